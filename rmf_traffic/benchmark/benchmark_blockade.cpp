@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Load simulation for the blockade Moderator.
+//
+// A fleet drives through a grid. Some robots travel along its rows and the
+// rest travel up its columns, so every column robot has to cross every row
+// robot. Each robot is a blockade::Participant whose writer is a Moderator,
+// and a ModeratorRectificationRequesterFactory rectifies them periodically, the
+// same way that the blockade unit tests run. Every simulation prints one CSV
+// row to stdout:
+//
+//   robots,path_length,crossing,threads,finished,steps,wall_ms,updates,
+//   updates_per_s,set_mean_us,set_max_us,ready_mean_us,ready_max_us,
+//   reached_mean_us,reached_max_us,rectify_mean_us,peak_rss_kb
+//
+// peak_rss_kb is the peak resident memory of the whole process after the
+// simulation, so it only ever grows from one row to the next.
+//
+// Usage: benchmark_blockade [--min-robots N] [--max-robots N]
+//                           [--path-length N] [--crossing FRACTION]
+//                           [--threads N] [--max-steps N]
+
+#include <rmf_traffic/blockade/Moderator.hpp>
+#include <rmf_traffic/blockade/Participant.hpp>
+#include <rmf_traffic/blockade/Rectifier.hpp>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+//==============================================================================
+struct Settings
+{
+  std::size_t min_robots = 2;
+  std::size_t max_robots = 40;
+  std::size_t path_length = 10;
+  double crossing = 0.5;
+  std::size_t threads = 1;
+  std::size_t max_steps = 100000;
+};
+
+//==============================================================================
+using Clock = std::chrono::steady_clock;
+using Checkpoint = rmf_traffic::blockade::Writer::Checkpoint;
+
+//==============================================================================
+const std::string map_name = "benchmark";
+
+//==============================================================================
+/// The latency of one kind of writer call
+struct Latency
+{
+  std::size_t count = 0;
+  Clock::duration total = Clock::duration(0);
+  Clock::duration max = Clock::duration(0);
+
+  void add(const Clock::duration duration)
+  {
+    ++count;
+    total += duration;
+    max = std::max(max, duration);
+  }
+
+  double mean_us() const
+  {
+    if (count == 0)
+      return 0.0;
+
+    return to_us(total) / static_cast<double>(count);
+  }
+
+  double max_us() const
+  {
+    return to_us(max);
+  }
+
+  static double to_us(const Clock::duration duration)
+  {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  }
+};
+
+//==============================================================================
+/// A writer that times every call that it forwards to a moderator
+class TimedWriter : public rmf_traffic::blockade::Writer
+{
+public:
+
+  using ParticipantId = rmf_traffic::blockade::ParticipantId;
+  using ReservationId = rmf_traffic::blockade::ReservationId;
+  using CheckpointId = rmf_traffic::blockade::CheckpointId;
+
+  TimedWriter(std::shared_ptr<rmf_traffic::blockade::Moderator> moderator)
+  : _moderator(std::move(moderator))
+  {
+    // Do nothing
+  }
+
+  void set(
+    const ParticipantId participant_id,
+    const ReservationId reservation_id,
+    const Reservation& reservation) final
+  {
+    const auto start = Clock::now();
+    _moderator->set(participant_id, reservation_id, reservation);
+    set_latency.add(Clock::now() - start);
+  }
+
+  void ready(
+    const ParticipantId participant_id,
+    const ReservationId reservation_id,
+    const CheckpointId checkpoint) final
+  {
+    const auto start = Clock::now();
+    _moderator->ready(participant_id, reservation_id, checkpoint);
+    ready_latency.add(Clock::now() - start);
+  }
+
+  void release(
+    const ParticipantId participant_id,
+    const ReservationId reservation_id,
+    const CheckpointId checkpoint) final
+  {
+    const auto start = Clock::now();
+    _moderator->release(participant_id, reservation_id, checkpoint);
+    other_latency.add(Clock::now() - start);
+  }
+
+  void reached(
+    const ParticipantId participant_id,
+    const ReservationId reservation_id,
+    const CheckpointId checkpoint) final
+  {
+    const auto start = Clock::now();
+    _moderator->reached(participant_id, reservation_id, checkpoint);
+    reached_latency.add(Clock::now() - start);
+  }
+
+  void cancel(
+    const ParticipantId participant_id,
+    const ReservationId reservation_id) final
+  {
+    const auto start = Clock::now();
+    _moderator->cancel(participant_id, reservation_id);
+    other_latency.add(Clock::now() - start);
+  }
+
+  void cancel(const ParticipantId participant_id) final
+  {
+    const auto start = Clock::now();
+    _moderator->cancel(participant_id);
+    other_latency.add(Clock::now() - start);
+  }
+
+  std::size_t updates() const
+  {
+    return set_latency.count + ready_latency.count
+      + reached_latency.count + other_latency.count;
+  }
+
+  Latency set_latency;
+  Latency ready_latency;
+  Latency reached_latency;
+  Latency other_latency;
+
+private:
+  std::shared_ptr<rmf_traffic::blockade::Moderator> _moderator;
+};
+
+//==============================================================================
+/// Make a straight path with evenly spaced checkpoints
+std::vector<Checkpoint> make_line(
+  const Eigen::Vector2d start,
+  const Eigen::Vector2d finish,
+  const std::size_t length)
+{
+  std::vector<Checkpoint> path;
+  path.reserve(length);
+  for (std::size_t i = 0; i < length; ++i)
+  {
+    const double s = static_cast<double>(i) / static_cast<double>(length - 1);
+    path.push_back(Checkpoint{start + s * (finish - start), map_name, true});
+  }
+
+  return path;
+}
+
+//==============================================================================
+/// Rows are 3 meters apart and the columns are spread evenly across the width
+/// of the grid. Robots on neighboring rows drive in opposite directions.
+std::vector<std::vector<Checkpoint>> make_paths(
+  const std::size_t robots,
+  const std::size_t length,
+  const double crossing)
+{
+  const auto columns = std::min(
+    robots - 1,
+    static_cast<std::size_t>(crossing * static_cast<double>(robots)));
+  const auto rows = robots - columns;
+
+  const double width = 3.0 * static_cast<double>(length - 1);
+  const double height = 3.0 * static_cast<double>(rows - 1);
+
+  std::vector<std::vector<Checkpoint>> paths;
+  for (std::size_t r = 0; r < rows; ++r)
+  {
+    const double y = 3.0 * static_cast<double>(r);
+    if (r % 2 == 0)
+      paths.push_back(make_line({0.0, y}, {width, y}, length));
+    else
+      paths.push_back(make_line({width, y}, {0.0, y}, length));
+  }
+
+  for (std::size_t c = 0; c < columns; ++c)
+  {
+    const double x =
+      width * (static_cast<double>(c) + 0.5) / static_cast<double>(columns);
+    paths.push_back(make_line({x, -3.0}, {x, height + 3.0}, length));
+  }
+
+  return paths;
+}
+
+//==============================================================================
+/// A robot that advances one checkpoint every few steps while it is allowed to
+class SimRobot
+{
+public:
+
+  SimRobot(rmf_traffic::blockade::Participant participant)
+  : _participant(std::move(participant))
+  {
+    // Do nothing
+  }
+
+  bool finished() const
+  {
+    return _participant.path().size() <= _participant.last_reached() + 1;
+  }
+
+  void step(const rmf_traffic::blockade::ReservedRange& range)
+  {
+    if (finished())
+      return;
+
+    if (range.end == _participant.last_reached())
+    {
+      if (_participant.last_ready() != range.end)
+        _participant.ready(range.end);
+
+      return;
+    }
+
+    if (_current_steps < StepsPerCheckpoint)
+    {
+      ++_current_steps;
+      return;
+    }
+
+    _current_steps = 0;
+    _participant.reached(_participant.last_reached() + 1);
+  }
+
+  rmf_traffic::blockade::ParticipantId id() const
+  {
+    return _participant.id();
+  }
+
+private:
+  static constexpr std::size_t StepsPerCheckpoint = 3;
+  rmf_traffic::blockade::Participant _participant;
+  std::size_t _current_steps = 0;
+};
+
+//==============================================================================
+std::size_t peak_rss_kb()
+{
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return static_cast<std::size_t>(usage.ru_maxrss);
+}
+
+//==============================================================================
+void run(const Settings& settings, const std::size_t robots)
+{
+  const double radius = 0.5;
+
+  const auto moderator = std::make_shared<rmf_traffic::blockade::Moderator>();
+  moderator->threads(settings.threads);
+  const auto writer = std::make_shared<TimedWriter>(moderator);
+  const auto rectifier_factory = std::make_shared<
+    rmf_traffic::blockade::ModeratorRectificationRequesterFactory>(moderator);
+
+  const auto start = Clock::now();
+
+  std::vector<SimRobot> fleet;
+  auto paths = make_paths(robots, settings.path_length, settings.crossing);
+  for (std::size_t i = 0; i < paths.size(); ++i)
+  {
+    auto participant = rmf_traffic::blockade::make_participant(
+      i, radius, writer, rectifier_factory);
+    participant.set(std::move(paths[i]));
+    fleet.emplace_back(std::move(participant));
+  }
+
+  const auto all_finished = [&fleet]()
+    {
+      return std::all_of(
+        fleet.begin(), fleet.end(),
+        [](const SimRobot& r) { return r.finished(); });
+    };
+
+  Latency rectify_latency;
+  std::size_t steps = 0;
+  while (!all_finished() && steps < settings.max_steps)
+  {
+    const auto& ranges = moderator->assignments().ranges();
+    for (auto& robot : fleet)
+    {
+      const auto it = ranges.find(robot.id());
+      if (it != ranges.end())
+        robot.step(it->second);
+    }
+
+    const auto rectify_start = Clock::now();
+    rectifier_factory->rectify();
+    rectify_latency.add(Clock::now() - rectify_start);
+
+    ++steps;
+  }
+
+  const auto finish = Clock::now();
+  const double wall_ms =
+    std::chrono::duration<double, std::milli>(finish - start).count();
+  const std::size_t updates = writer->updates();
+  const double updates_per_s =
+    wall_ms > 0.0 ? 1000.0 * static_cast<double>(updates) / wall_ms : 0.0;
+
+  std::cout << robots << "," << settings.path_length << ","
+            << settings.crossing << "," << settings.threads << ","
+            << all_finished() << "," << steps << "," << wall_ms << ","
+            << updates << "," << updates_per_s << ","
+            << writer->set_latency.mean_us() << ","
+            << writer->set_latency.max_us() << ","
+            << writer->ready_latency.mean_us() << ","
+            << writer->ready_latency.max_us() << ","
+            << writer->reached_latency.mean_us() << ","
+            << writer->reached_latency.max_us() << ","
+            << rectify_latency.mean_us() << ","
+            << peak_rss_kb() << std::endl;
+}
+
+//==============================================================================
+Settings parse_settings(int argc, char* argv[])
+{
+  Settings settings;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--min-robots" && i+1 < argc)
+    {
+      settings.min_robots = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--max-robots" && i+1 < argc)
+    {
+      settings.max_robots = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--path-length" && i+1 < argc)
+    {
+      settings.path_length = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--crossing" && i+1 < argc)
+    {
+      settings.crossing = std::strtod(argv[++i], nullptr);
+    }
+    else if (arg == "--threads" && i+1 < argc)
+    {
+      settings.threads = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--max-steps" && i+1 < argc)
+    {
+      settings.max_steps = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [--min-robots N] [--max-robots N] [--path-length N]"
+                << " [--crossing FRACTION] [--threads N] [--max-steps N]"
+                << std::endl;
+      std::exit(1);
+    }
+  }
+
+  if (settings.min_robots < 2)
+    settings.min_robots = 2;
+
+  if (settings.path_length < 2)
+    settings.path_length = 2;
+
+  settings.crossing = std::clamp(settings.crossing, 0.0, 1.0);
+
+  return settings;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const Settings settings = parse_settings(argc, argv);
+
+  std::cout << "robots,path_length,crossing,threads,finished,steps,wall_ms,"
+            << "updates,updates_per_s,set_mean_us,set_max_us,ready_mean_us,"
+            << "ready_max_us,reached_mean_us,reached_max_us,rectify_mean_us,"
+            << "peak_rss_kb" << std::endl;
+
+  for (std::size_t n = settings.min_robots; n <= settings.max_robots; ++n)
+    run(settings, n);
+
+  return 0;
+}
@@ -0,0 +1,435 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Microbenchmarks for conflict detection and the spline math underneath it.
+//
+// Every benchmark prints one CSV row to stdout so that the results can be
+// collected and compared across releases:
+//
+//   benchmark,scenario,shape,iterations,total_ns,mean_ns,checksum
+//
+// The checksum is derived from the results of the benchmarked calls. It should
+// stay the same between runs of the same build, and it keeps the compiler from
+// optimizing the calls away.
+//
+// Usage: benchmark_conflict [--iterations N] [--filter TEXT]
+
+#include "src/rmf_traffic/DetectConflictInternal.hpp"
+#include "src/rmf_traffic/Spline.hpp"
+#include "test/regression/utils_ConflictCorpus.hpp"
+
+#include <rmf_traffic/DetectConflict.hpp>
+#include <rmf_traffic/geometry/Box.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+//==============================================================================
+struct Settings
+{
+  std::size_t iterations = 100;
+  std::string filter;
+};
+
+//==============================================================================
+struct Scenario
+{
+  std::string name;
+  rmf_traffic::Trajectory a;
+  rmf_traffic::Trajectory b;
+};
+
+//==============================================================================
+struct Shape
+{
+  std::string name;
+  rmf_traffic::geometry::ConstFinalConvexShapePtr footprint;
+  rmf_traffic::geometry::ConstFinalConvexShapePtr vicinity;
+};
+
+//==============================================================================
+const rmf_traffic::Time t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+
+//==============================================================================
+rmf_traffic::Trajectory make_line(
+  const Eigen::Vector2d start,
+  const Eigen::Vector2d finish,
+  const rmf_traffic::Duration duration,
+  const std::size_t num_segments)
+{
+  const double yaw = std::atan2(finish.y() - start.y(), finish.x() - start.x());
+  const Eigen::Vector2d v =
+    (finish - start) / rmf_traffic::time::to_seconds(duration);
+
+  rmf_traffic::Trajectory trajectory;
+  for (std::size_t i = 0; i <= num_segments; ++i)
+  {
+    const double s = static_cast<double>(i)/static_cast<double>(num_segments);
+    const Eigen::Vector2d p = start + s*(finish - start);
+    trajectory.insert(
+      t0 + rmf_traffic::time::from_seconds(
+        s * rmf_traffic::time::to_seconds(duration)),
+      {p.x(), p.y(), yaw},
+      {v.x(), v.y(), 0.0});
+  }
+
+  return trajectory;
+}
+
+//==============================================================================
+/// A long trajectory that zig-zags across the x axis while moving along it
+rmf_traffic::Trajectory make_zigzag(
+  const double x_offset,
+  const std::size_t num_waypoints)
+{
+  rmf_traffic::Trajectory trajectory;
+  for (std::size_t i = 0; i < num_waypoints; ++i)
+  {
+    const double x = x_offset + 0.5 * static_cast<double>(i);
+    const double y = (i % 2 == 0) ? -1.0 : 1.0;
+    trajectory.insert(
+      t0 + std::chrono::milliseconds(500 * i),
+      {x, y, 0.0},
+      {1.0, 0.0, 0.0});
+  }
+
+  return trajectory;
+}
+
+//==============================================================================
+std::vector<Scenario> make_scenarios()
+{
+  std::vector<Scenario> scenarios;
+
+  // Two agents drive straight at each other down the same corridor
+  scenarios.push_back(
+    {
+      "head_on_corridor",
+      make_line({-10, 0}, {10, 0}, 20s, 4),
+      make_line({10, 0}, {-10, 0}, 20s, 4)
+    });
+
+  // Two agents pass through the same intersection at the same time
+  scenarios.push_back(
+    {
+      "crossing_paths",
+      make_line({-10, 0}, {10, 0}, 20s, 4),
+      make_line({0, -10}, {0, 10}, 20s, 4)
+    });
+
+  // Two agents drive side by side in neighboring lanes without touching
+  scenarios.push_back(
+    {
+      "parallel_lanes",
+      make_line({-10, 0}, {10, 0}, 20s, 4),
+      make_line({-10, 1.5}, {10, 1.5}, 20s, 4)
+    });
+
+  // Two long itineraries along the same path where one agent follows the other
+  // without catching up
+  scenarios.push_back(
+    {
+      "long_trajectories",
+      make_zigzag(0.0, 1200),
+      make_zigzag(10.0, 1200)
+    });
+
+  return scenarios;
+}
+
+//==============================================================================
+std::vector<Shape> make_shapes()
+{
+  using rmf_traffic::geometry::make_final_convex;
+  using rmf_traffic::geometry::Box;
+  using rmf_traffic::geometry::Circle;
+
+  return {
+    {"circle", make_final_convex<Circle>(0.5), make_final_convex<Circle>(0.6)},
+    {"box", make_final_convex<Box>(1.0, 1.0), make_final_convex<Box>(1.2, 1.2)}
+  };
+}
+
+//==============================================================================
+std::vector<rmf_traffic::Spline> make_splines(
+  const rmf_traffic::Trajectory& trajectory)
+{
+  std::vector<rmf_traffic::Spline> splines;
+  for (auto it = ++trajectory.begin(); it != trajectory.end(); ++it)
+    splines.emplace_back(it);
+
+  return splines;
+}
+
+//==============================================================================
+/// Pairs up the segments of two trajectories that are active at the same time
+std::vector<std::pair<rmf_traffic::Spline, rmf_traffic::Spline>>
+make_spline_pairs(const Scenario& scenario)
+{
+  const auto splines_a = make_splines(scenario.a);
+  const auto splines_b = make_splines(scenario.b);
+
+  std::vector<std::pair<rmf_traffic::Spline, rmf_traffic::Spline>> pairs;
+  for (const auto& a : splines_a)
+  {
+    for (const auto& b : splines_b)
+    {
+      if (a.finish_time() < b.start_time() || b.finish_time() < a.start_time())
+        continue;
+
+      pairs.emplace_back(a, b);
+    }
+  }
+
+  return pairs;
+}
+
+//==============================================================================
+void run(
+  const Settings& settings,
+  const std::string& benchmark,
+  const std::string& scenario,
+  const std::string& shape,
+  const std::function<double()>& body)
+{
+  const std::string name = benchmark + "/" + scenario + "/" + shape;
+  if (!settings.filter.empty() && name.find(settings.filter) == name.npos)
+    return;
+
+  // Warm up any caches before we start measuring
+  double checksum = body();
+
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < settings.iterations; ++i)
+    checksum += body();
+  const auto finish = std::chrono::steady_clock::now();
+
+  const auto total_ns =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start)
+    .count();
+
+  std::cout << benchmark << "," << scenario << "," << shape << ","
+            << settings.iterations << "," << total_ns << ","
+            << total_ns / static_cast<long long>(settings.iterations) << ","
+            << checksum << std::endl;
+}
+
+//==============================================================================
+void benchmark_between(
+  const Settings& settings,
+  const Scenario& scenario,
+  const Shape& shape)
+{
+  const rmf_traffic::Profile profile{shape.footprint, shape.vicinity};
+  run(settings, "between", scenario.name, shape.name, [&]() -> double
+    {
+      const auto conflict = rmf_traffic::DetectConflict::between(
+        profile, scenario.a, nullptr, profile, scenario.b, nullptr);
+
+      if (!conflict)
+        return 0.0;
+
+      return rmf_traffic::time::to_seconds(conflict->time - t0);
+    });
+}
+
+//==============================================================================
+void benchmark_check_collision(
+  const Settings& settings,
+  const Scenario& scenario,
+  const Shape& shape)
+{
+  const auto pairs = make_spline_pairs(scenario);
+  run(settings, "check_collision", scenario.name, shape.name, [&]() -> double
+    {
+      double checksum = 0.0;
+      for (const auto& pair : pairs)
+      {
+        const auto collision = rmf_traffic::internal::check_collision(
+          *shape.footprint, pair.first, *shape.vicinity, pair.second);
+
+        if (collision)
+          checksum += rmf_traffic::time::to_seconds(*collision - t0);
+      }
+
+      return checksum;
+    });
+}
+
+//==============================================================================
+void benchmark_approach_times(
+  const Settings& settings,
+  const Scenario& scenario)
+{
+  const auto pairs = make_spline_pairs(scenario);
+  run(settings, "approach_times", scenario.name, "none", [&]() -> double
+    {
+      double checksum = 0.0;
+      for (const auto& pair : pairs)
+      {
+        const rmf_traffic::DistanceDifferential D(pair.first, pair.second);
+        for (const auto t : D.approach_times())
+          checksum += rmf_traffic::time::to_seconds(t - t0);
+      }
+
+      return checksum;
+    });
+}
+
+//==============================================================================
+/// Check every pair of the regression corpus one at a time, and then through
+/// the batch API with different numbers of threads. The checksums of all the
+/// rows for the same shape must match, and the ratios of their mean times give
+/// the speedup of each path.
+void benchmark_corpus(
+  const Settings& settings,
+  const std::vector<ConflictCorpusEntry>& corpus,
+  const Shape& shape)
+{
+  using rmf_traffic::DetectConflict;
+  const rmf_traffic::Profile profile{shape.footprint, shape.vicinity};
+  const auto scenario = "corpus_" + std::to_string(corpus.size());
+
+  run(settings, "between", scenario, shape.name, [&]() -> double
+    {
+      double checksum = 0.0;
+      for (const auto& entry : corpus)
+      {
+        const auto conflict = DetectConflict::between(
+          profile, entry.a, nullptr, profile, entry.b, nullptr);
+
+        if (conflict)
+          checksum += rmf_traffic::time::to_seconds(conflict->time - t0);
+      }
+
+      return checksum;
+    });
+
+  std::vector<DetectConflict::Pair> pairs;
+  for (const auto& entry : corpus)
+    pairs.push_back({&profile, &entry.a, nullptr, &profile, &entry.b});
+
+  for (const std::size_t threads : {1, 4})
+  {
+    const DetectConflict::BatchOptions options(true, threads);
+    run(
+      settings, "between_pairs_" + std::to_string(threads), scenario,
+      shape.name, [&]() -> double
+      {
+        double checksum = 0.0;
+        for (const auto& c : DetectConflict::between_pairs(pairs, options))
+          checksum += rmf_traffic::time::to_seconds(c.conflict.time - t0);
+
+        return checksum;
+      });
+  }
+}
+
+//==============================================================================
+void benchmark_compute_position(
+  const Settings& settings,
+  const Scenario& scenario)
+{
+  const auto splines = make_splines(scenario.a);
+  run(settings, "compute_position", scenario.name, "none", [&]() -> double
+    {
+      constexpr std::size_t Samples = 16;
+      double checksum = 0.0;
+      for (const auto& spline : splines)
+      {
+        const auto duration = spline.finish_time() - spline.start_time();
+        for (std::size_t i = 0; i < Samples; ++i)
+        {
+          const auto t = spline.start_time()
+            + duration * static_cast<int>(i) / static_cast<int>(Samples);
+          checksum += spline.compute_position(t).sum();
+        }
+      }
+
+      return checksum;
+    });
+}
+
+//==============================================================================
+Settings parse_settings(int argc, char* argv[])
+{
+  Settings settings;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--iterations" && i+1 < argc)
+    {
+      settings.iterations = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--filter" && i+1 < argc)
+    {
+      settings.filter = argv[++i];
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [--iterations N] [--filter TEXT]" << std::endl;
+      std::exit(1);
+    }
+  }
+
+  if (settings.iterations == 0)
+    settings.iterations = 1;
+
+  return settings;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const Settings settings = parse_settings(argc, argv);
+  const auto scenarios = make_scenarios();
+  const auto shapes = make_shapes();
+
+  std::cout << "benchmark,scenario,shape,iterations,total_ns,mean_ns,checksum"
+            << std::endl;
+
+  for (const auto& scenario : scenarios)
+  {
+    for (const auto& shape : shapes)
+    {
+      benchmark_between(settings, scenario, shape);
+      benchmark_check_collision(settings, scenario, shape);
+    }
+
+    benchmark_approach_times(settings, scenario);
+    benchmark_compute_position(settings, scenario);
+  }
+
+  const auto corpus = make_conflict_corpus(200);
+  for (const auto& shape : shapes)
+    benchmark_corpus(settings, corpus, shape);
+
+  return 0;
+}
@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Benchmarks for how negotiations scale with the number of robots.
+//
+// Robots are placed on generated grid and corridor graphs and asked to swap
+// places or cross paths, then a CentralizedNegotiation is solved for them.
+// Every solve prints one CSV row to stdout:
+//
+//   scenario,robots,mode,success,wall_ms,tables,rejections,forfeits,
+//   responses,planning_attempts,expansions,validator_checks,peak_rss_kb
+//
+// peak_rss_kb is the peak resident memory of the whole process after the
+// solve, so it only ever grows from one row to the next.
+//
+// Usage: benchmark_negotiation [--min-robots N] [--max-robots N]
+//                              [--budget SECONDS] [--filter TEXT]
+
+#include <rmf_traffic/agv/CentralizedNegotiation.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Participant.hpp>
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+//==============================================================================
+struct Settings
+{
+  std::size_t min_robots = 2;
+  std::size_t max_robots = 20;
+  double budget = 30.0;
+  std::string filter;
+};
+
+//==============================================================================
+/// Where each robot starts and where it needs to go
+struct Task
+{
+  std::size_t start;
+  std::size_t goal;
+};
+
+//==============================================================================
+struct Scenario
+{
+  std::string name;
+  rmf_traffic::agv::Graph graph;
+  std::vector<Task> tasks;
+};
+
+//==============================================================================
+/// A negotiation setting that is being compared
+struct Mode
+{
+  std::string name;
+  std::function<void(rmf_traffic::agv::CentralizedNegotiation&)> apply;
+};
+
+//==============================================================================
+const std::string map_name = "benchmark";
+
+//==============================================================================
+void add_bidir_lane(
+  rmf_traffic::agv::Graph& graph,
+  const std::size_t w0,
+  const std::size_t w1)
+{
+  graph.add_lane(w0, w1);
+  graph.add_lane(w1, w0);
+}
+
+//==============================================================================
+/// A square grid with enough rows and columns to give every robot its own
+/// row and its own column
+rmf_traffic::agv::Graph make_grid(const std::size_t size)
+{
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t row = 0; row < size; ++row)
+  {
+    for (std::size_t col = 0; col < size; ++col)
+    {
+      const double x = 3.0 * static_cast<double>(col);
+      const double y = 3.0 * static_cast<double>(row);
+      graph.add_waypoint(map_name, {x, y}).set_holding_point(true);
+    }
+  }
+
+  for (std::size_t row = 0; row < size; ++row)
+  {
+    for (std::size_t col = 0; col < size; ++col)
+    {
+      const std::size_t w = row * size + col;
+      if (col + 1 < size)
+        add_bidir_lane(graph, w, w + 1);
+
+      if (row + 1 < size)
+        add_bidir_lane(graph, w, w + size);
+    }
+  }
+
+  return graph;
+}
+
+//==============================================================================
+/// Every pair of robots swaps the ends of one row of a grid
+Scenario make_grid_swap(const std::size_t robots)
+{
+  const std::size_t size = std::max<std::size_t>((robots + 1) / 2, 2) + 2;
+  Scenario scenario{"grid_swap", make_grid(size), {}};
+  for (std::size_t i = 0; i < robots; ++i)
+  {
+    const std::size_t row = i / 2 + 1;
+    const std::size_t left = row * size;
+    const std::size_t right = row * size + size - 1;
+    if (i % 2 == 0)
+      scenario.tasks.push_back({left, right});
+    else
+      scenario.tasks.push_back({right, left});
+  }
+
+  return scenario;
+}
+
+//==============================================================================
+/// Half of the robots cross a grid from left to right while the rest cross it
+/// from bottom to top
+Scenario make_grid_crossing(const std::size_t robots)
+{
+  const std::size_t size = std::max<std::size_t>((robots + 1) / 2, 2) + 2;
+  Scenario scenario{"grid_crossing", make_grid(size), {}};
+  for (std::size_t i = 0; i < robots; ++i)
+  {
+    const std::size_t lane = i / 2 + 1;
+    if (i % 2 == 0)
+      scenario.tasks.push_back({lane * size, lane * size + size - 1});
+    else
+      scenario.tasks.push_back({lane, (size - 1) * size + lane});
+  }
+
+  return scenario;
+}
+
+//==============================================================================
+/// A single corridor with a holding bay next to each of its waypoints. The
+/// robots start spread along the corridor and need to reverse their order.
+Scenario make_corridor_swap(const std::size_t robots)
+{
+  const std::size_t length = 2 * robots + 2;
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < length; ++i)
+  {
+    graph.add_waypoint(map_name, {3.0 * static_cast<double>(i), 0.0})
+    .set_holding_point(true);
+  }
+
+  for (std::size_t i = 0; i < length; ++i)
+  {
+    const std::size_t bay = graph.add_waypoint(
+      map_name, {3.0 * static_cast<double>(i), 3.0})
+      .set_holding_point(true).index();
+    add_bidir_lane(graph, i, bay);
+
+    if (i + 1 < length)
+      add_bidir_lane(graph, i, i + 1);
+  }
+
+  Scenario scenario{"corridor_swap", std::move(graph), {}};
+  for (std::size_t i = 0; i < robots; ++i)
+  {
+    const std::size_t start = 2 * i + 1;
+    const std::size_t goal = length - 1 - start;
+    scenario.tasks.push_back({start, goal});
+  }
+
+  return scenario;
+}
+
+//==============================================================================
+std::size_t peak_rss_kb()
+{
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return static_cast<std::size_t>(usage.ru_maxrss);
+}
+
+//==============================================================================
+void run(
+  const Settings& settings,
+  const Scenario& scenario,
+  const Mode& mode)
+{
+  const std::size_t robots = scenario.tasks.size();
+  const std::string name =
+    scenario.name + "/" + std::to_string(robots) + "/" + mode.name;
+  if (!settings.filter.empty() && name.find(settings.filter) == name.npos)
+    return;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {0.7, 0.3},
+    {1.0, 0.45},
+    profile
+  };
+
+  const auto planner = std::make_shared<rmf_traffic::agv::Planner>(
+    rmf_traffic::agv::Planner::Configuration{scenario.graph, traits},
+    rmf_traffic::agv::Planner::Options{nullptr});
+
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  std::vector<rmf_traffic::schedule::Participant> participants;
+  std::vector<rmf_traffic::agv::CentralizedNegotiation::Agent> agents;
+  const auto now = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < robots; ++i)
+  {
+    participants.push_back(
+      rmf_traffic::schedule::make_participant(
+        rmf_traffic::schedule::ParticipantDescription{
+          "robot " + std::to_string(i),
+          "benchmark_negotiation",
+          rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+          profile
+        },
+        database));
+
+    const auto& task = scenario.tasks[i];
+    agents.push_back(
+      {
+        participants.back().id(),
+        {{now, task.start, 0.0}},
+        task.goal,
+        planner
+      });
+  }
+
+  rmf_traffic::agv::CentralizedNegotiation negotiation(database);
+  negotiation.time_budget(rmf_traffic::time::from_seconds(settings.budget));
+  mode.apply(negotiation);
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto result = negotiation.solve(agents);
+  const auto finish = std::chrono::steady_clock::now();
+
+  const auto wall_ms =
+    std::chrono::duration_cast<std::chrono::milliseconds>(finish - start)
+    .count();
+
+  const auto& stats = result.statistics();
+  rmf_traffic::agv::SimpleNegotiator::Statistics work;
+  for (const auto& response : stats.responses)
+    work += response.work;
+
+  std::cout << scenario.name << "," << robots << "," << mode.name << ","
+            << result.proposal().has_value() << "," << wall_ms << ","
+            << stats.negotiation.tables_created << ","
+            << stats.negotiation.rejections << ","
+            << stats.negotiation.forfeits << ","
+            << work.responses << "," << work.planning_attempts << ","
+            << work.expansions << "," << work.validator_checks << ","
+            << peak_rss_kb() << std::endl;
+}
+
+//==============================================================================
+Settings parse_settings(int argc, char* argv[])
+{
+  Settings settings;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--min-robots" && i+1 < argc)
+    {
+      settings.min_robots = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--max-robots" && i+1 < argc)
+    {
+      settings.max_robots = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--budget" && i+1 < argc)
+    {
+      settings.budget = std::strtod(argv[++i], nullptr);
+    }
+    else if (arg == "--filter" && i+1 < argc)
+    {
+      settings.filter = argv[++i];
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [--min-robots N] [--max-robots N] [--budget SECONDS]"
+                << " [--filter TEXT]" << std::endl;
+      std::exit(1);
+    }
+  }
+
+  if (settings.min_robots < 2)
+    settings.min_robots = 2;
+
+  return settings;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const Settings settings = parse_settings(argc, argv);
+
+  const std::vector<std::function<Scenario(std::size_t)>> scenarios = {
+    make_grid_swap,
+    make_grid_crossing,
+    make_corridor_swap
+  };
+
+  using rmf_traffic::agv::CentralizedNegotiation;
+  const std::vector<Mode> modes = {
+    {"default", [](CentralizedNegotiation&) {}},
+    {"best_first", [](CentralizedNegotiation& n) { n.best_first(); }},
+    {"threads_4", [](CentralizedNegotiation& n) { n.threads(4); }}
+  };
+
+  std::cout << "scenario,robots,mode,success,wall_ms,tables,rejections,"
+            << "forfeits,responses,planning_attempts,expansions,"
+            << "validator_checks,peak_rss_kb" << std::endl;
+
+  for (std::size_t n = settings.min_robots; n <= settings.max_robots; ++n)
+  {
+    for (const auto& make_scenario : scenarios)
+    {
+      const auto scenario = make_scenario(n);
+      for (const auto& mode : modes)
+        run(settings, scenario, mode);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,532 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Benchmarks for the planner on large generated graphs.
+//
+// Each scenario generates a graph, plans itineraries for a number of obstacle
+// robots and puts them in a schedule::Database, and then times a set of
+// planner requests between random waypoints. The heuristic of each goal is
+// warmed up first, so the plan timings measure the search itself. Every
+// measurement prints one CSV row to stdout:
+//
+//   scenario,waypoints,lanes,obstacles,measurement,samples,successes,
+//   mean_ms,p50_ms,p90_ms,p99_ms,max_ms,mean_expansions
+//
+// The measurements are:
+//   warm_cache     - Planner::warm_cache() for one goal at a time
+//   plan           - Planner::plan() with a validator for the schedule
+//   setup_resume   - Planner::setup() followed by Planner::Result::resume()
+//   quickest_path  - Planner::quickest_path()
+//
+// The same seed always gives the same graphs, obstacles, and requests.
+//
+// Usage: benchmark_planner [--obstacles N] [--samples N] [--seed N]
+//                          [--timeout SECONDS] [--floors N] [--filter TEXT]
+
+#include <rmf_traffic/agv/Planner.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Participant.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+//==============================================================================
+struct Settings
+{
+  std::size_t obstacles = 20;
+  std::size_t samples = 20;
+  std::size_t seed = 42;
+  double timeout = 10.0;
+  std::size_t floors = 4;
+  std::string filter;
+};
+
+//==============================================================================
+using Clock = std::chrono::steady_clock;
+using Graph = rmf_traffic::agv::Graph;
+using Planner = rmf_traffic::agv::Planner;
+
+//==============================================================================
+struct Scenario
+{
+  std::string name;
+  Graph graph;
+
+  // The waypoints that robots may start from or go to
+  std::vector<std::size_t> stops;
+};
+
+//==============================================================================
+/// The timings of one kind of request
+struct Samples
+{
+  std::vector<Clock::duration> durations;
+  std::size_t successes = 0;
+  std::size_t expansions = 0;
+
+  void add(const Clock::duration duration, const bool success)
+  {
+    durations.push_back(duration);
+    if (success)
+      ++successes;
+  }
+};
+
+//==============================================================================
+void add_bidir_lane(Graph& graph, const std::size_t w0, const std::size_t w1)
+{
+  graph.add_lane(w0, w1);
+  graph.add_lane(w1, w0);
+}
+
+//==============================================================================
+/// A warehouse floor with 71x71 (about 5k) waypoints. Robots can drive along
+/// every row, but the racks only leave a cross aisle at every fifth column.
+Scenario make_warehouse(const Settings&)
+{
+  const std::size_t size = 71;
+  const double spacing = 2.0;
+  Scenario scenario{"warehouse_grid", Graph(), {}};
+  auto& graph = scenario.graph;
+  for (std::size_t row = 0; row < size; ++row)
+  {
+    for (std::size_t col = 0; col < size; ++col)
+    {
+      const double x = spacing * static_cast<double>(col);
+      const double y = spacing * static_cast<double>(row);
+      graph.add_waypoint("warehouse", {x, y}).set_holding_point(true);
+      scenario.stops.push_back(row * size + col);
+    }
+  }
+
+  for (std::size_t row = 0; row < size; ++row)
+  {
+    for (std::size_t col = 0; col < size; ++col)
+    {
+      const std::size_t w = row * size + col;
+      if (col + 1 < size)
+        add_bidir_lane(graph, w, w + 1);
+
+      const bool cross_aisle = col % 5 == 0 || col + 1 == size;
+      if (cross_aisle && row + 1 < size)
+        add_bidir_lane(graph, w, w + size);
+    }
+  }
+
+  return scenario;
+}
+
+//==============================================================================
+/// A hospital with several floors. Each floor is a ring of corridors around a
+/// courtyard with wards along it, and two lifts connect all of the floors.
+Scenario make_hospital(const Settings& settings)
+{
+  using Event = Graph::Lane::Event;
+  using LiftSessionBegin = Graph::Lane::LiftSessionBegin;
+  using LiftSessionEnd = Graph::Lane::LiftSessionEnd;
+  using LiftMove = Graph::Lane::LiftMove;
+
+  const std::size_t side = 30;
+  const double spacing = 2.5;
+  const std::size_t floors = std::max<std::size_t>(settings.floors, 1);
+  const std::vector<std::size_t> lift_corners = {0, 2*side};
+
+  Scenario scenario{"hospital", Graph(), {}};
+  auto& graph = scenario.graph;
+
+  // Waypoints along the ring of each floor, indexed by [floor][i]
+  std::vector<std::vector<std::size_t>> rings(floors);
+
+  // Waypoints inside each lift, indexed by [lift][floor]
+  std::vector<std::vector<std::size_t>> lifts(
+    lift_corners.size(), std::vector<std::size_t>(floors));
+
+  const auto ring_position = [&](const std::size_t i) -> Eigen::Vector2d
+    {
+      const double s = spacing * static_cast<double>(i % side);
+      const double l = spacing * static_cast<double>(side);
+      switch (i / side)
+      {
+        case 0: return {s, 0.0};
+        case 1: return {l, s};
+        case 2: return {l - s, l};
+        default: return {0.0, l - s};
+      }
+    };
+
+  for (std::size_t f = 0; f < floors; ++f)
+  {
+    const std::string floor = "L" + std::to_string(f+1);
+    for (std::size_t i = 0; i < 4*side; ++i)
+    {
+      const std::size_t corridor =
+        graph.add_waypoint(floor, ring_position(i)).index();
+      rings[f].push_back(corridor);
+
+      // Every few waypoints of the corridor there is the door of a ward
+      if (i % 3 == 1)
+      {
+        const Eigen::Vector2d p = ring_position(i);
+        const Eigen::Vector2d c = spacing * static_cast<double>(side) / 2.0
+          * Eigen::Vector2d::Ones();
+        const std::size_t ward = graph.add_waypoint(
+          floor, p + 2.0 * (c - p).normalized())
+          .set_holding_point(true).index();
+        add_bidir_lane(graph, corridor, ward);
+        scenario.stops.push_back(ward);
+      }
+    }
+
+    for (std::size_t i = 0; i < rings[f].size(); ++i)
+      add_bidir_lane(graph, rings[f][i], rings[f][(i+1) % rings[f].size()]);
+
+    for (std::size_t l = 0; l < lift_corners.size(); ++l)
+    {
+      const std::string lift = "lift_" + std::to_string(l);
+      const std::size_t corridor = rings[f][lift_corners[l]];
+      const Eigen::Vector2d p =
+        ring_position(lift_corners[l]) - Eigen::Vector2d(3.0, 3.0);
+      const std::size_t inside = graph.add_waypoint(floor, p).index();
+      lifts[l][f] = inside;
+
+      // Enter the lift
+      graph.add_lane(
+        {corridor, Event::make(LiftSessionBegin(lift, floor, 4s))}, inside);
+
+      // Exit the lift
+      graph.add_lane(
+        {inside, Event::make(LiftSessionBegin(lift, floor, 4s))},
+        {corridor, Event::make(LiftSessionEnd(lift, floor, 4s))});
+    }
+  }
+
+  for (std::size_t l = 0; l < lift_corners.size(); ++l)
+  {
+    const std::string lift = "lift_" + std::to_string(l);
+    for (std::size_t f = 0; f+1 < floors; ++f)
+    {
+      const std::string lower = "L" + std::to_string(f+1);
+      const std::string upper = "L" + std::to_string(f+2);
+      graph.add_lane(
+        {lifts[l][f], Event::make(LiftMove(lift, upper, 6s))},
+        lifts[l][f+1]);
+      graph.add_lane(
+        {lifts[l][f+1], Event::make(LiftMove(lift, lower, 6s))},
+        lifts[l][f]);
+    }
+  }
+
+  return scenario;
+}
+
+//==============================================================================
+/// Four long corridors that are joined at their ends into a loop, with a
+/// holding bay at every tenth waypoint
+Scenario make_corridors(const Settings&)
+{
+  const std::size_t corridors = 4;
+  const std::size_t length = 400;
+  const double spacing = 2.0;
+  Scenario scenario{"long_corridors", Graph(), {}};
+  auto& graph = scenario.graph;
+
+  std::vector<std::size_t> loop;
+  const double l = spacing * static_cast<double>(length);
+  for (std::size_t c = 0; c < corridors; ++c)
+  {
+    for (std::size_t i = 0; i < length; ++i)
+    {
+      const double s = spacing * static_cast<double>(i);
+      Eigen::Vector2d p;
+      switch (c)
+      {
+        case 0: p = {s, 0.0}; break;
+        case 1: p = {l, s}; break;
+        case 2: p = {l - s, l}; break;
+        default: p = {0.0, l - s}; break;
+      }
+
+      const std::size_t w = graph.add_waypoint("corridors", p).index();
+      loop.push_back(w);
+
+      if (i % 10 == 5)
+      {
+        const Eigen::Vector2d c_p = Eigen::Vector2d(l, l) / 2.0;
+        const std::size_t bay = graph.add_waypoint(
+          "corridors", p + 3.0 * (c_p - p).normalized())
+          .set_holding_point(true).index();
+        add_bidir_lane(graph, w, bay);
+        scenario.stops.push_back(bay);
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < loop.size(); ++i)
+    add_bidir_lane(graph, loop[i], loop[(i+1) % loop.size()]);
+
+  return scenario;
+}
+
+//==============================================================================
+double to_ms(const Clock::duration d)
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+//==============================================================================
+void print_row(
+  const Scenario& scenario,
+  const Settings& settings,
+  const std::string& measurement,
+  Samples samples)
+{
+  auto& d = samples.durations;
+  if (d.empty())
+    return;
+
+  std::sort(d.begin(), d.end());
+  const auto percentile = [&](const double p)
+    {
+      const auto rank = static_cast<std::size_t>(
+        std::ceil(p * static_cast<double>(d.size())));
+      return to_ms(d[std::min(std::max<std::size_t>(rank, 1), d.size()) - 1]);
+    };
+
+  Clock::duration total = Clock::duration(0);
+  for (const auto& s : d)
+    total += s;
+
+  const double n = static_cast<double>(d.size());
+  std::cout << scenario.name << "," << scenario.graph.num_waypoints() << ","
+            << scenario.graph.num_lanes() << "," << settings.obstacles << ","
+            << measurement << "," << d.size() << "," << samples.successes
+            << "," << to_ms(total) / n << "," << percentile(0.5) << ","
+            << percentile(0.9) << "," << percentile(0.99) << ","
+            << to_ms(d.back()) << ","
+            << static_cast<double>(samples.expansions) / n << std::endl;
+}
+
+//==============================================================================
+void run(const Settings& settings, const Scenario& scenario)
+{
+  if (!settings.filter.empty()
+    && scenario.name.find(settings.filter) == scenario.name.npos)
+    return;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.6)
+  };
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {0.7, 0.3},
+    {1.0, 0.45},
+    profile
+  };
+
+  std::mt19937 rng(static_cast<std::mt19937::result_type>(settings.seed));
+  std::uniform_int_distribution<std::size_t> pick(
+    0, scenario.stops.size() - 1);
+  const auto random_pair = [&]()
+    {
+      const std::size_t start = scenario.stops[pick(rng)];
+      std::size_t goal = scenario.stops[pick(rng)];
+      while (goal == start)
+        goal = scenario.stops[pick(rng)];
+
+      return std::make_pair(start, goal);
+    };
+
+  const Planner::Configuration config{scenario.graph, traits};
+  const auto start_time = Clock::now();
+
+  // The obstacles are planned by a planner of their own, so that they do not
+  // warm up the caches of the planner that is being measured.
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  std::vector<rmf_traffic::schedule::Participant> obstacles;
+  {
+    const Planner obstacle_planner{config, Planner::Options{nullptr}};
+    for (std::size_t i = 0; i < settings.obstacles; ++i)
+    {
+      const auto [start, goal] = random_pair();
+      const auto plan = obstacle_planner.plan(
+        Planner::Start{start_time, start, 0.0}, Planner::Goal{goal});
+      if (!plan.success())
+        continue;
+
+      obstacles.push_back(
+        rmf_traffic::schedule::make_participant(
+          rmf_traffic::schedule::ParticipantDescription{
+            "obstacle " + std::to_string(i),
+            "benchmark_planner",
+            rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+            profile
+          },
+          database));
+
+      auto& obstacle = obstacles.back();
+      obstacle.set(obstacle.assign_plan_id(), plan->get_itinerary());
+    }
+  }
+
+  std::vector<std::pair<std::size_t, std::size_t>> requests;
+  for (std::size_t i = 0; i < settings.samples; ++i)
+    requests.push_back(random_pair());
+
+  const Planner planner{config, Planner::Options{nullptr}};
+
+  Samples warm_cache;
+  for (const auto& request : requests)
+  {
+    const auto start = Clock::now();
+    planner.warm_cache({request.second});
+    warm_cache.add(Clock::now() - start, true);
+  }
+  print_row(scenario, settings, "warm_cache", std::move(warm_cache));
+
+  const auto make_options = [&]()
+    {
+      Planner::Options options{
+        rmf_utils::make_clone<rmf_traffic::agv::ScheduleRouteValidator>(
+          database,
+          std::numeric_limits<rmf_traffic::schedule::ParticipantId>::max(),
+          profile)
+      };
+
+      const auto deadline =
+        Clock::now() + rmf_traffic::time::from_seconds(settings.timeout);
+      options.interrupter([deadline]() { return deadline < Clock::now(); });
+      return options;
+    };
+
+  Samples plan;
+  for (const auto& [start, goal] : requests)
+  {
+    auto options = make_options();
+    const auto t0 = Clock::now();
+    const auto result = planner.plan(
+      Planner::Start{start_time, start, 0.0}, Planner::Goal{goal},
+      std::move(options));
+    plan.add(Clock::now() - t0, result.success());
+    plan.expansions += result.statistics().nodes_expanded;
+  }
+  print_row(scenario, settings, "plan", std::move(plan));
+
+  Samples setup_resume;
+  for (const auto& [start, goal] : requests)
+  {
+    auto options = make_options();
+    const auto t0 = Clock::now();
+    auto result = planner.setup(
+      Planner::Start{start_time, start, 0.0}, Planner::Goal{goal},
+      std::move(options));
+    result.resume();
+    setup_resume.add(Clock::now() - t0, result.success());
+    setup_resume.expansions += result.statistics().nodes_expanded;
+  }
+  print_row(scenario, settings, "setup_resume", std::move(setup_resume));
+
+  Samples quickest_path;
+  for (const auto& [start, goal] : requests)
+  {
+    const auto t0 = Clock::now();
+    const auto path = planner.quickest_path(
+      {Planner::Start{start_time, start, 0.0}}, goal);
+    quickest_path.add(Clock::now() - t0, path.has_value());
+  }
+  print_row(scenario, settings, "quickest_path", std::move(quickest_path));
+}
+
+//==============================================================================
+Settings parse_settings(int argc, char* argv[])
+{
+  Settings settings;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--obstacles" && i+1 < argc)
+    {
+      settings.obstacles = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--samples" && i+1 < argc)
+    {
+      settings.samples = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--seed" && i+1 < argc)
+    {
+      settings.seed = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--timeout" && i+1 < argc)
+    {
+      settings.timeout = std::strtod(argv[++i], nullptr);
+    }
+    else if (arg == "--floors" && i+1 < argc)
+    {
+      settings.floors = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--filter" && i+1 < argc)
+    {
+      settings.filter = argv[++i];
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [--obstacles N] [--samples N] [--seed N]"
+                << " [--timeout SECONDS] [--floors N] [--filter TEXT]"
+                << std::endl;
+      std::exit(1);
+    }
+  }
+
+  return settings;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const Settings settings = parse_settings(argc, argv);
+
+  const std::vector<std::function<Scenario(const Settings&)>> scenarios = {
+    make_warehouse,
+    make_hospital,
+    make_corridors
+  };
+
+  std::cout << "scenario,waypoints,lanes,obstacles,measurement,samples,"
+            << "successes,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,"
+            << "mean_expansions" << std::endl;
+
+  for (const auto& make_scenario : scenarios)
+    run(settings, make_scenario(settings));
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Replays a log that was recorded by schedule::Recorder against a fresh
+// schedule::Database, so that changes to the schedule can be measured on a
+// real workload instead of a synthetic one.
+//
+// The database can be started from a checkpoint that was saved when the
+// recording started, and its timeline can be given a different bucket size
+// than the recorded schedule used. Every patch that the recorded Changes calls
+// produce is given to a mirror, unless --no-mirror is passed.
+//
+// Every operation of every run prints one CSV row to stdout:
+//
+//   run,operation,count,failed,ops_per_s,mean_us,max_us
+//
+// ops_per_s only counts the time spent inside of the operation itself. The
+// "total" row gives the wall time of the whole run.
+//
+// Usage: benchmark_replay LOG [--checkpoint PATH] [--bucket SECONDS]
+//                             [--adaptive] [--runs N] [--paced] [--no-mirror]
+
+#include <rmf_traffic/schedule/Recorder.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+//==============================================================================
+struct Settings
+{
+  std::string log;
+  std::optional<std::string> checkpoint;
+  double bucket = 60.0;
+  bool adaptive = false;
+  std::size_t runs = 3;
+  bool paced = false;
+  bool mirror = true;
+};
+
+//==============================================================================
+using namespace rmf_traffic::schedule;
+
+//==============================================================================
+const char* operation_name(const Recorder::Operation op)
+{
+  using Op = Recorder::Operation;
+  switch (op)
+  {
+    case Op::Set: return "set";
+    case Op::Extend: return "extend";
+    case Op::Delay: return "delay";
+    case Op::Reached: return "reached";
+    case Op::Clear: return "clear";
+    case Op::RegisterParticipant: return "register_participant";
+    case Op::UnregisterParticipant: return "unregister_participant";
+    case Op::UpdateDescription: return "update_description";
+    case Op::Changes: return "changes";
+    case Op::Query: return "query";
+    case Op::Cull: return "cull";
+    case Op::SetCurrentTime: return "set_current_time";
+  }
+
+  return "unknown";
+}
+
+//==============================================================================
+void print_row(
+  const std::size_t run,
+  const std::string& operation,
+  const Replay::Timing& timing)
+{
+  if (timing.count == 0)
+    return;
+
+  const double total_us =
+    std::chrono::duration<double, std::micro>(timing.total).count();
+  const double max_us =
+    std::chrono::duration<double, std::micro>(timing.max).count();
+  const double mean_us = total_us / static_cast<double>(timing.count);
+  const double ops_per_s =
+    total_us > 0.0 ? 1e6 * static_cast<double>(timing.count) / total_us : 0.0;
+
+  std::cout << run << "," << operation << "," << timing.count << ","
+            << timing.failed << "," << ops_per_s << "," << mean_us << ","
+            << max_us << std::endl;
+}
+
+//==============================================================================
+std::vector<uint8_t> read_file(const std::string& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+  {
+    std::cerr << "Unable to read the file [" << path << "]" << std::endl;
+    std::exit(1);
+  }
+
+  return std::vector<uint8_t>(
+    std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+//==============================================================================
+Settings parse_settings(int argc, char* argv[])
+{
+  Settings settings;
+  bool valid = true;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = i+1 < argc;
+    if (arg == "--checkpoint" && has_value)
+      settings.checkpoint = argv[++i];
+    else if (arg == "--bucket" && has_value)
+      settings.bucket = std::strtod(argv[++i], nullptr);
+    else if (arg == "--adaptive")
+      settings.adaptive = true;
+    else if (arg == "--runs" && has_value)
+      settings.runs = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--paced")
+      settings.paced = true;
+    else if (arg == "--no-mirror")
+      settings.mirror = false;
+    else if (settings.log.empty() && arg.rfind("--", 0) != 0)
+      settings.log = arg;
+    else
+      valid = false;
+  }
+
+  if (!valid || settings.log.empty())
+  {
+    std::cerr << "Usage: " << argv[0]
+              << " LOG [--checkpoint PATH] [--bucket SECONDS]"
+              << " [--adaptive] [--runs N] [--paced] [--no-mirror]"
+              << std::endl;
+    std::exit(1);
+  }
+
+  if (settings.bucket <= 0.0)
+    settings.bucket = 60.0;
+
+  return settings;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const Settings settings = parse_settings(argc, argv);
+  const Replay replay(read_file(settings.log));
+
+  const auto bucket = std::chrono::duration_cast<rmf_traffic::Duration>(
+    std::chrono::duration<double>(settings.bucket));
+  const TimelineOptions options = settings.adaptive ?
+    TimelineOptions::adaptive(bucket) : TimelineOptions(bucket);
+
+  std::cerr << "Replaying " << replay.size() << " calls that were recorded "
+            << "over " << std::chrono::duration<double>(
+    replay.duration()).count() << "s" << std::endl;
+
+  std::cout << "run,operation,count,failed,ops_per_s,mean_us,max_us"
+            << std::endl;
+
+  for (std::size_t run = 0; run < settings.runs; ++run)
+  {
+    Database database = settings.checkpoint.has_value() ?
+      Database::load(*settings.checkpoint, options) : Database(options);
+
+    std::optional<Mirror> mirror;
+    if (settings.mirror)
+      mirror.emplace(options);
+
+    const auto stats = replay.run(
+      database, mirror.has_value() ? &*mirror : nullptr, settings.paced);
+
+    for (std::size_t i = 0; i < Recorder::NumOperations; ++i)
+    {
+      const auto op = static_cast<Recorder::Operation>(i);
+      print_row(run, operation_name(op), stats[op]);
+    }
+
+    print_row(run, "mirror_update", stats.mirror_update);
+
+    Replay::Timing total;
+    total.count = 1;
+    total.total = stats.total;
+    total.max = stats.total;
+    print_row(run, "total", total);
+  }
+
+  return 0;
+}
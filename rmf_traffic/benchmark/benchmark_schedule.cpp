@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Load test for schedule::Database and schedule::Mirror.
+//
+// A synthetic fleet drives around a grid in simulated time. Every robot is a
+// participant of a Database, and during each step it may replan (set), report
+// a delay, reach a checkpoint, or extend its itinerary, at the rates given on
+// the command line. After each step every mirror pulls the changes that it is
+// missing, and the planners run region queries on the Database. The Database
+// is culled periodically.
+//
+// Every operation of every run prints one CSV row to stdout:
+//
+//   participants,operation,count,ops_per_s,mean_us,p50_us,p99_us,max_us,
+//   rss_growth_kb
+//
+// ops_per_s only counts the time spent inside of the operation itself.
+// rss_growth_kb is how much the peak resident memory of the process grew
+// during the run, so it is the same for every row of a run. It will be zero
+// when earlier runs already used more memory.
+//
+// Usage: benchmark_schedule [--min-participants N] [--max-participants N]
+//                           [--duration SECONDS] [--step SECONDS]
+//                           [--set-rate HZ] [--delay-rate HZ]
+//                           [--reached-rate HZ] [--extend-rate HZ]
+//                           [--mirrors N] [--queries N] [--seed N]
+
+#include <rmf_traffic/geometry/Circle.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Mirror.hpp>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+//==============================================================================
+struct Settings
+{
+  std::size_t min_participants = 10;
+  std::size_t max_participants = 160;
+  double duration = 300.0;
+  double step = 0.5;
+  double set_rate = 0.05;
+  double delay_rate = 0.5;
+  double reached_rate = 1.0;
+  double extend_rate = 0.02;
+  std::size_t mirrors = 4;
+  std::size_t queries = 4;
+  std::size_t seed = 42;
+};
+
+//==============================================================================
+using Clock = std::chrono::steady_clock;
+using namespace rmf_traffic::schedule;
+using rmf_traffic::CheckpointId;
+using rmf_traffic::PlanId;
+
+//==============================================================================
+const std::string map_name = "benchmark";
+
+// The fleet drives on a square grid of this many points along each side
+const std::size_t grid_size = 40;
+const double grid_spacing = 2.0;
+
+// How long a robot takes to drive between neighboring grid points
+const rmf_traffic::Duration leg_duration = 4s;
+
+// How many legs long each route is
+const std::size_t legs_per_route = 15;
+
+// How often the database gets culled, and how far behind the current time
+const rmf_traffic::Duration cull_period = 60s;
+const rmf_traffic::Duration cull_horizon = 30s;
+
+//==============================================================================
+/// The latency of every call to one kind of operation
+struct Latency
+{
+  std::vector<Clock::duration> samples;
+
+  template<typename F>
+  auto measure(const F& f)
+  {
+    const auto start = Clock::now();
+    if constexpr (std::is_void_v<decltype(f())>)
+    {
+      f();
+      samples.push_back(Clock::now() - start);
+    }
+    else
+    {
+      auto result = f();
+      samples.push_back(Clock::now() - start);
+      return result;
+    }
+  }
+};
+
+//==============================================================================
+/// One robot of the synthetic fleet, and the versions that it has sent to the
+/// database so far
+struct Robot
+{
+  ParticipantId id;
+  PlanId plan;
+  StorageId storage;
+  ItineraryVersion version;
+  ProgressVersion progress = 0;
+
+  // The grid point that the robot is at or heading to
+  std::size_t x = 0;
+  std::size_t y = 0;
+
+  // The number of routes in the current itinerary
+  std::size_t routes = 0;
+
+  // The last checkpoint reached on the first route of the itinerary
+  CheckpointId reached = 0;
+};
+
+//==============================================================================
+/// Generates the itineraries of a synthetic fleet. Every robot follows a
+/// random walk over the grid.
+class Fleet
+{
+public:
+
+  Fleet(std::size_t seed)
+  : _rng(static_cast<std::mt19937::result_type>(seed))
+  {
+    // Do nothing
+  }
+
+  /// Put a robot at a random grid point
+  void place(Robot& robot)
+  {
+    std::uniform_int_distribution<std::size_t> pick(0, grid_size - 1);
+    robot.x = pick(_rng);
+    robot.y = pick(_rng);
+  }
+
+  /// Make a route that begins at the robot's current grid point
+  rmf_traffic::Route make_route(Robot& robot, const rmf_traffic::Time start)
+  {
+    rmf_traffic::Trajectory trajectory;
+    auto time = start;
+    trajectory.insert(time, position(robot), Eigen::Vector3d::Zero());
+    for (std::size_t i = 0; i < legs_per_route; ++i)
+    {
+      step(robot);
+      time += leg_duration;
+      trajectory.insert(time, position(robot), Eigen::Vector3d::Zero());
+    }
+
+    return {map_name, std::move(trajectory)};
+  }
+
+  /// True with a probability of rate*dt
+  bool happens(const double rate, const double dt)
+  {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(_rng) < rate*dt;
+  }
+
+  /// Pick a random region of the grid around the time given
+  rmf_traffic::Region make_region(const rmf_traffic::Time time)
+  {
+    const double extent = grid_spacing * static_cast<double>(grid_size);
+    std::uniform_real_distribution<double> pick(0.0, extent);
+    Eigen::Isometry2d tf = Eigen::Isometry2d::Identity();
+    tf.translation() = Eigen::Vector2d(pick(_rng), pick(_rng));
+
+    return rmf_traffic::Region{
+      map_name,
+      time,
+      time + 60s,
+      {
+        rmf_traffic::geometry::Space{
+          rmf_traffic::geometry::make_final<rmf_traffic::geometry::Circle>(
+            5.0),
+          tf
+        }
+      }
+    };
+  }
+
+private:
+
+  Eigen::Vector3d position(const Robot& robot) const
+  {
+    return {
+      grid_spacing * static_cast<double>(robot.x),
+      grid_spacing * static_cast<double>(robot.y),
+      0.0
+    };
+  }
+
+  void step(Robot& robot)
+  {
+    while (true)
+    {
+      switch (std::uniform_int_distribution<int>(0, 3)(_rng))
+      {
+        case 0: if (robot.x + 1 < grid_size) { ++robot.x; return; } break;
+        case 1: if (robot.x > 0) { --robot.x; return; } break;
+        case 2: if (robot.y + 1 < grid_size) { ++robot.y; return; } break;
+        default: if (robot.y > 0) { --robot.y; return; } break;
+      }
+    }
+  }
+
+  std::mt19937 _rng;
+};
+
+//==============================================================================
+std::size_t peak_rss_kb()
+{
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return static_cast<std::size_t>(usage.ru_maxrss);
+}
+
+//==============================================================================
+double to_us(const Clock::duration d)
+{
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+//==============================================================================
+void print_row(
+  const std::size_t participants,
+  const std::string& operation,
+  Latency latency,
+  const std::size_t rss_growth_kb)
+{
+  auto& d = latency.samples;
+  if (d.empty())
+    return;
+
+  std::sort(d.begin(), d.end());
+  const auto percentile = [&](const double p)
+    {
+      const auto rank = static_cast<std::size_t>(
+        std::ceil(p * static_cast<double>(d.size())));
+      return to_us(d[std::min(std::max<std::size_t>(rank, 1), d.size()) - 1]);
+    };
+
+  Clock::duration total = Clock::duration(0);
+  for (const auto& s : d)
+    total += s;
+
+  const double n = static_cast<double>(d.size());
+  const double total_s = std::chrono::duration<double>(total).count();
+  std::cout << participants << "," << operation << "," << d.size() << ","
+            << (total_s > 0.0 ? n / total_s : 0.0) << ","
+            << to_us(total) / n << "," << percentile(0.5) << ","
+            << percentile(0.99) << "," << to_us(d.back()) << ","
+            << rss_growth_kb << std::endl;
+}
+
+//==============================================================================
+void run(const Settings& settings, const std::size_t participants)
+{
+  const std::size_t rss_before = peak_rss_kb();
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  Fleet fleet(settings.seed);
+  Database database;
+  std::map<std::string, Latency> latency;
+
+  auto now = rmf_traffic::Time(rmf_traffic::Duration(0));
+  database.set_current_time(now);
+
+  std::vector<Robot> robots;
+  for (std::size_t i = 0; i < participants; ++i)
+  {
+    const auto registration = latency["register"].measure(
+      [&]()
+      {
+        return database.register_participant(
+          ParticipantDescription{
+            "robot " + std::to_string(i),
+            "benchmark_schedule",
+            ParticipantDescription::Rx::Responsive,
+            profile
+          });
+      });
+
+    Robot robot{
+      registration.id(),
+      registration.last_plan_id(),
+      registration.next_storage_base(),
+      registration.last_itinerary_version()
+    };
+    fleet.place(robot);
+    robots.push_back(robot);
+  }
+
+  const auto set = [&](Robot& robot)
+    {
+      const Itinerary itinerary = {fleet.make_route(robot, now)};
+      ++robot.plan;
+      ++robot.version;
+      latency["set"].measure(
+        [&]()
+        {
+          database.set(
+            robot.id, robot.plan, itinerary, robot.storage, robot.version);
+        });
+
+      robot.storage += itinerary.size();
+      robot.routes = itinerary.size();
+      robot.reached = 0;
+    };
+
+  for (auto& robot : robots)
+    set(robot);
+
+  std::vector<Mirror> mirrors(settings.mirrors);
+  {
+    ParticipantDescriptionsMap descriptions;
+    for (const auto id : database.participant_ids())
+      descriptions.insert_or_assign(id, *database.get_participant(id));
+
+    for (auto& mirror : mirrors)
+      mirror.update_participants_info(descriptions);
+  }
+
+  const auto query_all = rmf_traffic::schedule::query_all();
+  const auto step = rmf_traffic::time::from_seconds(settings.step);
+  const auto finish = now + rmf_traffic::time::from_seconds(settings.duration);
+  auto next_cull = now + cull_period;
+  while (now < finish)
+  {
+    now += step;
+    database.set_current_time(now);
+
+    for (auto& robot : robots)
+    {
+      if (fleet.happens(settings.set_rate, settings.step))
+      {
+        set(robot);
+        continue;
+      }
+
+      if (fleet.happens(settings.delay_rate, settings.step))
+      {
+        ++robot.version;
+        latency["delay"].measure(
+          [&]() { database.delay(robot.id, 500ms, robot.version); });
+      }
+
+      if (fleet.happens(settings.extend_rate, settings.step))
+      {
+        const Itinerary routes = {fleet.make_route(robot, now + 60s)};
+        ++robot.version;
+        latency["extend"].measure(
+          [&]() { database.extend(robot.id, routes, robot.version); });
+        robot.routes += routes.size();
+        robot.storage += routes.size();
+      }
+
+      if (robot.reached < legs_per_route
+        && fleet.happens(settings.reached_rate, settings.step))
+      {
+        ++robot.reached;
+        std::vector<CheckpointId> checkpoints(robot.routes, 0);
+        checkpoints.front() = robot.reached;
+        ++robot.progress;
+        latency["reached"].measure(
+          [&]()
+          {
+            database.reached(
+              robot.id, robot.plan, checkpoints, robot.progress);
+          });
+      }
+    }
+
+    for (auto& mirror : mirrors)
+    {
+      const auto patch = latency["changes"].measure(
+        [&]() { return database.changes(query_all, mirror.latest_version()); });
+
+      latency["mirror_update"].measure([&]() { mirror.update(patch); });
+    }
+
+    for (std::size_t i = 0; i < settings.queries; ++i)
+    {
+      const auto query = rmf_traffic::schedule::make_query(
+        {fleet.make_region(now)});
+      latency["query"].measure([&]() { return database.query(query); });
+    }
+
+    if (next_cull <= now)
+    {
+      latency["cull"].measure(
+        [&]() { return database.cull(now - cull_horizon); });
+      next_cull += cull_period;
+    }
+  }
+
+  const std::size_t rss_after = peak_rss_kb();
+  const std::size_t growth =
+    rss_after > rss_before ? rss_after - rss_before : 0;
+  for (auto& [operation, samples] : latency)
+    print_row(participants, operation, std::move(samples), growth);
+}
+
+//==============================================================================
+Settings parse_settings(int argc, char* argv[])
+{
+  Settings settings;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = i+1 < argc;
+    if (arg == "--min-participants" && has_value)
+      settings.min_participants = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--max-participants" && has_value)
+      settings.max_participants = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--duration" && has_value)
+      settings.duration = std::strtod(argv[++i], nullptr);
+    else if (arg == "--step" && has_value)
+      settings.step = std::strtod(argv[++i], nullptr);
+    else if (arg == "--set-rate" && has_value)
+      settings.set_rate = std::strtod(argv[++i], nullptr);
+    else if (arg == "--delay-rate" && has_value)
+      settings.delay_rate = std::strtod(argv[++i], nullptr);
+    else if (arg == "--reached-rate" && has_value)
+      settings.reached_rate = std::strtod(argv[++i], nullptr);
+    else if (arg == "--extend-rate" && has_value)
+      settings.extend_rate = std::strtod(argv[++i], nullptr);
+    else if (arg == "--mirrors" && has_value)
+      settings.mirrors = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--queries" && has_value)
+      settings.queries = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--seed" && has_value)
+      settings.seed = std::strtoul(argv[++i], nullptr, 10);
+    else
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [--min-participants N] [--max-participants N]"
+                << " [--duration SECONDS] [--step SECONDS]"
+                << " [--set-rate HZ] [--delay-rate HZ]"
+                << " [--reached-rate HZ] [--extend-rate HZ]"
+                << " [--mirrors N] [--queries N] [--seed N]" << std::endl;
+      std::exit(1);
+    }
+  }
+
+  settings.min_participants = std::max<std::size_t>(
+    settings.min_participants, 1);
+  if (settings.step <= 0.0)
+    settings.step = 0.5;
+
+  return settings;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const Settings settings = parse_settings(argc, argv);
+
+  std::cout << "participants,operation,count,ops_per_s,mean_us,p50_us,"
+            << "p99_us,max_us,rss_growth_kb" << std::endl;
+
+  // The number of participants doubles from one run to the next
+  for (std::size_t n = settings.min_participants;
+    n <= settings.max_participants; n *= 2)
+  {
+    run(settings, n);
+  }
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__COMPACTTRAJECTORY_HPP
+#define RMF_TRAFFIC__COMPACTTRAJECTORY_HPP
+
+#include <rmf_traffic/Trajectory.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace rmf_traffic {
+
+//==============================================================================
+/// A compact, immutable encoding of a Trajectory. This is meant for keeping
+/// long histories of trajectories, e.g. for retention or replay, using a
+/// fraction of the memory of a Trajectory.
+///
+/// All values are quantized to a fixed resolution and stored as deltas from
+/// the previous waypoint using variable-length integers. By default times have
+/// a resolution of one microsecond, translations have a resolution of one
+/// millimeter, and yaw is quantized to 16 bits.
+///
+/// Use decode() to get back a Trajectory. Each value of the decoded trajectory
+/// will be within half of a resolution step of its original value. Waypoints
+/// whose times would round to the same step are kept one step apart so that
+/// every waypoint survives the round trip.
+class CompactTrajectory
+{
+public:
+
+  /// The resolutions to use when quantizing the waypoints of a trajectory.
+  struct Quantization
+  {
+    /// The resolution of waypoint times
+    Duration time = std::chrono::microseconds(1);
+
+    /// The resolution of translational values, in meters (or meters per
+    /// second for velocities)
+    double translation = 1e-3;
+
+    /// The resolution of rotational values, in radians (or radians per second
+    /// for velocities). The default splits a full turn into 2^16 steps.
+    double rotation = 9.587379924285257e-05;
+  };
+
+  /// Encode a trajectory using the default resolutions.
+  ///
+  /// \param[in] trajectory
+  ///   The trajectory to encode.
+  CompactTrajectory(const Trajectory& trajectory);
+
+  /// Encode a trajectory.
+  ///
+  /// \param[in] trajectory
+  ///   The trajectory to encode.
+  ///
+  /// \param[in] quantization
+  ///   The resolutions to use. The resolutions must be positive, or else
+  ///   std::invalid_argument will be thrown.
+  CompactTrajectory(
+    const Trajectory& trajectory,
+    Quantization quantization);
+
+  /// Decode this into a Trajectory.
+  Trajectory decode() const;
+
+  /// Get the number of waypoints.
+  std::size_t size() const;
+
+  /// Returns true if there are no waypoints.
+  bool empty() const;
+
+  /// Get the time of the first waypoint, if there is one.
+  std::optional<Time> start_time() const;
+
+  /// Get the time of the last waypoint, as it will be decoded, if there is one.
+  std::optional<Time> finish_time() const;
+
+  /// Get the resolutions that were used for the encoding.
+  const Quantization& quantization() const;
+
+  /// Get the encoded waypoint data.
+  const std::vector<uint8_t>& data() const;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__COMPACTTRAJECTORY_HPP
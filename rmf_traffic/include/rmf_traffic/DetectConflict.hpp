@@ -18,10 +18,15 @@
 #ifndef RMF_TRAFFIC__DETECTCONFLICT_HPP
 #define RMF_TRAFFIC__DETECTCONFLICT_HPP
 
+#include <rmf_traffic/Executor.hpp>
 #include <rmf_traffic/Trajectory.hpp>
 #include <rmf_traffic/Route.hpp>
 #include <rmf_traffic/Profile.hpp>
+#include <cstdint>
 #include <exception>
+#include <functional>
+#include <memory>
+#include <vector>
 
 namespace rmf_traffic {
 
@@ -60,6 +65,64 @@ public:
     Time time;
   };
 
+  /// Options that trade between the speed and the precision of conflict
+  /// detection. Rough planning can use a low precision to explore more options,
+  /// while final admission into the schedule should use a high precision.
+  struct Options
+  {
+    /// The algorithm that is used to find the time of contact for pairs of
+    /// shapes that cannot be checked analytically
+    enum class Solver : uint16_t
+    {
+      /// Advance through time by the largest step that cannot skip over a
+      /// contact. This is precise, but it costs a distance computation at every
+      /// step.
+      ConservativeAdvancement,
+
+      /// Check for overlaps at evenly spaced samples in time. This is faster,
+      /// but brief contacts that happen between the samples will be missed.
+      Sampling
+    };
+
+    Options(
+      double tolerance = 1e-7,
+      std::size_t max_iterations = 15,
+      Solver solver = Solver::ConservativeAdvancement,
+      bool exact_time = true);
+
+    /// The precision of the time of contact, as a fraction of the duration of
+    /// the segments being checked. Coarser values make detection faster, but
+    /// contacts that are shallower than the tolerance may be reported as
+    /// conflicts. When the Sampling solver is used, this also limits the number
+    /// of samples to 1/tolerance.
+    double tolerance;
+
+    /// The maximum number of steps that the solver may take for each pair of
+    /// segments. If the ConservativeAdvancement solver runs out of steps before
+    /// it can rule out a contact, a conflict will be reported. The Sampling
+    /// solver always uses at least two samples.
+    std::size_t max_iterations;
+
+    /// The solver to use for shapes that are not both circles
+    Solver solver;
+
+    /// If true, the time of each conflict will be the earliest time of contact.
+    /// If false, the time of a conflict is only guaranteed to be no later than
+    /// the earliest time of contact within the same pair of segments, which
+    /// lets the checks stop as soon as any contact is certain. Use this when
+    /// only the existence of a conflict matters.
+    bool exact_time;
+
+    /// Options for quickly ruling out options during rough planning and
+    /// negotiation. Conflicts may be reported early or for near misses, but
+    /// they will not be missed.
+    static Options fast();
+
+    /// Options for the most precise conflict detection that is available,
+    /// meant for checking routes before they are admitted into the schedule.
+    static Options precise();
+  };
+
   /// Checks if there are any conflicts between the two trajectories.
   ///
   /// \param[in] profile_a
@@ -91,6 +154,257 @@ public:
     const DependsOnCheckpoint* dependencies_of_b_on_a,
     Interpolate interpolation = Interpolate::CubicSpline);
 
+  /// Same as the other between() function, but with options that decide the
+  /// precision of the checks.
+  static std::optional<Conflict> between(
+    const Profile& profile_a,
+    const Trajectory& trajectory_a,
+    const DependsOnCheckpoint* dependencies_of_a_on_b,
+    const Profile& profile_b,
+    const Trajectory& trajectory_b,
+    const DependsOnCheckpoint* dependencies_of_b_on_a,
+    const Options& options,
+    Interpolate interpolation = Interpolate::CubicSpline);
+
+  /// A span of time where two trajectories are in conflict, found by
+  /// all_between()
+  struct ConflictInterval
+  {
+    /// The waypoint of trajectory A that finishes the segment in conflict
+    Trajectory::const_iterator a_it;
+
+    /// The waypoint of trajectory B that finishes the segment in conflict
+    Trajectory::const_iterator b_it;
+
+    /// The earliest time of conflict within these segments
+    Time begin;
+
+    /// The time at which the first of the two segments finishes. Only the time
+    /// of first contact is computed for each pair of segments, so the agents
+    /// may separate before this, but they will not be in conflict within these
+    /// segments after it.
+    Time end;
+  };
+
+  /// Find every conflict between the two trajectories in a single pass. The
+  /// same checks are done as between(), except the search continues past the
+  /// first conflict until the end of the trajectories.
+  ///
+  /// Each pair of segments that are in conflict produces one interval, and
+  /// the intervals are sorted by their begin time. Use this instead of calling
+  /// between() repeatedly on truncated trajectories.
+  ///
+  /// The parameters are the same as between().
+  static std::vector<ConflictInterval> all_between(
+    const Profile& profile_a,
+    const Trajectory& trajectory_a,
+    const DependsOnCheckpoint* dependencies_of_a_on_b,
+    const Profile& profile_b,
+    const Trajectory& trajectory_b,
+    const DependsOnCheckpoint* dependencies_of_b_on_a,
+    const Options& options = Options(),
+    Interpolate interpolation = Interpolate::CubicSpline);
+
+  /// One of the other trajectories that between_many() should check against.
+  /// The pointers must remain valid until between_many() returns.
+  struct Candidate
+  {
+    /// The profile of the other agent
+    const Profile* profile;
+
+    /// The trajectory of the other agent
+    const Trajectory* trajectory;
+
+    /// The dependencies that the main agent has on this trajectory
+    const DependsOnCheckpoint* dependencies_on_candidate = nullptr;
+
+    /// The dependencies that this trajectory has on the main agent
+    const DependsOnCheckpoint* dependencies_of_candidate = nullptr;
+  };
+
+  /// A conflict that was found by between_many() or between_pairs()
+  struct IndexedConflict
+  {
+    /// The index of the candidate or pair that the conflict was found with
+    std::size_t index;
+
+    /// The earliest conflict between the main trajectory and the candidate.
+    /// Within the conflict, a_it refers to the main trajectory and b_it refers
+    /// to the candidate trajectory. For between_pairs(), a_it refers to
+    /// trajectory_a and b_it refers to trajectory_b of the pair.
+    Conflict conflict;
+  };
+
+  /// Options for between_many() and between_pairs()
+  struct BatchOptions
+  {
+    BatchOptions(
+      bool find_all = false,
+      std::size_t max_threads = 1,
+      std::size_t min_candidates_per_thread = 16,
+      Options detection = Options());
+
+    /// If true, find a conflict for every candidate that has one. If false,
+    /// only the conflict of the lowest-index candidate will be reported.
+    bool find_all;
+
+    /// The maximum number of threads that may be used to check the candidates,
+    /// including the calling thread. A value of 0 or 1 will check everything
+    /// on the calling thread. The other threads are borrowed from the
+    /// executor.
+    std::size_t max_threads;
+
+    /// The minimum number of candidates that each thread should be given.
+    /// Fewer threads than max_threads will be used for small batches.
+    std::size_t min_candidates_per_thread;
+
+    /// The options to use when checking each candidate
+    Options detection;
+
+    /// The executor whose threads will help check the candidates. If this is
+    /// a nullptr, Executor::shared() will be used.
+    std::shared_ptr<Executor> executor = nullptr;
+
+    /// If this is set, it will be called before each candidate is checked.
+    /// Once it returns true, the candidates that have not been checked yet
+    /// will be skipped, so the result will be missing any conflicts that they
+    /// have. Callers should ask the interrupter again after the batch returns
+    /// to find out whether the result can be trusted. When several threads are
+    /// used, this may be called from all of them at the same time.
+    std::function<bool()> interrupter = nullptr;
+  };
+
+  /// Checks one trajectory against a batch of other trajectories.
+  ///
+  /// The result is the same regardless of how many threads are used: the
+  /// conflicts are sorted by candidate index, and when only the first conflict
+  /// is requested it will be the conflict of the lowest-index candidate.
+  ///
+  /// If checking any candidate throws an exception, the exception of the
+  /// lowest-index candidate will be rethrown.
+  ///
+  /// \param[in] profile
+  ///   The profile of the main agent
+  ///
+  /// \param[in] trajectory
+  ///   The trajectory of the main agent
+  ///
+  /// \param[in] candidates
+  ///   The other trajectories to check against
+  ///
+  /// \param[in] options
+  ///   Whether to find all the conflicts and how to distribute the work
+  ///
+  /// \return the conflicts that were found, sorted by candidate index. This
+  /// will contain at most one element if options.find_all is false.
+  static std::vector<IndexedConflict> between_many(
+    const Profile& profile,
+    const Trajectory& trajectory,
+    const std::vector<Candidate>& candidates,
+    const BatchOptions& options = BatchOptions(),
+    Interpolate interpolation = Interpolate::CubicSpline);
+
+  /// Two trajectories that between_pairs() should check against each other.
+  /// The pointers must remain valid until between_pairs() returns.
+  struct Pair
+  {
+    const Profile* profile_a;
+    const Trajectory* trajectory_a;
+    const DependsOnCheckpoint* dependencies_of_a_on_b = nullptr;
+
+    const Profile* profile_b;
+    const Trajectory* trajectory_b;
+    const DependsOnCheckpoint* dependencies_of_b_on_a = nullptr;
+  };
+
+  /// Checks a batch of unrelated trajectory pairs, like the pairs gathered
+  /// while replaying a long history of traffic. Each pair is checked exactly
+  /// like between() would check it, and the work is distributed the same way
+  /// as between_many(), with min_candidates_per_thread counting pairs.
+  ///
+  /// If checking any pair throws an exception, the exception of the
+  /// lowest-index pair will be rethrown.
+  ///
+  /// \return the conflicts that were found, sorted by pair index. This will
+  /// contain at most one element if options.find_all is false.
+  static std::vector<IndexedConflict> between_pairs(
+    const std::vector<Pair>& pairs,
+    const BatchOptions& options = BatchOptions(),
+    Interpolate interpolation = Interpolate::CubicSpline);
+
+  /// Counters that describe the work done by conflict detection. These are
+  /// only collected while collect_stats(true) is in effect.
+  struct Stats
+  {
+    /// Number of trajectory pairs that were checked for conflicts
+    std::uint64_t pair_checks = 0;
+
+    /// Number of pair checks rejected because the trajectories do not overlap
+    /// in time
+    std::uint64_t time_overlap_rejects = 0;
+
+    /// Number of pair checks rejected because the bounding boxes of the
+    /// trajectories never come close to each other
+    std::uint64_t bounding_box_rejects = 0;
+
+    /// Number of pair checks where the agents started out too close to each
+    /// other and only approaches were checked
+    std::uint64_t close_start_hits = 0;
+
+    /// Number of segment pairs visited while searching for invasions
+    std::uint64_t invasion_segment_pairs = 0;
+
+    /// Number of visited segment pairs that were skipped because their bounding
+    /// boxes do not come close to each other
+    std::uint64_t segment_broadphase_rejects = 0;
+
+    /// Number of continuous collision checks that were passed to FCL
+    std::uint64_t fcl_ccd_calls = 0;
+
+    /// Number of collision checks between circles that were solved analytically
+    std::uint64_t analytic_circle_checks = 0;
+
+    /// Number of segment pairs where neither agent was moving, so a single
+    /// static overlap test was used instead of a continuous collision check
+    std::uint64_t stationary_checks = 0;
+
+    /// Number of segments that were passed over without being visited because
+    /// a hierarchy over a long trajectory showed that they could not come
+    /// close to the other trajectory
+    std::uint64_t hierarchy_skipped_segments = 0;
+
+    /// Number of times that a span of segment pairs which are ignored because
+    /// of dependencies was passed over all at once
+    std::uint64_t ignored_span_skips = 0;
+
+    /// Number of static overlap checks done while agents were approaching
+    std::uint64_t overlap_checks = 0;
+
+    /// Number of approach times that were sampled while agents were close
+    std::uint64_t approach_samples = 0;
+
+    /// Number of conflicts that were found
+    std::uint64_t conflicts = 0;
+
+    /// Total time spent inside of pair checks
+    Duration time_spent = Duration(0);
+  };
+
+  /// Turn the collection of Stats on or off for all threads. Collection is off
+  /// by default. While collection is off, the counters cost a single relaxed
+  /// atomic load per check.
+  static void collect_stats(bool on);
+
+  /// Check whether Stats are currently being collected
+  static bool collecting_stats();
+
+  /// Get the Stats that have been collected by every thread since the last
+  /// call to reset_stats(). Stats from threads that have finished are kept.
+  static Stats get_stats();
+
+  /// Set all of the collected Stats back to zero
+  static void reset_stats();
+
   class Implementation;
 };
 
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__EXECUTOR_HPP
+#define RMF_TRAFFIC__EXECUTOR_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace rmf_traffic {
+
+//==============================================================================
+/// A set of threads that the parallel features of rmf_traffic can run their
+/// work on. Planners, databases and negotiations that are given the same
+/// executor will share its threads instead of each starting threads of their
+/// own.
+///
+/// Executor::make() creates the default implementation, where each thread has
+/// its own queues of tasks, and a thread that runs out of tasks will steal
+/// them from the other threads. Integrators that already have a scheduler of
+/// their own can implement post() and concurrency() to hand the tasks over to
+/// it instead.
+class Executor
+{
+public:
+
+  using Task = std::function<void()>;
+
+  /// How urgently a task should be run. The threads of the default executor
+  /// will run every task of a higher priority that they can find before they
+  /// run a task of a lower priority. Tasks that are already running are never
+  /// preempted.
+  enum class Priority : uint8_t
+  {
+    Low,
+    Normal,
+    High
+  };
+
+  /// Settings for the default executor
+  struct Config
+  {
+    /// The number of threads. A value of 0 means one thread for each CPU that
+    /// the threads are allowed to run on.
+    std::size_t threads = 0;
+
+    /// The CPU cores that the threads will be pinned to. Thread i will be
+    /// pinned to cores[i % cores.size()]. If this is empty, the threads will
+    /// not be pinned to individual cores.
+    std::vector<std::size_t> cores = {};
+
+    /// Keep the threads on the CPUs of this NUMA node. If cores is empty, each
+    /// thread may run on any CPU of the node. Otherwise only the cores that
+    /// belong to the node will be used. Memory that the tasks allocate is
+    /// placed by the first-touch policy of the operating system, so it will
+    /// usually be local to the node as well.
+    std::optional<std::size_t> numa_node = std::nullopt;
+  };
+
+  /// Make an instance of the default work-stealing executor. When the
+  /// executor is destroyed, its threads will finish every task that has been
+  /// posted to it before they stop.
+  ///
+  /// Pinning and NUMA node selection are only supported on Linux, and they
+  /// are ignored on other platforms. Cores and nodes that do not exist are
+  /// ignored as well.
+  static std::shared_ptr<Executor> make(Config config);
+
+  /// Make an instance of the default executor with the default Config
+  static std::shared_ptr<Executor> make();
+
+  /// Get the executor that the library shares by default. It has one thread
+  /// for each hardware thread, and it is created the first time it is needed.
+  static const std::shared_ptr<Executor>& shared();
+
+  /// Run a task on one of the threads of this executor at some point. This
+  /// must be safe to call from any thread, including the threads of the
+  /// executor. Tasks are responsible for catching their own exceptions.
+  ///
+  /// \param[in] task
+  ///   The task to run
+  ///
+  /// \param[in] priority
+  ///   How urgently the task should be run
+  virtual void post(Task task, Priority priority = Priority::Normal) = 0;
+
+  /// Get the number of tasks that this executor can run at the same time
+  virtual std::size_t concurrency() const = 0;
+
+  /// Call task for each index in [0, count) and wait until every call has
+  /// finished. The calling thread works on the calls too, and tasks are posted
+  /// to this executor to help it. The calls do not depend on those tasks being
+  /// run, so this is safe to use from inside of a task even if every thread of
+  /// the executor is busy. If any of the calls throws an exception, the first
+  /// exception will be rethrown here after the rest of the calls have
+  /// finished.
+  ///
+  /// \param[in] count
+  ///   The number of calls to make
+  ///
+  /// \param[in] task
+  ///   The task to call with each index
+  ///
+  /// \param[in] max_threads
+  ///   The most threads that may work on the calls, including the calling
+  ///   thread. A value of 0 means that every thread of the executor may help.
+  ///
+  /// \param[in] priority
+  ///   The priority of the tasks that are posted to help
+  void run(
+    std::size_t count,
+    const std::function<void(std::size_t)>& task,
+    std::size_t max_threads = 0,
+    Priority priority = Priority::Normal);
+
+  virtual ~Executor() = default;
+};
+
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__EXECUTOR_HPP
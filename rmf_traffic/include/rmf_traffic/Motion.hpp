@@ -21,6 +21,7 @@
 #include <rmf_traffic/Trajectory.hpp>
 
 #include <memory>
+#include <vector>
 
 namespace rmf_traffic {
 
@@ -60,6 +61,17 @@ public:
   ///   and may result in an exception.
   virtual Eigen::Vector3d compute_acceleration(Time t) const = 0;
 
+  /// Get the positions of this motion at many points in time, such as when a
+  /// visualizer samples a trajectory at a fixed rate. Column k of the result
+  /// is the position at times[k].
+  ///
+  /// \param[in] times
+  ///   The times of interest. Each time must be in the range
+  ///   [start_time(), finish_time()], or else the output is undefined. Times
+  ///   that are in ascending order are sampled the most efficiently.
+  virtual Eigen::Matrix3Xd compute_positions(
+    const std::vector<Time>& times) const;
+
   // Default destructor
   virtual ~Motion() = default;
 
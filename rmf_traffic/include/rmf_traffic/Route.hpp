@@ -129,7 +129,13 @@ public:
   /// Set the trajectory for this route
   Route& trajectory(Trajectory value);
 
-  /// Get the trajectory for this route
+  /// Get the trajectory for this route.
+  ///
+  /// Copies of a route share the same trajectory until one of them needs to
+  /// modify it. If the trajectory is currently shared, this will first give
+  /// this route its own copy of the trajectory. After a mutable reference has
+  /// been handed out, any new copies of this route will copy the trajectory
+  /// instead of sharing it.
   Trajectory& trajectory();
 
   /// Get the trajectory for this immutable route
@@ -155,6 +155,22 @@ public:
   /// Create an empty Trajectory
   Trajectory();
 
+  /// The time, position, and velocity of a waypoint that has not been put into
+  /// a Trajectory yet
+  struct Point
+  {
+    Time time;
+    Eigen::Vector3d position;
+    Eigen::Vector3d velocity;
+  };
+
+  /// Create a Trajectory from waypoints that are already sorted by time. This
+  /// is the same as calling append_sorted() on an empty Trajectory.
+  ///
+  /// \throws std::invalid_argument if the times of the waypoints are not
+  /// strictly increasing.
+  explicit Trajectory(const std::vector<Point>& waypoints);
+
   // Copy construction/assignment
   Trajectory(const Trajectory& other);
   Trajectory& operator=(const Trajectory& other);
@@ -186,6 +202,16 @@ public:
   /// Insert a copy of another Trajectory's Waypoint into this one.
   InsertionResult insert(const Waypoint& other);
 
+  /// Add waypoints that are already sorted by time to the end of this
+  /// Trajectory. This builds the storage for all of them in one pass, without
+  /// searching for where each one belongs, so it is much faster than calling
+  /// insert() for each waypoint.
+  ///
+  /// \throws std::invalid_argument if the times of the waypoints are not
+  /// strictly increasing, or if the first of them does not come after the
+  /// finish time of this Trajectory. Nothing is added when this is thrown.
+  void append_sorted(const std::vector<Point>& waypoints);
+
   // TODO(MXG): Consider an insert() function that accepts a range of iterators
   // from another Trajectory instance.
 
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#ifndef RMF_TRAFFIC__AGV__BATCHPLANNER_HPP
+#define RMF_TRAFFIC__AGV__BATCHPLANNER_HPP
+
+#include <rmf_traffic/agv/Planner.hpp>
+
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+/// Plan for many participants at once, one after another in order of their
+/// priorities. Each participant avoids the plans of every participant that
+/// planned before it.
+///
+/// The plans are kept in reservations that belong to the BatchPlanner, so
+/// nothing needs to be written to a schedule database between the plans. The
+/// participants are split into groups that cannot possibly interact because
+/// their graphs have no maps in common, and the groups may be planned in
+/// parallel.
+///
+/// The plans that are produced do not have any dependencies on each other.
+/// They avoid each other by timing alone.
+class BatchPlanner
+{
+public:
+
+  class Request
+  {
+  public:
+
+    /// Constructor
+    ///
+    /// \param[in] id
+    ///   The ID of the participant to plan for. If multiple requests are given
+    ///   the same ID, then a runtime exception will be thrown.
+    ///
+    /// \param[in] start
+    ///   The starting condition for this participant.
+    ///
+    /// \param[in] goal
+    ///   The goal for this participant.
+    ///
+    /// \param[in] planner
+    ///   The single-agent planner used for this participant. If this is
+    ///   nullptr when planning begins, then a runtime exception will be
+    ///   thrown.
+    ///
+    /// \param[in] priority
+    ///   Requests with a higher priority are planned first. Requests with the
+    ///   same priority are planned in the order that they were given.
+    Request(
+      schedule::ParticipantId id,
+      Plan::Start start,
+      Plan::Goal goal,
+      std::shared_ptr<const Planner> planner,
+      int priority = 0);
+
+    /// Constructor
+    ///
+    /// \param[in] id
+    ///   The ID of the participant to plan for.
+    ///
+    /// \param[in] starts
+    ///   One or more starting conditions for this participant. The planner
+    ///   will use whichever starting condition provides the optimal plan.
+    ///
+    /// \param[in] goal
+    ///   The goal for this participant.
+    ///
+    /// \param[in] planner
+    ///   The single-agent planner used for this participant.
+    ///
+    /// \param[in] priority
+    ///   Requests with a higher priority are planned first.
+    Request(
+      schedule::ParticipantId id,
+      std::vector<Plan::Start> starts,
+      Plan::Goal goal,
+      std::shared_ptr<const Planner> planner,
+      int priority = 0);
+
+    /// Get the ID for this request
+    schedule::ParticipantId id() const;
+
+    /// Set the ID for this request
+    Request& id(schedule::ParticipantId value);
+
+    /// Get the starts for this request
+    const std::vector<Plan::Start>& starts() const;
+
+    /// Set the starts for this request
+    Request& starts(std::vector<Plan::Start> values);
+
+    /// Get the goal for this request
+    const Plan::Goal& goal() const;
+
+    /// Set the goal for this request
+    Request& goal(Plan::Goal value);
+
+    /// Get the planner for this request
+    const std::shared_ptr<const Planner>& planner() const;
+
+    /// Set the planner for this request
+    Request& planner(std::shared_ptr<const Planner> value);
+
+    /// Get the priority for this request
+    int priority() const;
+
+    /// Set the priority for this request
+    Request& priority(int value);
+
+    class Implementation;
+  private:
+    rmf_utils::impl_ptr<Implementation> _pimpl;
+  };
+
+  /// The plans that were found for each participant
+  using Plans = std::unordered_map<schedule::ParticipantId, Plan>;
+
+  class Result
+  {
+  public:
+
+    /// The plans that were found, including their itineraries
+    const Plans& plans() const;
+
+    /// The participants that no plan could be found for, in the order that
+    /// they were planned. These participants do not reserve anything, so the
+    /// plans of the other participants do not avoid them.
+    const std::vector<schedule::ParticipantId>& failures() const;
+
+    /// The number of groups of participants that were planned independently
+    /// of each other
+    std::size_t groups() const;
+
+    /// How long the whole batch took to plan
+    Duration time() const;
+
+    class Implementation;
+  private:
+    rmf_utils::impl_ptr<Implementation> _pimpl;
+  };
+
+  /// Default constructor
+  BatchPlanner();
+
+  /// Set how many groups of participants may be planned at the same time. The
+  /// outcome does not depend on this, because the groups never interact with
+  /// each other. A value of 0 is treated the same as 1, which is the default.
+  BatchPlanner& threads(std::size_t n);
+
+  /// Get how many groups of participants may be planned at the same time.
+  std::size_t threads() const;
+
+  /// Toggle on/off whether conflicts between the reservations that two routes
+  /// make on a graph are confirmed with DetectConflict. When this is off the
+  /// reservations are used on their own, which is faster but more cautious,
+  /// because a whole lane counts as occupied while a route travels along it.
+  /// On by default.
+  BatchPlanner& exact(bool on);
+
+  /// Check whether conflicts between reservations are confirmed.
+  bool exact() const;
+
+  /// Plan for all of the requests.
+  Result plan(const std::vector<Request>& requests) const;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__AGV__BATCHPLANNER_HPP
@@ -18,6 +18,7 @@
 #ifndef RMF_TRAFFIC__AGV__CENTRALIZEDNEGOTIATION_HPP
 #define RMF_TRAFFIC__AGV__CENTRALIZEDNEGOTIATION_HPP
 
+#include <rmf_traffic/Executor.hpp>
 #include <rmf_traffic/agv/Planner.hpp>
 #include <rmf_traffic/agv/SimpleNegotiator.hpp>
 
@@ -152,6 +153,34 @@ public:
     /// solving.
     const std::vector<std::string>& log() const;
 
+    /// The work that a negotiator did to respond to one table
+    struct Response
+    {
+      /// The table that was responded to
+      schedule::Negotiation::VersionedKeySequence table;
+
+      /// The work that the negotiator did
+      SimpleNegotiator::Statistics work;
+    };
+
+    /// Statistics about how the negotiation went. These are always collected
+    /// because they cost very little.
+    struct Statistics
+    {
+      /// Statistics about the tables of the negotiation
+      schedule::Negotiation::Statistics negotiation;
+
+      /// Every response that was given, in the order that the responses were
+      /// given to the tables
+      std::vector<Response> responses;
+
+      /// How long the whole negotiation took
+      Duration time = Duration(0);
+    };
+
+    /// Get statistics about how the negotiation went
+    const Statistics& statistics() const;
+
     class Implementation;
   private:
     rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -184,6 +213,67 @@ public:
   /// running. Off by default.
   CentralizedNegotiation& print(bool on = true);
 
+  /// Set how many tables of the negotiation may be responded to at the same
+  /// time. When this is more than 1, up to this many tables are taken from
+  /// the queue together, and the agents plan their responses to them in
+  /// parallel. The responses are always given to the tables one at a time in
+  /// the order that the tables were taken from the queue, so the outcome does
+  /// not depend on how the threads are scheduled. A value of 0 is treated the
+  /// same as 1, which is the default.
+  CentralizedNegotiation& threads(std::size_t n);
+
+  /// Set the Executor that the threads() of the negotiation will be borrowed
+  /// from. If this is a nullptr, which is the default, each solve() will start
+  /// threads of its own when threads() is more than 1.
+  CentralizedNegotiation& executor(
+    std::shared_ptr<rmf_traffic::Executor> value);
+
+  /// Get the Executor that the threads of the negotiation are borrowed from.
+  const std::shared_ptr<rmf_traffic::Executor>& executor() const;
+
+  /// Toggle on/off whether to respond to the most promising table first. Each
+  /// table gets a lower bound on the total travel time of the agents: the
+  /// travel time of each itinerary that has been submitted to the table or its
+  /// ancestors, plus the travel time that each remaining agent would need if
+  /// there were no traffic. The table with the lowest bound is responded to
+  /// next.
+  ///
+  /// When this is combined with optimal(), the negotiation stops as soon as no
+  /// pending table has a lower bound than the best complete proposal that has
+  /// been found, instead of considering every combination.
+  ///
+  /// Off by default, in which case the most recently created table is
+  /// responded to next.
+  CentralizedNegotiation& best_first(bool on = true);
+
+  /// Set a limit on how long a solve may spend negotiating. When the limit is
+  /// reached, the best proposal that has been found so far will be returned,
+  /// if any has been found. Use std::nullopt for no limit, which is the
+  /// default.
+  CentralizedNegotiation& time_budget(std::optional<Duration> budget);
+
+  /// Toggle on/off whether to remember work between calls to solve(). When
+  /// this is on, each agent keeps its negotiator, along with every planning
+  /// attempt that the negotiator has made, for as long as the agent's starts,
+  /// goal, planner, and options stay the same. A planning attempt is reused
+  /// whenever a later solve() asks the agent to accommodate the same
+  /// itineraries again, so re-solving after one agent's goal has changed only
+  /// replans where the new plans of that agent make a difference.
+  ///
+  /// Planning attempts are only kept while the set of agents stays the same
+  /// and the schedule participants outside of the negotiation keep the same
+  /// itineraries. The no-traffic plans of best_first() are kept for as long as
+  /// their agents stay the same. The heuristics of each planner are already
+  /// kept by the planner itself.
+  ///
+  /// Copies of this CentralizedNegotiation share what it remembers, and their
+  /// calls to solve() will take turns. Off by default. Turning it off forgets
+  /// everything.
+  CentralizedNegotiation& incremental(bool on = true);
+
+  /// Forget everything that has been remembered between calls to solve().
+  CentralizedNegotiation& forget();
+
   /// Solve a centralized negotiation for the given agents.
   Result solve(const std::vector<Agent>& agents) const;
 
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__AGV__CONGESTIONFIELD_HPP
+#define RMF_TRAFFIC__AGV__CONGESTIONFIELD_HPP
+
+#include <rmf_traffic/agv/Graph.hpp>
+#include <rmf_traffic/schedule/Viewer.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+/// An estimate of how long a robot can expect to wait at each waypoint and
+/// lane of a graph because of the traffic that is in a schedule.
+///
+/// The field is measured from the trajectories of the schedule over a horizon
+/// of time. For each waypoint, the field adds up how long the trajectories
+/// stay within a radius of it and how many separate times they pass by it. A
+/// robot that arrives at a random moment during the horizon and has to wait
+/// for each pass to clear would expect to wait
+///
+///   occupied_time^2 / (2 * horizon * passes)
+///
+/// which is the delay that is reported for the waypoint. The delay of a lane
+/// is the delay of the waypoint that it exits into.
+///
+/// A field does not change after it is made. Use refresh() to get a field for
+/// a newer version of the schedule.
+///
+/// A field can be given to Planner::Options::congestion_field() to steer the
+/// planner away from crowded parts of the graph.
+class CongestionField
+{
+public:
+
+  /// Measure the congestion in a schedule.
+  ///
+  /// \param[in] graph
+  ///   The graph to measure the congestion of.
+  ///
+  /// \param[in] viewer
+  ///   The schedule to measure.
+  ///
+  /// \param[in] now
+  ///   The start of the horizon that will be measured.
+  ///
+  /// \param[in] horizon
+  ///   How far past now to measure. This must be greater than zero.
+  ///
+  /// \param[in] radius
+  ///   A trajectory that comes within this distance of a waypoint is
+  ///   considered to be occupying it. This must be greater than zero.
+  ///
+  /// \param[in] ignore
+  ///   The participants whose trajectories should not be measured. This
+  ///   should usually include the participant that will be planning.
+  ///
+  /// \warning This will throw a std::invalid_argument if horizon or radius is
+  /// not greater than zero.
+  static std::shared_ptr<const CongestionField> make(
+    const Graph& graph,
+    const schedule::Viewer& viewer,
+    Time now,
+    Duration horizon = std::chrono::minutes(2),
+    double radius = 1.0,
+    std::vector<schedule::ParticipantId> ignore = {});
+
+  /// Get a field for the latest state of a schedule. If the field is not
+  /// stale() then it will be returned as-is. Otherwise a new field will be
+  /// measured with the same graph and parameters, starting from now.
+  ///
+  /// \param[in] field
+  ///   The field to refresh. If this is a nullptr, a nullptr is returned.
+  static std::shared_ptr<const CongestionField> refresh(
+    std::shared_ptr<const CongestionField> field,
+    const schedule::Viewer& viewer,
+    Time now);
+
+  /// True if this field needs to be measured again. That happens when the
+  /// schedule version of the viewer has changed since this field was made,
+  /// when the viewer does not keep track of its version, or when now has
+  /// moved more than a quarter of the horizon past the start of this field.
+  bool stale(const schedule::Viewer& viewer, Time now) const;
+
+  /// The schedule version that this field was measured from, if the viewer
+  /// keeps track of one.
+  std::optional<schedule::Version> schedule_version() const;
+
+  /// The start of the horizon that this field was measured over.
+  Time start_time() const;
+
+  /// How far the horizon of this field extends past start_time().
+  Duration horizon() const;
+
+  /// The radius that was used to measure this field.
+  double radius() const;
+
+  /// The number of waypoints in the graph that this field was made for.
+  std::size_t num_waypoints() const;
+
+  /// The expected delay at a waypoint. Waypoints that are not in the graph of
+  /// this field have no delay.
+  Duration waypoint_delay(std::size_t waypoint) const;
+
+  /// The expected delay of moving along a lane. Lanes that are not in the
+  /// graph of this field have no delay.
+  Duration lane_delay(std::size_t lane) const;
+
+  class Implementation;
+private:
+  CongestionField();
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__AGV__CONGESTIONFIELD_HPP
@@ -25,6 +25,7 @@
 #include <rmf_utils/impl_ptr.hpp>
 #include <rmf_utils/clone_ptr.hpp>
 
+#include <iosfwd>
 #include <vector>
 #include <unordered_map>
 #include <optional>
@@ -169,6 +170,8 @@ public:
     virtual ~OrientationConstraint() = default;
   };
 
+  struct LaneInfo;
+
   /// Add a lane to connect two waypoints
   class Lane
   {
@@ -450,6 +453,9 @@ public:
       // We make the Lane a friend so it can copy and move the Nodes
       friend class Lane;
 
+      // A LaneInfo only holds the Nodes until they are moved into a new Lane
+      friend struct Graph::LaneInfo;
+
       // These constructors are private to make sure a user can't modify the
       // waypoint_index of a Node by copying or moving
       Node(const Node&) = default;
@@ -515,6 +521,17 @@ public:
   /// Default constructor
   Graph();
 
+  /// Reserve space for the waypoints and lanes that will be added to this
+  /// graph. When a large graph is built, this avoids growing its storage one
+  /// element at a time.
+  ///
+  /// \param[in] waypoints
+  ///   The total number of waypoints that the graph is expected to have
+  ///
+  /// \param[in] lanes
+  ///   The total number of lanes that the graph is expected to have
+  void reserve(std::size_t waypoints, std::size_t lanes);
+
   /// Make a new waypoint for this graph. It will not be connected to any other
   /// waypoints until you use make_lane() to connect it.
   ///
@@ -566,6 +583,25 @@ public:
     const Lane::Node& exit,
     Lane::Properties properties = Lane::Properties());
 
+  /// The description of a lane for add_lanes()
+  struct LaneInfo
+  {
+    Lane::Node entry;
+    Lane::Node exit;
+    Lane::Properties properties = Lane::Properties();
+  };
+
+  /// Make many lanes for this graph at once. This gives the same result as
+  /// calling add_lane() for each element in order, but the connections of the
+  /// waypoints are sized for all of the new lanes in one pass.
+  ///
+  /// If any of the lanes refers to a waypoint that is not in the graph, then
+  /// std::out_of_range will be thrown and none of the lanes will be added.
+  ///
+  /// \return the index of the first lane that was added. The rest of the lanes
+  /// follow it in the same order that they were given.
+  std::size_t add_lanes(std::vector<LaneInfo> lanes);
+
   /// Get the lane at the specified index
   Lane& get_lane(std::size_t index);
 
@@ -589,6 +625,21 @@ public:
   /// const-qualified lane_from()
   const Lane* lane_from(std::size_t from_wp, std::size_t to_wp) const;
 
+  /// Write this graph into a compact binary snapshot that can be loaded with
+  /// load(). Loading a snapshot is much faster than building the graph again
+  /// from a description of the navigation graph.
+  ///
+  /// \throws std::runtime_error if a lane uses an orientation constraint that
+  /// was not made by OrientationConstraint::make(), since there is no way to
+  /// write it.
+  void save(std::ostream& output) const;
+
+  /// Load a graph from a snapshot that was written by save().
+  ///
+  /// \return a nullopt if the snapshot is damaged or was written by a version
+  /// of the library with a different snapshot format.
+  static std::optional<Graph> load(std::istream& input);
+
   class Implementation;
 private:
   rmf_utils::impl_ptr<Implementation> _pimpl;
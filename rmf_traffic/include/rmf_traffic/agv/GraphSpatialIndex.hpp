@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__AGV__GRAPHSPATIALINDEX_HPP
+#define RMF_TRAFFIC__AGV__GRAPHSPATIALINDEX_HPP
+
+#include <rmf_traffic/agv/Graph.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+/// A grid over the waypoints and lanes of each map of a Graph, to quickly find
+/// the ones that are near a location. Build this once for a graph and reuse
+/// it for as long as the graph does not change.
+///
+/// Lanes whose entry and exit are on different maps are not indexed.
+class GraphSpatialIndex
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] graph
+  ///   The graph to index.
+  ///
+  /// \param[in] cell_size
+  ///   The width of each cell of the grid. Queries are fastest when this is
+  ///   close to the radius that they will use.
+  ///
+  /// \warning This will throw a std::invalid_argument if cell_size is not
+  /// greater than zero.
+  GraphSpatialIndex(const Graph& graph, double cell_size = 2.0);
+
+  /// Get the indices of the waypoints on a map that are closer than radius to
+  /// a location, in ascending order.
+  std::vector<std::size_t> waypoints_near(
+    const std::string& map_name,
+    const Eigen::Vector2d& location,
+    double radius) const;
+
+  /// Get the indices of the lanes on a map that come closer than radius to a
+  /// location, in ascending order.
+  std::vector<std::size_t> lanes_near(
+    const std::string& map_name,
+    const Eigen::Vector2d& location,
+    double radius) const;
+
+  /// The number of waypoints in the graph that was indexed.
+  std::size_t num_waypoints() const;
+
+  /// The number of lanes in the graph that was indexed.
+  std::size_t num_lanes() const;
+
+  /// The width of each cell of the grid.
+  double cell_size() const;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__AGV__GRAPHSPATIALINDEX_HPP
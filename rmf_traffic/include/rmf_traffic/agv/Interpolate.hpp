@@ -99,6 +99,44 @@ public:
     const std::vector<Eigen::Vector3d>& input_positions,
     const Options& options = Options());
 
+  /// Interpolate the positions and append the result to an existing
+  /// trajectory instead of creating a new one. This lets callers reuse the
+  /// storage of a trajectory that they interpolate into repeatedly.
+  ///
+  /// The finish time of the output trajectory must not be later than
+  /// start_time. If the output already has a waypoint at start_time, then the
+  /// interpolation will continue from that waypoint.
+  ///
+  /// \param[in] traits
+  ///   The traits of the vehicle
+  ///
+  /// \param[in] start_time
+  ///   The time that the vehicle is at the first position
+  ///
+  /// \param[in] input_positions
+  ///   The positions to interpolate
+  ///
+  /// \param[out] output
+  ///   The trajectory that the interpolation will be appended to
+  ///
+  /// \param[in] options
+  ///   The interpolation options
+  static void positions(
+    const VehicleTraits& traits,
+    Time start_time,
+    const std::vector<Eigen::Vector3d>& input_positions,
+    Trajectory& output,
+    const Options& options = Options());
+
+  /// Interpolate many sequences of positions for vehicles that share the same
+  /// traits. The traits are only validated once for the whole batch. The
+  /// trajectory for each sequence will be at the same index as the sequence.
+  static std::vector<Trajectory> batch_positions(
+    const VehicleTraits& traits,
+    Time start_time,
+    const std::vector<std::vector<Eigen::Vector3d>>& input_sequences,
+    const Options& options = Options());
+
 };
 
 //==============================================================================
@@ -19,6 +19,7 @@
 #define RMF_TRAFFIC__AGV__LANECLOSURE_HPP
 
 #include <utility>
+#include <vector>
 
 #include <rmf_utils/impl_ptr.hpp>
 
@@ -62,8 +63,12 @@ public:
   ///   The index for the closing lane
   LaneClosure& close(std::size_t lane);
 
-  /// Get an integer that uniquely describes the overall closure status of the
-  /// graph lanes.
+  /// Get the indices of every lane that is closed, in ascending order.
+  std::vector<std::size_t> closed_lanes() const;
+
+  /// Get an integer that describes the overall closure status of the graph
+  /// lanes. Closures that are equal always have the same hash. This is
+  /// updated in constant time whenever a lane is opened or closed.
   std::size_t hash() const;
 
   /// Equality comparison operator
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__AGV__PLANEXECUTOR_HPP
+#define RMF_TRAFFIC__AGV__PLANEXECUTOR_HPP
+
+#include <rmf_traffic/Executor.hpp>
+#include <rmf_traffic/Time.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <memory>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+/// Computes plans in the background on the threads of an Executor, and keeps
+/// track of how long the planning jobs take.
+///
+/// One plan executor can be shared by any number of planners. The library owns
+/// a shared plan executor that runs on Executor::shared(), and it is used when
+/// no other plan executor is given to Planner::plan_async().
+///
+/// When a plan executor is destroyed, it will wait for every job that was
+/// given to it to finish.
+class PlanExecutor
+{
+public:
+
+  /// Statistics about the jobs that an executor has finished. These can be
+  /// used to decide how many threads an executor should have. If the queue
+  /// delay is large compared to the compute time, then more threads would
+  /// help.
+  struct Statistics
+  {
+    /// How many jobs have been finished
+    std::size_t jobs = 0;
+
+    /// The total time that finished jobs spent waiting for a worker
+    Duration total_queue_delay = Duration(0);
+
+    /// The longest time that any finished job spent waiting for a worker
+    Duration max_queue_delay = Duration(0);
+
+    /// The total time that workers spent computing finished jobs
+    Duration total_compute_time = Duration(0);
+  };
+
+  /// Make a plan executor with an Executor of its own.
+  ///
+  /// \param[in] threads
+  ///   The number of worker threads. A value of 0 is treated the same as 1.
+  static std::shared_ptr<PlanExecutor> make(std::size_t threads);
+
+  /// Make a plan executor that runs its jobs on the given Executor, which may
+  /// be shared with anything else.
+  ///
+  /// \param[in] executor
+  ///   The executor to run the jobs on. If this is a nullptr,
+  ///   Executor::shared() will be used.
+  static std::shared_ptr<PlanExecutor> make(std::shared_ptr<Executor> executor);
+
+  /// Get the plan executor that the library shares between all planners. It
+  /// runs on Executor::shared() and it is created the first time it is needed.
+  static const std::shared_ptr<PlanExecutor>& shared();
+
+  /// Get the Executor that runs the jobs
+  const std::shared_ptr<Executor>& executor() const;
+
+  /// Get the number of worker threads
+  std::size_t threads() const;
+
+  /// Get the number of jobs that are waiting for a worker
+  std::size_t queued() const;
+
+  /// Get statistics about the jobs that have been finished
+  Statistics statistics() const;
+
+  class Implementation;
+private:
+  PlanExecutor();
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__AGV__PLANEXECUTOR_HPP
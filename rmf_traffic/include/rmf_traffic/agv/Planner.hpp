@@ -18,17 +18,22 @@
 #ifndef RMF_TRAFFIC__AGV__PLANNER_HPP
 #define RMF_TRAFFIC__AGV__PLANNER_HPP
 
+#include <rmf_traffic/Executor.hpp>
 #include <rmf_traffic/Trajectory.hpp>
 
+#include <rmf_traffic/agv/CongestionField.hpp>
 #include <rmf_traffic/agv/Graph.hpp>
+#include <rmf_traffic/agv/GraphSpatialIndex.hpp>
 #include <rmf_traffic/agv/LaneClosure.hpp>
 #include <rmf_traffic/agv/Interpolate.hpp>
+#include <rmf_traffic/agv/PlanExecutor.hpp>
 #include <rmf_traffic/agv/RouteValidator.hpp>
 #include <rmf_traffic/agv/VehicleTraits.hpp>
 
 #include <rmf_utils/optional.hpp>
 
 #include <atomic>
+#include <memory_resource>
 
 namespace rmf_traffic {
 namespace agv {
@@ -70,7 +75,10 @@ public:
     /// Set the graph to use for planning
     Configuration& graph(Graph graph);
 
-    /// Get a mutable reference to the graph
+    /// Get a mutable reference to the graph. Changes made through this
+    /// reference will not affect any Planner or copy of this Configuration
+    /// that is created after it was taken, because they each get their own
+    /// copy of the graph.
     Graph& graph();
 
     /// Get a const reference to the graph
@@ -111,6 +119,100 @@ public:
     /// Get the traversal cost.
     double traversal_cost_per_meter() const;
 
+    /// Set a file of heuristic tables that a Planner should preload when it
+    /// gets constructed with this configuration. The file should have been
+    /// written by Planner::save_heuristic_cache() for a planner with the same
+    /// graph, vehicle traits, interpolation options, lane closures, and
+    /// traversal cost. A file that is missing or does not match will be
+    /// ignored, and the planner will compute its heuristics from scratch.
+    Configuration& heuristic_cache_file(std::optional<std::string> file_path);
+
+    /// Get the file of heuristic tables that will be preloaded, if any.
+    const std::optional<std::string>& heuristic_cache_file() const;
+
+    /// How a heuristic cache chooses which goals to discard when it goes over
+    /// its memory budget
+    enum class HeuristicEviction : uint8_t
+    {
+      /// Discard the goal that was used least recently
+      LeastRecentlyUsed,
+
+      /// Discard the goal whose heuristics took the least time to compute for
+      /// each byte that they use
+      CheapestToRecompute
+    };
+
+    /// Set how many bytes each heuristic cache of the planner may use. When a
+    /// cache goes over this budget, it discards the heuristics of whole goals
+    /// until it fits again. Discarded heuristics will be computed again if a
+    /// later plan needs them. The sizes are estimates, so this should be
+    /// treated as a soft limit. A nullopt budget, which is the default, lets
+    /// the caches grow without limit.
+    Configuration& heuristic_cache_budget(std::optional<std::size_t> bytes);
+
+    /// Get the memory budget of each heuristic cache.
+    std::optional<std::size_t> heuristic_cache_budget() const;
+
+    /// Set how the heuristic caches choose which goals to discard. The default
+    /// is HeuristicEviction::LeastRecentlyUsed.
+    Configuration& heuristic_cache_eviction(HeuristicEviction policy);
+
+    /// Get how the heuristic caches choose which goals to discard.
+    HeuristicEviction heuristic_cache_eviction() const;
+
+    /// Find the traversals of every waypoint of the graph while the planner is
+    /// being constructed, dividing the waypoints between the given number of
+    /// threads. Otherwise each traversal is found the first time that a search
+    /// reaches its waypoint, which can stall the first plans through a large
+    /// graph. A nullopt, which is the default, finds the traversals as they
+    /// are needed. A value of 0 is treated the same as 1.
+    Configuration& eager_traversals(std::optional<std::size_t> threads);
+
+    /// Get the number of threads that will find every traversal of the graph
+    /// when the planner is constructed, if the traversals are found eagerly.
+    std::optional<std::size_t> eager_traversals() const;
+
+    /// Find the shortest paths between floors in two levels: first across the
+    /// lanes that change floors, and then within each floor, reusing the
+    /// searches of each floor between plans. This can make the heuristics for
+    /// plans between floors much cheaper to find in large buildings, because
+    /// the searches no longer spread across whole floors that the path does
+    /// not pass through. The costs that are found do not change. The default
+    /// is false.
+    Configuration& floor_hierarchy(bool enable);
+
+    /// Check whether shortest paths between floors will be found in two
+    /// levels.
+    bool floor_hierarchy() const;
+
+    /// Pass straight through the waypoints in the middle of corridors instead
+    /// of considering a stop at each of them. A corridor waypoint connects
+    /// exactly two neighbors and is not named, a holding point, a parking
+    /// spot, or a charger. This makes the search much smaller on graphs with
+    /// long chains of lanes, but a plan will never wait for traffic at one of
+    /// those waypoints, so some conflicts may only be resolved by waiting
+    /// somewhere farther away, or not at all. The default is false.
+    Configuration& contract_corridors(bool enable);
+
+    /// Check whether plans will pass straight through the waypoints in the
+    /// middle of corridors.
+    bool contract_corridors() const;
+
+    /// Preprocess the graph into a contraction hierarchy when the planner is
+    /// constructed, and use it to find the quickest paths between waypoints,
+    /// both for quickest_path() and for the heuristic of the planner. The
+    /// preprocessing takes longer than the first few searches would, but after
+    /// that each shortest path only needs two small searches of the hierarchy
+    /// instead of a search across the graph. This suits large graphs that do
+    /// not change often. The hierarchy is made again whenever the lane
+    /// closures change. The costs that are found do not change. The default
+    /// is false.
+    Configuration& contraction_hierarchy(bool enable);
+
+    /// Check whether the quickest paths will be found with a contraction
+    /// hierarchy.
+    bool contraction_hierarchy() const;
+
     // TODO(MXG): Add a field to specify whether multi-start planning problems
     // should choose the plan that takes the least amount of time (according to
     // plan duration) or the plan that finishes the earliest (according to the
@@ -202,9 +304,29 @@ public:
     /// Set the route validator
     Options& validator(rmf_utils::clone_ptr<RouteValidator> v);
 
-    /// Get the route validator
+    /// Set a route validator that will be shared instead of cloned. Copies of
+    /// these Options and every plan that uses them will refer to the same
+    /// validator, so the Options stay cheap to copy and the validator can keep
+    /// its caches across many plans. The validator may be used by several
+    /// planning threads at once, so its find_conflict functions must be safe
+    /// to call concurrently.
+    ///
+    /// This replaces any validator that was given as a clone_ptr.
+    Options& validator(std::shared_ptr<const RouteValidator> v);
+
+    /// Remove the route validator
+    Options& validator(std::nullptr_t);
+
+    /// Get the route validator, if it was given as a clone_ptr
     const rmf_utils::clone_ptr<RouteValidator>& validator() const;
 
+    /// Get the route validator, if it was given as a shared_ptr
+    const std::shared_ptr<const RouteValidator>& shared_validator() const;
+
+    /// Get the route validator that will be used, whichever way it was given.
+    /// This will be a nullptr if there is no validator.
+    const RouteValidator* get_validator() const;
+
     /// Set the minimum amount of time to spend waiting at holding points
     Options& minimum_holding_time(Duration holding_time);
 
@@ -267,6 +389,204 @@ public:
     /// Get the dependency resolution for generated plans.
     Duration dependency_resolution() const;
 
+    /// Set the options that the validator should use to detect conflicts while
+    /// planning. Rough planning can use DetectConflict::Options::fast() to
+    /// explore the search space more quickly. If set to a nullopt, the
+    /// validator will use its own options.
+    Options& conflict_options(std::optional<DetectConflict::Options> value);
+
+    /// Get the options that the validator should use to detect conflicts.
+    const std::optional<DetectConflict::Options>& conflict_options() const;
+
+    /// Set how many threads may search for a plan that has several starts.
+    /// Each start will be searched separately on a pool of threads that is
+    /// shared by the planner, and the cheapest of the plans will be chosen.
+    /// The calling thread counts as one of the threads, so a value of 1, which
+    /// is the default, means that the starts are searched together on the
+    /// calling thread. A value of 0 is treated the same as 1.
+    ///
+    /// Rollout::expand() uses the same number of threads to expand through
+    /// separate blockages at the same time.
+    ///
+    /// \warning When more than one thread is used, the validator and the
+    /// interrupter may be called from several threads at the same time.
+    Options& search_threads(std::size_t value);
+
+    /// Get how many threads may search for a plan.
+    std::size_t search_threads() const;
+
+    /// Search for every plan with the search_threads() working together on
+    /// one search, instead of only splitting up the starts of a plan. The
+    /// states of the search are spread across the threads by their lane,
+    /// orientation and time, and each thread expands the states that belong
+    /// to it, passing the new states that belong to other threads over to
+    /// them. The search still finds the cheapest plan. This helps hard plans
+    /// that need to search through a great many states, such as waiting for a
+    /// crowded bottleneck to clear. The default is false.
+    ///
+    /// The saturation_limit() applies to each thread on its own. The search
+    /// that is carried over when a Result is resumed is the same whichever
+    /// way the plan was found.
+    ///
+    /// \warning When this is used, the validator and the interrupter will be
+    /// called from several threads at the same time.
+    Options& hash_distributed_search(bool enable);
+
+    /// Check whether the threads will work together on each search.
+    bool hash_distributed_search() const;
+
+    /// Set how many threads may validate the ways of leaving a waypoint each
+    /// time that the search expands from one. The routes are checked on a pool
+    /// of threads that is shared by the planner, and the nodes that pass are
+    /// added to the search in the same order as they would be on one thread,
+    /// so the plan that is found does not change. The calling thread counts as
+    /// one of the threads, so a value of 1, which is the default, means that
+    /// everything is validated on the calling thread. A value of 0 is treated
+    /// the same as 1.
+    ///
+    /// This helps most when the validator is expensive, because each
+    /// expansion has to wait for its slowest check.
+    ///
+    /// \warning When more than one thread is used, the validator may be called
+    /// from several threads at the same time.
+    Options& expansion_threads(std::size_t value);
+
+    /// Get how many threads may validate the expansions of a search.
+    std::size_t expansion_threads() const;
+
+    /// Let the interrupter stop the validator partway through checking a
+    /// route, instead of waiting for the check to finish before the search
+    /// notices the interruption. A check that gets cut short is treated as a
+    /// conflict, and the node that was being expanded is put back into the
+    /// search so that resuming the Result expands it again with a full check.
+    /// The default is false.
+    ///
+    /// \warning When this is used, the interrupter will be called many times
+    /// for each node that gets expanded, and it may be called from the
+    /// expansion_threads() at the same time. An interrupt_flag() is always
+    /// safe to use this way.
+    Options& validation_interrupts(bool enable);
+
+    /// Check whether the interrupter can stop the validator partway through a
+    /// check.
+    bool validation_interrupts() const;
+
+    /// Set the Executor whose threads will be borrowed by the
+    /// search_threads() and expansion_threads() of a plan. If this is a
+    /// nullptr, which is the default, the planner will start threads of its
+    /// own for them.
+    Options& executor(std::shared_ptr<rmf_traffic::Executor> value);
+
+    /// Get the Executor whose threads will be borrowed while planning.
+    const std::shared_ptr<rmf_traffic::Executor>& executor() const;
+
+    /// Allow the planner to return a plan that costs more than the best plan
+    /// in exchange for finding it sooner. The plan will cost at most
+    /// (1 + value) times the cost of the best plan. The default value of 0
+    /// means that the planner will always find the best plan. Negative values
+    /// are treated as 0.
+    ///
+    /// This takes effect when a planning job is set up, so changing it before
+    /// resuming a Result will not change how that Result searches.
+    Options& suboptimality_budget(double value);
+
+    /// Get the suboptimality budget.
+    double suboptimality_budget() const;
+
+    /// Give the planner a deadline, which turns on anytime planning. The
+    /// planner will first search quickly for any plan that it can find, and
+    /// then it will search for the best plan until the deadline. If the
+    /// deadline passes first, the quick plan will be returned as the
+    /// incumbent. The quick search is not stopped by the deadline, so a plan
+    /// will still be found when the deadline is very tight. Set this to a nullopt, which is the default, to let the
+    /// planner search for as long as it needs.
+    ///
+    /// The deadline will also interrupt the search, so Result::interrupted()
+    /// will be true if the deadline passed, even if an incumbent was returned.
+    Options& deadline(std::optional<Time> value);
+
+    /// Get the deadline of the planner.
+    std::optional<Time> deadline() const;
+
+    /// Let Result::replan() reuse the plan that was found before. When a new
+    /// start is on the previous plan, the rest of that plan will be checked
+    /// against the current schedule, and if it is still valid then it will be
+    /// given to the new search. The new search will finish as soon as it can
+    /// tell that nothing better is possible, so this will not make the new
+    /// plan any worse. This is true by default.
+    Options& reuse_previous_plan(bool choice);
+
+    /// Check whether Result::replan() will reuse the previous plan.
+    bool reuse_previous_plan() const;
+
+    /// Set the memory resource that the nodes of a search will be allocated
+    /// from. A per-request arena such as std::pmr::monotonic_buffer_resource
+    /// can make planning cheaper when many plans are made at once. Set this to
+    /// a nullptr, which is the default, to use the default memory resource.
+    ///
+    /// This takes effect when a planning job is set up. Resuming a Result
+    /// keeps using the resource that its job was set up with.
+    ///
+    /// \warning The resource must outlive every Result made with these
+    /// Options, including copies of those Results, and every Result that
+    /// continues from them. The planner does not synchronize its use of the
+    /// resource, so when search_threads() is more than 1 the resource must be
+    /// thread-safe.
+    Options& memory_resource(std::pmr::memory_resource* resource);
+
+    /// Get the memory resource that search nodes will be allocated from.
+    std::pmr::memory_resource* memory_resource() const;
+
+    /// Hold in safe intervals, similar to Safe Interval Path Planning. When
+    /// the planner first holds at a waypoint, it asks the validator once for
+    /// how long the robot could stay there before running into a conflict.
+    /// Holds inside of that interval do not need to be validated again, and
+    /// a robot that arrives at the waypoint later than an expanded node in
+    /// the same interval, for no less cost than waiting there, will not be
+    /// expanded. Crowded schedules will need far fewer validator calls to wait
+    /// out a long blockage.
+    ///
+    /// A plan found this way may cost up to one minimum_holding_time() more
+    /// than the plan that would be found without this. This is false by
+    /// default.
+    Options& safe_interval_holding(bool choice);
+
+    /// Check whether the planner will hold in safe intervals.
+    bool safe_interval_holding() const;
+
+    /// Steer the search away from congested parts of the graph. The field must
+    /// be made for the same graph as the planner. Use
+    /// CongestionField::refresh() to keep it up to date with the schedule.
+    ///
+    /// With a suboptimality_budget() of 0, the field only breaks ties between
+    /// nodes with the same cost estimate, so the best plan is still found.
+    /// Otherwise, part of the budget is spent on the expected delay at the
+    /// waypoint of each node, so the planner will explore around crowded
+    /// waypoints first, and the plan will still cost at most
+    /// (1 + suboptimality_budget()) times the cost of the best plan.
+    ///
+    /// Set this to a nullptr, which is the default, to ignore congestion. This
+    /// takes effect when a planning job is set up.
+    Options& congestion_field(std::shared_ptr<const CongestionField> field);
+
+    /// Get the congestion field that will steer the search.
+    const std::shared_ptr<const CongestionField>& congestion_field() const;
+
+    /// Try the ideal plan before searching around the schedule. The planner
+    /// will first find the plan that it would make if the schedule were
+    /// empty, and then validate it once. If it has no conflicts, it will be
+    /// returned right away, because no plan can cost less. Otherwise the part
+    /// of it that has no conflicts will be given to the search as a head
+    /// start, which will not make the plan any worse.
+    ///
+    /// This saves a lot of validation when most plans do not run into any
+    /// traffic, but it wastes the search for the ideal plan when they do. This
+    /// is false by default.
+    Options& ideal_plan_first(bool choice);
+
+    /// Check whether the planner will try the ideal plan first.
+    bool ideal_plan_first() const;
+
     class Implementation;
   private:
     rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -412,6 +732,42 @@ public:
     rmf_utils::impl_ptr<Implementation> _pimpl;
   };
 
+  /// A set of goals that a plan may finish at, e.g. any one of several
+  /// chargers. A plan to a GoalSet finishes at whichever goal has the lowest
+  /// total cost, where the total cost is the cost of the plan to reach the
+  /// goal plus the cost offset of the goal.
+  class GoalSet
+  {
+  public:
+
+    /// Create an empty set of goals
+    GoalSet();
+
+    /// Add a goal to the set.
+    ///
+    /// \param[in] goal
+    ///   The goal conditions. The orientation and minimum time of each goal
+    ///   are respected as usual.
+    ///
+    /// \param[in] cost_offset
+    ///   An extra cost for finishing at this goal. This can be used to express
+    ///   a preference between the goals.
+    GoalSet& add(Goal goal, double cost_offset = 0.0);
+
+    /// Get the number of goals in the set
+    std::size_t size() const;
+
+    /// Get a goal in the set
+    const Goal& goal(std::size_t index) const;
+
+    /// Get the cost offset of a goal in the set
+    double cost_offset(std::size_t index) const;
+
+    class Implementation;
+  private:
+    rmf_utils::impl_ptr<Implementation> _pimpl;
+  };
+
   class Result;
 
   /// Constructor
@@ -454,6 +810,178 @@ public:
   /// Get a const reference to the default planning options.
   const Options& get_default_options() const;
 
+  /// How the result cache picks which result to drop when it is full
+  enum class CacheEviction : uint8_t
+  {
+    /// Drop the result that was used least recently
+    LeastRecentlyUsed,
+
+    /// Drop the result that was put into the cache first
+    FirstInFirstOut
+  };
+
+  /// Set how many results of plan() this planner remembers. When plan() or
+  /// setup() is called with the same starts, goal, and options as a result
+  /// that it remembers, and the validator still has the same identity (see
+  /// RouteValidator::identity()), a copy of that result will be returned
+  /// without any searching. Only successful searches are remembered. Requests
+  /// are never answered from the cache if their options have a deadline or
+  /// custom conflict options, or if their validator does not have an identity.
+  ///
+  /// A capacity of 0 turns the cache off, which is the default. Copies of a
+  /// planner begin with an empty cache of the same capacity.
+  Planner& set_result_cache_capacity(std::size_t capacity);
+
+  /// Get how many results of plan() this planner remembers.
+  std::size_t get_result_cache_capacity() const;
+
+  /// Set how the result cache picks which result to drop when it is full. The
+  /// default is CacheEviction::LeastRecentlyUsed.
+  Planner& set_result_cache_eviction(CacheEviction policy);
+
+  /// Get how the result cache picks which result to drop when it is full.
+  CacheEviction get_result_cache_eviction() const;
+
+  /// Write the heuristic tables that this planner has computed so far into a
+  /// compact binary file. A new planner can preload the file (see
+  /// load_heuristic_cache() and Configuration::heuristic_cache_file()) to skip
+  /// the slow searches that the first plans of a cold planner would need.
+  ///
+  /// The file is stamped with a hash of this planner's configuration and will
+  /// be refused by planners with a different configuration.
+  ///
+  /// \return false if the file could not be written.
+  bool save_heuristic_cache(const std::string& file_path) const;
+
+  /// Preload heuristic tables that were written by save_heuristic_cache().
+  /// Entries that this planner has already computed are kept.
+  ///
+  /// \return false if the file could not be read or was written for a
+  /// different configuration. In that case nothing gets loaded.
+  bool load_heuristic_cache(const std::string& file_path);
+
+  /// Share heuristic tables with planners in other processes through an
+  /// append-only journal file, e.g. when each fleet adapter on a host has its
+  /// own planner for the same building. Every table in the journal that was
+  /// published for this planner's configuration gets preloaded, and then the
+  /// tables that this planner has computed which are not in the journal yet
+  /// are appended to it. Records for other configurations are left alone, so
+  /// one journal can be shared by every planner on the host.
+  ///
+  /// Call this after warm_cache() or every so often while the planner is in
+  /// use. The file will be created if it does not exist yet.
+  ///
+  /// \return false if the journal could not be opened or written.
+  bool sync_heuristic_cache(const std::string& file_path);
+
+  /// Statistics about the heuristic caches of a planner, summed over all of
+  /// its caches
+  struct HeuristicCacheStatistics
+  {
+    /// The number of heuristic entries that are stored
+    std::size_t entries = 0;
+
+    /// An estimate of how many bytes the stored entries use
+    std::size_t bytes = 0;
+
+    /// How many lookups were answered by a stored entry
+    std::size_t hits = 0;
+
+    /// How many lookups needed a new entry to be computed
+    std::size_t misses = 0;
+
+    /// How many goals have been discarded to stay within the memory budget
+    std::size_t evictions = 0;
+  };
+
+  /// Get statistics about the heuristic caches of this planner. Copies of a
+  /// planner share the same caches.
+  HeuristicCacheStatistics get_heuristic_cache_statistics() const;
+
+  /// A report of how much memory the caches of a planner are holding
+  struct MemoryUsage
+  {
+    /// How much memory one kind of cache is holding
+    struct Cache
+    {
+      /// The number of entries that are stored
+      std::size_t entries = 0;
+
+      /// The bytes of the stored entries and of the tables that hold them
+      std::size_t bytes = 0;
+    };
+
+    /// The heuristics that estimate the remaining cost to each goal
+    Cache heuristics;
+
+    /// The continuous traversals that leave or enter each waypoint
+    Cache traversals;
+
+    /// The ways of entering each waypoint
+    Cache entries;
+
+    /// The sum of the bytes of every cache
+    std::size_t total() const;
+  };
+
+  /// Get how much memory the caches of this planner are holding. Copies of a
+  /// planner share the same caches. This only takes the lock of each cache
+  /// briefly, so it is cheap enough to poll while plans are being made.
+  MemoryUsage memory_usage() const;
+
+  /// Compute the heuristics that plans to the given goal waypoints will need,
+  /// so that no later plan has to wait for them. This is meant to be run while
+  /// deploying or while the planner is idle. The goals are divided between a
+  /// pool of threads because the heuristic of each goal can be computed
+  /// independently of the others.
+  ///
+  /// Copies of this planner share the results. They will also be included in
+  /// the file written by save_heuristic_cache().
+  ///
+  /// \param[in] goals
+  ///   The indices of the goal waypoints. If this is empty, every waypoint of
+  ///   the graph will be treated as a goal.
+  ///
+  /// \param[in] threads
+  ///   The number of threads to use, including the calling thread. A value of
+  ///   0 is treated the same as 1.
+  ///
+  /// \throws std::out_of_range if a goal is not a waypoint of the graph.
+  void warm_cache(
+    std::vector<std::size_t> goals = {},
+    std::size_t threads = 1) const;
+
+  /// Make a planner that only differs from this one by its lane closures, e.g.
+  /// because a door has been blocked or a lift has gone out of service. This
+  /// is much faster than constructing a new Planner, because every cached
+  /// traversal and heuristic of this planner that cannot be affected by the
+  /// changed lanes is carried over into the new planner. Only the entries
+  /// whose paths cross a lane that has been closed need to be computed again.
+  /// Opening a lane may improve the solution for any goal, so when lanes are
+  /// opened, only the entries that do not depend on lane closures are kept.
+  ///
+  /// The new planner has the same default options and result cache settings
+  /// as this one, but it begins with an empty result cache. This planner is
+  /// not changed. If the closures are the same as the closures of this
+  /// planner, the result is simply a copy of this planner.
+  ///
+  /// \param[in] closures
+  ///   The lane closures of the new planner
+  Planner with_lane_closures(LaneClosure closures) const;
+
+  /// Change the lane closures of this planner in place, carrying over the
+  /// same cached traversals and heuristics as with_lane_closures(). The result
+  /// cache of this planner is cleared, but its settings are kept. Results that
+  /// were already produced by this planner are not affected. Nothing is done
+  /// if the closures are the same as the current closures of this planner.
+  ///
+  /// \warning This must not be called while another thread is planning with
+  /// this planner.
+  ///
+  /// \param[in] closures
+  ///   The new lane closures of this planner
+  Planner& set_lane_closures(LaneClosure closures);
+
   using StartSet = std::vector<Start>;
 
   /// Produce a plan for the given starting conditions and goal. The default
@@ -523,6 +1051,129 @@ public:
     Goal goal,
     Options options) const;
 
+  /// Produces a plan for the given set of starting conditions that finishes at
+  /// whichever of the goals has the lowest total cost. The default Options of
+  /// this Planner instance will be used.
+  ///
+  /// The goals are searched in order of their ideal costs, and each search is
+  /// capped by the best total cost that has been found so far, so goals that
+  /// cannot beat the best plan are abandoned early or never searched at all.
+  /// Use Result::get_goal() to find out which goal was chosen.
+  ///
+  /// If no goal can be reached, the Result of the goal with the lowest ideal
+  /// cost is returned.
+  ///
+  /// \param[in] starts
+  ///   The set of available starting conditions
+  ///
+  /// \param[in] goals
+  ///   The set of acceptable goals
+  ///
+  /// 	hrows std::invalid_argument if the set of goals is empty.
+  Result plan(const StartSet& starts, const GoalSet& goals) const;
+
+  /// Produces a plan for the given set of starting conditions that finishes at
+  /// whichever of the goals has the lowest total cost. Override the default
+  /// options.
+  ///
+  /// \param[in] starts
+  ///   The set of available starting conditions
+  ///
+  /// \param[in] goals
+  ///   The set of acceptable goals
+  ///
+  /// \param[in] options
+  ///   The options to use for this plan. This overrides the default Options of
+  ///   the Planner instance.
+  ///
+  /// 	hrows std::invalid_argument if the set of goals is empty.
+  ///
+  /// \sa plan(const StartSet&, const GoalSet&)
+  Result plan(
+    const StartSet& starts,
+    const GoalSet& goals,
+    Options options) const;
+
+  /// A handle on a plan that is being computed by a PlanExecutor. Copies of a
+  /// PendingResult refer to the same planning job.
+  class PendingResult
+  {
+  public:
+
+    /// Check whether the planning job has finished.
+    bool ready() const;
+
+    /// Wait until the planning job has finished or the timeout has passed.
+    ///
+    /// \return true if the planning job has finished.
+    bool wait_for(Duration timeout) const;
+
+    /// Wait until the planning job has finished and get its result. If the
+    /// planning job threw an exception, that exception will be rethrown here.
+    const Result& get() const;
+
+    /// Ask the planning job to stop. If the job has not started yet, it will
+    /// stop as soon as it starts. The Result will say that it was interrupted,
+    /// and it can be resumed later.
+    void cancel();
+
+    /// Check whether cancel() has been called.
+    bool cancelled() const;
+
+    /// The number of search nodes that the planning job has examined so far.
+    std::size_t expansions() const;
+
+    /// How long the planning job waited for a worker. This will be a nullopt
+    /// until a worker has started on the job.
+    std::optional<Duration> queue_delay() const;
+
+    /// How long a worker spent on the planning job. This will be a nullopt
+    /// until the job has finished.
+    std::optional<Duration> compute_time() const;
+
+    class Implementation;
+  private:
+    PendingResult();
+    rmf_utils::impl_ptr<Implementation> _pimpl;
+  };
+
+  /// Produce a plan in the background.
+  ///
+  /// \param[in] start
+  ///   The starting conditions
+  ///
+  /// \param[in] goal
+  ///   The goal conditions
+  ///
+  /// \param[in] options
+  ///   The Options to use for this plan. The interrupter of these options will
+  ///   be called from the thread of the executor.
+  ///
+  /// \param[in] deadline
+  ///   If the planning job is still running at this time, it will be
+  ///   interrupted.
+  ///
+  /// \param[in] executor
+  ///   The executor that should compute the plan. If this is a nullptr, then
+  ///   PlanExecutor::shared() will be used.
+  PendingResult plan_async(
+    const Start& start,
+    Goal goal,
+    Options options,
+    std::optional<Time> deadline = std::nullopt,
+    std::shared_ptr<PlanExecutor> executor = nullptr) const;
+
+  /// Produce a plan for a set of starting conditions in the background.
+  ///
+  /// \sa plan_async(const Start&, Goal, Options, std::optional<Time>,
+  /// std::shared_ptr<PlanExecutor>)
+  PendingResult plan_async(
+    const StartSet& starts,
+    Goal goal,
+    Options options,
+    std::optional<Time> deadline = std::nullopt,
+    std::shared_ptr<PlanExecutor> executor = nullptr) const;
+
   /// Set up a planning job, but do not start iterating.
   ///
   /// \sa plan(const Start&, Goal)
@@ -601,6 +1252,32 @@ public:
       const StartSet& start,
       std::size_t goal_vertex) const;
 
+  /// Calculate the QuickestPath from each of several start sets to each of
+  /// several goals, e.g. to find the cost of sending each robot of a fleet to
+  /// each of a set of tasks. This gives the same results as calling
+  /// quickest_path() for each combination, but the searches are shared: the
+  /// search tree that grows from a start waypoint is reused for every goal,
+  /// and the search tree that grows from a goal is reused for every start.
+  ///
+  /// \param[in] starts
+  ///   The start sets to plan from. Each start set gets one row of the matrix.
+  ///
+  /// \param[in] goal_vertices
+  ///   The goal vertices to plan to. Each goal gets one column of the matrix.
+  ///
+  /// \param[in] threads
+  ///   The number of threads to use, including the calling thread. A value of
+  ///   0 is treated the same as 1.
+  ///
+  /// \return A matrix where element [i][j] is the quickest path from starts[i]
+  /// to goal_vertices[j], or a nullopt if they are not connected.
+  ///
+  /// \throws std::out_of_range if a goal is not a waypoint of the graph.
+  std::vector<std::vector<std::optional<QuickestPath>>> quickest_path_matrix(
+    const std::vector<StartSet>& starts,
+    const std::vector<std::size_t>& goal_vertices,
+    std::size_t threads = 1) const;
+
   class Implementation;
   class Debug;
 private:
@@ -639,6 +1316,9 @@ public:
   /// Replan to the same goal from a new start location using the same options
   /// as before.
   ///
+  /// If the new start is on the previous plan, the rest of the previous plan
+  /// may be reused. See Options::reuse_previous_plan().
+  ///
   /// \param[in] new_start
   ///   The starting conditions that should be used for replanning.
   Result replan(const Start& new_start) const;
@@ -698,7 +1378,8 @@ public:
     const StartSet& new_starts,
     Options new_options) const;
 
-  /// Resume planning if the planner was paused.
+  /// Resume planning if the planner was paused. If the plan is an incumbent,
+  /// the planner will keep searching for a better one.
   ///
   /// \return true if a plan has been found, false otherwise.
   bool resume();
@@ -737,6 +1418,25 @@ public:
   /// return a nullopt.
   std::optional<double> ideal_cost() const;
 
+  /// If a plan has been found, get a bound on how far it can be from the best
+  /// plan. The plan costs at most this many times the cost of the best plan,
+  /// so a value of 1 means that the plan is known to be the best. The bound
+  /// never exceeds 1 + Options::suboptimality_budget(). If no plan has been
+  /// found, this will return a nullopt.
+  std::optional<double> suboptimality_bound() const;
+
+  /// This will return true if the plan is the incumbent of an anytime plan,
+  /// which means that the deadline of the Options passed before the planner
+  /// could find a better plan or prove that there is none. Calling resume()
+  /// will keep searching for a better plan, so give the Options a new deadline
+  /// before resuming.
+  bool incumbent() const;
+
+  /// If a plan has been found, get the most that its cost could exceed the
+  /// cost of the best plan. This will be 0 if the plan is known to be the
+  /// best. If no plan has been found, this will return a nullopt.
+  std::optional<double> cost_gap() const;
+
   /// Get the start conditions that were given for this planning task.
   const std::vector<Start>& get_starts() const;
 
@@ -762,6 +1462,73 @@ public:
   /// do prevent the optimal solution from being available.
   std::vector<schedule::ParticipantId> blockers() const;
 
+  /// Statistics about the work that went into the search of a Result. They
+  /// are always collected, because they only cost a few counters and clock
+  /// readings per expansion. Their purpose is to explain what made a search
+  /// slow, e.g. a dense schedule shows up as validator time, and a cold
+  /// heuristic shows up as heuristic misses.
+  struct Statistics
+  {
+    /// How many search nodes were generated
+    std::size_t nodes_generated = 0;
+
+    /// How many search nodes were taken from the queue to be expanded
+    std::size_t nodes_expanded = 0;
+
+    /// How many times the search tried to hold in place
+    std::size_t hold_expansions = 0;
+
+    /// How many search nodes were not expanded, or not added to the queue,
+    /// because a node at about the same place and time had already been
+    /// expanded for no more cost
+    std::size_t nodes_pruned = 0;
+
+    /// How many times the route validator was used
+    std::size_t validator_calls = 0;
+
+    /// The total time spent inside of the route validator
+    Duration validator_time = Duration(0);
+
+    /// How many heuristic lookups were answered by the heuristic cache
+    std::size_t heuristic_hits = 0;
+
+    /// How many heuristic lookups needed a new heuristic to be computed
+    std::size_t heuristic_misses = 0;
+
+    /// The total time spent computing heuristics for the misses
+    Duration heuristic_time = Duration(0);
+
+    /// The total time spent constructing the trajectories of search nodes
+    Duration trajectory_time = Duration(0);
+
+    /// The largest that the search queue has been
+    std::size_t peak_queue_size = 0;
+
+    /// An estimate of the most bytes that the nodes and queue of the search
+    /// have used. The routes of the nodes are not included.
+    std::size_t peak_memory = 0;
+
+    /// The total time spent searching, including any earlier calls to
+    /// resume()
+    Duration search_time = Duration(0);
+
+    /// How long the search ran before it produced its first feasible plan.
+    /// This will be nullopt if no plan has been found yet.
+    std::optional<Duration> time_to_first_feasible;
+
+    /// The fraction of heuristic lookups that were answered by the cache, or
+    /// nullopt if there were no lookups
+    std::optional<double> heuristic_hit_rate() const;
+
+    /// Add the statistics of a search that ran after this one
+    Statistics& operator+=(const Statistics& other);
+  };
+
+  /// Get statistics about the search that produced this Result. If this Result
+  /// was answered by the result cache of the Planner, these are the statistics
+  /// of the search that was cached.
+  Statistics statistics() const;
+
   class Implementation;
 private:
   Result();
@@ -922,6 +1689,30 @@ std::vector<Plan::Start> compute_plan_starts(
   const double max_merge_lane_distance = 1.0,
   const double min_lane_length = 1e-8);
 
+/// Produces the same starts as the overload above, but uses a spatial index
+/// of the graph to only look at the waypoints and lanes that are near the
+/// pose. This is much faster for large graphs.
+///
+/// \param[in] graph
+///   Graph which the starting waypoints and lanes will be derived from.
+///
+/// \param[in] index
+///   A spatial index that was built from graph.
+///
+/// The rest of the parameters are the same as the overload above.
+///
+/// \warning This will throw a std::invalid_argument if the index does not
+/// have the same number of waypoints and lanes as the graph.
+std::vector<Plan::Start> compute_plan_starts(
+  const rmf_traffic::agv::Graph& graph,
+  const GraphSpatialIndex& index,
+  const std::string& map_name,
+  const Eigen::Vector3d pose,
+  const rmf_traffic::Time start_time,
+  const double max_merge_waypoint_distance = 0.1,
+  const double max_merge_lane_distance = 1.0,
+  const double min_lane_length = 1e-8);
+
 } // namespace agv
 } // namespace rmf_traffic
 
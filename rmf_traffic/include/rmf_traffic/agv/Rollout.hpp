@@ -53,7 +53,9 @@ public:
   /// \param[in] options
   ///   The options to use while expanding. NOTE: It is important to provide a
   ///   RouteValidator that will ignore the blocker, otherwise the expansion
-  ///   might not give back any useful results.
+  ///   might not give back any useful results. If the search_threads() of the
+  ///   options is more than 1, then the rollouts through different blockages
+  ///   will be expanded on separate threads.
   ///
   /// \param[in] max_rollouts
   ///   The maximum number of rollouts to produce.
@@ -92,6 +94,14 @@ public:
     rmf_traffic::Duration span,
     rmf_utils::optional<std::size_t> max_rollouts = rmf_utils::nullopt) const;
 
+  /// Set a limit on how long each call to expand() may spend rolling out.
+  /// When the limit is reached, the rollouts that have been finished so far
+  /// will be returned. Use std::nullopt for no limit, which is the default.
+  Rollout& time_budget(std::optional<Duration> budget);
+
+  /// Get the limit on how long each call to expand() may spend rolling out.
+  std::optional<Duration> time_budget() const;
+
   class Implementation;
 private:
   rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -18,6 +18,8 @@
 #ifndef RMF_TRAFFIC__AGV__ROUTEVALIDATOR_HPP
 #define RMF_TRAFFIC__AGV__ROUTEVALIDATOR_HPP
 
+#include <rmf_traffic/DetectConflict.hpp>
+#include <rmf_traffic/agv/Graph.hpp>
 #include <rmf_traffic/schedule/Viewer.hpp>
 #include <rmf_traffic/schedule/Negotiation.hpp>
 
@@ -35,6 +37,7 @@ public:
 
   using ParticipantId = schedule::ParticipantId;
   using Route = rmf_traffic::Route;
+  using Interrupter = std::function<bool()>;
 
   struct Conflict
   {
@@ -60,6 +63,96 @@ public:
   virtual std::optional<Conflict> find_conflict(
     const Route& route) const = 0;
 
+  /// Same as find_conflict(route), except the given options should be used to
+  /// detect conflicts instead of whatever options the validator would normally
+  /// use. The default implementation ignores the options and calls
+  /// find_conflict(route).
+  ///
+  /// \param[in] route
+  ///   The route that is being checked.
+  ///
+  /// \param[in] options
+  ///   The options to use for conflict detection.
+  virtual std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options& options) const;
+
+  /// Find the first conflict of a set of routes, checking the routes in order.
+  /// The result is the same as calling find_conflict(route) on each route, but
+  /// a validator may override this to check all of the routes with a single
+  /// query of its schedule. The default implementation calls
+  /// find_conflict(route) on each route.
+  ///
+  /// \param[in] routes
+  ///   The routes that are being checked.
+  virtual std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes) const;
+
+  /// Same as find_conflicts(routes), except the given options should be used
+  /// to detect conflicts. The default implementation calls
+  /// find_conflict(route, options) on each route.
+  ///
+  /// \param[in] routes
+  ///   The routes that are being checked.
+  ///
+  /// \param[in] options
+  ///   The options to use for conflict detection.
+  virtual std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options& options) const;
+
+  /// Same as find_conflict(route), except the validator may stop partway
+  /// through the check once the interrupter returns true. The result of a
+  /// check that was stopped early cannot be trusted, so the caller must ask
+  /// the interrupter again after this returns and discard the result if it
+  /// says to stop. The default implementation ignores the interrupter.
+  ///
+  /// \param[in] route
+  ///   The route that is being checked.
+  ///
+  /// \param[in] options
+  ///   The options to use for conflict detection. If this is a nullptr, the
+  ///   validator will use whatever options it would normally use.
+  ///
+  /// \param[in] interrupter
+  ///   Returns true when the check should stop.
+  virtual std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const;
+
+  /// Same as find_conflicts(routes), except the validator may stop partway
+  /// through the checks once the interrupter returns true, like the
+  /// interruptible find_conflict(). The default implementation asks the
+  /// interrupter before each route and calls the interruptible
+  /// find_conflict() on it.
+  virtual std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const;
+
+  /// Identifies what a validator checks routes against. Two validators with
+  /// equal identities are expected to find the same conflicts for any route,
+  /// which lets a planner reuse plans that either of them approved.
+  struct Identity
+  {
+    /// The schedule that routes are checked against
+    const void* schedule;
+
+    /// The version of that schedule
+    schedule::Version version;
+
+    /// The participant whose routes are being checked
+    ParticipantId participant;
+
+    bool operator==(const Identity& other) const;
+  };
+
+  /// Get the identity of this validator. The default implementation returns a
+  /// nullopt, which means the validator could give different answers at any
+  /// time.
+  virtual std::optional<Identity> identity() const;
+
   /// Create a clone of the underlying RouteValidator object.
   virtual std::unique_ptr<RouteValidator> clone() const = 0;
 
@@ -139,11 +232,84 @@ public:
   /// Get the ID of the participant that is being validated.
   schedule::ParticipantId participant() const;
 
+  /// Set the options that will be used to detect conflicts.
+  ScheduleRouteValidator& conflict_options(DetectConflict::Options options);
+
+  /// Get the options that will be used to detect conflicts.
+  const DetectConflict::Options& conflict_options() const;
+
+  /// Let the validator reuse the results of its schedule queries. Each query
+  /// will cover an extra amount of time, given by padding, before and after
+  /// the routes that are being checked. Later checks of routes that fall
+  /// inside that window will filter the results that were already found
+  /// instead of querying the schedule again. This helps when many similar
+  /// routes are checked, like while a plan is being searched for.
+  ///
+  /// The cached results are dropped whenever the schedule version of the
+  /// viewer changes, so viewers that do not report a schedule version never
+  /// reuse their results. Clones of this validator share the cached results.
+  ///
+  /// Pass in a nullopt, which is the default, to query the schedule for every
+  /// check.
+  ScheduleRouteValidator& query_window(std::optional<Duration> padding);
+
+  /// Get the padding of the query window, if there is one.
+  std::optional<Duration> query_window() const;
+
+  /// Let the validator remember the result of checking a route against each
+  /// route of the schedule, so that checking the same pair of routes again
+  /// skips conflict detection entirely. This helps when the same routes are
+  /// validated repeatedly, e.g. while a plan is being reviewed. Routes are
+  /// identified by their trajectories, so a route that gets delayed or
+  /// modified is treated as a new route. Pairs of routes that depend on each
+  /// other are always checked again. Clones of this validator share the
+  /// remembered results.
+  ///
+  /// \param[in] capacity
+  ///   How many results to remember. The default is 0, which turns this off.
+  ScheduleRouteValidator& conflict_memo(std::size_t capacity);
+
+  /// Get how many conflict results the validator may remember.
+  std::size_t conflict_memo() const;
+
   // TODO(MXG): Make profile setters and getters
 
   // Documentation inherited
   std::optional<Conflict> find_conflict(const Route& route) const final;
 
+  // Documentation inherited
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options& options) const final;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes) const final;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options& options) const final;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const final;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const final;
+
+  /// The identity of this validator comes from the schedule viewer, the
+  /// version of the schedule that it shows, and the participant. Validators
+  /// for the same participant are assumed to use the same profile and conflict
+  /// options. If the viewer does not keep track of its schedule version, this
+  /// will return a nullopt.
+  std::optional<Identity> identity() const final;
+
   // Documentation inherited
   std::unique_ptr<RouteValidator> clone() const final;
 
@@ -200,11 +366,67 @@ public:
     /// with bystanders will be caught.
     Generator& ignore_bystanders(bool val = true);
 
+    /// Set the options that the generated validators will use to detect
+    /// conflicts. This will also affect any validators that were already
+    /// generated.
+    Generator& conflict_options(DetectConflict::Options options);
+
+    /// Get the options that the generated validators will use to detect
+    /// conflicts.
+    const DetectConflict::Options& conflict_options() const;
+
+    /// Let the generated validators remember the result of checking a route
+    /// against each route of the negotiation, and share those results with
+    /// each other. This works the same way as
+    /// ScheduleRouteValidator::conflict_memo(). This will also affect any
+    /// validators that were already generated.
+    ///
+    /// \param[in] capacity
+    ///   How many results to remember. The default is 0, which turns this off.
+    Generator& conflict_memo(std::size_t capacity);
+
+    /// Get how many conflict results the generated validators may remember.
+    std::size_t conflict_memo() const;
+
     /// Start with a NegotiatingRouteValidator that will use all the most
     /// preferred alternatives from every participant.
     NegotiatingRouteValidator begin() const;
 
-    /// Get all the Negotiating Route Validators that can be generated.
+    /// Produces the validators of a Generator one at a time, starting with
+    /// the combination of rollout alternatives that is most promising. Each
+    /// alternative is scored by how much later it finishes than the earliest
+    /// finishing alternative of the same participant, and combinations come
+    /// out in order of the total of those delays. Ties are broken by the
+    /// order that the participants offered their alternatives in.
+    ///
+    /// Only the combinations that have been reached so far are kept in memory,
+    /// so a negotiator that stops at the first combination that works never
+    /// pays for the ones after it.
+    class Enumerator
+    {
+    public:
+
+      /// Get the next validator, or a nullopt if every combination of
+      /// alternatives has been produced.
+      std::optional<NegotiatingRouteValidator> next();
+
+      /// Get how many validators have not been produced yet.
+      std::size_t remaining() const;
+
+      class Implementation;
+    private:
+      Enumerator();
+      rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+    };
+
+    /// Enumerate the Negotiating Route Validators that can be generated,
+    /// most promising first. The enumerator is independent of this Generator
+    /// except for the settings that validators share, like conflict_options().
+    Enumerator enumerate() const;
+
+    /// Get all the Negotiating Route Validators that can be generated, in the
+    /// same order that enumerate() produces them. Prefer enumerate() when you
+    /// might not need all of them.
     std::vector<rmf_utils::clone_ptr<NegotiatingRouteValidator>> all() const;
 
     /// Get the set of participants who have specified what their available
@@ -252,6 +474,32 @@ public:
   // Documentation inherited
   rmf_utils::optional<Conflict> find_conflict(const Route& route) const final;
 
+  // Documentation inherited
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options& options) const final;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes) const final;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options& options) const final;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const final;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const final;
+
   // Documentation inherited
   std::unique_ptr<RouteValidator> clone() const final;
 
@@ -261,6 +509,201 @@ private:
   rmf_utils::impl_ptr<Implementation> _pimpl;
 };
 
+//==============================================================================
+/// A RouteValidator for participants that stay on a navigation graph. Instead
+/// of checking the geometry of every route against the route being validated,
+/// it finds which waypoints and lanes of the graph each route occupies and
+/// when, and looks for other participants that occupy nearby parts of the
+/// graph at overlapping times.
+///
+/// This is more conservative than a ScheduleRouteValidator, because a whole
+/// lane is treated as occupied while a participant is anywhere on it. Turn on
+/// geometric_confirmation() to have each conflict that gets found confirmed by
+/// DetectConflict before it gets reported.
+///
+/// Routes that cannot be matched to the graph are checked with DetectConflict
+/// instead, so the validator is safe to use even if some participants leave
+/// the graph.
+class ReservationRouteValidator : public RouteValidator
+{
+public:
+
+  /// The parts of a graph that can conflict with each other. This only depends
+  /// on the graph, so it should be made once and shared by the validators of
+  /// every participant that uses the graph.
+  class Layout
+  {
+  public:
+
+    /// Constructor
+    ///
+    /// \param[in] graph
+    ///   The graph that participants are confined to.
+    ///
+    /// \param[in] clearance
+    ///   Waypoints and lanes that come closer than this distance to each other
+    ///   are remembered as being able to conflict. This should be at least the
+    ///   sum of the two largest profile radii of the participants. Pairs of
+    ///   participants whose radii add up to more than this are checked with
+    ///   DetectConflict instead.
+    ///
+    /// \param[in] tolerance
+    ///   How far a route may stray from a waypoint or lane while still being
+    ///   considered on it.
+    ///
+    /// \param[in] max_threads
+    ///   The maximum number of threads that may be used to find which parts
+    ///   of the graph can conflict, including the calling thread. A value of 0
+    ///   or 1 will do everything on the calling thread. The layout is the same
+    ///   either way.
+    ///
+    /// \param[in] executor
+    ///   The executor whose threads will help make the layout. If this is a
+    ///   nullptr, Executor::shared() will be used.
+    ///
+    /// \warning This will throw a std::invalid_argument if clearance or
+    /// tolerance is not greater than zero.
+    Layout(
+      const Graph& graph,
+      double clearance,
+      double tolerance = 0.05,
+      std::size_t max_threads = 1,
+      std::shared_ptr<Executor> executor = nullptr);
+
+    /// Constructor
+    ///
+    /// The clearance is chosen with clearance_for(profiles, tolerance), so
+    /// every pair of participants with these profiles can be checked by the
+    /// parts of the graph that they occupy, and DetectConflict is never
+    /// needed for them.
+    ///
+    /// \param[in] graph
+    ///   The graph that participants are confined to.
+    ///
+    /// \param[in] profiles
+    ///   The profiles of every participant that will use the graph.
+    ///
+    /// \param[in] tolerance
+    ///   How far a route may stray from a waypoint or lane while still being
+    ///   considered on it.
+    ///
+    /// \param[in] max_threads
+    ///   The maximum number of threads that may be used to make the layout.
+    ///
+    /// \param[in] executor
+    ///   The executor whose threads will help make the layout. If this is a
+    ///   nullptr, Executor::shared() will be used.
+    ///
+    /// \warning This will throw a std::invalid_argument if tolerance is not
+    /// greater than zero.
+    Layout(
+      const Graph& graph,
+      const std::vector<Profile>& profiles,
+      double tolerance = 0.05,
+      std::size_t max_threads = 1,
+      std::shared_ptr<Executor> executor = nullptr);
+
+    /// Get the smallest clearance that lets every pair of these profiles be
+    /// checked by their reservations. This is the sum of the two largest
+    /// profile radii, plus the tolerance. A single profile is counted twice,
+    /// because it may describe several participants.
+    static double clearance_for(
+      const std::vector<Profile>& profiles,
+      double tolerance = 0.05);
+
+    /// Get the clearance that the layout was made with
+    double clearance() const;
+
+    /// Get the tolerance that the layout was made with
+    double tolerance() const;
+
+    /// Get the indices of the waypoints that can conflict with a waypoint,
+    /// in ascending order. This includes the waypoint itself.
+    std::vector<std::size_t> waypoints_near_waypoint(
+      std::size_t waypoint_index) const;
+
+    /// Get the indices of the lanes that can conflict with a lane, in
+    /// ascending order. This includes the lane itself.
+    std::vector<std::size_t> lanes_near_lane(std::size_t lane_index) const;
+
+    class Implementation;
+  private:
+    friend class ReservationRouteValidator;
+    rmf_utils::impl_ptr<Implementation> _pimpl;
+  };
+
+  /// Constructor
+  ///
+  /// \warning You are expected to maintain the lifetime of the schedule
+  /// viewer for as long as this ReservationRouteValidator instance is alive.
+  ///
+  /// \param[in] viewer
+  ///   The schedule viewer which will be used to check for conflicts
+  ///
+  /// \param[in] participant_id
+  ///   The ID of the participant whose routes are being validated. Its routes
+  ///   on the schedule will be ignored while validating.
+  ///
+  /// \param[in] profile
+  ///   The profile of the participant.
+  ///
+  /// \param[in] layout
+  ///   The layout of the graph that the participant is confined to.
+  ReservationRouteValidator(
+    const schedule::Viewer& viewer,
+    schedule::ParticipantId participant_id,
+    Profile profile,
+    std::shared_ptr<const Layout> layout);
+
+  /// Constructor
+  ///
+  /// This version keeps the viewer alive.
+  ReservationRouteValidator(
+    std::shared_ptr<const schedule::Viewer> viewer,
+    schedule::ParticipantId participant_id,
+    Profile profile,
+    std::shared_ptr<const Layout> layout);
+
+  /// Make the ReservationRouteValidator as a clone_ptr
+  template<typename... Args>
+  static rmf_utils::clone_ptr<ReservationRouteValidator> make(Args&& ... args)
+  {
+    return rmf_utils::make_clone<ReservationRouteValidator>(
+      std::forward<Args>(args)...);
+  }
+
+  /// Get the layout that is being used
+  const std::shared_ptr<const Layout>& layout() const;
+
+  /// Set the options that will be used when DetectConflict is needed.
+  ReservationRouteValidator& conflict_options(DetectConflict::Options options);
+
+  /// Get the options that will be used when DetectConflict is needed.
+  const DetectConflict::Options& conflict_options() const;
+
+  /// Confirm each conflict between reservations with DetectConflict before
+  /// reporting it. This is off by default.
+  ReservationRouteValidator& geometric_confirmation(bool choice);
+
+  /// Check whether conflicts between reservations get confirmed.
+  bool geometric_confirmation() const;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflict(const Route& route) const final;
+
+  // Documentation inherited
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options& options) const final;
+
+  // Documentation inherited
+  std::unique_ptr<RouteValidator> clone() const final;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
 } // namespace agv
 } // namespace rmf_traffic
 
@@ -18,6 +18,7 @@
 #ifndef RMF_TRAFFIC__AGV__NEGOTIATOR_HPP
 #define RMF_TRAFFIC__AGV__NEGOTIATOR_HPP
 
+#include <rmf_traffic/agv/PlanExecutor.hpp>
 #include <rmf_traffic/agv/Planner.hpp>
 #include <rmf_traffic/schedule/Participant.hpp>
 #include <rmf_traffic/schedule/Negotiator.hpp>
@@ -114,6 +115,22 @@ public:
     /// Get the minimum amount of time to spend waiting at holding points
     Duration minimum_holding_time() const;
 
+    /// Toggle whether the negotiator should remember the outcome of its
+    /// planning attempts and reuse them when it is asked to plan around the
+    /// same itineraries again, e.g. on sibling tables whose proposals happen to
+    /// match. The rollouts that are used for rejecting a proposal get reused in
+    /// the same way.
+    ///
+    /// The remembered outcomes assume that the traffic schedule outside of the
+    /// negotiation does not change, so this should only be turned on for a
+    /// negotiator that will be used for a single negotiation. By default, this
+    /// is false.
+    Options& reuse_search_results(bool value);
+
+    /// Check whether the negotiator should reuse the outcome of its planning
+    /// attempts.
+    bool reuse_search_results() const;
+
     class Implementation;
   private:
     rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -193,11 +210,139 @@ public:
   // TODO(MXG): Offer a constructor that accepts a Planner instance to benefit
   // from the cached heuristics.
 
+  /// Counts of the work that a negotiator has done while responding to tables.
+  struct Statistics
+  {
+    /// How many tables have been responded to
+    std::size_t responses = 0;
+
+    /// How many times the planner was asked to search for a plan
+    std::size_t planning_attempts = 0;
+
+    /// How many planning attempts were skipped because the outcome of an
+    /// earlier attempt could be reused. See Options::reuse_search_results().
+    std::size_t reused_attempts = 0;
+
+    /// How many times alternatives were rolled out for a rejection
+    std::size_t rollouts = 0;
+
+    /// How many search nodes the planner expanded
+    std::size_t expansions = 0;
+
+    /// How many times a route validator was asked to check for conflicts
+    std::size_t validator_checks = 0;
+
+    /// How many responses were given with a plan that was shared by other
+    /// tables of a batch. See respond_batch().
+    std::size_t batched_responses = 0;
+
+    /// How many responses were abandoned without responding because they were
+    /// cancelled or their tables became defunct. See respond_async().
+    std::size_t cancelled_responses = 0;
+
+    /// How much time was spent responding
+    Duration time = Duration(0);
+
+    /// Add the counts of another set of statistics to these
+    Statistics& operator+=(const Statistics& other);
+  };
+
   // Documentation inherited
   void respond(
     const schedule::Negotiation::Table::ViewerPtr& table_viewer,
     const ResponderPtr& responder) final;
 
+  /// Same as respond(), but also get statistics about the work that was done
+  /// for this response.
+  Statistics respond_with_statistics(
+    const schedule::Negotiation::Table::ViewerPtr& table_viewer,
+    const ResponderPtr& responder);
+
+  /// Respond to a batch of tables with one shared planning attempt. The plan
+  /// is searched against only the constraints that would block every table of
+  /// the batch, so it is at least as good as the best plan that any of the
+  /// tables could get. It is then submitted to each table that it is valid
+  /// for. The remaining tables get an ordinary response.
+  void respond_batch(const std::vector<Pending>& pending) final;
+
+  /// Same as respond_batch(), but also get statistics about the work that was
+  /// done for the whole batch.
+  Statistics respond_batch_with_statistics(const std::vector<Pending>& pending);
+
+  /// A handle on a response that is being worked on by a PlanExecutor. Copies
+  /// of a PendingResponse refer to the same job.
+  class PendingResponse
+  {
+  public:
+
+    /// Check whether the job has finished, whether or not it gave a response.
+    bool ready() const;
+
+    /// Wait until the job has finished or the timeout has passed.
+    ///
+    /// \return true if the job has finished.
+    bool wait_for(Duration timeout) const;
+
+    /// Wait until the job has finished and get statistics about the work that
+    /// it did. If the job threw an exception, that exception will be rethrown
+    /// here.
+    const Statistics& get() const;
+
+    /// Ask the job to stop. If it has not responded yet, it will stop planning
+    /// as soon as it can and it will not respond.
+    void cancel();
+
+    /// Check whether cancel() has been called.
+    bool cancelled() const;
+
+    class Implementation;
+  private:
+    PendingResponse();
+    rmf_utils::impl_ptr<Implementation> _pimpl;
+  };
+
+  /// Callback for when a background response has finished. Calling get() on
+  /// the response gives its statistics, or rethrows the exception that stopped
+  /// the job.
+  using FinishedCallback = std::function<void(const PendingResponse&)>;
+
+  /// Respond to a table in the background, without blocking the caller. The
+  /// planning is done by a worker of the executor, and the response is given
+  /// to the responder from the thread of that worker.
+  ///
+  /// The job stops without responding if it is cancelled or if the table
+  /// becomes defunct, so no time is spent planning for tables that no longer
+  /// matter. Statistics::cancelled_responses will say when this happened.
+  ///
+  /// The job works on a copy of this negotiator. The copy shares the search
+  /// results and statistics of this negotiator, so this negotiator may be
+  /// destroyed before the job is finished.
+  ///
+  /// \param[in] table_viewer
+  ///   The table to respond to
+  ///
+  /// \param[in] responder
+  ///   The Responder to use when a response is ready
+  ///
+  /// \param[in] on_finished
+  ///   This will be called from the worker thread once the job has finished,
+  ///   whether or not it responded. It can be used to resume whatever is
+  ///   waiting for the response, such as a coroutine or a promise. It is also
+  ///   called if the job throws an exception, in which case get() on the
+  ///   response will rethrow it.
+  ///
+  /// \param[in] executor
+  ///   The executor that should do the work. If this is a nullptr, then
+  ///   PlanExecutor::shared() will be used.
+  PendingResponse respond_async(
+    const schedule::Negotiation::Table::ViewerPtr& table_viewer,
+    const ResponderPtr& responder,
+    FinishedCallback on_finished = nullptr,
+    std::shared_ptr<PlanExecutor> executor = nullptr) const;
+
+  /// Get statistics about all of the responses that this negotiator has given
+  Statistics statistics() const;
+
   class Implementation;
   class Debug;
 private:
@@ -98,6 +98,17 @@ public:
   /// Set the minimum angle that will trigger a conflict.
   Moderator& minimum_conflict_angle(double new_value);
 
+  /// Set how many threads may compare a new path against the paths of the
+  /// other participants. The comparisons with each peer will be split up
+  /// between a pool of threads that is owned by this Moderator. The calling
+  /// thread counts as one of the threads, so a value of 1, which is the
+  /// default, means that every comparison happens on the calling thread. A
+  /// value of 0 is treated the same as 1.
+  Moderator& threads(std::size_t value);
+
+  /// Get how many threads may compare paths.
+  std::size_t threads() const;
+
   /// Set the information logger for this Moderator. Pass in a nullptr to
   /// disable any information logging.
   Moderator& info_logger(std::function<void(std::string)> info);
@@ -137,6 +148,64 @@ public:
   /// Return true if the system is experiencing a gridlock
   bool has_gridlock() const;
 
+  /// The participants whose statuses or assigned ranges have changed.
+  struct Changes
+  {
+    /// The changes version that these changes are up to date with. Pass this
+    /// into changes_since() the next time to only get the newer changes.
+    std::size_t version;
+
+    /// The participants whose status or assigned range has changed, including
+    /// participants that are new. Look up their current values in statuses()
+    /// and assignments().
+    std::vector<ParticipantId> changed;
+
+    /// The participants that have been canceled
+    std::vector<ParticipantId> removed;
+  };
+
+  /// Get the current changes version. This increases by at least 1 each time
+  /// the status or the assigned range of any participant changes.
+  std::size_t changes_version() const;
+
+  /// Get which participants have changed since the given changes version. Each
+  /// participant will appear at most once, in the order of its latest change.
+  /// The cost of this is proportional to the number of participants that have
+  /// changed, not to the total number of participants. Pass in 0 to get every
+  /// participant that has ever been seen.
+  Changes changes_since(std::size_t version) const;
+
+  /// While a Batch is alive, the moderator will record every Writer call that
+  /// it receives, but it will not recompute its constraints or assignments
+  /// until the batch is flushed. This can be used to ingest many updates at
+  /// once, e.g. when a fleet adapter reconnects and replays the states of all
+  /// of its robots.
+  ///
+  /// The assignments(), statuses(), and has_gridlock() of the moderator are
+  /// not updated while a batch is open. Batches may be nested, in which case
+  /// the updates will only be applied once the outermost batch is finished.
+  class Batch
+  {
+  public:
+
+    /// Begin a batch of updates for a moderator
+    Batch(Moderator& moderator);
+
+    /// Apply the updates that have been received so far. The batch will
+    /// remain open after this is called.
+    void flush();
+
+    /// Finish the batch. If this is the outermost batch, the updates will be
+    /// applied.
+    ~Batch();
+
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+
+  private:
+    Moderator* _moderator;
+  };
+
   class Implementation;
 private:
   rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__DEBUG__TRACE_HPP
+#define RMF_TRAFFIC__DEBUG__TRACE_HPP
+
+#include <rmf_traffic/Time.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace debug {
+
+//==============================================================================
+/// A span of time that was spent on one kind of work.
+///
+/// The library records spans with these categories:
+/// * planner.expand - expanding one node of a planner search
+/// * planner.plan - running one planner search
+/// * schedule.query - querying a schedule database
+/// * conflict.narrowphase - checking the segments of a pair of trajectories
+///   that made it through the broadphase
+/// * negotiation.respond - responding to a table of a negotiation
+/// * negotiation.submit - submitting a proposal to a table of a negotiation
+struct TraceSpan
+{
+  /// The kind of work that was done. This must point to a string literal.
+  const char* category;
+
+  /// When the work started
+  Time start;
+
+  /// When the work finished
+  Time finish;
+
+  /// A number that identifies the thread that did the work
+  std::size_t thread;
+};
+
+//==============================================================================
+/// The interface for receiving the spans that are traced.
+class TraceSink
+{
+public:
+
+  /// This will be called each time a span finishes while this sink is
+  /// installed. It may be called from many threads at once.
+  virtual void record(const TraceSpan& span) = 0;
+
+  virtual ~TraceSink() = default;
+};
+
+//==============================================================================
+/// Install and inspect the sink that receives traced spans.
+///
+/// The spans inside of the library are only compiled in when the library is
+/// built with the RMF_TRAFFIC_ENABLE_TRACING CMake option. Otherwise they cost
+/// nothing, and only the spans of a ScopedTrace that you make yourself will be
+/// recorded.
+///
+/// While no sink is installed, a span costs a single atomic load.
+///
+/// To leave tracing running in a deployment without measuring every span, set
+/// a sample interval. Only every Nth span that starts on each thread will be
+/// measured, and the rest cost no more than an idle span plus a counter.
+class Trace
+{
+public:
+
+  /// True if the spans inside of the library were compiled in.
+  static bool compiled_in();
+
+  /// Install a sink. Pass in a nullptr to stop tracing. Spans that are already
+  /// in progress may still be sent to the previous sink.
+  static void set_sink(std::shared_ptr<TraceSink> sink);
+
+  /// Get the sink that is installed, if any.
+  static std::shared_ptr<TraceSink> get_sink();
+
+  /// True if a sink is installed.
+  static bool active();
+
+  /// Only measure every Nth span that starts on each thread. An interval of 0
+  /// or 1 will measure every span, which is the default.
+  static void set_sample_interval(std::size_t every);
+
+  /// Get the sample interval that is being used.
+  static std::size_t sample_interval();
+};
+
+//==============================================================================
+/// Measures a span from its construction until its destruction and sends it
+/// to the installed sink. If no sink is installed when it is constructed,
+/// nothing will be measured.
+class ScopedTrace
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] category
+  ///   The kind of work that is being done. This must point to a string
+  ///   literal, because sinks may hold onto it.
+  explicit ScopedTrace(const char* category);
+
+  ScopedTrace(const ScopedTrace&) = delete;
+  ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+  ~ScopedTrace();
+
+private:
+  const char* _category;
+  Time _start;
+};
+
+//==============================================================================
+/// A sink that passes each span to a callback.
+class CallbackTraceSink : public TraceSink
+{
+public:
+
+  using Callback = std::function<void(const TraceSpan& span)>;
+
+  /// Constructor
+  ///
+  /// \param[in] callback
+  ///   The callback that will receive each span. It may be triggered from
+  ///   many threads at once, so it must be thread-safe.
+  CallbackTraceSink(Callback callback);
+
+  // Documentation inherited
+  void record(const TraceSpan& span) final;
+
+private:
+  Callback _callback;
+};
+
+//==============================================================================
+/// A sink that keeps every span so that they can be written out in the Trace
+/// Event format of Chrome, which can be opened in chrome://tracing or Perfetto.
+class ChromeTraceSink : public TraceSink
+{
+public:
+
+  /// Constructor
+  ChromeTraceSink();
+
+  // Documentation inherited
+  void record(const TraceSpan& span) final;
+
+  /// Write the spans that have been recorded as a JSON object.
+  void write(std::ostream& output) const;
+
+  /// Get the number of spans that have been recorded.
+  std::size_t size() const;
+
+  /// Forget the spans that have been recorded.
+  void clear();
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+//==============================================================================
+/// A sink that counts the spans of each category and how long they took. This
+/// is cheap enough to leave running in a deployment.
+class CounterTraceSink : public TraceSink
+{
+public:
+
+  /// The counters of one category of span
+  struct Counter
+  {
+    /// How many spans have finished
+    std::size_t count = 0;
+
+    /// The total time spent in the spans
+    Duration total = Duration(0);
+
+    /// The time taken by the longest span
+    Duration max = Duration(0);
+  };
+
+  using Counters = std::unordered_map<std::string, Counter>;
+
+  /// Constructor
+  CounterTraceSink();
+
+  // Documentation inherited
+  void record(const TraceSpan& span) final;
+
+  /// Get the counters of each category that has been recorded.
+  Counters counters() const;
+
+  /// Set every counter back to zero.
+  void reset();
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace debug
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__DEBUG__TRACE_HPP
@@ -81,6 +81,22 @@ FinalConvexShapePtr make_final_convex(const T& convex)
   return std::make_shared<FinalConvexShape>(convex.finalize_convex());
 }
 
+//==============================================================================
+/// Get a finalized shape that is shared by everyone who interns an equal
+/// shape, for as long as any of them is holding onto it. Profiles that are
+/// made from interned shapes can be compared without looking at the shapes.
+///
+/// Finalized shapes with the same type and parameters always share their
+/// collision geometry, whether or not they are interned.
+ConstFinalConvexShapePtr intern_final_convex(const FinalConvexShape& shape);
+
+//==============================================================================
+template<typename T, typename... Args>
+ConstFinalConvexShapePtr make_interned_final_convex(Args&& ... args)
+{
+  return intern_final_convex(T(std::forward<Args>(args)...).finalize_convex());
+}
+
 } // namespace geometry
 } // namespace rmf_traffic
 
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__SCHEDULE__ASYNCWRITER_HPP
+#define RMF_TRAFFIC__SCHEDULE__ASYNCWRITER_HPP
+
+#include <rmf_traffic/schedule/Writer.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <memory>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// A Writer that passes every change along to another Writer on a background
+/// thread, so the caller does not have to wait for the other Writer to finish.
+/// This is useful when the other Writer sends changes to a remote schedule.
+///
+/// Changes are delivered in the same order that they were given to the
+/// AsyncWriter, so the itinerary versions of each participant arrive in order.
+/// The inner Writer is only ever used by the background thread.
+///
+/// The queue of changes has a limited capacity. When it is full, a caller will
+/// wait until the background thread has delivered enough changes to make room.
+///
+/// register_participant() waits until the registration has been delivered,
+/// because its result is needed by the caller.
+///
+/// If the inner Writer throws an exception while delivering a change, that
+/// change is dropped and counted in the statistics. A schedule will notice the
+/// missing itinerary version and ask for it to be retransmitted, the same as
+/// if the change had been lost by the middleware.
+///
+/// When an AsyncWriter is destroyed, every change that is still in its queue
+/// will be delivered before its thread stops.
+class AsyncWriter : public Writer
+{
+public:
+
+  /// Statistics about the changes that an AsyncWriter has delivered. These can
+  /// be used to tell whether the inner Writer is keeping up with the changes.
+  struct Statistics
+  {
+    /// How many changes have been delivered to the inner Writer
+    std::size_t delivered = 0;
+
+    /// How many changes were dropped because the inner Writer threw an
+    /// exception while they were being delivered
+    std::size_t failed = 0;
+
+    /// The most changes that have been waiting in the queue at the same time
+    std::size_t peak_queued = 0;
+
+    /// How many times a caller had to wait for room in the queue
+    std::size_t blocked = 0;
+
+    /// The total time that callers spent waiting for room in the queue
+    Duration total_blocked_time = Duration(0);
+
+    /// The total time that delivered changes spent waiting in the queue
+    Duration total_queue_delay = Duration(0);
+
+    /// The longest time that any delivered change spent waiting in the queue
+    Duration max_queue_delay = Duration(0);
+  };
+
+  /// Make an AsyncWriter.
+  ///
+  /// \param[in] writer
+  ///   The Writer that changes will be delivered to.
+  ///
+  /// \param[in] capacity
+  ///   The most changes that may wait in the queue at the same time. A value
+  ///   of 0 is treated the same as 1.
+  ///
+  /// \warning This will throw a std::runtime_error if you pass a nullptr
+  /// writer.
+  static std::shared_ptr<AsyncWriter> make(
+    std::shared_ptr<Writer> writer,
+    std::size_t capacity = 1024);
+
+  // Documentation inherited from Writer
+  void set(
+    ParticipantId participant,
+    PlanId plan,
+    const Itinerary& itinerary,
+    StorageId storage_base,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  void extend(
+    ParticipantId participant,
+    const Itinerary& routes,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  void delay(
+    ParticipantId participant,
+    Duration delay,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  void reached(
+    ParticipantId participant,
+    PlanId plan,
+    const std::vector<CheckpointId>& reached_checkpoints,
+    ProgressVersion version) final;
+
+  // Documentation inherited from Writer
+  void clear(
+    ParticipantId participant,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  Registration register_participant(
+    ParticipantDescription participant_info) final;
+
+  // Documentation inherited from Writer
+  void unregister_participant(
+    ParticipantId participant) final;
+
+  // Documentation inherited from Writer
+  void update_description(
+    ParticipantId participant,
+    ParticipantDescription desc) final;
+
+  /// Wait until every change that was given to this AsyncWriter before this
+  /// call has been delivered.
+  ///
+  /// \warning Do not call this from inside of the inner Writer, or it will
+  /// wait forever.
+  void flush();
+
+  /// Get the number of changes that are waiting to be delivered
+  std::size_t queued() const;
+
+  /// Get the capacity of the queue
+  std::size_t capacity() const;
+
+  /// Get the inner Writer that changes are delivered to
+  const std::shared_ptr<Writer>& inner() const;
+
+  /// Get statistics about the changes that have been delivered
+  Statistics statistics() const;
+
+  class Implementation;
+private:
+  AsyncWriter();
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__SCHEDULE__ASYNCWRITER_HPP
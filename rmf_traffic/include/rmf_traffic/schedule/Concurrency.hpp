@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__SCHEDULE__CONCURRENCY_HPP
+#define RMF_TRAFFIC__SCHEDULE__CONCURRENCY_HPP
+
+#include <cstdint>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// Decide whether a Database or Mirror may be used by several threads at once.
+enum class Concurrency : uint16_t
+{
+  /// Only one thread may use the schedule at a time. Users must serialize all
+  /// access to it themselves. This is the default, and it has no overhead.
+  None = 0,
+
+  /// Any number of threads may read from the schedule at the same time, while
+  /// writes get exclusive access. After every write, a new Snapshot gets
+  /// published, so calls to snapshot() never wait for writers to finish.
+  ///
+  /// Anything that the schedule returns by reference or by pointer, such as
+  /// participant_ids(), inconsistencies(), or get_current_progress(), may be
+  /// modified by the next write. Only use those while no writes can happen, or
+  /// use a Snapshot instead.
+  ///
+  /// Dependency callbacks are triggered while a write is in progress, so they
+  /// must not use the schedule that triggered them.
+  SharedReads
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__SCHEDULE__CONCURRENCY_HPP
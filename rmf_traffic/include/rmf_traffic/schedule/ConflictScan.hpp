@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__SCHEDULE__CONFLICTSCAN_HPP
+#define RMF_TRAFFIC__SCHEDULE__CONFLICTSCAN_HPP
+
+#include <rmf_traffic/DetectConflict.hpp>
+#include <rmf_traffic/schedule/Viewer.hpp>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// Find every pair of participants whose routes conflict with each other in a
+/// view of a schedule.
+///
+/// Instead of checking every pair of routes, the routes of each map are swept
+/// in order of their start times, and only pairs that overlap in time and come
+/// close enough in space are passed to DetectConflict. Routes of the same
+/// participant are never checked against each other, and the dependencies
+/// that each route has on the others are respected.
+class ConflictScan
+{
+public:
+
+  /// Options for between_all()
+  struct Options
+  {
+    Options(
+      std::size_t max_threads = 1,
+      DetectConflict::Options detection = DetectConflict::Options());
+
+    /// The maximum number of threads that may be used to check the candidate
+    /// pairs, including the calling thread. A value of 0 or 1 will check
+    /// everything on the calling thread. The other threads are borrowed from
+    /// the executor.
+    std::size_t max_threads;
+
+    /// The options to use when checking each candidate pair
+    DetectConflict::Options detection;
+
+    /// The executor whose threads will help check the candidate pairs. If
+    /// this is a nullptr, Executor::shared() will be used.
+    std::shared_ptr<Executor> executor = nullptr;
+  };
+
+  /// One of the routes that is involved in a conflict
+  struct Party
+  {
+    ParticipantId participant;
+    PlanId plan_id;
+    RouteId route_id;
+    std::shared_ptr<const Route> route;
+  };
+
+  /// A conflict between the routes of two participants
+  struct Conflict
+  {
+    /// The route that starts first, or the route of the participant with the
+    /// lower ID if both routes start at the same time
+    Party a;
+
+    /// The other route
+    Party b;
+
+    /// The earliest conflict between the routes. Within the conflict, a_it
+    /// refers to the trajectory of a and b_it refers to the trajectory of b.
+    /// These iterators remain valid for as long as the routes are alive.
+    DetectConflict::Conflict conflict;
+  };
+
+  /// Find the earliest conflict between each pair of routes in the view.
+  ///
+  /// The result is the same regardless of how many threads are used. The
+  /// conflicts are sorted by the time that their routes start. If checking any
+  /// pair throws an exception, the exception of the earliest pair is rethrown.
+  ///
+  /// \param[in] view
+  ///   The routes to check. Each participant should only appear with one plan.
+  ///
+  /// \param[in] options
+  ///   How to check the pairs and how to distribute the work
+  static std::vector<Conflict> between_all(
+    const Viewer::View& view,
+    const Options& options = Options());
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__SCHEDULE__CONFLICTSCAN_HPP
@@ -18,11 +18,14 @@
 #ifndef RMF_TRAFFIC__SCHEDULE__DATABASE_HPP
 #define RMF_TRAFFIC__SCHEDULE__DATABASE_HPP
 
+#include <rmf_traffic/schedule/Concurrency.hpp>
 #include <rmf_traffic/schedule/Inconsistencies.hpp>
+#include <rmf_traffic/schedule/MemoryUsage.hpp>
 #include <rmf_traffic/schedule/Viewer.hpp>
 #include <rmf_traffic/schedule/Patch.hpp>
 #include <rmf_traffic/schedule/Writer.hpp>
 #include <rmf_traffic/schedule/Snapshot.hpp>
+#include <rmf_traffic/schedule/TimelineOptions.hpp>
 
 #include <rmf_utils/macros.hpp>
 
@@ -74,6 +77,36 @@ public:
     const std::vector<CheckpointId>& reached_checkpoints,
     ProgressVersion version) final;
 
+  /// Indicate that a participant has reached a checkpoint along one route of
+  /// its plan. This works like the other reached(~) function, except that only
+  /// the progress along one route is given. The progress of the participant is
+  /// updated in place and only the dependencies on that route are checked,
+  /// which makes this cheaper for frequent progress reports.
+  ///
+  /// If the checkpoint is not beyond the progress that the database already
+  /// has for the route, nothing changes and no new schedule version is made.
+  ///
+  /// \param[in] participant
+  ///   The ID of the participant whose progress is being set.
+  ///
+  /// \param[in] plan
+  ///   The ID of the plan which progress has been made for.
+  ///
+  /// \param[in] route
+  ///   The ID of the route within the plan
+  ///
+  /// \param[in] checkpoint
+  ///   The checkpoint of the route that has been reached
+  ///
+  /// \param[in] version
+  ///   The version number for this progress.
+  void reached(
+    ParticipantId participant,
+    PlanId plan,
+    RouteId route,
+    CheckpointId checkpoint,
+    ProgressVersion version);
+
   // Documentation inherited from Writer
   void clear(
     ParticipantId participant,
@@ -118,6 +151,9 @@ public:
   // Documentation inherited from Viewer
   Version latest_version() const;
 
+  // Documentation inherited from Viewer
+  std::optional<Version> schedule_version() const final;
+
 
   //============================================================================
   // ItineraryViewer API
@@ -127,6 +163,10 @@ public:
   std::optional<ItineraryView> get_itinerary(
     std::size_t participant_id) const final;
 
+  // Documentation inherited from ItineraryViewer
+  std::shared_ptr<const ItineraryView> get_itinerary_view(
+    ParticipantId participant_id) const final;
+
   // Documentation inherited from ItineraryViewer
   std::optional<PlanId> get_current_plan_id(
     std::size_t participant_id) const final;
@@ -160,6 +200,34 @@ public:
   /// Initialize a Database
   Database();
 
+  /// Initialize a Database whose timeline uses the given options.
+  ///
+  /// \param[in] timeline_options
+  ///   Decide how the routes of the database are indexed by time.
+  ///
+  /// \param[in] concurrency
+  ///   Decide whether the database may be used by several threads at once.
+  Database(
+    const TimelineOptions& timeline_options,
+    Concurrency concurrency = Concurrency::None);
+
+  /// Pin the current version of the database so that it can be read
+  /// consistently while writers keep changing the database. Unlike snapshot(),
+  /// making a pin does not copy anything. The pin reads the live database
+  /// until the next change to the database, and only then does the database
+  /// make one snapshot to be shared by all the pins of that version. Routes
+  /// that get changed, culled, or unregistered after that are kept alive until
+  /// every pin that can see them has been released.
+  ///
+  /// Pins of the same version are shared, so pinning the database many times
+  /// between writes costs the same as pinning it once. When shared reads are
+  /// allowed, this returns the snapshot that was published after the latest
+  /// write.
+  ///
+  /// A pin can be given to a ScheduleRouteValidator to plan against a fixed
+  /// version of the schedule.
+  std::shared_ptr<const Snapshot> pin() const;
+
   /// A description of all inconsistencies currently present in the database.
   /// Inconsistencies are isolated between Participants.
   ///
@@ -209,6 +277,44 @@ public:
     const Query& parameters,
     Version after) const;
 
+  /// Identifies a query that was registered with subscribe()
+  using SubscriptionId = uint64_t;
+
+  /// Register a query whose changes should be tracked as the database is
+  /// written to. Each change to a route is only checked once against each
+  /// distinct query, no matter how many subscriptions share that query, and
+  /// then it is added to the pending changes of the matching subscriptions.
+  /// Use take_patch() to get the pending changes of a subscription.
+  ///
+  /// This is meant for schedule nodes that serve many mirrors. Calling
+  /// changes(~) for each mirror searches the schedule once per mirror, while
+  /// take_patch() only looks at the changes that were relevant to the
+  /// subscription.
+  ///
+  /// \param[in] parameters
+  ///   The parameters describing what types of schedule entries the mirror
+  ///   cares about.
+  ///
+  /// \return the ID of the new subscription
+  SubscriptionId subscribe(Query parameters);
+
+  /// Stop tracking the changes of a subscription. A std::runtime_error will be
+  /// thrown if there is no subscription with this ID.
+  void unsubscribe(SubscriptionId subscription);
+
+  /// Get a Patch of the changes that are relevant to a subscription since the
+  /// last time a patch was taken for it, and start tracking its changes from
+  /// the current version. The first patch of a subscription has every route
+  /// that is relevant to it, the same as changes(parameters, std::nullopt).
+  ///
+  /// If more changes pile up for a subscription than the change log retention
+  /// allows, the subscription stops tracking them and its next patch will be
+  /// found by searching the whole schedule instead.
+  ///
+  /// A std::runtime_error will be thrown if there is no subscription with this
+  /// ID.
+  Patch take_patch(SubscriptionId subscription);
+
   /// Excessive cumulative delays have a risk of overloading the schedule
   /// database by taking up an excessive amount of memory to track the delay
   /// history. Typically this would be a cumulative delay on the scale of
@@ -226,6 +332,41 @@ public:
   std::optional<rmf_traffic::Duration> get_cumulative_delay(
     ParticipantId participant) const;
 
+  /// The database keeps a log of which routes were changed by each of its
+  /// recent versions, so that changes(~) and query(~, after) only need to look
+  /// at the routes that changed after the requested version. This sets how many
+  /// of the most recent versions are kept in that log. Requests for changes
+  /// that are older than that will fall back to searching the whole schedule.
+  /// The default is 1024 versions. A value of 0 turns the log off.
+  void set_change_log_retention(std::size_t versions);
+
+  /// Get how many of the most recent versions are kept in the change log.
+  std::size_t get_change_log_retention() const;
+
+  /// Changes that arrive while an earlier change from the same participant is
+  /// still missing are held until the missing change arrives. This sets how
+  /// far ahead of the missing change a participant's changes may be held. A
+  /// change that is further ahead than this is discarded and reported as an
+  /// inconsistency, so the participant will be asked to send it again. The new
+  /// limit is used the next time a participant falls out of order. The default
+  /// is 256 changes.
+  void set_out_of_order_limit(std::size_t changes);
+
+  /// Get how far ahead of a missing change a participant's changes may be held.
+  std::size_t get_out_of_order_limit() const;
+
+  /// Keep the results of recent queries so that repeated queries of the same
+  /// version of the schedule do not need to search the schedule again. A
+  /// query will also be answered from the results of an earlier query that
+  /// covers it, e.g. a timespan query that is inside the timespan of an
+  /// earlier query. This sets how many results are kept, and snapshots of the
+  /// database will keep the same number. The default is 0, which turns the
+  /// cache off.
+  void set_query_cache_capacity(std::size_t capacity);
+
+  /// Get how many query results are kept.
+  std::size_t get_query_cache_capacity() const;
+
   /// Throw away all itineraries up to the specified time.
   ///
   /// \param[in] time
@@ -237,12 +378,47 @@ public:
   /// this version number will remain the same.
   Version cull(Time time);
 
+  /// Choose whether the memory of culled routes should be released on a
+  /// background thread. Culled routes are always removed from the schedule
+  /// before cull(~) returns. This only moves the work of destroying them, and
+  /// their history of changes, out of the caller's thread. This is off by
+  /// default.
+  void set_background_cull_reclamation(bool on);
+
+  /// Check whether culled routes are released on a background thread.
+  bool get_background_cull_reclamation() const;
+
   /// Set the current time on the database. This should be used immediately
   /// before calling unregister_participant() so that the database can cull the
-  /// existence of the participant at an appropriate time. There's no need to
-  /// call this function for any other purpose.
+  /// existence of the participant at an appropriate time. When a retention
+  /// window has been set, this will also roll the schedule forward by culling
+  /// whatever has fallen out of the window.
   void set_current_time(Time time);
 
+  /// Set how much of the past the database should retain. Whenever
+  /// set_current_time() is called, everything that finishes before the
+  /// current time minus this window will be culled, so the memory used by the
+  /// schedule stays flat without needing to call cull(~) manually.
+  ///
+  /// To avoid issuing a new version for every change of the current time, the
+  /// schedule is only rolled forward once the window has moved by at least the
+  /// bucket duration of the timeline, so routes may be retained for up to one
+  /// bucket duration longer than the window.
+  ///
+  /// \param[in] window
+  ///   How long to retain routes after they finish, or std::nullopt to only
+  ///   cull when cull(~) is called. The default is std::nullopt.
+  void set_retention(std::optional<Duration> window);
+
+  /// Get the retention window of the database.
+  std::optional<Duration> get_retention() const;
+
+  /// Get a report of how many bytes the database is holding for each
+  /// participant and each map. This walks the whole database while holding
+  /// the read lock, so it should be polled occasionally rather than after
+  /// every change.
+  MemoryUsage memory_usage() const;
+
   /// Get the current itinerary version for the specified participant.
   //
   // TODO(MXG): This function needs unit testing
@@ -258,6 +434,115 @@ public:
   /// Get the last Storage ID used by this participant.
   StorageId next_storage_base(ParticipantId participant) const;
 
+  /// The version of the checkpoint format that save() writes and load() reads.
+  static constexpr uint8_t CheckpointFormatVersion = 1;
+
+  /// Save a checkpoint of this database to a file, so that a restarted or
+  /// standby schedule node can pick up where this one left off by calling
+  /// load(). The checkpoint holds the participants, their current routes and
+  /// progress, and the versions of the schedule and of each itinerary.
+  ///
+  /// Changes that are waiting for an inconsistency to be resolved are not
+  /// saved. Their participants will be asked to resend them as usual.
+  ///
+  /// A std::runtime_error will be thrown if the file cannot be written, or if
+  /// a participant profile uses a shape that cannot be saved.
+  void save(const std::string& path) const;
+
+  /// Load a database from a checkpoint that was made by save(). The file is
+  /// memory-mapped while it is read. Mirrors that were in sync with the saved
+  /// database can keep requesting changes after their current version, while
+  /// older mirrors will be given a full update.
+  ///
+  /// A std::runtime_error will be thrown if the file cannot be read or is not
+  /// a valid checkpoint.
+  ///
+  /// \param[in] path
+  ///   The file that the checkpoint was saved to.
+  ///
+  /// \param[in] timeline_options
+  ///   Decide how the routes of the database are indexed by time.
+  ///
+  /// \param[in] concurrency
+  ///   Decide whether the database may be used by several threads at once.
+  static Database load(
+    const std::string& path,
+    const TimelineOptions& timeline_options = TimelineOptions(),
+    Concurrency concurrency = Concurrency::None);
+
+  /// A batch of itinerary changes that can be applied to the Database all at
+  /// once with apply(). The functions of this class take the same arguments as
+  /// the Writer functions of the same name, and they are checked the same way
+  /// when the transaction is applied.
+  class Transaction
+  {
+  public:
+
+    /// Create an empty transaction
+    Transaction();
+
+    /// Add a set(~) change to the transaction
+    Transaction& set(
+      ParticipantId participant,
+      PlanId plan,
+      Itinerary itinerary,
+      StorageId storage_base,
+      ItineraryVersion version);
+
+    /// Add an extend(~) change to the transaction
+    Transaction& extend(
+      ParticipantId participant,
+      Itinerary routes,
+      ItineraryVersion version);
+
+    /// Add a delay(~) change to the transaction
+    Transaction& delay(
+      ParticipantId participant,
+      Duration delay,
+      ItineraryVersion version);
+
+    /// Add a reached(~) change to the transaction
+    Transaction& reached(
+      ParticipantId participant,
+      PlanId plan,
+      std::vector<CheckpointId> reached_checkpoints,
+      ProgressVersion version);
+
+    /// Add a reached(~) change for one route to the transaction
+    Transaction& reached(
+      ParticipantId participant,
+      PlanId plan,
+      RouteId route,
+      CheckpointId checkpoint,
+      ProgressVersion version);
+
+    /// Add a clear(~) change to the transaction
+    Transaction& clear(
+      ParticipantId participant,
+      ItineraryVersion version);
+
+    /// The number of changes in the transaction
+    std::size_t size() const;
+
+    class Implementation;
+  private:
+    friend class Database;
+    rmf_utils::impl_ptr<Implementation> _pimpl;
+  };
+
+  /// Apply every change of a transaction, in the order that they were added.
+  ///
+  /// All of the changes that get accepted share a single new schedule version,
+  /// so mirrors that catch up with the database will receive them together in
+  /// one patch. If the Database allows shared reads, readers will not see any
+  /// of the changes until all of them have been applied. Dependencies that are
+  /// reached or deprecated by the changes are notified together after the
+  /// last change has been applied.
+  ///
+  /// \return The new version of the schedule database. If none of the changes
+  /// were accepted, this version number will remain the same.
+  Version apply(const Transaction& transaction);
+
   class Implementation;
   class Debug;
 private:
@@ -116,6 +116,7 @@ public:
   class Implementation;
 private:
   friend class Database;
+  friend class ShardedDatabase;
   Inconsistencies();
   rmf_utils::unique_impl_ptr<Implementation> _pimpl;
 };
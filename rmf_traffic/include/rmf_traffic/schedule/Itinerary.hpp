@@ -38,6 +38,14 @@ using ItineraryView = std::vector<std::shared_ptr<const Route>>;
 //==============================================================================
 using ProgressVersion = uint64_t;
 
+//==============================================================================
+/// Compute a hash of the content of an itinerary: the map, waypoints,
+/// checkpoints and dependencies of each of its routes, in order. Itineraries
+/// with the same content always have the same hash, so this can be compared
+/// against Participant::itinerary_hash() to find out whether a new itinerary
+/// is any different from the current one before assigning it a plan ID.
+std::size_t hash_itinerary(const Itinerary& itinerary);
+
 } // namespace schedule
 } // namespace rmf_traffic
 
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__SCHEDULE__MEMORYUSAGE_HPP
+#define RMF_TRAFFIC__SCHEDULE__MEMORYUSAGE_HPP
+
+#include <rmf_traffic/schedule/ParticipantDescription.hpp>
+
+#include <string>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// A report of how many bytes a Database or Mirror is holding. The sizes come
+/// from the allocations that the schedule has actually made, so they do not
+/// include overhead of the allocator itself.
+///
+/// A report is made by walking the schedule while holding its read lock, so it
+/// is cheap enough to poll every few seconds, but it should not be requested
+/// from inside of a tight loop.
+struct MemoryUsage
+{
+  /// The bytes that are held on behalf of a single participant
+  struct Participant
+  {
+    /// The current routes of the participant, including their trajectories
+    /// and the timeline handles that keep track of them.
+    std::size_t routes = 0;
+
+    /// The earlier versions of the routes that are kept so that patches can
+    /// be made for mirrors that are behind.
+    std::size_t change_history = 0;
+
+    /// The changes that are being held while the schedule waits for missing
+    /// changes from this participant to arrive.
+    std::size_t inconsistencies = 0;
+
+    /// The sum of all the bytes of this participant
+    std::size_t total() const;
+  };
+
+  /// The bytes that are held by the timeline of a single map
+  struct Map
+  {
+    /// How many timeline buckets exist for this map
+    std::size_t buckets = 0;
+
+    /// The bytes of those buckets. The routes inside of them are counted by
+    /// their participants.
+    std::size_t bytes = 0;
+  };
+
+  /// The bytes of each participant
+  std::unordered_map<ParticipantId, Participant> participants;
+
+  /// The bytes of each map
+  std::unordered_map<std::string, Map> maps;
+
+  /// The bytes that do not belong to any one participant or map, such as the
+  /// log of changes and the bookkeeping of the timeline.
+  std::size_t shared = 0;
+
+  /// The sum of all the bytes in this report
+  std::size_t total() const;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__SCHEDULE__MEMORYUSAGE_HPP
@@ -19,6 +19,7 @@
 #define RMF_TRAFFIC__SCHEDULE__MIRROR_HPP
 
 #include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/PatchCodec.hpp>
 
 namespace rmf_traffic {
 namespace schedule {
@@ -57,9 +58,16 @@ public:
   std::optional<ItineraryView> get_itinerary(
     std::size_t participant_id) const final;
 
+  // Documentation inherited from ItineraryViewer
+  std::shared_ptr<const ItineraryView> get_itinerary_view(
+    ParticipantId participant_id) const final;
+
   // Documentation inherited from Viewer
   std::optional<Version> latest_version() const;
 
+  // Documentation inherited from Viewer
+  std::optional<Version> schedule_version() const final;
+
 
   //============================================================================
   // ItineraryViewer API
@@ -97,6 +105,17 @@ public:
   /// Create a database mirror
   Mirror();
 
+  /// Create a database mirror whose timeline uses the given options.
+  ///
+  /// \param[in] timeline_options
+  ///   Decide how the routes of the mirror are indexed by time.
+  ///
+  /// \param[in] concurrency
+  ///   Decide whether the mirror may be used by several threads at once.
+  Mirror(
+    const TimelineOptions& timeline_options,
+    Concurrency concurrency = Concurrency::None);
+
   /// Update the known participants and their descriptions.
   void update_participants_info(const ParticipantDescriptionsMap& participants);
 
@@ -106,14 +125,70 @@ public:
   /// patch does not match
   bool update(const Patch& patch);
 
+  /// Update this mirror with a sequence of patches, ordered from oldest to
+  /// newest. The changes of the patches are collapsed into the net change for
+  /// each participant before any of them are applied, so a mirror that has
+  /// fallen behind can catch up with an amount of work that depends on how
+  /// much has actually changed, rather than on how many patches it missed.
+  ///
+  /// \return true if every patch is okay. false if the base version of one of
+  /// the patches does not match. The patches before that one will still have
+  /// been applied.
+  bool update(const std::vector<Patch>& patches);
+
+  /// Update this mirror from an encoded patch. The routes are built directly
+  /// from the encoded data instead of being decoded into a Patch first.
+  ///
+  /// \return true if this update is okay. false if the base version of the
+  /// patch does not match
+  bool update(const PatchView& patch);
+
   /// Tell this mirror that the upstream database is reseting its version
   /// number. The next patch that this mirror receives will need to provide a
   /// full update.
   void reset();
 
+  /// Only keep the routes that are on the given maps. Patches will still be
+  /// applied in full so that the versions are tracked correctly, but routes on
+  /// other maps are dropped as soon as they arrive. They will not appear in
+  /// queries, itineraries, snapshots, or forks of this mirror.
+  ///
+  /// Routes that this mirror is currently holding for other maps are dropped
+  /// right away. If any of the maps were not being kept before, this mirror
+  /// will be reset (see reset()), since it never held the routes of those
+  /// maps.
+  void subscribe_to_maps(std::unordered_set<std::string> maps);
+
+  /// Keep the routes of every map. This is the default. If this mirror was only
+  /// keeping some maps, it will be reset (see reset()).
+  void subscribe_to_all_maps();
+
+  /// Get the maps that this mirror keeps routes for. A nullopt means that it
+  /// keeps the routes of every map.
+  std::optional<std::unordered_set<std::string>> subscribed_maps() const;
+
+  /// Keep the results of recent queries so that repeated queries of the same
+  /// version of the mirror do not need to search it again. This works the
+  /// same way as Database::set_query_cache_capacity(). The default is 0, which
+  /// turns the cache off.
+  void set_query_cache_capacity(std::size_t capacity);
+
+  /// Get how many query results are kept.
+  std::size_t get_query_cache_capacity() const;
+
+  /// Get a report of how many bytes the mirror is holding for each
+  /// participant and each map. This works the same way as
+  /// Database::memory_usage(). A mirror does not keep a history of changes or
+  /// hold back out of order changes, so those are always zero.
+  MemoryUsage memory_usage() const;
+
   /// Fork a new database off of this Mirror. The state of the new database
   /// will match the last state of the upstream database that this Mirror knows
   /// about.
+  ///
+  /// This copies every itinerary of the mirror. To view hypothetical changes
+  /// without a copy, e.g. to evaluate candidate plans, layer an Overlay over
+  /// snapshot() instead.
   Database fork() const;
 
   // TODO(MXG): Consider a feature to log and report any possible
@@ -21,6 +21,7 @@
 #include <rmf_traffic/schedule/Viewer.hpp>
 #include <rmf_utils/impl_ptr.hpp>
 
+#include <optional>
 #include <unordered_map>
 
 namespace rmf_traffic {
@@ -78,6 +79,40 @@ public:
   /// to be finalized.
   void add_participant(ParticipantId p);
 
+  /// Declare that a participant of this negotiation will only ever propose the
+  /// given itinerary, the way a StubbornNegotiator would. The tables of this
+  /// participant will be resolved by the negotiation itself as soon as they
+  /// are created, so the participant never needs to be asked to respond:
+  /// * If the itinerary does not conflict with the proposal of the table, it
+  ///   will be submitted to the table.
+  /// * Otherwise the parent table will be rejected, with the itinerary as the
+  ///   only rollout. If the participant of the parent table is also stubborn,
+  ///   the parent table will be forfeited instead.
+  ///
+  /// Any tables of the participant that already exist are resolved right away,
+  /// replacing whatever was submitted to them. Conflicts with unresponsive
+  /// participants are ignored, and rebase() will never throw out the
+  /// submissions of a stubborn participant.
+  ///
+  /// \param[in] participant
+  ///   The participant that is being stubborn
+  ///
+  /// \param[in] plan
+  ///   The plan ID to submit with the itinerary
+  ///
+  /// \param[in] itinerary
+  ///   The itinerary that the participant will submit to every table
+  ///
+  /// \throws std::runtime_error if the participant is not part of this
+  /// negotiation.
+  void set_stubborn(
+    ParticipantId participant,
+    PlanId plan,
+    Itinerary itinerary);
+
+  /// Check whether set_stubborn() was used for a participant.
+  bool is_stubborn(ParticipantId participant) const;
+
   /// Returns true if at least one proposal is available that has the consent of
   /// every participant.
   bool ready() const;
@@ -89,6 +124,53 @@ public:
   /// that all proposals have been rejected.
   bool complete() const;
 
+  /// Keep the results of recent queries of the schedule viewer that this
+  /// negotiation was made with, and share them between all the tables of the
+  /// negotiation. Every table asks the schedule about the same participants,
+  /// i.e. the ones that are not part of the negotiation, so the tables of a
+  /// deep negotiation can answer most of their queries from this cache and
+  /// only need to search their own proposals. This sets how many results are
+  /// kept. The default is 0, which turns the cache off.
+  ///
+  /// The cache assumes that the schedule viewer does not change while the
+  /// negotiation is running, e.g. because it is a snapshot of the schedule.
+  void set_base_query_cache_capacity(std::size_t capacity);
+
+  /// Get how many results of schedule queries are kept.
+  std::size_t get_base_query_cache_capacity() const;
+
+  /// Counts of what has happened to the tables of a negotiation. These are
+  /// updated as the negotiation runs, so they cost next to nothing to keep.
+  struct Statistics
+  {
+    /// How many tables have been created
+    std::size_t tables_created = 0;
+
+    /// How many times a table has been rejected
+    std::size_t rejections = 0;
+
+    /// How many times a table has been forfeited
+    std::size_t forfeits = 0;
+
+    /// How many tables have become defunct because a table that they branched
+    /// off of was changed
+    std::size_t defunct_tables = 0;
+
+    /// How many submissions have been thrown out by rebase() because they
+    /// were in conflict with changes to the schedule
+    std::size_t invalidated_tables = 0;
+
+    /// How many itineraries were submitted on behalf of stubborn participants
+    std::size_t stubborn_submissions = 0;
+
+    /// The number of tables that have been created at each depth. The first
+    /// element counts the tables of depth 1, which are the root tables.
+    std::vector<std::size_t> tables_per_depth = {};
+  };
+
+  /// Get statistics about the tables of this negotiation
+  const Statistics& statistics() const;
+
   /// This struct is used to select a child table, demaning a specific version.
   struct VersionedKey
   {
@@ -119,6 +201,22 @@ public:
   };
 
   using Proposal = std::vector<Submission>;
+
+  /// A summary of a submission that is computed once, when the submission
+  /// arrives at its table.
+  struct SubmissionSummary
+  {
+    /// The participant that made the submission
+    ParticipantId participant;
+
+    /// The earliest finish time among the routes of the submitted itinerary,
+    /// or nullopt if none of its routes have a finish time.
+    std::optional<Time> finish_time;
+  };
+
+  /// The summaries of each submission of a proposal, in the same order as the
+  /// Proposal.
+  using ProposalSummary = std::vector<SubmissionSummary>;
   using Alternatives = std::vector<Itinerary>;
 
   class Table;
@@ -228,7 +326,8 @@ public:
       /// Returns true if the table of this viewer is no longer relevant. Unlike
       /// the other fields of the Viewer, this is not a snapshot of the table's
       /// state when the Viewer was created; instead this defunct status will
-      /// remain in sync with the state of the source Table.
+      /// remain in sync with the state of the source Table. It is safe to call
+      /// this from any thread, even while the Negotiation is being changed.
       bool defunct() const;
 
       /// Returns true if the proposal put on this Table has been rejected.
@@ -498,6 +597,14 @@ public:
     virtual std::size_t choose(
       const std::vector<const Proposal*>& proposals) const = 0;
 
+    /// Same as choose(), but with the summaries of each proposal, which were
+    /// computed when their submissions arrived. Evaluators whose ranking only
+    /// needs the summaries should override this to avoid looking through the
+    /// itineraries on every evaluation. By default this calls choose().
+    virtual std::size_t choose_summarized(
+      const std::vector<const Proposal*>& proposals,
+      const std::vector<const ProposalSummary*>& summaries) const;
+
     virtual ~Evaluator() = default;
   };
 
@@ -505,9 +612,48 @@ public:
   ///
   /// \return the negotiation table that was considered the best. Call
   /// Table::proposal() on this return value to see the full proposal. If there
-  /// was no
+  /// was no successfully completed table, this will return a nullptr.
   ConstTablePtr evaluate(const Evaluator& evaluator) const;
 
+  /// Set how many threads may gather the completed tables when evaluate() is
+  /// called. The tables will be split up between a pool of threads that is
+  /// owned by this Negotiation. The calling thread counts as one of the
+  /// threads, so a value of 1, which is the default, means that everything
+  /// happens on the calling thread. A value of 0 is treated the same as 1.
+  ///
+  /// This is only worthwhile for negotiations that have many completed tables.
+  Negotiation& evaluation_threads(std::size_t value);
+
+  /// Get how many threads may gather the completed tables in evaluate().
+  std::size_t evaluation_threads() const;
+
+  /// Move this negotiation onto a newer version of the schedule without
+  /// starting it over. Every submission that is in conflict with the current
+  /// itinerary of one of the changed participants gets thrown out, along with
+  /// all the tables that branched off of it. The rest of the negotiation is
+  /// kept as it is.
+  ///
+  /// The base query cache is cleared, since its results may be out of date.
+  ///
+  /// \param[in] schedule_viewer
+  ///   The viewer for the newer version of the schedule. If this is a nullptr,
+  ///   the negotiation will keep using the viewer that it already has, which
+  ///   is appropriate when that viewer always shows the latest schedule.
+  ///
+  /// \param[in] changed_participants
+  ///   The participants whose itineraries have changed in the schedule since
+  ///   the negotiation started or was last rebased. Participants that are part
+  ///   of the negotiation are ignored.
+  ///
+  /// \return the tables whose submissions were thrown out. Their participants
+  /// should be asked to respond to them again.
+  ///
+  /// \throws std::runtime_error if the new schedule viewer is missing the
+  /// description of a participant in the negotiation.
+  std::vector<TablePtr> rebase(
+    std::shared_ptr<const Viewer> schedule_viewer,
+    const std::vector<ParticipantId>& changed_participants);
+
   class Implementation;
 private:
   Negotiation();
@@ -525,6 +671,12 @@ public:
   std::size_t choose(
     const std::vector<const Negotiation::Proposal*>& proposals) const final;
 
+  // Documentation inherited
+  std::size_t choose_summarized(
+    const std::vector<const Negotiation::Proposal*>& proposals,
+    const std::vector<const Negotiation::ProposalSummary*>& summaries)
+  const final;
+
 };
 
 } // namespace schedule
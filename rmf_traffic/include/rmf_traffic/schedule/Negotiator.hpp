@@ -101,6 +101,23 @@ public:
     const TableViewerPtr& table_viewer,
     const ResponderPtr& responder) = 0;
 
+  /// A table that is waiting for a response, and the Responder that should be
+  /// used for it.
+  struct Pending
+  {
+    TableViewerPtr table_viewer;
+    ResponderPtr responder;
+  };
+
+  /// Have the Negotiator respond to several tables at once. Implementations
+  /// can override this to share work between tables that have most of their
+  /// constraints in common. The default implementation calls respond() for
+  /// each table, in order.
+  ///
+  /// \param[in] pending
+  ///   The tables that need a response
+  virtual void respond_batch(const std::vector<Pending>& pending);
+
   virtual ~Negotiator() = default;
 };
 
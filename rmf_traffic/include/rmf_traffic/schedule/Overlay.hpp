@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__SCHEDULE__OVERLAY_HPP
+#define RMF_TRAFFIC__SCHEDULE__OVERLAY_HPP
+
+#include <rmf_traffic/schedule/Snapshot.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// A view of a schedule with some hypothetical changes layered on top of it.
+/// The overlay pins a snapshot of the schedule as its base, and queries of the
+/// overlay show the hypothetical itineraries in place of the itineraries of
+/// the base for the participants that were changed.
+///
+/// Nothing of the base gets copied. Snapshots already share their timeline
+/// buckets with the schedule that they came from, and an overlay only indexes
+/// the routes of its own changes. Copies of an overlay share their changes
+/// until one of them is modified, so many alternative plans can be evaluated
+/// against one snapshot by making one copy of an overlay for each of them.
+///
+/// An overlay can be used as the base of another overlay.
+class Overlay : public Snapshot
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] base
+  ///   The snapshot to layer the changes over, e.g. from Database::snapshot()
+  ///   or Mirror::snapshot().
+  Overlay(std::shared_ptr<const Snapshot> base);
+
+  /// Replace the itinerary of a participant in this overlay. The routes that
+  /// the participant has in the base will be hidden. Routes with fewer than
+  /// two waypoints are left out, the same as they would be in a schedule.
+  ///
+  /// \param[in] participant
+  ///   The participant whose itinerary is being changed. This must be a
+  ///   participant of the base, or else std::runtime_error will be thrown.
+  ///
+  /// \param[in] plan
+  ///   The plan ID that the routes of the itinerary will have in queries.
+  ///
+  /// \param[in] itinerary
+  ///   The hypothetical itinerary of the participant
+  Overlay& set(ParticipantId participant, PlanId plan, Itinerary itinerary);
+
+  /// Hide every route of a participant. This is the same as setting an empty
+  /// itinerary.
+  Overlay& erase(ParticipantId participant);
+
+  /// Remove the change of a participant, so its itinerary in the base will be
+  /// visible again.
+  Overlay& reset(ParticipantId participant);
+
+  /// Remove every change of this overlay.
+  Overlay& reset();
+
+  /// Get the participants that this overlay has changed.
+  std::vector<ParticipantId> changed_participants() const;
+
+  /// Get the base of this overlay.
+  const std::shared_ptr<const Snapshot>& base() const;
+
+  // Documentation inherited from Viewer
+  View query(const Query& parameters) const final;
+
+  // Documentation inherited from Viewer
+  View query(
+    const Query::Spacetime& spacetime,
+    const Query::Participants& participants) const final;
+
+  // Documentation inherited from Viewer
+  const std::unordered_set<ParticipantId>& participant_ids() const final;
+
+  // Documentation inherited from Viewer
+  std::shared_ptr<const ParticipantDescription> get_participant(
+    ParticipantId participant_id) const final;
+
+  /// The version of the base schedule
+  std::optional<Version> schedule_version() const final;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__SCHEDULE__OVERLAY_HPP
@@ -45,6 +45,14 @@ public:
   ///
   /// \param[in] itinerary
   ///   The new itinerary that the participant should reflect in the schedule.
+  ///   The participant takes ownership of these routes, so pass them with
+  ///   std::move when they are no longer needed. Their trajectories will then
+  ///   be shared with the schedule instead of being copied. Any references
+  ///   into the routes must not be used after this is called.
+  ///
+  /// \return false if plan is older than the current plan ID. If plan is the
+  /// current plan ID, this returns true without sending anything when the
+  /// itinerary is identical to the current one, and false otherwise.
   bool set(PlanId plan, std::vector<Route> itinerary);
 
   /// The cumulative delay that has built up since the last call to
@@ -83,6 +91,57 @@ public:
   [[deprecated("Use cumulative_delay instead")]]
   Duration delay() const;
 
+  /// A policy for sending fewer delay changes to the schedule. A delay that
+  /// arrives too soon after the last delay that was sent, or that is too small,
+  /// is applied to the itinerary of the participant right away, but it is held
+  /// back from the schedule and merged into the next delay that gets sent.
+  ///
+  /// Held delays are sent before reached(~) notifies the schedule of progress,
+  /// and whenever flush_delay() is called. A call to set(~) or clear() drops
+  /// the held delays, because those changes replace the whole itinerary.
+  struct DelayCoalescing
+  {
+    /// The minimum time between two delays being sent to the schedule
+    Duration minimum_interval = Duration(0);
+
+    /// The held delays will only be sent once they add up to at least this
+    /// magnitude
+    Duration minimum_magnitude = Duration(0);
+  };
+
+  /// Set the policy for merging consecutive delays. Use std::nullopt, which is
+  /// the default, to send every delay to the schedule as soon as it happens.
+  /// Any delay that is being held back will be sent if the policy is removed.
+  void delay_coalescing(std::optional<DelayCoalescing> policy);
+
+  /// Get the policy for merging consecutive delays.
+  const std::optional<DelayCoalescing>& delay_coalescing() const;
+
+  /// Send any delay that is being held back by the delay coalescing policy.
+  void flush_delay();
+
+  /// How the participant answers when a schedule asks it to retransmit the
+  /// itinerary changes that the schedule is missing.
+  enum class Retransmission : uint16_t
+  {
+    /// Send every missing change again. This is the default.
+    Replay = 0,
+
+    /// When more than one change would need to be sent again, send a single
+    /// set(~) of the current itinerary with a new version instead, followed
+    /// by the current progress. The schedule always accepts a set(~) because
+    /// it replaces every earlier change, so the missing changes no longer
+    /// matter. This keeps retransmissions small when a participant sends many
+    /// delays, e.g. while many schedules reconnect after a network partition.
+    NetState
+  };
+
+  /// Choose how to answer requests for retransmissions.
+  void retransmission(Retransmission mode);
+
+  /// Get how requests for retransmissions are answered.
+  Retransmission retransmission() const;
+
   /// Notify the schedule that a checkpoint within a plan has been reached
   void reached(PlanId plan, RouteId route, CheckpointId checkpoint);
 
@@ -95,6 +154,11 @@ public:
   /// Get the current itinerary of the participant.
   const Itinerary& itinerary() const;
 
+  /// Get the hash_itinerary() of the current itinerary. This is cached, so it
+  /// is cheap to check whether a newly planned itinerary is any different from
+  /// the current one before assigning it a new plan ID.
+  std::size_t itinerary_hash() const;
+
   /// Get the current itinerary version for this participant.
   //
   // TODO(MXG): This function needs to be unit tested.
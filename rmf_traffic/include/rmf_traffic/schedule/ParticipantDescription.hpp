@@ -80,6 +80,12 @@ public:
   /// Inequality operator
   bool operator!=(const ParticipantDescription& rhs) const;
 
+  /// Get a hash of the contents of this description. Descriptions that are
+  /// equal have the same hash, so comparing hashes is a quick way to tell
+  /// that two descriptions are different. The hash is computed once and kept
+  /// until the description is changed.
+  std::size_t hash() const;
+
   /// Set the name of the participant.
   ParticipantDescription& name(std::string value);
 
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__SCHEDULE__PATCHCODEC_HPP
+#define RMF_TRAFFIC__SCHEDULE__PATCHCODEC_HPP
+
+#include <rmf_traffic/schedule/Patch.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// Encode a Patch into a compact binary format that can be sent to mirrors.
+///
+/// Times are delta-encoded against the previous waypoint, integers are stored
+/// as variable-length integers, and the map names of all routes are stored
+/// once in a table that the routes refer to. Positions and velocities can
+/// optionally be quantized to a fixed resolution, which usually makes them
+/// much smaller.
+///
+/// Use PatchView to decode the data.
+class PatchEncoder
+{
+public:
+
+  /// The resolutions to use when quantizing the positions and velocities of
+  /// waypoints.
+  struct Quantization
+  {
+    /// The resolution for translational values, in meters (or meters per
+    /// second for velocities).
+    double translation = 1e-3;
+
+    /// The resolution for rotational values, in radians (or radians per second
+    /// for velocities).
+    double rotation = 1e-3;
+  };
+
+  /// Default constructor. Positions and velocities will be stored with full
+  /// precision.
+  PatchEncoder();
+
+  /// Set the quantization to use. A nullopt means that positions and
+  /// velocities will be stored with full precision. The resolutions must be
+  /// positive, or else std::invalid_argument will be thrown.
+  PatchEncoder& quantization(std::optional<Quantization> value);
+
+  /// Get the quantization that will be used.
+  std::optional<Quantization> quantization() const;
+
+  /// Encode a patch.
+  std::vector<uint8_t> encode(const Patch& patch) const;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+//==============================================================================
+/// A view over a patch that was encoded by PatchEncoder. The view does not copy
+/// or decode the data up front. Mirror::update() can consume the view directly,
+/// building its routes straight from the encoded data.
+///
+/// The view does not own the data, so the data must outlive the view.
+class PatchView
+{
+public:
+
+  /// The version of the binary format that this library reads and writes.
+  static constexpr uint8_t FormatVersion = 1;
+
+  /// Constructor. The data will be validated, and std::runtime_error will be
+  /// thrown if it is not a complete patch of a supported format version.
+  ///
+  /// \param[in] data
+  ///   The encoded patch.
+  ///
+  /// \param[in] size
+  ///   The number of bytes in the encoded patch.
+  PatchView(const uint8_t* data, std::size_t size);
+
+  /// Constructor. The vector must outlive the view.
+  PatchView(const std::vector<uint8_t>& data);
+
+  /// The number of participants that are changed by this patch.
+  std::size_t size() const;
+
+  /// Get the base version of the Database that this patch builds on.
+  std::optional<Version> base_version() const;
+
+  /// Get the latest version of the Database that informed this patch.
+  Version latest_version() const;
+
+  /// Decode this view into a Patch.
+  Patch decode() const;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__SCHEDULE__PATCHCODEC_HPP
@@ -25,9 +25,12 @@
 
 #include <rmf_traffic/Region.hpp>
 #include <rmf_traffic/Time.hpp>
+#include <rmf_traffic/Trajectory.hpp>
 
 #include <rmf_utils/impl_ptr.hpp>
 
+#include <functional>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 
@@ -65,6 +68,9 @@ public:
 
       /// Request trajectories that are active in a specified timespan.
       Timespan,
+
+      /// Request trajectories that come near a trajectory while it is active.
+      Corridor,
     };
 
     //==========================================================================
@@ -186,6 +192,47 @@ public:
       rmf_utils::impl_ptr<Implementation> _pimpl;
     };
 
+    //==========================================================================
+    /// A class for specifying a corridor that is swept out by a trajectory.
+    /// Using Corridor mode will query for Trajectories on the same map that
+    /// may come within the radius of the corridor trajectory at the same time
+    /// as it. Their own footprints and vicinities are accounted for.
+    ///
+    /// This is meant to give route validators a small set of candidates to
+    /// check for conflicts. The motion of each segment of a trajectory is
+    /// represented by a bounding box, so some of the Trajectories that are
+    /// returned might not really come within the radius, but none that do
+    /// will be left out.
+    class Corridor
+    {
+    public:
+
+      /// Get the map of the corridor.
+      const std::string& map() const;
+
+      /// Set the map of the corridor.
+      Corridor& map(std::string map_name);
+
+      /// Get the trajectory that sweeps out the corridor.
+      const Trajectory& trajectory() const;
+
+      /// Set the trajectory that sweeps out the corridor. If the trajectory is
+      /// empty, nothing will be found.
+      Corridor& trajectory(Trajectory value);
+
+      /// Get how far the corridor reaches out from its trajectory.
+      double radius() const;
+
+      /// Set how far the corridor reaches out from its trajectory. Negative
+      /// values are treated as 0.
+      Corridor& radius(double value);
+
+      class Implementation;
+    private:
+      Corridor();
+      rmf_utils::impl_ptr<Implementation> _pimpl;
+    };
+
     /// Default constructor, uses All mode.
     Spacetime();
 
@@ -279,6 +326,28 @@ public:
     /// const-qualified timespan()
     const Timespan* timespan() const;
 
+    /// Switch to corridor mode.
+    ///
+    /// \param[in] map
+    ///   The map of the corridor
+    ///
+    /// \param[in] trajectory
+    ///   The trajectory that sweeps out the corridor
+    ///
+    /// \param[in] radius
+    ///   How far the corridor reaches out from the trajectory
+    Corridor& query_corridor(
+      std::string map,
+      Trajectory trajectory,
+      double radius);
+
+    /// Get the Corridor of Spacetime to use for this Query. If this Spacetime
+    /// is not in Corridor mode, then this will return a nullptr.
+    Corridor* corridor();
+
+    /// const-qualified corridor()
+    const Corridor* corridor() const;
+
     class Implementation;
   private:
     rmf_utils::impl_ptr<Implementation> _pimpl;
@@ -429,6 +498,21 @@ public:
   /// const-qualified participants()
   const Participants& participants() const;
 
+  /// Get a hash of this Query. Queries that are equal will have the same
+  /// hash. Call canonicalize() first so that queries which only differ in how
+  /// they were written will also be equal.
+  std::size_t hash() const;
+
+  /// Rewrite this Query into a canonical form that finds the same routes:
+  /// * Regions with the same map and time bounds are merged into one region,
+  ///   and repeated spaces are removed. The regions are sorted by map and
+  ///   then by time bounds, while spaces stay in the order they were added.
+  /// * A Timespan that covers all maps forgets its list of maps.
+  ///
+  /// The participant IDs of a query are always kept sorted and unique, so
+  /// they do not need to be canonicalized.
+  Query& canonicalize();
+
   class Implementation;
 private:
   /// \internal The default constructor is private because users are expected
@@ -437,6 +521,50 @@ private:
   rmf_utils::impl_ptr<Implementation> _pimpl;
 };
 
+//==============================================================================
+/// A Query that can no longer be changed, so it can be shared by many owners
+/// and threads without copying it. The query is canonicalized and hashed once
+/// when the SharedQuery is made, which makes it cheap to use as a key when
+/// collapsing equivalent queries, e.g. the subscriptions of a schedule server.
+///
+/// Copies of a SharedQuery refer to the same Query.
+class SharedQuery
+{
+public:
+
+  /// Canonicalize a query and share it.
+  SharedQuery(Query query);
+
+  /// Get the query.
+  const Query& get() const;
+
+  /// Get the query.
+  const Query& operator*() const;
+
+  /// Get the query.
+  const Query* operator->() const;
+
+  /// Get the hash of the query.
+  std::size_t hash() const;
+
+  class Implementation;
+private:
+  std::shared_ptr<const Implementation> _pimpl;
+};
+
+//==============================================================================
+/// Equality operator for SharedQuery objects. Copies of the same SharedQuery
+/// are compared in constant time, as are queries with different hashes.
+bool operator==(
+  const SharedQuery& lhs,
+  const SharedQuery& rhs);
+
+//==============================================================================
+/// Non-equality operator for SharedQuery objects.
+bool operator!=(
+  const SharedQuery& lhs,
+  const SharedQuery& rhs);
+
 //==============================================================================
 /// Query for all entries in a schedule database
 Query query_all();
@@ -508,4 +636,28 @@ extern template class bidirectional_iterator<
 } // namespace detail
 } // namespace rmf_traffic
 
+namespace std {
+
+//==============================================================================
+template<>
+struct hash<rmf_traffic::schedule::Query>
+{
+  std::size_t operator()(const rmf_traffic::schedule::Query& query) const
+  {
+    return query.hash();
+  }
+};
+
+//==============================================================================
+template<>
+struct hash<rmf_traffic::schedule::SharedQuery>
+{
+  std::size_t operator()(const rmf_traffic::schedule::SharedQuery& query) const
+  {
+    return query.hash();
+  }
+};
+
+} // namespace std
+
 #endif // RMF_TRAFFIC__SCHEDULE__QUERY_HPP
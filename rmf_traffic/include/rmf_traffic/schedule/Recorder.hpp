@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__SCHEDULE__RECORDER_HPP
+#define RMF_TRAFFIC__SCHEDULE__RECORDER_HPP
+
+#include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Mirror.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// A Writer that passes every change along to a Database and records it in a
+/// compact binary log, along with the queries, changes and culls that are
+/// requested through the recorder, and the time at which each call was made.
+/// Use Replay to run the log against another Database later, for example to
+/// reproduce the workload of a schedule node offline.
+///
+/// A call is recorded even if the Database throws an exception for it, so the
+/// replay will see the same rejected calls. The only exception is
+/// register_participant(), which is only recorded if it succeeds.
+///
+/// The participant IDs in the log are the ones that the recorded Database gave
+/// out, and Replay translates them to the IDs that its own Database gives out.
+/// If the recorded Database was not empty when the recorder was made, save()
+/// a checkpoint of it at that moment and load() the checkpoint before
+/// replaying, or the replay will reject changes for the participants that it
+/// does not know about.
+///
+/// Calls through the recorder are passed to the Database one at a time, so
+/// the log always has the same order as the changes that the Database saw.
+class Recorder : public Writer
+{
+public:
+
+  /// The kinds of calls that can be recorded
+  enum class Operation : uint8_t
+  {
+    Set = 0,
+    Extend,
+    Delay,
+    Reached,
+    Clear,
+    RegisterParticipant,
+    UnregisterParticipant,
+    UpdateDescription,
+    Changes,
+    Query,
+    Cull,
+    SetCurrentTime
+  };
+
+  /// The number of values in Operation
+  static constexpr std::size_t NumOperations = 12;
+
+  /// The version of the binary format that this library reads and writes.
+  static constexpr uint8_t FormatVersion = 1;
+
+  /// Constructor
+  ///
+  /// \param[in] database
+  ///   The Database that calls will be passed to.
+  ///
+  /// \warning This will throw a std::runtime_error if you pass a nullptr
+  /// database.
+  Recorder(std::shared_ptr<Database> database);
+
+  // Documentation inherited from Writer
+  void set(
+    ParticipantId participant,
+    PlanId plan,
+    const Itinerary& itinerary,
+    StorageId storage_base,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  void extend(
+    ParticipantId participant,
+    const Itinerary& routes,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  void delay(
+    ParticipantId participant,
+    Duration delay,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  void reached(
+    ParticipantId participant,
+    PlanId plan,
+    const std::vector<CheckpointId>& reached_checkpoints,
+    ProgressVersion version) final;
+
+  // Documentation inherited from Writer
+  void clear(
+    ParticipantId participant,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  Registration register_participant(
+    ParticipantDescription participant_info) final;
+
+  // Documentation inherited from Writer
+  void unregister_participant(
+    ParticipantId participant) final;
+
+  // Documentation inherited from Writer
+  void update_description(
+    ParticipantId participant,
+    ParticipantDescription desc) final;
+
+  /// Record a call to Database::changes(~) and pass it to the Database.
+  Patch changes(
+    const Query& parameters,
+    std::optional<Version> after);
+
+  /// Record a call to Database::query(~) and pass it to the Database.
+  Viewer::View query(const Query& parameters);
+
+  /// Record a call to Database::cull(~) and pass it to the Database.
+  Version cull(Time time);
+
+  /// Record a call to Database::set_current_time(~) and pass it to the
+  /// Database.
+  void set_current_time(Time time);
+
+  /// Get the Database that calls are passed to
+  const std::shared_ptr<Database>& database() const;
+
+  /// Get the number of calls that have been recorded so far
+  std::size_t size() const;
+
+  /// Get the number of calls that could not be recorded because they use a
+  /// shape that the log cannot hold. Only circles and boxes can be recorded.
+  /// These calls are still passed to the Database.
+  std::size_t skipped() const;
+
+  /// Take the part of the log that has been recorded since the last time this
+  /// was called. The first part starts with the header of the log, so the
+  /// parts can be appended to a file one after another as they are taken, and
+  /// the whole file can be given to Replay.
+  std::vector<uint8_t> take_log();
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+//==============================================================================
+/// A log that was recorded by a Recorder, decoded so that it can be run
+/// against a Database as many times as needed. Decoding happens up front, so
+/// the time it takes is not included in the statistics of run().
+class Replay
+{
+public:
+
+  using Operation = Recorder::Operation;
+
+  /// How long the calls of one kind of operation took during a replay
+  struct Timing
+  {
+    /// How many calls were made
+    std::size_t count = 0;
+
+    /// How many of the calls threw an exception
+    std::size_t failed = 0;
+
+    /// The total time spent in the calls
+    Duration total = Duration(0);
+
+    /// The longest time spent in any one call
+    Duration max = Duration(0);
+  };
+
+  /// Statistics about one run of a replay
+  struct Statistics
+  {
+    /// The timing of each operation, indexed by Operation
+    std::array<Timing, Recorder::NumOperations> operations;
+
+    /// The timing of updating the mirror with the patches that were produced
+    /// by the Changes calls. The failed count is the number of patches that
+    /// the mirror rejected.
+    Timing mirror_update;
+
+    /// How long the whole run took
+    Duration total = Duration(0);
+
+    /// Get the timing of one kind of operation
+    const Timing& operator[](Operation op) const;
+  };
+
+  /// Constructor. The log will be validated, and std::runtime_error will be
+  /// thrown if it is not a complete log of a supported format version.
+  ///
+  /// \param[in] log
+  ///   The log, or a concatenation of every part that was taken from a
+  ///   Recorder.
+  Replay(const std::vector<uint8_t>& log);
+
+  /// Get the number of calls in the log
+  std::size_t size() const;
+
+  /// Get the time between the start of the recording and the last recorded
+  /// call
+  Duration duration() const;
+
+  /// Run every call of the log against a database.
+  ///
+  /// \param[in] database
+  ///   The Database to make the calls on.
+  ///
+  /// \param[in] mirror
+  ///   If this is not a nullptr, every patch that is produced by a Changes
+  ///   call will be given to this mirror, and its participant information
+  ///   will be kept up to date.
+  ///
+  /// \param[in] paced
+  ///   If true, each call will wait until the same amount of time has passed
+  ///   since the start of the run as had passed since the start of the
+  ///   recording. Otherwise the calls are made as quickly as possible.
+  Statistics run(
+    Database& database,
+    Mirror* mirror = nullptr,
+    bool paced = false) const;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__SCHEDULE__RECORDER_HPP
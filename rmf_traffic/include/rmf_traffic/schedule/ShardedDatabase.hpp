@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__SCHEDULE__SHARDEDDATABASE_HPP
+#define RMF_TRAFFIC__SCHEDULE__SHARDEDDATABASE_HPP
+
+#include <rmf_traffic/schedule/Inconsistencies.hpp>
+#include <rmf_traffic/schedule/Patch.hpp>
+#include <rmf_traffic/schedule/TimelineOptions.hpp>
+#include <rmf_traffic/schedule/Viewer.hpp>
+#include <rmf_traffic/schedule/Writer.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <unordered_set>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// A schedule database that is split into shards by map, so that participants
+/// who are moving on different maps can update the schedule at the same time.
+/// Each shard is a Database with its own lock that indexes the routes of its
+/// group of maps. A change from a participant only locks the shards of the
+/// maps that its old and new routes are on.
+///
+/// Every change is given a version from one sequence that is shared by all the
+/// shards, so the patches of a ShardedDatabase can be applied to a Mirror in
+/// the same way as the patches of a Database.
+///
+/// Every method of this class may be called by several threads at once.
+class ShardedDatabase : public Viewer, public Writer
+{
+public:
+
+  //============================================================================
+  // Writer API
+  //============================================================================
+
+  // Documentation inherited from Writer
+  void set(
+    ParticipantId participant,
+    PlanId plan,
+    const Itinerary& itinerary,
+    StorageId storage_base,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  void extend(
+    ParticipantId participant,
+    const Itinerary& routes,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  void delay(
+    ParticipantId participant,
+    Duration delay,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  void reached(
+    ParticipantId participant,
+    PlanId plan,
+    const std::vector<CheckpointId>& reached_checkpoints,
+    ProgressVersion version) final;
+
+  /// Indicate that a participant has reached a checkpoint along one route of
+  /// its plan. This works the same as the Database function of the same name.
+  void reached(
+    ParticipantId participant,
+    PlanId plan,
+    RouteId route,
+    CheckpointId checkpoint,
+    ProgressVersion version);
+
+  // Documentation inherited from Writer
+  void clear(
+    ParticipantId participant,
+    ItineraryVersion version) final;
+
+  // Documentation inherited from Writer
+  Registration register_participant(
+    ParticipantDescription participant_info) final;
+
+  // Documentation inherited
+  void update_description(
+    ParticipantId participant,
+    ParticipantDescription desc) final;
+
+  // Documentation inherited from Writer
+  void unregister_participant(
+    ParticipantId participant) final;
+
+
+  //============================================================================
+  // Viewer API
+  //============================================================================
+
+  // Documentation inherited from Viewer
+  View query(const Query& parameters) const final;
+
+  // Documentation inherited from Viewer
+  View query(
+    const Query::Spacetime& spacetime,
+    const Query::Participants& participants) const final;
+
+  // Documentation inherited from Viewer
+  const std::unordered_set<ParticipantId>& participant_ids() const final;
+
+  // Documentation inherited from Viewer
+  std::shared_ptr<const ParticipantDescription> get_participant(
+    std::size_t participant_id) const final;
+
+  // Documentation inherited from Viewer
+  std::optional<Version> schedule_version() const final;
+
+
+  //============================================================================
+  // ShardedDatabase API
+  //============================================================================
+
+  /// Initialize a ShardedDatabase
+  ///
+  /// \param[in] map_groups
+  ///   Each group of maps gets its own shard. One more shard is made for the
+  ///   maps that do not belong to any group. A map should not be put in more
+  ///   than one group.
+  ///
+  /// \param[in] timeline_options
+  ///   Decide how the routes of each shard are indexed by time.
+  ShardedDatabase(
+    std::vector<std::unordered_set<std::string>> map_groups,
+    const TimelineOptions& timeline_options = TimelineOptions());
+
+  /// Get the number of shards, including the shard for maps that do not
+  /// belong to any group.
+  std::size_t shard_count() const;
+
+  /// Get the index of the shard that indexes the routes of a map.
+  std::size_t shard_of(const std::string& map) const;
+
+  /// Get the itinerary of a participant, gathered from every shard that it has
+  /// routes in.
+  std::optional<ItineraryView> get_itinerary(
+    std::size_t participant_id) const;
+
+  /// Get a shared view of the itinerary of a participant. This works the same
+  /// as Database::get_itinerary_view().
+  std::shared_ptr<const ItineraryView> get_itinerary_view(
+    std::size_t participant_id) const;
+
+  /// Get the current plan of a participant.
+  std::optional<PlanId> get_current_plan_id(
+    std::size_t participant_id) const;
+
+  /// A description of all inconsistencies currently present in the database.
+  /// This works the same as Database::inconsistencies().
+  const Inconsistencies& inconsistencies() const;
+
+  /// Get the latest version of the schedule, across all shards.
+  Version latest_version() const;
+
+  /// Get the changes in this database that match the given Query parameters.
+  /// This works the same as Database::changes(~).
+  Patch changes(
+    const Query& parameters,
+    std::optional<Version> after) const;
+
+  /// Throw away all itineraries up to the specified time in every shard.
+  ///
+  /// \return The new version of the schedule.
+  Version cull(Time time);
+
+  class Implementation;
+private:
+  rmf_utils::unique_impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__SCHEDULE__SHARDEDDATABASE_HPP
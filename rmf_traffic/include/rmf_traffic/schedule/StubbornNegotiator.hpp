@@ -26,6 +26,9 @@ namespace schedule {
 //==============================================================================
 /// A StubbornNegotiator will only accept plans that accommodate the current
 /// itinerary of the
+///
+/// \sa Negotiation::set_stubborn() resolves the tables of a stubborn
+/// participant inside the negotiation, so no negotiator needs to be asked.
 class StubbornNegotiator : public Negotiator
 {
 public:
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__SCHEDULE__TIMELINEOPTIONS_HPP
+#define RMF_TRAFFIC__SCHEDULE__TIMELINEOPTIONS_HPP
+
+#include <rmf_traffic/Executor.hpp>
+#include <rmf_traffic/Time.hpp>
+
+#include <rmf_utils/impl_ptr.hpp>
+
+#include <memory_resource>
+#include <optional>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// Options for the timeline that a Database or Mirror uses to index its routes
+/// by time. The timeline sorts routes into buckets that each span a range of
+/// time, and queries only look at the buckets that overlap the queried times.
+///
+/// Short buckets make queries over narrow time ranges cheaper, but each route
+/// will be stored in more buckets. Long buckets are cheaper to maintain, but
+/// queries will need to filter through more routes.
+class TimelineOptions
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] bucket_duration
+  ///   The span of time covered by each bucket of the timeline.
+  TimelineOptions(Duration bucket_duration = std::chrono::minutes(1));
+
+  /// Default options for an adaptive timeline. When a bucket holds more than
+  /// split_threshold routes it will be split in half, and when culling leaves
+  /// neighboring buckets with no more than merge_threshold routes between them,
+  /// they will be merged.
+  static TimelineOptions adaptive(
+    Duration bucket_duration = std::chrono::minutes(1),
+    std::size_t split_threshold = 64,
+    std::size_t merge_threshold = 8);
+
+  /// Set the span of time that new buckets will cover. This must be a positive
+  /// duration, or else std::invalid_argument will be thrown.
+  TimelineOptions& bucket_duration(Duration value);
+
+  /// Get the span of time that new buckets will cover.
+  Duration bucket_duration() const;
+
+  /// Set the number of routes that a bucket may hold before it gets split in
+  /// half. Splitting is turned off when this is a nullopt, which is the
+  /// default.
+  TimelineOptions& split_threshold(std::optional<std::size_t> value);
+
+  /// Get the split threshold.
+  std::optional<std::size_t> split_threshold() const;
+
+  /// Set the number of routes that neighboring buckets may hold between them
+  /// and still get merged into one bucket while the timeline is being culled.
+  /// Merging is turned off when this is a nullopt, which is the default.
+  TimelineOptions& merge_threshold(std::optional<std::size_t> value);
+
+  /// Get the merge threshold.
+  std::optional<std::size_t> merge_threshold() const;
+
+  /// Set the shortest span that a bucket may have as a result of being split.
+  /// The default is one second.
+  TimelineOptions& minimum_bucket_duration(Duration value);
+
+  /// Get the minimum bucket duration.
+  Duration minimum_bucket_duration() const;
+
+  /// Set the longest span that a bucket may have as a result of being merged.
+  /// The default is ten minutes.
+  TimelineOptions& maximum_bucket_duration(Duration value);
+
+  /// Get the maximum bucket duration.
+  Duration maximum_bucket_duration() const;
+
+  /// Set how many threads may work on a query whose spacetime is made of
+  /// regions. The regions of a large query will be divided between a pool of
+  /// worker threads that is shared by the timeline and its snapshots, and the
+  /// results will be the same as if only the calling thread had worked on it.
+  /// The calling thread counts as one of the threads, so a value of 1, which is
+  /// the default, means that no worker threads are used. A value of 0 is
+  /// treated the same as 1.
+  TimelineOptions& inspection_threads(std::size_t value);
+
+  /// Get how many threads may work on a query.
+  std::size_t inspection_threads() const;
+
+  /// Set the Executor that the inspection threads of a query will be borrowed
+  /// from. If this is a nullptr, which is the default, the timeline will start
+  /// worker threads of its own.
+  TimelineOptions& executor(std::shared_ptr<Executor> value);
+
+  /// Get the Executor whose threads will be borrowed by queries.
+  const std::shared_ptr<Executor>& executor() const;
+
+  /// Set the memory resource that the buckets of the timeline will be
+  /// allocated from, for example a pool that is local to the NUMA node of the
+  /// threads that use the schedule. Set this to a nullptr, which is the
+  /// default, to use std::pmr::get_default_resource().
+  ///
+  /// Snapshots of the timeline make their own copies of the buckets, and those
+  /// copies always use the default resource, so a snapshot may outlive the
+  /// resource.
+  ///
+  /// \warning The resource must outlive the Database or Mirror that uses these
+  /// options. The timeline only uses the resource while its owner is locked,
+  /// but a resource that is shared with anything else must be thread-safe.
+  TimelineOptions& memory_resource(std::pmr::memory_resource* resource);
+
+  /// Get the memory resource of the timeline.
+  std::pmr::memory_resource* memory_resource() const;
+
+  class Implementation;
+private:
+  rmf_utils::impl_ptr<Implementation> _pimpl;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // RMF_TRAFFIC__SCHEDULE__TIMELINEOPTIONS_HPP
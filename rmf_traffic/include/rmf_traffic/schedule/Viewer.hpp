@@ -23,6 +23,7 @@
 #include <rmf_traffic/schedule/Query.hpp>
 #include <rmf_traffic/schedule/Participant.hpp>
 #include <rmf_traffic/schedule/Itinerary.hpp>
+#include <rmf_traffic/schedule/Version.hpp>
 
 #include <rmf_utils/impl_ptr.hpp>
 #include <rmf_utils/macros.hpp>
@@ -107,6 +108,12 @@ public:
   /// Get the latest version number of this Database.
 //  virtual Version latest_version() const = 0;
 
+  /// Get the version of the schedule that this viewer is showing, if it keeps
+  /// track of one. Queries to the viewer will give the same results for as
+  /// long as this version does not change. The default implementation returns
+  /// a nullopt, which means the results could change at any time.
+  virtual std::optional<Version> schedule_version() const;
+
   // Virtual destructor
   virtual ~Viewer() = default;
 
@@ -134,6 +141,17 @@ public:
   virtual std::optional<ItineraryView> get_itinerary(
     ParticipantId participant_id) const = 0;
 
+  /// Get a shared view of the itinerary of a specific participant. This gives
+  /// the same information as get_itinerary(), but viewers that cache their
+  /// itineraries will keep returning the same view until the itinerary of the
+  /// participant changes, so polling this does not need to allocate. The view
+  /// that gets returned will never be modified.
+  ///
+  /// \return a nullptr in the same cases that get_itinerary() would return a
+  /// nullopt.
+  virtual std::shared_ptr<const ItineraryView> get_itinerary_view(
+    ParticipantId participant_id) const;
+
   /// Get the current plan ID of a specific participant if it is available. If
   /// a participant with the specified ID is not registered with the schedule,
   /// then this will return a nullopt.
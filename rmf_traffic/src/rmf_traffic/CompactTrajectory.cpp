@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/CompactTrajectory.hpp>
+
+#include "schedule/internal_PatchCodec.hpp"
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+namespace rmf_traffic {
+
+namespace {
+//==============================================================================
+using QuantizedVector = std::array<int64_t, 3>;
+
+//==============================================================================
+QuantizedVector quantize(
+  const Eigen::Vector3d& value,
+  const CompactTrajectory::Quantization& q)
+{
+  return {
+    std::llround(value[0] / q.translation),
+    std::llround(value[1] / q.translation),
+    std::llround(value[2] / q.rotation)
+  };
+}
+
+//==============================================================================
+Eigen::Vector3d dequantize(
+  const QuantizedVector& value,
+  const CompactTrajectory::Quantization& q)
+{
+  return {
+    static_cast<double>(value[0]) * q.translation,
+    static_cast<double>(value[1]) * q.translation,
+    static_cast<double>(value[2]) * q.rotation
+  };
+}
+
+} // anonymous namespace
+
+//==============================================================================
+class CompactTrajectory::Implementation
+{
+public:
+
+  Quantization quantization;
+  std::size_t size = 0;
+  std::optional<Time> start_time;
+  std::optional<Time> finish_time;
+
+  /// For each waypoint: the number of time steps since the previous waypoint
+  /// (left out for the first waypoint), then the changes in the quantized
+  /// position and the quantized velocity since the previous waypoint.
+  std::vector<uint8_t> data;
+};
+
+//==============================================================================
+CompactTrajectory::CompactTrajectory(const Trajectory& trajectory)
+: CompactTrajectory(trajectory, Quantization())
+{
+  // Do nothing
+}
+
+//==============================================================================
+CompactTrajectory::CompactTrajectory(
+  const Trajectory& trajectory,
+  Quantization quantization)
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  if (quantization.time <= Duration(0)
+    || !(quantization.translation > 0.0)
+    || !(quantization.rotation > 0.0))
+  {
+    // *INDENT-OFF*
+    throw std::invalid_argument(
+      "[rmf_traffic::CompactTrajectory] The resolutions of the quantization "
+      "must be positive");
+    // *INDENT-ON*
+  }
+
+  _pimpl->quantization = quantization;
+  _pimpl->size = trajectory.size();
+  if (trajectory.empty())
+    return;
+
+  const Time start = *trajectory.start_time();
+  _pimpl->start_time = start;
+
+  using Seconds = std::chrono::duration<double>;
+  const double time_step = Seconds(quantization.time).count();
+
+  schedule::codec::Writer writer;
+  int64_t last_step = 0;
+  QuantizedVector last_position = {0, 0, 0};
+  QuantizedVector last_velocity = {0, 0, 0};
+  for (const auto& wp : trajectory)
+  {
+    int64_t step = 0;
+    if (wp.index() > 0)
+    {
+      // Round the time relative to the start so that errors do not build up
+      // from one waypoint to the next, but never let two waypoints land on
+      // the same step.
+      step = std::llround(Seconds(wp.time() - start).count() / time_step);
+      step = std::max(step, last_step + 1);
+      writer.varint(static_cast<uint64_t>(step - last_step));
+    }
+    last_step = step;
+
+    const QuantizedVector p = quantize(wp.position(), quantization);
+    for (std::size_t i = 0; i < 3; ++i)
+      writer.zigzag(p[i] - last_position[i]);
+    last_position = p;
+
+    const QuantizedVector v = quantize(wp.velocity(), quantization);
+    for (std::size_t i = 0; i < 3; ++i)
+      writer.zigzag(v[i] - last_velocity[i]);
+    last_velocity = v;
+  }
+
+  _pimpl->finish_time = start + last_step * quantization.time;
+  _pimpl->data = std::move(writer.data);
+  _pimpl->data.shrink_to_fit();
+}
+
+//==============================================================================
+Trajectory CompactTrajectory::decode() const
+{
+  Trajectory output;
+  if (_pimpl->size == 0)
+    return output;
+
+  const auto& q = _pimpl->quantization;
+  schedule::codec::Reader reader(
+    _pimpl->data.data(), _pimpl->data.data() + _pimpl->data.size(),
+    "[rmf_traffic::CompactTrajectory::decode]");
+
+  int64_t step = 0;
+  QuantizedVector position = {0, 0, 0};
+  QuantizedVector velocity = {0, 0, 0};
+  for (std::size_t w = 0; w < _pimpl->size; ++w)
+  {
+    if (w > 0)
+      step += static_cast<int64_t>(reader.varint());
+
+    for (std::size_t i = 0; i < 3; ++i)
+      position[i] += reader.zigzag();
+
+    for (std::size_t i = 0; i < 3; ++i)
+      velocity[i] += reader.zigzag();
+
+    output.insert(
+      *_pimpl->start_time + step * q.time,
+      dequantize(position, q),
+      dequantize(velocity, q));
+  }
+
+  return output;
+}
+
+//==============================================================================
+std::size_t CompactTrajectory::size() const
+{
+  return _pimpl->size;
+}
+
+//==============================================================================
+bool CompactTrajectory::empty() const
+{
+  return _pimpl->size == 0;
+}
+
+//==============================================================================
+std::optional<Time> CompactTrajectory::start_time() const
+{
+  return _pimpl->start_time;
+}
+
+//==============================================================================
+std::optional<Time> CompactTrajectory::finish_time() const
+{
+  return _pimpl->finish_time;
+}
+
+//==============================================================================
+auto CompactTrajectory::quantization() const -> const Quantization&
+{
+  return _pimpl->quantization;
+}
+
+//==============================================================================
+const std::vector<uint8_t>& CompactTrajectory::data() const
+{
+  return _pimpl->data;
+}
+
+} // namespace rmf_traffic
@@ -17,9 +17,11 @@
 
 #include "geometry/ShapeInternal.hpp"
 #include "DetectConflictInternal.hpp"
+#include "DetectConflictStats.hpp"
 #include "ProfileInternal.hpp"
 #include "Spline.hpp"
 #include "StaticMotion.hpp"
+#include "debug/internal_Trace.hpp"
 
 #include "DetectConflictInternal.hpp"
 
@@ -33,6 +35,8 @@
 #include <fcl/collision.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
 #include <unordered_map>
 
 namespace rmf_traffic {
@@ -94,19 +98,33 @@ invalid_trajectory_error::invalid_trajectory_error()
 namespace {
 
 //==============================================================================
+/// Steps through the segments of a trajectory, from the segment that finishes
+/// at a starting waypoint to the end of the trajectory. The crawler only reads
+/// the contiguous arrays of the segment cache, so it never needs to walk the
+/// linked list of waypoints.
 class Crawler
 {
 public:
 
+  /// If the trajectory is a slice of an original trajectory, then origin should
+  /// point to the original, and index_offset should be the index of the first
+  /// waypoint of the slice within the original. The conflicts that the crawler
+  /// finds will then refer to the original trajectory.
   Crawler(
     std::size_t index_offset,
+    const Trajectory& trajectory,
     Trajectory::const_iterator current,
-    Trajectory::const_iterator end,
-    const DependsOnCheckpoint* dependencies_on_me)
+    const DependsOnCheckpoint* dependencies_on_me,
+    internal::ConstSegmentCachePtr cache,
+    const Trajectory* origin = nullptr)
   : _index_offset(index_offset),
-    _current(std::move(current)),
-    _end(std::move(end)),
-    _deps(dependencies_on_me)
+    _trajectory(&trajectory),
+    _origin(origin ? origin : &trajectory),
+    _current(
+      current == trajectory.end() ? trajectory.size() : current->index()),
+    _end(trajectory.size()),
+    _deps(dependencies_on_me),
+    _cache(std::move(cache))
   {
     if (_deps && _current != _end)
     {
@@ -119,19 +137,44 @@ public:
     return _current == _end;
   }
 
+  /// The current waypoint within the original trajectory
   Trajectory::const_iterator current() const
   {
-    return _current;
+    return internal::get_iterator(*_origin, index());
+  }
+
+  /// The trajectory that this crawler, or the slice it is crawling, came from
+  const Trajectory& origin() const
+  {
+    return *_origin;
   }
 
   Trajectory::const_iterator end() const
   {
-    return _end;
+    return _trajectory->end();
   }
 
   std::size_t index() const
   {
-    return _current->index() + _index_offset;
+    return _current + _index_offset;
+  }
+
+  /// The time of the current waypoint
+  Time time() const
+  {
+    return _cache->times[_current];
+  }
+
+  const internal::SegmentCache& cache() const
+  {
+    return *_cache;
+  }
+
+  /// The index of the current waypoint within the trajectory that is being
+  /// crawled. Unlike index(), this does not include the offset.
+  std::size_t local_index() const
+  {
+    return _current;
   }
 
   bool ignore(std::size_t other)
@@ -164,16 +207,66 @@ public:
     ++_current;
   }
 
+  /// Once ignore() is true for some index of the other trajectory, it stays
+  /// true for every later index of the other trajectory until this crawler
+  /// moves past the checkpoint of its current dependency. This gives the local
+  /// index of that checkpoint, or the end if the checkpoint is beyond the
+  /// trajectory being crawled.
+  ///
+  /// This must only be used while ignore() is true for some index.
+  std::size_t ignore_window_end() const
+  {
+    assert(_current_dep.has_value() && *_current_dep != _deps->end());
+    return std::min((*_current_dep)->first - _index_offset, _end);
+  }
+
+  /// Jump ahead to the segment that finishes at the waypoint with the given
+  /// local index
+  void skip_to(std::size_t local_index)
+  {
+    assert(_current <= local_index && local_index <= _end);
+    _current = local_index;
+    if (_deps && _current != _end)
+      _current_dep = _deps->lower_bound(index());
+  }
+
   const DependsOnCheckpoint* deps() const
   {
     return _deps;
   }
 
+  /// The bounding box of the segment that finishes at the current waypoint
+  const internal::BoundingBox& bounds() const
+  {
+    return _cache->bounds[_current];
+  }
+
+  /// The spline of the segment that finishes at the current waypoint
+  Spline spline() const
+  {
+    return Spline(_cache->splines[_current]);
+  }
+
+  /// True if the segment that finishes at the current waypoint does not move
+  bool stationary() const
+  {
+    return _cache->stationary[_current];
+  }
+
+  /// The position of the current waypoint
+  const Eigen::Vector3d& position() const
+  {
+    return _cache->positions[_current];
+  }
+
 private:
   std::size_t _index_offset;
-  Trajectory::const_iterator _current;
-  Trajectory::const_iterator _end;
+  const Trajectory* _trajectory;
+  const Trajectory* _origin;
+  std::size_t _current;
+  std::size_t _end;
   const DependsOnCheckpoint* _deps;
+  internal::ConstSegmentCachePtr _cache;
   std::optional<DependsOnCheckpoint::const_iterator> _current_dep;
 };
 
@@ -253,160 +346,143 @@ get_initial_iterators(
 }
 
 //==============================================================================
-struct BoundingBox
-{
-  Eigen::Vector2d min;
-  Eigen::Vector2d max;
-};
+using BoundingBox = internal::BoundingBox;
 
 //==============================================================================
-struct BoundingProfile
+BoundingBox adjust_bounding_box(
+  const BoundingBox& input,
+  const double value)
 {
-  BoundingBox footprint;
-  BoundingBox vicinity;
-};
+  BoundingBox box = input;
+  box.min -= Eigen::Vector2d{value, value};
+  box.max += Eigen::Vector2d{value, value};
 
-//==============================================================================
-double evaluate_spline(
-  const Eigen::Vector4d& coeffs,
-  const double t)
-{
-  // Assume time is parameterized [0,1]
-  return coeffs[3] * t * t * t
-    + coeffs[2] * t * t
-    + coeffs[1] * t
-    + coeffs[0];
+  return box;
 }
 
 //==============================================================================
-std::array<double, 2> get_local_extrema(
-  const Eigen::Vector4d& coeffs)
+bool overlap(
+  const BoundingBox& box_a,
+  const BoundingBox& box_b)
 {
-  std::vector<double> extrema_candidates;
-  // Store boundary values as potential extrema
-  extrema_candidates.emplace_back(evaluate_spline(coeffs, 0));
-  extrema_candidates.emplace_back(evaluate_spline(coeffs, 1));
-
-  // When derivate of spline motion is not quadratic
-  if (std::abs(coeffs[3]) < 1e-12)
-  {
-    if (std::abs(coeffs[2]) > 1e-12)
-    {
-      double t = -coeffs[1] / (2 * coeffs[2]);
-      extrema_candidates.emplace_back(evaluate_spline(coeffs, t));
-    }
-  }
-  else
+  for (int i = 0; i < 2; ++i)
   {
-    // Calculate the discriminant otherwise
-    const double D = (4 * pow(coeffs[2], 2) - 12 * coeffs[3] * coeffs[1]);
-
-    if (std::abs(D) < 1e-4)
-    {
-      const double t = (-2 * coeffs[2]) / (6 * coeffs[3]);
-      const double extrema = evaluate_spline(coeffs, t);
-      extrema_candidates.emplace_back(extrema);
-    }
-    else if (D < 0)
-    {
-      // If D is negative, then the local extrema would be imaginary. This will
-      // happen for splines that have no local extrema. When that happens, the
-      // endpoints of the spline are the only extrema.
-    }
-    else
-    {
-      const double t1 = ((-2 * coeffs[2]) + std::sqrt(D)) / (6 * coeffs[3]);
-      const double t2 = ((-2 * coeffs[2]) - std::sqrt(D)) / (6 * coeffs[3]);
+    if (box_a.max[i] < box_b.min[i])
+      return false;
 
-      extrema_candidates.emplace_back(evaluate_spline(coeffs, t1));
-      extrema_candidates.emplace_back(evaluate_spline(coeffs, t2));
-    }
+    if (box_b.max[i] < box_a.min[i])
+      return false;
   }
 
-  std::array<double, 2> extrema;
-  assert(!extrema_candidates.empty());
-  extrema[0] = *std::min_element(
-    extrema_candidates.begin(),
-    extrema_candidates.end());
-  extrema[1] = *std::max_element(
-    extrema_candidates.begin(),
-    extrema_candidates.end());
-
-  return extrema;
+  return true;
 }
 
 //==============================================================================
-BoundingBox get_bounding_box(const rmf_traffic::Spline& spline)
+/// A pair of shapes that needs to be checked for collisions, where shape a
+/// belongs to the first profile and shape b belongs to the second profile.
+struct ShapePair
 {
-  auto params = spline.get_params();
-  std::array<double, 2> extrema_x = get_local_extrema(params.coeffs[0]);
-  std::array<double, 2> extrema_y = get_local_extrema(params.coeffs[1]);
+  const geometry::FinalConvexShape* a;
+  const geometry::FinalConvexShape* b;
 
-  return BoundingBox{
-    Eigen::Vector2d{extrema_x[0], extrema_y[0]},
-    Eigen::Vector2d{extrema_x[1], extrema_y[1]}
-  };
-}
+  /// The sum of the characteristic lengths of the shapes. The shapes cannot be
+  /// in contact while their centers are farther apart than this.
+  double reach;
 
-//==============================================================================
-/// Create a bounding box which will never overlap with any other BoundingBox
-BoundingBox void_box()
-{
-  constexpr double inf = std::numeric_limits<double>::infinity();
-  return BoundingBox{
-    Eigen::Vector2d{inf, inf},
-    Eigen::Vector2d{-inf, -inf}
-  };
-}
+  /// If both shapes are circles, this is the distance between their centers
+  /// at which they begin to collide. Circle pairs can be checked analytically,
+  /// which is faster and more precise than going through FCL.
+  std::optional<double> circle_contact;
+
+  /// Check whether the bounding boxes of the shape centers are close enough
+  /// together for the shapes to possibly collide.
+  bool might_collide(const BoundingBox& box_a, const BoundingBox& box_b) const
+  {
+    return overlap(box_a, adjust_bounding_box(box_b, reach));
+  }
+};
 
 //==============================================================================
-BoundingBox adjust_bounding_box(
-  const BoundingBox& input,
-  const double value)
+/// The shape pairs that need to be checked to find conflicts between two
+/// profiles. The first pair checks the footprint of A against the vicinity of
+/// B, and the second pair checks the vicinity of A against the footprint of B.
+/// When both profiles are symmetric those checks are the same, so only one pair
+/// is kept. Pairs with a missing shape are left out.
+class CollisionPairs
 {
-  BoundingBox box = input;
-  box.min -= Eigen::Vector2d{value, value};
-  box.max += Eigen::Vector2d{value, value};
+public:
 
-  return box;
-}
+  CollisionPairs(
+    const Profile::Implementation& profile_a,
+    const Profile::Implementation& profile_b)
+  {
+    const auto& plan_a = profile_a.plan;
+    const auto& plan_b = profile_b.plan;
 
-//==============================================================================
-BoundingProfile get_bounding_profile(
-  const rmf_traffic::Spline& spline,
-  const Profile::Implementation& profile)
-{
-  BoundingBox base_box = get_bounding_box(spline);
+    add(
+      profile_a.footprint, plan_a.footprint_radius, plan_a.footprint_circle,
+      plan_b.vicinity, plan_b.vicinity_radius, plan_b.vicinity_circle);
 
-  const auto& footprint = profile.footprint;
-  const auto f_box = footprint ?
-    adjust_bounding_box(base_box, footprint->get_characteristic_length()) :
-    void_box();
+    if (!plan_a.symmetric || !plan_b.symmetric)
+    {
+      add(
+        plan_a.vicinity, plan_a.vicinity_radius, plan_a.vicinity_circle,
+        profile_b.footprint, plan_b.footprint_radius, plan_b.footprint_circle);
+    }
+  }
 
-  const auto& vicinity = profile.vicinity;
-  const auto v_box = vicinity ?
-    adjust_bounding_box(base_box, vicinity->get_characteristic_length()) :
-    void_box();
+  const ShapePair* begin() const
+  {
+    return _pairs.data();
+  }
 
-  return BoundingProfile{f_box, v_box};
-}
+  const ShapePair* end() const
+  {
+    return _pairs.data() + _size;
+  }
 
-//==============================================================================
-bool overlap(
-  const BoundingBox& box_a,
-  const BoundingBox& box_b)
-{
-  for (int i = 0; i < 2; ++i)
+  bool empty() const
   {
-    if (box_a.max[i] < box_b.min[i])
-      return false;
+    return _size == 0;
+  }
 
-    if (box_b.max[i] < box_a.min[i])
-      return false;
+  /// Check whether any pair could collide within these bounding boxes
+  bool might_collide(const BoundingBox& box_a, const BoundingBox& box_b) const
+  {
+    for (const auto& pair : *this)
+    {
+      if (pair.might_collide(box_a, box_b))
+        return true;
+    }
+
+    return false;
   }
 
-  return true;
-}
+private:
+
+  void add(
+    const geometry::ConstFinalConvexShapePtr& shape_a,
+    const double radius_a,
+    const std::optional<double>& circle_a,
+    const geometry::ConstFinalConvexShapePtr& shape_b,
+    const double radius_b,
+    const std::optional<double>& circle_b)
+  {
+    if (!shape_a || !shape_b)
+      return;
+
+    ShapePair& pair = _pairs[_size++];
+    pair.a = shape_a.get();
+    pair.b = shape_b.get();
+    pair.reach = radius_a + radius_b;
+    pair.circle_contact = std::nullopt;
+    if (circle_a && circle_b)
+      pair.circle_contact = *circle_a + *circle_b;
+  }
+
+  std::array<ShapePair, 2> _pairs;
+  std::size_t _size = 0;
+};
 
 //==============================================================================
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
@@ -414,53 +490,76 @@ using FclContinuousCollisionRequest = fcl::ContinuousCollisionRequestd;
 using FclContinuousCollisionResult = fcl::ContinuousCollisionResultd;
 using FclContinuousCollisionObject = fcl::ContinuousCollisionObjectd;
 using FclCollisionGeometry = fcl::CollisionGeometryd;
+using FclMotion = fcl::MotionBased;
 using FclVec3 = fcl::Vector3d;
 #else
 using FclContinuousCollisionRequest = fcl::ContinuousCollisionRequest;
 using FclContinuousCollisionResult = fcl::ContinuousCollisionResult;
 using FclContinuousCollisionObject = fcl::ContinuousCollisionObject;
 using FclCollisionGeometry = fcl::CollisionGeometry;
+using FclMotion = fcl::MotionBase;
 using FclVec3 = fcl::Vec3f;
 #endif
 
 //==============================================================================
-std::shared_ptr<FclSplineMotion> make_uninitialized_fcl_spline_motion()
+FclContinuousCollisionRequest make_fcl_request(
+  const DetectConflict::Options& options)
 {
-  // This function is only necessary because SplineMotion does not provide a
-  // default constructor, and we want to be able to instantiate one before
-  // we have any paramters to provide to it.
-#ifdef RMF_TRAFFIC__USING_FCL_0_6
-  fcl::Matrix3d R;
-#else
-  fcl::Matrix3f R;
-#endif
-  FclVec3 T;
+  using Solver = DetectConflict::Options::Solver;
+  FclContinuousCollisionRequest request;
+
+  request.gjk_solver_type = fcl::GST_LIBCCD;
+  request.num_max_iterations = options.max_iterations;
+  request.toc_err = options.tolerance;
+
+  if (options.solver == Solver::Sampling)
+  {
+    // The naive solver divides the time range by one less than the number of
+    // samples, so it needs at least two of them.
+    request.ccd_solver_type = fcl::CCDC_NAIVE;
+    request.num_max_iterations = std::max<std::size_t>(
+      request.num_max_iterations, 2);
+  }
+  else
+  {
+    request.ccd_solver_type = fcl::CCDC_CONSERVATIVE_ADVANCEMENT;
+  }
 
-  // The constructor that we are using is a no-op (apparently it was declared,
-  // but its definition is just `// TODO`, so we don't need to worry about
-  // unintended consequences. If we update the version of FCL, this may change,
-  // so I'm going to leave a FIXME tag here to keep us aware of that.
-  return std::make_shared<FclSplineMotion>(R, T, R, T);
+  return request;
 }
 
 //==============================================================================
-FclContinuousCollisionRequest make_fcl_request()
+/// Reusable objects for the narrowphase. Each thread keeps one instance alive
+/// so that checking a route against a whole schedule does not need to allocate
+/// new FCL motions on every call. The FCL collision objects only hold shared
+/// references to these motions, so they are cheap to construct on the stack.
+///
+/// None of the functions in this file hold onto the scratch while calling
+/// another function that uses it, so reentrance is not a concern.
+struct NarrowphaseScratch
 {
-  FclContinuousCollisionRequest request;
+  std::shared_ptr<ReusableFclSplineMotion> motion_a =
+    std::make_shared<ReusableFclSplineMotion>();
 
-  request.ccd_solver_type = fcl::CCDC_CONSERVATIVE_ADVANCEMENT;
-  request.gjk_solver_type = fcl::GST_LIBCCD;
-  request.num_max_iterations = 15;
+  std::shared_ptr<ReusableFclSplineMotion> motion_b =
+    std::make_shared<ReusableFclSplineMotion>();
 
-  return request;
-}
+  std::shared_ptr<internal::StaticMotion> motion_static =
+    std::make_shared<internal::StaticMotion>();
+
+  static NarrowphaseScratch& get()
+  {
+    thread_local NarrowphaseScratch scratch;
+    return scratch;
+  }
+};
 
 //==============================================================================
 std::optional<double> check_collision(
   const geometry::FinalConvexShape& shape_a,
-  const std::shared_ptr<FclSplineMotion>& motion_a,
+  const std::shared_ptr<FclMotion>& motion_a,
   const geometry::FinalConvexShape& shape_b,
-  const std::shared_ptr<FclSplineMotion>& motion_b,
+  const std::shared_ptr<FclMotion>& motion_b,
   const FclContinuousCollisionRequest& request)
 {
   const auto obj_a = FclContinuousCollisionObject(
@@ -471,6 +570,7 @@ std::optional<double> check_collision(
     geometry::FinalConvexShape::Implementation::get_collision(shape_b),
     motion_b);
 
+  internal::count_conflict_stat(internal::ConflictStat::FclCcdCalls);
   FclContinuousCollisionResult result;
   fcl::collide(&obj_a, &obj_b, request, result);
 
@@ -480,16 +580,6 @@ std::optional<double> check_collision(
   return std::nullopt;
 }
 
-//==============================================================================
-Profile::Implementation convert_profile(const Profile& profile)
-{
-  Profile::Implementation output = Profile::Implementation::get(profile);
-  if (!output.vicinity)
-    output.vicinity = output.footprint;
-
-  return output;
-}
-
 //==============================================================================
 Time compute_time(
   const double scaled_time,
@@ -521,52 +611,283 @@ std::optional<rmf_traffic::DetectConflict::Conflict> DetectConflict::between(
     interpolation);
 }
 
+//==============================================================================
+std::optional<rmf_traffic::DetectConflict::Conflict> DetectConflict::between(
+  const Profile& profile_a,
+  const Trajectory& trajectory_a,
+  const DependsOnCheckpoint* dependencies_of_a_on_b,
+  const Profile& profile_b,
+  const Trajectory& trajectory_b,
+  const DependsOnCheckpoint* dependencies_of_b_on_a,
+  const Options& options,
+  Interpolate interpolation)
+{
+  return Implementation::between(
+    profile_a, trajectory_a, dependencies_of_a_on_b,
+    profile_b, trajectory_b, dependencies_of_b_on_a,
+    interpolation, nullptr, options);
+}
+
+//==============================================================================
+auto DetectConflict::all_between(
+  const Profile& profile_a,
+  const Trajectory& trajectory_a,
+  const DependsOnCheckpoint* dependencies_of_a_on_b,
+  const Profile& profile_b,
+  const Trajectory& trajectory_b,
+  const DependsOnCheckpoint* dependencies_of_b_on_a,
+  const Options& options,
+  Interpolate interpolation) -> std::vector<ConflictInterval>
+{
+  Implementation::Conflicts conflicts;
+  Implementation::between(
+    profile_a, trajectory_a, dependencies_of_a_on_b,
+    profile_b, trajectory_b, dependencies_of_b_on_a,
+    interpolation, &conflicts, options);
+
+  // Each pair of segments may have reported several conflicts, one for each
+  // pair of shapes and each approach, but the crawl visits each pair of
+  // segments only once, so their conflicts are always next to each other.
+  std::vector<ConflictInterval> output;
+  output.reserve(conflicts.size());
+  for (const auto& conflict : conflicts)
+  {
+    if (!output.empty()
+      && output.back().a_it == conflict.a_it
+      && output.back().b_it == conflict.b_it)
+    {
+      auto& interval = output.back();
+      interval.begin = std::min(interval.begin, conflict.time);
+      continue;
+    }
+
+    output.push_back(
+      ConflictInterval{
+        conflict.a_it,
+        conflict.b_it,
+        conflict.time,
+        std::min(conflict.a_it->time(), conflict.b_it->time())
+      });
+  }
+
+  std::stable_sort(
+    output.begin(), output.end(),
+    [](const ConflictInterval& lhs, const ConflictInterval& rhs)
+    {
+      return lhs.begin < rhs.begin;
+    });
+
+  return output;
+}
+
+//==============================================================================
+DetectConflict::Options::Options(
+  const double tolerance_,
+  const std::size_t max_iterations_,
+  const Solver solver_,
+  const bool exact_time_)
+: tolerance(tolerance_),
+  max_iterations(max_iterations_),
+  solver(solver_),
+  exact_time(exact_time_)
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto DetectConflict::Options::fast() -> Options
+{
+  return Options(1e-3, 5, Solver::ConservativeAdvancement, false);
+}
+
+//==============================================================================
+auto DetectConflict::Options::precise() -> Options
+{
+  return Options(1e-9, 100, Solver::ConservativeAdvancement, true);
+}
+
+//==============================================================================
+DetectConflict::BatchOptions::BatchOptions(
+  const bool find_all_,
+  const std::size_t max_threads_,
+  const std::size_t min_candidates_per_thread_,
+  Options detection_)
+: find_all(find_all_),
+  max_threads(max_threads_),
+  min_candidates_per_thread(min_candidates_per_thread_),
+  detection(std::move(detection_))
+{
+  // Do nothing
+}
+
+//==============================================================================
+namespace {
+/// Run check on every index of a batch, spread across threads according to
+/// the options, and collect the conflicts in index order. The check must
+/// return the earliest conflict for the index, if there is one.
+template<typename Check>
+std::vector<DetectConflict::IndexedConflict> check_batch(
+  const std::size_t N,
+  const DetectConflict::BatchOptions& options,
+  const Check& check)
+{
+  // Each index gets its own slot so that the final result does not depend on
+  // the order that the threads happen to finish in.
+  std::vector<std::optional<DetectConflict::Conflict>> results(N);
+  std::vector<std::exception_ptr> errors(N);
+
+  // When we only want the first conflict, any index that is higher than a
+  // known conflict does not need to be checked.
+  std::atomic_size_t first_found = N;
+  std::atomic_size_t next = 0;
+  std::atomic_bool interrupted = false;
+
+  const auto work = [&]()
+    {
+      for (std::size_t i = next++; i < N; i = next++)
+      {
+        if (!options.find_all && first_found.load() < i)
+          continue;
+
+        if (options.interrupter
+          && (interrupted.load() || options.interrupter()))
+        {
+          // Let the other threads know so they can stop without asking the
+          // interrupter again.
+          interrupted = true;
+          return;
+        }
+
+        try
+        {
+          results[i] = check(i);
+        }
+        catch (...)
+        {
+          errors[i] = std::current_exception();
+        }
+
+        if (results[i] || errors[i])
+        {
+          std::size_t current = first_found.load();
+          while (i < current && !first_found.compare_exchange_weak(current, i))
+          {
+            // Keep trying until first_found is no greater than i
+          }
+        }
+      }
+    };
+
+  std::size_t num_threads = options.max_threads;
+  if (options.min_candidates_per_thread > 0)
+  {
+    num_threads = std::min(
+      num_threads, N / options.min_candidates_per_thread);
+  }
+
+  if (num_threads <= 1)
+  {
+    work();
+  }
+  else
+  {
+    // Each call keeps taking candidates until there are none left, so a call
+    // that starts late just finds nothing to do.
+    const auto& executor =
+      options.executor ? options.executor : Executor::shared();
+    executor->run(num_threads, [&](std::size_t) { work(); }, num_threads);
+  }
+
+  std::vector<DetectConflict::IndexedConflict> output;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    if (errors[i])
+      std::rethrow_exception(errors[i]);
+
+    if (results[i])
+    {
+      output.push_back(DetectConflict::IndexedConflict{i, *results[i]});
+      if (!options.find_all)
+        break;
+    }
+  }
+
+  return output;
+}
+} // anonymous namespace
+
+//==============================================================================
+auto DetectConflict::between_many(
+  const Profile& profile,
+  const Trajectory& trajectory,
+  const std::vector<Candidate>& candidates,
+  const BatchOptions& options,
+  Interpolate interpolation) -> std::vector<IndexedConflict>
+{
+  return check_batch(
+    candidates.size(), options,
+    [&](const std::size_t i)
+    {
+      const auto& c = candidates[i];
+      return Implementation::between(
+        profile, trajectory, c.dependencies_on_candidate,
+        *c.profile, *c.trajectory, c.dependencies_of_candidate,
+        interpolation, nullptr, options.detection);
+    });
+}
+
+//==============================================================================
+auto DetectConflict::between_pairs(
+  const std::vector<Pair>& pairs,
+  const BatchOptions& options,
+  Interpolate interpolation) -> std::vector<IndexedConflict>
+{
+  return check_batch(
+    pairs.size(), options,
+    [&](const std::size_t i)
+    {
+      const auto& p = pairs[i];
+      return Implementation::between(
+        *p.profile_a, *p.trajectory_a, p.dependencies_of_a_on_b,
+        *p.profile_b, *p.trajectory_b, p.dependencies_of_b_on_a,
+        interpolation, nullptr, options.detection);
+    });
+}
+
 namespace {
 
 //==============================================================================
+/// Check whether the shapes of a pair collide while they are resting at the
+/// given positions.
 bool check_overlap(
-  const Profile::Implementation& profile_a,
-  const Spline& spline_a,
-  const Profile::Implementation& profile_b,
-  const Spline& spline_b,
-  const Time time)
+  const ShapePair& pair,
+  const Eigen::Vector3d& pos_a,
+  const Eigen::Vector3d& pos_b)
 {
-  using ConvexPair = std::array<geometry::ConstFinalConvexShapePtr, 2>;
-  // TODO(MXG): If footprint and vicinity are equal, we can probably reduce this
-  // to just one check.
-  std::array<ConvexPair, 2> pairs = {
-    ConvexPair{profile_a.footprint, profile_b.vicinity},
-    ConvexPair{profile_a.vicinity, profile_b.footprint}
-  };
+  const double distance =
+    (pos_a.block<2, 1>(0, 0) - pos_b.block<2, 1>(0, 0)).norm();
+
+  if (pair.reach < distance)
+    return false;
+
+  if (pair.circle_contact)
+    return distance <= *pair.circle_contact;
 
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
   fcl::CollisionRequestd request;
   fcl::CollisionResultd result;
-  for (const auto& pair : pairs)
-  {
-    auto pos_a = spline_a.compute_position(time);
-    auto pos_b = spline_b.compute_position(time);
-
-    auto rot_a =
-      fcl::AngleAxisd(pos_a[2], Eigen::Vector3d::UnitZ()).toRotationMatrix();
-    auto rot_b =
-      fcl::AngleAxisd(pos_b[2], Eigen::Vector3d::UnitZ()).toRotationMatrix();
-
-    fcl::CollisionObjectd obj_a(
-      geometry::FinalConvexShape::Implementation::get_collision(*pair[0]),
-      rot_a,
-      fcl::Vector3d(pos_a[0], pos_a[1], 0.0)
-    );
-
-    fcl::CollisionObjectd obj_b(
-      geometry::FinalConvexShape::Implementation::get_collision(*pair[1]),
-      rot_b,
-      fcl::Vector3d(pos_b[0], pos_b[1], 0.0)
-    );
-
-    if (fcl::collide(&obj_a, &obj_b, request, result) > 0)
-      return true;
-  }
+
+  fcl::CollisionObjectd obj_a(
+    geometry::FinalConvexShape::Implementation::get_collision(*pair.a),
+    fcl::AngleAxisd(pos_a[2], Eigen::Vector3d::UnitZ()).toRotationMatrix(),
+    fcl::Vector3d(pos_a[0], pos_a[1], 0.0)
+  );
+
+  fcl::CollisionObjectd obj_b(
+    geometry::FinalConvexShape::Implementation::get_collision(*pair.b),
+    fcl::AngleAxisd(pos_b[2], Eigen::Vector3d::UnitZ()).toRotationMatrix(),
+    fcl::Vector3d(pos_b[0], pos_b[1], 0.0)
+  );
 #else
   fcl::CollisionRequest request;
   fcl::CollisionResult result;
@@ -578,133 +899,312 @@ bool check_overlap(
       return fcl::Transform3f(R, fcl::Vec3f(p[0], p[1], 0.0));
     };
 
-  for (const auto& pair : pairs)
-  {
-    fcl::CollisionObject obj_a(
-      geometry::FinalConvexShape::Implementation::get_collision(*pair[0]),
-      convert(spline_a.compute_position(time)));
+  fcl::CollisionObject obj_a(
+    geometry::FinalConvexShape::Implementation::get_collision(*pair.a),
+    convert(pos_a));
 
-    fcl::CollisionObject obj_b(
-      geometry::FinalConvexShape::Implementation::get_collision(*pair[1]),
-      convert(spline_b.compute_position(time)));
+  fcl::CollisionObject obj_b(
+    geometry::FinalConvexShape::Implementation::get_collision(*pair.b),
+    convert(pos_b));
+#endif
 
-    if (fcl::collide(&obj_a, &obj_b, request, result) > 0)
+  return fcl::collide(&obj_a, &obj_b, request, result) > 0;
+}
+
+//==============================================================================
+bool check_overlap(
+  const CollisionPairs& pairs,
+  const Spline& spline_a,
+  const Spline& spline_b,
+  const Time time)
+{
+  internal::count_conflict_stat(internal::ConflictStat::OverlapChecks);
+
+  const Eigen::Vector3d pos_a = spline_a.compute_position(time);
+  const Eigen::Vector3d pos_b = spline_b.compute_position(time);
+
+  for (const auto& pair : pairs)
+  {
+    if (check_overlap(pair, pos_a, pos_b))
       return true;
   }
-#endif
 
   return false;
 }
 
+//==============================================================================
+Eigen::Isometry2d to_isometry(const Eigen::Vector3d& position)
+{
+  Eigen::Isometry2d tf = Eigen::Isometry2d::Identity();
+  tf.translate(Eigen::Vector2d(position[0], position[1]));
+  tf.rotate(Eigen::Rotation2Dd(position[2]));
+  return tf;
+}
+
 //==============================================================================
 bool close_start(
-  const Profile::Implementation& profile_a,
-  const Trajectory::const_iterator& a_it,
-  const Profile::Implementation& profile_b,
-  const Trajectory::const_iterator& b_it)
+  const CollisionPairs& pairs,
+  const Spline& spline_a,
+  const Spline& spline_b)
 {
   // If two trajectories start very close to each other, then we do not consider
   // it a conflict for them to be in each other's vicinities. This gives robots
   // an opportunity to back away from each other without it being considered a
   // schedule conflict.
-  Spline spline_a(a_it);
-  Spline spline_b(b_it);
   const auto start_time =
     std::max(spline_a.start_time(), spline_b.start_time());
 
-  return check_overlap(profile_a, spline_a, profile_b, spline_b, start_time);
+  return check_overlap(pairs, spline_a, spline_b, start_time);
+}
+
+//==============================================================================
+/// When the current segments of the crawlers are too far apart to collide and
+/// mover finishes its segment first, a hierarchy over the trajectory of mover
+/// lets it jump past every segment that finishes before the current segment of
+/// other does and that cannot come within reach of it. Those segments only
+/// overlap in time with the current segment of other, so none of them could
+/// collide.
+///
+/// \return true if mover was moved ahead
+bool skip_ahead(Crawler& mover, const Crawler& other, const double reach)
+{
+  const auto& cache = mover.cache();
+  if (cache.hierarchy.empty())
+    return false;
+
+  const std::size_t first = mover.local_index() + 1;
+  const std::size_t last = std::min(
+    internal::seek_time(cache.times, first, other.time()),
+    cache.times.size() - 1);
+
+  if (last <= first)
+    return false;
+
+  const std::size_t target = internal::find_overlapping_segment(
+    cache, first, last, adjust_bounding_box(other.bounds(), reach));
+
+  internal::count_conflict_stat(
+    internal::ConflictStat::HierarchySkippedSegments, target - first);
+  mover.skip_to(target);
+  return true;
+}
+
+//==============================================================================
+/// When holder ignores the current segment of other because of a dependency,
+/// every segment pair is ignored until holder moves past the checkpoint of
+/// that dependency. Both crawlers are moved straight to the pair that the
+/// normal step-by-step crawl would reach at that checkpoint, without visiting
+/// any of the ignored pairs in between.
+///
+/// \return true if the crawlers were moved ahead
+bool skip_ignored_span(Crawler& holder, Crawler& other)
+{
+  if (!holder.ignore(other.index()))
+    return false;
+
+  const std::size_t target = holder.ignore_window_end();
+  if (target <= holder.local_index())
+    return false;
+
+  // The other crawler will have gone past every waypoint that is not later
+  // than the moment that holder reaches the start of its target segment.
+  const Time arrival = holder.cache().times[target - 1];
+  const auto& other_times = other.cache().times;
+  const std::size_t other_target = std::upper_bound(
+    other_times.begin() + other.local_index(), other_times.end(), arrival)
+    - other_times.begin();
+
+  holder.skip_to(target);
+  other.skip_to(other_target);
+  return true;
 }
 
 //==============================================================================
 std::optional<DetectConflict::Conflict> detect_invasion(
-  const Profile::Implementation& profile_a,
+  const CollisionPairs& pairs,
   Crawler crawl_a,
-  const Profile::Implementation& profile_b,
   Crawler crawl_b,
+  const DetectConflict::Options& options,
   std::vector<DetectConflict::Conflict>* output_conflicts)
 {
+  RMF_TRAFFIC_TRACE("conflict.narrowphase");
   using Conflict = DetectConflict::Conflict;
   std::optional<Spline> spline_a;
   std::optional<Spline> spline_b;
 
-  std::shared_ptr<FclSplineMotion> motion_a =
-    make_uninitialized_fcl_spline_motion();
-  std::shared_ptr<FclSplineMotion> motion_b =
-    make_uninitialized_fcl_spline_motion();
-
-  const FclContinuousCollisionRequest request = make_fcl_request();
+  auto& scratch = NarrowphaseScratch::get();
+  const auto request = make_fcl_request(options);
 
-  // This flag lets us know that we need to test both a's footprint in b's
-  // vicinity and b's footprint in a's vicinity.
-  const bool test_complement =
-    (profile_a.vicinity != profile_a.footprint)
-    || (profile_b.vicinity != profile_b.footprint);
-
-  if (output_conflicts)
-    output_conflicts->clear();
+  double reach = 0.0;
+  for (const auto& pair : pairs)
+    reach = std::max(reach, pair.reach);
 
   while (!crawl_a.finished() && !crawl_b.finished())
   {
-    if (!spline_a)
-      spline_a = Spline(crawl_a.current());
-
-    if (!spline_b)
-      spline_b = Spline(crawl_b.current());
-
     const bool ignore = crawl_a.ignore(crawl_b.index())
         || crawl_b.ignore(crawl_a.index());
 
+    if (ignore
+      && (skip_ignored_span(crawl_a, crawl_b)
+      || skip_ignored_span(crawl_b, crawl_a)))
+    {
+      internal::count_conflict_stat(
+        internal::ConflictStat::IgnoredSpanSkips);
+      spline_a = std::nullopt;
+      spline_b = std::nullopt;
+      continue;
+    }
+
+    // Use the cached bounding boxes of the segments as a broadphase so that we
+    // only construct splines and FCL motions for pairs that might collide.
+    std::array<bool, 2> test = {false, false};
+    bool test_circles = false;
+    bool test_fcl = false;
     if (!ignore)
     {
+      internal::count_conflict_stat(
+        internal::ConflictStat::InvasionSegmentPairs);
+
+      std::size_t k = 0;
+      for (const auto& pair : pairs)
+      {
+        test[k] = pair.might_collide(crawl_a.bounds(), crawl_b.bounds());
+        if (test[k])
+        {
+          if (pair.circle_contact)
+            test_circles = true;
+          else
+            test_fcl = true;
+        }
+
+        ++k;
+      }
+
+      if (!test_circles && !test_fcl)
+      {
+        internal::count_conflict_stat(
+          internal::ConflictStat::SegmentBroadphaseRejects);
+      }
+    }
+
+    if (test_circles || test_fcl)
+    {
+      if (!spline_a)
+        spline_a = crawl_a.spline();
+
+      if (!spline_b)
+        spline_b = crawl_b.spline();
+
       const Time start_time =
         std::max(spline_a->start_time(), spline_b->start_time());
 
       const Time finish_time =
         std::min(spline_a->finish_time(), spline_b->finish_time());
 
-      *motion_a = spline_a->to_fcl(start_time, finish_time);
-      *motion_b = spline_b->to_fcl(start_time, finish_time);
+      // When neither agent moves during these segments, whether they collide
+      // cannot change over time, so one static overlap test per shape pair
+      // decides it.
+      const bool stationary_a = crawl_a.stationary();
+      const bool stationary_b = crawl_b.stationary();
+      const bool stationary = stationary_a && stationary_b;
+
+      std::optional<DistanceDifferential> D;
+      if (test_circles && !stationary)
+        D.emplace(*spline_a, *spline_b);
+
+      // A stationary agent is given a static motion so that FCL only needs to
+      // advance the one that is moving.
+      std::shared_ptr<FclMotion> motion_a;
+      std::shared_ptr<FclMotion> motion_b;
+      if (test_fcl && !stationary)
+      {
+        if (stationary_a)
+        {
+          scratch.motion_static->set_transform(to_isometry(crawl_a.position()));
+          motion_a = scratch.motion_static;
+        }
+        else
+        {
+          scratch.motion_a->reset(*spline_a, start_time, finish_time);
+          motion_a = scratch.motion_a;
+        }
 
-      const auto bound_a = get_bounding_profile(*spline_a, profile_a);
-      const auto bound_b = get_bounding_profile(*spline_b, profile_b);
+        if (stationary_b)
+        {
+          scratch.motion_static->set_transform(to_isometry(crawl_b.position()));
+          motion_b = scratch.motion_static;
+        }
+        else
+        {
+          scratch.motion_b->reset(*spline_b, start_time, finish_time);
+          motion_b = scratch.motion_b;
+        }
+      }
 
-      if (overlap(bound_a.footprint, bound_b.vicinity))
+      std::size_t k = 0;
+      for (const auto& pair : pairs)
       {
-        if (const auto collision = check_collision(
-            *profile_a.footprint, motion_a,
-            *profile_b.vicinity, motion_b, request))
+        if (!test[k++])
+          continue;
+
+        std::optional<Time> collision;
+        if (stationary)
+        {
+          internal::count_conflict_stat(
+            internal::ConflictStat::StationaryChecks);
+          if (check_overlap(pair, crawl_a.position(), crawl_b.position()))
+            collision = start_time;
+        }
+        else if (pair.circle_contact)
         {
-          const auto time = compute_time(*collision, start_time, finish_time);
-          auto conflict = Conflict{crawl_a.current(), crawl_b.current(), time};
+          internal::count_conflict_stat(
+            internal::ConflictStat::AnalyticCircleChecks);
+          collision = D->first_time_within(
+            *pair.circle_contact, options.tolerance, options.exact_time);
+        }
+        else if (const auto scaled_time = check_collision(
+            *pair.a, motion_a, *pair.b, motion_b, request))
+        {
+          collision = compute_time(*scaled_time, start_time, finish_time);
+        }
+
+        if (collision)
+        {
+          auto conflict =
+            Conflict{crawl_a.current(), crawl_b.current(), *collision};
           if (!output_conflicts)
             return conflict;
 
           output_conflicts->emplace_back(std::move(conflict));
         }
       }
+    }
 
-      if (test_complement && overlap(bound_a.vicinity, bound_b.footprint))
+    // The finish time of each segment is the time of its waypoint, so we can
+    // advance the crawlers without needing the splines to have been built.
+    const Time finish_a = crawl_a.time();
+    const Time finish_b = crawl_b.time();
+    if (!test_circles && !test_fcl)
+    {
+      if (finish_a < finish_b && skip_ahead(crawl_a, crawl_b, reach))
       {
-        if (const auto collision = check_collision(
-            *profile_a.vicinity, motion_a,
-            *profile_b.footprint, motion_b, request))
-        {
-          const auto time = compute_time(*collision, start_time, finish_time);
-          auto conflict = Conflict{crawl_a.current(), crawl_b.current(), time};
-          if (!output_conflicts)
-            return conflict;
+        spline_a = std::nullopt;
+        continue;
+      }
 
-          output_conflicts->emplace_back(conflict);
-        }
+      if (finish_b < finish_a && skip_ahead(crawl_b, crawl_a, reach))
+      {
+        spline_b = std::nullopt;
+        continue;
       }
     }
 
-    if (spline_a->finish_time() < spline_b->finish_time())
+    if (finish_a < finish_b)
     {
       spline_a = std::nullopt;
       crawl_a.next();
     }
-    else if (spline_b->finish_time() < spline_a->finish_time())
+    else if (finish_b < finish_a)
     {
       spline_b = std::nullopt;
       crawl_b.next();
@@ -732,8 +1232,7 @@ std::optional<DetectConflict::Conflict> detect_invasion(
 Trajectory slice_trajectory(
   const Time start_time,
   const Spline& spline,
-  Trajectory::const_iterator it,
-  const Trajectory::const_iterator& end)
+  const Crawler& crawler)
 {
   Trajectory output;
   output.insert(
@@ -741,20 +1240,22 @@ Trajectory slice_trajectory(
     spline.compute_position(start_time),
     spline.compute_velocity(start_time));
 
-  for (; it != end; ++it)
-    output.insert(*it);
+  const auto& cache = crawler.cache();
+  for (std::size_t i = crawler.local_index(); i < cache.times.size(); ++i)
+    output.insert(cache.times[i], cache.positions[i], cache.velocities[i]);
 
   return output;
 }
 
 //==============================================================================
 std::optional<DetectConflict::Conflict> detect_approach(
-  const Profile::Implementation& profile_a,
+  const CollisionPairs& pairs,
   Crawler crawl_a,
-  const Profile::Implementation& profile_b,
   Crawler crawl_b,
+  const DetectConflict::Options& options,
   std::vector<DetectConflict::Conflict>* output_conflicts)
 {
+  RMF_TRAFFIC_TRACE("conflict.narrowphase");
   using Conflict = DetectConflict::Conflict;
   std::optional<Spline> spline_a;
   std::optional<Spline> spline_b;
@@ -762,10 +1263,10 @@ std::optional<DetectConflict::Conflict> detect_approach(
   while (!crawl_a.finished() && !crawl_b.finished())
   {
     if (!spline_a)
-      spline_a = Spline(crawl_a.current());
+      spline_a = crawl_a.spline();
 
     if (!spline_b)
-      spline_b = Spline(crawl_b.current());
+      spline_b = crawl_b.spline();
 
     const DistanceDifferential D(*spline_a, *spline_b);
 
@@ -785,9 +1286,12 @@ std::optional<DetectConflict::Conflict> detect_approach(
     }
 
     const auto approach_times = D.approach_times();
+    internal::count_conflict_stat(
+      internal::ConflictStat::ApproachSamples, approach_times.size());
+
     for (const auto t : approach_times)
     {
-      if (!check_overlap(profile_a, *spline_a, profile_b, *spline_b, t))
+      if (!check_overlap(pairs, *spline_a, *spline_b, t))
       {
         // If neither vehicle is in the vicinity of the other, then we should
         // revert to the normal invasion detection approach to identifying
@@ -796,29 +1300,31 @@ std::optional<DetectConflict::Conflict> detect_approach(
         // TODO(MXG): Consider an approach that does not require making copies
         // of the trajectories.
         const Trajectory sliced_trajectory_a =
-          slice_trajectory(t, *spline_a, crawl_a.current(), crawl_a.end());
+          slice_trajectory(t, *spline_a, crawl_a);
 
         const Trajectory sliced_trajectory_b =
-          slice_trajectory(t, *spline_b, crawl_b.current(), crawl_b.end());
+          slice_trajectory(t, *spline_b, crawl_b);
 
         Crawler sliced_crawl_a{
           crawl_a.index() - 1,
+          sliced_trajectory_a,
           ++sliced_trajectory_a.begin(),
-          sliced_trajectory_a.end(),
-          crawl_a.deps()
+          crawl_a.deps(),
+          internal::get_segment_cache(sliced_trajectory_a),
+          &crawl_a.origin()
         };
 
         Crawler sliced_crawl_b{
           crawl_b.index() - 1,
+          sliced_trajectory_b,
           ++sliced_trajectory_b.begin(),
-          sliced_trajectory_b.end(),
-          crawl_b.deps()
+          crawl_b.deps(),
+          internal::get_segment_cache(sliced_trajectory_b),
+          &crawl_b.origin()
         };
 
         return detect_invasion(
-          profile_a, sliced_crawl_a,
-          profile_b, sliced_crawl_b,
-          output_conflicts);
+          pairs, sliced_crawl_a, sliced_crawl_b, options, output_conflicts);
       }
 
       if (!ignore)
@@ -836,7 +1342,7 @@ std::optional<DetectConflict::Conflict> detect_approach(
     }
 
     const bool still_close = check_overlap(
-      profile_a, *spline_a, profile_b, *spline_b, D.finish_time());
+      pairs, *spline_a, *spline_b, D.finish_time());
 
     if (spline_a->finish_time() < spline_b->finish_time())
     {
@@ -860,9 +1366,7 @@ std::optional<DetectConflict::Conflict> detect_approach(
     if (!still_close)
     {
       return detect_invasion(
-        profile_a, crawl_a,
-        profile_b, crawl_b,
-        output_conflicts);
+        pairs, crawl_a, crawl_b, options, output_conflicts);
     }
   }
 
@@ -886,8 +1390,12 @@ std::optional<DetectConflict::Conflict> DetectConflict::Implementation::between(
   const Trajectory& trajectory_b,
   const DependsOnCheckpoint* deps_b_on_a,
   Interpolate /*interpolation*/,
-  std::vector<Conflict>* output_conflicts)
+  std::vector<Conflict>* output_conflicts,
+  const Options& options)
 {
+  const internal::ConflictStatTimer timer;
+  internal::count_conflict_stat(internal::ConflictStat::PairChecks);
+
   if (trajectory_a.size() < 2)
   {
     throw invalid_trajectory_error::Implementation
@@ -902,25 +1410,34 @@ std::optional<DetectConflict::Conflict> DetectConflict::Implementation::between(
             trajectory_b.size(), __LINE__, __FUNCTION__);
   }
 
-  const Profile::Implementation profile_a = convert_profile(input_profile_a);
-  const Profile::Implementation profile_b = convert_profile(input_profile_b);
-
-  // Return early if there is no geometry in the profiles
+  // Return early if there are no shapes in the profiles that can collide with
+  // each other.
   // TODO(MXG): Should this produce an exception? Is this an okay scenario?
-  if (!profile_a.footprint && !profile_b.footprint)
+  const CollisionPairs pairs(
+    Profile::Implementation::get(input_profile_a),
+    Profile::Implementation::get(input_profile_b));
+  if (pairs.empty())
     return std::nullopt;
 
-  // Return early if either profile is missing both a vicinity and a footprint.
-  // NOTE(MXG): Since convert_profile will promote the vicinity to have the same
-  // value as the footprint when the vicinity has a nullptr value, checking if
-  // a vicinity doesn't exist is the same as checking that both the vicinity and
-  // footprint doesn't exist.
-  if (!profile_a.vicinity || !profile_b.vicinity)
-    return std::nullopt;
+  if (output_conflicts)
+    output_conflicts->clear();
 
   // Return early if there is no time overlap between the trajectories
   if (!have_time_overlap(trajectory_a, trajectory_b))
+  {
+    internal::count_conflict_stat(internal::ConflictStat::TimeOverlapRejects);
+    return std::nullopt;
+  }
+
+  auto cache_a = internal::get_segment_cache(trajectory_a);
+  auto cache_b = internal::get_segment_cache(trajectory_b);
+
+  // Return early if the trajectories never come near each other at all
+  if (!pairs.might_collide(cache_a->total_bounds, cache_b->total_bounds))
+  {
+    internal::count_conflict_stat(internal::ConflictStat::BoundingBoxRejects);
     return std::nullopt;
+  }
 
   Trajectory::const_iterator a_it;
   Trajectory::const_iterator b_it;
@@ -928,28 +1445,95 @@ std::optional<DetectConflict::Conflict> DetectConflict::Implementation::between(
 
   // NOTE: The deps are intentionally swapped here because passing them to the
   // opposite crawler makes them more efficient to crawl through.
-  Crawler crawl_a(0, std::move(a_it), trajectory_a.end(), deps_b_on_a);
-  Crawler crawl_b(0, std::move(b_it), trajectory_b.end(), deps_a_on_b);
+  Crawler crawl_a(
+    0, trajectory_a, std::move(a_it), deps_b_on_a, std::move(cache_a));
+  Crawler crawl_b(
+    0, trajectory_b, std::move(b_it), deps_a_on_b, std::move(cache_b));
 
-  if (close_start(profile_a, crawl_a.current(), profile_b, crawl_b.current()))
+  std::optional<Conflict> conflict;
+  if (close_start(pairs, crawl_a.spline(), crawl_b.spline()))
   {
     // If the vehicles are already starting in close proximity, then we consider
     // it a conflict if they get any closer while within that proximity.
-    return detect_approach(
-      profile_a, crawl_a,
-      profile_b, crawl_b,
-      output_conflicts);
+    internal::count_conflict_stat(internal::ConflictStat::CloseStartHits);
+    conflict = detect_approach(
+      pairs, crawl_a, crawl_b, options, output_conflicts);
+  }
+  else
+  {
+    // If the vehicles are starting an acceptable distance from each other, then
+    // check if either one invades the vicinity of the other.
+    conflict = detect_invasion(
+      pairs, crawl_a, crawl_b, options, output_conflicts);
+  }
+
+  if (conflict)
+  {
+    internal::count_conflict_stat(
+      internal::ConflictStat::Conflicts,
+      output_conflicts ? output_conflicts->size() : 1);
   }
 
-  // If the vehicles are starting an acceptable distance from each other, then
-  // check if either one invades the vicinity of the other.
-  return detect_invasion(
-    profile_a, crawl_a,
-    profile_b, crawl_b,
-    output_conflicts);
+  return conflict;
 }
 
 namespace internal {
+//==============================================================================
+Spacetime::Spacetime(
+  const Time* lower_time_bound_,
+  const Time* upper_time_bound_,
+  Eigen::Isometry2d pose_,
+  geometry::ConstFinalShapePtr shape_)
+: lower_time_bound(lower_time_bound_),
+  upper_time_bound(upper_time_bound_)
+{
+  set_space(pose_, std::move(shape_));
+}
+
+//==============================================================================
+void Spacetime::set_space(
+  Eigen::Isometry2d pose_,
+  geometry::ConstFinalShapePtr shape_)
+{
+  pose = pose_;
+  shape = std::move(shape_);
+  piece_bounds.clear();
+
+  const Eigen::Vector2d center = pose.translation();
+  bounds = BoundingBox{center, center};
+  if (!shape)
+    return;
+
+  // Shapes that are made of several pieces, like polygons, keep a bounding
+  // circle for each piece. Those give a tighter reach than the characteristic
+  // length, and they let us skip the pieces that a segment cannot reach.
+  const auto& shape_bounds =
+    geometry::FinalShape::Implementation::get_bounds(*shape);
+  if (shape_bounds.empty())
+  {
+    // The shape fits inside of a circle of its characteristic length, no
+    // matter how it is rotated.
+    bounds = adjust_bounding_box(bounds, shape->get_characteristic_length());
+    return;
+  }
+
+  piece_bounds.reserve(shape_bounds.size());
+  for (const auto& piece : shape_bounds)
+  {
+    const Eigen::Vector2d piece_center = pose * piece.center;
+    piece_bounds.push_back(
+      adjust_bounding_box(
+        BoundingBox{piece_center, piece_center}, piece.radius));
+  }
+
+  bounds = piece_bounds.front();
+  for (const auto& piece : piece_bounds)
+  {
+    bounds.min = bounds.min.cwiseMin(piece.min);
+    bounds.max = bounds.max.cwiseMax(piece.max);
+  }
+}
+
 //==============================================================================
 bool detect_conflicts(
   const Profile& profile,
@@ -995,20 +1579,39 @@ bool detect_conflicts(
     return false;
   }
 
-  const Trajectory::const_iterator begin_it =
-    trajectory_start_time < start_time ?
-    trajectory.find(start_time) : ++trajectory.begin();
+  if (output_conflicts)
+    output_conflicts->clear();
 
-  const Trajectory::const_iterator end_it =
-    finish_time < trajectory_finish_time ?
-    ++trajectory.find(finish_time) : trajectory.end();
+  // The vicinity fits inside of a circle of its characteristic length, no
+  // matter how it is rotated, and the world-frame bounds of the region were
+  // computed when its space was set. That lets us rule out any part of the
+  // trajectory whose path does not come within reach of the region before we
+  // do any narrowphase checks.
+  const auto cache = internal::get_segment_cache(trajectory);
+  assert(region.shape);
+  const double vicinity_length = vicinity->get_characteristic_length();
+  const BoundingBox region_box =
+    adjust_bounding_box(region.bounds, vicinity_length);
+
+  if (!overlap(cache->total_bounds, region_box))
+    return false;
+
+  // The segments are looked up in the contiguous times of the cache. The
+  // finish time is always found near the start time, so the cursor can find
+  // it without searching the whole trajectory again.
+  internal::TimeCursor cursor(cache->times);
+  const std::size_t begin_index =
+    trajectory_start_time < start_time ? cursor.lower_bound(start_time) : 1;
 
-  std::shared_ptr<FclSplineMotion> motion_trajectory =
-    make_uninitialized_fcl_spline_motion();
-  std::shared_ptr<internal::StaticMotion> motion_region =
-    std::make_shared<internal::StaticMotion>(region.pose);
+  const std::size_t end_index =
+    finish_time < trajectory_finish_time ?
+    cursor.lower_bound(finish_time) + 1 : cache->times.size();
 
-  const FclContinuousCollisionRequest request = make_fcl_request();
+  auto& scratch = NarrowphaseScratch::get();
+  const auto& motion_trajectory = scratch.motion_a;
+  const auto& motion_region = scratch.motion_static;
+  motion_region->set_transform(region.pose);
+  const auto request = make_fcl_request(DetectConflict::Options());
 
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
   const std::shared_ptr<fcl::CollisionGeometryd> vicinity_geom =
@@ -1018,20 +1621,24 @@ bool detect_conflicts(
     geometry::FinalConvexShape::Implementation::get_collision(*vicinity);
 #endif
 
-  if (output_conflicts)
-    output_conflicts->clear();
-
-  for (auto it = begin_it; it != end_it; ++it)
+  // Only the segments that come within reach of the region are visited. Long
+  // trajectories have a hierarchy of their segments, so whole spans of them
+  // can be passed over at once.
+  for (std::size_t index = internal::find_overlapping_segment(
+      *cache, begin_index, end_index, region_box);
+    index < end_index;
+    index = internal::find_overlapping_segment(
+      *cache, index + 1, end_index, region_box))
   {
-    Spline spline_trajectory{it};
+    const Spline spline_trajectory{cache->splines[index]};
 
     const Time spline_start_time =
       std::max(spline_trajectory.start_time(), start_time);
     const Time spline_finish_time =
       std::min(spline_trajectory.finish_time(), finish_time);
 
-    *motion_trajectory = spline_trajectory.to_fcl(
-      spline_start_time, spline_finish_time);
+    motion_trajectory->reset(
+      spline_trajectory, spline_start_time, spline_finish_time);
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
     const auto obj_trajectory = fcl::ContinuousCollisionObjectd(
       vicinity_geom, motion_trajectory);
@@ -1040,11 +1647,18 @@ bool detect_conflicts(
       vicinity_geom, motion_trajectory);
 #endif
 
-    assert(region.shape);
     const auto& region_shapes = geometry::FinalShape::Implementation
       ::get_collisions(*region.shape);
-    for (const auto& region_shape : region_shapes)
+    for (std::size_t piece = 0; piece < region_shapes.size(); ++piece)
     {
+      // Skip the pieces of the region that this segment cannot reach
+      if (!region.piece_bounds.empty()
+        && !overlap(
+          cache->bounds[index],
+          adjust_bounding_box(region.piece_bounds[piece], vicinity_length)))
+        continue;
+
+      const auto& region_shape = region_shapes[piece];
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
       const auto obj_region = fcl::ContinuousCollisionObjectd(
         region_shape, motion_region);
@@ -1053,9 +1667,7 @@ bool detect_conflicts(
         region_shape, motion_region);
 #endif
 
-      // TODO(MXG): We should do a broadphase test here before using
-      // fcl::collide
-
+      internal::count_conflict_stat(internal::ConflictStat::FclCcdCalls);
       FclContinuousCollisionResult result;
       fcl::collide(&obj_trajectory, &obj_region, request, result);
       if (result.is_collide)
@@ -1063,6 +1675,7 @@ bool detect_conflicts(
         if (!output_conflicts)
           return true;
 
+        const auto it = internal::get_iterator(trajectory, index);
         output_conflicts->emplace_back(
           DetectConflict::Conflict{
             it, it,
@@ -1080,6 +1693,38 @@ bool detect_conflicts(
 
   return !output_conflicts->empty();
 }
+
+//==============================================================================
+std::optional<Time> check_collision(
+  const geometry::FinalConvexShape& shape_a,
+  const Spline& spline_a,
+  const geometry::FinalConvexShape& shape_b,
+  const Spline& spline_b,
+  const DetectConflict::Options& options)
+{
+  const Time start_time =
+    std::max(spline_a.start_time(), spline_b.start_time());
+
+  const Time finish_time =
+    std::min(spline_a.finish_time(), spline_b.finish_time());
+
+  if (finish_time < start_time)
+    return std::nullopt;
+
+  auto& scratch = NarrowphaseScratch::get();
+  scratch.motion_a->reset(spline_a, start_time, finish_time);
+  scratch.motion_b->reset(spline_b, start_time, finish_time);
+
+  const auto scaled_time = rmf_traffic::check_collision(
+    shape_a, scratch.motion_a, shape_b, scratch.motion_b,
+    make_fcl_request(options));
+
+  if (!scaled_time)
+    return std::nullopt;
+
+  return compute_time(*scaled_time, start_time, finish_time);
+}
+
 } // namespace internal
 
 } // namespace rmf_traffic
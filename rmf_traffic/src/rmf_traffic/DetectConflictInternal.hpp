@@ -21,6 +21,7 @@
 #include <rmf_traffic/DetectConflict.hpp>
 
 #include "geometry/ShapeInternal.hpp"
+#include "TrajectoryInternal.hpp"
 
 #include <rmf_traffic/Profile.hpp>
 #include <rmf_traffic/Trajectory.hpp>
@@ -29,6 +30,8 @@
 
 namespace rmf_traffic {
 
+class Spline;
+
 class DetectConflict::Implementation
 {
 public:
@@ -43,20 +46,46 @@ public:
     const Trajectory& trajectory_b,
     const DependsOnCheckpoint* deps_b,
     Interpolate interpolation,
-    std::vector<Conflict>* output_conflicts = nullptr);
+    std::vector<Conflict>* output_conflicts = nullptr,
+    const Options& options = Options());
 
 };
 
 namespace internal {
 
 //==============================================================================
+/// A space that is checked for conflicts over a range of time. The world-frame
+/// bounds of the space are computed whenever the space is set, so the
+/// trajectories that get checked against it can rule out most of their
+/// segments with interval tests.
 struct Spacetime
 {
-  const Time* lower_time_bound;
-  const Time* upper_time_bound;
+  Spacetime() = default;
+
+  Spacetime(
+    const Time* lower_time_bound,
+    const Time* upper_time_bound,
+    Eigen::Isometry2d pose,
+    geometry::ConstFinalShapePtr shape);
+
+  /// Change the space and compute its bounds. The pose and shape should only
+  /// be changed through this function.
+  void set_space(Eigen::Isometry2d pose, geometry::ConstFinalShapePtr shape);
+
+  const Time* lower_time_bound = nullptr;
+  const Time* upper_time_bound = nullptr;
 
-  Eigen::Isometry2d pose;
+  Eigen::Isometry2d pose = Eigen::Isometry2d::Identity();
   geometry::ConstFinalShapePtr shape;
+
+  /// A box that contains the whole shape in the world frame
+  BoundingBox bounds = BoundingBox{Eigen::Vector2d::Zero(),
+    Eigen::Vector2d::Zero()};
+
+  /// A box for each piece of the shape in the world frame, when the shape is
+  /// made of several pieces that have their own bounds. This is empty for
+  /// shapes that only have one piece.
+  std::vector<BoundingBox> piece_bounds;
 };
 
 //==============================================================================
@@ -66,6 +95,18 @@ bool detect_conflicts(
   const Spacetime& region,
   DetectConflict::Implementation::Conflicts* output_conflicts = nullptr);
 
+//==============================================================================
+/// Use FCL's continuous collision detection to find when two shapes first make
+/// contact while following their splines. Only the time range that is shared
+/// by both splines will be checked. This is the narrowphase that is used for
+/// pairs of shapes which cannot be checked analytically.
+std::optional<Time> check_collision(
+  const geometry::FinalConvexShape& shape_a,
+  const Spline& spline_a,
+  const geometry::FinalConvexShape& shape_b,
+  const Spline& spline_b,
+  const DetectConflict::Options& options = DetectConflict::Options());
+
 } // namespace internal
 
 } // namespace rmf_traffic
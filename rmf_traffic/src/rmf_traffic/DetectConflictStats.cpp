@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "DetectConflictStats.hpp"
+
+#include <array>
+#include <mutex>
+#include <unordered_set>
+
+namespace rmf_traffic {
+namespace internal {
+
+namespace {
+
+//==============================================================================
+constexpr std::size_t NumConflictStats =
+  static_cast<std::size_t>(ConflictStat::NumStats);
+
+using Counters = std::array<std::atomic<std::uint64_t>, NumConflictStats>;
+
+//==============================================================================
+/// Keeps track of the counters of every thread. When a thread exits, its counts
+/// are moved into the retired totals so that they still show up in get_stats().
+struct StatsRegistry
+{
+  std::mutex mutex;
+  std::unordered_set<Counters*> active;
+  std::array<std::uint64_t, NumConflictStats> retired = {};
+
+  static StatsRegistry& get()
+  {
+    static StatsRegistry registry;
+    return registry;
+  }
+};
+
+//==============================================================================
+class ThreadCounters
+{
+public:
+
+  ThreadCounters()
+  : _registry(StatsRegistry::get())
+  {
+    for (auto& c : _counters)
+      c.store(0, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(_registry.mutex);
+    _registry.active.insert(&_counters);
+  }
+
+  ~ThreadCounters()
+  {
+    std::lock_guard<std::mutex> lock(_registry.mutex);
+    for (std::size_t i = 0; i < NumConflictStats; ++i)
+      _registry.retired[i] += _counters[i].load(std::memory_order_relaxed);
+
+    _registry.active.erase(&_counters);
+  }
+
+  Counters& counters()
+  {
+    return _counters;
+  }
+
+  static ThreadCounters& get()
+  {
+    thread_local ThreadCounters counters;
+    return counters;
+  }
+
+private:
+  StatsRegistry& _registry;
+  Counters _counters;
+};
+
+//==============================================================================
+/// The fields of DetectConflict::Stats that correspond to each ConflictStat,
+/// except for TimeSpent which is a Duration.
+using StatField = std::uint64_t DetectConflict::Stats::*;
+const std::array<StatField, NumConflictStats - 1> stat_fields = {
+  &DetectConflict::Stats::pair_checks,
+  &DetectConflict::Stats::time_overlap_rejects,
+  &DetectConflict::Stats::bounding_box_rejects,
+  &DetectConflict::Stats::close_start_hits,
+  &DetectConflict::Stats::invasion_segment_pairs,
+  &DetectConflict::Stats::segment_broadphase_rejects,
+  &DetectConflict::Stats::fcl_ccd_calls,
+  &DetectConflict::Stats::analytic_circle_checks,
+  &DetectConflict::Stats::stationary_checks,
+  &DetectConflict::Stats::hierarchy_skipped_segments,
+  &DetectConflict::Stats::ignored_span_skips,
+  &DetectConflict::Stats::overlap_checks,
+  &DetectConflict::Stats::approach_samples,
+  &DetectConflict::Stats::conflicts
+};
+
+static_assert(
+  static_cast<std::size_t>(ConflictStat::TimeSpent) == NumConflictStats - 1,
+  "TimeSpent must be the last ConflictStat");
+
+} // anonymous namespace
+
+//==============================================================================
+std::atomic_bool collecting_conflict_stats(false);
+
+//==============================================================================
+void add_conflict_stat(const ConflictStat stat, const std::uint64_t amount)
+{
+  // The owning thread is the only one that adds to these counters, but
+  // reset_stats() may zero them from another thread, so we still need an
+  // atomic read-modify-write. Relaxed ordering is enough since the counters
+  // are independent of each other.
+  ThreadCounters::get().counters()[static_cast<std::size_t>(stat)]
+  .fetch_add(amount, std::memory_order_relaxed);
+}
+
+} // namespace internal
+
+//==============================================================================
+void DetectConflict::collect_stats(const bool on)
+{
+  internal::collecting_conflict_stats.store(on, std::memory_order_relaxed);
+}
+
+//==============================================================================
+bool DetectConflict::collecting_stats()
+{
+  return internal::collecting_conflict_stats.load(std::memory_order_relaxed);
+}
+
+//==============================================================================
+auto DetectConflict::get_stats() -> Stats
+{
+  auto& registry = internal::StatsRegistry::get();
+  std::array<std::uint64_t, internal::NumConflictStats> totals;
+
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    totals = registry.retired;
+    for (const auto* counters : registry.active)
+    {
+      for (std::size_t i = 0; i < internal::NumConflictStats; ++i)
+        totals[i] += (*counters)[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  Stats stats;
+  for (std::size_t i = 0; i < internal::stat_fields.size(); ++i)
+    stats.*internal::stat_fields[i] = totals[i];
+
+  stats.time_spent = Duration(static_cast<Duration::rep>(
+      totals[static_cast<std::size_t>(internal::ConflictStat::TimeSpent)]));
+
+  return stats;
+}
+
+//==============================================================================
+void DetectConflict::reset_stats()
+{
+  auto& registry = internal::StatsRegistry::get();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.retired.fill(0);
+  for (auto* counters : registry.active)
+  {
+    for (auto& c : *counters)
+      c.store(0, std::memory_order_relaxed);
+  }
+}
+
+} // namespace rmf_traffic
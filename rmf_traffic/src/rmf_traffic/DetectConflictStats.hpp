@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__DETECTCONFLICTSTATS_HPP
+#define SRC__RMF_TRAFFIC__DETECTCONFLICTSTATS_HPP
+
+#include <rmf_traffic/DetectConflict.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rmf_traffic {
+namespace internal {
+
+//==============================================================================
+/// The counters of DetectConflict::Stats, in the order of its fields
+enum class ConflictStat : std::size_t
+{
+  PairChecks = 0,
+  TimeOverlapRejects,
+  BoundingBoxRejects,
+  CloseStartHits,
+  InvasionSegmentPairs,
+  SegmentBroadphaseRejects,
+  FclCcdCalls,
+  AnalyticCircleChecks,
+  StationaryChecks,
+  HierarchySkippedSegments,
+  IgnoredSpanSkips,
+  OverlapChecks,
+  ApproachSamples,
+  Conflicts,
+  TimeSpent,
+
+  NumStats
+};
+
+//==============================================================================
+/// This is only meant to be used through count_conflict_stat()
+extern std::atomic_bool collecting_conflict_stats;
+
+//==============================================================================
+/// Add to the counter of the calling thread
+void add_conflict_stat(ConflictStat stat, std::uint64_t amount);
+
+//==============================================================================
+inline void count_conflict_stat(ConflictStat stat, std::uint64_t amount = 1)
+{
+  if (collecting_conflict_stats.load(std::memory_order_relaxed))
+    add_conflict_stat(stat, amount);
+}
+
+//==============================================================================
+/// Measures the time between its construction and destruction, and adds that
+/// to the TimeSpent counter. Nothing is measured while stats are off.
+class ConflictStatTimer
+{
+public:
+
+  ConflictStatTimer()
+  : _active(collecting_conflict_stats.load(std::memory_order_relaxed))
+  {
+    if (_active)
+      _start = std::chrono::steady_clock::now();
+  }
+
+  ~ConflictStatTimer()
+  {
+    if (!_active)
+      return;
+
+    const auto elapsed = std::chrono::steady_clock::now() - _start;
+    add_conflict_stat(
+      ConflictStat::TimeSpent,
+      static_cast<std::uint64_t>(
+        std::chrono::duration_cast<Duration>(elapsed).count()));
+  }
+
+  ConflictStatTimer(const ConflictStatTimer&) = delete;
+  ConflictStatTimer& operator=(const ConflictStatTimer&) = delete;
+
+private:
+  bool _active;
+  std::chrono::steady_clock::time_point _start;
+};
+
+} // namespace internal
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__DETECTCONFLICTSTATS_HPP
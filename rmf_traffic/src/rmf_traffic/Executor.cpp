@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/Executor.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace rmf_traffic {
+
+namespace {
+//==============================================================================
+/// Get the CPUs that belong to a NUMA node, or an empty list if they cannot be
+/// found
+std::vector<std::size_t> numa_node_cpus(const std::size_t node)
+{
+  std::vector<std::size_t> cpus;
+#ifdef __linux__
+  std::ifstream file(
+    "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+
+  // The list looks like "0-3,8-11"
+  std::string range;
+  while (std::getline(file, range, ','))
+  {
+    std::stringstream ss(range);
+    std::size_t first = 0;
+    if (!(ss >> first))
+      continue;
+
+    std::size_t last = first;
+    if (ss.peek() == '-')
+    {
+      ss.get();
+      if (!(ss >> last))
+        last = first;
+    }
+
+    for (std::size_t cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+#else
+  (void)(node);
+#endif
+
+  return cpus;
+}
+
+//==============================================================================
+/// Decide which CPUs each thread may run on. An empty list means the thread
+/// is not pinned.
+std::vector<std::vector<std::size_t>> place_threads(
+  const Executor::Config& config)
+{
+  std::vector<std::size_t> node_cpus;
+  if (config.numa_node.has_value())
+    node_cpus = numa_node_cpus(*config.numa_node);
+
+  std::vector<std::size_t> cores;
+  for (const auto core : config.cores)
+  {
+    if (node_cpus.empty()
+      || std::find(node_cpus.begin(), node_cpus.end(), core) != node_cpus.end())
+    {
+      cores.push_back(core);
+    }
+  }
+
+  // If none of the cores belong to the node, the node wins
+  if (cores.empty() && !config.cores.empty() && !node_cpus.empty())
+    cores = node_cpus;
+
+  std::size_t threads = config.threads;
+  if (threads == 0)
+  {
+    if (!cores.empty())
+      threads = cores.size();
+    else if (!node_cpus.empty())
+      threads = node_cpus.size();
+    else
+      threads = std::thread::hardware_concurrency();
+  }
+
+  std::vector<std::vector<std::size_t>> placement(
+    std::max<std::size_t>(threads, 1));
+  for (std::size_t i = 0; i < placement.size(); ++i)
+  {
+    if (!cores.empty())
+      placement[i] = {cores[i % cores.size()]};
+    else
+      placement[i] = node_cpus;
+  }
+
+  return placement;
+}
+
+//==============================================================================
+/// Keep the calling thread on the given CPUs
+void pin_this_thread(const std::vector<std::size_t>& cpus)
+{
+  if (cpus.empty())
+    return;
+
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  bool any = false;
+  for (const auto cpu : cpus)
+  {
+    if (cpu < CPU_SETSIZE)
+    {
+      CPU_SET(cpu, &set);
+      any = true;
+    }
+  }
+
+  // A failure only means that the thread may run anywhere
+  if (any)
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+//==============================================================================
+class WorkStealingExecutor : public Executor
+{
+public:
+
+  WorkStealingExecutor(const Config& config)
+  {
+    const auto placement = place_threads(config);
+    _workers.reserve(placement.size());
+    for (std::size_t i = 0; i < placement.size(); ++i)
+      _workers.push_back(std::make_unique<Worker>());
+
+    _threads.reserve(placement.size());
+    for (std::size_t i = 0; i < placement.size(); ++i)
+    {
+      _threads.emplace_back(
+        [this, i, cpus = placement[i]]()
+        {
+          pin_this_thread(cpus);
+          _work(i);
+        });
+    }
+  }
+
+  ~WorkStealingExecutor()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_sleep_mutex);
+      _quit = true;
+    }
+    _sleep_cv.notify_all();
+
+    for (auto& thread : _threads)
+      thread.join();
+  }
+
+  void post(Task task, const Priority priority) final
+  {
+    // The pending count goes up before the task is visible to the workers so
+    // that it can never drop below the number of tasks that are in the queues.
+    {
+      std::lock_guard<std::mutex> lock(_sleep_mutex);
+      ++_pending;
+    }
+
+    // Tasks that are posted by a task stay with the worker that posted them,
+    // since they are likely to use the same data.
+    std::size_t w = _next_worker++ % _workers.size();
+    if (current_worker.executor == this)
+      w = current_worker.index;
+
+    auto& worker = *_workers[w];
+    {
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      worker.tasks[static_cast<std::size_t>(priority)].push_back(
+        std::move(task));
+    }
+
+    _sleep_cv.notify_one();
+  }
+
+  std::size_t concurrency() const final
+  {
+    return _threads.size();
+  }
+
+private:
+
+  static constexpr std::size_t NumPriorities = 3;
+
+  struct Worker
+  {
+    std::mutex mutex;
+    std::array<std::deque<Task>, NumPriorities> tasks;
+  };
+
+  struct CurrentWorker
+  {
+    const WorkStealingExecutor* executor = nullptr;
+    std::size_t index = 0;
+  };
+
+  static thread_local CurrentWorker current_worker;
+
+  /// Take the newest task of worker i with priority p
+  bool _pop(const std::size_t i, const std::size_t p, Task& task)
+  {
+    auto& worker = *_workers[i];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    auto& tasks = worker.tasks[p];
+    if (tasks.empty())
+      return false;
+
+    task = std::move(tasks.back());
+    tasks.pop_back();
+    --_pending;
+    return true;
+  }
+
+  /// Take the oldest task with priority p of any worker other than i
+  bool _steal(const std::size_t i, const std::size_t p, Task& task)
+  {
+    for (std::size_t k = 1; k < _workers.size(); ++k)
+    {
+      auto& victim = *_workers[(i + k) % _workers.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      auto& tasks = victim.tasks[p];
+      if (tasks.empty())
+        continue;
+
+      task = std::move(tasks.front());
+      tasks.pop_front();
+      --_pending;
+      return true;
+    }
+
+    return false;
+  }
+
+  /// Find the most urgent task that worker i can take
+  bool _take(const std::size_t i, Task& task)
+  {
+    for (std::size_t p = NumPriorities; p-- > 0; )
+    {
+      if (_pop(i, p, task) || _steal(i, p, task))
+        return true;
+    }
+
+    return false;
+  }
+
+  void _work(const std::size_t i)
+  {
+    current_worker = CurrentWorker{this, i};
+
+    Task task;
+    while (true)
+    {
+      if (_take(i, task))
+      {
+        task();
+        task = nullptr;
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(_sleep_mutex);
+      _sleep_cv.wait(lock, [&]() { return _quit || _pending.load() > 0; });
+
+      // Every task that was posted before the executor was destroyed gets
+      // finished before the workers stop.
+      if (_quit && _pending.load() == 0)
+        return;
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> _workers;
+  std::atomic_size_t _next_worker = 0;
+
+  std::mutex _sleep_mutex;
+  std::condition_variable _sleep_cv;
+  std::atomic_size_t _pending = 0;
+  bool _quit = false;
+
+  std::vector<std::thread> _threads;
+};
+
+thread_local WorkStealingExecutor::CurrentWorker
+WorkStealingExecutor::current_worker;
+
+//==============================================================================
+/// The calls of one Executor::run()
+struct RunJob
+{
+  std::size_t count;
+  const std::function<void(std::size_t)>* task;
+  std::atomic_size_t next = 0;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::size_t finished = 0;
+  std::exception_ptr error;
+
+  /// Work on calls of this job until none are left to start. The task is only
+  /// used while some call has not been started, so a helper that runs after
+  /// the job has finished will not touch it.
+  void work()
+  {
+    std::size_t completed = 0;
+    std::exception_ptr exception;
+    for (std::size_t i = next++; i < count; i = next++)
+    {
+      try
+      {
+        (*task)(i);
+      }
+      catch (...)
+      {
+        if (!exception)
+          exception = std::current_exception();
+      }
+
+      ++completed;
+    }
+
+    if (completed == 0)
+      return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished += completed;
+    if (exception && !error)
+      error = exception;
+
+    if (finished == count)
+      cv.notify_all();
+  }
+};
+} // anonymous namespace
+
+//==============================================================================
+std::shared_ptr<Executor> Executor::make(Config config)
+{
+  return std::make_shared<WorkStealingExecutor>(config);
+}
+
+//==============================================================================
+std::shared_ptr<Executor> Executor::make()
+{
+  return make(Config());
+}
+
+//==============================================================================
+const std::shared_ptr<Executor>& Executor::shared()
+{
+  static const std::shared_ptr<Executor> executor = make();
+  return executor;
+}
+
+//==============================================================================
+void Executor::run(
+  const std::size_t count,
+  const std::function<void(std::size_t)>& task,
+  const std::size_t max_threads,
+  const Priority priority)
+{
+  if (count == 0)
+    return;
+
+  auto job = std::make_shared<RunJob>();
+  job->count = count;
+  job->task = &task;
+
+  std::size_t threads = concurrency() + 1;
+  if (max_threads > 0)
+    threads = std::min(threads, max_threads);
+
+  const std::size_t helpers = std::min(threads, count) - 1;
+  for (std::size_t i = 0; i < helpers; ++i)
+    post([job]() { job->work(); }, priority);
+
+  job->work();
+
+  std::unique_lock<std::mutex> lock(job->mutex);
+  job->cv.wait(lock, [&]() { return job->finished == count; });
+
+  if (job->error)
+    std::rethrow_exception(job->error);
+}
+
+} // namespace rmf_traffic
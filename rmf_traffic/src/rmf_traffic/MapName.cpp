@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_MapName.hpp"
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace rmf_traffic {
+
+namespace {
+//==============================================================================
+struct Registry
+{
+  std::shared_mutex mutex;
+
+  // The keys of an unordered_map never move, so MapName can point at them
+  std::unordered_map<std::string, MapName::Id> ids;
+
+  // The names of the IDs, in order of ID
+  std::vector<const std::string*> names;
+};
+
+//==============================================================================
+Registry& registry()
+{
+  // This is never destroyed, so map names can still be used by objects that
+  // are destroyed during static destruction.
+  static Registry* const instance = new Registry;
+  return *instance;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+MapName::MapName()
+{
+  static const MapName empty{std::string()};
+  *this = empty;
+}
+
+//==============================================================================
+MapName::MapName(const std::string& name)
+{
+  Registry& r = registry();
+  {
+    std::shared_lock<std::shared_mutex> lock(r.mutex);
+    const auto it = r.ids.find(name);
+    if (it != r.ids.end())
+    {
+      _id = it->second;
+      _name = &it->first;
+      return;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(r.mutex);
+  const auto [it, inserted] =
+    r.ids.insert({name, static_cast<Id>(r.ids.size())});
+  if (inserted)
+    r.names.push_back(&it->first);
+
+  _id = it->second;
+  _name = &it->first;
+}
+
+//==============================================================================
+std::optional<MapName::Id> MapName::find(const std::string& name)
+{
+  Registry& r = registry();
+  std::shared_lock<std::shared_mutex> lock(r.mutex);
+  const auto it = r.ids.find(name);
+  if (it == r.ids.end())
+    return std::nullopt;
+
+  return it->second;
+}
+
+//==============================================================================
+const std::string& MapName::str(const Id id)
+{
+  Registry& r = registry();
+  std::shared_lock<std::shared_mutex> lock(r.mutex);
+  return *r.names.at(id);
+}
+
+} // namespace rmf_traffic
@@ -17,6 +17,8 @@
 
 #include "MotionInternal.hpp"
 
+#include <algorithm>
+
 namespace rmf_traffic {
 
 //==============================================================================
@@ -33,25 +35,20 @@ std::unique_ptr<Motion> Motion::compute_cubic_splines(
     // *INDENT-ON*
   }
 
-  using const_iterator = internal::WaypointList::const_iterator;
-  const const_iterator begin = internal::get_raw_iterator(input_begin);
-  const const_iterator end = internal::get_raw_iterator(input_end);
+  const std::size_t begin = internal::get_index(input_begin);
+  const std::size_t end = internal::get_index(input_end);
 
-  if (++const_iterator(begin) == end)
+  if (begin + 1 == end)
   {
-    const auto& point = *begin;
+    const auto& point = *input_begin;
     return std::make_unique<SinglePointMotion>(
-      point.data.time, point.data.position, point.data.velocity);
+      point.time(), point.position(), point.velocity());
   }
 
-  std::vector<Spline> splines;
-  for (auto it = ++const_iterator(begin); it != end; ++it)
-    splines.emplace_back(Spline(it));
-
-  if (splines.size() == 1)
-    return std::make_unique<SplineMotion>(std::move(splines[0]));
-
-  return std::make_unique<PiecewiseSplineMotion>(std::move(splines));
+  // The segment that finishes at the first waypoint of the range is not part
+  // of the motion.
+  return std::make_unique<PiecewiseSplineMotion>(
+    internal::get_segment_cache(input_begin), begin + 1, end);
 }
 
 //==============================================================================
@@ -61,6 +58,17 @@ std::unique_ptr<Motion> Motion::compute_cubic_splines(
   return compute_cubic_splines(trajectory.begin(), trajectory.end());
 }
 
+//==============================================================================
+Eigen::Matrix3Xd Motion::compute_positions(
+  const std::vector<Time>& times) const
+{
+  Eigen::Matrix3Xd positions(3, static_cast<Eigen::Index>(times.size()));
+  for (std::size_t k = 0; k < times.size(); ++k)
+    positions.col(static_cast<Eigen::Index>(k)) = compute_position(times[k]);
+
+  return positions;
+}
+
 //==============================================================================
 SinglePointMotion::SinglePointMotion(
   const Time t,
@@ -104,84 +112,111 @@ Eigen::Vector3d SinglePointMotion::compute_acceleration(Time /*t*/) const
 }
 
 //==============================================================================
-SplineMotion::SplineMotion(Spline spline)
-: _spline(std::move(spline))
+PiecewiseSplineMotion::PiecewiseSplineMotion(
+  internal::ConstSegmentCachePtr cache,
+  const std::size_t begin,
+  const std::size_t end)
+: _cache(std::move(cache)),
+  _begin(begin),
+  _end(end),
+  _hint(begin)
 {
-  // Do nothing
+  assert(_cache);
+  assert(1 <= _begin && _begin < _end && _end <= _cache->times.size());
 }
 
 //==============================================================================
-Time SplineMotion::start_time() const
+PiecewiseSplineMotion::PiecewiseSplineMotion(const Trajectory& trajectory)
+: PiecewiseSplineMotion(
+    internal::get_segment_cache(trajectory), 1, trajectory.size())
 {
-  return _spline.start_time();
+  // Do nothing
 }
 
 //==============================================================================
-Time SplineMotion::finish_time() const
+Time PiecewiseSplineMotion::start_time() const
 {
-  return _spline.finish_time();
+  return _cache->times[_begin - 1];
 }
 
 //==============================================================================
-Eigen::Vector3d SplineMotion::compute_position(Time t) const
+Time PiecewiseSplineMotion::finish_time() const
 {
-  return _spline.compute_position(t);
+  return _cache->times[_end - 1];
 }
 
 //==============================================================================
-Eigen::Vector3d SplineMotion::compute_velocity(Time t) const
+Eigen::Vector3d PiecewiseSplineMotion::compute_position(Time t) const
 {
-  return _spline.compute_velocity(t);
+  return find_spline(t).compute_position(t);
 }
 
 //==============================================================================
-Eigen::Vector3d SplineMotion::compute_acceleration(Time t) const
+Eigen::Vector3d PiecewiseSplineMotion::compute_velocity(Time t) const
 {
-  return _spline.compute_acceleration(t);
+  return find_spline(t).compute_velocity(t);
 }
 
 //==============================================================================
-PiecewiseSplineMotion::PiecewiseSplineMotion(std::vector<Spline> splines)
+Eigen::Vector3d PiecewiseSplineMotion::compute_acceleration(Time t) const
 {
-  assert(!splines.empty());
-  for (auto& spline : splines)
-  {
-    const Time t = spline.finish_time();
-    _splines.insert(std::make_pair(t, std::move(spline)));
-  }
-
-  _start_time = _splines.begin()->second.start_time();
-  _finish_time = _splines.rbegin()->second.finish_time();
+  return find_spline(t).compute_acceleration(t);
 }
 
 //==============================================================================
-Time PiecewiseSplineMotion::start_time() const
+Eigen::Matrix3Xd PiecewiseSplineMotion::compute_positions(
+  const std::vector<Time>& times) const
 {
-  return _start_time;
-}
+  Eigen::Matrix3Xd positions(3, static_cast<Eigen::Index>(times.size()));
+  std::vector<Time> batch;
 
-//==============================================================================
-Time PiecewiseSplineMotion::finish_time() const
-{
-  return _finish_time;
-}
+  // Each run of times that falls inside of one segment is evaluated by its
+  // spline in a single batch.
+  std::size_t first = 0;
+  while (first < times.size())
+  {
+    const std::size_t index = find_segment(times[first]);
+    const auto in_segment = [&](const Time t)
+      {
+        return (index == _begin || _cache->times[index-1] < t)
+          && (index == _end - 1 || t <= _cache->times[index]);
+      };
+
+    std::size_t last = first + 1;
+    while (last < times.size() && in_segment(times[last]))
+      ++last;
+
+    batch.assign(times.begin() + first, times.begin() + last);
+    positions.middleCols(
+      static_cast<Eigen::Index>(first),
+      static_cast<Eigen::Index>(last - first)) =
+      Spline(_cache->splines[index]).compute_positions(batch);
+
+    first = last;
+  }
 
-//==============================================================================
-Eigen::Vector3d PiecewiseSplineMotion::compute_position(Time t) const
-{
-  return _splines.lower_bound(t)->second.compute_position(t);
+  return positions;
 }
 
 //==============================================================================
-Eigen::Vector3d PiecewiseSplineMotion::compute_velocity(Time t) const
+std::size_t PiecewiseSplineMotion::find_segment(Time t) const
 {
-  return _splines.lower_bound(t)->second.compute_velocity(t);
+  // The time of each waypoint is the finish time of the segment that ends at
+  // it, so the first waypoint that is not earlier than t ends the segment that
+  // contains t.
+  std::size_t index = internal::seek_time(
+    _cache->times, _hint.load(std::memory_order_relaxed), t);
+
+  // Times outside of the motion use the nearest segment.
+  index = std::clamp(index, _begin, _end - 1);
+  _hint.store(index, std::memory_order_relaxed);
+  return index;
 }
 
 //==============================================================================
-Eigen::Vector3d PiecewiseSplineMotion::compute_acceleration(Time t) const
+Spline PiecewiseSplineMotion::find_spline(Time t) const
 {
-  return _splines.lower_bound(t)->second.compute_acceleration(t);
+  return Spline(_cache->splines[find_segment(t)]);
 }
 
 } // namespace rmf_traffic
@@ -22,6 +22,9 @@
 
 #include "Spline.hpp"
 
+#include <atomic>
+#include <vector>
+
 namespace rmf_traffic {
 
 //==============================================================================
@@ -49,42 +52,56 @@ private:
 };
 
 //==============================================================================
-class SplineMotion : public Motion
+/// The motion of a span of segments of a trajectory. The splines are read
+/// straight out of the segment cache of the trajectory, which is shared with
+/// conflict detection and only recomputed after the trajectory is changed, so
+/// creating this motion and sampling it never allocate. The motion holds onto
+/// the cache, so it describes the trajectory as it was when the motion was
+/// created, even if the trajectory is changed or destroyed afterwards.
+///
+/// This can be created on the stack by code that samples a trajectory many
+/// times, instead of going through Motion::compute_cubic_splines.
+class PiecewiseSplineMotion : public Motion
 {
 public:
 
-  SplineMotion(Spline spline);
+  /// Follow the segments that finish at the waypoints with indices in the
+  /// range [begin, end). There must be at least one such segment, and begin
+  /// must be at least 1, since no segment finishes at the first waypoint.
+  PiecewiseSplineMotion(
+    internal::ConstSegmentCachePtr cache,
+    std::size_t begin,
+    std::size_t end);
+
+  /// Follow all the segments of a trajectory, which must have at least two
+  /// waypoints.
+  explicit PiecewiseSplineMotion(const Trajectory& trajectory);
 
   Time start_time() const final;
   Time finish_time() const final;
   Eigen::Vector3d compute_position(Time t) const final;
   Eigen::Vector3d compute_velocity(Time t) const final;
   Eigen::Vector3d compute_acceleration(Time t) const final;
+  Eigen::Matrix3Xd compute_positions(
+    const std::vector<Time>& times) const final;
 
 private:
 
-  Spline _spline;
-
-};
+  /// Get the index of the segment that should be used for time t
+  std::size_t find_segment(Time t) const;
 
-//==============================================================================
-class PiecewiseSplineMotion : public Motion
-{
-public:
+  /// Get the spline that should be used for time t
+  Spline find_spline(Time t) const;
 
-  PiecewiseSplineMotion(std::vector<Spline> splines);
-
-  Time start_time() const final;
-  Time finish_time() const final;
-  Eigen::Vector3d compute_position(Time t) const final;
-  Eigen::Vector3d compute_velocity(Time t) const final;
-  Eigen::Vector3d compute_acceleration(Time t) const final;
-
-private:
+  internal::ConstSegmentCachePtr _cache;
+  std::size_t _begin;
+  std::size_t _end;
 
-  std::map<Time, Spline> _splines;
-  Time _start_time;
-  Time _finish_time;
+  // The index of the segment that was used most recently. Motions are usually
+  // sampled at increasing times, so the next segment is almost always the same
+  // one or the one after it. This is only a hint, so concurrent samples may
+  // freely overwrite it.
+  mutable std::atomic<std::size_t> _hint;
 
 };
 
@@ -17,8 +17,43 @@
 
 #include "ProfileInternal.hpp"
 
+#include <rmf_traffic/geometry/Circle.hpp>
+
 namespace rmf_traffic {
 
+namespace {
+//==============================================================================
+std::optional<double> get_circle_radius(
+  const geometry::ConstFinalConvexShapePtr& shape)
+{
+  if (!shape)
+    return std::nullopt;
+
+  const auto* circle = dynamic_cast<const geometry::Circle*>(&shape->source());
+  if (!circle)
+    return std::nullopt;
+
+  return circle->get_radius();
+}
+} // anonymous namespace
+
+//==============================================================================
+void Profile::Implementation::update_plan()
+{
+  plan.vicinity = vicinity ? vicinity : footprint;
+
+  plan.footprint_radius =
+    footprint ? footprint->get_characteristic_length() : 0.0;
+  plan.vicinity_radius =
+    plan.vicinity ? plan.vicinity->get_characteristic_length() : 0.0;
+
+  plan.footprint_circle = get_circle_radius(footprint);
+  plan.vicinity_circle = get_circle_radius(plan.vicinity);
+
+  plan.symmetric = (plan.vicinity == footprint)
+    || (plan.vicinity && footprint && *plan.vicinity == *footprint);
+}
+
 //==============================================================================
 Profile::Profile(
   geometry::ConstFinalConvexShapePtr footprint,
@@ -26,10 +61,11 @@ Profile::Profile(
 : _pimpl(rmf_utils::make_impl<Implementation>(
       Implementation{
         std::move(footprint),
-        std::move(vicinity)
+        std::move(vicinity),
+        {}
       }))
 {
-  // Do nothing
+  _pimpl->update_plan();
 }
 
 //==============================================================================
@@ -47,7 +83,11 @@ bool Profile::operator==(const Profile& rhs) const
 
   const auto& self_footprint = footprint();
   const auto& other_footprint = rhs.footprint();
-  if (self_footprint && other_footprint)
+  if (self_footprint == other_footprint)
+  {
+    // Both profiles use the same shape, which is common for interned shapes
+  }
+  else if (self_footprint && other_footprint)
   {
     // Both pointers are valid so check what they point to for equality
     if (*self_footprint != *other_footprint)
@@ -64,7 +104,11 @@ bool Profile::operator==(const Profile& rhs) const
   // if a vicinity was never specified.
   const auto& self_vicinity = vicinity();
   const auto& other_vicinity = rhs.vicinity();
-  if (self_vicinity && other_vicinity)
+  if (self_vicinity == other_vicinity)
+  {
+    // Both profiles use the same shape, which is common for interned shapes
+  }
+  else if (self_vicinity && other_vicinity)
   {
     // Both pointers are valid so check what they point to for equality
     if (*self_vicinity != *other_vicinity)
@@ -83,6 +127,7 @@ bool Profile::operator==(const Profile& rhs) const
 Profile& Profile::footprint(geometry::ConstFinalConvexShapePtr shape)
 {
   _pimpl->footprint = std::move(shape);
+  _pimpl->update_plan();
   return *this;
 }
 
@@ -96,6 +141,7 @@ const geometry::ConstFinalConvexShapePtr& Profile::footprint() const
 Profile& Profile::vicinity(geometry::ConstFinalConvexShapePtr shape)
 {
   _pimpl->vicinity = std::move(shape);
+  _pimpl->update_plan();
   return *this;
 }
 
@@ -20,6 +20,8 @@
 
 #include <rmf_traffic/Profile.hpp>
 
+#include <optional>
+
 namespace rmf_traffic {
 
 //==============================================================================
@@ -27,8 +29,41 @@ class Profile::Implementation
 {
 public:
 
+  /// Information about the shapes of a profile that conflict detection needs.
+  /// This is computed whenever the footprint or vicinity changes so that it
+  /// does not need to be worked out for every conflict check.
+  struct CollisionPlan
+  {
+    /// The vicinity to use for conflict detection. This is the footprint if no
+    /// vicinity was given.
+    geometry::ConstFinalConvexShapePtr vicinity;
+
+    /// The characteristic length of the footprint, or 0 if there is none
+    double footprint_radius = 0.0;
+
+    /// The characteristic length of the vicinity, or 0 if there is none
+    double vicinity_radius = 0.0;
+
+    /// The radius of the footprint if it is a circle
+    std::optional<double> footprint_circle;
+
+    /// The radius of the vicinity if it is a circle
+    std::optional<double> vicinity_circle;
+
+    /// True if the vicinity is the same shape as the footprint. When two
+    /// symmetric profiles are compared, checking the footprint of A against
+    /// the vicinity of B is the same as checking the vicinity of A against the
+    /// footprint of B, so only one of those checks is needed.
+    bool symmetric = true;
+  };
+
   geometry::ConstFinalConvexShapePtr footprint;
   geometry::ConstFinalConvexShapePtr vicinity;
+  CollisionPlan plan;
+
+  /// Recompute the plan. This must be called whenever footprint or vicinity
+  /// is changed.
+  void update_plan();
 
   static const Implementation& get(const Profile& profile)
   {
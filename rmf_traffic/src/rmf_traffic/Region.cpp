@@ -15,46 +15,10 @@
  *
 */
 
-#include <rmf_traffic/Region.hpp>
-
-#include "detail/internal_bidirectional_iterator.hpp"
-
-#include <rmf_utils/optional.hpp>
+#include "internal_Region.hpp"
 
 namespace rmf_traffic {
 
-//==============================================================================
-class Region::IterImpl
-{
-public:
-
-  std::vector<geometry::Space>::iterator iter;
-
-};
-
-//==============================================================================
-class Region::Implementation
-{
-public:
-
-  std::string map;
-  rmf_utils::optional<Time> lower_bound;
-  rmf_utils::optional<Time> upper_bound;
-
-  using Spaces = std::vector<geometry::Space>;
-  Spaces spaces;
-
-  using raw_iterator = Spaces::iterator;
-  static iterator make_iterator(raw_iterator it)
-  {
-    iterator result;
-    result._pimpl = rmf_utils::make_impl<iterator::Implementation>(
-      iterator::Implementation{it});
-    return result;
-  }
-
-};
-
 //==============================================================================
 Region::Region(
   std::string map,
@@ -88,13 +52,13 @@ Region::Region(
 //==============================================================================
 const std::string& Region::get_map() const
 {
-  return _pimpl->map;
+  return _pimpl->map.str();
 }
 
 //==============================================================================
 auto Region::set_map(std::string map) -> Region&
 {
-  _pimpl->map = std::move(map);
+  _pimpl->map = MapName(map);
   return *this;
 }
 
@@ -233,7 +197,7 @@ bool operator==(
   const Region& lhs,
   const Region& rhs)
 {
-  if (lhs.get_map() != rhs.get_map() ||
+  if (RegionData::get_map(lhs) != RegionData::get_map(rhs) ||
     lhs.num_spaces() != rhs.num_spaces())
   {
     return false;
@@ -15,10 +15,14 @@
  *
 */
 
+#include "internal_MemoryUsage.hpp"
 #include "internal_Route.hpp"
+#include "TrajectoryInternal.hpp"
 
 #include <rmf_utils/Modular.hpp>
 
+#include <functional>
+
 namespace rmf_traffic {
 
 //==============================================================================
@@ -115,12 +119,7 @@ Route::Route(
   std::string map,
   Trajectory trajectory)
 : _pimpl(rmf_utils::make_impl<Implementation>(
-      Implementation{
-        std::move(map),
-        std::move(trajectory),
-        {},
-        {}
-      }))
+      std::move(map), std::move(trajectory)))
 {
   // Do nothing
 }
@@ -128,33 +127,36 @@ Route::Route(
 //==============================================================================
 Route& Route::map(std::string value)
 {
-  _pimpl->map = std::move(value);
+  _pimpl->map = MapName(value);
   return *this;
 }
 
 //==============================================================================
 const std::string& Route::map() const
 {
-  return _pimpl->map;
+  return _pimpl->map.str();
 }
 
 //==============================================================================
 Route& Route::trajectory(Trajectory value)
 {
-  _pimpl->trajectory = std::move(value);
+  _pimpl->trajectory = std::make_shared<Trajectory>(std::move(value));
+  _pimpl->exposed = false;
+  _pimpl->delay = Duration(0);
+  std::atomic_store(&_pimpl->delayed, std::shared_ptr<const Trajectory>());
   return *this;
 }
 
 //==============================================================================
 Trajectory& Route::trajectory()
 {
-  return _pimpl->trajectory;
+  return _pimpl->mutable_trajectory();
 }
 
 //==============================================================================
 const Trajectory& Route::trajectory() const
 {
-  return _pimpl->trajectory;
+  return _pimpl->view_trajectory();
 }
 
 //==============================================================================
@@ -273,4 +275,148 @@ const DependsOnCheckpoint* Route::check_dependencies(
   return &r_it->second;
 }
 
+namespace {
+//==============================================================================
+void hash_combine(std::size_t& seed, const std::size_t value)
+{
+  seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+//==============================================================================
+bool same_dependencies(
+  const DependsOnParticipant& a,
+  const DependsOnParticipant& b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (const auto& [participant, plan] : a)
+  {
+    const auto it = b.find(participant);
+    if (it == b.end())
+      return false;
+
+    const auto& other = it->second;
+    if (plan.plan() != other.plan() || plan.routes() != other.routes())
+      return false;
+  }
+
+  return true;
+}
+} // anonymous namespace
+
+//==============================================================================
+std::size_t Route::Implementation::hash(const Route& route)
+{
+  const auto& data = *route._pimpl;
+  std::size_t seed = std::hash<MapName::Id>()(data.map.id());
+
+  // The pending delay is added to the times instead of being applied to the
+  // waypoints, so hashing a delayed route does not need to copy it.
+  for (const auto& wp : *data.trajectory)
+  {
+    const Time time = wp.time() + data.delay;
+    hash_combine(seed, std::hash<int64_t>()(time.time_since_epoch().count()));
+
+    const Eigen::Vector3d p = wp.position();
+    const Eigen::Vector3d v = wp.velocity();
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      hash_combine(seed, std::hash<double>()(p[i]));
+      hash_combine(seed, std::hash<double>()(v[i]));
+    }
+  }
+
+  for (const auto checkpoint : data.checkpoints)
+    hash_combine(seed, std::hash<uint64_t>()(checkpoint));
+
+  // The dependencies are unordered, so their hashes are summed to make the
+  // result independent of the order that they are visited in.
+  std::size_t dependencies = 0;
+  for (const auto& [participant, plan] : data.dependencies)
+  {
+    std::size_t d = std::hash<ParticipantId>()(participant);
+    hash_combine(d, plan.plan().has_value() ? *plan.plan() + 1 : 0);
+
+    std::size_t routes = 0;
+    for (const auto& [route_id, checkpoints] : plan.routes())
+    {
+      std::size_t r = std::hash<RouteId>()(route_id);
+      for (const auto& [dependent, on] : checkpoints)
+      {
+        hash_combine(r, dependent);
+        hash_combine(r, on);
+      }
+
+      routes += r;
+    }
+
+    hash_combine(d, routes);
+    dependencies += d;
+  }
+
+  hash_combine(seed, dependencies);
+  return seed;
+}
+
+//==============================================================================
+std::size_t Route::Implementation::memory_usage(const Route& route)
+{
+  const auto& data = *route._pimpl;
+  std::size_t bytes = sizeof(Route::Implementation)
+    + sizeof(Trajectory) + internal::memory_usage(*data.trajectory)
+    + internal::tree_bytes(data.checkpoints)
+    + internal::hash_table_bytes(data.dependencies);
+
+  if (const auto delayed = std::atomic_load(&data.delayed))
+    bytes += sizeof(Trajectory) + internal::memory_usage(*delayed);
+
+  for (const auto& [_, plan] : data.dependencies)
+  {
+    bytes += sizeof(DependsOnPlan::Implementation)
+      + internal::hash_table_bytes(plan.routes());
+
+    for (const auto& [route_id, checkpoints] : plan.routes())
+      bytes += internal::tree_bytes(checkpoints);
+  }
+
+  return bytes;
+}
+
+//==============================================================================
+bool Route::Implementation::same_content(const Route& a, const Route& b)
+{
+  const auto& x = *a._pimpl;
+  const auto& y = *b._pimpl;
+  if (x.map != y.map || x.checkpoints != y.checkpoints)
+    return false;
+
+  if (!same_dependencies(x.dependencies, y.dependencies))
+    return false;
+
+  // Routes that were copied from each other usually share their trajectory
+  if (x.trajectory == y.trajectory && x.delay == y.delay)
+    return true;
+
+  const Trajectory& tx = *x.trajectory;
+  const Trajectory& ty = *y.trajectory;
+  if (tx.size() != ty.size())
+    return false;
+
+  auto it_y = ty.begin();
+  for (auto it_x = tx.begin(); it_x != tx.end(); ++it_x, ++it_y)
+  {
+    if (it_x->time() + x.delay != it_y->time() + y.delay)
+      return false;
+
+    if (it_x->position() != it_y->position())
+      return false;
+
+    if (it_x->velocity() != it_y->velocity())
+      return false;
+  }
+
+  return true;
+}
+
 } // namespace rmf_traffic
@@ -17,6 +17,8 @@
 
 #include "Spline.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <unordered_set>
 
 namespace rmf_traffic {
@@ -153,12 +155,12 @@ Eigen::Vector3d compute_position(
   const Spline::Parameters& params,
   const double time)
 {
-  Eigen::Vector3d result = Eigen::Vector3d::Zero();
+  // Horner's method
+  Eigen::Vector3d result;
   for (int i = 0; i < 3; ++i)
   {
-    const Eigen::Vector4d coeffs = params.coeffs[i];
-    for (int j = 0; j < 4; ++j)
-      result[i] += coeffs[j] * pow(time, j);
+    const Eigen::Vector4d& c = params.coeffs[i];
+    result[i] = ((c[3]*time + c[2])*time + c[1])*time + c[0];
   }
 
   return result;
@@ -169,13 +171,12 @@ Eigen::Vector3d compute_velocity(
   const Spline::Parameters& params,
   const double time)
 {
-  Eigen::Vector3d result = Eigen::Vector3d::Zero();
+  Eigen::Vector3d result;
   for (int i = 0; i < 3; ++i)
   {
-    const Eigen::Vector4d coeffs = params.coeffs[i];
+    const Eigen::Vector4d& c = params.coeffs[i];
     // Note: This is computing the derivative of the polynomial w.r.t. time
-    for (int j = 1; j < 4; ++j)
-      result[i] += j * coeffs[j] * pow(time, j-1);
+    result[i] = (3.0*c[3]*time + 2.0*c[2])*time + c[1];
   }
 
   return result;
@@ -186,18 +187,157 @@ Eigen::Vector3d compute_acceleration(
   const Spline::Parameters& params,
   const double time)
 {
-  Eigen::Vector3d result = Eigen::Vector3d::Zero();
+  Eigen::Vector3d result;
   for (int i = 0; i < 3; ++i)
   {
-    const Eigen::Vector4d coeffs = params.coeffs[i];
+    const Eigen::Vector4d& c = params.coeffs[i];
     // Note: This is computing the second derivative w.r.t. time
-    for (int j = 2; j < 4; ++j)
-      result[i] += j * (j-1) * coeffs[j] * pow(time, j-2);
+    result[i] = 6.0*c[3]*time + 2.0*c[2];
   }
 
   return result;
 }
 
+//==============================================================================
+/// Arrange the coefficients so that each row holds one dimension (x, y, yaw)
+/// and each column holds one power of the scaled time.
+Eigen::Matrix<double, 3, 4> coefficient_matrix(const Spline::Parameters& params)
+{
+  Eigen::Matrix<double, 3, 4> C;
+  for (int i = 0; i < 3; ++i)
+    C.row(i) = params.coeffs[i].transpose();
+
+  return C;
+}
+
+//==============================================================================
+/// Compute the matrix of scaled time powers where column k is
+/// [1, s_k, s_k^2, s_k^3] for the scaled time s_k of times[k].
+Eigen::Matrix4Xd time_power_matrix(
+  const Spline::Parameters& params,
+  const std::vector<Time>& times)
+{
+  Eigen::Matrix4Xd P(4, static_cast<Eigen::Index>(times.size()));
+  for (std::size_t k = 0; k < times.size(); ++k)
+  {
+    const double s = compute_scaled_time(times[k], params);
+    P(0, k) = 1.0;
+    P(1, k) = s;
+    P(2, k) = s*s;
+    P(3, k) = s*s*s;
+  }
+
+  return P;
+}
+
+//==============================================================================
+double evaluate_spline(
+  const Eigen::Vector4d& coeffs,
+  const double t)
+{
+  // Assume time is parameterized [0,1]
+  return coeffs[3] * t * t * t
+    + coeffs[2] * t * t
+    + coeffs[1] * t
+    + coeffs[0];
+}
+
+//==============================================================================
+void add_extremum_candidate(
+  std::vector<double>& candidates,
+  const Eigen::Vector4d& coeffs,
+  const double t)
+{
+  // Critical points outside of the unit domain are not part of the motion of
+  // the spline, so they should not widen its bounds.
+  if (t <= 0.0 || 1.0 <= t)
+    return;
+
+  candidates.emplace_back(evaluate_spline(coeffs, t));
+}
+
+//==============================================================================
+std::array<double, 2> get_local_extrema(
+  const Eigen::Vector4d& coeffs)
+{
+  std::vector<double> extrema_candidates;
+  // Store boundary values as potential extrema
+  extrema_candidates.emplace_back(evaluate_spline(coeffs, 0));
+  extrema_candidates.emplace_back(evaluate_spline(coeffs, 1));
+
+  // When derivate of spline motion is not quadratic
+  if (std::abs(coeffs[3]) < 1e-12)
+  {
+    if (std::abs(coeffs[2]) > 1e-12)
+    {
+      double t = -coeffs[1] / (2 * coeffs[2]);
+      add_extremum_candidate(extrema_candidates, coeffs, t);
+    }
+  }
+  else
+  {
+    // Calculate the discriminant otherwise
+    const double D = (4 * pow(coeffs[2], 2) - 12 * coeffs[3] * coeffs[1]);
+
+    if (std::abs(D) < 1e-4)
+    {
+      const double t = (-2 * coeffs[2]) / (6 * coeffs[3]);
+      add_extremum_candidate(extrema_candidates, coeffs, t);
+    }
+    else if (D < 0)
+    {
+      // If D is negative, then the local extrema would be imaginary. This will
+      // happen for splines that have no local extrema. When that happens, the
+      // endpoints of the spline are the only extrema.
+    }
+    else
+    {
+      const double t1 = ((-2 * coeffs[2]) + std::sqrt(D)) / (6 * coeffs[3]);
+      const double t2 = ((-2 * coeffs[2]) - std::sqrt(D)) / (6 * coeffs[3]);
+
+      add_extremum_candidate(extrema_candidates, coeffs, t1);
+      add_extremum_candidate(extrema_candidates, coeffs, t2);
+    }
+  }
+
+  std::array<double, 2> extrema;
+  assert(!extrema_candidates.empty());
+  extrema[0] = *std::min_element(
+    extrema_candidates.begin(),
+    extrema_candidates.end());
+  extrema[1] = *std::max_element(
+    extrema_candidates.begin(),
+    extrema_candidates.end());
+
+  return extrema;
+}
+
+//==============================================================================
+#ifdef RMF_TRAFFIC__USING_FCL_0_6
+using FclVec3 = fcl::Vector3d;
+#else
+using FclVec3 = fcl::Vec3f;
+#endif
+
+//==============================================================================
+void compute_fcl_knots(
+  const Spline& spline,
+  const Time start_time,
+  const Time finish_time,
+  std::array<FclVec3, 4>& Td,
+  std::array<FclVec3, 4>& Rd)
+{
+  const std::array<Eigen::Vector3d, 4> knots =
+    spline.compute_knots(start_time, finish_time);
+
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    const Eigen::Vector3d& p = knots[i];
+    Td[i] = FclVec3(p[0], p[1], 0.0);
+    Rd[i] = FclVec3(0.0, 0.0, p[2]);
+  }
+}
+
 } // anonymous namespace
 
 //==============================================================================
@@ -217,6 +357,13 @@ Spline::Spline(const internal::WaypointList::const_iterator& it)
   // Do nothing
 }
 
+//==============================================================================
+Spline::Spline(const internal::SplineParameters& params_)
+: params(params_)
+{
+  // Do nothing
+}
+
 //==============================================================================
 std::array<Eigen::Vector3d, 4> Spline::compute_knots(
   const Time start_time, const Time finish_time) const
@@ -257,26 +404,80 @@ std::array<Eigen::Vector3d, 4> Spline::compute_knots(
 FclSplineMotion Spline::to_fcl(
   const Time start_time, const Time finish_time) const
 {
+  std::array<FclVec3, 4> Td;
+  std::array<FclVec3, 4> Rd;
+  compute_fcl_knots(*this, start_time, finish_time, Td, Rd);
+
+  return FclSplineMotion(
+    Td[0], Td[1], Td[2], Td[3],
+    Rd[0], Rd[1], Rd[2], Rd[3]);
+}
+
+//==============================================================================
+namespace {
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
-  using FclVec3 = fcl::Vector3d;
+const fcl::Matrix3d uninitialized_R;
 #else
-  using FclVec3 = fcl::Vec3f;
+const fcl::Matrix3f uninitialized_R;
 #endif
-  std::array<Eigen::Vector3d, 4> knots = compute_knots(start_time, finish_time);
+const FclVec3 uninitialized_T;
+} // anonymous namespace
 
-  std::array<FclVec3, 4> Td;
-  std::array<FclVec3, 4> Rd;
+//==============================================================================
+ReusableFclSplineMotion::ReusableFclSplineMotion()
+// The constructor that we are using is a no-op (apparently it was declared,
+// but its definition is just `// TODO`, so we don't need to worry about
+// unintended consequences. If we update the version of FCL, this may change,
+// so I'm going to leave a FIXME tag here to keep us aware of that.
+: FclSplineMotion(
+    uninitialized_R, uninitialized_T, uninitialized_R, uninitialized_T)
+{
+  // Do nothing
+}
 
+//==============================================================================
+void ReusableFclSplineMotion::reset(
+  const Spline& spline,
+  const Time start_time,
+  const Time finish_time)
+{
+#ifdef RMF_TRAFFIC__USING_FCL_0_6
+  std::array<FclVec3, 4> knots_T;
+  std::array<FclVec3, 4> knots_R;
+  compute_fcl_knots(spline, start_time, finish_time, knots_T, knots_R);
+
+  // This mirrors the knot constructor of fcl::SplineMotion, except that it
+  // keeps the time interval that was allocated when this motion was created.
   for (std::size_t i = 0; i < 4; ++i)
   {
-    const Eigen::Vector3d p = knots[i];
-    Td[i] = FclVec3(p[0], p[1], 0.0);
-    Rd[i] = FclVec3(0.0, 0.0, p[2]);
+    Td[i] = knots_T[i];
+    Rd[i] = knots_R[i];
   }
 
-  return FclSplineMotion(
-    Td[0], Td[1], Td[2], Td[3],
-    Rd[0], Rd[1], Rd[2], Rd[3]);
+  Rd0Rd0 = Rd[0].dot(Rd[0]);
+  Rd0Rd1 = Rd[0].dot(Rd[1]);
+  Rd0Rd2 = Rd[0].dot(Rd[2]);
+  Rd0Rd3 = Rd[0].dot(Rd[3]);
+  Rd1Rd1 = Rd[1].dot(Rd[1]);
+  Rd1Rd2 = Rd[1].dot(Rd[2]);
+  Rd1Rd3 = Rd[1].dot(Rd[3]);
+  Rd2Rd2 = Rd[2].dot(Rd[2]);
+  Rd2Rd3 = Rd[2].dot(Rd[3]);
+  Rd3Rd3 = Rd[3].dot(Rd[3]);
+
+  TA = Td[1] * 3 - Td[2] * 3 + Td[3] - Td[0];
+  TB = (Td[0] - Td[1] * 2 + Td[2]) * 3;
+  TC = (Td[2] - Td[0]) * 3;
+
+  RA = Rd[1] * 3 - Rd[2] * 3 + Rd[3] - Rd[0];
+  RB = (Rd[0] - Rd[1] * 2 + Rd[2]) * 3;
+  RC = (Rd[2] - Rd[0]) * 3;
+
+  tf.setIdentity();
+  integrate(0.0);
+#else
+  FclSplineMotion::operator=(spline.to_fcl(start_time, finish_time));
+#endif
 }
 
 //==============================================================================
@@ -314,12 +515,30 @@ Eigen::Vector3d Spline::compute_acceleration(const Time at_time) const
     params, compute_scaled_time(at_time, params));
 }
 
+//==============================================================================
+Eigen::Matrix3Xd Spline::compute_positions(const std::vector<Time>& times) const
+{
+  return coefficient_matrix(params) * time_power_matrix(params, times);
+}
+
 //==============================================================================
 const Spline::Parameters& Spline::get_params() const
 {
   return params;
 }
 
+//==============================================================================
+internal::BoundingBox Spline::compute_bounding_box() const
+{
+  const std::array<double, 2> extrema_x = get_local_extrema(params.coeffs[0]);
+  const std::array<double, 2> extrema_y = get_local_extrema(params.coeffs[1]);
+
+  return internal::BoundingBox{
+    Eigen::Vector2d{extrema_x[0], extrema_y[0]},
+    Eigen::Vector2d{extrema_x[1], extrema_y[1]}
+  };
+}
+
 //==============================================================================
 std::array<Eigen::Vector4d, 3> normalize_coefficients(
   const Time t0,
@@ -396,12 +615,20 @@ bool is_second_derivative_of_distance_negative(
   return dv.dot(dv) + dp.dot(da) < 0.0;
 }
 
+//==============================================================================
+/// A quadratic has at most two roots
+using UnitRoots = BoundedList<double, 2>;
+
+//==============================================================================
+bool in_unit_domain(const double t)
+{
+  return 0.0 <= t && t <= 1.0;
+}
+
 //==============================================================================
 /// Get the quadratic roots of the coefficients, but only if they fall in the
 /// domain t = [0, 1]
-// TODO(MXG): This will always return 2, 1, or 0 results, so a bounded vector
-// would be preferable for a return value.
-std::vector<double> compute_roots_in_unit_domain(const Eigen::Vector3d coeffs)
+UnitRoots compute_roots_in_unit_domain(const Eigen::Vector3d& coeffs)
 {
   const double tol = 1e-5;
 
@@ -409,35 +636,30 @@ std::vector<double> compute_roots_in_unit_domain(const Eigen::Vector3d coeffs)
   const double b = coeffs[1];
   const double c = coeffs[0];
 
+  UnitRoots output;
   if (std::abs(a) < tol)
   {
     if (std::abs(b) < tol)
-    {
-      return {};
-    }
+      return output;
 
     const double t = -c/b;
-    if (0.0 <= t && t <= 1.0)
-    {
-      return {t};
-    }
+    if (in_unit_domain(t))
+      output.push_back(t);
 
-    return {};
+    return output;
   }
 
   const double determinate = (b*b - 4*a*c);
   if (determinate < 0.0)
-  {
-    return {};
-  }
+    return output;
 
-  std::vector<double> output;
-  const double t_m = (-b - std::sqrt(determinate))/(2*a);
-  if (0.0 <= t_m && t_m <= 1.0)
+  const double sqrt_det = std::sqrt(determinate);
+  const double t_m = (-b - sqrt_det)/(2*a);
+  if (in_unit_domain(t_m))
     output.push_back(t_m);
 
-  const double t_p = (-b + std::sqrt(determinate))/(2*a);
-  if (0.0 <= t_p && t_p <= 1.0 && std::abs(t_p - t_m) > time_tolerance)
+  const double t_p = (-b + sqrt_det)/(2*a);
+  if (in_unit_domain(t_p) && std::abs(t_p - t_m) > time_tolerance)
     output.push_back(t_p);
 
   return output;
@@ -478,7 +700,12 @@ bool is_in_eighth(
 }
 
 //==============================================================================
-bool contains(const std::vector<double>& times, const double t)
+/// The roots where both vx and vy are zero are a subset of the roots of vx and
+/// of vy, so there can be no more than four of them.
+using FullZeroRoots = BoundedList<double, 4>;
+
+//==============================================================================
+bool contains(const FullZeroRoots& times, const double t)
 {
   for (const auto check : times)
   {
@@ -490,14 +717,14 @@ bool contains(const std::vector<double>& times, const double t)
 }
 
 //==============================================================================
-void insert_if_missing(std::vector<double>& times, const double t)
+void insert_if_missing(FullZeroRoots& times, const double t)
 {
   if (!contains(times, t))
     times.push_back(t);
 }
 
 //==============================================================================
-std::vector<Time> DistanceDifferential::approach_times() const
+auto DistanceDifferential::approach_times() const -> ApproachTimes
 {
   // The idea behind finding the "approach times" is to find local maximum
   // points of the distance function. A local maximum on the distance function
@@ -541,12 +768,14 @@ std::vector<Time> DistanceDifferential::approach_times() const
   const Eigen::Vector3d vy_coeffs = compute_deriv_coeffs(_params.coeffs[1]);
 
   const auto t_vx_zero = compute_roots_in_unit_domain(vx_coeffs);
-  auto t_vy_zero = compute_roots_in_unit_domain(vy_coeffs);
+  const auto t_vy_zero = compute_roots_in_unit_domain(vy_coeffs);
 
-  std::vector<double> t_full_zero;
+  // Everything is kept in fixed-size lists, because this is evaluated for
+  // every pair of segments where the agents are close to each other.
+  FullZeroRoots t_full_zero;
   const double zero_tolerance = 1e-3;
 
-  std::vector<Time> output;
+  ApproachTimes output;
 
   for (const double t : t_vx_zero)
   {
@@ -635,6 +864,153 @@ std::vector<Time> DistanceDifferential::approach_times() const
   return output;
 }
 
+namespace {
+//==============================================================================
+/// The polynomial of the squared distance between two cubic splines has degree
+/// six. We represent it in the Bernstein basis over a sub-interval of the unit
+/// domain, because the Bernstein coefficients bound the value of the
+/// polynomial over that whole sub-interval.
+using Bernstein = std::array<double, 7>;
+
+//==============================================================================
+Bernstein compute_squared_distance_bernstein(
+  const Spline::Parameters& params,
+  const double distance)
+{
+  // Power basis coefficients of dx(t)^2 + dy(t)^2 - distance^2
+  std::array<double, 7> power = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  for (std::size_t k = 0; k < 2; ++k)
+  {
+    const Eigen::Vector4d& c = params.coeffs[k];
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+        power[static_cast<std::size_t>(i+j)] += c[i] * c[j];
+    }
+  }
+  power[0] -= distance * distance;
+
+  // b_i = sum_{j=0}^{i} [C(i,j) / C(6,j)] * a_j
+  constexpr std::array<std::array<double, 7>, 7> binomial = {{
+    {1, 0, 0, 0, 0, 0, 0},
+    {1, 1, 0, 0, 0, 0, 0},
+    {1, 2, 1, 0, 0, 0, 0},
+    {1, 3, 3, 1, 0, 0, 0},
+    {1, 4, 6, 4, 1, 0, 0},
+    {1, 5, 10, 10, 5, 1, 0},
+    {1, 6, 15, 20, 15, 6, 1}
+  }};
+
+  Bernstein output;
+  for (std::size_t i = 0; i < 7; ++i)
+  {
+    output[i] = 0.0;
+    for (std::size_t j = 0; j <= i; ++j)
+      output[i] += binomial[i][j] / binomial[6][j] * power[j];
+  }
+
+  return output;
+}
+
+//==============================================================================
+/// Split the Bernstein polynomial at the middle of its interval using the de
+/// Casteljau algorithm.
+std::array<Bernstein, 2> subdivide(const Bernstein& b)
+{
+  std::array<Bernstein, 2> output;
+  Bernstein work = b;
+  for (std::size_t level = 0; level < 7; ++level)
+  {
+    output[0][level] = work[0];
+    output[1][6 - level] = work[6 - level];
+    for (std::size_t i = 0; i + level < 6; ++i)
+      work[i] = 0.5 * (work[i] + work[i+1]);
+  }
+
+  return output;
+}
+
+//==============================================================================
+/// The depth of subdivision determines the precision of the earliest contact
+/// time. Each level halves the interval, so a tolerance of 1e-7 needs a depth
+/// of 24.
+std::size_t subdivision_depth(const double tolerance)
+{
+  constexpr std::size_t max_depth = 52;
+  if (!(tolerance > 0.0))
+    return max_depth;
+
+  if (tolerance >= 1.0)
+    return 0;
+
+  return std::min(
+    max_depth,
+    static_cast<std::size_t>(std::ceil(-std::log2(tolerance))));
+}
+
+//==============================================================================
+std::optional<double> earliest_nonpositive(
+  const Bernstein& b,
+  const double lower,
+  const double upper,
+  const std::size_t depth,
+  const std::size_t max_depth,
+  const bool exact)
+{
+  // The first coefficient is exactly the value at the start of the interval.
+  if (b[0] <= 0.0)
+    return lower;
+
+  // The last coefficient is exactly the value at the end of the interval, so a
+  // contact is certain to happen within it. Every earlier interval has already
+  // been ruled out, so the start of this interval comes before any contact.
+  if (!exact && b[6] <= 0.0)
+    return lower;
+
+  // The polynomial is contained in the convex hull of its coefficients, so if
+  // every coefficient is positive then there is no contact in this interval.
+  bool all_positive = true;
+  for (const double c : b)
+  {
+    if (c <= 0.0)
+    {
+      all_positive = false;
+      break;
+    }
+  }
+
+  if (all_positive)
+    return std::nullopt;
+
+  if (depth >= max_depth)
+    return lower;
+
+  const double middle = 0.5 * (lower + upper);
+  const auto halves = subdivide(b);
+  if (const auto t = earliest_nonpositive(
+      halves[0], lower, middle, depth+1, max_depth, exact))
+    return t;
+
+  return earliest_nonpositive(
+    halves[1], middle, upper, depth+1, max_depth, exact);
+}
+} // anonymous namespace
+
+//==============================================================================
+std::optional<Time> DistanceDifferential::first_time_within(
+  const double distance,
+  const double tolerance,
+  const bool exact_time) const
+{
+  const Bernstein b = compute_squared_distance_bernstein(_params, distance);
+  const auto t = earliest_nonpositive(
+    b, 0.0, 1.0, 0, subdivision_depth(tolerance), exact_time);
+  if (!t.has_value())
+    return std::nullopt;
+
+  return compute_real_time(_params.time_range, *t);
+}
+
 //==============================================================================
 Time DistanceDifferential::start_time() const
 {
@@ -29,6 +29,9 @@
 #endif
 
 #include <array>
+#include <cassert>
+#include <optional>
+#include <vector>
 
 namespace rmf_traffic {
 
@@ -55,6 +58,10 @@ public:
   /// `it`.
   Spline(const internal::WaypointList::const_iterator& it);
 
+  /// Create a spline from parameters that were already computed, e.g. by
+  /// internal::get_segment_cache().
+  Spline(const internal::SplineParameters& params);
+
   /// Compute the knots for the motion of this spline from start_time to
   /// finish_time, scaled to a "time" range of [0, 1].
   std::array<Eigen::Vector3d, 4> compute_knots(
@@ -65,12 +72,7 @@ public:
   Time start_time() const;
   Time finish_time() const;
 
-  struct Parameters
-  {
-    std::array<Eigen::Vector4d, 3> coeffs;
-    double delta_t;
-    std::array<Time, 2> time_range;
-  };
+  using Parameters = internal::SplineParameters;
 
   /// Compute the position of the spline at this moment in time
   Eigen::Vector3d compute_position(const Time at_time) const;
@@ -81,15 +83,80 @@ public:
   /// Compute the velocity of the spline at this moment in time
   Eigen::Vector3d compute_acceleration(const Time at_time) const;
 
+  /// Compute the positions of the spline at each of the given times. Column k
+  /// of the result corresponds to times[k]. Every time must be within the
+  /// range of the spline.
+  Eigen::Matrix3Xd compute_positions(const std::vector<Time>& times) const;
+
   /// Get a const reference to the parameters of this spline
   const Parameters& get_params() const;
 
+  /// Compute an axis-aligned box that contains the (x, y) motion of this
+  /// spline over its entire time range.
+  internal::BoundingBox compute_bounding_box() const;
+
 private:
 
   Parameters params;
 
 };
 
+//==============================================================================
+/// A list of values that never holds more than Capacity elements, so it can be
+/// kept on the stack instead of allocating.
+template<typename T, std::size_t Capacity>
+class BoundedList
+{
+public:
+
+  using const_iterator = typename std::array<T, Capacity>::const_iterator;
+
+  void push_back(const T& value)
+  {
+    assert(_size < Capacity);
+    _values[_size++] = value;
+  }
+
+  const_iterator begin() const
+  {
+    return _values.begin();
+  }
+
+  const_iterator end() const
+  {
+    return _values.begin() + _size;
+  }
+
+  typename std::array<T, Capacity>::iterator begin()
+  {
+    return _values.begin();
+  }
+
+  typename std::array<T, Capacity>::iterator end()
+  {
+    return _values.begin() + _size;
+  }
+
+  const T& operator[](const std::size_t index) const
+  {
+    return _values[index];
+  }
+
+  std::size_t size() const
+  {
+    return _size;
+  }
+
+  bool empty() const
+  {
+    return _size == 0;
+  }
+
+private:
+  std::array<T, Capacity> _values;
+  std::size_t _size = 0;
+};
+
 //==============================================================================
 /// This class helps compute the differentials of the distance between two
 /// splines.
@@ -103,10 +170,40 @@ public:
 
   bool initially_approaching() const;
 
+  /// Each of the four velocity conditions that approach_times() checks can be
+  /// met at most twice within the window.
+  static constexpr std::size_t MaxApproachTimes = 8;
+
+  using ApproachTimes = BoundedList<Time, MaxApproachTimes>;
+
   /// Calculate the times within the relevant window when an "approach" is
   /// occuring. This means that the vehicles are getting closer together than
-  /// they should.
-  std::vector<Time> approach_times() const;
+  /// they should. The times are sorted from earliest to latest.
+  ApproachTimes approach_times() const;
+
+  /// Find the earliest time within the relevant window when the (x, y)
+  /// distance between the two splines is less than or equal to the given
+  /// distance. This is solved directly on the polynomial of the squared
+  /// distance, so the result is deterministic and does not depend on any
+  /// iterative collision checking.
+  ///
+  /// \param[in] distance
+  ///   The distance to check for
+  ///
+  /// \param[in] tolerance
+  ///   The precision of the result as a fraction of the window. Near misses
+  ///   that are closer than this may be reported as contacts.
+  ///
+  /// \param[in] exact_time
+  ///   If false, the search will stop as soon as a contact is certain, and the
+  ///   result will be no later than the earliest contact instead of exactly at
+  ///   it.
+  ///
+  /// \return std::nullopt if the splines are never that close together
+  std::optional<Time> first_time_within(
+    double distance,
+    double tolerance = 1e-7,
+    bool exact_time = true) const;
 
   Time start_time() const;
   Time finish_time() const;
@@ -116,6 +213,24 @@ private:
 
 };
 
+//==============================================================================
+/// An FCL spline motion which can be reassigned to a different spline without
+/// allocating. Constructing a new FclSplineMotion allocates its time interval
+/// on the heap, which adds up in the narrowphase of conflict detection.
+class ReusableFclSplineMotion : public FclSplineMotion
+{
+public:
+
+  /// Create an uninitialized motion. reset() must be called before this is
+  /// used for any collision checking.
+  ReusableFclSplineMotion();
+
+  /// Make this motion follow the given spline from start_time to finish_time,
+  /// scaled to a "time" range of [0, 1].
+  void reset(const Spline& spline, Time start_time, Time finish_time);
+
+};
+
 } // namespace rmf_traffic
 
 #endif // SRC__RMF_TRAFFIC__SPLINE_HPP
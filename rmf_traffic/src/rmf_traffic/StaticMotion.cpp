@@ -24,6 +24,12 @@ namespace internal {
 
 //==============================================================================
 StaticMotion::StaticMotion(const Eigen::Isometry2d& tf)
+{
+  set_transform(tf);
+}
+
+//==============================================================================
+void StaticMotion::set_transform(const Eigen::Isometry2d& tf)
 {
   const Eigen::Vector2d& p = tf.translation();
   Eigen::Rotation2Dd R{tf.rotation()};
@@ -42,6 +42,9 @@ public:
 
   StaticMotion(const Eigen::Isometry2d& tf);
 
+  /// Change the transform of this motion without reallocating it
+  void set_transform(const Eigen::Isometry2d& tf);
+
   virtual bool integrate(double dt) const final;
 
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
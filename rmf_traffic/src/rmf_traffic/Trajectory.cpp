@@ -19,8 +19,11 @@
 
 #include "debug_Trajectory.hpp"
 #include "MotionInternal.hpp"
+#include "Spline.hpp"
 #include "TrajectoryInternal.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <optional>
 #include <string>
@@ -74,6 +77,19 @@ public:
   {
     return iterator._pimpl->raw_iterator;
   }
+
+  static ConstSegmentCachePtr segment_cache(const Trajectory& trajectory);
+
+  static ConstSegmentCachePtr segment_cache(
+    const Trajectory::const_iterator& iterator);
+
+  static std::size_t index_of(const Trajectory::const_iterator& iterator);
+
+  static Trajectory::const_iterator iterator_at(
+    const Trajectory& trajectory,
+    std::size_t index);
+
+  static std::size_t memory_usage(const Trajectory& trajectory);
 };
 
 //==============================================================================
@@ -83,6 +99,206 @@ WaypointList::const_iterator get_raw_iterator(
   return TrajectoryIteratorImplementation::raw(iterator);
 }
 
+//==============================================================================
+ConstSegmentCachePtr get_segment_cache(const Trajectory& trajectory)
+{
+  return TrajectoryIteratorImplementation::segment_cache(trajectory);
+}
+
+//==============================================================================
+ConstSegmentCachePtr get_segment_cache(
+  const Trajectory::const_iterator& iterator)
+{
+  return TrajectoryIteratorImplementation::segment_cache(iterator);
+}
+
+//==============================================================================
+std::size_t get_index(const Trajectory::const_iterator& iterator)
+{
+  return TrajectoryIteratorImplementation::index_of(iterator);
+}
+
+//==============================================================================
+Trajectory::const_iterator get_iterator(
+  const Trajectory& trajectory,
+  const std::size_t index)
+{
+  return TrajectoryIteratorImplementation::iterator_at(trajectory, index);
+}
+
+//==============================================================================
+std::size_t memory_usage(const Trajectory& trajectory)
+{
+  return TrajectoryIteratorImplementation::memory_usage(trajectory);
+}
+
+//==============================================================================
+std::size_t seek_time(
+  const std::vector<Time>& times,
+  std::size_t hint,
+  const Time time)
+{
+  // How many steps we take from the hint before switching to a binary search
+  constexpr std::size_t MaxSteps = 4;
+
+  const std::size_t n = times.size();
+  hint = std::min(hint, n);
+
+  if (hint < n && times[hint] < time)
+  {
+    for (std::size_t step = 0; step < MaxSteps; ++step)
+    {
+      ++hint;
+      if (hint == n || !(times[hint] < time))
+        return hint;
+    }
+
+    return std::lower_bound(times.begin() + hint, times.end(), time)
+      - times.begin();
+  }
+
+  for (std::size_t step = 0; step < MaxSteps; ++step)
+  {
+    if (hint == 0 || times[hint-1] < time)
+      return hint;
+
+    --hint;
+  }
+
+  return std::lower_bound(times.begin(), times.begin() + hint, time)
+    - times.begin();
+}
+
+namespace {
+//==============================================================================
+bool boxes_overlap(const BoundingBox& a, const BoundingBox& b)
+{
+  for (int i = 0; i < 2; ++i)
+  {
+    if (a.max[i] < b.min[i] || b.max[i] < a.min[i])
+      return false;
+  }
+
+  return true;
+}
+
+//==============================================================================
+/// Add a node that covers the segments [begin, end) along with all of its
+/// descendants, and return the index of the new node.
+std::size_t add_segment_node(
+  SegmentCache& cache,
+  const std::size_t begin,
+  const std::size_t end)
+{
+  const std::size_t index = cache.hierarchy.size();
+  cache.hierarchy.push_back({cache.bounds[begin], begin, end});
+
+  if (end - begin <= SegmentHierarchyLeafSize)
+  {
+    BoundingBox bounds = cache.bounds[begin];
+    for (std::size_t i = begin + 1; i < end; ++i)
+    {
+      bounds.min = bounds.min.cwiseMin(cache.bounds[i].min);
+      bounds.max = bounds.max.cwiseMax(cache.bounds[i].max);
+    }
+
+    cache.hierarchy[index].bounds = bounds;
+    return index;
+  }
+
+  // The vector may reallocate while the children are added, so we do not hold
+  // onto any references to the new node until they are finished.
+  const std::size_t middle = begin + (end - begin)/2;
+  const std::size_t left = add_segment_node(cache, begin, middle);
+  const std::size_t right = add_segment_node(cache, middle, end);
+
+  auto& node = cache.hierarchy[index];
+  const auto& left_bounds = cache.hierarchy[left].bounds;
+  const auto& right_bounds = cache.hierarchy[right].bounds;
+  node.left = left;
+  node.right = right;
+  node.bounds.min = left_bounds.min.cwiseMin(right_bounds.min);
+  node.bounds.max = left_bounds.max.cwiseMax(right_bounds.max);
+
+  return index;
+}
+
+//==============================================================================
+std::size_t find_in_segment_node(
+  const SegmentCache& cache,
+  const std::size_t node_index,
+  const std::size_t first,
+  const std::size_t last,
+  const BoundingBox& box)
+{
+  const auto& node = cache.hierarchy[node_index];
+  if (node.end <= first || last <= node.begin)
+    return last;
+
+  if (!boxes_overlap(node.bounds, box))
+    return last;
+
+  if (node.left == 0)
+  {
+    const std::size_t end = std::min(node.end, last);
+    for (std::size_t i = std::max(node.begin, first); i < end; ++i)
+    {
+      if (boxes_overlap(cache.bounds[i], box))
+        return i;
+    }
+
+    return last;
+  }
+
+  const std::size_t found =
+    find_in_segment_node(cache, node.left, first, last, box);
+  if (found < last)
+    return found;
+
+  return find_in_segment_node(cache, node.right, first, last, box);
+}
+} // anonymous namespace
+
+//==============================================================================
+void build_segment_hierarchy(SegmentCache& cache)
+{
+  cache.hierarchy.clear();
+
+  // There is no segment that finishes at the first waypoint, so the segments
+  // begin at index 1.
+  if (cache.bounds.size() < SegmentHierarchyThreshold + 1)
+    return;
+
+  const std::size_t segments = cache.bounds.size() - 1;
+  cache.hierarchy.reserve(4*segments/SegmentHierarchyLeafSize + 1);
+  add_segment_node(cache, 1, cache.bounds.size());
+}
+
+//==============================================================================
+std::size_t find_overlapping_segment(
+  const SegmentCache& cache,
+  const std::size_t first,
+  std::size_t last,
+  const BoundingBox& box)
+{
+  last = std::min(last, cache.bounds.size());
+  if (last <= first)
+    return last;
+
+  if (cache.hierarchy.empty())
+  {
+    for (std::size_t i = first; i < last; ++i)
+    {
+      if (boxes_overlap(cache.bounds[i], box))
+        return i;
+    }
+
+    return last;
+  }
+
+  return find_in_segment_node(cache, 0, first, last, box);
+}
+
 } // namespace internal
 
 //==============================================================================
@@ -117,8 +333,80 @@ class Trajectory::Implementation
 {
 public:
 
-  internal::OrderMap ordering;
-  internal::WaypointList segments;
+  // The waypoints of short trajectories are stored inside of this resource so
+  // that they do not need any heap allocations. This must be declared before
+  // the containers that use it.
+  internal::TrajectoryResource resource;
+  internal::OrderMap ordering{&resource};
+  internal::WaypointList segments{&resource};
+
+  // Lazily computed bounding boxes and spline parameters for each segment.
+  // This is cleared whenever the trajectory is modified. The pointer is only
+  // read and written through the std::atomic_* overloads so that concurrent
+  // const access is safe.
+  mutable internal::ConstSegmentCachePtr cache;
+
+  void invalidate_cache()
+  {
+    std::atomic_store(&cache, internal::ConstSegmentCachePtr());
+  }
+
+  internal::ConstSegmentCachePtr get_cache() const
+  {
+    auto output = std::atomic_load(&cache);
+    if (output)
+      return output;
+
+    output = compute_cache();
+    std::atomic_store(&cache, output);
+    return output;
+  }
+
+  internal::ConstSegmentCachePtr compute_cache() const
+  {
+    assert(!segments.empty());
+    auto output = std::make_shared<internal::SegmentCache>();
+    output->times.reserve(segments.size());
+    output->positions.reserve(segments.size());
+    output->velocities.reserve(segments.size());
+    output->bounds.reserve(segments.size());
+    output->stationary.reserve(segments.size());
+    output->splines.reserve(segments.size());
+
+    for (const auto& element : segments)
+    {
+      output->times.push_back(element.data.time);
+      output->positions.push_back(element.data.position);
+      output->velocities.push_back(element.data.velocity);
+    }
+
+    auto it = segments.begin();
+    const Eigen::Vector2d p0 = it->data.position.block<2, 1>(0, 0);
+    output->bounds.push_back({p0, p0});
+    output->total_bounds = {p0, p0};
+    output->stationary.push_back(false);
+    output->splines.push_back(
+      {{}, 0.0, {it->data.time, it->data.time}});
+
+    for (++it; it != segments.end(); ++it)
+    {
+      const auto& start = std::prev(it)->data;
+      const auto& finish = it->data;
+      output->stationary.push_back(
+        start.position == finish.position
+        && start.velocity.isZero() && finish.velocity.isZero());
+
+      const Spline spline(it);
+      const auto box = spline.compute_bounding_box();
+      output->total_bounds.min = output->total_bounds.min.cwiseMin(box.min);
+      output->total_bounds.max = output->total_bounds.max.cwiseMax(box.max);
+      output->bounds.push_back(box);
+      output->splines.push_back(spline.get_params());
+    }
+
+    internal::build_segment_hierarchy(*output);
+    return output;
+  }
 
   template<typename SegT>
   base_iterator<SegT> make_iterator(
@@ -157,6 +445,9 @@ public:
     ordering = other.ordering;
     segments = other.segments;
 
+    // The cached segment values are immutable, so the copy can share them.
+    std::atomic_store(&cache, std::atomic_load(&other.cache));
+
     // Now correct all the iterators to point to the freshly copied container
     internal::WaypointList::iterator sit = segments.begin();
     internal::OrderMap::iterator oit = ordering.begin();
@@ -171,7 +462,17 @@ public:
 
   InsertionResult insert(internal::WaypointElement::Data data)
   {
-    const internal::OrderMap::iterator hint = ordering.lower_bound(data.time);
+    // This must happen before the hint is found, because reserving will
+    // invalidate any iterators into the order map.
+    if (ordering.empty())
+      ordering.reserve(internal::TrajectoryInlineWaypoints);
+
+    // Trajectories are usually built from start to finish, so we check for an
+    // insertion at the end before doing a binary search.
+    const internal::OrderMap::iterator hint =
+      (!ordering.empty() && (--ordering.end())->key < data.time) ?
+      ordering.end() : ordering.lower_bound(data.time);
+
     if (hint != ordering.end() && hint->key == data.time)
     {
       // We already have a Waypoint in the Trajectory that ends at this same
@@ -181,6 +482,7 @@ public:
       return InsertionResult{make_iterator<Waypoint>(hint->value), false};
     }
 
+    invalidate_cache();
     const internal::WaypointList::const_iterator list_destination =
       (hint == ordering.end()) ? segments.end() : hint->value;
 
@@ -200,6 +502,50 @@ public:
     return InsertionResult{make_iterator<Waypoint>(result), true};
   }
 
+  void append_sorted(const std::vector<Trajectory::Point>& waypoints)
+  {
+    if (waypoints.empty())
+      return;
+
+    // Check every time before anything is changed
+    const Time* previous =
+      segments.empty() ? nullptr : &segments.back().data.time;
+    for (const auto& waypoint : waypoints)
+    {
+      if (previous && waypoint.time <= *previous)
+      {
+        // *INDENT-OFF*
+        throw std::invalid_argument(
+          "[Trajectory::append_sorted] The waypoint at time "
+          + std::to_string(waypoint.time.time_since_epoch().count())
+          + "ns does not come after the waypoint before it at time "
+          + std::to_string(previous->time_since_epoch().count()) + "ns");
+        // *INDENT-ON*
+      }
+
+      previous = &waypoint.time;
+    }
+
+    invalidate_cache();
+
+    // The order map is reserved first so that its buffer does not use up the
+    // room that gets reserved for the list nodes.
+    std::size_t index = ordering.size();
+    ordering.reserve(std::max(
+        index + waypoints.size(), internal::TrajectoryInlineWaypoints));
+    resource.reserve(waypoints.size()*internal::TrajectoryNodeBytes);
+
+    for (const auto& waypoint : waypoints)
+    {
+      const internal::WaypointList::iterator it = segments.emplace(
+        segments.end(),
+        internal::WaypointElement::Data{
+          waypoint.time, waypoint.position, waypoint.velocity, index++});
+      it->myself = make_segment(it);
+      ordering.emplace_hint(ordering.end(), waypoint.time, it);
+    }
+  }
+
   iterator find(Time time)
   {
     const auto it = ordering.lower_bound(time);
@@ -225,6 +571,7 @@ public:
 
   iterator erase(iterator waypoint)
   {
+    invalidate_cache();
     auto it = ordering.erase(waypoint->_pimpl->myself->data.time);
     auto index = it - ordering.begin();
     for(; it != ordering.end(); ++it, ++index)
@@ -235,6 +582,7 @@ public:
 
   iterator erase(iterator first, iterator last)
   {
+    invalidate_cache();
     const auto seg_begin = first->_pimpl->myself;
     const auto seg_end = last._pimpl->raw_iterator == segments.end() ?
       segments.end() : last->_pimpl->myself;
@@ -263,6 +611,82 @@ public:
 
 };
 
+//==============================================================================
+internal::ConstSegmentCachePtr
+internal::TrajectoryIteratorImplementation::segment_cache(
+  const Trajectory& trajectory)
+{
+  return trajectory._pimpl->get_cache();
+}
+
+//==============================================================================
+internal::ConstSegmentCachePtr
+internal::TrajectoryIteratorImplementation::segment_cache(
+  const Trajectory::const_iterator& iterator)
+{
+  return iterator._pimpl->parent->get_cache();
+}
+
+//==============================================================================
+std::size_t internal::TrajectoryIteratorImplementation::index_of(
+  const Trajectory::const_iterator& iterator)
+{
+  const auto* const parent = iterator._pimpl->parent;
+  if (iterator._pimpl->raw_iterator == parent->segments.end())
+    return parent->segments.size();
+
+  return iterator._pimpl->raw_iterator->data.index;
+}
+
+//==============================================================================
+Trajectory::const_iterator
+internal::TrajectoryIteratorImplementation::iterator_at(
+  const Trajectory& trajectory,
+  const std::size_t index)
+{
+  if (index >= trajectory.size())
+    return trajectory.end();
+
+  return trajectory._pimpl->make_iterator<const Trajectory::Waypoint>(
+    trajectory._pimpl->ordering[index].value);
+}
+
+//==============================================================================
+std::size_t internal::TrajectoryIteratorImplementation::memory_usage(
+  const Trajectory& trajectory)
+{
+  const auto& impl = *trajectory._pimpl;
+
+  // The waypoint list and the order map allocate from the inline resource, so
+  // anything that they hold beyond its buffer is counted by the resource.
+  std::size_t bytes =
+    sizeof(Trajectory::Implementation) + impl.resource.heap_bytes();
+
+  for (const auto& element : impl.segments)
+  {
+    if (element.myself)
+    {
+      bytes += sizeof(Trajectory::Waypoint)
+        + sizeof(Trajectory::Waypoint::Implementation);
+    }
+  }
+
+  if (const auto cache = std::atomic_load(&impl.cache))
+  {
+    const auto& c = *cache;
+    bytes += sizeof(SegmentCache)
+      + c.times.capacity()*sizeof(Time)
+      + c.positions.capacity()*sizeof(Eigen::Vector3d)
+      + c.velocities.capacity()*sizeof(Eigen::Vector3d)
+      + c.bounds.capacity()*sizeof(BoundingBox)
+      + c.stationary.capacity()/8
+      + c.splines.capacity()*sizeof(SplineParameters)
+      + c.hierarchy.capacity()*sizeof(SegmentNode);
+  }
+
+  return bytes;
+}
+
 //==============================================================================
 Eigen::Vector3d Trajectory::Waypoint::position() const
 {
@@ -274,6 +698,7 @@ Trajectory::Waypoint& Trajectory::Waypoint::position(
   Eigen::Vector3d new_position)
 {
   _pimpl->data().position = std::move(new_position);
+  _pimpl->parent->invalidate_cache();
   return *this;
 }
 
@@ -288,6 +713,7 @@ Trajectory::Waypoint& Trajectory::Waypoint::velocity(
   Eigen::Vector3d new_velocity)
 {
   _pimpl->data().velocity = std::move(new_velocity);
+  _pimpl->parent->invalidate_cache();
   return *this;
 }
 
@@ -317,6 +743,8 @@ Trajectory::Waypoint& Trajectory::Waypoint::change_time(const Time new_time)
     return *this;
   }
 
+  _pimpl->parent->invalidate_cache();
+
   internal::OrderMap& ordering = _pimpl->parent->ordering;
   internal::WaypointList& segments = _pimpl->parent->segments;
   const internal::OrderMap::iterator current_order_it =
@@ -415,6 +843,8 @@ void Trajectory::Waypoint::adjust_times(Duration delta_t)
     }
   }
 
+  _pimpl->parent->invalidate_cache();
+
   // Adjust the times for the segments
   for (auto it = begin_it; it != segments.end(); ++it)
     it->data.time += delta_t;
@@ -444,6 +874,13 @@ Trajectory::Trajectory()
   // Do nothing
 }
 
+//==============================================================================
+Trajectory::Trajectory(const std::vector<Point>& waypoints)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+{
+  _pimpl->append_sorted(waypoints);
+}
+
 //==============================================================================
 Trajectory::Trajectory(const Trajectory& other)
 : _pimpl(rmf_utils::make_unique_impl<Implementation>(*other._pimpl))
@@ -477,6 +914,12 @@ Trajectory::InsertionResult Trajectory::insert(const Waypoint& other)
   return _pimpl->insert(internal::WaypointElement::Data{other._pimpl->data()});
 }
 
+//==============================================================================
+void Trajectory::append_sorted(const std::vector<Point>& waypoints)
+{
+  _pimpl->append_sorted(waypoints);
+}
+
 //==============================================================================
 Trajectory::iterator Trajectory::find(Time time)
 {
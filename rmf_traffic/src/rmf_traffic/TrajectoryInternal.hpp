@@ -20,18 +20,200 @@
 
 #include <rmf_traffic/Trajectory.hpp>
 
+#include <array>
+#include <cstddef>
 #include <list>
 #include <map>
+#include <memory>
+#include <memory_resource>
 
 namespace rmf_traffic {
 namespace internal {
 
+//==============================================================================
+/// A memory resource that hands out blocks from a buffer that is stored inside
+/// of the resource itself. Once the buffer is used up, requests are passed
+/// along to the heap, unless room was set aside for them with reserve(). Blocks
+/// that are returned to the buffer or to reserved room are kept on a free list
+/// and reused for later requests of the same size.
+///
+/// This is not thread-safe, and every block must be returned before the
+/// resource is destroyed.
+template<std::size_t Bytes>
+class InlineResource : public std::pmr::memory_resource
+{
+public:
+
+  static constexpr std::size_t Alignment = alignof(std::max_align_t);
+
+  /// The number of bytes of the buffer that a request of the given size will
+  /// use up
+  static constexpr std::size_t block_size(const std::size_t bytes)
+  {
+    return (bytes + Alignment - 1) / Alignment * Alignment;
+  }
+
+  InlineResource() = default;
+  InlineResource(const InlineResource&) = delete;
+  InlineResource& operator=(const InlineResource&) = delete;
+
+  ~InlineResource()
+  {
+    while (_chunks)
+    {
+      Chunk* const next = _chunks->next;
+      std::pmr::new_delete_resource()->deallocate(
+        _chunks, _chunks->size, Alignment);
+      _chunks = next;
+    }
+  }
+
+  /// Set aside room for requests that will use up this many bytes in total,
+  /// as measured by block_size(). Whatever does not fit in the rest of the
+  /// buffer is taken from the heap as a single block, so a batch of requests
+  /// only needs one allocation.
+  void reserve(const std::size_t bytes)
+  {
+    const std::size_t available = (Bytes - _used)
+      + (_chunks ? _chunks->size - _chunks->used : 0);
+
+    if (bytes <= available)
+      return;
+
+    const std::size_t size = chunk_header() + block_size(bytes);
+    void* const memory =
+      std::pmr::new_delete_resource()->allocate(size, Alignment);
+    _heap_bytes += size;
+
+    // The rest of the previous chunk is abandoned. Its blocks that are still
+    // in use will be returned to the free list.
+    _chunks = new(memory) Chunk{_chunks, size, chunk_header()};
+  }
+
+  /// True if the pointer refers to a block inside of the buffer
+  bool owns(const void* p) const
+  {
+    const auto* const byte = static_cast<const unsigned char*>(p);
+    return _buffer <= byte && byte < _buffer + Bytes;
+  }
+
+  /// The number of bytes that have been passed along to the heap and not
+  /// returned yet
+  std::size_t heap_bytes() const
+  {
+    return _heap_bytes;
+  }
+
+private:
+
+  struct FreeBlock
+  {
+    FreeBlock* next;
+    std::size_t bytes;
+  };
+
+  static_assert(sizeof(FreeBlock) <= Alignment);
+
+  /// A block of the heap that was set aside by reserve(). Its blocks are
+  /// handed out after this header.
+  struct Chunk
+  {
+    Chunk* next;
+    std::size_t size;
+    std::size_t used;
+  };
+
+  static constexpr std::size_t chunk_header()
+  {
+    return block_size(sizeof(Chunk));
+  }
+
+  /// True if the pointer refers to a block inside of a reserved chunk
+  bool in_chunk(const void* p) const
+  {
+    const auto* const byte = static_cast<const unsigned char*>(p);
+    for (const Chunk* chunk = _chunks; chunk; chunk = chunk->next)
+    {
+      const auto* const begin = reinterpret_cast<const unsigned char*>(chunk);
+      if (begin <= byte && byte < begin + chunk->size)
+        return true;
+    }
+
+    return false;
+  }
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) final
+  {
+    if (alignment <= Alignment)
+    {
+      const std::size_t size = block_size(bytes);
+      for (FreeBlock** block = &_free; *block; block = &(*block)->next)
+      {
+        if ((*block)->bytes == size)
+        {
+          FreeBlock* const output = *block;
+          *block = output->next;
+          return output;
+        }
+      }
+
+      if (size <= Bytes - _used)
+      {
+        void* const output = _buffer + _used;
+        _used += size;
+        return output;
+      }
+
+      if (_chunks && size <= _chunks->size - _chunks->used)
+      {
+        void* const output =
+          reinterpret_cast<unsigned char*>(_chunks) + _chunks->used;
+        _chunks->used += size;
+        return output;
+      }
+    }
+
+    void* const output =
+      std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    _heap_bytes += bytes;
+    return output;
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) final
+  {
+    if (!owns(p) && !in_chunk(p))
+    {
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+      _heap_bytes -= bytes;
+      return;
+    }
+
+    _free = new(p) FreeBlock{_free, block_size(bytes)};
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+  noexcept final
+  {
+    return this == &other;
+  }
+
+  // InlineResource<0> is used for its block sizes, and arrays cannot be empty
+  alignas(Alignment) unsigned char _buffer[Bytes > 0 ? Bytes : 1];
+  std::size_t _used = 0;
+  FreeBlock* _free = nullptr;
+  Chunk* _chunks = nullptr;
+  std::size_t _heap_bytes = 0;
+};
+
 //==============================================================================
 struct WaypointElement;
-using WaypointList = std::list<WaypointElement>;
+using WaypointList = std::pmr::list<WaypointElement>;
 
 //==============================================================================
-template<typename Key, typename Value>
+template<
+  typename Key,
+  typename Value,
+  template<typename> class Allocator = std::allocator>
 class TemplateOrderMap
 {
 public:
@@ -56,10 +238,16 @@ public:
     }
   };
 
-  using Storage = std::vector<Element>;
+  using Storage = std::vector<Element, Allocator<Element>>;
   using iterator = typename Storage::iterator;
   using const_iterator = typename Storage::const_iterator;
 
+  TemplateOrderMap(const Allocator<Element>& allocator = Allocator<Element>())
+  : _storage(allocator)
+  {
+    // Do nothing
+  }
+
   iterator begin()
   {
     return _storage.begin();
@@ -258,11 +446,17 @@ public:
     return _storage.empty();
   }
 
+  void reserve(const std::size_t n)
+  {
+    _storage.reserve(n);
+  }
+
 private:
   Storage _storage;
 };
 
-using OrderMap = TemplateOrderMap<Time, WaypointList::iterator>;
+using OrderMap = TemplateOrderMap<
+  Time, WaypointList::iterator, std::pmr::polymorphic_allocator>;
 
 //==============================================================================
 struct WaypointElement
@@ -305,10 +499,211 @@ struct WaypointElement
   WaypointElement& operator=(WaypointElement&&) = default;
 };
 
+//==============================================================================
+/// The number of waypoints that a Trajectory can hold before it needs to
+/// allocate any memory on the heap for them
+constexpr std::size_t TrajectoryInlineWaypoints = 6;
+
+//==============================================================================
+/// The bytes that each waypoint of a Trajectory uses up in its memory resource
+/// for the list node that holds the element and two links
+constexpr std::size_t TrajectoryNodeBytes =
+  InlineResource<0>::block_size(sizeof(WaypointElement) + 2*sizeof(void*));
+
+//==============================================================================
+/// The inline memory resource of a Trajectory. Each waypoint needs one list
+/// node, and the order map reserves room for all the inline waypoints the
+/// first time a waypoint is inserted.
+using TrajectoryResource = InlineResource<
+  TrajectoryInlineWaypoints
+  * (TrajectoryNodeBytes + sizeof(OrderMap::Element))
+  + InlineResource<0>::Alignment>;
+
 //==============================================================================
 WaypointList::const_iterator get_raw_iterator(
   const Trajectory::const_iterator& iterator);
 
+//==============================================================================
+struct BoundingBox
+{
+  Eigen::Vector2d min;
+  Eigen::Vector2d max;
+};
+
+//==============================================================================
+/// The parameters of a cubic spline that describe the motion of one segment of
+/// a Trajectory. See the Spline class for how these are used.
+struct SplineParameters
+{
+  std::array<Eigen::Vector4d, 3> coeffs;
+  double delta_t;
+  std::array<Time, 2> time_range;
+};
+
+//==============================================================================
+/// A node of a SegmentHierarchy. The node covers the segments whose indices
+/// are in the range [begin, end), so it spans the time from the waypoint with
+/// index begin-1 to the waypoint with index end-1.
+struct SegmentNode
+{
+  /// A box that contains the bounds of every segment that the node covers
+  BoundingBox bounds;
+
+  std::size_t begin;
+  std::size_t end;
+
+  /// The indices of the child nodes, which split the range of this node in
+  /// half. Both are 0 when this node is a leaf, since the root can never be a
+  /// child.
+  std::size_t left = 0;
+  std::size_t right = 0;
+};
+
+//==============================================================================
+/// A bounding volume hierarchy over the segments of a long trajectory. The
+/// segments are already sorted by time, so each node bounds a contiguous span
+/// of segments in both time and space. The root is at index 0.
+using SegmentHierarchy = std::vector<SegmentNode>;
+
+//==============================================================================
+/// A trajectory needs at least this many segments before a SegmentHierarchy
+/// is built for it. Shorter trajectories are scanned segment by segment, which
+/// is faster than descending a tree when there are only a few segments.
+constexpr std::size_t SegmentHierarchyThreshold = 64;
+
+//==============================================================================
+/// The number of segments in each leaf of a SegmentHierarchy
+constexpr std::size_t SegmentHierarchyLeafSize = 8;
+
+//==============================================================================
+/// Values that are derived from each segment of a Trajectory. The entry at
+/// index i of each vector describes the spline that finishes at the waypoint
+/// with index i. There is no spline that finishes at the first waypoint, so the
+/// entry at index 0 of bounds only contains the position of the first waypoint
+/// and the entry at index 0 of splines should not be used.
+struct SegmentCache
+{
+  /// A contiguous copy of the waypoints of the trajectory. The entry at index
+  /// i of each of these vectors belongs to the waypoint with index i. Code that
+  /// crawls through a trajectory many times can read these instead of walking
+  /// the linked list of waypoints.
+  std::vector<Time> times;
+  std::vector<Eigen::Vector3d> positions;
+  std::vector<Eigen::Vector3d> velocities;
+
+  std::vector<BoundingBox> bounds;
+
+  /// True for each segment whose start and finish waypoints have the same
+  /// position and zero velocity, like the holds made by expand_hold. The spline
+  /// of such a segment does not move, so conflict detection can test it with a
+  /// static overlap instead of a continuous collision check. The entry at index
+  /// 0 is always false.
+  std::vector<bool> stationary;
+
+  /// A box that contains every entry of bounds
+  BoundingBox total_bounds;
+
+  std::vector<SplineParameters> splines;
+
+  /// A hierarchy over the entries of bounds. This is only built when the
+  /// trajectory has at least SegmentHierarchyThreshold segments, otherwise it
+  /// is empty.
+  SegmentHierarchy hierarchy;
+};
+
+using ConstSegmentCachePtr = std::shared_ptr<const SegmentCache>;
+
+//==============================================================================
+/// Get the bounding boxes and spline parameters of each segment of the
+/// trajectory. These are computed the first time they are requested and then
+/// cached inside the trajectory until the next time the trajectory is modified,
+/// so repeated conflict checks against a trajectory that isn't changing will
+/// not need to recompute them.
+///
+/// The trajectory must not be empty.
+ConstSegmentCachePtr get_segment_cache(const Trajectory& trajectory);
+
+//==============================================================================
+/// Get the segment cache of the trajectory that the iterator belongs to. The
+/// iterator may be the end iterator of the trajectory, but it must not be a
+/// default-constructed iterator.
+ConstSegmentCachePtr get_segment_cache(
+  const Trajectory::const_iterator& iterator);
+
+//==============================================================================
+/// Get the index of the waypoint that the iterator refers to, or the size of
+/// its trajectory if it is the end iterator.
+std::size_t get_index(const Trajectory::const_iterator& iterator);
+
+//==============================================================================
+/// Build the hierarchy of a segment cache whose bounds have been filled in.
+/// Nothing is built if there are fewer than SegmentHierarchyThreshold
+/// segments.
+void build_segment_hierarchy(SegmentCache& cache);
+
+//==============================================================================
+/// Get the index of the first segment in the range [first, last) whose bounds
+/// overlap with box, or last if there is no such segment. When the cache has a
+/// hierarchy, only the subtrees that overlap with both the range and the box
+/// are visited. Otherwise the segments are scanned one at a time.
+std::size_t find_overlapping_segment(
+  const SegmentCache& cache,
+  std::size_t first,
+  std::size_t last,
+  const BoundingBox& box);
+
+//==============================================================================
+/// Get an iterator to the waypoint with the given index in constant time. If
+/// index is equal to the size of the trajectory, the end iterator is returned.
+Trajectory::const_iterator get_iterator(
+  const Trajectory& trajectory,
+  std::size_t index);
+
+//==============================================================================
+/// Get the number of bytes that a trajectory is holding: its own storage, the
+/// waypoints that did not fit inside of it, and its segment cache if that has
+/// been computed.
+std::size_t memory_usage(const Trajectory& trajectory);
+
+//==============================================================================
+/// Get the index of the first entry of times that does not come before time,
+/// or times.size() if every entry comes before it. The search begins from the
+/// hint, so looking up a time that is near the previous lookup, like when a
+/// trajectory is sampled sequentially, takes constant time. Lookups that land
+/// far away from the hint fall back to a binary search.
+///
+/// The entries of times must be sorted.
+std::size_t seek_time(
+  const std::vector<Time>& times,
+  std::size_t hint,
+  Time time);
+
+//==============================================================================
+/// Remembers where its last lookup landed in a sorted list of times, so that
+/// a sequence of nearby lookups takes amortized constant time each. This is
+/// meant to be used with SegmentCache::times.
+class TimeCursor
+{
+public:
+
+  explicit TimeCursor(const std::vector<Time>& times)
+  : _times(&times)
+  {
+    // Do nothing
+  }
+
+  /// Same as std::lower_bound over the times
+  std::size_t lower_bound(const Time time)
+  {
+    _index = seek_time(*_times, _index, time);
+    return _index;
+  }
+
+private:
+  const std::vector<Time>* _times;
+  std::size_t _index = 0;
+};
+
 } // namespace internal
 } // namespace rmf_traffic
 
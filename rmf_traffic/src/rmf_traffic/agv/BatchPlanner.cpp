@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <rmf_traffic/agv/BatchPlanner.hpp>
+#include <rmf_traffic/agv/RouteValidator.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+
+#include "internal_planning.hpp"
+#include "../schedule/internal_WorkerPool.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+class BatchPlanner::Request::Implementation
+{
+public:
+
+  schedule::ParticipantId id;
+  std::vector<Plan::Start> starts;
+  Plan::Goal goal;
+  std::shared_ptr<const Planner> planner;
+  int priority;
+
+};
+
+//==============================================================================
+BatchPlanner::Request::Request(
+  schedule::ParticipantId id,
+  Plan::Start start,
+  Plan::Goal goal,
+  std::shared_ptr<const Planner> planner,
+  int priority)
+: _pimpl(
+    rmf_utils::make_impl<Implementation>(
+      Implementation{
+        id, {std::move(start)}, std::move(goal),
+        std::move(planner), priority
+      }))
+{
+  // Do nothing
+}
+
+//==============================================================================
+BatchPlanner::Request::Request(
+  schedule::ParticipantId id,
+  std::vector<Plan::Start> starts,
+  Plan::Goal goal,
+  std::shared_ptr<const Planner> planner,
+  int priority)
+: _pimpl(
+    rmf_utils::make_impl<Implementation>(
+      Implementation{
+        id, std::move(starts), std::move(goal),
+        std::move(planner), priority
+      }))
+{
+  // Do nothing
+}
+
+//==============================================================================
+schedule::ParticipantId BatchPlanner::Request::id() const
+{
+  return _pimpl->id;
+}
+
+//==============================================================================
+auto BatchPlanner::Request::id(schedule::ParticipantId value) -> Request&
+{
+  _pimpl->id = value;
+  return *this;
+}
+
+//==============================================================================
+const std::vector<Plan::Start>& BatchPlanner::Request::starts() const
+{
+  return _pimpl->starts;
+}
+
+//==============================================================================
+auto BatchPlanner::Request::starts(std::vector<Plan::Start> values)
+-> Request&
+{
+  _pimpl->starts = std::move(values);
+  return *this;
+}
+
+//==============================================================================
+const Plan::Goal& BatchPlanner::Request::goal() const
+{
+  return _pimpl->goal;
+}
+
+//==============================================================================
+auto BatchPlanner::Request::goal(Plan::Goal value) -> Request&
+{
+  _pimpl->goal = std::move(value);
+  return *this;
+}
+
+//==============================================================================
+const std::shared_ptr<const Planner>& BatchPlanner::Request::planner() const
+{
+  return _pimpl->planner;
+}
+
+//==============================================================================
+auto BatchPlanner::Request::planner(std::shared_ptr<const Planner> value)
+-> Request&
+{
+  _pimpl->planner = std::move(value);
+  return *this;
+}
+
+//==============================================================================
+int BatchPlanner::Request::priority() const
+{
+  return _pimpl->priority;
+}
+
+//==============================================================================
+auto BatchPlanner::Request::priority(int value) -> Request&
+{
+  _pimpl->priority = value;
+  return *this;
+}
+
+//==============================================================================
+class BatchPlanner::Result::Implementation
+{
+public:
+
+  Plans plans;
+  std::vector<schedule::ParticipantId> failures;
+  std::size_t groups = 0;
+  Duration time = Duration(0);
+
+  static Result make()
+  {
+    Result output;
+    output._pimpl = rmf_utils::make_impl<Implementation>();
+    return output;
+  }
+
+  static Implementation& get(Result& result)
+  {
+    return *result._pimpl;
+  }
+};
+
+//==============================================================================
+auto BatchPlanner::Result::plans() const -> const Plans&
+{
+  return _pimpl->plans;
+}
+
+//==============================================================================
+const std::vector<schedule::ParticipantId>&
+BatchPlanner::Result::failures() const
+{
+  return _pimpl->failures;
+}
+
+//==============================================================================
+std::size_t BatchPlanner::Result::groups() const
+{
+  return _pimpl->groups;
+}
+
+//==============================================================================
+Duration BatchPlanner::Result::time() const
+{
+  return _pimpl->time;
+}
+
+//==============================================================================
+class BatchPlanner::Implementation
+{
+public:
+  std::size_t threads = 1;
+  bool exact = true;
+};
+
+//==============================================================================
+BatchPlanner::BatchPlanner()
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  // Do nothing
+}
+
+//==============================================================================
+BatchPlanner& BatchPlanner::threads(std::size_t n)
+{
+  _pimpl->threads = std::max<std::size_t>(n, 1);
+  return *this;
+}
+
+//==============================================================================
+std::size_t BatchPlanner::threads() const
+{
+  return _pimpl->threads;
+}
+
+//==============================================================================
+BatchPlanner& BatchPlanner::exact(bool on)
+{
+  _pimpl->exact = on;
+  return *this;
+}
+
+//==============================================================================
+bool BatchPlanner::exact() const
+{
+  return _pimpl->exact;
+}
+
+namespace {
+//==============================================================================
+/// Find the root of a disjoint set, compressing the path along the way
+std::size_t find_root(std::vector<std::size_t>& parents, std::size_t i)
+{
+  while (parents[i] != i)
+  {
+    parents[i] = parents[parents[i]];
+    i = parents[i];
+  }
+
+  return i;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+auto BatchPlanner::plan(const std::vector<Request>& requests) const -> Result
+{
+  const auto start_time = std::chrono::steady_clock::now();
+
+  std::unordered_set<schedule::ParticipantId> ids;
+  for (const auto& r : requests)
+  {
+    if (!ids.insert(r.id()).second)
+    {
+      // *INDENT-OFF*
+      throw std::runtime_error(
+        "[BatchPlanner::plan] Duplicate participant ["
+        + std::to_string(r.id()) + "] in list of requests");
+      // *INDENT-ON*
+    }
+
+    if (!r.planner())
+    {
+      // *INDENT-OFF*
+      throw std::runtime_error(
+        "[BatchPlanner::plan] No planner was given for participant ["
+        + std::to_string(r.id()) + "]");
+      // *INDENT-ON*
+    }
+  }
+
+  std::vector<std::size_t> order(requests.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+    [&](const std::size_t a, const std::size_t b)
+    {
+      return requests[a].priority() > requests[b].priority();
+    });
+
+  // Participants whose graphs share any maps are put in the same group
+  std::unordered_map<std::string, std::size_t> maps;
+  std::vector<std::size_t> parents;
+  std::vector<std::size_t> first_map(requests.size());
+  for (std::size_t i = 0; i < requests.size(); ++i)
+  {
+    // Every request gets a set of its own, in case its graph is empty
+    first_map[i] = parents.size();
+    parents.push_back(parents.size());
+
+    const auto& graph = requests[i].planner()->get_configuration().graph();
+    for (std::size_t w = 0; w < graph.num_waypoints(); ++w)
+    {
+      const auto inserted = maps.insert(
+        {graph.get_waypoint(w).get_map_name(), parents.size()});
+      if (inserted.second)
+        parents.push_back(parents.size());
+
+      parents[find_root(parents, inserted.first->second)] =
+        find_root(parents, first_map[i]);
+    }
+  }
+
+  // Each group is a list of requests in the order that they get planned
+  std::vector<std::vector<std::size_t>> groups;
+  std::unordered_map<std::size_t, std::size_t> group_of_root;
+  for (const auto i : order)
+  {
+    const auto root = find_root(parents, first_map[i]);
+    const auto inserted = group_of_root.insert({root, groups.size()});
+    if (inserted.second)
+      groups.emplace_back();
+
+    groups[inserted.first->second].push_back(i);
+  }
+
+  std::vector<std::optional<Plan>> plans(requests.size());
+  const bool exact = _pimpl->exact;
+  const auto plan_group = [&](const std::size_t g)
+    {
+      const auto& group = groups[g];
+
+      // The reservations of the group only need to tell apart the two
+      // largest participants.
+      std::vector<Profile> profiles;
+      for (const auto i : group)
+      {
+        profiles.push_back(
+          requests[i].planner()->get_configuration()
+          .vehicle_traits().profile());
+      }
+
+      using Layout = ReservationRouteValidator::Layout;
+      const double clearance = Layout::clearance_for(profiles);
+      std::unordered_map<const Graph::Implementation*,
+        std::shared_ptr<const Layout>> layouts;
+
+      const auto database = std::make_shared<schedule::Database>();
+      std::vector<schedule::ParticipantId> participants;
+      for (const auto i : group)
+      {
+        const auto& config = requests[i].planner()->get_configuration();
+        participants.push_back(
+          database->register_participant(
+            schedule::ParticipantDescription{
+              std::to_string(requests[i].id()),
+              "BatchPlanner",
+              schedule::ParticipantDescription::Rx::Unresponsive,
+              config.vehicle_traits().profile()
+            }).id());
+
+        auto& layout = layouts[planning::shared_graph(config).get()];
+        if (!layout)
+          layout = std::make_shared<Layout>(config.graph(), clearance);
+      }
+
+      for (std::size_t k = 0; k < group.size(); ++k)
+      {
+        const auto& request = requests[group[k]];
+        const auto& planner = *request.planner();
+        const auto& config = planner.get_configuration();
+
+        // The validator is shared instead of cloned so that every copy of the
+        // options uses the same reservations.
+        auto validator = std::make_shared<ReservationRouteValidator>(
+          database, participants[k], config.vehicle_traits().profile(),
+          layouts.at(planning::shared_graph(config).get()));
+        validator->geometric_confirmation(exact);
+
+        // The participant IDs of the reservations only have meaning inside of
+        // this batch, so the plans avoid each other by timing alone instead of
+        // depending on each other.
+        auto options = planner.get_default_options();
+        options.validator(std::move(validator));
+        options.dependency_window(std::nullopt);
+        auto result =
+          planner.plan(request.starts(), request.goal(), std::move(options));
+
+        if (!result.success())
+          continue;
+
+        database->extend(participants[k], result->get_itinerary(), 0);
+        plans[group[k]] = *result;
+      }
+    };
+
+  if (_pimpl->threads > 1 && groups.size() > 1)
+  {
+    schedule::WorkerPool pool(std::min(_pimpl->threads, groups.size()));
+    pool.run(groups.size(), plan_group);
+  }
+  else
+  {
+    for (std::size_t g = 0; g < groups.size(); ++g)
+      plan_group(g);
+  }
+
+  auto result = Result::Implementation::make();
+  auto& output = Result::Implementation::get(result);
+  for (const auto i : order)
+  {
+    if (plans[i].has_value())
+      output.plans.insert({requests[i].id(), std::move(*plans[i])});
+    else
+      output.failures.push_back(requests[i].id());
+  }
+
+  output.groups = groups.size();
+  output.time = std::chrono::steady_clock::now() - start_time;
+  return result;
+}
+
+} // namespace agv
+} // namespace rmf_traffic
@@ -18,8 +18,14 @@
 #include <rmf_traffic/agv/CentralizedNegotiation.hpp>
 #include <rmf_traffic/schedule/Negotiation.hpp>
 
+#include "../internal_Route.hpp"
+#include "../schedule/internal_WorkerPool.hpp"
+
+#include <algorithm>
 #include <deque>
 #include <iostream>
+#include <mutex>
+#include <queue>
 
 namespace rmf_traffic {
 namespace agv {
@@ -149,6 +155,7 @@ public:
   std::optional<Proposal> proposal;
   std::unordered_set<schedule::ParticipantId> blockers;
   std::vector<std::string> log;
+  Statistics statistics;
 
   static Result make()
   {
@@ -183,6 +190,12 @@ const std::vector<std::string>& CentralizedNegotiation::Result::log() const
   return _pimpl->log;
 }
 
+//==============================================================================
+auto CentralizedNegotiation::Result::statistics() const -> const Statistics&
+{
+  return _pimpl->statistics;
+}
+
 //==============================================================================
 class CentralizedNegotiation::Implementation
 {
@@ -191,6 +204,49 @@ public:
   bool optimal = false;
   bool log = false;
   bool print = false;
+  std::size_t threads = 1;
+  std::shared_ptr<rmf_traffic::Executor> executor = nullptr;
+  bool best_first = false;
+  std::optional<Duration> time_budget = std::nullopt;
+  bool incremental = false;
+
+  /// What an agent left behind from the last solve()
+  struct AgentMemory
+  {
+    std::vector<Plan::Start> starts;
+    Plan::Goal goal;
+    std::shared_ptr<const Planner> planner;
+    std::optional<SimpleNegotiator::Options> options;
+
+    std::optional<SimpleNegotiator> negotiator;
+
+    /// When the plan of the agent starts and how long it would take if there
+    /// were no traffic
+    std::optional<std::pair<Time, double>> ideal;
+  };
+
+  /// A route of a schedule participant that is not part of the negotiation
+  struct OutsideRoute
+  {
+    schedule::ParticipantId participant;
+    PlanId plan_id;
+    RouteId route_id;
+    std::shared_ptr<const Route> route;
+  };
+
+  /// What is remembered between calls to solve() when incremental is on
+  struct Memory
+  {
+    std::mutex mutex;
+    std::unordered_map<schedule::ParticipantId, AgentMemory> agents;
+    std::vector<OutsideRoute> outside;
+
+    // The approval callbacks of the remembered negotiators put their plans
+    // in here, so it needs to outlive any one solve().
+    std::shared_ptr<Proposal> proposal = std::make_shared<Proposal>();
+  };
+
+  std::shared_ptr<Memory> memory = std::make_shared<Memory>();
 };
 
 //==============================================================================
@@ -238,6 +294,63 @@ CentralizedNegotiation& CentralizedNegotiation::print(bool on)
   return *this;
 }
 
+//==============================================================================
+CentralizedNegotiation& CentralizedNegotiation::threads(std::size_t n)
+{
+  _pimpl->threads = std::max<std::size_t>(n, 1);
+  return *this;
+}
+
+//==============================================================================
+CentralizedNegotiation& CentralizedNegotiation::executor(
+  std::shared_ptr<rmf_traffic::Executor> value)
+{
+  _pimpl->executor = std::move(value);
+  return *this;
+}
+
+//==============================================================================
+const std::shared_ptr<rmf_traffic::Executor>&
+CentralizedNegotiation::executor() const
+{
+  return _pimpl->executor;
+}
+
+//==============================================================================
+CentralizedNegotiation& CentralizedNegotiation::best_first(bool on)
+{
+  _pimpl->best_first = on;
+  return *this;
+}
+
+//==============================================================================
+CentralizedNegotiation& CentralizedNegotiation::time_budget(
+  std::optional<Duration> budget)
+{
+  _pimpl->time_budget = budget;
+  return *this;
+}
+
+//==============================================================================
+CentralizedNegotiation& CentralizedNegotiation::incremental(bool on)
+{
+  _pimpl->incremental = on;
+  if (!on)
+    forget();
+
+  return *this;
+}
+
+//==============================================================================
+CentralizedNegotiation& CentralizedNegotiation::forget()
+{
+  auto& memory = *_pimpl->memory;
+  std::lock_guard<std::mutex> lock(memory.mutex);
+  memory.agents.clear();
+  memory.outside.clear();
+  return *this;
+}
+
 //==============================================================================
 namespace {
 std::string display_itinerary(const schedule::Itinerary& itinerary)
@@ -264,41 +377,361 @@ std::string display_itinerary(const schedule::Itinerary& itinerary)
 
   return ss.str();
 }
+
+//==============================================================================
+/// Holds on to the response of a negotiator so that it can be passed along to
+/// the table later. This lets the negotiators plan their responses in parallel
+/// while only one thread ever modifies the negotiation.
+class DeferredResponder : public schedule::Negotiator::Responder
+{
+public:
+
+  void submit(
+    PlanId plan_id,
+    std::vector<Route> itinerary,
+    ApprovalCallback approval_callback) const final
+  {
+    _response = [
+      plan_id,
+      itinerary = std::move(itinerary),
+      approval_callback = std::move(approval_callback)
+    ](const Responder& responder)
+      {
+        responder.submit(plan_id, itinerary, approval_callback);
+      };
+  }
+
+  void reject(const Alternatives& alternatives) const final
+  {
+    _response = [alternatives](const Responder& responder)
+      {
+        responder.reject(alternatives);
+      };
+  }
+
+  void forfeit(const std::vector<ParticipantId>& blockers) const final
+  {
+    _response = [blockers](const Responder& responder)
+      {
+        responder.forfeit(blockers);
+      };
+  }
+
+  void pass_to(const Responder& responder) const
+  {
+    if (_response)
+      _response(responder);
+  }
+
+private:
+  mutable std::function<void(const Responder&)> _response;
+};
+
+//==============================================================================
+std::optional<Time> finish_time(const schedule::Itinerary& itinerary)
+{
+  std::optional<Time> output;
+  for (const auto& route : itinerary)
+  {
+    const auto* t = route.trajectory().finish_time();
+    if (t && (!output.has_value() || *output < *t))
+      output = *t;
+  }
+
+  return output;
+}
+
+//==============================================================================
+/// The tables that are waiting for a response. By default this behaves like a
+/// stack, except that push_front() puts a table at the bottom. When it is
+/// prioritized, the table with the lowest cost is taken first, and ties are
+/// broken in favor of the table that was pushed most recently.
+class TableQueue
+{
+public:
+
+  using TablePtr = schedule::Negotiation::TablePtr;
+  using CostFunction = std::function<double(const TablePtr&)>;
+
+  TableQueue(CostFunction cost = nullptr)
+  : _cost(std::move(cost))
+  {
+    // Do nothing
+  }
+
+  bool empty() const
+  {
+    return _cost ? _prioritized.empty() : _stack.empty();
+  }
+
+  const TablePtr& top() const
+  {
+    return _cost ? _prioritized.top().table : _stack.back();
+  }
+
+  /// The lowest cost of any table in the queue. Only valid when prioritized.
+  double lowest_cost() const
+  {
+    return _prioritized.top().cost;
+  }
+
+  void pop()
+  {
+    if (_cost)
+      _prioritized.pop();
+    else
+      _stack.pop_back();
+  }
+
+  void push_back(TablePtr table)
+  {
+    if (_cost)
+      _prioritized.push({_cost(table), _count++, std::move(table)});
+    else
+      _stack.push_back(std::move(table));
+  }
+
+  void push_front(TablePtr table)
+  {
+    if (_cost)
+      push_back(std::move(table));
+    else
+      _stack.push_front(std::move(table));
+  }
+
+private:
+
+  struct Entry
+  {
+    double cost;
+    std::size_t count;
+    TablePtr table;
+
+    // std::priority_queue puts the greatest element on top
+    bool operator<(const Entry& other) const
+    {
+      if (cost != other.cost)
+        return other.cost < cost;
+
+      return count < other.count;
+    }
+  };
+
+  CostFunction _cost;
+  std::deque<TablePtr> _stack;
+  std::priority_queue<Entry> _prioritized;
+  std::size_t _count = 0;
+};
+
+//==============================================================================
+bool same_starts(
+  const std::vector<Plan::Start>& a,
+  const std::vector<Plan::Start>& b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    if (a[i].time() != b[i].time()
+      || a[i].waypoint() != b[i].waypoint()
+      || a[i].orientation() != b[i].orientation()
+      || a[i].location() != b[i].location()
+      || a[i].lane() != b[i].lane())
+      return false;
+  }
+
+  return true;
+}
+
+//==============================================================================
+bool same_goal(const Plan::Goal& a, const Plan::Goal& b)
+{
+  if (a.waypoint() != b.waypoint() || a.minimum_time() != b.minimum_time())
+    return false;
+
+  if (!a.orientation() || !b.orientation())
+    return a.orientation() == b.orientation();
+
+  return *a.orientation() == *b.orientation();
+}
+
+//==============================================================================
+bool same_options(
+  const std::optional<SimpleNegotiator::Options>& a,
+  const std::optional<SimpleNegotiator::Options>& b)
+{
+  if (a.has_value() != b.has_value())
+    return false;
+
+  if (!a.has_value())
+    return true;
+
+  // The approval callback and the reuse of search results are always replaced
+  // by solve(), and interrupted planning attempts are never remembered, so
+  // those options do not matter here.
+  return a->maximum_cost_leeway() == b->maximum_cost_leeway()
+    && a->maximum_alternatives() == b->maximum_alternatives()
+    && a->minimum_holding_time() == b->minimum_holding_time()
+    && a->minimum_cost_threshold() == b->minimum_cost_threshold()
+    && a->maximum_cost_threshold() == b->maximum_cost_threshold();
+}
+
+//==============================================================================
+bool same_agent(
+  const CentralizedNegotiation::Implementation::AgentMemory& memory,
+  const CentralizedNegotiation::Agent& agent)
+{
+  return memory.planner == agent.planner()
+    && same_starts(memory.starts, agent.starts())
+    && same_goal(memory.goal, agent.goal())
+    && same_options(memory.options, agent.options());
+}
+
+//==============================================================================
+using OutsideRoute = CentralizedNegotiation::Implementation::OutsideRoute;
+
+/// Get every route in the schedule that belongs to a participant which is not
+/// one of the agents
+std::vector<OutsideRoute> outside_routes(
+  const schedule::Viewer& viewer,
+  std::vector<schedule::ParticipantId> agents)
+{
+  auto query = schedule::query_all();
+  query.participants() =
+    schedule::Query::Participants::make_all_except(std::move(agents));
+
+  std::vector<OutsideRoute> output;
+  for (const auto& element : viewer.query(query))
+  {
+    output.push_back(
+      {element.participant, element.plan_id, element.route_id, element.route});
+  }
+
+  std::sort(output.begin(), output.end(),
+    [](const OutsideRoute& a, const OutsideRoute& b)
+    {
+      if (a.participant != b.participant)
+        return a.participant < b.participant;
+
+      return a.route_id < b.route_id;
+    });
+
+  return output;
+}
+
+//==============================================================================
+bool same_outside(
+  const std::vector<OutsideRoute>& a,
+  const std::vector<OutsideRoute>& b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    if (a[i].participant != b[i].participant
+      || a[i].plan_id != b[i].plan_id
+      || a[i].route_id != b[i].route_id)
+      return false;
+
+    if (a[i].route != b[i].route
+      && !RouteData::same_content(*a[i].route, *b[i].route))
+      return false;
+  }
+
+  return true;
+}
+
 } // anonymous namespace
 
 //==============================================================================
 auto CentralizedNegotiation::solve(const std::vector<Agent>& agents) const
 -> Result
 {
-  std::deque<schedule::Negotiation::TablePtr> queue;
+  const auto start_time = std::chrono::steady_clock::now();
   std::unordered_map<schedule::ParticipantId, SimpleNegotiator> negotiators;
-  std::unordered_map<schedule::ParticipantId, Plan> proposal;
+
+  auto& memory = *_pimpl->memory;
+  std::unique_lock<std::mutex> memory_lock(memory.mutex, std::defer_lock);
+  const bool incremental = _pimpl->incremental;
+  std::shared_ptr<Proposal> proposal_ptr;
+  std::vector<OutsideRoute> outside;
+  bool keep_negotiators = false;
+  if (incremental)
+  {
+    memory_lock.lock();
+    proposal_ptr = memory.proposal;
+    proposal_ptr->clear();
+
+    std::vector<schedule::ParticipantId> ids;
+    bool same_agents = memory.agents.size() == agents.size();
+    for (const auto& a : agents)
+    {
+      ids.push_back(a.id());
+      same_agents = same_agents && memory.agents.count(a.id()) > 0;
+    }
+
+    if (_pimpl->viewer)
+    {
+      // The planning attempts of the negotiators can only be trusted if every
+      // participant that they had to avoid is still where it was.
+      outside = outside_routes(*_pimpl->viewer, std::move(ids));
+      keep_negotiators = same_agents && same_outside(outside, memory.outside);
+    }
+  }
+  else
+  {
+    proposal_ptr = std::make_shared<Proposal>();
+  }
+  auto& proposal = *proposal_ptr;
 
   auto approvals = std::make_shared<schedule::SimpleResponder::ApprovalMap>();
   auto blockers = std::make_shared<schedule::SimpleResponder::BlockerSet>();
 
+  std::unordered_map<schedule::ParticipantId, Implementation::AgentMemory>
+  remembered;
   std::vector<schedule::ParticipantId> participants;
   for (const auto& a : agents)
   {
-    SimpleNegotiator::Options options;
-    if (a.options().has_value())
-      options = *a.options();
+    const Implementation::AgentMemory* previous = nullptr;
+    if (incremental)
+    {
+      const auto it = memory.agents.find(a.id());
+      if (it != memory.agents.end() && same_agent(it->second, a))
+        previous = &it->second;
+    }
 
-    using UpdateVersion = SimpleNegotiator::Responder::UpdateVersion;
-    options.approval_callback(
-      [&proposal, id = a.id()](rmf_traffic::agv::Plan plan) -> UpdateVersion
-      {
-        proposal.insert_or_assign(id, std::move(plan));
-        return std::nullopt;
-      });
+    std::optional<SimpleNegotiator> negotiator;
+    if (previous && keep_negotiators && previous->negotiator.has_value())
+      negotiator = previous->negotiator;
 
-    const auto inserted = negotiators.insert(
-      {
-        a.id(),
-        SimpleNegotiator(
-          std::make_shared<schedule::Participant::AssignIDPtr::element_type>(),
-          a.starts(), a.goal(), a.planner(), std::move(options))
-      }).second;
+    if (!negotiator.has_value())
+    {
+      SimpleNegotiator::Options options;
+      if (a.options().has_value())
+        options = *a.options();
+
+      // These negotiators only live for this one negotiation, or for as long
+      // as nothing that they planned around has changed, so they can safely
+      // reuse each other's planning attempts across sibling tables.
+      options.reuse_search_results(true);
+
+      using UpdateVersion = SimpleNegotiator::Responder::UpdateVersion;
+      options.approval_callback(
+        [proposal_ptr, id = a.id()](rmf_traffic::agv::Plan plan)
+        -> UpdateVersion
+        {
+          proposal_ptr->insert_or_assign(id, std::move(plan));
+          return std::nullopt;
+        });
+
+      negotiator.emplace(
+        std::make_shared<schedule::Participant::AssignIDPtr::element_type>(),
+        a.starts(), a.goal(), a.planner(), std::move(options));
+    }
+
+    const auto inserted = negotiators.insert({a.id(), *negotiator}).second;
 
     if (!inserted)
     {
@@ -309,9 +742,31 @@ auto CentralizedNegotiation::solve(const std::vector<Agent>& agents) const
       // *INDENT-ON*
     }
 
+    if (incremental)
+    {
+      std::optional<std::pair<Time, double>> ideal;
+      if (previous)
+        ideal = previous->ideal;
+
+      remembered.insert(
+        {
+          a.id(),
+          Implementation::AgentMemory{
+            a.starts(), a.goal(), a.planner(), a.options(),
+            std::move(negotiator), ideal
+          }
+        });
+    }
+
     participants.push_back(a.id());
   }
 
+  if (incremental)
+  {
+    memory.agents = std::move(remembered);
+    memory.outside = std::move(outside);
+  }
+
   auto negotiation = schedule::Negotiation::make(_pimpl->viewer, participants);
   if (!negotiation.has_value())
   {
@@ -322,6 +777,78 @@ auto CentralizedNegotiation::solve(const std::vector<Agent>& agents) const
     // *INDENT-ON*
   }
 
+  // The schedule is not changed while we solve, so the tables can all share
+  // the results of their queries about the participants that are outside of
+  // the negotiation.
+  negotiation->set_base_query_cache_capacity(256);
+
+  // For each agent, this is when its plan starts and how long its plan would
+  // take if there were no traffic
+  std::unordered_map<schedule::ParticipantId, std::pair<Time, double>> ideals;
+  double ideal_total = 0.0;
+  TableQueue::CostFunction table_cost;
+  if (_pimpl->best_first)
+  {
+    for (const auto& a : agents)
+    {
+      std::optional<std::pair<Time, double>>* remembered_ideal = nullptr;
+      if (incremental)
+      {
+        remembered_ideal = &memory.agents.at(a.id()).ideal;
+        if (remembered_ideal->has_value())
+        {
+          ideals[a.id()] = **remembered_ideal;
+          ideal_total += (*remembered_ideal)->second;
+          continue;
+        }
+      }
+
+      Time begin = Time::max();
+      for (const auto& s : a.starts())
+        begin = std::min(begin, s.time());
+
+      auto options = a.planner()->get_default_options();
+      options.validator(nullptr);
+      const auto ideal_plan = a.planner()->plan(a.starts(), a.goal(), options);
+
+      double ideal = 0.0;
+      if (ideal_plan)
+      {
+        if (const auto t = finish_time(ideal_plan->get_itinerary()))
+          ideal = std::max(0.0, time::to_seconds(*t - begin));
+      }
+
+      ideals[a.id()] = {begin, ideal};
+      ideal_total += ideal;
+
+      if (remembered_ideal)
+        *remembered_ideal = std::make_pair(begin, ideal);
+    }
+
+    table_cost = [&](const schedule::Negotiation::TablePtr& table)
+      {
+        double cost = ideal_total;
+        for (auto t = table; t; t = t->parent())
+        {
+          const auto* submission = t->submission();
+          if (!submission)
+            continue;
+
+          const auto& ideal = ideals.at(t->participant());
+          if (const auto finish = finish_time(*submission))
+          {
+            cost += std::max(0.0, time::to_seconds(*finish - ideal.first))
+              - ideal.second;
+          }
+        }
+
+        return cost;
+      };
+  }
+
+  TableQueue queue(table_cost);
+  std::optional<double> best_complete_cost;
+
   for (const auto& p : negotiation->participants())
   {
     const auto table = negotiation->table(p, {});
@@ -330,8 +857,20 @@ auto CentralizedNegotiation::solve(const std::vector<Agent>& agents) const
 
   auto finished = [&]()
     {
+      if (_pimpl->time_budget.has_value()
+        && *_pimpl->time_budget < std::chrono::steady_clock::now() - start_time)
+        return true;
+
       if (_pimpl->optimal)
+      {
+        // None of the remaining tables can lead to a better proposal than the
+        // best one that we already have
+        if (best_complete_cost.has_value()
+          && !queue.empty() && *best_complete_cost <= queue.lowest_cost())
+          return true;
+
         return negotiation->complete();
+      }
 
       return negotiation->ready();
     };
@@ -381,66 +920,148 @@ auto CentralizedNegotiation::solve(const std::vector<Agent>& agents) const
       return msg;
     };
 
+  const std::size_t batch_size = _pimpl->threads;
+  std::optional<schedule::WorkerPool> pool;
+  if (batch_size > 1)
+    pool.emplace(_pimpl->executor, batch_size);
+
+  std::vector<schedule::Negotiation::TablePtr> batch;
+  std::vector<schedule::Negotiation::Table::ViewerPtr> viewers;
+  std::vector<std::shared_ptr<DeferredResponder>> responses;
+  std::vector<SimpleNegotiator::Statistics> work;
   while (!queue.empty() && !finished())
   {
-    const auto top = queue.back();
-    queue.pop_back();
+    batch.clear();
+    while (batch.size() < batch_size && !queue.empty())
+    {
+      const auto top = queue.top();
 
-    if (log_or_print)
-      progress(selected_table(top));
+      // A table that is queued twice needs to see its first response before
+      // it can be responded to again.
+      if (std::find(batch.begin(), batch.end(), top) != batch.end())
+        break;
+
+      queue.pop();
 
-    if (skip(top))
-    {
       if (log_or_print)
-        progress("Skipping");
+        progress(selected_table(top));
+
+      if (skip(top))
+      {
+        if (log_or_print)
+          progress("Skipping");
+
+        continue;
+      }
+
+      batch.push_back(top);
+    }
 
+    if (batch.empty())
       continue;
+
+    // The negotiation is not modified while the responses are being planned,
+    // so the viewers of the tables can all be read at the same time.
+    viewers.clear();
+    responses.clear();
+    for (const auto& table : batch)
+    {
+      viewers.push_back(table->viewer());
+      responses.push_back(std::make_shared<DeferredResponder>());
     }
+    work.assign(batch.size(), SimpleNegotiator::Statistics());
 
-    auto& negotiator = negotiators.at(top->participant());
+    const auto respond = [&](const std::size_t i)
+      {
+        work[i] = negotiators.at(batch[i]->participant())
+          .respond_with_statistics(viewers[i], responses[i]);
+      };
 
-    blockers->clear();
-    const auto viewer = top->viewer();
-    negotiator.respond(
-      viewer, schedule::SimpleResponder::make(top, approvals, blockers));
+    if (pool.has_value() && batch.size() > 1)
+      pool->run(batch.size(), respond);
+    else
+      respond(0);
 
-    if (top->submission())
+    for (std::size_t i = 0; i < batch.size(); ++i)
     {
-      if (log_or_print)
-        progress("Submitted plan:" + display_itinerary(*top->submission()));
-
-      for (const auto& [p, _] : negotiators)
+      const auto& top = batch[i];
+      if (i > 0)
       {
-        const auto respond_to = top->respond(p);
-        if (respond_to)
-          queue.push_back(respond_to);
+        if (finished())
+          break;
+
+        // An earlier response in this batch might have rejected an ancestor
+        if (skip(top))
+        {
+          if (log_or_print)
+            progress("Skipping " + selected_table(top));
+
+          continue;
+        }
       }
 
-      continue;
-    }
+      rimpl.statistics.responses.push_back({top->sequence(), work[i]});
 
-    const auto parent = top->parent();
-    if (parent && parent->rejected())
-    {
-      if (log_or_print)
-        progress("Rejected parent");
+      blockers->clear();
+      responses[i]->pass_to(
+        *schedule::SimpleResponder::make(top, approvals, blockers));
 
-      queue.push_front(parent);
-    }
+      if (top->submission())
+      {
+        if (log_or_print)
+          progress("Submitted plan:" + display_itinerary(*top->submission()));
+
+        bool complete = true;
+        for (const auto& [p, _] : negotiators)
+        {
+          const auto respond_to = top->respond(p);
+          if (respond_to)
+          {
+            complete = false;
+            queue.push_back(respond_to);
+          }
+        }
+
+        if (complete && table_cost)
+        {
+          const double cost = table_cost(top);
+          if (!best_complete_cost.has_value() || cost < *best_complete_cost)
+            best_complete_cost = cost;
+        }
 
-    if (top->forfeited())
-    {
-      if (log_or_print)
-        progress("Forfeited");
+        continue;
+      }
+
+      const auto parent = top->parent();
+      if (parent && parent->rejected())
+      {
+        if (log_or_print)
+          progress("Rejected parent");
 
-      for (const auto& b : *blockers)
-        rimpl.blockers.insert(b);
+        queue.push_front(parent);
+      }
+
+      if (top->forfeited())
+      {
+        if (log_or_print)
+          progress("Forfeited");
+
+        for (const auto& b : *blockers)
+          rimpl.blockers.insert(b);
+      }
     }
   }
 
+  if (log_or_print && _pimpl->time_budget.has_value()
+    && *_pimpl->time_budget < std::chrono::steady_clock::now() - start_time)
+    progress("Ran out of time");
+
   for (const auto& p : participants)
     rimpl.blockers.erase(p);
 
+  rimpl.statistics.negotiation = negotiation->statistics();
+  rimpl.statistics.time = std::chrono::steady_clock::now() - start_time;
+
   if (!negotiation->ready())
     return result;
 
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_ConflictMemo.hpp"
+
+namespace rmf_traffic {
+namespace agv {
+
+namespace {
+//==============================================================================
+void hash_combine(std::size_t& seed, const std::size_t value)
+{
+  seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+//==============================================================================
+/// Get the segment cache of a trajectory, or a nullptr if the trajectory is
+/// too short to be checked for conflicts.
+internal::ConstSegmentCachePtr get_cache(const Trajectory& trajectory)
+{
+  if (trajectory.size() < 2)
+    return nullptr;
+
+  return internal::get_segment_cache(trajectory);
+}
+} // anonymous namespace
+
+//==============================================================================
+bool ConflictMemo::Key::operator==(const Key& other) const
+{
+  return trajectories == other.trajectories
+    && shapes == other.shapes
+    && tolerance == other.tolerance
+    && max_iterations == other.max_iterations
+    && solver == other.solver
+    && exact_time == other.exact_time;
+}
+
+//==============================================================================
+std::size_t ConflictMemo::Hash::operator()(const Key& key) const
+{
+  std::size_t seed = 0;
+  for (const auto* t : key.trajectories)
+    hash_combine(seed, std::hash<const void*>()(t));
+
+  for (const auto* s : key.shapes)
+    hash_combine(seed, std::hash<const void*>()(s));
+
+  hash_combine(seed, std::hash<double>()(key.tolerance));
+  hash_combine(seed, key.max_iterations);
+  hash_combine(seed, static_cast<std::size_t>(key.solver));
+  hash_combine(seed, key.exact_time);
+  return seed;
+}
+
+//==============================================================================
+ConflictMemo::ConflictMemo(const std::size_t capacity)
+: _capacity(capacity)
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto ConflictMemo::make_key(
+  const Profile& profile_a,
+  const internal::SegmentCache* cache_a,
+  const Profile& profile_b,
+  const internal::SegmentCache* cache_b,
+  const DetectConflict::Options& options) -> std::optional<Key>
+{
+  if (!cache_a || !cache_b)
+    return std::nullopt;
+
+  return Key{
+    {cache_a, cache_b},
+    {
+      profile_a.footprint().get(),
+      profile_a.vicinity().get(),
+      profile_b.footprint().get(),
+      profile_b.vicinity().get()
+    },
+    options.tolerance,
+    options.max_iterations,
+    options.solver,
+    options.exact_time
+  };
+}
+
+//==============================================================================
+auto ConflictMemo::find(
+  const Profile& profile_a,
+  const Trajectory& trajectory_a,
+  const Profile& profile_b,
+  const Trajectory& trajectory_b,
+  const DetectConflict::Options& options) -> std::optional<Result>
+{
+  const auto cache_a = get_cache(trajectory_a);
+  const auto cache_b = get_cache(trajectory_b);
+  const auto key = make_key(
+    profile_a, cache_a.get(), profile_b, cache_b.get(), options);
+  if (!key.has_value())
+    return std::nullopt;
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  const auto it = _lookup.find(*key);
+  if (it == _lookup.end())
+    return std::nullopt;
+
+  // Both caches are alive, so the result must have been remembered for them
+  // and not for caches that used to have the same addresses.
+  const auto& entry = *it->second;
+  if (entry.trajectories[0].lock() != cache_a
+    || entry.trajectories[1].lock() != cache_b)
+  {
+    _entries.erase(it->second);
+    _lookup.erase(it);
+    return std::nullopt;
+  }
+
+  _entries.splice(_entries.begin(), _entries, it->second);
+  return entry.result;
+}
+
+//==============================================================================
+void ConflictMemo::insert(
+  const Profile& profile_a,
+  const Trajectory& trajectory_a,
+  const Profile& profile_b,
+  const Trajectory& trajectory_b,
+  const DetectConflict::Options& options,
+  Result result)
+{
+  if (_capacity == 0)
+    return;
+
+  const auto cache_a = get_cache(trajectory_a);
+  const auto cache_b = get_cache(trajectory_b);
+  auto key = make_key(
+    profile_a, cache_a.get(), profile_b, cache_b.get(), options);
+  if (!key.has_value())
+    return;
+
+  Entry entry{
+    *key,
+    {cache_a, cache_b},
+    {
+      profile_a.footprint(),
+      profile_a.vicinity(),
+      profile_b.footprint(),
+      profile_b.vicinity()
+    },
+    result
+  };
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  const auto it = _lookup.find(*key);
+  if (it != _lookup.end())
+  {
+    *it->second = std::move(entry);
+    _entries.splice(_entries.begin(), _entries, it->second);
+    return;
+  }
+
+  _entries.push_front(std::move(entry));
+  _lookup.insert({*key, _entries.begin()});
+
+  while (_entries.size() > _capacity)
+  {
+    _lookup.erase(_entries.back().key);
+    _entries.pop_back();
+  }
+}
+
+//==============================================================================
+std::size_t ConflictMemo::capacity() const
+{
+  return _capacity;
+}
+
+//==============================================================================
+std::size_t ConflictMemo::size() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _entries.size();
+}
+
+} // namespace agv
+} // namespace rmf_traffic
@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/agv/CongestionField.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace agv {
+
+namespace {
+//==============================================================================
+/// The parts of a graph that a field needs. This is shared by a field and the
+/// fields that are refreshed from it.
+struct Layout
+{
+  struct Waypoint
+  {
+    std::string map;
+    Eigen::Vector2d location;
+  };
+
+  using Cell = std::pair<int64_t, int64_t>;
+
+  struct CellHash
+  {
+    std::size_t operator()(const Cell& cell) const
+    {
+      return std::hash<int64_t>()(cell.first * 73856093 ^ cell.second);
+    }
+  };
+
+  using Grid = std::unordered_map<Cell, std::vector<std::size_t>, CellHash>;
+
+  Layout(
+    const Graph& graph,
+    const double radius_,
+    std::vector<schedule::ParticipantId> ignore_)
+  : radius(radius_),
+    ignore(std::move(ignore_))
+  {
+    waypoints.reserve(graph.num_waypoints());
+    for (std::size_t i = 0; i < graph.num_waypoints(); ++i)
+    {
+      const auto& wp = graph.get_waypoint(i);
+      waypoints.push_back({wp.get_map_name(), wp.get_location()});
+      grids[wp.get_map_name()][cell(wp.get_location())].push_back(i);
+    }
+
+    lane_exits.reserve(graph.num_lanes());
+    for (std::size_t i = 0; i < graph.num_lanes(); ++i)
+      lane_exits.push_back(graph.get_lane(i).exit().waypoint_index());
+  }
+
+  Cell cell(const Eigen::Vector2d& p) const
+  {
+    return {
+      static_cast<int64_t>(std::floor(p.x() / radius)),
+      static_cast<int64_t>(std::floor(p.y() / radius))
+    };
+  }
+
+  double radius;
+  std::vector<schedule::ParticipantId> ignore;
+  std::vector<Waypoint> waypoints;
+  std::vector<std::size_t> lane_exits;
+  std::unordered_map<std::string, Grid> grids;
+};
+
+//==============================================================================
+/// The occupancy of one waypoint while a field is being measured
+struct Occupancy
+{
+  double occupied = 0.0;
+  std::size_t passes = 0;
+};
+
+//==============================================================================
+/// The times within [s0, s1] when p0 + s*(p1 - p0) is within radius of w.
+/// Returns false if there are no such times.
+bool overlap(
+  const Eigen::Vector2d& p0,
+  const Eigen::Vector2d& p1,
+  const Eigen::Vector2d& w,
+  const double radius,
+  double& s0,
+  double& s1)
+{
+  const Eigen::Vector2d v = p1 - p0;
+  const Eigen::Vector2d d = p0 - w;
+  const double a = v.dot(v);
+  const double c = d.dot(d) - radius*radius;
+  if (a < 1e-12)
+    return c <= 0.0;
+
+  const double b = 2.0 * d.dot(v);
+  const double discriminant = b*b - 4.0*a*c;
+  if (discriminant < 0.0)
+    return false;
+
+  const double root = std::sqrt(discriminant);
+  s0 = std::max(s0, (-b - root) / (2.0*a));
+  s1 = std::min(s1, (-b + root) / (2.0*a));
+  return s0 <= s1;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+class CongestionField::Implementation
+{
+public:
+
+  std::shared_ptr<const Layout> layout;
+  std::optional<schedule::Version> version;
+  Time start = Time(Duration(0));
+  Duration horizon = Duration(0);
+  std::vector<Duration> waypoint_delays;
+
+  static std::shared_ptr<const CongestionField> measure(
+    std::shared_ptr<const Layout> layout,
+    const schedule::Viewer& viewer,
+    const Time now,
+    const Duration horizon)
+  {
+    std::shared_ptr<CongestionField> field(new CongestionField);
+    auto& impl = *field->_pimpl;
+    impl.layout = std::move(layout);
+    impl.version = viewer.schedule_version();
+    impl.start = now;
+    impl.horizon = horizon;
+
+    const Layout& l = *impl.layout;
+    const Time finish = now + horizon;
+    std::vector<Occupancy> occupancy(l.waypoints.size());
+
+    schedule::Query::Spacetime spacetime;
+    spacetime.query_timespan(true)
+    .set_lower_time_bound(now)
+    .set_upper_time_bound(finish);
+
+    const auto participants = l.ignore.empty() ?
+      schedule::Query::Participants::make_all() :
+      schedule::Query::Participants::make_all_except(l.ignore);
+
+    // The end of the latest pass of the current route by each waypoint, so
+    // that the segments of one pass are only counted once
+    std::unordered_map<std::size_t, double> last_pass;
+
+    const double t_start = 0.0;
+    const double t_finish = time::to_seconds(horizon);
+    for (const auto& element : viewer.query(spacetime, participants))
+    {
+      const auto grid_it = l.grids.find(element.route->map());
+      if (grid_it == l.grids.end())
+        continue;
+
+      const auto& grid = grid_it->second;
+      const auto& trajectory = element.route->trajectory();
+      if (trajectory.size() < 2)
+        continue;
+
+      last_pass.clear();
+      auto prev = trajectory.begin();
+      for (auto it = ++trajectory.begin(); it != trajectory.end(); prev = it++)
+      {
+        const auto& wp0 = *prev;
+        const auto& wp1 = *it;
+        const double t0 = time::to_seconds(wp0.time() - now);
+        const double t1 = time::to_seconds(wp1.time() - now);
+        if (t1 <= t_start || t_finish <= t0 || t1 <= t0)
+          continue;
+
+        const Eigen::Vector2d p0 = wp0.position().block<2, 1>(0, 0);
+        const Eigen::Vector2d p1 = wp1.position().block<2, 1>(0, 0);
+        const double sa = std::max(0.0, (t_start - t0) / (t1 - t0));
+        const double sb = std::min(1.0, (t_finish - t0) / (t1 - t0));
+
+        const Eigen::Vector2d qa = p0 + sa*(p1 - p0);
+        const Eigen::Vector2d qb = p0 + sb*(p1 - p0);
+        const Eigen::Vector2d r = Eigen::Vector2d::Constant(l.radius);
+        const auto lower = l.cell(qa.cwiseMin(qb) - r);
+        const auto upper = l.cell(qa.cwiseMax(qb) + r);
+        for (int64_t x = lower.first; x <= upper.first; ++x)
+        {
+          for (int64_t y = lower.second; y <= upper.second; ++y)
+          {
+            const auto cell_it = grid.find({x, y});
+            if (cell_it == grid.end())
+              continue;
+
+            for (const std::size_t w : cell_it->second)
+            {
+              double s0 = sa;
+              double s1 = sb;
+              if (!overlap(p0, p1, l.waypoints[w].location, l.radius, s0, s1))
+                continue;
+
+              const double begin = t0 + s0*(t1 - t0);
+              const double end = t0 + s1*(t1 - t0);
+              auto& occ = occupancy[w];
+              occ.occupied += end - begin;
+
+              const auto insertion = last_pass.insert({w, end});
+              if (insertion.second || insertion.first->second + 1e-3 < begin)
+                ++occ.passes;
+
+              insertion.first->second = end;
+            }
+          }
+        }
+      }
+    }
+
+    impl.waypoint_delays.reserve(occupancy.size());
+    for (const auto& occ : occupancy)
+    {
+      if (occ.passes == 0)
+      {
+        impl.waypoint_delays.push_back(Duration(0));
+        continue;
+      }
+
+      const double expected = occ.occupied * occ.occupied
+        / (2.0 * t_finish * static_cast<double>(occ.passes));
+      impl.waypoint_delays.push_back(time::from_seconds(expected));
+    }
+
+    return field;
+  }
+};
+
+//==============================================================================
+std::shared_ptr<const CongestionField> CongestionField::make(
+  const Graph& graph,
+  const schedule::Viewer& viewer,
+  const Time now,
+  const Duration horizon,
+  const double radius,
+  std::vector<schedule::ParticipantId> ignore)
+{
+  if (horizon <= Duration(0) || !(radius > 0.0))
+  {
+    // *INDENT-OFF*
+    throw std::invalid_argument(
+      "[rmf_traffic::agv::CongestionField::make] The horizon and radius must "
+      "be greater than zero");
+    // *INDENT-ON*
+  }
+
+  return Implementation::measure(
+    std::make_shared<Layout>(graph, radius, std::move(ignore)),
+    viewer, now, horizon);
+}
+
+//==============================================================================
+std::shared_ptr<const CongestionField> CongestionField::refresh(
+  std::shared_ptr<const CongestionField> field,
+  const schedule::Viewer& viewer,
+  const Time now)
+{
+  if (!field || !field->stale(viewer, now))
+    return field;
+
+  return Implementation::measure(
+    field->_pimpl->layout, viewer, now, field->_pimpl->horizon);
+}
+
+//==============================================================================
+bool CongestionField::stale(
+  const schedule::Viewer& viewer,
+  const Time now) const
+{
+  const auto version = viewer.schedule_version();
+  if (!version.has_value() || version != _pimpl->version)
+    return true;
+
+  return now - _pimpl->start > _pimpl->horizon/4;
+}
+
+//==============================================================================
+std::optional<schedule::Version> CongestionField::schedule_version() const
+{
+  return _pimpl->version;
+}
+
+//==============================================================================
+Time CongestionField::start_time() const
+{
+  return _pimpl->start;
+}
+
+//==============================================================================
+Duration CongestionField::horizon() const
+{
+  return _pimpl->horizon;
+}
+
+//==============================================================================
+double CongestionField::radius() const
+{
+  return _pimpl->layout->radius;
+}
+
+//==============================================================================
+std::size_t CongestionField::num_waypoints() const
+{
+  return _pimpl->waypoint_delays.size();
+}
+
+//==============================================================================
+Duration CongestionField::waypoint_delay(const std::size_t waypoint) const
+{
+  if (waypoint >= _pimpl->waypoint_delays.size())
+    return Duration(0);
+
+  return _pimpl->waypoint_delays[waypoint];
+}
+
+//==============================================================================
+Duration CongestionField::lane_delay(const std::size_t lane) const
+{
+  const auto& exits = _pimpl->layout->lane_exits;
+  if (lane >= exits.size())
+    return Duration(0);
+
+  return _pimpl->waypoint_delays[exits[lane]];
+}
+
+//==============================================================================
+CongestionField::CongestionField()
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  // Do nothing
+}
+
+} // namespace agv
+} // namespace rmf_traffic
@@ -22,6 +22,14 @@
 #include <rmf_utils/math.hpp>
 #include <rmf_utils/optional.hpp>
 
+#include <array>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
 namespace rmf_traffic {
 namespace agv {
 
@@ -779,6 +787,16 @@ Graph::Graph()
   // Do nothing
 }
 
+//==============================================================================
+void Graph::reserve(const std::size_t waypoints, const std::size_t lanes)
+{
+  _pimpl->waypoints.reserve(waypoints);
+  _pimpl->lanes_from.reserve(waypoints);
+  _pimpl->lanes_into.reserve(waypoints);
+  _pimpl->lane_between.reserve(waypoints);
+  _pimpl->lanes.reserve(lanes);
+}
+
 //==============================================================================
 auto Graph::add_waypoint(
   std::string map_name,
@@ -908,6 +926,70 @@ auto Graph::add_lane(
   return _pimpl->lanes.back();
 }
 
+//==============================================================================
+std::size_t Graph::add_lanes(std::vector<LaneInfo> lanes)
+{
+  const std::size_t num_waypoints = _pimpl->waypoints.size();
+  std::vector<std::size_t> num_from(num_waypoints, 0);
+  std::vector<std::size_t> num_into(num_waypoints, 0);
+  for (std::size_t i = 0; i < lanes.size(); ++i)
+  {
+    for (const auto* node : {&lanes[i].entry, &lanes[i].exit})
+    {
+      if (num_waypoints <= node->waypoint_index())
+      {
+        // *INDENT-OFF*
+        throw std::out_of_range(
+          "[Graph::add_lanes] Lane #" + std::to_string(i) + " refers to "
+          "waypoint " + std::to_string(node->waypoint_index()) + ", but the "
+          "graph only has " + std::to_string(num_waypoints) + " waypoints");
+        // *INDENT-ON*
+      }
+    }
+
+    ++num_from[lanes[i].entry.waypoint_index()];
+    ++num_into[lanes[i].exit.waypoint_index()];
+  }
+
+  for (std::size_t wp = 0; wp < num_waypoints; ++wp)
+  {
+    if (num_from[wp] > 0)
+    {
+      auto& from = _pimpl->lanes_from[wp];
+      from.reserve(from.size() + num_from[wp]);
+      auto& between = _pimpl->lane_between[wp];
+      between.reserve(between.size() + num_from[wp]);
+    }
+
+    if (num_into[wp] > 0)
+    {
+      auto& into = _pimpl->lanes_into[wp];
+      into.reserve(into.size() + num_into[wp]);
+    }
+  }
+
+  const std::size_t first_lane = _pimpl->lanes.size();
+  _pimpl->lanes.reserve(first_lane + lanes.size());
+  for (auto& lane : lanes)
+  {
+    const std::size_t lane_id = _pimpl->lanes.size();
+    const std::size_t entry_index = lane.entry.waypoint_index();
+    const std::size_t exit_index = lane.exit.waypoint_index();
+    _pimpl->lanes_from[entry_index].push_back(lane_id);
+    _pimpl->lanes_into[exit_index].push_back(lane_id);
+    _pimpl->lane_between[entry_index][exit_index] = lane_id;
+
+    _pimpl->lanes.emplace_back(
+      Lane::Implementation::make(
+        lane_id,
+        std::move(lane.entry),
+        std::move(lane.exit),
+        std::move(lane.properties)));
+  }
+
+  return first_lane;
+}
+
 //==============================================================================
 auto Graph::get_lane(const std::size_t index) -> Lane&
 {
@@ -956,5 +1038,559 @@ auto Graph::lane_from(std::size_t from_wp, std::size_t to_wp) const
   return const_cast<Graph&>(*this).lane_from(from_wp, to_wp);
 }
 
+namespace {
+//==============================================================================
+// Bump this whenever the layout of the snapshot changes
+const std::uint32_t SnapshotFormat = 1;
+const std::array<char, 8> SnapshotMagic =
+{'R', 'M', 'F', 'G', 'R', 'A', 'P', 0};
+
+//==============================================================================
+template<typename T>
+void write(std::ostream& output, const T& value)
+{
+  static_assert(std::is_arithmetic_v<T>);
+  output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//==============================================================================
+void write(std::ostream& output, const std::string& value)
+{
+  write<std::uint64_t>(output, value.size());
+  output.write(value.data(), value.size());
+}
+
+//==============================================================================
+template<typename T>
+bool read(std::istream& input, T& value)
+{
+  static_assert(std::is_arithmetic_v<T>);
+  input.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return input.gcount() == static_cast<std::streamsize>(sizeof(T));
+}
+
+//==============================================================================
+bool read(std::istream& input, std::string& value)
+{
+  std::uint64_t size;
+  if (!read(input, size))
+    return false;
+
+  // Read in chunks so that a damaged size cannot trigger a huge allocation
+  value.clear();
+  std::array<char, 256> buffer;
+  while (value.size() < size)
+  {
+    const std::size_t chunk =
+      std::min<std::uint64_t>(buffer.size(), size - value.size());
+    input.read(buffer.data(), chunk);
+    if (input.gcount() != static_cast<std::streamsize>(chunk))
+      return false;
+
+    value.append(buffer.data(), chunk);
+  }
+
+  return true;
+}
+
+//==============================================================================
+/// A 64-bit FNV-1a hash of the body of a snapshot
+std::uint64_t checksum(const std::string& body)
+{
+  std::uint64_t hash = 14695981039346656037ull;
+  for (const char c : body)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+//==============================================================================
+enum class EventKind : std::uint8_t
+{
+  None = 0,
+  DoorOpen,
+  DoorClose,
+  LiftSessionBegin,
+  LiftDoorOpen,
+  LiftSessionEnd,
+  LiftMove,
+  Dock,
+  Wait
+};
+
+//==============================================================================
+class EventWriter : public Graph::Lane::Executor
+{
+public:
+
+  EventWriter(std::ostream& output)
+  : _output(output)
+  {
+    // Do nothing
+  }
+
+  void execute(const DoorOpen& open) final
+  {
+    door(EventKind::DoorOpen, open);
+  }
+
+  void execute(const DoorClose& close) final
+  {
+    door(EventKind::DoorClose, close);
+  }
+
+  void execute(const LiftSessionBegin& begin) final
+  {
+    lift(EventKind::LiftSessionBegin, begin);
+  }
+
+  void execute(const LiftDoorOpen& open) final
+  {
+    lift(EventKind::LiftDoorOpen, open);
+  }
+
+  void execute(const LiftSessionEnd& end) final
+  {
+    lift(EventKind::LiftSessionEnd, end);
+  }
+
+  void execute(const LiftMove& move) final
+  {
+    lift(EventKind::LiftMove, move);
+  }
+
+  void execute(const Dock& dock) final
+  {
+    write(_output, static_cast<std::uint8_t>(EventKind::Dock));
+    write(_output, dock.dock_name());
+    write(_output, dock.duration().count());
+  }
+
+  void execute(const Wait& wait) final
+  {
+    write(_output, static_cast<std::uint8_t>(EventKind::Wait));
+    write(_output, wait.duration().count());
+  }
+
+private:
+
+  void door(const EventKind kind, const Graph::Lane::Door& door)
+  {
+    write(_output, static_cast<std::uint8_t>(kind));
+    write(_output, door.name());
+    write(_output, door.duration().count());
+  }
+
+  void lift(const EventKind kind, const Graph::Lane::LiftSession& lift)
+  {
+    write(_output, static_cast<std::uint8_t>(kind));
+    write(_output, lift.lift_name());
+    write(_output, lift.floor_name());
+    write(_output, lift.duration().count());
+  }
+
+  std::ostream& _output;
+};
+
+//==============================================================================
+bool read_event(std::istream& input, Graph::Lane::EventPtr& event)
+{
+  using Lane = Graph::Lane;
+
+  std::uint8_t kind;
+  if (!read(input, kind))
+    return false;
+
+  std::string name;
+  std::string floor;
+  Duration::rep duration;
+  switch (static_cast<EventKind>(kind))
+  {
+    case EventKind::None:
+      event = nullptr;
+      return true;
+    case EventKind::DoorOpen:
+    case EventKind::DoorClose:
+    case EventKind::Dock:
+      if (!read(input, name) || !read(input, duration))
+        return false;
+      break;
+    case EventKind::LiftSessionBegin:
+    case EventKind::LiftDoorOpen:
+    case EventKind::LiftSessionEnd:
+    case EventKind::LiftMove:
+      if (!read(input, name) || !read(input, floor) || !read(input, duration))
+        return false;
+      break;
+    case EventKind::Wait:
+      if (!read(input, duration))
+        return false;
+      break;
+    default:
+      return false;
+  }
+
+  const Duration d(duration);
+  switch (static_cast<EventKind>(kind))
+  {
+    case EventKind::DoorOpen:
+      event = Lane::Event::make(Lane::DoorOpen(std::move(name), d));
+      break;
+    case EventKind::DoorClose:
+      event = Lane::Event::make(Lane::DoorClose(std::move(name), d));
+      break;
+    case EventKind::LiftSessionBegin:
+      event = Lane::Event::make(
+        Lane::LiftSessionBegin(std::move(name), std::move(floor), d));
+      break;
+    case EventKind::LiftDoorOpen:
+      event = Lane::Event::make(
+        Lane::LiftDoorOpen(std::move(name), std::move(floor), d));
+      break;
+    case EventKind::LiftSessionEnd:
+      event = Lane::Event::make(
+        Lane::LiftSessionEnd(std::move(name), std::move(floor), d));
+      break;
+    case EventKind::LiftMove:
+      event = Lane::Event::make(
+        Lane::LiftMove(std::move(name), std::move(floor), d));
+      break;
+    case EventKind::Dock:
+      event = Lane::Event::make(Lane::Dock(std::move(name), d));
+      break;
+    default:
+      event = Lane::Event::make(Lane::Wait(d));
+      break;
+  }
+
+  return true;
+}
+
+//==============================================================================
+enum class ConstraintKind : std::uint8_t
+{
+  None = 0,
+  Acceptable,
+  Direction
+};
+
+//==============================================================================
+void write_constraint(
+  std::ostream& output,
+  const Graph::OrientationConstraint* constraint)
+{
+  if (!constraint)
+  {
+    write(output, static_cast<std::uint8_t>(ConstraintKind::None));
+    return;
+  }
+
+  if (const auto* acceptable =
+    dynamic_cast<const AcceptableOrientationConstraint*>(constraint))
+  {
+    write(output, static_cast<std::uint8_t>(ConstraintKind::Acceptable));
+    write<std::uint64_t>(output, acceptable->orientations.size());
+    for (const double theta : acceptable->orientations)
+      write(output, theta);
+
+    return;
+  }
+
+  if (const auto* direction =
+    dynamic_cast<const DirectionConstraint*>(constraint))
+  {
+    write(output, static_cast<std::uint8_t>(ConstraintKind::Direction));
+    write(output, static_cast<std::uint8_t>(direction->direction));
+    write(output, direction->R_f.angle());
+    return;
+  }
+
+  // *INDENT-OFF*
+  throw std::runtime_error(
+    "[Graph::save] A lane has a custom OrientationConstraint, which cannot be "
+    "written into a snapshot. Only constraints that were made by "
+    "OrientationConstraint::make() are supported.");
+  // *INDENT-ON*
+}
+
+//==============================================================================
+bool read_constraint(
+  std::istream& input,
+  rmf_utils::clone_ptr<Graph::OrientationConstraint>& constraint)
+{
+  std::uint8_t kind;
+  if (!read(input, kind))
+    return false;
+
+  switch (static_cast<ConstraintKind>(kind))
+  {
+    case ConstraintKind::None:
+    {
+      constraint = nullptr;
+      return true;
+    }
+    case ConstraintKind::Acceptable:
+    {
+      std::uint64_t count;
+      if (!read(input, count))
+        return false;
+
+      std::vector<double> orientations;
+      for (std::uint64_t i = 0; i < count; ++i)
+      {
+        double theta;
+        if (!read(input, theta))
+          return false;
+
+        orientations.push_back(theta);
+      }
+
+      constraint = Graph::OrientationConstraint::make(std::move(orientations));
+      return true;
+    }
+    case ConstraintKind::Direction:
+    {
+      std::uint8_t direction;
+      double angle;
+      if (!read(input, direction) || !read(input, angle) || direction > 1)
+        return false;
+
+      constraint = Graph::OrientationConstraint::make(
+        static_cast<Graph::OrientationConstraint::Direction>(direction),
+        Eigen::Vector2d(std::cos(angle), std::sin(angle)));
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//==============================================================================
+void write_node(std::ostream& output, const Graph::Lane::Node& node)
+{
+  write<std::uint64_t>(output, node.waypoint_index());
+  if (const auto* event = node.event())
+  {
+    EventWriter writer(output);
+    event->execute(writer);
+  }
+  else
+  {
+    write(output, static_cast<std::uint8_t>(EventKind::None));
+  }
+
+  write_constraint(output, node.orientation_constraint());
+}
+
+//==============================================================================
+// Nodes cannot be moved around, so their fields are read into this first
+struct NodeData
+{
+  std::size_t waypoint;
+  Graph::Lane::EventPtr event;
+  rmf_utils::clone_ptr<Graph::OrientationConstraint> constraint;
+
+  Graph::Lane::Node make()
+  {
+    return Graph::Lane::Node(
+      waypoint, std::move(event), std::move(constraint));
+  }
+};
+
+//==============================================================================
+std::optional<NodeData> read_node(
+  std::istream& input,
+  const std::size_t num_waypoints)
+{
+  NodeData node;
+  std::uint64_t waypoint;
+  if (!read(input, waypoint) || num_waypoints <= waypoint)
+    return std::nullopt;
+
+  node.waypoint = waypoint;
+  if (!read_event(input, node.event))
+    return std::nullopt;
+
+  if (!read_constraint(input, node.constraint))
+    return std::nullopt;
+
+  return node;
+}
+
+//==============================================================================
+// The flags of a waypoint, packed into one byte
+enum WaypointFlag : std::uint8_t
+{
+  HoldingPoint = 1 << 0,
+  PassthroughPoint = 1 << 1,
+  ParkingSpot = 1 << 2,
+  Charger = 1 << 3
+};
+
+} // anonymous namespace
+
+//==============================================================================
+void Graph::save(std::ostream& output) const
+{
+  // The body is put together first so that its checksum can come before it
+  std::stringstream body;
+  write<std::uint64_t>(body, _pimpl->waypoints.size());
+  for (const auto& wp : _pimpl->waypoints)
+  {
+    write(body, wp.get_map_name());
+    write(body, wp.get_location().x());
+    write(body, wp.get_location().y());
+
+    std::uint8_t flags = 0;
+    if (wp.is_holding_point())
+      flags |= HoldingPoint;
+    if (wp.is_passthrough_point())
+      flags |= PassthroughPoint;
+    if (wp.is_parking_spot())
+      flags |= ParkingSpot;
+    if (wp.is_charger())
+      flags |= Charger;
+    write(body, flags);
+
+    write<std::uint8_t>(body, wp.name() != nullptr);
+    if (const auto* name = wp.name())
+      write(body, *name);
+  }
+
+  write<std::uint64_t>(body, _pimpl->keys.size());
+  for (const auto& [key, wp] : _pimpl->keys)
+  {
+    write(body, key);
+    write<std::uint64_t>(body, wp);
+  }
+
+  write<std::uint64_t>(body, _pimpl->lanes.size());
+  for (const auto& lane : _pimpl->lanes)
+  {
+    write_node(body, lane.entry());
+    write_node(body, lane.exit());
+
+    const auto speed_limit = lane.properties().speed_limit();
+    write<std::uint8_t>(body, speed_limit.has_value());
+    if (speed_limit.has_value())
+      write(body, *speed_limit);
+  }
+
+  const std::string data = body.str();
+  output.write(SnapshotMagic.data(), SnapshotMagic.size());
+  write(output, SnapshotFormat);
+  write(output, checksum(data));
+  write(output, data);
+}
+
+//==============================================================================
+std::optional<Graph> Graph::load(std::istream& input)
+{
+  std::array<char, 8> magic;
+  input.read(magic.data(), magic.size());
+  if (input.gcount() != static_cast<std::streamsize>(magic.size()))
+    return std::nullopt;
+
+  if (magic != SnapshotMagic)
+    return std::nullopt;
+
+  std::uint32_t format;
+  if (!read(input, format) || format != SnapshotFormat)
+    return std::nullopt;
+
+  std::uint64_t expected_checksum;
+  std::string data;
+  if (!read(input, expected_checksum) || !read(input, data))
+    return std::nullopt;
+
+  if (checksum(data) != expected_checksum)
+    return std::nullopt;
+
+  std::istringstream body(std::move(data));
+
+  std::uint64_t num_waypoints;
+  if (!read(body, num_waypoints))
+    return std::nullopt;
+
+  Graph graph;
+  for (std::uint64_t i = 0; i < num_waypoints; ++i)
+  {
+    std::string map;
+    double x, y;
+    std::uint8_t flags, has_name;
+    if (!read(body, map) || !read(body, x) || !read(body, y)
+      || !read(body, flags) || !read(body, has_name))
+      return std::nullopt;
+
+    auto& wp = graph.add_waypoint(std::move(map), Eigen::Vector2d(x, y));
+    wp.set_holding_point(flags & HoldingPoint);
+    wp.set_passthrough_point(flags & PassthroughPoint);
+    wp.set_parking_spot(flags & ParkingSpot);
+    wp.set_charger(flags & Charger);
+
+    if (has_name)
+    {
+      std::string name;
+      if (!read(body, name))
+        return std::nullopt;
+
+      Waypoint::Implementation::get(wp).name = std::move(name);
+    }
+  }
+
+  std::uint64_t num_keys;
+  if (!read(body, num_keys))
+    return std::nullopt;
+
+  for (std::uint64_t i = 0; i < num_keys; ++i)
+  {
+    std::string key;
+    std::uint64_t wp;
+    if (!read(body, key) || !read(body, wp) || num_waypoints <= wp)
+      return std::nullopt;
+
+    graph._pimpl->keys[std::move(key)] = wp;
+  }
+
+  std::uint64_t num_lanes;
+  if (!read(body, num_lanes))
+    return std::nullopt;
+
+  std::vector<LaneInfo> lanes;
+  for (std::uint64_t i = 0; i < num_lanes; ++i)
+  {
+    auto entry = read_node(body, num_waypoints);
+    if (!entry.has_value())
+      return std::nullopt;
+
+    auto exit = read_node(body, num_waypoints);
+    if (!exit.has_value())
+      return std::nullopt;
+
+    std::uint8_t has_speed_limit;
+    if (!read(body, has_speed_limit))
+      return std::nullopt;
+
+    Lane::Properties properties;
+    if (has_speed_limit)
+    {
+      double speed_limit;
+      if (!read(body, speed_limit))
+        return std::nullopt;
+
+      properties.speed_limit(speed_limit);
+    }
+
+    lanes.push_back(
+      LaneInfo{entry->make(), exit->make(), std::move(properties)});
+  }
+
+  graph.add_lanes(std::move(lanes));
+  return graph;
+}
+
 } // namespace avg
 } // namespace rmf_traffic
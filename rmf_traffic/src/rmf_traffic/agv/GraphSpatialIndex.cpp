@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/agv/GraphSpatialIndex.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+class GraphSpatialIndex::Implementation
+{
+public:
+
+  struct Lane
+  {
+    Eigen::Vector2d p0;
+    Eigen::Vector2d p1;
+  };
+
+  // Each cell is keyed by its column in the upper 32 bits and its row in the
+  // lower 32 bits.
+  using Cells = std::unordered_map<uint64_t, std::vector<std::size_t>>;
+
+  struct Grid
+  {
+    Cells waypoints;
+    Cells lanes;
+  };
+
+  double cell_size;
+  std::vector<Eigen::Vector2d> waypoints;
+  std::vector<Lane> lanes;
+  std::unordered_map<std::string, Grid> grids;
+
+  int64_t coordinate(const double value) const
+  {
+    return static_cast<int64_t>(std::floor(value / cell_size));
+  }
+
+  static uint64_t key(const int64_t x, const int64_t y)
+  {
+    return (static_cast<uint64_t>(x) << 32)
+      | static_cast<uint64_t>(static_cast<uint32_t>(y));
+  }
+
+  uint64_t key(const Eigen::Vector2d& p) const
+  {
+    return key(coordinate(p.x()), coordinate(p.y()));
+  }
+
+  void add_lane(Grid& grid, const std::size_t index, const Lane& lane)
+  {
+    // Every point of the lane is within half of a cell of one of these
+    // samples, so a query that looks one cell past its radius will find it.
+    const double length = (lane.p1 - lane.p0).norm();
+    const std::size_t steps =
+      static_cast<std::size_t>(std::ceil(length / cell_size));
+
+    uint64_t last = 0;
+    for (std::size_t i = 0; i <= steps; ++i)
+    {
+      const double s = steps == 0 ? 0.0 : static_cast<double>(i) / steps;
+      const uint64_t cell = key(lane.p0 + s*(lane.p1 - lane.p0));
+      if (i > 0 && cell == last)
+        continue;
+
+      auto& bucket = grid.lanes[cell];
+      if (bucket.empty() || bucket.back() != index)
+        bucket.push_back(index);
+
+      last = cell;
+    }
+  }
+
+  template<typename Check>
+  std::vector<std::size_t> query(
+    const Cells& cells,
+    const Eigen::Vector2d& location,
+    const double radius,
+    const int64_t margin,
+    const Check& check) const
+  {
+    std::vector<std::size_t> output;
+    if (!(radius > 0.0))
+      return output;
+
+    const int64_t x0 = coordinate(location.x() - radius) - margin;
+    const int64_t x1 = coordinate(location.x() + radius) + margin;
+    const int64_t y0 = coordinate(location.y() - radius) - margin;
+    const int64_t y1 = coordinate(location.y() + radius) + margin;
+    for (int64_t x = x0; x <= x1; ++x)
+    {
+      for (int64_t y = y0; y <= y1; ++y)
+      {
+        const auto it = cells.find(key(x, y));
+        if (it == cells.end())
+          continue;
+
+        for (const std::size_t i : it->second)
+        {
+          if (check(i))
+            output.push_back(i);
+        }
+      }
+    }
+
+    std::sort(output.begin(), output.end());
+    output.erase(std::unique(output.begin(), output.end()), output.end());
+    return output;
+  }
+};
+
+//==============================================================================
+GraphSpatialIndex::GraphSpatialIndex(
+  const Graph& graph,
+  const double cell_size)
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  if (!(cell_size > 0.0))
+  {
+    // *INDENT-OFF*
+    throw std::invalid_argument(
+      "[rmf_traffic::agv::GraphSpatialIndex] The cell size must be greater "
+      "than zero");
+    // *INDENT-ON*
+  }
+
+  auto& impl = *_pimpl;
+  impl.cell_size = cell_size;
+  impl.waypoints.reserve(graph.num_waypoints());
+  for (std::size_t i = 0; i < graph.num_waypoints(); ++i)
+  {
+    const auto& wp = graph.get_waypoint(i);
+    impl.waypoints.push_back(wp.get_location());
+    impl.grids[wp.get_map_name()].waypoints[impl.key(wp.get_location())]
+    .push_back(i);
+  }
+
+  impl.lanes.reserve(graph.num_lanes());
+  for (std::size_t i = 0; i < graph.num_lanes(); ++i)
+  {
+    const auto& lane = graph.get_lane(i);
+    const auto& wp0 = graph.get_waypoint(lane.entry().waypoint_index());
+    const auto& wp1 = graph.get_waypoint(lane.exit().waypoint_index());
+    impl.lanes.push_back({wp0.get_location(), wp1.get_location()});
+    if (wp0.get_map_name() != wp1.get_map_name())
+      continue;
+
+    impl.add_lane(impl.grids[wp0.get_map_name()], i, impl.lanes.back());
+  }
+}
+
+//==============================================================================
+std::vector<std::size_t> GraphSpatialIndex::waypoints_near(
+  const std::string& map_name,
+  const Eigen::Vector2d& location,
+  const double radius) const
+{
+  const auto grid = _pimpl->grids.find(map_name);
+  if (grid == _pimpl->grids.end())
+    return {};
+
+  return _pimpl->query(
+    grid->second.waypoints, location, radius, 0,
+    [&](const std::size_t i)
+    {
+      return (_pimpl->waypoints[i] - location).norm() < radius;
+    });
+}
+
+//==============================================================================
+std::vector<std::size_t> GraphSpatialIndex::lanes_near(
+  const std::string& map_name,
+  const Eigen::Vector2d& location,
+  const double radius) const
+{
+  const auto grid = _pimpl->grids.find(map_name);
+  if (grid == _pimpl->grids.end())
+    return {};
+
+  return _pimpl->query(
+    grid->second.lanes, location, radius, 1,
+    [&](const std::size_t i)
+    {
+      const auto& lane = _pimpl->lanes[i];
+      const Eigen::Vector2d v = lane.p1 - lane.p0;
+      const double length_squared = v.squaredNorm();
+      double s = 0.0;
+      if (length_squared > 0.0)
+      {
+        s = std::clamp(
+          (location - lane.p0).dot(v) / length_squared, 0.0, 1.0);
+      }
+
+      return (lane.p0 + s*v - location).norm() < radius;
+    });
+}
+
+//==============================================================================
+std::size_t GraphSpatialIndex::num_waypoints() const
+{
+  return _pimpl->waypoints.size();
+}
+
+//==============================================================================
+std::size_t GraphSpatialIndex::num_lanes() const
+{
+  return _pimpl->lanes.size();
+}
+
+//==============================================================================
+double GraphSpatialIndex::cell_size() const
+{
+  return _pimpl->cell_size;
+}
+
+} // namespace agv
+} // namespace rmf_traffic
@@ -21,6 +21,10 @@
 
 #include <rmf_utils/math.hpp>
 
+#include <array>
+#include <cassert>
+#include <utility>
+
 namespace rmf_traffic {
 namespace agv {
 
@@ -38,6 +42,8 @@ struct State
   // Time
   Time t;
 
+  State() = default;
+
   State(double s_in, double v_in, double t_in, Time t_start)
   : s(s_in),
     v(v_in),
@@ -49,7 +55,28 @@ struct State
   }
 };
 
-using States = std::vector<State>;
+//==============================================================================
+/// The states of one traversal. A traversal never has more than three states,
+/// so they are kept inline instead of being allocated for every hop.
+class States
+{
+public:
+
+  template<typename... Args>
+  void emplace_back(Args&& ... args)
+  {
+    assert(_size < _states.size());
+    _states[_size++] = State(std::forward<Args>(args)...);
+  }
+
+  const State* begin() const { return _states.data(); }
+  const State* end() const { return _states.data() + _size; }
+  const State& back() const { return _states[_size-1]; }
+
+private:
+  std::array<State, 3> _states;
+  std::size_t _size = 0;
+};
 
 //==============================================================================
 States compute_traversal(
@@ -59,7 +86,6 @@ States compute_traversal(
   const double a_nom)
 {
   States states;
-  states.reserve(3);
 
   // Time spent accelerating
   const double t_a = std::min(std::sqrt(s_f/a_nom), v_nom/a_nom);
@@ -349,22 +375,16 @@ bool can_skip_interpolation(
   return can_skip;
 }
 
-} // namespace internal
-
 //==============================================================================
-Trajectory Interpolate::positions(
+void interpolate_positions(
+  Trajectory& trajectory,
   const VehicleTraits& traits,
   const Time start_time,
   const std::vector<Eigen::Vector3d>& input_positions,
-  const Options& input_options)
+  const Interpolate::Options::Implementation& options)
 {
-  if (!traits.valid())
-    throw invalid_traits_error::Implementation::make_error(traits);
-
-  Trajectory trajectory;
-
   if (input_positions.empty())
-    return trajectory;
+    return;
 
   trajectory.insert(
     start_time,
@@ -376,7 +396,6 @@ Trajectory Interpolate::positions(
   const double a = traits.linear().get_nominal_acceleration();
   const double w = traits.rotational().get_nominal_velocity();
   const double alpha = traits.rotational().get_nominal_acceleration();
-  const auto options = Options::Implementation::get(input_options);
 
   const std::size_t N = input_positions.size();
   std::size_t last_stop_index = 0;
@@ -406,10 +425,60 @@ Trajectory Interpolate::positions(
 
     last_stop_index = i;
   }
+}
+
+} // namespace internal
 
+//==============================================================================
+Trajectory Interpolate::positions(
+  const VehicleTraits& traits,
+  const Time start_time,
+  const std::vector<Eigen::Vector3d>& input_positions,
+  const Options& input_options)
+{
+  Trajectory trajectory;
+  positions(traits, start_time, input_positions, trajectory, input_options);
   return trajectory;
 }
 
+//==============================================================================
+void Interpolate::positions(
+  const VehicleTraits& traits,
+  const Time start_time,
+  const std::vector<Eigen::Vector3d>& input_positions,
+  Trajectory& output,
+  const Options& input_options)
+{
+  if (!traits.valid())
+    throw invalid_traits_error::Implementation::make_error(traits);
+
+  internal::interpolate_positions(
+    output, traits, start_time, input_positions,
+    Options::Implementation::get(input_options));
+}
+
+//==============================================================================
+std::vector<Trajectory> Interpolate::batch_positions(
+  const VehicleTraits& traits,
+  const Time start_time,
+  const std::vector<std::vector<Eigen::Vector3d>>& input_sequences,
+  const Options& input_options)
+{
+  if (!traits.valid())
+    throw invalid_traits_error::Implementation::make_error(traits);
+
+  const auto& options = Options::Implementation::get(input_options);
+
+  std::vector<Trajectory> trajectories(input_sequences.size());
+  for (std::size_t i = 0; i < input_sequences.size(); ++i)
+  {
+    internal::interpolate_positions(
+      trajectories[i], traits, start_time, input_sequences[i], options);
+  }
+
+  return trajectories;
+}
+
 //==============================================================================
 TimeVelocity interpolate_time_along_quadratic_straight_line(
   const Trajectory& trajectory,
@@ -16,6 +16,10 @@
 */
 
 #include <rmf_traffic/agv/LaneClosure.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <unordered_map>
 
 namespace rmf_traffic {
@@ -48,9 +52,8 @@ public:
     if (insertion.second)
     {
       // The bitfield did not exist before, so now it has been inserted with
-      // the desired bit. We will need to recalculate the hash. After that, we
-      // can return.
-      _recalculate_hash();
+      // the desired bit. We just need to update the hash.
+      _hash ^= _lane_hash(value);
       return;
     }
 
@@ -63,7 +66,7 @@ public:
     }
 
     bitfield |= bit;
-    _recalculate_hash();
+    _hash ^= _lane_hash(value);
   }
 
   void erase(std::size_t value)
@@ -87,7 +90,34 @@ public:
     }
 
     bitfield &= ~bit;
-    _recalculate_hash();
+    _hash ^= _lane_hash(value);
+
+    // Empty bitfields are removed so that equal closures have equal maps
+    if (bitfield == 0)
+      _bitfields.erase(bucket_it);
+  }
+
+  std::vector<std::size_t> closed_lanes() const
+  {
+    std::vector<std::size_t> keys;
+    keys.reserve(_bitfields.size());
+    for (const auto& [key, _] : _bitfields)
+      keys.push_back(key);
+
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<std::size_t> lanes;
+    for (const std::size_t key : keys)
+    {
+      const std::size_t bitfield = _bitfields.at(key);
+      for (std::size_t shift = 0; shift < field_size; ++shift)
+      {
+        if (bitfield & (std::size_t(1) << shift))
+          lanes.push_back(key*field_size + shift);
+      }
+    }
+
+    return lanes;
   }
 
   std::size_t hash() const
@@ -107,11 +137,16 @@ private:
 
   static constexpr std::size_t field_size = sizeof(std::size_t)*8;
 
-  void _recalculate_hash()
+  // The hash of a closure is the XOR of the hashes of its closed lanes, so it
+  // can be updated in constant time whenever a lane is opened or closed.
+  static std::size_t _lane_hash(const std::size_t value)
   {
-    _hash = 0;
-    for (const auto& [_, bitfield] : _bitfields)
-      _hash |= bitfield;
+    // This is the finalizer of SplitMix64, which spreads nearby lane indices
+    // across all of the bits.
+    uint64_t z = static_cast<uint64_t>(value) + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<std::size_t>(z ^ (z >> 31));
   }
 
   std::size_t _get_key(const std::size_t value) const
@@ -159,6 +194,12 @@ LaneClosure& LaneClosure::close(std::size_t lane)
   return *this;
 }
 
+//==============================================================================
+std::vector<std::size_t> LaneClosure::closed_lanes() const
+{
+  return _pimpl->closed_lanes();
+}
+
 //==============================================================================
 std::size_t LaneClosure::hash() const
 {
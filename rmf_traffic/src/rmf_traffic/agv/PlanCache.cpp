@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_PlanCache.hpp"
+
+#include <rmf_utils/optional.hpp>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+bool PlanCache::Key::Start::operator==(const Start& other) const
+{
+  return time == other.time
+    && waypoint == other.waypoint
+    && orientation == other.orientation
+    && location == other.location
+    && lane == other.lane;
+}
+
+//==============================================================================
+bool PlanCache::Key::operator==(const Key& other) const
+{
+  return starts == other.starts
+    && goal_waypoint == other.goal_waypoint
+    && goal_orientation == other.goal_orientation
+    && goal_minimum_time == other.goal_minimum_time
+    && validator == other.validator
+    && min_hold_time == other.min_hold_time
+    && maximum_cost_estimate == other.maximum_cost_estimate
+    && saturation_limit == other.saturation_limit
+    && dependency_window == other.dependency_window
+    && dependency_resolution == other.dependency_resolution
+    && suboptimality_budget == other.suboptimality_budget;
+}
+
+//==============================================================================
+auto PlanCache::Key::make(
+  const std::vector<Planner::Start>& starts,
+  const Planner::Goal& goal,
+  const Planner::Options& options) -> std::optional<Key>
+{
+  // An anytime plan depends on how fast the search runs, and conflict options
+  // cannot be compared, so neither can be remembered.
+  if (options.deadline().has_value() || options.conflict_options().has_value())
+    return std::nullopt;
+
+  std::optional<RouteValidator::Identity> validator;
+  if (const auto* v = options.get_validator())
+  {
+    validator = v->identity();
+    if (!validator.has_value())
+      return std::nullopt;
+  }
+
+  Key key{
+    {},
+    goal.waypoint(),
+    rmf_utils::pointer_to_opt(goal.orientation()),
+    goal.minimum_time(),
+    validator,
+    options.minimum_holding_time(),
+    options.maximum_cost_estimate(),
+    options.saturation_limit(),
+    options.dependency_window(),
+    options.dependency_resolution(),
+    options.suboptimality_budget()
+  };
+
+  key.starts.reserve(starts.size());
+  for (const auto& start : starts)
+  {
+    key.starts.push_back(
+      Start{
+        start.time(),
+        start.waypoint(),
+        start.orientation(),
+        start.location(),
+        start.lane()
+      });
+  }
+
+  return key;
+}
+
+//==============================================================================
+void PlanCache::set_capacity(const std::size_t capacity)
+{
+  _capacity = capacity;
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  while (_entries.size() > capacity)
+    _entries.pop_back();
+}
+
+//==============================================================================
+std::size_t PlanCache::get_capacity() const
+{
+  return _capacity;
+}
+
+//==============================================================================
+void PlanCache::set_eviction(const Eviction policy)
+{
+  _eviction = policy;
+}
+
+//==============================================================================
+auto PlanCache::get_eviction() const -> Eviction
+{
+  return _eviction;
+}
+
+//==============================================================================
+void PlanCache::clear()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _entries.clear();
+}
+
+//==============================================================================
+std::optional<Planner::Result> PlanCache::find(const Key& key)
+{
+  if (_capacity.load(std::memory_order_relaxed) == 0)
+    return std::nullopt;
+
+  std::shared_ptr<const Planner::Result> cached;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _entries.begin(); it != _entries.end(); ++it)
+    {
+      if (!(it->key == key))
+        continue;
+
+      cached = it->result;
+      if (_eviction == Eviction::LeastRecentlyUsed)
+        _entries.splice(_entries.begin(), _entries, it);
+
+      break;
+    }
+  }
+
+  if (!cached)
+    return std::nullopt;
+
+  // Copying a result copies its search, so we do it outside of the lock
+  return *cached;
+}
+
+//==============================================================================
+void PlanCache::insert(Key key, const Planner::Result& result)
+{
+  if (_capacity.load(std::memory_order_relaxed) == 0)
+    return;
+
+  auto cached = std::make_shared<const Planner::Result>(result);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (auto it = _entries.begin(); it != _entries.end(); ++it)
+  {
+    if (it->key == key)
+    {
+      _entries.erase(it);
+      break;
+    }
+  }
+
+  _entries.push_front(Entry{std::move(key), std::move(cached)});
+
+  while (_entries.size() > _capacity)
+    _entries.pop_back();
+}
+
+} // namespace agv
+} // namespace rmf_traffic
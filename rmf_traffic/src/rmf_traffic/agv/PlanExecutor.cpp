@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_PlanExecutor.hpp"
+
+#include <algorithm>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+PlanExecutor::Implementation::Implementation(
+  std::shared_ptr<Executor> executor)
+: _executor(std::move(executor))
+{
+  // Do nothing
+}
+
+//==============================================================================
+PlanExecutor::Implementation::~Implementation()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _finished_cv.wait(lock, [&]() { return _unfinished == 0; });
+}
+
+//==============================================================================
+void PlanExecutor::Implementation::post(Job job)
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_unfinished;
+  }
+
+  ++_queued;
+  const Time posted = std::chrono::steady_clock::now();
+  _executor->post(
+    [this, job = std::move(job), posted]()
+    {
+      --_queued;
+      const auto start = std::chrono::steady_clock::now();
+
+      // The jobs are responsible for catching their own exceptions
+      job();
+
+      const auto finish = std::chrono::steady_clock::now();
+      const Duration delay = start - posted;
+
+      // The notification happens while the mutex is locked, because the
+      // destructor may go ahead as soon as the mutex is released.
+      std::lock_guard<std::mutex> lock(_mutex);
+      ++_statistics.jobs;
+      _statistics.total_queue_delay += delay;
+      _statistics.max_queue_delay =
+        std::max(_statistics.max_queue_delay, delay);
+      _statistics.total_compute_time += finish - start;
+      --_unfinished;
+      _finished_cv.notify_all();
+    });
+}
+
+//==============================================================================
+std::size_t PlanExecutor::Implementation::queued() const
+{
+  return _queued.load();
+}
+
+//==============================================================================
+auto PlanExecutor::Implementation::statistics() const -> Statistics
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _statistics;
+}
+
+//==============================================================================
+auto PlanExecutor::Implementation::get(PlanExecutor& executor)
+-> Implementation&
+{
+  return *executor._pimpl;
+}
+
+//==============================================================================
+std::shared_ptr<PlanExecutor> PlanExecutor::make(const std::size_t threads)
+{
+  Executor::Config config;
+  config.threads = std::max<std::size_t>(threads, 1);
+  return make(Executor::make(std::move(config)));
+}
+
+//==============================================================================
+std::shared_ptr<PlanExecutor> PlanExecutor::make(
+  std::shared_ptr<Executor> executor)
+{
+  if (!executor)
+    executor = Executor::shared();
+
+  std::shared_ptr<PlanExecutor> output(new PlanExecutor);
+  output->_pimpl =
+    rmf_utils::make_unique_impl<Implementation>(std::move(executor));
+  return output;
+}
+
+//==============================================================================
+const std::shared_ptr<PlanExecutor>& PlanExecutor::shared()
+{
+  static const std::shared_ptr<PlanExecutor> executor =
+    make(Executor::shared());
+
+  return executor;
+}
+
+//==============================================================================
+const std::shared_ptr<Executor>& PlanExecutor::executor() const
+{
+  return _pimpl->_executor;
+}
+
+//==============================================================================
+std::size_t PlanExecutor::threads() const
+{
+  return _pimpl->_executor->concurrency();
+}
+
+//==============================================================================
+std::size_t PlanExecutor::queued() const
+{
+  return _pimpl->queued();
+}
+
+//==============================================================================
+auto PlanExecutor::statistics() const -> Statistics
+{
+  return _pimpl->statistics();
+}
+
+//==============================================================================
+PlanExecutor::PlanExecutor()
+{
+  // Do nothing
+}
+
+} // namespace agv
+} // namespace rmf_traffic
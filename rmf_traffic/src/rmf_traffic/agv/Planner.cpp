@@ -18,9 +18,16 @@
 #include <rmf_traffic/agv/Planner.hpp>
 #include <rmf_traffic/agv/debug/debug_Planner.hpp>
 
+#include "internal_Graph.hpp"
+#include "internal_PlanCache.hpp"
+#include "internal_PlanExecutor.hpp"
 #include "internal_Planner.hpp"
 #include "internal_planning.hpp"
 
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+
 namespace rmf_traffic {
 namespace agv {
 
@@ -29,16 +36,109 @@ namespace agv {
 // inside of this translation unit.
 const Duration Planner::Options::DefaultMinHoldingTime;
 
+//==============================================================================
+/// The graph of a configuration. Copies of a configuration share one graph,
+/// which is only copied if one of them asks for mutable access while it is
+/// being shared. The supergraphs of planners also share it, so planners for a
+/// large graph do not need to keep their own copies.
+///
+/// Once a mutable reference to the graph has been handed out, it can be used
+/// to change the graph at any later time. From then on, every copy of the
+/// configuration gets its own copy of the graph, so a planner never shares a
+/// graph that can still be changed.
+class SharedGraph
+{
+public:
+
+  SharedGraph(std::shared_ptr<Graph> graph)
+  : _graph(std::move(graph))
+  {
+    // Do nothing
+  }
+
+  SharedGraph(const SharedGraph& other)
+  : _graph(other.frozen())
+  {
+    // Do nothing
+  }
+
+  SharedGraph(SharedGraph&&) = default;
+
+  SharedGraph& operator=(const SharedGraph& other)
+  {
+    _graph = other.frozen();
+    _exposed = false;
+    return *this;
+  }
+
+  SharedGraph& operator=(SharedGraph&&) = default;
+
+  /// Get mutable access to the graph, copying it first if it is shared
+  Graph& mutable_graph()
+  {
+    if (_graph.use_count() > 1)
+      _graph = std::make_shared<Graph>(*_graph);
+
+    _exposed = true;
+    return *_graph;
+  }
+
+  const std::shared_ptr<Graph>& get() const
+  {
+    return _graph;
+  }
+
+  /// Stop sharing the graph with anything that has been given a mutable
+  /// reference to it
+  void freeze()
+  {
+    if (_exposed)
+    {
+      _graph = std::make_shared<Graph>(*_graph);
+      _exposed = false;
+    }
+  }
+
+private:
+
+  std::shared_ptr<Graph> frozen() const
+  {
+    return _exposed ? std::make_shared<Graph>(*_graph) : _graph;
+  }
+
+  std::shared_ptr<Graph> _graph;
+  bool _exposed = false;
+};
+
 //==============================================================================
 class Planner::Configuration::Implementation
 {
 public:
 
-  Graph graph;
+  SharedGraph graph;
   VehicleTraits traits;
   Interpolate::Options interpolation;
   LaneClosure lane_closures;
   double traversal_cost_per_meter = 5.0;
+  std::optional<std::string> heuristic_cache_file = std::nullopt;
+  std::optional<std::size_t> heuristic_cache_budget = std::nullopt;
+  HeuristicEviction heuristic_cache_eviction =
+    HeuristicEviction::LeastRecentlyUsed;
+  std::optional<std::size_t> eager_traversals = std::nullopt;
+  bool floor_hierarchy = false;
+  bool contract_corridors = false;
+  bool contraction_hierarchy = false;
+
+  static const std::shared_ptr<Graph>& shared_graph(
+    const Configuration& config)
+  {
+    return config._pimpl->graph.get();
+  }
+
+  static void freeze_graph(Configuration& config)
+  {
+    config._pimpl->graph.freeze();
+  }
 
 };
 
@@ -49,7 +149,7 @@ Planner::Configuration::Configuration(
   Interpolate::Options interpolation)
 : _pimpl(rmf_utils::make_impl<Implementation>(
       Implementation{
-        std::move(graph),
+        std::make_shared<Graph>(std::move(graph)),
         std::move(traits),
         std::move(interpolation),
         LaneClosure()
@@ -61,20 +161,20 @@ Planner::Configuration::Configuration(
 //==============================================================================
 auto Planner::Configuration::graph(Graph graph) -> Configuration&
 {
-  _pimpl->graph = std::move(graph);
+  _pimpl->graph = std::make_shared<Graph>(std::move(graph));
   return *this;
 }
 
 //==============================================================================
 Graph& Planner::Configuration::graph()
 {
-  return _pimpl->graph;
+  return _pimpl->graph.mutable_graph();
 }
 
 //==============================================================================
 const Graph& Planner::Configuration::graph() const
 {
-  return _pimpl->graph;
+  return *_pimpl->graph.get();
 }
 
 //==============================================================================
@@ -151,6 +251,120 @@ double Planner::Configuration::traversal_cost_per_meter() const
   return _pimpl->traversal_cost_per_meter;
 }
 
+//==============================================================================
+auto Planner::Configuration::heuristic_cache_file(
+  std::optional<std::string> file_path) -> Configuration&
+{
+  _pimpl->heuristic_cache_file = std::move(file_path);
+  return *this;
+}
+
+//==============================================================================
+const std::optional<std::string>&
+Planner::Configuration::heuristic_cache_file() const
+{
+  return _pimpl->heuristic_cache_file;
+}
+
+//==============================================================================
+auto Planner::Configuration::heuristic_cache_budget(
+  std::optional<std::size_t> bytes) -> Configuration&
+{
+  _pimpl->heuristic_cache_budget = bytes;
+  return *this;
+}
+
+//==============================================================================
+std::optional<std::size_t>
+Planner::Configuration::heuristic_cache_budget() const
+{
+  return _pimpl->heuristic_cache_budget;
+}
+
+//==============================================================================
+auto Planner::Configuration::heuristic_cache_eviction(
+  const HeuristicEviction policy) -> Configuration&
+{
+  _pimpl->heuristic_cache_eviction = policy;
+  return *this;
+}
+
+//==============================================================================
+auto Planner::Configuration::heuristic_cache_eviction() const
+-> HeuristicEviction
+{
+  return _pimpl->heuristic_cache_eviction;
+}
+
+//==============================================================================
+auto Planner::Configuration::eager_traversals(
+  std::optional<std::size_t> threads) -> Configuration&
+{
+  _pimpl->eager_traversals = threads;
+  return *this;
+}
+
+//==============================================================================
+std::optional<std::size_t> Planner::Configuration::eager_traversals() const
+{
+  return _pimpl->eager_traversals;
+}
+
+//==============================================================================
+auto Planner::Configuration::floor_hierarchy(const bool enable)
+-> Configuration&
+{
+  _pimpl->floor_hierarchy = enable;
+  return *this;
+}
+
+//==============================================================================
+bool Planner::Configuration::floor_hierarchy() const
+{
+  return _pimpl->floor_hierarchy;
+}
+
+//==============================================================================
+auto Planner::Configuration::contract_corridors(const bool enable)
+-> Configuration&
+{
+  _pimpl->contract_corridors = enable;
+  return *this;
+}
+
+//==============================================================================
+bool Planner::Configuration::contract_corridors() const
+{
+  return _pimpl->contract_corridors;
+}
+
+//==============================================================================
+auto Planner::Configuration::contraction_hierarchy(const bool enable)
+-> Configuration&
+{
+  _pimpl->contraction_hierarchy = enable;
+  return *this;
+}
+
+//==============================================================================
+bool Planner::Configuration::contraction_hierarchy() const
+{
+  return _pimpl->contraction_hierarchy;
+}
+
+//==============================================================================
+std::shared_ptr<const Graph::Implementation> planning::shared_graph(
+  const Planner::Configuration& config)
+{
+  const auto& graph = Planner::Configuration::Implementation::shared_graph(
+    config);
+
+  // Alias the implementation of the graph so that it keeps the whole shared
+  // graph alive.
+  return std::shared_ptr<const Graph::Implementation>(
+    graph, &Graph::Implementation::get(*graph));
+}
+
 //==============================================================================
 class Planner::Options::Implementation
 {
@@ -167,6 +381,33 @@ public:
   std::optional<Duration> dependency_window = std::chrono::seconds(30);
   Duration dependency_resolution = std::chrono::milliseconds(1000);
 
+  std::optional<DetectConflict::Options> conflict_options = std::nullopt;
+
+  std::size_t search_threads = 1;
+
+  std::size_t expansion_threads = 1;
+
+  bool validation_interrupts = false;
+
+  std::shared_ptr<rmf_traffic::Executor> executor = nullptr;
+
+  bool hash_distributed_search = false;
+
+  double suboptimality_budget = 0.0;
+
+  std::optional<Time> deadline = std::nullopt;
+
+  bool reuse_previous_plan = true;
+
+  std::pmr::memory_resource* memory_resource = nullptr;
+
+  bool safe_interval_holding = false;
+
+  std::shared_ptr<const CongestionField> congestion_field = nullptr;
+
+  bool ideal_plan_first = false;
+
+  std::shared_ptr<const RouteValidator> shared_validator = nullptr;
 };
 
 //==============================================================================
@@ -211,6 +452,24 @@ auto Planner::Options::validator(rmf_utils::clone_ptr<RouteValidator> v)
 -> Options&
 {
   _pimpl->validator = std::move(v);
+  _pimpl->shared_validator = nullptr;
+  return *this;
+}
+
+//==============================================================================
+auto Planner::Options::validator(std::shared_ptr<const RouteValidator> v)
+-> Options&
+{
+  _pimpl->shared_validator = std::move(v);
+  _pimpl->validator = nullptr;
+  return *this;
+}
+
+//==============================================================================
+auto Planner::Options::validator(std::nullptr_t) -> Options&
+{
+  _pimpl->validator = nullptr;
+  _pimpl->shared_validator = nullptr;
   return *this;
 }
 
@@ -220,6 +479,22 @@ const rmf_utils::clone_ptr<RouteValidator>& Planner::Options::validator() const
   return _pimpl->validator;
 }
 
+//==============================================================================
+const std::shared_ptr<const RouteValidator>&
+Planner::Options::shared_validator() const
+{
+  return _pimpl->shared_validator;
+}
+
+//==============================================================================
+const RouteValidator* Planner::Options::get_validator() const
+{
+  if (_pimpl->shared_validator)
+    return _pimpl->shared_validator.get();
+
+  return _pimpl->validator.get();
+}
+
 //==============================================================================
 auto Planner::Options::minimum_holding_time(const Duration holding_time)
 -> Options&
@@ -330,185 +605,361 @@ Duration Planner::Options::dependency_resolution() const
 }
 
 //==============================================================================
-class Planner::Start::Implementation
+auto Planner::Options::conflict_options(
+  std::optional<DetectConflict::Options> value) -> Options&
 {
-public:
-
-  Time time;
-  std::size_t waypoint;
-  double orientation;
-  std::optional<Eigen::Vector2d> location;
-  std::optional<std::size_t> lane;
-
-};
+  _pimpl->conflict_options = std::move(value);
+  return *this;
+}
 
 //==============================================================================
-Planner::Start::Start(
-  const Time initial_time,
-  const std::size_t initial_waypoint,
-  const double initial_orientation,
-  std::optional<Eigen::Vector2d> initial_location,
-  std::optional<std::size_t> initial_lane)
-: _pimpl(rmf_utils::make_impl<Implementation>(
-      Implementation{
-        initial_time,
-        initial_waypoint,
-        initial_orientation,
-        std::move(initial_location),
-        std::move(initial_lane)
-      }))
+const std::optional<DetectConflict::Options>&
+Planner::Options::conflict_options() const
 {
-  // Do nothing
+  return _pimpl->conflict_options;
 }
 
 //==============================================================================
-auto Planner::Start::time(const Time initial_time) -> Start&
+auto Planner::Options::search_threads(const std::size_t value) -> Options&
 {
-  _pimpl->time = initial_time;
+  _pimpl->search_threads = std::max<std::size_t>(value, 1);
   return *this;
 }
 
 //==============================================================================
-Time Planner::Start::time() const
+std::size_t Planner::Options::search_threads() const
 {
-  return _pimpl->time;
+  return _pimpl->search_threads;
 }
 
 //==============================================================================
-auto Planner::Start::waypoint(const std::size_t initial_waypoint) -> Start&
+auto Planner::Options::hash_distributed_search(const bool enable) -> Options&
 {
-  _pimpl->waypoint = initial_waypoint;
+  _pimpl->hash_distributed_search = enable;
   return *this;
 }
 
 //==============================================================================
-std::size_t Planner::Start::waypoint() const
+bool Planner::Options::hash_distributed_search() const
 {
-  return _pimpl->waypoint;
+  return _pimpl->hash_distributed_search;
 }
 
 //==============================================================================
-auto Planner::Start::orientation(const double initial_orientation) -> Start&
+auto Planner::Options::expansion_threads(const std::size_t value) -> Options&
 {
-  _pimpl->orientation = initial_orientation;
+  _pimpl->expansion_threads = std::max<std::size_t>(value, 1);
   return *this;
 }
 
 //==============================================================================
-double Planner::Start::orientation() const
+std::size_t Planner::Options::expansion_threads() const
 {
-  return _pimpl->orientation;
+  return _pimpl->expansion_threads;
 }
 
 //==============================================================================
-const std::optional<Eigen::Vector2d>& Planner::Start::location() const
+auto Planner::Options::validation_interrupts(const bool enable) -> Options&
 {
-  return _pimpl->location;
+  _pimpl->validation_interrupts = enable;
+  return *this;
 }
 
 //==============================================================================
-auto Planner::Start::location(
-  std::optional<Eigen::Vector2d> initial_location) -> Start&
+bool Planner::Options::validation_interrupts() const
 {
-  _pimpl->location = std::move(initial_location);
+  return _pimpl->validation_interrupts;
+}
+
+//==============================================================================
+auto Planner::Options::executor(std::shared_ptr<rmf_traffic::Executor> value)
+-> Options&
+{
+  _pimpl->executor = std::move(value);
   return *this;
 }
 
 //==============================================================================
-const std::optional<std::size_t>& Planner::Start::lane() const
+const std::shared_ptr<rmf_traffic::Executor>&
+Planner::Options::executor() const
 {
-  return _pimpl->lane;
+  return _pimpl->executor;
 }
 
 //==============================================================================
-auto Planner::Start::lane(
-  std::optional<std::size_t> initial_lane) -> Start&
+auto Planner::Options::suboptimality_budget(const double value) -> Options&
 {
-  _pimpl->lane = initial_lane;
+  _pimpl->suboptimality_budget = std::max(value, 0.0);
   return *this;
 }
 
 //==============================================================================
-class Planner::Goal::Implementation
+double Planner::Options::suboptimality_budget() const
 {
-public:
-
-  std::size_t waypoint;
-  std::optional<double> orientation;
-  std::optional<rmf_traffic::Time> minimum_time;
+  return _pimpl->suboptimality_budget;
+}
 
-};
+//==============================================================================
+auto Planner::Options::deadline(std::optional<Time> value) -> Options&
+{
+  _pimpl->deadline = value;
+  return *this;
+}
 
 //==============================================================================
-Planner::Goal::Goal(const std::size_t waypoint)
-: _pimpl(rmf_utils::make_impl<Implementation>(
-      Implementation{
-        waypoint,
-        std::nullopt,
-        std::nullopt
-      }))
+std::optional<Time> Planner::Options::deadline() const
 {
-  // Do nothing
+  return _pimpl->deadline;
 }
 
 //==============================================================================
-Planner::Goal::Goal(
-  const std::size_t waypoint,
-  const double goal_orientation)
-: _pimpl(rmf_utils::make_impl<Implementation>(
-      Implementation{
-        waypoint,
-        goal_orientation,
-        std::nullopt
-      }))
+auto Planner::Options::reuse_previous_plan(const bool choice) -> Options&
 {
-  // Do nothing
+  _pimpl->reuse_previous_plan = choice;
+  return *this;
 }
 
 //==============================================================================
-Planner::Goal::Goal(
-  const std::size_t goal_waypoint,
-  const std::optional<rmf_traffic::Time> minimum_time,
-  const std::optional<double> goal_orientation)
-: _pimpl(rmf_utils::make_impl<Implementation>(
-      Implementation{
-        goal_waypoint,
-        goal_orientation,
-        minimum_time
-      }))
+bool Planner::Options::reuse_previous_plan() const
 {
-  // Do nothing
+  return _pimpl->reuse_previous_plan;
 }
 
 //==============================================================================
-auto Planner::Goal::waypoint(const std::size_t goal_waypoint) -> Goal&
+auto Planner::Options::memory_resource(std::pmr::memory_resource* resource)
+-> Options&
 {
-  _pimpl->waypoint = goal_waypoint;
+  _pimpl->memory_resource = resource;
   return *this;
 }
 
 //==============================================================================
-std::size_t Planner::Goal::waypoint() const
+std::pmr::memory_resource* Planner::Options::memory_resource() const
 {
-  return _pimpl->waypoint;
+  return _pimpl->memory_resource;
 }
 
 //==============================================================================
-auto Planner::Goal::orientation(const double goal_orientation) -> Goal&
+auto Planner::Options::safe_interval_holding(const bool choice) -> Options&
 {
-  _pimpl->orientation = goal_orientation;
+  _pimpl->safe_interval_holding = choice;
   return *this;
 }
 
 //==============================================================================
-auto Planner::Goal::any_orientation() -> Goal&
+bool Planner::Options::safe_interval_holding() const
 {
-  _pimpl->orientation = rmf_utils::nullopt;
+  return _pimpl->safe_interval_holding;
+}
+
+//==============================================================================
+auto Planner::Options::congestion_field(
+  std::shared_ptr<const CongestionField> field) -> Options&
+{
+  _pimpl->congestion_field = std::move(field);
   return *this;
 }
 
 //==============================================================================
-const double* Planner::Goal::orientation() const
+const std::shared_ptr<const CongestionField>&
+Planner::Options::congestion_field() const
+{
+  return _pimpl->congestion_field;
+}
+
+//==============================================================================
+auto Planner::Options::ideal_plan_first(const bool choice) -> Options&
+{
+  _pimpl->ideal_plan_first = choice;
+  return *this;
+}
+
+//==============================================================================
+bool Planner::Options::ideal_plan_first() const
+{
+  return _pimpl->ideal_plan_first;
+}
+
+//==============================================================================
+class Planner::Start::Implementation
+{
+public:
+
+  Time time;
+  std::size_t waypoint;
+  double orientation;
+  std::optional<Eigen::Vector2d> location;
+  std::optional<std::size_t> lane;
+
+};
+
+//==============================================================================
+Planner::Start::Start(
+  const Time initial_time,
+  const std::size_t initial_waypoint,
+  const double initial_orientation,
+  std::optional<Eigen::Vector2d> initial_location,
+  std::optional<std::size_t> initial_lane)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{
+        initial_time,
+        initial_waypoint,
+        initial_orientation,
+        std::move(initial_location),
+        std::move(initial_lane)
+      }))
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto Planner::Start::time(const Time initial_time) -> Start&
+{
+  _pimpl->time = initial_time;
+  return *this;
+}
+
+//==============================================================================
+Time Planner::Start::time() const
+{
+  return _pimpl->time;
+}
+
+//==============================================================================
+auto Planner::Start::waypoint(const std::size_t initial_waypoint) -> Start&
+{
+  _pimpl->waypoint = initial_waypoint;
+  return *this;
+}
+
+//==============================================================================
+std::size_t Planner::Start::waypoint() const
+{
+  return _pimpl->waypoint;
+}
+
+//==============================================================================
+auto Planner::Start::orientation(const double initial_orientation) -> Start&
+{
+  _pimpl->orientation = initial_orientation;
+  return *this;
+}
+
+//==============================================================================
+double Planner::Start::orientation() const
+{
+  return _pimpl->orientation;
+}
+
+//==============================================================================
+const std::optional<Eigen::Vector2d>& Planner::Start::location() const
+{
+  return _pimpl->location;
+}
+
+//==============================================================================
+auto Planner::Start::location(
+  std::optional<Eigen::Vector2d> initial_location) -> Start&
+{
+  _pimpl->location = std::move(initial_location);
+  return *this;
+}
+
+//==============================================================================
+const std::optional<std::size_t>& Planner::Start::lane() const
+{
+  return _pimpl->lane;
+}
+
+//==============================================================================
+auto Planner::Start::lane(
+  std::optional<std::size_t> initial_lane) -> Start&
+{
+  _pimpl->lane = initial_lane;
+  return *this;
+}
+
+//==============================================================================
+class Planner::Goal::Implementation
+{
+public:
+
+  std::size_t waypoint;
+  std::optional<double> orientation;
+  std::optional<rmf_traffic::Time> minimum_time;
+
+};
+
+//==============================================================================
+Planner::Goal::Goal(const std::size_t waypoint)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{
+        waypoint,
+        std::nullopt,
+        std::nullopt
+      }))
+{
+  // Do nothing
+}
+
+//==============================================================================
+Planner::Goal::Goal(
+  const std::size_t waypoint,
+  const double goal_orientation)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{
+        waypoint,
+        goal_orientation,
+        std::nullopt
+      }))
+{
+  // Do nothing
+}
+
+//==============================================================================
+Planner::Goal::Goal(
+  const std::size_t goal_waypoint,
+  const std::optional<rmf_traffic::Time> minimum_time,
+  const std::optional<double> goal_orientation)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{
+        goal_waypoint,
+        goal_orientation,
+        minimum_time
+      }))
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto Planner::Goal::waypoint(const std::size_t goal_waypoint) -> Goal&
+{
+  _pimpl->waypoint = goal_waypoint;
+  return *this;
+}
+
+//==============================================================================
+std::size_t Planner::Goal::waypoint() const
+{
+  return _pimpl->waypoint;
+}
+
+//==============================================================================
+auto Planner::Goal::orientation(const double goal_orientation) -> Goal&
+{
+  _pimpl->orientation = goal_orientation;
+  return *this;
+}
+
+//==============================================================================
+auto Planner::Goal::any_orientation() -> Goal&
+{
+  _pimpl->orientation = rmf_utils::nullopt;
+  return *this;
+}
+
+//==============================================================================
+const double* Planner::Goal::orientation() const
 {
   if (_pimpl->orientation)
     return &(*_pimpl->orientation);
@@ -517,196 +968,843 @@ const double* Planner::Goal::orientation() const
 }
 
 //==============================================================================
-auto Planner::Goal::minimum_time(std::optional<rmf_traffic::Time> value)
--> Goal&
+auto Planner::Goal::minimum_time(std::optional<rmf_traffic::Time> value)
+-> Goal&
+{
+  _pimpl->minimum_time = value;
+  return *this;
+}
+
+//==============================================================================
+std::optional<rmf_traffic::Time> Planner::Goal::minimum_time() const
+{
+  return _pimpl->minimum_time;
+}
+
+//==============================================================================
+class Planner::GoalSet::Implementation
+{
+public:
+
+  struct Candidate
+  {
+    Goal goal;
+    double cost_offset;
+  };
+
+  std::vector<Candidate> candidates;
+
+};
+
+//==============================================================================
+Planner::GoalSet::GoalSet()
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto Planner::GoalSet::add(Goal goal, const double cost_offset) -> GoalSet&
+{
+  _pimpl->candidates.push_back({std::move(goal), cost_offset});
+  return *this;
+}
+
+//==============================================================================
+std::size_t Planner::GoalSet::size() const
+{
+  return _pimpl->candidates.size();
+}
+
+//==============================================================================
+auto Planner::GoalSet::goal(const std::size_t index) const -> const Goal&
+{
+  return _pimpl->candidates.at(index).goal;
+}
+
+//==============================================================================
+double Planner::GoalSet::cost_offset(const std::size_t index) const
+{
+  return _pimpl->candidates.at(index).cost_offset;
+}
+
+//==============================================================================
+class Planner::Implementation
+{
+public:
+
+  planning::InterfacePtr interface;
+
+  Options default_options;
+
+  Configuration configuration;
+
+  mutable PlanCache cache = PlanCache();
+
+  /// Plan with the cache if it is turned on
+  Result generate(
+    const std::vector<Start>& starts,
+    Goal goal,
+    Options options) const;
+
+  /// Set up a plan with the cache if it is turned on
+  Result setup(
+    const std::vector<Start>& starts,
+    Goal goal,
+    Options options) const;
+
+  /// Plan to whichever goal of the set has the lowest total cost
+  Result generate(
+    const std::vector<Start>& starts,
+    const GoalSet& goals,
+    const Options& options) const;
+
+};
+
+//==============================================================================
+class Plan::Implementation
+{
+public:
+
+  planning::PlanData plan;
+
+  static std::optional<Plan> make(std::optional<planning::PlanData> result)
+  {
+    if (!result)
+      return std::nullopt;
+
+    Plan plan;
+    plan._pimpl = rmf_utils::make_impl<Implementation>(
+      Implementation{*std::move(result)});
+
+    return plan;
+  }
+
+};
+
+//==============================================================================
+Planner::Planner(
+  Configuration config,
+  Options default_options)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{
+        nullptr,
+        std::move(default_options),
+        std::move(config)
+      }))
+{
+  // The planner and its interface share one graph that nothing else can change
+  Configuration::Implementation::freeze_graph(_pimpl->configuration);
+  _pimpl->interface =
+    planning::make_planner_interface(_pimpl->configuration);
+
+  if (const auto& file_path = _pimpl->configuration.heuristic_cache_file())
+    load_heuristic_cache(*file_path);
+}
+
+//==============================================================================
+Planner::Result Planner::Result::Implementation::generate(
+  planning::InterfacePtr interface,
+  const std::vector<Planner::Start>& starts,
+  Planner::Goal goal,
+  Planner::Options options,
+  const planning::State* previous)
+{
+  // TODO(MXG): Throw an exception if any of the starts or the goal has an
+  // invalid waypoint index.
+  const bool reuse = previous && options.reuse_previous_plan();
+  auto state = reuse ?
+    interface->reinitiate(
+    *previous, starts, std::move(goal), std::move(options)) :
+    interface->initiate(starts, std::move(goal), std::move(options));
+
+  Planner::Result result;
+  result._pimpl = rmf_utils::make_impl<Implementation>(
+    Implementation{
+      std::move(interface),
+      std::move(state),
+      std::nullopt
+    });
+
+  result._pimpl->search();
+  return result;
+}
+
+//==============================================================================
+namespace {
+// The suboptimality budget of the quick search of an anytime plan
+const double AnytimeQuickBudget = 4.0;
+} // anonymous namespace
+
+//==============================================================================
+void Planner::Result::Implementation::search()
+{
+  auto& options = state.conditions.options;
+  const auto deadline = options.deadline();
+  if (!deadline.has_value())
+  {
+    plan = Plan::Implementation::make(interface->plan(state));
+    incumbent = false;
+    return;
+  }
+
+  const Options user_options = options;
+  const auto interrupter =
+    [deadline = *deadline, user = user_options.interrupter()]() -> bool
+    {
+      if (deadline < std::chrono::steady_clock::now())
+        return true;
+
+      return user && user();
+    };
+
+  if (!plan.has_value())
+  {
+    // Find any plan that we can, as fast as we can. This search is not bound
+    // by the deadline, otherwise a tight deadline would leave us with nothing.
+    auto quick_options = user_options;
+    quick_options
+    .suboptimality_budget(
+      std::max(AnytimeQuickBudget, user_options.suboptimality_budget()))
+    .search_threads(1);
+
+    auto quick_state = interface->initiate(
+      state.conditions.starts, state.conditions.goal, std::move(quick_options));
+
+    plan = Plan::Implementation::make(interface->plan(quick_state));
+    incumbent = plan.has_value();
+    earlier_statistics += quick_state.internal->statistics();
+  }
+
+  // Now look for the best plan. Nothing that costs more than the incumbent is
+  // worth expanding.
+  options.interrupter(interrupter);
+  if (plan.has_value())
+  {
+    const double cost = plan->get_cost();
+    options.maximum_cost_estimate(
+      std::min(cost, user_options.maximum_cost_estimate().value_or(cost)));
+  }
+
+  auto better = Plan::Implementation::make(interface->plan(state));
+  options = user_options;
+
+  if (better.has_value())
+  {
+    plan = std::move(better);
+    incumbent = false;
+    return;
+  }
+
+  if (plan.has_value() && !state.issues.interrupted)
+  {
+    // The search ran out of anything that could beat the incumbent
+    incumbent = lower_bound() < plan->get_cost() - 1e-3;
+  }
+}
+
+//==============================================================================
+double Planner::Result::Implementation::lower_bound() const
+{
+  // Nothing in the queue can reach the goal more cheaply than its own cost
+  // estimate, so the lowest estimate in the queue is a lower bound on the cost
+  // of the best plan.
+  const double cost = plan.has_value() ?
+    plan->get_cost() : std::numeric_limits<double>::infinity();
+
+  double bound = state.internal->cost_estimate().value_or(cost);
+  bound = std::min(bound, cost);
+  return std::max(bound, state.ideal_cost.value_or(0.0));
+}
+
+//==============================================================================
+Planner::Result Planner::Result::Implementation::setup(
+  planning::InterfacePtr interface,
+  const std::vector<Planner::Start>& starts,
+  Planner::Goal goal,
+  Planner::Options options,
+  const planning::State* previous)
+{
+  const bool reuse = previous && options.reuse_previous_plan();
+  auto state = reuse ?
+    interface->reinitiate(
+    *previous, starts, std::move(goal), std::move(options)) :
+    interface->initiate(starts, std::move(goal), std::move(options));
+
+  Planner::Result result;
+  result._pimpl = rmf_utils::make_impl<Implementation>(
+    Implementation{
+      std::move(interface),
+      std::move(state),
+      rmf_utils::nullopt
+    });
+
+  return result;
+}
+
+//==============================================================================
+auto Planner::Result::Implementation::get(const Result& r)
+-> const Implementation&
+{
+  return *r._pimpl;
+}
+
+//==============================================================================
+auto Planner::get_configuration() const -> const Configuration&
+{
+  return _pimpl->configuration;
+}
+
+//==============================================================================
+Planner& Planner::set_default_options(Options default_options)
+{
+  _pimpl->default_options = std::move(default_options);
+  return *this;
+}
+
+//==============================================================================
+auto Planner::get_default_options() -> Options&
+{
+  return _pimpl->default_options;
+}
+
+//==============================================================================
+auto Planner::get_default_options() const -> const Options&
+{
+  return _pimpl->default_options;
+}
+
+//==============================================================================
+Planner& Planner::set_result_cache_capacity(const std::size_t capacity)
+{
+  _pimpl->cache.set_capacity(capacity);
+  return *this;
+}
+
+//==============================================================================
+std::size_t Planner::get_result_cache_capacity() const
+{
+  return _pimpl->cache.get_capacity();
+}
+
+//==============================================================================
+Planner& Planner::set_result_cache_eviction(const CacheEviction policy)
+{
+  _pimpl->cache.set_eviction(policy);
+  return *this;
+}
+
+//==============================================================================
+auto Planner::get_result_cache_eviction() const -> CacheEviction
+{
+  return _pimpl->cache.get_eviction();
+}
+
+//==============================================================================
+bool Planner::save_heuristic_cache(const std::string& file_path) const
+{
+  std::ofstream output(file_path, std::ios::binary | std::ios::trunc);
+  if (!output)
+    return false;
+
+  _pimpl->interface->save_heuristic(output);
+  output.flush();
+  return static_cast<bool>(output);
+}
+
+//==============================================================================
+bool Planner::load_heuristic_cache(const std::string& file_path)
+{
+  std::ifstream input(file_path, std::ios::binary);
+  if (!input)
+    return false;
+
+  return _pimpl->interface->load_heuristic(input);
+}
+
+//==============================================================================
+bool Planner::sync_heuristic_cache(const std::string& file_path)
+{
+  // Opening the output first creates the journal if it does not exist yet.
+  // Append mode makes each record land at the end of the file, even when other
+  // processes have appended to it since it was read.
+  std::ofstream output(file_path, std::ios::binary | std::ios::app);
+  if (!output)
+    return false;
+
+  std::ifstream journal(file_path, std::ios::binary);
+  if (!journal)
+    return false;
+
+  _pimpl->interface->sync_heuristic(journal, output);
+  output.flush();
+  return static_cast<bool>(output);
+}
+
+//==============================================================================
+auto Planner::get_heuristic_cache_statistics() const
+-> HeuristicCacheStatistics
+{
+  return _pimpl->interface->heuristic_statistics();
+}
+
+//==============================================================================
+std::size_t Planner::MemoryUsage::total() const
+{
+  return heuristics.bytes + traversals.bytes + entries.bytes;
+}
+
+//==============================================================================
+auto Planner::memory_usage() const -> MemoryUsage
+{
+  return _pimpl->interface->memory_usage();
+}
+
+//==============================================================================
+void Planner::warm_cache(
+  std::vector<std::size_t> goals,
+  const std::size_t threads) const
+{
+  if (goals.empty())
+  {
+    goals.resize(_pimpl->configuration.graph().num_waypoints());
+    std::iota(goals.begin(), goals.end(), 0);
+  }
+
+  _pimpl->interface->warm_heuristic(goals, threads);
+}
+
+//==============================================================================
+Planner Planner::with_lane_closures(LaneClosure closures) const
+{
+  Planner planner = *this;
+  planner.set_lane_closures(std::move(closures));
+  return planner;
+}
+
+//==============================================================================
+Planner& Planner::set_lane_closures(LaneClosure closures)
+{
+  if (closures == _pimpl->configuration.lane_closures())
+    return *this;
+
+  _pimpl->interface = _pimpl->interface->with_closures(closures);
+  _pimpl->configuration.lane_closures(std::move(closures));
+  _pimpl->cache.clear();
+  return *this;
+}
+
+//==============================================================================
+Planner::Result Planner::Implementation::generate(
+  const std::vector<Start>& starts,
+  Goal goal,
+  Options options) const
+{
+  std::optional<PlanCache::Key> key;
+  if (cache.get_capacity() > 0)
+  {
+    key = PlanCache::Key::make(starts, goal, options);
+    if (key.has_value())
+    {
+      if (auto cached = cache.find(*key))
+        return std::move(*cached);
+    }
+  }
+
+  auto result = Result::Implementation::generate(
+    interface, starts, std::move(goal), std::move(options));
+
+  if (key.has_value() && result.success() && !result.incumbent())
+    cache.insert(std::move(*key), result);
+
+  return result;
+}
+
+//==============================================================================
+Planner::Result Planner::Implementation::generate(
+  const std::vector<Start>& starts,
+  const GoalSet& goals,
+  const Options& options) const
+{
+  if (goals.size() == 0)
+  {
+    throw std::invalid_argument(
+      "[rmf_traffic::agv::Planner::plan] The GoalSet is empty");
+  }
+
+  struct Candidate
+  {
+    double lower_bound;
+    double cost_offset;
+    Result result;
+  };
+
+  // The ideal cost of each goal comes from the heuristic caches, so ranking
+  // the goals is cheap compared to searching any one of them.
+  std::vector<Candidate> candidates;
+  candidates.reserve(goals.size());
+  for (std::size_t i = 0; i < goals.size(); ++i)
+  {
+    auto result = setup(starts, goals.goal(i), options);
+    const auto ideal = result.ideal_cost();
+    const double offset = goals.cost_offset(i);
+    const double lower_bound = ideal.has_value() ?
+      *ideal + offset : std::numeric_limits<double>::infinity();
+
+    candidates.push_back({lower_bound, offset, std::move(result)});
+  }
+
+  std::stable_sort(
+    candidates.begin(), candidates.end(),
+    [](const Candidate& a, const Candidate& b)
+    {
+      return a.lower_bound < b.lower_bound;
+    });
+
+  const auto user_cap = options.maximum_cost_estimate();
+  std::optional<std::size_t> best;
+  double best_total = std::numeric_limits<double>::infinity();
+  for (std::size_t i = 0; i < candidates.size(); ++i)
+  {
+    auto& candidate = candidates[i];
+
+    // None of the remaining goals can beat the best plan
+    if (best_total <= candidate.lower_bound)
+      break;
+
+    if (best.has_value())
+    {
+      // Abandon this search as soon as it cannot beat the best plan
+      const double cap = best_total - candidate.cost_offset;
+      candidate.result.options().maximum_cost_estimate(
+        user_cap.has_value() ? std::min(*user_cap, cap) : cap);
+    }
+
+    if (!candidate.result.resume())
+      continue;
+
+    const double total = candidate.result->get_cost() + candidate.cost_offset;
+    if (total < best_total)
+    {
+      best = i;
+      best_total = total;
+    }
+  }
+
+  if (!best.has_value())
+    return std::move(candidates.front().result);
+
+  auto chosen = std::move(candidates[*best].result);
+  chosen.options().maximum_cost_estimate(user_cap);
+
+  if (cache.get_capacity() > 0 && !chosen.incumbent())
+  {
+    if (auto key = PlanCache::Key::make(starts, chosen.get_goal(), options))
+      cache.insert(std::move(*key), chosen);
+  }
+
+  return chosen;
+}
+
+//==============================================================================
+Planner::Result Planner::Implementation::setup(
+  const std::vector<Start>& starts,
+  Goal goal,
+  Options options) const
+{
+  if (cache.get_capacity() > 0)
+  {
+    if (const auto key = PlanCache::Key::make(starts, goal, options))
+    {
+      if (auto cached = cache.find(*key))
+        return std::move(*cached);
+    }
+  }
+
+  return Result::Implementation::setup(
+    interface, starts, std::move(goal), std::move(options));
+}
+
+//==============================================================================
+Planner::Result Planner::plan(const Start& start, Goal goal) const
+{
+  return _pimpl->generate(
+    {start},
+    std::move(goal),
+    _pimpl->default_options);
+}
+
+//==============================================================================
+Planner::Result Planner::plan(
+  const Start& start,
+  Goal goal,
+  Options options) const
+{
+  return _pimpl->generate(
+    {start},
+    std::move(goal),
+    std::move(options));
+}
+
+//==============================================================================
+Planner::Result Planner::plan(const StartSet& starts, Goal goal) const
+{
+  return _pimpl->generate(
+    starts,
+    std::move(goal),
+    _pimpl->default_options);
+}
+
+//==============================================================================
+Planner::Result Planner::plan(
+  const StartSet& starts,
+  Goal goal,
+  Options options) const
+{
+  return _pimpl->generate(
+    starts,
+    std::move(goal),
+    std::move(options));
+}
+
+//==============================================================================
+Planner::Result Planner::plan(
+  const StartSet& starts,
+  const GoalSet& goals) const
 {
-  _pimpl->minimum_time = value;
-  return *this;
+  return _pimpl->generate(starts, goals, _pimpl->default_options);
 }
 
 //==============================================================================
-std::optional<rmf_traffic::Time> Planner::Goal::minimum_time() const
+Planner::Result Planner::plan(
+  const StartSet& starts,
+  const GoalSet& goals,
+  Options options) const
 {
-  return _pimpl->minimum_time;
+  return _pimpl->generate(starts, goals, options);
 }
 
 //==============================================================================
-class Planner::Implementation
+class Planner::PendingResult::Implementation
 {
 public:
 
-  planning::InterfacePtr interface;
-
-  Options default_options;
-
-  Configuration configuration;
-
-};
-
-//==============================================================================
-class Plan::Implementation
-{
-public:
+  struct Shared
+  {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<Result> result;
+    std::exception_ptr error;
+    Time posted;
+    std::optional<Time> started;
+    std::optional<Time> finished;
+
+    std::atomic_bool cancelled = false;
+    std::atomic_size_t expansions = 0;
+
+    bool done() const
+    {
+      return result.has_value() || error;
+    }
+  };
 
-  planning::PlanData plan;
+  std::shared_ptr<Shared> shared;
 
-  static std::optional<Plan> make(std::optional<planning::PlanData> result)
+  static PendingResult make(
+    planning::InterfacePtr interface,
+    const std::vector<Planner::Start>& starts,
+    Planner::Goal goal,
+    Planner::Options options,
+    std::optional<Time> deadline,
+    std::shared_ptr<PlanExecutor> executor)
   {
-    if (!result)
-      return std::nullopt;
+    if (!executor)
+      executor = PlanExecutor::shared();
 
-    Plan plan;
-    plan._pimpl = rmf_utils::make_impl<Implementation>(
-      Implementation{*std::move(result)});
+    auto shared = std::make_shared<Shared>();
+    shared->posted = std::chrono::steady_clock::now();
 
-    return plan;
-  }
+    const auto user_interrupter = options.interrupter();
+    const auto user_interrupt_flag = options.interrupt_flag();
 
+    // The expander calls the interrupter once for each node that it pops, so
+    // it doubles as our progress counter.
+    options.interrupter(
+      [shared, user_interrupter, deadline]() -> bool
+      {
+        ++shared->expansions;
+        if (shared->cancelled.load())
+          return true;
+
+        if (deadline.has_value() && *deadline < std::chrono::steady_clock::now())
+          return true;
+
+        return user_interrupter && user_interrupter();
+      });
+
+    PlanExecutor::Implementation::get(*executor).post(
+      [
+        interface = std::move(interface),
+        starts,
+        goal = std::move(goal),
+        options = std::move(options),
+        shared,
+        user_interrupter,
+        user_interrupt_flag
+      ]()
+      {
+        {
+          std::lock_guard<std::mutex> lock(shared->mutex);
+          shared->started = std::chrono::steady_clock::now();
+        }
+
+        std::optional<Result> result;
+        std::exception_ptr error;
+        try
+        {
+          result = Result::Implementation::generate(
+            interface, starts, goal, options);
+
+          // Give the result back the interrupter that the user asked for, in
+          // case they want to resume it.
+          if (user_interrupt_flag)
+            result->options().interrupt_flag(user_interrupt_flag);
+          else
+            result->options().interrupter(user_interrupter);
+        }
+        catch (...)
+        {
+          error = std::current_exception();
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(shared->mutex);
+          shared->result = std::move(result);
+          shared->error = error;
+          shared->finished = std::chrono::steady_clock::now();
+        }
+        shared->cv.notify_all();
+      });
+
+    PendingResult pending;
+    pending._pimpl = rmf_utils::make_impl<Implementation>(
+      Implementation{std::move(shared)});
+    return pending;
+  }
 };
 
 //==============================================================================
-Planner::Planner(
-  Configuration config,
-  Options default_options)
-: _pimpl(rmf_utils::make_impl<Implementation>(
-      Implementation{
-        planning::make_planner_interface(config),
-        std::move(default_options),
-        config
-      }))
+Planner::PendingResult Planner::plan_async(
+  const Start& start,
+  Goal goal,
+  Options options,
+  std::optional<Time> deadline,
+  std::shared_ptr<PlanExecutor> executor) const
 {
-  // Do nothing
+  return PendingResult::Implementation::make(
+    _pimpl->interface,
+    {start},
+    std::move(goal),
+    std::move(options),
+    deadline,
+    std::move(executor));
 }
 
 //==============================================================================
-Planner::Result Planner::Result::Implementation::generate(
-  planning::InterfacePtr interface,
-  const std::vector<Planner::Start>& starts,
-  Planner::Goal goal,
-  Planner::Options options)
+Planner::PendingResult Planner::plan_async(
+  const StartSet& starts,
+  Goal goal,
+  Options options,
+  std::optional<Time> deadline,
+  std::shared_ptr<PlanExecutor> executor) const
 {
-  // TODO(MXG): Throw an exception if any of the starts or the goal has an
-  // invalid waypoint index.
-  auto state = interface->initiate(
-    starts, std::move(goal), std::move(options));
-
-  auto plan = Plan::Implementation::make(interface->plan(state));
-
-  Planner::Result result;
-  result._pimpl = rmf_utils::make_impl<Implementation>(
-    Implementation{
-      std::move(interface),
-      std::move(state),
-      std::move(plan)
-    });
-
-  return result;
+  return PendingResult::Implementation::make(
+    _pimpl->interface,
+    starts,
+    std::move(goal),
+    std::move(options),
+    deadline,
+    std::move(executor));
 }
 
 //==============================================================================
-Planner::Result Planner::Result::Implementation::setup(
-  planning::InterfacePtr interface,
-  const std::vector<Planner::Start>& starts,
-  Planner::Goal goal,
-  Planner::Options options)
+bool Planner::PendingResult::ready() const
 {
-  auto state = interface->initiate(
-    starts, std::move(goal), std::move(options));
-
-  Planner::Result result;
-  result._pimpl = rmf_utils::make_impl<Implementation>(
-    Implementation{
-      std::move(interface),
-      std::move(state),
-      rmf_utils::nullopt
-    });
-
-  return result;
+  std::lock_guard<std::mutex> lock(_pimpl->shared->mutex);
+  return _pimpl->shared->done();
 }
 
 //==============================================================================
-auto Planner::Result::Implementation::get(const Result& r)
--> const Implementation&
+bool Planner::PendingResult::wait_for(const Duration timeout) const
 {
-  return *r._pimpl;
+  auto& shared = *_pimpl->shared;
+  std::unique_lock<std::mutex> lock(shared.mutex);
+  return shared.cv.wait_for(lock, timeout, [&]() { return shared.done(); });
 }
 
 //==============================================================================
-auto Planner::get_configuration() const -> const Configuration&
+auto Planner::PendingResult::get() const -> const Result&
 {
-  return _pimpl->configuration;
-}
+  auto& shared = *_pimpl->shared;
+  std::unique_lock<std::mutex> lock(shared.mutex);
+  shared.cv.wait(lock, [&]() { return shared.done(); });
 
-//==============================================================================
-Planner& Planner::set_default_options(Options default_options)
-{
-  _pimpl->default_options = std::move(default_options);
-  return *this;
+  if (shared.error)
+    std::rethrow_exception(shared.error);
+
+  return *shared.result;
 }
 
 //==============================================================================
-auto Planner::get_default_options() -> Options&
+void Planner::PendingResult::cancel()
 {
-  return _pimpl->default_options;
+  _pimpl->shared->cancelled = true;
 }
 
 //==============================================================================
-auto Planner::get_default_options() const -> const Options&
+bool Planner::PendingResult::cancelled() const
 {
-  return _pimpl->default_options;
+  return _pimpl->shared->cancelled.load();
 }
 
 //==============================================================================
-Planner::Result Planner::plan(const Start& start, Goal goal) const
+std::size_t Planner::PendingResult::expansions() const
 {
-  return Result::Implementation::generate(
-    _pimpl->interface,
-    {start},
-    std::move(goal),
-    _pimpl->default_options);
+  return _pimpl->shared->expansions.load();
 }
 
 //==============================================================================
-Planner::Result Planner::plan(
-  const Start& start,
-  Goal goal,
-  Options options) const
+std::optional<Duration> Planner::PendingResult::queue_delay() const
 {
-  return Result::Implementation::generate(
-    _pimpl->interface,
-    {start},
-    std::move(goal),
-    std::move(options));
+  const auto& shared = *_pimpl->shared;
+  std::lock_guard<std::mutex> lock(_pimpl->shared->mutex);
+  if (!shared.started.has_value())
+    return std::nullopt;
+
+  return *shared.started - shared.posted;
 }
 
 //==============================================================================
-Planner::Result Planner::plan(const StartSet& starts, Goal goal) const
+std::optional<Duration> Planner::PendingResult::compute_time() const
 {
-  return Result::Implementation::generate(
-    _pimpl->interface,
-    starts,
-    std::move(goal),
-    _pimpl->default_options);
+  const auto& shared = *_pimpl->shared;
+  std::lock_guard<std::mutex> lock(_pimpl->shared->mutex);
+  if (!shared.finished.has_value())
+    return std::nullopt;
+
+  return *shared.finished - *shared.started;
 }
 
 //==============================================================================
-Planner::Result Planner::plan(
-  const StartSet& starts,
-  Goal goal,
-  Options options) const
+Planner::PendingResult::PendingResult()
 {
-  return Result::Implementation::generate(
-    _pimpl->interface,
-    starts,
-    std::move(goal),
-    std::move(options));
+  // Do nothing
 }
 
 //==============================================================================
 Planner::Result Planner::setup(const Start& start, Goal goal) const
 {
-  return Result::Implementation::setup(
-    _pimpl->interface,
+  return _pimpl->setup(
     {start},
     std::move(goal),
     _pimpl->default_options);
@@ -718,8 +1816,7 @@ Planner::Result Planner::setup(
   Goal goal,
   Options options) const
 {
-  return Result::Implementation::setup(
-    _pimpl->interface,
+  return _pimpl->setup(
     {start},
     std::move(goal),
     std::move(options));
@@ -728,8 +1825,7 @@ Planner::Result Planner::setup(
 //==============================================================================
 Planner::Result Planner::setup(const StartSet& start, Goal goal) const
 {
-  return Result::Implementation::setup(
-    _pimpl->interface,
+  return _pimpl->setup(
     start,
     std::move(goal),
     _pimpl->default_options);
@@ -741,8 +1837,7 @@ Planner::Result Planner::setup(
   Goal goal,
   Options options) const
 {
-  return Result::Implementation::setup(
-    _pimpl->interface,
+  return _pimpl->setup(
     start,
     std::move(goal),
     std::move(options));
@@ -797,7 +1892,8 @@ Planner::Result Planner::Result::replan(const Start& new_start) const
     _pimpl->interface,
     {new_start},
     _pimpl->state.conditions.goal,
-    _pimpl->state.conditions.options);
+    _pimpl->state.conditions.options,
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -809,7 +1905,8 @@ Planner::Result Planner::Result::replan(
     _pimpl->interface,
     {new_start},
     _pimpl->state.conditions.goal,
-    std::move(new_options));
+    std::move(new_options),
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -819,7 +1916,8 @@ Planner::Result Planner::Result::replan(const StartSet& new_starts) const
     _pimpl->interface,
     new_starts,
     _pimpl->state.conditions.goal,
-    _pimpl->state.conditions.options);
+    _pimpl->state.conditions.options,
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -831,7 +1929,8 @@ Planner::Result Planner::Result::replan(
     _pimpl->interface,
     new_starts,
     _pimpl->state.conditions.goal,
-    std::move(new_options));
+    std::move(new_options),
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -841,7 +1940,8 @@ Planner::Result Planner::Result::setup(const Start& new_start) const
     _pimpl->interface,
     {new_start},
     _pimpl->state.conditions.goal,
-    _pimpl->state.conditions.options);
+    _pimpl->state.conditions.options,
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -853,7 +1953,8 @@ Planner::Result Planner::Result::setup(
     _pimpl->interface,
     {new_start},
     _pimpl->state.conditions.goal,
-    std::move(new_options));
+    std::move(new_options),
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -863,7 +1964,8 @@ Planner::Result Planner::Result::setup(const StartSet& new_starts) const
     _pimpl->interface,
     new_starts,
     _pimpl->state.conditions.goal,
-    _pimpl->state.conditions.options);
+    _pimpl->state.conditions.options,
+    &_pimpl->state);
 }
 
 //==============================================================================
@@ -875,18 +1977,17 @@ Planner::Result Planner::Result::setup(
     _pimpl->interface,
     new_starts,
     _pimpl->state.conditions.goal,
-    std::move(new_options));
+    std::move(new_options),
+    &_pimpl->state);
 }
 
 //==============================================================================
 bool Planner::Result::resume()
 {
-  if (_pimpl->plan)
+  if (_pimpl->plan && !_pimpl->incumbent)
     return true;
 
-  _pimpl->plan = Plan::Implementation::make(
-    _pimpl->interface->plan(_pimpl->state));
-
+  _pimpl->search();
   return _pimpl->plan.has_value();
 }
 
@@ -936,6 +2037,35 @@ std::optional<double> Planner::Result::ideal_cost() const
   return _pimpl->state.ideal_cost;
 }
 
+//==============================================================================
+std::optional<double> Planner::Result::suboptimality_bound() const
+{
+  if (!_pimpl->plan.has_value())
+    return std::nullopt;
+
+  const double cost = _pimpl->plan->get_cost();
+  const double lower_bound = _pimpl->lower_bound();
+  if (lower_bound <= 0.0)
+    return 1.0;
+
+  return std::max(cost / lower_bound, 1.0);
+}
+
+//==============================================================================
+bool Planner::Result::incumbent() const
+{
+  return _pimpl->incumbent;
+}
+
+//==============================================================================
+std::optional<double> Planner::Result::cost_gap() const
+{
+  if (!_pimpl->plan.has_value())
+    return std::nullopt;
+
+  return std::max(_pimpl->plan->get_cost() - _pimpl->lower_bound(), 0.0);
+}
+
 //==============================================================================
 const std::vector<Planner::Start>& Planner::Result::get_starts() const
 {
@@ -986,6 +2116,52 @@ std::vector<schedule::ParticipantId> Planner::Result::blockers() const
   return blockers;
 }
 
+//==============================================================================
+std::optional<double> Planner::Result::Statistics::heuristic_hit_rate() const
+{
+  const std::size_t lookups = heuristic_hits + heuristic_misses;
+  if (lookups == 0)
+    return std::nullopt;
+
+  return static_cast<double>(heuristic_hits) / static_cast<double>(lookups);
+}
+
+//==============================================================================
+auto Planner::Result::Statistics::operator+=(const Statistics& other)
+-> Statistics&
+{
+  nodes_generated += other.nodes_generated;
+  nodes_expanded += other.nodes_expanded;
+  hold_expansions += other.hold_expansions;
+  nodes_pruned += other.nodes_pruned;
+  validator_calls += other.validator_calls;
+  validator_time += other.validator_time;
+  heuristic_hits += other.heuristic_hits;
+  heuristic_misses += other.heuristic_misses;
+  heuristic_time += other.heuristic_time;
+  trajectory_time += other.trajectory_time;
+  peak_queue_size = std::max(peak_queue_size, other.peak_queue_size);
+  peak_memory = std::max(peak_memory, other.peak_memory);
+
+  // The other search began when this one ended
+  if (!time_to_first_feasible.has_value()
+    && other.time_to_first_feasible.has_value())
+  {
+    time_to_first_feasible = search_time + *other.time_to_first_feasible;
+  }
+
+  search_time += other.search_time;
+  return *this;
+}
+
+//==============================================================================
+auto Planner::Result::statistics() const -> Statistics
+{
+  auto output = _pimpl->earlier_statistics;
+  output += _pimpl->state.internal->statistics();
+  return output;
+}
+
 //==============================================================================
 Planner::Result::Result()
 {
@@ -1051,6 +2227,16 @@ auto Planner::quickest_path(
   return _pimpl->interface->quickest_path(start, goal);
 }
 
+//==============================================================================
+auto Planner::quickest_path_matrix(
+  const std::vector<StartSet>& starts,
+  const std::vector<std::size_t>& goals,
+  const std::size_t threads) const
+-> std::vector<std::vector<std::optional<QuickestPath>>>
+{
+  return _pimpl->interface->quickest_path_matrix(starts, goals, threads);
+}
+
 //==============================================================================
 const Eigen::Vector3d& Plan::Waypoint::position() const
 {
@@ -1148,6 +2334,88 @@ Plan::Plan()
   // Do nothing
 }
 
+namespace {
+//==============================================================================
+/// Add the start that a location would have on a lane, if the location is
+/// close enough to merge onto it.
+void add_lane_start(
+  const rmf_traffic::agv::Graph& graph,
+  const std::size_t lane_index,
+  const Eigen::Vector2d& p_location,
+  const double start_yaw,
+  const rmf_traffic::Time start_time,
+  const double max_merge_lane_distance,
+  const double min_lane_length,
+  std::vector<Plan::Start>& starts,
+  std::unordered_set<std::size_t>& raw_starts)
+{
+  const auto& lane = graph.get_lane(lane_index);
+  const auto& wp0 = graph.get_waypoint(lane.entry().waypoint_index());
+  const auto& wp1 = graph.get_waypoint(lane.exit().waypoint_index());
+
+  const Eigen::Vector2d p0 = wp0.get_location();
+  const Eigen::Vector2d p1 = wp1.get_location();
+
+  const double lane_length = (p1 - p0).norm();
+
+  // This "lane" is effectively a single point, so we'll skip it
+  if (lane_length < min_lane_length)
+    return;
+
+  const Eigen::Vector2d pn = (p1 - p0) / lane_length;
+  const Eigen::Vector2d p_l = p_location - p0;
+  const double p_l_projection = p_l.dot(pn);
+
+  // If it's negative then its closest point on the lane is the entry point
+  if (p_l_projection < 0.0)
+  {
+    const double dist_to_entry = p_l.norm();
+    const std::size_t entry_waypoint_index = lane.entry().waypoint_index();
+
+    if (dist_to_entry < max_merge_lane_distance)
+    {
+      if (!raw_starts.insert(entry_waypoint_index).second)
+        return;
+
+      starts.emplace_back(
+        Plan::Start(
+          start_time, entry_waypoint_index, start_yaw, p_location));
+    }
+  }
+  // If it's larger than the lane length, then its closest point on the lane
+  // is the exit point.
+  else if (lane_length < p_l_projection)
+  {
+    const double dist_to_exit = (p_location - p1).norm();
+    const std::size_t exit_waypoint_index = lane.exit().waypoint_index();
+
+    if (dist_to_exit < max_merge_lane_distance)
+    {
+      if (!raw_starts.insert(exit_waypoint_index).second)
+        return;
+
+      starts.emplace_back(
+        Plan::Start(
+          start_time, exit_waypoint_index, start_yaw, p_location));
+    }
+  }
+  // If its between the entry and the exit waypoints, then we should
+  // compute it's distance away from the lane line.
+  else
+  {
+    const double lane_dist = (p_l - p_l_projection*pn).norm();
+    const std::size_t exit_waypoint_index = lane.exit().waypoint_index();
+
+    if (lane_dist < max_merge_lane_distance)
+    {
+      starts.emplace_back(
+        Plan::Start(
+          start_time, exit_waypoint_index, start_yaw, p_location, lane_index));
+    }
+  }
+}
+} // anonymous namespace
+
 //==============================================================================
 std::vector<Plan::Start> compute_plan_starts(
   const rmf_traffic::agv::Graph& graph,
@@ -1192,66 +2460,54 @@ std::vector<Plan::Start> compute_plan_starts(
     if (wp1.get_map_name() != map_name)
       continue;
 
-    const Eigen::Vector2d p0 = wp0.get_location();
-    const Eigen::Vector2d p1 = wp1.get_location();
-
-    const double lane_length = (p1 - p0).norm();
-
-    // This "lane" is effectively a single point, so we'll skip it
-    if (lane_length < min_lane_length)
-      continue;
-
-    const Eigen::Vector2d pn = (p1 - p0) / lane_length;
-    const Eigen::Vector2d p_l = p_location - p0;
-    const double p_l_projection = p_l.dot(pn);
-
-    // If it's negative then its closest point on the lane is the entry point
-    if (p_l_projection < 0.0)
-    {
-      const double dist_to_entry = p_l.norm();
-      const std::size_t entry_waypoint_index = lane.entry().waypoint_index();
+    add_lane_start(
+      graph, i, p_location, start_yaw, start_time,
+      max_merge_lane_distance, min_lane_length, starts, raw_starts);
+  }
 
-      if (dist_to_entry < max_merge_lane_distance)
-      {
-        if (!raw_starts.insert(entry_waypoint_index).second)
-          continue;
+  return starts;
+}
 
-        starts.emplace_back(
-          Plan::Start(
-            start_time, entry_waypoint_index, start_yaw, p_location));
-      }
-    }
-    // If it's larger than the lane length, then its closest point on the lane
-    // is the exit point.
-    else if (lane_length < p_l_projection)
-    {
-      const double dist_to_exit = (p_location - p1).norm();
-      const std::size_t exit_waypoint_index = lane.exit().waypoint_index();
+//==============================================================================
+std::vector<Plan::Start> compute_plan_starts(
+  const rmf_traffic::agv::Graph& graph,
+  const GraphSpatialIndex& index,
+  const std::string& map_name,
+  const Eigen::Vector3d pose,
+  const rmf_traffic::Time start_time,
+  const double max_merge_waypoint_distance,
+  const double max_merge_lane_distance,
+  const double min_lane_length)
+{
+  if (index.num_waypoints() != graph.num_waypoints()
+    || index.num_lanes() != graph.num_lanes())
+  {
+    // *INDENT-OFF*
+    throw std::invalid_argument(
+      "[rmf_traffic::agv::compute_plan_starts] The spatial index was not "
+      "built from this graph");
+    // *INDENT-ON*
+  }
 
-      if (dist_to_exit < max_merge_lane_distance)
-      {
-        if (!raw_starts.insert(exit_waypoint_index).second)
-          continue;
+  const Eigen::Vector2d p_location = {pose[0], pose[1]};
+  const double start_yaw = pose[2];
 
-        starts.emplace_back(
-          Plan::Start(
-            start_time, exit_waypoint_index, start_yaw, p_location));
-      }
-    }
-    // If its between the entry and the exit waypoints, then we should
-    // compute it's distance away from the lane line.
-    else
-    {
-      const double lane_dist = (p_l - p_l_projection*pn).norm();
-      const std::size_t exit_waypoint_index = lane.exit().waypoint_index();
+  // The waypoints come back in ascending order, so this picks the same
+  // waypoint as the overload that scans the whole graph.
+  const auto waypoints =
+    index.waypoints_near(map_name, p_location, max_merge_waypoint_distance);
+  if (!waypoints.empty())
+    return {Plan::Start(start_time, waypoints.front(), start_yaw)};
 
-      if (lane_dist < max_merge_lane_distance)
-      {
-        starts.emplace_back(
-          Plan::Start(
-            start_time, exit_waypoint_index, start_yaw, p_location, i));
-      }
-    }
+  std::vector<Plan::Start> starts;
+  std::unordered_set<std::size_t> raw_starts;
+  const auto lanes =
+    index.lanes_near(map_name, p_location, max_merge_lane_distance);
+  for (const std::size_t i : lanes)
+  {
+    add_lane_start(
+      graph, i, p_location, start_yaw, start_time,
+      max_merge_lane_distance, min_lane_length, starts, raw_starts);
   }
 
   return starts;
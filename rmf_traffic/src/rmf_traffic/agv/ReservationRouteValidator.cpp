@@ -0,0 +1,904 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <rmf_traffic/agv/GraphSpatialIndex.hpp>
+#include <rmf_traffic/agv/RouteValidator.hpp>
+
+#include "../internal_Route.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace agv {
+
+namespace {
+//==============================================================================
+double point_to_segment(
+  const Eigen::Vector2d& p,
+  const Eigen::Vector2d& a,
+  const Eigen::Vector2d& b)
+{
+  const Eigen::Vector2d v = b - a;
+  const double length_squared = v.squaredNorm();
+  double s = 0.0;
+  if (length_squared > 0.0)
+    s = std::clamp((p - a).dot(v) / length_squared, 0.0, 1.0);
+
+  return (a + s*v - p).norm();
+}
+
+//==============================================================================
+double cross(const Eigen::Vector2d& a, const Eigen::Vector2d& b)
+{
+  return a.x()*b.y() - a.y()*b.x();
+}
+
+//==============================================================================
+double segment_to_segment(
+  const Eigen::Vector2d& a0,
+  const Eigen::Vector2d& a1,
+  const Eigen::Vector2d& b0,
+  const Eigen::Vector2d& b1)
+{
+  // Segments that properly cross each other have no distance between them
+  const double d0 = cross(a1 - a0, b0 - a0);
+  const double d1 = cross(a1 - a0, b1 - a0);
+  const double d2 = cross(b1 - b0, a0 - b0);
+  const double d3 = cross(b1 - b0, a1 - b0);
+  if (d0*d1 < 0.0 && d2*d3 < 0.0)
+    return 0.0;
+
+  return std::min(
+    std::min(point_to_segment(a0, b0, b1), point_to_segment(a1, b0, b1)),
+    std::min(point_to_segment(b0, a0, a1), point_to_segment(b1, a0, a1)));
+}
+
+//==============================================================================
+double profile_radius(const Profile& profile)
+{
+  double radius = 0.0;
+  if (const auto& footprint = profile.footprint())
+    radius = std::max(radius, footprint->get_characteristic_length());
+
+  if (const auto& vicinity = profile.vicinity())
+    radius = std::max(radius, vicinity->get_characteristic_length());
+
+  return radius;
+}
+
+//==============================================================================
+/// A span of time when a route occupies one waypoint or lane of a graph
+struct Occupancy
+{
+  std::size_t element;
+  Time start;
+  Time finish;
+};
+
+using Occupancies = std::vector<Occupancy>;
+
+} // anonymous namespace
+
+//==============================================================================
+class ReservationRouteValidator::Layout::Implementation
+{
+public:
+
+  struct Neighbor
+  {
+    std::size_t element;
+    double distance;
+  };
+
+  struct Lane
+  {
+    Eigen::Vector2d p0;
+    Eigen::Vector2d p1;
+  };
+
+  double clearance;
+  double tolerance;
+  GraphSpatialIndex index;
+  std::vector<Eigen::Vector2d> waypoints;
+  std::vector<Lane> lanes;
+
+  // The waypoints come first, followed by the lanes. Each element is included
+  // in its own list of neighbors.
+  std::vector<std::vector<Neighbor>> neighbors;
+
+  Implementation(
+    const Graph& graph,
+    double clearance_,
+    double tolerance_,
+    std::size_t max_threads,
+    const std::shared_ptr<Executor>& executor)
+  : clearance(clearance_),
+    tolerance(tolerance_),
+    index(graph, clearance_)
+  {
+    const std::size_t N_wp = graph.num_waypoints();
+    const std::size_t N_lanes = graph.num_lanes();
+    waypoints.reserve(N_wp);
+    for (std::size_t i = 0; i < N_wp; ++i)
+      waypoints.push_back(graph.get_waypoint(i).get_location());
+
+    lanes.reserve(N_lanes);
+    for (std::size_t i = 0; i < N_lanes; ++i)
+    {
+      const auto& lane = graph.get_lane(i);
+      lanes.push_back(
+        {
+          waypoints[lane.entry().waypoint_index()],
+          waypoints[lane.exit().waypoint_index()]
+        });
+    }
+
+    // Each element only writes to its own list of neighbors and the index is
+    // only read, so the elements can be spread across threads.
+    const std::size_t N = N_wp + N_lanes;
+    neighbors.resize(N);
+    std::atomic_size_t next = 0;
+    const auto work = [&]()
+      {
+        for (std::size_t k = next++; k < N; k = next++)
+        {
+          if (k < N_wp)
+            find_waypoint_neighbors(graph, k);
+          else
+            find_lane_neighbors(graph, k - N_wp);
+
+          auto& output = neighbors[k];
+          std::sort(output.begin(), output.end(),
+            [](const Neighbor& a, const Neighbor& b)
+            {
+              return a.element < b.element;
+            });
+
+          output.erase(
+            std::unique(output.begin(), output.end(),
+            [](const Neighbor& a, const Neighbor& b)
+            {
+              return a.element == b.element;
+            }), output.end());
+        }
+      };
+
+    const std::size_t num_threads = std::min(max_threads, N);
+    if (num_threads <= 1)
+    {
+      work();
+    }
+    else
+    {
+      // Each call keeps taking elements until there are none left
+      const auto& pool = executor ? executor : Executor::shared();
+      pool->run(num_threads, [&](std::size_t) { work(); }, num_threads);
+    }
+  }
+
+  void find_waypoint_neighbors(const Graph& graph, const std::size_t i)
+  {
+    const std::size_t N_wp = waypoints.size();
+    const auto& map = graph.get_waypoint(i).get_map_name();
+    const auto& p = waypoints[i];
+    auto& output = neighbors[i];
+    for (const auto j : index.waypoints_near(map, p, clearance))
+      output.push_back({j, (waypoints[j] - p).norm()});
+
+    for (const auto j : index.lanes_near(map, p, clearance))
+    {
+      const auto& other = lanes[j];
+      output.push_back(
+        {N_wp + j, point_to_segment(p, other.p0, other.p1)});
+    }
+  }
+
+  void find_lane_neighbors(const Graph& graph, const std::size_t i)
+  {
+    const std::size_t N_wp = waypoints.size();
+    const auto& lane = graph.get_lane(i);
+    const auto& map =
+      graph.get_waypoint(lane.entry().waypoint_index()).get_map_name();
+    const auto& exit_map =
+      graph.get_waypoint(lane.exit().waypoint_index()).get_map_name();
+
+    // Lanes between maps are not in the spatial index, so routes can never
+    // be matched to them.
+    if (map != exit_map)
+      return;
+
+    const auto& [p0, p1] = lanes[i];
+    auto& output = neighbors[N_wp + i];
+
+    // Every point of the lane is within half of a step of one of these
+    // samples, so anything closer than the clearance to the lane is closer
+    // than the clearance plus half of a step to one of them.
+    const double step = clearance;
+    const double radius = clearance + step/2.0;
+    const std::size_t steps =
+      static_cast<std::size_t>(std::ceil((p1 - p0).norm() / step));
+
+    for (std::size_t k = 0; k <= steps; ++k)
+    {
+      const double s = steps == 0 ? 0.0 : static_cast<double>(k) / steps;
+      const Eigen::Vector2d sample = p0 + s*(p1 - p0);
+      for (const auto j : index.waypoints_near(map, sample, radius))
+      {
+        const double d = point_to_segment(waypoints[j], p0, p1);
+        if (d < clearance)
+          output.push_back({j, d});
+      }
+
+      for (const auto j : index.lanes_near(map, sample, radius))
+      {
+        const auto& other = lanes[j];
+        const double d = segment_to_segment(p0, p1, other.p0, other.p1);
+        if (d < clearance)
+          output.push_back({N_wp + j, d});
+      }
+    }
+  }
+
+  /// Find the element that a participant occupies while it stays near a point
+  std::optional<std::size_t> element_at(
+    const std::string& map,
+    const Eigen::Vector2d& p) const
+  {
+    std::optional<std::size_t> nearest;
+    double nearest_distance = std::numeric_limits<double>::infinity();
+    for (const auto i : index.waypoints_near(map, p, tolerance))
+    {
+      const double d = (waypoints[i] - p).norm();
+      if (d < nearest_distance)
+      {
+        nearest = i;
+        nearest_distance = d;
+      }
+    }
+
+    if (nearest.has_value())
+      return nearest;
+
+    // The participant might be waiting somewhere along a lane
+    const auto on_lanes = index.lanes_near(map, p, tolerance);
+    if (on_lanes.empty())
+      return std::nullopt;
+
+    return waypoints.size() + on_lanes.front();
+  }
+
+  /// Find the lanes that a participant occupies while it moves in a straight
+  /// line from p0 to p1. The motion might span several lanes if the
+  /// waypoints between them were skipped by the interpolation.
+  std::optional<std::vector<std::size_t>> elements_along(
+    const std::string& map,
+    const Eigen::Vector2d& p0,
+    const Eigen::Vector2d& p1) const
+  {
+    const Eigen::Vector2d v = p1 - p0;
+    const double length = v.norm();
+    const Eigen::Vector2d u = v / length;
+
+    std::vector<std::size_t> candidates;
+    const std::size_t steps =
+      static_cast<std::size_t>(std::ceil(length / index.cell_size()));
+    for (std::size_t k = 0; k <= steps; ++k)
+    {
+      const double s = steps == 0 ? 0.0 : static_cast<double>(k) / steps;
+      const auto near = index.lanes_near(map, p0 + s*v, tolerance);
+      candidates.insert(candidates.end(), near.begin(), near.end());
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(
+      std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // Keep the lanes that run along the motion, and make sure that together
+    // they cover all of it.
+    std::vector<std::size_t> output;
+    std::vector<std::pair<double, double>> covered;
+    for (const auto i : candidates)
+    {
+      const auto& lane = lanes[i];
+      const double off0 = std::abs(cross(u, lane.p0 - p0));
+      const double off1 = std::abs(cross(u, lane.p1 - p0));
+      if (off0 > tolerance || off1 > tolerance)
+        continue;
+
+      double s0 = u.dot(lane.p0 - p0);
+      double s1 = u.dot(lane.p1 - p0);
+      if (s1 < s0)
+        std::swap(s0, s1);
+
+      s0 = std::max(s0, 0.0);
+      s1 = std::min(s1, length);
+      if (s1 - s0 <= 0.0)
+        continue;
+
+      output.push_back(waypoints.size() + i);
+      covered.push_back({s0, s1});
+    }
+
+    std::sort(covered.begin(), covered.end());
+    double reach = 0.0;
+    for (const auto& [s0, s1] : covered)
+    {
+      if (s0 > reach + tolerance)
+        return std::nullopt;
+
+      reach = std::max(reach, s1);
+    }
+
+    if (reach + tolerance < length)
+      return std::nullopt;
+
+    return output;
+  }
+
+  /// Find the parts of the graph that a route occupies. A nullopt means that
+  /// the route leaves the graph somewhere.
+  std::optional<Occupancies> occupancies(const Route& route) const
+  {
+    Occupancies output;
+    const auto& trajectory = route.trajectory();
+    if (trajectory.size() < 2)
+      return output;
+
+    const auto occupy = [&output](
+      const std::size_t element, const Time start, const Time finish)
+      {
+        for (auto it = output.rbegin(); it != output.rend(); ++it)
+        {
+          if (it->finish < start)
+            break;
+
+          if (it->element == element)
+          {
+            it->finish = std::max(it->finish, finish);
+            return;
+          }
+        }
+
+        output.push_back({element, start, finish});
+      };
+
+    auto it = trajectory.begin();
+    auto previous = it++;
+    for (; it != trajectory.end(); previous = it++)
+    {
+      const Eigen::Vector2d p0 = previous->position().block<2, 1>(0, 0);
+      const Eigen::Vector2d p1 = it->position().block<2, 1>(0, 0);
+      const Time t0 = previous->time();
+      const Time t1 = it->time();
+
+      if ((p1 - p0).norm() <= tolerance)
+      {
+        const auto element = element_at(route.map(), p0);
+        if (!element.has_value())
+          return std::nullopt;
+
+        occupy(*element, t0, t1);
+        continue;
+      }
+
+      const auto elements = elements_along(route.map(), p0, p1);
+      if (!elements.has_value())
+        return std::nullopt;
+
+      for (const auto element : *elements)
+        occupy(element, t0, t1);
+    }
+
+    return output;
+  }
+};
+
+//==============================================================================
+ReservationRouteValidator::Layout::Layout(
+  const Graph& graph,
+  const double clearance,
+  const double tolerance,
+  const std::size_t max_threads,
+  std::shared_ptr<Executor> executor)
+{
+  if (!(clearance > 0.0) || !(tolerance > 0.0))
+  {
+    // *INDENT-OFF*
+    throw std::invalid_argument(
+      "[rmf_traffic::agv::ReservationRouteValidator::Layout] The clearance ["
+      + std::to_string(clearance) + "] and tolerance ["
+      + std::to_string(tolerance) + "] must be greater than zero.");
+    // *INDENT-ON*
+  }
+
+  _pimpl = rmf_utils::make_impl<Implementation>(
+    graph, clearance, tolerance, max_threads, executor);
+}
+
+//==============================================================================
+ReservationRouteValidator::Layout::Layout(
+  const Graph& graph,
+  const std::vector<Profile>& profiles,
+  const double tolerance,
+  const std::size_t max_threads,
+  std::shared_ptr<Executor> executor)
+: Layout(
+    graph, clearance_for(profiles, tolerance), tolerance, max_threads,
+    std::move(executor))
+{
+  // Do nothing
+}
+
+//==============================================================================
+double ReservationRouteValidator::Layout::clearance_for(
+  const std::vector<Profile>& profiles,
+  const double tolerance)
+{
+  double largest = 0.0;
+  double second = 0.0;
+  for (const auto& profile : profiles)
+  {
+    const double r = profile_radius(profile);
+    if (largest < r)
+    {
+      second = largest;
+      largest = r;
+    }
+    else if (second < r)
+    {
+      second = r;
+    }
+  }
+
+  // A single profile still needs to be told apart from itself
+  if (profiles.size() == 1)
+    second = largest;
+
+  return largest + second + tolerance;
+}
+
+//==============================================================================
+double ReservationRouteValidator::Layout::clearance() const
+{
+  return _pimpl->clearance;
+}
+
+//==============================================================================
+double ReservationRouteValidator::Layout::tolerance() const
+{
+  return _pimpl->tolerance;
+}
+
+//==============================================================================
+std::vector<std::size_t>
+ReservationRouteValidator::Layout::waypoints_near_waypoint(
+  const std::size_t waypoint_index) const
+{
+  const std::size_t N_wp = _pimpl->waypoints.size();
+  if (N_wp <= waypoint_index)
+  {
+    // *INDENT-OFF*
+    throw std::out_of_range(
+      "[rmf_traffic::agv::ReservationRouteValidator::Layout::"
+      "waypoints_near_waypoint] Waypoint index [" +
+      std::to_string(waypoint_index) + "] is out of range for a graph with ["
+      + std::to_string(N_wp) + "] waypoints.");
+    // *INDENT-ON*
+  }
+
+  std::vector<std::size_t> output;
+  for (const auto& n : _pimpl->neighbors[waypoint_index])
+  {
+    if (n.element < N_wp)
+      output.push_back(n.element);
+  }
+
+  return output;
+}
+
+//==============================================================================
+std::vector<std::size_t> ReservationRouteValidator::Layout::lanes_near_lane(
+  const std::size_t lane_index) const
+{
+  const std::size_t N_wp = _pimpl->waypoints.size();
+  const std::size_t N_lanes = _pimpl->lanes.size();
+  if (N_lanes <= lane_index)
+  {
+    // *INDENT-OFF*
+    throw std::out_of_range(
+      "[rmf_traffic::agv::ReservationRouteValidator::Layout::lanes_near_lane] "
+      "Lane index [" + std::to_string(lane_index) + "] is out of range for a "
+      "graph with [" + std::to_string(N_lanes) + "] lanes.");
+    // *INDENT-ON*
+  }
+
+  std::vector<std::size_t> output;
+  for (const auto& n : _pimpl->neighbors[N_wp + lane_index])
+  {
+    if (N_wp <= n.element)
+      output.push_back(n.element - N_wp);
+  }
+
+  return output;
+}
+
+//==============================================================================
+class ReservationRouteValidator::Implementation
+{
+public:
+
+  using Element = schedule::Viewer::View::Element;
+
+  struct Entry
+  {
+    const Element* element;
+    double radius;
+  };
+
+  struct Reservation
+  {
+    Time start;
+    Time finish;
+    std::size_t entry;
+  };
+
+  struct Timeline
+  {
+    // Sorted by their start times
+    std::vector<Reservation> reservations;
+
+    // The latest finish time of each reservation and every one before it
+    std::vector<Time> latest_finish;
+  };
+
+  /// Everything that the routes of the schedule have reserved
+  struct Snapshot
+  {
+    std::shared_ptr<const schedule::Viewer::View> view;
+    std::vector<Entry> entries;
+    std::vector<Timeline> timelines;
+
+    // The entries that need to be checked with DetectConflict
+    std::vector<std::size_t> geometric;
+  };
+
+  /// The reservations of the schedule, which are shared by every clone of the
+  /// validator. The occupancies of each route are remembered for as long as
+  /// the route stays on the schedule, so only the routes that changed need
+  /// to be matched to the graph again when the schedule changes.
+  struct Reservations
+  {
+    struct Cached
+    {
+      std::shared_ptr<const Route> route;
+      std::optional<Occupancies> occupancies;
+    };
+
+    std::mutex mutex;
+    std::optional<schedule::Version> version;
+    std::shared_ptr<const Snapshot> snapshot;
+    std::unordered_map<const Route*, Cached> routes;
+  };
+
+  std::shared_ptr<const schedule::Viewer> shared_viewer;
+  const schedule::Viewer* viewer;
+  schedule::ParticipantId participant;
+  Profile profile;
+  std::shared_ptr<const Layout> layout;
+  DetectConflict::Options conflict_options = DetectConflict::Options();
+  bool confirm = false;
+  std::shared_ptr<Reservations> reservations =
+    std::make_shared<Reservations>();
+
+  const Layout::Implementation& layout_impl() const
+  {
+    return *layout->_pimpl;
+  }
+
+  /// Get the reservations of the current version of the schedule
+  std::shared_ptr<const Snapshot> refresh() const
+  {
+    auto& r = *reservations;
+    std::unique_lock<std::mutex> lock(r.mutex);
+    const auto version = viewer->schedule_version();
+    if (r.snapshot && version.has_value() && r.version == version)
+      return r.snapshot;
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->view = std::make_shared<const schedule::Viewer::View>(
+      viewer->query(schedule::query_all()));
+
+    const auto& graph = layout_impl();
+    const double own_radius = profile_radius(profile);
+    snapshot->timelines.resize(graph.neighbors.size());
+
+    std::unordered_map<const Route*, Reservations::Cached> routes;
+    for (const auto& element : *snapshot->view)
+    {
+      if (element.participant == participant)
+        continue;
+
+      const Route* key = element.route.get();
+      auto cached = r.routes.find(key);
+      if (cached == r.routes.end())
+      {
+        cached = r.routes.insert(
+          {key, {element.route, graph.occupancies(*element.route)}}).first;
+      }
+
+      const auto& occupancies =
+        routes.insert({key, cached->second}).first->second.occupancies;
+
+      const std::size_t index = snapshot->entries.size();
+      const double radius = profile_radius(element.description.profile());
+      snapshot->entries.push_back({&element, radius});
+
+      if (!occupancies.has_value() || graph.clearance < own_radius + radius)
+      {
+        snapshot->geometric.push_back(index);
+        continue;
+      }
+
+      for (const auto& o : *occupancies)
+      {
+        snapshot->timelines[o.element].reservations.push_back(
+          {o.start, o.finish, index});
+      }
+    }
+
+    for (auto& timeline : snapshot->timelines)
+    {
+      auto& reserved = timeline.reservations;
+      if (reserved.empty())
+        continue;
+
+      std::sort(reserved.begin(), reserved.end(),
+        [](const Reservation& a, const Reservation& b)
+        {
+          return a.start < b.start;
+        });
+
+      timeline.latest_finish.reserve(reserved.size());
+      Time latest = reserved.front().finish;
+      for (const auto& reservation : reserved)
+      {
+        latest = std::max(latest, reservation.finish);
+        timeline.latest_finish.push_back(latest);
+      }
+    }
+
+    // Routes that have left the schedule are forgotten
+    r.routes = std::move(routes);
+    r.version = version;
+    r.snapshot = std::move(snapshot);
+    return r.snapshot;
+  }
+
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options& options) const
+  {
+    const auto snapshot = refresh();
+    const auto& entries = snapshot->entries;
+
+    std::optional<Conflict> best;
+    const auto consider = [&best](const Element& e, const Time time)
+      {
+        if (best.has_value() && best->time <= time)
+          return;
+
+        best = Conflict{
+          Dependency{
+            e.participant,
+            e.plan_id,
+            e.route_id,
+            e.route->trajectory().index_after(time)
+          },
+          time,
+          e.route
+        };
+      };
+
+    std::vector<bool> checked(entries.size(), false);
+    const auto check_geometry = [&](const std::size_t index)
+      {
+        if (checked[index])
+          return;
+
+        checked[index] = true;
+        const auto& e = *entries[index].element;
+        if (!RouteData::same_map(*e.route, route))
+          return;
+
+        const auto conflict = DetectConflict::between(
+          profile,
+          route.trajectory(),
+          route.check_dependencies(e.participant, e.plan_id, e.route_id),
+          e.description.profile(),
+          e.route->trajectory(),
+          nullptr,
+          options);
+
+        if (conflict.has_value())
+          consider(e, conflict->time);
+      };
+
+    const auto& graph = layout_impl();
+    const auto occupancies = graph.occupancies(route);
+    if (!occupancies.has_value())
+    {
+      // This route cannot be matched to the graph, so it gets checked the
+      // same way that a ScheduleRouteValidator would check it.
+      for (std::size_t i = 0; i < entries.size(); ++i)
+        check_geometry(i);
+
+      return best;
+    }
+
+    const double own_radius = profile_radius(profile);
+    for (const auto& o : *occupancies)
+    {
+      // The occupancies are in chronological order, so nothing that comes
+      // after this can have an earlier conflict.
+      if (best.has_value() && best->time <= o.start)
+        break;
+
+      for (const auto& neighbor : graph.neighbors[o.element])
+      {
+        const auto& timeline = snapshot->timelines[neighbor.element];
+        const auto& reserved = timeline.reservations;
+        const auto& latest = timeline.latest_finish;
+        auto i = static_cast<std::size_t>(
+          std::upper_bound(latest.begin(), latest.end(), o.start)
+          - latest.begin());
+
+        for (; i < reserved.size() && reserved[i].start < o.finish; ++i)
+        {
+          const auto& reservation = reserved[i];
+          if (reservation.finish <= o.start)
+            continue;
+
+          const auto& entry = entries[reservation.entry];
+          if (own_radius + entry.radius <= neighbor.distance)
+            continue;
+
+          const auto& e = *entry.element;
+          const bool depends = route.check_dependencies(
+            e.participant, e.plan_id, e.route_id) != nullptr;
+
+          // Dependencies can only be honored by checking the geometry
+          if (confirm || depends)
+          {
+            check_geometry(reservation.entry);
+            continue;
+          }
+
+          consider(e, std::max(o.start, reservation.start));
+        }
+      }
+    }
+
+    for (const auto index : snapshot->geometric)
+      check_geometry(index);
+
+    return best;
+  }
+};
+
+//==============================================================================
+ReservationRouteValidator::ReservationRouteValidator(
+  const schedule::Viewer& viewer,
+  schedule::ParticipantId participant_id,
+  Profile profile,
+  std::shared_ptr<const Layout> layout)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{
+        nullptr,
+        &viewer,
+        participant_id,
+        std::move(profile),
+        std::move(layout)
+      }))
+{
+  // Do nothing
+}
+
+//==============================================================================
+ReservationRouteValidator::ReservationRouteValidator(
+  std::shared_ptr<const schedule::Viewer> viewer,
+  schedule::ParticipantId participant_id,
+  Profile profile,
+  std::shared_ptr<const Layout> layout)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{
+        viewer,
+        viewer.get(),
+        participant_id,
+        std::move(profile),
+        std::move(layout)
+      }))
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto ReservationRouteValidator::layout() const
+-> const std::shared_ptr<const Layout>&
+{
+  return _pimpl->layout;
+}
+
+//==============================================================================
+ReservationRouteValidator& ReservationRouteValidator::conflict_options(
+  DetectConflict::Options options)
+{
+  _pimpl->conflict_options = std::move(options);
+  return *this;
+}
+
+//==============================================================================
+const DetectConflict::Options&
+ReservationRouteValidator::conflict_options() const
+{
+  return _pimpl->conflict_options;
+}
+
+//==============================================================================
+ReservationRouteValidator& ReservationRouteValidator::geometric_confirmation(
+  const bool choice)
+{
+  _pimpl->confirm = choice;
+  return *this;
+}
+
+//==============================================================================
+bool ReservationRouteValidator::geometric_confirmation() const
+{
+  return _pimpl->confirm;
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+ReservationRouteValidator::find_conflict(const Route& route) const
+{
+  return _pimpl->find_conflict(route, _pimpl->conflict_options);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+ReservationRouteValidator::find_conflict(
+  const Route& route,
+  const DetectConflict::Options& options) const
+{
+  return _pimpl->find_conflict(route, options);
+}
+
+//==============================================================================
+std::unique_ptr<RouteValidator> ReservationRouteValidator::clone() const
+{
+  return std::make_unique<ReservationRouteValidator>(*this);
+}
+
+} // namespace agv
+} // namespace rmf_traffic
@@ -29,6 +29,8 @@ public:
 
   Planner::Result result;
 
+  std::optional<Duration> time_budget = std::nullopt;
+
 };
 
 //==============================================================================
@@ -58,12 +60,17 @@ std::vector<schedule::Itinerary> Rollout::expand(
   if (block_it->second.empty())
     return {};
 
+  std::optional<Time> deadline;
+  if (_pimpl->time_budget.has_value())
+    deadline = std::chrono::steady_clock::now() + *_pimpl->time_budget;
+
   return result.interface->rollout(
     span,
     block_it->second,
     result.state.conditions.goal,
     options,
-    max_rollouts);
+    max_rollouts,
+    deadline);
 }
 
 //==============================================================================
@@ -75,5 +82,18 @@ std::vector<schedule::Itinerary> Rollout::expand(
   return expand(blocker, span, _pimpl->result.options(), max_rollouts);
 }
 
+//==============================================================================
+Rollout& Rollout::time_budget(std::optional<Duration> budget)
+{
+  _pimpl->time_budget = budget;
+  return *this;
+}
+
+//==============================================================================
+std::optional<Duration> Rollout::time_budget() const
+{
+  return _pimpl->time_budget;
+}
+
 } // namespace agv
 } // namespace rmf_traffic
@@ -18,9 +18,263 @@
 #include <rmf_traffic/agv/RouteValidator.hpp>
 #include <rmf_traffic/DetectConflict.hpp>
 
+#include "internal_ConflictMemo.hpp"
+#include "../internal_Route.hpp"
+
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <set>
+
 namespace rmf_traffic {
 namespace agv {
 
+namespace {
+//==============================================================================
+std::optional<RouteValidator::Conflict> find_first_conflict(
+  const Profile& profile,
+  const Route& route,
+  const std::vector<const schedule::Viewer::View::Element*>& elements,
+  const DetectConflict::Options& options,
+  ConflictMemo* memo,
+  const RouteValidator::Interrupter& interrupter = nullptr)
+{
+  const Trajectory& trajectory = route.trajectory();
+
+  // The elements whose results are not remembered get checked as a batch. If
+  // a remembered conflict is found, only the elements before it need to be
+  // checked, because we are looking for the first conflict.
+  std::vector<DetectConflict::Candidate> candidates;
+  std::vector<std::size_t> candidate_elements;
+  candidates.reserve(elements.size());
+  candidate_elements.reserve(elements.size());
+  std::optional<std::pair<std::size_t, Time>> remembered;
+  for (std::size_t i = 0; i < elements.size(); ++i)
+  {
+    const auto* v = elements[i];
+    const auto* deps =
+      route.check_dependencies(v->participant, v->plan_id, v->route_id);
+
+    if (memo && !deps)
+    {
+      const auto result = memo->find(
+        profile, trajectory, v->description.profile(), v->route->trajectory(),
+        options);
+
+      if (result.has_value())
+      {
+        if (!result->has_value())
+          continue;
+
+        remembered = std::make_pair(i, **result);
+        break;
+      }
+    }
+
+    candidates.push_back(
+      DetectConflict::Candidate{
+        &v->description.profile(),
+        &v->route->trajectory(),
+        deps,
+        nullptr
+      });
+    candidate_elements.push_back(i);
+  }
+
+  DetectConflict::BatchOptions batch;
+  batch.detection = options;
+  if (interrupter)
+    batch.interrupter = [&interrupter]() { return interrupter(); };
+
+  const auto conflicts = DetectConflict::between_many(
+    profile, trajectory, candidates, batch);
+
+  // The candidates that were skipped by an interruption are unknown, so
+  // nothing from this batch can be remembered or reported.
+  if (interrupter && interrupter())
+    return std::nullopt;
+
+  if (memo)
+  {
+    // Every candidate before the one in conflict was found to be clear
+    const std::size_t checked = conflicts.empty() ?
+      candidates.size() : conflicts.front().index + 1;
+
+    for (std::size_t k = 0; k < checked; ++k)
+    {
+      const auto& candidate = candidates[k];
+      if (candidate.dependencies_on_candidate)
+        continue;
+
+      std::optional<Time> result;
+      if (k + 1 == checked && !conflicts.empty())
+        result = conflicts.front().conflict.time;
+
+      memo->insert(
+        profile, trajectory, *candidate.profile, *candidate.trajectory,
+        options, result);
+    }
+  }
+
+  std::optional<std::pair<std::size_t, Time>> first = remembered;
+  if (!conflicts.empty())
+  {
+    first = std::make_pair(
+      candidate_elements[conflicts.front().index],
+      conflicts.front().conflict.time);
+  }
+
+  if (!first.has_value())
+    return std::nullopt;
+
+  const auto time = first->second;
+  const auto* v = elements[first->first];
+  return RouteValidator::Conflict{
+    Dependency{
+      v->participant,
+      v->plan_id,
+      v->route_id,
+      v->route->trajectory().index_after(time)
+    },
+    time,
+    v->route
+  };
+}
+
+//==============================================================================
+std::vector<const Route*> route_pointers(const std::vector<Route>& routes)
+{
+  std::vector<const Route*> pointers;
+  pointers.reserve(routes.size());
+  for (const auto& route : routes)
+    pointers.push_back(&route);
+
+  return pointers;
+}
+
+//==============================================================================
+/// Make one query that finds everything that is relevant to any of the routes
+schedule::Query::Spacetime make_spacetime(
+  const std::vector<const Route*>& routes)
+{
+  Time lower = *routes.front()->trajectory().start_time();
+  Time upper = *routes.front()->trajectory().finish_time();
+
+  schedule::Query::Spacetime spacetime;
+  auto& timespan = spacetime.query_timespan().all_maps(false);
+  for (const Route* route : routes)
+  {
+    timespan.add_map(route->map());
+    lower = std::min(lower, *route->trajectory().start_time());
+    upper = std::max(upper, *route->trajectory().finish_time());
+  }
+
+  timespan
+  .set_lower_time_bound(lower)
+  .set_upper_time_bound(upper);
+
+  return spacetime;
+}
+
+//==============================================================================
+/// True if the other route would have been found by a query that was made for
+/// this route alone
+bool overlaps(const Route& route, const Route& other)
+{
+  if (!RouteData::same_map(route, other))
+    return false;
+
+  const Trajectory& trajectory = route.trajectory();
+  const Trajectory& other_trajectory = other.trajectory();
+  if (*other_trajectory.finish_time() < *trajectory.start_time())
+    return false;
+
+  if (*trajectory.finish_time() < *other_trajectory.start_time())
+    return false;
+
+  return true;
+}
+} // anonymous namespace
+
+//==============================================================================
+std::optional<RouteValidator::Conflict> RouteValidator::find_conflict(
+  const Route& route,
+  const DetectConflict::Options&) const
+{
+  return find_conflict(route);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict> RouteValidator::find_conflicts(
+  const std::vector<Route>& routes) const
+{
+  for (const auto& route : routes)
+  {
+    if (auto conflict = find_conflict(route))
+      return conflict;
+  }
+
+  return std::nullopt;
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict> RouteValidator::find_conflicts(
+  const std::vector<Route>& routes,
+  const DetectConflict::Options& options) const
+{
+  for (const auto& route : routes)
+  {
+    if (auto conflict = find_conflict(route, options))
+      return conflict;
+  }
+
+  return std::nullopt;
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict> RouteValidator::find_conflict(
+  const Route& route,
+  const DetectConflict::Options* options,
+  const Interrupter&) const
+{
+  if (options)
+    return find_conflict(route, *options);
+
+  return find_conflict(route);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict> RouteValidator::find_conflicts(
+  const std::vector<Route>& routes,
+  const DetectConflict::Options* options,
+  const Interrupter& interrupter) const
+{
+  for (const auto& route : routes)
+  {
+    if (interrupter && interrupter())
+      return std::nullopt;
+
+    if (auto conflict = find_conflict(route, options, interrupter))
+      return conflict;
+  }
+
+  return std::nullopt;
+}
+
+//==============================================================================
+bool RouteValidator::Identity::operator==(const Identity& other) const
+{
+  return schedule == other.schedule
+    && version == other.version
+    && participant == other.participant;
+}
+
+//==============================================================================
+auto RouteValidator::identity() const -> std::optional<Identity>
+{
+  return std::nullopt;
+}
+
 //==============================================================================
 class ScheduleRouteValidator::Implementation
 {
@@ -30,6 +284,37 @@ public:
   const schedule::Viewer* viewer;
   schedule::ParticipantId participant;
   Profile profile;
+  DetectConflict::Options conflict_options = DetectConflict::Options();
+
+  /// The results of the last query, which are shared by every clone of the
+  /// validator
+  struct QueryWindow
+  {
+    Duration padding;
+
+    std::mutex mutex;
+    const schedule::Viewer* viewer = nullptr;
+    std::optional<schedule::Version> version;
+    std::set<std::string> maps;
+    Time lower;
+    Time upper;
+    std::shared_ptr<const schedule::Viewer::View> view;
+  };
+
+  std::shared_ptr<QueryWindow> window = nullptr;
+
+  /// Conflict results that are shared by every clone of the validator
+  std::shared_ptr<ConflictMemo> memo = nullptr;
+
+  /// Get a view that has everything that is relevant to the routes
+  std::shared_ptr<const schedule::Viewer::View> query(
+    const std::vector<const Route*>& routes) const;
+
+  /// Check every route with one query of the schedule
+  std::optional<Conflict> find_conflicts(
+    const std::vector<const Route*>& routes,
+    const DetectConflict::Options& options,
+    const Interrupter& interrupter = nullptr) const;
 
 };
 
@@ -93,51 +378,247 @@ schedule::ParticipantId ScheduleRouteValidator::participant() const
   return _pimpl->participant;
 }
 
+//==============================================================================
+ScheduleRouteValidator& ScheduleRouteValidator::conflict_options(
+  DetectConflict::Options options)
+{
+  _pimpl->conflict_options = std::move(options);
+  return *this;
+}
+
+//==============================================================================
+const DetectConflict::Options&
+ScheduleRouteValidator::conflict_options() const
+{
+  return _pimpl->conflict_options;
+}
+
+//==============================================================================
+ScheduleRouteValidator& ScheduleRouteValidator::query_window(
+  std::optional<Duration> padding)
+{
+  if (padding.has_value())
+  {
+    _pimpl->window = std::make_shared<Implementation::QueryWindow>();
+    _pimpl->window->padding = *padding;
+  }
+  else
+  {
+    _pimpl->window = nullptr;
+  }
+
+  return *this;
+}
+
+//==============================================================================
+std::optional<Duration> ScheduleRouteValidator::query_window() const
+{
+  if (_pimpl->window)
+    return _pimpl->window->padding;
+
+  return std::nullopt;
+}
+
+//==============================================================================
+ScheduleRouteValidator& ScheduleRouteValidator::conflict_memo(
+  const std::size_t capacity)
+{
+  if (capacity > 0)
+    _pimpl->memo = std::make_shared<ConflictMemo>(capacity);
+  else
+    _pimpl->memo = nullptr;
+
+  return *this;
+}
+
+//==============================================================================
+std::size_t ScheduleRouteValidator::conflict_memo() const
+{
+  if (_pimpl->memo)
+    return _pimpl->memo->capacity();
+
+  return 0;
+}
+
 //==============================================================================
 std::optional<RouteValidator::Conflict>
 ScheduleRouteValidator::find_conflict(const Route& route) const
 {
-  // TODO(MXG): Should we use a mutable Spacetime instance to avoid the
-  // allocation here?
+  return find_conflict(route, _pimpl->conflict_options);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+ScheduleRouteValidator::find_conflict(
+  const Route& route,
+  const DetectConflict::Options& options) const
+{
+  return _pimpl->find_conflicts({&route}, options);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+ScheduleRouteValidator::find_conflicts(const std::vector<Route>& routes) const
+{
+  return find_conflicts(routes, _pimpl->conflict_options);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+ScheduleRouteValidator::find_conflicts(
+  const std::vector<Route>& routes,
+  const DetectConflict::Options& options) const
+{
+  return _pimpl->find_conflicts(route_pointers(routes), options);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+ScheduleRouteValidator::find_conflict(
+  const Route& route,
+  const DetectConflict::Options* options,
+  const Interrupter& interrupter) const
+{
+  return _pimpl->find_conflicts(
+    {&route}, options ? *options : _pimpl->conflict_options, interrupter);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+ScheduleRouteValidator::find_conflicts(
+  const std::vector<Route>& routes,
+  const DetectConflict::Options* options,
+  const Interrupter& interrupter) const
+{
+  return _pimpl->find_conflicts(
+    route_pointers(routes),
+    options ? *options : _pimpl->conflict_options,
+    interrupter);
+}
+
+//==============================================================================
+std::shared_ptr<const schedule::Viewer::View>
+ScheduleRouteValidator::Implementation::query(
+  const std::vector<const Route*>& routes) const
+{
+  const auto version = window ? viewer->schedule_version() : std::nullopt;
+  if (!version.has_value())
+  {
+    // TODO(MXG): Should we use a mutable Spacetime instance to avoid the
+    // allocation here?
+    return std::make_shared<schedule::Viewer::View>(
+      viewer->query(
+        make_spacetime(routes), schedule::Query::Participants::make_all()));
+  }
+
+  Time lower = *routes.front()->trajectory().start_time();
+  Time upper = *routes.front()->trajectory().finish_time();
+  for (const Route* route : routes)
+  {
+    lower = std::min(lower, *route->trajectory().start_time());
+    upper = std::max(upper, *route->trajectory().finish_time());
+  }
+
+  std::set<std::string> maps;
+  {
+    std::lock_guard<std::mutex> lock(window->mutex);
+    const bool same_schedule =
+      window->viewer == viewer && window->version == version;
+
+    bool covered = window->view && same_schedule
+      && window->lower <= lower && upper <= window->upper;
+
+    for (std::size_t i = 0; covered && i < routes.size(); ++i)
+      covered = window->maps.count(routes[i]->map()) > 0;
+
+    if (covered)
+      return window->view;
+
+    // If only the time ran out, then the maps that we already know about are
+    // probably still needed.
+    if (same_schedule)
+      maps = window->maps;
+  }
+
+  for (const Route* route : routes)
+    maps.insert(route->map());
+
+  // Query a wider window so that the next routes are likely to fall inside it
+  lower -= window->padding;
+  upper += window->padding;
+
   schedule::Query::Spacetime spacetime;
-  spacetime.query_timespan()
-  .all_maps(false)
-  .add_map(route.map())
-  .set_lower_time_bound(*route.trajectory().start_time())
-  .set_upper_time_bound(*route.trajectory().finish_time());
+  auto& timespan = spacetime.query_timespan().all_maps(false);
+  for (const auto& map : maps)
+    timespan.add_map(map);
+
+  timespan
+  .set_lower_time_bound(lower)
+  .set_upper_time_bound(upper);
+
+  auto view = std::make_shared<const schedule::Viewer::View>(
+    viewer->query(spacetime, schedule::Query::Participants::make_all()));
+
+  std::lock_guard<std::mutex> lock(window->mutex);
+  window->view = view;
+  window->viewer = viewer;
+  window->version = version;
+  window->maps = std::move(maps);
+  window->lower = lower;
+  window->upper = upper;
+
+  return view;
+}
 
-  const auto view = _pimpl->viewer->query(
-    spacetime, schedule::Query::Participants::make_all());
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+ScheduleRouteValidator::Implementation::find_conflicts(
+  const std::vector<const Route*>& routes,
+  const DetectConflict::Options& options,
+  const Interrupter& interrupter) const
+{
+  if (routes.empty())
+    return std::nullopt;
 
-  for (const auto& v : view)
+  const auto view = query(routes);
+
+  std::vector<const schedule::Viewer::View::Element*> elements;
+  elements.reserve(view->size());
+  for (const Route* route : routes)
   {
-    if (v.participant == _pimpl->participant)
-      continue;
+    if (interrupter && interrupter())
+      return std::nullopt;
 
-    if (const auto conflict = rmf_traffic::DetectConflict::between(
-        _pimpl->profile,
-        route.trajectory(),
-        route.check_dependencies(v.participant, v.plan_id, v.route_id),
-        v.description.profile(),
-        v.route->trajectory(),
-        nullptr))
+    // The view was made for every route at once, so we only keep the parts
+    // that this route would have found on its own.
+    elements.clear();
+    for (const auto& v : *view)
     {
-      return Conflict{
-        Dependency{
-          v.participant,
-          v.plan_id,
-          v.route_id,
-          v.route->trajectory().index_after(conflict->time)
-        },
-        conflict->time,
-        v.route
-      };
+      if (v.participant == participant)
+        continue;
+
+      if (overlaps(*route, *v.route))
+        elements.push_back(&v);
     }
+
+    if (auto conflict = find_first_conflict(
+        profile, *route, elements, options, memo.get(), interrupter))
+      return conflict;
   }
 
   return std::nullopt;
 }
 
+//==============================================================================
+auto ScheduleRouteValidator::identity() const -> std::optional<Identity>
+{
+  const auto version = _pimpl->viewer->schedule_version();
+  if (!version.has_value())
+    return std::nullopt;
+
+  return Identity{_pimpl->viewer, *version, _pimpl->participant};
+}
+
 //==============================================================================
 std::unique_ptr<RouteValidator> ScheduleRouteValidator::clone() const
 {
@@ -155,6 +636,10 @@ public:
     Profile profile;
     bool ignore_unresponsive;
     bool ignore_bystanders;
+    DetectConflict::Options conflict_options;
+
+    /// Conflict results that are shared by every generated validator
+    std::shared_ptr<ConflictMemo> memo = nullptr;
   };
 
   std::shared_ptr<Data> data;
@@ -179,7 +664,8 @@ public:
           std::move(viewer),
           std::move(profile),
           false,
-          false
+          false,
+          DetectConflict::Options()
         }))
   {
     const auto& alternatives = data->viewer->alternatives();
@@ -198,6 +684,12 @@ public:
   schedule::Negotiation::VersionedKeySequence rollouts;
   std::optional<schedule::ParticipantId> masked = std::nullopt;
 
+  /// Check every route with one query of the negotiation table
+  std::optional<Conflict> find_conflicts(
+    const std::vector<const Route*>& routes,
+    const DetectConflict::Options& options,
+    const Interrupter& interrupter = nullptr) const;
+
   static NegotiatingRouteValidator make(
     std::shared_ptr<const Generator::Implementation::Data> data,
     schedule::Negotiation::VersionedKeySequence rollouts)
@@ -257,6 +749,42 @@ auto NegotiatingRouteValidator::Generator::ignore_bystanders(const bool val)
   return *this;
 }
 
+//==============================================================================
+auto NegotiatingRouteValidator::Generator::conflict_options(
+  DetectConflict::Options options) -> Generator&
+{
+  _pimpl->data->conflict_options = std::move(options);
+  return *this;
+}
+
+//==============================================================================
+const DetectConflict::Options&
+NegotiatingRouteValidator::Generator::conflict_options() const
+{
+  return _pimpl->data->conflict_options;
+}
+
+//==============================================================================
+auto NegotiatingRouteValidator::Generator::conflict_memo(
+  const std::size_t capacity) -> Generator&
+{
+  if (capacity > 0)
+    _pimpl->data->memo = std::make_shared<ConflictMemo>(capacity);
+  else
+    _pimpl->data->memo = nullptr;
+
+  return *this;
+}
+
+//==============================================================================
+std::size_t NegotiatingRouteValidator::Generator::conflict_memo() const
+{
+  if (_pimpl->data->memo)
+    return _pimpl->data->memo->capacity();
+
+  return 0;
+}
+
 //==============================================================================
 NegotiatingRouteValidator NegotiatingRouteValidator::Generator::begin() const
 {
@@ -269,63 +797,211 @@ NegotiatingRouteValidator NegotiatingRouteValidator::Generator::begin() const
 }
 
 //==============================================================================
-std::vector<rmf_utils::clone_ptr<NegotiatingRouteValidator>>
-NegotiatingRouteValidator::Generator::all() const
+class NegotiatingRouteValidator::Generator::Enumerator::Implementation
 {
-  const std::size_t N_alts = _pimpl->data->viewer->alternatives().size();
-  if (0 == N_alts)
-    return {rmf_utils::make_clone<NegotiatingRouteValidator>(begin())};
-
-  std::vector<std::vector<schedule::Version>> version_queue;
-  std::vector<schedule::Version> current_versions;
-  current_versions.reserve(N_alts);
-  std::vector<schedule::Version> end_versions;
-  current_versions.reserve(N_alts);
-  schedule::Negotiation::VersionedKeySequence keys;
-  keys.reserve(N_alts);
-  for (const auto& alts : _pimpl->data->viewer->alternatives())
+public:
+
+  /// The alternatives of one participant that offered them, from the most
+  /// promising to the least
+  struct Dimension
   {
-    current_versions.push_back(0);
-    end_versions.push_back(alts.second->size());
-    keys.push_back({alts.first, 0});
-  }
+    schedule::ParticipantId participant;
+    std::vector<schedule::Version> versions;
+    std::vector<Duration> delays;
+  };
+
+  /// A combination of alternatives, given by its position along each dimension
+  struct Candidate
+  {
+    Duration delay;
+    std::vector<std::size_t> positions;
 
-  assert(current_versions.size() == N_alts);
-  assert(end_versions.size() == N_alts);
-  assert(keys.size() == N_alts);
+    bool operator>(const Candidate& other) const
+    {
+      if (delay != other.delay)
+        return delay > other.delay;
 
-  while (true) // A break statement provides the exit condition
+      return positions > other.positions;
+    }
+  };
+
+  std::shared_ptr<const Generator::Implementation::Data> data;
+  std::vector<Dimension> dimensions;
+  std::priority_queue<
+    Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+  std::size_t remaining = 0;
+
+  /// The time when the last route of an itinerary finishes
+  static std::optional<Time> finish_time(const schedule::Itinerary& itinerary)
   {
-    for (std::size_t i = 0; i < N_alts-1; ++i)
+    std::optional<Time> finish;
+    for (const auto& route : itinerary)
     {
-      if (current_versions[i] >= end_versions[i])
+      const auto* t = route.trajectory().finish_time();
+      if (t && (!finish.has_value() || *finish < *t))
+        finish = *t;
+    }
+
+    return finish;
+  }
+
+  static Dimension make_dimension(
+    const schedule::ParticipantId participant,
+    const schedule::Negotiation::Alternatives& alternatives)
+  {
+    Dimension dimension{participant, {}, {}};
+    std::vector<std::optional<Time>> finishes;
+    finishes.reserve(alternatives.size());
+    std::optional<Time> earliest;
+    for (const auto& alternative : alternatives)
+    {
+      const auto finish = finish_time(alternative);
+      if (finish.has_value() && (!earliest.has_value() || *finish < *earliest))
+        earliest = finish;
+
+      finishes.push_back(finish);
+    }
+
+    std::vector<Duration> delays;
+    delays.reserve(alternatives.size());
+    for (const auto& finish : finishes)
+    {
+      // An alternative that never finishes does not hold anyone up
+      delays.push_back(
+        finish.has_value() ? *finish - *earliest : Duration(0));
+    }
+
+    dimension.versions.resize(alternatives.size());
+    std::iota(dimension.versions.begin(), dimension.versions.end(), 0);
+    std::stable_sort(
+      dimension.versions.begin(), dimension.versions.end(),
+      [&](const schedule::Version a, const schedule::Version b)
       {
-        for (std::size_t j = 0; j <= i; ++j)
-          current_versions[j] = 0;
+        return delays[a] < delays[b];
+      });
 
-        ++current_versions[i+1];
-        continue;
-      }
+    dimension.delays.reserve(delays.size());
+    for (const auto v : dimension.versions)
+      dimension.delays.push_back(delays[v]);
+
+    return dimension;
+  }
+
+  Implementation(std::shared_ptr<const Generator::Implementation::Data> data_)
+  : data(std::move(data_))
+  {
+    remaining = 1;
+    for (const auto& [participant, alternatives] : data->viewer->alternatives())
+    {
+      dimensions.push_back(make_dimension(participant, *alternatives));
+      remaining *= alternatives->size();
     }
 
-    if (current_versions.back() >= end_versions.back())
-      break;
+    if (remaining > 0)
+    {
+      Candidate first{Duration(0), std::vector<std::size_t>(dimensions.size())};
+      for (const auto& dimension : dimensions)
+        first.delay += dimension.delays.front();
 
-    version_queue.push_back(current_versions);
-    ++current_versions[0];
+      queue.push(std::move(first));
+    }
   }
 
-  std::vector<rmf_utils::clone_ptr<NegotiatingRouteValidator>> validators;
-  validators.reserve(version_queue.size());
+  std::optional<NegotiatingRouteValidator> next()
+  {
+    if (queue.empty())
+      return std::nullopt;
+
+    Candidate candidate = queue.top();
+    queue.pop();
+    --remaining;
+
+    // Each combination is reached from exactly one parent: the combination
+    // that has one less step along its last dimension that has taken a step.
+    // So a combination only steps along that dimension or the ones after it,
+    // and nothing is ever queued twice.
+    std::size_t last = 0;
+    for (std::size_t i = 0; i < candidate.positions.size(); ++i)
+    {
+      if (candidate.positions[i] > 0)
+        last = i;
+    }
+
+    for (std::size_t i = last; i < dimensions.size(); ++i)
+    {
+      const auto& dimension = dimensions[i];
+      const auto position = candidate.positions[i];
+      if (position + 1 >= dimension.versions.size())
+        continue;
+
+      Candidate child = candidate;
+      child.positions[i] = position + 1;
+      child.delay +=
+        dimension.delays[position + 1] - dimension.delays[position];
+      queue.push(std::move(child));
+    }
+
+    schedule::Negotiation::VersionedKeySequence rollouts;
+    rollouts.reserve(dimensions.size());
+    for (std::size_t i = 0; i < dimensions.size(); ++i)
+    {
+      rollouts.push_back(
+        {
+          dimensions[i].participant,
+          dimensions[i].versions[candidate.positions[i]]
+        });
+    }
+
+    return NegotiatingRouteValidator::Implementation::make(
+      data, std::move(rollouts));
+  }
 
-  for (const auto& versions : version_queue)
+  static Enumerator make(
+    std::shared_ptr<const Generator::Implementation::Data> data)
   {
-    for (std::size_t i = 0; i < N_alts; ++i)
-      keys[i].version = versions[i];
+    Enumerator output;
+    output._pimpl =
+      rmf_utils::make_unique_impl<Implementation>(std::move(data));
+    return output;
+  }
+};
+
+//==============================================================================
+NegotiatingRouteValidator::Generator::Enumerator::Enumerator()
+{
+  // Do nothing
+}
 
+//==============================================================================
+std::optional<NegotiatingRouteValidator>
+NegotiatingRouteValidator::Generator::Enumerator::next()
+{
+  return _pimpl->next();
+}
+
+//==============================================================================
+std::size_t NegotiatingRouteValidator::Generator::Enumerator::remaining() const
+{
+  return _pimpl->remaining;
+}
+
+//==============================================================================
+auto NegotiatingRouteValidator::Generator::enumerate() const -> Enumerator
+{
+  return Enumerator::Implementation::make(_pimpl->data);
+}
+
+//==============================================================================
+std::vector<rmf_utils::clone_ptr<NegotiatingRouteValidator>>
+NegotiatingRouteValidator::Generator::all() const
+{
+  auto enumerator = enumerate();
+  std::vector<rmf_utils::clone_ptr<NegotiatingRouteValidator>> validators;
+  validators.reserve(enumerator.remaining());
+  while (auto validator = enumerator.next())
+  {
     validators.emplace_back(
-      NegotiatingRouteValidator::Implementation::make_ptr(
-        _pimpl->data, keys));
+      rmf_utils::make_clone<NegotiatingRouteValidator>(std::move(*validator)));
   }
 
   return validators;
@@ -421,20 +1097,75 @@ bool NegotiatingRouteValidator::end() const
 //==============================================================================
 std::optional<RouteValidator::Conflict>
 NegotiatingRouteValidator::find_conflict(const Route& route) const
+{
+  return find_conflict(route, _pimpl->data->conflict_options);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+NegotiatingRouteValidator::find_conflict(
+  const Route& route,
+  const DetectConflict::Options& options) const
+{
+  return _pimpl->find_conflicts({&route}, options);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+NegotiatingRouteValidator::find_conflicts(
+  const std::vector<Route>& routes) const
+{
+  return find_conflicts(routes, _pimpl->data->conflict_options);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+NegotiatingRouteValidator::find_conflicts(
+  const std::vector<Route>& routes,
+  const DetectConflict::Options& options) const
+{
+  return _pimpl->find_conflicts(route_pointers(routes), options);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+NegotiatingRouteValidator::find_conflict(
+  const Route& route,
+  const DetectConflict::Options* options,
+  const Interrupter& interrupter) const
+{
+  return _pimpl->find_conflicts(
+    {&route}, options ? *options : _pimpl->data->conflict_options,
+    interrupter);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+NegotiatingRouteValidator::find_conflicts(
+  const std::vector<Route>& routes,
+  const DetectConflict::Options* options,
+  const Interrupter& interrupter) const
+{
+  return _pimpl->find_conflicts(
+    route_pointers(routes),
+    options ? *options : _pimpl->data->conflict_options,
+    interrupter);
+}
+
+//==============================================================================
+std::optional<RouteValidator::Conflict>
+NegotiatingRouteValidator::Implementation::find_conflicts(
+  const std::vector<const Route*>& routes,
+  const DetectConflict::Options& options,
+  const Interrupter& interrupter) const
 {
   using namespace std::chrono_literals;
 
-  // TODO(MXG): Consider if we can reduce the amount of heap allocation that's
-  // needed here.
-  schedule::Query::Spacetime spacetime;
-  spacetime.query_timespan()
-  .all_maps(false)
-  .add_map(route.map())
-  .set_lower_time_bound(*route.trajectory().start_time())
-  .set_upper_time_bound(*route.trajectory().finish_time());
+  if (routes.empty())
+    return std::nullopt;
 
   const auto skip_unresponsive =
-    [may_skip = _pimpl->data->ignore_unresponsive](
+    [may_skip = data->ignore_unresponsive](
     const schedule::ParticipantDescription& description) -> bool
     {
       if (!may_skip)
@@ -445,7 +1176,7 @@ NegotiatingRouteValidator::find_conflict(const Route& route) const
     };
 
   const auto skip_bystander =
-    [data = _pimpl->data](const schedule::ParticipantId id) -> bool
+    [data = data](const schedule::ParticipantId id) -> bool
     {
       if (!data->ignore_bystanders)
         return false;
@@ -467,50 +1198,55 @@ NegotiatingRouteValidator::find_conflict(const Route& route) const
       return false;
     };
 
-  const auto view = _pimpl->data->viewer->query(spacetime, _pimpl->rollouts);
+  // TODO(MXG): Consider if we can reduce the amount of heap allocation that's
+  // needed here.
+  const auto view = data->viewer->query(make_spacetime(routes), rollouts);
+
+  std::vector<const schedule::Viewer::View::Element*> relevant;
+  relevant.reserve(view.size());
   for (const auto& v : view)
   {
-    if (_pimpl->masked && (*_pimpl->masked == v.participant))
+    if (masked && (*masked == v.participant))
       continue;
 
     if (skip_participant(v.participant, v.description))
       continue;
 
-    // NOTE(MXG): There is no need to check the map, because the query will
-    // filter out all itineraries that are not on this map.
-    if (const auto conflict = rmf_traffic::DetectConflict::between(
-        _pimpl->data->profile,
-        route.trajectory(),
-        route.check_dependencies(v.participant, v.plan_id, v.route_id),
-        v.description.profile(),
-        v.route->trajectory(),
-        nullptr))
-    {
-      return Conflict{
-        Dependency{
-          v.participant,
-          v.plan_id,
-          v.route_id,
-          v.route->trajectory().index_after(conflict->time)
-        },
-        conflict->time,
-        v.route
-      };
-    }
+    relevant.push_back(&v);
   }
 
+  const auto initial_endpoints = data->viewer->initial_endpoints(rollouts);
+  const auto final_endpoints = data->viewer->final_endpoints(rollouts);
+
+  std::vector<const schedule::Viewer::View::Element*> elements;
+  elements.reserve(relevant.size());
+  for (const Route* route : routes)
   {
-    const auto initial_endpoints = _pimpl->data->viewer->initial_endpoints(
-      _pimpl->rollouts);
+    if (interrupter && interrupter())
+      return std::nullopt;
+
+    // The view was made for every route at once, so we only keep the parts
+    // that this route would have found on its own.
+    elements.clear();
+    for (const auto* v : relevant)
+    {
+      if (overlaps(*route, *v->route))
+        elements.push_back(v);
+    }
+
+    if (auto conflict = find_first_conflict(
+        data->profile, *route, elements, options, data->memo.get(),
+        interrupter))
+      return conflict;
 
-    const auto& initial_wp = route.trajectory().front();
+    const auto& initial_wp = route->trajectory().front();
     for (const auto& other : initial_endpoints)
     {
       const auto& ep = other.second;
       if (skip_participant(ep.participant(), ep.description()))
         continue;
 
-      if (route.map() != ep.map())
+      if (route->map() != ep.map())
         continue;
 
       const auto& other_wp = ep.waypoint();
@@ -529,12 +1265,13 @@ NegotiatingRouteValidator::find_conflict(const Route& route) const
         Eigen::Vector3d::Zero());
 
       if (const auto conflict = DetectConflict::between(
-          _pimpl->data->profile,
-          route.trajectory(),
-          route.check_dependencies(other.first, ep.plan_id(), ep.route_id()),
+          data->profile,
+          route->trajectory(),
+          route->check_dependencies(other.first, ep.plan_id(), ep.route_id()),
           ep.description().profile(),
           other_start,
-          nullptr))
+          nullptr,
+          options))
       {
         return Conflict{
           Dependency{
@@ -544,24 +1281,19 @@ NegotiatingRouteValidator::find_conflict(const Route& route) const
             other_start.index_after(conflict->time)
           },
           conflict->time,
-          std::make_shared<Route>(route.map(), std::move(other_start))
+          std::make_shared<Route>(route->map(), std::move(other_start))
         };
       }
     }
-  }
-
-  {
-    const auto final_endpoints = _pimpl->data->viewer->final_endpoints(
-      _pimpl->rollouts);
 
-    const auto& final_wp = route.trajectory().back();
+    const auto& final_wp = route->trajectory().back();
     for (const auto& other : final_endpoints)
     {
       const auto& ep = other.second;
       if (skip_participant(ep.participant(), ep.description()))
         continue;
 
-      if (route.map() != ep.map())
+      if (route->map() != ep.map())
         continue;
 
       const auto& other_wp = ep.waypoint();
@@ -580,12 +1312,13 @@ NegotiatingRouteValidator::find_conflict(const Route& route) const
         Eigen::Vector3d::Zero());
 
       if (const auto conflict = DetectConflict::between(
-          _pimpl->data->profile,
-          route.trajectory(),
-          route.check_dependencies(other.first, ep.plan_id(), ep.route_id()),
+          data->profile,
+          route->trajectory(),
+          route->check_dependencies(other.first, ep.plan_id(), ep.route_id()),
           ep.description().profile(),
           other_finish,
-          nullptr))
+          nullptr,
+          options))
       {
         return Conflict{
           Dependency{
@@ -595,7 +1328,7 @@ NegotiatingRouteValidator::find_conflict(const Route& route) const
             other_finish.index_after(conflict->time)
           },
           conflict->time,
-          std::make_shared<Route>(route.map(), std::move(other_finish))
+          std::make_shared<Route>(route->map(), std::move(other_finish))
         };
       }
     }
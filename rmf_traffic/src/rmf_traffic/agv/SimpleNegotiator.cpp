@@ -19,8 +19,15 @@
 #include <rmf_traffic/agv/Rollout.hpp>
 #include <rmf_traffic/agv/debug/debug_Negotiator.hpp>
 
+#include "../debug/internal_Trace.hpp"
+#include "../internal_Route.hpp"
+#include "internal_PlanExecutor.hpp"
+
+#include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <iostream>
+#include <mutex>
 
 namespace rmf_traffic {
 namespace agv {
@@ -42,6 +49,7 @@ public:
   Duration minimum_holding_time;
   std::optional<double> minimum_cost_threshold = DefaultMinCostThreshold;
   std::optional<double> maximum_cost_threshold = std::nullopt;
+  bool reuse_search_results = false;
 
   static ApprovalCallback& get_approval_cb(Options& options)
   {
@@ -163,6 +171,368 @@ Duration SimpleNegotiator::Options::minimum_holding_time() const
   return _pimpl->minimum_holding_time;
 }
 
+//==============================================================================
+auto SimpleNegotiator::Options::reuse_search_results(const bool value)
+-> Options&
+{
+  _pimpl->reuse_search_results = value;
+  return *this;
+}
+
+//==============================================================================
+bool SimpleNegotiator::Options::reuse_search_results() const
+{
+  return _pimpl->reuse_search_results;
+}
+
+namespace {
+//==============================================================================
+/// The itineraries that a planning attempt had to avoid. A planning attempt of
+/// a negotiator only depends on these (and on the schedule outside of the
+/// negotiation), so two attempts with the same constraints have the same
+/// outcome.
+struct SearchConstraint
+{
+  schedule::ParticipantId participant;
+
+  // True if this is an alternative that was offered during a rejection, false
+  // if it is a proposal on the negotiation table
+  bool alternative;
+
+  schedule::Itinerary itinerary;
+};
+
+using SearchConstraints = std::vector<SearchConstraint>;
+
+//==============================================================================
+SearchConstraints make_search_constraints(
+  const schedule::Negotiation::Table::Viewer& table_viewer,
+  const schedule::Negotiation::VersionedKeySequence& alternatives)
+{
+  SearchConstraints constraints;
+  for (const auto& p : table_viewer.base_proposals())
+    constraints.push_back({p.participant, false, p.itinerary});
+
+  for (const auto& key : alternatives)
+  {
+    constraints.push_back(
+      {
+        key.participant,
+        true,
+        table_viewer.alternatives().at(key.participant)->at(key.version)
+      });
+  }
+
+  std::sort(constraints.begin(), constraints.end(),
+    [](const SearchConstraint& a, const SearchConstraint& b)
+    {
+      if (a.participant != b.participant)
+        return a.participant < b.participant;
+
+      return a.alternative < b.alternative;
+    });
+
+  return constraints;
+}
+
+//==============================================================================
+// The route validators only look at the geometry of a route, so we do not
+// compare checkpoints or dependencies.
+bool same_route(const Route& a, const Route& b)
+{
+  if (!RouteData::same_map(a, b))
+    return false;
+
+  const auto& trajectory_a = a.trajectory();
+  const auto& trajectory_b = b.trajectory();
+  if (trajectory_a.size() != trajectory_b.size())
+    return false;
+
+  auto it_b = trajectory_b.begin();
+  for (const auto& wp_a : trajectory_a)
+  {
+    const auto& wp_b = *it_b;
+    ++it_b;
+
+    if (wp_a.time() != wp_b.time())
+      return false;
+
+    if (wp_a.position() != wp_b.position())
+      return false;
+
+    if (wp_a.velocity() != wp_b.velocity())
+      return false;
+  }
+
+  return true;
+}
+
+//==============================================================================
+bool same_constraints(const SearchConstraints& a, const SearchConstraints& b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    if (a[i].participant != b[i].participant)
+      return false;
+
+    if (a[i].alternative != b[i].alternative)
+      return false;
+
+    const auto& itinerary_a = a[i].itinerary;
+    const auto& itinerary_b = b[i].itinerary;
+    if (itinerary_a.size() != itinerary_b.size())
+      return false;
+
+    for (std::size_t j = 0; j < itinerary_a.size(); ++j)
+    {
+      if (!same_route(itinerary_a[j], itinerary_b[j]))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+//==============================================================================
+std::size_t hash_constraints(const SearchConstraints& constraints)
+{
+  std::size_t output = constraints.size();
+  const auto combine = [&output](const std::size_t value)
+    {
+      output ^= value + 0x9e3779b9 + (output << 6) + (output >> 2);
+    };
+
+  for (const auto& c : constraints)
+  {
+    combine(std::hash<schedule::ParticipantId>()(c.participant));
+    combine(c.alternative);
+    for (const auto& route : c.itinerary)
+    {
+      combine(RouteData::get(route).map.id());
+      combine(route.trajectory().size());
+      if (const auto* t = route.trajectory().start_time())
+        combine(t->time_since_epoch().count());
+
+      if (const auto* t = route.trajectory().finish_time())
+        combine(t->time_since_epoch().count());
+    }
+  }
+
+  return output;
+}
+
+//==============================================================================
+/// Passes every check along to another validator while counting the checks
+class CountingValidator : public RouteValidator
+{
+public:
+
+  CountingValidator(
+    rmf_utils::clone_ptr<RouteValidator> validator,
+    std::shared_ptr<std::atomic_size_t> counter)
+  : _validator(std::move(validator)),
+    _counter(std::move(counter))
+  {
+    // Do nothing
+  }
+
+  std::optional<Conflict> find_conflict(const Route& route) const final
+  {
+    ++(*_counter);
+    return _validator->find_conflict(route);
+  }
+
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options& options) const final
+  {
+    ++(*_counter);
+    return _validator->find_conflict(route, options);
+  }
+
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes) const final
+  {
+    ++(*_counter);
+    return _validator->find_conflicts(routes);
+  }
+
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options& options) const final
+  {
+    ++(*_counter);
+    return _validator->find_conflicts(routes, options);
+  }
+
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const final
+  {
+    ++(*_counter);
+    return _validator->find_conflict(route, options, interrupter);
+  }
+
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const final
+  {
+    ++(*_counter);
+    return _validator->find_conflicts(routes, options, interrupter);
+  }
+
+  std::optional<Identity> identity() const final
+  {
+    return _validator->identity();
+  }
+
+  std::unique_ptr<RouteValidator> clone() const final
+  {
+    return std::make_unique<CountingValidator>(*this);
+  }
+
+private:
+  rmf_utils::clone_ptr<RouteValidator> _validator;
+  std::shared_ptr<std::atomic_size_t> _counter;
+};
+
+//==============================================================================
+/// Accepts a route if any one of its validators accepts it. A search that uses
+/// this validator only respects the constraints that every validator has in
+/// common.
+class EitherValidator : public RouteValidator
+{
+public:
+
+  EitherValidator(std::vector<rmf_utils::clone_ptr<RouteValidator>> validators)
+  : _validators(std::move(validators))
+  {
+    // Do nothing
+  }
+
+  std::optional<Conflict> find_conflict(const Route& route) const final
+  {
+    std::optional<Conflict> conflict;
+    for (const auto& validator : _validators)
+    {
+      conflict = validator->find_conflict(route);
+      if (!conflict.has_value())
+        return std::nullopt;
+    }
+
+    return conflict;
+  }
+
+  std::unique_ptr<RouteValidator> clone() const final
+  {
+    return std::make_unique<EitherValidator>(*this);
+  }
+
+private:
+  std::vector<rmf_utils::clone_ptr<RouteValidator>> _validators;
+};
+
+//==============================================================================
+/// Adds up the statistics of every response of a negotiator
+class StatisticsTracker
+{
+public:
+
+  void add(const SimpleNegotiator::Statistics& stats)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _total += stats;
+  }
+
+  SimpleNegotiator::Statistics total() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _total;
+  }
+
+private:
+  mutable std::mutex _mutex;
+  SimpleNegotiator::Statistics _total;
+};
+
+//==============================================================================
+/// Remembers the outcomes of the planning attempts of a negotiator
+class SearchMemo
+{
+public:
+
+  struct Entry
+  {
+    SearchConstraints constraints;
+    std::shared_ptr<const Planner::Result> result;
+    double initial_cost_estimate;
+
+    /// The rollouts that were computed from this result, keyed by the
+    /// participant that was masked out for the rollout. A null rollout means
+    /// that no alternatives could be found. The rollouts are shared so that
+    /// reusing them does not copy their itineraries.
+    std::unordered_map<
+      schedule::ParticipantId,
+      std::shared_ptr<const schedule::Negotiation::Alternatives>> rollouts = {};
+  };
+
+  using EntryPtr = std::shared_ptr<Entry>;
+
+  EntryPtr find(const SearchConstraints& constraints, std::size_t hash) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto range = _entries.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      if (same_constraints(it->second->constraints, constraints))
+        return it->second;
+    }
+
+    return nullptr;
+  }
+
+  EntryPtr insert(std::size_t hash, Entry entry)
+  {
+    auto ptr = std::make_shared<Entry>(std::move(entry));
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.insert({hash, ptr});
+    return ptr;
+  }
+
+  const std::shared_ptr<const schedule::Negotiation::Alternatives>*
+  find_rollout(
+    const Entry& entry,
+    const schedule::ParticipantId masked) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = entry.rollouts.find(masked);
+    if (it == entry.rollouts.end())
+      return nullptr;
+
+    return &it->second;
+  }
+
+  void insert_rollout(
+    Entry& entry,
+    const schedule::ParticipantId masked,
+    std::shared_ptr<const schedule::Negotiation::Alternatives> rollout)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    entry.rollouts.insert({masked, std::move(rollout)});
+  }
+
+private:
+  mutable std::mutex _mutex;
+  std::unordered_multimap<std::size_t, EntryPtr> _entries;
+};
+
+} // anonymous namespace
+
 //==============================================================================
 class SimpleNegotiator::Implementation
 {
@@ -174,9 +544,94 @@ public:
   Planner::Options planner_options;
   std::shared_ptr<const Planner> planner;
   Options negotiator_options;
+  std::shared_ptr<SearchMemo> memo = std::make_shared<SearchMemo>();
+  std::shared_ptr<StatisticsTracker> statistics =
+    std::make_shared<StatisticsTracker>();
+
+  /// When this returns true, the response that is being worked on is no longer
+  /// wanted. This is only set on the copy of a negotiator that runs a
+  /// background response.
+  std::function<bool()> stop;
 
   bool debug_print = false;
 
+  /// Search for a plan, limiting its cost according to the negotiator options.
+  /// Returns the result along with its initial cost estimate.
+  std::pair<Planner::Result, double> search(
+    const Planner::Options& search_options) const
+  {
+    auto plan = planner->setup(starts, goal, search_options);
+
+    const double initial_cost_estimate = *plan.cost_estimate();
+    if (debug_print)
+    {
+      std::cout << "Initial cost estimate: " << initial_cost_estimate <<
+        std::endl;
+    }
+
+    const auto maximum_cost_leeway = negotiator_options.maximum_cost_leeway();
+    const auto minimum_cost_threshold =
+      negotiator_options.minimum_cost_threshold();
+    const auto maximum_cost_threshold =
+      negotiator_options.maximum_cost_threshold();
+
+    std::optional<double> cost_limit;
+    if (maximum_cost_leeway.has_value())
+    {
+      cost_limit = maximum_cost_leeway.value() * initial_cost_estimate;
+      if (minimum_cost_threshold.has_value())
+      {
+        cost_limit = std::max(
+          *minimum_cost_threshold + initial_cost_estimate, *cost_limit);
+      }
+    }
+
+    if (maximum_cost_threshold.has_value())
+    {
+      if (cost_limit.has_value())
+      {
+        cost_limit = std::min(
+          *cost_limit, *maximum_cost_threshold + initial_cost_estimate);
+      }
+      else
+      {
+        cost_limit = *maximum_cost_threshold + initial_cost_estimate;
+      }
+    }
+
+    plan.options().maximum_cost_estimate(cost_limit);
+
+    plan.resume();
+    return {std::move(plan), initial_cost_estimate};
+  }
+
+  /// Submit a plan through a responder
+  void submit(const Plan& plan, const ResponderPtr& responder)
+  {
+    Responder::ApprovalCallback responder_approval_cb;
+    auto options_approval_callback =
+      Options::Implementation::get_approval_cb(negotiator_options);
+    if (options_approval_callback)
+    {
+      responder_approval_cb = [
+        approval_cb = options_approval_callback,
+        approved_plan = plan
+        ]() -> Responder::UpdateVersion
+        {
+          return approval_cb(std::move(approved_plan));
+        };
+    }
+
+    if (debug_print)
+    {
+      std::cout << " >>>>> Submitting" << std::endl;
+    }
+    responder->submit(
+      assign_id->assign(),
+      plan.get_itinerary(),
+      responder_approval_cb);
+  }
+
   Implementation(
     schedule::Participant::AssignIDPtr assign_id_,
     std::vector<Planner::Start> starts_,
@@ -379,11 +834,64 @@ private:
 
 } // anonymous namespace
 
+//==============================================================================
+auto SimpleNegotiator::Statistics::operator+=(const Statistics& other)
+-> Statistics&
+{
+  responses += other.responses;
+  planning_attempts += other.planning_attempts;
+  reused_attempts += other.reused_attempts;
+  rollouts += other.rollouts;
+  expansions += other.expansions;
+  validator_checks += other.validator_checks;
+  batched_responses += other.batched_responses;
+  cancelled_responses += other.cancelled_responses;
+  time += other.time;
+  return *this;
+}
+
 //==============================================================================
 void SimpleNegotiator::respond(
   const schedule::Negotiation::Table::ViewerPtr& table_viewer,
   const ResponderPtr& responder)
 {
+  respond_with_statistics(table_viewer, responder);
+}
+
+//==============================================================================
+auto SimpleNegotiator::statistics() const -> Statistics
+{
+  return _pimpl->statistics->total();
+}
+
+//==============================================================================
+auto SimpleNegotiator::respond_with_statistics(
+  const schedule::Negotiation::Table::ViewerPtr& table_viewer,
+  const ResponderPtr& responder) -> Statistics
+{
+  RMF_TRAFFIC_TRACE("negotiation.respond");
+  const auto respond_start = std::chrono::steady_clock::now();
+  Statistics stats;
+  stats.responses = 1;
+
+  const auto expansions = std::make_shared<std::atomic_size_t>(0);
+  const auto validator_checks = std::make_shared<std::atomic_size_t>(0);
+  const auto finish = [&]() -> Statistics
+    {
+      stats.expansions = expansions->load();
+      stats.validator_checks = validator_checks->load();
+      stats.time = std::chrono::steady_clock::now() - respond_start;
+      _pimpl->statistics->add(stats);
+      return stats;
+    };
+
+  const auto counted = [&validator_checks](
+    const rmf_utils::clone_ptr<NegotiatingRouteValidator>& validator)
+    {
+      return rmf_utils::make_clone<CountingValidator>(
+        validator, validator_checks);
+    };
+
   const auto& profile =
     _pimpl->planner->get_configuration().vehicle_traits().profile();
   NegotiatingRouteValidator::Generator rv_generator(table_viewer, profile);
@@ -392,21 +900,29 @@ void SimpleNegotiator::respond(
 
   auto options = _pimpl->planner_options;
 
-  const auto maximum_cost_leeway =
-    _pimpl->negotiator_options.maximum_cost_leeway();
-  const auto max_alts = _pimpl->negotiator_options.maximum_alternatives();
+  const auto& stop = _pimpl->stop;
+  const auto stopped = [&stop]() { return stop && stop(); };
 
-  const auto minimum_cost_threshold =
-    _pimpl->negotiator_options.minimum_cost_threshold();
+  // The planner calls the interrupter once for each node that it expands, so
+  // we use it to count the expansions.
+  const auto counting_interrupter =
+    [expansions, stop, user_interrupter = options.interrupter()]()
+    {
+      ++(*expansions);
+      if (stop && stop())
+        return true;
 
-  const auto maximum_cost_threshold =
-    _pimpl->negotiator_options.maximum_cost_threshold();
+      return user_interrupter && user_interrupter();
+    };
+  options.interrupter(counting_interrupter);
+
+  const auto max_alts = _pimpl->negotiator_options.maximum_alternatives();
 
   std::deque<rmf_utils::clone_ptr<NegotiatingRouteValidator>> validators;
   validators.push_back(
     rmf_utils::make_clone<NegotiatingRouteValidator>(rv_generator.begin()));
 
-  rmf_utils::optional<schedule::Negotiation::Alternatives> alternatives;
+  std::shared_ptr<const schedule::Negotiation::Alternatives> alternatives;
   rmf_utils::optional<std::vector<schedule::ParticipantId>> best_blockers;
 
   if (_pimpl->debug_print)
@@ -417,10 +933,14 @@ void SimpleNegotiator::respond(
     std::cout << " ]" << std::endl;
   }
 
+  const bool reuse_search_results =
+    _pimpl->negotiator_options.reuse_search_results();
+
   AlternativesTracker tracker(rv_generator.alternative_sets());
 
   const auto interrupt_flag = _pimpl->planner_options.interrupt_flag();
-  while (!validators.empty() && !(interrupt_flag && *interrupt_flag))
+  while (!validators.empty() && !(interrupt_flag && *interrupt_flag)
+    && !stopped())
   {
     const auto validator = std::move(validators.front());
     validators.pop_front();
@@ -452,45 +972,57 @@ void SimpleNegotiator::respond(
       }
     }
 
-    options.validator(validator);
-    auto plan = _pimpl->planner->setup(_pimpl->starts, _pimpl->goal, options);
-    const double initial_cost_estimate = *plan.cost_estimate();
-    if (_pimpl->debug_print)
+    SearchMemo::EntryPtr memo_entry;
+    SearchConstraints constraints;
+    std::size_t constraints_hash = 0;
+    if (reuse_search_results)
     {
-      std::cout << "Initial cost estimate: " << initial_cost_estimate <<
-        std::endl;
+      constraints = make_search_constraints(
+        *table_viewer, validator->alternatives());
+      constraints_hash = hash_constraints(constraints);
+      memo_entry = _pimpl->memo->find(constraints, constraints_hash);
     }
 
-    std::optional<double> cost_limit;
-    if (maximum_cost_leeway.has_value())
+    if (!memo_entry)
     {
-      cost_limit = maximum_cost_leeway.value() * initial_cost_estimate;
-      if (minimum_cost_threshold.has_value())
+      ++stats.planning_attempts;
+      options.validator(counted(validator));
+      auto result = _pimpl->search(options);
+      if (reuse_search_results && !result.first.interrupted())
       {
-        cost_limit = std::max(
-          *minimum_cost_threshold + initial_cost_estimate, *cost_limit);
-      }
-    }
-
-    if (maximum_cost_threshold.has_value())
-    {
-      if (cost_limit.has_value())
-      {
-        cost_limit = std::min(
-          *cost_limit, *maximum_cost_threshold + initial_cost_estimate);
+        memo_entry = _pimpl->memo->insert(
+          constraints_hash,
+          {
+            std::move(constraints),
+            std::make_shared<Planner::Result>(std::move(result.first)),
+            result.second
+          });
       }
       else
       {
-        cost_limit = *maximum_cost_threshold + initial_cost_estimate;
+        memo_entry = std::make_shared<SearchMemo::Entry>(
+          SearchMemo::Entry{
+            {},
+            std::make_shared<Planner::Result>(std::move(result.first)),
+            result.second
+          });
       }
     }
+    else
+    {
+      ++stats.reused_attempts;
+      if (_pimpl->debug_print)
+        std::cout << "Reusing an earlier planning attempt" << std::endl;
+    }
 
-    plan.options().maximum_cost_estimate(cost_limit);
-
-    plan.resume();
+    const Planner::Result& plan = *memo_entry->result;
+    const double initial_cost_estimate = memo_entry->initial_cost_estimate;
 
     if (plan)
     {
+      if (stopped())
+        break;
+
       if (_pimpl->debug_print)
       {
         const double cost = plan->get_cost();
@@ -501,28 +1033,8 @@ void SimpleNegotiator::respond(
         print_itinerary(plan->get_itinerary());
       }
 
-      Responder::ApprovalCallback responder_approval_cb;
-      auto options_approval_callback =
-        Options::Implementation::get_approval_cb(_pimpl->negotiator_options);
-      if (options_approval_callback)
-      {
-        responder_approval_cb = [
-          approval_cb = options_approval_callback,
-          approved_plan = *plan
-          ]() -> Responder::UpdateVersion
-          {
-            return approval_cb(std::move(approved_plan));
-          };
-      }
-
-      if (_pimpl->debug_print)
-      {
-        std::cout << " >>>>> Submitting" << std::endl;
-      }
-      return responder->submit(
-        _pimpl->assign_id->assign(),
-        plan->get_itinerary(),
-        responder_approval_cb);
+      _pimpl->submit(*plan, responder);
+      return finish();
     }
 
     if (_pimpl->debug_print)
@@ -577,20 +1089,45 @@ void SimpleNegotiator::respond(
                 << parent_id << "] is a blocker" << std::endl;
     }
 
+    if (const auto* rollout =
+      _pimpl->memo->find_rollout(*memo_entry, parent_id))
+    {
+      alternatives = *rollout;
+      if (_pimpl->debug_print)
+      {
+        std::cout << "Reusing an earlier rollout" << std::endl;
+      }
+
+      continue;
+    }
+
+    ++stats.rollouts;
     validator->mask(parent_id);
-    options.interrupt_flag(nullptr);
-    options.validator(validator);
+
+    // The interrupt flag does not apply to rollouts, but a stopped response
+    // has no use for them.
+    options.interrupter(stop);
+    options.validator(counted(validator));
     const auto old_holding_time = options.minimum_holding_time();
     options.minimum_holding_time(std::chrono::seconds(5));
 
     Rollout rollout(plan);
     // TODO(MXG): Make the span configurable
-    alternatives = rollout.expand(
+    auto expanded = rollout.expand(
       parent_id, std::chrono::seconds(15), options, max_alts);
 
-    if (alternatives->empty())
+    using Alternatives = schedule::Negotiation::Alternatives;
+    if (expanded.empty())
+      alternatives = nullptr;
+    else
+      alternatives = std::make_shared<const Alternatives>(std::move(expanded));
+
+    // A rollout that was cut short must not be reused
+    if (reuse_search_results && !stopped())
+      _pimpl->memo->insert_rollout(*memo_entry, parent_id, alternatives);
+
+    if (!alternatives)
     {
-      alternatives = rmf_utils::nullopt;
       if (_pimpl->debug_print)
       {
         std::cout << "Could not roll out any alternatives" << std::endl;
@@ -614,17 +1151,29 @@ void SimpleNegotiator::respond(
       }
     }
 
-    options.interrupt_flag(interrupt_flag);
+    options.interrupter(counting_interrupter);
     options.minimum_holding_time(old_holding_time);
   }
 
+  if (stopped())
+  {
+    if (_pimpl->debug_print)
+    {
+      std::cout << " >>>>> Stopped without responding" << std::endl;
+    }
+
+    stats.cancelled_responses = 1;
+    return finish();
+  }
+
   if (alternatives)
   {
     if (_pimpl->debug_print)
     {
       std::cout << " >>>>> Rejecting" << std::endl;
     }
-    return responder->reject(*alternatives);
+    responder->reject(*alternatives);
+    return finish();
   }
 
   if (best_blockers)
@@ -633,7 +1182,8 @@ void SimpleNegotiator::respond(
     {
       std::cout << " >>>>> Forfeiting with blockers" << std::endl;
     }
-    return responder->forfeit(*best_blockers);
+    responder->forfeit(*best_blockers);
+    return finish();
   }
 
   if (_pimpl->debug_print)
@@ -643,6 +1193,231 @@ void SimpleNegotiator::respond(
 
   // This would be suspicious. How could the planning fail without any blockers?
   responder->forfeit({});
+  return finish();
+}
+
+//==============================================================================
+void SimpleNegotiator::respond_batch(const std::vector<Pending>& pending)
+{
+  respond_batch_with_statistics(pending);
+}
+
+//==============================================================================
+auto SimpleNegotiator::respond_batch_with_statistics(
+  const std::vector<Pending>& pending) -> Statistics
+{
+  Statistics stats;
+  if (pending.size() < 2)
+  {
+    // There is nothing to share between the tables
+    for (const auto& p : pending)
+      stats += respond_with_statistics(p.table_viewer, p.responder);
+
+    return stats;
+  }
+
+  const auto batch_start = std::chrono::steady_clock::now();
+  const auto expansions = std::make_shared<std::atomic_size_t>(0);
+  const auto validator_checks = std::make_shared<std::atomic_size_t>(0);
+
+  const auto& profile =
+    _pimpl->planner->get_configuration().vehicle_traits().profile();
+
+  std::vector<rmf_utils::clone_ptr<RouteValidator>> table_validators;
+  table_validators.reserve(pending.size());
+  for (const auto& p : pending)
+  {
+    NegotiatingRouteValidator::Generator rv_generator(p.table_viewer, profile);
+    table_validators.push_back(
+      rmf_utils::make_clone<CountingValidator>(
+        rmf_utils::make_clone<NegotiatingRouteValidator>(rv_generator.begin()),
+        validator_checks));
+  }
+
+  auto options = _pimpl->planner_options;
+  options.interrupter(
+    [expansions, user_interrupter = options.interrupter()]()
+    {
+      ++(*expansions);
+      return user_interrupter && user_interrupter();
+    });
+  options.validator(rmf_utils::make_clone<EitherValidator>(table_validators));
+
+  if (_pimpl->debug_print)
+  {
+    std::cout << "Searching for a plan to share between ["
+              << pending.size() << "] tables" << std::endl;
+  }
+
+  ++stats.planning_attempts;
+  const auto shared = _pimpl->search(options).first;
+
+  // Each bit tells whether the shared plan is valid for one of the tables
+  std::vector<bool> valid(pending.size(), false);
+  if (shared)
+  {
+    const auto& itinerary = shared->get_itinerary();
+    for (std::size_t i = 0; i < pending.size(); ++i)
+      valid[i] = !table_validators[i]->find_conflicts(itinerary).has_value();
+  }
+
+  for (std::size_t i = 0; i < pending.size(); ++i)
+  {
+    if (!valid[i])
+      continue;
+
+    _pimpl->submit(*shared, pending[i].responder);
+    ++stats.responses;
+    ++stats.batched_responses;
+  }
+
+  stats.expansions = expansions->load();
+  stats.validator_checks = validator_checks->load();
+  stats.time = std::chrono::steady_clock::now() - batch_start;
+  _pimpl->statistics->add(stats);
+
+  for (std::size_t i = 0; i < pending.size(); ++i)
+  {
+    if (valid[i])
+      continue;
+
+    const auto& p = pending[i];
+    stats += respond_with_statistics(p.table_viewer, p.responder);
+  }
+
+  return stats;
+}
+
+//==============================================================================
+class SimpleNegotiator::PendingResponse::Implementation
+{
+public:
+
+  struct Shared
+  {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<Statistics> statistics;
+    std::exception_ptr error;
+
+    std::atomic_bool cancelled = false;
+
+    bool done() const
+    {
+      return statistics.has_value() || error;
+    }
+  };
+
+  std::shared_ptr<Shared> shared;
+
+  static PendingResponse make(std::shared_ptr<Shared> shared)
+  {
+    PendingResponse pending;
+    pending._pimpl = rmf_utils::make_impl<Implementation>(
+      Implementation{std::move(shared)});
+    return pending;
+  }
+};
+
+//==============================================================================
+auto SimpleNegotiator::respond_async(
+  const schedule::Negotiation::Table::ViewerPtr& table_viewer,
+  const ResponderPtr& responder,
+  FinishedCallback on_finished,
+  std::shared_ptr<PlanExecutor> executor) const -> PendingResponse
+{
+  if (!executor)
+    executor = PlanExecutor::shared();
+
+  using Shared = PendingResponse::Implementation::Shared;
+  auto shared = std::make_shared<Shared>();
+
+  // The job gets its own copy of this negotiator so that it can be told when
+  // to stop without affecting any other responses.
+  SimpleNegotiator negotiator = *this;
+  negotiator._pimpl->stop = [shared, table_viewer]()
+    {
+      return shared->cancelled.load() || table_viewer->defunct();
+    };
+
+  PlanExecutor::Implementation::get(*executor).post(
+    [
+      negotiator = std::move(negotiator),
+      table_viewer,
+      responder,
+      on_finished = std::move(on_finished),
+      shared
+    ]() mutable
+    {
+      std::optional<Statistics> stats;
+      std::exception_ptr error;
+      try
+      {
+        stats = negotiator.respond_with_statistics(table_viewer, responder);
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->statistics = stats;
+        shared->error = error;
+      }
+      shared->cv.notify_all();
+
+      if (on_finished)
+        on_finished(PendingResponse::Implementation::make(shared));
+    });
+
+  return PendingResponse::Implementation::make(std::move(shared));
+}
+
+//==============================================================================
+bool SimpleNegotiator::PendingResponse::ready() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->shared->mutex);
+  return _pimpl->shared->done();
+}
+
+//==============================================================================
+bool SimpleNegotiator::PendingResponse::wait_for(const Duration timeout) const
+{
+  auto& shared = *_pimpl->shared;
+  std::unique_lock<std::mutex> lock(shared.mutex);
+  return shared.cv.wait_for(lock, timeout, [&]() { return shared.done(); });
+}
+
+//==============================================================================
+auto SimpleNegotiator::PendingResponse::get() const -> const Statistics&
+{
+  auto& shared = *_pimpl->shared;
+  std::unique_lock<std::mutex> lock(shared.mutex);
+  shared.cv.wait(lock, [&]() { return shared.done(); });
+
+  if (shared.error)
+    std::rethrow_exception(shared.error);
+
+  return *shared.statistics;
+}
+
+//==============================================================================
+void SimpleNegotiator::PendingResponse::cancel()
+{
+  _pimpl->shared->cancelled = true;
+}
+
+//==============================================================================
+bool SimpleNegotiator::PendingResponse::cancelled() const
+{
+  return _pimpl->shared->cancelled.load();
+}
+
+//==============================================================================
+SimpleNegotiator::PendingResponse::PendingResponse()
+{
+  // Do nothing
 }
 
 //==============================================================================
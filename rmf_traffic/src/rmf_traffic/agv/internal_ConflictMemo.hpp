@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__INTERNAL_CONFLICTMEMO_HPP
+#define SRC__RMF_TRAFFIC__AGV__INTERNAL_CONFLICTMEMO_HPP
+
+#include <rmf_traffic/DetectConflict.hpp>
+#include <rmf_traffic/Profile.hpp>
+
+#include "../TrajectoryInternal.hpp"
+
+#include <array>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+/// Remembers whether pairs of trajectories were found to be in conflict, so
+/// that the same pair does not need to go through the narrowphase again.
+///
+/// A trajectory is identified by its segment cache, which is shared by copies
+/// of the trajectory and replaced whenever the trajectory changes. Routes in a
+/// schedule or a negotiation are never modified, and a delay of a route gives
+/// it a new trajectory, so a remembered result stays valid for as long as the
+/// segment caches of both trajectories are alive.
+///
+/// Results can only be remembered for pairs that have no dependencies on each
+/// other. The memo is safe to use from several threads at once.
+class ConflictMemo
+{
+public:
+
+  /// The time of the first conflict, or a nullopt if there is no conflict
+  using Result = std::optional<Time>;
+
+  ConflictMemo(std::size_t capacity);
+
+  /// Get the result for this pair of trajectories if it is remembered.
+  std::optional<Result> find(
+    const Profile& profile_a,
+    const Trajectory& trajectory_a,
+    const Profile& profile_b,
+    const Trajectory& trajectory_b,
+    const DetectConflict::Options& options);
+
+  /// Remember the result for this pair of trajectories.
+  void insert(
+    const Profile& profile_a,
+    const Trajectory& trajectory_a,
+    const Profile& profile_b,
+    const Trajectory& trajectory_b,
+    const DetectConflict::Options& options,
+    Result result);
+
+  /// Get how many results are kept.
+  std::size_t capacity() const;
+
+  /// Get how many results are currently remembered.
+  std::size_t size() const;
+
+private:
+
+  struct Key
+  {
+    std::array<const internal::SegmentCache*, 2> trajectories;
+    std::array<const geometry::FinalConvexShape*, 4> shapes;
+    double tolerance;
+    std::size_t max_iterations;
+    DetectConflict::Options::Solver solver;
+    bool exact_time;
+
+    bool operator==(const Key& other) const;
+  };
+
+  struct Hash
+  {
+    std::size_t operator()(const Key& key) const;
+  };
+
+  struct Entry
+  {
+    Key key;
+
+    // The caches are only watched so that a result is not given to a new
+    // cache that happens to be allocated at the address of an old one.
+    std::array<std::weak_ptr<const internal::SegmentCache>, 2> trajectories;
+
+    // The shapes are kept alive for the same reason.
+    std::array<geometry::ConstFinalConvexShapePtr, 4> shapes;
+
+    Result result;
+  };
+
+  /// Make the key for a pair of trajectories, or a nullopt if either of them
+  /// cannot be checked for conflicts.
+  static std::optional<Key> make_key(
+    const Profile& profile_a,
+    const internal::SegmentCache* cache_a,
+    const Profile& profile_b,
+    const internal::SegmentCache* cache_b,
+    const DetectConflict::Options& options);
+
+  mutable std::mutex _mutex;
+  std::size_t _capacity;
+
+  // The most recently used entry is at the front
+  std::list<Entry> _entries;
+  std::unordered_map<Key, std::list<Entry>::iterator, Hash> _lookup;
+};
+
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__INTERNAL_CONFLICTMEMO_HPP
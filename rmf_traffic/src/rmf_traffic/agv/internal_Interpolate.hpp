@@ -96,6 +96,16 @@ bool interpolate_rotation(
   const Eigen::Vector3d& finish,
   const double threshold);
 
+//==============================================================================
+/// Append the interpolation of input_positions to the trajectory. The traits
+/// must already be known to be valid.
+void interpolate_positions(
+  Trajectory& trajectory,
+  const VehicleTraits& traits,
+  const Time start_time,
+  const std::vector<Eigen::Vector3d>& input_positions,
+  const Interpolate::Options::Implementation& options);
+
 } // namespace internal
 } // namespace agv
 } // namespace rmf_traffic
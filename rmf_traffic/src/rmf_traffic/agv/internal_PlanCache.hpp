@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__INTERNAL_PLANCACHE_HPP
+#define SRC__RMF_TRAFFIC__AGV__INTERNAL_PLANCACHE_HPP
+
+#include <rmf_traffic/agv/Planner.hpp>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <optional>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+/// Remembers the results of recent planning requests so that identical
+/// requests can be answered without searching again.
+///
+/// A request can only be remembered if everything that its result depends on
+/// can be compared, including the identity of its route validator. The cache
+/// is safe to use from several threads that are planning at once.
+class PlanCache
+{
+public:
+
+  using Eviction = Planner::CacheEviction;
+
+  /// Everything that the result of a planning request depends on
+  struct Key
+  {
+    struct Start
+    {
+      Time time;
+      std::size_t waypoint;
+      double orientation;
+      std::optional<Eigen::Vector2d> location;
+      std::optional<std::size_t> lane;
+
+      bool operator==(const Start& other) const;
+    };
+
+    std::vector<Start> starts;
+
+    std::size_t goal_waypoint;
+    std::optional<double> goal_orientation;
+    std::optional<Time> goal_minimum_time;
+
+    std::optional<RouteValidator::Identity> validator;
+    Duration min_hold_time;
+    std::optional<double> maximum_cost_estimate;
+    std::optional<std::size_t> saturation_limit;
+    std::optional<Duration> dependency_window;
+    Duration dependency_resolution;
+    double suboptimality_budget;
+
+    bool operator==(const Key& other) const;
+
+    /// Make the key for a request, or a nullopt if the result of the request
+    /// should not be remembered.
+    static std::optional<Key> make(
+      const std::vector<Planner::Start>& starts,
+      const Planner::Goal& goal,
+      const Planner::Options& options);
+  };
+
+  PlanCache() = default;
+
+  /// Copies of a planner begin with an empty cache of the same settings
+  PlanCache(const PlanCache& other)
+  : _capacity(other.get_capacity()),
+    _eviction(other.get_eviction())
+  {
+    // Do nothing
+  }
+
+  PlanCache& operator=(const PlanCache& other)
+  {
+    set_capacity(other.get_capacity());
+    set_eviction(other.get_eviction());
+    clear();
+    return *this;
+  }
+
+  /// Set how many results are kept. A capacity of 0 turns the cache off.
+  void set_capacity(std::size_t capacity);
+
+  /// Get how many results are kept.
+  std::size_t get_capacity() const;
+
+  /// Set which result is dropped when a new one does not fit.
+  void set_eviction(Eviction policy);
+
+  /// Get which result is dropped when a new one does not fit.
+  Eviction get_eviction() const;
+
+  /// Drop every result in the cache.
+  void clear();
+
+  /// Get a copy of the result for a request, or a nullopt if the cache does
+  /// not have one.
+  std::optional<Planner::Result> find(const Key& key);
+
+  /// Remember the result of a request.
+  void insert(Key key, const Planner::Result& result);
+
+private:
+
+  struct Entry
+  {
+    Key key;
+    std::shared_ptr<const Planner::Result> result;
+  };
+
+  mutable std::mutex _mutex;
+  std::atomic_size_t _capacity = 0;
+  std::atomic<Eviction> _eviction = Eviction::LeastRecentlyUsed;
+
+  // The newest entry is at the front. When the eviction policy is
+  // LeastRecentlyUsed, entries are moved to the front when they are used.
+  std::list<Entry> _entries;
+};
+
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__INTERNAL_PLANCACHE_HPP
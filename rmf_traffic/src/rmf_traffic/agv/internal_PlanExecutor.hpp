@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__INTERNAL_PLANEXECUTOR_HPP
+#define SRC__RMF_TRAFFIC__AGV__INTERNAL_PLANEXECUTOR_HPP
+
+#include <rmf_traffic/agv/PlanExecutor.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+namespace rmf_traffic {
+namespace agv {
+
+//==============================================================================
+class PlanExecutor::Implementation
+{
+public:
+
+  using Job = std::function<void()>;
+
+  Implementation(std::shared_ptr<Executor> executor);
+
+  /// Wait until every job that was posted has finished
+  ~Implementation();
+
+  /// Give a job to the executor
+  void post(Job job);
+
+  std::size_t queued() const;
+
+  Statistics statistics() const;
+
+  static Implementation& get(PlanExecutor& executor);
+
+private:
+
+  friend class PlanExecutor;
+
+  std::shared_ptr<Executor> _executor;
+  std::atomic_size_t _queued = 0;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _finished_cv;
+  std::size_t _unfinished = 0;
+  Statistics _statistics;
+};
+
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__INTERNAL_PLANEXECUTOR_HPP
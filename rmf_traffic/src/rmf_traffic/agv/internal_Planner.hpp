@@ -79,17 +79,35 @@ public:
   planning::State state;
   std::optional<Plan> plan;
 
+  // True if the plan came from the quick search of an anytime plan and has
+  // not been proven to be as good as the full search could find.
+  bool incumbent = false;
+
+  // The statistics of searches that ran before the search of the state, such
+  // as the quick search of an anytime plan.
+  Statistics earlier_statistics = Statistics();
+
+  /// Search for a plan. If the options have a deadline, then a plan will first
+  /// be found quickly, and it will be kept as the incumbent if the full search
+  /// cannot finish before the deadline.
+  void search();
+
+  /// The lowest cost that any plan for this state could have
+  double lower_bound() const;
+
   static Result generate(
     planning::InterfacePtr interface,
     const std::vector<Planner::Start>& starts,
     Planner::Goal goal,
-    Planner::Options options);
+    Planner::Options options,
+    const planning::State* previous = nullptr);
 
   static Result setup(
     planning::InterfacePtr interface,
     const std::vector<Planner::Start>& starts,
     Planner::Goal goal,
-    Planner::Options options);
+    Planner::Options options,
+    const planning::State* previous = nullptr);
 
   static const Implementation& get(const Result& r);
 
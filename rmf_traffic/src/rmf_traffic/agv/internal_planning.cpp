@@ -19,15 +19,197 @@
 
 #include "planning/DifferentialDrivePlanner.hpp"
 
+#include <future>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 namespace rmf_traffic {
 namespace agv {
 namespace planning {
 
+namespace {
+//==============================================================================
+bool same_limits(
+  const VehicleTraits::Limits& a,
+  const VehicleTraits::Limits& b)
+{
+  return a.get_nominal_velocity() == b.get_nominal_velocity()
+    && a.get_nominal_acceleration() == b.get_nominal_acceleration();
+}
+
+//==============================================================================
+bool same_traits(const VehicleTraits& a, const VehicleTraits& b)
+{
+  if (!same_limits(a.linear(), b.linear()))
+    return false;
+
+  if (!same_limits(a.rotational(), b.rotational()))
+    return false;
+
+  if (a.get_steering() != b.get_steering() || !(a.profile() == b.profile()))
+    return false;
+
+  const auto* diff_a = a.get_differential();
+  const auto* diff_b = b.get_differential();
+  if (diff_a && diff_b)
+  {
+    return diff_a->get_forward() == diff_b->get_forward()
+      && diff_a->is_reversible() == diff_b->is_reversible();
+  }
+
+  return !diff_a && !diff_b;
+}
+
+//==============================================================================
+bool same_interpolation(
+  const Interpolate::Options& a,
+  const Interpolate::Options& b)
+{
+  return a.always_stop() == b.always_stop()
+    && a.get_translation_threshold() == b.get_translation_threshold()
+    && a.get_rotation_threshold() == b.get_rotation_threshold()
+    && a.get_corner_angle_threshold() == b.get_corner_angle_threshold();
+}
+
+//==============================================================================
+/// Configurations whose shared graph is the same are checked by this. Graphs
+/// are only compared by identity, because comparing their contents would cost
+/// about as much as building a new supergraph.
+bool same_settings(
+  const Planner::Configuration& a,
+  const Planner::Configuration& b)
+{
+  return same_traits(a.vehicle_traits(), b.vehicle_traits())
+    && same_interpolation(a.interpolation(), b.interpolation())
+    && a.lane_closures() == b.lane_closures()
+    && a.traversal_cost_per_meter() == b.traversal_cost_per_meter()
+    && a.heuristic_cache_file() == b.heuristic_cache_file()
+    && a.heuristic_cache_budget() == b.heuristic_cache_budget()
+    && a.heuristic_cache_eviction() == b.heuristic_cache_eviction()
+    && a.eager_traversals() == b.eager_traversals()
+    && a.floor_hierarchy() == b.floor_hierarchy()
+    && a.contract_corridors() == b.contract_corridors()
+    && a.contraction_hierarchy() == b.contraction_hierarchy();
+}
+
+//==============================================================================
+class InterfaceRegistry
+{
+public:
+
+  static InterfaceRegistry& get()
+  {
+    static InterfaceRegistry registry;
+    return registry;
+  }
+
+  InterfacePtr intern(Planner::Configuration config)
+  {
+    const auto graph = shared_graph(config);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    prune();
+
+    auto& entries = _entries[graph.get()];
+    for (const auto& entry : entries)
+    {
+      if (!same_settings(entry.settings, config))
+        continue;
+
+      if (auto interface = entry.interface.lock())
+        return interface;
+
+      if (entry.building.valid())
+      {
+        // Another thread is already building this interface, so wait for it
+        // without blocking planners for any other configuration.
+        auto building = entry.building;
+        lock.unlock();
+        return building.get();
+      }
+    }
+
+    // The entry does not hold onto the graph. While it is being built, the
+    // graph is kept alive by config, and afterwards by the interface, so its
+    // address cannot be reused by a different graph while the entry matters.
+    std::promise<InterfacePtr> promise;
+    const auto entry = entries.insert(
+      entries.end(),
+      Entry{Planner::Configuration(config).graph(Graph()), {},
+        promise.get_future().share()});
+
+    // Building the supergraph can take a while for a large graph, so it is
+    // done without holding the lock.
+    lock.unlock();
+
+    InterfacePtr interface;
+    try
+    {
+      interface = std::make_shared<DifferentialDrivePlanner>(std::move(config));
+    }
+    catch (...)
+    {
+      lock.lock();
+      entries.erase(entry);
+      lock.unlock();
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+
+    lock.lock();
+    entry->interface = interface;
+    entry->building = {};
+    lock.unlock();
+
+    promise.set_value(interface);
+    return interface;
+  }
+
+private:
+
+  struct Entry
+  {
+    // The settings of the configuration with an empty graph in place of its
+    // own, since the graph is only compared by its address.
+    Planner::Configuration settings;
+    std::weak_ptr<const Interface> interface;
+
+    // Valid while the interface is still being built
+    std::shared_future<InterfacePtr> building;
+  };
+
+  void prune()
+  {
+    for (auto it = _entries.begin(); it != _entries.end(); )
+    {
+      auto& entries = it->second;
+      entries.remove_if([](const Entry& e)
+        {
+          return !e.building.valid() && e.interface.expired();
+        });
+
+      if (entries.empty())
+        it = _entries.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  std::mutex _mutex;
+
+  // A list is used so that an entry stays in place while its interface is
+  // being built without the lock.
+  std::unordered_map<const Graph::Implementation*, std::list<Entry>> _entries;
+};
+
+} // anonymous namespace
+
 //==============================================================================
 InterfacePtr make_planner_interface(Planner::Configuration config)
 {
   if (config.vehicle_traits().get_differential())
-    return std::make_shared<DifferentialDrivePlanner>(std::move(config));
+    return InterfaceRegistry::get().intern(std::move(config));
 
   throw std::runtime_error(
           "[rmf_traffic::agv::planning::make_planner_interface] The rmf_traffic "
@@ -21,8 +21,10 @@
 #include <rmf_traffic/agv/Planner.hpp>
 #include <rmf_traffic/agv/debug/debug_Planner.hpp>
 
+#include <istream>
 #include <memory>
 #include <mutex>
+#include <ostream>
 
 namespace rmf_traffic {
 namespace agv {
@@ -64,6 +66,8 @@ struct State
 
     virtual std::size_t expansion_count() const = 0;
 
+    virtual agv::Planner::Result::Statistics statistics() const = 0;
+
     virtual ~Internal() = default;
   };
 
@@ -90,6 +94,14 @@ public:
     agv::Planner::Goal goal,
     agv::Planner::Options options) const = 0;
 
+  /// Initiate a new search that may reuse the solution of a previous search
+  /// to the same goal.
+  virtual State reinitiate(
+    const State& previous,
+    const std::vector<agv::Planner::Start>& starts,
+    agv::Planner::Goal goal,
+    agv::Planner::Options options) const = 0;
+
   virtual std::optional<PlanData> plan(State& state) const = 0;
 
   virtual std::vector<schedule::Itinerary> rollout(
@@ -97,14 +109,50 @@ public:
     const Issues::BlockedNodes& nodes,
     const Planner::Goal& goal,
     const Planner::Options& options,
-    std::optional<std::size_t> max_rollouts) const = 0;
+    std::optional<std::size_t> max_rollouts,
+    std::optional<Time> deadline) const = 0;
 
   virtual std::optional<Planner::QuickestPath> quickest_path(
     const Planner::StartSet& start_vertices,
     std::size_t goal_vertex) const = 0;
 
+  virtual std::vector<std::vector<std::optional<Planner::QuickestPath>>>
+  quickest_path_matrix(
+    const std::vector<Planner::StartSet>& starts,
+    const std::vector<std::size_t>& goals,
+    std::size_t threads) const = 0;
+
   virtual const Planner::Configuration& get_configuration() const = 0;
 
+  /// Write the heuristic tables that have been computed so far
+  virtual void save_heuristic(std::ostream& output) const = 0;
+
+  /// Preload heuristic tables that were written by save_heuristic(). Returns
+  /// false if the tables are unreadable or belong to a different
+  /// configuration.
+  virtual bool load_heuristic(std::istream& input) const = 0;
+
+  /// Preload the tables of a heuristic journal that belong to this
+  /// configuration, and write a record of the tables that it is missing
+  virtual void sync_heuristic(
+    std::istream& journal,
+    std::ostream& output) const = 0;
+
+  /// Compute the heuristics from every waypoint to each of the goals
+  virtual void warm_heuristic(
+    const std::vector<std::size_t>& goals,
+    std::size_t threads) const = 0;
+
+  virtual Planner::HeuristicCacheStatistics heuristic_statistics() const = 0;
+
+  /// Get how much memory the caches of this interface are holding
+  virtual Planner::MemoryUsage memory_usage() const = 0;
+
+  /// Make an interface that only differs from this one by its lane closures.
+  /// Cached heuristics that cannot be affected by the change are carried over.
+  virtual std::shared_ptr<const Interface> with_closures(
+    LaneClosure closures) const = 0;
+
   class Debugger
   {
   public:
@@ -134,6 +182,17 @@ public:
 using InterfacePtr = std::shared_ptr<const Interface>;
 
 //==============================================================================
+/// Get the graph of a configuration without copying it. The graph is shared
+/// with the configuration and every copy of it, and must not be modified.
+std::shared_ptr<const Graph::Implementation> shared_graph(
+  const Planner::Configuration& config);
+
+//==============================================================================
+/// Get the planner interface for a configuration. Configurations that share
+/// the same graph and have identical vehicle traits, interpolation options,
+/// lane closures and cache settings will get the same interface for as long as
+/// a planner is still using it, so their supergraph and heuristic caches are
+/// shared instead of being built again for every planner.
 InterfacePtr make_planner_interface(Planner::Configuration config);
 
 } // namespace planning
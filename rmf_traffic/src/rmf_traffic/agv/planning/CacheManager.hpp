@@ -18,6 +18,9 @@
 #ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__CACHEMANAGER_HPP
 #define SRC__RMF_TRAFFIC__AGV__PLANNING__CACHEMANAGER_HPP
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <optional>
 #include <memory>
 #include <mutex>
@@ -25,6 +28,8 @@
 #include <unordered_map>
 #include <shared_mutex>
 #include <atomic>
+#include <cstdint>
+#include <vector>
 
 namespace rmf_traffic {
 namespace agv {
@@ -70,6 +75,194 @@ private:
   std::atomic_bool* _mutex = nullptr;
 };
 
+//==============================================================================
+/// A hash map that is split into shards which each have their own lock. Each
+/// operation only locks the shards that it touches, and only for as long as
+/// it needs them, so readers of one shard are never held up by writers of
+/// another shard, and no lock is held while new items are being generated.
+template<typename StorageArg>
+class ShardedStorage
+{
+public:
+
+  using Storage = StorageArg;
+  using Key = typename Storage::key_type;
+  using Value = typename Storage::mapped_type;
+
+  static constexpr std::size_t ShardCount = 16;
+
+  /// Constructor
+  ///
+  /// \param[in] storage_initializer
+  ///   Creates the storage of each shard. The hash function of that storage
+  ///   is also used to choose the shard of each key.
+  ShardedStorage(const std::function<Storage()>& storage_initializer)
+  {
+    for (auto& shard : _shards)
+      shard = std::make_unique<Shard>(storage_initializer());
+
+    _hash.emplace(_shards.front()->items.hash_function());
+  }
+
+  ShardedStorage(const ShardedStorage&) = delete;
+  ShardedStorage& operator=(const ShardedStorage&) = delete;
+
+  /// Get a copy of the item with this key, or nullopt if it is not stored
+  std::optional<Value> find(const Key& key) const
+  {
+    const auto& shard = _shard_of(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    const auto it = shard.items.find(key);
+    if (it == shard.items.end())
+      return std::nullopt;
+
+    return it->second;
+  }
+
+  /// Get the number of items that are stored
+  std::size_t size() const
+  {
+    std::size_t output = 0;
+    for (const auto& shard : _shards)
+    {
+      std::shared_lock<std::shared_mutex> lock(shard->mutex);
+      output += shard->items.size();
+    }
+
+    return output;
+  }
+
+  /// Get the bytes of the shards and the bucket arrays of their hash tables.
+  /// The items themselves are not counted.
+  std::size_t table_bytes() const
+  {
+    std::size_t output = 0;
+    for (const auto& shard : _shards)
+    {
+      std::shared_lock<std::shared_mutex> lock(shard->mutex);
+      output += sizeof(Shard) + shard->items.bucket_count()*sizeof(void*);
+    }
+
+    return output;
+  }
+
+  /// Get a copy of every item. Items that get inserted while the copy is being
+  /// made may or may not be included.
+  Storage snapshot(Storage output) const
+  {
+    for (const auto& shard : _shards)
+    {
+      std::shared_lock<std::shared_mutex> lock(shard->mutex);
+      output.insert(shard->items.begin(), shard->items.end());
+    }
+
+    return output;
+  }
+
+  /// Insert items, locking each shard once.
+  ///
+  /// \param[in] assign
+  ///   If true, the new items will replace stored items with the same key.
+  ///
+  /// \param[in] on_merge
+  ///   Called as on_merge(key, old_value, new_value) for each item that is
+  ///   inserted or assigned, while the lock of its shard is still held.
+  ///   old_value is nullptr if the key was not stored yet.
+  template<typename F>
+  void merge(Storage items, const bool assign, F&& on_merge)
+  {
+    std::array<std::vector<typename Storage::iterator>, ShardCount> sorted;
+    for (auto it = items.begin(); it != items.end(); ++it)
+      sorted[_index_of(it->first)].push_back(it);
+
+    for (std::size_t i = 0; i < ShardCount; ++i)
+    {
+      if (sorted[i].empty())
+        continue;
+
+      auto& shard = *_shards[i];
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+      for (const auto& item : sorted[i])
+      {
+        const auto it = shard.items.find(item->first);
+        if (it == shard.items.end())
+        {
+          on_merge(item->first, nullptr, item->second);
+          shard.items.insert({item->first, std::move(item->second)});
+        }
+        else if (assign)
+        {
+          on_merge(item->first, &it->second, item->second);
+          it->second = std::move(item->second);
+        }
+      }
+    }
+  }
+
+  /// Erase every item whose key satisfies the predicate, locking each shard
+  /// once.
+  template<typename P>
+  void erase_if(P&& predicate)
+  {
+    for (auto& shard : _shards)
+    {
+      std::unique_lock<std::shared_mutex> lock(shard->mutex);
+      for (auto it = shard->items.begin(); it != shard->items.end(); )
+      {
+        if (predicate(it->first))
+          it = shard->items.erase(it);
+        else
+          ++it;
+      }
+    }
+  }
+
+  /// Call f(key, value) for each item while its shard is locked for reading
+  template<typename F>
+  void for_each(F&& f) const
+  {
+    for (const auto& shard : _shards)
+    {
+      std::shared_lock<std::shared_mutex> lock(shard->mutex);
+      for (const auto& [key, value] : shard->items)
+        f(key, value);
+    }
+  }
+
+private:
+
+  struct Shard
+  {
+    Shard(Storage items_)
+    : items(std::move(items_))
+    {
+      // Do nothing
+    }
+
+    mutable std::shared_mutex mutex;
+    Storage items;
+  };
+
+  std::size_t _index_of(const Key& key) const
+  {
+    // The low bits of some of our hashes are waypoint or lane indices, so we
+    // mix the bits before choosing a shard.
+    std::size_t h = (*_hash)(key);
+    h ^= h >> 17;
+    h *= 0xed5ad4bbu;
+    h ^= h >> 11;
+    return h % ShardCount;
+  }
+
+  const Shard& _shard_of(const Key& key) const
+  {
+    return *_shards[_index_of(key)];
+  }
+
+  std::array<std::unique_ptr<Shard>, ShardCount> _shards;
+  std::optional<typename Storage::hasher> _hash;
+};
+
 //==============================================================================
 template<typename StorageArg>
 class Generator
@@ -79,10 +272,11 @@ public:
   using Storage = StorageArg;
   using Key = typename Storage::key_type;
   using Value = typename Storage::mapped_type;
+  using OldItems = ShardedStorage<Storage>;
 
   virtual Value generate(
     const Key& key,
-    const Storage& old_items,
+    const OldItems& old_items,
     Storage& new_items) const = 0;
 
   virtual ~Generator() = default;
@@ -104,6 +298,70 @@ public:
   virtual ~Factory() = default;
 };
 
+//==============================================================================
+/// How a cache with a memory budget chooses what to discard
+enum class EvictionPolicy
+{
+  /// Discard the group that was used least recently
+  LeastRecentlyUsed,
+
+  /// Discard the group that took the least time to generate for each byte
+  /// that it uses
+  CheapestToRecompute
+};
+
+//==============================================================================
+/// Statistics about the usage of a cache
+struct CacheStatistics
+{
+  /// The number of items that are stored
+  std::size_t entries = 0;
+
+  /// An estimate of how many bytes the stored items use
+  std::size_t bytes = 0;
+
+  /// How many requests were answered by a stored item
+  std::size_t hits = 0;
+
+  /// How many requests needed to generate a new item
+  std::size_t misses = 0;
+
+  /// How many groups of items have been discarded to stay within the budget
+  std::size_t evictions = 0;
+
+  /// The total time spent generating the items that are stored, in seconds
+  double compute_time = 0.0;
+
+  CacheStatistics& operator+=(const CacheStatistics& other)
+  {
+    entries += other.entries;
+    bytes += other.bytes;
+    hits += other.hits;
+    misses += other.misses;
+    evictions += other.evictions;
+    compute_time += other.compute_time;
+    return *this;
+  }
+};
+
+//==============================================================================
+/// How much memory a cache is holding
+struct CacheMemory
+{
+  /// The number of items that are stored
+  std::size_t entries = 0;
+
+  /// The bytes of the stored items and of the tables that hold them
+  std::size_t bytes = 0;
+
+  CacheMemory& operator+=(const CacheMemory& other)
+  {
+    entries += other.entries;
+    bytes += other.bytes;
+    return *this;
+  }
+};
+
 //==============================================================================
 template<typename GeneratorArg>
 class Upstream
@@ -112,20 +370,194 @@ public:
 
   using Generator = GeneratorArg;
   using Storage = typename Generator::Storage;
+  using Key = typename Storage::key_type;
+  using Value = typename Storage::mapped_type;
 
   Upstream(
     std::function<Storage()> storage_initializer,
     std::shared_ptr<const Generator> generator_)
-  : storage(storage_initializer()),
+  : storage(storage_initializer),
     generator(std::move(generator_))
   {
     // Do nothing
   }
 
-  std::atomic_bool read_blocker = false;
-  std::shared_mutex storage_mutex;
-  Storage storage;
+  /// Items are evicted in groups. Each group remembers how much it is using
+  /// and how much it cost to generate.
+  struct Group
+  {
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+    double compute_time = 0.0;
+
+    std::uint64_t last_used = 0;
+  };
+
+  /// Estimate the bytes used by one stored item
+  std::size_t bytes_of(const Key& key, const Value& value) const
+  {
+    if (entry_bytes)
+      return entry_bytes(key, value);
+
+    // The nodes of std::unordered_map hold the item and a pointer to the next
+    // node, and the buckets hold one more pointer.
+    return sizeof(typename Storage::value_type) + 2*sizeof(void*);
+  }
+
+  std::size_t group_of(const Key& key) const
+  {
+    return grouping ? grouping(key) : 0;
+  }
+
+  /// Mark that a group has been used. This is skipped if another thread is
+  /// using the accounting, so the recency is only approximate, but a lookup
+  /// never has to wait for it.
+  void touch(const Key& key)
+  {
+    if (!tracking_usage.load(std::memory_order_relaxed))
+      return;
+
+    std::unique_lock<std::mutex> lock(accounting_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+      return;
+
+    const auto it = groups.find(group_of(key));
+    if (it != groups.end())
+      it->second.last_used = ++clock;
+  }
+
+  /// Insert new items and enforce the budget
+  ///
+  /// \param[in] assign
+  ///   If true, the new items will replace existing items with the same key.
+  void store(
+    Storage items,
+    const std::optional<Key>& requested,
+    const double compute_time,
+    const bool assign)
+  {
+    std::lock_guard<std::mutex> lock(accounting_mutex);
+    const auto tick = ++clock;
+    storage.merge(
+      std::move(items), assign,
+      [&](const Key& key, const Value* old_value, const Value& new_value)
+      {
+        auto& group = groups[group_of(key)];
+        group.last_used = tick;
+        if (old_value)
+        {
+          const std::size_t old = bytes_of(key, *old_value);
+          group.bytes -= old;
+          total_bytes -= old;
+        }
+        else
+        {
+          ++group.entries;
+        }
+
+        const std::size_t bytes = bytes_of(key, new_value);
+        group.bytes += bytes;
+        total_bytes += bytes;
+      });
+
+    std::optional<std::size_t> keep;
+    if (requested.has_value())
+    {
+      keep = group_of(*requested);
+      auto& group = groups[*keep];
+      group.compute_time += compute_time;
+      group.last_used = tick;
+    }
+
+    enforce_budget(keep);
+  }
+
+  /// Recount every group after the grouping or the size estimate has changed.
+  /// The accounting mutex must be held.
+  void regroup()
+  {
+    groups.clear();
+    total_bytes = 0;
+    const auto tick = ++clock;
+    storage.for_each(
+      [&](const Key& key, const Value& value)
+      {
+        const std::size_t bytes = bytes_of(key, value);
+        auto& group = groups[group_of(key)];
+        ++group.entries;
+        group.bytes += bytes;
+        group.last_used = tick;
+        total_bytes += bytes;
+      });
+  }
+
+  /// Discard whole groups until the storage fits inside the budget. The group
+  /// named by keep will never be discarded. The accounting mutex must be held.
+  void enforce_budget(const std::optional<std::size_t> keep)
+  {
+    if (!budget.has_value() || total_bytes <= *budget)
+      return;
+
+    std::unordered_map<std::size_t, bool> evict;
+    std::size_t remaining = total_bytes;
+    while (remaining > *budget)
+    {
+      std::optional<std::size_t> victim;
+      double victim_score = 0.0;
+      for (const auto& [id, group] : groups)
+      {
+        if (id == keep || evict.count(id))
+          continue;
+
+        const double score = policy == EvictionPolicy::LeastRecentlyUsed ?
+          static_cast<double>(group.last_used) :
+          group.compute_time / std::max<std::size_t>(group.bytes, 1);
+
+        if (!victim.has_value() || score < victim_score)
+        {
+          victim = id;
+          victim_score = score;
+        }
+      }
+
+      // If only the group that was just used is left, then we keep it even
+      // though it is too big for the budget on its own. Discarding it would
+      // only force the same items to be generated again.
+      if (!victim.has_value())
+        break;
+
+      evict[*victim] = true;
+      remaining -= std::min(remaining, groups.at(*victim).bytes);
+    }
+
+    storage.erase_if(
+      [&](const Key& key) { return evict.count(group_of(key)) > 0; });
+
+    for (const auto& [id, _] : evict)
+    {
+      total_bytes -= std::min(total_bytes, groups.at(id).bytes);
+      groups.erase(id);
+      ++evictions;
+    }
+  }
+
+  ShardedStorage<Storage> storage;
   const std::shared_ptr<const Generator> generator;
+
+  // The fields below are guarded by the accounting mutex, except for the
+  // atomic fields.
+  std::mutex accounting_mutex;
+  std::atomic_bool tracking_usage = false;
+  std::function<std::size_t(const Key&)> grouping;
+  std::function<std::size_t(const Key&, const Value&)> entry_bytes;
+  std::optional<std::size_t> budget;
+  EvictionPolicy policy = EvictionPolicy::LeastRecentlyUsed;
+  std::unordered_map<std::size_t, Group> groups;
+  std::size_t total_bytes = 0;
+  std::size_t evictions = 0;
+  std::uint64_t clock = 0;
+  std::atomic_size_t hits = 0;
+  std::atomic_size_t misses = 0;
 };
 
 //==============================================================================
@@ -152,7 +584,13 @@ public:
   using Key = typename Storage::key_type;
   using Value = typename Storage::mapped_type;
 
-  Value get(const Key& key) const;
+  /// Get the value of a key, generating it if needed. If lookups is not a
+  /// nullptr, this lookup will be counted in its hits or misses, and the time
+  /// spent generating will be added to its compute_time.
+  Value get(const Key& key, CacheStatistics* lookups = nullptr) const;
+
+  /// Get the generator that produces the items of this cache
+  const std::shared_ptr<const Generator>& generator() const;
 
 private:
   std::shared_ptr<Upstream_type> _upstream;
@@ -180,6 +618,44 @@ public:
 
   const std::shared_ptr<const Generator>& inner() const;
 
+  /// Get a copy of every item that has been stored so far
+  Storage snapshot() const;
+
+  /// Insert items that were generated somewhere else, e.g. by an earlier run
+  /// of the same program. Items that are already stored will be kept.
+  void preload(Storage items) const;
+
+  using Key = typename Storage::key_type;
+  using Value = typename Storage::mapped_type;
+
+  /// Choose how stored items are grouped together. When the cache goes over
+  /// its budget, whole groups are discarded at once. By default every item is
+  /// in the same group.
+  ///
+  /// \param[in] grouping
+  ///   Get the group of an item from its key
+  ///
+  /// \param[in] entry_bytes
+  ///   Estimate how many bytes an item uses. If this is null, only the size of
+  ///   the key and value types themselves will be counted.
+  void set_grouping(
+    std::function<std::size_t(const Key&)> grouping,
+    std::function<std::size_t(const Key&, const Value&)> entry_bytes =
+    nullptr) const;
+
+  /// Limit how many bytes the stored items may use. A nullopt budget, which
+  /// is the default, lets the cache grow without limit.
+  void set_budget(
+    std::optional<std::size_t> bytes,
+    EvictionPolicy policy = EvictionPolicy::LeastRecentlyUsed) const;
+
+  /// Get statistics about how this cache has been used
+  CacheStatistics statistics() const;
+
+  /// Get how much memory this cache is holding. This uses the same size
+  /// estimate of each item as the budget, plus the tables of the storage.
+  CacheMemory memory_usage() const;
+
 private:
 
   CacheManager(
@@ -214,13 +690,42 @@ public:
 
   CacheManagerPtr get(std::size_t goal_index) const;
 
+  /// Get every manager that has been created so far, along with the goal
+  /// index that it was created for.
+  std::vector<std::pair<std::size_t, CacheManagerPtr>> managers() const;
+
+  /// Limit how many bytes the managers of this map may use altogether. When
+  /// the managers go over the budget, the managers of whole goals will be
+  /// discarded, except for the goal that is being requested. A nullopt
+  /// budget, which is the default, lets the map grow without limit.
+  void set_budget(
+    std::optional<std::size_t> bytes,
+    EvictionPolicy policy = EvictionPolicy::LeastRecentlyUsed) const;
+
+  /// Get statistics about how the managers of this map have been used,
+  /// including the managers that have been discarded.
+  CacheStatistics statistics() const;
+
+  /// Get how much memory the managers of this map are holding
+  CacheMemory memory_usage() const;
+
 private:
+
+  /// Discard managers until the map fits inside its budget. The map mutex must
+  /// be held.
+  void _enforce_budget(std::size_t keep) const;
+
   // NOTE(MXG): We take some significant liberties with mutability here because
   // this cache manager is always logically const, even as its physical state is
   // changing significantly. Besides memoizing the results of previous
   // computations, the cache manager does not actually have any internal state.
   mutable std::unordered_map<std::size_t, CacheManagerPtr> _managers;
   mutable std::atomic_bool _map_mutex = false;
+  mutable std::unordered_map<std::size_t, std::uint64_t> _last_used;
+  mutable std::uint64_t _clock = 0;
+  mutable std::optional<std::size_t> _budget;
+  mutable EvictionPolicy _policy = EvictionPolicy::LeastRecentlyUsed;
+  mutable CacheStatistics _discarded;
   const std::shared_ptr<const GeneratorFactory> _generator_factory;
   const std::function<Storage()> _storage_initializer;
 };
@@ -238,46 +743,50 @@ Cache<GeneratorArg>::Cache(
 
 //==============================================================================
 template<typename GeneratorArg>
-auto Cache<GeneratorArg>::get(const Key& key) const -> Value
+auto Cache<GeneratorArg>::get(
+  const Key& key,
+  CacheStatistics* lookups) const -> Value
 {
+  const auto& all_items = _upstream->storage;
+  if (auto value = all_items.find(key))
   {
-    // Check if the read blocker is up to avoid starving the writers
-    SpinLock wait_for_writers(_upstream->read_blocker);
-  }
+    ++_upstream->hits;
+    if (lookups)
+      ++lookups->hits;
 
-  std::shared_lock<std::shared_mutex> read_lock(
-    _upstream->storage_mutex, std::defer_lock);
-  while (!read_lock.try_lock())
-  {
-    // Just spin
+    _upstream->touch(key);
+    return *std::move(value);
   }
 
-  const auto& all_items = _upstream->storage;
-  const auto it = all_items.find(key);
-  if (it != all_items.end())
-    return it->second;
-
+  // No lock is held while the new items are generated, so other threads can
+  // keep reading and recording items in the meantime.
+  ++_upstream->misses;
   Storage new_items = _storage_initializer();
+  const auto start_time = std::chrono::steady_clock::now();
   auto result = _upstream->generator->generate(key, all_items, new_items);
+  const double compute_time = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start_time).count();
 
-  read_lock.unlock();
-
-  // Record the new items into the upstream storage
-  SpinLock lock_out_readers(_upstream->read_blocker);
-  std::unique_lock<std::shared_mutex> write_lock(
-    _upstream->storage_mutex, std::defer_lock);
-  while (!write_lock.try_lock())
+  if (lookups)
   {
-    // Just spin
+    ++lookups->misses;
+    lookups->compute_time += compute_time;
   }
 
-  auto& storage = _upstream->storage;
-  for (auto&& item : new_items)
-    storage[item.first] = std::move(item.second);
+  // Record the new items into the upstream storage
+  _upstream->store(std::move(new_items), key, compute_time, true);
 
   return result;
 }
 
+//==============================================================================
+template<typename GeneratorArg>
+auto Cache<GeneratorArg>::generator() const
+-> const std::shared_ptr<const Generator>&
+{
+  return _upstream->generator;
+}
+
 //==============================================================================
 template<typename CacheArg>
 CacheManager<CacheArg>::CacheManager(
@@ -305,6 +814,75 @@ CacheManager<CacheArg>::inner() const
   return _upstream->generator;
 }
 
+//==============================================================================
+template<typename CacheArg>
+auto CacheManager<CacheArg>::snapshot() const -> Storage
+{
+  return _upstream->storage.snapshot(_storage_initializer());
+}
+
+//==============================================================================
+template<typename CacheArg>
+void CacheManager<CacheArg>::preload(Storage items) const
+{
+  _upstream->store(std::move(items), std::nullopt, 0.0, false);
+}
+
+//==============================================================================
+template<typename CacheArg>
+void CacheManager<CacheArg>::set_grouping(
+  std::function<std::size_t(const Key&)> grouping,
+  std::function<std::size_t(const Key&, const Value&)> entry_bytes) const
+{
+  std::lock_guard<std::mutex> lock(_upstream->accounting_mutex);
+  _upstream->grouping = std::move(grouping);
+  _upstream->entry_bytes = std::move(entry_bytes);
+  _upstream->tracking_usage = static_cast<bool>(_upstream->grouping);
+  _upstream->regroup();
+}
+
+//==============================================================================
+template<typename CacheArg>
+void CacheManager<CacheArg>::set_budget(
+  const std::optional<std::size_t> bytes,
+  const EvictionPolicy policy) const
+{
+  std::lock_guard<std::mutex> lock(_upstream->accounting_mutex);
+  _upstream->budget = bytes;
+  _upstream->policy = policy;
+  _upstream->enforce_budget(std::nullopt);
+}
+
+//==============================================================================
+template<typename CacheArg>
+CacheStatistics CacheManager<CacheArg>::statistics() const
+{
+  std::lock_guard<std::mutex> lock(_upstream->accounting_mutex);
+  CacheStatistics output;
+  output.entries = _upstream->storage.size();
+  output.bytes = _upstream->total_bytes;
+  output.hits = _upstream->hits.load();
+  output.misses = _upstream->misses.load();
+  output.evictions = _upstream->evictions;
+  for (const auto& [_, group] : _upstream->groups)
+    output.compute_time += group.compute_time;
+
+  return output;
+}
+
+//==============================================================================
+template<typename CacheArg>
+CacheMemory CacheManager<CacheArg>::memory_usage() const
+{
+  std::lock_guard<std::mutex> lock(_upstream->accounting_mutex);
+  CacheMemory output;
+  output.entries = _upstream->storage.size();
+  output.bytes = sizeof(Upstream_type) + _upstream->total_bytes
+    + _upstream->storage.table_bytes();
+
+  return output;
+}
+
 //==============================================================================
 template<typename CacheArg>
 CacheManagerMap<CacheArg>::CacheManagerMap(
@@ -323,17 +901,113 @@ auto CacheManagerMap<CacheArg>::get(std::size_t goal_index) const
 {
   SpinLock lock(_map_mutex);
   const auto it = _managers.insert({goal_index, nullptr});
-  auto& manager = it.first->second;
+  auto manager = it.first->second;
   if (manager == nullptr)
   {
     manager = CacheManager_type::make(
       _generator_factory->make(goal_index),
       _storage_initializer);
+    it.first->second = manager;
   }
 
+  _last_used[goal_index] = ++_clock;
+  if (_budget.has_value())
+    _enforce_budget(goal_index);
+
   return manager;
 }
 
+//==============================================================================
+template<typename CacheArg>
+auto CacheManagerMap<CacheArg>::managers() const
+-> std::vector<std::pair<std::size_t, CacheManagerPtr>>
+{
+  SpinLock lock(_map_mutex);
+  return {_managers.begin(), _managers.end()};
+}
+
+//==============================================================================
+template<typename CacheArg>
+void CacheManagerMap<CacheArg>::set_budget(
+  const std::optional<std::size_t> bytes,
+  const EvictionPolicy policy) const
+{
+  SpinLock lock(_map_mutex);
+  _budget = bytes;
+  _policy = policy;
+}
+
+//==============================================================================
+template<typename CacheArg>
+CacheStatistics CacheManagerMap<CacheArg>::statistics() const
+{
+  SpinLock lock(_map_mutex);
+  CacheStatistics output = _discarded;
+  for (const auto& [_, manager] : _managers)
+    output += manager->statistics();
+
+  return output;
+}
+
+//==============================================================================
+template<typename CacheArg>
+CacheMemory CacheManagerMap<CacheArg>::memory_usage() const
+{
+  SpinLock lock(_map_mutex);
+  CacheMemory output;
+  for (const auto& [_, manager] : _managers)
+    output += manager->memory_usage();
+
+  return output;
+}
+
+//==============================================================================
+template<typename CacheArg>
+void CacheManagerMap<CacheArg>::_enforce_budget(const std::size_t keep) const
+{
+  std::unordered_map<std::size_t, CacheStatistics> stats;
+  std::size_t total = 0;
+  for (const auto& [goal, manager] : _managers)
+  {
+    const auto& s = stats.insert({goal, manager->statistics()}).first->second;
+    total += s.bytes;
+  }
+
+  while (total > *_budget)
+  {
+    std::optional<std::size_t> victim;
+    double victim_score = 0.0;
+    for (const auto& [goal, s] : stats)
+    {
+      if (goal == keep)
+        continue;
+
+      const double score = _policy == EvictionPolicy::LeastRecentlyUsed ?
+        static_cast<double>(_last_used[goal]) :
+        s.compute_time / std::max<std::size_t>(s.bytes, 1);
+
+      if (!victim.has_value() || score < victim_score)
+      {
+        victim = goal;
+        victim_score = score;
+      }
+    }
+
+    if (!victim.has_value())
+      return;
+
+    const auto& s = stats.at(*victim);
+    total -= std::min(total, s.bytes);
+    _discarded.hits += s.hits;
+    _discarded.misses += s.misses;
+    _discarded.evictions += s.evictions + 1;
+
+    _managers.erase(*victim);
+    _last_used.erase(*victim);
+    stats.erase(*victim);
+  }
+}
+
 } // namespace planning
 } // namespace agv
 } // namespace rmf_traffic
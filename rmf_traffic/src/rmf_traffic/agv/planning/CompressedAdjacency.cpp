@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "CompressedAdjacency.hpp"
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+CompressedAdjacency::CompressedAdjacency(
+  const Graph::Implementation& graph,
+  const LaneClosure& closures,
+  const double max_speed,
+  const Direction direction)
+{
+  const bool forward = direction == Direction::Forward;
+  const auto& lanes_of = forward ? graph.lanes_from : graph.lanes_into;
+  const std::size_t N = graph.waypoints.size();
+
+  _offsets.reserve(N + 1);
+  _offsets.push_back(0);
+  _edges.reserve(graph.lanes.size());
+  for (std::size_t wp = 0; wp < N; ++wp)
+  {
+    const auto& p_0 = graph.waypoints[wp].get_location();
+    for (const auto l : lanes_of[wp])
+    {
+      if (closures.is_closed(l))
+        continue;
+
+      const auto& lane = graph.lanes[l];
+      const std::size_t target = forward ?
+        lane.exit().waypoint_index() : lane.entry().waypoint_index();
+
+      const auto& p_1 = graph.waypoints[target].get_location();
+      const auto speed =
+        lane.properties().speed_limit().value_or(max_speed);
+
+      double cost = (p_1 - p_0).norm()/speed;
+
+      if (const auto* entry_event = lane.entry().event())
+        cost += rmf_traffic::time::to_seconds(entry_event->duration());
+
+      if (const auto* exit_event = lane.exit().event())
+        cost += rmf_traffic::time::to_seconds(exit_event->duration());
+
+      _edges.push_back(Edge{l, target, cost});
+    }
+
+    _offsets.push_back(_edges.size());
+  }
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
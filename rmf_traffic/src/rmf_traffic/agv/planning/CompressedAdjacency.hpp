@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__COMPRESSEDADJACENCY_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__COMPRESSEDADJACENCY_HPP
+
+#include "../internal_Graph.hpp"
+
+#include <rmf_traffic/agv/LaneClosure.hpp>
+
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// A frozen, read-only view of the open lanes of a graph in compressed sparse
+/// row form. The lanes of every waypoint are stored next to each other in one
+/// contiguous array, so a search can sweep over them without chasing pointers
+/// through the vectors of the original graph.
+class CompressedAdjacency
+{
+public:
+
+  enum class Direction : uint8_t
+  {
+    /// Each waypoint is adjacent to the exits of the lanes that leave it
+    Forward,
+
+    /// Each waypoint is adjacent to the entries of the lanes that enter it
+    Reverse
+  };
+
+  struct Edge
+  {
+    /// The index of the lane in the original graph
+    std::size_t lane;
+
+    /// The waypoint on the other side of the lane
+    std::size_t target;
+
+    /// The time it takes to move down the lane at the speed limit of the lane
+    /// (or the nominal speed of the vehicle if there is none), plus the
+    /// duration of the lane's events
+    double cost;
+  };
+
+  class Range
+  {
+  public:
+
+    Range(const Edge* begin, const Edge* end)
+    : _begin(begin),
+      _end(end)
+    {
+      // Do nothing
+    }
+
+    const Edge* begin() const
+    {
+      return _begin;
+    }
+
+    const Edge* end() const
+    {
+      return _end;
+    }
+
+    std::size_t size() const
+    {
+      return _end - _begin;
+    }
+
+    bool empty() const
+    {
+      return _begin == _end;
+    }
+
+  private:
+    const Edge* _begin;
+    const Edge* _end;
+  };
+
+  /// Constructor
+  ///
+  /// \param[in] graph
+  ///   The graph to make the view of
+  ///
+  /// \param[in] closures
+  ///   Lanes that are closed will be left out of the view
+  ///
+  /// \param[in] max_speed
+  ///   The nominal speed of the vehicle, used for lanes without a speed limit
+  ///
+  /// \param[in] direction
+  ///   Which way the lanes will be followed
+  CompressedAdjacency(
+    const Graph::Implementation& graph,
+    const LaneClosure& closures,
+    double max_speed,
+    Direction direction);
+
+  /// Get the open lanes of a waypoint, in the same order as the graph has them
+  Range edges(std::size_t waypoint) const
+  {
+    const Edge* const data = _edges.data();
+    return Range(data + _offsets[waypoint], data + _offsets[waypoint+1]);
+  }
+
+  /// Get the number of waypoints in the view
+  std::size_t num_waypoints() const
+  {
+    return _offsets.size() - 1;
+  }
+
+  /// Get the number of open lanes in the view
+  std::size_t num_edges() const
+  {
+    return _edges.size();
+  }
+
+private:
+  // The edges of waypoint i are in the range [_offsets[i], _offsets[i+1])
+  std::vector<std::size_t> _offsets;
+  std::vector<Edge> _edges;
+};
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__COMPRESSEDADJACENCY_HPP
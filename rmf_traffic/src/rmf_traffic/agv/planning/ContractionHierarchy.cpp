@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ContractionHierarchy.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+namespace {
+//==============================================================================
+/// The most waypoints that a witness search will settle before it gives up
+/// and lets a shortcut be added. Giving up early only costs an unnecessary
+/// shortcut, never a wrong answer.
+const std::size_t WitnessSettleLimit = 256;
+
+//==============================================================================
+struct Candidate
+{
+  double cost;
+  WaypointId waypoint;
+};
+
+//==============================================================================
+struct HigherCost
+{
+  bool operator()(const Candidate& a, const Candidate& b) const
+  {
+    return b.cost < a.cost;
+  }
+};
+
+//==============================================================================
+using MinQueue =
+  std::priority_queue<Candidate, std::vector<Candidate>, HigherCost>;
+
+//==============================================================================
+struct WorkingArc
+{
+  WaypointId target;
+  double cost;
+};
+
+//==============================================================================
+/// The graph that remains while the waypoints are being contracted
+class Remaining
+{
+public:
+
+  Remaining(const CompressedAdjacency& lanes_from, std::size_t N)
+  : out(N),
+    in(N),
+    contracted(N, false)
+  {
+    for (std::size_t a = 0; a < N; ++a)
+    {
+      for (const auto& edge : lanes_from.edges(a))
+      {
+        if (edge.target != a)
+          add(a, edge.target, edge.cost);
+      }
+    }
+  }
+
+  /// Add an arc from a to b unless there is already one that is no more
+  /// costly. Returns true if the arc was added or made cheaper.
+  bool add(WaypointId a, WaypointId b, double cost)
+  {
+    for (auto& arc : out[a])
+    {
+      if (arc.target != b)
+        continue;
+
+      if (arc.cost <= cost)
+        return false;
+
+      arc.cost = cost;
+      for (auto& back : in[b])
+      {
+        if (back.target == a)
+          back.cost = cost;
+      }
+
+      return true;
+    }
+
+    out[a].push_back({b, cost});
+    in[b].push_back({a, cost});
+    return true;
+  }
+
+  /// Call f(a, b, cost) for each shortcut that contracting v would need
+  template<typename F>
+  void for_each_shortcut(WaypointId v, F f) const
+  {
+    for (const auto& arc_in : in[v])
+    {
+      const WaypointId a = arc_in.target;
+      if (contracted[a])
+        continue;
+
+      double bound = 0.0;
+      for (const auto& arc_out : out[v])
+      {
+        if (!contracted[arc_out.target] && arc_out.target != a)
+          bound = std::max(bound, arc_in.cost + arc_out.cost);
+      }
+
+      const auto witness = _witness_search(a, v, bound);
+      for (const auto& arc_out : out[v])
+      {
+        const WaypointId b = arc_out.target;
+        if (contracted[b] || b == a)
+          continue;
+
+        const double cost = arc_in.cost + arc_out.cost;
+        const auto it = witness.find(b);
+        if (it != witness.end() && it->second <= cost)
+          continue;
+
+        f(a, b, cost);
+      }
+    }
+  }
+
+  std::vector<std::vector<WorkingArc>> out;
+  std::vector<std::vector<WorkingArc>> in;
+  std::vector<bool> contracted;
+
+private:
+
+  /// Find the costs of the paths from the source that do not pass through
+  /// the skipped waypoint, up to the bound
+  std::unordered_map<WaypointId, double> _witness_search(
+    WaypointId source, WaypointId skip, double bound) const
+  {
+    std::unordered_map<WaypointId, double> settled;
+    MinQueue queue;
+    queue.push({0.0, source});
+    while (!queue.empty() && settled.size() < WitnessSettleLimit)
+    {
+      const auto top = queue.top();
+      queue.pop();
+
+      if (bound < top.cost)
+        break;
+
+      if (!settled.insert({top.waypoint, top.cost}).second)
+        continue;
+
+      for (const auto& arc : out[top.waypoint])
+      {
+        if (arc.target == skip || contracted[arc.target])
+          continue;
+
+        if (settled.count(arc.target) == 0)
+          queue.push({top.cost + arc.cost, arc.target});
+      }
+    }
+
+    return settled;
+  }
+};
+
+//==============================================================================
+struct Label
+{
+  double cost;
+  WaypointId parent;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+ContractionHierarchy::ContractionHierarchy(
+  std::shared_ptr<const Supergraph> graph)
+: _num_waypoints(graph->original().waypoints.size()),
+  _upward(_num_waypoints),
+  _downward(_num_waypoints)
+{
+  const std::size_t N = _num_waypoints;
+  Remaining remaining(graph->lanes_from(), N);
+  std::vector<std::size_t> contracted_neighbors(N, 0);
+
+  // Waypoints whose contraction adds few shortcuts compared to the arcs that
+  // it removes go first. Counting the neighbors that were already contracted
+  // spreads the contractions evenly across the graph.
+  const auto priority = [&](const WaypointId v)
+    {
+      std::size_t shortcuts = 0;
+      remaining.for_each_shortcut(
+        v, [&](WaypointId, WaypointId, double) { ++shortcuts; });
+
+      std::size_t removed = 0;
+      for (const auto& arc : remaining.in[v])
+        removed += remaining.contracted[arc.target] ? 0 : 1;
+      for (const auto& arc : remaining.out[v])
+        removed += remaining.contracted[arc.target] ? 0 : 1;
+
+      return static_cast<double>(shortcuts) - static_cast<double>(removed)
+        + static_cast<double>(contracted_neighbors[v]);
+    };
+
+  MinQueue queue;
+  for (std::size_t v = 0; v < N; ++v)
+    queue.push({priority(v), v});
+
+  while (!queue.empty())
+  {
+    const auto top = queue.top();
+    queue.pop();
+    if (remaining.contracted[top.waypoint])
+      continue;
+
+    // The priorities go stale as the graph is contracted, so each one is
+    // checked again before the waypoint is contracted.
+    const WaypointId v = top.waypoint;
+    const double current = priority(v);
+    if (!queue.empty() && queue.top().cost < current)
+    {
+      queue.push({current, v});
+      continue;
+    }
+
+    struct Shortcut
+    {
+      WaypointId a;
+      WaypointId b;
+      double cost;
+    };
+
+    std::vector<Shortcut> shortcuts;
+    remaining.for_each_shortcut(
+      v, [&](WaypointId a, WaypointId b, double cost)
+      {
+        shortcuts.push_back({a, b, cost});
+      });
+
+    for (const auto& arc : remaining.out[v])
+    {
+      if (remaining.contracted[arc.target])
+        continue;
+
+      _upward[v].push_back({arc.target, arc.cost});
+      ++contracted_neighbors[arc.target];
+    }
+
+    for (const auto& arc : remaining.in[v])
+    {
+      if (remaining.contracted[arc.target])
+        continue;
+
+      _downward[v].push_back({arc.target, arc.cost});
+      ++contracted_neighbors[arc.target];
+    }
+
+    remaining.contracted[v] = true;
+    for (const auto& shortcut : shortcuts)
+    {
+      if (remaining.add(shortcut.a, shortcut.b, shortcut.cost))
+        _middle[shortcut.a*N + shortcut.b] = v;
+    }
+  }
+}
+
+//==============================================================================
+ConstForestSolutionPtr ContractionHierarchy::solve(
+  const WaypointId start,
+  const WaypointId finish) const
+{
+  if (start == finish)
+    return std::make_shared<ForestSolution>(ForestSolution{0.0, {start}});
+
+  // The forward search climbs the upward arcs from the start and the reverse
+  // search climbs the downward arcs from the finish. The shortest path meets
+  // at its waypoint of highest rank.
+  std::unordered_map<WaypointId, Label> labels[2];
+  std::unordered_map<WaypointId, double> settled[2];
+  MinQueue queues[2];
+  const std::vector<std::vector<Arc>>* arcs[2] = {&_upward, &_downward};
+
+  labels[0][start] = Label{0.0, start};
+  labels[1][finish] = Label{0.0, finish};
+  queues[0].push({0.0, start});
+  queues[1].push({0.0, finish});
+
+  double best = std::numeric_limits<double>::infinity();
+  std::optional<WaypointId> meeting;
+  while (true)
+  {
+    std::optional<std::size_t> side;
+    for (std::size_t s = 0; s < 2; ++s)
+    {
+      if (queues[s].empty() || best <= queues[s].top().cost)
+        continue;
+
+      if (!side.has_value() || queues[s].top().cost < queues[*side].top().cost)
+        side = s;
+    }
+
+    if (!side.has_value())
+      break;
+
+    const std::size_t s = *side;
+    const auto top = queues[s].top();
+    queues[s].pop();
+
+    if (!settled[s].insert({top.waypoint, top.cost}).second)
+      continue;
+
+    const auto other = labels[1-s].find(top.waypoint);
+    if (other != labels[1-s].end() && top.cost + other->second.cost < best)
+    {
+      best = top.cost + other->second.cost;
+      meeting = top.waypoint;
+    }
+
+    for (const auto& arc : (*arcs[s])[top.waypoint])
+    {
+      const double cost = top.cost + arc.cost;
+      const auto inserted =
+        labels[s].insert({arc.target, Label{cost, top.waypoint}});
+      if (!inserted.second)
+      {
+        if (inserted.first->second.cost <= cost)
+          continue;
+
+        inserted.first->second = Label{cost, top.waypoint};
+      }
+
+      queues[s].push({cost, arc.target});
+    }
+  }
+
+  if (!meeting.has_value())
+    return nullptr;
+
+  // Crawl back to the start through the forward labels, then out to the
+  // finish through the reverse labels, unpacking every shortcut on the way.
+  std::vector<WaypointId> climb;
+  for (WaypointId wp = *meeting; wp != start; wp = labels[0].at(wp).parent)
+    climb.push_back(wp);
+
+  std::vector<WaypointId> path;
+  path.push_back(start);
+  WaypointId previous = start;
+  for (auto it = climb.rbegin(); it != climb.rend(); ++it)
+  {
+    _unpack(previous, *it, path);
+    previous = *it;
+  }
+
+  for (WaypointId wp = *meeting; wp != finish; )
+  {
+    const WaypointId next = labels[1].at(wp).parent;
+    _unpack(wp, next, path);
+    wp = next;
+  }
+
+  return std::make_shared<ForestSolution>(
+    ForestSolution{best, std::move(path)});
+}
+
+//==============================================================================
+std::size_t ContractionHierarchy::shortcuts() const
+{
+  return _middle.size();
+}
+
+//==============================================================================
+void ContractionHierarchy::_unpack(
+  const WaypointId a,
+  const WaypointId b,
+  std::vector<WaypointId>& path) const
+{
+  std::vector<std::pair<WaypointId, WaypointId>> stack;
+  stack.push_back({a, b});
+  while (!stack.empty())
+  {
+    const auto [from, to] = stack.back();
+    stack.pop_back();
+
+    const auto it = _middle.find(from*_num_waypoints + to);
+    if (it == _middle.end())
+    {
+      path.push_back(to);
+      continue;
+    }
+
+    // The first half has to be unpacked first, so it goes on top
+    stack.push_back({it->second, to});
+    stack.push_back({from, it->second});
+  }
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
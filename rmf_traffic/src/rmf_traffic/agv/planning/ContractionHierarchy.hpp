@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__CONTRACTIONHIERARCHY_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__CONTRACTIONHIERARCHY_HPP
+
+#include "Supergraph.hpp"
+#include "Tree.hpp"
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// A contraction hierarchy of the open lanes of a supergraph. Each waypoint is
+/// given a rank, and the waypoints are contracted from the lowest rank to the
+/// highest, adding a shortcut lane wherever contracting a waypoint would have
+/// made a shortest path longer. The shortest path between any two waypoints
+/// can then be found by two small searches that only ever climb in rank, one
+/// from each end, which is much faster than searching the whole graph.
+///
+/// The lane closures of the supergraph are baked into the hierarchy, so a
+/// supergraph with different closures needs a hierarchy of its own.
+class ContractionHierarchy
+{
+public:
+
+  ContractionHierarchy(std::shared_ptr<const Supergraph> graph);
+
+  /// Find the shortest path from the start to the finish. The cost of each
+  /// lane is the same as the ShortestPath forest uses, so the cost of the
+  /// solution is the same as the forest would find. A nullptr is returned if
+  /// the finish cannot be reached from the start.
+  ConstForestSolutionPtr solve(WaypointId start, WaypointId finish) const;
+
+  /// Get the number of shortcuts that were added to the hierarchy
+  std::size_t shortcuts() const;
+
+private:
+
+  struct Arc
+  {
+    WaypointId target;
+    double cost;
+  };
+
+  /// Append the waypoints of the original lanes that the arc from a to b
+  /// stands for. The waypoint a is left out.
+  void _unpack(
+    WaypointId a,
+    WaypointId b,
+    std::vector<WaypointId>& path) const;
+
+  std::size_t _num_waypoints;
+
+  /// The arcs leaving each waypoint towards waypoints of a higher rank
+  std::vector<std::vector<Arc>> _upward;
+
+  /// The arcs arriving at each waypoint from waypoints of a higher rank. The
+  /// target of each of these arcs is the waypoint that it comes from.
+  std::vector<std::vector<Arc>> _downward;
+
+  /// The waypoint that each shortcut skips over, keyed by a*N + b
+  std::unordered_map<std::size_t, WaypointId> _middle;
+};
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__CONTRACTIONHIERARCHY_HPP
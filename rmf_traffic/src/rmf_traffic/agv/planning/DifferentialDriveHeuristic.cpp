@@ -20,6 +20,7 @@
 
 #include <rmf_utils/math.hpp>
 
+#include <cmath>
 #include <queue>
 
 // TODO(MXG): Remove the debug blocks from this after this code has matured
@@ -79,6 +80,11 @@ public:
       return info.remaining_cost_estimate;
     }
 
+    double get_congestion() const
+    {
+      return 0.0;
+    }
+
     std::optional<Orientation> get_orientation() const
     {
       if (info.entry.has_value())
@@ -133,15 +139,20 @@ public:
 
     const auto traversals = _graph->traversals_from(current_wp_index);
     assert(traversals);
+    const bool contract = _graph->contract_corridors();
     for (const auto& traversal : *traversals)
     {
+      if (contract && traversal.corridor
+        && traversal.finish_waypoint_index != _goal_waypoint)
+        continue;
+
       const auto next_waypoint_index = traversal.finish_waypoint_index;
       const auto& next_waypoint =
         _graph->original().waypoints[next_waypoint_index];
       const Eigen::Vector2d next_position = next_waypoint.get_location();
 
-      const double exit_event_duration = traversal.exit_event ?
-        rmf_traffic::time::to_seconds(traversal.exit_event->duration()) : 0.0;
+      const double exit_event_duration =
+        rmf_traffic::time::to_seconds(traversal.exit_event_duration);
 
       const auto initial_lane_index = traversal.initial_lane_index;
       const auto next_lane_index = traversal.finish_lane_index;
@@ -230,7 +241,7 @@ public:
           auto routes = make_hold_factory(
             next_position,
             target_yaw,
-            traversal.exit_event->duration(),
+            traversal.exit_event_duration,
             _limits,
             _interpolate.rotation_thresh,
             traversal.maps);
@@ -329,11 +340,11 @@ public:
       _goal_entry.orientation
     };
 
-    const auto old_it = _old_items.find(key);
-    if (old_it == _old_items.end())
+    const auto old_item = _old_items.find(key);
+    if (!old_item.has_value())
       return false;
 
-    if (!old_it->second)
+    if (!*old_item)
     {
       // We return true here to say that this node has no way of reaching
       // the goal from its current state, so the planner should not bother
@@ -341,7 +352,7 @@ public:
       return true;
     }
 
-    auto solution = old_it->second->child;
+    auto solution = (*old_item)->child;
     auto node = top;
     while (solution)
     {
@@ -470,7 +481,7 @@ public:
 
   DifferentialDriveExpander(
     Entry goal_entry,
-    const DifferentialDriveHeuristic::Storage& old_items,
+    const DifferentialDriveHeuristic::OldItems& old_items,
     ConstChildHeuristicPtr heuristic,
     std::shared_ptr<const Supergraph> graph)
   : _goal_entry(std::move(goal_entry)),
@@ -498,7 +509,7 @@ private:
   std::size_t _goal_waypoint;
   std::optional<double> _goal_yaw;
   Entry _goal_entry;
-  const DifferentialDriveHeuristic::Storage& _old_items;
+  const DifferentialDriveHeuristic::OldItems& _old_items;
   ConstChildHeuristicPtr _heuristic;
   std::shared_ptr<const Supergraph> _graph;
   KinematicLimits _limits;
@@ -511,7 +522,9 @@ private:
 DifferentialDriveHeuristic::DifferentialDriveHeuristic(
   std::shared_ptr<const Supergraph> graph)
 : _graph(std::move(graph)),
-  _heuristic(std::make_shared<const ChildHeuristic>(_graph))
+  _heuristic(std::make_shared<const ChildHeuristic>(_graph)),
+  _costs(std::make_shared<DifferentialDriveCostTable>(
+      _graph->original().lanes.size()))
 {
   // Do nothing
 }
@@ -519,7 +532,7 @@ DifferentialDriveHeuristic::DifferentialDriveHeuristic(
 //==============================================================================
 auto DifferentialDriveHeuristic::generate(
   const Key& key,
-  const Storage& old_items,
+  const OldItems& old_items,
   Storage& new_items) const -> SolutionNodePtr
 {
   using SearchQueue = DifferentialDriveExpander::SearchQueue;
@@ -706,15 +719,55 @@ ConstForestSolutionPtr DifferentialDriveHeuristic::inner_heuristic(
   return _heuristic->get(start, finish);
 }
 
+//==============================================================================
+auto DifferentialDriveHeuristic::child_heuristic() const
+-> const ConstChildHeuristicPtr&
+{
+  return _heuristic;
+}
+
+//==============================================================================
+auto DifferentialDriveHeuristic::cost_table() const
+-> const std::shared_ptr<DifferentialDriveCostTable>&
+{
+  return _costs;
+}
+
 //==============================================================================
 CacheManagerPtr<DifferentialDriveHeuristic>
 DifferentialDriveHeuristic::make_manager(
   std::shared_ptr<const Supergraph> supergraph)
 {
   const std::size_t N = supergraph->original().lanes.size();
-  return CacheManager<Cache<DifferentialDriveHeuristic>>::make(
-    std::make_shared<DifferentialDriveHeuristic>(std::move(supergraph)),
+  auto manager = CacheManager<Cache<DifferentialDriveHeuristic>>::make(
+    std::make_shared<DifferentialDriveHeuristic>(supergraph),
     [N]() { return Storage(4093, DifferentialDriveMapTypes::KeyHash{N}); });
+
+  // Group the entries by their goal waypoint so that a memory budget discards
+  // the heuristics of whole goals at once.
+  manager->set_grouping(
+    [supergraph](const Key& key) -> std::size_t
+    {
+      return supergraph->original().lanes[key.goal_lane].exit()
+      .waypoint_index();
+    },
+    [](const Key&, const SolutionNodePtr& node) -> std::size_t
+    {
+      std::size_t bytes =
+        sizeof(Storage::value_type) + 2*sizeof(void*);
+
+      // The children of a solution node are usually shared with the entries
+      // of other keys, so we only count the node itself.
+      if (node)
+      {
+        bytes += sizeof(SolutionNode)
+          + node->info.approach_lanes.capacity()*sizeof(std::size_t);
+      }
+
+      return bytes;
+    });
+
+  return manager;
 }
 
 //==============================================================================
@@ -724,6 +777,7 @@ DifferentialDriveHeuristicAdapter::DifferentialDriveHeuristicAdapter(
   std::size_t goal_waypoint,
   std::optional<double> goal_yaw)
 : _cache(std::move(cache)),
+  _costs(_cache.generator()->cost_table()),
   _graph(std::move(graph)),
   _goal_waypoint(goal_waypoint),
   _goal_yaw(goal_yaw),
@@ -737,7 +791,8 @@ DifferentialDriveHeuristicAdapter::DifferentialDriveHeuristicAdapter(
 //==============================================================================
 std::optional<double> DifferentialDriveHeuristicAdapter::compute(
   const std::size_t start_waypoint,
-  const double yaw) const
+  const double yaw,
+  CacheStatistics* lookups) const
 {
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__HEURISTIC
   std::cout << "Computing heuristic for (" << start_waypoint
@@ -785,11 +840,26 @@ std::optional<double> DifferentialDriveHeuristicAdapter::compute(
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__HEURISTIC
 
   std::optional<double> best_cost;
-  SolutionNodePtr best_solution;
+  std::optional<Key> best_key;
   for (const auto& key : keys)
   {
-    const auto solution = _cache.get(key);
-    if (!solution)
+    // The cost table answers most of these lookups, so the cache only needs
+    // to be asked about keys that have never been looked up before.
+    std::optional<double> key_cost = _costs->cost(key);
+    if (key_cost.has_value())
+    {
+      if (lookups)
+        ++lookups->hits;
+    }
+    else
+    {
+      const auto solution = _cache.get(key, lookups);
+      _costs->record(key, solution);
+      if (solution)
+        key_cost = solution->info.remaining_cost_estimate;
+    }
+
+    if (!key_cost.has_value() || std::isinf(*key_cost))
     {
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__HEURISTIC
       std::cout << " == No solution for " << key << std::endl;
@@ -801,7 +871,7 @@ std::optional<double> DifferentialDriveHeuristicAdapter::compute(
     const auto target_yaw = _graph->yaw_of(
       {key.start_lane, key.start_orientation, key.start_side});
 
-    double cost = solution->info.remaining_cost_estimate;
+    double cost = *key_cost;
     double yaw_cost = 0.0;
     if (target_yaw.has_value())
     {
@@ -831,11 +901,12 @@ std::optional<double> DifferentialDriveHeuristicAdapter::compute(
     if (!best_cost.has_value() || cost < *best_cost)
     {
       best_cost = cost;
-      best_solution = solution;
+      best_key = key;
     }
   }
 
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__HEURISTIC
+  auto best_solution = best_key ? _cache.get(*best_key) : nullptr;
   if (best_solution)
   {
     std::cout << "Best heuristic estimate: " << *best_cost << std::endl;
@@ -873,8 +944,9 @@ std::optional<double> DifferentialDriveHeuristicAdapter::compute(
 }
 
 //==============================================================================
-auto DifferentialDriveHeuristicAdapter::compute(Entry start) const
--> SolutionNodePtr
+auto DifferentialDriveHeuristicAdapter::compute(
+  Entry start,
+  CacheStatistics* lookups) const -> SolutionNodePtr
 {
   const auto goal_entries = _graph->entries_into(_goal_waypoint)
     ->relevant_entries(_goal_yaw);
@@ -890,7 +962,8 @@ auto DifferentialDriveHeuristicAdapter::compute(Entry start) const
       goal_entry.orientation
     };
 
-    const auto solution = _cache.get(key);
+    const auto solution = _cache.get(key, lookups);
+    _costs->record(key, solution);
     if (!solution)
       continue;
 
@@ -49,18 +49,25 @@ public:
 
   SolutionNodePtr generate(
     const Key& key,
-    const Storage& old_items,
+    const OldItems& old_items,
     Storage& new_items) const final;
 
   ConstForestSolutionPtr inner_heuristic(
       std::size_t start, std::size_t finish) const;
 
+  const ConstChildHeuristicPtr& child_heuristic() const;
+
+  /// Get the dense table of the costs that have been looked up through this
+  /// heuristic
+  const std::shared_ptr<DifferentialDriveCostTable>& cost_table() const;
+
   static CacheManagerPtr<DifferentialDriveHeuristic> make_manager(
     std::shared_ptr<const Supergraph> graph);
 
 private:
   std::shared_ptr<const Supergraph> _graph;
   ConstChildHeuristicPtr _heuristic;
+  std::shared_ptr<DifferentialDriveCostTable> _costs;
 };
 
 //==============================================================================
@@ -78,20 +85,27 @@ public:
     std::size_t goal_waypoint,
     std::optional<double> goal_yaw);
 
+  /// If lookups is not a nullptr, the cache lookups of this computation will
+  /// be counted in it. Costs that are answered by the cost table of the
+  /// heuristic count as hits.
   std::optional<double> compute(
     std::size_t start_waypoint,
-    double yaw) const;
+    double yaw,
+    CacheStatistics* lookups = nullptr) const;
 
   using SolutionNodePtr = DifferentialDriveHeuristic::SolutionNodePtr;
   using Entry = DifferentialDriveHeuristic::Entry;
   using Key = DifferentialDriveHeuristic::Key;
 
-  SolutionNodePtr compute(Entry start) const;
+  SolutionNodePtr compute(
+    Entry start,
+    CacheStatistics* lookups = nullptr) const;
 
   const Cache<DifferentialDriveHeuristic>& cache() const;
 
 private:
   Cache<DifferentialDriveHeuristic> _cache;
+  std::shared_ptr<DifferentialDriveCostTable> _costs;
   std::shared_ptr<const Supergraph> _graph;
   std::size_t _goal_waypoint;
   std::optional<double> _goal_yaw;
@@ -104,8 +118,29 @@ private:
 template<typename NodePtrT>
 struct DifferentialDriveCompare
 {
-  DifferentialDriveCompare(double threshold = 1e-3)
-  : _threshold(threshold)
+  /// Constructor
+  ///
+  /// \param[in] threshold
+  ///   Cost estimates that are closer than this are considered to be tied.
+  ///
+  /// \param[in] weight
+  ///   The weight on the remaining cost estimate. Values above 1 give a
+  ///   weighted A* search whose solutions cost at most this many times the
+  ///   optimal cost.
+  ///
+  /// \param[in] congestion
+  ///   True if the get_congestion() of the nodes should be used. In a weighted
+  ///   search, half of the weight is always applied and the other half is
+  ///   only applied as far as the congestion of the node, which keeps the
+  ///   same bound on the solution cost. Otherwise the congestion only breaks
+  ///   ties.
+  DifferentialDriveCompare(
+    double threshold = 1e-3,
+    double weight = 1.0,
+    bool congestion = false)
+  : _threshold(threshold),
+    _weight(weight),
+    _congestion(congestion)
   {
     // Do nothing
   }
@@ -116,14 +151,22 @@ struct DifferentialDriveCompare
   {
     // TODO(MXG): Micro-optimization: consider saving the sum of these values
     // in the Node instead of needing to re-add them for every comparison.
-    const double a_value = a->get_total_cost_estimate();
-    const double b_value = b->get_total_cost_estimate();
+    const double a_value = a->get_total_cost_estimate() + _inflation(a);
+    const double b_value = b->get_total_cost_estimate() + _inflation(b);
 
     // Note(MXG): The priority queue puts the greater value first, so we
     // reverse the arguments in this comparison.
     if (std::abs(a_value - b_value) > _threshold)
       return b_value < a_value;
 
+    if (_congestion)
+    {
+      const double a_congestion = a->get_congestion();
+      const double b_congestion = b->get_congestion();
+      if (std::abs(a_congestion - b_congestion) > _threshold)
+        return b_congestion < a_congestion;
+    }
+
     const std::optional<Orientation> a_orientation = a->get_orientation();
     const std::optional<Orientation> b_orientation = b->get_orientation();
 
@@ -143,8 +186,27 @@ struct DifferentialDriveCompare
     return b->get_remaining_cost_estimate() < a->get_remaining_cost_estimate();
   }
 
+  double weight() const
+  {
+    return _weight;
+  }
+
 private:
+
+  double _inflation(const NodePtrT& node) const
+  {
+    const double inflation =
+      (_weight - 1.0) * node->get_remaining_cost_estimate();
+
+    if (!_congestion)
+      return inflation;
+
+    return inflation/2.0 + std::min(inflation/2.0, node->get_congestion());
+  }
+
   double _threshold;
+  double _weight;
+  bool _congestion;
 };
 
 } // namespace planning
@@ -22,6 +22,10 @@
 
 #include "../internal_Interpolate.hpp"
 
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 namespace rmf_traffic {
 namespace agv {
 namespace planning {
@@ -50,23 +54,26 @@ FactoryInfo make_differential_drive_translate_factory(
   double traversal_cost_per_meter,
   std::vector<std::string> maps)
 {
+  // The translation profile does not depend on when the traversal starts or on
+  // the initial yaw of the robot, so it is interpolated once here and every
+  // route that the factory produces gets a time-shifted copy of it.
   const auto dummy_start_time = rmf_traffic::Time(rmf_traffic::Duration(0));
-  Trajectory trajectory;
-  trajectory.insert(dummy_start_time, start, Eigen::Vector3d::Zero());
+  auto translation = std::make_shared<Trajectory>();
+  translation->insert(dummy_start_time, start, Eigen::Vector3d::Zero());
   internal::interpolate_translation(
-    trajectory, limits.linear.velocity, limits.linear.acceleration,
+    *translation, limits.linear.velocity, limits.linear.acceleration,
     dummy_start_time, start, finish, translation_thresh);
 
   const double minimal_cost =
-    calculate_cost(trajectory, traversal_cost_per_meter);
+    calculate_cost(*translation, traversal_cost_per_meter);
 
   auto factory =
     [start,
       finish,
       limits,
-      translation_thresh,
       rotation_thresh,
       traversal_cost_per_meter,
+      translation = std::shared_ptr<const Trajectory>(std::move(translation)),
       maps = std::move(maps)](
     rmf_traffic::Time start_time,
     double initial_yaw)
@@ -80,9 +87,13 @@ FactoryInfo make_differential_drive_translate_factory(
         trajectory, limits.angular.velocity, limits.angular.acceleration,
         start_time, pre_start, start, rotation_thresh);
 
-      internal::interpolate_translation(
-        trajectory, limits.linear.velocity, limits.linear.acceleration,
-        trajectory.back().time(), start, finish, translation_thresh);
+      const auto translation_start = trajectory.back().time();
+      for (auto it = ++translation->begin(); it != translation->end(); ++it)
+      {
+        trajectory.insert(
+          translation_start + it->time().time_since_epoch(),
+          it->position(), it->velocity());
+      }
 
       std::vector<Route> routes;
       routes.reserve(maps.size());
@@ -337,6 +348,217 @@ make_start_factory(
     };
 }
 
+//==============================================================================
+namespace {
+// Every bit of an unrecorded slot is set, which is a NaN cost
+constexpr std::uint64_t UnknownSlot = std::numeric_limits<std::uint64_t>::max();
+
+// The low bits of a slot hold the index of the next entry plus one, so that
+// zero can mean that there is no next entry.
+constexpr std::uint64_t NoNextEntry = 0;
+
+//==============================================================================
+std::uint64_t pack_slot(const double cost, const std::uint64_t next)
+{
+  float low = static_cast<float>(cost);
+  if (static_cast<double>(low) > cost)
+    low = std::nextafter(low, -std::numeric_limits<float>::infinity());
+
+  std::uint32_t bits;
+  static_assert(sizeof(bits) == sizeof(low));
+  std::memcpy(&bits, &low, sizeof(bits));
+  return (static_cast<std::uint64_t>(bits) << 32) | next;
+}
+
+//==============================================================================
+double unpack_cost(const std::uint64_t slot)
+{
+  const auto bits = static_cast<std::uint32_t>(slot >> 32);
+  float cost;
+  std::memcpy(&cost, &bits, sizeof(cost));
+  return static_cast<double>(cost);
+}
+} // anonymous namespace
+
+//==============================================================================
+DifferentialDriveCostTable::DifferentialDriveCostTable(
+  const std::size_t N_lanes)
+: _row_size(6*N_lanes),
+  _num_rows(3*N_lanes),
+  _rows(std::make_unique<std::atomic<Slot*>[]>(_num_rows))
+{
+  for (std::size_t i = 0; i < _num_rows; ++i)
+    _rows[i].store(nullptr, std::memory_order_relaxed);
+}
+
+//==============================================================================
+DifferentialDriveCostTable::~DifferentialDriveCostTable()
+{
+  for (std::size_t i = 0; i < _num_rows; ++i)
+    delete[] _rows[i].load(std::memory_order_relaxed);
+}
+
+//==============================================================================
+std::optional<double> DifferentialDriveCostTable::cost(const Key& key) const
+{
+  const Slot* slot = _find_slot(key);
+  if (!slot)
+    return std::nullopt;
+
+  const std::uint64_t value = slot->load(std::memory_order_relaxed);
+  if (value == UnknownSlot)
+    return std::nullopt;
+
+  return unpack_cost(value);
+}
+
+//==============================================================================
+void DifferentialDriveCostTable::record(
+  const Key& key,
+  const SolutionNodePtr& solution)
+{
+  const std::size_t row_index =
+    3*key.goal_lane + static_cast<std::size_t>(key.goal_orientation);
+  if (row_index >= _num_rows)
+    return;
+
+  const Entry start{key.start_lane, key.start_orientation, key.start_side};
+  const std::size_t start_index = _start_index(start);
+  if (start_index >= _row_size)
+    return;
+
+  auto& row = _rows[row_index];
+  Slot* slots = row.load(std::memory_order_acquire);
+  if (!slots)
+  {
+    auto* fresh = new Slot[_row_size];
+    for (std::size_t i = 0; i < _row_size; ++i)
+      fresh[i].store(UnknownSlot, std::memory_order_relaxed);
+
+    if (row.compare_exchange_strong(slots, fresh, std::memory_order_acq_rel))
+    {
+      slots = fresh;
+      ++_allocated_rows;
+    }
+    else
+    {
+      // Another thread allocated this row first
+      delete[] fresh;
+    }
+  }
+
+  if (!solution)
+  {
+    slots[start_index].store(
+      pack_slot(std::numeric_limits<double>::infinity(), NoNextEntry),
+      std::memory_order_relaxed);
+    return;
+  }
+
+  std::uint64_t next = NoNextEntry;
+  for (auto node = solution->child; node; node = node->child)
+  {
+    const auto& entry = node->info.entry;
+    if (entry.has_value() && *entry != start)
+    {
+      next = _start_index(*entry) + 1;
+      break;
+    }
+  }
+
+  slots[start_index].store(
+    pack_slot(solution->info.remaining_cost_estimate, next),
+    std::memory_order_relaxed);
+}
+
+//==============================================================================
+auto DifferentialDriveCostTable::path(const Key& key) const
+-> std::vector<Entry>
+{
+  std::vector<Entry> output;
+  Key current = key;
+
+  // A path can never visit more entries than there are in a row, so this also
+  // protects against a cycle of stale values.
+  for (std::size_t i = 0; i < _row_size; ++i)
+  {
+    const Slot* slot = _find_slot(current);
+    if (!slot)
+      break;
+
+    const std::uint64_t value = slot->load(std::memory_order_relaxed);
+    if (value == UnknownSlot || std::isinf(unpack_cost(value)))
+      break;
+
+    output.push_back(
+      {current.start_lane, current.start_orientation, current.start_side});
+
+    const std::uint64_t next = value & 0xFFFFFFFF;
+    if (next == NoNextEntry)
+      break;
+
+    const Entry entry = _entry_of(next - 1);
+    current.start_lane = entry.lane;
+    current.start_orientation = entry.orientation;
+    current.start_side = entry.side;
+  }
+
+  return output;
+}
+
+//==============================================================================
+std::size_t DifferentialDriveCostTable::rows() const
+{
+  return _allocated_rows.load();
+}
+
+//==============================================================================
+std::size_t DifferentialDriveCostTable::bytes() const
+{
+  return _num_rows*sizeof(std::atomic<Slot*>)
+    + rows()*_row_size*sizeof(Slot);
+}
+
+//==============================================================================
+std::size_t DifferentialDriveCostTable::_start_index(const Entry& entry) const
+{
+  return 6*entry.lane
+    + 2*static_cast<std::size_t>(entry.orientation)
+    + static_cast<std::size_t>(entry.side);
+}
+
+//==============================================================================
+auto DifferentialDriveCostTable::_entry_of(const std::size_t start_index) const
+-> Entry
+{
+  return Entry{
+    start_index/6,
+    static_cast<Orientation>((start_index % 6)/2),
+    static_cast<Side>(start_index % 2)
+  };
+}
+
+//==============================================================================
+auto DifferentialDriveCostTable::_find_slot(const Key& key) const
+-> const Slot*
+{
+  const std::size_t row_index =
+    3*key.goal_lane + static_cast<std::size_t>(key.goal_orientation);
+  if (row_index >= _num_rows)
+    return nullptr;
+
+  const std::size_t start_index =
+    _start_index({key.start_lane, key.start_orientation, key.start_side});
+  if (start_index >= _row_size)
+    return nullptr;
+
+  const Slot* slots = _rows[row_index].load(std::memory_order_acquire);
+  if (!slots)
+    return nullptr;
+
+  return &slots[start_index];
+}
+
 //==============================================================================
 DifferentialDriveMapTypes::RouteFactoryFactory
 make_recycling_factory(DifferentialDriveMapTypes::RouteFactory old_factory)
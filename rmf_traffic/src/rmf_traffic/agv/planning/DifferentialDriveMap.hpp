@@ -23,9 +23,13 @@
 
 #include "../internal_VehicleTraits.hpp"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace rmf_traffic {
 namespace agv {
@@ -308,6 +312,72 @@ using DifferentialDriveEntrySet =
   DifferentialDriveMapTypes::EntryHash
   >;
 
+//==============================================================================
+/// A dense table of the costs of DifferentialDriveMap keys. Each key takes one
+/// float cost and the index of the next entry of its solution, packed into a
+/// single word, instead of a hash map node and a solution node. The planner
+/// asks for these costs once per expansion, so they are kept here even after
+/// the solution nodes of a goal have been evicted from the cache.
+///
+/// The row of each goal entry is allocated the first time that one of its
+/// keys is recorded. Recording and looking up keys never takes a lock, so
+/// this can be shared by every thread that uses the same heuristic.
+class DifferentialDriveCostTable
+{
+public:
+
+  using Key = DifferentialDriveMapTypes::Key;
+  using Entry = DifferentialDriveMapTypes::Entry;
+  using SolutionNodePtr = DifferentialDriveMapTypes::SolutionNodePtr;
+
+  /// Constructor
+  ///
+  /// \param[in] N_lanes
+  ///   The number of lanes in the graph
+  DifferentialDriveCostTable(std::size_t N_lanes);
+
+  DifferentialDriveCostTable(const DifferentialDriveCostTable&) = delete;
+  DifferentialDriveCostTable& operator=(
+    const DifferentialDriveCostTable&) = delete;
+
+  ~DifferentialDriveCostTable();
+
+  /// Get the cost of a key. This is a nullopt if the key has not been recorded
+  /// yet, and infinity if the goal cannot be reached from the start.
+  ///
+  /// The cost is rounded down to the nearest float, so it never overestimates
+  /// the cost of the solution.
+  std::optional<double> cost(const Key& key) const;
+
+  /// Record the solution of a key. A nullptr solution means that the goal
+  /// cannot be reached from the start.
+  void record(const Key& key, const SolutionNodePtr& solution);
+
+  /// Get the entries that the solution of a key passes through, starting with
+  /// the start entry of the key. This is empty if the key has not been
+  /// recorded or the goal cannot be reached. The entries are only as complete
+  /// as the keys that have been recorded along the way.
+  std::vector<Entry> path(const Key& key) const;
+
+  /// Get the number of goal entries whose rows have been allocated
+  std::size_t rows() const;
+
+  /// Get the number of bytes used by the rows that have been allocated
+  std::size_t bytes() const;
+
+private:
+  using Slot = std::atomic<std::uint64_t>;
+
+  std::size_t _start_index(const Entry& entry) const;
+  Entry _entry_of(std::size_t start_index) const;
+  const Slot* _find_slot(const Key& key) const;
+
+  std::size_t _row_size;
+  std::size_t _num_rows;
+  std::unique_ptr<std::atomic<Slot*>[]> _rows;
+  std::atomic_size_t _allocated_rows = 0;
+};
+
 //==============================================================================
 struct FactoryInfo
 {
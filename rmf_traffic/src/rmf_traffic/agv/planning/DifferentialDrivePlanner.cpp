@@ -19,10 +19,22 @@
 
 #include "../internal_Planner.hpp"
 
+#include "HeuristicArchive.hpp"
+#include "NodeArena.hpp"
+#include "VisitSet.hpp"
 #include "a_star.hpp"
 
+#include "../../debug/internal_Trace.hpp"
+
 #include <rmf_utils/math.hpp>
-#include <set>
+
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
 
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 #include <iostream>
@@ -81,6 +93,45 @@ struct OrientationTimeMap
     double yaw;
     TimeMap time_map;
 
+    /// The search already proved that the robot can sit still at the pose of
+    /// some nodes for a span of time. If those spans cover the whole hold
+    /// from node_low to node_high, the hold does not need to be validated
+    /// again. Otherwise only the part that was never proven gets validated.
+    static bool needs_validation(
+      const NodePtr& node_low,
+      const NodePtr& node_high,
+      const Route& hold,
+      const agv::RouteValidator& validator)
+    {
+      const auto& start_wp = hold.trajectory().front();
+      const auto& end_wp = hold.trajectory().back();
+      if ((start_wp.position() - end_wp.position()).norm() > 1e-8)
+        return static_cast<bool>(validator.find_conflict(hold));
+
+      const Time t_low = start_wp.time();
+      const Time t_high = end_wp.time();
+      const Time proven_until = node_low->stationary_until;
+      const Time proven_since = node_high->stationary_since;
+      if (proven_until >= t_high || proven_since <= t_low
+        || proven_since <= proven_until)
+      {
+        return false;
+      }
+
+      const Time unproven_start = std::max(t_low, proven_until);
+      const Time unproven_finish = std::min(t_high, proven_since);
+      if (unproven_start == t_low && unproven_finish == t_high)
+        return static_cast<bool>(validator.find_conflict(hold));
+
+      Route gap{hold.map(), {}};
+      gap.trajectory().insert(
+        unproven_start, end_wp.position(), Eigen::Vector3d::Zero());
+      gap.trajectory().insert(
+        unproven_finish, end_wp.position(), Eigen::Vector3d::Zero());
+
+      return static_cast<bool>(validator.find_conflict(gap));
+    }
+
     void squash(const agv::RouteValidator* validator)
     {
       assert(!time_map.empty());
@@ -130,7 +181,8 @@ struct OrientationTimeMap
           end_wp.position(),
           Eigen::Vector3d::Zero());
 
-        if (!validator || !validator->find_conflict(new_route))
+        if (!validator || !needs_validation(node_low, node_high, new_route,
+          *validator))
         {
           reparent_node_for_holding(node_low, node_high, std::move(new_route));
           time_map.erase(++typename TimeMap::iterator(it_low), it_high);
@@ -175,6 +227,53 @@ struct OrientationTimeMap
 
   std::vector<Element> elements;
 };
+
+//==============================================================================
+/// Check that a cached heuristic solution does not use any of the lanes
+bool avoids_lanes(
+  const DifferentialDriveMapTypes::Key& key,
+  DifferentialDriveMapTypes::SolutionNodePtr node,
+  const std::vector<bool>& lanes)
+{
+  if (lanes[key.start_lane] || lanes[key.goal_lane])
+    return false;
+
+  for (; node; node = node->child)
+  {
+    const auto& info = node->info;
+    if (info.entry.has_value() && lanes[info.entry->lane])
+      return false;
+
+    for (const auto l : info.approach_lanes)
+    {
+      if (lanes[l])
+        return false;
+    }
+  }
+
+  return true;
+}
+
+//==============================================================================
+/// Check that a shortest path does not use any of the lanes
+bool avoids_lanes(
+  const Graph::Implementation& graph,
+  const std::vector<std::size_t>& path,
+  const std::vector<bool>& lanes)
+{
+  for (std::size_t i = 1; i < path.size(); ++i)
+  {
+    // We do not know which lane the path used between these waypoints, so we
+    // check all of them.
+    for (const auto l : graph.lanes_from[path[i-1]])
+    {
+      if (lanes[l] && graph.lanes[l].exit().waypoint_index() == path[i])
+        return false;
+    }
+  }
+
+  return true;
+}
 } // anonymous namespace
 
 //==============================================================================
@@ -195,8 +294,8 @@ std::vector<NodePtr> reconstruct_nodes(
     OrientationTimeMap<NodePtr>
   > cruft_map;
 
-  NodePtr first_midlane_node;
-  NodePtr last_midlane_node;
+  NodePtr first_midlane_node = nullptr;
+  NodePtr last_midlane_node = nullptr;
 
   for (const auto& node : node_sequence)
   {
@@ -665,6 +764,180 @@ Plan::Start find_start(NodePtr node)
   return node->start.value();
 }
 
+//==============================================================================
+/// Forwards the conflict options of the planner to a validator every time it
+/// checks a route.
+class ConfiguredRouteValidator : public RouteValidator
+{
+public:
+
+  ConfiguredRouteValidator(
+    const RouteValidator* validator,
+    DetectConflict::Options options)
+  : _validator(validator),
+    _options(std::move(options))
+  {
+    // Do nothing
+  }
+
+  std::optional<Conflict> find_conflict(const Route& route) const final
+  {
+    return _validator->find_conflict(route, _options);
+  }
+
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes) const final
+  {
+    return _validator->find_conflicts(routes, _options);
+  }
+
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options*,
+    const Interrupter& interrupter) const final
+  {
+    return _validator->find_conflict(route, &_options, interrupter);
+  }
+
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options*,
+    const Interrupter& interrupter) const final
+  {
+    return _validator->find_conflicts(routes, &_options, interrupter);
+  }
+
+  std::unique_ptr<RouteValidator> clone() const final
+  {
+    return std::make_unique<ConfiguredRouteValidator>(*this);
+  }
+
+private:
+  const RouteValidator* _validator;
+  DetectConflict::Options _options;
+};
+
+//==============================================================================
+/// Counts the calls to a validator and the time that they take.
+class MeasuredRouteValidator : public RouteValidator
+{
+public:
+
+  using Statistics = Planner::Result::Statistics;
+
+  MeasuredRouteValidator(
+    const RouteValidator* validator,
+    Statistics* statistics)
+  : _validator(validator),
+    _statistics(statistics)
+  {
+    // Do nothing
+  }
+
+  std::optional<Conflict> find_conflict(const Route& route) const final
+  {
+    return _measure([&]() { return _validator->find_conflict(route); });
+  }
+
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options& options) const final
+  {
+    return _measure(
+      [&]() { return _validator->find_conflict(route, options); });
+  }
+
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes) const final
+  {
+    return _measure([&]() { return _validator->find_conflicts(routes); });
+  }
+
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options& options) const final
+  {
+    return _measure(
+      [&]() { return _validator->find_conflicts(routes, options); });
+  }
+
+  std::optional<Conflict> find_conflict(
+    const Route& route,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const final
+  {
+    return _measure(
+      [&]()
+      {
+        return _validator->find_conflict(route, options, interrupter);
+      });
+  }
+
+  std::optional<Conflict> find_conflicts(
+    const std::vector<Route>& routes,
+    const DetectConflict::Options* options,
+    const Interrupter& interrupter) const final
+  {
+    return _measure(
+      [&]()
+      {
+        return _validator->find_conflicts(routes, options, interrupter);
+      });
+  }
+
+  std::optional<Identity> identity() const final
+  {
+    return _validator->identity();
+  }
+
+  std::unique_ptr<RouteValidator> clone() const final
+  {
+    return std::make_unique<MeasuredRouteValidator>(*this);
+  }
+
+private:
+
+  template<typename F>
+  std::optional<Conflict> _measure(const F& check) const
+  {
+    const auto start = std::chrono::steady_clock::now();
+    auto conflict = check();
+    ++_statistics->validator_calls;
+    _statistics->validator_time += std::chrono::steady_clock::now() - start;
+    return conflict;
+  }
+
+  const RouteValidator* _validator;
+  Statistics* _statistics;
+};
+
+//==============================================================================
+/// Adds the time between its construction and destruction to the time that a
+/// search has spent constructing trajectories.
+class TrajectoryTimer
+{
+public:
+
+  TrajectoryTimer(Planner::Result::Statistics& statistics)
+  : _statistics(statistics),
+    _start(std::chrono::steady_clock::now())
+  {
+    // Do nothing
+  }
+
+  ~TrajectoryTimer()
+  {
+    _statistics.trajectory_time += std::chrono::steady_clock::now() - _start;
+  }
+
+  TrajectoryTimer(const TrajectoryTimer&) = delete;
+  TrajectoryTimer& operator=(const TrajectoryTimer&) = delete;
+
+private:
+  Planner::Result::Statistics& _statistics;
+  Time _start;
+};
+
 //==============================================================================
 class ScheduledDifferentialDriveExpander
 {
@@ -673,11 +946,39 @@ public:
   using Entry = DifferentialDriveMapTypes::Entry;
   using EntryHash = DifferentialDriveMapTypes::EntryHash;
 
+  // Search nodes live in the NodeArena of the search that made them, so they
+  // refer to each other with raw pointers.
   struct SearchNode;
-  using SearchNodePtr = std::shared_ptr<SearchNode>;
-  using ConstSearchNodePtr = std::shared_ptr<const SearchNode>;
+  using SearchNodePtr = SearchNode*;
+  using ConstSearchNodePtr = const SearchNode*;
   using NodePtr = SearchNodePtr;
 
+  /// Describes how the routes of a node can be remade from its parent. Most of
+  /// the nodes in a search are never popped from the queue, so we only keep
+  /// the routes of the uncommon kinds of nodes, and we make the rest when they
+  /// are needed.
+  struct RouteRecipe
+  {
+    enum class Kind : uint8_t
+    {
+      /// The routes are stored in the node.
+      Stored,
+
+      /// The node is holding in place after its parent.
+      Hold,
+
+      /// The node is rotating towards the entry of a traversal.
+      Approach,
+
+      /// The node comes at the end of a traversal.
+      Traverse
+    };
+
+    Kind kind;
+    uint8_t alternative;
+    const Traversal* traversal;
+  };
+
   struct SearchNode
   {
     // We use optional here because start nodes don't always have an Entry value
@@ -692,7 +993,10 @@ public:
 
     double remaining_cost_estimate;
 
+    // This will be empty until the node is materialized unless the recipe
+    // kind is Stored.
     std::vector<Route> route_from_parent;
+    RouteRecipe recipe;
 
     // An event that should occur when this node is reached,
     // i.e. after route_from_parent has been traversed
@@ -702,6 +1006,22 @@ public:
     std::optional<Planner::Start> start;
     SearchNodePtr parent;
 
+    // The expected delay at the waypoint of this node because of congestion.
+    // This is filled in by make_node() when the search has a congestion field.
+    double congestion = 0.0;
+
+    // The search has proven that the robot can sit still at the position and
+    // yaw of this node from stationary_since until stationary_until without
+    // any conflicts. These grow as holds are validated, so that reconstructing
+    // the plan does not need to validate the same holds again.
+    Time stationary_since;
+    Time stationary_until;
+
+    // When there is no validator, this is the rest of the heuristic's solution
+    // from this node to the goal. It only gets turned into search nodes if
+    // this node is popped from the queue.
+    DifferentialDriveMapTypes::SolutionNodePtr free_solution = nullptr;
+
     double get_total_cost_estimate() const
     {
       return current_cost + remaining_cost_estimate;
@@ -712,6 +1032,11 @@ public:
       return remaining_cost_estimate;
     }
 
+    double get_congestion() const
+    {
+      return congestion;
+    }
+
     std::optional<Orientation> get_orientation() const
     {
       if (entry.has_value())
@@ -732,7 +1057,8 @@ public:
       Graph::Lane::EventPtr event_,
       double current_cost_,
       std::optional<Planner::Start> start_,
-      SearchNodePtr parent_)
+      SearchNodePtr parent_,
+      RouteRecipe recipe_ = {RouteRecipe::Kind::Stored, 0, nullptr})
     : entry(entry_),
       waypoint(waypoint_),
       approach_lanes(std::move(approach_lanes_)),
@@ -741,12 +1067,17 @@ public:
       time(time_),
       remaining_cost_estimate(remaining_cost_estimate_),
       route_from_parent(std::move(route_from_parent_)),
+      recipe(recipe_),
       event(event_),
       current_cost(current_cost_),
       start(std::move(start_)),
-      parent(std::move(parent_))
+      parent(parent_),
+      stationary_since(time_),
+      stationary_until(time_)
     {
-      assert(!route_from_parent.empty());
+      assert(
+        !route_from_parent.empty() || recipe.kind != RouteRecipe::Kind::Stored);
+      assert(recipe.kind == RouteRecipe::Kind::Stored || parent);
 
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
       if (parent &&
@@ -802,13 +1133,27 @@ public:
     }
   };
 
-  using SearchQueue =
+  using SearchCompare = DifferentialDriveCompare<SearchNodePtr>;
+  using SearchQueueBase =
     std::priority_queue<
     SearchNodePtr,
     std::vector<SearchNodePtr>,
-    DifferentialDriveCompare<SearchNodePtr>
+    SearchCompare
     >;
 
+  struct SearchQueue : SearchQueueBase
+  {
+    using SearchQueueBase::SearchQueueBase;
+
+    /// Every node in the queue, in no particular order
+    const std::vector<SearchNodePtr>& nodes() const
+    {
+      return this->c;
+    }
+  };
+
+  using Arena = NodeArena<SearchNode>;
+
   class InternalState : public State::Internal
   {
   public:
@@ -818,8 +1163,19 @@ public:
       if (queue.empty())
         return std::nullopt;
 
-      const auto& top = queue.top();
-      return top->current_cost + top->remaining_cost_estimate;
+      if (weight == 1.0)
+      {
+        const auto& top = queue.top();
+        return top->current_cost + top->remaining_cost_estimate;
+      }
+
+      // A weighted queue is not ordered by the plain cost estimate, so we need
+      // to look through the whole queue.
+      double lowest = std::numeric_limits<double>::infinity();
+      for (const auto& node : queue.nodes())
+        lowest = std::min(lowest, node->get_total_cost_estimate());
+
+      return lowest;
     }
 
     std::size_t queue_size() const final
@@ -832,13 +1188,206 @@ public:
       return popped_count;
     }
 
+    Planner::Result::Statistics statistics() const final
+    {
+      auto output = search_statistics;
+      output.nodes_expanded = popped_count;
+      output.heuristic_hits = heuristic_lookups.hits;
+      output.heuristic_misses = heuristic_lookups.misses;
+      output.heuristic_time = std::chrono::duration_cast<Duration>(
+        std::chrono::duration<double>(heuristic_lookups.compute_time));
+      output.peak_memory = std::max(
+        output.peak_memory,
+        output.nodes_generated * sizeof(SearchNode)
+        + output.peak_queue_size * sizeof(SearchNodePtr));
+
+      return output;
+    }
+
+    InternalState() = default;
+
+    // A copy of a search keeps the nodes of the original alive, but it makes
+    // its new nodes in an arena of its own.
+    InternalState(const InternalState& other)
+    : weight(other.weight),
+      congestion(other.congestion),
+      queue(other.queue),
+      popped_count(other.popped_count),
+      arena(std::make_shared<Arena>(other.arena)),
+      traversals(other.traversals),
+      solution(other.solution),
+      search_statistics(other.search_statistics),
+      heuristic_lookups(other.heuristic_lookups)
+    {
+      // Do nothing
+    }
+
+    InternalState& operator=(const InternalState& other)
+    {
+      weight = other.weight;
+      congestion = other.congestion;
+      queue = other.queue;
+      popped_count = other.popped_count;
+      arena = std::make_shared<Arena>(other.arena);
+      traversals = other.traversals;
+      solution = other.solution;
+      search_statistics = other.search_statistics;
+      heuristic_lookups = other.heuristic_lookups;
+      return *this;
+    }
+
+    /// Make an empty queue that is ordered the same way as this search
+    SearchQueue make_queue() const
+    {
+      return SearchQueue(SearchCompare(1e-3, weight, congestion));
+    }
+
+    // The weight on the remaining cost estimate when ordering the queue
+    double weight = 1.0;
+
+    // True if the queue is ordered with the congestion of the nodes
+    bool congestion = false;
     SearchQueue queue;
     std::size_t popped_count = 0;
+    std::shared_ptr<Arena> arena = std::make_shared<Arena>();
+
+    // The recipes of the nodes refer to these traversals
+    std::unordered_set<ConstTraversalsPtr> traversals;
+
+    // The last solution that this search found, so that a later search to the
+    // same goal can reuse it
+    SearchNodePtr solution = nullptr;
+
+    // The statistics that are not derived from the other fields
+    Planner::Result::Statistics search_statistics;
+    CacheStatistics heuristic_lookups;
   };
 
+  /// Make a new search node in the arena of the current search.
+  SearchNodePtr make_node(SearchNode node) const
+  {
+    ++_internal->search_statistics.nodes_generated;
+    if (_internal->congestion && _congestion_field && node.waypoint.has_value()
+      && *node.waypoint != _goal_waypoint)
+    {
+      node.congestion = rmf_traffic::time::to_seconds(
+        _congestion_field->waypoint_delay(*node.waypoint));
+    }
+
+    return _internal->arena->make(std::move(node));
+  }
+
+  /// Make the routes of a node if they were not stored when it was created.
+  void materialize(const SearchNodePtr& node) const
+  {
+    if (!node->route_from_parent.empty())
+      return;
+
+    const TrajectoryTimer timer(_internal->search_statistics);
+    const auto& parent = node->parent;
+    const auto& recipe = node->recipe;
+    const Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+    switch (recipe.kind)
+    {
+      case RouteRecipe::Kind::Stored:
+      {
+        // Stored nodes always have their routes
+        assert(false);
+        return;
+      }
+      case RouteRecipe::Kind::Hold:
+      {
+        const std::string& map_name =
+          _supergraph->original().waypoints[*node->waypoint].get_map_name();
+
+        const Eigen::Vector2d& p = node->position;
+        const Eigen::Vector3d position{p.x(), p.y(), node->yaw};
+        Trajectory trajectory;
+        trajectory.insert(parent->time, position, zero);
+        trajectory.insert(node->time, position, zero);
+        node->route_from_parent = {{map_name, std::move(trajectory)}};
+        return;
+      }
+      case RouteRecipe::Kind::Approach:
+      {
+        const auto& waypoint = _supergraph->original()
+          .waypoints[recipe.traversal->initial_waypoint_index];
+        const Eigen::Vector2d p0 = waypoint.get_location();
+        const auto& alt = recipe.traversal->alternatives[recipe.alternative];
+
+        Trajectory trajectory;
+        const Eigen::Vector3d start{p0.x(), p0.y(), parent->yaw};
+        trajectory.insert(parent->time, start, zero);
+        if (alt->yaw.has_value())
+        {
+          const Eigen::Vector3d finish{p0.x(), p0.y(), *alt->yaw};
+          internal::interpolate_rotation(
+            trajectory, _w_nom, _alpha_nom, parent->time,
+            start, finish, _rotation_threshold);
+        }
+
+        node->route_from_parent =
+          {{waypoint.get_map_name(), std::move(trajectory)}};
+        return;
+      }
+      case RouteRecipe::Kind::Traverse:
+      {
+        const auto& traversal = *recipe.traversal;
+        const auto& alt = traversal.alternatives[recipe.alternative];
+        const auto& waypoint = _supergraph->original()
+          .waypoints[traversal.initial_waypoint_index];
+
+        // The parent is either the approach node or the node that the
+        // traversal was expanded from, so it sits where the entry event begins.
+        auto ready_time = parent->time;
+        std::optional<Route> entry_event_route;
+        if (traversal.entry_event
+          && traversal.entry_event_duration > Duration(0))
+        {
+          const Eigen::Vector2d p0 = waypoint.get_location();
+          const Eigen::Vector3d position{p0.x(), p0.y(), parent->yaw};
+          ready_time += traversal.entry_event_duration;
+
+          Trajectory trajectory;
+          trajectory.insert(parent->time, position, zero);
+          trajectory.insert(ready_time, position, zero);
+          entry_event_route = Route{waypoint.get_map_name(), trajectory};
+        }
+
+        auto routes = alt->free_routes(ready_time, parent->yaw).routes;
+        if (entry_event_route.has_value())
+        {
+          auto& front = routes.front();
+          if (entry_event_route->map() == front.map())
+          {
+            for (const auto& wp : entry_event_route->trajectory())
+              front.trajectory().insert(wp);
+          }
+          else
+          {
+            routes.insert(routes.begin(), std::move(*entry_event_route));
+          }
+        }
+
+        node->route_from_parent = std::move(routes);
+        return;
+      }
+    }
+  }
+
+  /// Materialize a node and every ancestor of it. Nodes that store their
+  /// routes can sit between lazy nodes, so the whole lineage is visited.
+  void materialize_lineage(SearchNodePtr node) const
+  {
+    for (; node; node = node->parent)
+      materialize(node);
+  }
+
   bool quit(const SearchNodePtr& top, SearchQueue& queue) const
   {
     ++_internal->popped_count;
+    auto& peak_queue_size = _internal->search_statistics.peak_queue_size;
+    peak_queue_size = std::max(peak_queue_size, queue.size() + 1);
 
     if (_saturation_limit.has_value())
     {
@@ -880,6 +1429,10 @@ public:
 
   bool is_finished(const SearchNodePtr& top) const
   {
+    // The rest of a free solution still needs to be followed
+    if (top->free_solution)
+      return false;
+
     if (_goal_time.has_value())
     {
       if (top->time < *_goal_time)
@@ -945,21 +1498,10 @@ public:
     for (const auto& approach_trajectory : approach_info.trajectories)
     {
       std::vector<Route> approach_routes;
-      bool all_valid = true;
-
       for (const auto& map : map_names)
-      {
-        Route route{map, approach_trajectory};
-        if (_validator && !is_valid(top, route))
-        {
-          all_valid = false;
-          break;
-        }
-
-        approach_routes.emplace_back(std::move(route));
-      }
+        approach_routes.emplace_back(map, approach_trajectory);
 
-      if (!all_valid)
+      if (_validator && !is_valid(top, approach_routes))
         continue;
 
       std::vector<Route> exit_event_routes;
@@ -970,20 +1512,10 @@ public:
         hold.insert(approached);
         hold.insert(approached.time(), approached.position(), {0, 0, 0});
 
-        bool all_valid = true;
         for (const auto& map : map_names)
-        {
-          Route route{map, hold};
-          if (_validator && !is_valid(top, route))
-          {
-            all_valid = false;
-            break;
-          }
-
-          exit_event_routes.emplace_back(std::move(route));
-        }
+          exit_event_routes.emplace_back(map, hold);
 
-        if (!all_valid)
+        if (_validator && !is_valid(top, exit_event_routes))
           continue;
       }
 
@@ -994,7 +1526,7 @@ public:
       // TODO(MXG): We can actually specify the orientation for this. We just
       // need to be smarter with make_start_approach_trajectories(). We should
       // really have it return a Traversal.
-      auto node = std::make_shared<SearchNode>(
+      auto node = make_node(
         SearchNode{
           std::nullopt,
           target_waypoint_index,
@@ -1012,7 +1544,7 @@ public:
 
       if (exit_event)
       {
-        node = std::make_shared<SearchNode>(
+        node = make_node(
           SearchNode{
             std::nullopt,
             target_waypoint_index,
@@ -1054,7 +1586,7 @@ public:
     }
 
     queue.push(
-      std::make_shared<SearchNode>(
+      make_node(
         SearchNode{
           std::nullopt,
           std::nullopt,
@@ -1074,8 +1606,10 @@ public:
   SearchNodePtr expand_hold(
     const SearchNodePtr& top,
     const Duration hold_time,
-    const double cost_factor) const
+    const double cost_factor,
+    const bool validate = true) const
   {
+    ++_internal->search_statistics.hold_expansions;
     const std::size_t wp_index = top->waypoint.value();
     if (_supergraph->original().waypoints[wp_index].is_passthrough_point())
       return nullptr;
@@ -1091,16 +1625,25 @@ public:
     const auto finish_time = start_time + hold_time;
     const auto cost = cost_factor * time::to_seconds(hold_time);
 
-    Trajectory trajectory;
-    trajectory.insert(start_time, position, zero);
-    trajectory.insert(finish_time, position, zero);
+    if (validate)
+    {
+      Trajectory trajectory;
+      trajectory.insert(start_time, position, zero);
+      trajectory.insert(finish_time, position, zero);
 
-    Route route{map_name, std::move(trajectory)};
+      Route route{map_name, std::move(trajectory)};
 
-    if (!is_valid(top, route))
-      return nullptr;
+      if (!is_valid(top, route))
+        return nullptr;
+    }
 
-    return std::make_shared<SearchNode>(
+    // Either the hold was just validated or it is inside of a safe interval,
+    // so the robot is known to be able to sit here for the whole hold. Nothing
+    // is proven by a search that has no validator.
+    if (_validator)
+      top->stationary_until = std::max(top->stationary_until, finish_time);
+
+    const auto node = make_node(
       SearchNode{
         top->entry,
         wp_index,
@@ -1109,19 +1652,42 @@ public:
         yaw,
         finish_time,
         top->remaining_cost_estimate,
-        {std::move(route)},
+        {},
         nullptr,
         top->current_cost + cost,
         std::nullopt,
-        top
+        top,
+        RouteRecipe{RouteRecipe::Kind::Hold, 0, nullptr}
       });
+
+    node->stationary_since = top->stationary_since;
+    node->stationary_until = top->stationary_until;
+    return node;
   }
 
   void expand_hold(
     const SearchNodePtr& top,
     SearchQueue& queue) const
   {
-    if (const auto node = expand_hold(top, _holding_time, 1.0))
+    // A hold that stays inside of a safe interval is known to be valid. Once
+    // the interval is about to end, the hold is validated like usual so that
+    // the blocker gets reported.
+    bool validate = true;
+    if (_safe_interval_holding && top->entry.has_value())
+    {
+      const SafeInterval* interval = _find_safe_interval(top);
+      if (!interval)
+        interval = _compute_safe_interval(top);
+
+      validate = !interval || interval->finish < top->time + _holding_time;
+      if (interval)
+      {
+        top->stationary_until =
+          std::max(top->stationary_until, interval->finish);
+      }
+    }
+
+    if (const auto node = expand_hold(top, _holding_time, 1.0, validate))
     {
       if (_should_expand_to(node))
         queue.push(node);
@@ -1156,7 +1722,7 @@ public:
     if (_validator && !is_valid(top, route))
       return nullptr;
 
-    return std::make_shared<SearchNode>(
+    return make_node(
       SearchNode{
         std::nullopt,
         _goal_waypoint,
@@ -1173,321 +1739,614 @@ public:
       });
   }
 
-  bool is_valid(const SearchNodePtr& parent, const Route& route) const
+  /// Record that the schedule blocked an expansion from the parent node
+  void record_conflict(
+    const SearchNodePtr& parent,
+    const RouteValidator::Conflict& conflict) const
   {
-    if (!_validator)
-      return true;
+    // The conflicts of an interrupted expansion may be stand-ins for checks
+    // that never finished, and the expansion will be done again anyway.
+    if (_expansion_interrupted)
+      return;
+
+    auto time_it =
+      _issues->blocked_nodes[conflict.dependency.on_participant]
+      .insert({std::shared_ptr<void>(_internal->arena, parent),
+          conflict.time});
 
-    if (route.trajectory().size() >= 2)
+    if (!time_it.second)
     {
-      auto conflict = _validator->find_conflict(route);
-      if (conflict)
-      {
-        auto time_it =
-          _issues->blocked_nodes[conflict->dependency.on_participant]
-          .insert({parent, conflict->time});
+      time_it.first->second =
+        std::max(time_it.first->second, conflict.time);
+    }
+  }
 
-        if (!time_it.second)
-        {
-          time_it.first->second =
-            std::max(time_it.first->second, conflict->time);
-        }
+  /// Check one route with the given validator
+  std::optional<RouteValidator::Conflict> find_conflict(
+    const Route& route,
+    const RouteValidator* validator) const
+  {
+    // Routes that stay at one point in time cannot conflict with anything
+    if (!validator || route.trajectory().size() < 2)
+      return std::nullopt;
 
-        return false;
-      }
-    }
+    if (!_validation_interrupter)
+      return validator->find_conflict(route);
 
-    return true;
+    return screen_interruption(
+      validator->find_conflict(route, nullptr, _validation_interrupter),
+      route);
   }
 
-  void expand_traversal(
-    const SearchNodePtr& top,
-    const Traversal& traversal,
-    SearchQueue& queue) const
+  /// The answer of a check that was interrupted cannot be trusted, so the
+  /// route is treated as blocked and expand() will put the node back into the
+  /// queue to be expanded again when the search is resumed.
+  std::optional<RouteValidator::Conflict> screen_interruption(
+    std::optional<RouteValidator::Conflict> conflict,
+    const Route& route) const
   {
-    const auto initial_waypoint_index = top->waypoint.value();
-    const auto& initial_waypoint =
-      _supergraph->original().waypoints[initial_waypoint_index];
-    const Eigen::Vector2d p0 = initial_waypoint.get_location();
-    const double initial_yaw = top->yaw;
-    const std::string& initial_map_name = initial_waypoint.get_map_name();
+    if (!_validation_interrupter())
+      return conflict;
 
-    const auto next_waypoint_index = traversal.finish_waypoint_index;
-    const auto& next_waypoint =
-      _supergraph->original().waypoints[next_waypoint_index];
-    const Eigen::Vector2d next_position = next_waypoint.get_location();
-    const std::string& next_map_name = next_waypoint.get_map_name();
+    _expansion_interrupted = true;
+    if (conflict.has_value())
+      return conflict;
 
-    for (std::size_t i = 0; i < traversal.alternatives.size(); ++i)
+    return RouteValidator::Conflict{
+      Dependency{},
+      *route.trajectory().start_time(),
+      nullptr
+    };
+  }
+
+  bool is_valid(const SearchNodePtr& parent, const Route& route) const
+  {
+    const auto conflict = find_conflict(route, _validator);
+    if (!conflict)
+      return true;
+
+    record_conflict(parent, *conflict);
+    return false;
+  }
+
+  /// Check all of the routes with one call to the given validator
+  std::optional<RouteValidator::Conflict> find_conflict(
+    const std::vector<Route>& routes,
+    const RouteValidator* validator) const
+  {
+    if (!validator)
+      return std::nullopt;
+
+    // Routes that stay at one point in time cannot conflict with anything
+    bool all_checkable = true;
+    for (const auto& route : routes)
+      all_checkable &= route.trajectory().size() >= 2;
+
+    const auto check = [&](const std::vector<Route>& checkable)
+      -> std::optional<RouteValidator::Conflict>
+      {
+        if (!_validation_interrupter || checkable.empty())
+          return validator->find_conflicts(checkable);
+
+        return screen_interruption(
+          validator->find_conflicts(
+            checkable, nullptr, _validation_interrupter),
+          checkable.front());
+      };
+
+    if (all_checkable)
+      return check(routes);
+
+    std::vector<Route> checkable;
+    for (const auto& route : routes)
     {
-      const auto& alt = traversal.alternatives[i];
+      if (route.trajectory().size() >= 2)
+        checkable.push_back(route);
+    }
+
+    if (checkable.empty())
+      return std::nullopt;
+
+    return check(checkable);
+  }
+
+  /// Check all of the routes with one call to the validator
+  std::optional<RouteValidator::Conflict> find_conflict(
+    const std::vector<Route>& routes) const
+  {
+    return find_conflict(routes, _validator);
+  }
+
+  bool is_valid(
+    const SearchNodePtr& parent,
+    const std::vector<Route>& routes) const
+  {
+    const auto conflict = find_conflict(routes);
+    if (!conflict)
+      return true;
+
+    record_conflict(parent, *conflict);
+    return false;
+  }
+
+  /// The routes of one alternative of a traversal that got through the
+  /// validator up to the end of the traversal
+  struct CheckedAlternative
+  {
+    Route approach_route;
+    double entry_event_cost;
+    Time finish_time;
+    double finish_yaw;
+    Route exit_event_route;
+    double exit_event_cost;
+    Duration exit_event_duration;
+
+    // A conflict with the exit event only blocks the alternative if the goal
+    // can be reached from the end of the traversal, so it is kept apart.
+    std::optional<RouteValidator::Conflict> exit_conflict;
+  };
+
+  /// The outcome of checking one alternative of a traversal against the
+  /// validator. Checking an alternative does not change the search, so the
+  /// alternatives of a node can be checked on several threads at once.
+  struct AlternativeCheck
+  {
+    // The conflict that blocked the alternative before the end of the
+    // traversal, if there was one
+    std::optional<RouteValidator::Conflict> conflict;
+    std::optional<CheckedAlternative> checked;
+  };
+
+  AlternativeCheck check_alternative(
+    const SearchNodePtr& top,
+    const Traversal& traversal,
+    const std::size_t i,
+    const RouteValidator* validator,
+    Planner::Result::Statistics& statistics) const
+  {
+    const auto& alt = traversal.alternatives[i];
 
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-      std::cout << "Expanding from " << top->waypoint.value()
-                << " -> " << traversal.finish_waypoint_index << " | "
-                << Orientation(i) << " {" << traversal.entry_event << "}"
-                << std::endl;
+    std::cout << "Expanding from " << top->waypoint.value()
+              << " -> " << traversal.finish_waypoint_index << " | "
+              << Orientation(i) << " {" << traversal.entry_event << "}"
+              << std::endl;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-      if (!alt.has_value())
-      {
+    if (!alt.has_value())
+    {
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-        std::cout << " ==== nullopt alternative" << std::endl;
+      std::cout << " ==== nullopt alternative" << std::endl;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-        continue;
-      }
+      return {};
+    }
 
-      const Orientation orientation = Orientation(i);
+    const auto& initial_waypoint =
+      _supergraph->original().waypoints[top->waypoint.value()];
+    const Eigen::Vector2d p0 = initial_waypoint.get_location();
+    const double initial_yaw = top->yaw;
+    const std::string& initial_map_name = initial_waypoint.get_map_name();
+    const std::string& next_map_name =
+      _supergraph->original().waypoints[traversal.finish_waypoint_index]
+      .get_map_name();
 
-      Time start_time = top->time;
-      const auto traversal_yaw = alt->yaw;
+    Time start_time = top->time;
+    const auto traversal_yaw = alt->yaw;
 
-      Trajectory approach_trajectory;
-      const Eigen::Vector3d start{p0.x(), p0.y(), initial_yaw};
-      approach_trajectory.insert(
-        start_time, start, Eigen::Vector3d::Zero());
+    Trajectory approach_trajectory;
+    const Eigen::Vector3d start{p0.x(), p0.y(), initial_yaw};
+    approach_trajectory.insert(
+      start_time, start, Eigen::Vector3d::Zero());
 
-      // TODO(MXG): We could push the logic for creating this trajectory
-      // upstream into the traversal alternative.
+    // TODO(MXG): We could push the logic for creating this trajectory
+    // upstream into the traversal alternative.
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-      double approach_cost = 0.0;
+    double approach_cost = 0.0;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-      if (traversal_yaw.has_value())
-      {
-        const Eigen::Vector3d finish{p0.x(), p0.y(), * traversal_yaw};
-        internal::interpolate_rotation(
-          approach_trajectory, _w_nom, _alpha_nom, start_time,
-          start, finish, _rotation_threshold);
+    if (traversal_yaw.has_value())
+    {
+      const Eigen::Vector3d finish{p0.x(), p0.y(), * traversal_yaw};
+      internal::interpolate_rotation(
+        approach_trajectory, _w_nom, _alpha_nom, start_time,
+        start, finish, _rotation_threshold);
 
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-        approach_cost = calculate_cost(approach_trajectory);
+      approach_cost = calculate_cost(approach_trajectory);
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-      }
+    }
 
-      auto approach_route =
-        Route{
-        initial_map_name,
-        std::move(approach_trajectory)
-      };
+    auto approach_route =
+      Route{
+      initial_map_name,
+      std::move(approach_trajectory)
+    };
 
-      if (!is_valid(top, approach_route))
-      {
+    if (auto conflict = find_conflict(approach_route, validator))
+    {
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-        std::cout << " ==== Invalid approach route" << std::endl;
+      std::cout << " ==== Invalid approach route" << std::endl;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-        continue;
-      }
+      return {std::move(conflict), std::nullopt};
+    }
 
-      Trajectory entry_event_trajectory;
-      const auto& approach_wp = approach_route.trajectory().back();
-      entry_event_trajectory.insert(approach_wp);
-      double entry_event_cost = 0.0;
-      if (traversal.entry_event
-        && traversal.entry_event->duration() > Duration(0))
-      {
-        const auto duration = traversal.entry_event->duration();
-        entry_event_cost = time::to_seconds(duration);
+    Trajectory entry_event_trajectory;
+    const auto& approach_wp = approach_route.trajectory().back();
+    entry_event_trajectory.insert(approach_wp);
+    double entry_event_cost = 0.0;
+    if (traversal.entry_event
+      && traversal.entry_event_duration > Duration(0))
+    {
+      const auto duration = traversal.entry_event_duration;
+      entry_event_cost = time::to_seconds(duration);
 
-        entry_event_trajectory.insert(
-          approach_wp.time() + duration,
-          approach_wp.position(), Eigen::Vector3d::Zero());
-      }
+      entry_event_trajectory.insert(
+        approach_wp.time() + duration,
+        approach_wp.position(), Eigen::Vector3d::Zero());
+    }
 
-      auto entry_event_route =
-        Route{
-        initial_map_name,
-        std::move(entry_event_trajectory)
-      };
+    auto entry_event_route =
+      Route{
+      initial_map_name,
+      std::move(entry_event_trajectory)
+    };
 
-      if (!is_valid(top, entry_event_route))
-      {
+    if (auto conflict = find_conflict(entry_event_route, validator))
+    {
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-        std::cout << " ==== Invalid entry event route" << std::endl;
+      std::cout << " ==== Invalid entry event route" << std::endl;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-        continue;
-      }
-
-      const auto& ready_wp = entry_event_route.trajectory().back();
-      const auto ready_time = ready_wp.time();
-      const double ready_yaw = ready_wp.position()[2];
-      auto traversal_result = alt->routes(std::nullopt)(ready_time, ready_yaw);
+      return {std::move(conflict), std::nullopt};
+    }
 
-      bool all_valid = true;
-      for (const auto& r : traversal_result.routes)
+    const auto& ready_wp = entry_event_route.trajectory().back();
+    const auto ready_time = ready_wp.time();
+    const double ready_yaw = ready_wp.position()[2];
+    auto traversal_result = [&]()
       {
-        if (!is_valid(top, r))
-        {
-          all_valid = false;
-          break;
-        }
-      }
+        const TrajectoryTimer timer(statistics);
+        return alt->free_routes(ready_time, ready_yaw);
+      }();
 
-      if (!all_valid)
-      {
+    if (auto conflict = find_conflict(traversal_result.routes, validator))
+    {
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-        std::cout << " ==== Invalid traversal" << std::endl;
+      std::cout << " ==== Invalid traversal" << std::endl;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-        continue;
-      }
+      return {std::move(conflict), std::nullopt};
+    }
 
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-      std::cout << " --------" << std::endl;
+    std::cout << " --------" << std::endl;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-      const auto remaining_cost_estimate = _heuristic.compute(
-        next_waypoint_index, traversal_result.finish_yaw);
+    const auto& arrival_wp =
+      traversal_result.routes.back().trajectory().back();
+
+    Trajectory exit_event_trajectory;
+    exit_event_trajectory.insert(arrival_wp);
+    double exit_event_cost = 0.0;
+    Duration exit_event_duration = Duration(0);
+    if (traversal.exit_event
+      && traversal.exit_event_duration > Duration(0))
+    {
+      exit_event_duration = traversal.exit_event_duration;
+      exit_event_cost = time::to_seconds(exit_event_duration);
+
+      exit_event_trajectory.insert(
+        arrival_wp.time() + exit_event_duration,
+        arrival_wp.position(), Eigen::Vector3d::Zero());
+    }
 
-      if (!remaining_cost_estimate.has_value())
-      {
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-        std::cout << " ==== nullopt heuristic" << std::endl;
+    std::cout << "Cost " << approach_cost + entry_event_cost + alt->cost
+      + exit_event_cost << " = " << "Approach: " << approach_cost
+              << " | Entry: " << entry_event_cost << " | Alt: " << alt->cost
+              << " | Exit: " << exit_event_cost << std::endl;
+    std::cout << "Previous cost " << top->current_cost << " + Cost "
+              << approach_cost + entry_event_cost + alt->cost
+      + exit_event_cost << " = " << top->current_cost
+      + approach_cost + entry_event_cost + alt->cost
+      + exit_event_cost << std::endl;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-        continue;
+    auto exit_event_route =
+      Route{
+      next_map_name,
+      std::move(exit_event_trajectory)
+    };
+
+    auto exit_conflict = find_conflict(exit_event_route, validator);
+
+    return {
+      std::nullopt,
+      CheckedAlternative{
+        std::move(approach_route),
+        entry_event_cost,
+        traversal_result.finish_time,
+        traversal_result.finish_yaw,
+        std::move(exit_event_route),
+        exit_event_cost,
+        exit_event_duration,
+        std::move(exit_conflict)
       }
+    };
+  }
+
+  /// Push the nodes of an alternative that has been checked
+  void push_alternative(
+    const SearchNodePtr& top,
+    const Traversal& traversal,
+    const std::size_t i,
+    AlternativeCheck& check,
+    SearchQueue& queue) const
+  {
+    if (check.conflict.has_value())
+    {
+      record_conflict(top, *check.conflict);
+      return;
+    }
 
-      const auto& arrival_wp =
-        traversal_result.routes.back().trajectory().back();
+    if (!check.checked.has_value())
+      return;
 
-      Trajectory exit_event_trajectory;
-      exit_event_trajectory.insert(arrival_wp);
-      double exit_event_cost = 0.0;
-      Duration exit_event_duration = Duration(0);
-      if (traversal.exit_event
-        && traversal.exit_event->duration() > Duration(0))
-      {
-        exit_event_duration = traversal.exit_event->duration();
-        exit_event_cost = time::to_seconds(exit_event_duration);
+    auto& checked = *check.checked;
+    const auto& alt = traversal.alternatives[i];
+    const Orientation orientation = Orientation(i);
+    const auto initial_waypoint_index = top->waypoint.value();
+    const Eigen::Vector2d p0 =
+      _supergraph->original().waypoints[initial_waypoint_index].get_location();
+    const auto next_waypoint_index = traversal.finish_waypoint_index;
+    const Eigen::Vector2d next_position =
+      _supergraph->original().waypoints[next_waypoint_index].get_location();
 
-        exit_event_trajectory.insert(
-          arrival_wp.time() + exit_event_duration,
-          arrival_wp.position(), Eigen::Vector3d::Zero());
-      }
+    const auto remaining_cost_estimate = _heuristic.compute(
+      next_waypoint_index, checked.finish_yaw,
+      &_internal->heuristic_lookups);
 
+    if (!remaining_cost_estimate.has_value())
+    {
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-      std::cout << "Cost " << approach_cost + entry_event_cost + alt->cost
-        + exit_event_cost << " = " << "Approach: " << approach_cost
-                << " | Entry: " << entry_event_cost << " | Alt: " << alt->cost
-                << " | Exit: " << exit_event_cost << std::endl;
-      std::cout << "Previous cost " << top->current_cost << " + Cost "
-                << approach_cost + entry_event_cost + alt->cost
-        + exit_event_cost << " = " << top->current_cost
-        + approach_cost + entry_event_cost + alt->cost
-        + exit_event_cost << std::endl;
+      std::cout << " ==== nullopt heuristic" << std::endl;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-      auto exit_event_route =
-        Route{
-        next_map_name,
-        std::move(exit_event_trajectory)
-      };
+      return;
+    }
 
-      if (!is_valid(top, exit_event_route))
-      {
+    if (checked.exit_conflict.has_value())
+    {
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-        std::cout << " ==== invalid exit event" << std::endl;
+      std::cout << " ==== invalid exit event" << std::endl;
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-        continue;
-      }
+      record_conflict(top, *checked.exit_conflict);
+      return;
+    }
 
-      auto node = top;
-      if (approach_route.trajectory().size() >= 2 || traversal.entry_event)
-      {
-        const double cost = calculate_cost(approach_route.trajectory());
-        const double yaw = approach_wp.position()[2];
-        const auto time = approach_wp.time();
+    const auto& approach_route = checked.approach_route;
+    const double entry_event_cost = checked.entry_event_cost;
+    const double exit_event_cost = checked.exit_event_cost;
 
-        node = std::make_shared<SearchNode>(
-          SearchNode{
-            Entry{
-              traversal.initial_lane_index,
-              orientation,
-              Side::Start
-            },
-            initial_waypoint_index,
-            {},
-            p0,
-            yaw,
-            time,
-            *remaining_cost_estimate
-            + entry_event_cost + alt->cost + exit_event_cost,
-            {std::move(approach_route)},
-            traversal.entry_event,
-            node->current_cost + cost,
-            std::nullopt,
-            node
-          });
-      }
+    auto node = top;
+    if (approach_route.trajectory().size() >= 2 || traversal.entry_event)
+    {
+      const auto& approach_wp = approach_route.trajectory().back();
+      const double cost = calculate_cost(approach_route.trajectory());
+      const double yaw = approach_wp.position()[2];
+      const auto time = approach_wp.time();
 
-      if (entry_event_route.trajectory().size() >= 2)
-      {
-        auto& front = traversal_result.routes.front();
-        if (entry_event_route.map() == front.map())
-        {
-          for (const auto& wp : entry_event_route.trajectory())
-            front.trajectory().insert(wp);
-        }
-        else
-        {
-          traversal_result.routes.insert(
-            traversal_result.routes.begin(),
-            entry_event_route);
-        }
-      }
+      node = make_node(
+        SearchNode{
+          Entry{
+            traversal.initial_lane_index,
+            orientation,
+            Side::Start
+          },
+          initial_waypoint_index,
+          {},
+          p0,
+          yaw,
+          time,
+          *remaining_cost_estimate
+          + entry_event_cost + alt->cost + exit_event_cost,
+          {},
+          traversal.entry_event,
+          node->current_cost + cost,
+          std::nullopt,
+          node,
+          RouteRecipe{
+            RouteRecipe::Kind::Approach,
+            static_cast<uint8_t>(i),
+            &traversal
+          }
+        });
+    }
 
-      const Entry finish_key = Entry{
-        traversal.initial_lane_index,
-        orientation,
-        Side::Finish
-      };
+    // The entry event route gets merged into the traversal routes when the
+    // node is materialized.
 
-      node = std::make_shared<SearchNode>(
+    const Entry finish_key = Entry{
+      traversal.initial_lane_index,
+      orientation,
+      Side::Finish
+    };
+
+    node = make_node(
+      SearchNode{
+        traversal.exit_event ? std::nullopt : std::make_optional(finish_key),
+        next_waypoint_index,
+        traversal.traversed_lanes,
+        next_position,
+        checked.finish_yaw,
+        checked.finish_time,
+        *remaining_cost_estimate + exit_event_cost,
+        {},
+        traversal.exit_event,
+        node->current_cost + entry_event_cost + alt->cost,
+        std::nullopt,
+        node,
+        RouteRecipe{
+          RouteRecipe::Kind::Traverse,
+          static_cast<uint8_t>(i),
+          &traversal
+        }
+      });
+
+    if (traversal.exit_event
+      && checked.exit_event_route.trajectory().size() >= 2)
+    {
+      node = make_node(
         SearchNode{
-          traversal.exit_event ? std::nullopt : std::make_optional(finish_key),
+          finish_key,
           next_waypoint_index,
-          traversal.traversed_lanes,
+          {},
           next_position,
-          traversal_result.finish_yaw,
-          traversal_result.finish_time,
-          *remaining_cost_estimate + exit_event_cost,
-          std::move(traversal_result.routes),
-          traversal.exit_event,
-          node->current_cost + entry_event_cost + alt->cost,
+          checked.finish_yaw,
+          checked.finish_time + checked.exit_event_duration,
+          *remaining_cost_estimate,
+          {std::move(checked.exit_event_route)},
+          nullptr,
+          node->current_cost + exit_event_cost,
           std::nullopt,
           node
         });
+    }
+
+#ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
+    std::cout << " ^^^^^^^^^^^^^^ Pushing" << std::endl;
+#endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
+
+    if (_should_expand_to(node))
+      queue.push(node);
+  }
+
+  void expand_traversal(
+    const SearchNodePtr& top,
+    const Traversal& traversal,
+    SearchQueue& queue) const
+  {
+    for (std::size_t i = 0; i < traversal.alternatives.size(); ++i)
+    {
+      auto check = check_alternative(
+        top, traversal, i, _validator, _internal->search_statistics);
+      push_alternative(top, traversal, i, check, queue);
+    }
+  }
+
+  /// Check the alternatives of the traversals on the expansion pool, and then
+  /// push the valid ones in the same order that expand_traversal() would have
+  /// pushed them, so the search does not depend on the timing of the threads.
+  void expand_traversals_in_parallel(
+    const SearchNodePtr& top,
+    const std::vector<const Traversal*>& traversals,
+    SearchQueue& queue) const
+  {
+    struct Task
+    {
+      const Traversal* traversal;
+      std::size_t alternative;
+    };
 
-      if (traversal.exit_event && exit_event_route.trajectory().size() >= 2)
+    std::vector<Task> tasks;
+    for (const auto* traversal : traversals)
+    {
+      for (std::size_t i = 0; i < traversal->alternatives.size(); ++i)
       {
-        node = std::make_shared<SearchNode>(
-          SearchNode{
-            finish_key,
-            next_waypoint_index,
-            {},
-            next_position,
-            traversal_result.finish_yaw,
-            traversal_result.finish_time + exit_event_duration,
-            *remaining_cost_estimate,
-            {std::move(exit_event_route)},
-            nullptr,
-            node->current_cost + exit_event_cost,
-            std::nullopt,
-            node
-          });
+        if (traversal->alternatives[i].has_value())
+          tasks.push_back({traversal, i});
       }
+    }
+
+    // The statistics of the search cannot be shared between the threads, so
+    // each check is measured separately and added in afterwards.
+    std::vector<AlternativeCheck> checks(tasks.size());
+    std::vector<Planner::Result::Statistics> statistics(tasks.size());
+    _expansion_pool->run(
+      tasks.size(), [&](const std::size_t t)
+      {
+        const MeasuredRouteValidator validator(
+          _unmeasured_validator, &statistics[t]);
+
+        checks[t] = check_alternative(
+          top, *tasks[t].traversal, tasks[t].alternative,
+          &validator, statistics[t]);
+      });
+
+    for (std::size_t t = 0; t < tasks.size(); ++t)
+    {
+      _internal->search_statistics += statistics[t];
+      push_alternative(
+        top, *tasks[t].traversal, tasks[t].alternative, checks[t], queue);
+    }
+  }
+
+  /// Make the search node that follows one node of a free solution
+  SearchNodePtr step_freely(
+    const SearchNodePtr& search_node,
+    const DifferentialDriveMapTypes::SolutionNode& solution_node) const
+  {
+    assert(solution_node.route_factory);
 
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-      std::cout << " ^^^^^^^^^^^^^^ Pushing" << std::endl;
+    std::cout << "(" << search_node->current_cost << "; ";
+    if (search_node->waypoint.has_value())
+      std::cout << search_node->waypoint.value();
+    else
+      std::cout << "null";
+
+    std::cout << ", " << search_node->yaw << ") ";
+    if (solution_node.info.entry.has_value())
+      std::cout << *solution_node.info.entry;
+    else
+      std::cout << "[null]";
+
+    std::cout << " <" << solution_node.info.cost_from_parent
+              << " : " << solution_node.info.remaining_cost_estimate
+              << "> --> ";
 #endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
 
-      if (_should_expand_to(node))
-        queue.push(node);
+    auto route_info = solution_node.route_factory(
+      search_node->time, search_node->yaw);
+
+    return make_node(
+      SearchNode{
+        solution_node.info.entry,
+        solution_node.info.waypoint,
+        solution_node.info.approach_lanes,
+        solution_node.info.position,
+        route_info.finish_yaw,
+        route_info.finish_time,
+        solution_node.info.remaining_cost_estimate,
+        std::move(route_info.routes),
+        solution_node.info.event,
+        search_node->current_cost + solution_node.info.cost_from_parent,
+        std::nullopt,
+        search_node
+      });
+  }
+
+  /// Turn the rest of the free solution of a node into search nodes. This is
+  /// only done for the nodes that get popped from the queue, because nothing
+  /// can get in the way of a free solution, so only the cheapest one matters.
+  void follow_freely(const SearchNodePtr& top, SearchQueue& queue) const
+  {
+    auto search_node = top;
+    auto solution_node = std::move(top->free_solution);
+    top->free_solution = nullptr;
+    while (solution_node)
+    {
+      search_node = step_freely(search_node, *solution_node);
+      solution_node = solution_node->child;
     }
+
+#ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
+    std::cout << std::endl;
+#endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
+
+    queue.push(search_node);
   }
 
   void expand_freely(
@@ -1495,13 +2354,16 @@ public:
     SearchQueue& queue) const
   {
     // This function is used when there is no validator. We can just expand
-    // freely to the goal without validating the results.
+    // freely to the goal without validating the results. Only the first node
+    // of each solution is made here, and the rest of the solution is kept
+    // aside until that node gets popped.
     const auto keys = _supergraph->keys_for(
       top->waypoint.value(), _goal_waypoint, _goal_yaw);
 
     for (const auto& key : keys)
     {
-      const auto solution_root = _heuristic.cache().get(key);
+      const auto solution_root =
+        _heuristic.cache().get(key, &_internal->heuristic_lookups);
       if (!solution_root)
       {
         // There is no solution for this key
@@ -1509,12 +2371,13 @@ public:
       }
 
       auto search_node = top;
+      auto solution_node = solution_root->child;
 
       auto approach_info = solution_root->route_factory(top->time, top->yaw);
       if (approach_info.routes.back().trajectory().size() >= 2
         || solution_root->info.event)
       {
-        search_node = std::make_shared<SearchNode>(
+        search_node = make_node(
           SearchNode{
             solution_root->info.entry,
             solution_root->info.waypoint,
@@ -1530,60 +2393,14 @@ public:
             search_node
           });
       }
-
-      auto solution_node = solution_root->child;
-
-#ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-//      std::cout << "Free solution: ";
-#endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-
-      while (solution_node)
+      else if (solution_node)
       {
-        assert(solution_node->route_factory);
-
-#ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-        std::cout << "(" << search_node->current_cost << "; ";
-        if (search_node->waypoint.has_value())
-          std::cout << top->waypoint.value();
-        else
-          std::cout << "null";
-
-        std::cout << ", " << search_node->yaw << ") ";
-        if (solution_node->info.entry.has_value())
-          std::cout << *solution_node->info.entry;
-        else
-          std::cout << "[null]";
-
-        std::cout << " <" << solution_node->info.cost_from_parent
-                  << " : " << solution_node->info.remaining_cost_estimate
-                  << "> --> ";
-#endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-
-        auto route_info = solution_node->route_factory(
-          search_node->time, search_node->yaw);
-
-        search_node = std::make_shared<SearchNode>(
-          SearchNode{
-            solution_node->info.entry,
-            solution_node->info.waypoint,
-            solution_node->info.approach_lanes,
-            solution_node->info.position,
-            route_info.finish_yaw,
-            route_info.finish_time,
-            solution_node->info.remaining_cost_estimate,
-            std::move(route_info.routes),
-            solution_node->info.event,
-            search_node->current_cost + solution_node->info.cost_from_parent,
-            std::nullopt,
-            search_node
-          });
-
+        search_node = step_freely(search_node, *solution_node);
         solution_node = solution_node->child;
       }
 
-#ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
-      std::cout << std::endl;
-#endif // RMF_TRAFFIC__AGV__PLANNING__DEBUG__PLANNER
+      if (search_node != top)
+        search_node->free_solution = std::move(solution_node);
 
       queue.push(search_node);
     }
@@ -1591,10 +2408,41 @@ public:
 
   void expand(const SearchNodePtr& top, SearchQueue& queue) const
   {
-    if (!_should_expand_from(top))
+    // A node whose last expansion was interrupted has already been marked as
+    // expanded, but it still needs to be expanded properly.
+    const bool unfinished = top == _unfinished_expansion;
+    if (unfinished)
+      _unfinished_expansion = nullptr;
+
+    _expansion_interrupted = false;
+    expand_node(top, queue, unfinished);
+    if (_expansion_interrupted)
     {
-      // This means we have already expanded from this location before, at
-      // approximately the same time, so there is no value in expanding this
+      // Some of the children of this node may have been rejected by checks
+      // that never finished, so the node goes back into the queue where a
+      // resumed search will find it again.
+      _expansion_interrupted = false;
+      _unfinished_expansion = top;
+      queue.push(top);
+    }
+  }
+
+  void expand_node(
+    const SearchNodePtr& top,
+    SearchQueue& queue,
+    const bool unfinished) const
+  {
+    RMF_TRAFFIC_TRACE("planner.expand");
+    if (top->free_solution)
+    {
+      follow_freely(top, queue);
+      return;
+    }
+
+    if (!unfinished && !_should_expand_from(top))
+    {
+      // This means we have already expanded from this location before, at
+      // approximately the same time, so there is no value in expanding this
       // again.
       return;
     }
@@ -1656,8 +2504,29 @@ public:
     }
 
     const auto traversals = _supergraph->traversals_from(current_wp_index);
+    _internal->traversals.insert(traversals);
+    const bool contract = _supergraph->contract_corridors();
+    std::vector<const Traversal*> expansions;
+    expansions.reserve(traversals->size());
     for (const auto& traversal : *traversals)
-      expand_traversal(top, traversal, queue);
+    {
+      // A longer traversal passes through the end of this one, so there is no
+      // need to consider stopping there.
+      if (contract && traversal.corridor
+        && traversal.finish_waypoint_index != _goal_waypoint)
+        continue;
+
+      expansions.push_back(&traversal);
+    }
+
+    if (_expansion_pool && expansions.size() > 1)
+    {
+      expand_traversals_in_parallel(top, expansions, queue);
+      return;
+    }
+
+    for (const auto* traversal : expansions)
+      expand_traversal(top, *traversal, queue);
   }
 
   struct ApproachInfo
@@ -1799,7 +2668,8 @@ public:
         const double yaw = approach.back().position()[2];
         double cost = calculate_cost(approach);
         const auto heuristic_cost_estimate =
-          _heuristic.compute(initial_waypoint_index, yaw);
+          _heuristic.compute(
+          initial_waypoint_index, yaw, &_internal->heuristic_lookups);
 
         if (!heuristic_cost_estimate.has_value())
           continue;
@@ -1840,7 +2710,8 @@ public:
     {
       node_waypoint = initial_waypoint_index;
       const auto heuristic_cost_estimate =
-        _heuristic.compute(initial_waypoint_index, initial_yaw);
+        _heuristic.compute(
+        initial_waypoint_index, initial_yaw, &_internal->heuristic_lookups);
 
       if (!heuristic_cost_estimate.has_value())
       {
@@ -1865,7 +2736,7 @@ public:
 
     assert(!start_point_trajectory.empty());
 
-    return std::make_shared<SearchNode>(
+    return make_node(
       SearchNode{
         std::nullopt,
         node_waypoint,
@@ -1882,6 +2753,135 @@ public:
       });
   }
 
+  /// Copy the part of a previous solution that comes after a new start into
+  /// the arena of this search, as long as that part is still valid. The new
+  /// start must be at a waypoint of the previous solution, no later than the
+  /// previous solution was there. The last node of the copy is returned so it
+  /// can seed the queue of this search, or a nullptr if nothing can be reused.
+  SearchNodePtr reuse_solution(
+    const ConstSearchNodePtr& previous_solution,
+    const Planner::Start& start) const
+  {
+    if (start.location().has_value())
+      return nullptr;
+
+    // Find the earliest node of the previous solution that the new start can
+    // wait for.
+    std::vector<ConstSearchNodePtr> suffix;
+    std::optional<std::size_t> match;
+    for (auto node = previous_solution; node; node = node->parent)
+    {
+      if (node->time < start.time())
+        break;
+
+      suffix.push_back(node);
+      if (node->waypoint != start.waypoint())
+        continue;
+
+      const double yaw_diff =
+        rmf_utils::wrap_to_pi(node->yaw - start.orientation());
+      if (std::abs(yaw_diff) <= _rotation_threshold)
+        match = suffix.size() - 1;
+    }
+
+    if (!match.has_value())
+      return nullptr;
+
+    suffix.resize(*match + 1);
+    std::reverse(suffix.begin(), suffix.end());
+    const auto& matched = suffix.front();
+
+    // The schedule may have changed since the previous search, so every route
+    // that we reuse needs to be checked again.
+    for (std::size_t i = 1; i < suffix.size(); ++i)
+    {
+      const auto& routes = suffix[i]->route_from_parent;
+      if (routes.empty())
+        return nullptr;
+
+      if (find_conflict(routes))
+        return nullptr;
+    }
+
+    const std::size_t wp_index = start.waypoint();
+    const auto& waypoint = _supergraph->original().waypoints[wp_index];
+    const auto& map_name = waypoint.get_map_name();
+    const Eigen::Vector2d p = waypoint.get_location();
+    const Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+
+    Trajectory start_trajectory;
+    start_trajectory.insert(
+      start.time(), {p.x(), p.y(), start.orientation()}, zero);
+
+    SearchNodePtr parent = make_node(
+      SearchNode{
+        std::nullopt,
+        wp_index,
+        {},
+        p,
+        start.orientation(),
+        start.time(),
+        matched->remaining_cost_estimate,
+        {{map_name, std::move(start_trajectory)}},
+        nullptr,
+        0.0,
+        start,
+        nullptr
+      });
+
+    double cost_offset = -matched->current_cost;
+    if (start.time() < matched->time)
+    {
+      // Wait at the start until the previous solution was there
+      Trajectory hold;
+      hold.insert(start.time(), {p.x(), p.y(), matched->yaw}, zero);
+      hold.insert(matched->time, {p.x(), p.y(), matched->yaw}, zero);
+      Route route{map_name, std::move(hold)};
+      if (_validator && _validator->find_conflict(route))
+        return nullptr;
+
+      const double hold_cost = time::to_seconds(matched->time - start.time());
+      cost_offset += hold_cost;
+      parent = make_node(
+        SearchNode{
+          matched->entry,
+          wp_index,
+          {},
+          p,
+          matched->yaw,
+          matched->time,
+          matched->remaining_cost_estimate,
+          {std::move(route)},
+          nullptr,
+          hold_cost,
+          std::nullopt,
+          parent
+        });
+    }
+
+    for (std::size_t i = 1; i < suffix.size(); ++i)
+    {
+      const auto& node = suffix[i];
+      parent = make_node(
+        SearchNode{
+          node->entry,
+          node->waypoint,
+          node->approach_lanes,
+          node->position,
+          node->yaw,
+          node->time,
+          node->remaining_cost_estimate,
+          node->route_from_parent,
+          node->event,
+          node->current_cost + cost_offset,
+          std::nullopt,
+          parent
+        });
+    }
+
+    return parent;
+  }
+
   struct RolloutEntry
   {
     Time initial_time;
@@ -1894,8 +2894,7 @@ public:
 
     Duration span() const
     {
-      return *node->route_from_parent.back().trajectory().finish_time()
-        - initial_time;
+      return node->time - initial_time;
     }
   };
 
@@ -1908,17 +2907,16 @@ public:
       .at(*waypoint_index).is_holding_point();
   }
 
-  std::vector<schedule::Itinerary> rollout(
-    const Duration max_span,
-    const Issues::BlockedNodes& nodes,
-    std::optional<std::size_t> max_rollouts) const
+  /// Choose the blocked nodes that rollouts should begin from.
+  std::vector<RolloutEntry> rollout_roots(
+    const Issues::BlockedNodes& nodes) const
   {
     std::vector<RolloutEntry> rollout_queue;
     for (const auto& void_node : nodes)
     {
       bool skip = false;
       const auto original_node =
-        std::static_pointer_cast<SearchNode>(void_node.first);
+        static_cast<SearchNodePtr>(void_node.first.get());
 
       const auto original_t = void_node.second;
 
@@ -1933,7 +2931,10 @@ public:
       auto ancestor = original_node->parent;
       while (ancestor)
       {
-        if (nodes.count(ancestor) > 0)
+        // The keys of the blocked nodes are only compared by address, so we
+        // do not need to own the ancestor to look it up.
+        if (nodes.count(std::shared_ptr<void>(std::shared_ptr<void>(),
+          ancestor)) > 0)
         {
           // TODO(MXG): Consider if we should account for the time difference
           // between these conflicts so that we get a broader rollout.
@@ -1964,16 +2965,30 @@ public:
         break;
     }
 
-    std::unordered_map<NodePtr, ConstRoutePtr> route_map;
-    std::vector<schedule::Itinerary> alternatives;
-
-    Issues::BlockerMap temp_blocked_nodes;
+    return rollout_queue;
+  }
 
+  /// Keep rolling out from the entries of the queue until the queue is empty,
+  /// the deadline has passed, or finished_count has reached max_rollouts. The
+  /// nodes where rollouts finished are added to the finished vector. The
+  /// finished_count may be shared by rollouts on other threads.
+  void roll_out(
+    std::vector<RolloutEntry> rollout_queue,
+    const Duration max_span,
+    const std::optional<std::size_t> max_rollouts,
+    const std::optional<Time> deadline,
+    std::atomic_size_t& finished_count,
+    std::vector<SearchNodePtr>& finished) const
+  {
     SearchQueue search_queue;
-    SearchQueue finished_rollouts;
-
     while (!rollout_queue.empty() && !(_interrupter && _interrupter()))
     {
+      if (deadline.has_value() && *deadline <= std::chrono::steady_clock::now())
+        break;
+
+      if (max_rollouts && *max_rollouts <= finished_count.load())
+        break;
+
       const auto top = rollout_queue.back();
       rollout_queue.pop_back();
 
@@ -1986,9 +3001,9 @@ public:
 
       if (stop_expanding)
       {
-        finished_rollouts.push(top.node);
+        finished.push_back(top.node);
 
-        if (max_rollouts && *max_rollouts <= finished_rollouts.size())
+        if (max_rollouts && *max_rollouts <= ++finished_count)
           break;
 
         continue;
@@ -2006,11 +3021,27 @@ public:
         search_queue.pop();
       }
     }
+  }
 
+  /// Turn the nodes where rollouts finished into itineraries, cheapest first.
+  std::vector<schedule::Itinerary> make_rollouts(
+    const std::vector<SearchNodePtr>& finished,
+    const Duration max_span,
+    const std::optional<std::size_t> max_rollouts) const
+  {
+    SearchQueue finished_rollouts;
+    for (const auto& node : finished)
+      finished_rollouts.push(node);
+
+    std::vector<schedule::Itinerary> alternatives;
     while (!finished_rollouts.empty())
     {
+      if (max_rollouts && *max_rollouts <= alternatives.size())
+        break;
+
       auto node = finished_rollouts.top();
       finished_rollouts.pop();
+      materialize_lineage(node);
 
       auto [routes, _] = reconstruct_waypoints(
         reconstruct_nodes(node),
@@ -2033,7 +3064,8 @@ public:
     DifferentialDriveHeuristicAdapter heuristic,
     const Planner::Goal& goal,
     const Planner::Options& options,
-    double traversal_cost_per_meter)
+    double traversal_cost_per_meter,
+    std::shared_ptr<schedule::WorkerPool> expansion_pool = nullptr)
   : _internal(static_cast<InternalState*>(internal)),
     _issues(&issues),
     _supergraph(std::move(supergraph)),
@@ -2041,21 +3073,42 @@ public:
     _goal_waypoint(goal.waypoint()),
     _goal_yaw(rmf_utils::pointer_to_opt(goal.orientation())),
     _goal_time(goal.minimum_time()),
-    _validator(options.validator().get()),
+    _validator(options.get_validator()),
     _holding_time(options.minimum_holding_time()),
     _discrete_time_window(_holding_time/2),
+    _safe_interval_holding(options.safe_interval_holding()),
+    _congestion_field(options.congestion_field()),
     _saturation_limit(options.saturation_limit()),
     _maximum_cost_estimate(options.maximum_cost_estimate()),
     _interrupter(options.interrupter()),
+    _validation_interrupter(
+      options.validation_interrupts() ? options.interrupter() : nullptr),
     _dependency_window(options.dependency_window()),
     _dependency_resolution(options.dependency_resolution()),
     _traversal_cost_per_meter(traversal_cost_per_meter),
-    _already_expanded(4093, EntryHash(_supergraph->original().lanes.size()))
+    _already_expanded(4093, EntryHash(_supergraph->original().lanes.size())),
+    _safe_intervals(64, EntryHash(_supergraph->original().lanes.size())),
+    _expansion_pool(std::move(expansion_pool))
   {
     const auto& angular = _supergraph->traits().rotational();
     _w_nom = angular.get_nominal_velocity();
     _alpha_nom = angular.get_nominal_acceleration();
     _rotation_threshold = _supergraph->options().rotation_thresh;
+
+    if (_validator && options.conflict_options().has_value())
+    {
+      _configured_validator = std::make_shared<ConfiguredRouteValidator>(
+        _validator, *options.conflict_options());
+      _validator = _configured_validator.get();
+    }
+
+    _unmeasured_validator = _validator;
+    if (_validator)
+    {
+      _measured_validator = std::make_shared<MeasuredRouteValidator>(
+        _validator, &_internal->search_statistics);
+      _validator = _measured_validator.get();
+    }
   }
 
   class Debugger : public Interface::Debugger
@@ -2144,6 +3197,9 @@ public:
 
     std::size_t next_id = 0;
 
+    // Every node that the debugger has seen is kept in this arena
+    std::shared_ptr<Arena> arena_;
+
     Debugger(
       std::vector<agv::Planner::Start> starts,
       agv::Planner::Goal goal,
@@ -2160,6 +3216,7 @@ public:
       Cache<DifferentialDriveHeuristic> cache)
     {
       InternalState internal;
+      internal.arena = arena_;
       Issues issues;
 
       ScheduledDifferentialDriveExpander expander{
@@ -2194,6 +3251,7 @@ public:
       starts,
       std::move(goal),
       std::move(options));
+    debugger->arena_ = _internal->arena;
 
     for (const auto& start : starts)
     {
@@ -2230,6 +3288,9 @@ public:
     {
       while (!queue.empty())
       {
+        // The debugger does not keep the traversals of the search alive, so
+        // the nodes must be materialized before they are handed over.
+        materialize_lineage(queue.top());
         debugger.queue_.push(debugger.convert(queue.top()));
         queue.pop();
       }
@@ -2238,8 +3299,33 @@ public:
     return std::nullopt;
   }
 
+  /// Validate the routes of a solution that was found by a search without a
+  /// validator, starting from its start node. This returns the latest node
+  /// whose whole lineage is free of conflicts, which may be the solution
+  /// itself. The start node is assumed to be valid already.
+  SearchNodePtr valid_prefix(const SearchNodePtr& solution) const
+  {
+    materialize_lineage(solution);
+    std::vector<SearchNodePtr> lineage;
+    for (auto node = solution; node; node = node->parent)
+      lineage.push_back(node);
+
+    std::reverse(lineage.begin(), lineage.end());
+    SearchNodePtr valid = lineage.front();
+    for (std::size_t i = 1; i < lineage.size(); ++i)
+    {
+      if (!is_valid(valid, lineage[i]->route_from_parent))
+        break;
+
+      valid = lineage[i];
+    }
+
+    return valid;
+  }
+
   PlanData make_plan(const SearchNodePtr& solution) const
   {
+    materialize_lineage(solution);
     auto nodes = reconstruct_nodes(
       solution, _validator, _w_nom, _alpha_nom, _rotation_threshold);
 
@@ -2274,11 +3360,30 @@ private:
   std::optional<double> _goal_yaw;
   std::optional<rmf_traffic::Time> _goal_time;
   const RouteValidator* _validator;
+  std::shared_ptr<const RouteValidator> _configured_validator;
+  std::shared_ptr<const RouteValidator> _measured_validator;
+
+  // The validator without the measurements, so that checks on the expansion
+  // pool can measure themselves into statistics of their own
+  const RouteValidator* _unmeasured_validator;
   Duration _holding_time;
   Duration _discrete_time_window;
+  bool _safe_interval_holding;
+  std::shared_ptr<const CongestionField> _congestion_field;
   std::optional<std::size_t> _saturation_limit;
   std::optional<double> _maximum_cost_estimate;
   std::function<bool()> _interrupter;
+
+  // The interrupter that is passed along to the validator, if the options
+  // allow the validator to be interrupted
+  std::function<bool()> _validation_interrupter;
+
+  // Set when a validator check was interrupted during the current expansion
+  mutable std::atomic_bool _expansion_interrupted = false;
+
+  // The node whose expansion was interrupted the last time it was expanded
+  mutable SearchNodePtr _unfinished_expansion = nullptr;
+
   std::optional<Duration> _dependency_window;
   Duration _dependency_resolution;
   double _w_nom;
@@ -2286,55 +3391,128 @@ private:
   double _rotation_threshold;
   double _traversal_cost_per_meter;
 
-  using TimeSet = std::set<rmf_traffic::Time>;
   using VisitMap = std::unordered_map<
     DifferentialDriveMapTypes::Entry,
-    TimeSet,
+    VisitSet,
     DifferentialDriveMapTypes::EntryHash
   >;
 
   mutable VisitMap _already_expanded;
 
-  std::optional<TimeSet::const_iterator> _get_hint_if_not_redundant(
-    const Time time,
-    const TimeSet& time_set) const
+  /// How far ahead the planner looks when it measures a safe interval
+  static constexpr Duration SafeIntervalHorizon = std::chrono::minutes(5);
+
+  /// A node that was expanded inside of a safe interval
+  struct IntervalVisit
   {
-    const auto greater_or_equal_it = time_set.lower_bound(time);
-    if (greater_or_equal_it == time_set.begin())
-    {
-      if (time + _discrete_time_window < *greater_or_equal_it)
-      {
-        return greater_or_equal_it;
-      }
+    Time time;
+    double cost;
+  };
 
-      // The node's time is within the tolerance of one that was already
-      // expanded
-      return std::nullopt;
-    }
+  /// A span of time that a robot can hold at an entry without a conflict
+  struct SafeInterval
+  {
+    Time start;
+    Time finish;
+    std::vector<IntervalVisit> visits;
+  };
+
+  using SafeIntervalMap = std::unordered_map<
+    DifferentialDriveMapTypes::Entry,
+    std::vector<SafeInterval>,
+    DifferentialDriveMapTypes::EntryHash
+  >;
+
+  mutable SafeIntervalMap _safe_intervals;
+
+  // When this is set, the children of a node are validated on this pool
+  std::shared_ptr<schedule::WorkerPool> _expansion_pool;
+
+  SafeInterval* _find_safe_interval(const SearchNodePtr& node) const
+  {
+    const auto it = _safe_intervals.find(*node->entry);
+    if (it == _safe_intervals.end())
+      return nullptr;
 
-    const auto less_than = --TimeSet::const_iterator(greater_or_equal_it);
-    if (time < *less_than + _discrete_time_window)
+    for (auto& interval : it->second)
     {
-      // The node is within the tolerance of an earlier time
-      return std::nullopt;
+      if (interval.start <= node->time && node->time < interval.finish)
+        return &interval;
     }
 
-    // If we reach this point, the node is far enough from the earlier time, so
-    // now we need to check if it's far enough from any later time.
+    return nullptr;
+  }
+
+  /// Ask the validator how long the robot could hold at the entry of a node.
+  /// Returns a nullptr if it could not even hold for one holding step.
+  const SafeInterval* _compute_safe_interval(const SearchNodePtr& top) const
+  {
+    const std::size_t wp_index = top->waypoint.value();
+    const auto& wp = _supergraph->original().waypoints[wp_index];
+    if (!_validator || wp.is_passthrough_point())
+      return nullptr;
+
+    const Eigen::Vector3d position{top->position.x(), top->position.y(),
+      top->yaw};
+    const Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+    const Time start = top->time;
+    Time finish = start + SafeIntervalHorizon;
 
-    if (greater_or_equal_it == time_set.end())
+    // The validator only promises to report some conflict, not the earliest
+    // one, so we keep checking the shorter hold until it has no conflict.
+    for (std::size_t attempt = 0; attempt < 8; ++attempt)
     {
-      // There is no need to check the node against a later time, because there
-      // is no later time in the set.
-      return greater_or_equal_it;
+      if (finish < start + _holding_time)
+        return nullptr;
+
+      Trajectory hold;
+      hold.insert(start, position, zero);
+      hold.insert(finish, position, zero);
+      const auto conflict =
+        _validator->find_conflict(Route{wp.get_map_name(), std::move(hold)});
+
+      if (!conflict)
+      {
+        auto& intervals = _safe_intervals[*top->entry];
+        intervals.push_back(
+          SafeInterval{start, finish, {{start, top->current_cost}}});
+        return &intervals.back();
+      }
+
+      if (conflict->time < finish)
+        finish = conflict->time - _discrete_time_window;
+      else
+        finish = start + (finish - start)/2;
     }
 
-    if (time + _discrete_time_window < *greater_or_equal_it)
+    return nullptr;
+  }
+
+  /// A node that arrives inside of a safe interval is not worth expanding if
+  /// a node that was expanded earlier in the same interval could have waited
+  /// until this node's time for no more cost.
+  bool _is_dominated_in_interval(const SearchNodePtr& node) const
+  {
+    if (!_safe_interval_holding
+      || node->recipe.kind == RouteRecipe::Kind::Hold)
+      return false;
+
+    SafeInterval* interval = _find_safe_interval(node);
+    if (!interval)
+      return false;
+
+    for (const auto& visit : interval->visits)
     {
-      return greater_or_equal_it;
+      if (visit.time > node->time)
+        continue;
+
+      const double wait = time::to_seconds(node->time - visit.time);
+      if (visit.cost + wait <= node->current_cost + 1e-6)
+        return true;
     }
 
-    return std::nullopt;
+    interval->visits.push_back({node->time, node->current_cost});
+    return false;
   }
 
   bool _should_expand_from(const SearchNodePtr& node) const
@@ -2342,23 +3520,15 @@ private:
     if (!node->entry.has_value())
       return true;
 
-    const auto entry_it = _already_expanded.insert({*node->entry, {}}).first;
-    TimeSet& time_set = entry_it->second;
-    if (time_set.empty())
-    {
-      time_set.insert(node->time);
-      return true;
-    }
-
-    const auto time = node->time;
-    const auto hint = _get_hint_if_not_redundant(time, time_set);
-    if (hint.has_value())
+    if (_is_dominated_in_interval(node)
+      || !_already_expanded[*node->entry].insert(
+        node->time, node->current_cost, _discrete_time_window))
     {
-      time_set.insert(*hint, time);
-      return true;
+      ++_internal->search_statistics.nodes_pruned;
+      return false;
     }
 
-    return false;
+    return true;
   }
 
   bool _should_expand_to(const SearchNodePtr& node) const
@@ -2366,28 +3536,107 @@ private:
     if (!node->entry.has_value())
       return true;
 
-    const auto entry_it = _already_expanded.insert({*node->entry, {}}).first;
-    const TimeSet& time_set = entry_it->second;
-    if (time_set.empty())
+    const auto it = _already_expanded.find(*node->entry);
+    if (it == _already_expanded.end())
       return true;
 
-    return _get_hint_if_not_redundant(node->time, time_set).has_value();
+    if (it->second.dominated(
+        node->time, node->current_cost, _discrete_time_window))
+    {
+      ++_internal->search_statistics.nodes_pruned;
+      return false;
+    }
+
+    return true;
   }
 };
 
+namespace {
+//==============================================================================
+/// The span of time that a hash distributed search gives to the same worker
+/// for each entry
+const Duration HashDistributedTimeBucket = std::chrono::seconds(10);
+
+//==============================================================================
+/// Move what a separate search has done into the state of a plan, so that the
+/// state looks like one search that can be resumed later. The nodes of the
+/// search are kept alive by the merged arena.
+void merge_search(
+  State& state,
+  ScheduledDifferentialDriveExpander::Arena& merged_arena,
+  ScheduledDifferentialDriveExpander::InternalState& search,
+  const Issues& issues)
+{
+  using InternalState = ScheduledDifferentialDriveExpander::InternalState;
+  auto& internal = static_cast<InternalState&>(*state.internal);
+
+  merged_arena.keep_alive(search.arena);
+  internal.popped_count += search.popped_count;
+  internal.search_statistics += search.search_statistics;
+  internal.heuristic_lookups += search.heuristic_lookups;
+  internal.traversals.insert(
+    search.traversals.begin(), search.traversals.end());
+
+  while (!search.queue.empty())
+  {
+    internal.queue.push(search.queue.top());
+    search.queue.pop();
+  }
+
+  for (const auto& [participant, blocked] : issues.blocked_nodes)
+  {
+    auto& merged_blocked = state.issues.blocked_nodes[participant];
+    for (const auto& [node, time] : blocked)
+    {
+      const auto it = merged_blocked.insert({node, time});
+      if (!it.second)
+        it.first->second = std::max(it.first->second, time);
+    }
+  }
+
+  state.issues.interrupted |= issues.interrupted;
+}
+} // anonymous namespace
+
 //==============================================================================
 DifferentialDrivePlanner::DifferentialDrivePlanner(
   Planner::Configuration config)
-: _config(std::move(config))
+: DifferentialDrivePlanner(
+    config,
+    Supergraph::make(
+      shared_graph(config),
+      config.vehicle_traits(),
+      config.lane_closures(),
+      config.interpolation(),
+      config.traversal_cost_per_meter(),
+      config.eager_traversals(),
+      config.floor_hierarchy(),
+      config.contract_corridors(),
+      config.contraction_hierarchy()))
 {
-  _supergraph = Supergraph::make(
-    Graph::Implementation::get(_config.graph()),
-    _config.vehicle_traits(),
-    _config.lane_closures(),
-    _config.interpolation(),
-    _config.traversal_cost_per_meter());
+  // Do nothing
+}
 
+//==============================================================================
+DifferentialDrivePlanner::DifferentialDrivePlanner(
+  Planner::Configuration config,
+  std::shared_ptr<const Supergraph> supergraph)
+: _config(std::move(config)),
+  _supergraph(std::move(supergraph))
+{
   _cache = DifferentialDriveHeuristic::make_manager(_supergraph);
+
+  if (const auto budget = _config.heuristic_cache_budget())
+  {
+    const auto policy =
+      _config.heuristic_cache_eviction()
+      == Planner::Configuration::HeuristicEviction::CheapestToRecompute ?
+      EvictionPolicy::CheapestToRecompute : EvictionPolicy::LeastRecentlyUsed;
+
+    _cache->set_budget(*budget, policy);
+    _cache->inner()->child_heuristic()->heuristic_cache()
+    ->set_budget(*budget, policy);
+  }
 }
 
 //==============================================================================
@@ -2412,6 +3661,12 @@ State DifferentialDrivePlanner::initiate(
   auto& internal = static_cast<InternalState&>(*state.internal);
   const auto& goal = state.conditions.goal;
 
+  internal.weight = 1.0 + state.conditions.options.suboptimality_budget();
+  internal.congestion = state.conditions.options.congestion_field() != nullptr;
+  internal.queue = internal.make_queue();
+  internal.arena = std::make_shared<ScheduledDifferentialDriveExpander::Arena>(
+    nullptr, state.conditions.options.memory_resource());
+
   ScheduledDifferentialDriveExpander expander{
     state.internal.get(),
     state.issues,
@@ -2439,18 +3694,39 @@ State DifferentialDrivePlanner::initiate(
   }
   else
   {
-    const auto& top = internal.queue.top();
-    state.ideal_cost = top->get_total_cost_estimate();
+    state.ideal_cost = internal.cost_estimate();
   }
 
   return state;
 }
 
 //==============================================================================
-std::optional<PlanData> DifferentialDrivePlanner::plan(State& state) const
+State DifferentialDrivePlanner::reinitiate(
+  const State& previous,
+  const std::vector<Planner::Start>& starts,
+  Planner::Goal goal,
+  Planner::Options options) const
 {
-  const auto& goal = state.conditions.goal;
+  using InternalState = ScheduledDifferentialDriveExpander::InternalState;
+  auto state = initiate(starts, std::move(goal), std::move(options));
+  if (state.issues.disconnected)
+    return state;
+
+  const auto& previous_internal =
+    static_cast<const InternalState&>(*previous.internal);
+  if (!previous_internal.solution)
+    return state;
+
+  // The previous solution is only useful if it went to the same goal
+  const auto& old_goal = previous.conditions.goal;
+  const auto& new_goal = state.conditions.goal;
+  if (old_goal.waypoint() != new_goal.waypoint()
+    || rmf_utils::pointer_to_opt(old_goal.orientation())
+    != rmf_utils::pointer_to_opt(new_goal.orientation())
+    || old_goal.minimum_time() != new_goal.minimum_time())
+    return state;
 
+  auto& internal = static_cast<InternalState&>(*state.internal);
   ScheduledDifferentialDriveExpander expander{
     state.internal.get(),
     state.issues,
@@ -2458,92 +3734,756 @@ std::optional<PlanData> DifferentialDrivePlanner::plan(State& state) const
     DifferentialDriveHeuristicAdapter{
       _cache->get(),
     _supergraph,
-    goal.waypoint(),
-      rmf_utils::pointer_to_opt(goal.orientation())
+    new_goal.waypoint(),
+      rmf_utils::pointer_to_opt(new_goal.orientation())
     },
-    state.conditions.goal,
+    new_goal,
     state.conditions.options,
     _supergraph->traversal_cost_per_meter()
   };
 
+  // The copy of the previous solution goes into the queue like any other node.
+  // It will be popped as the solution unless the search finds something that
+  // costs less, so it never makes the plan worse.
+  for (const auto& start : starts)
+  {
+    if (const auto seed =
+      expander.reuse_solution(previous_internal.solution, start))
+      internal.queue.push(seed);
+  }
+
+  return state;
+}
+
+//==============================================================================
+std::optional<PlanData> DifferentialDrivePlanner::plan(State& state) const
+{
+  RMF_TRAFFIC_TRACE("planner.plan");
   using InternalState = ScheduledDifferentialDriveExpander::InternalState;
   auto& internal = static_cast<InternalState&>(*state.internal);
 
-  const auto solution = a_star_search(expander, internal.queue);
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto& options = state.conditions.options;
+  std::optional<PlanData> plan;
+  if (options.ideal_plan_first() && options.get_validator()
+    && internal.popped_count == 0 && !internal.queue.empty())
+    plan = _plan_ideal_first(state);
 
-  if (!solution)
-    return std::nullopt;
+  const std::size_t threads = options.search_threads();
+  if (!plan.has_value())
+  {
+    if (threads > 1 && options.hash_distributed_search())
+    {
+      plan = _plan_hash_distributed(state, threads);
+    }
+    else
+    {
+      plan =
+        threads > 1 && internal.popped_count == 0 && internal.queue.size() > 1 ?
+        _plan_in_parallel(state, threads) : _plan_in_series(state);
+    }
+  }
 
-  return expander.make_plan(solution);
+  auto& statistics = internal.search_statistics;
+  const Duration elapsed = std::chrono::steady_clock::now() - start_time;
+  if (plan.has_value() && !statistics.time_to_first_feasible.has_value())
+    statistics.time_to_first_feasible = statistics.search_time + elapsed;
+
+  statistics.search_time += elapsed;
+  return plan;
 }
 
 //==============================================================================
-std::vector<schedule::Itinerary> DifferentialDrivePlanner::rollout(
-  const Duration span,
-  const Issues::BlockedNodes& nodes,
-  const Planner::Goal& goal,
-  const Planner::Options& options,
-  std::optional<std::size_t> max_rollouts) const
+std::optional<PlanData> DifferentialDrivePlanner::_plan_ideal_first(
+  State& state) const
 {
-  using InternalState = ScheduledDifferentialDriveExpander::InternalState;
-  InternalState internal;
-  Issues issues;
+  using Expander = ScheduledDifferentialDriveExpander;
+  using InternalState = Expander::InternalState;
+  auto& internal = static_cast<InternalState&>(*state.internal);
+  const auto& goal = state.conditions.goal;
 
-  ScheduledDifferentialDriveExpander expander{
-    &internal,
-    issues,
+  // Search from the same start nodes as if the schedule were empty. The start
+  // nodes were already validated when they were made.
+  auto ideal_options = state.conditions.options;
+  ideal_options.validator(nullptr);
+
+  InternalState ideal = internal;
+  Issues ideal_issues;
+  Expander ideal_expander{
+    &ideal,
+    ideal_issues,
     _supergraph,
     DifferentialDriveHeuristicAdapter{
       _cache->get(),
-    _supergraph,
-    goal.waypoint(),
-      rmf_utils::pointer_to_opt(goal.orientation()),
+      _supergraph,
+      goal.waypoint(),
+      rmf_utils::pointer_to_opt(goal.orientation())
     },
     goal,
-    options,
+    ideal_options,
     _supergraph->traversal_cost_per_meter()
   };
 
-  return expander.rollout(span, nodes, max_rollouts);
-}
+  const auto ideal_solution = a_star_search(ideal_expander, ideal.queue);
 
-//==============================================================================
-std::optional<Planner::QuickestPath> DifferentialDrivePlanner::quickest_path(
-  const Planner::StartSet& start_options,
-  std::size_t goal_vertex) const
+  // The arena of the ideal search keeps the nodes of the original search
+  // alive, so it takes over as the arena of the original search. The queue
+  // of the original search is left alone.
+  internal.arena = ideal.arena;
+  internal.traversals = std::move(ideal.traversals);
+  internal.popped_count = ideal.popped_count;
+  internal.search_statistics = ideal.search_statistics;
+  internal.heuristic_lookups = ideal.heuristic_lookups;
+  state.issues.interrupted |= ideal_issues.interrupted;
+
+  if (!ideal_solution)
+    return std::nullopt;
+
+  Expander expander{
+    state.internal.get(),
+    state.issues,
+    _supergraph,
+    DifferentialDriveHeuristicAdapter{
+      _cache->get(),
+      _supergraph,
+      goal.waypoint(),
+      rmf_utils::pointer_to_opt(goal.orientation())
+    },
+    goal,
+    state.conditions.options,
+    _supergraph->traversal_cost_per_meter()
+  };
+
+  // Nothing can cost less than the ideal plan, so if it has no conflicts then
+  // we are done.
+  const auto valid = expander.valid_prefix(ideal_solution);
+  if (valid == ideal_solution)
+  {
+    internal.solution = ideal_solution;
+    return expander.make_plan(ideal_solution);
+  }
+
+  // The part of the ideal plan that has no conflicts is a real way to make
+  // progress, so it is a fair node for the search to consider.
+  if (valid->parent)
+    internal.queue.push(valid);
+
+  return std::nullopt;
+}
+
+//==============================================================================
+std::optional<PlanData> DifferentialDrivePlanner::_plan_in_series(
+  State& state) const
 {
-  std::optional<Planner::QuickestPath::Implementation> best;
-  for (const auto& start : start_options)
+  using InternalState = ScheduledDifferentialDriveExpander::InternalState;
+  auto& internal = static_cast<InternalState&>(*state.internal);
+  const auto& goal = state.conditions.goal;
+
+  ScheduledDifferentialDriveExpander expander{
+    state.internal.get(),
+    state.issues,
+    _supergraph,
+    DifferentialDriveHeuristicAdapter{
+      _cache->get(),
+    _supergraph,
+    goal.waypoint(),
+      rmf_utils::pointer_to_opt(goal.orientation())
+    },
+    state.conditions.goal,
+    state.conditions.options,
+    _supergraph->traversal_cost_per_meter(),
+    _get_expansion_pool(state.conditions.options)
+  };
+
+  const auto solution = a_star_search(expander, internal.queue);
+
+  if (!solution)
+    return std::nullopt;
+
+  internal.solution = solution;
+  return expander.make_plan(solution);
+}
+
+//==============================================================================
+std::optional<PlanData> DifferentialDrivePlanner::_plan_in_parallel(
+  State& state,
+  const std::size_t threads) const
+{
+  using Expander = ScheduledDifferentialDriveExpander;
+  using InternalState = Expander::InternalState;
+  using SearchNodePtr = Expander::SearchNodePtr;
+  auto& internal = static_cast<InternalState&>(*state.internal);
+  const auto& goal = state.conditions.goal;
+
+  struct Search
   {
-    const auto cost_offset = [&]()
+    InternalState internal;
+    Issues issues;
+    SearchNodePtr solution = nullptr;
+  };
+
+  // Give each start node a search of its own. Every search makes its nodes in
+  // an arena of its own, because the arenas cannot be shared between threads.
+  auto start_queue = internal.queue;
+  std::vector<Search> searches(start_queue.size());
+  for (auto& search : searches)
+  {
+    search.internal.arena = std::make_shared<Expander::Arena>(internal.arena);
+    search.internal.traversals = internal.traversals;
+    search.internal.weight = internal.weight;
+    search.internal.congestion = internal.congestion;
+    search.internal.queue = internal.make_queue();
+    search.internal.queue.push(start_queue.top());
+    start_queue.pop();
+  }
+
+  // A search can stop as soon as it cannot beat the best solution that any
+  // other search has found, because the heuristic never overestimates.
+  std::atomic<double> best_cost = std::numeric_limits<double>::infinity();
+  const auto prune = [&best_cost](const SearchNodePtr& top) -> bool
+    {
+      return best_cost.load() < top->get_total_cost_estimate();
+    };
+
+  const auto expansion_pool = _get_expansion_pool(state.conditions.options);
+
+  _get_search_pool(threads, state.conditions.options)->run(
+    searches.size(), [&](const std::size_t i)
+    {
+      auto& search = searches[i];
+      Expander expander{
+        &search.internal,
+        search.issues,
+        _supergraph,
+        DifferentialDriveHeuristicAdapter{
+          _cache->get(),
+          _supergraph,
+          goal.waypoint(),
+          rmf_utils::pointer_to_opt(goal.orientation())
+        },
+        goal,
+        state.conditions.options,
+        _supergraph->traversal_cost_per_meter(),
+        expansion_pool
+      };
+
+      search.solution = a_star_search(expander, search.internal.queue, prune);
+      if (!search.solution)
+        return;
+
+      const double cost = search.solution->current_cost;
+      double current = best_cost.load();
+      while (cost < current && !best_cost.compare_exchange_weak(current, cost))
       {
-        const auto location = start.location();
-        if (!location.has_value())
-          return 0.0;
+        // Keep trying until we have lowered the best cost or another search
+        // has found something better.
+      }
+    });
+
+  // Merge the searches back into the state so that it looks like one search
+  // that can be resumed later. Ties between solutions go to the start that
+  // had the lowest cost estimate.
+  auto merged_arena =
+    std::make_shared<Expander::Arena>(nullptr, internal.arena->resource());
+  internal.queue = internal.make_queue();
+  std::optional<std::size_t> best;
+  for (std::size_t i = 0; i < searches.size(); ++i)
+  {
+    auto& search = searches[i];
+    merge_search(state, *merged_arena, search.internal, search.issues);
+
+    if (search.solution)
+    {
+      const double cost = search.solution->current_cost;
+      if (!best.has_value() || cost < searches[*best].solution->current_cost)
+        best = i;
+    }
+  }
 
-        const Eigen::Vector2d wp_location =
-          _supergraph->original().waypoints.at(start.waypoint()).get_location();
+  internal.arena = std::move(merged_arena);
 
-        const auto speed = [&]()
+  if (!best.has_value())
+    return std::nullopt;
+
+  // The unused solutions go back into the queue, where they would have been
+  // if this had been one search.
+  for (std::size_t i = 0; i < searches.size(); ++i)
+  {
+    if (i != *best && searches[i].solution)
+      internal.queue.push(searches[i].solution);
+  }
+
+  Expander expander{
+    &internal,
+    state.issues,
+    _supergraph,
+    DifferentialDriveHeuristicAdapter{
+      _cache->get(),
+      _supergraph,
+      goal.waypoint(),
+      rmf_utils::pointer_to_opt(goal.orientation())
+    },
+    goal,
+    state.conditions.options,
+    _supergraph->traversal_cost_per_meter()
+  };
+
+  internal.solution = searches[*best].solution;
+  return expander.make_plan(internal.solution);
+}
+
+//==============================================================================
+std::optional<PlanData> DifferentialDrivePlanner::_plan_hash_distributed(
+  State& state,
+  const std::size_t threads) const
+{
+  using Expander = ScheduledDifferentialDriveExpander;
+  using InternalState = Expander::InternalState;
+  using SearchNodePtr = Expander::SearchNodePtr;
+  using SearchQueue = Expander::SearchQueue;
+  auto& internal = static_cast<InternalState&>(*state.internal);
+  const auto& goal = state.conditions.goal;
+  const auto& options = state.conditions.options;
+
+  struct Worker
+  {
+    InternalState internal;
+    Issues issues;
+    std::vector<SearchNodePtr> solutions;
+    std::exception_ptr error;
+
+    // The nodes that other workers have passed to this one. This is guarded
+    // by the mutex of the search.
+    std::vector<SearchNodePtr> inbox;
+  };
+
+  // Every worker makes its nodes in an arena of its own, because the arenas
+  // cannot be shared between threads. A node is never changed by the worker
+  // that made it once it has been passed to another worker.
+  std::vector<Worker> workers(threads);
+  for (auto& worker : workers)
+  {
+    worker.internal.arena = std::make_shared<Expander::Arena>(internal.arena);
+    worker.internal.weight = internal.weight;
+    worker.internal.congestion = internal.congestion;
+    worker.internal.queue = internal.make_queue();
+  }
+
+  // Nodes at the same entry and around the same time always belong to the
+  // same worker, so the duplicate detection of each worker still sees all of
+  // the nodes that it needs to compare. Nodes without an entry stay with the
+  // worker that made them.
+  const DifferentialDriveMapTypes::EntryHash entry_hash(
+    _supergraph->original().lanes.size());
+  const auto owner = [&](const SearchNodePtr& node, const std::size_t self)
+    {
+      if (!node->entry.has_value())
+        return self;
+
+      const auto bucket = static_cast<std::size_t>(
+        node->time.time_since_epoch() / HashDistributedTimeBucket);
+
+      return (entry_hash(*node->entry) ^ (bucket * 0x9e3779b9)) % threads;
+    };
+
+  std::size_t next_worker = 0;
+  while (!internal.queue.empty())
+  {
+    const auto node = internal.queue.top();
+    internal.queue.pop();
+    const auto o = owner(node, next_worker);
+    workers[o].internal.queue.push(node);
+    next_worker = (next_worker + 1) % threads;
+  }
+
+  // Everything below is guarded by the mutex, except for best_cost. The
+  // search is over once every worker is idle and no nodes are on their way
+  // from one worker to another.
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::size_t idle = 0;
+  std::size_t in_transit = 0;
+  bool done = false;
+
+  const auto stop = [&]()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+      cv.notify_all();
+    };
+
+  // A worker does not need to expand anything that cannot beat the best
+  // solution that any worker has found, because the heuristic never
+  // overestimates.
+  std::atomic<double> best_cost = std::numeric_limits<double>::infinity();
+  const auto prune = [&best_cost](const SearchNodePtr& top) -> bool
+    {
+      return best_cost.load() < top->get_total_cost_estimate();
+    };
+
+  const auto expansion_pool = _get_expansion_pool(options);
+
+  const auto work = [&](const std::size_t self)
+    {
+      auto& worker = workers[self];
+      Expander expander{
+        &worker.internal,
+        worker.issues,
+        _supergraph,
+        DifferentialDriveHeuristicAdapter{
+          _cache->get(),
+          _supergraph,
+          goal.waypoint(),
+          rmf_utils::pointer_to_opt(goal.orientation())
+        },
+        goal,
+        options,
+        _supergraph->traversal_cost_per_meter(),
+        expansion_pool
+      };
+
+      auto& queue = worker.internal.queue;
+      SearchQueue children = worker.internal.make_queue();
+      std::vector<std::vector<SearchNodePtr>> outboxes(threads);
+      std::vector<SearchNodePtr> received;
+      while (true)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (done)
+            return;
+
+          received.swap(worker.inbox);
+          in_transit -= received.size();
+        }
+
+        for (const auto& node : received)
+          queue.push(node);
+        received.clear();
+
+        SearchNodePtr top = nullptr;
+        if (!queue.empty() && !prune(queue.top()))
+        {
+          if (expander.quit(queue.top(), queue))
+          {
+            if (worker.issues.interrupted)
+            {
+              stop();
+              return;
+            }
+          }
+          else
           {
-            const auto agent_speed =
-              _supergraph->traits().linear().get_nominal_velocity();
+            top = queue.top();
+            queue.pop();
+          }
+        }
+
+        if (!top)
+        {
+          // Wait for more nodes to arrive. This worker cannot make anything
+          // new until then, so if every other worker is waiting too and no
+          // nodes are in transit, the search is over.
+          std::unique_lock<std::mutex> lock(mutex);
+          if (!worker.inbox.empty())
+            continue;
 
-            const auto lane_index = start.lane();
-            if (!lane_index.has_value())
-              return agent_speed;
+          if (++idle == threads && in_transit == 0)
+          {
+            done = true;
+            cv.notify_all();
+            return;
+          }
 
-            const auto& lane = _supergraph->original().lanes.at(*lane_index);
-            const auto speed_limit = lane.properties().speed_limit();
-            if (!speed_limit.has_value())
-              return agent_speed;
+          cv.wait(lock, [&]() { return done || !worker.inbox.empty(); });
+          if (done)
+            return;
 
-            return std::min(agent_speed, *speed_limit);
-          }();
+          --idle;
+          continue;
+        }
 
-        return (*location - wp_location).norm() / speed;
-      }();
+        if (expander.is_finished(top))
+        {
+          worker.solutions.push_back(top);
+          const double cost = top->current_cost;
+          double current = best_cost.load();
+          while (cost < current
+            && !best_cost.compare_exchange_weak(current, cost))
+          {
+            // Keep trying until we have lowered the best cost or another
+            // worker has found something better.
+          }
+
+          continue;
+        }
+
+        expander.expand(top, children);
+        bool sending = false;
+        while (!children.empty())
+        {
+          const auto child = children.top();
+          children.pop();
+
+          const auto o = owner(child, self);
+          if (o == self)
+          {
+            queue.push(child);
+          }
+          else
+          {
+            outboxes[o].push_back(child);
+            sending = true;
+          }
+        }
+
+        if (!sending)
+          continue;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::size_t o = 0; o < threads; ++o)
+        {
+          auto& outbox = outboxes[o];
+          in_transit += outbox.size();
+          auto& inbox = workers[o].inbox;
+          inbox.insert(inbox.end(), outbox.begin(), outbox.end());
+          outbox.clear();
+        }
+
+        cv.notify_all();
+      }
+    };
+
+  // The workers wait for each other, so each one needs a thread of its own
+  // instead of a task on a pool that might run them one at a time.
+  const auto run = [&](const std::size_t self)
+    {
+      try
+      {
+        work(self);
+      }
+      catch (...)
+      {
+        workers[self].error = std::current_exception();
+        stop();
+      }
+    };
+
+  std::vector<std::thread> worker_threads;
+  worker_threads.reserve(threads - 1);
+  for (std::size_t i = 1; i < threads; ++i)
+    worker_threads.emplace_back(run, i);
+
+  run(0);
+
+  for (auto& t : worker_threads)
+    t.join();
+
+  for (const auto& worker : workers)
+  {
+    if (worker.error)
+      std::rethrow_exception(worker.error);
+  }
+
+  // Merge the workers back into the state so that it looks like one search
+  // that can be resumed later. The nodes that were still on their way to
+  // another worker go back into the queue too.
+  auto merged_arena =
+    std::make_shared<Expander::Arena>(nullptr, internal.arena->resource());
+  internal.queue = internal.make_queue();
+  std::vector<SearchNodePtr> solutions;
+  for (auto& worker : workers)
+  {
+    for (const auto& node : worker.inbox)
+      internal.queue.push(node);
+
+    merge_search(state, *merged_arena, worker.internal, worker.issues);
+    solutions.insert(
+      solutions.end(), worker.solutions.begin(), worker.solutions.end());
+  }
+
+  internal.arena = std::move(merged_arena);
+
+  if (solutions.empty())
+    return std::nullopt;
+
+  std::size_t best = 0;
+  for (std::size_t i = 1; i < solutions.size(); ++i)
+  {
+    if (solutions[i]->current_cost < solutions[best]->current_cost)
+      best = i;
+  }
 
+  // The unused solutions go back into the queue, where they would have been
+  // if this had been one search.
+  for (std::size_t i = 0; i < solutions.size(); ++i)
+  {
+    if (i != best)
+      internal.queue.push(solutions[i]);
+  }
+
+  Expander expander{
+    &internal,
+    state.issues,
+    _supergraph,
+    DifferentialDriveHeuristicAdapter{
+      _cache->get(),
+      _supergraph,
+      goal.waypoint(),
+      rmf_utils::pointer_to_opt(goal.orientation())
+    },
+    goal,
+    options,
+    _supergraph->traversal_cost_per_meter()
+  };
+
+  internal.solution = solutions[best];
+  return expander.make_plan(internal.solution);
+}
+
+//==============================================================================
+std::shared_ptr<schedule::WorkerPool>
+DifferentialDrivePlanner::_get_search_pool(
+  const std::size_t threads,
+  const Planner::Options& options) const
+{
+  // Pools that borrow the threads of an executor cost nothing to make
+  if (options.executor())
+    return std::make_shared<schedule::WorkerPool>(options.executor(), threads);
+
+  std::lock_guard<std::mutex> lock(_search_pool_mutex);
+  if (!_search_pool || _search_pool->size() != threads)
+    _search_pool = std::make_shared<schedule::WorkerPool>(threads);
+
+  return _search_pool;
+}
+
+//==============================================================================
+std::shared_ptr<schedule::WorkerPool>
+DifferentialDrivePlanner::_get_expansion_pool(
+  const Planner::Options& options) const
+{
+  const std::size_t threads = options.expansion_threads();
+  if (threads <= 1)
+    return nullptr;
+
+  if (options.executor())
+    return std::make_shared<schedule::WorkerPool>(options.executor(), threads);
+
+  // The searches of a parallel plan run their own jobs on this pool, so it is
+  // kept apart from the search pool to let both have their own size.
+  std::lock_guard<std::mutex> lock(_search_pool_mutex);
+  if (!_expansion_pool || _expansion_pool->size() != threads)
+    _expansion_pool = std::make_shared<schedule::WorkerPool>(threads);
+
+  return _expansion_pool;
+}
+
+//==============================================================================
+std::vector<schedule::Itinerary> DifferentialDrivePlanner::rollout(
+  const Duration span,
+  const Issues::BlockedNodes& nodes,
+  const Planner::Goal& goal,
+  const Planner::Options& options,
+  std::optional<std::size_t> max_rollouts,
+  std::optional<Time> deadline) const
+{
+  using Expander = ScheduledDifferentialDriveExpander;
+  using InternalState = Expander::InternalState;
+  using SearchNodePtr = Expander::SearchNodePtr;
+  InternalState internal;
+  internal.arena =
+    std::make_shared<Expander::Arena>(nullptr, options.memory_resource());
+  Issues issues;
+
+  Expander expander{
+    &internal,
+    issues,
+    _supergraph,
+    DifferentialDriveHeuristicAdapter{
+      _cache->get(),
+    _supergraph,
+    goal.waypoint(),
+      rmf_utils::pointer_to_opt(goal.orientation()),
+    },
+    goal,
+    options,
+    _supergraph->traversal_cost_per_meter()
+  };
+
+  const std::size_t threads = options.search_threads();
+  auto roots = expander.rollout_roots(nodes);
+  if (threads <= 1 || roots.size() <= 1)
+  {
+    std::atomic_size_t finished_count = 0;
+    std::vector<SearchNodePtr> finished;
+    expander.roll_out(
+      std::move(roots), span, max_rollouts, deadline, finished_count, finished);
+
+    return expander.make_rollouts(finished, span, max_rollouts);
+  }
+
+  struct Branch
+  {
+    InternalState internal;
+    Issues issues;
+    std::vector<SearchNodePtr> finished;
+  };
+
+  // Each blockage is rolled out on a branch of its own. The branches share
+  // the ancestors of their roots, so those are materialized up front to keep
+  // the branches from writing to the same nodes.
+  for (const auto& root : roots)
+    expander.materialize_lineage(root.node);
+
+  std::vector<Branch> branches(roots.size());
+  std::atomic_size_t finished_count = 0;
+  _get_search_pool(threads, options)->run(
+    branches.size(), [&](const std::size_t i)
+    {
+      auto& branch = branches[i];
+      branch.internal.arena =
+        std::make_shared<Expander::Arena>(nullptr, internal.arena->resource());
+      Expander branch_expander{
+        &branch.internal,
+        branch.issues,
+        _supergraph,
+        DifferentialDriveHeuristicAdapter{
+          _cache->get(),
+          _supergraph,
+          goal.waypoint(),
+          rmf_utils::pointer_to_opt(goal.orientation())
+        },
+        goal,
+        options,
+        _supergraph->traversal_cost_per_meter()
+      };
+
+      branch_expander.roll_out(
+        {roots[i]}, span, max_rollouts, deadline, finished_count,
+        branch.finished);
+    });
+
+  // The branches stay alive until the itineraries have been made, because
+  // their nodes live in the arenas of the branches.
+  std::vector<SearchNodePtr> finished;
+  for (const auto& branch : branches)
+  {
+    finished.insert(
+      finished.end(), branch.finished.begin(), branch.finished.end());
+  }
+
+  return expander.make_rollouts(finished, span, max_rollouts);
+}
+
+//==============================================================================
+std::optional<Planner::QuickestPath> DifferentialDrivePlanner::quickest_path(
+  const Planner::StartSet& start_options,
+  std::size_t goal_vertex) const
+{
+  std::optional<Planner::QuickestPath::Implementation> best;
+  for (const auto& start : start_options)
+  {
     const auto solution =
       _cache->inner()->inner_heuristic(start.waypoint(), goal_vertex);
 
@@ -2552,12 +4492,131 @@ std::optional<Planner::QuickestPath> DifferentialDrivePlanner::quickest_path(
 
     Planner::QuickestPath::Implementation::choose_better(
       best,
-      Planner::QuickestPath::Implementation{solution, cost_offset});
+      Planner::QuickestPath::Implementation{
+        solution, _start_cost_offset(start)});
   }
 
   return Planner::QuickestPath::Implementation::promote(best);
 }
 
+//==============================================================================
+std::vector<std::vector<std::optional<Planner::QuickestPath>>>
+DifferentialDrivePlanner::quickest_path_matrix(
+  const std::vector<Planner::StartSet>& starts,
+  const std::vector<std::size_t>& goals,
+  const std::size_t threads) const
+{
+  const std::size_t N = _supergraph->original().waypoints.size();
+  for (const auto goal : goals)
+  {
+    if (goal >= N)
+    {
+      // *INDENT-OFF*
+      throw std::out_of_range(
+        "[rmf_traffic::agv::Planner::quickest_path_matrix] Goal waypoint "
+        "index [" + std::to_string(goal) + "] is out of range for a graph "
+        "with [" + std::to_string(N) + "] waypoints");
+      // *INDENT-ON*
+    }
+  }
+
+  // Start sets often share waypoints, so each distinct start waypoint is only
+  // searched once for each goal.
+  std::vector<std::size_t> start_waypoints;
+  std::unordered_map<std::size_t, std::size_t> row_of_waypoint;
+  for (const auto& start_set : starts)
+  {
+    for (const auto& start : start_set)
+    {
+      const auto wp = start.waypoint();
+      if (row_of_waypoint.insert({wp, start_waypoints.size()}).second)
+        start_waypoints.push_back(wp);
+    }
+  }
+
+  // Each task works through the goals of one start waypoint, so the forward
+  // tree of that start is grown by only one thread and reused for every goal.
+  // The tasks begin at different goals so that they do not all wait on the
+  // reverse tree of the same goal. The forest takes care of its own locking.
+  const std::size_t G = goals.size();
+  const auto& heuristic = *_cache->inner();
+  std::vector<ConstForestSolutionPtr> solutions(start_waypoints.size()*G);
+  schedule::WorkerPool pool(std::max<std::size_t>(threads, 1));
+  pool.run(
+    start_waypoints.size(), [&](const std::size_t i)
+    {
+      for (std::size_t k = 0; k < G; ++k)
+      {
+        const std::size_t j = (i + k) % G;
+        solutions[i*G + j] =
+          heuristic.inner_heuristic(start_waypoints[i], goals[j]);
+      }
+    });
+
+  std::vector<std::vector<std::optional<Planner::QuickestPath>>> matrix;
+  matrix.reserve(starts.size());
+  for (const auto& start_set : starts)
+  {
+    std::vector<std::optional<Planner::QuickestPath::Implementation>> best(G);
+    for (const auto& start : start_set)
+    {
+      const double cost_offset = _start_cost_offset(start);
+      const std::size_t i = row_of_waypoint.at(start.waypoint());
+      for (std::size_t j = 0; j < G; ++j)
+      {
+        const auto& solution = solutions[i*G + j];
+        if (!solution)
+          continue;
+
+        Planner::QuickestPath::Implementation::choose_better(
+          best[j],
+          Planner::QuickestPath::Implementation{solution, cost_offset});
+      }
+    }
+
+    auto& row = matrix.emplace_back();
+    row.reserve(G);
+    for (auto& b : best)
+    {
+      row.push_back(
+        Planner::QuickestPath::Implementation::promote(std::move(b)));
+    }
+  }
+
+  return matrix;
+}
+
+//==============================================================================
+double DifferentialDrivePlanner::_start_cost_offset(
+  const Planner::Start& start) const
+{
+  const auto location = start.location();
+  if (!location.has_value())
+    return 0.0;
+
+  const Eigen::Vector2d wp_location =
+    _supergraph->original().waypoints.at(start.waypoint()).get_location();
+
+  const auto speed = [&]()
+    {
+      const auto agent_speed =
+        _supergraph->traits().linear().get_nominal_velocity();
+
+      const auto lane_index = start.lane();
+      if (!lane_index.has_value())
+        return agent_speed;
+
+      const auto& lane = _supergraph->original().lanes.at(*lane_index);
+      const auto speed_limit = lane.properties().speed_limit();
+      if (!speed_limit.has_value())
+        return agent_speed;
+
+      return std::min(agent_speed, *speed_limit);
+    }();
+
+  return (*location - wp_location).norm() / speed;
+}
+
 //==============================================================================
 const Planner::Configuration&
 DifferentialDrivePlanner::get_configuration() const
@@ -2565,6 +4624,156 @@ DifferentialDrivePlanner::get_configuration() const
   return _config;
 }
 
+//==============================================================================
+void DifferentialDrivePlanner::save_heuristic(std::ostream& output) const
+{
+  // The DifferentialDriveHeuristic entries hold route factories which cannot
+  // be written out, so we save the shortest path tables that they are built
+  // from. Those searches make up most of the cost of a cold start.
+  planning::save_heuristic(
+    *_cache->inner()->child_heuristic(), *_supergraph, output);
+}
+
+//==============================================================================
+bool DifferentialDrivePlanner::load_heuristic(std::istream& input) const
+{
+  return planning::load_heuristic(
+    *_cache->inner()->child_heuristic(), *_supergraph, input);
+}
+
+//==============================================================================
+void DifferentialDrivePlanner::sync_heuristic(
+  std::istream& journal,
+  std::ostream& output) const
+{
+  planning::sync_heuristic(
+    *_cache->inner()->child_heuristic(), *_supergraph, journal, output);
+}
+
+//==============================================================================
+Planner::HeuristicCacheStatistics
+DifferentialDrivePlanner::heuristic_statistics() const
+{
+  auto stats = _cache->statistics();
+  stats += _cache->inner()->child_heuristic()->heuristic_cache()->statistics();
+
+  Planner::HeuristicCacheStatistics output;
+  output.entries = stats.entries;
+  output.bytes = stats.bytes;
+  output.hits = stats.hits;
+  output.misses = stats.misses;
+  output.evictions = stats.evictions;
+  return output;
+}
+
+//==============================================================================
+Planner::MemoryUsage DifferentialDrivePlanner::memory_usage() const
+{
+  const auto convert = [](const CacheMemory& memory)
+    {
+      Planner::MemoryUsage::Cache output;
+      output.entries = memory.entries;
+      output.bytes = memory.bytes;
+      return output;
+    };
+
+  auto heuristics = _cache->memory_usage();
+  heuristics +=
+    _cache->inner()->child_heuristic()->heuristic_cache()->memory_usage();
+
+  Planner::MemoryUsage output;
+  output.heuristics = convert(heuristics);
+  output.traversals = convert(_supergraph->traversal_memory());
+  output.entries = convert(_supergraph->entry_memory());
+  return output;
+}
+
+//==============================================================================
+std::shared_ptr<const Interface> DifferentialDrivePlanner::with_closures(
+  LaneClosure closures) const
+{
+  const auto& graph = _supergraph->original();
+  const LaneClosureChange change(
+    _supergraph->closures(), closures, graph.lanes.size());
+
+  auto config = _config;
+  config.lane_closures(closures);
+  auto planner = std::make_shared<DifferentialDrivePlanner>(
+    std::move(config),
+    _supergraph->with_closures(
+      std::move(closures), _config.eager_traversals()));
+
+  const auto& child = *_cache->inner()->child_heuristic();
+  const auto& new_child = *planner->_cache->inner()->child_heuristic();
+
+  // Closing lanes can only take options away from a search, so a solution
+  // that does not use any of the newly closed lanes is still optimal, and a
+  // goal that could not be reached still cannot be reached. Opening a lane
+  // might give any of the searches a better solution, so in that case none of
+  // the solutions can be carried over.
+  if (!change.any_opened)
+  {
+    auto solutions = _cache->snapshot();
+    for (auto it = solutions.begin(); it != solutions.end(); )
+    {
+      if (avoids_lanes(it->first, it->second, change.closed))
+        ++it;
+      else
+        it = solutions.erase(it);
+    }
+    planner->_cache->preload(std::move(solutions));
+
+    for (auto& entry : child.solutions())
+    {
+      if (!entry.solution
+        || avoids_lanes(graph, entry.solution->path, change.closed))
+        new_child.preload(std::move(entry));
+    }
+  }
+
+  // The euclidean heuristic does not depend on lane closures at all
+  for (const auto& [goal, manager] : child.heuristic_cache()->managers())
+    new_child.heuristic_cache()->get(goal)->preload(manager->snapshot());
+
+  return planner;
+}
+
+//==============================================================================
+void DifferentialDrivePlanner::warm_heuristic(
+  const std::vector<std::size_t>& goals,
+  const std::size_t threads) const
+{
+  const std::size_t N = _supergraph->original().waypoints.size();
+  for (const auto goal : goals)
+  {
+    if (goal >= N)
+    {
+      // *INDENT-OFF*
+      throw std::out_of_range(
+        "[rmf_traffic::agv::Planner::warm_cache] Goal waypoint index ["
+        + std::to_string(goal) + "] is out of range for a graph with ["
+        + std::to_string(N) + "] waypoints");
+      // *INDENT-ON*
+    }
+  }
+
+  // The heuristic of each goal is generated independently of the others, so
+  // each goal gets its own task. The caches take care of their own locking.
+  const auto cache = _cache->get();
+  schedule::WorkerPool pool(std::max<std::size_t>(threads, 1));
+  pool.run(
+    goals.size(), [&](const std::size_t i)
+    {
+      const std::size_t goal = goals[i];
+      for (std::size_t start = 0; start < N; ++start)
+      {
+        const auto keys = _supergraph->keys_for(start, goal, std::nullopt);
+        for (const auto& key : keys)
+          cache.get(key);
+      }
+    });
+}
+
 //==============================================================================
 auto DifferentialDrivePlanner::debug_begin(
   const std::vector<Planner::Start>& starts,
@@ -22,6 +22,10 @@
 
 #include "DifferentialDriveHeuristic.hpp"
 
+#include "../../schedule/internal_WorkerPool.hpp"
+
+#include <mutex>
+
 namespace rmf_traffic {
 namespace agv {
 namespace planning {
@@ -33,11 +37,23 @@ public:
 
   DifferentialDrivePlanner(Planner::Configuration config);
 
+  /// Make a planner that uses a supergraph that was already made for the
+  /// configuration.
+  DifferentialDrivePlanner(
+    Planner::Configuration config,
+    std::shared_ptr<const Supergraph> supergraph);
+
   State initiate(
     const std::vector<agv::Planner::Start>& starts,
     agv::Planner::Goal goal,
     agv::Planner::Options options) const final;
 
+  State reinitiate(
+    const State& previous,
+    const std::vector<agv::Planner::Start>& starts,
+    agv::Planner::Goal goal,
+    agv::Planner::Options options) const final;
+
   std::optional<PlanData> plan(State& state) const final;
 
   std::vector<schedule::Itinerary> rollout(
@@ -45,14 +61,40 @@ public:
     const Issues::BlockedNodes& nodes,
     const Planner::Goal& goal,
     const Planner::Options& options,
-    std::optional<std::size_t> max_rollouts) const final;
+    std::optional<std::size_t> max_rollouts,
+    std::optional<Time> deadline) const final;
 
   std::optional<Planner::QuickestPath> quickest_path(
     const Planner::StartSet& start_vertices,
     std::size_t goal_vertex) const final;
 
+  std::vector<std::vector<std::optional<Planner::QuickestPath>>>
+  quickest_path_matrix(
+    const std::vector<Planner::StartSet>& starts,
+    const std::vector<std::size_t>& goals,
+    std::size_t threads) const final;
+
   const Planner::Configuration& get_configuration() const final;
 
+  void save_heuristic(std::ostream& output) const final;
+
+  bool load_heuristic(std::istream& input) const final;
+
+  void sync_heuristic(
+    std::istream& journal,
+    std::ostream& output) const final;
+
+  void warm_heuristic(
+    const std::vector<std::size_t>& goals,
+    std::size_t threads) const final;
+
+  Planner::HeuristicCacheStatistics heuristic_statistics() const final;
+
+  Planner::MemoryUsage memory_usage() const final;
+
+  std::shared_ptr<const Interface> with_closures(
+    LaneClosure closures) const final;
+
   std::unique_ptr<Debugger> debug_begin(
     const std::vector<Planner::Start>& starts,
     Planner::Goal goal,
@@ -63,9 +105,47 @@ public:
   std::optional<double> compute_heuristic(const Planner::Start& start) const;
 
 private:
+
+  /// Validate the plan that would be made if the schedule were empty, and
+  /// return it if it has no conflicts. Otherwise give the part of it that has
+  /// no conflicts to the search.
+  std::optional<PlanData> _plan_ideal_first(State& state) const;
+
+  /// Search for a plan on the calling thread
+  std::optional<PlanData> _plan_in_series(State& state) const;
+
+  /// Search each start of a fresh plan on a separate thread
+  std::optional<PlanData> _plan_in_parallel(
+    State& state,
+    std::size_t threads) const;
+
+  /// Search with several threads that each own part of the search, and pass
+  /// the nodes that they make to the threads that own them
+  std::optional<PlanData> _plan_hash_distributed(
+    State& state,
+    std::size_t threads) const;
+
+  /// Get a pool for the searches of a plan, which borrows the threads of the
+  /// executor of the options if there is one
+  std::shared_ptr<schedule::WorkerPool> _get_search_pool(
+    std::size_t threads,
+    const Planner::Options& options) const;
+
+  /// Get the pool that validates the expansions of a search, or a nullptr if
+  /// they should be validated on the thread of the search
+  std::shared_ptr<schedule::WorkerPool> _get_expansion_pool(
+    const Planner::Options& options) const;
+
+  /// The cost of moving from the location of a start to its waypoint
+  double _start_cost_offset(const Planner::Start& start) const;
+
   Planner::Configuration _config;
   std::shared_ptr<const Supergraph> _supergraph;
   CacheManagerPtr<DifferentialDriveHeuristic> _cache;
+
+  mutable std::mutex _search_pool_mutex;
+  mutable std::shared_ptr<schedule::WorkerPool> _search_pool;
+  mutable std::shared_ptr<schedule::WorkerPool> _expansion_pool;
 };
 
 } // namespace planning
@@ -18,6 +18,8 @@
 #include "EuclideanHeuristic.hpp"
 #include "a_star.hpp"
 
+#include <cmath>
+#include <limits>
 #include <queue>
 
 namespace rmf_traffic {
@@ -73,14 +75,14 @@ public:
     }
 
     const auto current_cost = top->current_cost;
-    const auto old_it = _old_items.find(current_wp_index);
-    if (old_it != _old_items.end())
+    const auto old_item = _heuristic.find(current_wp_index);
+    if (old_item.has_value())
     {
-      // If the current waypoint already has an entry in the old items, then we
-      // can immediately create a node that brings it the rest of the way to the
+      // If the cost of the current waypoint is already known, then we can
+      // immediately create a node that brings it the rest of the way to the
       // goal with the best possible cost.
 
-      const auto remaining_cost = old_it->second;
+      const auto remaining_cost = *old_item;
       if (!remaining_cost.has_value())
       {
         // If the old value is a nullopt, then this waypoint has no way to reach
@@ -193,13 +195,13 @@ public:
     Eigen::Vector2d goal_p,
     const std::string& goal_map,
     double max_speed,
-    const EuclideanHeuristic::Storage& old_items,
+    const EuclideanHeuristic& heuristic,
     std::shared_ptr<const Supergraph> graph)
   : _goal(goal),
     _goal_p(goal_p),
     _goal_map(goal_map),
     _max_speed(max_speed),
-    _old_items(old_items),
+    _heuristic(heuristic),
     _graph(std::move(graph))
   {
     // Do nothing
@@ -210,16 +212,41 @@ private:
   Eigen::Vector2d _goal_p;
   const std::string& _goal_map;
   double _max_speed;
-  const EuclideanHeuristic::Storage& _old_items;
+  const EuclideanHeuristic& _heuristic;
   std::shared_ptr<const Supergraph> _graph;
   std::unordered_set<std::size_t> _visited;
 };
 
+//==============================================================================
+auto EuclideanHeuristic::Positions::make(const Supergraph& graph)
+-> std::shared_ptr<const Positions>
+{
+  const auto& waypoints = graph.original().waypoints;
+  auto positions = std::make_shared<Positions>();
+  positions->x.reserve(waypoints.size());
+  positions->y.reserve(waypoints.size());
+  positions->map.reserve(waypoints.size());
+
+  std::unordered_map<std::string, std::size_t> map_indices;
+  for (const auto& wp : waypoints)
+  {
+    const Eigen::Vector2d p = wp.get_location();
+    positions->x.push_back(p.x());
+    positions->y.push_back(p.y());
+    positions->map.push_back(
+      map_indices.insert({wp.get_map_name(), map_indices.size()})
+      .first->second);
+  }
+
+  return positions;
+}
+
 //==============================================================================
 EuclideanHeuristic::EuclideanHeuristic(
   std::size_t goal,
   double max_speed,
-  std::shared_ptr<const Supergraph> graph)
+  std::shared_ptr<const Supergraph> graph,
+  std::shared_ptr<const Positions> positions)
 : _goal(goal),
   _max_speed(max_speed),
   _graph(std::move(graph))
@@ -227,31 +254,96 @@ EuclideanHeuristic::EuclideanHeuristic(
   const auto& goal_wp = _graph->original().waypoints.at(goal);
   _goal_p = goal_wp.get_location();
   _goal_map = &goal_wp.get_map_name();
+
+  if (!positions)
+    positions = Positions::make(*_graph);
+
+  // This loop has no branches and reads the positions contiguously, so the
+  // compiler is free to vectorize it.
+  const std::size_t N = positions->x.size();
+  const double* const x = positions->x.data();
+  const double* const y = positions->y.data();
+  const std::size_t* const map = positions->map.data();
+  const std::size_t goal_map = map[goal];
+  const double gx = _goal_p.x();
+  const double gy = _goal_p.y();
+  const double inv_speed = 1.0/_max_speed;
+  constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+
+  _direct.resize(N);
+  double* const direct = _direct.data();
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    const double dx = x[i] - gx;
+    const double dy = y[i] - gy;
+    const double cost = std::sqrt(dx*dx + dy*dy) * inv_speed;
+    direct[i] = map[i] == goal_map ? cost : nan;
+  }
+
+  _searched = std::make_unique<std::atomic<double>[]>(N);
+  for (std::size_t i = 0; i < N; ++i)
+    _searched[i].store(nan, std::memory_order_relaxed);
+}
+
+//==============================================================================
+std::optional<double> EuclideanHeuristic::get(const std::size_t waypoint) const
+{
+  if (const auto known = find(waypoint))
+    return *known;
+
+  // Make sure that an invalid waypoint gets the same exception as before
+  _graph->original().waypoints.at(waypoint);
+  return _search(waypoint);
+}
+
+//==============================================================================
+std::optional<std::optional<double>> EuclideanHeuristic::find(
+  const std::size_t waypoint) const
+{
+  if (waypoint >= _direct.size())
+    return std::nullopt;
+
+  const double direct = _direct[waypoint];
+  if (!std::isnan(direct))
+    return direct;
+
+  const double searched = _searched[waypoint].load(std::memory_order_relaxed);
+  if (std::isnan(searched))
+    return std::nullopt;
+
+  if (std::isinf(searched))
+    return std::optional<double>();
+
+  return searched;
 }
 
 //==============================================================================
 std::optional<double> EuclideanHeuristic::generate(
   const std::size_t& key,
-  const Storage& old_items,
+  const OldItems&,
   Storage& new_items) const
 {
-  const auto& start_wp = _graph->original().waypoints.at(key);
-  const auto& start_map = start_wp.get_map_name();
-  const Eigen::Vector2d start_p = start_wp.get_location();
-  const auto minimum_cost = (_goal_p - start_p).norm()/_max_speed;
+  // The dense array is what keeps the costs, so the cache only needs the one
+  // that was asked for.
+  const auto cost = get(key);
+  new_items.insert({key, cost});
+  return cost;
+}
 
-  if (start_map == *_goal_map)
-  {
-    const auto it = new_items.insert({key, minimum_cost});
-    return it.first->second;
-  }
+//==============================================================================
+std::optional<double> EuclideanHeuristic::_search(
+  const std::size_t waypoint) const
+{
+  const Eigen::Vector2d start_p =
+    _graph->original().waypoints[waypoint].get_location();
+  const auto minimum_cost = (_goal_p - start_p).norm()/_max_speed;
 
   EuclideanExpander expander{
     _goal,
     _goal_p,
     *_goal_map,
     _max_speed,
-    old_items,
+    *this,
     _graph
   };
 
@@ -259,7 +351,7 @@ std::optional<double> EuclideanHeuristic::generate(
   queue.push(
     std::make_shared<EuclideanExpander::Node>(
       EuclideanExpander::Node{
-        key,
+        waypoint,
         minimum_cost,
         0.0,
         nullptr
@@ -269,7 +361,8 @@ std::optional<double> EuclideanHeuristic::generate(
   if (!solution)
   {
     // This means there is no way to move to the goal from the start waypoint
-    new_items.insert({key, std::nullopt});
+    _searched[waypoint].store(
+      std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
     return std::nullopt;
   }
 
@@ -280,7 +373,12 @@ std::optional<double> EuclideanHeuristic::generate(
     // We can save the results for every waypoint that was used in this solution
     // because every segment of an optimal solution is an optimal solution
     // itself
-    new_items.insert({node->waypoint, final_cost - node->current_cost});
+    if (std::isnan(_direct[node->waypoint]))
+    {
+      _searched[node->waypoint].store(
+        final_cost - node->current_cost, std::memory_order_relaxed);
+    }
+
     node = node->parent;
   }
 
@@ -291,7 +389,8 @@ std::optional<double> EuclideanHeuristic::generate(
 EuclideanHeuristicFactory::EuclideanHeuristicFactory(
   std::shared_ptr<const Supergraph> graph)
 : _graph(std::move(graph)),
-  _max_speed(_graph->traits().linear().get_nominal_velocity())
+  _max_speed(_graph->traits().linear().get_nominal_velocity()),
+  _positions(EuclideanHeuristic::Positions::make(*_graph))
 {
   // Do nothing
 }
@@ -300,7 +399,8 @@ EuclideanHeuristicFactory::EuclideanHeuristicFactory(
 ConstEuclideanHeuristicPtr EuclideanHeuristicFactory::make(
   const std::size_t goal) const
 {
-  return std::make_shared<EuclideanHeuristic>(goal, _max_speed, _graph);
+  return std::make_shared<EuclideanHeuristic>(
+    goal, _max_speed, _graph, _positions);
 }
 
 } // namespace planning
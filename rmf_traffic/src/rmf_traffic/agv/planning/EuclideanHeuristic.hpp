@@ -22,6 +22,11 @@
 #include "Supergraph.hpp"
 #include <rmf_traffic/agv/Planner.hpp>
 
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
 namespace rmf_traffic {
 namespace agv {
 namespace planning {
@@ -32,27 +37,75 @@ namespace planning {
 /// for a goal waypoint that is on a different map, it will perform a search to
 /// figure out which choice of floor-changing lane will allow for the shortest
 /// Euclidean distance traveling.
+///
+/// The costs of every waypoint are kept in a dense array. The waypoints on the
+/// same map as the goal are filled in when the heuristic is constructed, with
+/// one pass over the positions of the waypoints. The waypoints on other maps
+/// are filled in the first time that they are asked for. Looking up a cost
+/// never takes a lock.
 class EuclideanHeuristic
   : public Generator<std::unordered_map<std::size_t, std::optional<double>>>
 {
 public:
 
+  /// The positions of every waypoint of a graph, laid out so that the costs
+  /// of all of them can be computed in one tight loop.
+  struct Positions
+  {
+    std::vector<double> x;
+    std::vector<double> y;
+
+    /// An index for the map of each waypoint. Waypoints with the same index
+    /// are on the same map.
+    std::vector<std::size_t> map;
+
+    static std::shared_ptr<const Positions> make(const Supergraph& graph);
+  };
+
+  /// Constructor
+  ///
+  /// \param[in] positions
+  ///   The positions of the waypoints of the graph. These will be computed
+  ///   if a nullptr is given. The factory shares one set of positions across
+  ///   every goal.
   EuclideanHeuristic(
     std::size_t goal,
     double max_speed,
-    std::shared_ptr<const Supergraph> graph);
+    std::shared_ptr<const Supergraph> graph,
+    std::shared_ptr<const Positions> positions = nullptr);
+
+  /// Get the cost from a waypoint to the goal, or a nullopt if the goal cannot
+  /// be reached from it. This does not use a cache manager, so it is the
+  /// cheapest way to get a Euclidean heuristic.
+  std::optional<double> get(std::size_t waypoint) const;
+
+  /// Get the cost of a waypoint only if it is already known. The inner value
+  /// is a nullopt if the goal cannot be reached from the waypoint.
+  std::optional<std::optional<double>> find(std::size_t waypoint) const;
 
   std::optional<double> generate(
     const std::size_t& key,
-    const Storage& old_items,
+    const OldItems& old_items,
     Storage& new_items) const final;
 
 private:
+
+  std::optional<double> _search(std::size_t waypoint) const;
+
   std::size_t _goal;
   Eigen::Vector2d _goal_p;
   const std::string* _goal_map;
   double _max_speed;
   std::shared_ptr<const Supergraph> _graph;
+
+  /// Costs of the waypoints on the same map as the goal. This is NaN for
+  /// waypoints on other maps.
+  std::vector<double> _direct;
+
+  /// Costs of the waypoints on other maps that have been searched. This is
+  /// NaN until a waypoint is searched, and infinity if it cannot reach the
+  /// goal.
+  std::unique_ptr<std::atomic<double>[]> _searched;
 };
 
 //==============================================================================
@@ -72,6 +125,7 @@ public:
 private:
   std::shared_ptr<const Supergraph> _graph;
   double _max_speed;
+  std::shared_ptr<const EuclideanHeuristic::Positions> _positions;
 };
 
 //==============================================================================
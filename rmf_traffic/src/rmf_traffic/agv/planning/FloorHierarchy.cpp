@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include "FloorHierarchy.hpp"
+
+#include <algorithm>
+#include <queue>
+#include <tuple>
+#include <unordered_set>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+namespace {
+//==============================================================================
+struct FloorCandidate
+{
+  double cost;
+  WaypointId waypoint;
+  WaypointId parent;
+};
+
+//==============================================================================
+struct PortalCandidate
+{
+  double cost;
+  std::size_t record;
+};
+
+//==============================================================================
+struct HigherCost
+{
+  template<typename T>
+  bool operator()(const T& a, const T& b) const
+  {
+    return b.cost < a.cost;
+  }
+};
+
+//==============================================================================
+template<typename T>
+using MinQueue = std::priority_queue<T, std::vector<T>, HigherCost>;
+
+} // anonymous namespace
+
+//==============================================================================
+FloorHierarchy::FloorHierarchy(std::shared_ptr<const Supergraph> graph)
+: _graph(std::move(graph))
+{
+  const auto& original = _graph->original();
+
+  std::unordered_map<std::string, std::size_t> floors;
+  _floor_of_waypoint.reserve(original.waypoints.size());
+  for (const auto& wp : original.waypoints)
+  {
+    const std::size_t next_floor = floors.size();
+    _floor_of_waypoint.push_back(
+      floors.insert({wp.get_map_name(), next_floor}).first->second);
+  }
+
+  _portals_from_floor.resize(floors.size());
+  for (const auto& from_floor : _graph->floor_change())
+  {
+    for (const auto& to_floor : from_floor.second)
+    {
+      for (const auto& change : to_floor.second)
+      {
+        const auto entry =
+          original.lanes[change.lane].entry().waypoint_index();
+
+        // Closed lanes are left out of the adjacency view, so a portal is only
+        // made for a floor change that is open.
+        for (const auto& edge : _graph->lanes_from().edges(entry))
+        {
+          if (edge.lane != change.lane)
+            continue;
+
+          _portals_from_floor[_floor_of_waypoint[entry]].push_back(
+            Portal{entry, edge.target, edge.cost});
+        }
+      }
+    }
+  }
+
+  // The floor change map is unordered, so we sort the portals to make sure
+  // that ties are always broken the same way.
+  for (auto& portals : _portals_from_floor)
+  {
+    std::sort(
+      portals.begin(), portals.end(),
+      [](const Portal& a, const Portal& b)
+      {
+        return std::tie(a.entry, a.exit) < std::tie(b.entry, b.exit);
+      });
+  }
+}
+
+//==============================================================================
+bool FloorHierarchy::separates(
+  const WaypointId start,
+  const WaypointId finish) const
+{
+  return _floor_of_waypoint.at(start) != _floor_of_waypoint.at(finish);
+}
+
+//==============================================================================
+ConstForestSolutionPtr FloorHierarchy::solve(
+  const WaypointId start,
+  const WaypointId finish) const
+{
+  // Each record is a waypoint that the upper level search arrived at, either
+  // by crossing a floor change or by finishing its last floor search.
+  struct Record
+  {
+    WaypointId waypoint;
+    double cost;
+    std::size_t previous;
+    std::optional<WaypointId> portal_entry;
+  };
+
+  const std::size_t root = std::numeric_limits<std::size_t>::max();
+  std::vector<Record> records;
+  records.push_back(Record{start, 0.0, root, std::nullopt});
+
+  MinQueue<PortalCandidate> queue;
+  queue.push(PortalCandidate{0.0, 0});
+
+  const std::size_t finish_floor = _floor_of_waypoint.at(finish);
+  std::unordered_set<WaypointId> settled;
+  std::optional<std::size_t> arrival;
+  while (!queue.empty())
+  {
+    const auto top = queue.top();
+    queue.pop();
+
+    const WaypointId waypoint = records[top.record].waypoint;
+    if (waypoint == finish)
+    {
+      arrival = top.record;
+      break;
+    }
+
+    if (!settled.insert(waypoint).second)
+      continue;
+
+    const auto search = floor_search(waypoint);
+    const std::size_t floor = _floor_of_waypoint[waypoint];
+    if (floor == finish_floor)
+    {
+      const auto it = search->visits.find(finish);
+      if (it != search->visits.end())
+      {
+        records.push_back(
+          Record{finish, top.cost + it->second.cost, top.record, std::nullopt});
+        queue.push(PortalCandidate{records.back().cost, records.size()-1});
+      }
+    }
+
+    for (const auto& portal : _portals_from_floor[floor])
+    {
+      if (settled.count(portal.exit) != 0)
+        continue;
+
+      const auto it = search->visits.find(portal.entry);
+      if (it == search->visits.end())
+        continue;
+
+      records.push_back(
+        Record{
+          portal.exit,
+          top.cost + it->second.cost + portal.cost,
+          top.record,
+          portal.entry
+        });
+      queue.push(PortalCandidate{records.back().cost, records.size()-1});
+    }
+  }
+
+  if (!arrival.has_value())
+    return nullptr;
+
+  // Crawl back through the records, filling in each stretch of a floor from
+  // the floor search that it came from.
+  std::vector<std::size_t> path;
+  std::size_t r = *arrival;
+  while (records[r].previous != root)
+  {
+    const auto& record = records[r];
+    const WaypointId origin = records[record.previous].waypoint;
+
+    WaypointId leg_end = record.waypoint;
+    if (record.portal_entry.has_value())
+    {
+      path.push_back(record.waypoint);
+      leg_end = *record.portal_entry;
+    }
+
+    const auto search = floor_search(origin);
+    for (WaypointId wp = leg_end; wp != origin;
+      wp = search->visits.at(wp).parent)
+    {
+      path.push_back(wp);
+    }
+
+    r = record.previous;
+  }
+
+  path.push_back(start);
+  std::reverse(path.begin(), path.end());
+
+  return std::make_shared<ForestSolution>(
+    ForestSolution{records[*arrival].cost, std::move(path)});
+}
+
+//==============================================================================
+auto FloorHierarchy::floor_search(const WaypointId source) const
+-> ConstFloorSearchPtr
+{
+  {
+    SpinLock lock(_floor_searches_mutex);
+    const auto it = _floor_searches.find(source);
+    if (it != _floor_searches.end())
+      return it->second;
+  }
+
+  // The lanes that change floors belong to the upper level, so this search
+  // only ever covers one floor.
+  auto search = std::make_shared<FloorSearch>();
+  const std::size_t floor = _floor_of_waypoint.at(source);
+  MinQueue<FloorCandidate> queue;
+  queue.push(FloorCandidate{0.0, source, source});
+  while (!queue.empty())
+  {
+    const auto top = queue.top();
+    queue.pop();
+
+    const auto inserted = search->visits.insert(
+      {top.waypoint, FloorSearch::Visit{top.cost, top.parent}}).second;
+    if (!inserted)
+      continue;
+
+    for (const auto& edge : _graph->lanes_from().edges(top.waypoint))
+    {
+      if (_floor_of_waypoint[edge.target] != floor)
+        continue;
+
+      if (search->visits.count(edge.target) != 0)
+        continue;
+
+      queue.push(
+        FloorCandidate{top.cost + edge.cost, edge.target, top.waypoint});
+    }
+  }
+
+  // If another thread finished the same search first, we keep its result
+  SpinLock lock(_floor_searches_mutex);
+  return _floor_searches.insert({source, std::move(search)}).first->second;
+}
+
+//==============================================================================
+std::size_t FloorHierarchy::cached_floor_searches() const
+{
+  SpinLock lock(_floor_searches_mutex);
+  return _floor_searches.size();
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
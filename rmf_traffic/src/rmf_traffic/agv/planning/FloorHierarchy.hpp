@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__FLOORHIERARCHY_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__FLOORHIERARCHY_HPP
+
+#include "Supergraph.hpp"
+#include "Tree.hpp"
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// A two level view of a graph whose waypoints are spread across several
+/// floors. The upper level only has the lanes of the floor change map, and the
+/// lower level has searches that stay on one floor. The shortest path between
+/// waypoints on different floors is found by searching the upper level, using
+/// the floor searches for the cost of moving between the floor changes. The
+/// floor searches are cached, so every query that passes through a floor
+/// change reuses the same search of the floor where it arrives.
+class FloorHierarchy
+{
+public:
+
+  /// The shortest paths from one waypoint to every waypoint that can be
+  /// reached from it without leaving its floor
+  struct FloorSearch
+  {
+    struct Visit
+    {
+      /// The cost of the shortest path from the source to this waypoint
+      double cost;
+
+      /// The waypoint before this one on the shortest path. The source is its
+      /// own parent.
+      WaypointId parent;
+    };
+
+    std::unordered_map<WaypointId, Visit> visits;
+  };
+  using ConstFloorSearchPtr = std::shared_ptr<const FloorSearch>;
+
+  FloorHierarchy(std::shared_ptr<const Supergraph> graph);
+
+  /// True if the two waypoints are on different floors
+  bool separates(WaypointId start, WaypointId finish) const;
+
+  /// Find the shortest path from the start to the finish. The cost of each
+  /// lane is the same as the ShortestPath forest uses, so the cost of the
+  /// solution is the same as the forest would find. A nullptr is returned if
+  /// the finish cannot be reached from the start.
+  ConstForestSolutionPtr solve(WaypointId start, WaypointId finish) const;
+
+  /// Get the search of the floor of the source waypoint, starting from the
+  /// source waypoint
+  ConstFloorSearchPtr floor_search(WaypointId source) const;
+
+  /// Get the number of floor searches that have been cached
+  std::size_t cached_floor_searches() const;
+
+private:
+
+  /// A lane that changes floors and is not closed
+  struct Portal
+  {
+    WaypointId entry;
+    WaypointId exit;
+    double cost;
+  };
+
+  std::shared_ptr<const Supergraph> _graph;
+  std::vector<std::size_t> _floor_of_waypoint;
+  std::vector<std::vector<Portal>> _portals_from_floor;
+
+  mutable std::unordered_map<WaypointId, ConstFloorSearchPtr> _floor_searches;
+  mutable std::atomic_bool _floor_searches_mutex = false;
+};
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__FLOORHIERARCHY_HPP
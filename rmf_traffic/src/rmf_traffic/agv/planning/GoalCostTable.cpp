@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "GoalCostTable.hpp"
+
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+GoalCostTable::GoalCostTable(
+  const CompressedAdjacency& lanes_into,
+  const std::size_t capacity,
+  const std::size_t promotion)
+: _lanes_into(&lanes_into),
+  _capacity(capacity),
+  _promotion(promotion)
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto GoalCostTable::find(const std::size_t goal) const -> ConstCostsPtr
+{
+  if (_capacity == 0 || goal >= _lanes_into->num_waypoints())
+    return nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& entry = _entries[goal];
+    ++entry.queries;
+    if (entry.costs)
+      return entry.costs;
+
+    // While another thread is building the table, the callers can use their
+    // regular search instead of waiting for it.
+    if (entry.building || entry.queries < _promotion)
+      return nullptr;
+
+    entry.building = true;
+  }
+
+  return _build(goal);
+}
+
+//==============================================================================
+auto GoalCostTable::get(const std::size_t goal) const -> ConstCostsPtr
+{
+  if (_capacity == 0 || goal >= _lanes_into->num_waypoints())
+    return nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& entry = _entries[goal];
+    ++entry.queries;
+    if (entry.costs)
+      return entry.costs;
+
+    entry.building = true;
+  }
+
+  return _build(goal);
+}
+
+//==============================================================================
+std::size_t GoalCostTable::size() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _tables;
+}
+
+//==============================================================================
+std::size_t GoalCostTable::capacity() const
+{
+  return _capacity;
+}
+
+//==============================================================================
+auto GoalCostTable::solve(
+  const CompressedAdjacency& lanes_into,
+  const std::size_t goal) -> Costs
+{
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  Costs costs(lanes_into.num_waypoints(), inf);
+
+  using Item = std::pair<double, std::size_t>;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+  costs[goal] = 0.0;
+  queue.push({0.0, goal});
+  while (!queue.empty())
+  {
+    const auto [cost, waypoint] = queue.top();
+    queue.pop();
+    if (costs[waypoint] < cost)
+      continue;
+
+    for (const auto& edge : lanes_into.edges(waypoint))
+    {
+      const double next = cost + edge.cost;
+      if (next < costs[edge.target])
+      {
+        costs[edge.target] = next;
+        queue.push({next, edge.target});
+      }
+    }
+  }
+
+  return costs;
+}
+
+//==============================================================================
+auto GoalCostTable::_build(const std::size_t goal) const -> ConstCostsPtr
+{
+  auto costs = std::make_shared<const Costs>(solve(*_lanes_into, goal));
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto& entry = _entries.at(goal);
+  if (entry.costs)
+  {
+    // Another thread built this table at the same time
+    return entry.costs;
+  }
+
+  if (_tables >= _capacity)
+  {
+    // Drop the table of the goal that has been asked about the least
+    Entry* least = nullptr;
+    for (auto& [_, other] : _entries)
+    {
+      if (other.costs && (!least || other.queries < least->queries))
+        least = &other;
+    }
+
+    if (least)
+    {
+      least->costs = nullptr;
+      --_tables;
+    }
+  }
+
+  entry.costs = costs;
+  entry.building = false;
+  ++_tables;
+  return costs;
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__GOALCOSTTABLE_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__GOALCOSTTABLE_HPP
+
+#include "CompressedAdjacency.hpp"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// Dense tables of the shortest path cost from every waypoint to a few popular
+/// goals, such as chargers and docks. A goal gets a table after it has been
+/// asked about often enough, and from then on its costs only need one lookup.
+/// The table of each goal is found with a single reverse Dijkstra search over
+/// the open lanes.
+///
+/// The tables belong to a Supergraph, so every heuristic of that supergraph
+/// shares them. This is safe to use from several threads at once.
+class GoalCostTable
+{
+public:
+
+  /// The cost from each waypoint to the goal. Waypoints that cannot reach the
+  /// goal have an infinite cost.
+  using Costs = std::vector<double>;
+  using ConstCostsPtr = std::shared_ptr<const Costs>;
+
+  /// Constructor
+  ///
+  /// \param[in] lanes_into
+  ///   The open lanes that enter each waypoint. This must outlive the table.
+  ///
+  /// \param[in] capacity
+  ///   The most goals that may have a table at once. When a new goal needs a
+  ///   table, the goal that has been asked about the least is dropped. A
+  ///   capacity of 0 turns the tables off.
+  ///
+  /// \param[in] promotion
+  ///   How many times a goal needs to be asked about before it gets a table.
+  GoalCostTable(
+    const CompressedAdjacency& lanes_into,
+    std::size_t capacity = 16,
+    std::size_t promotion = 32);
+
+  /// Count one question about a goal, and get its table if it has one. This
+  /// returns a nullptr if the goal is not popular enough yet.
+  ConstCostsPtr find(std::size_t goal) const;
+
+  /// Get the table of a goal, making it right away if needed.
+  ConstCostsPtr get(std::size_t goal) const;
+
+  /// The number of goals that have a table.
+  std::size_t size() const;
+
+  /// The most goals that may have a table at once.
+  std::size_t capacity() const;
+
+  /// Find the cost from every waypoint to a goal.
+  static Costs solve(const CompressedAdjacency& lanes_into, std::size_t goal);
+
+private:
+
+  struct Entry
+  {
+    std::size_t queries = 0;
+    ConstCostsPtr costs;
+    bool building = false;
+  };
+
+  ConstCostsPtr _build(std::size_t goal) const;
+
+  const CompressedAdjacency* _lanes_into;
+  std::size_t _capacity;
+  std::size_t _promotion;
+
+  mutable std::mutex _mutex;
+  mutable std::unordered_map<std::size_t, Entry> _entries;
+  mutable std::size_t _tables = 0;
+};
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__GOALCOSTTABLE_HPP
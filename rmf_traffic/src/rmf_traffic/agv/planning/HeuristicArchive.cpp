@@ -0,0 +1,537 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "HeuristicArchive.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <sstream>
+#include <type_traits>
+#include <unordered_set>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+namespace {
+//==============================================================================
+// Bump this whenever the layout of the archive changes
+const std::uint32_t ArchiveFormat = 1;
+const std::array<char, 8> ArchiveMagic = {'R', 'M', 'F', 'H', 'E', 'U', 'R', 0};
+
+//==============================================================================
+/// A 64-bit FNV-1a hash
+class Hasher
+{
+public:
+
+  template<typename T>
+  void add(const T& value)
+  {
+    static_assert(std::is_arithmetic_v<T>);
+    std::array<unsigned char, sizeof(T)> bytes;
+    std::memcpy(bytes.data(), &value, sizeof(T));
+    for (const auto b : bytes)
+    {
+      _hash ^= b;
+      _hash *= 1099511628211ull;
+    }
+  }
+
+  void add(const std::string& value)
+  {
+    add<std::uint64_t>(value.size());
+    for (const char c : value)
+      add(c);
+  }
+
+  void add(const Eigen::Vector2d& value)
+  {
+    add(value.x());
+    add(value.y());
+  }
+
+  template<typename T>
+  void add(const std::optional<T>& value)
+  {
+    add(value.has_value());
+    if (value.has_value())
+      add(*value);
+  }
+
+  std::uint64_t hash() const
+  {
+    return _hash;
+  }
+
+private:
+  std::uint64_t _hash = 14695981039346656037ull;
+};
+
+//==============================================================================
+void add_node(Hasher& hasher, const Graph::Lane::Node& node)
+{
+  hasher.add<std::uint64_t>(node.waypoint_index());
+  hasher.add(node.orientation_constraint() != nullptr);
+  hasher.add(node.event() != nullptr);
+  if (const auto* event = node.event())
+    hasher.add(event->duration().count());
+}
+
+//==============================================================================
+void add_limits(Hasher& hasher, const VehicleTraits::Limits& limits)
+{
+  hasher.add(limits.get_nominal_velocity());
+  hasher.add(limits.get_nominal_acceleration());
+}
+
+//==============================================================================
+template<typename T>
+void write(std::ostream& output, const T& value)
+{
+  static_assert(std::is_arithmetic_v<T>);
+  output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//==============================================================================
+template<typename T>
+bool read(std::istream& input, T& value)
+{
+  static_assert(std::is_arithmetic_v<T>);
+  input.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return input.gcount() == static_cast<std::streamsize>(sizeof(T));
+}
+
+//==============================================================================
+using SolutionEntry = ShortestPathHeuristic::SolutionEntry;
+using EuclideanStorage = EuclideanHeuristic::Storage;
+
+} // anonymous namespace
+
+//==============================================================================
+std::uint64_t fingerprint(const Supergraph& graph)
+{
+  Hasher hasher;
+
+  const auto& original = graph.original();
+  hasher.add<std::uint64_t>(original.waypoints.size());
+  for (const auto& wp : original.waypoints)
+  {
+    hasher.add(wp.get_map_name());
+    hasher.add(wp.get_location());
+    hasher.add(wp.is_passthrough_point());
+  }
+
+  hasher.add<std::uint64_t>(original.lanes.size());
+  for (const auto& lane : original.lanes)
+  {
+    add_node(hasher, lane.entry());
+    add_node(hasher, lane.exit());
+    hasher.add(lane.properties().speed_limit());
+    hasher.add(graph.closures().is_open(lane.index()));
+  }
+
+  const auto& traits = graph.traits();
+  add_limits(hasher, traits.linear());
+  add_limits(hasher, traits.rotational());
+  hasher.add(static_cast<std::uint32_t>(traits.get_steering()));
+  if (const auto* differential = traits.get_differential())
+  {
+    hasher.add(differential->get_forward());
+    hasher.add(differential->is_reversible());
+  }
+
+  const auto& options = graph.options();
+  hasher.add(options.always_stop);
+  hasher.add(options.translation_thresh);
+  hasher.add(options.rotation_thresh);
+  hasher.add(options.corner_angle_thresh);
+
+  hasher.add(graph.traversal_cost_per_meter());
+
+  return hasher.hash();
+}
+
+namespace {
+//==============================================================================
+/// The tables of a heuristic that get written into an archive
+struct ArchiveTables
+{
+  std::vector<SolutionEntry> solutions;
+  std::vector<std::pair<std::size_t, EuclideanStorage>> tables;
+};
+
+//==============================================================================
+ArchiveTables collect_tables(const ShortestPathHeuristic& heuristic)
+{
+  ArchiveTables output;
+  output.solutions = heuristic.solutions();
+  for (const auto& [goal, manager] : heuristic.heuristic_cache()->managers())
+    output.tables.push_back({goal, manager->snapshot()});
+
+  return output;
+}
+
+//==============================================================================
+void write_tables(
+  const ArchiveTables& input,
+  const Supergraph& graph,
+  std::ostream& output)
+{
+  output.write(ArchiveMagic.data(), ArchiveMagic.size());
+  write(output, ArchiveFormat);
+  write(output, fingerprint(graph));
+
+  write<std::uint64_t>(output, input.solutions.size());
+  for (const auto& entry : input.solutions)
+  {
+    write<std::uint64_t>(output, entry.start);
+    write<std::uint64_t>(output, entry.finish);
+    write<std::uint8_t>(output, entry.solution != nullptr);
+    if (!entry.solution)
+      continue;
+
+    write(output, entry.solution->cost);
+    write<std::uint64_t>(output, entry.solution->path.size());
+    for (const auto wp : entry.solution->path)
+      write<std::uint64_t>(output, wp);
+  }
+
+  write<std::uint64_t>(output, input.tables.size());
+  for (const auto& [goal, storage] : input.tables)
+  {
+    write<std::uint64_t>(output, goal);
+    write<std::uint64_t>(output, storage.size());
+    for (const auto& [wp, cost] : storage)
+    {
+      write<std::uint64_t>(output, wp);
+      write<std::uint8_t>(output, cost.has_value());
+      if (cost.has_value())
+        write(output, *cost);
+    }
+  }
+}
+
+//==============================================================================
+std::optional<ArchiveTables> read_tables(
+  const Supergraph& graph,
+  std::istream& input)
+{
+  std::array<char, 8> magic;
+  input.read(magic.data(), magic.size());
+  if (input.gcount() != static_cast<std::streamsize>(magic.size()))
+    return std::nullopt;
+
+  if (magic != ArchiveMagic)
+    return std::nullopt;
+
+  std::uint32_t format;
+  if (!read(input, format) || format != ArchiveFormat)
+    return std::nullopt;
+
+  std::uint64_t archive_fingerprint;
+  if (!read(input, archive_fingerprint))
+    return std::nullopt;
+
+  if (archive_fingerprint != fingerprint(graph))
+    return std::nullopt;
+
+  // The fingerprint already rules out a different graph, but we still check
+  // every waypoint index so that a corrupted file cannot break the planner.
+  const std::uint64_t N = graph.original().waypoints.size();
+
+  std::uint64_t solution_count;
+  if (!read(input, solution_count))
+    return std::nullopt;
+
+  ArchiveTables output;
+  for (std::uint64_t i = 0; i < solution_count; ++i)
+  {
+    std::uint64_t start, finish;
+    std::uint8_t found;
+    if (!read(input, start) || !read(input, finish) || !read(input, found))
+      return std::nullopt;
+
+    if (N <= start || N <= finish)
+      return std::nullopt;
+
+    if (!found)
+    {
+      output.solutions.push_back({start, finish, nullptr});
+      continue;
+    }
+
+    ForestSolution solution;
+    std::uint64_t length;
+    if (!read(input, solution.cost) || !read(input, length))
+      return std::nullopt;
+
+    for (std::uint64_t j = 0; j < length; ++j)
+    {
+      std::uint64_t wp;
+      if (!read(input, wp))
+        return std::nullopt;
+
+      if (N <= wp)
+        return std::nullopt;
+
+      solution.path.push_back(wp);
+    }
+
+    output.solutions.push_back(
+      {start, finish, std::make_shared<ForestSolution>(std::move(solution))});
+  }
+
+  std::uint64_t goal_count;
+  if (!read(input, goal_count))
+    return std::nullopt;
+
+  for (std::uint64_t i = 0; i < goal_count; ++i)
+  {
+    std::uint64_t goal, entry_count;
+    if (!read(input, goal) || !read(input, entry_count))
+      return std::nullopt;
+
+    if (N <= goal)
+      return std::nullopt;
+
+    EuclideanStorage storage;
+    for (std::uint64_t j = 0; j < entry_count; ++j)
+    {
+      std::uint64_t wp;
+      std::uint8_t found;
+      if (!read(input, wp) || !read(input, found))
+        return std::nullopt;
+
+      if (N <= wp)
+        return std::nullopt;
+
+      std::optional<double> cost;
+      if (found)
+      {
+        double value;
+        if (!read(input, value))
+          return std::nullopt;
+
+        cost = value;
+      }
+
+      storage.insert({wp, cost});
+    }
+
+    output.tables.push_back({goal, std::move(storage)});
+  }
+
+  return output;
+}
+
+//==============================================================================
+void preload_tables(
+  const ShortestPathHeuristic& heuristic,
+  ArchiveTables input)
+{
+  for (auto& entry : input.solutions)
+    heuristic.preload(std::move(entry));
+
+  for (auto& [goal, storage] : input.tables)
+    heuristic.heuristic_cache()->get(goal)->preload(std::move(storage));
+}
+
+//==============================================================================
+const std::array<char, 8> JournalMagic = {'R', 'M', 'F', 'J', 'R', 'N', 'L', 0};
+
+//==============================================================================
+std::uint64_t checksum(const std::string& data)
+{
+  Hasher hasher;
+  for (const char c : data)
+    hasher.add(c);
+
+  return hasher.hash();
+}
+
+//==============================================================================
+/// Read the payload of the next record of a journal.
+///
+/// \return false if there are no more records that can be read. A record that
+/// was cut short can only be the last one, since it was still being written.
+bool read_record(std::istream& input, std::string& payload, bool& intact)
+{
+  std::array<char, 8> magic;
+  input.read(magic.data(), magic.size());
+  if (input.gcount() != static_cast<std::streamsize>(magic.size()))
+    return false;
+
+  if (magic != JournalMagic)
+    return false;
+
+  std::uint64_t size, expected_checksum;
+  if (!read(input, size) || !read(input, expected_checksum))
+    return false;
+
+  // Make sure that a corrupted size cannot make us allocate more than what is
+  // left in the journal.
+  const auto here = input.tellg();
+  if (here < 0)
+    return false;
+
+  input.seekg(0, std::ios::end);
+  const auto end = input.tellg();
+  input.seekg(here);
+  if (end < here || static_cast<std::uint64_t>(end - here) < size)
+    return false;
+
+  payload.resize(size);
+  input.read(payload.data(), static_cast<std::streamsize>(size));
+  if (input.gcount() != static_cast<std::streamsize>(size))
+    return false;
+
+  intact = checksum(payload) == expected_checksum;
+  return true;
+}
+
+//==============================================================================
+void write_record(std::ostream& output, const std::string& payload)
+{
+  std::string record;
+  record.reserve(
+    JournalMagic.size() + 2*sizeof(std::uint64_t) + payload.size());
+  record.append(JournalMagic.data(), JournalMagic.size());
+
+  const auto append = [&record](const std::uint64_t value)
+    {
+      record.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+  append(payload.size());
+  append(checksum(payload));
+  record.append(payload);
+
+  // The whole record goes out in one write so that a journal opened in append
+  // mode by several processes does not get records that are mixed together.
+  output.write(record.data(), static_cast<std::streamsize>(record.size()));
+}
+
+} // anonymous namespace
+
+//==============================================================================
+void save_heuristic(
+  const ShortestPathHeuristic& heuristic,
+  const Supergraph& graph,
+  std::ostream& output)
+{
+  write_tables(collect_tables(heuristic), graph, output);
+}
+
+//==============================================================================
+bool load_heuristic(
+  const ShortestPathHeuristic& heuristic,
+  const Supergraph& graph,
+  std::istream& input)
+{
+  auto tables = read_tables(graph, input);
+  if (!tables.has_value())
+    return false;
+
+  preload_tables(heuristic, std::move(*tables));
+  return true;
+}
+
+//==============================================================================
+void sync_heuristic(
+  const ShortestPathHeuristic& heuristic,
+  const Supergraph& graph,
+  std::istream& journal,
+  std::ostream& output)
+{
+  const std::size_t N = graph.original().waypoints.size();
+  std::unordered_set<std::size_t> published_solutions;
+  std::unordered_map<std::size_t, std::unordered_set<std::size_t>>
+  published_tables;
+
+  std::string payload;
+  bool intact = false;
+  while (read_record(journal, payload, intact))
+  {
+    if (!intact)
+      continue;
+
+    std::istringstream record(payload);
+    auto tables = read_tables(graph, record);
+    if (!tables.has_value())
+    {
+      // This record was written for a different configuration
+      continue;
+    }
+
+    for (const auto& entry : tables->solutions)
+      published_solutions.insert(entry.start*N + entry.finish);
+
+    for (const auto& [goal, storage] : tables->tables)
+    {
+      auto& published = published_tables[goal];
+      for (const auto& [wp, cost] : storage)
+        published.insert(wp);
+    }
+
+    preload_tables(heuristic, std::move(*tables));
+  }
+
+  // Only publish what nobody else has published yet, so the journal does not
+  // keep growing with copies of the same tables.
+  auto tables = collect_tables(heuristic);
+  auto& solutions = tables.solutions;
+  solutions.erase(
+    std::remove_if(solutions.begin(), solutions.end(),
+    [&](const SolutionEntry& entry)
+    {
+      return published_solutions.count(entry.start*N + entry.finish) > 0;
+    }), solutions.end());
+
+  std::size_t new_entries = solutions.size();
+  for (auto& [goal, storage] : tables.tables)
+  {
+    const auto published = published_tables.find(goal);
+    if (published == published_tables.end())
+    {
+      new_entries += storage.size();
+      continue;
+    }
+
+    for (auto it = storage.begin(); it != storage.end(); )
+    {
+      if (published->second.count(it->first) > 0)
+        it = storage.erase(it);
+      else
+        ++it;
+    }
+
+    new_entries += storage.size();
+  }
+
+  if (new_entries > 0)
+  {
+    std::ostringstream record;
+    write_tables(tables, graph, record);
+    write_record(output, record.str());
+  }
+}
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__HEURISTICARCHIVE_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__HEURISTICARCHIVE_HPP
+
+#include "ShortestPathHeuristic.hpp"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// Compute a hash of everything that the heuristic tables of a supergraph
+/// depend on: the graph, the vehicle traits, the lane closures, the
+/// interpolation options, and the traversal cost. Tables that were computed
+/// for one fingerprint should never be used for a different one.
+std::uint64_t fingerprint(const Supergraph& graph);
+
+//==============================================================================
+/// Write the shortest path solutions and Euclidean heuristic tables that have
+/// been computed so far into a compact binary archive. The archive is stamped
+/// with the fingerprint of the graph.
+void save_heuristic(
+  const ShortestPathHeuristic& heuristic,
+  const Supergraph& graph,
+  std::ostream& output);
+
+//==============================================================================
+/// Preload the tables of an archive that was written by save_heuristic(). The
+/// whole archive is checked before anything gets loaded, so nothing will be
+/// loaded if this returns false.
+///
+/// \return false if the archive cannot be read or its fingerprint does not
+/// match the graph.
+bool load_heuristic(
+  const ShortestPathHeuristic& heuristic,
+  const Supergraph& graph,
+  std::istream& input);
+
+//==============================================================================
+/// Share heuristic tables with other planners through an append-only journal.
+/// Every record of the journal whose fingerprint matches the graph gets
+/// preloaded, and then the tables of the heuristic that are not in the
+/// journal yet are written to the output as one new record. Nothing is
+/// written if every table was already in the journal.
+///
+/// Each record is stamped with a checksum. Records that are damaged or meant
+/// for a different fingerprint are skipped, and reading stops at a record
+/// that was cut short.
+///
+/// \param[in] journal
+///   The records that have been published so far
+///
+/// \param[in] output
+///   Where the new record should be appended. This should be the end of the
+///   same journal.
+void sync_heuristic(
+  const ShortestPathHeuristic& heuristic,
+  const Supergraph& graph,
+  std::istream& journal,
+  std::ostream& output);
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__HEURISTICARCHIVE_HPP
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__NODEARENA_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__NODEARENA_HPP
+
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// A monotonic arena for the nodes of a search. Nodes are placed one after
+/// another in large blocks and they are never freed individually. Every node
+/// is destroyed when the arena is destroyed, so nodes can refer to their
+/// parents with raw pointers.
+///
+/// An arena may keep other arenas alive, so that a copy of a search can keep
+/// growing on its own while it still refers to the nodes that came before it.
+///
+/// The blocks are allocated from a memory resource. When no resource is given,
+/// the arena uses the resource of the previous arena, or else the default
+/// memory resource.
+template<typename Node, std::size_t BlockSize = 256>
+class NodeArena
+{
+public:
+
+  NodeArena(
+    std::shared_ptr<const NodeArena> previous = nullptr,
+    std::pmr::memory_resource* resource = nullptr)
+  : _resource(
+      resource ? resource :
+      previous ? previous->_resource :
+      std::pmr::get_default_resource()),
+    _blocks(_resource)
+  {
+    keep_alive(std::move(previous));
+  }
+
+  NodeArena(const NodeArena&) = delete;
+  NodeArena& operator=(const NodeArena&) = delete;
+
+  /// Construct a new node in the arena.
+  template<typename... Args>
+  Node* make(Args&&... args)
+  {
+    if (_next == BlockSize)
+    {
+      // Make room for the block first so that it cannot leak if the vector
+      // fails to grow.
+      if (_blocks.size() == _blocks.capacity())
+        _blocks.reserve(2 * _blocks.size() + 1);
+
+      _blocks.push_back(
+        new (_resource->allocate(sizeof(Block), alignof(Block))) Block);
+      _next = 0;
+    }
+
+    Node* const node =
+      new (_blocks.back()->at(_next)) Node(std::forward<Args>(args)...);
+
+    ++_next;
+    return node;
+  }
+
+  /// Keep the nodes of another arena alive for as long as this one lives.
+  void keep_alive(std::shared_ptr<const NodeArena> other)
+  {
+    if (other)
+      _previous.emplace_back(std::move(other));
+  }
+
+  /// The number of nodes that have been made in this arena.
+  std::size_t size() const
+  {
+    if (_blocks.empty())
+      return 0;
+
+    return (_blocks.size() - 1) * BlockSize + _next;
+  }
+
+  /// The memory resource that the blocks of this arena are allocated from.
+  std::pmr::memory_resource* resource() const
+  {
+    return _resource;
+  }
+
+  ~NodeArena()
+  {
+    for (std::size_t b = 0; b < _blocks.size(); ++b)
+    {
+      const std::size_t count = b+1 < _blocks.size() ? BlockSize : _next;
+      for (std::size_t i = 0; i < count; ++i)
+        std::launder(reinterpret_cast<Node*>(_blocks[b]->at(i)))->~Node();
+
+      _resource->deallocate(_blocks[b], sizeof(Block), alignof(Block));
+    }
+  }
+
+private:
+
+  struct Block
+  {
+    alignas(Node) unsigned char data[sizeof(Node) * BlockSize];
+
+    void* at(const std::size_t i)
+    {
+      return data + i * sizeof(Node);
+    }
+  };
+
+  std::pmr::memory_resource* _resource;
+  std::pmr::vector<Block*> _blocks;
+  std::size_t _next = BlockSize;
+  std::vector<std::shared_ptr<const NodeArena>> _previous;
+};
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__NODEARENA_HPP
@@ -18,6 +18,7 @@
 #include "ShortestPathHeuristic.hpp"
 #include "a_star.hpp"
 
+#include <cmath>
 #include <queue>
 
 namespace rmf_traffic {
@@ -25,53 +26,28 @@ namespace agv {
 namespace planning {
 
 //==============================================================================
-template<
-  typename GetNextWaypoint,
-  typename NodePtrT, typename C>
+template<typename NodePtrT, typename C>
 void expand_lane(
   const NodePtrT& top,
   FrontierTemplate<NodePtrT, C>& frontier,
   std::unordered_map<WaypointId, NodePtrT>& visited,
-  const Graph::Implementation& g,
-  const LaneClosure& closures,
-  const double agent_max_speed,
-  const std::vector<std::size_t>& lanes)
-{
-  const auto& wp_0 = g.waypoints[top->waypoint];
-  const auto& p_0 = wp_0.get_location();
-  for (const auto l : lanes)
+  const CompressedAdjacency& adjacency)
+{
+  // The adjacency view only has open lanes, and their costs are already known
+  for (const auto& edge : adjacency.edges(top->waypoint))
   {
-    if (closures.is_closed(l))
-      continue;
-
-    const auto& next_lane = g.lanes[l];
-    const auto next_waypoint = GetNextWaypoint()(next_lane);
-    if (visited.count(next_waypoint) != 0)
+    if (visited.count(edge.target) != 0)
     {
       // If this waypoint has already been visited, then we should not bother
       // trying to expand it.
       continue;
     }
 
-    const auto& wp_1 = g.waypoints[next_waypoint];
-    const auto& p_1 = wp_1.get_location();
-
-    const auto max_speed =
-      next_lane.properties().speed_limit().value_or(agent_max_speed);
-
-    double local_cost = (p_1 - p_0).norm()/max_speed;
-
-    if (const auto* entry_event = next_lane.entry().event())
-      local_cost += rmf_traffic::time::to_seconds(entry_event->duration());
-
-    if (const auto* exit_event = next_lane.exit().event())
-      local_cost += rmf_traffic::time::to_seconds(exit_event->duration());
-
     frontier.push(
       std::make_shared<typename NodePtrT::element_type>(
         typename NodePtrT::element_type{
-          next_waypoint,
-          top->current_cost + local_cost,
+          edge.target,
+          top->current_cost + edge.cost,
           top
         }));
   }
@@ -82,21 +58,11 @@ ShortestPath::ForwardExpander::ForwardExpander(
   std::shared_ptr<const Supergraph> graph,
   const HeuristicCachePtr&,
   const WaypointId)
-: _graph(std::move(graph)),
-  _max_speed(_graph->traits().linear().get_nominal_velocity())
+: _graph(std::move(graph))
 {
   // Do nothing
 }
 
-//==============================================================================
-struct ForwardGetNextWaypoint
-{
-  std::size_t operator()(const rmf_traffic::agv::Graph::Lane& lane) const
-  {
-    return lane.exit().waypoint_index();
-  }
-};
-
 //==============================================================================
 ShortestPath::ForwardNodePtr ShortestPath::ForwardExpander::expand(
   const ForwardNodePtr& top,
@@ -112,11 +78,7 @@ ShortestPath::ForwardNodePtr ShortestPath::ForwardExpander::expand(
     return nullptr;
   }
 
-  const auto& g = _graph->original();
-  const auto& closures = _graph->closures();
-  expand_lane<ForwardGetNextWaypoint>(
-    top, frontier, visited, g, closures, _max_speed,
-    g.lanes_from[top->waypoint]);
+  expand_lane(top, frontier, visited, _graph->lanes_from());
 
   return top;
 }
@@ -152,21 +114,11 @@ ShortestPath::ReverseExpander::ReverseExpander(
   std::shared_ptr<const Supergraph> graph,
   const HeuristicCachePtr&,
   const WaypointId)
-: _graph(std::move(graph)),
-  _max_speed(_graph->traits().linear().get_nominal_velocity())
+: _graph(std::move(graph))
 {
   // Do nothing
 }
 
-//==============================================================================
-struct ReverseGetNextWaypoint
-{
-  std::size_t operator()(const rmf_traffic::agv::Graph::Lane& lane) const
-  {
-    return lane.entry().waypoint_index();
-  }
-};
-
 //==============================================================================
 ShortestPath::ReverseNodePtr ShortestPath::ReverseExpander::expand(
   const ReverseNodePtr& top,
@@ -182,11 +134,7 @@ ShortestPath::ReverseNodePtr ShortestPath::ReverseExpander::expand(
     return nullptr;
   }
 
-  const auto& g = _graph->original();
-  const auto& closures = _graph->closures();
-  expand_lane<ReverseGetNextWaypoint>(
-    top, frontier, visited, g, closures, _max_speed,
-    g.lanes_into[top->waypoint]);
+  expand_lane(top, frontier, visited, _graph->lanes_into());
 
   return top;
 }
@@ -226,7 +174,69 @@ ShortestPathHeuristic::ShortestPathHeuristic(
     std::make_shared<EuclideanHeuristicCacheMap>(
       std::make_shared<EuclideanHeuristicFactory>(graph)))
 {
-  // Do nothing
+  if (graph->contraction_hierarchy())
+    _contraction = std::make_shared<ContractionHierarchy>(graph);
+  else if (graph->floor_hierarchy())
+    _floors = std::make_shared<FloorHierarchy>(graph);
+
+  _graph = std::move(graph);
+}
+
+//==============================================================================
+ConstForestSolutionPtr ShortestPathHeuristic::get(
+  const WaypointId start,
+  const WaypointId finish) const
+{
+  const bool use_floors = _floors && _floors->separates(start, finish);
+  if (!_contraction && !use_floors)
+    return BidirectionalForest<ShortestPath>::get(start, finish);
+
+  if (const auto known = _check_for_solution(start, finish))
+    return *known;
+
+  // The solution goes into the forest so that it gets archived and carried
+  // over just like the ones that the forest finds itself.
+  preload(
+    {
+      start, finish,
+      _contraction ?
+      _contraction->solve(start, finish) : _floors->solve(start, finish)
+    });
+  return _check_for_solution(start, finish).value_or(nullptr);
+}
+
+//==============================================================================
+std::optional<double> ShortestPathHeuristic::get_cost(
+  const WaypointId start,
+  const WaypointId finish) const
+{
+  // Popular goals have a dense table of costs, which is much cheaper than
+  // asking the forest.
+  if (const auto costs = _graph->goal_costs().find(finish))
+  {
+    const double cost = (*costs)[start];
+    if (std::isinf(cost))
+      return std::nullopt;
+
+    return cost;
+  }
+
+  if (const auto solution = get(start, finish))
+    return solution->cost;
+
+  return std::nullopt;
+}
+
+//==============================================================================
+const FloorHierarchy* ShortestPathHeuristic::floors() const
+{
+  return _floors.get();
+}
+
+//==============================================================================
+const ContractionHierarchy* ShortestPathHeuristic::contraction() const
+{
+  return _contraction.get();
 }
 
 } // namespace planning
@@ -21,7 +21,9 @@
 #include "CacheManager.hpp"
 #include "Supergraph.hpp"
 
+#include "ContractionHierarchy.hpp"
 #include "EuclideanHeuristic.hpp"
+#include "FloorHierarchy.hpp"
 #include "Tree.hpp"
 
 namespace rmf_traffic {
@@ -80,7 +82,6 @@ public:
 
   private:
     std::shared_ptr<const Supergraph> _graph;
-    double _max_speed;
   };
   using ForwardTree = Tree<ForwardExpander>;
 
@@ -133,7 +134,6 @@ public:
 
   private:
     std::shared_ptr<const Supergraph> _graph;
-    double _max_speed;
   };
 
   using ReverseTree = Tree<ReverseExpander>;
@@ -186,6 +186,25 @@ public:
   ShortestPathHeuristic(
     std::shared_ptr<const Supergraph> graph);
 
+  /// Get the shortest path between two waypoints. If the supergraph asks for a
+  /// contraction hierarchy, every path is found by it. Otherwise if the
+  /// supergraph asks for a floor hierarchy, paths between floors are found by
+  /// the hierarchy, and the forest is only grown for paths that stay on one
+  /// floor.
+  ConstForestSolutionPtr get(WaypointId start, WaypointId finish) const;
+
+  std::optional<double> get_cost(WaypointId start, WaypointId finish) const;
+
+  /// Get the floor hierarchy, or a nullptr if it is not being used
+  const FloorHierarchy* floors() const;
+
+  /// Get the contraction hierarchy, or a nullptr if it is not being used
+  const ContractionHierarchy* contraction() const;
+
+private:
+  std::shared_ptr<const Supergraph> _graph;
+  std::shared_ptr<const FloorHierarchy> _floors;
+  std::shared_ptr<const ContractionHierarchy> _contraction;
 };
 
 //==============================================================================
@@ -16,9 +16,11 @@
 */
 
 #include "Supergraph.hpp"
+#include "../../schedule/internal_WorkerPool.hpp"
 
 #include <rmf_utils/math.hpp>
 
+#include <algorithm>
 #include <unordered_set>
 
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__SUPERGRAPH
@@ -131,15 +133,17 @@ void node_to_traversals(
   if (node.entry_event)
   {
     traversal.entry_event = node.entry_event->clone();
+    traversal.entry_event_duration = traversal.entry_event->duration();
     traversal.best_cost += rmf_traffic::time::to_seconds(
-      traversal.entry_event->duration());
+      traversal.entry_event_duration);
   }
 
   if (node.exit_event)
   {
     traversal.exit_event = node.exit_event->clone();
+    traversal.exit_event_duration = traversal.exit_event->duration();
     traversal.best_cost += rmf_traffic::time::to_seconds(
-      traversal.exit_event->duration());
+      traversal.exit_event_duration);
   }
 
   if (node.standstill)
@@ -148,6 +152,7 @@ void node_to_traversals(
     alt.routes = make_start_factory(
       node.initial_p, std::nullopt, kin.limits,
       kin.interpolate.rotation_thresh, traversal.maps);
+    alt.free_routes = alt.routes(std::nullopt);
 
     // If the node is a standstill, just add this empty Alternative
     traversal.alternatives[static_cast<std::size_t>(Orientation::Any)] =
@@ -209,6 +214,7 @@ void node_to_traversals(
     const auto time = factory_info.minimum_cost;
     alternative.cost = time;
     alternative.routes = std::move(factory_info.factory);
+    alternative.free_routes = alternative.routes(std::nullopt);
 
 #ifdef RMF_TRAFFIC__AGV__PLANNING__DEBUG__SUPERGRAPH
     std::cout << "SUPERGRAPH [" << traversal.initial_lane_index
@@ -458,6 +464,70 @@ void initiate_traversal(
     nullptr, lane_index, graph, closures, kin, queue, output, visited);
 }
 
+//==============================================================================
+/// The waypoint connects exactly two neighbors and nothing about it gives a
+/// robot a reason to stop there, so it is only ever passed through on the way
+/// along a corridor.
+bool is_corridor_waypoint(
+  const Graph::Implementation& graph,
+  const std::size_t waypoint_index)
+{
+  const auto& wp = graph.waypoints[waypoint_index];
+  if (wp.is_holding_point() || wp.is_parking_spot() || wp.is_charger()
+    || wp.name())
+    return false;
+
+  std::unordered_set<std::size_t> neighbors;
+  for (const auto l : graph.lanes_from[waypoint_index])
+    neighbors.insert(graph.lanes[l].exit().waypoint_index());
+
+  for (const auto l : graph.lanes_into[waypoint_index])
+    neighbors.insert(graph.lanes[l].entry().waypoint_index());
+
+  return neighbors.size() == 2
+    && graph.lanes_from[waypoint_index].size() <= 2
+    && graph.lanes_into[waypoint_index].size() <= 2;
+}
+
+//==============================================================================
+/// Mark the traversals that stop at a corridor waypoint while a longer
+/// traversal carries on through it along the same lanes with every one of
+/// the same orientations.
+void mark_corridors(
+  const Graph::Implementation& graph,
+  std::vector<Traversal>& output)
+{
+  for (auto& traversal : output)
+  {
+    if (!is_corridor_waypoint(graph, traversal.finish_waypoint_index))
+      continue;
+
+    const auto& lanes = traversal.traversed_lanes;
+    for (const auto& other : output)
+    {
+      if (other.traversed_lanes.size() <= lanes.size())
+        continue;
+
+      if (!std::equal(lanes.begin(), lanes.end(),
+        other.traversed_lanes.begin()))
+        continue;
+
+      bool covered = true;
+      for (std::size_t i = 0; i < traversal.alternatives.size(); ++i)
+      {
+        if (traversal.alternatives[i] && !other.alternatives[i])
+          covered = false;
+      }
+
+      if (covered)
+      {
+        traversal.corridor = true;
+        break;
+      }
+    }
+  }
+}
+
 } // anonymous namespace
 
 double calculate_cost(
@@ -564,7 +634,7 @@ TraversalFromGenerator::TraversalFromGenerator(
 //==============================================================================
 ConstTraversalsPtr TraversalFromGenerator::generate(
   const std::size_t& key,
-  const Storage&, // old items are irrelevant
+  const OldItems&, // old items are irrelevant
   Storage& new_items) const
 {
   const auto supergraph = _graph.lock();
@@ -588,28 +658,32 @@ ConstTraversalsPtr TraversalFromGenerator::generate(
   const std::size_t waypoint_index = key;
   const auto& graph = supergraph->original();
   const auto& closures = supergraph->closures();
-  const auto& initial_lanes = graph.lanes_from[waypoint_index];
+  const auto& lanes_from = supergraph->lanes_from();
   std::vector<TraversalNode> queue;
   std::vector<Traversal> output;
   std::unordered_set<std::size_t> visited;
   visited.insert(waypoint_index);
 
-  for (const auto l : initial_lanes)
-    initiate_traversal(l, graph, closures, _kinematics, queue, output, visited);
+  for (const auto& edge : lanes_from.edges(waypoint_index))
+  {
+    initiate_traversal(
+      edge.lane, graph, closures, _kinematics, queue, output, visited);
+  }
 
   while (!queue.empty())
   {
     auto top = std::move(queue.back());
     queue.pop_back();
 
-    const auto& lanes = graph.lanes_from[top.finish_waypoint_index];
-    for (const auto l : lanes)
+    for (const auto& edge : lanes_from.edges(top.finish_waypoint_index))
     {
       expand_traversal(
-        top, l, graph, closures, _kinematics, queue, output, visited);
+        top, edge.lane, graph, closures, _kinematics, queue, output, visited);
     }
   }
 
+  mark_corridors(graph, output);
+
   auto new_traversals = std::make_shared<Traversals>(std::move(output));
   new_items.insert({waypoint_index, new_traversals});
 
@@ -629,7 +703,7 @@ TraversalIntoGenerator::TraversalIntoGenerator(
 //==============================================================================
 ConstTraversalsPtr TraversalIntoGenerator::generate(
   const std::size_t& key,
-  const Storage&, // old items are irrelevant
+  const OldItems&, // old items are irrelevant
   Storage& new_items) const
 {
   const auto supergraph = _graph.lock();
@@ -674,31 +748,107 @@ ConstTraversalsPtr TraversalIntoGenerator::generate(
   return traversals_into;
 }
 
+namespace {
+//==============================================================================
+/// Count the bytes of a set of traversals that is stored in a traversal cache.
+/// The route factories of the alternatives are not counted.
+std::size_t traversals_bytes(
+  const std::size_t&,
+  const ConstTraversalsPtr& traversals)
+{
+  std::size_t bytes = sizeof(std::pair<const std::size_t, ConstTraversalsPtr>)
+    + 2*sizeof(void*);
+
+  if (!traversals)
+    return bytes;
+
+  // The traversals are made by std::make_shared
+  bytes += 2*sizeof(void*) + sizeof(Traversals)
+    + traversals->capacity()*sizeof(Traversal);
+
+  for (const auto& traversal : *traversals)
+  {
+    bytes += traversal.maps.capacity()*sizeof(std::string)
+      + traversal.traversed_lanes.capacity()*sizeof(std::size_t);
+
+    for (const auto& map : traversal.maps)
+    {
+      // Short strings are stored inside of the string object itself
+      if (map.capacity() >= sizeof(std::string))
+        bytes += map.capacity() + 1;
+    }
+  }
+
+  return bytes;
+}
+} // anonymous namespace
+
 //==============================================================================
 std::shared_ptr<const Supergraph> Supergraph::make(
   Graph::Implementation original,
   VehicleTraits traits,
   LaneClosure lane_closures,
   const Interpolate::Options::Implementation& interpolate,
-  double traversal_cost_per_meter)
+  double traversal_cost_per_meter,
+  const std::optional<std::size_t> eager_threads,
+  const bool floor_hierarchy,
+  const bool contract_corridors,
+  const bool contraction_hierarchy)
+{
+  return make(
+    std::make_shared<const Graph::Implementation>(std::move(original)),
+    std::move(traits), std::move(lane_closures), interpolate,
+    traversal_cost_per_meter, eager_threads, floor_hierarchy,
+    contract_corridors, contraction_hierarchy);
+}
+
+//==============================================================================
+std::shared_ptr<const Supergraph> Supergraph::make(
+  std::shared_ptr<const Graph::Implementation> original,
+  VehicleTraits traits,
+  LaneClosure lane_closures,
+  const Interpolate::Options::Implementation& interpolate,
+  double traversal_cost_per_meter,
+  const std::optional<std::size_t> eager_threads,
+  const bool floor_hierarchy,
+  const bool contract_corridors,
+  const bool contraction_hierarchy)
 {
   auto supergraph = std::shared_ptr<Supergraph>(
     new Supergraph(
       std::move(original), std::move(traits),
       std::move(lane_closures), interpolate, traversal_cost_per_meter));
 
+  supergraph->_floor_hierarchy = floor_hierarchy;
+  supergraph->_contract_corridors = contract_corridors;
+  supergraph->_contraction_hierarchy = contraction_hierarchy;
+
   supergraph->_traversals_from =
     CacheManager<TraversalFromCache>::make(
     std::make_shared<TraversalFromGenerator>(supergraph));
+  supergraph->_traversals_from->set_grouping(nullptr, traversals_bytes);
 
   supergraph->_traversals_into =
     CacheManager<TraversalIntoCache>::make(
     std::make_shared<TraversalIntoGenerator>(
       supergraph->_traversals_from, supergraph));
+  supergraph->_traversals_into->set_grouping(nullptr, traversals_bytes);
 
   supergraph->_entries_into_waypoint_cache =
     CacheManager<EntriesCache>::make(
     std::make_shared<EntriesGenerator>(supergraph));
+  supergraph->_entries_into_waypoint_cache->set_grouping(
+    nullptr,
+    [](const std::size_t&, const ConstEntriesPtr& entries) -> std::size_t
+    {
+      std::size_t bytes = sizeof(EntriesCache::Storage::value_type)
+        + 2*sizeof(void*);
+
+      if (entries)
+        bytes += 2*sizeof(void*) + entries->memory_usage();
+
+      return bytes;
+    });
 
   const std::size_t N_lanes = supergraph->original().lanes.size();
   supergraph->_lane_yaw_cache =
@@ -706,13 +856,129 @@ std::shared_ptr<const Supergraph> Supergraph::make(
     std::make_shared<LaneYawGenerator>(supergraph),
     [N_lanes]() { return LaneYawMap(251, EntryHash(N_lanes)); });
 
+  if (eager_threads.has_value())
+    supergraph->precompute(*eager_threads);
+
   return supergraph;
 }
 
+//==============================================================================
+LaneClosureChange::LaneClosureChange(
+  const LaneClosure& from,
+  const LaneClosure& to,
+  const std::size_t N_lanes)
+: closed(N_lanes, false),
+  opened(N_lanes, false)
+{
+  // Only the closed lanes of each side need to be compared, which is much less
+  // than every lane of a large graph.
+  for (const std::size_t l : to.closed_lanes())
+  {
+    if (l < N_lanes && !from.is_closed(l))
+    {
+      closed[l] = true;
+      any_closed = true;
+    }
+  }
+
+  for (const std::size_t l : from.closed_lanes())
+  {
+    if (l < N_lanes && !to.is_closed(l))
+    {
+      opened[l] = true;
+      any_opened = true;
+    }
+  }
+}
+
+//==============================================================================
+std::shared_ptr<const Supergraph> Supergraph::with_closures(
+  LaneClosure closures,
+  const std::optional<std::size_t> eager_threads) const
+{
+  // The closed lanes matter here, so we use every lane of the original graph
+  const auto& all_lanes_from = _original->lanes_from;
+  const LaneClosureChange change(
+    _lane_closures, closures, _original->lanes.size());
+
+  const auto overlay = make(
+    _original, _traits, std::move(closures),
+    _interpolate, _traversal_cost_per_meter, std::nullopt, _floor_hierarchy,
+    _contract_corridors, _contraction_hierarchy);
+
+  // The search for the traversals of a waypoint only ever considers the lanes
+  // that leave that waypoint and the lanes that leave the finish waypoints of
+  // the traversals that it found. If none of those lanes were opened or
+  // closed, then the search would find exactly the same traversals again.
+  const auto unaffected = [&](
+    const std::size_t waypoint, const ConstTraversalsPtr& traversals)
+    {
+      for (const auto l : all_lanes_from[waypoint])
+      {
+        if (change.changed(l))
+          return false;
+      }
+
+      for (const auto& traversal : *traversals)
+      {
+        for (const auto l : all_lanes_from[traversal.finish_waypoint_index])
+        {
+          if (change.changed(l))
+            return false;
+        }
+      }
+
+      return true;
+    };
+
+  auto traversals = _traversals_from->snapshot();
+  for (auto it = traversals.begin(); it != traversals.end(); )
+  {
+    if (unaffected(it->first, it->second))
+      ++it;
+    else
+      it = traversals.erase(it);
+  }
+  overlay->_traversals_from->preload(std::move(traversals));
+
+  // The traversals into a waypoint are gathered from the traversals out of
+  // many other waypoints, so we let the overlay gather them again from the
+  // traversals that it was given.
+
+  overlay->_entries_into_waypoint_cache->preload(
+    _entries_into_waypoint_cache->snapshot());
+
+  overlay->_lane_yaw_cache->preload(_lane_yaw_cache->snapshot());
+
+  if (eager_threads.has_value())
+    overlay->precompute(*eager_threads);
+
+  return overlay;
+}
+
+//==============================================================================
+void Supergraph::precompute(const std::size_t threads) const
+{
+  const std::size_t N = _original->waypoints.size();
+  schedule::WorkerPool pool(std::max<std::size_t>(threads, 1));
+
+  // The traversals into a waypoint are gathered from the traversals out of
+  // its neighbors, so we find every traversal out of a waypoint first. The
+  // caches take care of their own locking.
+  pool.run(N, [&](const std::size_t wp) { traversals_from(wp); });
+
+  pool.run(
+    N, [&](const std::size_t wp)
+    {
+      traversals_into(wp);
+      entries_into(wp);
+    });
+}
+
 //==============================================================================
 const Graph::Implementation& Supergraph::original() const
 {
-  return _original;
+  return *_original;
 }
 
 //==============================================================================
@@ -739,12 +1005,48 @@ double Supergraph::traversal_cost_per_meter() const
   return _traversal_cost_per_meter;
 }
 
+//==============================================================================
+bool Supergraph::floor_hierarchy() const
+{
+  return _floor_hierarchy;
+}
+
+//==============================================================================
+bool Supergraph::contract_corridors() const
+{
+  return _contract_corridors;
+}
+
+//==============================================================================
+bool Supergraph::contraction_hierarchy() const
+{
+  return _contraction_hierarchy;
+}
+
 //==============================================================================
 auto Supergraph::floor_change() const -> const FloorChangeMap&
 {
   return _floor_changes;
 }
 
+//==============================================================================
+const CompressedAdjacency& Supergraph::lanes_from() const
+{
+  return _lanes_from;
+}
+
+//==============================================================================
+const CompressedAdjacency& Supergraph::lanes_into() const
+{
+  return _lanes_into;
+}
+
+//==============================================================================
+const GoalCostTable& Supergraph::goal_costs() const
+{
+  return _goal_costs;
+}
+
 //==============================================================================
 ConstTraversalsPtr Supergraph::traversals_from(
   const std::size_t waypoint_index) const
@@ -820,6 +1122,14 @@ Supergraph::Entries::Entries(
     + (_agnostic_entry.has_value() ? 1 : 0);
 }
 
+//==============================================================================
+std::size_t Supergraph::Entries::memory_usage() const
+{
+  return sizeof(Entries)
+    + _angled_entries.size()
+    * (4*sizeof(void*) + sizeof(std::pair<const double, Entry>));
+}
+
 //==============================================================================
 Supergraph::ConstEntriesPtr Supergraph::entries_into(
   const std::size_t waypoint_index) const
@@ -843,11 +1153,11 @@ std::optional<double> Supergraph::yaw_of(const Entry& entry) const
   if (!_constraint.has_value())
     return std::nullopt;
 
-  const auto& lane = _original.lanes[entry.lane];
+  const auto& lane = _original->lanes[entry.lane];
   const std::size_t waypoint_index_0 = lane.entry().waypoint_index();
   const std::size_t waypoint_index_1 = lane.exit().waypoint_index();
-  const auto& wp0 = _original.waypoints[waypoint_index_0];
-  const auto& wp1 = _original.waypoints[waypoint_index_1];
+  const auto& wp0 = _original->waypoints[waypoint_index_0];
+  const auto& wp1 = _original->waypoints[waypoint_index_1];
 
   const Eigen::Vector2d p0 = wp0.get_location();
   const Eigen::Vector2d p1 = wp1.get_location();
@@ -860,6 +1170,22 @@ std::optional<double> Supergraph::yaw_of(const Entry& entry) const
   return orientations[static_cast<std::size_t>(entry.orientation)];
 }
 
+//==============================================================================
+CacheMemory Supergraph::traversal_memory() const
+{
+  CacheMemory output = _traversals_from->memory_usage();
+  output += _traversals_into->memory_usage();
+  return output;
+}
+
+//==============================================================================
+CacheMemory Supergraph::entry_memory() const
+{
+  CacheMemory output = _entries_into_waypoint_cache->memory_usage();
+  output += _lane_yaw_cache->memory_usage();
+  return output;
+}
+
 //==============================================================================
 DifferentialDriveKeySet Supergraph::keys_for(
   const std::size_t start_waypoint_index,
@@ -867,7 +1193,7 @@ DifferentialDriveKeySet Supergraph::keys_for(
   std::optional<double> goal_orientation) const
 {
   using KeyHash = DifferentialDriveMapTypes::KeyHash;
-  DifferentialDriveKeySet keys(31, KeyHash{_original.lanes.size()});
+  DifferentialDriveKeySet keys(31, KeyHash{_original->lanes.size()});
 
   const auto relevant_goal_entries = entries_into(goal_waypoint_index)
     ->relevant_entries(goal_orientation);
@@ -914,7 +1240,7 @@ Supergraph::EntriesGenerator::EntriesGenerator(
 //==============================================================================
 auto Supergraph::EntriesGenerator::generate(
   const std::size_t& key,
-  const Storage&, // old items are irrelevant
+  const OldItems&, // old items are irrelevant
   Storage& new_items) const -> ConstEntriesPtr
 {
   const auto supergraph = _graph.lock();
@@ -997,7 +1323,7 @@ Supergraph::LaneYawGenerator::LaneYawGenerator(
 //==============================================================================
 std::optional<double> Supergraph::LaneYawGenerator::generate(
   const Entry& key,
-  const Storage& /*old_items*/,
+  const OldItems& /*old_items*/,
   Storage& new_items) const
 {
   if (key.orientation == Orientation::Any)
@@ -1074,7 +1400,8 @@ std::optional<double> Supergraph::LaneYawGenerator::generate(
 }
 
 //==============================================================================
-Supergraph::Supergraph(Graph::Implementation original,
+Supergraph::Supergraph(
+  std::shared_ptr<const Graph::Implementation> original,
   VehicleTraits traits,
   LaneClosure lane_closures,
   const Interpolate::Options::Implementation& interpolate,
@@ -1084,7 +1411,14 @@ Supergraph::Supergraph(Graph::Implementation original,
   _lane_closures(std::move(lane_closures)),
   _interpolate(interpolate),
   _traversal_cost_per_meter(traversal_cost_per_meter),
-  _floor_changes(find_floor_changes(_original))
+  _floor_changes(find_floor_changes(*_original)),
+  _lanes_from(
+    *_original, _lane_closures, _traits.linear().get_nominal_velocity(),
+    CompressedAdjacency::Direction::Forward),
+  _lanes_into(
+    *_original, _lane_closures, _traits.linear().get_nominal_velocity(),
+    CompressedAdjacency::Direction::Reverse),
+  _goal_costs(_lanes_into)
 {
   if (const auto* diff = _traits.get_differential())
   {
@@ -21,7 +21,9 @@
 #include "../internal_Graph.hpp"
 #include "../internal_Interpolate.hpp"
 #include "CacheManager.hpp"
+#include "CompressedAdjacency.hpp"
 #include "DifferentialDriveMap.hpp"
+#include "GoalCostTable.hpp"
 
 #include <rmf_traffic/Route.hpp>
 #include <rmf_traffic/Trajectory.hpp>
@@ -71,10 +73,21 @@ struct Traversal
   std::size_t finish_waypoint_index;
   Graph::Lane::EventPtr entry_event;
   Graph::Lane::EventPtr exit_event;
+
+  // The durations of the events are fixed, so they are computed once here
+  // instead of being asked of the events each time the traversal is expanded.
+  Duration entry_event_duration = Duration(0);
+  Duration exit_event_duration = Duration(0);
+
   std::vector<std::string> maps;
   std::vector<std::size_t> traversed_lanes;
   double best_cost;
 
+  // True if this traversal stops at a waypoint in the middle of a corridor
+  // while another traversal from the same start carries on through it along
+  // the same lanes. Searches that contract corridors can skip it.
+  bool corridor = false;
+
   struct Alternative
   {
     double cost = 0.0;
@@ -82,6 +95,12 @@ struct Traversal
 
     using RouteFactoryFactory = DifferentialDriveMapTypes::RouteFactoryFactory;
     RouteFactoryFactory routes;
+
+    // The factory that routes(std::nullopt) produces. The scheduled planner
+    // uses this for every expansion, so it is made once when the traversal is
+    // generated, and only needs to be shifted to the start time.
+    using RouteFactory = DifferentialDriveMapTypes::RouteFactory;
+    RouteFactory free_routes;
   };
 
   std::array<std::optional<Alternative>, 3> alternatives;
@@ -100,7 +119,7 @@ public:
 
   ConstTraversalsPtr generate(
     const std::size_t& key,
-    const Storage& old_items,
+    const OldItems& old_items,
     Storage& new_items) const final;
 
   struct Kinematics
@@ -136,7 +155,7 @@ public:
 
   ConstTraversalsPtr generate(
     const std::size_t& key,
-    const Storage& old_items,
+    const OldItems& old_items,
     Storage& new_items) const final;
 
 private:
@@ -147,6 +166,31 @@ private:
 //==============================================================================
 using TraversalIntoCache = Cache<TraversalIntoGenerator>;
 
+//==============================================================================
+/// The lanes whose closure status differs between two LaneClosure objects
+struct LaneClosureChange
+{
+  LaneClosureChange(
+    const LaneClosure& from,
+    const LaneClosure& to,
+    std::size_t N_lanes);
+
+  /// Lanes that were open and are now closed
+  std::vector<bool> closed;
+
+  /// Lanes that were closed and are now open
+  std::vector<bool> opened;
+
+  bool any_closed = false;
+  bool any_opened = false;
+
+  /// True if the lane was opened or closed
+  bool changed(std::size_t lane) const
+  {
+    return closed[lane] || opened[lane];
+  }
+};
+
 //==============================================================================
 /// A Supergraph is derived from a regular Graph. It analyzes the vertices and
 /// edges of a regular Graph and adds in new edges and extra information that
@@ -159,12 +203,66 @@ public:
   // TODO(MXG): We could consider moving some of this class's nested classes out
   // into the global scope to clean up the API here.
 
+  /// \param[in] eager_threads
+  ///   If this has a value, the traversals and entries of every waypoint will
+  ///   be found with this many threads before the supergraph is returned.
+  ///   Otherwise they will be found as they are needed.
+  ///
+  /// \param[in] floor_hierarchy
+  ///   If true, searches for the shortest path between waypoints on different
+  ///   floors will go through a FloorHierarchy instead of searching the whole
+  ///   graph.
+  ///
+  /// \param[in] contract_corridors
+  ///   If true, searches will not stop at the waypoints in the middle of
+  ///   corridors unless they are the goal. See Traversal::corridor.
+  ///
+  /// \param[in] contraction_hierarchy
+  ///   If true, shortest paths between waypoints will be found with a
+  ///   ContractionHierarchy instead of searching the whole graph.
   static std::shared_ptr<const Supergraph> make(
     Graph::Implementation original,
     VehicleTraits traits,
     LaneClosure lane_closures,
     const Interpolate::Options::Implementation& interpolate,
-    double traversal_cost_per_meter);
+    double traversal_cost_per_meter,
+    std::optional<std::size_t> eager_threads = std::nullopt,
+    bool floor_hierarchy = false,
+    bool contract_corridors = false,
+    bool contraction_hierarchy = false);
+
+  /// Make a supergraph that shares an immutable graph instead of keeping its
+  /// own copy of it. The graph must not be modified while it is shared.
+  static std::shared_ptr<const Supergraph> make(
+    std::shared_ptr<const Graph::Implementation> original,
+    VehicleTraits traits,
+    LaneClosure lane_closures,
+    const Interpolate::Options::Implementation& interpolate,
+    double traversal_cost_per_meter,
+    std::optional<std::size_t> eager_threads = std::nullopt,
+    bool floor_hierarchy = false,
+    bool contract_corridors = false,
+    bool contraction_hierarchy = false);
+
+  /// Make a supergraph that only differs from this one by its lane closures.
+  /// The traversals of this supergraph that cannot be affected by the change
+  /// are carried over, along with the entries and lane yaws, which do not
+  /// depend on lane closures at all.
+  ///
+  /// \param[in] eager_threads
+  ///   If this has a value, the traversals that could not be carried over will
+  ///   be found with this many threads before the supergraph is returned.
+  std::shared_ptr<const Supergraph> with_closures(
+    LaneClosure closures,
+    std::optional<std::size_t> eager_threads = std::nullopt) const;
+
+  /// Find the traversals and entries of every waypoint that have not been
+  /// found yet, dividing the waypoints between a pool of threads.
+  ///
+  /// \param[in] threads
+  ///   The number of threads to use, including the calling thread. A value of
+  ///   0 is treated the same as 1.
+  void precompute(std::size_t threads) const;
 
   const Graph::Implementation& original() const;
   const VehicleTraits& traits() const;
@@ -172,6 +270,15 @@ public:
   const Interpolate::Options::Implementation& options() const;
   double traversal_cost_per_meter() const;
 
+  /// True if cross-floor shortest paths should be found with a FloorHierarchy
+  bool floor_hierarchy() const;
+
+  /// True if searches should skip the traversals marked as corridors
+  bool contract_corridors() const;
+
+  /// True if shortest paths should be found with a ContractionHierarchy
+  bool contraction_hierarchy() const;
+
   struct FloorChange
   {
     std::size_t lane;
@@ -183,6 +290,15 @@ public:
   /// identifying the bottlenecks for moving between different maps.
   const FloorChangeMap& floor_change() const;
 
+  /// Get a compact view of the open lanes that leave each waypoint
+  const CompressedAdjacency& lanes_from() const;
+
+  /// Get a compact view of the open lanes that enter each waypoint
+  const CompressedAdjacency& lanes_into() const;
+
+  /// Get the dense tables of the shortest path costs to popular goals
+  const GoalCostTable& goal_costs() const;
+
   /// Get the continuous traversals that can be done from the given waypoint.
   /// This means traversals during which the robot does not need to stop or
   /// rotate.
@@ -202,6 +318,9 @@ public:
     std::vector<Entry> relevant_entries(
       std::optional<double> orientation) const;
 
+    /// Get the bytes that these entries are holding
+    std::size_t memory_usage() const;
+
     Entries(
       std::map<double, Entry> angled_entries,
       std::optional<Entry> agnostic_entry);
@@ -224,6 +343,12 @@ public:
   // Get the yaw of this lane+orientation combo
   std::optional<double> yaw_of(const Entry& entry) const;
 
+  /// Get how much memory the caches of traversals are holding
+  CacheMemory traversal_memory() const;
+
+  /// Get how much memory the caches of entries and lane yaws are holding
+  CacheMemory entry_memory() const;
+
   /// Get the keys for the DifferentialDriveHeuristic cache entries that are
   /// relevant for a given combination of start and goal conditions.
   DifferentialDriveKeySet keys_for(
@@ -233,18 +358,24 @@ public:
 
 private:
   Supergraph(
-    Graph::Implementation original,
+    std::shared_ptr<const Graph::Implementation> original,
     VehicleTraits traits,
     LaneClosure lane_closures,
     const Interpolate::Options::Implementation& interpolate,
     double traversal_cost_per_meter);
 
-  Graph::Implementation _original;
+  std::shared_ptr<const Graph::Implementation> _original;
   VehicleTraits _traits;
   LaneClosure _lane_closures;
   Interpolate::Options::Implementation _interpolate;
   double _traversal_cost_per_meter;
+  bool _floor_hierarchy = false;
+  bool _contract_corridors = false;
+  bool _contraction_hierarchy = false;
   FloorChangeMap _floor_changes;
+  CompressedAdjacency _lanes_from;
+  CompressedAdjacency _lanes_into;
+  GoalCostTable _goal_costs;
   std::shared_ptr<const CacheManager<TraversalFromCache>> _traversals_from;
   std::shared_ptr<const CacheManager<TraversalIntoCache>> _traversals_into;
   std::optional<DifferentialDriveConstraint> _constraint;
@@ -258,7 +389,7 @@ private:
 
     ConstEntriesPtr generate(
       const std::size_t& key,
-      const Storage& old_items,
+      const OldItems& old_items,
       Storage& new_items) const final;
 
   private:
@@ -279,7 +410,7 @@ private:
 
     std::optional<double> generate(
       const Entry& key,
-      const Storage& old_items,
+      const OldItems& old_items,
       Storage& new_items) const final;
 
   private:
@@ -240,16 +240,37 @@ public:
 
   std::optional<double> get_cost(WaypointId start, WaypointId finish) const;
 
+  /// A solution that has been found between a start and a finish waypoint. A
+  /// nullptr solution means that the finish cannot be reached from the start.
+  struct SolutionEntry
+  {
+    WaypointId start;
+    WaypointId finish;
+    ConstForestSolutionPtr solution;
+  };
+
+  /// Get a copy of every solution that has been found so far
+  std::vector<SolutionEntry> solutions() const;
+
+  /// Insert a solution that was found somewhere else, e.g. by an earlier run
+  /// of the same program. A solution that is already known will be kept.
+  void preload(SolutionEntry entry) const;
+
+  /// Get the cache of heuristics that this forest uses for its searches
+  const Cache& heuristic_cache() const;
+
   ~BidirectionalForest();
 
+protected:
+
+  std::optional<ConstForestSolutionPtr> _check_for_solution(
+    WaypointId start, WaypointId finish) const;
+
 private:
 
   using ForwardTreeManagerMap = TreeManagerMap<ForwardTree, ReverseTree>;
   using ReverseTreeManagerMap = TreeManagerMap<ReverseTree, ForwardTree>;
 
-  std::optional<ConstForestSolutionPtr> _check_for_solution(
-    WaypointId start, WaypointId finish) const;
-
   ConstForestSolutionPtr _search(
     WaypointId start,
     std::optional<LockedTree<ForwardTree>> forward_locked,
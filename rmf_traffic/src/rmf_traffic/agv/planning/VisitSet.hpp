@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__AGV__PLANNING__VISITSET_HPP
+#define SRC__RMF_TRAFFIC__AGV__PLANNING__VISITSET_HPP
+
+#include <rmf_traffic/Time.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace rmf_traffic {
+namespace agv {
+namespace planning {
+
+//==============================================================================
+/// The times and costs at which a search has expanded one entry of its graph.
+///
+/// Two nodes whose times are within the tolerance of each other are treated
+/// as being at the same time. A node is dominated if a node at the same time
+/// was already expanded for no more cost, or if a node at an earlier time in
+/// the tolerance was expanded for no more cost than waiting until then.
+///
+/// The visits are kept sorted by time in a flat vector. A search mostly moves
+/// forward in time, so new visits are nearly always appended, and the visits
+/// near a time are found with a binary search.
+class VisitSet
+{
+public:
+
+  struct Visit
+  {
+    Time time;
+    double cost;
+  };
+
+  /// Check whether a node at this time and cost is dominated by a visit.
+  bool dominated(
+    const Time time,
+    const double cost,
+    const Duration tolerance) const
+  {
+    // Search the visits in (time - tolerance, time + tolerance]
+    auto it = std::upper_bound(
+      _visits.begin(), _visits.end(), time - tolerance,
+      [](const Time t, const Visit& v) { return t < v.time; });
+
+    for (; it != _visits.end() && it->time <= time + tolerance; ++it)
+    {
+      double bound = cost;
+      if (it->time < time)
+        bound -= time::to_seconds(time - it->time);
+
+      if (it->cost <= bound + 1e-8)
+        return true;
+    }
+
+    return false;
+  }
+
+  /// Record a visit unless it is dominated. Returns true if it was recorded.
+  bool insert(const Time time, const double cost, const Duration tolerance)
+  {
+    if (dominated(time, cost, tolerance))
+      return false;
+
+    if (_visits.empty() || _visits.back().time <= time)
+    {
+      _visits.push_back({time, cost});
+      return true;
+    }
+
+    const auto it = std::upper_bound(
+      _visits.begin(), _visits.end(), time,
+      [](const Time t, const Visit& v) { return t < v.time; });
+    _visits.insert(it, {time, cost});
+    return true;
+  }
+
+  /// The number of visits that were recorded.
+  std::size_t size() const
+  {
+    return _visits.size();
+  }
+
+  /// The visits that were recorded, sorted by time.
+  const std::vector<Visit>& visits() const
+  {
+    return _visits;
+  }
+
+private:
+  std::vector<Visit> _visits;
+};
+
+} // namespace planning
+} // namespace agv
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__AGV__PLANNING__VISITSET_HPP
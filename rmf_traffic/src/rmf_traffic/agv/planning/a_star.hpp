@@ -51,6 +51,41 @@ NodePtr a_star_search(
   return nullptr;
 }
 
+//==============================================================================
+/// The same as a_star_search, except the search will stop without a solution
+/// as soon as prune(top) returns true for the top of the queue. The top is left
+/// in the queue so that the search can be resumed later.
+template<
+  class Expander,
+  class SearchQueue,
+  class Prune,
+  class NodePtr = typename Expander::NodePtr>
+NodePtr a_star_search(
+  Expander& expander,
+  SearchQueue& queue,
+  const Prune& prune)
+{
+  while (!queue.empty())
+  {
+    NodePtr top = queue.top();
+
+    if (prune(top))
+      return nullptr;
+
+    if (expander.quit(top, queue))
+      return nullptr;
+
+    queue.pop();
+
+    if (expander.is_finished(top))
+      return top;
+
+    expander.expand(top, queue);
+  }
+
+  return nullptr;
+}
+
 //==============================================================================
 template<typename NodePtrT>
 struct SimpleCompare
@@ -372,6 +372,36 @@ std::optional<double> BidirectionalForest<T>::get_cost(
   return std::nullopt;
 }
 
+//==============================================================================
+template<typename T>
+auto BidirectionalForest<T>::solutions() const -> std::vector<SolutionEntry>
+{
+  std::vector<SolutionEntry> output;
+  SpinLock lock(_solutions_mutex);
+  for (const auto& [start, finish_map] : _solutions)
+  {
+    for (const auto& [finish, solution] : finish_map)
+      output.push_back({start, finish, solution});
+  }
+
+  return output;
+}
+
+//==============================================================================
+template<typename T>
+void BidirectionalForest<T>::preload(SolutionEntry entry) const
+{
+  SpinLock lock(_solutions_mutex);
+  _solutions[entry.start].insert({entry.finish, std::move(entry.solution)});
+}
+
+//==============================================================================
+template<typename T>
+auto BidirectionalForest<T>::heuristic_cache() const -> const Cache&
+{
+  return _heuristic_cache;
+}
+
 //==============================================================================
 template<typename T>
 BidirectionalForest<T>::~BidirectionalForest()
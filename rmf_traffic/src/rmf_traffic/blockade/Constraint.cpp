@@ -42,6 +42,50 @@ std::string toul(const std::size_t input)
   return output;
 }
 
+//==============================================================================
+bool blockage_can_hold(
+  const ReservedRange& range,
+  const bool has_hold_point,
+  const std::size_t hold_point)
+{
+  return has_hold_point && range.end <= hold_point;
+}
+
+//==============================================================================
+bool blockage_has_reached(
+  const ReservedRange& range,
+  const bool has_end_condition,
+  const std::size_t has_reached,
+  const bool end_when_reached)
+{
+  if (!has_end_condition)
+    return false;
+
+  if (range.begin < has_reached)
+    return false;
+
+  // Implicit: has_reached <= range.begin
+  if (has_reached < range.end)
+    return true;
+
+  if (end_when_reached && has_reached == range.begin)
+    return true;
+
+  return false;
+}
+
+//==============================================================================
+bool has_passed(const ReservedRange& range, const std::size_t index)
+{
+  if (index < range.begin)
+    return true;
+
+  if (range.begin < index)
+    return false;
+
+  return index < range.end;
+}
+
 //==============================================================================
 class BlockageConstraint : public Constraint
 {
@@ -154,40 +198,41 @@ public:
     return str.str();
   }
 
-private:
-
-  bool _evaluate_can_hold(const ReservedRange& range) const
+  std::size_t blocked_by() const
   {
-    if (_blocker_hold_point)
-    {
-      if (range.end <= _blocker_hold_point)
-        return true;
-    }
+    return _blocked_by;
+  }
 
-    return false;
+  const std::optional<std::size_t>& blocker_hold_point() const
+  {
+    return _blocker_hold_point;
   }
 
-  bool _evaluate_has_reached(const ReservedRange& range) const
+  const std::optional<BlockageEndCondition>& end_condition() const
   {
-    if (_end_condition)
-    {
-      const std::size_t has_reached = _end_condition->index;
+    return _end_condition;
+  }
 
-      if (range.begin < has_reached)
-        return false;
+private:
 
-      // Implicit: has_reached <= range.begin
-      if (has_reached < range.end)
-        return true;
+  bool _evaluate_can_hold(const ReservedRange& range) const
+  {
+    return blockage_can_hold(
+      range,
+      _blocker_hold_point.has_value(),
+      _blocker_hold_point.value_or(0));
+  }
 
-      if (_end_condition->condition == BlockageEndCondition::HasReached)
-      {
-        if (_end_condition->index == range.begin)
-          return true;
-      }
-    }
+  bool _evaluate_has_reached(const ReservedRange& range) const
+  {
+    if (!_end_condition.has_value())
+      return false;
 
-    return false;
+    return blockage_has_reached(
+      range,
+      true,
+      _end_condition->index,
+      _end_condition->condition == BlockageEndCondition::HasReached);
   }
 
   bool _evaluate(const ReservedRange& range) const
@@ -299,17 +344,21 @@ public:
     return str.str();
   }
 
-private:
+  std::size_t participant() const
+  {
+    return _participant;
+  }
 
-  bool _evaluate(const ReservedRange& range) const
+  std::size_t index() const
   {
-    if (_index < range.begin)
-      return true;
+    return _index;
+  }
 
-    if (range.begin < _index)
-      return false;
+private:
 
-    return _index < range.end;
+  bool _evaluate(const ReservedRange& range) const
+  {
+    return has_passed(range, _index);
   }
 
   std::size_t _participant;
@@ -369,6 +418,12 @@ void AndConstraint::add(ConstConstraintPtr new_constraint)
   _constraints.emplace(std::move(new_constraint));
 }
 
+//==============================================================================
+const std::unordered_set<ConstConstraintPtr>& AndConstraint::constraints() const
+{
+  return _constraints;
+}
+
 //==============================================================================
 bool AndConstraint::evaluate(const State& state) const
 {
@@ -457,6 +512,12 @@ void OrConstraint::add(ConstConstraintPtr new_constraint)
   _constraints.emplace(std::move(new_constraint));
 }
 
+//==============================================================================
+const std::unordered_set<ConstConstraintPtr>& OrConstraint::constraints() const
+{
+  return _constraints;
+}
+
 //==============================================================================
 bool OrConstraint::evaluate(const State& state) const
 {
@@ -585,8 +646,229 @@ ConstConstraintPtr compute_gridlock_constraint(GridlockNodePtr node)
   return or_constraint;
 }
 
+//==============================================================================
+std::size_t StateLayout::slot(const std::size_t participant)
+{
+  const auto insertion = _slots.insert({participant, _participants.size()});
+  if (insertion.second)
+    _participants.push_back(participant);
+
+  return insertion.first->second;
+}
+
+//==============================================================================
+std::optional<std::size_t> StateLayout::find(
+  const std::size_t participant) const
+{
+  const auto it = _slots.find(participant);
+  if (it == _slots.end())
+    return std::nullopt;
+
+  return it->second;
+}
+
+//==============================================================================
+std::size_t StateLayout::size() const
+{
+  return _participants.size();
+}
+
+//==============================================================================
+const std::vector<std::size_t>& StateLayout::participants() const
+{
+  return _participants;
+}
+
+//==============================================================================
+void PackedState::pack(const StateLayout& layout, const State& state)
+{
+  const auto& participants = layout.participants();
+  ranges.resize(participants.size());
+  present.resize(participants.size());
+  for (std::size_t i = 0; i < participants.size(); ++i)
+    update(i, participants[i], state);
+}
+
+//==============================================================================
+void PackedState::update(
+  const std::size_t slot,
+  const std::size_t participant,
+  const State& state)
+{
+  const auto it = state.find(participant);
+  present[slot] = it != state.end();
+  if (present[slot])
+    ranges[slot] = it->second;
+}
+
+//==============================================================================
+CompiledConstraint::CompiledConstraint(
+  ConstConstraintPtr constraint,
+  StateLayout& layout)
+: _source(std::move(constraint))
+{
+  _compile(_source, layout);
+}
+
+//==============================================================================
+bool CompiledConstraint::evaluate(
+  const PackedState& packed,
+  const State& state) const
+{
+  return _evaluate(0, packed, state);
+}
+
+//==============================================================================
+const ConstConstraintPtr& CompiledConstraint::source() const
+{
+  return _source;
+}
+
+//==============================================================================
+std::size_t CompiledConstraint::size() const
+{
+  return _instructions.size();
+}
+
+//==============================================================================
+void CompiledConstraint::_compile(
+  const ConstConstraintPtr& constraint,
+  StateLayout& layout)
+{
+  const std::size_t start = _instructions.size();
+  Instruction instruction{Instruction::True, false, false, false, 0, 1, 0, 0};
+
+  const auto set_slot = [&](const std::size_t participant)
+    {
+      instruction.slot = static_cast<std::uint32_t>(layout.slot(participant));
+    };
+
+  const std::unordered_set<ConstConstraintPtr>* children = nullptr;
+  if (const auto* b = dynamic_cast<const BlockageConstraint*>(
+      constraint.get()))
+  {
+    instruction.op = Instruction::Blockage;
+    set_slot(b->blocked_by());
+    instruction.has_hold_point = b->blocker_hold_point().has_value();
+    instruction.hold_point = b->blocker_hold_point().value_or(0);
+    if (const auto& end = b->end_condition())
+    {
+      instruction.has_end_condition = true;
+      instruction.index = end->index;
+      instruction.end_when_reached =
+        end->condition == BlockageEndCondition::HasReached;
+    }
+  }
+  else if (const auto* p = dynamic_cast<const PassedConstraint*>(
+      constraint.get()))
+  {
+    instruction.op = Instruction::Passed;
+    set_slot(p->participant());
+    instruction.index = p->index();
+  }
+  else if (dynamic_cast<const AlwaysValid*>(constraint.get()))
+  {
+    instruction.op = Instruction::True;
+  }
+  else if (const auto* a = dynamic_cast<const AndConstraint*>(
+      constraint.get()))
+  {
+    instruction.op = Instruction::And;
+    children = &a->constraints();
+  }
+  else if (const auto* o = dynamic_cast<const OrConstraint*>(
+      constraint.get()))
+  {
+    instruction.op = Instruction::Or;
+    children = &o->constraints();
+  }
+  else
+  {
+    instruction.op = Instruction::Opaque;
+    instruction.index = _opaque.size();
+    _opaque.push_back(constraint);
+  }
+
+  _instructions.push_back(instruction);
+  if (children)
+  {
+    for (const auto& child : *children)
+      _compile(child, layout);
+  }
+
+  _instructions[start].size =
+    static_cast<std::uint32_t>(_instructions.size() - start);
+}
+
+//==============================================================================
+bool CompiledConstraint::_evaluate(
+  const std::size_t i,
+  const PackedState& packed,
+  const State& state) const
+{
+  const Instruction& instruction = _instructions[i];
+
+  const auto range = [&]() -> const ReservedRange&
+    {
+      if (!packed.present[instruction.slot])
+      {
+        // *INDENT-OFF*
+        throw std::runtime_error(
+          "Failed to evaluate a compiled constraint because the participant "
+          "in slot " + std::to_string(instruction.slot)
+          + " is missing from the state.");
+        // *INDENT-ON*
+      }
+
+      return packed.ranges[instruction.slot];
+    };
+
+  switch (instruction.op)
+  {
+    case Instruction::True:
+      return true;
+    case Instruction::Blockage:
+    {
+      const auto& r = range();
+      return blockage_can_hold(
+        r, instruction.has_hold_point, instruction.hold_point)
+        || blockage_has_reached(
+        r, instruction.has_end_condition, instruction.index,
+        instruction.end_when_reached);
+    }
+    case Instruction::Passed:
+      return has_passed(range(), instruction.index);
+    case Instruction::And:
+    case Instruction::Or:
+    {
+      const bool is_and = instruction.op == Instruction::And;
+      const std::size_t end = i + instruction.size;
+      for (std::size_t child = i+1; child < end;
+        child += _instructions[child].size)
+      {
+        if (_evaluate(child, packed, state) != is_and)
+          return !is_and;
+      }
+
+      // An empty And or Or is always true
+      return is_and || instruction.size == 1;
+    }
+    case Instruction::Opaque:
+      return _opaque[instruction.index]->evaluate(state);
+  }
+
+  return false;
+}
+
 //==============================================================================
 ConstConstraintPtr compute_gridlock_constraint(const Blockers& blockers)
+{
+  return combine_gridlock_cycles(compute_gridlock_cycles(blockers));
+}
+
+//==============================================================================
+std::vector<ConstConstraintPtr> compute_gridlock_cycles(
+  const Blockers& blockers)
 {
   std::vector<GridlockNodePtr> queue;
   std::unordered_map<std::size_t, std::vector<Blocker>> dependents;
@@ -664,10 +946,76 @@ ConstConstraintPtr compute_gridlock_constraint(const Blockers& blockers)
     }
   }
 
-  if (gridlock_constraints.empty())
+  return gridlock_constraints;
+}
+
+//==============================================================================
+ConstConstraintPtr combine_gridlock_cycles(
+  const std::vector<ConstConstraintPtr>& cycles)
+{
+  if (cycles.empty())
     return std::make_shared<AlwaysValid>();
 
-  return std::make_shared<AndConstraint>(gridlock_constraints);
+  return std::make_shared<AndConstraint>(cycles);
+}
+
+//==============================================================================
+void GridlockStatus::reset(
+  std::vector<ConstConstraintPtr> cycles,
+  const State& state)
+{
+  _cycles = std::move(cycles);
+  _layout = StateLayout();
+  _compiled.clear();
+  _compiled.reserve(_cycles.size());
+  _violated.assign(_cycles.size(), false);
+  _num_violated = 0;
+  _dependents.clear();
+
+  for (const auto& cycle : _cycles)
+    _compiled.emplace_back(cycle, _layout);
+
+  _packed.pack(_layout, state);
+
+  for (std::size_t i = 0; i < _cycles.size(); ++i)
+  {
+    for (const auto p : _cycles[i]->dependencies())
+      _dependents[p].push_back(i);
+
+    _violated[i] = !_compiled[i].evaluate(_packed, state);
+    if (_violated[i])
+      ++_num_violated;
+  }
+}
+
+//==============================================================================
+void GridlockStatus::update(const std::size_t participant, const State& state)
+{
+  const auto it = _dependents.find(participant);
+  if (it == _dependents.end())
+    return;
+
+  if (const auto slot = _layout.find(participant))
+    _packed.update(*slot, participant, state);
+
+  for (const auto i : it->second)
+  {
+    const bool violated = !_compiled[i].evaluate(_packed, state);
+    if (violated == _violated[i])
+      continue;
+
+    _violated[i] = violated;
+    if (violated)
+      ++_num_violated;
+    else
+      --_num_violated;
+  }
+}
+
+//==============================================================================
+bool GridlockStatus::has_gridlock() const
+{
+  return _num_violated > 0;
 }
 
 } // namespace blockade
@@ -19,9 +19,12 @@
 #define SRC__RMF_TRAFFIC__BLOCKADE__CONSTRAINT_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include <rmf_traffic/blockade/Writer.hpp>
 
@@ -91,6 +94,9 @@ public:
 
   void add(ConstConstraintPtr new_constraint);
 
+  /// The constraints that are being combined
+  const std::unordered_set<ConstConstraintPtr>& constraints() const;
+
   bool evaluate(const State& state) const final;
   const std::unordered_set<std::size_t>& dependencies() const final;
   std::optional<bool> partial_evaluate(const State& state) const final;
@@ -110,6 +116,9 @@ public:
 
   void add(ConstConstraintPtr new_constraint);
 
+  /// The constraints that are being combined
+  const std::unordered_set<ConstConstraintPtr>& constraints() const;
+
   bool evaluate(const State& state) const final;
   const std::unordered_set<std::size_t>& dependencies() const final;
   std::optional<bool> partial_evaluate(const State& state) const final;
@@ -126,9 +135,154 @@ using IndexToConstraint = std::unordered_map<std::size_t, ConstConstraintPtr>;
 //==============================================================================
 using Blockers = std::unordered_map<std::size_t, IndexToConstraint>;
 
+//==============================================================================
+/// Gives each participant a dense slot so that compiled constraints can look up
+/// the range of a participant in a vector instead of a hash map. One layout can
+/// be shared by any number of compiled constraints.
+class StateLayout
+{
+public:
+
+  /// Get the slot of a participant, assigning a new one if needed
+  std::size_t slot(std::size_t participant);
+
+  /// Get the slot of a participant if it has one
+  std::optional<std::size_t> find(std::size_t participant) const;
+
+  /// The number of slots that have been assigned
+  std::size_t size() const;
+
+  /// The participant that each slot belongs to
+  const std::vector<std::size_t>& participants() const;
+
+private:
+  std::unordered_map<std::size_t, std::size_t> _slots;
+  std::vector<std::size_t> _participants;
+};
+
+//==============================================================================
+/// The ranges of a State, ordered by the slots of a StateLayout
+struct PackedState
+{
+  std::vector<ReservedRange> ranges;
+  std::vector<bool> present;
+
+  /// Fill in every slot of the layout from the state
+  void pack(const StateLayout& layout, const State& state);
+
+  /// Fill in one slot from the state
+  void update(std::size_t slot, std::size_t participant, const State& state);
+};
+
+//==============================================================================
+/// A constraint that has been flattened into an array of instructions. The
+/// blockage, passed, and/or nodes of the constraint are evaluated directly
+/// from a PackedState, without any virtual calls or hash map lookups. Any
+/// other kind of constraint is kept as it is, and gets evaluated on the State.
+class CompiledConstraint
+{
+public:
+
+  CompiledConstraint(ConstConstraintPtr constraint, StateLayout& layout);
+
+  /// Evaluate the constraint. The packed state must have been packed from the
+  /// state using the layout that this constraint was compiled with.
+  bool evaluate(const PackedState& packed, const State& state) const;
+
+  /// The constraint that was compiled
+  const ConstConstraintPtr& source() const;
+
+  /// The number of instructions that the constraint was compiled into
+  std::size_t size() const;
+
+  struct Instruction
+  {
+    enum Op : std::uint8_t
+    {
+      True,
+      Blockage,
+      Passed,
+      And,
+      Or,
+      Opaque
+    };
+
+    Op op;
+
+    // Blockage only
+    bool has_hold_point;
+    bool has_end_condition;
+    bool end_when_reached;
+
+    // Blockage and Passed: the slot of the participant that is checked
+    std::uint32_t slot;
+
+    // The number of instructions in the subtree that begins here
+    std::uint32_t size;
+
+    // Blockage only
+    std::size_t hold_point;
+
+    // Blockage: the index of the end condition. Passed: the index that must be
+    // passed. Opaque: the index into the opaque constraints.
+    std::size_t index;
+  };
+
+private:
+  void _compile(const ConstConstraintPtr& constraint, StateLayout& layout);
+  bool _evaluate(
+    std::size_t i,
+    const PackedState& packed,
+    const State& state) const;
+
+  ConstConstraintPtr _source;
+  std::vector<Instruction> _instructions;
+  std::vector<ConstConstraintPtr> _opaque;
+};
+
 //==============================================================================
 ConstConstraintPtr compute_gridlock_constraint(const Blockers& blockers);
 
+//==============================================================================
+/// Find each cycle of blockers that could cause a gridlock. Each cycle is given
+/// as a constraint that is violated when the gridlock happens.
+/// compute_gridlock_constraint() is the combination of all these constraints.
+std::vector<ConstConstraintPtr> compute_gridlock_cycles(
+  const Blockers& blockers);
+
+//==============================================================================
+/// Combine gridlock cycles into a single constraint that is violated if any one
+/// of the cycles is violated.
+ConstConstraintPtr combine_gridlock_cycles(
+  const std::vector<ConstConstraintPtr>& cycles);
+
+//==============================================================================
+/// Keeps track of which gridlock cycles are currently violated. A cycle only
+/// gets evaluated again when the range of a participant that it depends on
+/// has changed, so checking for a gridlock costs nothing.
+class GridlockStatus
+{
+public:
+
+  /// Start tracking a new set of cycles, evaluating each of them on the state
+  void reset(std::vector<ConstConstraintPtr> cycles, const State& state);
+
+  /// Evaluate the cycles that depend on a participant whose range has changed
+  void update(std::size_t participant, const State& state);
+
+  /// True if any of the cycles is violated
+  bool has_gridlock() const;
+
+private:
+  std::vector<ConstConstraintPtr> _cycles;
+  StateLayout _layout;
+  PackedState _packed;
+  std::vector<CompiledConstraint> _compiled;
+  std::vector<bool> _violated;
+  std::size_t _num_violated = 0;
+  std::unordered_map<std::size_t, std::vector<std::size_t>> _dependents;
+};
+
 } // namespace blockade
 } // namespace rmf_traffic
 
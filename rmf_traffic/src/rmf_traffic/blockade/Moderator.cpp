@@ -19,9 +19,14 @@
 
 #include <rmf_utils/Modular.hpp>
 
+#include "ReservationIndex.hpp"
 #include "conflicts.hpp"
 
-#include <list>
+#include "../schedule/internal_WorkerPool.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <map>
 #include <array>
 #include <sstream>
 
@@ -79,17 +84,7 @@ class Moderator::Implementation
 {
 public:
 
-  struct ReservationInfo
-  {
-    ReservationId id;
-    Reservation reservation;
-
-    ReservationInfo(ReservationId id_)
-    : id(id_)
-    {
-      // Do nothing
-    }
-  };
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
 
   struct ReadyInfo
   {
@@ -98,19 +93,82 @@ public:
     CheckpointId checkpoint;
   };
 
+  /// Everything that the moderator tracks for one participant. Slots are
+  /// stored densely and reused after their participant is canceled.
+  struct ParticipantSlot
+  {
+    bool active = false;
+    ParticipantId participant_id = 0;
+    ReservationId reservation_id = 0;
+    Reservation reservation;
+    PreparedPath prepared;
+
+    // A participant has at most one entry in the ready queue, which holds the
+    // latest checkpoint that it is ready at. The queue is an intrusive list
+    // that links the slots together in the order that they became ready.
+    bool queued = false;
+    ReadyInfo ready = ReadyInfo{0, 0, 0};
+    std::size_t prev = npos;
+    std::size_t next = npos;
+  };
+
+  struct PeerComparison
+  {
+    ParticipantId participant_id;
+    const Reservation* reservation;
+    const PreparedPath* prepared;
+    std::array<IndexToConstraint, 2> blockers;
+    std::array<std::vector<Alignment>, 2> alignments;
+  };
+
   std::function<void(std::string)> info_logger;
   std::function<void(std::string)> debug_logger;
   double min_conflict_angle;
 
-  std::list<ReadyInfo> ready_queue;
+  // This is only created when more than one thread is requested
+  std::shared_ptr<schedule::WorkerPool> worker_pool;
+
+  std::vector<ParticipantSlot> slots;
+  std::vector<std::size_t> free_slots;
+  std::unordered_map<ParticipantId, std::size_t> slot_index;
+  std::size_t ready_head = npos;
+  std::size_t ready_tail = npos;
 
-  std::unordered_map<ParticipantId, ReservationInfo> last_known_reservation;
+  ReservationIndex reservation_index;
   Assignments assignments;
   std::unordered_map<ParticipantId, Status> statuses;
 
   PeerToPeerBlockers peer_blockers;
   PeerToPeerAlignment peer_alignment;
   FinalConstraints final_constraints;
+  GridlockStatus gridlock_status;
+
+  // The should_go constraints of final_constraints, compiled so that they can
+  // be evaluated quickly while reservations are being extended
+  StateLayout should_go_layout;
+  std::unordered_map<
+    ParticipantId, std::unordered_map<std::size_t, CompiledConstraint>
+  > compiled_should_go;
+  PackedState packed_state;
+
+  struct ChangeRecord
+  {
+    std::size_t version;
+    bool removed;
+  };
+
+  // The last change of each participant, and the same changes ordered by
+  // version so that the changes since any version can be found quickly
+  std::unordered_map<ParticipantId, ChangeRecord> change_records;
+  std::map<std::size_t, ParticipantId> change_log;
+  std::size_t change_version = 0;
+
+  // The number of batches that are currently open
+  std::size_t batch_depth = 0;
+
+  // True if the final constraints need to be recomputed when the next batch is
+  // flushed
+  bool constraints_changed = false;
 
   Implementation(
     std::function<void(std::string)> info,
@@ -131,13 +189,128 @@ public:
     Finished
   };
 
+  /// Record that the status or range of a participant has changed
+  void mark_changed(const ParticipantId participant_id, bool removed = false)
+  {
+    const auto insertion =
+      change_records.insert({participant_id, ChangeRecord{0, false}});
+    auto& record = insertion.first->second;
+    if (!insertion.second)
+      change_log.erase(record.version);
+
+    record = ChangeRecord{++change_version, removed};
+    change_log[record.version] = participant_id;
+  }
+
+  /// Check whether two reservations would be compared the same way against
+  /// every peer
+  static bool same_reservation(const Reservation& a, const Reservation& b)
+  {
+    if (a.radius != b.radius || a.path.size() != b.path.size())
+      return false;
+
+    for (std::size_t i = 0; i < a.path.size(); ++i)
+    {
+      const auto& c_a = a.path[i];
+      const auto& c_b = b.path[i];
+      if (c_a.position != c_b.position
+        || c_a.can_hold != c_b.can_hold
+        || c_a.map_name != c_b.map_name)
+        return false;
+    }
+
+    return true;
+  }
+
+  /// Get the slot of a participant, or npos if it does not have one
+  std::size_t find_slot(const ParticipantId participant_id) const
+  {
+    const auto it = slot_index.find(participant_id);
+    if (it == slot_index.end())
+      return npos;
+
+    return it->second;
+  }
+
+  /// Give a slot to a participant that does not have one yet
+  std::size_t add_slot(const ParticipantId participant_id)
+  {
+    std::size_t s;
+    if (free_slots.empty())
+    {
+      s = slots.size();
+      slots.emplace_back();
+    }
+    else
+    {
+      s = free_slots.back();
+      free_slots.pop_back();
+    }
+
+    auto& slot = slots[s];
+    slot.active = true;
+    slot.participant_id = participant_id;
+    slot_index[participant_id] = s;
+    return s;
+  }
+
+  /// Release the slot of a participant so that it can be reused
+  void remove_slot(const std::size_t s)
+  {
+    pop_ready(s);
+    auto& slot = slots[s];
+    slot_index.erase(slot.participant_id);
+    slot = ParticipantSlot();
+    free_slots.push_back(s);
+  }
+
+  /// Put a slot at the back of the ready queue
+  void push_ready(const std::size_t s)
+  {
+    auto& slot = slots[s];
+    if (slot.queued)
+      return;
+
+    slot.queued = true;
+    slot.prev = ready_tail;
+    slot.next = npos;
+    if (ready_tail == npos)
+      ready_head = s;
+    else
+      slots[ready_tail].next = s;
+
+    ready_tail = s;
+  }
+
+  /// Take a slot out of the ready queue
+  void pop_ready(const std::size_t s)
+  {
+    auto& slot = slots[s];
+    if (!slot.queued)
+      return;
+
+    if (slot.prev == npos)
+      ready_head = slot.next;
+    else
+      slots[slot.prev].next = slot.next;
+
+    if (slot.next == npos)
+      ready_tail = slot.prev;
+    else
+      slots[slot.next].prev = slot.prev;
+
+    slot.queued = false;
+    slot.prev = npos;
+    slot.next = npos;
+  }
+
   ReadyStatus check_reservation(const ReadyInfo& check)
   {
-    const auto r_it = last_known_reservation.find(check.participant_id);
-    if (r_it == last_known_reservation.end())
+    const auto slot = find_slot(check.participant_id);
+    if (slot == npos)
       return Finished;
 
-    if (r_it->second.id != check.reservation_id)
+    if (slots[slot].reservation_id != check.reservation_id)
       return Finished;
 
     auto state = assignments.ranges();
@@ -146,17 +319,21 @@ public:
       return Finished;
 
     const auto constraints_it =
-      final_constraints.should_go.find(check.participant_id);
-    if (constraints_it == final_constraints.should_go.end())
+      compiled_should_go.find(check.participant_id);
+    if (constraints_it == compiled_should_go.end())
     {
       // There are no constraints for this participant, so we will just allow it
       // to go all the way.
       Assignments::Implementation::modify(assignments)
       .ranges[check.participant_id].end = check.checkpoint + 1;
+      gridlock_status.update(check.participant_id, assignments.ranges());
+      mark_changed(check.participant_id);
       return Finished;
     }
 
     const auto& constraints = constraints_it->second;
+    packed_state.pack(should_go_layout, state);
+    const auto packed_slot = should_go_layout.find(check.participant_id);
 
     const std::size_t current_end = s.end;
     const std::size_t i_max = (check.checkpoint+1) - (current_end+1);
@@ -169,6 +346,8 @@ public:
       // now.
       const std::size_t check_end = check.checkpoint+1 - i;
       s.end = check_end;
+      if (packed_slot.has_value())
+        packed_state.ranges[*packed_slot].end = check_end;
 
       // TODO(MXG): We could probably get slightly better performance here if
       // should_go used an ordered std::map instead of std::unordered_map.
@@ -176,7 +355,8 @@ public:
       for (std::size_t c = s.begin; c < s.end; ++c)
       {
         const auto it = constraints.find(c);
-        if (it != constraints.end() && !it->second->evaluate(state))
+        if (it != constraints.end()
+          && !it->second.evaluate(packed_state, state))
         {
           if (debug_logger)
           {
@@ -185,7 +365,7 @@ public:
             str << "Cannot reserve [" << P << s.begin
                 << " -> " << P << check_end
                 << "]. Blocked at " << P << c << " by: "
-                << it->second->detail(state);
+                << it->second.source()->detail(state);
             debug_logger(str.str());
           }
 
@@ -198,6 +378,8 @@ public:
       {
         Assignments::Implementation::modify(assignments)
         .ranges[check.participant_id].end = check_end;
+        gridlock_status.update(check.participant_id, assignments.ranges());
+        mark_changed(check.participant_id);
 
         if (i == 0)
           return Finished;
@@ -209,24 +391,92 @@ public:
     return Skip;
   }
 
+  /// Compile the final constraints after they have been recomputed
+  void compile_final_constraints()
+  {
+    should_go_layout = StateLayout();
+    compiled_should_go.clear();
+    for (const auto& p : final_constraints.should_go)
+    {
+      auto& compiled = compiled_should_go[p.first];
+      for (const auto& c : p.second)
+      {
+        compiled.emplace(
+          c.first, CompiledConstraint(c.second, should_go_layout));
+      }
+    }
+
+    gridlock_status.reset(
+      final_constraints.gridlock_cycles, assignments.ranges());
+  }
+
+  /// Update the final constraints after the peer constraints have changed
+  void update_constraints()
+  {
+    if (batch_depth > 0)
+    {
+      constraints_changed = true;
+      return;
+    }
+
+    final_constraints = compute_final_ShouldGo_constraints(
+      peer_blockers, peer_alignment);
+
+    compile_final_constraints();
+  }
+
+  /// Tell the gridlock status that the range of a participant has changed
+  void update_gridlock(const ParticipantId participant_id)
+  {
+    // The gridlock status will be reset once the batch is flushed, so there is
+    // no point in updating it against constraints that are out of date.
+    if (constraints_changed)
+      return;
+
+    gridlock_status.update(participant_id, assignments.ranges());
+  }
+
+  /// Recompute the assignments unless a batch is open
+  void update_assignments()
+  {
+    if (batch_depth > 0)
+      return;
+
+    process_ready_queue();
+  }
+
+  void flush()
+  {
+    if (constraints_changed)
+    {
+      constraints_changed = false;
+      final_constraints = compute_final_ShouldGo_constraints(
+        peer_blockers, peer_alignment);
+
+      compile_final_constraints();
+    }
+
+    process_ready_queue();
+  }
+
   void process_ready_queue()
   {
-    auto next = ready_queue.begin();
-    while (next != ready_queue.end())
+    auto next = ready_head;
+    while (next != npos)
     {
-      const auto result = check_reservation(*next);
+      const auto result = check_reservation(slots[next].ready);
       if (result == Finished)
       {
-        ready_queue.erase(next);
-        next = ready_queue.begin();
+        pop_ready(next);
+        next = ready_head;
       }
       else if (result == Incomplete)
       {
-        next = ready_queue.begin();
+        next = ready_head;
       }
       else
       {
-        ++next;
+        next = slots[next].next;
       }
     }
   }
@@ -236,21 +486,26 @@ public:
     const ReservationId reservation_id,
     const Reservation& reservation)
   {
-    const auto insertion = last_known_reservation.insert(
-      {participant_id, reservation_id});
-    const bool inserted = insertion.second;
-    const auto& r_it = insertion.first;
-    auto& current_reservation = r_it->second;
-
-    if (!inserted)
+    bool same_path = false;
+    std::size_t slot = find_slot(participant_id);
+    if (slot == npos)
     {
-      const auto current_id = current_reservation.id;
+      slot = add_slot(participant_id);
+    }
+    else
+    {
+      const auto current_id = slots[slot].reservation_id;
       if (rmf_utils::modular(reservation_id).less_than_or_equal(current_id))
         return;
 
-      current_reservation.id = reservation_id;
+      // Whatever the participant was ready for belonged to its old reservation
+      pop_ready(slot);
+      same_path = same_reservation(slots[slot].reservation, reservation);
     }
 
+    auto& current_reservation = slots[slot];
+    current_reservation.reservation_id = reservation_id;
+
     if (info_logger)
     {
       std::stringstream str;
@@ -259,7 +514,27 @@ public:
       info_logger(str.str());
     }
 
+    if (same_path)
+    {
+      // The comparisons with the peers only depend on the paths, so everything
+      // that was found for the previous reservation still holds. Only the
+      // progress of the participant needs to start over.
+      Assignments::Implementation::modify(assignments).ranges
+      .insert_or_assign(participant_id, ReservedRange{0, 0});
+
+      update_gridlock(participant_id);
+      statuses[participant_id] = Status{reservation_id, std::nullopt, 0, false};
+      mark_changed(participant_id);
+      update_assignments();
+      return;
+    }
+
     current_reservation.reservation = reservation;
+    current_reservation.prepared =
+      PreparedPath::make(reservation.path, reservation.radius);
+    const auto& prepared = current_reservation.prepared;
+    reservation_index.insert(participant_id, reservation);
+    const auto nearby = reservation_index.nearby(participant_id);
 
     const auto peer_blocker_insertion =
       peer_blockers.insert({participant_id, {}});
@@ -275,25 +550,83 @@ public:
     if (!peer_aligned_inserted)
       peer_aligned_it->second.clear();
 
-    for (const auto& other_r : last_known_reservation)
+    std::vector<PeerComparison> comparisons;
+    for (const auto& other_slot : slots)
     {
-      const auto other_participant = other_r.first;
+      if (!other_slot.active)
+        continue;
+
+      const auto other_participant = other_slot.participant_id;
       if (other_participant == participant_id)
         continue;
 
-      const auto& other_reservation = other_r.second.reservation;
+      if (nearby.count(other_participant) == 0)
+      {
+        // The paths are too far apart to have any conflicts or alignments, so
+        // we only need to clear out whatever was found for the previous path.
+        const auto other_blocker_it = peer_blockers.find(other_participant);
+        if (other_blocker_it != peer_blockers.end())
+          other_blocker_it->second.erase(participant_id);
+
+        const auto other_aligned_it = peer_alignment.find(other_participant);
+        if (other_aligned_it != peer_alignment.end())
+          other_aligned_it->second.erase(participant_id);
+
+        continue;
+      }
+
+      comparisons.push_back(
+        PeerComparison{
+          other_participant,
+          &other_slot.reservation,
+          &other_slot.prepared,
+          {},
+          {}
+        });
+    }
+
+    // Merge the results in order of participant ID so that the outcome does
+    // not depend on how the reservations happen to be stored.
+    std::sort(
+      comparisons.begin(), comparisons.end(),
+      [](const PeerComparison& a, const PeerComparison& b)
+      {
+        return a.participant_id < b.participant_id;
+      });
+
+    const auto compare = [&](const std::size_t i)
+      {
+        auto& comparison = comparisons[i];
+        const auto& other_reservation = *comparison.reservation;
+
+        const auto brackets = compute_brackets(
+          reservation.path, prepared,
+          other_reservation.path, *comparison.prepared,
+          min_conflict_angle);
 
-      const auto brackets = compute_brackets(
-        reservation.path, reservation.radius,
-        other_reservation.path, other_reservation.radius,
-        min_conflict_angle);
+        comparison.blockers = compute_blockers(
+          brackets.conflicts,
+          participant_id, reservation.path.size(),
+          comparison.participant_id, other_reservation.path.size());
 
-      auto zero_order_blockers = compute_blockers(
-        brackets.conflicts,
-        participant_id, reservation.path.size(),
-        other_participant, other_reservation.path.size());
+        comparison.alignments = compute_alignments(brackets.alignments);
+      };
 
-      auto alignments = compute_alignments(brackets.alignments);
+    if (worker_pool && comparisons.size() > 1)
+    {
+      worker_pool->run(comparisons.size(), compare);
+    }
+    else
+    {
+      for (std::size_t i = 0; i < comparisons.size(); ++i)
+        compare(i);
+    }
+
+    for (auto& comparison : comparisons)
+    {
+      const auto other_participant = comparison.participant_id;
+      auto& zero_order_blockers = comparison.blockers;
+      auto& alignments = comparison.alignments;
 
       const auto this_blocker_it =
         peer_blocker_it->second.insert_or_assign(
@@ -322,15 +655,15 @@ public:
       other_aligned_map = std::move(alignments.at(1));
     }
 
-    final_constraints = compute_final_ShouldGo_constraints(
-      peer_blockers, peer_alignment);
-
     Assignments::Implementation::modify(assignments).ranges
     .insert_or_assign(participant_id, ReservedRange{0, 0});
 
+    update_constraints();
+
     statuses[participant_id] = Status{reservation_id, std::nullopt, 0, false};
+    mark_changed(participant_id);
 
-    process_ready_queue();
+    update_assignments();
   }
 
   void ready(
@@ -338,14 +671,15 @@ public:
     const ReservationId reservation_id,
     const CheckpointId checkpoint)
   {
-    const auto r_it = last_known_reservation.find(participant_id);
-    if (r_it == last_known_reservation.end())
+    const auto s = find_slot(participant_id);
+    if (s == npos)
       return;
 
-    if (r_it->second.id != reservation_id)
+    auto& slot = slots[s];
+    if (slot.reservation_id != reservation_id)
       return;
 
-    const auto& path = r_it->second.reservation.path;
+    const auto& path = slot.reservation.path;
     if (path.empty())
       return;
 
@@ -362,10 +696,20 @@ public:
     }
 
     status.last_ready = checkpoint;
-    ready_queue.push_back(
-      ReadyInfo{participant_id, reservation_id, checkpoint});
+    mark_changed(participant_id);
+    if (slot.queued)
+    {
+      // The participant is already waiting in the queue, so the entry it has
+      // there will now try to reach the later checkpoint.
+      slot.ready.checkpoint = checkpoint;
+    }
+    else
+    {
+      slot.ready = ReadyInfo{participant_id, reservation_id, checkpoint};
+      push_ready(s);
+    }
 
-    process_ready_queue();
+    update_assignments();
   }
 
   void release(
@@ -373,14 +717,15 @@ public:
     const ReservationId reservation_id,
     CheckpointId checkpoint)
   {
-    const auto r_it = last_known_reservation.find(participant_id);
-    if (r_it == last_known_reservation.end())
+    const auto s = find_slot(participant_id);
+    if (s == npos)
       return;
 
-    if (r_it->second.id != reservation_id)
+    auto& slot = slots[s];
+    if (slot.reservation_id != reservation_id)
       return;
 
-    const auto& path = r_it->second.reservation.path;
+    const auto& path = slot.reservation.path;
     if (path.empty())
       return;
 
@@ -396,48 +741,30 @@ public:
       new_ready = checkpoint - 1;
 
     status.last_ready = new_ready;
+    mark_changed(participant_id);
 
     auto& range = Assignments::Implementation::modify(assignments)
       .ranges.at(participant_id);
 
     if (checkpoint < range.end)
+    {
       range.end = checkpoint;
+      update_gridlock(participant_id);
+    }
 
     if (new_ready.has_value())
     {
-      for (auto r_it = ready_queue.begin(); r_it != ready_queue.end(); ++r_it)
-      {
-        if (participant_id != r_it->participant_id)
-          continue;
-
-        // This ready entry probably shouldn't exist anyway, but we'll leave
-        // that up to process_ready_queue() to deal with.
-        if (reservation_id != r_it->reservation_id)
-          continue;
-
-        if (checkpoint <= r_it->checkpoint)
-          r_it->checkpoint = checkpoint;
-      }
+      if (slot.queued && checkpoint <= slot.ready.checkpoint)
+        slot.ready.checkpoint = checkpoint;
     }
     else
     {
       // The participant no longer has any checkpoints that it is ready to move
-      // from, so we should erase any entries that this participant has in the
-      // ready queue.
-      auto r_it = ready_queue.begin();
-      while (r_it != ready_queue.end())
-      {
-        if (participant_id != r_it->participant_id)
-        {
-          ++r_it;
-          continue;
-        }
-
-        ready_queue.erase(r_it++);
-      }
+      // from, so we should remove its entry from the ready queue.
+      pop_ready(s);
     }
 
-    process_ready_queue();
+    update_assignments();
   }
 
   void reached(
@@ -445,14 +772,15 @@ public:
     const ReservationId reservation_id,
     CheckpointId checkpoint)
   {
-    const auto r_it = last_known_reservation.find(participant_id);
-    if (r_it == last_known_reservation.end())
+    const auto s = find_slot(participant_id);
+    if (s == npos)
       return;
 
-    if (r_it->second.id != reservation_id)
+    auto& slot = slots[s];
+    if (slot.reservation_id != reservation_id)
       return;
 
-    const auto& path = r_it->second.reservation.path;
+    const auto& path = slot.reservation.path;
     // TODO(MXG): Should this trigger a warning or exception?
     if (checkpoint >= path.size())
       checkpoint = path.size()-1;
@@ -472,6 +800,8 @@ public:
 
       if (!had_critical_error)
       {
+        mark_changed(participant_id);
+
         std::stringstream str;
         str << "[rmf_traffic::blockade::Participant::reached] Participant ["
             << participant_id << "] reached an invalid checkpoint ["
@@ -492,21 +822,23 @@ public:
     status.last_reached = checkpoint;
 
     range.begin = checkpoint;
+    update_gridlock(participant_id);
+    mark_changed(participant_id);
 
-    process_ready_queue();
+    update_assignments();
   }
 
   void cancel(
     const ParticipantId participant_id,
     const ReservationId reservation_id)
   {
-    const auto r_it = last_known_reservation.find(participant_id);
-    if (r_it == last_known_reservation.end())
+    const auto s = find_slot(participant_id);
+    if (s == npos)
     {
       return;
     }
 
-    if (reservation_id < r_it->second.id)
+    if (reservation_id < slots[s].reservation_id)
     {
       return;
     }
@@ -526,8 +858,14 @@ public:
       info_logger("Canceling: " + toul(participant_id));
     }
 
-    last_known_reservation.erase(participant_id);
-    statuses.erase(participant_id);
+    const auto s = find_slot(participant_id);
+    if (s != npos)
+      remove_slot(s);
+
+    reservation_index.erase(participant_id);
+    if (statuses.erase(participant_id) > 0)
+      mark_changed(participant_id, true);
+
     peer_blockers.erase(participant_id);
     peer_alignment.erase(participant_id);
     Assignments::Implementation::modify(assignments)
@@ -539,13 +877,32 @@ public:
     for (auto& peer : peer_alignment)
       peer.second.erase(participant_id);
 
-    final_constraints = compute_final_ShouldGo_constraints(
-      peer_blockers, peer_alignment);
-
-    process_ready_queue();
+    update_constraints();
+    update_assignments();
   }
 };
 
+//==============================================================================
+Moderator::Batch::Batch(Moderator& moderator)
+: _moderator(&moderator)
+{
+  ++_moderator->_pimpl->batch_depth;
+}
+
+//==============================================================================
+void Moderator::Batch::flush()
+{
+  _moderator->_pimpl->flush();
+}
+
+//==============================================================================
+Moderator::Batch::~Batch()
+{
+  auto& impl = *_moderator->_pimpl;
+  if (--impl.batch_depth == 0)
+    impl.flush();
+}
+
 //==============================================================================
 Moderator::Moderator(
   std::function<void(std::string)> info,
@@ -622,6 +979,26 @@ Moderator& Moderator::minimum_conflict_angle(const double new_value)
   return *this;
 }
 
+//==============================================================================
+Moderator& Moderator::threads(const std::size_t value)
+{
+  if (value <= 1)
+    _pimpl->worker_pool = nullptr;
+  else if (!_pimpl->worker_pool || _pimpl->worker_pool->size() != value)
+    _pimpl->worker_pool = std::make_shared<schedule::WorkerPool>(value);
+
+  return *this;
+}
+
+//==============================================================================
+std::size_t Moderator::threads() const
+{
+  if (!_pimpl->worker_pool)
+    return 1;
+
+  return _pimpl->worker_pool->size();
+}
+
 //==============================================================================
 Moderator& Moderator::info_logger(std::function<void(std::string)> info)
 {
@@ -649,12 +1026,33 @@ const std::unordered_map<ParticipantId, Status>& Moderator::statuses() const
 }
 
 //==============================================================================
-bool Moderator::has_gridlock() const
+std::size_t Moderator::changes_version() const
 {
-  if (!_pimpl->final_constraints.gridlock)
-    return false;
+  return _pimpl->change_version;
+}
+
+//==============================================================================
+auto Moderator::changes_since(const std::size_t version) const -> Changes
+{
+  Changes changes;
+  changes.version = _pimpl->change_version;
+  const auto& log = _pimpl->change_log;
+  for (auto it = log.upper_bound(version); it != log.end(); ++it)
+  {
+    const auto participant_id = it->second;
+    if (_pimpl->change_records.at(participant_id).removed)
+      changes.removed.push_back(participant_id);
+    else
+      changes.changed.push_back(participant_id);
+  }
+
+  return changes;
+}
 
-  return !_pimpl->final_constraints.gridlock->evaluate(assignments().ranges());
+//==============================================================================
+bool Moderator::has_gridlock() const
+{
+  return _pimpl->gridlock_status.has_gridlock();
 }
 
 } // namespace blockade
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ReservationIndex.hpp"
+#include "geometry.hpp"
+
+#include <cmath>
+
+namespace rmf_traffic {
+namespace blockade {
+
+//==============================================================================
+bool ReservationIndex::Cell::operator==(const Cell& other) const
+{
+  return x == other.x && y == other.y && map == other.map;
+}
+
+//==============================================================================
+std::size_t ReservationIndex::CellHash::operator()(const Cell& cell) const
+{
+  std::size_t seed = std::hash<std::string>()(cell.map);
+  for (const auto v : {cell.x, cell.y})
+  {
+    seed ^= std::hash<std::int64_t>()(v) + 0x9e3779b9 + (seed << 6)
+      + (seed >> 2);
+  }
+
+  return seed;
+}
+
+//==============================================================================
+ReservationIndex::ReservationIndex(const double cell_size)
+: _cell_size(cell_size)
+{
+  // Do nothing
+}
+
+//==============================================================================
+void ReservationIndex::insert(
+  const ParticipantId participant,
+  const Writer::Reservation& reservation)
+{
+  erase(participant);
+
+  std::unordered_set<Cell, CellHash> cells;
+  const auto& path = reservation.path;
+  for (std::size_t i = 0; i+1 < path.size(); ++i)
+  {
+    const auto& start = path[i];
+    const auto& finish = path[i+1];
+
+    // Segments that move between maps are never compared, just like in
+    // compute_brackets()
+    if (start.map_name != finish.map_name)
+      continue;
+
+    const auto box = BoundingBox::make(
+      {start.position, finish.position, reservation.radius});
+
+    const auto x_min = static_cast<std::int64_t>(
+      std::floor(box.min.x()/_cell_size));
+    const auto x_max = static_cast<std::int64_t>(
+      std::floor(box.max.x()/_cell_size));
+    const auto y_min = static_cast<std::int64_t>(
+      std::floor(box.min.y()/_cell_size));
+    const auto y_max = static_cast<std::int64_t>(
+      std::floor(box.max.y()/_cell_size));
+
+    for (auto x = x_min; x <= x_max; ++x)
+    {
+      for (auto y = y_min; y <= y_max; ++y)
+        cells.insert(Cell{start.map_name, x, y});
+    }
+  }
+
+  auto& participant_cells = _participant_cells[participant];
+  participant_cells.reserve(cells.size());
+  for (const auto& cell : cells)
+  {
+    _cells[cell].insert(participant);
+    participant_cells.push_back(cell);
+  }
+}
+
+//==============================================================================
+void ReservationIndex::erase(const ParticipantId participant)
+{
+  const auto it = _participant_cells.find(participant);
+  if (it == _participant_cells.end())
+    return;
+
+  for (const auto& cell : it->second)
+  {
+    const auto c_it = _cells.find(cell);
+    if (c_it == _cells.end())
+      continue;
+
+    c_it->second.erase(participant);
+    if (c_it->second.empty())
+      _cells.erase(c_it);
+  }
+
+  _participant_cells.erase(it);
+}
+
+//==============================================================================
+std::unordered_set<ParticipantId> ReservationIndex::nearby(
+  const ParticipantId participant) const
+{
+  std::unordered_set<ParticipantId> output;
+  const auto it = _participant_cells.find(participant);
+  if (it == _participant_cells.end())
+    return output;
+
+  for (const auto& cell : it->second)
+  {
+    const auto c_it = _cells.find(cell);
+    if (c_it == _cells.end())
+      continue;
+
+    output.insert(c_it->second.begin(), c_it->second.end());
+  }
+
+  output.erase(participant);
+  return output;
+}
+
+} // namespace blockade
+} // namespace rmf_traffic
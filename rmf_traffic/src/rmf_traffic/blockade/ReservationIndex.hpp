@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__BLOCKADE__RESERVATIONINDEX_HPP
+#define SRC__RMF_TRAFFIC__BLOCKADE__RESERVATIONINDEX_HPP
+
+#include <rmf_traffic/blockade/Writer.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace rmf_traffic {
+namespace blockade {
+
+//==============================================================================
+/// A grid over the maps that keeps track of which cells the reserved paths of
+/// each participant pass through. Two participants whose paths do not share
+/// any cell are too far apart to have any conflicts or alignments, so their
+/// paths do not need to be compared.
+class ReservationIndex
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] cell_size
+  ///   The width of each square cell of the grid
+  explicit ReservationIndex(double cell_size = 5.0);
+
+  /// Index the reserved path of a participant. Any path that was indexed for
+  /// this participant before will be replaced.
+  void insert(
+    ParticipantId participant,
+    const Writer::Reservation& reservation);
+
+  /// Remove the path of a participant from the index
+  void erase(ParticipantId participant);
+
+  /// Get the other participants whose paths pass through at least one of the
+  /// cells that the path of this participant passes through.
+  std::unordered_set<ParticipantId> nearby(ParticipantId participant) const;
+
+private:
+
+  struct Cell
+  {
+    std::string map;
+    std::int64_t x;
+    std::int64_t y;
+
+    bool operator==(const Cell& other) const;
+  };
+
+  struct CellHash
+  {
+    std::size_t operator()(const Cell& cell) const;
+  };
+
+  double _cell_size;
+  std::unordered_map<Cell, std::unordered_set<ParticipantId>, CellHash> _cells;
+  std::unordered_map<ParticipantId, std::vector<Cell>> _participant_cells;
+};
+
+} // namespace blockade
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__BLOCKADE__RESERVATIONINDEX_HPP
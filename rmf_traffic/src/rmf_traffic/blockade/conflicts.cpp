@@ -18,6 +18,7 @@
 #include "conflicts.hpp"
 #include "geometry.hpp"
 
+#include <algorithm>
 #include <set>
 #include <map>
 
@@ -364,69 +365,199 @@ void expand_bracket(
 }
 
 //==============================================================================
-Brackets compute_brackets(
-  const std::vector<Writer::Checkpoint>& path_a,
-  const double radius_a,
-  const std::vector<Writer::Checkpoint>& path_b,
-  const double radius_b,
-  const double angle_threshold)
+PreparedPath PreparedPath::make(
+  const std::vector<Writer::Checkpoint>& path,
+  const double radius)
 {
-  std::multimap<std::size_t, AlignedBracketPair> aligned_set;
-  std::multimap<std::size_t, ConflictBracketPair> conflict_set;
-  for (std::size_t a = 0; a < path_a.size()-1; ++a)
-  {
-    const auto& it_a_start = path_a[a];
-    const auto& it_a_finish = path_a[a+1];
+  PreparedPath prepared;
+  if (path.size() < 2)
+    return prepared;
 
-    if (it_a_start.map_name != it_a_finish.map_name)
+  prepared.segments.reserve(path.size() - 1);
+  for (std::size_t i = 0; i+1 < path.size(); ++i)
+  {
+    const auto& start = path[i];
+    const auto& finish = path[i+1];
+    if (start.map_name != finish.map_name)
+    {
+      prepared.segments.push_back(std::nullopt);
       continue;
+    }
 
-    const Segment segment_a{
-      it_a_start.position, it_a_finish.position, radius_a};
+    prepared.segments.push_back(
+      PreparedSegment::make({start.position, finish.position, radius}));
+    prepared.sweep_order.push_back(i);
+  }
 
-    for (std::size_t b = 0; b < path_b.size()-1; ++b)
+  const auto& segments = prepared.segments;
+  std::sort(prepared.sweep_order.begin(), prepared.sweep_order.end(),
+    [&segments](const std::size_t lhs, const std::size_t rhs)
     {
-      const auto& it_b_start = path_b[b];
-      const auto& it_b_finish = path_b[b+1];
+      return segments[lhs]->box.min.x() < segments[rhs]->box.min.x();
+    });
+
+  return prepared;
+}
+
+//==============================================================================
+std::vector<std::pair<std::size_t, std::size_t>> find_segment_pairs(
+  const std::vector<Writer::Checkpoint>& path_a,
+  const double radius_a,
+  const std::vector<Writer::Checkpoint>& path_b,
+  const double radius_b)
+{
+  return find_segment_pairs(
+    path_a, PreparedPath::make(path_a, radius_a),
+    path_b, PreparedPath::make(path_b, radius_b));
+}
 
-      if (it_b_start.map_name != it_b_finish.map_name)
-        continue;
+//==============================================================================
+std::vector<std::pair<std::size_t, std::size_t>> find_segment_pairs(
+  const std::vector<Writer::Checkpoint>& path_a,
+  const PreparedPath& prepared_a,
+  const std::vector<Writer::Checkpoint>& path_b,
+  const PreparedPath& prepared_b)
+{
+  struct Item
+  {
+    std::size_t index;
+    const BoundingBox* box;
+    const std::string* map;
+  };
 
-      if (it_a_start.map_name != it_b_start.map_name)
-        continue;
+  const auto make_items = [](
+    const std::vector<Writer::Checkpoint>& path,
+    const PreparedPath& prepared)
+    {
+      std::vector<Item> items;
+      items.reserve(prepared.sweep_order.size());
+      for (const auto i : prepared.sweep_order)
+        items.push_back({i, &prepared.segments[i]->box, &path[i].map_name});
 
-      const Segment segment_b{
-        it_b_start.position, it_b_finish.position, radius_b};
+      return items;
+    };
 
-      const auto info = detect_conflict(segment_a, segment_b, angle_threshold);
+  const auto items_a = make_items(path_a, prepared_a);
+  const auto items_b = make_items(path_b, prepared_b);
 
-      if (info.is_nothing())
-        continue;
+  // Drop the items that end before x, since none of the remaining items can
+  // reach back to them
+  const auto retire = [](std::vector<const Item*>& active, const double x)
+    {
+      active.erase(
+        std::remove_if(active.begin(), active.end(),
+        [x](const Item* item) { return item->box->max.x() < x; }),
+        active.end());
+    };
 
-      BracketPair pair;
-      pair.A.start = a;
-      pair.A.finish = a+1;
-      pair.A.include_start = info.include_cap_a[ConflictInfo::Start];
-      pair.A.include_finish = info.include_cap_a[ConflictInfo::Finish];
+  const auto touches = [](const Item& a, const Item& b)
+    {
+      return a.box->overlaps(*b.box) && *a.map == *b.map;
+    };
 
-      pair.B.start = b;
-      pair.B.finish = b+1;
-      pair.B.include_start = info.include_cap_b[ConflictInfo::Start];
-      pair.B.include_finish = info.include_cap_b[ConflictInfo::Finish];
+  std::vector<std::pair<std::size_t, std::size_t>> pairs;
+  std::vector<const Item*> active_a;
+  std::vector<const Item*> active_b;
+  std::size_t next_a = 0;
+  std::size_t next_b = 0;
+  while (next_a < items_a.size() || next_b < items_b.size())
+  {
+    const bool take_a = next_b >= items_b.size()
+      || (next_a < items_a.size()
+      && items_a[next_a].box->min.x() <= items_b[next_b].box->min.x());
 
-      if (info.is_conflict())
+    if (take_a)
+    {
+      const Item& item = items_a[next_a++];
+      retire(active_b, item.box->min.x());
+      for (const Item* other : active_b)
       {
-        expand_bracket(pair.A, path_a);
-        expand_bracket(pair.B, path_b);
-
-        conflict_set.emplace(
-          std::make_pair(pair.A.start, ConflictBracketPair{pair}));
+        if (touches(item, *other))
+          pairs.emplace_back(item.index, other->index);
       }
-      else if (info.is_alignment())
+
+      active_a.push_back(&item);
+    }
+    else
+    {
+      const Item& item = items_b[next_b++];
+      retire(active_a, item.box->min.x());
+      for (const Item* other : active_a)
       {
-        aligned_set.emplace(
-          std::make_pair(pair.A.start, AlignedBracketPair{pair}));
+        if (touches(*other, item))
+          pairs.emplace_back(other->index, item.index);
       }
+
+      active_b.push_back(&item);
+    }
+  }
+
+  std::sort(pairs.begin(), pairs.end());
+  return pairs;
+}
+
+//==============================================================================
+Brackets compute_brackets(
+  const std::vector<Writer::Checkpoint>& path_a,
+  const double radius_a,
+  const std::vector<Writer::Checkpoint>& path_b,
+  const double radius_b,
+  const double angle_threshold)
+{
+  return compute_brackets(
+    path_a, PreparedPath::make(path_a, radius_a),
+    path_b, PreparedPath::make(path_b, radius_b),
+    angle_threshold);
+}
+
+//==============================================================================
+Brackets compute_brackets(
+  const std::vector<Writer::Checkpoint>& path_a,
+  const PreparedPath& prepared_a,
+  const std::vector<Writer::Checkpoint>& path_b,
+  const PreparedPath& prepared_b,
+  const double angle_threshold)
+{
+  std::multimap<std::size_t, AlignedBracketPair> aligned_set;
+  std::multimap<std::size_t, ConflictBracketPair> conflict_set;
+
+  // Only the pairs of segments that are close enough to touch need to be
+  // checked. They are visited in the same order as a full pairwise loop would
+  // visit them, so the brackets come out the same.
+  const auto segment_pairs =
+    find_segment_pairs(path_a, prepared_a, path_b, prepared_b);
+
+  for (const auto& [a, b] : segment_pairs)
+  {
+    const auto info = detect_conflict(
+      *prepared_a.segments[a], *prepared_b.segments[b], angle_threshold);
+
+    if (info.is_nothing())
+      continue;
+
+    BracketPair pair;
+    pair.A.start = a;
+    pair.A.finish = a+1;
+    pair.A.include_start = info.include_cap_a[ConflictInfo::Start];
+    pair.A.include_finish = info.include_cap_a[ConflictInfo::Finish];
+
+    pair.B.start = b;
+    pair.B.finish = b+1;
+    pair.B.include_start = info.include_cap_b[ConflictInfo::Start];
+    pair.B.include_finish = info.include_cap_b[ConflictInfo::Finish];
+
+    if (info.is_conflict())
+    {
+      expand_bracket(pair.A, path_a);
+      expand_bracket(pair.B, path_b);
+
+      conflict_set.emplace(
+        std::make_pair(pair.A.start, ConflictBracketPair{pair}));
+    }
+    else if (info.is_alignment())
+    {
+      aligned_set.emplace(
+        std::make_pair(pair.A.start, AlignedBracketPair{pair}));
     }
   }
 
@@ -743,7 +874,8 @@ FinalConstraints compute_final_ShouldGo_constraints(
     }
   }
 
-  const auto gridlock_constraint = compute_gridlock_constraint(first_order);
+  auto gridlock_cycles = compute_gridlock_cycles(first_order);
+  const auto gridlock_constraint = combine_gridlock_cycles(gridlock_cycles);
 
   // Now we will move the first order constraints into the container for the
   // final order constraints and modify them in place by adding the gridlock
@@ -772,7 +904,11 @@ FinalConstraints compute_final_ShouldGo_constraints(
     }
   }
 
-  return FinalConstraints{std::move(final_order), gridlock_constraint};
+  return FinalConstraints{
+    std::move(final_order),
+    gridlock_constraint,
+    std::move(gridlock_cycles)
+  };
 }
 
 } // namespace blockade
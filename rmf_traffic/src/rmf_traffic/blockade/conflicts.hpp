@@ -19,9 +19,11 @@
 #define SRC__RMF_TRAFFIC__BLOCKADE__CONFLICTS_HPP
 
 #include "Constraint.hpp"
+#include "geometry.hpp"
 #include <rmf_traffic/blockade/Writer.hpp>
 
 #include <map>
+#include <optional>
 
 namespace rmf_traffic {
 namespace blockade {
@@ -108,6 +110,44 @@ struct Brackets
   std::vector<AlignedBracketSet> alignments;
 };
 
+//==============================================================================
+/// The segments of a path, prepared for conflict detection. Segment i goes from
+/// checkpoint i to checkpoint i+1. A path can be prepared once, when it is
+/// reserved, and then compared against any number of other paths.
+struct PreparedPath
+{
+  /// One entry for each segment. Segments that move between maps are empty.
+  std::vector<std::optional<PreparedSegment>> segments;
+
+  /// The indices of the non-empty segments, sorted by the lower x bounds of
+  /// their boxes.
+  std::vector<std::size_t> sweep_order;
+
+  static PreparedPath make(
+    const std::vector<Writer::Checkpoint>& path,
+    double radius);
+};
+
+//==============================================================================
+/// Find the pairs of segments of two paths whose bounding boxes overlap, using
+/// a sweep along the x axis. Only these pairs can have a conflict or an
+/// alignment. Each pair holds the index of a segment in path_a followed by the
+/// index of a segment in path_b, where segment i goes from checkpoint i to
+/// checkpoint i+1. The pairs are sorted.
+std::vector<std::pair<std::size_t, std::size_t>> find_segment_pairs(
+  const std::vector<Writer::Checkpoint>& path_a,
+  double radius_a,
+  const std::vector<Writer::Checkpoint>& path_b,
+  double radius_b);
+
+//==============================================================================
+/// Same as above, but for paths that have already been prepared
+std::vector<std::pair<std::size_t, std::size_t>> find_segment_pairs(
+  const std::vector<Writer::Checkpoint>& path_a,
+  const PreparedPath& prepared_a,
+  const std::vector<Writer::Checkpoint>& path_b,
+  const PreparedPath& prepared_b);
+
 //==============================================================================
 Brackets compute_brackets(
   const std::vector<Writer::Checkpoint>& path_a,
@@ -116,6 +156,15 @@ Brackets compute_brackets(
   double radius_b,
   double angle_threshold);
 
+//==============================================================================
+/// Same as above, but for paths that have already been prepared
+Brackets compute_brackets(
+  const std::vector<Writer::Checkpoint>& path_a,
+  const PreparedPath& prepared_a,
+  const std::vector<Writer::Checkpoint>& path_b,
+  const PreparedPath& prepared_b,
+  double angle_threshold);
+
 //==============================================================================
 std::array<IndexToConstraint, 2> compute_blockers(
   const std::vector<ConflictBracketPair>& conflict_brackets,
@@ -169,6 +218,9 @@ struct FinalConstraints
 {
   Blockers should_go;
   ConstConstraintPtr gridlock;
+
+  /// The cycles that make up the gridlock constraint
+  std::vector<ConstConstraintPtr> gridlock_cycles;
 };
 
 //==============================================================================
@@ -41,21 +41,36 @@ ConflictInfo detect_conflict(
   const Segment& s_b,
   const double angle_threshold)
 {
+  return detect_conflict(
+    PreparedSegment::make(s_a),
+    PreparedSegment::make(s_b),
+    angle_threshold);
+}
+
+//==============================================================================
+ConflictInfo detect_conflict(
+  const PreparedSegment& prepared_a,
+  const PreparedSegment& prepared_b,
+  const double angle_threshold)
+{
+  const Segment& s_a = prepared_a.segment;
+  const Segment& s_b = prepared_b.segment;
+
   const Eigen::Vector2d p_a0 = s_a.start;
   const Eigen::Vector2d p_a1 = s_a.finish;
   const Eigen::Vector2d p_b0 = s_b.start;
   const Eigen::Vector2d p_b1 = s_b.finish;
 
-  const Eigen::Vector2d n_a = p_a1 - p_a0;
-  const Eigen::Vector2d n_b = p_b1 - p_b0;
+  const Eigen::Vector2d& n_a = prepared_a.n;
+  const Eigen::Vector2d& n_b = prepared_b.n;
 
   const double c_ab = n_a.dot(n_b);
 
   // We put caps of -1.0, 1.0 here because sometimes floating point error may
   // cause the calculation to flow a tiny bit over 1.0 or a tiny bit under -1.0,
   // which causes an NaN result for angle.
-  const double cos_theta =
-    std::max(-1.0, std::min(1.0, c_ab/(n_a.norm()*n_b.norm())));
+  const double cos_theta = std::max(
+    -1.0, std::min(1.0, c_ab/(prepared_a.length*prepared_b.length)));
 
   const double angle = std::acos(cos_theta);
 
@@ -70,10 +85,10 @@ ConflictInfo detect_conflict(
     info.type = ConflictInfo::Alignment;
   }
 
-  const double c_aa = n_a.dot(n_a);
+  const double c_aa = prepared_a.length_squared;
   assert(c_aa != 0.0);
 
-  const double c_bb = n_b.dot(n_b);
+  const double c_bb = prepared_b.length_squared;
   assert(c_bb != 0.0);
 
   const double conflict_r = s_a.radius+s_b.radius;
@@ -160,5 +175,41 @@ ConflictInfo detect_conflict(
   return info;
 }
 
+//==============================================================================
+BoundingBox BoundingBox::make(const Segment& segment)
+{
+  const Eigen::Vector2d r = Eigen::Vector2d::Constant(segment.radius);
+  return BoundingBox{
+    segment.start.cwiseMin(segment.finish) - r,
+    segment.start.cwiseMax(segment.finish) + r
+  };
+}
+
+//==============================================================================
+bool BoundingBox::overlaps(const BoundingBox& other) const
+{
+  for (int i = 0; i < 2; ++i)
+  {
+    if (max[i] < other.min[i] || other.max[i] < min[i])
+      return false;
+  }
+
+  return true;
+}
+
+//==============================================================================
+PreparedSegment PreparedSegment::make(const Segment& segment)
+{
+  const Eigen::Vector2d n = segment.finish - segment.start;
+  const double length_squared = n.dot(n);
+  return PreparedSegment{
+    segment,
+    n,
+    length_squared,
+    std::sqrt(length_squared),
+    BoundingBox::make(segment)
+  };
+}
+
 } // namespace blockade
 } // namespace rmf_traffic
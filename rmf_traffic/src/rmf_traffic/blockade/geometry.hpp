@@ -81,6 +81,49 @@ ConflictInfo detect_conflict(
   const Segment& s_b,
   double angle_threshold);
 
+//==============================================================================
+/// An axis-aligned box that surrounds a segment, including its radius. If the
+/// boxes of two segments do not overlap, then detect_conflict() will find
+/// nothing for them.
+struct BoundingBox
+{
+  Eigen::Vector2d min;
+  Eigen::Vector2d max;
+
+  static BoundingBox make(const Segment& segment);
+
+  bool overlaps(const BoundingBox& other) const;
+};
+
+//==============================================================================
+/// A segment together with the quantities that detect_conflict() derives from
+/// its endpoints. Preparing a segment once lets it be checked against many
+/// other segments without recomputing them.
+struct PreparedSegment
+{
+  Segment segment;
+
+  /// The vector from the start of the segment to its finish
+  Eigen::Vector2d n;
+
+  /// The squared length of the segment
+  double length_squared;
+
+  /// The length of the segment
+  double length;
+
+  /// The box that surrounds the segment, including its radius
+  BoundingBox box;
+
+  static PreparedSegment make(const Segment& segment);
+};
+
+//==============================================================================
+ConflictInfo detect_conflict(
+  const PreparedSegment& s_a,
+  const PreparedSegment& s_b,
+  double angle_threshold);
+
 } // namespace blockade
 } // namespace rmf_traffic
 
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/debug/Trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rmf_traffic {
+namespace debug {
+
+namespace {
+//==============================================================================
+// The sink is only ever accessed through the atomic free functions of
+// std::shared_ptr. The flag lets an idle span skip that access entirely.
+std::shared_ptr<TraceSink> installed_sink;
+std::atomic_bool sink_installed(false);
+std::atomic_size_t sample_every(1);
+
+//==============================================================================
+std::size_t this_thread_number()
+{
+  static std::atomic_size_t next_number(0);
+  thread_local const std::size_t number = next_number++;
+  return number;
+}
+
+//==============================================================================
+void write_escaped(std::ostream& output, const char* text)
+{
+  for (const char* c = text; *c != '\0'; ++c)
+  {
+    if (*c == '"' || *c == '\\')
+      output << '\\';
+
+    output << *c;
+  }
+}
+
+//==============================================================================
+double to_microseconds(const Duration d)
+{
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+} // anonymous namespace
+
+//==============================================================================
+bool Trace::compiled_in()
+{
+#ifdef RMF_TRAFFIC__ENABLE_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+//==============================================================================
+void Trace::set_sink(std::shared_ptr<TraceSink> sink)
+{
+  const bool installed = static_cast<bool>(sink);
+  std::atomic_store(&installed_sink, std::move(sink));
+  sink_installed.store(installed, std::memory_order_release);
+}
+
+//==============================================================================
+std::shared_ptr<TraceSink> Trace::get_sink()
+{
+  return std::atomic_load(&installed_sink);
+}
+
+//==============================================================================
+bool Trace::active()
+{
+  return sink_installed.load(std::memory_order_relaxed);
+}
+
+//==============================================================================
+void Trace::set_sample_interval(const std::size_t every)
+{
+  sample_every.store(std::max<std::size_t>(every, 1),
+    std::memory_order_relaxed);
+}
+
+//==============================================================================
+std::size_t Trace::sample_interval()
+{
+  return sample_every.load(std::memory_order_relaxed);
+}
+
+//==============================================================================
+namespace {
+bool sampled()
+{
+  const std::size_t every = sample_every.load(std::memory_order_relaxed);
+  if (every <= 1)
+    return true;
+
+  // Each thread keeps its own count so that sampling never contends
+  thread_local std::size_t count = 0;
+  return ++count % every == 0;
+}
+} // anonymous namespace
+
+//==============================================================================
+ScopedTrace::ScopedTrace(const char* category)
+: _category(Trace::active() && sampled() ? category : nullptr)
+{
+  if (_category)
+    _start = std::chrono::steady_clock::now();
+}
+
+//==============================================================================
+ScopedTrace::~ScopedTrace()
+{
+  if (!_category)
+    return;
+
+  const auto finish = std::chrono::steady_clock::now();
+  const auto sink = Trace::get_sink();
+  if (!sink)
+    return;
+
+  sink->record({_category, _start, finish, this_thread_number()});
+}
+
+//==============================================================================
+CallbackTraceSink::CallbackTraceSink(Callback callback)
+: _callback(std::move(callback))
+{
+  // Do nothing
+}
+
+//==============================================================================
+void CallbackTraceSink::record(const TraceSpan& span)
+{
+  if (_callback)
+    _callback(span);
+}
+
+//==============================================================================
+class ChromeTraceSink::Implementation
+{
+public:
+  mutable std::mutex mutex;
+  std::vector<TraceSpan> spans;
+};
+
+//==============================================================================
+ChromeTraceSink::ChromeTraceSink()
+: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+{
+  // Do nothing
+}
+
+//==============================================================================
+void ChromeTraceSink::record(const TraceSpan& span)
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->spans.push_back(span);
+}
+
+//==============================================================================
+void ChromeTraceSink::write(std::ostream& output) const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  output << "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto& span : _pimpl->spans)
+  {
+    if (!first)
+      output << ",";
+
+    first = false;
+    output << "\n{\"name\":\"";
+    write_escaped(output, span.category);
+    output << "\",\"cat\":\"rmf_traffic\",\"ph\":\"X\",\"pid\":0"
+           << ",\"tid\":" << span.thread
+           << ",\"ts\":" << to_microseconds(span.start.time_since_epoch())
+           << ",\"dur\":" << to_microseconds(span.finish - span.start)
+           << "}";
+  }
+  output << "\n]}\n";
+}
+
+//==============================================================================
+std::size_t ChromeTraceSink::size() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->spans.size();
+}
+
+//==============================================================================
+void ChromeTraceSink::clear()
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->spans.clear();
+}
+
+//==============================================================================
+class CounterTraceSink::Implementation
+{
+public:
+  mutable std::mutex mutex;
+
+  // Categories are string literals, so their addresses can be used as keys
+  // without allocating a string for every span.
+  std::unordered_map<const char*, Counter> counters;
+};
+
+//==============================================================================
+CounterTraceSink::CounterTraceSink()
+: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+{
+  // Do nothing
+}
+
+//==============================================================================
+void CounterTraceSink::record(const TraceSpan& span)
+{
+  const Duration elapsed = span.finish - span.start;
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  auto& counter = _pimpl->counters[span.category];
+  ++counter.count;
+  counter.total += elapsed;
+  counter.max = std::max(counter.max, elapsed);
+}
+
+//==============================================================================
+auto CounterTraceSink::counters() const -> Counters
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  Counters output;
+  for (const auto& [category, counter] : _pimpl->counters)
+  {
+    // The same category may come from more than one copy of its literal
+    auto& merged = output[category];
+    merged.count += counter.count;
+    merged.total += counter.total;
+    merged.max = std::max(merged.max, counter.max);
+  }
+
+  return output;
+}
+
+//==============================================================================
+void CounterTraceSink::reset()
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  _pimpl->counters.clear();
+}
+
+} // namespace debug
+} // namespace rmf_traffic
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__DEBUG__INTERNAL_TRACE_HPP
+#define SRC__RMF_TRAFFIC__DEBUG__INTERNAL_TRACE_HPP
+
+#include <rmf_traffic/debug/Trace.hpp>
+
+#define RMF_TRAFFIC__TRACE_CONCAT_IMPL(A, B) A ## B
+#define RMF_TRAFFIC__TRACE_CONCAT(A, B) RMF_TRAFFIC__TRACE_CONCAT_IMPL(A, B)
+
+//==============================================================================
+/// Trace the rest of the enclosing scope as a span of the given category. This
+/// compiles to nothing unless RMF_TRAFFIC__ENABLE_TRACING is defined.
+#ifdef RMF_TRAFFIC__ENABLE_TRACING
+#define RMF_TRAFFIC_TRACE(category) \
+  const ::rmf_traffic::debug::ScopedTrace \
+  RMF_TRAFFIC__TRACE_CONCAT(_rmf_traffic_trace_, __LINE__)(category)
+#else
+#define RMF_TRAFFIC_TRACE(category) static_cast<void>(0)
+#endif
+
+#endif // SRC__RMF_TRAFFIC__DEBUG__INTERNAL_TRACE_HPP
@@ -113,7 +113,9 @@ FinalShape Box::finalize() const
     + this->get_y_length() * this->get_y_length());
   return FinalShape::Implementation::make_final_shape(
     rmf_utils::make_derived_impl<const Shape, const Box>(*this),
-    _get_internal()->make_fcl(), characteristic_length,
+    intern_collisions(
+      typeid(Box), {get_x_length(), get_y_length()}, *_get_internal()),
+    characteristic_length,
     make_equality_comparator(*this));
 }
 
@@ -125,7 +127,9 @@ FinalConvexShape Box::finalize_convex() const
     + this->get_y_length() * this->get_y_length());
   return FinalConvexShape::Implementation::make_final_shape(
     rmf_utils::make_derived_impl<const Shape, const Box>(*this),
-    _get_internal()->make_fcl(), characteristic_length,
+    intern_collisions(
+      typeid(Box), {get_x_length(), get_y_length()}, *_get_internal()),
+    characteristic_length,
     make_equality_comparator(*this));
 }
 
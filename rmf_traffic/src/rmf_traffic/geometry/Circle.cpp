@@ -92,7 +92,8 @@ FinalShape Circle::finalize() const
 {
   return FinalShape::Implementation::make_final_shape(
     rmf_utils::make_derived_impl<const Shape, const Circle>(*this),
-    _get_internal()->make_fcl(), this->get_radius(),
+    intern_collisions(typeid(Circle), {get_radius()}, *_get_internal()),
+    this->get_radius(),
     make_equality_comparator(*this));
 }
 
@@ -101,7 +102,8 @@ FinalConvexShape Circle::finalize_convex() const
 {
   return FinalConvexShape::Implementation::make_final_shape(
     rmf_utils::make_derived_impl<const Shape, const Circle>(*this),
-    _get_internal()->make_fcl(), this->get_radius(),
+    intern_collisions(typeid(Circle), {get_radius()}, *_get_internal()),
+    this->get_radius(),
     make_equality_comparator(*this));
 }
 
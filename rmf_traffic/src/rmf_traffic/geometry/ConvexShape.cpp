@@ -19,6 +19,9 @@
 
 #include "ShapeInternal.hpp"
 
+#include <mutex>
+#include <unordered_map>
+
 namespace rmf_traffic {
 namespace geometry {
 
@@ -35,5 +38,40 @@ FinalConvexShape::FinalConvexShape()
   // Do nothing
 }
 
+//==============================================================================
+ConstFinalConvexShapePtr intern_final_convex(const FinalConvexShape& shape)
+{
+  const auto& collisions = FinalShape::Implementation::get_collisions(shape);
+  if (collisions.empty())
+    return std::make_shared<FinalConvexShape>(shape);
+
+  // Equal shapes share their collision geometry, so the geometry can be used
+  // to find the shape that was interned for them.
+  static std::mutex mutex;
+  static std::unordered_map<
+    const void*, std::weak_ptr<const FinalConvexShape>> interned;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& entry = interned[collisions.front().get()];
+  if (auto existing = entry.lock())
+    return existing;
+
+  auto output = std::make_shared<const FinalConvexShape>(shape);
+  entry = output;
+
+  if (interned.size() >= 64 && interned.size() % 64 == 0)
+  {
+    for (auto it = interned.begin(); it != interned.end(); )
+    {
+      if (it->second.expired())
+        it = interned.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  return output;
+}
+
 } // namespace geometry
 } // namespace rmf_traffic
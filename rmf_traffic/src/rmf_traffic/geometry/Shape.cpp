@@ -19,9 +19,99 @@
 
 #include "ShapeInternal.hpp"
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+
 namespace rmf_traffic {
 namespace geometry {
 
+namespace {
+//==============================================================================
+class CollisionRegistry
+{
+public:
+
+  using Key = std::pair<std::type_index, std::vector<double>>;
+  using Entry = std::vector<std::weak_ptr<CollisionGeometryPtr::element_type>>;
+
+  static CollisionRegistry& get()
+  {
+    static CollisionRegistry registry;
+    return registry;
+  }
+
+  CollisionGeometries find_or_make(
+    Key key,
+    const Shape::Internal& internal)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = _entries.find(key);
+    if (it != _entries.end())
+    {
+      CollisionGeometries output;
+      output.reserve(it->second.size());
+      for (const auto& weak : it->second)
+      {
+        auto geometry = weak.lock();
+        if (!geometry)
+          break;
+
+        output.emplace_back(std::move(geometry));
+      }
+
+      if (output.size() == it->second.size())
+        return output;
+    }
+
+    CollisionGeometries output = internal.make_fcl();
+    Entry& entry = _entries[std::move(key)];
+    entry.assign(output.begin(), output.end());
+
+    if (_entries.size() >= _prune_at)
+    {
+      prune();
+      _prune_at = std::max<std::size_t>(64, 2*_entries.size());
+    }
+
+    return output;
+  }
+
+private:
+
+  /// Remove the entries of shapes that are no longer alive
+  void prune()
+  {
+    for (auto it = _entries.begin(); it != _entries.end(); )
+    {
+      const bool expired = std::any_of(
+        it->second.begin(), it->second.end(),
+        [](const auto& weak) { return weak.expired(); });
+
+      if (expired)
+        it = _entries.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  std::mutex _mutex;
+  std::map<Key, Entry> _entries;
+  std::size_t _prune_at = 64;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+CollisionGeometries intern_collisions(
+  std::type_index type,
+  std::vector<double> parameters,
+  const Shape::Internal& internal)
+{
+  return CollisionRegistry::get().find_or_make(
+    {type, std::move(parameters)}, internal);
+}
+
 //==============================================================================
 Shape::Internal* Shape::_get_internal()
 {
@@ -69,6 +159,12 @@ FinalShape::FinalShape()
 //==============================================================================
 bool FinalShape::operator==(const FinalShape& other) const
 {
+  // Shapes share their FCL geometries when they have the same type and
+  // parameters, so matching geometries mean that the shapes are equal.
+  const auto& collisions = _pimpl->_collisions;
+  if (!collisions.empty() && collisions == other._pimpl->_collisions)
+    return true;
+
   return _pimpl->_compare_equality(*(other._pimpl->_shape));
 }
 
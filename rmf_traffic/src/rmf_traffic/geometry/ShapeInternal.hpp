@@ -27,7 +27,10 @@
 #include <fcl/collision_object.h>
 #endif
 
+#include <Eigen/Geometry>
+
 #include <functional>
+#include <typeindex>
 #include <vector>
 
 namespace rmf_traffic {
@@ -40,6 +43,15 @@ using CollisionGeometryPtr = std::shared_ptr<fcl::CollisionGeometry>;
 #endif
 using CollisionGeometries = std::vector<CollisionGeometryPtr>;
 
+//==============================================================================
+/// A circle in the frame of a shape that contains one of its collision
+/// geometries, no matter how the shape is rotated
+struct CollisionBounds
+{
+  Eigen::Vector2d center;
+  double radius;
+};
+
 //==============================================================================
 /// \brief Implementations of this class must be created by the child classes of
 /// Shape, and then passed to the constructor of Shape.
@@ -53,6 +65,26 @@ public:
 
 };
 
+//==============================================================================
+/// Get the FCL geometries of a shape. Shapes of the same type with the same
+/// parameters will share their geometries for as long as any of them is
+/// alive, so finalizing the same shape many times does not create many copies
+/// of the same geometry. This is safe to call from any thread.
+///
+/// \param[in] type
+///   The type of the shape
+///
+/// \param[in] parameters
+///   All the values that determine the geometry of the shape
+///
+/// \param[in] internal
+///   The internal of the shape, which will be used to make the geometries if
+///   no live shape has the same type and parameters
+CollisionGeometries intern_collisions(
+  std::type_index type,
+  std::vector<double> parameters,
+  const Shape::Internal& internal);
+
 //==============================================================================
 class FinalShape::Implementation
 {
@@ -66,23 +98,36 @@ public:
 
   std::function<bool(const Shape& other)> _compare_equality;
 
+  /// The bounds of each collision geometry, in the same order as the
+  /// geometries. Shapes with only one geometry can leave this empty, and the
+  /// characteristic length will be used to bound them instead.
+  std::vector<CollisionBounds> _bounds;
+
   static const CollisionGeometries& get_collisions(const FinalShape& shape)
   {
     return shape._pimpl->_collisions;
   }
 
+  static const std::vector<CollisionBounds>& get_bounds(
+    const FinalShape& shape)
+  {
+    return shape._pimpl->_bounds;
+  }
+
   static FinalShape make_final_shape(
     rmf_utils::impl_ptr<const Shape> shape,
     CollisionGeometries collisions,
     double characteristic_length,
-    std::function<bool(const Shape& other)> compare_equality)
+    std::function<bool(const Shape& other)> compare_equality,
+    std::vector<CollisionBounds> bounds = {})
   {
     FinalShape result;
     result._pimpl = rmf_utils::make_impl<Implementation>(
       Implementation{std::move(shape),
         std::move(collisions),
         std::move(characteristic_length),
-        std::move(compare_equality)});
+        std::move(compare_equality),
+        std::move(bounds)});
     return result;
   }
 
@@ -109,7 +154,8 @@ public:
       FinalShape::Implementation{std::move(shape),
         std::move(collisions),
         characteristic_length,
-        std::move(compare_equality)});
+        std::move(compare_equality),
+        {}});
     return result;
   }
 };
@@ -26,6 +26,10 @@
 #include <fcl/shape/geometric_shapes.h>
 #endif
 
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <optional>
 #include <sstream>
 
 namespace rmf_traffic {
@@ -123,6 +127,12 @@ bool compute_intersection(
   return true;
 }
 
+//==============================================================================
+double cross_product_2D(const Eigen::Vector2d& v0, const Eigen::Vector2d& v1)
+{
+  return v0[0]*v1[1] - v0[1]*v1[0];
+}
+
 //==============================================================================
 using Triangle = std::array<std::size_t, 3>;
 
@@ -134,36 +144,6 @@ struct AliasVertex
 };
 using Subpolygon = std::vector<AliasVertex>;
 
-//==============================================================================
-bool is_polygon_ear(
-  const Subpolygon& polygon,
-  const Triangle& triangle)
-{
-  using EdgeInfo = SimplePolygon::EdgeInfo;
-
-  const std::size_t a0 = triangle[0];
-  const std::size_t a1 = triangle[2]; // yes, [2] is intended
-  const EdgeInfo edge_a =
-    EdgeInfo{{a0, a1}, {polygon[a0].point, polygon[a1].point}};
-
-  for (std::size_t b0 = 0; b0 < polygon.size(); ++b0)
-  {
-    const std::size_t b1 = (b0 == polygon.size()-1) ? 0 : b0+1;
-
-    // Ignore any edges that are in contact with the edge we care about.
-    if (b0 == a0 || b0 == a1 || b1 == a0 || b1 == a1)
-      continue;
-
-    const EdgeInfo edge_b =
-      EdgeInfo{{b0, b1}, {polygon[b0].point, polygon[b1].point}};
-
-    if (compute_intersection(edge_a, edge_b))
-      return false;
-  }
-
-  return true;
-}
-
 //==============================================================================
 std::size_t find_deepest_reflex_point(
   const Subpolygon& polygon,
@@ -176,11 +156,13 @@ std::size_t find_deepest_reflex_point(
   const Eigen::Vector2d p_preceding = polygon[triangle[0]].point;
   const Eigen::Vector2d p_successive = polygon[triangle[2]].point;
 
-  const Eigen::Matrix2d M_inv = [&]()
+  // The lambda must return a matrix rather than the inverse expression, which
+  // would refer to a local variable that is gone once the lambda returns.
+  const Eigen::Matrix2d M_inv = [&]() -> Eigen::Matrix2d
     {
       Eigen::Matrix2d output;
       output.block<2, 1>(0, 0) = p_preceding - p_pivot;
-      output.block<2, 1>(0, 0) = p_successive - p_pivot;
+      output.block<2, 1>(0, 1) = p_successive - p_pivot;
       return output.inverse();
     } ();
 
@@ -250,6 +232,36 @@ std::array<Subpolygon, 2> split_subpolygon(
   return output;
 }
 
+//==============================================================================
+/// Rotate the vertices of a subpolygon so that the vertex before its last one
+/// is convex. A triangle around a reflex vertex would be outside of the
+/// subpolygon, so it can never be snipped off or split.
+void rotate_convex_vertex_to_pivot(Subpolygon& polygon)
+{
+  const std::size_t N = polygon.size();
+  double area = 0.0;
+  for (std::size_t i = 0; i < N; ++i)
+    area += cross_product_2D(polygon[i].point, polygon[(i+1) % N].point);
+
+  // Every simple polygon has at least one convex vertex
+  for (std::size_t k = 0; k < N; ++k)
+  {
+    const Eigen::Vector2d& p_preceding = polygon[(k + N - 1) % N].point;
+    const Eigen::Vector2d& p_pivot = polygon[k].point;
+    const Eigen::Vector2d& p_successive = polygon[(k+1) % N].point;
+    const double turn = cross_product_2D(
+      p_pivot - p_preceding, p_successive - p_pivot);
+    if (turn * area > 0.0)
+    {
+      std::rotate(
+        polygon.begin(),
+        polygon.begin() + static_cast<std::ptrdiff_t>((k+2) % N),
+        polygon.end());
+      return;
+    }
+  }
+}
+
 //==============================================================================
 Triangle get_original_indices(
   const Subpolygon& polygon,
@@ -307,32 +319,31 @@ std::vector<Triangle> decompose_polygon(
       throw InvalidSimplePolygonException(N);
     }
 
+    rotate_convex_vertex_to_pivot(next_polygon);
     const std::size_t pivot_point = N-2;
     const Triangle next_triangle = {pivot_point-1, pivot_point, pivot_point+1};
-    if (is_polygon_ear(next_polygon, next_triangle))
+
+    // The pivot is convex, so the triangle is an ear unless some other vertex
+    // of the polygon is inside of it. Otherwise we find the deepest of those
+    // reflex points, and then slice the polygon along the line that joins the
+    // deepest reflex point to the triangle's pivot point.
+    const std::size_t reflex_point =
+      find_deepest_reflex_point(next_polygon, next_triangle);
+
+    if (reflex_point == static_cast<std::size_t>(-1))
     {
-      // If the triangle is an ear (not intersected by any other lines of the
-      // polygon), then we can just snip it off.
+      // If the triangle is an ear (no other vertices of the polygon are inside
+      // of it), then we can just snip it off.
       triangles.push_back(get_original_indices(next_polygon, next_triangle));
 
-      // Removing the last two vertices will snip off the ear while leaving the
-      // remaining polygon untouched.
-      next_polygon.resize(N-2);
+      // Removing the pivot will snip off the ear while leaving the remaining
+      // polygon untouched.
+      next_polygon.erase(
+        next_polygon.begin() + static_cast<std::ptrdiff_t>(pivot_point));
       subpolygon_queue.emplace_back(std::move(next_polygon));
       continue;
     }
 
-    // If the polgyon is not an ear, we should find its deepest reflex point,
-    // and then slice the polygon along the line that joins the deepest reflex
-    // point to the triangle's pivot point.
-
-    // NOTE(MXG): It might be possible to improve performance here by
-    // remembering which line segments crossed the diagonal during the
-    // computation of is_polygon_ear(~) and using that to narrow down which
-    // vertices to look at when computing the deepest reflext point.
-    const std::size_t reflex_point =
-      find_deepest_reflex_point(next_polygon, next_triangle);
-
     const auto new_subpolygons = split_subpolygon(
       next_polygon, {pivot_point, reflex_point});
 
@@ -343,12 +354,6 @@ std::vector<Triangle> decompose_polygon(
   return triangles;
 }
 
-//==============================================================================
-double cross_product_2D(const Eigen::Vector2d& v0, const Eigen::Vector2d& v1)
-{
-  return v0[0]*v1[1] - v0[1]*v1[0];
-}
-
 //==============================================================================
 bool is_polygon_convex(const std::vector<Eigen::Vector2d>& polygon)
 {
@@ -375,9 +380,123 @@ bool is_polygon_convex(const std::vector<Eigen::Vector2d>& polygon)
     e_previous = ei;
   }
 
+  // The turn from the last edge back onto the first edge needs to match too
+  return (cross_product_2D(e_previous, e0) > 0.0) == must_be_ccw;
+}
+
+//==============================================================================
+/// The indices of the polygon vertices that make up one convex piece of it, in
+/// counter-clockwise order
+using ConvexPiece = std::vector<std::size_t>;
+
+//==============================================================================
+bool is_piece_convex(
+  const std::vector<Eigen::Vector2d>& polygon,
+  const ConvexPiece& piece)
+{
+  // The piece is counter-clockwise, so every turn needs to be a left turn or
+  // a straight line.
+  const std::size_t N = piece.size();
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    const Eigen::Vector2d& p0 = polygon[piece[i]];
+    const Eigen::Vector2d& p1 = polygon[piece[(i+1) % N]];
+    const Eigen::Vector2d& p2 = polygon[piece[(i+2) % N]];
+    if (cross_product_2D(p1 - p0, p2 - p1) < -1e-12)
+      return false;
+  }
+
   return true;
 }
 
+//==============================================================================
+/// Join two pieces if they share an edge and their union is still convex
+std::optional<ConvexPiece> try_join_pieces(
+  const std::vector<Eigen::Vector2d>& polygon,
+  const ConvexPiece& a,
+  const ConvexPiece& b)
+{
+  for (std::size_t edge_a = 0; edge_a < a.size(); ++edge_a)
+  {
+    const std::size_t i = a[edge_a];
+    const std::size_t j = a[(edge_a+1) % a.size()];
+    for (std::size_t edge_b = 0; edge_b < b.size(); ++edge_b)
+    {
+      // Both pieces are counter-clockwise, so a shared edge runs in opposite
+      // directions for each of them.
+      if (b[edge_b] != j || b[(edge_b+1) % b.size()] != i)
+        continue;
+
+      // Walk all the way around piece a, starting from j and ending at i. Then
+      // walk the rest of the way around piece b, which brings us back to j.
+      ConvexPiece joined;
+      joined.reserve(a.size() + b.size() - 2);
+      for (std::size_t k = 1; k <= a.size(); ++k)
+        joined.push_back(a[(edge_a + k) % a.size()]);
+
+      for (std::size_t k = 2; k < b.size(); ++k)
+        joined.push_back(b[(edge_b + k) % b.size()]);
+
+      if (is_piece_convex(polygon, joined))
+        return joined;
+
+      return std::nullopt;
+    }
+  }
+
+  return std::nullopt;
+}
+
+//==============================================================================
+/// Decompose a simple polygon into convex pieces. The polygon is triangulated,
+/// and then neighboring triangles are joined for as long as they stay convex,
+/// so that collision checks against the polygon need fewer narrowphase calls.
+std::vector<ConvexPiece> decompose_into_convex_pieces(
+  const std::vector<Eigen::Vector2d>& polygon)
+{
+  if (is_polygon_convex(polygon))
+  {
+    ConvexPiece piece(polygon.size());
+    std::iota(piece.begin(), piece.end(), 0);
+    return {piece};
+  }
+
+  std::vector<ConvexPiece> pieces;
+  for (const Triangle& triangle : decompose_polygon(polygon))
+  {
+    ConvexPiece piece(triangle.begin(), triangle.end());
+    const Eigen::Vector2d& p0 = polygon[piece[0]];
+    const Eigen::Vector2d& p1 = polygon[piece[1]];
+    const Eigen::Vector2d& p2 = polygon[piece[2]];
+    if (cross_product_2D(p1 - p0, p2 - p1) < 0.0)
+      std::swap(piece[1], piece[2]);
+
+    pieces.emplace_back(std::move(piece));
+  }
+
+  for (std::size_t a = 0; a < pieces.size(); ++a)
+  {
+    std::size_t b = a+1;
+    while (b < pieces.size())
+    {
+      if (auto joined = try_join_pieces(polygon, pieces[a], pieces[b]))
+      {
+        pieces[a] = std::move(*joined);
+        pieces.erase(pieces.begin() + static_cast<std::ptrdiff_t>(b));
+
+        // The new piece has new edges, so the pieces that it was already
+        // checked against might be joinable now.
+        b = a+1;
+        continue;
+      }
+
+      ++b;
+    }
+  }
+
+  return pieces;
+}
+
 #ifdef RMF_TRAFFIC__USING_FCL_0_6
 using FclConvexType = fcl::Convexd;
 #else
@@ -429,35 +548,6 @@ public:
 
 };
 
-//==============================================================================
-std::shared_ptr<FclConvexType> make_convex(
-  const std::vector<Eigen::Vector2d>& polygon)
-{
-  return ConvexWrapper::make(polygon);
-}
-
-//==============================================================================
-std::vector<std::shared_ptr<FclConvexType>> make_triangulation(
-  const std::vector<Eigen::Vector2d>& polygon)
-{
-  const std::vector<Triangle> triangles = decompose_polygon(polygon);
-
-  std::vector<std::shared_ptr<FclConvexType>> triangulation;
-
-  std::vector<Eigen::Vector2d> points;
-  points.reserve(3);
-  for (const Triangle& triangle : triangles)
-  {
-    points.clear();
-    for (const std::size_t index : triangle)
-      points.push_back(polygon[index]);
-
-    triangulation.push_back(ConvexWrapper::make(points));
-  }
-
-  return triangulation;
-}
-
 } // anonymous namespace
 
 //==============================================================================
@@ -565,24 +655,62 @@ public:
     // *INDENT-ON*
   }
 
-  CollisionGeometries make_fcl() const final
+  std::vector<ConvexPiece> make_pieces() const
   {
     except_on_invalid_polygon();
+    return decompose_into_convex_pieces(_points);
+  }
 
+  CollisionGeometries make_geometries(
+    const std::vector<ConvexPiece>& pieces) const
+  {
     CollisionGeometries shapes;
-    if (is_polygon_convex(_points))
+    shapes.reserve(pieces.size());
+
+    std::vector<Eigen::Vector2d> points;
+    for (const ConvexPiece& piece : pieces)
     {
-      shapes.push_back(make_convex(_points));
+      points.clear();
+      for (const std::size_t index : piece)
+        points.push_back(_points[index]);
+
+      shapes.push_back(ConvexWrapper::make(points));
     }
-    else
+
+    return shapes;
+  }
+
+  /// Bound each piece with a circle around the center of its axis-aligned
+  /// bounding box
+  std::vector<CollisionBounds> make_bounds(
+    const std::vector<ConvexPiece>& pieces) const
+  {
+    std::vector<CollisionBounds> bounds;
+    bounds.reserve(pieces.size());
+    for (const ConvexPiece& piece : pieces)
     {
-      const auto triangles = make_triangulation(_points);
-      shapes.reserve(triangles.size());
-      for (auto&& triangle : triangles)
-        shapes.push_back(std::move(triangle));
+      Eigen::Vector2d min = _points[piece.front()];
+      Eigen::Vector2d max = min;
+      for (const std::size_t index : piece)
+      {
+        min = min.cwiseMin(_points[index]);
+        max = max.cwiseMax(_points[index]);
+      }
+
+      const Eigen::Vector2d center = (min + max)/2.0;
+      double radius = 0.0;
+      for (const std::size_t index : piece)
+        radius = std::max(radius, (_points[index] - center).norm());
+
+      bounds.push_back({center, radius});
     }
 
-    return shapes;
+    return bounds;
+  }
+
+  CollisionGeometries make_fcl() const final
+  {
+    return make_geometries(make_pieces());
   }
 
   std::vector<Eigen::Vector2d> _points;
@@ -688,10 +816,18 @@ FinalShape SimplePolygon::finalize() const
     if (distance > characteristic_length)
       characteristic_length = distance;
   }
+
+  // The decomposition is computed once here and then kept by the final shape
+  // along with the bounds of each piece.
+  const auto& internal =
+    static_cast<const SimplePolygonInternal&>(*_get_internal());
+  const auto pieces = internal.make_pieces();
+
   return FinalShape::Implementation::make_final_shape(
     rmf_utils::make_derived_impl<const Shape, const SimplePolygon>(*this),
-    _get_internal()->make_fcl(), characteristic_length,
-    make_equality_comparator(*this));
+    internal.make_geometries(pieces), characteristic_length,
+    make_equality_comparator(*this),
+    internal.make_bounds(pieces));
 }
 
 //==============================================================================
@@ -31,8 +31,11 @@ namespace rmf_traffic {
 namespace geometry {
 
 // TODO(MXG): This header has been moved out of the public API because our
-// collision detection does not properly support it yet. This should be moved
-// back to the public API once the support is available.
+// collision detection does not properly support it yet. Finalized polygons are
+// decomposed into convex pieces, which lets them be used as the shapes of
+// region queries, but they cannot be used as footprints or vicinities of a
+// Profile, since those need to be convex. This should be moved back to the
+// public API once the support is available.
 
 //==============================================================================
 /// \brief The SimplePolygon class represent a simple polygon. A polygon is
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__INTERNAL_MAPNAME_HPP
+#define SRC__RMF_TRAFFIC__INTERNAL_MAPNAME_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace rmf_traffic {
+
+//==============================================================================
+/// A map name that has been interned in a registry that is shared by the whole
+/// process. Copying, comparing and hashing a MapName only touches its integer
+/// ID, so routes and regions can be matched up by map without hashing or
+/// allocating strings.
+///
+/// The registry only ever grows, so the string of a MapName stays valid for as
+/// long as the process runs. The number of distinct map names in a deployment
+/// is small, so this does not need to be bounded.
+class MapName
+{
+public:
+
+  using Id = uint32_t;
+
+  /// The empty map name
+  MapName();
+
+  /// Intern a map name, or find it if it was interned before
+  MapName(const std::string& name);
+
+  /// Find the ID of a map name without interning it. If the name has never
+  /// been interned, then nothing can be on that map, and this returns a
+  /// nullopt.
+  static std::optional<Id> find(const std::string& name);
+
+  /// Get the string of a map name from its ID. The ID must have come from an
+  /// interned map name.
+  static const std::string& str(Id id);
+
+  /// Get the ID of this map name
+  Id id() const
+  {
+    return _id;
+  }
+
+  /// Get the string of this map name
+  const std::string& str() const
+  {
+    return *_name;
+  }
+
+  bool operator==(const MapName& other) const
+  {
+    return _id == other._id;
+  }
+
+  bool operator!=(const MapName& other) const
+  {
+    return _id != other._id;
+  }
+
+private:
+  Id _id;
+  const std::string* _name;
+};
+
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__INTERNAL_MAPNAME_HPP
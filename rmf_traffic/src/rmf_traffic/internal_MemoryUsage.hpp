@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__INTERNAL_MEMORYUSAGE_HPP
+#define SRC__RMF_TRAFFIC__INTERNAL_MEMORYUSAGE_HPP
+
+#include <cstddef>
+
+namespace rmf_traffic {
+namespace internal {
+
+// These give the sizes of the allocations that the standard containers make
+// for what they currently hold. The node layouts are the ones used by the
+// common standard libraries: a tree node has a colour and three links in front
+// of its value, and a hash node has a link and a cached hash next to its value.
+
+//==============================================================================
+/// The bytes of one node of a std::map or std::set
+template<typename Value>
+constexpr std::size_t tree_node_bytes()
+{
+  return 4*sizeof(void*) + sizeof(Value);
+}
+
+//==============================================================================
+/// The bytes of one node of a std::unordered_map or std::unordered_set
+template<typename Value>
+constexpr std::size_t hash_node_bytes()
+{
+  return 2*sizeof(void*) + sizeof(Value);
+}
+
+//==============================================================================
+/// The bytes of an object that was made by std::make_shared or
+/// std::allocate_shared, which puts the control block in the same allocation
+template<typename T>
+constexpr std::size_t shared_object_bytes()
+{
+  return 2*sizeof(void*) + sizeof(T);
+}
+
+//==============================================================================
+/// The bytes of the nodes of a std::map or std::set
+template<typename Container>
+std::size_t tree_bytes(const Container& container)
+{
+  return container.size()
+    * tree_node_bytes<typename Container::value_type>();
+}
+
+//==============================================================================
+/// The bytes of the nodes and bucket array of a std::unordered_map or
+/// std::unordered_set
+template<typename Container>
+std::size_t hash_table_bytes(const Container& container)
+{
+  return container.bucket_count()*sizeof(void*)
+    + container.size()*hash_node_bytes<typename Container::value_type>();
+}
+
+//==============================================================================
+/// The bytes of the buffer of a std::vector
+template<typename Container>
+std::size_t vector_bytes(const Container& container)
+{
+  return container.capacity()*sizeof(typename Container::value_type);
+}
+
+} // namespace internal
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__INTERNAL_MEMORYUSAGE_HPP
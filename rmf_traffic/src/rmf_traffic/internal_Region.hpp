@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__INTERNAL_REGION_HPP
+#define SRC__RMF_TRAFFIC__INTERNAL_REGION_HPP
+
+#include <rmf_traffic/Region.hpp>
+
+#include "internal_MapName.hpp"
+#include "detail/internal_bidirectional_iterator.hpp"
+
+#include <rmf_utils/optional.hpp>
+
+namespace rmf_traffic {
+
+//==============================================================================
+class Region::IterImpl
+{
+public:
+
+  std::vector<geometry::Space>::iterator iter;
+
+};
+
+//==============================================================================
+class Region::Implementation
+{
+public:
+
+  // The map is interned so that it can be matched against the maps of routes
+  // without comparing strings.
+  MapName map;
+  rmf_utils::optional<Time> lower_bound;
+  rmf_utils::optional<Time> upper_bound;
+
+  using Spaces = std::vector<geometry::Space>;
+  Spaces spaces;
+
+  using raw_iterator = Spaces::iterator;
+  static iterator make_iterator(raw_iterator it)
+  {
+    iterator result;
+    result._pimpl = rmf_utils::make_impl<iterator::Implementation>(
+      iterator::Implementation{it});
+    return result;
+  }
+
+  static const MapName& get_map(const Region& region)
+  {
+    return region._pimpl->map;
+  }
+
+};
+
+using RegionData = Region::Implementation;
+
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__INTERNAL_REGION_HPP
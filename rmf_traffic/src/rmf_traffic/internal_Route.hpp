@@ -20,6 +20,12 @@
 
 #include <rmf_traffic/Route.hpp>
 
+#include "internal_MapName.hpp"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
 namespace rmf_traffic {
 
 //==============================================================================
@@ -27,15 +33,212 @@ class Route::Implementation
 {
 public:
 
-  std::string map;
-  Trajectory trajectory;
+  // The map is interned so that routes can be copied and matched up by map
+  // without copying or comparing strings.
+  MapName map;
+
+  // The trajectory is shared between copies of a route until one of them asks
+  // for mutable access to it, so routes can be passed from participants to the
+  // database and on to mirrors without copying their trajectories.
+  std::shared_ptr<Trajectory> trajectory;
+
+  // This is set once a mutable reference to the trajectory has been handed
+  // out. The holder of that reference could modify the trajectory at any
+  // time, so copies of this route can no longer share it.
+  bool exposed = false;
+
+  // A delay that has been added to the route but not applied to the waypoints
+  // of the trajectory yet. Delays are applied lazily so that delaying a route
+  // does not need to copy or rewrite its trajectory.
+  Duration delay = Duration(0);
+
+  // The trajectory with the pending delay applied. This is created the first
+  // time it is needed after a delay is added. It is only read and written
+  // through the std::atomic_* overloads so that concurrent const access is
+  // safe.
+  mutable std::shared_ptr<const Trajectory> delayed;
+
   std::set<uint64_t> checkpoints;
   DependsOnParticipant dependencies;
 
+  Implementation(const std::string& map_, Trajectory trajectory_)
+  : map(map_),
+    trajectory(std::make_shared<Trajectory>(std::move(trajectory_)))
+  {
+    // Do nothing
+  }
+
+  Implementation(const Implementation& other)
+  : map(other.map),
+    trajectory(other.share_trajectory()),
+    delay(other.delay),
+    delayed(std::atomic_load(&other.delayed)),
+    checkpoints(other.checkpoints),
+    dependencies(other.dependencies)
+  {
+    // Do nothing
+  }
+
+  Implementation& operator=(const Implementation& other)
+  {
+    map = other.map;
+    trajectory = other.share_trajectory();
+    exposed = false;
+    delay = other.delay;
+    std::atomic_store(&delayed, std::atomic_load(&other.delayed));
+    checkpoints = other.checkpoints;
+    dependencies = other.dependencies;
+    return *this;
+  }
+
+  std::shared_ptr<Trajectory> share_trajectory() const
+  {
+    if (exposed)
+      return std::make_shared<Trajectory>(*trajectory);
+
+    return trajectory;
+  }
+
+  Trajectory& mutable_trajectory()
+  {
+    if (delay != Duration(0))
+    {
+      // The pending delay needs to be applied before anyone can modify the
+      // trajectory.
+      if (const auto current = std::atomic_load(&delayed))
+      {
+        trajectory = std::make_shared<Trajectory>(*current);
+      }
+      else
+      {
+        if (trajectory.use_count() > 1)
+          trajectory = std::make_shared<Trajectory>(*trajectory);
+
+        trajectory->front().adjust_times(delay);
+      }
+
+      delay = Duration(0);
+      std::atomic_store(&delayed, std::shared_ptr<const Trajectory>());
+    }
+    else if (!exposed && trajectory.use_count() > 1)
+    {
+      // If anything else might still be sharing this trajectory, we need to
+      // make our own copy before it can be modified.
+      trajectory = std::make_shared<Trajectory>(*trajectory);
+    }
+
+    exposed = true;
+    return *trajectory;
+  }
+
+  /// Get the trajectory with any pending delay applied
+  const Trajectory& view_trajectory() const
+  {
+    if (delay == Duration(0))
+      return *trajectory;
+
+    std::shared_ptr<const Trajectory> current = std::atomic_load(&delayed);
+    if (current)
+      return *current;
+
+    auto computed = std::make_shared<Trajectory>(*trajectory);
+    computed->front().adjust_times(delay);
+
+    // If another thread finished first, we use its result so that every
+    // reader gets a reference to the same trajectory.
+    if (std::atomic_compare_exchange_strong(
+        &delayed, &current, std::shared_ptr<const Trajectory>(computed)))
+    {
+      return *computed;
+    }
+
+    return *current;
+  }
+
+  /// Delay the route. Unless a mutable reference to the trajectory has been
+  /// handed out, this does not touch the waypoints of the trajectory.
+  void add_delay(const Duration duration)
+  {
+    if (trajectory->empty())
+      return;
+
+    if (exposed)
+    {
+      // Someone may be holding a reference to the trajectory, so they need to
+      // see the change right away.
+      trajectory->front().adjust_times(duration);
+      return;
+    }
+
+    delay += duration;
+    std::atomic_store(&delayed, std::shared_ptr<const Trajectory>());
+  }
+
+  /// Get the number of waypoints without applying any pending delay
+  std::size_t size() const
+  {
+    return trajectory->size();
+  }
+
+  /// Get the start time of the trajectory without applying the pending delay
+  /// to its waypoints
+  std::optional<Time> start_time() const
+  {
+    if (const Time* const start = trajectory->start_time())
+      return *start + delay;
+
+    return std::nullopt;
+  }
+
+  /// Get the finish time of the trajectory without applying the pending delay
+  /// to its waypoints
+  std::optional<Time> finish_time() const
+  {
+    if (const Time* const finish = trajectory->finish_time())
+      return *finish + delay;
+
+    return std::nullopt;
+  }
+
+  /// Forget that a mutable reference to the trajectory of the route was ever
+  /// handed out, so that copies of the route can share its trajectory again.
+  /// This should only be used after the route has been handed over to a new
+  /// owner that nothing else can hold a reference into.
+  static void take_ownership(Route& route)
+  {
+    route._pimpl->exposed = false;
+  }
+
+  /// Delay a route without rewriting its trajectory
+  static void delay_route(Route& route, const Duration duration)
+  {
+    route._pimpl->add_delay(duration);
+  }
+
   static const Route::Implementation& get(const Route& route)
   {
     return *route._pimpl;
   }
+
+  /// Check whether two routes are on the same map by comparing the IDs of
+  /// their interned map names
+  static bool same_map(const Route& a, const Route& b)
+  {
+    return a._pimpl->map == b._pimpl->map;
+  }
+
+  /// Hash the content of a route: its map, waypoints, checkpoints and
+  /// dependencies. Routes with the same content have the same hash, whether
+  /// or not their pending delays have been applied to their waypoints.
+  static std::size_t hash(const Route& route);
+
+  /// Check whether two routes have the same content
+  static bool same_content(const Route& a, const Route& b);
+
+  /// Get the number of bytes that a route is holding, including its
+  /// trajectory. A trajectory that is shared between copies of a route is
+  /// counted for each of them.
+  static std::size_t memory_usage(const Route& route);
 };
 
 using RouteData = Route::Implementation;
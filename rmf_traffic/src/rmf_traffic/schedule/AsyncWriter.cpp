@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/AsyncWriter.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+class AsyncWriter::Implementation
+{
+public:
+
+  using Job = std::function<void(Writer&)>;
+
+  Implementation(std::shared_ptr<Writer> writer, const std::size_t capacity)
+  : _writer(std::move(writer)),
+    _capacity(std::max<std::size_t>(capacity, 1))
+  {
+    _thread = std::thread([this]() { _dispatch(); });
+  }
+
+  ~Implementation()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _quit = true;
+    }
+    _work_cv.notify_all();
+    _thread.join();
+  }
+
+  /// Add a job to the back of the queue, waiting for room if the queue is full
+  void post(Job job)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_queue.size() >= _capacity)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      _space_cv.wait(lock, [&]() { return _queue.size() < _capacity; });
+      const auto finish = std::chrono::steady_clock::now();
+      ++_statistics.blocked;
+      _statistics.total_blocked_time += finish - start;
+    }
+
+    _queue.push_back({std::move(job), std::chrono::steady_clock::now()});
+    ++_posted;
+    _statistics.peak_queued =
+      std::max(_statistics.peak_queued, _queue.size());
+
+    lock.unlock();
+    _work_cv.notify_one();
+  }
+
+  void flush()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    const uint64_t target = _posted;
+    _done_cv.wait(lock, [&]() { return target <= _finished; });
+  }
+
+  std::size_t queued() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _queue.size();
+  }
+
+  Statistics statistics() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _statistics;
+  }
+
+  std::shared_ptr<Writer> _writer;
+  std::size_t _capacity;
+
+private:
+
+  struct Entry
+  {
+    Job job;
+    Time posted;
+  };
+
+  void _dispatch()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+      _work_cv.wait(lock, [&]() { return _quit || !_queue.empty(); });
+
+      // Every change that was posted before the writer was destroyed gets
+      // delivered before the thread stops.
+      if (_queue.empty())
+        return;
+
+      Entry entry = std::move(_queue.front());
+      _queue.pop_front();
+      lock.unlock();
+      _space_cv.notify_one();
+
+      const auto start = std::chrono::steady_clock::now();
+      bool failed = false;
+      try
+      {
+        entry.job(*_writer);
+      }
+      catch (...)
+      {
+        failed = true;
+      }
+
+      const Duration delay = start - entry.posted;
+
+      lock.lock();
+      if (failed)
+        ++_statistics.failed;
+      else
+        ++_statistics.delivered;
+
+      _statistics.total_queue_delay += delay;
+      _statistics.max_queue_delay =
+        std::max(_statistics.max_queue_delay, delay);
+
+      ++_finished;
+      _done_cv.notify_all();
+    }
+  }
+
+  mutable std::mutex _mutex;
+  std::condition_variable _work_cv;
+  std::condition_variable _space_cv;
+  std::condition_variable _done_cv;
+  std::deque<Entry> _queue;
+  uint64_t _posted = 0;
+  uint64_t _finished = 0;
+  bool _quit = false;
+  Statistics _statistics;
+
+  // The thread is declared last so that everything it uses has been
+  // constructed before it starts.
+  std::thread _thread;
+};
+
+//==============================================================================
+std::shared_ptr<AsyncWriter> AsyncWriter::make(
+  std::shared_ptr<Writer> writer,
+  const std::size_t capacity)
+{
+  if (!writer)
+  {
+    throw std::runtime_error(
+            "[rmf_traffic::schedule::AsyncWriter::make] A nullptr was given "
+            "for the `writer` argument. This is illegal.");
+  }
+
+  std::shared_ptr<AsyncWriter> async_writer(new AsyncWriter);
+  async_writer->_pimpl =
+    rmf_utils::make_unique_impl<Implementation>(std::move(writer), capacity);
+
+  return async_writer;
+}
+
+//==============================================================================
+void AsyncWriter::set(
+  const ParticipantId participant,
+  const PlanId plan,
+  const Itinerary& itinerary,
+  const StorageId storage_base,
+  const ItineraryVersion version)
+{
+  _pimpl->post(
+    [participant, plan, itinerary, storage_base, version](Writer& w)
+    {
+      w.set(participant, plan, itinerary, storage_base, version);
+    });
+}
+
+//==============================================================================
+void AsyncWriter::extend(
+  const ParticipantId participant,
+  const Itinerary& routes,
+  const ItineraryVersion version)
+{
+  _pimpl->post(
+    [participant, routes, version](Writer& w)
+    {
+      w.extend(participant, routes, version);
+    });
+}
+
+//==============================================================================
+void AsyncWriter::delay(
+  const ParticipantId participant,
+  const Duration delay,
+  const ItineraryVersion version)
+{
+  _pimpl->post(
+    [participant, delay, version](Writer& w)
+    {
+      w.delay(participant, delay, version);
+    });
+}
+
+//==============================================================================
+void AsyncWriter::reached(
+  const ParticipantId participant,
+  const PlanId plan,
+  const std::vector<CheckpointId>& reached_checkpoints,
+  const ProgressVersion version)
+{
+  _pimpl->post(
+    [participant, plan, reached_checkpoints, version](Writer& w)
+    {
+      w.reached(participant, plan, reached_checkpoints, version);
+    });
+}
+
+//==============================================================================
+void AsyncWriter::clear(
+  const ParticipantId participant,
+  const ItineraryVersion version)
+{
+  _pimpl->post(
+    [participant, version](Writer& w)
+    {
+      w.clear(participant, version);
+    });
+}
+
+//==============================================================================
+auto AsyncWriter::register_participant(
+  ParticipantDescription participant_info) -> Registration
+{
+  // The registration goes through the queue like every other change so that
+  // it is delivered after the changes that came before it.
+  std::promise<Registration> promise;
+  auto future = promise.get_future();
+  _pimpl->post(
+    [&promise, info = std::move(participant_info)](Writer& w)
+    {
+      try
+      {
+        promise.set_value(w.register_participant(info));
+      }
+      catch (...)
+      {
+        promise.set_exception(std::current_exception());
+      }
+    });
+
+  return future.get();
+}
+
+//==============================================================================
+void AsyncWriter::unregister_participant(const ParticipantId participant)
+{
+  _pimpl->post(
+    [participant](Writer& w)
+    {
+      w.unregister_participant(participant);
+    });
+}
+
+//==============================================================================
+void AsyncWriter::update_description(
+  const ParticipantId participant,
+  ParticipantDescription desc)
+{
+  _pimpl->post(
+    [participant, desc = std::move(desc)](Writer& w)
+    {
+      w.update_description(participant, desc);
+    });
+}
+
+//==============================================================================
+void AsyncWriter::flush()
+{
+  _pimpl->flush();
+}
+
+//==============================================================================
+std::size_t AsyncWriter::queued() const
+{
+  return _pimpl->queued();
+}
+
+//==============================================================================
+std::size_t AsyncWriter::capacity() const
+{
+  return _pimpl->_capacity;
+}
+
+//==============================================================================
+const std::shared_ptr<Writer>& AsyncWriter::inner() const
+{
+  return _pimpl->_writer;
+}
+
+//==============================================================================
+auto AsyncWriter::statistics() const -> Statistics
+{
+  return _pimpl->statistics();
+}
+
+//==============================================================================
+AsyncWriter::AsyncWriter()
+{
+  // Do nothing
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
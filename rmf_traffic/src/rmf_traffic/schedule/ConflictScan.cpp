@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/ConflictScan.hpp>
+
+#include "../ProfileInternal.hpp"
+#include "../TrajectoryInternal.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace rmf_traffic {
+namespace schedule {
+
+namespace {
+//==============================================================================
+/// A route of the view along with what the sweep needs to know about it
+struct SweepEntry
+{
+  const Viewer::View::Element* element;
+  Time start;
+  Time finish;
+
+  /// The box that contains the route, grown by the farthest reach of the
+  /// shapes of its profile
+  internal::BoundingBox bounds;
+};
+
+//==============================================================================
+bool overlap(const internal::BoundingBox& a, const internal::BoundingBox& b)
+{
+  for (int i = 0; i < 2; ++i)
+  {
+    if (a.max[i] < b.min[i] || b.max[i] < a.min[i])
+      return false;
+  }
+
+  return true;
+}
+
+//==============================================================================
+/// Minimum number of candidate pairs that each thread should be given, so that
+/// small scans do not pay for launching threads.
+const std::size_t MinPairsPerThread = 16;
+
+} // anonymous namespace
+
+//==============================================================================
+ConflictScan::Options::Options(
+  const std::size_t max_threads_,
+  DetectConflict::Options detection_)
+: max_threads(max_threads_),
+  detection(std::move(detection_))
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto ConflictScan::between_all(
+  const Viewer::View& view,
+  const Options& options) -> std::vector<Conflict>
+{
+  std::vector<SweepEntry> entries;
+  entries.reserve(view.size());
+  for (const auto& element : view)
+  {
+    const Trajectory& trajectory = element.route->trajectory();
+    if (trajectory.size() < 2)
+      continue;
+
+    const auto& plan =
+      Profile::Implementation::get(element.description.profile()).plan;
+    const double reach = std::max(plan.footprint_radius, plan.vicinity_radius);
+
+    internal::BoundingBox bounds =
+      internal::get_segment_cache(trajectory)->total_bounds;
+    bounds.min -= Eigen::Vector2d(reach, reach);
+    bounds.max += Eigen::Vector2d(reach, reach);
+
+    entries.push_back(
+      SweepEntry{
+        &element,
+        *trajectory.start_time(),
+        *trajectory.finish_time(),
+        bounds
+      });
+  }
+
+  // Sweep through the routes of each map in order of their start times
+  std::sort(
+    entries.begin(), entries.end(),
+    [](const SweepEntry& lhs, const SweepEntry& rhs)
+    {
+      const auto& lhs_map = lhs.element->route->map();
+      const auto& rhs_map = rhs.element->route->map();
+      if (lhs_map != rhs_map)
+        return lhs_map < rhs_map;
+
+      if (lhs.start != rhs.start)
+        return lhs.start < rhs.start;
+
+      return lhs.element->participant < rhs.element->participant;
+    });
+
+  // The candidate pairs are found in order of the start time of the second
+  // route, and the first route of each pair always starts first.
+  std::vector<std::pair<std::size_t, std::size_t>> pairs;
+  std::vector<std::size_t> active;
+  for (std::size_t i = 0; i < entries.size(); ++i)
+  {
+    const auto& entry = entries[i];
+    if (i > 0
+      && entries[i-1].element->route->map() != entry.element->route->map())
+    {
+      active.clear();
+    }
+
+    // Routes that finished before this one started cannot overlap with it or
+    // with any route that comes after it.
+    active.erase(
+      std::remove_if(
+        active.begin(), active.end(),
+        [&](const std::size_t j)
+        {
+          return entries[j].finish < entry.start;
+        }),
+      active.end());
+
+    for (const std::size_t j : active)
+    {
+      const auto& other = entries[j];
+      if (other.element->participant == entry.element->participant)
+        continue;
+
+      if (!overlap(other.bounds, entry.bounds))
+        continue;
+
+      pairs.emplace_back(j, i);
+    }
+
+    active.push_back(i);
+  }
+
+  std::sort(pairs.begin(), pairs.end());
+
+  // Each pair gets its own slot so that the final result does not depend on
+  // the order that the threads happen to finish in.
+  const std::size_t N = pairs.size();
+  std::vector<std::optional<DetectConflict::Conflict>> results(N);
+  std::vector<std::exception_ptr> errors(N);
+  std::atomic_size_t next = 0;
+
+  const auto work = [&]()
+    {
+      for (std::size_t k = next++; k < N; k = next++)
+      {
+        const auto& a = *entries[pairs[k].first].element;
+        const auto& b = *entries[pairs[k].second].element;
+        try
+        {
+          results[k] = DetectConflict::between(
+            a.description.profile(),
+            a.route->trajectory(),
+            a.route->check_dependencies(b.participant, b.plan_id, b.route_id),
+            b.description.profile(),
+            b.route->trajectory(),
+            b.route->check_dependencies(a.participant, a.plan_id, a.route_id),
+            options.detection);
+        }
+        catch (...)
+        {
+          errors[k] = std::current_exception();
+        }
+      }
+    };
+
+  const std::size_t num_threads =
+    std::min(options.max_threads, N / MinPairsPerThread);
+
+  if (num_threads <= 1)
+  {
+    work();
+  }
+  else
+  {
+    // Each call keeps taking pairs until there are none left
+    const auto& executor =
+      options.executor ? options.executor : Executor::shared();
+    executor->run(num_threads, [&](std::size_t) { work(); }, num_threads);
+  }
+
+  std::vector<Conflict> output;
+  for (std::size_t k = 0; k < N; ++k)
+  {
+    if (errors[k])
+      std::rethrow_exception(errors[k]);
+
+    if (!results[k])
+      continue;
+
+    const auto& a = *entries[pairs[k].first].element;
+    const auto& b = *entries[pairs[k].second].element;
+    output.push_back(
+      Conflict{
+        Party{a.participant, a.plan_id, a.route_id, a.route},
+        Party{b.participant, b.plan_id, b.route_id, b.route},
+        *results[k]
+      });
+  }
+
+  return output;
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
@@ -22,21 +22,223 @@
 #include "debug_Database.hpp"
 #include "internal_Snapshot.hpp"
 #include "internal_Database.hpp"
+#include "internal_Itinerary.hpp"
+#include "internal_Query.hpp"
+#include "internal_ParticipantDescription.hpp"
+#include "internal_ParticipantTable.hpp"
+#include "internal_Concurrency.hpp"
 
 #include "../detail/internal_bidirectional_iterator.hpp"
 #include "internal_Progress.hpp"
 #include "internal_Viewer.hpp"
 #include "DependencyTracker.hpp"
+#include "internal_PatchCodec.hpp"
+#include "internal_QueryCache.hpp"
+#include "../debug/internal_Trace.hpp"
+#include "../internal_MapName.hpp"
+#include "../internal_MemoryUsage.hpp"
 
 #include <rmf_utils/Modular.hpp>
 
 #include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
 #include <list>
 #include <deque>
+#include <memory_resource>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace rmf_traffic {
 namespace schedule {
 
+namespace {
+//==============================================================================
+/// Check whether an entry is relevant to any part of a query spacetime. This
+/// gives the same result as the relevance checks of the timeline, except it
+/// does not need to know which bucket the entry was found in.
+bool is_relevant(
+  const Query::Spacetime& spacetime,
+  const BaseRouteEntry& entry)
+{
+  const Query::Spacetime::Mode mode = spacetime.get_mode();
+  if (Query::Spacetime::Mode::All == mode)
+    return true;
+
+  const Route& route = *entry.route;
+  const Trajectory& trajectory = route.trajectory();
+  if (!trajectory.start_time())
+    return false;
+
+  if (Query::Spacetime::Mode::Timespan == mode)
+  {
+    const auto& timespan = *spacetime.timespan();
+    if (!timespan.all_maps() && timespan.maps().count(route.map()) == 0)
+      return false;
+
+    const Time* const lower_time_bound = timespan.get_lower_time_bound();
+    const Time* const upper_time_bound = timespan.get_upper_time_bound();
+    if (lower_time_bound && *trajectory.finish_time() < *lower_time_bound)
+      return false;
+
+    if (upper_time_bound && *upper_time_bound < *trajectory.start_time())
+      return false;
+
+    return true;
+  }
+
+  if (Query::Spacetime::Mode::Corridor == mode)
+  {
+    const CorridorFilter filter(*spacetime.corridor());
+    if (filter.map() != route.map())
+      return false;
+
+    return filter.relevant(entry.description->profile(), trajectory);
+  }
+
+  rmf_traffic::internal::Spacetime spacetime_data;
+  for (const Region& region : *spacetime.regions())
+  {
+    if (RegionData::get_map(region) != RouteData::get(route).map)
+      continue;
+
+    spacetime_data.lower_time_bound = region.get_lower_time_bound();
+    spacetime_data.upper_time_bound = region.get_upper_time_bound();
+    for (auto space_it = region.begin(); space_it != region.end(); ++space_it)
+    {
+      spacetime_data.set_space(space_it->get_pose(), space_it->get_shape());
+
+      if (rmf_traffic::internal::detect_conflicts(
+          entry.description->profile(), trajectory, spacetime_data))
+        return true;
+    }
+  }
+
+  return false;
+}
+
+//==============================================================================
+/// Get a callback that passes the changes which were held back by the
+/// inconsistency tracker of a participant into the database once they are
+/// ready.
+InconsistencyTracker::Apply deferred_applier(
+  Database& database,
+  const ParticipantId participant)
+{
+  return [&database, participant](
+    const InconsistencyTracker::DeferredChange& change,
+    const ItineraryVersion version)
+    {
+      using Type = InconsistencyTracker::DeferredChange::Type;
+      switch (change.type)
+      {
+        case Type::Set:
+          database.set(
+            participant, change.plan, change.itinerary,
+            change.storage_base, version);
+          return;
+        case Type::Extend:
+          database.extend(participant, change.itinerary, version);
+          return;
+        case Type::Delay:
+          database.delay(participant, change.delay, version);
+          return;
+        case Type::Clear:
+          database.clear(participant, version);
+          return;
+      }
+    };
+}
+} // anonymous namespace
+
+//==============================================================================
+/// Releases the memory of culled routes on a background thread. Each batch is
+/// released in order from front to back.
+class CullReclaimer
+{
+public:
+
+  using Batch = std::vector<std::shared_ptr<void>>;
+
+  CullReclaimer()
+  : _thread([this]() { run(); })
+  {
+    // Do nothing
+  }
+
+  ~CullReclaimer()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _quit = true;
+    }
+
+    _cv.notify_all();
+    _thread.join();
+  }
+
+  void reclaim(Batch batch)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _batches.emplace_back(std::move(batch));
+    }
+
+    _cv.notify_one();
+  }
+
+private:
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+      _cv.wait(lock, [this]() { return _quit || !_batches.empty(); });
+
+      // Finish any remaining batches before quitting
+      if (_batches.empty())
+        return;
+
+      Batch batch = std::move(_batches.front());
+      _batches.pop_front();
+
+      lock.unlock();
+      for (auto& item : batch)
+        item.reset();
+      lock.lock();
+    }
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  std::deque<Batch> _batches;
+  bool _quit = false;
+  std::thread _thread;
+};
+
+//==============================================================================
+/// Destroys an object and returns its memory to the pool it was allocated from
+template<typename T>
+struct PoolDeleter
+{
+  std::pmr::memory_resource* pool = nullptr;
+
+  void operator()(const T* object) const
+  {
+    object->~T();
+    pool->deallocate(const_cast<T*>(object), sizeof(T), alignof(T));
+  }
+};
+
 //==============================================================================
 class RouteStorageException : public std::exception
 {
@@ -49,6 +251,9 @@ public:
   }
 };
 
+//==============================================================================
+class PinnedSnapshot;
+
 //==============================================================================
 class Database::Implementation
 {
@@ -56,9 +261,18 @@ public:
 
   struct ParticipantState;
 
+  // Route entries and their transitions get replaced constantly while the
+  // participants replan, so they are allocated from this pool instead of the
+  // general heap to keep the heap from fragmenting. This needs to be declared
+  // before anything that holds route entries so that it outlives them. It is
+  // synchronized because CullReclaimer may release entries on its own thread.
+  std::pmr::synchronized_pool_resource route_pool;
+
   struct Transition;
-  using TransitionPtr = std::unique_ptr<Transition>;
-  using ConstTransitionPtr = std::unique_ptr<const Transition>;
+
+  using TransitionPtr = std::unique_ptr<Transition, PoolDeleter<Transition>>;
+  using ConstTransitionPtr =
+    std::unique_ptr<const Transition, PoolDeleter<Transition>>;
 
   struct RouteEntry;
   using RouteEntryPtr = std::shared_ptr<RouteEntry>;
@@ -115,6 +329,33 @@ public:
     }
   };
 
+  /// Allocate a route entry from the route pool
+  RouteEntryPtr make_entry(RouteEntry entry)
+  {
+    return std::allocate_shared<RouteEntry>(
+      std::pmr::polymorphic_allocator<RouteEntry>(&route_pool),
+      std::move(entry));
+  }
+
+  /// Allocate a transition from the route pool
+  TransitionPtr make_transition(Transition transition)
+  {
+    void* const memory =
+      route_pool.allocate(sizeof(Transition), alignof(Transition));
+
+    try
+    {
+      return TransitionPtr(
+        new (memory) Transition(std::move(transition)),
+        PoolDeleter<Transition>{&route_pool});
+    }
+    catch (...)
+    {
+      route_pool.deallocate(memory, sizeof(Transition), alignof(Transition));
+      throw;
+    }
+  }
+
   Timeline<RouteEntry> timeline;
 
   using ParticipantStorage = std::unordered_map<RouteId, RouteStorage>;
@@ -134,8 +375,18 @@ public:
     Progress progress = {};
     std::optional<Version> schedule_version_of_progress = std::nullopt;
     ProgressBuffer buffered_progress = {};
+
+    /// The itinerary view that was last handed out by get_itinerary_view().
+    /// Readers fill this in with atomic operations while they hold the read
+    /// lock, and any change to the active routes must reset it.
+    mutable std::shared_ptr<const ItineraryView> itinerary_view = nullptr;
+
+    /// The hash_routes() of the active routes, calculated the first time that
+    /// a set() needs it. An extension folds its new routes into it, and any
+    /// other change to the active routes must reset it.
+    std::optional<std::size_t> itinerary_hash = std::nullopt;
   };
-  using ParticipantStates = std::unordered_map<ParticipantId, ParticipantState>;
+  using ParticipantStates = ParticipantTable<ParticipantState>;
   ParticipantStates states;
 
   // This violates the single-source-of-truth principle, but it helps make it
@@ -203,15 +454,420 @@ public:
   rmf_traffic::Time current_time = rmf_traffic::Time(rmf_traffic::Duration(0));
   rmf_traffic::Duration maximum_cumulative_delay = std::chrono::hours(2);
 
+  /// How long routes are retained after they finish, if the schedule should be
+  /// rolled forward automatically as the current time advances
+  std::optional<rmf_traffic::Duration> retention;
+
+  /// How far the retention window needs to move before the schedule gets
+  /// rolled forward again. This matches the bucket duration of the timeline so
+  /// that each roll can release whole buckets.
+  rmf_traffic::Duration retention_step = TimelineOptions().bucket_duration();
+
+  /// Get the time that the schedule should be culled to, if the retention
+  /// window has moved far enough since the last cull.
+  std::optional<Time> retention_cull_time() const
+  {
+    if (!retention.has_value())
+      return std::nullopt;
+
+    const Time cutoff = current_time - *retention;
+    if (last_cull.has_value()
+      && cutoff < last_cull->cull.time() + retention_step)
+      return std::nullopt;
+
+    return cutoff;
+  }
+
   mutable DependencyTracker dependencies;
 
-  /// This function is used to insert routes into the Database.
+  ConcurrencyControl concurrency;
+
+  /// Make a snapshot of the current state of the database
+  std::shared_ptr<const Snapshot> make_snapshot() const;
+
+  /// Get the bytes of a route entry, its route, and its timeline handle.
+  /// Routes that are in the counted set are skipped, because consecutive
+  /// entries often share a route.
+  static std::size_t entry_memory(
+    const RouteStorage& storage,
+    std::unordered_set<const Route*>& counted);
+
+  /// Get the bytes of the earlier entries that the transitions of an entry
+  /// are keeping alive
+  static std::size_t history_memory(
+    const RouteEntry& entry,
+    std::unordered_set<const Route*>& counted);
+
+  /// Get a report of the memory of the database. The caller must hold the read
+  /// lock or the write lock.
+  MemoryUsage memory_usage() const;
+
+  /// Query the current state of the database. The caller must hold the read
+  /// lock or the write lock.
+  Viewer::View query(
+    const Query::Spacetime& spacetime,
+    const Query::Participants& participants) const;
+
+  /// The pins that are still reading the current state of the database. They
+  /// get frozen before the next change to the database.
+  mutable std::vector<std::weak_ptr<PinnedSnapshot>> live_pins;
+
+  /// Guards live_pins, because pins can be made by concurrent readers
+  mutable std::mutex pins_mutex;
+
+  /// Give every live pin a snapshot of the current state of the database so
+  /// that it stops reading the live state. This must be called with the write
+  /// lock held before anything in the database is changed.
+  void freeze_pins();
+
+  ~Implementation()
+  {
+    freeze_pins();
+  }
+
+  /// True while a Transaction is being applied
+  bool in_transaction = false;
+
+  /// True once the current Transaction has bumped the schedule version
+  bool transaction_bumped_version = false;
+
+  /// A route that was changed by a schedule version
+  struct ChangeRecord
+  {
+    Version version;
+    ParticipantId participant;
+    StorageId storage_id;
+  };
+
+  /// The routes that were changed by recent versions, in order of version
+  std::deque<ChangeRecord> change_log;
+
+  /// How many of the most recent versions are kept in the change log
+  std::size_t change_log_retention = 1024;
+
+  /// How many out of order changes each participant tracker may hold
+  std::size_t out_of_order_limit = InconsistencyTracker::DefaultLimit;
+
+  /// The newest version whose changes have been dropped from the change log
+  std::optional<Version> change_log_horizon;
+
+  /// Recent query results for the current version
+  mutable QueryCache query_cache;
+
+  /// Releases culled routes when background cull reclamation is turned on
+  std::unique_ptr<CullReclaimer> cull_reclaimer;
+
+  /// A query that was registered with Database::subscribe()
+  struct Subscription
+  {
+    SharedQuery query;
+
+    /// The version when the last patch was taken, or nullopt if no patch has
+    /// been taken yet
+    std::optional<Version> synced;
+
+    /// The routes which changed after the synced version in a way that may be
+    /// relevant to the query
+    std::vector<ChangeRecord> pending;
+
+    /// True if too many changes piled up, so the next patch needs to search
+    /// the whole schedule
+    bool overflowed = false;
+  };
+
+  std::unordered_map<Database::SubscriptionId, Subscription> subscriptions;
+
+  /// The subscriptions that share each distinct query
+  std::unordered_map<SharedQuery, std::vector<Database::SubscriptionId>>
+  subscription_groups;
+
+  Database::SubscriptionId next_subscription_id = 0;
+
+  /// Only routes on maps that pass this test are put into the timeline and the
+  /// change log. When this is empty, the routes of every map are indexed.
+  std::function<bool(const std::string& map)> indexed_maps;
+
+  /// Get the map of the route that an entry changed
+  static const std::string& map_of(const RouteEntry& entry)
+  {
+    if (entry.route)
+      return entry.route->map();
+
+    // An erasure keeps the route of its predecessor
+    return entry.transition->predecessor.entry->route->map();
+  }
+
+  bool indexes(const RouteEntry& entry) const
+  {
+    return !indexed_maps || indexed_maps(map_of(entry));
+  }
+
+  /// Put the newest entry of a route into the timeline and the change log,
+  /// unless its map is not indexed by this database.
+  void index(const ParticipantId participant, RouteStorage& entry_storage)
+  {
+    if (!indexes(*entry_storage.entry))
+      return;
+
+    entry_storage.timeline_handle = timeline.insert(entry_storage.entry);
+    log_change(participant, entry_storage.entry->storage_id);
+    notify_subscriptions(participant, *entry_storage.entry);
+  }
+
+  /// Check whether a change to a route may be relevant to a query. It is
+  /// relevant if either the new version of the route or the version that it
+  /// replaced is relevant, because a mirror which knew about the old version
+  /// will need to be told that it was erased.
+  static bool may_be_relevant(
+    const Query& query,
+    const ParticipantId participant,
+    const RouteEntry& entry)
+  {
+    const auto& participants = query.participants();
+    if (const auto* include = participants.include())
+    {
+      if (ParticipantFilter::Include(*include).ignore(participant))
+        return false;
+    }
+    else if (const auto* exclude = participants.exclude())
+    {
+      if (ParticipantFilter::Exclude(*exclude).ignore(participant))
+        return false;
+    }
+
+    if (entry.route && is_relevant(query.spacetime(), entry))
+      return true;
+
+    if (!entry.transition)
+      return false;
+
+    const RouteEntry& predecessor = *entry.transition->predecessor.entry;
+    return predecessor.route && is_relevant(query.spacetime(), predecessor);
+  }
+
+  /// Add a route change to the pending changes of every subscription that it
+  /// may be relevant to
+  void notify_subscriptions(
+    const ParticipantId participant,
+    const RouteEntry& entry)
+  {
+    for (const auto& [query, members] : subscription_groups)
+    {
+      if (!may_be_relevant(*query, participant, entry))
+        continue;
+
+      for (const auto id : members)
+      {
+        Subscription& subscription = subscriptions.at(id);
+        if (!subscription.synced.has_value() || subscription.overflowed)
+          continue;
+
+        if (subscription.pending.size() >= change_log_retention)
+        {
+          subscription.pending.clear();
+          subscription.overflowed = true;
+          continue;
+        }
+
+        subscription.pending.push_back(
+          {schedule_version, participant, entry.storage_id});
+      }
+    }
+  }
+
+  /// Record that a route was changed by the current schedule version
+  void log_change(const ParticipantId participant, const StorageId storage_id)
+  {
+    change_log.push_back({schedule_version, participant, storage_id});
+    trim_change_log();
+  }
+
+  void trim_change_log()
+  {
+    while (!change_log.empty()
+      && schedule_version - change_log.front().version >= change_log_retention)
+    {
+      change_log_horizon = change_log.front().version;
+      change_log.pop_front();
+    }
+  }
+
+  /// Check whether the change log has every change that came after a version
+  bool change_log_covers(const Version after) const
+  {
+    return !change_log_horizon.has_value()
+      || !rmf_utils::modular(after).less_than(*change_log_horizon);
+  }
+
+  /// Inspect the newest entries of the routes in the change log that changed
+  /// after the given version and match the query. Only use this when
+  /// change_log_covers(after) is true.
+  template<typename Inspector>
+  void inspect_changes(
+    const Query& parameters,
+    const Version after,
+    Inspector& inspector) const
+  {
+    const auto& participants = parameters.participants();
+    const Query::Participants::Mode mode = participants.get_mode();
+
+    if (Query::Participants::Mode::All == mode)
+    {
+      inspect_changes(
+        parameters.spacetime(), ParticipantFilter::AllowAll(),
+        after, inspector);
+    }
+    else if (Query::Participants::Mode::Include == mode)
+    {
+      inspect_changes(
+        parameters.spacetime(),
+        ParticipantFilter::Include(*participants.include()),
+        after, inspector);
+    }
+    else if (Query::Participants::Mode::Exclude == mode)
+    {
+      inspect_changes(
+        parameters.spacetime(),
+        ParticipantFilter::Exclude(*participants.exclude()),
+        after, inspector);
+    }
+    else
+    {
+      // *INDENT-OFF*
+      throw std::runtime_error(
+        "Unexpected Query::Participants mode: "
+        + std::to_string(static_cast<uint16_t>(mode)));
+      // *INDENT-ON*
+    }
+  }
+
+  template<typename Inspector, typename ParticipantFilter>
+  void inspect_changes(
+    const Query::Spacetime& spacetime,
+    const ParticipantFilter& participant_filter,
+    const Version after,
+    Inspector& inspector) const
+  {
+    const auto relevant = [&spacetime](const RouteEntry& entry) -> bool
+      {
+        return is_relevant(spacetime, entry);
+      };
+
+    // The log is sorted by version, so we can skip straight to the first
+    // record that came after the requested version.
+    const auto begin = std::partition_point(
+      change_log.begin(), change_log.end(),
+      [after](const ChangeRecord& record)
+      {
+        return !rmf_utils::modular(after).less_than(record.version);
+      });
+
+    VisitedRoutes checked;
+    for (auto it = begin; it != change_log.end(); ++it)
+    {
+      if (participant_filter.ignore(it->participant))
+        continue;
+
+      if (!checked.insert(it->participant, it->storage_id))
+        continue;
+
+      if (const RouteEntry* const entry = find_entry(*it))
+        inspector.inspect(entry, relevant);
+    }
+  }
+
+  /// Inspect the newest entries of the routes that are pending for a
+  /// subscription.
+  template<typename Inspector>
+  void inspect_pending(
+    const Subscription& subscription,
+    Inspector& inspector) const
+  {
+    const Query::Spacetime& spacetime = subscription.query->spacetime();
+    const auto relevant = [&spacetime](const RouteEntry& entry) -> bool
+      {
+        return is_relevant(spacetime, entry);
+      };
+
+    VisitedRoutes checked;
+    for (const ChangeRecord& record : subscription.pending)
+    {
+      if (!checked.insert(record.participant, record.storage_id))
+        continue;
+
+      if (const RouteEntry* const entry = find_entry(record))
+        inspector.inspect(entry, relevant);
+    }
+  }
+
+  /// Find the newest entry of the route that a change record refers to.
+  /// Routes that have been culled or whose participant has been unregistered
+  /// are no longer in the timeline either, so this will return a nullptr for
+  /// them.
+  const RouteEntry* find_entry(const ChangeRecord& record) const
+  {
+    const auto s_it = states.find(record.participant);
+    if (s_it == states.end())
+      return nullptr;
+
+    const auto r_it = s_it->second.storage.find(record.storage_id);
+    if (r_it == s_it->second.storage.end())
+      return nullptr;
+
+    const RouteEntry* const entry = r_it->second.entry.get();
+    if (!entry->description)
+      return nullptr;
+
+    return entry;
+  }
+
+  /// Get the schedule version for an itinerary change that is being accepted.
+  /// Every change within a Transaction shares the same version.
+  Version next_version()
+  {
+    if (in_transaction)
+    {
+      if (!transaction_bumped_version)
+      {
+        ++schedule_version;
+        transaction_bumped_version = true;
+      }
+
+      return schedule_version;
+    }
+
+    return ++schedule_version;
+  }
+
+  /// Fold the content of a route into a hash of routes. Unlike
+  /// hash_itinerary(), this leaves out the number of routes, so the hash of an
+  /// itinerary can be carried forward when routes are appended to it.
+  static void hash_route(std::size_t& seed, const Route& route)
+  {
+    hash_combine(seed, RouteData::hash(route));
+  }
+
+  /// Get the hash_route() fold of every route in an itinerary
+  static std::size_t hash_routes(const Itinerary& itinerary)
+  {
+    std::size_t seed = 0;
+    for (const auto& route : itinerary)
+      hash_route(seed, route);
+
+    return seed;
+  }
+
+  /// This function is used to insert routes into the Database. Only the new
+  /// routes are touched: each one gets a storage entry, a place in the
+  /// timeline and a record in the change log, so extending a long itinerary
+  /// costs the same as extending a short one.
   void insert_items(
     const ParticipantId participant,
     ParticipantState& state,
     const Itinerary& itinerary)
   {
     ParticipantStorage& storage = state.storage;
+    state.itinerary_view = nullptr;
 
     const auto plan_id = state.latest_plan_id;
     const auto initial_route_num = state.active_routes.size();
@@ -223,8 +879,13 @@ public:
 
       state.active_routes.push_back(storage_id);
 
+      // The routes are appended in order, so a hash of the routes that were
+      // already active can be carried forward instead of being recalculated.
+      if (state.itinerary_hash.has_value())
+        hash_route(*state.itinerary_hash, route);
+
       RouteStorage& entry_storage = storage[storage_id];
-      entry_storage.entry = std::make_unique<RouteEntry>(
+      entry_storage.entry = make_entry(
         RouteEntry{
           std::make_shared<Route>(route),
           participant,
@@ -237,7 +898,7 @@ public:
           RouteEntryPtr()
         });
 
-      entry_storage.timeline_handle = timeline.insert(entry_storage.entry);
+      index(participant, entry_storage);
     }
   }
 
@@ -247,6 +908,8 @@ public:
     Duration delay)
   {
     ParticipantStorage& storage = state.storage;
+    state.itinerary_view = nullptr;
+    state.itinerary_hash = std::nullopt;
     state.cumulative_delay += delay;
     if (state.cumulative_delay > maximum_cumulative_delay)
     {
@@ -262,8 +925,7 @@ public:
         auto& entry_storage = s_it->second;
         const auto& route_entry = entry_storage.entry;
         auto new_route = *route_entry->route;
-        if (!new_route.trajectory().empty())
-          new_route.trajectory().front().adjust_times(delay);
+        RouteData::delay_route(new_route, delay);
         refresh_itinerary.push_back(new_route);
       }
 
@@ -282,15 +944,17 @@ public:
       const auto& route_entry = entry_storage.entry;
       const auto route_id = route_entry->route_id;
 
-      const Trajectory& old_trajectory = route_entry->route->trajectory();
-      assert(old_trajectory.start_time());
-      if (old_trajectory.empty())
+      const RouteData& old_route = RouteData::get(*route_entry->route);
+      assert(old_route.start_time());
+      if (old_route.size() == 0)
         continue;
 
+      // The delay is only applied to the waypoints of the new route once
+      // something needs to read them.
       auto new_route = std::make_shared<Route>(*route_entry->route);
-      new_route->trajectory().front().adjust_times(delay);
+      RouteData::delay_route(*new_route, delay);
 
-      auto transition = std::make_unique<Transition>(
+      auto transition = make_transition(
         Transition{
           Change::Delay::Implementation{delay},
           std::move(entry_storage)
@@ -299,7 +963,7 @@ public:
       // NOTE(MXG): The previous contents of entry have been moved into the
       // predecessor field of transition, so we are free to refill entry with
       // the newly created data.
-      entry_storage.entry = std::make_unique<RouteEntry>(
+      entry_storage.entry = make_entry(
         RouteEntry{
           std::move(new_route),
           participant,
@@ -312,10 +976,14 @@ public:
           RouteEntryPtr()
         });
 
-      entry_storage.entry->transition->predecessor.entry->successor =
-        entry_storage.entry;
+      auto& predecessor = entry_storage.entry->transition->predecessor;
+      predecessor.entry->successor = entry_storage.entry;
+
+      // The predecessor stays in the timeline, but it is no longer relevant to
+      // snapshots now that it has a successor.
+      timeline.invalidate_snapshots(predecessor.timeline_handle);
 
-      entry_storage.timeline_handle = timeline.insert(entry_storage.entry);
+      index(participant, entry_storage);
     }
   }
 
@@ -334,13 +1002,13 @@ public:
       auto route = entry_storage.entry->route;
       const auto route_id = entry_storage.entry->route_id;
 
-      auto transition = std::make_unique<Transition>(
+      auto transition = make_transition(
         Transition{
           std::nullopt,
           std::move(entry_storage)
         });
 
-      entry_storage.entry = std::make_unique<RouteEntry>(
+      entry_storage.entry = make_entry(
         RouteEntry{
           std::move(route),
           participant,
@@ -353,20 +1021,61 @@ public:
           RouteEntryPtr()
         });
 
-      entry_storage.entry->transition->predecessor.entry->successor =
-        entry_storage.entry;
+      auto& predecessor = entry_storage.entry->transition->predecessor;
+      predecessor.entry->successor = entry_storage.entry;
 
-      entry_storage.timeline_handle = timeline.insert(entry_storage.entry);
+      // The predecessor stays in the timeline, but it is no longer relevant to
+      // snapshots now that it has a successor.
+      timeline.invalidate_snapshots(predecessor.timeline_handle);
+
+      index(participant, entry_storage);
     }
   }
 
-  void clear(
-    ParticipantId participant,
+  /// Check whether a set() would leave the active routes of a participant
+  /// exactly as they are. That can only be the case for a set() of the plan
+  /// that is already active, since progress and dependencies are tied to the
+  /// plan ID.
+  bool same_itinerary(
     ParticipantState& state,
-    bool clear_progress = true)
+    const PlanId plan,
+    const Itinerary& itinerary) const
   {
-    ParticipantStorage& storage = state.storage;
-    for (const StorageId storage_id : state.active_routes)
+    if (plan != state.latest_plan_id)
+      return false;
+
+    if (itinerary.size() != state.active_routes.size())
+      return false;
+
+    if (!state.itinerary_hash.has_value())
+    {
+      std::size_t seed = 0;
+      for (const auto storage_id : state.active_routes)
+        hash_route(seed, *state.storage.at(storage_id).entry->route);
+
+      state.itinerary_hash = seed;
+    }
+
+    if (*state.itinerary_hash != hash_routes(itinerary))
+      return false;
+
+    for (std::size_t i = 0; i < itinerary.size(); ++i)
+    {
+      const auto& entry = state.storage.at(state.active_routes[i]).entry;
+      if (!RouteData::same_content(itinerary[i], *entry->route))
+        return false;
+    }
+
+    return true;
+  }
+
+  void clear(
+    ParticipantId participant,
+    ParticipantState& state,
+    bool clear_progress = true)
+  {
+    ParticipantStorage& storage = state.storage;
+    for (const StorageId storage_id : state.active_routes)
     {
       const auto s_it = storage.find(storage_id);
       if (s_it == storage.end())
@@ -375,13 +1084,13 @@ public:
       auto& entry_storage = s_it->second;
       const auto& entry = *entry_storage.entry;
 
-      auto transition = std::make_unique<Transition>(
+      auto transition = make_transition(
         Transition{
           rmf_utils::nullopt,
           std::move(entry_storage)
         });
 
-      entry_storage.entry = std::make_unique<RouteEntry>(
+      entry_storage.entry = make_entry(
         RouteEntry{
           nullptr,
           participant,
@@ -394,14 +1103,20 @@ public:
           RouteEntryPtr()
         });
 
-      entry_storage.entry->transition->predecessor.entry->successor =
-        entry_storage.entry;
+      auto& predecessor = entry_storage.entry->transition->predecessor;
+      predecessor.entry->successor = entry_storage.entry;
+
+      // The predecessor stays in the timeline, but it is no longer relevant to
+      // snapshots now that it has a successor.
+      timeline.invalidate_snapshots(predecessor.timeline_handle);
 
-      entry_storage.timeline_handle = timeline.insert(entry_storage.entry);
+      index(participant, entry_storage);
     }
 
     state.cumulative_delay = rmf_traffic::Duration(0);
     state.active_routes.clear();
+    state.itinerary_view = nullptr;
+    state.itinerary_hash = std::nullopt;
     if (clear_progress)
       state.progress.reached_checkpoints.clear();
   }
@@ -453,10 +1168,38 @@ public:
     return *database._pimpl;
   }
 
+  ParticipantId next_participant_id() const
+  {
+    return _next_participant_id;
+  }
+
+  void set_next_participant_id(const ParticipantId id)
+  {
+    _next_participant_id = id;
+  }
+
 private:
   ParticipantId _next_participant_id = 0;
 };
 
+//==============================================================================
+/// Holds the write lock of a database while it is being modified, and makes
+/// sure that the pins which were reading the database stop reading it before
+/// anything changes.
+class DatabaseWriteScope
+{
+public:
+
+  DatabaseWriteScope(Database::Implementation& database)
+  : _scope(database)
+  {
+    database.freeze_pins();
+  }
+
+private:
+  WriteScope<Database::Implementation> _scope;
+};
+
 //==============================================================================
 std::size_t Database::Debug::current_entry_history_count(
   const Database& database)
@@ -509,6 +1252,8 @@ void Database::set(
   const StorageId storage_base,
   const ItineraryVersion version)
 {
+  const DatabaseWriteScope write(*_pimpl);
+
   const auto p_it = _pimpl->states.find(participant);
   if (p_it == _pimpl->states.end())
   {
@@ -530,13 +1275,23 @@ void Database::set(
 
   if (auto ticket = state.tracker->check(version, true))
   {
-    ticket->set([=]() {
-      this->set(participant, plan, itinerary, storage_base, version);
-    });
+    ticket->set(
+      InconsistencyTracker::DeferredChange::make_set(
+        plan, itinerary, storage_base),
+      deferred_applier(*this, participant));
     return;
   }
 
-  ++_pimpl->schedule_version;
+  if (_pimpl->same_itinerary(state, plan, itinerary))
+  {
+    // The participant sent the itinerary that is already active, so nothing
+    // changes in the schedule. Keep the storage IDs in step with the
+    // participant in case it refers to them later.
+    state.next_storage_id = storage_base + itinerary.size();
+    return;
+  }
+
+  _pimpl->next_version();
 
   // Erase the routes that are currently active
   _pimpl->clear(participant, state);
@@ -563,6 +1318,8 @@ void Database::extend(
   const Itinerary& itinerary,
   ItineraryVersion version)
 {
+  const DatabaseWriteScope write(*_pimpl);
+
   const auto p_it = _pimpl->states.find(participant);
   if (p_it == _pimpl->states.end())
   {
@@ -587,12 +1344,14 @@ void Database::extend(
   if (auto ticket = state.tracker->check(version))
   {
     // If we got a ticket from the inconsistency tracker, then pass along a
-    // callback to call this
-    ticket->set([=]() { this->extend(participant, itinerary, version); });
+    // description of this change so it can be applied later
+    ticket->set(
+      InconsistencyTracker::DeferredChange::make_extend(itinerary),
+      deferred_applier(*this, participant));
     return;
   }
 
-  ++_pimpl->schedule_version;
+  _pimpl->next_version();
 
   _pimpl->insert_items(participant, state, itinerary);
 
@@ -607,6 +1366,8 @@ void Database::delay(
   Duration delay,
   ItineraryVersion version)
 {
+  const DatabaseWriteScope write(*_pimpl);
+
   const auto p_it = _pimpl->states.find(participant);
   if (p_it == _pimpl->states.end())
   {
@@ -629,11 +1390,13 @@ void Database::delay(
 
   if (auto ticket = state.tracker->check(version))
   {
-    ticket->set([=]() { this->delay(participant, delay, version); });
+    ticket->set(
+      InconsistencyTracker::DeferredChange::make_delay(delay),
+      deferred_applier(*this, participant));
     return;
   }
 
-  ++_pimpl->schedule_version;
+  _pimpl->next_version();
   _pimpl->apply_delay(participant, state, delay);
 }
 
@@ -644,6 +1407,8 @@ void Database::reached(
   const std::vector<CheckpointId>& reached_checkpoints,
   ProgressVersion version)
 {
+  const DatabaseWriteScope write(*_pimpl);
+
   const auto p_it = _pimpl->states.find(participant);
   if (p_it == _pimpl->states.end())
   {
@@ -670,18 +1435,57 @@ void Database::reached(
   for (std::size_t i = 0; i < reached_checkpoints.size(); ++i)
     state.progress.update(i, reached_checkpoints[i], version);
 
-  state.schedule_version_of_progress = ++_pimpl->schedule_version;
+  state.schedule_version_of_progress = _pimpl->next_version();
 
   // Update relevant dependencies
   _pimpl->dependencies.reached(
     participant, plan, state.progress.reached_checkpoints);
 }
 
+//==============================================================================
+void Database::reached(
+  const ParticipantId participant,
+  const PlanId plan,
+  const RouteId route,
+  const CheckpointId checkpoint,
+  const ProgressVersion version)
+{
+  const DatabaseWriteScope write(*_pimpl);
+
+  const auto p_it = _pimpl->states.find(participant);
+  if (p_it == _pimpl->states.end())
+  {
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "[Database::reached] No participant with ID ["
+      + std::to_string(participant) + "]");
+    // *INDENT-ON*
+  }
+  Implementation::ParticipantState& state = p_it->second;
+
+  if (plan != state.latest_plan_id)
+  {
+    if (rmf_utils::modular(plan).less_than(state.latest_plan_id))
+      return;
+
+    state.buffered_progress.buff(plan, route, checkpoint, version);
+    return;
+  }
+
+  if (!state.progress.update(route, checkpoint, version))
+    return;
+
+  state.schedule_version_of_progress = _pimpl->next_version();
+  _pimpl->dependencies.reached(participant, plan, route, checkpoint);
+}
+
 //==============================================================================
 void Database::clear(
   ParticipantId participant,
   ItineraryVersion version)
 {
+  const DatabaseWriteScope write(*_pimpl);
+
   const auto p_it = _pimpl->states.find(participant);
   if (p_it == _pimpl->states.end())
   {
@@ -704,16 +1508,167 @@ void Database::clear(
 
   if (auto ticket = state.tracker->check(version))
   {
-    ticket->set([=]() { this->clear(participant, version); });
+    ticket->set(
+      InconsistencyTracker::DeferredChange::make_clear(),
+      deferred_applier(*this, participant));
     return;
   }
 
-  ++_pimpl->schedule_version;
+  _pimpl->next_version();
   _pimpl->clear(participant, state);
   _pimpl->dependencies.deprecate_dependencies_before(
     participant, state.latest_plan_id+1);
 }
 
+//==============================================================================
+class Database::Transaction::Implementation
+{
+public:
+
+  std::vector<std::function<void(Database&)>> changes;
+
+};
+
+//==============================================================================
+Database::Transaction::Transaction()
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto Database::Transaction::set(
+  ParticipantId participant,
+  PlanId plan,
+  Itinerary itinerary,
+  StorageId storage_base,
+  ItineraryVersion version) -> Transaction&
+{
+  _pimpl->changes.emplace_back(
+    [=, itinerary = std::move(itinerary)](Database& db)
+    {
+      db.set(participant, plan, itinerary, storage_base, version);
+    });
+
+  return *this;
+}
+
+//==============================================================================
+auto Database::Transaction::extend(
+  ParticipantId participant,
+  Itinerary routes,
+  ItineraryVersion version) -> Transaction&
+{
+  _pimpl->changes.emplace_back(
+    [=, routes = std::move(routes)](Database& db)
+    {
+      db.extend(participant, routes, version);
+    });
+
+  return *this;
+}
+
+//==============================================================================
+auto Database::Transaction::delay(
+  ParticipantId participant,
+  Duration delay,
+  ItineraryVersion version) -> Transaction&
+{
+  _pimpl->changes.emplace_back(
+    [=](Database& db)
+    {
+      db.delay(participant, delay, version);
+    });
+
+  return *this;
+}
+
+//==============================================================================
+auto Database::Transaction::reached(
+  ParticipantId participant,
+  PlanId plan,
+  std::vector<CheckpointId> reached_checkpoints,
+  ProgressVersion version) -> Transaction&
+{
+  _pimpl->changes.emplace_back(
+    [=, reached_checkpoints = std::move(reached_checkpoints)](Database& db)
+    {
+      db.reached(participant, plan, reached_checkpoints, version);
+    });
+
+  return *this;
+}
+
+//==============================================================================
+auto Database::Transaction::reached(
+  ParticipantId participant,
+  PlanId plan,
+  RouteId route,
+  CheckpointId checkpoint,
+  ProgressVersion version) -> Transaction&
+{
+  _pimpl->changes.emplace_back(
+    [=](Database& db)
+    {
+      db.reached(participant, plan, route, checkpoint, version);
+    });
+
+  return *this;
+}
+
+//==============================================================================
+auto Database::Transaction::clear(
+  ParticipantId participant,
+  ItineraryVersion version) -> Transaction&
+{
+  _pimpl->changes.emplace_back(
+    [=](Database& db)
+    {
+      db.clear(participant, version);
+    });
+
+  return *this;
+}
+
+//==============================================================================
+std::size_t Database::Transaction::size() const
+{
+  return _pimpl->changes.size();
+}
+
+//==============================================================================
+Version Database::apply(const Transaction& transaction)
+{
+  // The individual changes will reuse this write scope, so the new state only
+  // gets published once all of them have been applied.
+  const DatabaseWriteScope write(*_pimpl);
+
+  struct TransactionScope
+  {
+    Implementation& impl;
+
+    TransactionScope(Implementation& impl_)
+    : impl(impl_)
+    {
+      impl.in_transaction = true;
+      impl.transaction_bumped_version = false;
+    }
+
+    ~TransactionScope()
+    {
+      impl.in_transaction = false;
+      impl.transaction_bumped_version = false;
+    }
+  };
+
+  const TransactionScope scope(*_pimpl);
+  const DependencyTracker::Batch batch(_pimpl->dependencies);
+  for (const auto& change : transaction._pimpl->changes)
+    change(*this);
+
+  return _pimpl->schedule_version;
+}
+
 //==============================================================================
 Writer::Registration register_participant_impl(
   Database::Implementation& pimpl,
@@ -724,9 +1679,9 @@ Writer::Registration register_participant_impl(
   const Version version = ++pimpl.schedule_version;
   auto tracker = Inconsistencies::Implementation::register_participant(
     pimpl.inconsistencies, id, last_known_version);
+  tracker->set_limit(pimpl.out_of_order_limit);
 
-  const auto description_ptr =
-    std::make_shared<const ParticipantDescription>(std::move(description));
+  const auto description_ptr = intern_description(std::move(description));
 
   const auto p_it = pimpl.states.insert(
     std::make_pair(
@@ -755,6 +1710,8 @@ Writer::Registration register_participant_impl(
 Writer::Registration Database::register_participant(
   ParticipantDescription description)
 {
+  const DatabaseWriteScope write(*_pimpl);
+
   const ParticipantId id = _pimpl->get_next_participant_id();
   return register_participant_impl(
     *_pimpl,
@@ -817,6 +1774,8 @@ void set_participant_state(
   }
 
   state.active_routes.clear();
+  state.itinerary_view = nullptr;
+  state.itinerary_hash = std::nullopt;
   state.latest_plan_id = plan;
   state.next_storage_id = storage_base;
   state.progress.reached_checkpoints = std::move(progress);
@@ -831,7 +1790,7 @@ void set_participant_state(
     state.active_routes.push_back(storage_id);
 
     auto& entry_storage = storage[storage_id];
-    entry_storage.entry = std::make_unique<RouteEntry>(
+    entry_storage.entry = impl.make_entry(
       RouteEntry{
         info.route,
         participant,
@@ -844,7 +1803,8 @@ void set_participant_state(
         RouteEntryPtr()
       });
 
-    entry_storage.timeline_handle = impl.timeline.insert(entry_storage.entry);
+    if (impl.indexes(*entry_storage.entry))
+      entry_storage.timeline_handle = impl.timeline.insert(entry_storage.entry);
   }
 
   std::sort(state.active_routes.begin(), state.active_routes.end());
@@ -863,8 +1823,7 @@ void set_initial_fork_version(
   {
     for (const auto& [_, storage] : state.storage)
     {
-      const auto& route = storage.entry->route;
-      const auto* finish = route->trajectory().finish_time();
+      const auto finish = RouteData::get(*storage.entry->route).finish_time();
       if (finish)
       {
         if (!maximum_time.has_value() || *maximum_time < *finish)
@@ -884,11 +1843,88 @@ void set_initial_fork_version(
   }
 }
 
+//==============================================================================
+void set_indexed_maps(
+  Database& database,
+  std::function<bool(const std::string& map)> indexed_maps)
+{
+  auto& impl = Database::Implementation::get(database);
+  impl.indexed_maps = std::move(indexed_maps);
+}
+
+//==============================================================================
+void set_next_version(Database& database, const Version version)
+{
+  auto& impl = Database::Implementation::get(database);
+  assert(!impl.in_transaction);
+  impl.schedule_version = version - 1;
+}
+
+//==============================================================================
+void copy_participant_state(
+  Database& source,
+  Database& target,
+  const ParticipantId participant,
+  const ItineraryVersion itinerary_version)
+{
+  using RouteEntry = Database::Implementation::RouteEntry;
+  using RouteEntryPtr = Database::Implementation::RouteEntryPtr;
+  const auto& from_impl = Database::Implementation::get(source);
+  auto& to_impl = Database::Implementation::get(target);
+  const auto& from = from_impl.states.at(participant);
+  auto& to = to_impl.states.at(participant);
+
+  if (auto ticket = to.tracker->check(itinerary_version, true))
+  {
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "Inconsistency detected with the itinerary version ["
+      + std::to_string(itinerary_version) + "] of participant ["
+      + std::to_string(participant) + "]");
+    // *INDENT-ON*
+  }
+
+  to_impl.next_version();
+  to_impl.clear(participant, to);
+
+  to.cumulative_delay = from.cumulative_delay;
+  to.latest_plan_id = from.latest_plan_id;
+  to.next_storage_id = from.next_storage_id;
+  to.progress = from.progress;
+  to.buffered_progress = from.buffered_progress;
+  to.schedule_version_of_progress = to_impl.schedule_version;
+
+  for (const StorageId storage_id : from.active_routes)
+  {
+    const auto& entry = *from.storage.at(storage_id).entry;
+    to.active_routes.push_back(storage_id);
+
+    // The routes are immutable, so both databases can share them
+    auto& entry_storage = to.storage[storage_id];
+    entry_storage.entry = to_impl.make_entry(
+      RouteEntry{
+        entry.route,
+        participant,
+        entry.plan_id,
+        entry.route_id,
+        storage_id,
+        to.description,
+        to_impl.schedule_version,
+        nullptr,
+        RouteEntryPtr()
+      });
+
+    to_impl.index(participant, entry_storage);
+  }
+}
+
 //==============================================================================
 void Database::update_description(
   ParticipantId id,
   ParticipantDescription desc)
 {
+  const DatabaseWriteScope write(*_pimpl);
+
   const auto p_it = _pimpl->states.find(id);
   if (p_it == _pimpl->states.end())
   {
@@ -899,8 +1935,12 @@ void Database::update_description(
     // *INDENT-ON*
   }
 
-  const auto description_ptr =
-    std::make_shared<ParticipantDescription>(std::move(desc));
+  // An unchanged description does not need a new schedule version, and does
+  // not need the participant's routes to be reindexed.
+  if (*p_it->second.description == desc)
+    return;
+
+  const auto description_ptr = intern_description(std::move(desc));
 
   auto version = ++_pimpl->schedule_version;
   p_it->second.last_updated = version;
@@ -913,6 +1953,8 @@ void Database::update_description(
 void Database::unregister_participant(
   ParticipantId participant)
 {
+  const DatabaseWriteScope write(*_pimpl);
+
   const auto id_it = _pimpl->participant_ids.find(participant);
   const auto state_it = _pimpl->states.find(participant);
 
@@ -997,7 +2039,7 @@ public:
 
   using RouteEntry = Database::Implementation::RouteEntry;
 
-  std::unordered_map<ParticipantId, ParticipantChanges> changes;
+  ParticipantTable<ParticipantChanges> changes;
 
   const RouteEntry* get_last_known_ancestor(const RouteEntry* from) const
   {
@@ -1114,7 +2156,7 @@ public:
 
   using RouteEntry = Database::Implementation::RouteEntry;
 
-  std::unordered_map<ParticipantId, ParticipantChanges> changes;
+  ParticipantTable<ParticipantChanges> changes;
 
   void inspect(
     const RouteEntry* entry,
@@ -1140,9 +2182,18 @@ class ViewRelevanceInspector
 public:
 
   using RouteEntry = Database::Implementation::RouteEntry;
-  using Storage = Viewer::View::Implementation::Storage;
 
-  std::vector<Storage> routes;
+  Viewer::View::Implementation::Builder routes;
+
+  ViewRelevanceInspector split() const
+  {
+    return ViewRelevanceInspector();
+  }
+
+  void merge(ViewRelevanceInspector&& other)
+  {
+    routes.merge(std::move(other.routes));
+  }
 
   void inspect(
     const RouteEntry* entry,
@@ -1151,14 +2202,7 @@ public:
     entry = get_most_recent(entry);
     if (entry->route && relevant(*entry))
     {
-      routes.emplace_back(
-        Storage{
-          entry->participant,
-          entry->plan_id,
-          entry->route_id,
-          entry->route,
-          entry->description
-        });
+      routes.add(*entry);
     }
   }
 };
@@ -1170,9 +2214,25 @@ class SnapshotViewRelevanceInspector
 {
 public:
 
-  using Storage = Viewer::View::Implementation::Storage;
+  Viewer::View::Implementation::Builder routes;
 
-  std::vector<Storage> routes;
+  SnapshotViewRelevanceInspector(bool pin_descriptions = true)
+  : routes(pin_descriptions)
+  {
+    // Do nothing
+  }
+
+  SnapshotViewRelevanceInspector split() const
+  {
+    SnapshotViewRelevanceInspector output;
+    output.routes = routes.split();
+    return output;
+  }
+
+  void merge(SnapshotViewRelevanceInspector&& other)
+  {
+    routes.merge(std::move(other.routes));
+  }
 
   void inspect(
     const BaseRouteEntry* entry,
@@ -1180,14 +2240,7 @@ public:
   {
     if (relevant(*entry))
     {
-      routes.emplace_back(
-        Storage{
-          entry->participant,
-          entry->plan_id,
-          entry->route_id,
-          entry->route,
-          entry->description
-        });
+      routes.add(*entry);
     }
   }
 
@@ -1200,9 +2253,8 @@ class ViewerAfterRelevanceInspector
 public:
 
   using RouteEntry = Database::Implementation::RouteEntry;
-  using Storage = Viewer::View::Implementation::Storage;
 
-  std::vector<Storage> routes;
+  Viewer::View::Implementation::Builder routes;
 
   const Version after;
 
@@ -1220,14 +2272,7 @@ public:
     if (rmf_utils::modular(after).less_than(entry->schedule_version)
       && entry->route && relevant(*entry))
     {
-      routes.emplace_back(
-        Storage{
-          entry->participant,
-          entry->plan_id,
-          entry->route_id,
-          entry->route,
-          entry->description
-        });
+      routes.add(*entry);
     }
   }
 };
@@ -1266,8 +2311,8 @@ public:
       entry = successor.get();
     }
 
-    assert(entry->route->trajectory().finish_time());
-    if (*entry->route->trajectory().finish_time() < _cull_time)
+    assert(RouteData::get(*entry->route).finish_time());
+    if (*RouteData::get(*entry->route).finish_time() < _cull_time)
     {
       routes.emplace_back(Info{entry->participant, entry->storage_id});
     }
@@ -1277,34 +2322,125 @@ private:
   Time _cull_time;
 };
 
-} // anonymous namespace
-
-//==============================================================================
-Viewer::View Database::query(const Query& parameters) const
-{
-  return query(parameters.spacetime(), parameters.participants());
-}
-
 //==============================================================================
-Viewer::View Database::query(
-  const Query::Spacetime& spacetime,
-  const Query::Participants& participants) const
+/// Put the changes that an inspector found for each participant into a Patch
+Patch make_patch(
+  const Database::Implementation& database,
+  ParticipantTable<ParticipantChanges> changes,
+  const std::optional<Version> after)
 {
-  ViewRelevanceInspector inspector;
-  _pimpl->timeline.inspect(spacetime, participants, inspector);
-  return Viewer::View::Implementation::make_view(std::move(inspector.routes));
-}
+  std::vector<Patch::Participant> part_patches;
+  for (const auto& p : changes)
+  {
+    const auto& changeset = p.second;
+    const auto& state = database.states.at(p.first);
 
-//==============================================================================
-const std::unordered_set<ParticipantId>& Database::participant_ids() const
-{
-  return _pimpl->participant_ids;
-}
+    std::vector<Change::Delay> delays;
+    for (const auto& d : changeset.delays)
+    {
+      delays.emplace_back(
+        Change::Delay{
+          d.second.duration
+        });
+    }
+
+    if (changeset.erasures.empty()
+      && delays.empty()
+      && changeset.additions.empty())
+    {
+      // There aren't actually any changes for this participant, so we will
+      // leave it out of the patch.
+      continue;
+    }
+
+    std::optional<Change::Progress> progress;
+    if (state.schedule_version_of_progress.has_value())
+    {
+      if (!after.has_value() || *after < *state.schedule_version_of_progress)
+      {
+        progress = Change::Progress(
+            state.progress.version,
+            state.progress.reached_checkpoints);
+      }
+    }
+
+    part_patches.emplace_back(
+      Patch::Participant{
+        p.first,
+        state.tracker->last_known_version(),
+        Change::Erase(std::move(p.second.erasures)),
+        std::move(delays),
+        Change::Add(state.latest_plan_id, std::move(p.second.additions)),
+        std::move(progress)
+      });
+  }
+
+  std::optional<Change::Cull> cull;
+  if (database.last_cull && after && *after < database.last_cull->version)
+  {
+    cull = database.last_cull->cull;
+  }
+
+  return Patch(
+    std::move(part_patches),
+    cull,
+    after,
+    database.schedule_version);
+}
+
+} // anonymous namespace
+
+//==============================================================================
+Viewer::View Database::query(const Query& parameters) const
+{
+  return query(parameters.spacetime(), parameters.participants());
+}
+
+//==============================================================================
+Viewer::View Database::query(
+  const Query::Spacetime& spacetime,
+  const Query::Participants& participants) const
+{
+  RMF_TRAFFIC_TRACE("schedule.query");
+  const auto lock = _pimpl->concurrency.read();
+
+  return _pimpl->query(spacetime, participants);
+}
+
+//==============================================================================
+Viewer::View Database::Implementation::query(
+  const Query::Spacetime& spacetime,
+  const Query::Participants& participants) const
+{
+  const auto inspect = [&]()
+    {
+      ViewRelevanceInspector inspector;
+      timeline.inspect(spacetime, participants, inspector);
+      return std::move(inspector.routes).build();
+    };
+
+  // Several changes of a transaction share one version, so results that are
+  // queried in the middle of a transaction cannot be cached.
+  if (in_transaction)
+    return inspect();
+
+  return query_cache.query(spacetime, participants, schedule_version, inspect);
+}
+
+//==============================================================================
+const std::unordered_set<ParticipantId>& Database::participant_ids() const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  return _pimpl->participant_ids;
+}
 
 //==============================================================================
 std::shared_ptr<const ParticipantDescription> Database::get_participant(
   std::size_t participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto state_it = _pimpl->descriptions.find(participant_id);
   if (state_it == _pimpl->descriptions.end())
     return nullptr;
@@ -1315,13 +2451,23 @@ std::shared_ptr<const ParticipantDescription> Database::get_participant(
 //==============================================================================
 Version Database::latest_version() const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   return _pimpl->schedule_version;
 }
 
+//==============================================================================
+std::optional<Version> Database::schedule_version() const
+{
+  return latest_version();
+}
+
 //==============================================================================
 std::optional<ItineraryView> Database::get_itinerary(
   const std::size_t participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto state_it = _pimpl->states.find(participant_id);
   if (state_it == _pimpl->states.end())
     return std::nullopt;
@@ -1343,10 +2489,44 @@ std::optional<ItineraryView> Database::get_itinerary(
   return itinerary;
 }
 
+//==============================================================================
+std::shared_ptr<const ItineraryView> Database::get_itinerary_view(
+  const ParticipantId participant_id) const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  const auto state_it = _pimpl->states.find(participant_id);
+  if (state_it == _pimpl->states.end())
+    return nullptr;
+
+  const Implementation::ParticipantState& state = state_it->second;
+  if (auto view = std::atomic_load(&state.itinerary_view))
+    return view;
+
+  auto itinerary = std::make_shared<ItineraryView>();
+  itinerary->reserve(state.active_routes.size());
+  for (const RouteId route : state.active_routes)
+  {
+    const auto s_it = state.storage.find(route);
+    if (s_it == state.storage.end())
+      throw RouteStorageException();
+
+    itinerary->push_back(s_it->second.entry->route);
+  }
+
+  // If several readers get here at once, they will each store an equivalent
+  // view, so it does not matter which one is kept.
+  std::shared_ptr<const ItineraryView> view = std::move(itinerary);
+  std::atomic_store(&state.itinerary_view, view);
+  return view;
+}
+
 //==============================================================================
 std::optional<PlanId> Database::get_current_plan_id(
   const std::size_t participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto state_it = _pimpl->states.find(participant_id);
   if (state_it == _pimpl->states.end())
     return std::nullopt;
@@ -1359,6 +2539,8 @@ std::optional<PlanId> Database::get_current_plan_id(
 const std::vector<CheckpointId>* Database::get_current_progress(
   ParticipantId participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p = _pimpl->states.find(participant_id);
   if (p == _pimpl->states.end())
     return nullptr;
@@ -1370,6 +2552,8 @@ const std::vector<CheckpointId>* Database::get_current_progress(
 ProgressVersion Database::get_current_progress_version(
   ParticipantId participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p = _pimpl->states.find(participant_id);
   if (p == _pimpl->states.end())
     return 0;
@@ -1383,6 +2567,8 @@ auto Database::watch_dependency(
   std::function<void()> on_reached,
   std::function<void()> on_deprecated) const -> DependencySubscription
 {
+  const auto lock = _pimpl->concurrency.read();
+
   auto subscription = DependencySubscription::Implementation::make(
     dep, std::move(on_reached), std::move(on_deprecated));
 
@@ -1425,6 +2611,16 @@ auto Database::watch_dependency(
 
 //==============================================================================
 std::shared_ptr<const Snapshot> Database::snapshot() const
+{
+  if (auto published = _pimpl->concurrency.published())
+    return published;
+
+  const auto lock = _pimpl->concurrency.read();
+  return _pimpl->make_snapshot();
+}
+
+//==============================================================================
+std::shared_ptr<const Snapshot> Database::Implementation::make_snapshot() const
 {
   using SnapshotType =
     SnapshotImplementation<BaseRouteEntry, SnapshotViewRelevanceInspector>;
@@ -1436,21 +2632,261 @@ std::shared_ptr<const Snapshot> Database::snapshot() const
     };
 
   return std::make_shared<SnapshotType>(
-    _pimpl->timeline.snapshot(check_relevant),
-    _pimpl->participant_ids,
-    _pimpl->descriptions);
+    timeline.snapshot(check_relevant),
+    participant_ids,
+    descriptions,
+    query_cache.get_capacity());
+}
+
+//==============================================================================
+/// A view of the database at the version when it was pinned. It reads the live
+/// state of the database until the database is about to change, and only then
+/// does it get a snapshot to read from instead.
+class PinnedSnapshot : public Snapshot
+{
+public:
+
+  PinnedSnapshot(const Database::Implementation& database)
+  : _database(database),
+    _version(database.schedule_version),
+    _participant_ids(database.participant_ids)
+  {
+    // Do nothing
+  }
+
+  View query(const Query& parameters) const final
+  {
+    return query(parameters.spacetime(), parameters.participants());
+  }
+
+  View query(
+    const Query::Spacetime& spacetime,
+    const Query::Participants& participants) const final
+  {
+    if (const auto frozen = std::atomic_load(&_frozen))
+      return frozen->query(spacetime, participants);
+
+    // Writers freeze the pins while they hold the write lock, so once we have
+    // the read lock, either the pin is frozen or the database is unchanged.
+    const auto lock = _database.concurrency.read();
+    if (const auto frozen = std::atomic_load(&_frozen))
+      return frozen->query(spacetime, participants);
+
+    return _database.query(spacetime, participants);
+  }
+
+  const std::unordered_set<ParticipantId>& participant_ids() const final
+  {
+    return _participant_ids;
+  }
+
+  std::shared_ptr<const ParticipantDescription> get_participant(
+    std::size_t participant_id) const final
+  {
+    if (const auto frozen = std::atomic_load(&_frozen))
+      return frozen->get_participant(participant_id);
+
+    const auto lock = _database.concurrency.read();
+    if (const auto frozen = std::atomic_load(&_frozen))
+      return frozen->get_participant(participant_id);
+
+    const auto it = _database.descriptions.find(participant_id);
+    if (it == _database.descriptions.end())
+      return nullptr;
+
+    return it->second;
+  }
+
+  std::optional<Version> schedule_version() const final
+  {
+    return _version;
+  }
+
+  Version version() const
+  {
+    return _version;
+  }
+
+  bool frozen() const
+  {
+    return std::atomic_load(&_frozen) != nullptr;
+  }
+
+  void freeze(std::shared_ptr<const Snapshot> snapshot) const
+  {
+    std::atomic_store(&_frozen, std::move(snapshot));
+  }
+
+private:
+  const Database::Implementation& _database;
+  const Version _version;
+  const std::unordered_set<ParticipantId> _participant_ids;
+  mutable std::shared_ptr<const Snapshot> _frozen;
+};
+
+//==============================================================================
+std::size_t Database::Implementation::entry_memory(
+  const RouteStorage& storage,
+  std::unordered_set<const Route*>& counted)
+{
+  if (!storage.entry)
+    return 0;
+
+  std::size_t bytes = internal::shared_object_bytes<RouteEntry>()
+    + Timeline<RouteEntry>::handle_memory_usage(storage.timeline_handle);
+
+  const auto& route = storage.entry->route;
+  if (route && counted.insert(route.get()).second)
+  {
+    bytes += internal::shared_object_bytes<Route>()
+      + RouteData::memory_usage(*route);
+  }
+
+  return bytes;
+}
+
+//==============================================================================
+std::size_t Database::Implementation::history_memory(
+  const RouteEntry& entry,
+  std::unordered_set<const Route*>& counted)
+{
+  std::size_t bytes = 0;
+  const Transition* transition = entry.transition.get();
+  while (transition)
+  {
+    bytes += sizeof(Transition)
+      + entry_memory(transition->predecessor, counted);
+
+    const auto& predecessor = transition->predecessor.entry;
+    transition = predecessor ? predecessor->transition.get() : nullptr;
+  }
+
+  return bytes;
+}
+
+//==============================================================================
+MemoryUsage Database::Implementation::memory_usage() const
+{
+  MemoryUsage usage;
+  usage.participants.reserve(participant_ids.size());
+
+  std::unordered_set<const Route*> counted;
+  for (const auto& [participant, state] : states)
+  {
+    counted.clear();
+    auto& memory = usage.participants[participant];
+    memory.routes = sizeof(ParticipantState)
+      + internal::vector_bytes(state.active_routes)
+      + internal::hash_table_bytes(state.storage);
+
+    for (const auto& [_, storage] : state.storage)
+    {
+      memory.routes += entry_memory(storage, counted);
+      if (storage.entry)
+        memory.change_history += history_memory(*storage.entry, counted);
+    }
+
+    if (state.tracker)
+      memory.inconsistencies = state.tracker->memory_usage();
+  }
+
+  for (const auto& [map, bucket_memory] : timeline.map_memory_usage())
+  {
+    auto& memory = usage.maps[MapName::str(map)];
+    memory.buckets = bucket_memory.buckets;
+    memory.bytes = bucket_memory.bytes;
+  }
+
+  usage.shared = sizeof(Implementation)
+    + timeline.shared_memory_usage()
+    + change_log.size()*sizeof(ChangeRecord)
+    + internal::hash_table_bytes(descriptions)
+    + internal::hash_table_bytes(participant_ids)
+    + internal::hash_table_bytes(subscriptions);
+
+  for (const auto& [_, subscription] : subscriptions)
+    usage.shared += internal::vector_bytes(subscription.pending);
+
+  return usage;
+}
+
+//==============================================================================
+void Database::Implementation::freeze_pins()
+{
+  const std::lock_guard<std::mutex> guard(pins_mutex);
+  if (live_pins.empty())
+    return;
+
+  // All the live pins share one snapshot of the version they are pinned at
+  std::shared_ptr<const Snapshot> snapshot;
+  for (const auto& weak : live_pins)
+  {
+    const auto pin = weak.lock();
+    if (!pin || pin->frozen())
+      continue;
+
+    if (!snapshot)
+      snapshot = make_snapshot();
+
+    pin->freeze(snapshot);
+  }
+
+  live_pins.clear();
+}
+
+//==============================================================================
+std::shared_ptr<const Snapshot> Database::pin() const
+{
+  // A snapshot gets published after every write when reads are shared, so it
+  // already shows the current version.
+  if (auto published = _pimpl->concurrency.published())
+    return published;
+
+  const auto lock = _pimpl->concurrency.read();
+  const std::lock_guard<std::mutex> guard(_pimpl->pins_mutex);
+
+  // Pins of the same version can share one view of the database
+  auto& pins = _pimpl->live_pins;
+  pins.erase(
+    std::remove_if(pins.begin(), pins.end(),
+    [](const std::weak_ptr<PinnedSnapshot>& pin) { return pin.expired(); }),
+    pins.end());
+
+  if (!pins.empty())
+  {
+    auto newest = pins.back().lock();
+    if (newest->version() == _pimpl->schedule_version)
+      return newest;
+  }
+
+  auto pin = std::make_shared<PinnedSnapshot>(*_pimpl);
+  pins.push_back(pin);
+  return pin;
 }
 
 //==============================================================================
 Database::Database()
-: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+: Database(TimelineOptions())
 {
   // Do nothing
 }
 
+//==============================================================================
+Database::Database(
+  const TimelineOptions& timeline_options,
+  const Concurrency concurrency)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+{
+  _pimpl->timeline = Timeline<Implementation::RouteEntry>(timeline_options);
+  _pimpl->retention_step = timeline_options.bucket_duration();
+  _pimpl->concurrency = ConcurrencyControl(concurrency);
+}
+
 //==============================================================================
 const Inconsistencies& Database::inconsistencies() const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   return _pimpl->inconsistencies;
 }
 
@@ -1459,6 +2895,7 @@ auto Database::changes(
   const Query& parameters,
   std::optional<Version> after) const -> Patch
 {
+  const auto lock = _pimpl->concurrency.read();
   if (after.has_value() && _pimpl->fork_info.has_value())
   {
     // If a specific version is being asked for, but that version predates the
@@ -1466,106 +2903,206 @@ auto Database::changes(
     // a changeset that will bring the mirrors up to date no matter what their
     // current version is.
     if (*after < _pimpl->fork_info->initial_version)
-      return changes(parameters, std::nullopt);
+      after = std::nullopt;
   }
 
-  std::unordered_map<ParticipantId, ParticipantChanges> changes;
+  ParticipantTable<ParticipantChanges> changes;
   if (after.has_value())
   {
     PatchRelevanceInspector inspector(*after);
+    if (_pimpl->change_log_covers(*after))
+    {
+      _pimpl->inspect_changes(parameters, *after, inspector);
+    }
+    else
+    {
+      _pimpl->timeline.inspect(
+        parameters.spacetime(), parameters.participants(), inspector);
+    }
+
+    changes = std::move(inspector.changes);
+  }
+  else
+  {
+    FirstPatchRelevanceInspector inspector;
     _pimpl->timeline.inspect(
       parameters.spacetime(), parameters.participants(), inspector);
 
-    changes = inspector.changes;
+    changes = std::move(inspector.changes);
+  }
+
+  return make_patch(*_pimpl, std::move(changes), after);
+}
+
+//==============================================================================
+Viewer::View Database::query(const Query& parameters, const Version after) const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  ViewerAfterRelevanceInspector inspector{after};
+  if (_pimpl->change_log_covers(after))
+  {
+    _pimpl->inspect_changes(parameters, after, inspector);
   }
   else
   {
-    FirstPatchRelevanceInspector inspector;
     _pimpl->timeline.inspect(
       parameters.spacetime(), parameters.participants(), inspector);
+  }
 
-    changes = inspector.changes;
+  return std::move(inspector.routes).build();
+}
+
+//==============================================================================
+auto Database::subscribe(Query parameters) -> SubscriptionId
+{
+  const auto lock = _pimpl->concurrency.write();
+
+  const SubscriptionId id = _pimpl->next_subscription_id++;
+  SharedQuery query(std::move(parameters));
+  _pimpl->subscription_groups[query].push_back(id);
+  _pimpl->subscriptions.insert(
+    {id, Implementation::Subscription{query, std::nullopt, {}, false}});
+  return id;
+}
+
+//==============================================================================
+void Database::unsubscribe(const SubscriptionId subscription)
+{
+  const auto lock = _pimpl->concurrency.write();
+
+  const auto it = _pimpl->subscriptions.find(subscription);
+  if (it == _pimpl->subscriptions.end())
+  {
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "[Database::unsubscribe] No subscription with ID ["
+      + std::to_string(subscription) + "]");
+    // *INDENT-ON*
   }
 
-  std::vector<Patch::Participant> part_patches;
-  for (const auto& p : changes)
+  const auto g_it = _pimpl->subscription_groups.find(it->second.query);
+  assert(g_it != _pimpl->subscription_groups.end());
+  auto& members = g_it->second;
+  members.erase(std::find(members.begin(), members.end(), subscription));
+  if (members.empty())
+    _pimpl->subscription_groups.erase(g_it);
+
+  _pimpl->subscriptions.erase(it);
+}
+
+//==============================================================================
+auto Database::take_patch(const SubscriptionId subscription) -> Patch
+{
+  const auto lock = _pimpl->concurrency.write();
+
+  const auto it = _pimpl->subscriptions.find(subscription);
+  if (it == _pimpl->subscriptions.end())
   {
-    const auto& changeset = p.second;
-    const auto& state = _pimpl->states.at(p.first);
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "[Database::take_patch] No subscription with ID ["
+      + std::to_string(subscription) + "]");
+    // *INDENT-ON*
+  }
 
-    std::vector<Change::Delay> delays;
-    for (const auto& d : changeset.delays)
-    {
-      delays.emplace_back(
-        Change::Delay{
-          d.second.duration
-        });
-    }
+  Implementation::Subscription& state = it->second;
+  const Query& parameters = *state.query;
+  const std::optional<Version> after = state.synced;
 
-    if (changeset.erasures.empty()
-      && delays.empty()
-      && changeset.additions.empty())
+  ParticipantTable<ParticipantChanges> changes;
+  if (after.has_value())
+  {
+    PatchRelevanceInspector inspector(*after);
+    if (state.overflowed)
     {
-      // There aren't actually any changes for this participant, so we will
-      // leave it out of the patch.
-      continue;
+      _pimpl->timeline.inspect(
+        parameters.spacetime(), parameters.participants(), inspector);
     }
-
-    std::optional<Change::Progress> progress;
-    if (state.schedule_version_of_progress.has_value())
+    else
     {
-      if (!after.has_value() || *after < *state.schedule_version_of_progress)
-      {
-        progress = Change::Progress(
-            state.progress.version,
-            state.progress.reached_checkpoints);
-      }
+      _pimpl->inspect_pending(state, inspector);
     }
 
-    part_patches.emplace_back(
-      Patch::Participant{
-        p.first,
-        state.tracker->last_known_version(),
-        Change::Erase(std::move(p.second.erasures)),
-        std::move(delays),
-        Change::Add(state.latest_plan_id, std::move(p.second.additions)),
-        std::move(progress)
-      });
+    changes = std::move(inspector.changes);
   }
-
-  std::optional<Change::Cull> cull;
-  if (_pimpl->last_cull && after && *after < _pimpl->last_cull->version)
+  else
   {
-    cull = _pimpl->last_cull->cull;
+    FirstPatchRelevanceInspector inspector;
+    _pimpl->timeline.inspect(
+      parameters.spacetime(), parameters.participants(), inspector);
+
+    changes = std::move(inspector.changes);
   }
 
-  return Patch(
-    std::move(part_patches),
-    cull,
-    after,
-    _pimpl->schedule_version);
+  state.synced = _pimpl->schedule_version;
+  state.pending.clear();
+  state.overflowed = false;
+
+  return make_patch(*_pimpl, std::move(changes), after);
 }
 
 //==============================================================================
-Viewer::View Database::query(const Query& parameters, const Version after) const
+void Database::set_maximum_cumulative_delay(rmf_traffic::Duration maximum_delay)
 {
-  ViewerAfterRelevanceInspector inspector{after};
-  _pimpl->timeline.inspect(
-    parameters.spacetime(), parameters.participants(), inspector);
+  const auto lock = _pimpl->concurrency.write();
+
+  _pimpl->maximum_cumulative_delay = maximum_delay;
+}
+
+//==============================================================================
+void Database::set_change_log_retention(const std::size_t versions)
+{
+  const auto lock = _pimpl->concurrency.write();
 
-  return Viewer::View::Implementation::make_view(std::move(inspector.routes));
+  _pimpl->change_log_retention = versions;
+  _pimpl->trim_change_log();
 }
 
 //==============================================================================
-void Database::set_maximum_cumulative_delay(rmf_traffic::Duration maximum_delay)
+std::size_t Database::get_change_log_retention() const
 {
-  _pimpl->maximum_cumulative_delay = maximum_delay;
+  const auto lock = _pimpl->concurrency.read();
+
+  return _pimpl->change_log_retention;
+}
+
+//==============================================================================
+void Database::set_out_of_order_limit(const std::size_t changes)
+{
+  const auto lock = _pimpl->concurrency.write();
+
+  _pimpl->out_of_order_limit = changes;
+  for (auto& state : _pimpl->states)
+    state.second.tracker->set_limit(changes);
+}
+
+//==============================================================================
+std::size_t Database::get_out_of_order_limit() const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  return _pimpl->out_of_order_limit;
+}
+
+//==============================================================================
+void Database::set_query_cache_capacity(const std::size_t capacity)
+{
+  _pimpl->query_cache.set_capacity(capacity);
+}
+
+//==============================================================================
+std::size_t Database::get_query_cache_capacity() const
+{
+  return _pimpl->query_cache.get_capacity();
 }
 
 //==============================================================================
 std::optional<rmf_traffic::Duration> Database::get_cumulative_delay(
   ParticipantId participant) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto s_it = _pimpl->states.find(participant);
   if (s_it == _pimpl->states.end())
     return std::nullopt;
@@ -1576,6 +3113,8 @@ std::optional<rmf_traffic::Duration> Database::get_cumulative_delay(
 //==============================================================================
 Version Database::cull(Time time)
 {
+  const DatabaseWriteScope write(*_pimpl);
+
   Query::Spacetime spacetime;
   spacetime.query_timespan().set_upper_time_bound(time);
 
@@ -1583,6 +3122,46 @@ Version Database::cull(Time time)
   _pimpl->timeline.inspect(
     spacetime, Query::Participants::make_all(), inspector);
 
+  if (_pimpl->indexed_maps)
+  {
+    // Routes on the maps that this database does not index are missing from
+    // the timeline, but they still need to be culled along with the databases
+    // that do index them so that the itineraries stay the same everywhere.
+    for (const auto& [participant, state] : _pimpl->states)
+    {
+      for (const auto& [storage_id, entry_storage] : state.storage)
+      {
+        const Implementation::RouteEntry* entry = entry_storage.entry.get();
+        if (_pimpl->indexes(*entry))
+          continue;
+
+        if (!entry->route)
+          entry = entry->transition->predecessor.entry.get();
+
+        assert(RouteData::get(*entry->route).finish_time());
+        if (*RouteData::get(*entry->route).finish_time() < time)
+          inspector.routes.emplace_back(
+            CullRelevanceInspector::Info{participant, storage_id});
+      }
+    }
+  }
+
+  // Erase the buckets that come before the cull time first, so the culled
+  // entries only need to be removed from the buckets that remain.
+  _pimpl->timeline.cull(time);
+
+  // The timeline handles of every culled entry, including the predecessors of
+  // the culled routes, get released together so that each bucket is only
+  // passed over once.
+  std::vector<std::shared_ptr<void>> handles;
+
+  // If the thread of RouteEntries gets too long, it is possible that erasing
+  // the entry from storage could cause a stack overflow as its predecessors
+  // are recursively destructed. Therefore we store each entry of the thread
+  // here from newest to oldest, and then release them one at a time in that
+  // order so that no destructor ever needs to recurse.
+  CullReclaimer::Batch reclaim;
+
   // TODO(MXG) This iterating could probably be made more efficient by grouping
   // together the culls of each participant.
   for (const auto& route : inspector.routes)
@@ -1599,47 +3178,47 @@ Version Database::cull(Time time)
       p_it->second.active_routes.end(),
       route.storage_id);
     if (a_it != p_it->second.active_routes.end())
+    {
       p_it->second.active_routes.erase(a_it);
+      p_it->second.itinerary_view = nullptr;
+      p_it->second.itinerary_hash = std::nullopt;
+    }
 
-    // If the thread of RouteEntries gets too long, it is possible that erasing
-    // the entry from storage could cause a stack overflow as its predecessors
-    // are recursively destructed. Therefore we will first store the
-    // predecessors in a queue before erasing the entry, and then destruct the
-    // queue in an order that will avoid recursive destruction.
-    std::unordered_set<Implementation::RouteEntryPtr> visited;
-    std::deque<Implementation::RouteEntryPtr> entries;
-    entries.push_back(r_it->second.entry);
-    while (const auto* transition = entries.back()->transition.get())
-    {
-      if (transition->predecessor.entry.use_count() == 1)
-      {
-        if (!visited.insert(transition->predecessor.entry).second)
-        {
-          // A circular reference like this should never happen, but if it does
-          // then we should exit right away.
-          // TODO(MXG): Consider escalating this issue with an error printout
-          break;
-        }
-        entries.push_back(transition->predecessor.entry);
-      }
-      else
+    std::unordered_set<const Implementation::RouteEntry*> visited;
+    const Implementation::RouteEntry* entry = r_it->second.entry.get();
+    handles.push_back(std::move(r_it->second.timeline_handle));
+    reclaim.push_back(std::move(r_it->second.entry));
+    while (const auto* transition = entry->transition.get())
+    {
+      const auto& predecessor = transition->predecessor;
+      if (!visited.insert(predecessor.entry.get()).second)
       {
-        // If the use count of the route entry is already higher than one, then
-        // we do not have to worry about recursively destructing it.
+        // A circular reference like this should never happen, but if it does
+        // then we should exit right away.
+        // TODO(MXG): Consider escalating this issue with an error printout
         break;
       }
+
+      handles.push_back(predecessor.timeline_handle);
+      reclaim.push_back(predecessor.entry);
+      entry = predecessor.entry.get();
     }
 
     storage.erase(r_it);
-    visited.clear();
-
-    // Now we pop the queue from front to back to make sure the destruction
-    // happens one entry at a time.
-    while (!entries.empty())
-      entries.pop_front();
   }
 
-  _pimpl->timeline.cull(time);
+  _pimpl->timeline.erase(handles);
+  handles.clear();
+
+  if (_pimpl->cull_reclaimer)
+  {
+    _pimpl->cull_reclaimer->reclaim(std::move(reclaim));
+  }
+  else
+  {
+    for (auto& item : reclaim)
+      item.reset();
+  }
 
   // Erase all trace of participants that were removed before the culling time.
   const auto p_cull_begin = _pimpl->remove_participant_time.begin();
@@ -1676,15 +3255,70 @@ Version Database::cull(Time time)
   return _pimpl->schedule_version;
 }
 
+//==============================================================================
+void Database::set_background_cull_reclamation(const bool on)
+{
+  const auto lock = _pimpl->concurrency.write();
+
+  if (on && !_pimpl->cull_reclaimer)
+    _pimpl->cull_reclaimer = std::make_unique<CullReclaimer>();
+  else if (!on)
+    _pimpl->cull_reclaimer.reset();
+}
+
+//==============================================================================
+bool Database::get_background_cull_reclamation() const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  return _pimpl->cull_reclaimer != nullptr;
+}
+
 //==============================================================================
 void Database::set_current_time(Time time)
 {
-  _pimpl->current_time = time;
+  std::optional<Time> roll;
+  {
+    const auto lock = _pimpl->concurrency.write();
+    _pimpl->current_time = time;
+    roll = _pimpl->retention_cull_time();
+  }
+
+  // Only take the full write scope, which freezes pins and publishes a new
+  // snapshot, when the schedule actually needs to roll forward.
+  if (roll.has_value())
+    cull(*roll);
+}
+
+//==============================================================================
+void Database::set_retention(std::optional<Duration> window)
+{
+  const auto lock = _pimpl->concurrency.write();
+
+  _pimpl->retention = window;
+}
+
+//==============================================================================
+std::optional<Duration> Database::get_retention() const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  return _pimpl->retention;
+}
+
+//==============================================================================
+MemoryUsage Database::memory_usage() const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  return _pimpl->memory_usage();
 }
 
 //==============================================================================
 ItineraryVersion Database::itinerary_version(ParticipantId participant) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p_it = _pimpl->states.find(participant);
   if (p_it == _pimpl->states.end())
   {
@@ -1701,6 +3335,8 @@ ItineraryVersion Database::itinerary_version(ParticipantId participant) const
 //==============================================================================
 PlanId Database::latest_plan_id(ParticipantId participant) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p_it = _pimpl->states.find(participant);
   if (p_it == _pimpl->states.end())
   {
@@ -1712,9 +3348,328 @@ PlanId Database::latest_plan_id(ParticipantId participant) const
   return p_it->second.latest_plan_id;
 }
 
+namespace {
+//==============================================================================
+constexpr uint8_t CheckpointMagic[4] = {'R', 'M', 'F', 'D'};
+
+//==============================================================================
+/// A read-only view of a file's contents. Where it is available, the file is
+/// memory-mapped so that it does not need to be copied into a buffer first.
+class MappedFile
+{
+public:
+
+  MappedFile(const std::string& path)
+  {
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      fail(path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+      ::close(fd);
+      fail(path);
+    }
+
+    _size = static_cast<std::size_t>(info.st_size);
+    if (_size > 0)
+    {
+      void* const mapped = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if (mapped == MAP_FAILED)
+        fail(path);
+
+      _mapped = mapped;
+      _data = static_cast<const uint8_t*>(mapped);
+    }
+    else
+    {
+      ::close(fd);
+    }
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+      fail(path);
+
+    _buffer.assign(
+      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    _data = reinterpret_cast<const uint8_t*>(_buffer.data());
+    _size = _buffer.size();
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile()
+  {
+#ifndef _WIN32
+    if (_mapped)
+      ::munmap(_mapped, _size);
+#endif
+  }
+
+  const uint8_t* begin() const
+  {
+    return _data;
+  }
+
+  const uint8_t* end() const
+  {
+    return _data + _size;
+  }
+
+private:
+
+  [[noreturn]] static void fail(const std::string& path)
+  {
+    throw std::runtime_error(
+      "[rmf_traffic::schedule::Database::load] Unable to read the file ["
+      + path + "]");
+  }
+
+  const uint8_t* _data = nullptr;
+  std::size_t _size = 0;
+#ifndef _WIN32
+  void* _mapped = nullptr;
+#else
+  std::vector<char> _buffer;
+#endif
+};
+
+} // anonymous namespace
+
+//==============================================================================
+void Database::save(const std::string& path) const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  codec::Writer writer;
+  for (const auto b : CheckpointMagic)
+    writer.byte(b);
+
+  writer.byte(CheckpointFormatVersion);
+  writer.varint(_pimpl->schedule_version);
+  writer.varint(_pimpl->next_participant_id());
+  writer.zigzag(codec::to_nanoseconds(_pimpl->current_time.time_since_epoch()));
+
+  writer.byte(_pimpl->last_cull.has_value() ? 1 : 0);
+  if (_pimpl->last_cull.has_value())
+  {
+    writer.zigzag(
+      codec::to_nanoseconds(_pimpl->last_cull->cull.time().time_since_epoch()));
+    writer.varint(_pimpl->last_cull->version);
+  }
+
+  std::vector<ParticipantId> participants;
+  participants.reserve(_pimpl->states.size());
+  for (const auto& [id, _] : _pimpl->states)
+    participants.push_back(id);
+  std::sort(participants.begin(), participants.end());
+
+  writer.varint(participants.size());
+  for (const auto id : participants)
+  {
+    const auto& state = _pimpl->states.at(id);
+    const auto& description = *state.description;
+    writer.varint(id);
+    writer.string(description.name());
+    writer.string(description.owner());
+    writer.byte(static_cast<uint8_t>(description.responsiveness()));
+    codec::write_shape(writer, description.profile().footprint().get());
+    codec::write_shape(writer, description.profile().vicinity().get());
+
+    // Changes that are waiting on an inconsistency to be resolved are not
+    // saved. We only save the state up to the last change that was applied,
+    // and the participant will need to resend anything after that.
+    const ItineraryVersion expected = state.tracker->expected_version();
+    const bool applied = expected != 0;
+    writer.byte(applied ? 1 : 0);
+    if (!applied)
+      continue;
+
+    writer.varint(expected - 1);
+    writer.varint(state.latest_plan_id);
+    writer.varint(state.next_storage_id);
+    writer.zigzag(codec::to_nanoseconds(state.cumulative_delay));
+
+    writer.varint(state.progress.version);
+    writer.varint(state.progress.reached_checkpoints.size());
+    for (const auto checkpoint : state.progress.reached_checkpoints)
+      writer.varint(checkpoint);
+
+    std::vector<const Implementation::RouteEntry*> entries;
+    entries.reserve(state.active_routes.size());
+    for (const auto storage_id : state.active_routes)
+      entries.push_back(state.storage.at(storage_id).entry.get());
+
+    std::sort(entries.begin(), entries.end(),
+      [](const auto* a, const auto* b) { return a->route_id < b->route_id; });
+
+    writer.varint(entries.size());
+    Time last_time = Time(Duration(0));
+    for (const auto* entry : entries)
+    {
+      writer.varint(entry->route_id);
+      writer.varint(entry->storage_id);
+      writer.string(entry->route->map());
+      codec::write_route(writer, *entry->route, std::nullopt, last_time);
+    }
+  }
+
+  // Write to a temporary file first so that an existing checkpoint is never
+  // left half-written. The file is synced to the disk before it replaces the
+  // checkpoint, so a failed flush is noticed while the old checkpoint is still
+  // in place.
+  const std::string temporary = path + ".tmp";
+  const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool written = fd >= 0;
+  const auto* data = writer.data.data();
+  std::size_t remaining = writer.data.size();
+  while (written && remaining > 0)
+  {
+    const ssize_t count = ::write(fd, data, remaining);
+    if (count < 0)
+    {
+      written = errno == EINTR;
+      continue;
+    }
+
+    data += count;
+    remaining -= static_cast<std::size_t>(count);
+  }
+
+  if (fd >= 0)
+  {
+    written = written && ::fsync(fd) == 0;
+    written = ::close(fd) == 0 && written;
+  }
+
+  if (!written)
+  {
+    std::remove(temporary.c_str());
+    throw std::runtime_error(
+      "[rmf_traffic::schedule::Database::save] Unable to write the file ["
+      + temporary + "]");
+  }
+
+  if (std::rename(temporary.c_str(), path.c_str()) != 0)
+  {
+    std::remove(temporary.c_str());
+    throw std::runtime_error(
+      "[rmf_traffic::schedule::Database::save] Unable to replace the file ["
+      + path + "]");
+  }
+}
+
+//==============================================================================
+Database Database::load(
+  const std::string& path,
+  const TimelineOptions& timeline_options,
+  const Concurrency concurrency)
+{
+  const MappedFile file(path);
+  codec::Reader reader(
+    file.begin(), file.end(), "[rmf_traffic::schedule::Database::load]");
+
+  for (const auto b : CheckpointMagic)
+  {
+    if (reader.byte() != b)
+      reader.fail("the file does not start with the checkpoint marker");
+  }
+
+  const uint8_t format = reader.byte();
+  if (format != CheckpointFormatVersion)
+    reader.fail("unsupported format version [" + std::to_string(format) + "]");
+
+  Database database(timeline_options, concurrency);
+  auto& impl = *database._pimpl;
+
+  const Version schedule_version = reader.varint();
+  const ParticipantId next_participant_id = reader.varint();
+  const Time current_time = Time(codec::from_nanoseconds(reader.zigzag()));
+
+  std::optional<Implementation::CullInfo> last_cull;
+  if (reader.byte())
+  {
+    const Time cull_time = Time(codec::from_nanoseconds(reader.zigzag()));
+    const Version cull_version = reader.varint();
+    last_cull = Implementation::CullInfo{Change::Cull(cull_time), cull_version};
+  }
+
+  const std::size_t participant_count = reader.count();
+  for (std::size_t i = 0; i < participant_count; ++i)
+  {
+    const ParticipantId id = reader.varint();
+    std::string name(reader.string());
+    std::string owner(reader.string());
+    const auto rx = static_cast<ParticipantDescription::Rx>(reader.byte());
+    auto footprint = codec::read_shape(reader);
+    auto vicinity = codec::read_shape(reader);
+
+    ParticipantDescription description(
+      std::move(name),
+      std::move(owner),
+      rx,
+      Profile(std::move(footprint), std::move(vicinity)));
+
+    if (!reader.byte())
+    {
+      internal_register_participant(
+        database, id, std::numeric_limits<ItineraryVersion>::max(),
+        std::move(description));
+      continue;
+    }
+
+    const ItineraryVersion itinerary_version = reader.varint();
+    const PlanId plan = reader.varint();
+    const StorageId next_storage_id = reader.varint();
+    const Duration cumulative_delay = codec::from_nanoseconds(reader.zigzag());
+
+    const ProgressVersion progress_version = reader.varint();
+    std::vector<CheckpointId> progress(reader.count());
+    for (auto& checkpoint : progress)
+      checkpoint = reader.varint();
+
+    std::vector<RouteStorageInfo> routes(reader.count());
+    Time last_time = Time(Duration(0));
+    for (auto& route : routes)
+    {
+      route.route_id = reader.varint();
+      route.storage_id = reader.varint();
+      std::string map(reader.string());
+      route.route = codec::read_route(
+        reader, std::move(map), std::nullopt, last_time, true);
+    }
+
+    internal_register_participant(
+      database, id, itinerary_version - 1, std::move(description));
+
+    set_participant_state(
+      database, id, plan, std::move(routes), next_storage_id,
+      itinerary_version, std::move(progress), progress_version);
+
+    impl.states.at(id).cumulative_delay = cumulative_delay;
+  }
+
+  if (!reader.done())
+    reader.fail("there is data after the end of the checkpoint");
+
+  set_initial_fork_version(database, schedule_version);
+  impl.set_next_participant_id(next_participant_id);
+  impl.current_time = current_time;
+  impl.last_cull = std::move(last_cull);
+
+  return database;
+}
+
 //==============================================================================
 StorageId Database::next_storage_base(ParticipantId participant) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p_it = _pimpl->states.find(participant);
   if (p_it == _pimpl->states.end())
   {
@@ -19,15 +19,71 @@
 
 #include <rmf_utils/Modular.hpp>
 
+#include <algorithm>
+#include <cassert>
+
 namespace rmf_traffic {
 namespace schedule {
 
+namespace {
+//==============================================================================
+void collect(
+  const DependencyTracker::PlanWatchers& watchers,
+  std::vector<std::shared_ptr<DependencyTracker::Shared>>& output)
+{
+  for (const auto& route : watchers.routes)
+  {
+    for (const auto& w : route)
+    {
+      if (auto dep = w.dependency.lock())
+        output.push_back(std::move(dep));
+    }
+  }
+}
+
+//==============================================================================
+/// Pop the watchers of a route whose checkpoints have been reached
+void pop_reached(
+  DependencyTracker::PlanWatchers& watchers,
+  const std::size_t r,
+  const CheckpointId reached,
+  std::vector<std::shared_ptr<DependencyTracker::Shared>>& output)
+{
+  auto& route = watchers.routes[r];
+  while (!route.empty() && route.back().checkpoint <= reached)
+  {
+    if (auto dep = route.back().dependency.lock())
+      output.push_back(std::move(dep));
+
+    route.pop_back();
+    --watchers.count;
+  }
+}
+} // anonymous namespace
+
 //==============================================================================
 void DependencyTracker::add(Dependency dep, DependencyPtr shared)
 {
   std::lock_guard<std::mutex> lock(_mutex);
-  _dependencies[dep.on_participant][dep.on_plan]
-    [dep.on_route][dep.on_checkpoint].push_back(std::move(shared));
+  const auto insertion = _dependencies.insert(
+    {PlanKey{dep.on_participant, dep.on_plan}, PlanWatchers()});
+  if (insertion.second)
+    _plans[dep.on_participant].push_back(dep.on_plan);
+
+  PlanWatchers& plan = insertion.first->second;
+  if (plan.routes.size() <= dep.on_route)
+    plan.routes.resize(dep.on_route + 1);
+
+  auto& route = plan.routes[dep.on_route];
+  const auto it = std::upper_bound(
+    route.begin(), route.end(), dep.on_checkpoint,
+    [](const CheckpointId c, const Watcher& w)
+    {
+      return c > w.checkpoint;
+    });
+
+  route.insert(it, Watcher{dep.on_checkpoint, std::move(shared)});
+  ++plan.count;
 }
 
 //==============================================================================
@@ -36,33 +92,47 @@ void DependencyTracker::reached(
   const PlanId plan,
   const std::vector<CheckpointId>& reached_checkpoints)
 {
-  std::lock_guard<std::mutex> lock(_mutex);
-  auto& all_plan_deps = _dependencies[participant];
-  const auto r_it = all_plan_deps.find(plan);
-  if (r_it != all_plan_deps.end())
-  {
-    for (auto& [r, checkpoints] : r_it->second)
-    {
-      if (r >= reached_checkpoints.size())
-        continue;
-
-      auto c_it = checkpoints.begin();
-      const auto c_end = checkpoints.upper_bound(reached_checkpoints[r]);
-      while (c_it != c_end)
-      {
-        const auto reached_it = c_it;
-        ++c_it;
-
-        for (const auto& w : reached_it->second)
-        {
-          if (const auto dep = w.lock())
-            dep->reach();
-        }
-
-        checkpoints.erase(reached_it);
-      }
-    }
-  }
+  std::vector<std::shared_ptr<Shared>> notify;
+  std::unique_lock<std::mutex> lock(_mutex);
+  const auto p_it = _dependencies.find(PlanKey{participant, plan});
+  if (p_it == _dependencies.end())
+    return;
+
+  PlanWatchers& watchers = p_it->second;
+  const std::size_t N =
+    std::min(watchers.routes.size(), reached_checkpoints.size());
+  for (std::size_t r = 0; r < N; ++r)
+    pop_reached(watchers, r, reached_checkpoints[r], notify);
+
+  if (watchers.count == 0)
+    erase_plan(p_it);
+
+  _notify(lock, std::move(notify), true);
+}
+
+//==============================================================================
+void DependencyTracker::reached(
+  const ParticipantId participant,
+  const PlanId plan,
+  const RouteId route,
+  const CheckpointId checkpoint)
+{
+  std::vector<std::shared_ptr<Shared>> notify;
+  std::unique_lock<std::mutex> lock(_mutex);
+  const auto p_it = _dependencies.find(PlanKey{participant, plan});
+  if (p_it == _dependencies.end())
+    return;
+
+  PlanWatchers& watchers = p_it->second;
+  if (route >= watchers.routes.size())
+    return;
+
+  pop_reached(watchers, route, checkpoint, notify);
+
+  if (watchers.count == 0)
+    erase_plan(p_it);
+
+  _notify(lock, std::move(notify), true);
 }
 
 //==============================================================================
@@ -70,62 +140,121 @@ void DependencyTracker::deprecate_dependencies_before(
   const ParticipantId participant,
   const PlanId plan)
 {
-  std::lock_guard<std::mutex> lock(_mutex);
-  const auto d_it = _dependencies.find(participant);
-  if (d_it != _dependencies.end())
+  std::vector<std::shared_ptr<Shared>> notify;
+  std::unique_lock<std::mutex> lock(_mutex);
+  const auto d_it = _plans.find(participant);
+  if (d_it == _plans.end())
+    return;
+
+  auto& plans = d_it->second;
+  auto p_it = plans.begin();
+  while (p_it != plans.end())
   {
-    auto p_it = d_it->second.begin();
-    while (p_it != d_it->second.end())
+    if (rmf_utils::modular(*p_it).less_than(plan))
+    {
+      const auto w_it = _dependencies.find(PlanKey{participant, *p_it});
+      assert(w_it != _dependencies.end());
+      collect(w_it->second, notify);
+      _dependencies.erase(w_it);
+      p_it = plans.erase(p_it);
+    }
+    else
     {
-      const auto check_it = p_it;
       ++p_it;
-
-      if (rmf_utils::modular(check_it->first).less_than(plan))
-      {
-        for (const auto& [_, r] : check_it->second)
-        {
-          for (const auto& [_, c] : r)
-          {
-            for (const auto& w : c)
-            {
-              if (const auto dep = w.lock())
-              {
-                dep->deprecate();
-              }
-            }
-          }
-        }
-
-        d_it->second.erase(check_it);
-      }
     }
   }
+
+  if (plans.empty())
+    _plans.erase(d_it);
+
+  _notify(lock, std::move(notify), false);
 }
 
 //==============================================================================
 void DependencyTracker::deprecate_dependencies_on(
   const ParticipantId participant)
 {
-  std::lock_guard<std::mutex> lock(_mutex);
-  const auto p_it = _dependencies.find(participant);
-  if (p_it != _dependencies.end())
+  std::vector<std::shared_ptr<Shared>> notify;
+  std::unique_lock<std::mutex> lock(_mutex);
+  const auto d_it = _plans.find(participant);
+  if (d_it == _plans.end())
+    return;
+
+  for (const auto plan : d_it->second)
   {
-    for (const auto& [_, r] : p_it->second)
-    {
-      for (const auto& [_, c] : r)
-      {
-        for (const auto& [_, deps] : c)
-        {
-          for (const auto& w : deps)
-          {
-            if (const auto dep = w.lock())
-              dep->deprecate();
-          }
-        }
-      }
-    }
+    const auto w_it = _dependencies.find(PlanKey{participant, plan});
+    assert(w_it != _dependencies.end());
+    collect(w_it->second, notify);
+    _dependencies.erase(w_it);
+  }
+
+  _plans.erase(d_it);
+
+  _notify(lock, std::move(notify), false);
+}
+
+//==============================================================================
+void DependencyTracker::erase_plan(TrafficDependencies::iterator it)
+{
+  const auto participant = it->first.participant;
+  const auto plan = it->first.plan;
+  _dependencies.erase(it);
+  auto& plans = _plans[participant];
+  plans.erase(std::find(plans.begin(), plans.end(), plan));
+  if (plans.empty())
+    _plans.erase(participant);
+}
 
-    _dependencies.erase(p_it);
+//==============================================================================
+void DependencyTracker::_notify(
+  std::unique_lock<std::mutex>& lock,
+  std::vector<std::shared_ptr<Shared>> dependencies,
+  const bool reached)
+{
+  if (_batch_depth > 0)
+  {
+    for (auto& dep : dependencies)
+      _held.emplace_back(std::move(dep), reached);
+
+    return;
+  }
+
+  lock.unlock();
+  for (const auto& dep : dependencies)
+  {
+    if (reached)
+      dep->reach();
+    else
+      dep->deprecate();
+  }
+}
+
+//==============================================================================
+DependencyTracker::Batch::Batch(DependencyTracker& tracker)
+: _tracker(tracker)
+{
+  std::lock_guard<std::mutex> lock(_tracker._mutex);
+  ++_tracker._batch_depth;
+}
+
+//==============================================================================
+DependencyTracker::Batch::~Batch()
+{
+  std::vector<std::pair<std::shared_ptr<Shared>, bool>> held;
+  {
+    std::lock_guard<std::mutex> lock(_tracker._mutex);
+    if (--_tracker._batch_depth > 0)
+      return;
+
+    held.swap(_tracker._held);
+  }
+
+  for (const auto& [dep, reached] : held)
+  {
+    if (reached)
+      dep->reach();
+    else
+      dep->deprecate();
   }
 }
 
@@ -21,6 +21,8 @@
 #include "internal_Viewer.hpp"
 
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace rmf_traffic {
 namespace schedule {
@@ -31,31 +33,112 @@ struct DependencyTracker
   using Shared =
     ItineraryViewer::DependencySubscription::Implementation::Shared;
   using DependencyPtr = std::weak_ptr<Shared>;
-  using CheckpointDependencies =
-    std::map<CheckpointId, std::vector<DependencyPtr>>;
-  using RouteDependencies =
-    std::unordered_map<RouteId, CheckpointDependencies>;
-  using PlanDependencies =
-    std::unordered_map<PlanId, RouteDependencies>;
+
+  struct Watcher
+  {
+    CheckpointId checkpoint;
+    DependencyPtr dependency;
+  };
+
+  /// The watchers of one route, sorted from the highest checkpoint to the
+  /// lowest so that reached checkpoints can be popped off the back.
+  using RouteWatchers = std::vector<Watcher>;
+
+  /// The watchers of one plan, indexed by route
+  struct PlanWatchers
+  {
+    std::vector<RouteWatchers> routes;
+    std::size_t count = 0;
+  };
+
+  struct PlanKey
+  {
+    ParticipantId participant;
+    PlanId plan;
+
+    bool operator==(const PlanKey& other) const
+    {
+      return participant == other.participant && plan == other.plan;
+    }
+  };
+
+  struct PlanKeyHash
+  {
+    std::size_t operator()(const PlanKey& key) const
+    {
+      const std::size_t h = std::hash<ParticipantId>()(key.participant);
+      return h ^ (std::hash<PlanId>()(key.plan) + 0x9e3779b9 + (h << 6)
+        + (h >> 2));
+    }
+  };
+
   using TrafficDependencies =
-    std::unordered_map<ParticipantId, PlanDependencies>;
+    std::unordered_map<PlanKey, PlanWatchers, PlanKeyHash>;
 
   void add(Dependency dep, DependencyPtr shared);
 
+  /// Notify every dependency on the checkpoints that have been reached in a
+  /// plan. The dependencies are collected with one lookup of the plan and then
+  /// notified together after the tracker is unlocked.
   void reached(
     const ParticipantId participant,
     const PlanId plan,
     const std::vector<CheckpointId>& reached_checkpoints);
 
+  /// Notify the dependencies on one route of a plan, when only the progress
+  /// along that route has changed. The watchers of the other routes are not
+  /// visited.
+  void reached(
+    const ParticipantId participant,
+    const PlanId plan,
+    const RouteId route,
+    const CheckpointId checkpoint);
+
   void deprecate_dependencies_before(
     const ParticipantId participant,
     const PlanId plan);
 
   void deprecate_dependencies_on(const ParticipantId participant);
 
+  /// While a Batch is alive, the dependencies that need to be notified are
+  /// held by the tracker instead of being notified right away. They are all
+  /// notified, in the order that they were triggered, once the last Batch is
+  /// destroyed.
+  class Batch
+  {
+  public:
+    Batch(DependencyTracker& tracker);
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+    ~Batch();
+
+  private:
+    DependencyTracker& _tracker;
+  };
+
+  /// Notify the dependencies, or hold onto them if a Batch is alive. The mutex
+  /// must be locked by the caller, and will be unlocked before any
+  /// dependencies are notified.
+  void _notify(
+    std::unique_lock<std::mutex>& lock,
+    std::vector<std::shared_ptr<Shared>> dependencies,
+    bool reached);
+
+  void erase_plan(TrafficDependencies::iterator it);
+
 //private:
   std::mutex _mutex;
   TrafficDependencies _dependencies;
+
+  /// The plans of each participant that have dependencies on them
+  std::unordered_map<ParticipantId, std::vector<PlanId>> _plans;
+
+  /// The number of Batches that are alive
+  std::size_t _batch_depth = 0;
+
+  /// Dependencies that are waiting for the Batches to finish, and whether
+  /// they were reached (true) or deprecated (false)
+  std::vector<std::pair<std::shared_ptr<Shared>, bool>> _held;
 };
 
 } // namespace schedule
@@ -18,34 +18,92 @@
 #include "InconsistencyTracker.hpp"
 #include "InconsistenciesInternal.hpp"
 
+#include "../internal_MemoryUsage.hpp"
+#include "../internal_Route.hpp"
+
 #include <rmf_utils/Modular.hpp>
 
+#include <algorithm>
+
 namespace rmf_traffic {
 namespace schedule {
 
 InconsistencyTracker::InconsistencyTracker(
   RangesSet& ranges,
-  ItineraryVersion& last_known_version)
+  ItineraryVersion& last_known_version,
+  const std::size_t limit)
 : _ranges(ranges),
   _last_known_version(last_known_version),
-  _expected_version(_last_known_version+1)
+  _expected_version(_last_known_version+1),
+  _limit(limit)
 {
   // Do nothing
 }
 
 //==============================================================================
-void InconsistencyTracker::Ticket::set(std::function<void()> change)
+auto InconsistencyTracker::DeferredChange::make_set(
+  const PlanId plan,
+  Itinerary itinerary,
+  const StorageId storage_base) -> DeferredChange
+{
+  DeferredChange change;
+  change.type = Type::Set;
+  change.plan = plan;
+  change.storage_base = storage_base;
+  change.itinerary = std::move(itinerary);
+  return change;
+}
+
+//==============================================================================
+auto InconsistencyTracker::DeferredChange::make_extend(Itinerary itinerary)
+-> DeferredChange
+{
+  DeferredChange change;
+  change.type = Type::Extend;
+  change.itinerary = std::move(itinerary);
+  return change;
+}
+
+//==============================================================================
+auto InconsistencyTracker::DeferredChange::make_delay(const Duration delay)
+-> DeferredChange
+{
+  DeferredChange change;
+  change.type = Type::Delay;
+  change.delay = delay;
+  return change;
+}
+
+//==============================================================================
+auto InconsistencyTracker::DeferredChange::make_clear() -> DeferredChange
+{
+  DeferredChange change;
+  change.type = Type::Clear;
+  return change;
+}
+
+//==============================================================================
+void InconsistencyTracker::Ticket::set(DeferredChange change, Apply apply)
 {
   _set = true;
-  _callback = change;
+
+  // If the change could not be held then it will be requested again later, so
+  // we simply drop it.
+  if (_slot)
+    *_slot = std::move(change);
+
+  // The applier is only needed if this ticket is going to release the changes
+  // that are being held.
+  if (_parent._ready)
+    _apply = std::move(apply);
 }
 
 //==============================================================================
 InconsistencyTracker::Ticket::Ticket(
   InconsistencyTracker& parent,
-  std::function<void()>& callback)
+  DeferredChange* slot)
 : _parent(parent),
-  _callback(callback)
+  _slot(slot)
 {
   // Do nothing
 }
@@ -64,7 +122,7 @@ InconsistencyTracker::Ticket::~Ticket()
   // that in the first place.
   if (_parent._ready)
   {
-    _parent._apply_changes();
+    _parent._apply_changes(_apply);
   }
 }
 
@@ -102,11 +160,17 @@ auto InconsistencyTracker::check(
     // it here just to make sure.
     assert(!rmf_utils::modular(version).less_than(_expected_version));
 
+    if (_overflows(version))
+    {
+      // This change is too far ahead for us to hold on to, so we will treat it
+      // as missing along with everything that came before it.
+      _ranges.insert(Range{_expected_version, version});
+      return std::make_unique<Ticket>(*this, nullptr);
+    }
+
     // This is the only inconsistency, so it should be easy to fill in the set:
     _ranges.insert(Range{_expected_version, version-1});
-
-    const auto c_it = _changes.insert(std::make_pair(version, nullptr)).first;
-    return std::make_unique<Ticket>(*this, c_it->second);
+    return std::make_unique<Ticket>(*this, _hold(version));
   }
   else
   {
@@ -114,9 +178,6 @@ auto InconsistencyTracker::check(
     // how this new entry affects the current ranges of inconsistencies and
     // adjust them as needed.
 
-    const auto c_insertion = _changes.insert(std::make_pair(version, nullptr));
-    auto& callback = c_insertion.first->second;
-
     // TODO(MXG): Should we care about cases where a repeat ticket is issued for
     // the same inconsistent change number? It would be largely irrelevant for a
     // new copy of the change to replace the old copy, because they should be
@@ -125,24 +186,27 @@ auto InconsistencyTracker::check(
     // won't have a noticeable impact. When we have benchmark tests for the
     // schedule we can try to make it more efficient by exposing when repeat
     // tickets are issued and see if that improves performance.
-    if (!c_insertion.second)
+    if (Slot* const slot = _find(version))
     {
       // We have already received this change in the past, so we don't need to
       // modify the inconsistency ranges. We're assuming that repeats of the
       // changes we receive from participants will be consistent with themselves
-      return std::make_unique<Ticket>(*this, callback);
+      return std::make_unique<Ticket>(*this, &slot->change);
+    }
+
+    if (version == _expected_version && _ranges.begin()->lower != version)
+    {
+      // This is a change that was being held and is now being applied, because
+      // every change before it has arrived.
+      _expected_version = version + 1;
+      return nullptr;
     }
 
     if (nullifying)
     {
       // If this is a nullifying change, then we can erase all recorded changes
       // that predate it.
-      auto c_old = _changes.begin();
-      while (c_old->first < version)
-      {
-        _changes.erase(c_old++);
-        assert(c_old != _changes.end());
-      }
+      _release_before(version);
 
       // We can update the expected version because earlier changes no longer
       // matter.
@@ -152,6 +216,11 @@ auto InconsistencyTracker::check(
       // apply all the changes that we've been saving up.
       _expected_version = version;
     }
+    else if (_overflows(version))
+    {
+      _mark_missing(version);
+      return std::make_unique<Ticket>(*this, nullptr);
+    }
 
     // Symbol key for the example illustrations below
     //
@@ -178,14 +247,14 @@ auto InconsistencyTracker::check(
       // than any of the missing entries, we must have never received any change
       // with a higher version. If either of those beliefs are false, then there
       // is a software bug somewhere.
-      assert(!_changes.empty() && (_changes.rbegin())->first <= version);
+      assert(rmf_utils::modular(_newest_seen()).less_than(version));
 
       if (nullifying)
       {
         // This is a nullifying change, so we can wipe out all earlier changes
         // and all earlier inconsistencies and start fresh.
 
-        _changes.clear();
+        _release_all();
         _ranges.clear();
         _expected_version = version + 1;
         return nullptr;
@@ -195,8 +264,7 @@ auto InconsistencyTracker::check(
         // This is the highest inconsistent version number that we have seen so
         // far. We will create an inconsistency range between this and the
         // highest change value that we have received so far.
-        assert(_changes.size() >= 2);
-        const ItineraryVersion lower = (++_changes.rbegin())->first + 1;
+        const ItineraryVersion lower = _newest_seen() + 1;
         const ItineraryVersion upper = version - 1;
 
         if (rmf_utils::modular(lower).less_than_or_equal(upper))
@@ -226,7 +294,7 @@ auto InconsistencyTracker::check(
           // any new range of inconsistency.
         }
 
-        return std::make_unique<Ticket>(*this, callback);
+        return std::make_unique<Ticket>(*this, _hold(version));
       }
     }
     else
@@ -241,24 +309,7 @@ auto InconsistencyTracker::check(
         const auto hint_it =
           _ranges.erase(_ranges.begin(), ++RangesSet::iterator(range_it));
 
-        if (version == upper)
-        {
-          // x x o x x x o x x o
-          //           ^
-
-          // The new change also eliminates the range of inconsistencies that it
-          // belongs to, because it is the upper end of its range.
-
-          if (_ranges.empty())
-          {
-            // x x o x x x o o o
-            //           ^
-
-            // All inconsistencies have been eliminated.
-            _ready = true;
-          }
-        }
-        else
+        if (version != upper)
         {
           // x x o x x x o x x o
           //         ^
@@ -268,7 +319,8 @@ auto InconsistencyTracker::check(
           _ranges.insert(hint_it, Range{version + 1, upper});
         }
 
-        return std::make_unique<Ticket>(*this, callback);
+        // Nothing before this change is missing anymore, so it will be applied
+        // along with any changes that were held after it.
       }
       else if (version == upper)
       {
@@ -279,17 +331,6 @@ auto InconsistencyTracker::check(
 
           // The new version eliminates this unit-sized range of inconsistencies
           _ranges.erase(range_it);
-
-          if (_ranges.empty())
-          {
-            // o o o x o o
-            //       ^
-
-            // The new version eliminates all outstanding inconsistencies for
-            // this participant, so we are ready to start applying the changes
-            // that have been accumulating.
-            _ready = true;
-          }
         }
         else
         {
@@ -307,8 +348,6 @@ auto InconsistencyTracker::check(
           _ranges.insert(range_it, Range{lower, version-1});
           _ranges.erase(range_it);
         }
-
-        return std::make_unique<Ticket>(*this, callback);
       }
       else
       {
@@ -340,21 +379,181 @@ auto InconsistencyTracker::check(
           _ranges.insert(hint_it, Range{lower, version-1});
           _ranges.insert(hint_it, Range{version+1, upper});
         }
+      }
+
+      if (version == _expected_version)
+      {
+        // o o o x o o
+        //       ^
 
-        return std::make_unique<Ticket>(*this, callback);
+        // This was the earliest missing change, so we can start applying the
+        // changes that have been accumulating up to the next one that is still
+        // missing.
+        _ready = true;
       }
+
+      return std::make_unique<Ticket>(*this, _hold(version));
     }
   }
 }
 
 //==============================================================================
-void InconsistencyTracker::_apply_changes()
+std::size_t InconsistencyTracker::memory_usage() const
+{
+  std::size_t bytes = sizeof(InconsistencyTracker)
+    + internal::vector_bytes(_changes)
+    + internal::tree_bytes(_ranges);
+
+  if (_held_count == 0)
+    return bytes;
+
+  for (const auto& slot : _changes)
+  {
+    if (!slot.version.has_value())
+      continue;
+
+    const auto& itinerary = slot.change.itinerary;
+    bytes += internal::vector_bytes(itinerary);
+    for (const auto& route : itinerary)
+      bytes += RouteData::memory_usage(route);
+  }
+
+  return bytes;
+}
+
+//==============================================================================
+auto InconsistencyTracker::_find(const ItineraryVersion version) -> Slot*
+{
+  if (_changes.empty())
+    return nullptr;
+
+  Slot& slot = _changes[version % _changes.size()];
+  if (slot.version == version)
+    return &slot;
+
+  return nullptr;
+}
+
+//==============================================================================
+auto InconsistencyTracker::_hold(const ItineraryVersion version)
+-> DeferredChange*
+{
+  if (_changes.empty())
+    _changes.resize(std::max<std::size_t>(_limit, 1));
+
+  Slot& slot = _changes[version % _changes.size()];
+
+  // Every change that is held must be within one ring length of the expected
+  // version, so no two of them can land in the same slot.
+  assert(!slot.version.has_value());
+
+  slot.version = version;
+  if (_held_count == 0
+    || rmf_utils::modular(_newest_held).less_than(version))
+  {
+    _newest_held = version;
+  }
+
+  ++_held_count;
+  return &slot.change;
+}
+
+//==============================================================================
+bool InconsistencyTracker::_overflows(const ItineraryVersion version) const
+{
+  const std::size_t capacity = _changes.empty() ? _limit : _changes.size();
+  return version - _expected_version >= capacity;
+}
+
+//==============================================================================
+ItineraryVersion InconsistencyTracker::_newest_seen() const
+{
+  assert(!_ranges.empty());
+  const ItineraryVersion newest_missing = _ranges.rbegin()->upper;
+  if (_held_count > 0 && rmf_utils::modular(newest_missing).less_than(
+      _newest_held))
+  {
+    return _newest_held;
+  }
+
+  return newest_missing;
+}
+
+//==============================================================================
+void InconsistencyTracker::_mark_missing(const ItineraryVersion version)
+{
+  using Range = Inconsistencies::Ranges::Range;
+
+  const auto range_it = _ranges.lower_bound(Range{version, version});
+  if (range_it != _ranges.end())
+  {
+    // This change is already known to be missing
+    assert(rmf_utils::modular(range_it->lower).less_than_or_equal(version));
+    return;
+  }
+
+  const auto last_it = --_ranges.end();
+  const ItineraryVersion lower = _newest_seen() + 1;
+  if (last_it->upper + 1 == lower)
+  {
+    // Grow the newest range of inconsistencies instead of starting a new one
+    const ItineraryVersion last_lower = last_it->lower;
+    _ranges.erase(last_it);
+    _ranges.insert(Range{last_lower, version});
+  }
+  else
+  {
+    _ranges.insert(Range{lower, version});
+  }
+}
+
+//==============================================================================
+void InconsistencyTracker::_release_before(const ItineraryVersion version)
+{
+  for (auto& slot : _changes)
+  {
+    if (slot.version && rmf_utils::modular(*slot.version).less_than(version))
+    {
+      slot.version = std::nullopt;
+      slot.change = DeferredChange();
+      --_held_count;
+    }
+  }
+
+  if (_held_count == 0)
+    _release_all();
+}
+
+//==============================================================================
+void InconsistencyTracker::_release_all()
+{
+  std::vector<Slot>().swap(_changes);
+  _held_count = 0;
+}
+
+//==============================================================================
+void InconsistencyTracker::_apply_changes(const Apply& apply)
 {
   _ready = false;
-  for (const auto& c : _changes)
-    c.second();
 
-  _changes.clear();
+  // Apply every held change from the expected version up until the next change
+  // that is still missing. Each change is taken out of its slot before it gets
+  // applied, so the tracker will let it through when the applier passes it
+  // back into check().
+  while (Slot* const slot = _find(_expected_version))
+  {
+    const ItineraryVersion version = *slot->version;
+    DeferredChange change = std::move(slot->change);
+    slot->version = std::nullopt;
+    slot->change = DeferredChange();
+    --_held_count;
+
+    apply(change, version);
+    assert(_expected_version == version + 1);
+  }
+
+  if (_held_count == 0)
+    _release_all();
 }
 
 } // namespace schedule
@@ -18,6 +18,7 @@
 #ifndef SRC__RMF_TRAFFIC__SCHEDULE__INCONSISTENCYTRACKER_HPP
 #define SRC__RMF_TRAFFIC__SCHEDULE__INCONSISTENCYTRACKER_HPP
 
+#include <rmf_traffic/schedule/Change.hpp>
 #include <rmf_traffic/schedule/Inconsistencies.hpp>
 #include <rmf_traffic/schedule/Itinerary.hpp>
 #include <rmf_traffic/schedule/Participant.hpp>
@@ -25,9 +26,11 @@
 #include <rmf_utils/optional.hpp>
 #include <rmf_utils/Modular.hpp>
 
+#include <functional>
+#include <optional>
 #include <set>
-#include <map>
 #include <unordered_map>
+#include <vector>
 
 namespace rmf_traffic {
 namespace schedule {
@@ -54,29 +57,77 @@ class InconsistencyTracker
 {
 public:
 
+  /// The default number of changes that a tracker will hold on to while it
+  /// waits for missing changes to arrive.
+  static constexpr std::size_t DefaultLimit = 256;
+
   InconsistencyTracker(
     RangesSet& parent,
-    ItineraryVersion& last_known_version);
+    ItineraryVersion& last_known_version,
+    std::size_t limit = DefaultLimit);
+
+  /// A compact description of a change that arrived while an earlier change
+  /// was still missing. These are held by the tracker until the missing
+  /// changes arrive.
+  struct DeferredChange
+  {
+    enum class Type : uint8_t
+    {
+      Set,
+      Extend,
+      Delay,
+      Clear
+    };
+
+    Type type = Type::Clear;
+    PlanId plan = 0;
+    StorageId storage_base = 0;
+    Duration delay = Duration(0);
+    Itinerary itinerary;
+
+    static DeferredChange make_set(
+      PlanId plan,
+      Itinerary itinerary,
+      StorageId storage_base);
+
+    static DeferredChange make_extend(Itinerary itinerary);
+
+    static DeferredChange make_delay(Duration delay);
+
+    static DeferredChange make_clear();
+  };
+
+  /// A callback that applies a deferred change once it is ready.
+  using Apply =
+    std::function<void(const DeferredChange& change, ItineraryVersion version)>;
 
   /// The Ticket class is a way to inform the caller that there is an
   /// inconsistency with the version of an incoming change. When the
   /// Inconsistency::check() function returns a Ticket, the caller must pass
-  /// along a callback function that represents the intended change.
+  /// along a description of the intended change and a callback that can apply
+  /// it.
   ///
-  /// We use a ticket class for this instead of having the caller pass a
-  /// callback to the check() function because generally the callback will be a
-  /// lambda that requires memory allocation and copy operations that won't be
-  /// necessary if there's no inconsistency.
+  /// We use a ticket class for this instead of having the caller pass the
+  /// change to the check() function because generally the change will contain
+  /// an itinerary that would be copied needlessly if there's no inconsistency.
   class Ticket
   {
   public:
 
     /// Set the change for this ticket.
-    void set(std::function<void()> change);
+    ///
+    /// \param[in] change
+    ///   The change that was requested.
+    ///
+    /// \param[in] apply
+    ///   A callback that can apply any of the changes that are being held for
+    ///   this participant. It will only be used if this ticket resolves the
+    ///   last inconsistency.
+    void set(DeferredChange change, Apply apply);
 
     Ticket(
       InconsistencyTracker& parent,
-      std::function<void()>& callback);
+      DeferredChange* slot);
 
     Ticket(const Ticket&) = delete;
     Ticket& operator=(const Ticket&) = delete;
@@ -90,7 +141,11 @@ public:
     friend class InconsistencyTracker;
 
     InconsistencyTracker& _parent;
-    std::function<void()>& _callback;
+
+    // This is a nullptr if the change was too far ahead to be held. In that
+    // case the change is discarded and will be requested again.
+    DeferredChange* _slot;
+    Apply _apply;
     bool _set = false;
   };
 
@@ -125,9 +180,63 @@ public:
     return _last_known_version;
   }
 
+  /// Set how many changes may be held while waiting for missing changes.
+  /// A change that is this many versions or more ahead of the next expected
+  /// version will be discarded and marked as missing, so the participant will
+  /// be asked to send it again. The new limit takes effect the next time this
+  /// tracker starts holding changes.
+  void set_limit(std::size_t limit)
+  {
+    _limit = limit;
+  }
+
+  /// Get how many changes may be held while waiting for missing changes.
+  std::size_t get_limit() const
+  {
+    return _limit;
+  }
+
+  /// Get how many changes are currently being held.
+  std::size_t held() const
+  {
+    return _held_count;
+  }
+
+  /// Get how many bytes this tracker is holding, including the ranges of
+  /// missing changes and the itineraries of the changes that are being held.
+  std::size_t memory_usage() const;
+
 private:
 
-  void _apply_changes();
+  struct Slot
+  {
+    std::optional<ItineraryVersion> version;
+    DeferredChange change;
+  };
+
+  /// Get the slot of a change that is already being held, or a nullptr.
+  Slot* _find(ItineraryVersion version);
+
+  /// Start holding a change in its slot.
+  DeferredChange* _hold(ItineraryVersion version);
+
+  /// Decide whether a change is too far ahead of the expected version to be
+  /// held.
+  bool _overflows(ItineraryVersion version) const;
+
+  /// Get the newest version that has either been held or marked as missing.
+  ItineraryVersion _newest_seen() const;
+
+  /// Mark a change that could not be held as missing.
+  void _mark_missing(ItineraryVersion version);
+
+  /// Stop holding every change that is older than the given version.
+  void _release_before(ItineraryVersion version);
+
+  /// Stop holding every change and free the ring.
+  void _release_all();
+
+  void _apply_changes(const Apply& apply);
 
   // TODO(MXG): Consider a more robust way of keeping _ranges up to date. Right
   // now we calculate both _changes and _ranges independently, but they are
@@ -138,7 +247,14 @@ private:
 
   ItineraryVersion& _last_known_version;
   ItineraryVersion _expected_version;
-  std::map<ItineraryVersion, std::function<void()>> _changes;
+
+  // The changes that are being held, in a ring that is indexed by version. The
+  // ring is only allocated while changes are being held, and it has a fixed
+  // size during that time so that the Ticket slots remain valid.
+  std::vector<Slot> _changes;
+  std::size_t _held_count = 0;
+  ItineraryVersion _newest_held = 0;
+  std::size_t _limit;
 
   // TODO(MXG): Consider whether this _ready flag is superfluous since a Ticket
   // can simply check _ranges.empty() to determine if the changes are ready to
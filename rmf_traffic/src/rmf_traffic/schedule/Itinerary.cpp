@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/Itinerary.hpp>
+
+#include "internal_Itinerary.hpp"
+#include "internal_Query.hpp"
+#include "../internal_Route.hpp"
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+std::size_t hash_itinerary(const Itinerary& itinerary)
+{
+  std::size_t seed = itinerary.size();
+  for (const auto& route : itinerary)
+    hash_combine(seed, RouteData::hash(route));
+
+  return seed;
+}
+
+//==============================================================================
+std::size_t hash_itinerary(const ItineraryView& itinerary)
+{
+  std::size_t seed = itinerary.size();
+  for (const auto& route : itinerary)
+    hash_combine(seed, RouteData::hash(*route));
+
+  return seed;
+}
+
+//==============================================================================
+bool same_itinerary(const Itinerary& a, const Itinerary& b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    if (!RouteData::same_content(a[i], b[i]))
+      return false;
+  }
+
+  return true;
+}
+
+//==============================================================================
+bool same_itinerary(const Itinerary& a, const ItineraryView& b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    if (!RouteData::same_content(a[i], *b[i]))
+      return false;
+  }
+
+  return true;
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/MemoryUsage.hpp>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+std::size_t MemoryUsage::Participant::total() const
+{
+  return routes + change_history + inconsistencies;
+}
+
+//==============================================================================
+std::size_t MemoryUsage::total() const
+{
+  std::size_t bytes = shared;
+  for (const auto& [_, participant] : participants)
+    bytes += participant.total();
+
+  for (const auto& [_, map] : maps)
+    bytes += map.bytes;
+
+  return bytes;
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
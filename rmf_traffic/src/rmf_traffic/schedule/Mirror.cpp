@@ -24,8 +24,16 @@
 #include "ViewerInternal.hpp"
 #include "internal_Snapshot.hpp"
 #include "internal_Database.hpp"
+#include "internal_ParticipantDescription.hpp"
+#include "internal_ParticipantTable.hpp"
 #include "internal_Progress.hpp"
 #include "DependencyTracker.hpp"
+#include "internal_Concurrency.hpp"
+#include "internal_PatchCodec.hpp"
+#include "internal_QueryCache.hpp"
+
+#include "../internal_MapName.hpp"
+#include "../internal_MemoryUsage.hpp"
 
 namespace rmf_traffic {
 namespace schedule {
@@ -54,6 +62,16 @@ public:
     PlanId current_plan_id = std::numeric_limits<PlanId>::max();
     std::optional<StorageId> highest_storage;
     Progress progress;
+
+    // Routes of this participant that were dropped because they are not on a
+    // subscribed map, along with their start times. We keep track of them so
+    // that the progress of the plan and culls can still be handled correctly.
+    std::unordered_map<StorageId, std::optional<Time>> skipped;
+
+    /// The itinerary view that was last handed out by get_itinerary_view().
+    /// Readers fill this in with atomic operations while they hold the read
+    /// lock, and any change to the storage must reset it.
+    mutable std::shared_ptr<const ItineraryView> itinerary_view = nullptr;
   };
 
   // This violates the single-source-of-truth principle, but it helps make it
@@ -64,7 +82,7 @@ public:
     >;
   ParticipantDescriptions descriptions;
 
-  using ParticipantStates = std::unordered_map<ParticipantId, ParticipantState>;
+  using ParticipantStates = ParticipantTable<ParticipantState>;
   ParticipantStates states;
 
   std::unordered_set<ParticipantId> participant_ids;
@@ -73,16 +91,47 @@ public:
 
   mutable DependencyTracker dependencies;
 
+  ConcurrencyControl concurrency;
+
+  /// Recent query results for the latest version. This needs to be cleared
+  /// by any change that does not come with a new version.
+  mutable QueryCache query_cache;
+
+  /// The maps that routes will be kept for. A nullopt means all maps.
+  std::optional<std::unordered_set<std::string>> maps = std::nullopt;
+
+  /// The interned IDs of maps, so that routes can be checked against them
+  /// without hashing their map names
+  std::unordered_set<MapName::Id> map_ids;
+
+  bool keeps(const Route& route) const
+  {
+    return !maps.has_value()
+      || map_ids.count(RouteData::get(route).map.id()) > 0;
+  }
+
+  /// Forget all routes and versions so that a full update is needed
+  void reset();
+
+  /// Make a snapshot of the current state of the mirror
+  std::shared_ptr<const Snapshot> make_snapshot() const;
+
   static void erase_routes(
     const ParticipantId participant,
     ParticipantState& state,
-    const Change::Erase& erase)
+    const std::vector<StorageId>& erase)
   {
-    for (const StorageId id : erase.ids())
+    if (!erase.empty())
+      state.itinerary_view = nullptr;
+
+    for (const StorageId id : erase)
     {
       const auto r_it = state.storage.find(id);
       if (r_it == state.storage.end())
       {
+        if (state.skipped.erase(id) > 0)
+          continue;
+
         std::cerr << "[Mirror::update] Erasing unrecognized route [" << id
                   << "] for participant [" << participant << "]" << std::endl;
         continue;
@@ -94,18 +143,25 @@ public:
 
   void apply_delay(
     ParticipantState& state,
-    const Change::Delay& delay)
+    const Duration delay)
   {
+    state.itinerary_view = nullptr;
+    for (auto& [_, start] : state.skipped)
+    {
+      if (start.has_value())
+        *start += delay;
+    }
+
     for (auto& s : state.storage)
     {
       RouteStorage& entry_storage = s.second;
       assert(entry_storage.entry);
       assert(entry_storage.entry->route);
-      if (entry_storage.entry->route->trajectory().empty())
+      if (RouteData::get(*entry_storage.entry->route).size() == 0)
         continue;
 
       auto new_route = std::make_shared<Route>(*entry_storage.entry->route);
-      new_route->trajectory().front().adjust_times(delay.duration());
+      RouteData::delay_route(*new_route, delay);
 
       // We create a new entry because
       auto new_entry = std::make_shared<RouteEntry>(*entry_storage.entry);
@@ -120,8 +176,9 @@ public:
     ParticipantState& state,
     const RouteId route_id,
     const StorageId storage_id,
-    const ConstRoutePtr& route)
+    ConstRoutePtr route)
   {
+    state.itinerary_view = nullptr;
     auto insertion = state.storage.insert({storage_id, RouteStorage()});
     const bool inserted = insertion.second;
     if (!inserted)
@@ -152,6 +209,21 @@ public:
       state.highest_storage = storage_id;
   }
 
+  static void skip_route(
+    ParticipantState& state,
+    const StorageId storage_id,
+    const Route& route)
+  {
+    state.skipped[storage_id] = RouteData::get(route).start_time();
+
+    // The storage IDs of skipped routes still need to be accounted for so that
+    // a fork of this mirror does not reuse them.
+    if (!state.highest_storage.has_value())
+      state.highest_storage = storage_id;
+    else if (rmf_utils::modular(*state.highest_storage).less_than(storage_id))
+      state.highest_storage = storage_id;
+  }
+
   void add_routes(
     const ParticipantId participant,
     ParticipantState& state,
@@ -159,6 +231,12 @@ public:
   {
     for (const auto& item : add.items())
     {
+      if (!keeps(*item.route))
+      {
+        skip_route(state, item.storage_id, *item.route);
+        continue;
+      }
+
       add_route(
         participant,
         state,
@@ -167,6 +245,95 @@ public:
         std::make_shared<const Route>(*item.route));
     }
   }
+
+  /// Check whether a patch with these versions can be applied on top of the
+  /// current state. If it cannot, this returns the value that update() should
+  /// return.
+  std::optional<bool> check_versions(
+    const std::optional<Version> base_version,
+    const Version patch_version)
+  {
+    if (latest_version >= patch_version)
+    {
+      // This patch is older than or equal to the information this mirror
+      // already has, so it can safely be ignored.
+      return true;
+    }
+
+    if (base_version.has_value())
+    {
+      if (*base_version != latest_version)
+        return false;
+    }
+    else
+    {
+      // If the patch is assuming that we're starting from a blank slate, then
+      // we'll simply erase all the itineraries we currently have and apply the
+      // patch on top of a blank slate.
+      for (auto& [_, state] : states)
+      {
+        state.storage.clear();
+        state.skipped.clear();
+        state.itinerary_view = nullptr;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  /// Apply the changes for one participant. The additions will be given the
+  /// participant's state to add its routes into.
+  template<typename Additions>
+  void apply_participant(
+    const ParticipantId participant,
+    const ItineraryVersion itinerary_version,
+    const std::vector<StorageId>& erasures,
+    const std::optional<Duration> delay,
+    const PlanId plan_id,
+    const Additions& additions,
+    const std::optional<Change::Progress>& progress)
+  {
+    // Check if the mirror knows about this participant yet, and insert a blank
+    // participant state if it does not.
+    const auto insertion = states.insert({participant, {}});
+    const auto p_it = insertion.first;
+    ParticipantState& state = p_it->second;
+    state.itinerary_version = itinerary_version;
+    const auto newly_inserted = insertion.second;
+    if (newly_inserted)
+    {
+      // Unknown participant. We will create an empty description for it,
+      // unless the description already exists
+      const auto d_it = descriptions.insert({participant, {}}).first;
+      state.description = d_it->second;
+      participant_ids.insert(participant);
+    }
+
+    erase_routes(participant, state, erasures);
+
+    if (delay.has_value())
+      apply_delay(state, *delay);
+
+    if (state.current_plan_id != plan_id)
+      state.progress = Progress();
+
+    state.current_plan_id = plan_id;
+    additions(state);
+    state.progress.resize(state.storage.size() + state.skipped.size());
+
+    if (progress.has_value())
+    {
+      state.progress.reached_checkpoints = progress->checkpoints();
+      state.progress.version = progress->version();
+    }
+  }
+
+  void apply_cull(Time time);
+
+  void update_dependencies(
+    ParticipantId participant,
+    PlanId plan_id,
+    const std::optional<Change::Progress>& progress);
 };
 
 namespace {
@@ -177,9 +344,26 @@ class MirrorViewRelevanceInspector
 public:
 
   using RouteEntry = Mirror::Implementation::RouteEntry;
-  using Storage = Viewer::View::Implementation::Storage;
 
-  std::vector<Storage> routes;
+  Viewer::View::Implementation::Builder routes;
+
+  MirrorViewRelevanceInspector(bool pin_descriptions = true)
+  : routes(pin_descriptions)
+  {
+    // Do nothing
+  }
+
+  MirrorViewRelevanceInspector split() const
+  {
+    MirrorViewRelevanceInspector output;
+    output.routes = routes.split();
+    return output;
+  }
+
+  void merge(MirrorViewRelevanceInspector&& other)
+  {
+    routes.merge(std::move(other.routes));
+  }
 
   void inspect(
     const RouteEntry* entry,
@@ -189,14 +373,7 @@ public:
     assert(entry->route);
     if (relevant(*entry))
     {
-      routes.emplace_back(
-        Storage{
-          entry->participant,
-          entry->plan_id,
-          entry->route_id,
-          entry->route,
-          entry->description
-        });
+      routes.add(*entry);
     }
   }
 
@@ -242,14 +419,27 @@ Viewer::View Mirror::query(
   const Query::Spacetime& spacetime,
   const Query::Participants& participants) const
 {
-  MirrorViewRelevanceInspector inspector;
-  _pimpl->timeline.inspect(spacetime, participants, inspector);
-  return Viewer::View::Implementation::make_view(std::move(inspector.routes));
+  const auto lock = _pimpl->concurrency.read();
+
+  const auto inspect = [&]()
+    {
+      MirrorViewRelevanceInspector inspector;
+      _pimpl->timeline.inspect(spacetime, participants, inspector);
+      return std::move(inspector.routes).build();
+    };
+
+  if (!_pimpl->latest_version.has_value())
+    return inspect();
+
+  return _pimpl->query_cache.query(
+    spacetime, participants, *_pimpl->latest_version, inspect);
 }
 
 //==============================================================================
 const std::unordered_set<ParticipantId>& Mirror::participant_ids() const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   return _pimpl->participant_ids;
 }
 
@@ -257,6 +447,8 @@ const std::unordered_set<ParticipantId>& Mirror::participant_ids() const
 std::shared_ptr<const ParticipantDescription> Mirror::get_participant(
   std::size_t participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p = _pimpl->descriptions.find(participant_id);
   if (p == _pimpl->descriptions.end())
     return nullptr;
@@ -267,13 +459,23 @@ std::shared_ptr<const ParticipantDescription> Mirror::get_participant(
 //==============================================================================
 std::optional<Version> Mirror::latest_version() const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   return _pimpl->latest_version;
 }
 
+//==============================================================================
+std::optional<Version> Mirror::schedule_version() const
+{
+  return latest_version();
+}
+
 //==============================================================================
 std::optional<ItineraryView> Mirror::get_itinerary(
   const std::size_t participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p = _pimpl->states.find(participant_id);
   if (p == _pimpl->states.end())
   {
@@ -295,10 +497,42 @@ std::optional<ItineraryView> Mirror::get_itinerary(
   return itinerary;
 }
 
+//==============================================================================
+std::shared_ptr<const ItineraryView> Mirror::get_itinerary_view(
+  const ParticipantId participant_id) const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  const auto p = _pimpl->states.find(participant_id);
+  if (p == _pimpl->states.end())
+  {
+    // This matches the behavior of get_itinerary()
+    if (_pimpl->participant_ids.count(participant_id) > 0)
+      return std::make_shared<const ItineraryView>();
+
+    return nullptr;
+  }
+
+  const auto& state = p->second;
+  if (auto view = std::atomic_load(&state.itinerary_view))
+    return view;
+
+  auto itinerary = std::make_shared<ItineraryView>();
+  itinerary->reserve(state.storage.size());
+  for (const auto& s : state.storage)
+    itinerary->push_back(s.second.entry->route);
+
+  std::shared_ptr<const ItineraryView> view = std::move(itinerary);
+  std::atomic_store(&state.itinerary_view, view);
+  return view;
+}
+
 //==============================================================================
 std::optional<PlanId> Mirror::get_current_plan_id(
   const std::size_t participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p = _pimpl->states.find(participant_id);
   if (p == _pimpl->states.end())
     return std::nullopt;
@@ -310,6 +544,8 @@ std::optional<PlanId> Mirror::get_current_plan_id(
 const std::vector<CheckpointId>* Mirror::get_current_progress(
   ParticipantId participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p = _pimpl->states.find(participant_id);
   if (p == _pimpl->states.end())
     return nullptr;
@@ -323,6 +559,8 @@ auto Mirror::watch_dependency(
   std::function<void()> on_reached,
   std::function<void()> on_deprecated) const -> DependencySubscription
 {
+  const auto lock = _pimpl->concurrency.read();
+
   auto subscription = DependencySubscription::Implementation::make(
     dep, std::move(on_reached), std::move(on_deprecated));
 
@@ -367,6 +605,8 @@ auto Mirror::watch_dependency(
 ProgressVersion Mirror::get_current_progress_version(
   ParticipantId participant_id) const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   const auto p = _pimpl->states.find(participant_id);
   if (p == _pimpl->states.end())
     return 0;
@@ -376,6 +616,16 @@ ProgressVersion Mirror::get_current_progress_version(
 
 //==============================================================================
 std::shared_ptr<const Snapshot> Mirror::snapshot() const
+{
+  if (auto published = _pimpl->concurrency.published())
+    return published;
+
+  const auto lock = _pimpl->concurrency.read();
+  return _pimpl->make_snapshot();
+}
+
+//==============================================================================
+std::shared_ptr<const Snapshot> Mirror::Implementation::make_snapshot() const
 {
   using SnapshotType =
     SnapshotImplementation<
@@ -384,22 +634,37 @@ std::shared_ptr<const Snapshot> Mirror::snapshot() const
     >;
 
   return std::make_shared<SnapshotType>(
-    _pimpl->timeline.snapshot(nullptr),
-    _pimpl->participant_ids,
-    _pimpl->descriptions);
+    timeline.snapshot(nullptr),
+    participant_ids,
+    descriptions,
+    query_cache.get_capacity());
 }
 
 //==============================================================================
 Mirror::Mirror()
-: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+: Mirror(TimelineOptions())
 {
   // Do nothing
 }
 
+//==============================================================================
+Mirror::Mirror(
+  const TimelineOptions& timeline_options,
+  const Concurrency concurrency)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+{
+  _pimpl->timeline =
+    Timeline<const Implementation::RouteEntry>(timeline_options);
+  _pimpl->concurrency = ConcurrencyControl(concurrency);
+}
+
 //==============================================================================
 void Mirror::update_participants_info(
   const ParticipantDescriptionsMap& participants)
 {
+  const WriteScope<Implementation> write(*_pimpl);
+  bool changed = false;
+
   // First remove any participants that are no longer around.
   // We create a removed_ids list to start, because otherwise we would be
   // iterating through _pimpl->states while also erasing elements from it, which
@@ -419,6 +684,7 @@ void Mirror::update_participants_info(
     _pimpl->states.erase(id);
     _pimpl->descriptions.erase(id);
     _pimpl->participant_ids.erase(id);
+    changed = true;
   }
 
   // Next add-or-update all participants that are currently present
@@ -430,18 +696,31 @@ void Mirror::update_participants_info(
       // This is a new participant. We need to add a new state entry for it.
       // We do not add a state for it yet because we know nothing about its
       // routes or itinerary version.
-      const auto description_ptr =
-        std::make_shared<const ParticipantDescription>(description);
-      _pimpl->descriptions.insert({id, description_ptr});
+      const auto d_it = _pimpl->descriptions.find(id);
+      if (d_it != _pimpl->descriptions.end() && d_it->second
+        && *d_it->second == description)
+        continue;
+
+      _pimpl->descriptions[id] = intern_description(description);
       _pimpl->participant_ids.insert(id);
+      changed = true;
     }
     else
     {
+      // Most updates only touch a few participants, so the routes of the
+      // participants whose descriptions are unchanged are left alone. A
+      // participant that first arrived through a patch has no description.
+      const auto& current = p_it->second.description;
+      if (current && *current == description)
+        continue;
+
       // This is an existing participant. We need to overwrite the description
       // and then replace all the timeline entries with new ones that contain
       // the new description.
-      p_it->second.description =
-        std::make_shared<const ParticipantDescription>(description);
+      const auto description_ptr = intern_description(description);
+      p_it->second.description = description_ptr;
+      _pimpl->descriptions[id] = description_ptr;
+      changed = true;
 
       const auto participant_id = p_it->first;
       auto& state = p_it->second;
@@ -451,6 +730,7 @@ void Mirror::update_participants_info(
 
       // Clear out the state's copy of the route information
       state.storage.clear();
+      state.itinerary_view = nullptr;
 
       // Insert new routes that are equivalent to the old ones, but which have
       // the updated description.
@@ -463,138 +743,625 @@ void Mirror::update_participants_info(
       }
     }
   }
+
+  if (changed)
+    _pimpl->query_cache.clear();
 }
 
 //==============================================================================
-bool Mirror::update(const Patch& patch)
+void Mirror::Implementation::apply_cull(const Time time)
 {
-  if (_pimpl->latest_version >= patch.latest_version())
+  Query query = query_all();
+  query.spacetime().query_timespan().set_upper_time_bound(time);
+
+  MirrorCullRelevanceInspector inspector;
+  timeline.inspect(query.spacetime(), query.participants(), inspector);
+
+  for (const auto& route : inspector.info)
   {
-    // This patch is older than or equal to the information this mirror already
-    // has, so it can safely be ignored.
-    return true;
+    auto p_it = states.find(route.participant);
+    assert(p_it != states.end());
+    if (p_it == states.end())
+    {
+      std::cerr << "[Mirror::update] Non-existent participant ["
+                << route.participant << "] in timeline entry" << std::endl;
+      continue;
+    }
+
+    p_it->second.storage.erase(route.storage_id);
+    p_it->second.itinerary_view = nullptr;
   }
 
-  if (patch.base_version().has_value())
+  // Skipped routes are not in the timeline, so we cull them the same way
+  // that the timeline inspection would.
+  for (auto& [_, state] : states)
   {
-    if (*patch.base_version() != _pimpl->latest_version)
-      return false;
+    for (auto s_it = state.skipped.begin(); s_it != state.skipped.end(); )
+    {
+      if (s_it->second.has_value() && !(time < *s_it->second))
+        s_it = state.skipped.erase(s_it);
+      else
+        ++s_it;
+    }
   }
-  else
+}
+
+//==============================================================================
+void Mirror::Implementation::update_dependencies(
+  const ParticipantId participant,
+  const PlanId plan_id,
+  const std::optional<Change::Progress>& progress)
+{
+  dependencies.deprecate_dependencies_before(participant, plan_id);
+
+  if (progress.has_value())
+    dependencies.reached(participant, plan_id, progress->checkpoints());
+
+  // This is a hacky way of recognizing if a clear() has happened
+  const auto& state = states[participant];
+  if (state.storage.empty() && state.skipped.empty())
+    dependencies.deprecate_dependencies_before(participant, plan_id+1);
+}
+
+namespace {
+//==============================================================================
+std::optional<Duration> total_delay(const std::vector<Change::Delay>& delays)
+{
+  if (delays.empty())
+    return std::nullopt;
+
+  Duration total = Duration(0);
+  for (const auto& delay : delays)
+    total += delay.duration();
+
+  return total;
+}
+
+//==============================================================================
+std::optional<Duration> total_delay(const std::vector<Duration>& delays)
+{
+  if (delays.empty())
+    return std::nullopt;
+
+  Duration total = Duration(0);
+  for (const auto delay : delays)
+    total += delay;
+
+  return total;
+}
+
+//==============================================================================
+/// Collapses the changes of several consecutive patches into the net change
+/// for each participant, so that routes which would be added and then erased
+/// or delayed again within the batch never touch the timeline.
+class PatchCoalescer
+{
+public:
+
+  using Implementation = Mirror::Implementation;
+
+  PatchCoalescer(Implementation& mirror)
+  : _mirror(mirror)
   {
-    // If the patch is assuming that we're starting from a blank slate, then
-    // we'll simply erase all the itineraries we currently have and apply the
-    // patch on top of a blank slate.
-    for (auto& [_, state] : _pimpl->states)
-      state.storage.clear();
+    // Do nothing
   }
 
-  for (const auto& p : patch)
+  void add(const Patch::Participant& p)
   {
     const ParticipantId participant = p.participant_id();
+    auto& net = get(participant);
+    net.itinerary_version = p.itinerary_version();
 
-    // Check if the mirror knows about this participant yet, and insert a blank
-    // participant state if it does not.
-    const auto insertion = _pimpl->states.insert({participant, {}});
-    const auto p_it = insertion.first;
-    Implementation::ParticipantState& state = p_it->second;
-    state.itinerary_version = p.itinerary_version();
-    const auto newly_inserted = insertion.second;
-    if (newly_inserted)
-    {
-      // Unknown participant. We will create an empty description for it, unless
-      // the description already exists
-      const auto d_it = _pimpl->descriptions.insert({participant, {}}).first;
-      state.description = d_it->second;
-      _pimpl->participant_ids.insert(participant);
-    }
-
-    Implementation::erase_routes(participant, state, p.erasures());
+    for (const StorageId id : p.erasures().ids())
+      net.erase(id);
 
     for (const auto& delay : p.delays())
-      _pimpl->apply_delay(state, delay);
+      net.delay(delay.duration());
 
-    if (state.current_plan_id != p.additions().plan_id())
-      state.progress = Progress();
+    const PlanId plan_id = p.additions().plan_id();
+    if (net.plan_id != plan_id)
+    {
+      // Routes that were added for an earlier plan must keep their plan ID, so
+      // we apply them before moving on to the new plan.
+      if (!net.additions.empty())
+        flush(participant, net);
 
-    state.current_plan_id = p.additions().plan_id();
-    _pimpl->add_routes(participant, state, p.additions());
-    state.progress.resize(state.storage.size());
+      net.plan_id = plan_id;
+      net.progress = Progress();
+    }
+
+    for (const auto& item : p.additions().items())
+      net.add(item);
 
+    net.progress.resize(net.count);
     if (p.progress().has_value())
     {
-      state.progress.reached_checkpoints = p.progress()->checkpoints();
-      state.progress.version = p.progress()->version();
+      net.progress.reached_checkpoints = p.progress()->checkpoints();
+      net.progress.version = p.progress()->version();
     }
+
+    _dependencies.push_back({participant, plan_id, p.progress()});
   }
 
-  if (const Change::Cull* cull = patch.cull())
+  /// Apply all the net changes that have been collected so far
+  void flush()
+  {
+    for (auto& [participant, net] : _net)
+      flush(participant, net);
+
+    _net.clear();
+  }
+
+  /// Update the dependencies after all the changes have been applied
+  void update_dependencies()
   {
-    const Time time = cull->time();
-    Query query = query_all();
-    query.spacetime().query_timespan().set_upper_time_bound(time);
+    for (const auto& d : _dependencies)
+      _mirror.update_dependencies(d.participant, d.plan_id, d.progress);
+  }
+
+private:
 
-    MirrorCullRelevanceInspector inspector;
-    _pimpl->timeline.inspect(
-      query.spacetime(), query.participants(), inspector);
+  struct PendingRoute
+  {
+    RouteId route_id;
+    ConstRoutePtr route;
+    Duration delay;
+  };
+
+  struct Net
+  {
+    const Implementation::ParticipantState* state;
+    ItineraryVersion itinerary_version;
+    PlanId plan_id;
+    Progress progress;
 
-    for (const auto& route : inspector.info)
+    // Changes to the routes that are already in the mirror
+    std::unordered_set<StorageId> erased;
+    std::vector<StorageId> erasures;
+    std::optional<Duration> existing_delay;
+
+    // Routes that were added within the batch
+    std::unordered_map<StorageId, PendingRoute> additions;
+
+    // The number of routes that the participant would have
+    std::size_t count;
+
+    bool exists(const StorageId id) const
+    {
+      return state
+        && (state->storage.count(id) > 0 || state->skipped.count(id) > 0)
+        && erased.count(id) == 0;
+    }
+
+    void erase(const StorageId id)
     {
-      auto p_it = _pimpl->states.find(route.participant);
-      assert(p_it != _pimpl->states.end());
-      if (p_it == _pimpl->states.end())
+      const bool pending = additions.erase(id) > 0;
+      const bool existing = exists(id);
+      if (pending || existing)
+        --count;
+
+      // Unrecognized IDs are passed along too so that the mirror reports them
+      if (existing || !pending)
       {
-        std::cerr << "[Mirror::update] Non-existent participant ["
-                  << route.participant << "] in timeline entry" << std::endl;
-        continue;
+        if (erased.insert(id).second)
+          erasures.push_back(id);
       }
+    }
 
-      p_it->second.storage.erase(route.storage_id);
+    void delay(const Duration duration)
+    {
+      existing_delay = existing_delay.value_or(Duration(0)) + duration;
+      for (auto& [_, pending] : additions)
+        pending.delay += duration;
     }
+
+    void add(const Change::Add::Item& item)
+    {
+      const auto insertion = additions.insert(
+        {item.storage_id, PendingRoute{item.route_id, item.route, Duration(0)}});
+
+      if (!insertion.second)
+        insertion.first->second = {item.route_id, item.route, Duration(0)};
+      else if (!exists(item.storage_id))
+        ++count;
+    }
+  };
+
+  Net& get(const ParticipantId participant)
+  {
+    const auto it = _net.find(participant);
+    if (it != _net.end())
+      return it->second;
+
+    Net net;
+    const auto s_it = _mirror.states.find(participant);
+    net.state = s_it == _mirror.states.end() ? nullptr : &s_it->second;
+    if (net.state)
+    {
+      net.itinerary_version = net.state->itinerary_version;
+      net.plan_id = net.state->current_plan_id;
+      net.progress = net.state->progress;
+      net.count = net.state->storage.size() + net.state->skipped.size();
+    }
+    else
+    {
+      net.itinerary_version = 0;
+      net.plan_id = std::numeric_limits<PlanId>::max();
+      net.count = 0;
+    }
+
+    return _net.insert({participant, std::move(net)}).first->second;
+  }
+
+  void flush(const ParticipantId participant, Net& net)
+  {
+    Progress progress = net.progress;
+    _mirror.apply_participant(
+      participant,
+      net.itinerary_version,
+      net.erasures,
+      net.existing_delay,
+      net.plan_id,
+      [&](Implementation::ParticipantState& state)
+      {
+        for (auto& [storage_id, pending] : net.additions)
+        {
+          auto route = std::make_shared<Route>(*pending.route);
+          if (pending.delay != Duration(0))
+            RouteData::delay_route(*route, pending.delay);
+
+          if (!_mirror.keeps(*route))
+          {
+            Implementation::skip_route(state, storage_id, *route);
+            continue;
+          }
+
+          _mirror.add_route(
+            participant, state, pending.route_id, storage_id,
+            std::move(route));
+        }
+      },
+      std::nullopt);
+
+    // The progress was already worked out while the changes were collected
+    auto& state = _mirror.states.at(participant);
+    state.progress = std::move(progress);
+    state.progress.resize(state.storage.size() + state.skipped.size());
+
+    net.state = &state;
+    net.erased.clear();
+    net.erasures.clear();
+    net.existing_delay = std::nullopt;
+    net.additions.clear();
+    net.progress = state.progress;
+    net.count = state.storage.size() + state.skipped.size();
+  }
+
+  struct Dependency
+  {
+    ParticipantId participant;
+    PlanId plan_id;
+    std::optional<Change::Progress> progress;
+  };
+
+  Implementation& _mirror;
+  std::unordered_map<ParticipantId, Net> _net;
+  std::vector<Dependency> _dependencies;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+bool Mirror::update(const Patch& patch)
+{
+  const WriteScope<Implementation> write(*_pimpl);
+
+  if (const auto result = _pimpl->check_versions(
+      patch.base_version(), patch.latest_version()))
+    return *result;
+
+  for (const auto& p : patch)
+  {
+    const ParticipantId participant = p.participant_id();
+    _pimpl->apply_participant(
+      participant,
+      p.itinerary_version(),
+      p.erasures().ids(),
+      total_delay(p.delays()),
+      p.additions().plan_id(),
+      [&](Implementation::ParticipantState& state)
+      {
+        _pimpl->add_routes(participant, state, p.additions());
+      },
+      p.progress());
   }
 
+  if (const Change::Cull* cull = patch.cull())
+    _pimpl->apply_cull(cull->time());
+
   _pimpl->latest_version = patch.latest_version();
 
   for (const auto& p : patch)
   {
-    _pimpl->dependencies.deprecate_dependencies_before(
-      p.participant_id(), p.additions().plan_id());
+    _pimpl->update_dependencies(
+      p.participant_id(), p.additions().plan_id(), p.progress());
+  }
 
-    if (p.progress().has_value())
+  return true;
+}
+
+//==============================================================================
+bool Mirror::update(const std::vector<Patch>& patches)
+{
+  const WriteScope<Implementation> write(*_pimpl);
+
+  // A patch without a base version replaces everything that came before it,
+  // so the patches before the last one of those can be skipped entirely.
+  std::size_t first = 0;
+  for (std::size_t i = 0; i < patches.size(); ++i)
+  {
+    if (!patches[i].base_version().has_value())
+      first = i;
+  }
+
+  PatchCoalescer coalescer(*_pimpl);
+  bool okay = true;
+  for (std::size_t i = first; i < patches.size(); ++i)
+  {
+    const auto& patch = patches[i];
+    if (const auto result = _pimpl->check_versions(
+        patch.base_version(), patch.latest_version()))
     {
-      _pimpl->dependencies.reached(
-        p.participant_id(), p.additions().plan_id(),
-        p.progress()->checkpoints());
+      if (*result)
+        continue;
+
+      okay = false;
+      break;
     }
 
-    // This is a hacky way of recognizing if a clear() has happened
-    const auto& state = _pimpl->states[p.participant_id()];
-    if (state.storage.empty())
+    for (const auto& p : patch)
+      coalescer.add(p);
+
+    if (const Change::Cull* cull = patch.cull())
     {
-      _pimpl->dependencies.deprecate_dependencies_before(
-        p.participant_id(), p.additions().plan_id()+1);
+      // The cull needs to see the routes exactly as they are at this point
+      coalescer.flush();
+      _pimpl->apply_cull(cull->time());
     }
+
+    _pimpl->latest_version = patch.latest_version();
   }
 
+  coalescer.flush();
+  coalescer.update_dependencies();
+
+  return okay;
+}
+
+//==============================================================================
+bool Mirror::update(const PatchView& patch)
+{
+  const WriteScope<Implementation> write(*_pimpl);
+
+  const auto& view = PatchView::Implementation::get(patch);
+  if (const auto result = _pimpl->check_versions(
+      view.base_version, view.latest_version))
+    return *result;
+
+  struct Applied
+  {
+    ParticipantId participant;
+    PlanId plan_id;
+    std::optional<Change::Progress> progress;
+  };
+
+  std::vector<Applied> applied;
+  applied.reserve(view.participant_count);
+
+  view.for_each_participant(
+    [&](codec::ParticipantChanges& changes)
+    {
+      const ParticipantId participant = changes.id;
+      _pimpl->apply_participant(
+        participant,
+        changes.itinerary_version,
+        changes.erasures,
+        total_delay(changes.delays),
+        changes.plan_id,
+        [&](Implementation::ParticipantState& state)
+        {
+          // The decoded routes are not shared with anything else, so the
+          // mirror can take them without making copies.
+          for (auto& item : changes.additions)
+          {
+            if (!_pimpl->keeps(*item.route))
+            {
+              Implementation::skip_route(state, item.storage_id, *item.route);
+              continue;
+            }
+
+            _pimpl->add_route(
+              participant, state, item.route_id, item.storage_id,
+              std::move(item.route));
+          }
+        },
+        changes.progress);
+
+      applied.push_back(
+        Applied{participant, changes.plan_id, std::move(changes.progress)});
+    });
+
+  if (view.cull.has_value())
+    _pimpl->apply_cull(*view.cull);
+
+  _pimpl->latest_version = view.latest_version;
+
+  for (const auto& a : applied)
+    _pimpl->update_dependencies(a.participant, a.plan_id, a.progress);
+
   return true;
 }
 
 //==============================================================================
 void Mirror::reset()
 {
-  _pimpl->latest_version = std::nullopt;
-  for (auto& [id, state] : _pimpl->states)
+  const WriteScope<Implementation> write(*_pimpl);
+  _pimpl->reset();
+}
+
+//==============================================================================
+void Mirror::Implementation::reset()
+{
+  latest_version = std::nullopt;
+  query_cache.clear();
+  for (auto& [id, state] : states)
   {
     state.storage.clear();
+    state.skipped.clear();
+    state.itinerary_view = nullptr;
     state.highest_storage = std::nullopt;
     state.current_plan_id = std::numeric_limits<PlanId>::max();
     state.itinerary_version = 0;
   }
 }
 
+//==============================================================================
+void Mirror::subscribe_to_maps(std::unordered_set<std::string> maps)
+{
+  const WriteScope<Implementation> write(*_pimpl);
+
+  bool widened = false;
+  if (_pimpl->maps.has_value())
+  {
+    for (const auto& map : maps)
+    {
+      if (_pimpl->maps->count(map) == 0)
+      {
+        widened = true;
+        break;
+      }
+    }
+  }
+
+  _pimpl->map_ids.clear();
+  for (const auto& map : maps)
+    _pimpl->map_ids.insert(MapName(map).id());
+
+  _pimpl->maps = std::move(maps);
+  _pimpl->query_cache.clear();
+
+  if (widened)
+  {
+    // We never kept the routes of the new maps, so we need a full update.
+    _pimpl->reset();
+    return;
+  }
+
+  // Drop the routes that should no longer be kept, but remember their storage
+  // IDs so that the progress of each plan stays consistent.
+  for (auto& [_, state] : _pimpl->states)
+  {
+    for (auto s_it = state.storage.begin(); s_it != state.storage.end(); )
+    {
+      const auto& route = *s_it->second.entry->route;
+      if (_pimpl->keeps(route))
+      {
+        ++s_it;
+        continue;
+      }
+
+      Implementation::skip_route(state, s_it->first, route);
+      s_it = state.storage.erase(s_it);
+      state.itinerary_view = nullptr;
+    }
+  }
+}
+
+//==============================================================================
+void Mirror::subscribe_to_all_maps()
+{
+  const WriteScope<Implementation> write(*_pimpl);
+  if (!_pimpl->maps.has_value())
+    return;
+
+  _pimpl->maps = std::nullopt;
+  _pimpl->map_ids.clear();
+  _pimpl->reset();
+}
+
+//==============================================================================
+std::optional<std::unordered_set<std::string>> Mirror::subscribed_maps() const
+{
+  const auto lock = _pimpl->concurrency.read();
+  return _pimpl->maps;
+}
+
+//==============================================================================
+void Mirror::set_query_cache_capacity(const std::size_t capacity)
+{
+  _pimpl->query_cache.set_capacity(capacity);
+}
+
+//==============================================================================
+std::size_t Mirror::get_query_cache_capacity() const
+{
+  return _pimpl->query_cache.get_capacity();
+}
+
+//==============================================================================
+MemoryUsage Mirror::memory_usage() const
+{
+  const auto lock = _pimpl->concurrency.read();
+
+  using RouteEntry = Implementation::RouteEntry;
+  using Entries = Timeline<const RouteEntry>;
+
+  MemoryUsage usage;
+  usage.participants.reserve(_pimpl->participant_ids.size());
+  for (const auto& [participant, state] : _pimpl->states)
+  {
+    auto& memory = usage.participants[participant];
+    memory.routes = sizeof(Implementation::ParticipantState)
+      + internal::hash_table_bytes(state.storage)
+      + internal::hash_table_bytes(state.skipped);
+
+    for (const auto& [_, storage] : state.storage)
+    {
+      if (!storage.entry)
+        continue;
+
+      memory.routes += internal::shared_object_bytes<RouteEntry>()
+        + Entries::handle_memory_usage(storage.timeline_handle);
+
+      if (storage.entry->route)
+      {
+        memory.routes += internal::shared_object_bytes<Route>()
+          + RouteData::memory_usage(*storage.entry->route);
+      }
+    }
+  }
+
+  for (const auto& [map, bucket_memory] : _pimpl->timeline.map_memory_usage())
+  {
+    auto& memory = usage.maps[MapName::str(map)];
+    memory.buckets = bucket_memory.buckets;
+    memory.bytes = bucket_memory.bytes;
+  }
+
+  usage.shared = sizeof(Implementation)
+    + _pimpl->timeline.shared_memory_usage()
+    + internal::hash_table_bytes(_pimpl->descriptions)
+    + internal::hash_table_bytes(_pimpl->participant_ids)
+    + internal::hash_table_bytes(_pimpl->map_ids);
+
+  return usage;
+}
+
 //==============================================================================
 Database Mirror::fork() const
 {
+  const auto lock = _pimpl->concurrency.read();
+
   Database output;
 
   try
@@ -17,11 +17,20 @@
 
 #include <rmf_traffic/schedule/Negotiation.hpp>
 
+#include <rmf_traffic/DetectConflict.hpp>
+
 #include "Timeline.hpp"
 #include "ViewerInternal.hpp"
+#include "internal_Query.hpp"
+#include "internal_QueryCache.hpp"
+#include "internal_WorkerPool.hpp"
+#include "../debug/internal_Trace.hpp"
 
 #include <rmf_utils/Modular.hpp>
 
+#include <atomic>
+#include <mutex>
+
 namespace rmf_traffic {
 namespace schedule {
 namespace {
@@ -66,6 +75,9 @@ std::size_t termination_factor(
   return factorial(num_participants - depth);
 }
 
+//==============================================================================
+struct StubbornParticipant;
+
 //==============================================================================
 struct NegotiationData
 {
@@ -81,7 +93,90 @@ struct NegotiationData
 
   std::unordered_set<Negotiation::Table::Implementation*> forfeited_tables;
 
-  void clear_successful_descendants_of(
+  /// Results of queries of the schedule viewer, shared by every table
+  std::shared_ptr<QueryCache> base_query_cache =
+    std::make_shared<QueryCache>();
+
+  Negotiation::Statistics statistics;
+
+  /// The participants that were declared stubborn with set_stubborn()
+  std::unordered_map<ParticipantId, std::shared_ptr<const StubbornParticipant>>
+  stubborn;
+
+  struct SequenceHash
+  {
+    std::size_t operator()(const std::vector<ParticipantId>& sequence) const
+    {
+      std::size_t seed = sequence.size();
+      for (const auto p : sequence)
+        hash_combine(seed, std::hash<ParticipantId>()(p));
+
+      return seed;
+    }
+  };
+
+  /// Every table that is still part of the negotiation, keyed by the sequence
+  /// of participants that leads to it. There is only ever one live table for
+  /// each sequence, so tables can be found without descending through every
+  /// level of the tree.
+  std::unordered_map<
+    std::vector<ParticipantId>,
+    std::weak_ptr<Negotiation::Table>,
+    SequenceHash> table_index;
+
+  static std::vector<ParticipantId> participants_of(
+    const Negotiation::VersionedKeySequence& sequence)
+  {
+    std::vector<ParticipantId> output;
+    output.reserve(sequence.size());
+    for (const auto& key : sequence)
+      output.push_back(key.participant);
+
+    return output;
+  }
+
+  void index_table(
+    const Negotiation::VersionedKeySequence& sequence,
+    const std::shared_ptr<Negotiation::Table>& table)
+  {
+    table_index[participants_of(sequence)] = table;
+  }
+
+  void unindex_table(
+    const Negotiation::VersionedKeySequence& sequence,
+    const Negotiation::Table* table)
+  {
+    const auto it = table_index.find(participants_of(sequence));
+    if (it == table_index.end())
+      return;
+
+    // A newer table may have taken this sequence over already
+    const auto indexed = it->second.lock();
+    if (!indexed || indexed.get() == table)
+      table_index.erase(it);
+  }
+
+  Negotiation::TablePtr find_indexed(
+    const std::vector<ParticipantId>& sequence) const
+  {
+    const auto it = table_index.find(sequence);
+    if (it == table_index.end())
+      return nullptr;
+
+    return it->second.lock();
+  }
+
+  const StubbornParticipant* get_stubborn(const ParticipantId p) const
+  {
+    const auto it = stubborn.find(p);
+    if (it == stubborn.end())
+      return nullptr;
+
+    return it->second.get();
+  }
+
+  /// Returns how many successful tables were erased
+  std::size_t clear_successful_descendants_of(
     const Negotiation::VersionedKeySequence& sequence)
   {
     const auto erase_it = std::remove_if(
@@ -98,10 +193,194 @@ struct NegotiationData
         return true;
       });
 
+    const std::size_t erased =
+      static_cast<std::size_t>(successful_tables.end() - erase_it);
     successful_tables.erase(erase_it, successful_tables.end());
+    return erased;
   }
 };
 
+//==============================================================================
+/// True if any route of the submission is in conflict with any of the routes
+/// in the changes
+bool in_conflict(
+  const Negotiation::Submission& submission,
+  const ParticipantDescription& description,
+  const Viewer::View& changes)
+{
+  for (std::size_t i = 0; i < submission.itinerary.size(); ++i)
+  {
+    const Route& route = submission.itinerary[i];
+    if (route.trajectory().size() < 2)
+      continue;
+
+    for (const auto& other : changes)
+    {
+      if (!RouteData::same_map(*other.route, route))
+        continue;
+
+      if (other.route->trajectory().size() < 2)
+        continue;
+
+      const auto conflict = DetectConflict::between(
+        description.profile(),
+        route.trajectory(),
+        route.check_dependencies(
+          other.participant, other.plan_id, other.route_id),
+        other.description.profile(),
+        other.route->trajectory(),
+        other.route->check_dependencies(
+          submission.participant, submission.plan, i));
+
+      if (conflict.has_value())
+        return true;
+    }
+  }
+
+  return false;
+}
+
+//==============================================================================
+std::optional<Time> get_finish_time(const Itinerary& itinerary)
+{
+  std::optional<Time> finish_time;
+  for (const auto& route : itinerary)
+  {
+    const auto* t = route.trajectory().finish_time();
+    if (!t)
+      continue;
+
+    if (!finish_time)
+      finish_time = *route.trajectory().finish_time();
+    else
+    {
+      if (*t < *finish_time)
+        finish_time = *t;
+    }
+  }
+
+  return finish_time;
+}
+
+//==============================================================================
+/// An immutable chain of submissions. Each table links its own submission onto
+/// the chain of its parent, so the itineraries of a proposal are shared by
+/// every table that branches off of it instead of being copied into each one.
+class ProposalChain
+{
+public:
+
+  struct Node
+  {
+    Node(std::shared_ptr<const Node> parent_, Negotiation::Submission sub)
+    : parent(std::move(parent_)),
+      submission(std::move(sub)),
+      summary{submission.participant, get_finish_time(submission.itinerary)}
+    {
+      // Do nothing
+    }
+
+    std::shared_ptr<const Node> parent;
+    Negotiation::Submission submission;
+
+    // Summarized when the submission arrives so that evaluating the
+    // negotiation never needs to look through the itinerary again
+    Negotiation::SubmissionSummary summary;
+  };
+
+  using ConstNodePtr = std::shared_ptr<const Node>;
+
+  /// Make a chain that ends with the given node
+  explicit ProposalChain(ConstNodePtr tail)
+  : _tail(std::move(tail)),
+    _size(0)
+  {
+    for (auto node = _tail.get(); node; node = node->parent.get())
+      ++_size;
+  }
+
+  /// Make a chain that links a new submission onto the end of this one
+  std::shared_ptr<const ProposalChain> extend(
+    Negotiation::Submission submission) const
+  {
+    return std::make_shared<ProposalChain>(
+      std::make_shared<Node>(_tail, std::move(submission)));
+  }
+
+  const ConstNodePtr& tail() const
+  {
+    return _tail;
+  }
+
+  std::size_t size() const
+  {
+    return _size;
+  }
+
+  /// Get a pointer to a route of a node that keeps the node alive without
+  /// copying the route.
+  static ConstRoutePtr route(const ConstNodePtr& node, std::size_t index)
+  {
+    return ConstRoutePtr(node, &node->submission.itinerary.at(index));
+  }
+
+  /// Visit each node of the chain in the order they were submitted
+  template<typename F>
+  void for_each(F&& f) const
+  {
+    std::vector<const ConstNodePtr*> nodes;
+    nodes.reserve(_size);
+    for (auto node = &_tail; *node; node = &(*node)->parent)
+      nodes.push_back(node);
+
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+      f(**it);
+  }
+
+  /// Get the whole chain as a Proposal. This is only computed the first time
+  /// it is asked for, because it copies every itinerary of the chain.
+  const Negotiation::Proposal& proposal() const
+  {
+    std::call_once(_once, [&]()
+      {
+        _proposal.reserve(_size);
+        for_each([&](const ConstNodePtr& node)
+          {
+            _proposal.push_back(node->submission);
+          });
+      });
+
+    return _proposal;
+  }
+
+  /// Get the summaries of the whole chain. Like proposal(), this is only
+  /// assembled the first time it is asked for.
+  const Negotiation::ProposalSummary& summary() const
+  {
+    std::call_once(_summary_once, [&]()
+      {
+        _summary.reserve(_size);
+        for_each([&](const ConstNodePtr& node)
+          {
+            _summary.push_back(node->summary);
+          });
+      });
+
+    return _summary;
+  }
+
+private:
+  ConstNodePtr _tail;
+  std::size_t _size;
+  mutable std::once_flag _once;
+  mutable Negotiation::Proposal _proposal;
+  mutable std::once_flag _summary_once;
+  mutable Negotiation::ProposalSummary _summary;
+};
+
+using ConstProposalChainPtr = std::shared_ptr<const ProposalChain>;
+
+//==============================================================================
 using AlternativeTimelinePtr =
   std::shared_ptr<const TimelineView<const BaseRouteEntry>>;
 
@@ -109,6 +388,78 @@ using AlternativesTimelineMap = std::vector<AlternativeTimelinePtr>;
 using ParticipantToAlternativesMap =
   std::unordered_map<ParticipantId, AlternativesTimelineMap>;
 
+//==============================================================================
+/// Everything a table needs to resolve itself on behalf of a stubborn
+/// participant. The rollout that gets offered when the participant rejects a
+/// proposal is its one itinerary, so the timeline of that rollout is made once
+/// and shared by every rejection.
+struct StubbornParticipant
+{
+  Negotiation::Submission submission;
+  std::shared_ptr<const ParticipantDescription> description;
+  std::shared_ptr<Negotiation::Alternatives> rollouts;
+  AlternativesTimelineMap rollout_timelines;
+};
+
+//==============================================================================
+/// True if any route of the submission is in conflict with the submissions of
+/// the proposal. Unresponsive participants are ignored, the same way that
+/// StubbornNegotiator ignores them.
+bool in_conflict(
+  const Negotiation::Submission& submission,
+  const ParticipantDescription& description,
+  const ProposalChain& proposal,
+  const Viewer& schedule_viewer)
+{
+  bool conflict = false;
+  proposal.for_each([&](const ProposalChain::ConstNodePtr& node)
+    {
+      if (conflict)
+        return;
+
+      const auto& other = node->submission;
+      const auto other_description =
+        schedule_viewer.get_participant(other.participant);
+      if (!other_description)
+        return;
+
+      if (other_description->responsiveness()
+      == ParticipantDescription::Rx::Unresponsive)
+        return;
+
+      for (std::size_t i = 0; i < submission.itinerary.size() && !conflict; ++i)
+      {
+        const Route& route = submission.itinerary[i];
+        if (route.trajectory().size() < 2)
+          continue;
+
+        for (std::size_t j = 0; j < other.itinerary.size(); ++j)
+        {
+          const Route& other_route = other.itinerary[j];
+          if (!RouteData::same_map(other_route, route))
+            continue;
+
+          if (other_route.trajectory().size() < 2)
+            continue;
+
+          conflict = DetectConflict::between(
+            description.profile(),
+            route.trajectory(),
+            route.check_dependencies(other.participant, other.plan, j),
+            other_description->profile(),
+            other_route.trajectory(),
+            other_route.check_dependencies(
+              submission.participant, submission.plan, i)).has_value();
+
+          if (conflict)
+            break;
+        }
+      }
+    });
+
+  return conflict;
+}
+
 } // anonymous namespace
 
 //==============================================================================
@@ -181,15 +532,16 @@ public:
   AlternativeTimelinePtr proposed_timeline;
   ParticipantToAlternativesMap alternatives_timelines;
   AlternativeMap alternatives;
-  std::shared_ptr<Proposal> base_proposals;
+  ConstProposalChainPtr base_proposals;
   std::shared_ptr<Query::Participants> participant_query;
   std::shared_ptr<const schedule::Viewer> schedule_viewer;
+  std::shared_ptr<QueryCache> base_query_cache;
   rmf_utils::optional<ParticipantId> parent_id;
   VersionedKeySequence sequence;
-  std::shared_ptr<const bool> defunct;
+  std::shared_ptr<const std::atomic_bool> defunct;
   bool rejected;
   bool forfeited;
-  std::optional<Itinerary> itinerary;
+  ProposalChain::ConstNodePtr submission;
 
   std::unordered_map<ParticipantId, Endpoint> initial_endpoints = {};
   std::unordered_map<ParticipantId, Endpoint> final_endpoints = {};
@@ -321,25 +673,26 @@ private:
 
   void _make_endpoints()
   {
-    std::unordered_map<ParticipantId, ConstRoutePtr> initial;
-    for (const auto& p : *base_proposals)
-    {
-      const auto& description = schedule_viewer->get_participant(p.participant);
-
-      insert_initial_endpoint(
-        initial_endpoints,
-        p.participant,
-        p.plan,
-        description,
-        p.itinerary);
-
-      insert_final_endpoint(
-        final_endpoints,
-        p.participant,
-        p.plan,
-        description,
-        p.itinerary);
-    }
+    base_proposals->for_each([&](const ProposalChain::ConstNodePtr& node)
+      {
+        const auto& p = node->submission;
+        const auto& description =
+          schedule_viewer->get_participant(p.participant);
+
+        insert_initial_endpoint(
+          initial_endpoints,
+          p.participant,
+          p.plan,
+          description,
+          p.itinerary);
+
+        insert_final_endpoint(
+          final_endpoints,
+          p.participant,
+          p.plan,
+          description,
+          p.itinerary);
+      });
   }
 
 };
@@ -355,7 +708,7 @@ class DefunctFlag
 public:
 
   DefunctFlag()
-  : _defunct(std::make_shared<bool>(false))
+  : _defunct(std::make_shared<std::atomic_bool>(false))
   {
     // Do nothing
   }
@@ -377,7 +730,7 @@ public:
     return *_defunct;
   }
 
-  std::shared_ptr<const bool> get() const
+  std::shared_ptr<const std::atomic_bool> get() const
   {
     return _defunct;
   }
@@ -388,7 +741,7 @@ public:
   }
 
 private:
-  std::shared_ptr<bool> _defunct;
+  std::shared_ptr<std::atomic_bool> _defunct;
 };
 } // anonymous namespace
 
@@ -399,7 +752,7 @@ public:
 
   using TableMap = std::unordered_map<ParticipantId, std::shared_ptr<Table>>;
 
-  std::shared_ptr<const schedule::Viewer> const schedule_viewer;
+  std::shared_ptr<const schedule::Viewer> schedule_viewer;
   VersionedKeySequence sequence;
   std::vector<ParticipantId> unsubmitted;
 
@@ -414,14 +767,18 @@ public:
   // operations
   mutable ViewerPtr cached_table_viewer;
 
-  std::shared_ptr<Proposal> base_proposals;
-  Proposal proposal;
+  // The submissions of the ancestors of this table
+  ConstProposalChainPtr base_proposals;
+
+  // The submissions of the ancestors of this table, followed by the submission
+  // of this table if it has one
+  ConstProposalChainPtr proposal;
 
   const ParticipantId participant;
   const std::size_t depth;
-  // TODO(MXG): Do we really need this `itinerary` field when it's duplicated
-  // at the back of the `proposal` field?
-  std::optional<Itinerary> itinerary;
+
+  // The submission of this table, which is the tail of `proposal`
+  ProposalChain::ConstNodePtr submission;
   bool rejected = false;
   bool forfeited = false;
   DefunctFlag defunct;
@@ -449,43 +806,52 @@ public:
     std::size_t depth_,
     VersionedKeySequence submitted_,
     std::vector<ParticipantId> unsubmitted_,
-    Proposal initial_proposal_,
+    ConstProposalChainPtr initial_proposal_,
     TablePtr parent_)
   : schedule_viewer(std::move(schedule_viewer_)),
     unsubmitted(std::move(unsubmitted_)),
-    base_proposals(std::make_shared<Proposal>(std::move(initial_proposal_))),
-    proposal(*base_proposals),
+    base_proposals(std::move(initial_proposal_)),
+    proposal(base_proposals),
     participant(participant_),
     depth(depth_),
     weak_negotiation_data(negotiation_data_),
     weak_owner(owner_),
     weak_parent(std::move(parent_))
   {
+    if (negotiation_data_)
+    {
+      auto& stats = negotiation_data_->statistics;
+      ++stats.tables_created;
+      if (stats.tables_per_depth.size() < depth)
+        stats.tables_per_depth.resize(depth, 0);
+
+      ++stats.tables_per_depth[depth-1];
+    }
+
     std::vector<std::shared_ptr<void>> handles;
     Timeline<BaseRouteEntry> timeline_builder;
 
-    for (const auto& p : proposal)
-    {
-      const ParticipantId participant = p.participant;
-      const auto description = schedule_viewer->get_participant(participant);
-
-      for (std::size_t i = 0; i < p.itinerary.size(); ++i)
+    base_proposals->for_each([&](const ProposalChain::ConstNodePtr& node)
       {
-        const auto& route = p.itinerary[i];
+        const auto& p = node->submission;
+        const ParticipantId participant = p.participant;
+        const auto description = schedule_viewer->get_participant(participant);
 
-        auto entry = std::make_shared<BaseRouteEntry>(
-          BaseRouteEntry{
-            std::make_shared<Route>(route),
-            participant,
-            p.plan,
-            i,
-            i,
-            description
-          });
-
-        handles.push_back(timeline_builder.insert(entry));
-      }
-    }
+        for (std::size_t i = 0; i < p.itinerary.size(); ++i)
+        {
+          auto entry = std::make_shared<BaseRouteEntry>(
+            BaseRouteEntry{
+              ProposalChain::route(node, i),
+              participant,
+              p.plan,
+              i,
+              i,
+              description
+            });
+
+          handles.push_back(timeline_builder.insert(entry));
+        }
+      });
 
     proposed_timeline = timeline_builder.snapshot(nullptr);
 
@@ -527,7 +893,7 @@ public:
 
     unsubmitted.push_back(new_participant);
 
-    if (itinerary)
+    if (submission)
     {
       // If we already have a submission for this table, then immediately add
       // a descendent for this new participant.
@@ -537,8 +903,8 @@ public:
 
   void make_descendants()
   {
-    assert(itinerary.has_value());
-    assert(proposal.size() == depth);
+    assert(submission);
+    assert(proposal->size() == depth);
 
     assert(std::find(unsubmitted.begin(),
       unsubmitted.end(), participant) == unsubmitted.end());
@@ -555,7 +921,12 @@ public:
       table, weak_negotiation_data.lock(), schedule_viewer, p, depth+1,
       sequence, unsubmitted, proposal, weak_owner.lock());
 
-    descendants.insert(std::make_pair(p, std::move(table)));
+    const auto insertion = descendants.insert(std::make_pair(p, table));
+    if (!insertion.second)
+      return;
+
+    if (const auto negotiation_data = weak_negotiation_data.lock())
+      negotiation_data->index_table(table->_pimpl->sequence, table);
   }
 
   static TablePtr make_root(
@@ -568,7 +939,11 @@ public:
     table->_pimpl = rmf_utils::make_unique_impl<Implementation>(
       Implementation(
         table, negotiation_data, std::move(schedule_viewer),
-        participant, 1, {}, participants, {}, nullptr));
+        participant, 1, {}, participants,
+        std::make_shared<ProposalChain>(nullptr), nullptr));
+
+    if (negotiation_data)
+      negotiation_data->index_table(table->_pimpl->sequence, table);
 
     return table;
   }
@@ -593,7 +968,7 @@ public:
 
     version() = new_version;
 
-    const bool had_itinerary = itinerary.has_value();
+    const bool had_itinerary = submission != nullptr;
     bool formerly_successful = false;
 
     const auto negotiation_data = weak_negotiation_data.lock();
@@ -610,19 +985,16 @@ public:
       formerly_successful = true;
     }
 
-    itinerary = std::move(new_itinerary);
     rejected = false;
     forfeited = false;
+    cached_table_viewer.reset();
 
     if (had_itinerary)
-    {
-      proposal.back() = {participant, plan_id, *itinerary};
       clear_descendants();
-    }
-    else
-    {
-      proposal.push_back({participant, plan_id, *itinerary});
-    }
+
+    proposal = base_proposals->extend(
+      {participant, plan_id, std::move(new_itinerary)});
+    submission = proposal->tail();
 
     make_descendants();
 
@@ -635,15 +1007,87 @@ public:
       negotiation_data->num_terminated_tables += 1;
     }
 
+    if (negotiation_data)
+      resolve_stubborn_descendants(*negotiation_data);
+
     return true;
   }
 
+  // Stubborn participants always submit the same itinerary, so their tables
+  // are resolved as soon as they are made instead of waiting for a response.
+  void resolve_stubborn_descendants(const NegotiationData& negotiation_data)
+  {
+    if (negotiation_data.stubborn.empty())
+      return;
+
+    std::vector<TablePtr> stubborn_tables;
+    for (const auto& [p, table] : descendants)
+    {
+      if (negotiation_data.get_stubborn(p))
+        stubborn_tables.push_back(table);
+    }
+
+    for (const auto& table : stubborn_tables)
+    {
+      // Resolving one of the tables might have rejected this table, which
+      // makes the rest of its descendants defunct.
+      if (!submission)
+        return;
+
+      table->_pimpl->resolve_stubborn(negotiation_data);
+    }
+  }
+
+  // Submit the itinerary of the stubborn participant of this table if it fits
+  // the proposal. Otherwise the parent table gets rejected with that itinerary
+  // as the only rollout, or forfeited if its participant is stubborn too.
+  void resolve_stubborn(const NegotiationData& negotiation_data)
+  {
+    const auto* stubborn = negotiation_data.get_stubborn(participant);
+    assert(stubborn);
+
+    const auto parent = weak_parent.lock();
+    if (parent && in_conflict(
+        stubborn->submission, *stubborn->description,
+        *base_proposals, *schedule_viewer))
+    {
+      auto& parent_impl = *parent->_pimpl;
+      if (negotiation_data.get_stubborn(parent_impl.participant))
+      {
+        parent_impl.forfeit(parent_impl.version());
+      }
+      else
+      {
+        parent_impl.reject(
+          parent_impl.version(), participant,
+          stubborn->rollouts, stubborn->rollout_timelines);
+      }
+
+      return;
+    }
+
+    if (const auto data = weak_negotiation_data.lock())
+      ++data->statistics.stubborn_submissions;
+
+    submit(
+      stubborn->submission.plan, stubborn->submission.itinerary,
+      version() + 1);
+  }
+
   AlternativesTimelineMap to_timelines(
     const ParticipantId participant,
     const Alternatives& alternatives) const
+  {
+    return to_timelines(
+      participant, schedule_viewer->get_participant(participant), alternatives);
+  }
+
+  static AlternativesTimelineMap to_timelines(
+    const ParticipantId participant,
+    const std::shared_ptr<const ParticipantDescription>& description,
+    const Alternatives& alternatives)
   {
     AlternativesTimelineMap output;
-    const auto description = schedule_viewer->get_participant(participant);
 
     for (const auto& alternative : alternatives)
     {
@@ -680,6 +1124,22 @@ public:
     const Version rejected_version,
     ParticipantId rejected_by,
     Alternatives offered_alternatives)
+  {
+    if (rmf_utils::modular(rejected_version).less_than(version()))
+      return false;
+
+    auto timelines = to_timelines(rejected_by, offered_alternatives);
+    return reject(
+      rejected_version, rejected_by,
+      std::make_shared<Alternatives>(std::move(offered_alternatives)),
+      std::move(timelines));
+  }
+
+  bool reject(
+    const Version rejected_version,
+    ParticipantId rejected_by,
+    std::shared_ptr<Alternatives> offered_alternatives,
+    AlternativesTimelineMap offered_timelines)
   {
     // TODO(MXG): I should also keep track of the rejection version of the
     // rejecter. That way we can correctly identify if the offered_alternatives
@@ -689,11 +1149,12 @@ public:
 
     cached_table_viewer.reset();
 
-    alternatives_timelines[rejected_by] =
-      to_timelines(rejected_by, offered_alternatives);
+    alternatives_timelines[rejected_by] = std::move(offered_timelines);
+
+    if (const auto negotiation_data = weak_negotiation_data.lock())
+      ++negotiation_data->statistics.rejections;
 
-    this->alternatives[rejected_by] =
-      std::make_shared<Alternatives>(std::move(offered_alternatives));
+    this->alternatives[rejected_by] = std::move(offered_alternatives);
 
     version() = rejected_version;
 
@@ -704,7 +1165,7 @@ public:
       return true;
 
     const auto negotiation_data = weak_negotiation_data.lock();
-    if (itinerary && descendants.empty() && negotiation_data)
+    if (submission && descendants.empty() && negotiation_data)
     {
       // This used to be a successfully completed negotiation table.
       // TODO(MXG): It's a bit suspicious that a successfully completed
@@ -713,10 +1174,10 @@ public:
       negotiation_data->num_terminated_tables -= 1;
     }
 
-    if (itinerary)
+    if (submission)
     {
-      itinerary = rmf_utils::nullopt;
-      proposal.pop_back();
+      submission = nullptr;
+      proposal = base_proposals;
     }
 
     rejected = true;
@@ -743,8 +1204,10 @@ public:
     if (forfeited)
       return;
 
+    cached_table_viewer.reset();
+
     const auto negotiation_data = weak_negotiation_data.lock();
-    if (itinerary && descendants.empty() && negotiation_data)
+    if (submission && descendants.empty() && negotiation_data)
     {
       // This used to be a successfully completed negotiation table.
       // TODO(MXG): It's a bit suspicious that a successfully completed
@@ -753,10 +1216,10 @@ public:
       negotiation_data->num_terminated_tables -= 1;
     }
 
-    if (itinerary)
+    if (submission)
     {
-      itinerary = std::nullopt;
-      proposal.pop_back();
+      submission = nullptr;
+      proposal = base_proposals;
     }
 
     forfeited = true;
@@ -764,6 +1227,7 @@ public:
 
     if (negotiation_data)
     {
+      ++negotiation_data->statistics.forfeits;
       negotiation_data->num_terminated_tables +=
         termination_factor(depth, negotiation_data->participants.size());
       negotiation_data->forfeited_tables.insert(this);
@@ -772,6 +1236,29 @@ public:
     }
   }
 
+  // Throw out the submission of this table because it no longer fits the
+  // schedule. The table goes back to waiting for a response, with a newer
+  // version so that stale responses to it will be turned away.
+  void invalidate()
+  {
+    assert(submission);
+
+    submission = nullptr;
+    proposal = base_proposals;
+    cached_table_viewer.reset();
+    clear_descendants();
+    ++version();
+
+    if (const auto negotiation_data = weak_negotiation_data.lock())
+    {
+      ++negotiation_data->statistics.invalidated_tables;
+
+      // Every successful table that was erased had been counted as terminated
+      negotiation_data->num_terminated_tables -=
+        negotiation_data->clear_successful_descendants_of(sequence);
+    }
+  }
+
   // This function removes descendent tables and makes sure that they can no
   // longer impact the negotiation
   void clear_descendants()
@@ -783,6 +1270,9 @@ public:
 
     const auto negotiation_data = weak_negotiation_data.lock();
 
+    // We hold onto every defunct table until the traversal is finished so that
+    // none of them get destroyed while we are still visiting them.
+    std::vector<TablePtr> defunct_tables;
     std::vector<Table::Implementation*> queue;
     queue.push_back(this);
     while (!queue.empty())
@@ -802,13 +1292,30 @@ public:
           negotiation_data->forfeited_tables.erase(table->_pimpl.get());
         }
 
+        if (negotiation_data)
+        {
+          ++negotiation_data->statistics.defunct_tables;
+          negotiation_data->unindex_table(
+            table->_pimpl->sequence, table.get());
+        }
+
         table->_pimpl->weak_negotiation_data.reset();
         // Tell the child tables that they are now defunct
         table->_pimpl->defunct.terminate();
         queue.push_back(entry.second->_pimpl.get());
+        defunct_tables.push_back(table);
       }
     }
 
+    // A defunct table can never be chosen again, so we release its subtree and
+    // its cached viewer right away. Otherwise anyone who is still holding onto
+    // a defunct table would keep the whole branch beneath it alive.
+    for (const auto& table : defunct_tables)
+    {
+      table->_pimpl->descendants.clear();
+      table->_pimpl->cached_table_viewer.reset();
+    }
+
     descendants.clear();
   }
 };
@@ -844,6 +1351,9 @@ public:
 
   std::shared_ptr<NegotiationData> data;
 
+  // Only used by evaluate() when more than one thread has been requested
+  std::shared_ptr<WorkerPool> evaluation_pool;
+
   TablePtr climb(const TableMap& map, const ParticipantId p)
   {
     const auto it = map.find(p);
@@ -856,21 +1366,10 @@ public:
   TablePtr get_entry(
     const std::vector<ParticipantId>& table)
   {
-    // TODO(MXG): We could use a TablePtr* here to avoid unnecessary reference
-    // counting. However, it would add another layer of indirection and make the
-    // nullptr semantics much trickier.
-    TablePtr output = nullptr;
-    const TableMap* map = &tables;
-    for (const auto p : table)
-    {
-      output = climb(*map, p);
-      if (!output)
-        return nullptr;
-
-      map = &Table::Implementation::get(*output).descendants;
-    }
+    if (table.empty())
+      return nullptr;
 
-    return output;
+    return data->find_indexed(table);
   }
 
   ConstTablePtr get_entry(const std::vector<ParticipantId>& table) const
@@ -882,22 +1381,12 @@ public:
     const ParticipantId for_participant,
     const std::vector<ParticipantId>& to_accommodate)
   {
-    TableMap* map = nullptr;
-    if (to_accommodate.empty())
-    {
-      map = &tables;
-    }
-    else
-    {
-      const auto output = get_entry(to_accommodate);
-      if (!output)
-        return nullptr;
-
-      map = &Table::Implementation::get(*output).descendants;
-    }
-    assert(map);
-
-    return climb(*map, for_participant);
+    std::vector<ParticipantId> sequence;
+    sequence.reserve(to_accommodate.size() + 1);
+    sequence.insert(
+      sequence.end(), to_accommodate.begin(), to_accommodate.end());
+    sequence.push_back(for_participant);
+    return data->find_indexed(sequence);
   }
 
   ConstTablePtr get_entry(
@@ -910,6 +1399,38 @@ public:
 
   SearchResult<TablePtr> find_entry(
     const VersionedKeySequence& sequence)
+  {
+    if (sequence.empty())
+      return {SearchStatus::Absent, nullptr};
+
+    if (auto table = data->find_indexed(NegotiationData::participants_of(
+        sequence)))
+    {
+      // The descendants of a table are remade whenever its version changes,
+      // so the sequence of a live table always has the current versions of
+      // all of its ancestors. Comparing against it gives the same answer as
+      // comparing against each ancestor on the way down the tree.
+      const auto& current = Table::Implementation::get(*table).sequence;
+      assert(current.size() == sequence.size());
+      for (std::size_t i = 0; i < sequence.size(); ++i)
+      {
+        if (sequence[i].version < current[i].version)
+          return {SearchStatus::Deprecated, nullptr};
+
+        if (current[i].version < sequence[i].version)
+          return {SearchStatus::Absent, nullptr};
+      }
+
+      return {SearchStatus::Found, std::move(table)};
+    }
+
+    // The table does not exist, so we descend the tree to find out whether it
+    // was deprecated or has never been created.
+    return find_missing_entry(sequence);
+  }
+
+  SearchResult<TablePtr> find_missing_entry(
+    const VersionedKeySequence& sequence)
   {
     TablePtr parent = nullptr;
     TablePtr output = nullptr;
@@ -1048,6 +1569,139 @@ public:
         data->participants.end()));
   }
 
+  void set_stubborn(
+    const ParticipantId participant,
+    const PlanId plan,
+    Itinerary itinerary)
+  {
+    if (data->participants.count(participant) == 0)
+    {
+      // *INDENT-OFF*
+      throw std::runtime_error(
+        "[rmf_traffic::schedule::Negotiation::set_stubborn] "
+        "Participant [" + std::to_string(participant) + "] is not part of "
+        "the Negotiation");
+      // *INDENT-ON*
+    }
+
+    auto description = schedule_viewer->get_participant(participant);
+    auto rollouts = std::make_shared<Alternatives>(Alternatives{itinerary});
+    auto rollout_timelines =
+      Table::Implementation::to_timelines(participant, description, *rollouts);
+
+    data->stubborn[participant] = std::make_shared<StubbornParticipant>(
+      StubbornParticipant{
+        Submission{participant, plan, std::move(itinerary)},
+        std::move(description),
+        std::move(rollouts),
+        std::move(rollout_timelines)
+      });
+
+    // Resolve the tables of this participant that already exist
+    std::vector<TablePtr> queue;
+    for (const auto& entry : tables)
+      queue.push_back(entry.second);
+
+    while (!queue.empty())
+    {
+      const auto table = queue.back();
+      queue.pop_back();
+
+      auto& impl = Table::Implementation::get(*table);
+      if (impl.defunct)
+        continue;
+
+      if (impl.participant == participant)
+      {
+        // Resolving the table replaces all of its descendants
+        impl.resolve_stubborn(*data);
+        continue;
+      }
+
+      for (const auto& entry : impl.descendants)
+        queue.push_back(entry.second);
+    }
+  }
+
+  std::vector<TablePtr> rebase(
+    std::shared_ptr<const schedule::Viewer> new_viewer,
+    const std::vector<ParticipantId>& changed_participants)
+  {
+    if (new_viewer)
+    {
+      for (const auto p : data->participants)
+      {
+        if (!new_viewer->get_participant(p))
+        {
+          // *INDENT-OFF*
+          throw std::runtime_error(
+            "[rmf_traffic::schedule::Negotiation::rebase] "
+            "The new schedule viewer is missing a description for participant "
+            "[" + std::to_string(p) + "]");
+          // *INDENT-ON*
+        }
+      }
+
+      schedule_viewer = std::move(new_viewer);
+    }
+
+    data->base_query_cache->clear();
+
+    std::vector<ParticipantId> outsiders;
+    for (const auto p : changed_participants)
+    {
+      if (data->participants.count(p) == 0)
+        outsiders.push_back(p);
+    }
+
+    std::optional<Viewer::View> changes;
+    if (!outsiders.empty())
+    {
+      Query query = query_all();
+      query.participants() =
+        Query::Participants::make_only(std::move(outsiders));
+      changes = schedule_viewer->query(query);
+    }
+
+    std::vector<TablePtr> invalidated;
+    std::vector<TablePtr> queue;
+    for (const auto& entry : tables)
+      queue.push_back(entry.second);
+
+    while (!queue.empty())
+    {
+      const auto table = queue.back();
+      queue.pop_back();
+
+      auto& impl = Table::Implementation::get(*table);
+      impl.schedule_viewer = schedule_viewer;
+      impl.cached_table_viewer.reset();
+
+      // Stubborn participants would submit the same itinerary again, so
+      // their submissions are kept.
+      if (changes.has_value() && impl.submission
+        && !data->get_stubborn(impl.participant))
+      {
+        const auto description =
+          schedule_viewer->get_participant(impl.participant);
+
+        if (in_conflict(impl.submission->submission, *description, *changes))
+        {
+          // None of the descendants of this table will be kept, so there is
+          // no need to visit them.
+          impl.invalidate();
+          invalidated.push_back(table);
+          continue;
+        }
+      }
+
+      for (const auto& entry : impl.descendants)
+        queue.push_back(entry.second);
+    }
+
+    return invalidated;
+  }
+
   ~Implementation()
   {
     std::vector<Table::Implementation*> queue;
@@ -1113,12 +1767,54 @@ void Negotiation::add_participant(ParticipantId p)
   _pimpl->add_participant(p);
 }
 
+//==============================================================================
+void Negotiation::set_stubborn(
+  const ParticipantId participant,
+  const PlanId plan,
+  Itinerary itinerary)
+{
+  _pimpl->set_stubborn(participant, plan, std::move(itinerary));
+}
+
+//==============================================================================
+bool Negotiation::is_stubborn(const ParticipantId participant) const
+{
+  return _pimpl->data->get_stubborn(participant) != nullptr;
+}
+
 //==============================================================================
 bool Negotiation::ready() const
 {
   return !_pimpl->data->successful_tables.empty();
 }
 
+//==============================================================================
+void Negotiation::set_base_query_cache_capacity(const std::size_t capacity)
+{
+  _pimpl->data->base_query_cache->set_capacity(capacity);
+}
+
+//==============================================================================
+std::size_t Negotiation::get_base_query_cache_capacity() const
+{
+  return _pimpl->data->base_query_cache->get_capacity();
+}
+
+//==============================================================================
+auto Negotiation::statistics() const -> const Statistics&
+{
+  return _pimpl->data->statistics;
+}
+
+//==============================================================================
+auto Negotiation::rebase(
+  std::shared_ptr<const Viewer> schedule_viewer,
+  const std::vector<ParticipantId>& changed_participants)
+-> std::vector<TablePtr>
+{
+  return _pimpl->rebase(std::move(schedule_viewer), changed_participants);
+}
+
 //==============================================================================
 bool Negotiation::complete() const
 {
@@ -1134,9 +1830,7 @@ class NegotiationRelevanceInspector : public TimelineInspector<BaseRouteEntry>
 {
 public:
 
-  using Storage = schedule::Viewer::View::Implementation::Storage;
-
-  std::vector<Storage> routes;
+  schedule::Viewer::View::Implementation::Builder routes;
 
   void inspect(
     const BaseRouteEntry* entry,
@@ -1145,14 +1839,7 @@ public:
     assert(entry->route);
     if (relevant(*entry))
     {
-      routes.emplace_back(
-        Storage{
-          entry->participant,
-          entry->plan_id,
-          entry->route_id,
-          entry->route,
-          entry->description
-        });
+      routes.add(*entry);
     }
   }
 };
@@ -1180,12 +1867,21 @@ Viewer::View Negotiation::Table::Viewer::Implementation::query(
     ->inspect(spacetime, all_participants, inspector);
   }
 
-  // Query for the relevant routes that are outside of the negotiation
-  Viewer::View view = schedule_viewer->query(spacetime, *participant_query);
+  // Query for the relevant routes that are outside of the negotiation. The
+  // schedule viewer is the same for every table, so every table can share the
+  // results.
+  const auto inspect_schedule = [&]()
+    {
+      return schedule_viewer->query(spacetime, *participant_query);
+    };
+
+  Viewer::View view = base_query_cache ?
+    base_query_cache->query(spacetime, *participant_query, 0, inspect_schedule)
+    : inspect_schedule();
 
   // Merge them together into a single view
   Viewer::View::Implementation::append_to_view(
-    view, std::move(inspector.routes));
+    view, std::move(inspector.routes).build());
 
   return view;
 }
@@ -1270,7 +1966,7 @@ auto Negotiation::Table::Viewer::alternatives() const -> const AlternativeMap&
 //==============================================================================
 auto Negotiation::Table::Viewer::base_proposals() const -> const Proposal&
 {
-  return *_pimpl->base_proposals;
+  return _pimpl->base_proposals->proposal();
 }
 
 //==============================================================================
@@ -1320,8 +2016,8 @@ bool Negotiation::Table::Viewer::forfeited() const
 //==============================================================================
 const Itinerary* Negotiation::Table::Viewer::submission() const
 {
-  if (_pimpl->itinerary)
-    return &(*_pimpl->itinerary);
+  if (_pimpl->submission)
+    return &_pimpl->submission->submission.itinerary;
 
   return nullptr;
 }
@@ -1331,18 +2027,19 @@ std::optional<rmf_traffic::Time>
 Negotiation::Table::Viewer::earliest_base_proposal_time() const
 {
   std::optional<rmf_traffic::Time> earliest;
-  for (const auto& proposal : *_pimpl->base_proposals)
-  {
-    for (const auto& route : proposal.itinerary)
+  _pimpl->base_proposals->for_each(
+    [&](const ProposalChain::ConstNodePtr& node)
     {
-      const auto* t = route.trajectory().start_time();
-      if (!t)
-        continue;
+      for (const auto& route : node->submission.itinerary)
+      {
+        const auto* t = route.trajectory().start_time();
+        if (!t)
+          continue;
 
-      if (!earliest.has_value() || *t < *earliest)
-        earliest = *t;
-    }
-  }
+        if (!earliest.has_value() || *t < *earliest)
+          earliest = *t;
+      }
+    });
 
   return earliest;
 }
@@ -1352,18 +2049,19 @@ std::optional<rmf_traffic::Time>
 Negotiation::Table::Viewer::latest_base_proposal_time() const
 {
   std::optional<rmf_traffic::Time> latest;
-  for (const auto& proposal : *_pimpl->base_proposals)
-  {
-    for (const auto& route : proposal.itinerary)
+  _pimpl->base_proposals->for_each(
+    [&](const ProposalChain::ConstNodePtr& node)
     {
-      const auto* t = route.trajectory().finish_time();
-      if (!t)
-        continue;
+      for (const auto& route : node->submission.itinerary)
+      {
+        const auto* t = route.trajectory().finish_time();
+        if (!t)
+          continue;
 
-      if (!latest.has_value() || *latest < *t)
-        latest = *t;
-    }
-  }
+        if (!latest.has_value() || *latest < *t)
+          latest = *t;
+      }
+    });
 
   return latest;
 }
@@ -1384,6 +2082,10 @@ auto Negotiation::Table::viewer() const -> ViewerPtr
   if (const auto p = parent())
     parent_id = p->participant();
 
+  std::shared_ptr<QueryCache> base_query_cache;
+  if (const auto data = _pimpl->weak_negotiation_data.lock())
+    base_query_cache = data->base_query_cache;
+
   _pimpl->cached_table_viewer = std::make_shared<Viewer>(
     Viewer::Implementation::make(
       _pimpl->proposed_timeline,
@@ -1392,12 +2094,13 @@ auto Negotiation::Table::viewer() const -> ViewerPtr
       _pimpl->base_proposals,
       _pimpl->participant_query,
       _pimpl->schedule_viewer,
+      std::move(base_query_cache),
       parent_id,
       _pimpl->sequence,
       _pimpl->defunct.get(),
       _pimpl->rejected,
       _pimpl->forfeited,
-      _pimpl->itinerary));
+      _pimpl->submission));
 
   return _pimpl->cached_table_viewer;
 }
@@ -1405,8 +2108,8 @@ auto Negotiation::Table::viewer() const -> ViewerPtr
 //==============================================================================
 const Itinerary* Negotiation::Table::submission() const
 {
-  if (_pimpl->itinerary)
-    return &(*_pimpl->itinerary);
+  if (_pimpl->submission)
+    return &_pimpl->submission->submission.itinerary;
 
   return nullptr;
 }
@@ -1420,7 +2123,7 @@ Version Negotiation::Table::version() const
 //==============================================================================
 auto Negotiation::Table::proposal() const -> const Proposal&
 {
-  return _pimpl->proposal;
+  return _pimpl->proposal->proposal();
 }
 
 //==============================================================================
@@ -1452,6 +2155,7 @@ bool Negotiation::Table::submit(
   std::vector<Route> itinerary,
   const Version version)
 {
+  RMF_TRAFFIC_TRACE("negotiation.submit");
   return _pimpl->submit(plan_id, std::move(itinerary), version);
 }
 
@@ -1608,6 +2312,14 @@ auto Negotiation::find(const VersionedKeySequence& sequence) const
   return _pimpl->find_entry(sequence);
 }
 
+//==============================================================================
+std::size_t Negotiation::Evaluator::choose_summarized(
+  const std::vector<const Proposal*>& proposals,
+  const std::vector<const ProposalSummary*>&) const
+{
+  return choose(proposals);
+}
+
 //==============================================================================
 auto Negotiation::evaluate(const Evaluator& evaluator) const -> ConstTablePtr
 {
@@ -1615,84 +2327,88 @@ auto Negotiation::evaluate(const Evaluator& evaluator) const -> ConstTablePtr
   if (successes.empty())
     return nullptr;
 
-  std::vector<const Proposal*> proposals;
-  std::vector<ConstTablePtr> tables;
-  proposals.reserve(successes.size());
-  for (const auto& s : successes)
-  {
-    auto table_ptr = _pimpl->find_entry(s).table;
-    assert(table_ptr);
-
-    const auto& proposal = Table::Implementation::get(*table_ptr).proposal;
-    assert(Table::Implementation::get(*table_ptr).itinerary);
-    assert(!Table::Implementation::get(*table_ptr).rejected);
-    assert(proposal.size() == Table::Implementation::get(*table_ptr).depth);
-    assert(Table::Implementation::get(*table_ptr).descendants.empty());
+  std::vector<const Proposal*> proposals(successes.size(), nullptr);
+  std::vector<const ProposalSummary*> summaries(successes.size(), nullptr);
+  std::vector<ConstTablePtr> tables(successes.size(), nullptr);
 
-    tables.emplace_back(std::move(table_ptr));
-    proposals.emplace_back(&proposal);
+  // The first time a table is evaluated, its proposal gets copied out of the
+  // chain. After that, both the proposal and its summary are cached in the
+  // table, so evaluating again only has to look the tables up.
+  const auto gather = [&](const std::size_t i)
+    {
+      auto table_ptr = _pimpl->find_entry(successes[i]).table;
+      assert(table_ptr);
+
+      const auto& table = Table::Implementation::get(*table_ptr);
+      assert(table.submission);
+      assert(!table.rejected);
+      assert(table.proposal->size() == table.depth);
+      assert(table.descendants.empty());
+
+      proposals[i] = &table.proposal->proposal();
+      summaries[i] = &table.proposal->summary();
+      tables[i] = std::move(table_ptr);
+    };
+
+  const auto& pool = _pimpl->evaluation_pool;
+  if (pool && successes.size() > 1)
+  {
+    pool->run(successes.size(), gather);
+  }
+  else
+  {
+    for (std::size_t i = 0; i < successes.size(); ++i)
+      gather(i);
   }
 
-  const std::size_t choice = evaluator.choose(proposals);
+  const std::size_t choice = evaluator.choose_summarized(proposals, summaries);
   assert(choice < tables.size());
 
   return tables[choice];
 }
 
 //==============================================================================
-Negotiation::Negotiation()
+Negotiation& Negotiation::evaluation_threads(const std::size_t value)
 {
-  // Do nothing
+  auto& pool = _pimpl->evaluation_pool;
+  if (value <= 1)
+    pool = nullptr;
+  else if (!pool || pool->size() != value)
+    pool = std::make_shared<WorkerPool>(value);
+
+  return *this;
 }
 
-namespace {
 //==============================================================================
-rmf_utils::optional<Time> get_finish_time(const Itinerary& itinerary)
+std::size_t Negotiation::evaluation_threads() const
 {
-  rmf_utils::optional<Time> finish_time;
-  for (const auto& route : itinerary)
-  {
-    const auto* t = route.trajectory().finish_time();
-    if (!t)
-      continue;
+  if (!_pimpl->evaluation_pool)
+    return 1;
 
-    if (!finish_time)
-      finish_time = *route.trajectory().finish_time();
-    else
-    {
-      if (*t < *finish_time)
-        finish_time = *t;
-    }
-  }
+  return _pimpl->evaluation_pool->size();
+}
 
-  return finish_time;
+//==============================================================================
+Negotiation::Negotiation()
+{
+  // Do nothing
 }
-} // anonymous namespace
 
 //==============================================================================
-std::size_t QuickestFinishEvaluator::choose(
-  const std::vector<const Negotiation::Proposal*>& proposals) const
+namespace {
+std::size_t choose_quickest_finish(
+  const std::vector<const Negotiation::ProposalSummary*>& summaries)
 {
   std::unordered_map<ParticipantId, Time> best_finish_times;
-
-  std::vector<std::unordered_map<ParticipantId, Time>> all_finish_times;
-  all_finish_times.reserve(proposals.size());
-
-  for (const auto& proposal : proposals)
+  for (const auto& summary : summaries)
   {
-    all_finish_times.push_back({});
-    auto& finish_times = all_finish_times.back();
-
-    for (const auto& p : *proposal)
+    for (const auto& s : *summary)
     {
-      auto finish_time = get_finish_time(p.itinerary);
-      if (!finish_time)
+      if (!s.finish_time)
         continue;
 
-      finish_times[p.participant] = *finish_time;
-
       const auto insertion = best_finish_times.insert(
-        std::make_pair(p.participant, *finish_time));
+        std::make_pair(s.participant, *s.finish_time));
 
       if (insertion.second)
       {
@@ -1701,27 +2417,25 @@ std::size_t QuickestFinishEvaluator::choose(
         continue;
       }
 
-      if (*finish_time < insertion.first->second)
-        insertion.first->second = *finish_time;
+      if (*s.finish_time < insertion.first->second)
+        insertion.first->second = *s.finish_time;
     }
   }
 
-  assert(all_finish_times.size() == proposals.size());
-
   double best_penalty = std::numeric_limits<double>::infinity();
   std::size_t best_index = std::numeric_limits<std::size_t>::max();
-  for (std::size_t i = 0; i < proposals.size(); ++i)
+  for (std::size_t i = 0; i < summaries.size(); ++i)
   {
-    const auto& finish_times = all_finish_times[i];
     double penalty = 0;
-    for (const auto& t : finish_times)
+    for (const auto& s : *summaries[i])
     {
-      const ParticipantId participant = t.first;
-      const Time time = t.second;
-      const Time best_finish_time = best_finish_times.at(participant);
-      assert(best_finish_time <= time);
+      if (!s.finish_time)
+        continue;
 
-      penalty += time::to_seconds(time - best_finish_time);
+      const Time best_finish_time = best_finish_times.at(s.participant);
+      assert(best_finish_time <= *s.finish_time);
+
+      penalty += time::to_seconds(*s.finish_time - best_finish_time);
     }
 
     if (penalty < best_penalty)
@@ -1731,9 +2445,42 @@ std::size_t QuickestFinishEvaluator::choose(
     }
   }
 
-  assert(best_index < proposals.size());
+  assert(best_index < summaries.size());
   return best_index;
 }
+} // anonymous namespace
+
+//==============================================================================
+std::size_t QuickestFinishEvaluator::choose(
+  const std::vector<const Negotiation::Proposal*>& proposals) const
+{
+  std::vector<Negotiation::ProposalSummary> all_summaries;
+  all_summaries.reserve(proposals.size());
+
+  std::vector<const Negotiation::ProposalSummary*> summaries;
+  summaries.reserve(proposals.size());
+
+  for (const auto& proposal : proposals)
+  {
+    all_summaries.push_back({});
+    auto& summary = all_summaries.back();
+    summary.reserve(proposal->size());
+    for (const auto& p : *proposal)
+      summary.push_back({p.participant, get_finish_time(p.itinerary)});
+
+    summaries.push_back(&summary);
+  }
+
+  return choose_quickest_finish(summaries);
+}
+
+//==============================================================================
+std::size_t QuickestFinishEvaluator::choose_summarized(
+  const std::vector<const Negotiation::Proposal*>&,
+  const std::vector<const Negotiation::ProposalSummary*>& summaries) const
+{
+  return choose_quickest_finish(summaries);
+}
 
 } // namespace schedule
 } // namespace rmf_traffic
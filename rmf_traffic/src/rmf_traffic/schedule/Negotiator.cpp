@@ -20,6 +20,13 @@
 namespace rmf_traffic {
 namespace schedule {
 
+//==============================================================================
+void Negotiator::respond_batch(const std::vector<Pending>& pending)
+{
+  for (const auto& p : pending)
+    respond(p.table_viewer, p.responder);
+}
+
 //==============================================================================
 class SimpleResponder::Implementation
 {
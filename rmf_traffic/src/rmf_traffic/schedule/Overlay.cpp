@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/Overlay.hpp>
+
+#include "Timeline.hpp"
+#include "ViewerInternal.hpp"
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace rmf_traffic {
+namespace schedule {
+
+namespace {
+//==============================================================================
+class OverlayInspector : public TimelineInspector<BaseRouteEntry>
+{
+public:
+
+  Viewer::View::Implementation::Builder routes;
+
+  OverlayInspector split() const
+  {
+    OverlayInspector output;
+    output.routes = routes.split();
+    return output;
+  }
+
+  void merge(OverlayInspector&& other)
+  {
+    routes.merge(std::move(other.routes));
+  }
+
+  void inspect(
+    const BaseRouteEntry* entry,
+    const std::function<bool(const BaseRouteEntry&)>& relevant) final
+  {
+    if (relevant(*entry))
+      routes.add(*entry);
+  }
+};
+
+//==============================================================================
+/// The routes of the changes of an overlay, indexed by a timeline
+struct ChangeIndex
+{
+  // The handles are declared first so that the timeline gets destroyed before
+  // them. Otherwise each handle would remove its entry from the timeline one
+  // at a time.
+  std::vector<std::shared_ptr<Timeline<BaseRouteEntry>::Handle>> handles;
+  Timeline<BaseRouteEntry> timeline;
+};
+
+//==============================================================================
+struct Change
+{
+  PlanId plan;
+  std::vector<ConstRoutePtr> routes;
+  std::shared_ptr<const ParticipantDescription> description;
+};
+
+//==============================================================================
+/// The changes of an overlay. This is shared between copies of an overlay
+/// until one of them gets modified.
+struct Changes
+{
+  std::map<ParticipantId, Change> participants;
+
+  Changes() = default;
+
+  Changes(const Changes& other)
+  : participants(other.participants)
+  {
+    // The index is not copied, since the copy is about to be modified
+  }
+
+  /// Forget the index because the changes are about to be modified. Views that
+  /// were made from the old index keep it alive for as long as they need it.
+  void invalidate()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _index = nullptr;
+  }
+
+  /// Get the timeline of the routes of the changes, making it if needed
+  std::shared_ptr<const ChangeIndex> index() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_index)
+      return _index;
+
+    auto index = std::make_shared<ChangeIndex>();
+    for (const auto& [participant, change] : participants)
+    {
+      for (std::size_t i = 0; i < change.routes.size(); ++i)
+      {
+        index->handles.push_back(
+          index->timeline.insert(
+            std::make_shared<BaseRouteEntry>(
+              BaseRouteEntry{
+                change.routes[i],
+                participant,
+                change.plan,
+                i,
+                i,
+                change.description
+              })));
+      }
+    }
+
+    _index = std::move(index);
+    return _index;
+  }
+
+private:
+  mutable std::mutex _mutex;
+  mutable std::shared_ptr<const ChangeIndex> _index;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+class Overlay::Implementation
+{
+public:
+
+  std::shared_ptr<const Snapshot> base;
+  std::shared_ptr<Changes> changes;
+
+  /// Get the changes so that they can be modified. They get copied first if
+  /// another copy of the overlay is sharing them.
+  Changes& modify()
+  {
+    if (changes.use_count() > 1)
+      changes = std::make_shared<Changes>(*changes);
+    else
+      changes->invalidate();
+
+    return *changes;
+  }
+};
+
+//==============================================================================
+Overlay::Overlay(std::shared_ptr<const Snapshot> base)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{std::move(base), std::make_shared<Changes>()}))
+{
+  if (!_pimpl->base)
+  {
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "[rmf_traffic::schedule::Overlay] nullptr given for the base snapshot");
+    // *INDENT-ON*
+  }
+}
+
+//==============================================================================
+Overlay& Overlay::set(
+  const ParticipantId participant,
+  const PlanId plan,
+  Itinerary itinerary)
+{
+  auto description = _pimpl->base->get_participant(participant);
+  if (!description)
+  {
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "[rmf_traffic::schedule::Overlay::set] Participant ["
+      + std::to_string(participant) + "] is not in the base schedule");
+    // *INDENT-ON*
+  }
+
+  Change change{plan, {}, std::move(description)};
+  change.routes.reserve(itinerary.size());
+  for (auto& route : itinerary)
+  {
+    if (route.trajectory().size() < 2)
+      continue;
+
+    change.routes.push_back(std::make_shared<const Route>(std::move(route)));
+  }
+
+  _pimpl->modify().participants[participant] = std::move(change);
+  return *this;
+}
+
+//==============================================================================
+Overlay& Overlay::erase(const ParticipantId participant)
+{
+  return set(participant, 0, {});
+}
+
+//==============================================================================
+Overlay& Overlay::reset(const ParticipantId participant)
+{
+  if (_pimpl->changes->participants.count(participant) > 0)
+    _pimpl->modify().participants.erase(participant);
+
+  return *this;
+}
+
+//==============================================================================
+Overlay& Overlay::reset()
+{
+  _pimpl->changes = std::make_shared<Changes>();
+  return *this;
+}
+
+//==============================================================================
+std::vector<ParticipantId> Overlay::changed_participants() const
+{
+  std::vector<ParticipantId> output;
+  output.reserve(_pimpl->changes->participants.size());
+  for (const auto& [participant, _] : _pimpl->changes->participants)
+    output.push_back(participant);
+
+  return output;
+}
+
+//==============================================================================
+const std::shared_ptr<const Snapshot>& Overlay::base() const
+{
+  return _pimpl->base;
+}
+
+//==============================================================================
+auto Overlay::query(const Query& parameters) const -> View
+{
+  return query(parameters.spacetime(), parameters.participants());
+}
+
+//==============================================================================
+auto Overlay::query(
+  const Query::Spacetime& spacetime,
+  const Query::Participants& participants) const -> View
+{
+  const auto base_view = _pimpl->base->query(spacetime, participants);
+  const auto changes = _pimpl->changes;
+  if (changes->participants.empty())
+    return base_view;
+
+  auto view = View::Implementation::make_filtered_view(
+    base_view, [&](const View::Element& element)
+    {
+      return changes->participants.count(element.participant) == 0;
+    });
+
+  const auto index = changes->index();
+  OverlayInspector inspector;
+  index->timeline.inspect(spacetime, participants, inspector);
+
+  // The view pins the index, which keeps the routes of the changes alive
+  View::Implementation::append_to_view(
+    view, std::move(inspector.routes).build(index));
+
+  return view;
+}
+
+//==============================================================================
+const std::unordered_set<ParticipantId>& Overlay::participant_ids() const
+{
+  return _pimpl->base->participant_ids();
+}
+
+//==============================================================================
+std::shared_ptr<const ParticipantDescription> Overlay::get_participant(
+  const ParticipantId participant_id) const
+{
+  return _pimpl->base->get_participant(participant_id);
+}
+
+//==============================================================================
+std::optional<Version> Overlay::schedule_version() const
+{
+  return _pimpl->base->schedule_version();
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
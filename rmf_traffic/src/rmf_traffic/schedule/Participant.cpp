@@ -17,7 +17,9 @@
 
 #include "internal_Participant.hpp"
 #include "debug_Participant.hpp"
+#include "internal_Itinerary.hpp"
 #include "internal_Rectifier.hpp"
+#include "../internal_Route.hpp"
 
 #include <iostream>
 #include <thread>
@@ -56,7 +58,14 @@ bool Participant::Implementation::Shared::set(
   PlanId plan, std::vector<Route> itinerary)
 {
   if (rmf_utils::modular(plan).less_than_or_equal(_current_plan_id))
-    return false;
+  {
+    // Resubmitting the current plan is harmless as long as nothing about it
+    // has changed, so there is nothing to send in that case.
+    return plan == _current_plan_id
+      && itinerary.size() == _current_itinerary.size()
+      && hash_itinerary(itinerary) == current_itinerary_hash()
+      && same_itinerary(itinerary, _current_itinerary);
+  }
 
   for (std::size_t i = 0; i < itinerary.size(); ++i)
   {
@@ -74,31 +83,32 @@ bool Participant::Implementation::Shared::set(
 
   _change_history.clear();
   _cumulative_delay = std::chrono::seconds(0);
+  _held_delay = std::chrono::seconds(0);
   _current_plan_id = plan;
   const auto storage_base = _next_storage_base;
   _next_storage_base += itinerary.size();
   _assign_plan_id->fast_forward_to(plan+1);
+
+  // The participant owns these routes now, so they can share their
+  // trajectories with the copies that are given to the writer.
+  for (auto& route : itinerary)
+    RouteData::take_ownership(route);
+
   _current_itinerary = std::move(itinerary);
+  _current_itinerary_hash = std::nullopt;
   _progress = _buffered_progress.pull(plan, _current_itinerary.size());
 
   const ItineraryVersion itinerary_version = get_next_version();
-  const ParticipantId id = _id;
-  auto change =
-    [
-      self = weak_from_this(),
-      itinerary = _current_itinerary,
-      itinerary_version,
-      id,
-      plan,
-      storage_base
-    ]()
-    {
-      if (const auto me = self.lock())
-        me->_writer->set(id, plan, itinerary, storage_base, itinerary_version);
-    };
 
-  _change_history[itinerary_version] = change;
-  change();
+  // The change history keeps the itinerary as it was when it was set, since
+  // the current itinerary will be modified by delays. The snapshot is shared
+  // so that storing and retransmitting the change does not copy it again.
+  StoredChange change;
+  change.type = StoredChange::Type::Set;
+  change.plan = plan;
+  change.storage_base = storage_base;
+  change.itinerary = std::make_shared<const Itinerary>(_current_itinerary);
+  record(itinerary_version, std::move(change));
 
   if (_progress.version > 0)
   {
@@ -122,34 +132,14 @@ bool Participant::Implementation::Shared::cumulative_delay(
   if (std::chrono::abs(change_in_delay) <= std::chrono::abs(tolerance))
     return true;
 
-  bool no_delays = true;
-  for (auto& route : _current_itinerary)
-  {
-    if (route.trajectory().size() > 0)
-    {
-      no_delays = false;
-      route.trajectory().front().adjust_times(change_in_delay);
-    }
-  }
-
-  if (no_delays)
+  if (!apply_delay(change_in_delay))
   {
     // We don't need to make any changes, because there are no waypoints to move
     return true;
   }
 
   _cumulative_delay = new_cumulative_delay;
-  const ItineraryVersion itinerary_version = get_next_version();
-  const ParticipantId id = _id;
-  auto change =
-    [self = weak_from_this(), change_in_delay, itinerary_version, id]()
-    {
-      if (const auto me = self.lock())
-        me->_writer->delay(id, change_in_delay, itinerary_version);
-    };
-
-  _change_history[itinerary_version] = change;
-  change();
+  report_delay(change_in_delay);
   return true;
 }
 
@@ -166,35 +156,84 @@ std::optional<Duration> Participant::Implementation::Shared::cumulative_delay(
 //==============================================================================
 void Participant::Implementation::Shared::delay(Duration delay)
 {
+  if (!apply_delay(delay))
+  {
+    // We don't need to make any changes, because there are no waypoints to move
+    return;
+  }
+
+  _cumulative_delay += delay;
+  report_delay(delay);
+}
+
+//==============================================================================
+void Participant::Implementation::Shared::delay_coalescing(
+  std::optional<DelayCoalescing> policy)
+{
+  _delay_coalescing = policy;
+  if (!_delay_coalescing.has_value())
+    flush_delay();
+}
+
+//==============================================================================
+void Participant::Implementation::Shared::flush_delay()
+{
+  if (_held_delay == Duration(0))
+  {
+    // Either nothing was held back or the held delays cancelled out, so the
+    // schedule already has the right itinerary.
+    return;
+  }
+
+  const Duration delay = _held_delay;
+  _held_delay = Duration(0);
+  _last_delay_sent = std::chrono::steady_clock::now();
+
+  // The version is only taken when the delay is sent, so the versions that
+  // the schedule receives have no gaps where held delays would have been.
+  const ItineraryVersion itinerary_version = get_next_version();
+  StoredChange change;
+  change.type = StoredChange::Type::Delay;
+  change.delay = delay;
+  record(itinerary_version, std::move(change));
+}
+
+//==============================================================================
+bool Participant::Implementation::Shared::apply_delay(Duration delay)
+{
+  _current_itinerary_hash = std::nullopt;
   bool no_delays = true;
   for (auto& route : _current_itinerary)
   {
-    if (route.trajectory().size() > 0)
+    if (RouteData::get(route).size() > 0)
     {
       no_delays = false;
-      route.trajectory().front().adjust_times(delay);
+      RouteData::delay_route(route, delay);
     }
   }
 
-  if (no_delays)
+  return !no_delays;
+}
+
+//==============================================================================
+void Participant::Implementation::Shared::report_delay(Duration delay)
+{
+  _held_delay += delay;
+  if (_delay_coalescing.has_value())
   {
-    // We don't need to make any changes, because there are no waypoints to move
-    return;
-  }
+    const auto& policy = *_delay_coalescing;
+    const bool too_soon = _last_delay_sent.has_value()
+      && std::chrono::steady_clock::now() - *_last_delay_sent
+      < policy.minimum_interval;
 
-  _cumulative_delay += delay;
+    const bool too_small = std::chrono::abs(_held_delay)
+      < std::chrono::abs(policy.minimum_magnitude);
 
-  const ItineraryVersion itinerary_version = get_next_version();
-  const ParticipantId id = _id;
-  auto change =
-    [self = weak_from_this(), delay, itinerary_version, id]()
-    {
-      if (const auto me = self.lock())
-        me->_writer->delay(id, delay, itinerary_version);
-    };
+    if (too_soon || too_small)
+      return;
+  }
 
-  _change_history[itinerary_version] = change;
-  change();
+  flush_delay();
 }
 
 //==============================================================================
@@ -212,6 +251,9 @@ void Participant::Implementation::Shared::reached(
 
   if (_progress.update(route, checkpoint))
   {
+    // The schedule should have the latest timing of the itinerary before it
+    // hears about the progress along it.
+    flush_delay();
     _writer->reached(
       _id, plan, _progress.reached_checkpoints, _progress.version);
   }
@@ -221,6 +263,7 @@ void Participant::Implementation::Shared::reached(
 void Participant::Implementation::Shared::clear()
 {
   _cumulative_delay = std::chrono::seconds(0);
+  _held_delay = std::chrono::seconds(0);
   if (_current_itinerary.empty())
   {
     // There is nothing to clear, so we can skip this change
@@ -228,18 +271,74 @@ void Participant::Implementation::Shared::clear()
   }
 
   _current_itinerary.clear();
+  _current_itinerary_hash = std::nullopt;
 
   const ItineraryVersion itinerary_version = get_next_version();
-  const ParticipantId id = _id;
-  auto change =
-    [self = weak_from_this(), itinerary_version, id]()
-    {
-      if (const auto me = self.lock())
-        me->_writer->clear(id, itinerary_version);
-    };
+  StoredChange change;
+  change.type = StoredChange::Type::Clear;
+  record(itinerary_version, std::move(change));
+}
+
+//==============================================================================
+void Participant::Implementation::Shared::send(
+  const ItineraryVersion version,
+  const StoredChange& change) const
+{
+  switch (change.type)
+  {
+    case StoredChange::Type::Set:
+      _writer->set(
+        _id, change.plan, *change.itinerary, change.storage_base, version);
+      return;
+    case StoredChange::Type::Delay:
+      _writer->delay(_id, change.delay, version);
+      return;
+    case StoredChange::Type::Clear:
+      _writer->clear(_id, version);
+      return;
+  }
+}
 
-  _change_history[itinerary_version] = change;
-  change();
+//==============================================================================
+void Participant::Implementation::Shared::record(
+  const ItineraryVersion version,
+  StoredChange change)
+{
+  const auto it = _change_history.insert_or_assign(
+    version, std::move(change)).first;
+  send(version, it->second);
+}
+
+//==============================================================================
+void Participant::Implementation::Shared::send_net_state()
+{
+  // The held delays are already part of the current itinerary
+  _held_delay = std::chrono::seconds(0);
+
+  // The set gets new storage IDs, the same as any other set, so that the
+  // schedule never reuses the storage of routes that it is erasing.
+  const auto storage_base = _next_storage_base;
+  _next_storage_base += _current_itinerary.size();
+
+  StoredChange change;
+  change.type = StoredChange::Type::Set;
+  change.plan = _current_plan_id;
+  change.storage_base = storage_base;
+  change.itinerary = std::make_shared<const Itinerary>(_current_itinerary);
+
+  _change_history.clear();
+  record(get_next_version(), std::move(change));
+
+  // The schedule resets the progress of an itinerary when it is set
+  _writer->reached(
+    _id, _current_plan_id, _progress.reached_checkpoints, _progress.version);
+}
+
+//==============================================================================
+void Participant::Implementation::Shared::retransmission(
+  const Retransmission mode)
+{
+  _retransmission = mode;
 }
 
 //==============================================================================
@@ -298,6 +397,9 @@ void Participant::Implementation::Shared::retransmit(
     return;
   }
 
+  // Gather the changes to send before sending any of them, so that we can
+  // decide whether to send the net state instead.
+  std::vector<ChangeHistory::const_iterator> replay;
   for (const auto& range : ranges)
   {
     assert(rmf_utils::modular(range.lower).less_than_or_equal(range.upper));
@@ -322,14 +424,23 @@ void Participant::Implementation::Shared::retransmit(
     assert(begin_it->first <= end_it->first);
 
     for (auto it = begin_it; it->first <= end_it->first; ++it)
-      it->second();
+      replay.push_back(it);
   }
 
   // In case the database doesn't have the most recent changes, we will
   // retransmit them.
   const auto tail_begin = _change_history.upper_bound(last_known_itinerary);
   for (auto it = tail_begin; it != _change_history.end(); ++it)
-    it->second();
+    replay.push_back(it);
+
+  if (Retransmission::NetState == _retransmission && replay.size() > 1)
+  {
+    send_net_state();
+    return;
+  }
+
+  for (const auto& it : replay)
+    send(it->first, it->second);
 
   bool resend_progress = last_known_progress < _progress.version;
   if (!_change_history.empty())
@@ -390,6 +501,15 @@ void Participant::Implementation::Shared::correct_id(ParticipantId new_id)
   set(_current_plan_id, _current_itinerary);
 }
 
+//==============================================================================
+std::size_t Participant::Implementation::Shared::current_itinerary_hash() const
+{
+  if (!_current_itinerary_hash.has_value())
+    _current_itinerary_hash = hash_itinerary(_current_itinerary);
+
+  return *_current_itinerary_hash;
+}
+
 //==============================================================================
 const ParticipantDescription&
 Participant::Implementation::Shared::get_description() const
@@ -452,6 +572,37 @@ rmf_traffic::Duration Participant::delay() const
   return _pimpl->_shared->_cumulative_delay;
 }
 
+//==============================================================================
+void Participant::delay_coalescing(std::optional<DelayCoalescing> policy)
+{
+  _pimpl->_shared->delay_coalescing(policy);
+}
+
+//==============================================================================
+auto Participant::delay_coalescing() const
+-> const std::optional<DelayCoalescing>&
+{
+  return _pimpl->_shared->_delay_coalescing;
+}
+
+//==============================================================================
+void Participant::flush_delay()
+{
+  _pimpl->_shared->flush_delay();
+}
+
+//==============================================================================
+void Participant::retransmission(const Retransmission mode)
+{
+  _pimpl->_shared->retransmission(mode);
+}
+
+//==============================================================================
+auto Participant::retransmission() const -> Retransmission
+{
+  return _pimpl->_shared->_retransmission;
+}
+
 //==============================================================================
 void Participant::reached(PlanId plan, RouteId route, CheckpointId checkpoint)
 {
@@ -476,6 +627,12 @@ const Itinerary& Participant::itinerary() const
   return _pimpl->_shared->_current_itinerary;
 }
 
+//==============================================================================
+std::size_t Participant::itinerary_hash() const
+{
+  return _pimpl->_shared->current_itinerary_hash();
+}
+
 //==============================================================================
 ItineraryVersion Participant::version() const
 {
@@ -15,11 +15,38 @@
  *
 */
 
-#include <rmf_traffic/schedule/ParticipantDescription.hpp>
+#include "internal_ParticipantDescription.hpp"
+
+#include <rmf_traffic/geometry/ConvexShape.hpp>
+
+#include <mutex>
+#include <typeinfo>
+#include <unordered_map>
 
 namespace rmf_traffic {
 namespace schedule {
 
+namespace {
+//==============================================================================
+void hash_combine(std::size_t& seed, const std::size_t value)
+{
+  seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+//==============================================================================
+/// Equal shapes always have the same type and characteristic length, so those
+/// can be hashed without looking at each kind of shape.
+std::size_t hash_shape(const geometry::ConstFinalConvexShapePtr& shape)
+{
+  if (!shape)
+    return 0;
+
+  std::size_t seed = typeid(shape->source()).hash_code();
+  hash_combine(seed, std::hash<double>()(shape->get_characteristic_length()));
+  return seed;
+}
+} // anonymous namespace
+
 //==============================================================================
 class ParticipantDescription::Implementation
 {
@@ -30,6 +57,9 @@ public:
   Rx responsiveness;
   Profile profile;
 
+  /// The hash of the fields above, once it has been computed
+  mutable std::optional<std::size_t> hash = std::nullopt;
+
 };
 
 //==============================================================================
@@ -52,6 +82,11 @@ ParticipantDescription::ParticipantDescription(
 //==============================================================================
 bool ParticipantDescription::operator==(const ParticipantDescription& rhs) const
 {
+  const auto& hash = _pimpl->hash;
+  const auto& rhs_hash = rhs._pimpl->hash;
+  if (hash.has_value() && rhs_hash.has_value() && *hash != *rhs_hash)
+    return false;
+
   return _pimpl->name == rhs._pimpl->name &&
     _pimpl->owner == rhs._pimpl->owner &&
     _pimpl->responsiveness == rhs._pimpl->responsiveness &&
@@ -64,10 +99,27 @@ bool ParticipantDescription::operator!=(const ParticipantDescription& rhs) const
   return !(*this == rhs);
 }
 
+//==============================================================================
+std::size_t ParticipantDescription::hash() const
+{
+  if (_pimpl->hash.has_value())
+    return *_pimpl->hash;
+
+  std::size_t seed = std::hash<std::string>()(_pimpl->name);
+  hash_combine(seed, std::hash<std::string>()(_pimpl->owner));
+  hash_combine(seed, static_cast<std::size_t>(_pimpl->responsiveness));
+  hash_combine(seed, hash_shape(_pimpl->profile.footprint()));
+  hash_combine(seed, hash_shape(_pimpl->profile.vicinity()));
+
+  _pimpl->hash = seed;
+  return seed;
+}
+
 //==============================================================================
 ParticipantDescription& ParticipantDescription::name(std::string value)
 {
   _pimpl->name = std::move(value);
+  _pimpl->hash = std::nullopt;
   return *this;
 }
 
@@ -81,6 +133,7 @@ const std::string& ParticipantDescription::name() const
 ParticipantDescription& ParticipantDescription::owner(std::string value)
 {
   _pimpl->owner = std::move(value);
+  _pimpl->hash = std::nullopt;
   return *this;
 }
 
@@ -94,6 +147,7 @@ const std::string& ParticipantDescription::owner() const
 ParticipantDescription& ParticipantDescription::responsiveness(Rx value)
 {
   _pimpl->responsiveness = value;
+  _pimpl->hash = std::nullopt;
   return *this;
 }
 
@@ -107,6 +161,7 @@ auto ParticipantDescription::responsiveness() const -> Rx
 ParticipantDescription& ParticipantDescription::profile(Profile new_profile)
 {
   _pimpl->profile = std::move(new_profile);
+  _pimpl->hash = std::nullopt;
   return *this;
 }
 
@@ -116,5 +171,55 @@ const Profile& ParticipantDescription::profile() const
   return _pimpl->profile;
 }
 
+//==============================================================================
+std::shared_ptr<const ParticipantDescription> intern_description(
+  ParticipantDescription description)
+{
+  // Profiles made from interned shapes can be compared without looking at the
+  // shapes, so the shapes get interned along with the description.
+  Profile profile = description.profile();
+  const bool separate_vicinity = profile.vicinity() != profile.footprint();
+  if (const auto footprint = profile.footprint())
+    profile.footprint(geometry::intern_final_convex(*footprint));
+
+  if (separate_vicinity && profile.vicinity())
+    profile.vicinity(geometry::intern_final_convex(*profile.vicinity()));
+
+  description.profile(std::move(profile));
+  const std::size_t hash = description.hash();
+
+  static std::mutex mutex;
+  static std::unordered_multimap<
+    std::size_t, std::weak_ptr<const ParticipantDescription>> interned;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto range = interned.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    if (auto existing = it->second.lock())
+    {
+      if (*existing == description)
+        return existing;
+    }
+  }
+
+  auto output =
+    std::make_shared<const ParticipantDescription>(std::move(description));
+  interned.insert({hash, output});
+
+  if (interned.size() >= 64 && interned.size() % 64 == 0)
+  {
+    for (auto it = interned.begin(); it != interned.end(); )
+    {
+      if (it->second.expired())
+        it = interned.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  return output;
+}
+
 } // namespace schedule
 } // namespace rmf_traffic
@@ -0,0 +1,624 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_PatchCodec.hpp"
+#include "../geometry/Box.hpp"
+
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <array>
+#include <cmath>
+#include <set>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+class PatchEncoder::Implementation
+{
+public:
+
+  std::optional<Quantization> quantization;
+
+};
+
+namespace {
+using codec::to_nanoseconds;
+using codec::from_nanoseconds;
+
+//==============================================================================
+using QuantizedVector = std::array<int64_t, 3>;
+
+//==============================================================================
+QuantizedVector quantize(
+  const Eigen::Vector3d& value,
+  const PatchEncoder::Quantization& q)
+{
+  return {
+    std::llround(value[0] / q.translation),
+    std::llround(value[1] / q.translation),
+    std::llround(value[2] / q.rotation)
+  };
+}
+
+//==============================================================================
+Eigen::Vector3d dequantize(
+  const QuantizedVector& value,
+  const PatchEncoder::Quantization& q)
+{
+  return {
+    static_cast<double>(value[0]) * q.translation,
+    static_cast<double>(value[1]) * q.translation,
+    static_cast<double>(value[2]) * q.rotation
+  };
+}
+
+//==============================================================================
+using MapIndices = std::unordered_map<std::string, std::size_t>;
+
+} // anonymous namespace
+
+namespace codec {
+//==============================================================================
+void write_route(
+  Writer& writer,
+  const Route& route,
+  const std::optional<PatchEncoder::Quantization>& quantization,
+  Time& last_time)
+{
+  writer.varint(route.checkpoints().size());
+  uint64_t last_checkpoint = 0;
+  for (const auto checkpoint : route.checkpoints())
+  {
+    writer.varint(checkpoint - last_checkpoint);
+    last_checkpoint = checkpoint;
+  }
+
+  writer.varint(route.dependencies().size());
+  for (const auto& [participant, plan] : route.dependencies())
+  {
+    writer.varint(participant);
+    writer.byte(plan.plan().has_value() ? 1 : 0);
+    if (plan.plan().has_value())
+      writer.varint(*plan.plan());
+
+    writer.varint(plan.routes().size());
+    for (const auto& [route_id, checkpoints] : plan.routes())
+    {
+      writer.varint(route_id);
+      writer.varint(checkpoints.size());
+      for (const auto& [dependent, on] : checkpoints)
+      {
+        writer.varint(dependent);
+        writer.varint(on);
+      }
+    }
+  }
+
+  const Trajectory& trajectory = route.trajectory();
+  writer.varint(trajectory.size());
+  QuantizedVector last_position = {0, 0, 0};
+  for (const auto& wp : trajectory)
+  {
+    writer.zigzag(to_nanoseconds(wp.time() - last_time));
+    last_time = wp.time();
+
+    if (quantization.has_value())
+    {
+      const QuantizedVector p = quantize(wp.position(), *quantization);
+      for (std::size_t i = 0; i < 3; ++i)
+        writer.zigzag(p[i] - last_position[i]);
+      last_position = p;
+
+      const QuantizedVector v = quantize(wp.velocity(), *quantization);
+      for (std::size_t i = 0; i < 3; ++i)
+        writer.zigzag(v[i]);
+    }
+    else
+    {
+      const Eigen::Vector3d p = wp.position();
+      const Eigen::Vector3d v = wp.velocity();
+      for (std::size_t i = 0; i < 3; ++i)
+        writer.f64(p[i]);
+      for (std::size_t i = 0; i < 3; ++i)
+        writer.f64(v[i]);
+    }
+  }
+}
+
+//==============================================================================
+std::shared_ptr<Route> read_route(
+  Reader& reader,
+  std::string map,
+  const std::optional<PatchEncoder::Quantization>& quantization,
+  Time& last_time,
+  const bool build)
+{
+  std::set<uint64_t> checkpoints;
+  const std::size_t checkpoint_count = reader.count();
+  uint64_t checkpoint = 0;
+  for (std::size_t c = 0; c < checkpoint_count; ++c)
+  {
+    checkpoint += reader.varint();
+    if (build)
+      checkpoints.insert(checkpoints.end(), checkpoint);
+  }
+
+  DependsOnParticipant dependencies;
+  const std::size_t dependency_count = reader.count();
+  for (std::size_t d = 0; d < dependency_count; ++d)
+  {
+    const ParticipantId on_participant = reader.varint();
+    std::optional<PlanId> on_plan;
+    if (reader.byte())
+      on_plan = reader.varint();
+
+    DependsOnRoute on_routes;
+    const std::size_t on_route_count = reader.count();
+    for (std::size_t r = 0; r < on_route_count; ++r)
+    {
+      const RouteId on_route = reader.varint();
+      DependsOnCheckpoint on_checkpoints;
+      const std::size_t pair_count = reader.count();
+      for (std::size_t c = 0; c < pair_count; ++c)
+      {
+        const CheckpointId dependent = reader.varint();
+        const CheckpointId on = reader.varint();
+        if (build)
+          on_checkpoints[dependent] = on;
+      }
+
+      if (build)
+        on_routes[on_route] = std::move(on_checkpoints);
+    }
+
+    if (build)
+    {
+      dependencies[on_participant] =
+        DependsOnPlan().plan(on_plan).routes(std::move(on_routes));
+    }
+  }
+
+  // The times are checked as they are read, so the waypoints can be handed to
+  // the trajectory in one batch
+  std::vector<Trajectory::Point> waypoints;
+  const std::size_t waypoint_count = reader.count();
+  QuantizedVector last_position = {0, 0, 0};
+  for (std::size_t w = 0; w < waypoint_count; ++w)
+  {
+    const Duration dt = from_nanoseconds(reader.zigzag());
+    if (w > 0 && dt <= Duration(0))
+      reader.fail("the waypoint times of a route are not increasing");
+
+    const Time time = last_time + dt;
+    last_time = time;
+
+    Eigen::Vector3d position;
+    Eigen::Vector3d velocity;
+    if (quantization.has_value())
+    {
+      QuantizedVector p;
+      for (std::size_t k = 0; k < 3; ++k)
+        p[k] = last_position[k] + reader.zigzag();
+      last_position = p;
+
+      QuantizedVector v;
+      for (std::size_t k = 0; k < 3; ++k)
+        v[k] = reader.zigzag();
+
+      position = dequantize(p, *quantization);
+      velocity = dequantize(v, *quantization);
+    }
+    else
+    {
+      for (std::size_t k = 0; k < 3; ++k)
+        position[k] = reader.f64();
+      for (std::size_t k = 0; k < 3; ++k)
+        velocity[k] = reader.f64();
+    }
+
+    if (build)
+      waypoints.push_back({time, position, velocity});
+  }
+
+  if (!build)
+    return nullptr;
+
+  auto route = std::make_shared<Route>(
+    std::move(map), Trajectory(waypoints));
+  route->checkpoints(std::move(checkpoints));
+  route->dependencies(std::move(dependencies));
+  return route;
+}
+
+//==============================================================================
+void write_shape(Writer& writer, const geometry::FinalShape* shape)
+{
+  if (!shape)
+  {
+    writer.byte(0);
+    return;
+  }
+
+  const auto& source = shape->source();
+  if (const auto* circle = dynamic_cast<const geometry::Circle*>(&source))
+  {
+    writer.byte(1);
+    writer.f64(circle->get_radius());
+    return;
+  }
+
+  if (const auto* box = dynamic_cast<const geometry::Box*>(&source))
+  {
+    writer.byte(2);
+    writer.f64(box->get_x_length());
+    writer.f64(box->get_y_length());
+    return;
+  }
+
+  // *INDENT-OFF*
+  throw std::runtime_error(
+    "[rmf_traffic::schedule] Only circle and box shapes can be encoded");
+  // *INDENT-ON*
+}
+
+//==============================================================================
+geometry::ConstFinalConvexShapePtr read_shape(Reader& reader)
+{
+  const uint8_t type = reader.byte();
+  if (type == 0)
+    return nullptr;
+
+  if (type == 1)
+  {
+    const double radius = reader.f64();
+    return geometry::make_final_convex<geometry::Circle>(radius);
+  }
+
+  if (type == 2)
+  {
+    const double x = reader.f64();
+    const double y = reader.f64();
+    return geometry::make_final_convex<geometry::Box>(x, y);
+  }
+
+  reader.fail("unknown shape type [" + std::to_string(type) + "]");
+}
+} // namespace codec
+
+//==============================================================================
+PatchEncoder::PatchEncoder()
+: _pimpl(rmf_utils::make_impl<Implementation>())
+{
+  // Do nothing
+}
+
+//==============================================================================
+PatchEncoder& PatchEncoder::quantization(std::optional<Quantization> value)
+{
+  if (value.has_value()
+    && !(value->translation > 0.0 && value->rotation > 0.0))
+  {
+    // *INDENT-OFF*
+    throw std::invalid_argument(
+      "[rmf_traffic::schedule::PatchEncoder::quantization] The resolutions "
+      "must be positive, but they were [" + std::to_string(value->translation)
+      + "] and [" + std::to_string(value->rotation) + "]");
+    // *INDENT-ON*
+  }
+
+  _pimpl->quantization = value;
+  return *this;
+}
+
+//==============================================================================
+auto PatchEncoder::quantization() const -> std::optional<Quantization>
+{
+  return _pimpl->quantization;
+}
+
+//==============================================================================
+std::vector<uint8_t> PatchEncoder::encode(const Patch& patch) const
+{
+  const auto& quantization = _pimpl->quantization;
+
+  MapIndices maps;
+  std::vector<const std::string*> map_names;
+  for (const auto& p : patch)
+  {
+    for (const auto& item : p.additions().items())
+    {
+      const auto insertion = maps.insert({item.route->map(), maps.size()});
+      if (insertion.second)
+        map_names.push_back(&insertion.first->first);
+    }
+  }
+
+  codec::Writer writer;
+  for (const auto b : codec::Magic)
+    writer.byte(b);
+
+  writer.byte(PatchView::FormatVersion);
+
+  uint8_t flags = 0;
+  if (patch.base_version().has_value())
+    flags |= codec::HasBaseVersion;
+  if (patch.cull())
+    flags |= codec::HasCull;
+  if (quantization.has_value())
+    flags |= codec::Quantized;
+  writer.byte(flags);
+
+  if (quantization.has_value())
+  {
+    writer.f64(quantization->translation);
+    writer.f64(quantization->rotation);
+  }
+
+  if (patch.base_version().has_value())
+    writer.varint(*patch.base_version());
+
+  writer.varint(patch.latest_version());
+
+  if (const auto* cull = patch.cull())
+    writer.zigzag(to_nanoseconds(cull->time().time_since_epoch()));
+
+  writer.varint(map_names.size());
+  for (const auto* name : map_names)
+    writer.string(*name);
+
+  writer.varint(patch.size());
+  Time last_time = Time(Duration(0));
+  for (const auto& p : patch)
+  {
+    writer.varint(p.participant_id());
+    writer.varint(p.itinerary_version());
+
+    writer.varint(p.erasures().ids().size());
+    for (const auto id : p.erasures().ids())
+      writer.varint(id);
+
+    writer.varint(p.delays().size());
+    for (const auto& delay : p.delays())
+      writer.zigzag(to_nanoseconds(delay.duration()));
+
+    writer.varint(p.additions().plan_id());
+    writer.varint(p.additions().items().size());
+    for (const auto& item : p.additions().items())
+    {
+      writer.varint(item.route_id);
+      writer.varint(item.storage_id);
+      writer.varint(maps.at(item.route->map()));
+      codec::write_route(writer, *item.route, quantization, last_time);
+    }
+
+    const auto& progress = p.progress();
+    writer.byte(progress.has_value() ? 1 : 0);
+    if (progress.has_value())
+    {
+      writer.varint(progress->version());
+      writer.varint(progress->checkpoints().size());
+      for (const auto checkpoint : progress->checkpoints())
+        writer.varint(checkpoint);
+    }
+  }
+
+  return std::move(writer.data);
+}
+
+//==============================================================================
+PatchView::Implementation::Implementation(
+  const uint8_t* data,
+  const std::size_t size)
+: end(data + size)
+{
+  codec::Reader reader(data, end, "[rmf_traffic::schedule::PatchView]");
+  for (const auto b : codec::Magic)
+  {
+    if (reader.byte() != b)
+      reader.fail("the data does not start with the patch marker");
+  }
+
+  const uint8_t version = reader.byte();
+  if (version != PatchView::FormatVersion)
+  {
+    reader.fail(
+      "unsupported format version [" + std::to_string(version) + "]");
+  }
+
+  const uint8_t flags = reader.byte();
+  if (flags & codec::Quantized)
+  {
+    PatchEncoder::Quantization q;
+    q.translation = reader.f64();
+    q.rotation = reader.f64();
+    if (!(q.translation > 0.0 && q.rotation > 0.0))
+      reader.fail("the quantization resolutions must be positive");
+
+    quantization = q;
+  }
+
+  if (flags & codec::HasBaseVersion)
+    base_version = reader.varint();
+
+  latest_version = reader.varint();
+
+  if (flags & codec::HasCull)
+    cull = Time(from_nanoseconds(reader.zigzag()));
+
+  const std::size_t map_count = reader.count();
+  maps.reserve(map_count);
+  for (std::size_t i = 0; i < map_count; ++i)
+    maps.push_back(reader.string());
+
+  participant_count = reader.count();
+  participants = reader.position();
+
+  Time last_time = Time(Duration(0));
+  for (std::size_t i = 0; i < participant_count; ++i)
+    read_participant(reader, last_time, nullptr);
+
+  if (!reader.done())
+    reader.fail("there is data after the end of the patch");
+}
+
+//==============================================================================
+void PatchView::Implementation::read_participant(
+  codec::Reader& reader,
+  Time& last_time,
+  codec::ParticipantChanges* output) const
+{
+  const ParticipantId id = reader.varint();
+  const ItineraryVersion itinerary_version = reader.varint();
+  if (output)
+  {
+    output->id = id;
+    output->itinerary_version = itinerary_version;
+    output->erasures.clear();
+    output->delays.clear();
+    output->additions.clear();
+    output->progress = std::nullopt;
+  }
+
+  const std::size_t erasure_count = reader.count();
+  for (std::size_t i = 0; i < erasure_count; ++i)
+  {
+    const StorageId storage_id = reader.varint();
+    if (output)
+      output->erasures.push_back(storage_id);
+  }
+
+  const std::size_t delay_count = reader.count();
+  for (std::size_t i = 0; i < delay_count; ++i)
+  {
+    const Duration delay = from_nanoseconds(reader.zigzag());
+    if (output)
+      output->delays.push_back(delay);
+  }
+
+  const PlanId plan_id = reader.varint();
+  if (output)
+    output->plan_id = plan_id;
+
+  const std::size_t route_count = reader.count();
+  for (std::size_t i = 0; i < route_count; ++i)
+  {
+    const RouteId route_id = reader.varint();
+    const StorageId storage_id = reader.varint();
+    const uint64_t map_index = reader.varint();
+    if (map_index >= maps.size())
+      reader.fail("a route refers to a map that is not in the table");
+
+    auto route = codec::read_route(
+      reader,
+      output ? std::string(maps[map_index]) : std::string(),
+      quantization,
+      last_time,
+      output != nullptr);
+
+    if (output)
+    {
+      output->additions.push_back(
+        Change::Add::Item{route_id, storage_id, std::move(route)});
+    }
+  }
+
+  if (reader.byte())
+  {
+    const ProgressVersion version = reader.varint();
+    std::vector<CheckpointId> checkpoints;
+    const std::size_t checkpoint_count = reader.count();
+    for (std::size_t c = 0; c < checkpoint_count; ++c)
+    {
+      const CheckpointId reached = reader.varint();
+      if (output)
+        checkpoints.push_back(reached);
+    }
+
+    if (output)
+      output->progress = Change::Progress(version, std::move(checkpoints));
+  }
+}
+
+//==============================================================================
+PatchView::PatchView(const uint8_t* data, const std::size_t size)
+: _pimpl(rmf_utils::make_impl<Implementation>(data, size))
+{
+  // Do nothing
+}
+
+//==============================================================================
+PatchView::PatchView(const std::vector<uint8_t>& data)
+: PatchView(data.data(), data.size())
+{
+  // Do nothing
+}
+
+//==============================================================================
+std::size_t PatchView::size() const
+{
+  return _pimpl->participant_count;
+}
+
+//==============================================================================
+std::optional<Version> PatchView::base_version() const
+{
+  return _pimpl->base_version;
+}
+
+//==============================================================================
+Version PatchView::latest_version() const
+{
+  return _pimpl->latest_version;
+}
+
+//==============================================================================
+Patch PatchView::decode() const
+{
+  std::vector<Patch::Participant> participants;
+  participants.reserve(_pimpl->participant_count);
+  _pimpl->for_each_participant(
+    [&](codec::ParticipantChanges& changes)
+    {
+      std::vector<Change::Delay> delays;
+      delays.reserve(changes.delays.size());
+      for (const auto delay : changes.delays)
+        delays.emplace_back(delay);
+
+      participants.emplace_back(
+        changes.id,
+        changes.itinerary_version,
+        Change::Erase(changes.erasures),
+        std::move(delays),
+        Change::Add(changes.plan_id, std::move(changes.additions)),
+        std::move(changes.progress));
+    });
+
+  rmf_utils::optional<Change::Cull> cull;
+  if (_pimpl->cull.has_value())
+    cull = Change::Cull(*_pimpl->cull);
+
+  return Patch(
+    std::move(participants),
+    std::move(cull),
+    _pimpl->base_version,
+    _pimpl->latest_version);
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
@@ -17,10 +17,15 @@
 
 #include "../detail/internal_bidirectional_iterator.hpp"
 
-#include <rmf_traffic/schedule/Query.hpp>
+#include "internal_Query.hpp"
+
+#include "../TrajectoryInternal.hpp"
+#include "../internal_Region.hpp"
 
 #include <rmf_utils/optional.hpp>
 
+#include <algorithm>
+
 namespace rmf_traffic {
 namespace schedule {
 
@@ -113,6 +118,29 @@ public:
   }
 };
 
+//==============================================================================
+class Query::Spacetime::Corridor::Implementation
+{
+public:
+
+  std::string map;
+  Trajectory trajectory;
+  double radius;
+
+  static Corridor make(std::string map, Trajectory trajectory, double radius)
+  {
+    Corridor corridor;
+    corridor._pimpl = rmf_utils::make_impl<Implementation>(
+      Implementation{
+        std::move(map),
+        std::move(trajectory),
+        std::max(radius, 0.0)
+      });
+
+    return corridor;
+  }
+};
+
 //==============================================================================
 class Query::Spacetime::Implementation
 {
@@ -122,6 +150,7 @@ public:
   All all_instance;
   Regions regions_instance;
   Timespan timespan_instance;
+  Corridor corridor_instance;
 
   // TODO(MXG): We can make this more efficient by leaving the pimpls of
   // regions_instance and timespan_instance uninitialized until they actually
@@ -130,7 +159,8 @@ public:
   : regions_instance(Regions::Implementation::make({})),
     timespan_instance(
       Timespan::Implementation::make(
-        {}, rmf_utils::nullopt, rmf_utils::nullopt))
+        {}, rmf_utils::nullopt, rmf_utils::nullopt)),
+    corridor_instance(Corridor::Implementation::make({}, {}, 0.0))
   {
     // Do nothing
   }
@@ -484,14 +514,125 @@ auto Query::Spacetime::timespan() const -> const Timespan*
   return nullptr;
 }
 
+//==============================================================================
+const std::string& Query::Spacetime::Corridor::map() const
+{
+  return _pimpl->map;
+}
+
+//==============================================================================
+auto Query::Spacetime::Corridor::map(std::string map_name) -> Corridor&
+{
+  _pimpl->map = std::move(map_name);
+  return *this;
+}
+
+//==============================================================================
+const Trajectory& Query::Spacetime::Corridor::trajectory() const
+{
+  return _pimpl->trajectory;
+}
+
+//==============================================================================
+auto Query::Spacetime::Corridor::trajectory(Trajectory value) -> Corridor&
+{
+  _pimpl->trajectory = std::move(value);
+  return *this;
+}
+
+//==============================================================================
+double Query::Spacetime::Corridor::radius() const
+{
+  return _pimpl->radius;
+}
+
+//==============================================================================
+auto Query::Spacetime::Corridor::radius(const double value) -> Corridor&
+{
+  _pimpl->radius = std::max(value, 0.0);
+  return *this;
+}
+
+//==============================================================================
+Query::Spacetime::Corridor::Corridor()
+{
+  // Do nothing
+}
+
+//==============================================================================
+auto Query::Spacetime::query_corridor(
+  std::string map,
+  Trajectory trajectory,
+  const double radius) -> Corridor&
+{
+  _pimpl->mode = Mode::Corridor;
+  _pimpl->corridor_instance = Corridor::Implementation::make(
+    std::move(map), std::move(trajectory), radius);
+
+  return _pimpl->corridor_instance;
+}
+
+//==============================================================================
+auto Query::Spacetime::corridor() -> Corridor*
+{
+  if (Mode::Corridor == _pimpl->mode)
+    return &_pimpl->corridor_instance;
+
+  return nullptr;
+}
+
+//==============================================================================
+auto Query::Spacetime::corridor() const -> const Corridor*
+{
+  if (Mode::Corridor == _pimpl->mode)
+    return &_pimpl->corridor_instance;
+
+  return nullptr;
+}
+
 //==============================================================================
 bool operator==(
   const Query::Spacetime::Timespan& lhs,
   const Query::Spacetime::Timespan& rhs)
 {
-  return (lhs.maps() == rhs.maps() || (lhs.all_maps() && rhs.all_maps())) &&
-    *lhs.get_lower_time_bound() == *rhs.get_lower_time_bound() &&
-    *lhs.get_upper_time_bound() == *rhs.get_upper_time_bound();
+  const auto same_bound = [](const Time* a, const Time* b)
+    {
+      if (!a || !b)
+        return a == b;
+
+      return *a == *b;
+    };
+
+  if (lhs.all_maps() != rhs.all_maps())
+    return false;
+
+  return (lhs.all_maps() || lhs.maps() == rhs.maps()) &&
+    same_bound(lhs.get_lower_time_bound(), rhs.get_lower_time_bound()) &&
+    same_bound(lhs.get_upper_time_bound(), rhs.get_upper_time_bound());
+}
+
+//==============================================================================
+bool operator==(
+  const Query::Spacetime::Corridor& lhs,
+  const Query::Spacetime::Corridor& rhs)
+{
+  const Trajectory& lhs_t = lhs.trajectory();
+  const Trajectory& rhs_t = rhs.trajectory();
+  if (lhs.map() != rhs.map() || lhs.radius() != rhs.radius()
+    || lhs_t.size() != rhs_t.size())
+    return false;
+
+  auto lhs_it = lhs_t.begin();
+  auto rhs_it = rhs_t.begin();
+  for (; lhs_it != lhs_t.end(); ++lhs_it, ++rhs_it)
+  {
+    if (lhs_it->time() != rhs_it->time()
+      || lhs_it->position() != rhs_it->position()
+      || lhs_it->velocity() != rhs_it->velocity())
+      return false;
+  }
+
+  return true;
 }
 
 //==============================================================================
@@ -512,6 +653,8 @@ bool operator==(
       return *lhs.regions() == *rhs.regions();
     case Query::Spacetime::Mode::Timespan:
       return *lhs.timespan() == *rhs.timespan();
+    case Query::Spacetime::Mode::Corridor:
+      return *lhs.corridor() == *rhs.corridor();
     case Query::Spacetime::Mode::Invalid:
     default:
       return false;
@@ -555,13 +698,12 @@ bool operator==(
 
 namespace {
 //==============================================================================
+// The IDs are kept sorted so that filters with the same set of IDs compare
+// and hash the same no matter what order the IDs were given in.
 std::vector<ParticipantId> uniquify(std::vector<ParticipantId> ids)
 {
-  std::unordered_set<ParticipantId> unique_ids;
-  for (const auto id : ids)
-    unique_ids.insert(id);
-
-  ids.assign(unique_ids.begin(), unique_ids.end());
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
   return ids;
 }
 } // anonymous namespace
@@ -573,6 +715,14 @@ public:
 
   std::vector<ParticipantId> ids;
 
+  // This is filled in by get_id_set() and cleared whenever the IDs change
+  mutable ConstParticipantIdSetPtr compiled = nullptr;
+
+  static const Implementation& get(const Include& filter)
+  {
+    return *filter._pimpl;
+  }
+
 };
 
 //==============================================================================
@@ -594,6 +744,7 @@ auto Query::Participants::Include::set_ids(std::vector<ParticipantId> ids)
 -> Include&
 {
   _pimpl->ids = uniquify(std::move(ids));
+  _pimpl->compiled = nullptr;
   return *this;
 }
 
@@ -618,6 +769,14 @@ public:
 
   std::vector<ParticipantId> ids;
 
+  // This is filled in by get_id_set() and cleared whenever the IDs change
+  mutable ConstParticipantIdSetPtr compiled = nullptr;
+
+  static const Implementation& get(const Exclude& filter)
+  {
+    return *filter._pimpl;
+  }
+
 };
 
 //==============================================================================
@@ -639,6 +798,7 @@ auto Query::Participants::Exclude::set_ids(std::vector<ParticipantId> ids)
 -> Exclude&
 {
   _pimpl->ids = uniquify(std::move(ids));
+  _pimpl->compiled = nullptr;
   return *this;
 }
 
@@ -656,6 +816,41 @@ bool operator==(
   return lhs.get_ids() == rhs.get_ids();
 }
 
+namespace {
+//==============================================================================
+template<typename Impl>
+ConstParticipantIdSetPtr get_compiled(const Impl& impl)
+{
+  // Queries may be shared between threads, so the cache is accessed
+  // atomically. Two threads might both compile the set, but they will get
+  // the same result.
+  auto compiled = std::atomic_load(&impl.compiled);
+  if (!compiled)
+  {
+    compiled = std::make_shared<ParticipantIdSet>(impl.ids);
+    std::atomic_store(&impl.compiled, compiled);
+  }
+
+  return compiled;
+}
+} // anonymous namespace
+
+//==============================================================================
+ConstParticipantIdSetPtr get_id_set(
+  const Query::Participants::Include& include)
+{
+  using Implementation = Query::Participants::Include::Implementation;
+  return get_compiled(Implementation::get(include));
+}
+
+//==============================================================================
+ConstParticipantIdSetPtr get_id_set(
+  const Query::Participants::Exclude& exclude)
+{
+  using Implementation = Query::Participants::Exclude::Implementation;
+  return get_compiled(Implementation::get(exclude));
+}
+
 //==============================================================================
 Query::Participants::Participants()
 : _pimpl(rmf_utils::make_impl<Implementation>())
@@ -857,6 +1052,167 @@ Query::Query()
   // Do nothing
 }
 
+//==============================================================================
+std::size_t Query::hash() const
+{
+  std::size_t seed = hash_spacetime(spacetime());
+  hash_combine(seed, hash_participants(participants()));
+  return seed;
+}
+
+namespace {
+//==============================================================================
+bool same_bound(const Time* a, const Time* b)
+{
+  if (!a || !b)
+    return a == b;
+
+  return *a == *b;
+}
+
+//==============================================================================
+/// Nullptr bounds come first
+bool bound_less(const Time* a, const Time* b)
+{
+  if (!a || !b)
+    return !a && b;
+
+  return *a < *b;
+}
+} // anonymous namespace
+
+//==============================================================================
+Query& Query::canonicalize()
+{
+  if (auto* regions = spacetime().regions())
+  {
+    // Merge the regions that cover the same map and time range, leaving out
+    // any spaces that are repeated
+    std::vector<Region> merged;
+    for (const Region& region : *regions)
+    {
+      const auto it = std::find_if(merged.begin(), merged.end(),
+          [&](const Region& other)
+          {
+            return RegionData::get_map(other) == RegionData::get_map(region)
+            && same_bound(
+              other.get_lower_time_bound(), region.get_lower_time_bound())
+            && same_bound(
+              other.get_upper_time_bound(), region.get_upper_time_bound());
+          });
+
+      Region* target = nullptr;
+      if (it == merged.end())
+      {
+        merged.push_back(region);
+        target = &merged.back();
+        target->erase(target->begin(), target->end());
+      }
+      else
+      {
+        target = &(*it);
+      }
+
+      for (const auto& space : region)
+      {
+        bool repeated = false;
+        for (const auto& existing : *target)
+        {
+          if (existing == space)
+          {
+            repeated = true;
+            break;
+          }
+        }
+
+        if (!repeated)
+          target->push_back(space);
+      }
+    }
+
+    std::stable_sort(merged.begin(), merged.end(),
+      [](const Region& a, const Region& b)
+      {
+        if (a.get_map() != b.get_map())
+          return a.get_map() < b.get_map();
+
+        const Time* const a_lower = a.get_lower_time_bound();
+        const Time* const b_lower = b.get_lower_time_bound();
+        if (!same_bound(a_lower, b_lower))
+          return bound_less(a_lower, b_lower);
+
+        return bound_less(a.get_upper_time_bound(), b.get_upper_time_bound());
+      });
+
+    spacetime().query_regions(std::move(merged));
+  }
+  else if (auto* timespan = spacetime().timespan())
+  {
+    if (timespan->all_maps())
+      timespan->clear_maps();
+  }
+
+  return *this;
+}
+
+//==============================================================================
+class SharedQuery::Implementation
+{
+public:
+
+  Query query;
+  std::size_t hash;
+
+};
+
+//==============================================================================
+SharedQuery::SharedQuery(Query query)
+{
+  query.canonicalize();
+  const std::size_t hash = query.hash();
+  _pimpl = std::make_shared<const Implementation>(
+    Implementation{std::move(query), hash});
+}
+
+//==============================================================================
+const Query& SharedQuery::get() const
+{
+  return _pimpl->query;
+}
+
+//==============================================================================
+const Query& SharedQuery::operator*() const
+{
+  return _pimpl->query;
+}
+
+//==============================================================================
+const Query* SharedQuery::operator->() const
+{
+  return &_pimpl->query;
+}
+
+//==============================================================================
+std::size_t SharedQuery::hash() const
+{
+  return _pimpl->hash;
+}
+
+//==============================================================================
+bool operator==(const SharedQuery& lhs, const SharedQuery& rhs)
+{
+  if (&lhs.get() == &rhs.get())
+    return true;
+
+  return lhs.hash() == rhs.hash() && lhs.get() == rhs.get();
+}
+
+//==============================================================================
+bool operator!=(const SharedQuery& lhs, const SharedQuery& rhs)
+{
+  return !(lhs == rhs);
+}
+
 //==============================================================================
 Query query_all()
 {
@@ -896,6 +1252,226 @@ bool operator!=(
   return !(lhs == rhs);
 }
 
+//==============================================================================
+void hash_combine(std::size_t& seed, const std::size_t value)
+{
+  seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+namespace {
+//==============================================================================
+std::size_t hash_bound(const Time* bound)
+{
+  if (!bound)
+    return 0;
+
+  return std::hash<Time::rep>()(bound->time_since_epoch().count()) + 1;
+}
+} // anonymous namespace
+
+//==============================================================================
+std::size_t hash_spacetime(const Query::Spacetime& spacetime)
+{
+  using Mode = Query::Spacetime::Mode;
+  const Mode mode = spacetime.get_mode();
+  std::size_t seed = static_cast<std::size_t>(mode);
+  if (Mode::Regions == mode)
+  {
+    // Spaces are compared with a tolerance, so they are only counted
+    for (const Region& region : *spacetime.regions())
+    {
+      hash_combine(seed, RegionData::get_map(region).id());
+      hash_combine(seed, hash_bound(region.get_lower_time_bound()));
+      hash_combine(seed, hash_bound(region.get_upper_time_bound()));
+      hash_combine(seed, region.num_spaces());
+    }
+  }
+  else if (Mode::Timespan == mode)
+  {
+    const auto& timespan = *spacetime.timespan();
+    hash_combine(seed, timespan.all_maps());
+    if (!timespan.all_maps())
+    {
+      // The maps are not in any particular order, so their hashes are summed
+      std::size_t maps = 0;
+      for (const auto& map : timespan.maps())
+        maps += std::hash<std::string>()(map);
+
+      hash_combine(seed, maps);
+    }
+
+    hash_combine(seed, hash_bound(timespan.get_lower_time_bound()));
+    hash_combine(seed, hash_bound(timespan.get_upper_time_bound()));
+  }
+  else if (Mode::Corridor == mode)
+  {
+    const auto& corridor = *spacetime.corridor();
+    hash_combine(seed, std::hash<std::string>()(corridor.map()));
+    hash_combine(seed, std::hash<double>()(corridor.radius()));
+    const Trajectory& trajectory = corridor.trajectory();
+    hash_combine(seed, trajectory.size());
+    for (const auto& waypoint : trajectory)
+    {
+      const Time time = waypoint.time();
+      hash_combine(seed, hash_bound(&time));
+    }
+  }
+
+  return seed;
+}
+
+//==============================================================================
+std::size_t hash_participants(const Query::Participants& participants)
+{
+  using Mode = Query::Participants::Mode;
+  const Mode mode = participants.get_mode();
+  std::size_t seed = static_cast<std::size_t>(mode);
+
+  const std::vector<ParticipantId>* ids = nullptr;
+  if (const auto* include = participants.include())
+    ids = &include->get_ids();
+  else if (const auto* exclude = participants.exclude())
+    ids = &exclude->get_ids();
+
+  if (ids)
+  {
+    for (const auto id : *ids)
+      hash_combine(seed, std::hash<ParticipantId>()(id));
+  }
+
+  return seed;
+}
+
+namespace {
+//==============================================================================
+/// The span of time and space that one segment of a trajectory might occupy.
+/// A trajectory with a single waypoint has one segment that only lasts for an
+/// instant.
+struct SegmentSpan
+{
+  Time start;
+  Time finish;
+  const rmf_traffic::internal::BoundingBox* box;
+};
+
+//==============================================================================
+std::size_t count_segments(const rmf_traffic::internal::SegmentCache& cache)
+{
+  return std::max<std::size_t>(cache.times.size(), 2) - 1;
+}
+
+//==============================================================================
+SegmentSpan get_segment(
+  const rmf_traffic::internal::SegmentCache& cache,
+  const std::size_t i)
+{
+  if (cache.times.size() == 1)
+    return {cache.times[0], cache.times[0], &cache.bounds[0]};
+
+  return {cache.times[i], cache.times[i+1], &cache.bounds[i+1]};
+}
+
+//==============================================================================
+bool boxes_overlap(
+  const rmf_traffic::internal::BoundingBox& a,
+  const rmf_traffic::internal::BoundingBox& b,
+  const double margin)
+{
+  for (int k = 0; k < 2; ++k)
+  {
+    if (a.max[k] + margin < b.min[k] || b.max[k] + margin < a.min[k])
+      return false;
+  }
+
+  return true;
+}
+
+//==============================================================================
+double reach(const Profile& profile)
+{
+  double output = 0.0;
+  if (const auto& footprint = profile.footprint())
+    output = footprint->get_characteristic_length();
+
+  if (const auto& vicinity = profile.vicinity())
+    output = std::max(output, vicinity->get_characteristic_length());
+
+  return output;
+}
+} // anonymous namespace
+
+//==============================================================================
+CorridorFilter::CorridorFilter(const Query::Spacetime::Corridor& corridor)
+: _map(&corridor.map()),
+  _radius(corridor.radius())
+{
+  const Trajectory& trajectory = corridor.trajectory();
+  if (trajectory.empty())
+    return;
+
+  _segments = rmf_traffic::internal::get_segment_cache(trajectory);
+  _lower_time_bound = *trajectory.start_time();
+  _upper_time_bound = *trajectory.finish_time();
+}
+
+//==============================================================================
+const std::string& CorridorFilter::map() const
+{
+  return *_map;
+}
+
+//==============================================================================
+const Time* CorridorFilter::lower_time_bound() const
+{
+  return _lower_time_bound.has_value() ? &*_lower_time_bound : nullptr;
+}
+
+//==============================================================================
+const Time* CorridorFilter::upper_time_bound() const
+{
+  return _upper_time_bound.has_value() ? &*_upper_time_bound : nullptr;
+}
+
+//==============================================================================
+bool CorridorFilter::relevant(
+  const Profile& profile,
+  const Trajectory& trajectory) const
+{
+  if (!_segments || trajectory.empty())
+    return false;
+
+  if (*trajectory.finish_time() < *_lower_time_bound
+    || *_upper_time_bound < *trajectory.start_time())
+    return false;
+
+  const auto other = rmf_traffic::internal::get_segment_cache(trajectory);
+  const double margin = _radius + reach(profile);
+  if (!boxes_overlap(_segments->total_bounds, other->total_bounds, margin))
+    return false;
+
+  // Sweep through both lists of segments in time order, comparing the boxes
+  // of each pair of segments that overlap in time.
+  const std::size_t n = count_segments(*_segments);
+  const std::size_t m = count_segments(*other);
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < n && j < m)
+  {
+    const auto a = get_segment(*_segments, i);
+    const auto b = get_segment(*other, j);
+    if (a.start <= b.finish && b.start <= a.finish
+      && boxes_overlap(*a.box, *b.box, margin))
+      return true;
+
+    if (a.finish < b.finish)
+      ++i;
+    else
+      ++j;
+  }
+
+  return false;
+}
+
 } // namespace schedule
 
 namespace detail {
@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_QueryCache.hpp"
+#include "internal_Query.hpp"
+#include "ViewerInternal.hpp"
+
+namespace rmf_traffic {
+namespace schedule {
+
+namespace {
+//==============================================================================
+bool same_bound(const Time* lhs, const Time* rhs)
+{
+  if (!lhs || !rhs)
+    return lhs == rhs;
+
+  return *lhs == *rhs;
+}
+
+//==============================================================================
+bool same_timespan(
+  const Query::Spacetime::Timespan& lhs,
+  const Query::Spacetime::Timespan& rhs)
+{
+  if (lhs.all_maps() != rhs.all_maps())
+    return false;
+
+  if (!lhs.all_maps() && lhs.maps() != rhs.maps())
+    return false;
+
+  return same_bound(lhs.get_lower_time_bound(), rhs.get_lower_time_bound())
+    && same_bound(lhs.get_upper_time_bound(), rhs.get_upper_time_bound());
+}
+
+//==============================================================================
+bool same_regions(
+  const Query::Spacetime::Regions& lhs,
+  const Query::Spacetime::Regions& rhs)
+{
+  if (lhs.size() != rhs.size())
+    return false;
+
+  auto lhs_it = lhs.begin();
+  auto rhs_it = rhs.begin();
+  for (; lhs_it != lhs.end(); ++lhs_it, ++rhs_it)
+  {
+    if (!(*lhs_it == *rhs_it))
+      return false;
+  }
+
+  return true;
+}
+
+//==============================================================================
+bool same_spacetime(const Query::Spacetime& lhs, const Query::Spacetime& rhs)
+{
+  if (lhs.get_mode() != rhs.get_mode())
+    return false;
+
+  switch (lhs.get_mode())
+  {
+    case Query::Spacetime::Mode::All:
+      return true;
+    case Query::Spacetime::Mode::Regions:
+      return same_regions(*lhs.regions(), *rhs.regions());
+    case Query::Spacetime::Mode::Timespan:
+      return same_timespan(*lhs.timespan(), *rhs.timespan());
+    case Query::Spacetime::Mode::Corridor:
+      return *lhs.corridor() == *rhs.corridor();
+    default:
+      return false;
+  }
+}
+
+//==============================================================================
+/// True if every route that is relevant to the inner timespan is also relevant
+/// to the outer one.
+bool encloses(
+  const Query::Spacetime::Timespan& outer,
+  const Query::Spacetime::Timespan& inner)
+{
+  if (!outer.all_maps())
+  {
+    if (inner.all_maps())
+      return false;
+
+    for (const auto& map : inner.maps())
+    {
+      if (outer.maps().count(map) == 0)
+        return false;
+    }
+  }
+
+  const Time* const outer_lower = outer.get_lower_time_bound();
+  const Time* const inner_lower = inner.get_lower_time_bound();
+  if (outer_lower && (!inner_lower || *inner_lower < *outer_lower))
+    return false;
+
+  const Time* const outer_upper = outer.get_upper_time_bound();
+  const Time* const inner_upper = inner.get_upper_time_bound();
+  if (outer_upper && (!inner_upper || *outer_upper < *inner_upper))
+    return false;
+
+  return true;
+}
+
+//==============================================================================
+/// This matches the relevance test that the timeline uses for timespans.
+bool within_timespan(
+  const Query::Spacetime::Timespan& timespan,
+  const Route& route)
+{
+  if (!timespan.all_maps() && timespan.maps().count(route.map()) == 0)
+    return false;
+
+  const Trajectory& trajectory = route.trajectory();
+  const Time* const lower = timespan.get_lower_time_bound();
+  if (lower && *trajectory.finish_time() < *lower)
+    return false;
+
+  const Time* const upper = timespan.get_upper_time_bound();
+  if (upper && *upper < *trajectory.start_time())
+    return false;
+
+  return true;
+}
+
+//==============================================================================
+bool same_participants(
+  const Query::Participants& lhs,
+  const Query::Participants& rhs)
+{
+  if (lhs.get_mode() != rhs.get_mode())
+    return false;
+
+  switch (lhs.get_mode())
+  {
+    case Query::Participants::Mode::All:
+      return true;
+    case Query::Participants::Mode::Include:
+      return lhs.include()->get_ids() == rhs.include()->get_ids();
+    case Query::Participants::Mode::Exclude:
+      return lhs.exclude()->get_ids() == rhs.exclude()->get_ids();
+    default:
+      return false;
+  }
+}
+
+//==============================================================================
+/// A participant filter compiled for testing the participants of cached routes
+class ParticipantTest
+{
+public:
+
+  ParticipantTest(const Query::Participants& participants)
+  {
+    if (const auto* include = participants.include())
+      _include = get_id_set(*include);
+    else if (const auto* exclude = participants.exclude())
+      _exclude = get_id_set(*exclude);
+  }
+
+  bool admits(const ParticipantId participant) const
+  {
+    if (_include)
+      return _include->contains(participant);
+
+    if (_exclude)
+      return !_exclude->contains(participant);
+
+    return true;
+  }
+
+private:
+  ConstParticipantIdSetPtr _include;
+  ConstParticipantIdSetPtr _exclude;
+};
+
+} // anonymous namespace
+
+//==============================================================================
+void QueryCache::set_capacity(const std::size_t capacity)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _capacity = capacity;
+  while (_entries.size() > capacity)
+    _entries.pop_back();
+}
+
+//==============================================================================
+std::size_t QueryCache::get_capacity() const
+{
+  return _capacity;
+}
+
+//==============================================================================
+void QueryCache::clear()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _entries.clear();
+  _version = std::nullopt;
+}
+
+//==============================================================================
+std::optional<Viewer::View> QueryCache::find(
+  const Query::Spacetime& spacetime,
+  const Query::Participants& participants,
+  const Version version)
+{
+  std::shared_ptr<const Viewer::View> cached;
+  bool filter_spacetime = false;
+  bool filter_participants = false;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_version != version)
+    {
+      _entries.clear();
+      _version = version;
+      return std::nullopt;
+    }
+
+    const auto* const timespan = spacetime.timespan();
+    for (auto it = _entries.begin(); it != _entries.end(); ++it)
+    {
+      const bool exact_participants =
+        same_participants(it->participants, participants);
+
+      if (!exact_participants
+        && it->participants.get_mode() != Query::Participants::Mode::All)
+        continue;
+
+      bool exact_spacetime = same_spacetime(it->spacetime, spacetime);
+      if (!exact_spacetime)
+      {
+        if (!timespan)
+          continue;
+
+        const auto mode = it->spacetime.get_mode();
+        if (mode == Query::Spacetime::Mode::Timespan)
+        {
+          if (!encloses(*it->spacetime.timespan(), *timespan))
+            continue;
+        }
+        else if (mode != Query::Spacetime::Mode::All)
+        {
+          continue;
+        }
+      }
+
+      filter_spacetime = !exact_spacetime;
+      filter_participants = !exact_participants;
+      cached = it->view;
+      _entries.splice(_entries.begin(), _entries, it);
+      break;
+    }
+  }
+
+  if (!cached)
+    return std::nullopt;
+
+  if (!filter_spacetime && !filter_participants)
+    return *cached;
+
+  // The cached view covers more than this query asked for, so only keep the
+  // routes that this query would have found.
+  const ParticipantTest participant_test(participants);
+  return Viewer::View::Implementation::make_filtered_view(
+    *cached, [&](const Viewer::View::Element& element)
+    {
+      if (filter_participants && !participant_test.admits(element.participant))
+        return false;
+
+      if (filter_spacetime
+        && !within_timespan(*spacetime.timespan(), *element.route))
+        return false;
+
+      return true;
+    });
+}
+
+//==============================================================================
+void QueryCache::insert(
+  const Query::Spacetime& spacetime,
+  const Query::Participants& participants,
+  const Version version,
+  const Viewer::View& view)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_version != version || _capacity == 0)
+    return;
+
+  _entries.push_front(
+    Entry{spacetime, participants, std::make_shared<Viewer::View>(view)});
+
+  while (_entries.size() > _capacity)
+    _entries.pop_back();
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
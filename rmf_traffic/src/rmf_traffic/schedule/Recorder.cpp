@@ -0,0 +1,962 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/Recorder.hpp>
+
+#include "internal_PatchCodec.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace rmf_traffic {
+namespace schedule {
+
+namespace {
+using codec::to_nanoseconds;
+using codec::from_nanoseconds;
+using Clock = std::chrono::steady_clock;
+
+//==============================================================================
+/// The layout of the binary format, version 1, using the same integer
+/// encodings as PatchEncoder.
+///
+/// Header:
+///   "RMFR", format version (byte)
+///
+/// Each call:
+///   operation (byte), time since the previous call (signed nanoseconds)
+///   then the arguments of the call, in the order that the Writer or Database
+///   function takes them. Itineraries are stored as a route count followed by
+///   each map name and route. Participant IDs of registrations are the ones
+///   that the recorded Database gave out.
+constexpr uint8_t RecorderMagic[4] = {'R', 'M', 'F', 'R'};
+
+//==============================================================================
+void write_time(codec::Writer& writer, const Time time)
+{
+  writer.zigzag(to_nanoseconds(time.time_since_epoch()));
+}
+
+//==============================================================================
+Time read_time(codec::Reader& reader)
+{
+  return Time(from_nanoseconds(reader.zigzag()));
+}
+
+//==============================================================================
+void write_optional_time(codec::Writer& writer, const Time* time)
+{
+  writer.byte(time ? 1 : 0);
+  if (time)
+    write_time(writer, *time);
+}
+
+//==============================================================================
+std::optional<Time> read_optional_time(codec::Reader& reader)
+{
+  if (!reader.byte())
+    return std::nullopt;
+
+  return read_time(reader);
+}
+
+//==============================================================================
+void write_itinerary(codec::Writer& writer, const Itinerary& itinerary)
+{
+  writer.varint(itinerary.size());
+  Time last_time = Time(Duration(0));
+  for (const auto& route : itinerary)
+  {
+    writer.string(route.map());
+    codec::write_route(writer, route, std::nullopt, last_time);
+  }
+}
+
+//==============================================================================
+Itinerary read_itinerary(codec::Reader& reader)
+{
+  Itinerary itinerary;
+  const std::size_t count = reader.count();
+  itinerary.reserve(count);
+  Time last_time = Time(Duration(0));
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    std::string map(reader.string());
+    const auto route = codec::read_route(
+      reader, std::move(map), std::nullopt, last_time, true);
+    itinerary.push_back(*route);
+  }
+
+  return itinerary;
+}
+
+//==============================================================================
+void write_description(
+  codec::Writer& writer,
+  const ParticipantDescription& description)
+{
+  writer.string(description.name());
+  writer.string(description.owner());
+  writer.byte(static_cast<uint8_t>(description.responsiveness()));
+  codec::write_shape(writer, description.profile().footprint().get());
+  codec::write_shape(writer, description.profile().vicinity().get());
+}
+
+//==============================================================================
+ParticipantDescription read_description(codec::Reader& reader)
+{
+  std::string name(reader.string());
+  std::string owner(reader.string());
+  const auto rx = static_cast<ParticipantDescription::Rx>(reader.byte());
+  auto footprint = codec::read_shape(reader);
+  auto vicinity = codec::read_shape(reader);
+
+  return ParticipantDescription(
+    std::move(name),
+    std::move(owner),
+    rx,
+    Profile(std::move(footprint), std::move(vicinity)));
+}
+
+//==============================================================================
+void write_trajectory(codec::Writer& writer, const Trajectory& trajectory)
+{
+  writer.varint(trajectory.size());
+  for (const auto& wp : trajectory)
+  {
+    write_time(writer, wp.time());
+    const Eigen::Vector3d p = wp.position();
+    const Eigen::Vector3d v = wp.velocity();
+    for (std::size_t i = 0; i < 3; ++i)
+      writer.f64(p[i]);
+    for (std::size_t i = 0; i < 3; ++i)
+      writer.f64(v[i]);
+  }
+}
+
+//==============================================================================
+Trajectory read_trajectory(codec::Reader& reader)
+{
+  Trajectory trajectory;
+  const std::size_t count = reader.count();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const Time time = read_time(reader);
+    Eigen::Vector3d p;
+    Eigen::Vector3d v;
+    for (std::size_t k = 0; k < 3; ++k)
+      p[k] = reader.f64();
+    for (std::size_t k = 0; k < 3; ++k)
+      v[k] = reader.f64();
+
+    trajectory.insert(time, p, v);
+  }
+
+  return trajectory;
+}
+
+//==============================================================================
+void write_ids(codec::Writer& writer, const std::vector<ParticipantId>& ids)
+{
+  writer.varint(ids.size());
+  for (const auto id : ids)
+    writer.varint(id);
+}
+
+//==============================================================================
+std::vector<ParticipantId> read_ids(codec::Reader& reader)
+{
+  std::vector<ParticipantId> ids(reader.count());
+  for (auto& id : ids)
+    id = reader.varint();
+
+  return ids;
+}
+
+//==============================================================================
+void write_query(codec::Writer& writer, const Query& query)
+{
+  using Spacetime = Query::Spacetime;
+  const auto& spacetime = query.spacetime();
+  const auto s_mode = spacetime.get_mode();
+  writer.byte(static_cast<uint8_t>(s_mode));
+  if (s_mode == Spacetime::Mode::Regions)
+  {
+    const auto& regions = *spacetime.regions();
+    writer.varint(regions.size());
+    for (const auto& region : regions)
+    {
+      writer.string(region.get_map());
+      write_optional_time(writer, region.get_lower_time_bound());
+      write_optional_time(writer, region.get_upper_time_bound());
+      writer.varint(region.num_spaces());
+      for (const auto& space : region)
+      {
+        codec::write_shape(writer, space.get_shape().get());
+        const Eigen::Isometry2d& pose = space.get_pose();
+        const Eigen::Matrix2d R = pose.rotation();
+        writer.f64(pose.translation().x());
+        writer.f64(pose.translation().y());
+        writer.f64(std::atan2(R(1, 0), R(0, 0)));
+      }
+    }
+  }
+  else if (s_mode == Spacetime::Mode::Timespan)
+  {
+    const auto& timespan = *spacetime.timespan();
+    writer.byte(timespan.all_maps() ? 1 : 0);
+    if (!timespan.all_maps())
+    {
+      writer.varint(timespan.maps().size());
+      for (const auto& map : timespan.maps())
+        writer.string(map);
+    }
+
+    write_optional_time(writer, timespan.get_lower_time_bound());
+    write_optional_time(writer, timespan.get_upper_time_bound());
+  }
+  else if (s_mode == Spacetime::Mode::Corridor)
+  {
+    const auto& corridor = *spacetime.corridor();
+    writer.string(corridor.map());
+    writer.f64(corridor.radius());
+    write_trajectory(writer, corridor.trajectory());
+  }
+
+  using Participants = Query::Participants;
+  const auto& participants = query.participants();
+  const auto p_mode = participants.get_mode();
+  writer.byte(static_cast<uint8_t>(p_mode));
+  if (p_mode == Participants::Mode::Include)
+    write_ids(writer, participants.include()->get_ids());
+  else if (p_mode == Participants::Mode::Exclude)
+    write_ids(writer, participants.exclude()->get_ids());
+}
+
+//==============================================================================
+Query read_query(codec::Reader& reader)
+{
+  using Spacetime = Query::Spacetime;
+  Query query = query_all();
+  auto& spacetime = query.spacetime();
+  const auto s_mode = static_cast<Spacetime::Mode>(reader.byte());
+  if (s_mode == Spacetime::Mode::All)
+  {
+    spacetime.query_all();
+  }
+  else if (s_mode == Spacetime::Mode::Regions)
+  {
+    std::vector<Region> regions;
+    const std::size_t count = reader.count();
+    regions.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      std::string map(reader.string());
+      const auto lower = read_optional_time(reader);
+      const auto upper = read_optional_time(reader);
+
+      std::vector<geometry::Space> spaces;
+      const std::size_t num_spaces = reader.count();
+      spaces.reserve(num_spaces);
+      for (std::size_t k = 0; k < num_spaces; ++k)
+      {
+        auto shape = codec::read_shape(reader);
+        if (!shape)
+          reader.fail("a region has a space without a shape");
+
+        const double x = reader.f64();
+        const double y = reader.f64();
+        const double angle = reader.f64();
+        Eigen::Isometry2d pose = Eigen::Isometry2d::Identity();
+        pose.translate(Eigen::Vector2d(x, y));
+        pose.rotate(Eigen::Rotation2Dd(angle));
+        spaces.emplace_back(std::move(shape), pose);
+      }
+
+      Region region(std::move(map), std::move(spaces));
+      if (lower.has_value())
+        region.set_lower_time_bound(*lower);
+      if (upper.has_value())
+        region.set_upper_time_bound(*upper);
+
+      regions.push_back(std::move(region));
+    }
+
+    spacetime.query_regions(std::move(regions));
+  }
+  else if (s_mode == Spacetime::Mode::Timespan)
+  {
+    const bool all_maps = reader.byte() != 0;
+    auto& timespan = spacetime.query_timespan(all_maps);
+    if (!all_maps)
+    {
+      const std::size_t count = reader.count();
+      for (std::size_t i = 0; i < count; ++i)
+        timespan.add_map(std::string(reader.string()));
+    }
+
+    if (const auto lower = read_optional_time(reader))
+      timespan.set_lower_time_bound(*lower);
+    if (const auto upper = read_optional_time(reader))
+      timespan.set_upper_time_bound(*upper);
+  }
+  else if (s_mode == Spacetime::Mode::Corridor)
+  {
+    std::string map(reader.string());
+    const double radius = reader.f64();
+    spacetime.query_corridor(std::move(map), read_trajectory(reader), radius);
+  }
+  else
+  {
+    reader.fail(
+      "unknown spacetime mode [" + std::to_string(
+        static_cast<unsigned int>(s_mode)) + "]");
+  }
+
+  using Participants = Query::Participants;
+  auto& participants = query.participants();
+  const auto p_mode = static_cast<Participants::Mode>(reader.byte());
+  if (p_mode == Participants::Mode::Include)
+  {
+    participants.include(read_ids(reader));
+  }
+  else if (p_mode == Participants::Mode::Exclude)
+  {
+    participants.exclude(read_ids(reader));
+  }
+  else if (p_mode != Participants::Mode::All)
+  {
+    reader.fail(
+      "unknown participants mode [" + std::to_string(
+        static_cast<unsigned int>(p_mode)) + "]");
+  }
+
+  return query;
+}
+
+} // anonymous namespace
+
+//==============================================================================
+class Recorder::Implementation
+{
+public:
+
+  std::shared_ptr<Database> database;
+
+  mutable std::mutex mutex;
+  codec::Writer log;
+  std::size_t size = 0;
+  std::size_t skipped = 0;
+  Clock::time_point last_call;
+
+  Implementation(std::shared_ptr<Database> database_)
+  : database(std::move(database_)),
+    last_call(Clock::now())
+  {
+    write_header();
+  }
+
+  void write_header()
+  {
+    for (const auto b : RecorderMagic)
+      log.byte(b);
+
+    log.byte(FormatVersion);
+  }
+
+  /// Append one call to the log. The mutex must be locked by the caller.
+  template<typename Encode>
+  void append(const Operation op, const Encode& encode)
+  {
+    codec::Writer arguments;
+    try
+    {
+      encode(arguments);
+    }
+    catch (const std::runtime_error&)
+    {
+      // The call uses a shape that the log cannot hold
+      ++skipped;
+      return;
+    }
+
+    const auto now = Clock::now();
+    log.byte(static_cast<uint8_t>(op));
+    log.zigzag(to_nanoseconds(now - last_call));
+    log.data.insert(
+      log.data.end(), arguments.data.begin(), arguments.data.end());
+
+    last_call = now;
+    ++size;
+  }
+
+  /// Record a call and then make it, while holding the mutex so that the log
+  /// has the same order as the database.
+  template<typename Encode, typename Call>
+  auto record(const Operation op, const Encode& encode, const Call& call)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    append(op, encode);
+    return call();
+  }
+};
+
+//==============================================================================
+Recorder::Recorder(std::shared_ptr<Database> database)
+{
+  if (!database)
+  {
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "[rmf_traffic::schedule::Recorder] nullptr was given for the database");
+    // *INDENT-ON*
+  }
+
+  _pimpl = rmf_utils::make_unique_impl<Implementation>(std::move(database));
+}
+
+//==============================================================================
+void Recorder::set(
+  const ParticipantId participant,
+  const PlanId plan,
+  const Itinerary& itinerary,
+  const StorageId storage_base,
+  const ItineraryVersion version)
+{
+  _pimpl->record(
+    Operation::Set,
+    [&](codec::Writer& writer)
+    {
+      writer.varint(participant);
+      writer.varint(plan);
+      write_itinerary(writer, itinerary);
+      writer.varint(storage_base);
+      writer.varint(version);
+    },
+    [&]()
+    {
+      _pimpl->database->set(
+        participant, plan, itinerary, storage_base, version);
+    });
+}
+
+//==============================================================================
+void Recorder::extend(
+  const ParticipantId participant,
+  const Itinerary& routes,
+  const ItineraryVersion version)
+{
+  _pimpl->record(
+    Operation::Extend,
+    [&](codec::Writer& writer)
+    {
+      writer.varint(participant);
+      write_itinerary(writer, routes);
+      writer.varint(version);
+    },
+    [&]()
+    {
+      _pimpl->database->extend(participant, routes, version);
+    });
+}
+
+//==============================================================================
+void Recorder::delay(
+  const ParticipantId participant,
+  const Duration delay,
+  const ItineraryVersion version)
+{
+  _pimpl->record(
+    Operation::Delay,
+    [&](codec::Writer& writer)
+    {
+      writer.varint(participant);
+      writer.zigzag(to_nanoseconds(delay));
+      writer.varint(version);
+    },
+    [&]()
+    {
+      _pimpl->database->delay(participant, delay, version);
+    });
+}
+
+//==============================================================================
+void Recorder::reached(
+  const ParticipantId participant,
+  const PlanId plan,
+  const std::vector<CheckpointId>& reached_checkpoints,
+  const ProgressVersion version)
+{
+  _pimpl->record(
+    Operation::Reached,
+    [&](codec::Writer& writer)
+    {
+      writer.varint(participant);
+      writer.varint(plan);
+      writer.varint(reached_checkpoints.size());
+      for (const auto checkpoint : reached_checkpoints)
+        writer.varint(checkpoint);
+      writer.varint(version);
+    },
+    [&]()
+    {
+      _pimpl->database->reached(
+        participant, plan, reached_checkpoints, version);
+    });
+}
+
+//==============================================================================
+void Recorder::clear(
+  const ParticipantId participant,
+  const ItineraryVersion version)
+{
+  _pimpl->record(
+    Operation::Clear,
+    [&](codec::Writer& writer)
+    {
+      writer.varint(participant);
+      writer.varint(version);
+    },
+    [&]()
+    {
+      _pimpl->database->clear(participant, version);
+    });
+}
+
+//==============================================================================
+auto Recorder::register_participant(
+  ParticipantDescription participant_info) -> Registration
+{
+  // The registration is recorded after it has been made, because the replay
+  // needs to know which ID the participant was given.
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  auto registration =
+    _pimpl->database->register_participant(participant_info);
+
+  _pimpl->append(
+    Operation::RegisterParticipant,
+    [&](codec::Writer& writer)
+    {
+      writer.varint(registration.id());
+      write_description(writer, participant_info);
+    });
+
+  return registration;
+}
+
+//==============================================================================
+void Recorder::unregister_participant(const ParticipantId participant)
+{
+  _pimpl->record(
+    Operation::UnregisterParticipant,
+    [&](codec::Writer& writer)
+    {
+      writer.varint(participant);
+    },
+    [&]()
+    {
+      _pimpl->database->unregister_participant(participant);
+    });
+}
+
+//==============================================================================
+void Recorder::update_description(
+  const ParticipantId participant,
+  ParticipantDescription desc)
+{
+  _pimpl->record(
+    Operation::UpdateDescription,
+    [&](codec::Writer& writer)
+    {
+      writer.varint(participant);
+      write_description(writer, desc);
+    },
+    [&]()
+    {
+      _pimpl->database->update_description(participant, std::move(desc));
+    });
+}
+
+//==============================================================================
+Patch Recorder::changes(
+  const Query& parameters,
+  const std::optional<Version> after)
+{
+  return _pimpl->record(
+    Operation::Changes,
+    [&](codec::Writer& writer)
+    {
+      write_query(writer, parameters);
+      writer.byte(after.has_value() ? 1 : 0);
+      if (after.has_value())
+        writer.varint(*after);
+    },
+    [&]()
+    {
+      return _pimpl->database->changes(parameters, after);
+    });
+}
+
+//==============================================================================
+Viewer::View Recorder::query(const Query& parameters)
+{
+  return _pimpl->record(
+    Operation::Query,
+    [&](codec::Writer& writer)
+    {
+      write_query(writer, parameters);
+    },
+    [&]()
+    {
+      return _pimpl->database->query(parameters);
+    });
+}
+
+//==============================================================================
+Version Recorder::cull(const Time time)
+{
+  return _pimpl->record(
+    Operation::Cull,
+    [&](codec::Writer& writer)
+    {
+      write_time(writer, time);
+    },
+    [&]()
+    {
+      return _pimpl->database->cull(time);
+    });
+}
+
+//==============================================================================
+void Recorder::set_current_time(const Time time)
+{
+  _pimpl->record(
+    Operation::SetCurrentTime,
+    [&](codec::Writer& writer)
+    {
+      write_time(writer, time);
+    },
+    [&]()
+    {
+      _pimpl->database->set_current_time(time);
+    });
+}
+
+//==============================================================================
+const std::shared_ptr<Database>& Recorder::database() const
+{
+  return _pimpl->database;
+}
+
+//==============================================================================
+std::size_t Recorder::size() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->size;
+}
+
+//==============================================================================
+std::size_t Recorder::skipped() const
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  return _pimpl->skipped;
+}
+
+//==============================================================================
+std::vector<uint8_t> Recorder::take_log()
+{
+  std::lock_guard<std::mutex> lock(_pimpl->mutex);
+  std::vector<uint8_t> output;
+  output.swap(_pimpl->log.data);
+  return output;
+}
+
+//==============================================================================
+class Replay::Implementation
+{
+public:
+
+  /// One recorded call. Only the fields that the operation uses are set.
+  struct Call
+  {
+    Operation op;
+
+    /// The time between the start of the recording and this call
+    Duration offset;
+
+    ParticipantId participant = 0;
+    PlanId plan = 0;
+    StorageId storage_base = 0;
+    uint64_t version = 0;
+    Duration delay = Duration(0);
+    Itinerary itinerary;
+    std::vector<CheckpointId> checkpoints;
+    std::optional<ParticipantDescription> description;
+    std::optional<Query> query;
+    std::optional<Version> after;
+    Time time;
+  };
+
+  std::vector<Call> calls;
+
+  Implementation(const std::vector<uint8_t>& log)
+  {
+    codec::Reader reader(
+      log.data(), log.data() + log.size(), "[rmf_traffic::schedule::Replay]");
+
+    for (const auto b : RecorderMagic)
+    {
+      if (reader.byte() != b)
+        reader.fail("the log does not start with the recorder marker");
+    }
+
+    const uint8_t format = reader.byte();
+    if (format != Recorder::FormatVersion)
+    {
+      reader.fail(
+        "unsupported format version [" + std::to_string(format) + "]");
+    }
+
+    Duration offset = Duration(0);
+    while (!reader.done())
+    {
+      const uint8_t op = reader.byte();
+      if (op >= Recorder::NumOperations)
+        reader.fail("unknown operation [" + std::to_string(op) + "]");
+
+      offset += from_nanoseconds(reader.zigzag());
+
+      Call call;
+      call.op = static_cast<Operation>(op);
+      call.offset = offset;
+      switch (call.op)
+      {
+        case Operation::Set:
+          call.participant = reader.varint();
+          call.plan = reader.varint();
+          call.itinerary = read_itinerary(reader);
+          call.storage_base = reader.varint();
+          call.version = reader.varint();
+          break;
+        case Operation::Extend:
+          call.participant = reader.varint();
+          call.itinerary = read_itinerary(reader);
+          call.version = reader.varint();
+          break;
+        case Operation::Delay:
+          call.participant = reader.varint();
+          call.delay = from_nanoseconds(reader.zigzag());
+          call.version = reader.varint();
+          break;
+        case Operation::Reached:
+          call.participant = reader.varint();
+          call.plan = reader.varint();
+          call.checkpoints.resize(reader.count());
+          for (auto& checkpoint : call.checkpoints)
+            checkpoint = reader.varint();
+          call.version = reader.varint();
+          break;
+        case Operation::Clear:
+          call.participant = reader.varint();
+          call.version = reader.varint();
+          break;
+        case Operation::RegisterParticipant:
+        case Operation::UpdateDescription:
+          call.participant = reader.varint();
+          call.description = read_description(reader);
+          break;
+        case Operation::UnregisterParticipant:
+          call.participant = reader.varint();
+          break;
+        case Operation::Changes:
+          call.query = read_query(reader);
+          if (reader.byte())
+            call.after = reader.varint();
+          break;
+        case Operation::Query:
+          call.query = read_query(reader);
+          break;
+        case Operation::Cull:
+        case Operation::SetCurrentTime:
+          call.time = read_time(reader);
+          break;
+      }
+
+      calls.emplace_back(std::move(call));
+    }
+  }
+};
+
+//==============================================================================
+auto Replay::Statistics::operator[](const Operation op) const -> const Timing&
+{
+  return operations.at(static_cast<std::size_t>(op));
+}
+
+//==============================================================================
+Replay::Replay(const std::vector<uint8_t>& log)
+: _pimpl(rmf_utils::make_impl<Implementation>(log))
+{
+  // Do nothing
+}
+
+//==============================================================================
+std::size_t Replay::size() const
+{
+  return _pimpl->calls.size();
+}
+
+//==============================================================================
+Duration Replay::duration() const
+{
+  if (_pimpl->calls.empty())
+    return Duration(0);
+
+  return _pimpl->calls.back().offset;
+}
+
+//==============================================================================
+auto Replay::run(
+  Database& database,
+  Mirror* const mirror,
+  const bool paced) const -> Statistics
+{
+  Statistics stats;
+
+  // The IDs that the recorded database gave out, mapped to the IDs that this
+  // database gave out for the same registrations
+  std::unordered_map<ParticipantId, ParticipantId> ids;
+  const auto translate = [&ids](const ParticipantId id)
+    {
+      const auto it = ids.find(id);
+      return it == ids.end() ? id : it->second;
+    };
+
+  const auto update_mirror_participants = [&]()
+    {
+      ParticipantDescriptionsMap descriptions;
+      for (const auto id : database.participant_ids())
+        descriptions.insert({id, *database.get_participant(id)});
+
+      mirror->update_participants_info(descriptions);
+    };
+
+  const auto add = [](Timing& timing, const Duration elapsed, bool failed)
+    {
+      ++timing.count;
+      if (failed)
+        ++timing.failed;
+
+      timing.total += elapsed;
+      timing.max = std::max(timing.max, elapsed);
+    };
+
+  if (mirror)
+    update_mirror_participants();
+
+  const auto start = Clock::now();
+  for (const auto& call : _pimpl->calls)
+  {
+    if (paced)
+      std::this_thread::sleep_until(start + call.offset);
+
+    const ParticipantId participant = translate(call.participant);
+    std::optional<Patch> patch;
+    bool failed = false;
+    const auto call_start = Clock::now();
+    try
+    {
+      switch (call.op)
+      {
+        case Operation::Set:
+          database.set(
+            participant, call.plan, call.itinerary, call.storage_base,
+            call.version);
+          break;
+        case Operation::Extend:
+          database.extend(participant, call.itinerary, call.version);
+          break;
+        case Operation::Delay:
+          database.delay(participant, call.delay, call.version);
+          break;
+        case Operation::Reached:
+          database.reached(
+            participant, call.plan, call.checkpoints, call.version);
+          break;
+        case Operation::Clear:
+          database.clear(participant, call.version);
+          break;
+        case Operation::RegisterParticipant:
+          ids[call.participant] =
+            database.register_participant(*call.description).id();
+          break;
+        case Operation::UnregisterParticipant:
+          database.unregister_participant(participant);
+          break;
+        case Operation::UpdateDescription:
+          database.update_description(participant, *call.description);
+          break;
+        case Operation::Changes:
+          patch = database.changes(*call.query, call.after);
+          break;
+        case Operation::Query:
+          database.query(*call.query);
+          break;
+        case Operation::Cull:
+          database.cull(call.time);
+          break;
+        case Operation::SetCurrentTime:
+          database.set_current_time(call.time);
+          break;
+      }
+    }
+    catch (const std::exception&)
+    {
+      failed = true;
+    }
+
+    add(
+      stats.operations[static_cast<std::size_t>(call.op)],
+      Clock::now() - call_start, failed);
+
+    if (!mirror)
+      continue;
+
+    if (patch.has_value())
+    {
+      const auto update_start = Clock::now();
+      const bool accepted = mirror->update(*patch);
+      add(stats.mirror_update, Clock::now() - update_start, !accepted);
+    }
+    else if (call.op == Operation::RegisterParticipant
+      || call.op == Operation::UnregisterParticipant
+      || call.op == Operation::UpdateDescription)
+    {
+      update_mirror_participants();
+    }
+  }
+
+  stats.total = Clock::now() - start;
+  return stats;
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
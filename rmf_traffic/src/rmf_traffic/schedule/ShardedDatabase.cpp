@@ -0,0 +1,930 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/ShardedDatabase.hpp>
+
+#include "InconsistenciesInternal.hpp"
+#include "InconsistencyTracker.hpp"
+#include "ViewerInternal.hpp"
+#include "internal_Database.hpp"
+#include "internal_ParticipantDescription.hpp"
+
+#include <rmf_utils/Modular.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+class ShardedDatabase::Implementation
+{
+public:
+
+  struct Shard
+  {
+    Database database;
+    mutable std::shared_mutex mutex;
+
+    Shard(const TimelineOptions& options)
+    : database(options, Concurrency::None)
+    {
+      // Do nothing
+    }
+  };
+
+  /// Progress that was reported for a plan that has not arrived yet
+  struct BufferedProgress
+  {
+    PlanId plan;
+    std::vector<CheckpointId> reached_checkpoints;
+    ProgressVersion version;
+  };
+
+  struct ParticipantState
+  {
+    /// Held while a change for this participant is being applied
+    std::mutex mutex;
+
+    std::shared_ptr<const ParticipantDescription> description;
+    std::unique_ptr<InconsistencyTracker> tracker;
+
+    /// The shards that hold the current itinerary of the participant, sorted
+    /// by index. The first one is used whenever a new shard needs a copy of
+    /// the itinerary. The participant keeps a member shard after its first
+    /// change even if its itinerary is empty, so that its storage IDs are
+    /// never lost.
+    std::vector<std::size_t> members;
+
+    /// The last itinerary version given to each shard, or nullopt for shards
+    /// that the participant has not been registered in yet. Each shard has its
+    /// own sequence because a shard only receives some of the changes.
+    std::vector<std::optional<ItineraryVersion>> shard_versions;
+
+    /// The delays since the current plan was set, keyed by schedule version,
+    /// so that patches can report each delay once no matter how many shards
+    /// it touched.
+    std::map<Version, Duration> delays;
+
+    std::vector<BufferedProgress> buffered_progress;
+
+    // These can be read by changes(~) while another thread is writing
+    std::atomic<PlanId> plan = std::numeric_limits<PlanId>::max();
+    std::atomic<ItineraryVersion> last_known_version =
+      std::numeric_limits<ItineraryVersion>::max();
+  };
+
+  using ParticipantStatePtr = std::unique_ptr<ParticipantState>;
+
+  using ShardLocks = std::vector<std::unique_lock<std::shared_mutex>>;
+  using SharedShardLocks = std::vector<std::shared_lock<std::shared_mutex>>;
+
+  std::unordered_map<std::string, std::size_t> map_to_shard;
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  /// Guards the set of participants. Writers of a participant hold it shared,
+  /// while registering and unregistering hold it exclusively. This must always
+  /// be locked before the mutex of a participant, which must always be locked
+  /// before the mutexes of shards, which get locked in order of index.
+  mutable std::shared_mutex registry_mutex;
+  std::unordered_map<ParticipantId, ParticipantStatePtr> states;
+  std::unordered_set<ParticipantId> participant_ids;
+  ParticipantId next_participant_id = 0;
+
+  Inconsistencies inconsistencies;
+
+  /// Every change to any shard takes its version from this sequence while it
+  /// holds the locks of the shards that it changes.
+  std::atomic<Version> version = 0;
+
+  std::size_t default_shard() const
+  {
+    return shards.size() - 1;
+  }
+
+  std::size_t shard_of(const std::string& map) const
+  {
+    const auto it = map_to_shard.find(map);
+    if (it == map_to_shard.end())
+      return default_shard();
+
+    return it->second;
+  }
+
+  std::vector<std::size_t> shards_of(const Itinerary& itinerary) const
+  {
+    std::vector<std::size_t> output;
+    for (const auto& route : itinerary)
+      output.push_back(shard_of(route.map()));
+
+    std::sort(output.begin(), output.end());
+    output.erase(std::unique(output.begin(), output.end()), output.end());
+    return output;
+  }
+
+  static std::vector<std::size_t> combine(
+    const std::vector<std::size_t>& a,
+    const std::vector<std::size_t>& b)
+  {
+    std::vector<std::size_t> output;
+    std::set_union(
+      a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(output));
+    return output;
+  }
+
+  static bool contains(const std::vector<std::size_t>& set, std::size_t s)
+  {
+    return std::binary_search(set.begin(), set.end(), s);
+  }
+
+  ShardLocks lock(const std::vector<std::size_t>& indices) const
+  {
+    ShardLocks locks;
+    locks.reserve(indices.size());
+    for (const auto s : indices)
+      locks.emplace_back(shards[s]->mutex);
+
+    return locks;
+  }
+
+  SharedShardLocks lock_all_shared() const
+  {
+    SharedShardLocks locks;
+    locks.reserve(shards.size());
+    for (const auto& shard : shards)
+      locks.emplace_back(shard->mutex);
+
+    return locks;
+  }
+
+  ParticipantState& get_state(
+    const ParticipantId participant,
+    const char* function) const
+  {
+    const auto it = states.find(participant);
+    if (it == states.end())
+    {
+      // *INDENT-OFF*
+      throw std::runtime_error(
+        std::string("[rmf_traffic::schedule::ShardedDatabase::") + function
+        + "] No participant with ID [" + std::to_string(participant) + "]");
+      // *INDENT-ON*
+    }
+
+    return *it->second;
+  }
+
+  /// Get the database of a shard, ready to receive a change of the given
+  /// version for the participant. The participant is registered in the shard
+  /// the first time this is called for it.
+  Database& prepare(
+    const std::size_t s,
+    const ParticipantId participant,
+    ParticipantState& state,
+    const Version next)
+  {
+    Database& database = shards[s]->database;
+    set_next_version(database, next);
+    if (!state.shard_versions[s].has_value())
+    {
+      constexpr auto initial = std::numeric_limits<ItineraryVersion>::max();
+      internal_register_participant(
+        database, participant, initial, *state.description);
+      state.shard_versions[s] = initial;
+      set_next_version(database, next);
+    }
+
+    return database;
+  }
+
+  static ItineraryVersion next_itinerary_version(
+    ParticipantState& state,
+    const std::size_t s)
+  {
+    return ++*state.shard_versions[s];
+  }
+
+  InconsistencyTracker::Apply deferred_applier(
+    const ParticipantId participant,
+    ParticipantState& state)
+  {
+    return [this, participant, &state](
+      const InconsistencyTracker::DeferredChange& change,
+      const ItineraryVersion version)
+      {
+        using Type = InconsistencyTracker::DeferredChange::Type;
+        switch (change.type)
+        {
+          case Type::Set:
+            this->set(
+              participant, state, change.plan, change.itinerary,
+              change.storage_base, version);
+            return;
+          case Type::Extend:
+            this->extend(participant, state, change.itinerary, version);
+            return;
+          case Type::Delay:
+            this->delay(participant, state, change.delay, version);
+            return;
+          case Type::Clear:
+            this->clear(participant, state, version);
+            return;
+        }
+      };
+  }
+
+  static bool is_old(
+    const ParticipantState& state,
+    const ItineraryVersion version)
+  {
+    // This is an old change, possibly a retransmission requested by a different
+    // database tracker, so we will ignore it.
+    return rmf_utils::modular(version).less_than(
+      state.tracker->expected_version());
+  }
+
+  void set(
+    const ParticipantId participant,
+    ParticipantState& state,
+    const PlanId plan,
+    const Itinerary& itinerary,
+    const StorageId storage_base,
+    const ItineraryVersion version)
+  {
+    if (is_old(state, version))
+      return;
+
+    if (auto ticket = state.tracker->check(version, true))
+    {
+      ticket->set(
+        InconsistencyTracker::DeferredChange::make_set(
+          plan, itinerary, storage_base),
+        deferred_applier(participant, state));
+      return;
+    }
+
+    auto new_members = shards_of(itinerary);
+    if (new_members.empty())
+    {
+      new_members.push_back(
+        state.members.empty() ? default_shard() : state.members.front());
+    }
+
+    const auto targets = combine(state.members, new_members);
+    const auto locks = lock(targets);
+    const Version next = ++this->version;
+    for (const auto s : targets)
+    {
+      Database& database = prepare(s, participant, state, next);
+      if (!contains(new_members, s))
+      {
+        // The participant is leaving the maps of this shard
+        database.clear(participant, next_itinerary_version(state, s));
+        continue;
+      }
+
+      database.set(
+        participant, plan, itinerary, storage_base,
+        next_itinerary_version(state, s));
+
+      for (const auto& progress : state.buffered_progress)
+      {
+        if (progress.plan != plan)
+          continue;
+
+        set_next_version(database, next);
+        database.reached(
+          participant, plan, progress.reached_checkpoints, progress.version);
+      }
+    }
+
+    const auto end = std::remove_if(
+      state.buffered_progress.begin(), state.buffered_progress.end(),
+      [plan](const BufferedProgress& progress)
+      {
+        return rmf_utils::modular(progress.plan).less_than_or_equal(plan);
+      });
+    state.buffered_progress.erase(end, state.buffered_progress.end());
+
+    state.members = std::move(new_members);
+    state.delays.clear();
+    state.plan = plan;
+    state.last_known_version = version;
+  }
+
+  void extend(
+    const ParticipantId participant,
+    ParticipantState& state,
+    const Itinerary& itinerary,
+    const ItineraryVersion version)
+  {
+    if (is_old(state, version))
+      return;
+
+    if (auto ticket = state.tracker->check(version))
+    {
+      ticket->set(
+        InconsistencyTracker::DeferredChange::make_extend(itinerary),
+        deferred_applier(participant, state));
+      return;
+    }
+
+    std::vector<std::size_t> joining;
+    for (const auto s : shards_of(itinerary))
+    {
+      if (!contains(state.members, s))
+        joining.push_back(s);
+    }
+
+    if (state.members.empty() && joining.empty())
+      joining.push_back(default_shard());
+
+    const auto targets = combine(state.members, joining);
+    const auto locks = lock(targets);
+    const Version next = ++this->version;
+    for (const auto s : joining)
+    {
+      Database& database = prepare(s, participant, state, next);
+      if (state.members.empty())
+        continue;
+
+      // Bring the shard up to date with the current itinerary before it gets
+      // extended, so it gives the new routes the same IDs as the other shards.
+      copy_participant_state(
+        shards[state.members.front()]->database, database, participant,
+        next_itinerary_version(state, s));
+    }
+
+    for (const auto s : targets)
+    {
+      prepare(s, participant, state, next).extend(
+        participant, itinerary, next_itinerary_version(state, s));
+    }
+
+    state.members = targets;
+    state.last_known_version = version;
+  }
+
+  void delay(
+    const ParticipantId participant,
+    ParticipantState& state,
+    const Duration duration,
+    const ItineraryVersion version)
+  {
+    if (is_old(state, version))
+      return;
+
+    if (auto ticket = state.tracker->check(version))
+    {
+      ticket->set(
+        InconsistencyTracker::DeferredChange::make_delay(duration),
+        deferred_applier(participant, state));
+      return;
+    }
+
+    const auto locks = lock(state.members);
+    if (!state.members.empty())
+    {
+      const Version next = ++this->version;
+      for (const auto s : state.members)
+      {
+        prepare(s, participant, state, next).delay(
+          participant, duration, next_itinerary_version(state, s));
+      }
+
+      state.delays[next] = duration;
+    }
+
+    state.last_known_version = version;
+  }
+
+  void clear(
+    const ParticipantId participant,
+    ParticipantState& state,
+    const ItineraryVersion version)
+  {
+    if (is_old(state, version))
+      return;
+
+    if (auto ticket = state.tracker->check(version))
+    {
+      ticket->set(
+        InconsistencyTracker::DeferredChange::make_clear(),
+        deferred_applier(participant, state));
+      return;
+    }
+
+    const auto locks = lock(state.members);
+    if (!state.members.empty())
+    {
+      const Version next = ++this->version;
+      for (const auto s : state.members)
+      {
+        prepare(s, participant, state, next).clear(
+          participant, next_itinerary_version(state, s));
+      }
+    }
+
+    state.delays.clear();
+    state.last_known_version = version;
+  }
+
+  /// Get the shards that the participant has been registered in
+  static std::vector<std::size_t> registered_shards(
+    const ParticipantState& state)
+  {
+    std::vector<std::size_t> output;
+    for (std::size_t s = 0; s < state.shard_versions.size(); ++s)
+    {
+      if (state.shard_versions[s].has_value())
+        output.push_back(s);
+    }
+
+    return output;
+  }
+
+  ParticipantId get_next_participant_id()
+  {
+    const ParticipantId initial_suggestion = next_participant_id;
+    do
+    {
+      const auto insertion = participant_ids.insert(next_participant_id);
+      ++next_participant_id;
+      if (insertion.second)
+        return *insertion.first;
+
+    } while (next_participant_id != initial_suggestion);
+
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "[ShardedDatabase::Implementation::get_next_participant_id] There are no "
+      "remaining Participant ID values available. This should never happen."
+      " Please report this as a serious bug.");
+    // *INDENT-ON*
+  }
+};
+
+//==============================================================================
+void ShardedDatabase::set(
+  const ParticipantId participant,
+  const PlanId plan,
+  const Itinerary& itinerary,
+  const StorageId storage_base,
+  const ItineraryVersion version)
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  auto& state = _pimpl->get_state(participant, "set");
+  std::lock_guard<std::mutex> lock(state.mutex);
+  _pimpl->set(participant, state, plan, itinerary, storage_base, version);
+}
+
+//==============================================================================
+void ShardedDatabase::extend(
+  const ParticipantId participant,
+  const Itinerary& routes,
+  const ItineraryVersion version)
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  auto& state = _pimpl->get_state(participant, "extend");
+  std::lock_guard<std::mutex> lock(state.mutex);
+  _pimpl->extend(participant, state, routes, version);
+}
+
+//==============================================================================
+void ShardedDatabase::delay(
+  const ParticipantId participant,
+  const Duration delay,
+  const ItineraryVersion version)
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  auto& state = _pimpl->get_state(participant, "delay");
+  std::lock_guard<std::mutex> lock(state.mutex);
+  _pimpl->delay(participant, state, delay, version);
+}
+
+//==============================================================================
+void ShardedDatabase::reached(
+  const ParticipantId participant,
+  const PlanId plan,
+  const std::vector<CheckpointId>& reached_checkpoints,
+  const ProgressVersion version)
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  auto& state = _pimpl->get_state(participant, "reached");
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  const PlanId current_plan = state.plan.load();
+  if (plan != current_plan)
+  {
+    if (rmf_utils::modular(plan).less_than(current_plan))
+      return;
+
+    // The shards that will hold this plan are not known until it arrives
+    state.buffered_progress.push_back({plan, reached_checkpoints, version});
+    return;
+  }
+
+  const auto locks = _pimpl->lock(state.members);
+  if (state.members.empty())
+    return;
+
+  const Version next = ++_pimpl->version;
+  for (const auto s : state.members)
+  {
+    _pimpl->prepare(s, participant, state, next).reached(
+      participant, plan, reached_checkpoints, version);
+  }
+}
+
+//==============================================================================
+void ShardedDatabase::reached(
+  const ParticipantId participant,
+  const PlanId plan,
+  const RouteId route,
+  const CheckpointId checkpoint,
+  const ProgressVersion version)
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  auto& state = _pimpl->get_state(participant, "reached");
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  const PlanId current_plan = state.plan.load();
+  if (plan != current_plan)
+  {
+    if (rmf_utils::modular(plan).less_than(current_plan))
+      return;
+
+    // The other routes are left at zero, which never undoes any progress when
+    // the buffered progress gets applied.
+    std::vector<CheckpointId> reached_checkpoints(route + 1, 0);
+    reached_checkpoints[route] = checkpoint;
+    state.buffered_progress.push_back(
+      {plan, std::move(reached_checkpoints), version});
+    return;
+  }
+
+  const auto locks = _pimpl->lock(state.members);
+  if (state.members.empty())
+    return;
+
+  const Version next = ++_pimpl->version;
+  for (const auto s : state.members)
+  {
+    _pimpl->prepare(s, participant, state, next).reached(
+      participant, plan, route, checkpoint, version);
+  }
+}
+
+//==============================================================================
+void ShardedDatabase::clear(
+  const ParticipantId participant,
+  const ItineraryVersion version)
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  auto& state = _pimpl->get_state(participant, "clear");
+  std::lock_guard<std::mutex> lock(state.mutex);
+  _pimpl->clear(participant, state, version);
+}
+
+//==============================================================================
+Writer::Registration ShardedDatabase::register_participant(
+  ParticipantDescription participant_info)
+{
+  std::unique_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  const ParticipantId id = _pimpl->get_next_participant_id();
+
+  auto state = std::make_unique<Implementation::ParticipantState>();
+  state->description = intern_description(std::move(participant_info));
+  state->tracker = Inconsistencies::Implementation::register_participant(
+    _pimpl->inconsistencies, id, std::numeric_limits<ItineraryVersion>::max());
+  state->shard_versions.resize(_pimpl->shards.size());
+
+  const auto& inserted = *_pimpl->states.insert({id, std::move(state)})
+    .first->second;
+
+  return Registration(
+    id, inserted.tracker->last_known_version(), inserted.plan, 0);
+}
+
+//==============================================================================
+void ShardedDatabase::update_description(
+  const ParticipantId participant,
+  ParticipantDescription desc)
+{
+  std::unique_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  auto& state = _pimpl->get_state(participant, "update_description");
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  if (*state.description == desc)
+    return;
+
+  state.description = intern_description(std::move(desc));
+
+  const auto registered = Implementation::registered_shards(state);
+  const auto locks = _pimpl->lock(registered);
+  if (registered.empty())
+    return;
+
+  const Version next = ++_pimpl->version;
+  for (const auto s : registered)
+  {
+    _pimpl->prepare(s, participant, state, next).update_description(
+      participant, *state.description);
+  }
+}
+
+//==============================================================================
+void ShardedDatabase::unregister_participant(const ParticipantId participant)
+{
+  std::unique_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  const auto it = _pimpl->states.find(participant);
+  if (it == _pimpl->states.end())
+  {
+    // *INDENT-OFF*
+    throw std::runtime_error(
+      "[ShardedDatabase::unregister_participant] Requested unregistering an "
+      "inactive participant ID [" + std::to_string(participant) + "]");
+    // *INDENT-ON*
+  }
+
+  auto& state = *it->second;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    const auto registered = Implementation::registered_shards(state);
+    const auto locks = _pimpl->lock(registered);
+    const Version next = ++_pimpl->version;
+    for (const auto s : registered)
+    {
+      Database& database = _pimpl->shards[s]->database;
+      set_next_version(database, next);
+      database.unregister_participant(participant);
+    }
+  }
+
+  _pimpl->inconsistencies._pimpl->unregister_participant(participant);
+  _pimpl->participant_ids.erase(participant);
+  _pimpl->states.erase(it);
+}
+
+//==============================================================================
+Viewer::View ShardedDatabase::query(const Query& parameters) const
+{
+  return query(parameters.spacetime(), parameters.participants());
+}
+
+//==============================================================================
+Viewer::View ShardedDatabase::query(
+  const Query::Spacetime& spacetime,
+  const Query::Participants& participants) const
+{
+  const auto locks = _pimpl->lock_all_shared();
+  auto view = _pimpl->shards.front()->database.query(spacetime, participants);
+  for (std::size_t s = 1; s < _pimpl->shards.size(); ++s)
+  {
+    View::Implementation::append_to_view(
+      view, _pimpl->shards[s]->database.query(spacetime, participants));
+  }
+
+  return view;
+}
+
+//==============================================================================
+const std::unordered_set<ParticipantId>& ShardedDatabase::participant_ids()
+const
+{
+  return _pimpl->participant_ids;
+}
+
+//==============================================================================
+std::shared_ptr<const ParticipantDescription>
+ShardedDatabase::get_participant(std::size_t participant_id) const
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  const auto it = _pimpl->states.find(participant_id);
+  if (it == _pimpl->states.end())
+    return nullptr;
+
+  return it->second->description;
+}
+
+//==============================================================================
+ShardedDatabase::ShardedDatabase(
+  std::vector<std::unordered_set<std::string>> map_groups,
+  const TimelineOptions& timeline_options)
+: _pimpl(rmf_utils::make_unique_impl<Implementation>())
+{
+  for (std::size_t i = 0; i < map_groups.size(); ++i)
+  {
+    for (const auto& map : map_groups[i])
+      _pimpl->map_to_shard.insert({map, i});
+  }
+
+  // The last shard holds every map that is not in a group
+  for (std::size_t i = 0; i <= map_groups.size(); ++i)
+  {
+    auto shard = std::make_unique<Implementation::Shard>(timeline_options);
+    set_indexed_maps(
+      shard->database,
+      [pimpl = _pimpl.get(), i](const std::string& map)
+      {
+        return pimpl->shard_of(map) == i;
+      });
+
+    _pimpl->shards.push_back(std::move(shard));
+  }
+}
+
+//==============================================================================
+std::size_t ShardedDatabase::shard_count() const
+{
+  return _pimpl->shards.size();
+}
+
+//==============================================================================
+std::size_t ShardedDatabase::shard_of(const std::string& map) const
+{
+  return _pimpl->shard_of(map);
+}
+
+//==============================================================================
+std::optional<ItineraryView> ShardedDatabase::get_itinerary(
+  std::size_t participant_id) const
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  const auto it = _pimpl->states.find(participant_id);
+  if (it == _pimpl->states.end())
+    return std::nullopt;
+
+  auto& state = *it->second;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.members.empty())
+    return ItineraryView();
+
+  // Every member shard holds the whole itinerary
+  const auto& shard = *_pimpl->shards[state.members.front()];
+  std::shared_lock<std::shared_mutex> shard_lock(shard.mutex);
+  return shard.database.get_itinerary(participant_id);
+}
+
+//==============================================================================
+std::shared_ptr<const ItineraryView> ShardedDatabase::get_itinerary_view(
+  std::size_t participant_id) const
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  const auto it = _pimpl->states.find(participant_id);
+  if (it == _pimpl->states.end())
+    return nullptr;
+
+  auto& state = *it->second;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.members.empty())
+    return std::make_shared<const ItineraryView>();
+
+  // Every member shard holds the whole itinerary
+  const auto& shard = *_pimpl->shards[state.members.front()];
+  std::shared_lock<std::shared_mutex> shard_lock(shard.mutex);
+  return shard.database.get_itinerary_view(participant_id);
+}
+
+//==============================================================================
+std::optional<PlanId> ShardedDatabase::get_current_plan_id(
+  std::size_t participant_id) const
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  const auto it = _pimpl->states.find(participant_id);
+  if (it == _pimpl->states.end())
+    return std::nullopt;
+
+  return it->second->plan.load();
+}
+
+//==============================================================================
+const Inconsistencies& ShardedDatabase::inconsistencies() const
+{
+  return _pimpl->inconsistencies;
+}
+
+//==============================================================================
+Version ShardedDatabase::latest_version() const
+{
+  return _pimpl->version;
+}
+
+//==============================================================================
+std::optional<Version> ShardedDatabase::schedule_version() const
+{
+  return latest_version();
+}
+
+//==============================================================================
+Patch ShardedDatabase::changes(
+  const Query& parameters,
+  const std::optional<Version> after) const
+{
+  std::shared_lock<std::shared_mutex> registry(_pimpl->registry_mutex);
+  const auto locks = _pimpl->lock_all_shared();
+
+  // Every change that was given a version up to this one has finished, since
+  // no shard can be changed while we hold all of their locks.
+  const Version latest = _pimpl->version;
+
+  struct Merged
+  {
+    std::vector<StorageId> erasures;
+    std::vector<Change::Add::Item> additions;
+    std::optional<Change::Progress> progress;
+  };
+
+  std::map<ParticipantId, Merged> merged;
+  std::optional<Change::Cull> cull;
+  for (std::size_t s = 0; s < _pimpl->shards.size(); ++s)
+  {
+    const auto patch = _pimpl->shards[s]->database.changes(parameters, after);
+    if (!cull.has_value() && patch.cull())
+      cull = *patch.cull();
+
+    for (const auto& p : patch)
+    {
+      // Each route is only indexed by one shard, so these never overlap
+      auto& m = merged[p.participant_id()];
+      const auto& erasures = p.erasures().ids();
+      m.erasures.insert(m.erasures.end(), erasures.begin(), erasures.end());
+      const auto& additions = p.additions().items();
+      m.additions.insert(m.additions.end(), additions.begin(), additions.end());
+
+      const auto& state = *_pimpl->states.at(p.participant_id());
+      if (!m.progress.has_value() && p.progress().has_value()
+        && Implementation::contains(state.members, s))
+      {
+        m.progress = p.progress();
+      }
+    }
+  }
+
+  std::vector<Patch::Participant> part_patches;
+  for (auto& [participant, m] : merged)
+  {
+    const auto& state = *_pimpl->states.at(participant);
+
+    std::vector<Change::Delay> delays;
+    if (after.has_value())
+    {
+      for (auto it = state.delays.upper_bound(*after);
+        it != state.delays.end(); ++it)
+      {
+        delays.emplace_back(Change::Delay{it->second});
+      }
+    }
+
+    part_patches.emplace_back(
+      Patch::Participant{
+        participant,
+        state.last_known_version,
+        Change::Erase(std::move(m.erasures)),
+        std::move(delays),
+        Change::Add(state.plan, std::move(m.additions)),
+        std::move(m.progress)
+      });
+  }
+
+  return Patch(std::move(part_patches), cull, after, latest);
+}
+
+//==============================================================================
+Version ShardedDatabase::cull(const Time time)
+{
+  std::vector<std::unique_lock<std::shared_mutex>> locks;
+  for (const auto& shard : _pimpl->shards)
+    locks.emplace_back(shard->mutex);
+
+  const Version next = ++_pimpl->version;
+  for (const auto& shard : _pimpl->shards)
+  {
+    set_next_version(shard->database, next);
+    shard->database.cull(time);
+  }
+
+  return next;
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
@@ -157,7 +157,10 @@ void StubbornNegotiator::respond(
     .ignore_bystanders();
 
   std::vector<rmf_traffic::schedule::Itinerary> alternatives;
-  for (const auto& validator : generator.all())
+  // The most promising combinations of alternatives come first, and we stop
+  // at the first one that works, so the rest are never generated.
+  auto validators = generator.enumerate();
+  while (const auto validator = validators.next())
   {
     if (_pimpl->test_candidate(0s, original, *validator, alternatives)
       .has_value())
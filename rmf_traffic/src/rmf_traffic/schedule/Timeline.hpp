@@ -19,44 +19,75 @@
 #define SRC__RMF_TRAFFIC__SCHEDULE__TIMELINE_HPP
 
 #include "../DetectConflictInternal.hpp"
+#include "../internal_MemoryUsage.hpp"
+#include "../internal_Region.hpp"
+#include "../internal_Route.hpp"
+#include "internal_Query.hpp"
+#include "internal_WorkerPool.hpp"
 
 #include <rmf_traffic/schedule/Query.hpp>
+#include <rmf_traffic/schedule/TimelineOptions.hpp>
 
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 namespace rmf_traffic {
 namespace schedule {
 
 using StorageId = uint64_t;
 
-namespace {
+//==============================================================================
+/// The values of TimelineOptions, unpacked so that the timeline does not need
+/// to go through the pimpl of TimelineOptions while it inserts entries.
+struct TimelineSettings
+{
+  TimelineSettings(const TimelineOptions& options = TimelineOptions())
+  : bucket_duration(options.bucket_duration()),
+    partial_bucket_duration(bucket_duration - bucket_duration/6),
+    split_threshold(options.split_threshold()),
+    merge_threshold(options.merge_threshold()),
+    minimum_bucket_duration(options.minimum_bucket_duration()),
+    maximum_bucket_duration(options.maximum_bucket_duration()),
+    inspection_threads(options.inspection_threads()),
+    memory_resource(
+      options.memory_resource() ?
+      options.memory_resource() : std::pmr::get_default_resource())
+  {
+    // Do nothing
+  }
 
-// TODO(MXG): Consider allowing these values to be configured
+  bool adaptive() const
+  {
+    return split_threshold.has_value() || merge_threshold.has_value();
+  }
+
+  // Each Timeline Bucket spans a range of this duration.
+  Duration bucket_duration;
 
-// Each Timeline Bucket spans a range of 1 minute.
-const Duration BucketDuration = std::chrono::minutes(1);
+  // This value is used during the creation of the first bucket for a timeline.
+  // It's a very minor optimization that avoids making a bucket that will
+  // potentially not be very useful.
+  Duration partial_bucket_duration;
 
-// This constant is used during the creation of the first bucket for a timeline.
-// It's a very minor optimization that avoids making a bucket that will
-// potentially not be very useful.
-const Duration PartialBucketDuration = std::chrono::seconds(50);
+  std::optional<std::size_t> split_threshold;
+  std::optional<std::size_t> merge_threshold;
+  Duration minimum_bucket_duration;
+  Duration maximum_bucket_duration;
+  std::size_t inspection_threads;
 
-} // anonymous namespace
+  // The buckets of the timeline are allocated from this resource
+  std::pmr::memory_resource* memory_resource;
+};
 
 //==============================================================================
 struct ParticipantFilter
 {
-  static std::unordered_set<ParticipantId> convert(
-    const std::vector<ParticipantId>& ids)
-  {
-    std::unordered_set<ParticipantId> output;
-    for (const auto id : ids)
-      output.insert(id);
-
-    return output;
-  }
-
   //============================================================================
   struct AllowAll
   {
@@ -69,40 +100,192 @@ struct ParticipantFilter
   //============================================================================
   struct Include
   {
-    Include(const std::vector<ParticipantId>& ids)
-    : _ids(convert(ids))
+    Include(const Query::Participants::Include& include)
+    : _ids(get_id_set(include))
     {
       // Do nothing
     }
 
     bool ignore(ParticipantId id) const
     {
-      return _ids.find(id) == _ids.end();
+      return !_ids->contains(id);
     }
 
   private:
-    std::unordered_set<ParticipantId> _ids;
+    ConstParticipantIdSetPtr _ids;
   };
 
   //============================================================================
   struct Exclude
   {
-    Exclude(const std::vector<ParticipantId>& ids)
-    : _ids(convert(ids))
+    Exclude(const Query::Participants::Exclude& exclude)
+    : _ids(get_id_set(exclude))
     {
       // Do nothing
     }
 
     bool ignore(ParticipantId id) const
     {
-      return _ids.find(id) != _ids.end();
+      return _ids->contains(id);
     }
 
   private:
-    std::unordered_set<ParticipantId> _ids;
+    ConstParticipantIdSetPtr _ids;
   };
 };
 
+//==============================================================================
+/// The set of routes that have already been inspected during one query. A
+/// route can appear in many buckets, but it should only be inspected once.
+///
+/// The storage of these sets gets reused from one query to the next on each
+/// thread, so once a set has grown to fit the largest query, inspecting the
+/// timeline does not allocate anything. Clearing a set only bumps its stamp.
+class VisitedRoutes
+{
+public:
+
+  VisitedRoutes()
+  : _table(acquire())
+  {
+    _table->clear();
+  }
+
+  ~VisitedRoutes()
+  {
+    release(std::move(_table));
+  }
+
+  VisitedRoutes(const VisitedRoutes&) = delete;
+  VisitedRoutes& operator=(const VisitedRoutes&) = delete;
+
+  /// Returns true if this route had not been visited yet
+  bool insert(const ParticipantId participant, const StorageId storage_id)
+  {
+    return _table->insert(participant, storage_id);
+  }
+
+private:
+
+  class Table
+  {
+  public:
+
+    void clear()
+    {
+      _size = 0;
+      if (++_stamp == 0)
+      {
+        // The stamp wrapped around, so the old stamps need to be wiped out
+        for (auto& slot : _slots)
+          slot.stamp = 0;
+
+        _stamp = 1;
+      }
+    }
+
+    bool insert(const ParticipantId participant, const StorageId storage_id)
+    {
+      if (2*(_size + 1) > _slots.size())
+        grow();
+
+      Slot* const slot = find(_slots, participant, storage_id, _stamp);
+      if (slot->stamp == _stamp)
+        return false;
+
+      *slot = Slot{participant, storage_id, _stamp};
+      ++_size;
+      return true;
+    }
+
+  private:
+
+    struct Slot
+    {
+      ParticipantId participant = 0;
+      StorageId storage_id = 0;
+      uint32_t stamp = 0;
+    };
+
+    /// Find the slot that holds this route or the empty slot where it belongs
+    static Slot* find(
+      std::vector<Slot>& slots,
+      const ParticipantId participant,
+      const StorageId storage_id,
+      const uint32_t stamp)
+    {
+      const std::size_t mask = slots.size() - 1;
+      std::size_t i = hash(participant, storage_id) & mask;
+      while (true)
+      {
+        Slot& slot = slots[i];
+        if (slot.stamp != stamp)
+          return &slot;
+
+        if (slot.participant == participant && slot.storage_id == storage_id)
+          return &slot;
+
+        i = (i + 1) & mask;
+      }
+    }
+
+    static std::size_t hash(
+      const ParticipantId participant,
+      const StorageId storage_id)
+    {
+      uint64_t h = participant*0x9E3779B97F4A7C15ull ^ storage_id;
+      h ^= h >> 31;
+      h *= 0xBF58476D1CE4E5B9ull;
+      h ^= h >> 29;
+      return static_cast<std::size_t>(h);
+    }
+
+    void grow()
+    {
+      std::vector<Slot> slots(std::max<std::size_t>(64, 2*_slots.size()));
+      for (const auto& slot : _slots)
+      {
+        if (slot.stamp == _stamp)
+          *find(slots, slot.participant, slot.storage_id, _stamp) = slot;
+      }
+
+      _slots = std::move(slots);
+    }
+
+    std::vector<Slot> _slots;
+    std::size_t _size = 0;
+    uint32_t _stamp = 0;
+  };
+
+  using TablePtr = std::unique_ptr<Table>;
+
+  // Each thread keeps its own tables. A stack is used instead of a single
+  // table in case an inspector starts another query while it is inspecting.
+  static std::vector<TablePtr>& pool()
+  {
+    thread_local std::vector<TablePtr> tables;
+    return tables;
+  }
+
+  static TablePtr acquire()
+  {
+    auto& tables = pool();
+    if (tables.empty())
+      return std::make_unique<Table>();
+
+    TablePtr table = std::move(tables.back());
+    tables.pop_back();
+    return table;
+  }
+
+  static void release(TablePtr table)
+  {
+    pool().emplace_back(std::move(table));
+  }
+
+  TablePtr _table;
+};
+
 //==============================================================================
 template<typename Entry>
 class TimelineInspector;
@@ -111,6 +294,21 @@ class TimelineInspector;
 template<typename Entry>
 class Timeline;
 
+//==============================================================================
+/// An inspector is mergeable if split() gives an empty inspector of the same
+/// kind, and merge() appends the results of one of those inspectors to its own.
+/// The regions of a query can then be inspected by several threads that each
+/// have their own split, and merging the splits in order gives the same results
+/// as one inspector would have.
+template<typename Inspector, typename = void>
+struct is_mergeable_inspector : std::false_type {};
+
+template<typename Inspector>
+struct is_mergeable_inspector<Inspector, std::void_t<
+    decltype(std::declval<const Inspector&>().split()),
+    decltype(std::declval<Inspector&>().merge(std::declval<Inspector&&>()))>>
+  : std::true_type {};
+
 //==============================================================================
 template<typename Entry>
 class TimelineView
@@ -119,19 +317,20 @@ public:
 public:
 
   using ConstEntryPtr = std::shared_ptr<const Entry>;
-  using Bucket = std::vector<ConstEntryPtr>;
+  using Bucket = std::pmr::vector<ConstEntryPtr>;
 
   // We use a shared_ptr for BucketPtr so that the Handle class can hold a
   // weak_ptr to the bucket that contains its entry. If the bucket is ever
   // deleted (e.g. because of a culling) that won't have a negative impact on
   // the Handle's cleanup.
   using BucketPtr = std::shared_ptr<Bucket>;
-  using Checked =
-    std::unordered_map<ParticipantId, std::unordered_set<RouteId>>;
+  using Checked = VisitedRoutes;
 
   // TODO(MXG): Come up with a better name for this data structure than Entries
   using Entries = std::map<Time, BucketPtr>;
-  using MapNameToEntries = std::unordered_map<std::string, Entries>;
+  // The timelines are keyed by the interned ID of their map, so finding the
+  // timeline for a route or region does not need to hash its map name.
+  using MapNameToEntries = std::unordered_map<MapName::Id, Entries>;
 
   /// Constructor
   TimelineView()
@@ -160,14 +359,14 @@ public:
     {
       inspect_spacetime(
         spacetime,
-        ParticipantFilter::Include(participants.include()->get_ids()),
+        ParticipantFilter::Include(*participants.include()),
         inspector);
     }
     else if (Query::Participants::Mode::Exclude == mode)
     {
       inspect_spacetime(
         spacetime,
-        ParticipantFilter::Exclude(participants.exclude()->get_ids()),
+        ParticipantFilter::Exclude(*participants.exclude()),
         inspector);
     }
     else
@@ -206,6 +405,11 @@ protected:
       inspect_spacetime_timespan(
         *spacetime.timespan(), participant_filter, inspector);
     }
+    else if (Query::Spacetime::Mode::Corridor == mode)
+    {
+      inspect_spacetime_corridor(
+        *spacetime.corridor(), participant_filter, inspector);
+    }
   }
 
   template<typename Inspector, typename ParticipantFilter>
@@ -228,7 +432,7 @@ protected:
       if (participant_filter.ignore(entry->participant))
         continue;
 
-      if (!checked[entry->participant].insert(entry->storage_id).second)
+      if (!checked.insert(entry->participant, entry->storage_id))
         continue;
 
       inspector.inspect(entry.get(), relevant);
@@ -241,6 +445,16 @@ protected:
     const ParticipantFilter& participant_filter,
     Inspector& inspector) const
   {
+    if constexpr (is_mergeable_inspector<Inspector>::value)
+    {
+      if (_workers)
+      {
+        inspect_spacetime_regions_in_parallel(
+          regions, participant_filter, inspector);
+        return;
+      }
+    }
+
     Checked checked;
 
     rmf_traffic::internal::Spacetime spacetime_data;
@@ -255,8 +469,7 @@ protected:
 
     for (const Region& region : regions)
     {
-      const std::string& map = region.get_map();
-      const auto map_it = _timelines.find(map);
+      const auto map_it = _timelines.find(RegionData::get_map(region).id());
       if (map_it == _timelines.end())
         continue;
 
@@ -282,8 +495,8 @@ protected:
 
       for (auto space_it = region.begin(); space_it != region.end(); ++space_it)
       {
-        spacetime_data.pose = space_it->get_pose();
-        spacetime_data.shape = space_it->get_shape();
+        spacetime_data.set_space(
+          space_it->get_pose(), space_it->get_shape());
 
         inspect_entries(
           relevant,
@@ -296,6 +509,122 @@ protected:
     }
   }
 
+  /// Each task of a parallel inspection should have at least this many entries
+  /// to inspect, or else it is not worth handing them to another thread.
+  static constexpr std::size_t MinimumEntriesPerTask = 32;
+
+  template<typename Inspector, typename ParticipantFilter>
+  void inspect_spacetime_regions_in_parallel(
+    const Query::Spacetime::Regions& regions,
+    const ParticipantFilter& participant_filter,
+    Inspector& inspector) const
+  {
+    // First we find the entries in the same order that the serial inspection
+    // would visit them in, along with the space that each one would be checked
+    // against. This part is cheap compared to checking them for conflicts.
+    struct Visit
+    {
+      const Entry* entry;
+      std::size_t space;
+    };
+
+    std::vector<rmf_traffic::internal::Spacetime> spaces;
+    std::vector<Visit> visits;
+    Checked checked;
+    for (const Region& region : regions)
+    {
+      const auto map_it = _timelines.find(RegionData::get_map(region).id());
+      if (map_it == _timelines.end())
+        continue;
+
+      const Entries& timeline = map_it->second;
+      const Time* const lower_time_bound = region.get_lower_time_bound();
+      const Time* const upper_time_bound = region.get_upper_time_bound();
+      const auto timeline_begin =
+        get_timeline_begin(timeline, lower_time_bound);
+      const auto timeline_end =
+        get_timeline_end(timeline, upper_time_bound);
+
+      if (timeline_begin == timeline_end)
+        continue;
+
+      for (auto space_it = region.begin(); space_it != region.end(); ++space_it)
+      {
+        spaces.push_back(
+          rmf_traffic::internal::Spacetime{
+            lower_time_bound,
+            upper_time_bound,
+            space_it->get_pose(),
+            space_it->get_shape()
+          });
+
+        for (auto it = timeline_begin; it != timeline_end; ++it)
+        {
+          for (const auto& entry : *it->second)
+          {
+            if (!entry->description)
+              continue;
+
+            if (participant_filter.ignore(entry->participant))
+              continue;
+
+            if (!checked.insert(entry->participant, entry->storage_id))
+              continue;
+
+            visits.push_back(Visit{entry.get(), spaces.size()-1});
+          }
+        }
+      }
+    }
+
+    const auto inspect_visits = [&](
+      Inspector& output, const std::size_t begin, const std::size_t end)
+      {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+          const auto& space = spaces[visits[i].space];
+          const std::function<bool(const Entry&)> relevant =
+            [&space](const Entry& entry) -> bool
+            {
+              return rmf_traffic::internal::detect_conflicts(
+                entry.description->profile(),
+                entry.route->trajectory(),
+                space);
+            };
+
+          output.inspect(visits[i].entry, relevant);
+        }
+      };
+
+    const std::size_t tasks = std::min(
+      _workers->size(), visits.size() / MinimumEntriesPerTask);
+
+    if (tasks <= 1)
+    {
+      inspect_visits(inspector, 0, visits.size());
+      return;
+    }
+
+    // Each task inspects a contiguous slice of the visits, so merging the
+    // tasks in order gives the same order of results as a serial inspection.
+    std::vector<Inspector> splits;
+    splits.reserve(tasks);
+    for (std::size_t i = 0; i < tasks; ++i)
+      splits.push_back(inspector.split());
+
+    _workers->run(
+      tasks, [&](const std::size_t task)
+      {
+        inspect_visits(
+          splits[task],
+          task * visits.size() / tasks,
+          (task+1) * visits.size() / tasks);
+      });
+
+    for (auto& split : splits)
+      inspector.merge(std::move(split));
+  }
+
   template<typename Inspector, typename ParticipantFilter>
   void inspect_spacetime_timespan(
     const Query::Spacetime::Timespan& timespan,
@@ -310,12 +639,12 @@ protected:
     const auto relevant = [&lower_time_bound, &upper_time_bound](
       const Entry& entry) -> bool
       {
-        const Trajectory& trajectory = entry.route->trajectory();
-        assert(trajectory.start_time());
-        if (lower_time_bound && *trajectory.finish_time() < *lower_time_bound)
+        const RouteData& route = RouteData::get(*entry.route);
+        assert(route.start_time());
+        if (lower_time_bound && *route.finish_time() < *lower_time_bound)
           return false;
 
-        if (upper_time_bound && *upper_time_bound < *trajectory.start_time())
+        if (upper_time_bound && *upper_time_bound < *route.start_time())
           return false;
 
         return true;
@@ -340,7 +669,12 @@ protected:
       const auto& maps = timespan.maps();
       for (const std::string& map : maps)
       {
-        const auto map_it = _timelines.find(map);
+        // A map name that was never interned cannot have any routes on it
+        const auto map_id = MapName::find(map);
+        if (!map_id.has_value())
+          continue;
+
+        const auto map_it = _timelines.find(*map_id);
         if (map_it == _timelines.end())
           continue;
 
@@ -356,6 +690,46 @@ protected:
     }
   }
 
+  template<typename Inspector, typename ParticipantFilter>
+  void inspect_spacetime_corridor(
+    const Query::Spacetime::Corridor& corridor,
+    const ParticipantFilter& participant_filter,
+    Inspector& inspector) const
+  {
+    const CorridorFilter filter(corridor);
+    const Time* const lower_time_bound = filter.lower_time_bound();
+    const Time* const upper_time_bound = filter.upper_time_bound();
+    if (!lower_time_bound)
+      return;
+
+    const auto map_id = MapName::find(filter.map());
+    if (!map_id.has_value())
+      return;
+
+    const auto map_it = _timelines.find(*map_id);
+    if (map_it == _timelines.end())
+      return;
+
+    const auto relevant = [&filter](const Entry& entry) -> bool
+      {
+        return filter.relevant(
+          entry.description->profile(), entry.route->trajectory());
+      };
+
+    // Only the buckets that overlap the corridor in time are visited, and the
+    // boxes of the segments rule out most of the entries in those buckets
+    // before any conflict detection needs to be done.
+    const Entries& timeline = map_it->second;
+    Checked checked;
+    inspect_entries(
+      relevant,
+      participant_filter,
+      inspector,
+      get_timeline_begin(timeline, lower_time_bound),
+      get_timeline_end(timeline, upper_time_bound),
+      checked);
+  }
+
   template<typename Inspector, typename ParticipantFilter>
   void inspect_entries(
     const std::function<bool(const Entry&)>& relevant,
@@ -385,7 +759,7 @@ protected:
         if (participant_filter.ignore(entry->participant))
           continue;
 
-        if (!checked[entry->participant].insert(entry->storage_id).second)
+        if (!checked.insert(entry->participant, entry->storage_id))
           continue;
 
         inspector.inspect(entry, relevant);
@@ -417,6 +791,10 @@ protected:
 
   MapNameToEntries _timelines;
   BucketPtr _all_bucket;
+
+  /// The threads that can share the work of inspecting regions. This is a
+  /// nullptr when the inspection should only happen on the calling thread.
+  std::shared_ptr<WorkerPool> _workers;
 };
 
 //==============================================================================
@@ -445,34 +823,51 @@ public:
   using BaseBucket = TimelineView<BaseRouteEntry>::Bucket;
   using BaseBucketPtr = TimelineView<BaseRouteEntry>::BucketPtr;
 
-  static BaseBucketPtr clone_bucket(
-    const Bucket& other,
-    const std::function<bool(const Entry& other)>& check_relevant)
+  /// Constructor
+  Timeline(const TimelineOptions& options = TimelineOptions())
+  : _settings(options)
   {
-    if constexpr (std::is_same<Entry, BaseRouteEntry>::value)
+    this->_all_bucket = make_bucket();
+
+    if (_settings.inspection_threads > 1)
     {
-      // If there is no need to check for relevance and we are using
-      if (!check_relevant)
-        return std::make_shared<BaseBucket>(other);
+      this->_workers = std::make_shared<WorkerPool>(
+        options.executor(), _settings.inspection_threads);
     }
+  }
 
-    BaseBucket output;
-    output.reserve(other.size());
+  /// Clones of the buckets and entries that were made for earlier snapshots.
+  /// Snapshots never modify their buckets, so successive snapshots can share
+  /// the clones of any buckets that have not changed in between them.
+  struct SnapshotCache
+  {
+    struct BucketClone
+    {
+      std::weak_ptr<Bucket> source;
+      BaseBucketPtr clone;
+    };
 
-    for (const auto& other_entry : other)
+    struct EntryClone
     {
-      assert(other_entry);
-      if (check_relevant)
-      {
-        if (!check_relevant(*other_entry))
-          continue;
-      }
+      std::weak_ptr<const Entry> source;
+      std::shared_ptr<const BaseRouteEntry> clone;
+    };
 
-      output.emplace_back(std::make_shared<BaseRouteEntry>(*other_entry));
+    /// Stop sharing the clone of a bucket because the bucket has changed
+    void invalidate(const Bucket* bucket)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      buckets.erase(bucket);
     }
 
-    return std::make_shared<BaseBucket>(std::move(output));
-  }
+    std::mutex mutex;
+    std::unordered_map<const Bucket*, BucketClone> buckets;
+    std::unordered_map<const Entry*, EntryClone> entries;
+    std::size_t prune_buckets_at = 64;
+    std::size_t prune_entries_at = 64;
+  };
+
+  using SnapshotCachePtr = std::shared_ptr<SnapshotCache>;
 
   /// This Timeline::Handle class allows us to use RAII so that when an Entry is
   /// deleted it will automatically be removed from any of its timeline buckets.
@@ -480,9 +875,11 @@ public:
   {
     Handle(
       ConstEntryPtr entry,
-      std::vector<std::weak_ptr<Bucket>> buckets)
+      std::vector<std::weak_ptr<Bucket>> buckets,
+      SnapshotCachePtr snapshot_cache)
     : _entry(std::move(entry)),
-      _buckets(std::move(buckets))
+      _buckets(std::move(buckets)),
+      _snapshot_cache(std::move(snapshot_cache))
     {
       // Do nothing
     }
@@ -497,13 +894,64 @@ public:
 
         const auto it = std::find(bucket->begin(), bucket->end(), _entry);
         if (it != bucket->end())
+        {
           bucket->erase(it);
+          _snapshot_cache->invalidate(bucket.get());
+        }
+      }
+    }
+
+    /// Stop sharing the snapshot clones of every bucket that holds this entry
+    void invalidate_snapshots()
+    {
+      for (const auto& b : _buckets)
+      {
+        if (const auto bucket = b.lock())
+          _snapshot_cache->invalidate(bucket.get());
       }
     }
 
+    /// Stop tracking the buckets of the entry and hand them over so that the
+    /// entry can be removed from them in bulk. After this, destroying the
+    /// handle will not touch the timeline.
+    std::vector<std::weak_ptr<Bucket>> release()
+    {
+      std::vector<std::weak_ptr<Bucket>> buckets;
+      std::swap(buckets, _buckets);
+      return buckets;
+    }
+
+    const ConstEntryPtr& entry() const
+    {
+      return _entry;
+    }
+
+    /// The bytes that this handle is holding
+    std::size_t memory_usage() const
+    {
+      // The handle is made by std::make_shared, so its control block shares
+      // its allocation.
+      return sizeof(Handle) + 2*sizeof(void*)
+        + internal::vector_bytes(_buckets);
+    }
+
+    /// Keep track of a bucket that the entry was added to after it was
+    /// inserted, i.e. because a bucket was split or merged.
+    void track(std::weak_ptr<Bucket> bucket)
+    {
+      _buckets.erase(
+        std::remove_if(
+          _buckets.begin(), _buckets.end(),
+          [](const std::weak_ptr<Bucket>& b) { return b.expired(); }),
+        _buckets.end());
+
+      _buckets.emplace_back(std::move(bucket));
+    }
+
   private:
     ConstEntryPtr _entry;
     std::vector<std::weak_ptr<Bucket>> _buckets;
+    SnapshotCachePtr _snapshot_cache;
   };
 
   /// Insert a new entry into the timeline
@@ -521,28 +969,36 @@ public:
     }
 
     std::vector<std::weak_ptr<Bucket>> buckets;
+    std::vector<typename Entries::iterator> crowded;
+    Entries* crowded_timeline = nullptr;
     this->_all_bucket->push_back(entry);
     buckets.emplace_back(this->_all_bucket);
+    _snapshot_cache->invalidate(this->_all_bucket.get());
 
-    if (entry->route && entry->route->trajectory().size() < 2)
+    // Only the time span of the route is needed here, so we avoid applying
+    // any pending delay to its waypoints.
+    const RouteData* const route =
+      entry->route ? &RouteData::get(*entry->route) : nullptr;
+
+    if (route && route->size() < 2)
     {
       // *INDENT-OFF*
       throw std::runtime_error(
         "[rmf_traffic::schedule::Timeline] Trying to insert a trajectory with "
         "less than 2 waypoints ["
-        + std::to_string(entry->route->trajectory().size()) + "] is illegal!");
+        + std::to_string(route->size()) + "] is illegal!");
       // *INDENT-ON*
     }
 
-    if (entry->route && entry->route->trajectory().start_time())
+    if (route && route->start_time())
     {
 
-      const Time start_time = *entry->route->trajectory().start_time();
-      const Time finish_time = *entry->route->trajectory().finish_time();
-      const std::string& map_name = entry->route->map();
+      const Time start_time = *route->start_time();
+      const Time finish_time = *route->finish_time();
+      const MapName::Id map_id = RouteData::get(*entry->route).map.id();
 
       const auto map_it = this->_timelines.insert(
-        std::make_pair(map_name, Entries())).first;
+        std::make_pair(map_id, Entries())).first;
 
       Entries& timeline = map_it->second;
 
@@ -553,10 +1009,83 @@ public:
       {
         it->second->push_back(entry);
         buckets.emplace_back(it->second);
+        _snapshot_cache->invalidate(it->second.get());
+
+        if (_settings.split_threshold
+          && *_settings.split_threshold < it->second->size())
+        {
+          crowded.push_back(it);
+        }
+      }
+
+      crowded_timeline = &timeline;
+    }
+
+    auto handle = std::make_shared<Handle>(
+      entry, std::move(buckets), _snapshot_cache);
+    if (_settings.adaptive())
+      register_handle(entry.get(), handle);
+
+    // Each insertion splits a crowded bucket at most once, so the cost of
+    // splitting is spread out across the insertions that crowded it.
+    for (const auto& it : crowded)
+      split_bucket(*crowded_timeline, it);
+
+    return handle;
+  }
+
+  /// Tell the timeline that the relevance of an entry may have changed, so
+  /// the next snapshot needs to check it again.
+  void invalidate_snapshots(const std::shared_ptr<void>& handle)
+  {
+    if (handle)
+      std::static_pointer_cast<Handle>(handle)->invalidate_snapshots();
+  }
+
+  /// Remove the entries of many handles from the timeline at once. Each
+  /// affected bucket only gets passed over once, instead of once per handle,
+  /// which matters for the bucket that holds every entry. The handles can be
+  /// destroyed at any time afterwards without touching the timeline.
+  void erase(const std::vector<std::shared_ptr<void>>& handles)
+  {
+    struct Removal
+    {
+      BucketPtr bucket;
+      std::unordered_set<const Entry*> entries;
+    };
+
+    std::unordered_map<const Bucket*, Removal> removals;
+    for (const auto& h : handles)
+    {
+      if (!h)
+        continue;
+
+      auto* const handle = static_cast<Handle*>(h.get());
+      for (const auto& b : handle->release())
+      {
+        if (BucketPtr bucket = b.lock())
+        {
+          Removal& removal = removals[bucket.get()];
+          removal.bucket = std::move(bucket);
+          removal.entries.insert(handle->entry().get());
+        }
       }
     }
 
-    return std::make_shared<Handle>(entry, std::move(buckets));
+    for (auto& [_, removal] : removals)
+    {
+      Bucket& bucket = *removal.bucket;
+      bucket.erase(
+        std::remove_if(
+          bucket.begin(), bucket.end(),
+          [&removal](const ConstEntryPtr& entry)
+          {
+            return removal.entries.count(entry.get()) > 0;
+          }),
+        bucket.end());
+
+      _snapshot_cache->invalidate(removal.bucket.get());
+    }
   }
 
   void cull(const Time time)
@@ -574,13 +1103,24 @@ public:
 
       if (end_it != timeline.begin())
         timeline.erase(timeline.begin(), end_it);
+
+      if (_settings.merge_threshold)
+        merge_sparse_buckets(timeline);
     }
+
+    if (_settings.adaptive())
+      prune_handles();
   }
 
   /// Create an immutable snapshot of the current timeline. A single instance of
   /// the snapshot can be safely used by multiple threads simultaneously.
   ///
-  /// Filter out entries based on which are relevant.
+  /// Filter out entries based on which are relevant. Whether an entry is
+  /// relevant must not change while it is in the timeline, because buckets
+  /// that have not changed since the last snapshot will not be filtered again.
+  ///
+  /// Only the buckets that have changed since the last snapshot get cloned.
+  /// The rest are shared with the previous snapshot.
   std::shared_ptr<const TimelineView<const BaseRouteEntry>> snapshot(
     const std::function<bool(const Entry& other)>& check_relevant) const
   {
@@ -589,48 +1129,115 @@ public:
     // to reduce how many heap allocations are needed, and to lessen the cache
     // misses. The tricky part is this may cost us more when copying the maps.
 
-    // TODO(MXG): Consider whether there's a safe way to cache a snapshot. The
-    // main problem I see is that we don't have a good way of knowing when an
-    // entry gets removed right now, so we wouldn't know to update the snapshot
-    // when an entry gets taken out.
+    SnapshotCache& cache = *_snapshot_cache;
+    std::lock_guard<std::mutex> lock(cache.mutex);
 
     std::shared_ptr<TimelineView<const BaseRouteEntry>> result =
       std::make_shared<TimelineView<const BaseRouteEntry>>();
 
-    // Make a deep copy of the buckets so that adding/removing entries from the
-    // source bucket does not impact the snapshot
-    if constexpr (std::is_same<Entry, BaseRouteEntry>::value)
+    result->_timelines.reserve(this->_timelines.size());
+    for (const auto& [map, time_scope] : this->_timelines)
     {
-      result->_timelines = this->_timelines;
-      for (auto& [map, time_scope] : result->_timelines)
+      auto& out_time_scope =
+        result->_timelines.insert({map, {}}).first->second;
+
+      for (const auto& [time, bucket] : time_scope)
       {
-        for (auto& [time, bucket] : time_scope)
-          bucket = clone_bucket(*bucket, check_relevant);
+        out_time_scope.emplace_hint(
+          out_time_scope.end(), time,
+          snapshot_bucket(bucket, check_relevant, cache));
       }
     }
-    else
-    {
-      result->_timelines.reserve(this->_timelines.size());
-      for (const auto& [map, time_scope] : this->_timelines)
-      {
-        auto& out_time_scope =
-          result->_timelines.insert({map, {}}).first->second;
 
-        for (const auto& [time, bucket] : time_scope)
-          out_time_scope.insert({time, clone_bucket(*bucket, check_relevant)});
-      }
-    }
+    result->_all_bucket =
+      snapshot_bucket(this->_all_bucket, check_relevant, cache);
+    result->_workers = this->_workers;
 
-    result->_all_bucket = clone_bucket(*this->_all_bucket, check_relevant);
+    prune_snapshot_cache(cache);
 
     return result;
   }
 
+  /// The memory that the buckets of one map are holding
+  struct MapMemory
+  {
+    std::size_t buckets = 0;
+    std::size_t bytes = 0;
+  };
+
+  /// Get the memory that the buckets of each map are holding. This only walks
+  /// the buckets, not the entries inside of them.
+  std::unordered_map<MapName::Id, MapMemory> map_memory_usage() const
+  {
+    std::unordered_map<MapName::Id, MapMemory> output;
+    for (const auto& [map, timeline] : this->_timelines)
+    {
+      auto& memory = output[map];
+      memory.buckets = timeline.size();
+      memory.bytes = internal::tree_bytes(timeline);
+      for (const auto& [_, bucket] : timeline)
+        memory.bytes += bucket_bytes(*bucket);
+    }
+
+    return output;
+  }
+
+  /// Get the memory that the timeline is holding apart from the buckets of
+  /// each map: the bucket that holds every entry, and the bookkeeping of
+  /// handles and snapshots.
+  std::size_t shared_memory_usage() const
+  {
+    std::size_t bytes = bucket_bytes(*this->_all_bucket)
+      + internal::hash_table_bytes(this->_timelines)
+      + internal::hash_table_bytes(_handles);
+
+    SnapshotCache& cache = *_snapshot_cache;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    bytes += sizeof(SnapshotCache)
+      + internal::hash_table_bytes(cache.buckets)
+      + internal::hash_table_bytes(cache.entries);
+
+    return bytes;
+  }
+
+  /// Get the bytes that the handle of an entry is holding
+  static std::size_t handle_memory_usage(const std::shared_ptr<void>& handle)
+  {
+    if (!handle)
+      return 0;
+
+    return static_cast<const Handle*>(handle.get())->memory_usage();
+  }
+
+  // Each timeline has its own snapshot cache, so copying one would let the two
+  // copies share clones of buckets that are not the same.
+  Timeline(const Timeline&) = delete;
+  Timeline& operator=(const Timeline&) = delete;
+  Timeline(Timeline&&) = default;
+  Timeline& operator=(Timeline&&) = default;
+
 private:
 
   //============================================================================
-  static typename Entries::iterator get_timeline_iterator(
-    Entries& timeline, const Time time)
+  /// The bytes that a bucket is holding. Buckets are made by
+  /// std::allocate_shared, so their control blocks share their allocation.
+  static std::size_t bucket_bytes(const Bucket& bucket)
+  {
+    return sizeof(Bucket) + 2*sizeof(void*) + internal::vector_bytes(bucket);
+  }
+
+  //============================================================================
+  /// Make an empty bucket that is allocated from the memory resource of this
+  /// timeline.
+  BucketPtr make_bucket() const
+  {
+    return std::allocate_shared<Bucket>(
+      std::pmr::polymorphic_allocator<Bucket>(_settings.memory_resource));
+  }
+
+  //============================================================================
+  typename Entries::iterator get_timeline_iterator(
+    Entries& timeline, const Time time) const
   {
     auto start_it = timeline.lower_bound(time);
 
@@ -643,8 +1250,8 @@ private:
         return timeline.insert(
           timeline.end(),
           std::make_pair(
-            time + PartialBucketDuration,
-            std::make_shared<Bucket>()));
+            time + _settings.partial_bucket_duration,
+            make_bucket()));
       }
 
       auto last_it = --timeline.end();
@@ -653,24 +1260,270 @@ private:
         last_it = timeline.insert(
           timeline.end(),
           std::make_pair(
-            last_it->first + BucketDuration,
-            std::make_shared<Bucket>()));
+            last_it->first + _settings.bucket_duration,
+            make_bucket()));
       }
 
       return last_it;
     }
 
-    while (time + BucketDuration < start_it->first)
+    // Only the first bucket can be stretched too far back in time. Every other
+    // bucket starts where the bucket before it ends, no matter how wide it is.
+    if (start_it != timeline.begin())
+      return start_it;
+
+    while (time + _settings.bucket_duration < start_it->first)
     {
       start_it = timeline.insert(
         start_it,
         std::make_pair(
-          start_it->first - BucketDuration,
-          std::make_shared<Bucket>()));
+          start_it->first - _settings.bucket_duration,
+          make_bucket()));
     }
 
     return start_it;
   }
+
+  //============================================================================
+  /// Get the clone of a bucket for a snapshot, reusing the clone from the last
+  /// snapshot if the bucket has not changed since then. The cache mutex must be
+  /// locked.
+  BaseBucketPtr snapshot_bucket(
+    const BucketPtr& bucket,
+    const std::function<bool(const Entry& other)>& check_relevant,
+    SnapshotCache& cache) const
+  {
+    auto& cached = cache.buckets[bucket.get()];
+    if (cached.clone && cached.source.lock() == bucket)
+      return cached.clone;
+
+    BaseBucket output;
+    output.reserve(bucket->size());
+
+    for (const auto& entry : *bucket)
+    {
+      assert(entry);
+      if (check_relevant)
+      {
+        if (!check_relevant(*entry))
+          continue;
+      }
+
+      output.emplace_back(snapshot_entry(entry, cache));
+    }
+
+    cached.source = bucket;
+    cached.clone = std::make_shared<BaseBucket>(std::move(output));
+    return cached.clone;
+  }
+
+  //============================================================================
+  /// Get the version of an entry that can be put into a snapshot. Entries are
+  /// never modified once they are in the timeline, so they only need to be
+  /// cloned once.
+  std::shared_ptr<const BaseRouteEntry> snapshot_entry(
+    const ConstEntryPtr& entry,
+    SnapshotCache& cache) const
+  {
+    if constexpr (
+      std::is_same<std::remove_const_t<Entry>, BaseRouteEntry>::value)
+    {
+      // The entry is already a plain BaseRouteEntry, so the snapshot can share
+      // it directly.
+      (void)cache;
+      return entry;
+    }
+    else
+    {
+      // The entry has extra fields that the snapshot does not need, and which
+      // may hold onto more data than we want to keep alive, so we slice it down
+      // to a BaseRouteEntry.
+      auto& cached = cache.entries[entry.get()];
+      if (!cached.clone || cached.source.lock() != entry)
+      {
+        cached.source = entry;
+        cached.clone = std::make_shared<BaseRouteEntry>(*entry);
+      }
+
+      return cached.clone;
+    }
+  }
+
+  //============================================================================
+  /// Get rid of clones whose sources have been deleted. This is only done when
+  /// the caches have grown a lot since the last time they were pruned.
+  static void prune_snapshot_cache(SnapshotCache& cache)
+  {
+    if (cache.buckets.size() >= cache.prune_buckets_at)
+    {
+      for (auto it = cache.buckets.begin(); it != cache.buckets.end(); )
+      {
+        if (it->second.source.expired())
+          it = cache.buckets.erase(it);
+        else
+          ++it;
+      }
+
+      cache.prune_buckets_at =
+        std::max<std::size_t>(64, 2*cache.buckets.size());
+    }
+
+    if (cache.entries.size() >= cache.prune_entries_at)
+    {
+      for (auto it = cache.entries.begin(); it != cache.entries.end(); )
+      {
+        if (it->second.source.expired())
+          it = cache.entries.erase(it);
+        else
+          ++it;
+      }
+
+      cache.prune_entries_at =
+        std::max<std::size_t>(64, 2*cache.entries.size());
+    }
+  }
+
+  //============================================================================
+  void register_handle(
+    const Entry* entry,
+    const std::shared_ptr<Handle>& handle)
+  {
+    _handles[entry] = handle;
+
+    if (_handles.size() >= _prune_handles_at)
+    {
+      prune_handles();
+      _prune_handles_at = std::max<std::size_t>(64, 2*_handles.size());
+    }
+  }
+
+  //============================================================================
+  void prune_handles()
+  {
+    for (auto it = _handles.begin(); it != _handles.end(); )
+    {
+      if (it->second.expired())
+        it = _handles.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  //============================================================================
+  /// Tell the handle of an entry that the entry has been added to a bucket.
+  void track(const ConstEntryPtr& entry, const BucketPtr& bucket)
+  {
+    const auto it = _handles.find(entry.get());
+    if (it == _handles.end())
+      return;
+
+    if (const auto handle = it->second.lock())
+      handle->track(bucket);
+  }
+
+  //============================================================================
+  /// Split a bucket into two buckets that each cover half of its time range.
+  void split_bucket(Entries& timeline, const typename Entries::iterator it)
+  {
+    Bucket& bucket = *it->second;
+    const Time upper = it->first;
+    Time lower = upper;
+    if (it == timeline.begin())
+    {
+      // The first bucket does not have a lower bound, so we split the range
+      // that its entries actually start in.
+      for (const auto& entry : bucket)
+        lower = std::min(lower, *RouteData::get(*entry->route).start_time());
+    }
+    else
+    {
+      lower = std::prev(it)->first;
+    }
+
+    const Duration span = upper - lower;
+    if (span < 2*_settings.minimum_bucket_duration)
+      return;
+
+    const Time middle = lower + span/2;
+    if (middle <= lower)
+      return;
+
+    // The new bucket covers (lower, middle] and the old bucket is reduced to
+    // (middle, upper]. An entry will land in both if it spans the middle.
+    auto early_bucket = make_bucket();
+    Bucket late_bucket(bucket.get_allocator());
+    late_bucket.reserve(bucket.size());
+    for (const auto& entry : bucket)
+    {
+      const RouteData& route = RouteData::get(*entry->route);
+      if (*route.start_time() <= middle)
+      {
+        early_bucket->push_back(entry);
+        track(entry, early_bucket);
+      }
+
+      if (middle < *route.finish_time())
+        late_bucket.push_back(entry);
+    }
+
+    bucket = std::move(late_bucket);
+    _snapshot_cache->invalidate(&bucket);
+    timeline.insert(it, std::make_pair(middle, std::move(early_bucket)));
+  }
+
+  //============================================================================
+  /// Merge neighboring buckets that have few entries between them.
+  void merge_sparse_buckets(Entries& timeline)
+  {
+    if (timeline.size() < 2)
+      return;
+
+    auto it = timeline.begin();
+    auto next = std::next(it);
+    while (next != timeline.end())
+    {
+      // The first bucket has no lower bound, so only the span of the bucket
+      // after it is counted.
+      const Time lower = it == timeline.begin() ?
+        it->first : std::prev(it)->first;
+
+      const std::size_t combined = it->second->size() + next->second->size();
+      if (combined > *_settings.merge_threshold
+        || next->first - lower > _settings.maximum_bucket_duration)
+      {
+        it = next++;
+        continue;
+      }
+
+      Bucket& later = *next->second;
+      std::unordered_set<const Entry*> present;
+      for (const auto& entry : later)
+        present.insert(entry.get());
+
+      for (const auto& entry : *it->second)
+      {
+        if (present.count(entry.get()))
+          continue;
+
+        later.push_back(entry);
+        track(entry, next->second);
+      }
+
+      _snapshot_cache->invalidate(&later);
+
+      it = timeline.erase(it);
+      next = std::next(it);
+    }
+  }
+
+  TimelineSettings _settings;
+  SnapshotCachePtr _snapshot_cache = std::make_shared<SnapshotCache>();
+
+  // The handles of the entries are only tracked when the timeline is adaptive,
+  // because splitting or merging buckets moves entries into buckets that their
+  // handles would not otherwise know about.
+  std::unordered_map<const Entry*, std::weak_ptr<Handle>> _handles;
+  std::size_t _prune_handles_at = 64;
 };
 
 //==============================================================================
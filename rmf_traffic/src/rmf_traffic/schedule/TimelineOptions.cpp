@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/TimelineOptions.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+class TimelineOptions::Implementation
+{
+public:
+
+  Duration bucket_duration;
+  std::optional<std::size_t> split_threshold = std::nullopt;
+  std::optional<std::size_t> merge_threshold = std::nullopt;
+  Duration minimum_bucket_duration = std::chrono::seconds(1);
+  Duration maximum_bucket_duration = std::chrono::minutes(10);
+  std::size_t inspection_threads = 1;
+  std::shared_ptr<Executor> executor = nullptr;
+  std::pmr::memory_resource* memory_resource = nullptr;
+
+};
+
+namespace {
+//==============================================================================
+void check_positive(const Duration value, const std::string& name)
+{
+  if (value <= Duration(0))
+  {
+    // *INDENT-OFF*
+    throw std::invalid_argument(
+      "[rmf_traffic::schedule::TimelineOptions::" + name + "] The value must "
+      "be a positive duration, but it was ["
+      + std::to_string(value.count()) + "ns]");
+    // *INDENT-ON*
+  }
+}
+} // anonymous namespace
+
+//==============================================================================
+TimelineOptions::TimelineOptions(const Duration bucket_duration)
+: _pimpl(rmf_utils::make_impl<Implementation>(
+      Implementation{bucket_duration}))
+{
+  check_positive(bucket_duration, "TimelineOptions");
+}
+
+//==============================================================================
+TimelineOptions TimelineOptions::adaptive(
+  const Duration bucket_duration,
+  const std::size_t split_threshold,
+  const std::size_t merge_threshold)
+{
+  TimelineOptions options(bucket_duration);
+  options.split_threshold(split_threshold);
+  options.merge_threshold(merge_threshold);
+  return options;
+}
+
+//==============================================================================
+TimelineOptions& TimelineOptions::bucket_duration(const Duration value)
+{
+  check_positive(value, "bucket_duration");
+  _pimpl->bucket_duration = value;
+  return *this;
+}
+
+//==============================================================================
+Duration TimelineOptions::bucket_duration() const
+{
+  return _pimpl->bucket_duration;
+}
+
+//==============================================================================
+TimelineOptions& TimelineOptions::split_threshold(
+  const std::optional<std::size_t> value)
+{
+  _pimpl->split_threshold = value;
+  return *this;
+}
+
+//==============================================================================
+std::optional<std::size_t> TimelineOptions::split_threshold() const
+{
+  return _pimpl->split_threshold;
+}
+
+//==============================================================================
+TimelineOptions& TimelineOptions::merge_threshold(
+  const std::optional<std::size_t> value)
+{
+  _pimpl->merge_threshold = value;
+  return *this;
+}
+
+//==============================================================================
+std::optional<std::size_t> TimelineOptions::merge_threshold() const
+{
+  return _pimpl->merge_threshold;
+}
+
+//==============================================================================
+TimelineOptions& TimelineOptions::minimum_bucket_duration(const Duration value)
+{
+  check_positive(value, "minimum_bucket_duration");
+  _pimpl->minimum_bucket_duration = value;
+  return *this;
+}
+
+//==============================================================================
+Duration TimelineOptions::minimum_bucket_duration() const
+{
+  return _pimpl->minimum_bucket_duration;
+}
+
+//==============================================================================
+TimelineOptions& TimelineOptions::maximum_bucket_duration(const Duration value)
+{
+  check_positive(value, "maximum_bucket_duration");
+  _pimpl->maximum_bucket_duration = value;
+  return *this;
+}
+
+//==============================================================================
+Duration TimelineOptions::maximum_bucket_duration() const
+{
+  return _pimpl->maximum_bucket_duration;
+}
+
+//==============================================================================
+TimelineOptions& TimelineOptions::inspection_threads(const std::size_t value)
+{
+  _pimpl->inspection_threads = std::max<std::size_t>(value, 1);
+  return *this;
+}
+
+//==============================================================================
+std::size_t TimelineOptions::inspection_threads() const
+{
+  return _pimpl->inspection_threads;
+}
+
+//==============================================================================
+TimelineOptions& TimelineOptions::executor(std::shared_ptr<Executor> value)
+{
+  _pimpl->executor = std::move(value);
+  return *this;
+}
+
+//==============================================================================
+const std::shared_ptr<Executor>& TimelineOptions::executor() const
+{
+  return _pimpl->executor;
+}
+
+//==============================================================================
+TimelineOptions& TimelineOptions::memory_resource(
+  std::pmr::memory_resource* resource)
+{
+  _pimpl->memory_resource = resource;
+  return *this;
+}
+
+//==============================================================================
+std::pmr::memory_resource* TimelineOptions::memory_resource() const
+{
+  return _pimpl->memory_resource;
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
@@ -57,6 +57,12 @@ std::size_t Viewer::View::size() const
   return _pimpl->elements.size();
 }
 
+//==============================================================================
+std::optional<Version> Viewer::schedule_version() const
+{
+  return std::nullopt;
+}
+
 //==============================================================================
 void ItineraryViewer::DependencySubscription::Implementation::Shared::reach()
 {
@@ -123,6 +129,17 @@ ItineraryViewer::DependencySubscription::DependencySubscription()
   // Do nothing
 }
 
+//==============================================================================
+std::shared_ptr<const ItineraryView> ItineraryViewer::get_itinerary_view(
+  const ParticipantId participant_id) const
+{
+  auto itinerary = get_itinerary(participant_id);
+  if (!itinerary.has_value())
+    return nullptr;
+
+  return std::make_shared<const ItineraryView>(std::move(*itinerary));
+}
+
 } // namespace schedule
 
 
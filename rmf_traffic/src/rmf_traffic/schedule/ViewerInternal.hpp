@@ -20,6 +20,8 @@
 
 #include <rmf_traffic/schedule/Viewer.hpp>
 
+#include <cassert>
+#include <memory>
 #include <vector>
 
 namespace rmf_traffic {
@@ -36,53 +38,160 @@ public:
     PlanId plan_id;
     RouteId route_id;
     ConstRoutePtr route;
-    std::shared_ptr<const ParticipantDescription> description;
+    const ParticipantDescription* description;
+  };
+
+  /// Collects the routes of a view while a timeline is being inspected.
+  ///
+  /// The elements of a view only refer to the descriptions of their
+  /// participants, so the view needs to keep those descriptions alive. Rather
+  /// than holding a reference count for the description of every route, the
+  /// builder only pins a description when it differs from the last one that it
+  /// pinned. A builder for a source that never changes, like a snapshot, does
+  /// not need to pin any descriptions since the view can pin the whole source
+  /// instead.
+  class Builder
+  {
+  public:
+
+    Builder(bool pin_descriptions = true)
+    : _pin_descriptions(pin_descriptions)
+    {
+      // Do nothing
+    }
+
+    template<typename Entry>
+    void add(const Entry& entry)
+    {
+      const ParticipantDescription* const description =
+        entry.description.get();
+
+      if (_pin_descriptions && description != _last_pinned)
+      {
+        _pins.push_back(entry.description);
+        _last_pinned = description;
+      }
+
+      _storage.push_back(
+        Storage{
+          entry.participant,
+          entry.plan_id,
+          entry.route_id,
+          entry.route,
+          description
+        });
+    }
+
+    /// Make an empty builder that pins in the same way as this one
+    Builder split() const
+    {
+      return Builder(_pin_descriptions);
+    }
+
+    /// Add the routes that another builder collected after these ones
+    void merge(Builder&& other)
+    {
+      _storage.insert(
+        _storage.end(),
+        std::make_move_iterator(other._storage.begin()),
+        std::make_move_iterator(other._storage.end()));
+
+      _pins.insert(
+        _pins.end(),
+        std::make_move_iterator(other._pins.begin()),
+        std::make_move_iterator(other._pins.end()));
+    }
+
+    /// Make the view. The source can be pinned as a whole, which is needed
+    /// when this builder does not pin descriptions.
+    View build(std::shared_ptr<const void> source = nullptr) &&
+    {
+      if (source)
+        _pins.push_back(std::move(source));
+
+      return make_view(std::move(_storage), std::move(_pins));
+    }
+
+  private:
+    bool _pin_descriptions;
+    const ParticipantDescription* _last_pinned = nullptr;
+    std::vector<Storage> _storage;
+    std::vector<std::shared_ptr<const void>> _pins;
   };
 
-  std::vector<Storage> storage;
   std::vector<Element> elements;
 
-  static View make_view(std::vector<Storage> input)
-  {
-    std::vector<Element> elements = make_elements(input);
+  /// Keeps alive the descriptions that the elements refer to
+  std::vector<std::shared_ptr<const void>> pins;
 
+  static View make_view(
+    std::vector<Storage> input,
+    std::vector<std::shared_ptr<const void>> pins)
+  {
     View view;
     view._pimpl = rmf_utils::make_impl<Implementation>(
-      Implementation{
-        std::move(input),
-        std::move(elements)
-      });
+      Implementation{{}, std::move(pins)});
+    append_to_elements(view._pimpl->elements, std::move(input));
     return view;
   }
 
-  static void append_to_view(View& view, std::vector<Storage> input)
+  /// Make a view of some of the elements of another view
+  template<typename Predicate>
+  static View make_filtered_view(const View& source, const Predicate& keep)
   {
-    append_to_elements(view._pimpl->elements, input);
-    view._pimpl->storage.insert(
-      view._pimpl->storage.end(),
-      std::make_move_iterator(input.begin()),
-      std::make_move_iterator(input.end()));
+    View view;
+    view._pimpl = rmf_utils::make_impl<Implementation>(
+      Implementation{{}, source._pimpl->pins});
+
+    for (const auto& element : source._pimpl->elements)
+    {
+      if (keep(element))
+        view._pimpl->elements.push_back(element);
+    }
+
+    return view;
   }
 
-  static std::vector<Element> make_elements(
-    const std::vector<Storage>& input)
+  static void append_to_view(View& view, const View& other)
   {
-    std::vector<Element> elements;
-    append_to_elements(elements, input);
-    return elements;
+    auto& elements = view._pimpl->elements;
+    elements.reserve(elements.size() + other._pimpl->elements.size());
+    for (const auto& element : other._pimpl->elements)
+      elements.push_back(element);
+
+    auto& pins = view._pimpl->pins;
+    pins.insert(pins.end(), other._pimpl->pins.begin(), other._pimpl->pins.end());
   }
 
+private:
+
+  /// Builds an element in place, taking the route from its storage so that
+  /// the reference count of the route does not need to be touched.
+  struct ElementFromStorage
+  {
+    Storage& storage;
+
+    operator Element() const
+    {
+      assert(storage.route);
+      assert(storage.description);
+      return Element{
+        storage.participant,
+        storage.plan_id,
+        storage.route_id,
+        std::move(storage.route),
+        *storage.description
+      };
+    }
+  };
+
   static void append_to_elements(
     std::vector<Element>& elements,
-    const std::vector<Storage>& input)
+    std::vector<Storage> input)
   {
     elements.reserve(elements.size() + input.size());
-    for (const auto& s : input)
-    {
-      assert(s.route);
-      elements.emplace_back(
-        Element{s.participant, s.plan_id, s.route_id, s.route, *s.description});
-    }
+    for (auto& s : input)
+      elements.emplace_back(ElementFromStorage{s});
   }
 };
 
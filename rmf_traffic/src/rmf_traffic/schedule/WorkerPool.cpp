@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "internal_WorkerPool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+WorkerPool::WorkerPool(const std::size_t size)
+: WorkerPool(nullptr, size)
+{
+  // Do nothing
+}
+
+//==============================================================================
+WorkerPool::WorkerPool(
+  std::shared_ptr<Executor> executor,
+  const std::size_t size)
+: _executor(std::move(executor)),
+  _size(std::max<std::size_t>(size, 1))
+{
+  if (!_executor && _size > 1)
+  {
+    Executor::Config config;
+    config.threads = _size - 1;
+    _executor = Executor::make(std::move(config));
+  }
+}
+
+//==============================================================================
+std::size_t WorkerPool::size() const
+{
+  return _size;
+}
+
+//==============================================================================
+const std::shared_ptr<Executor>& WorkerPool::executor() const
+{
+  return _executor;
+}
+
+//==============================================================================
+void WorkerPool::run(
+  const std::size_t count,
+  const std::function<void(std::size_t)>& task)
+{
+  if (_executor && _size > 1 && count > 1)
+  {
+    _executor->run(count, task, _size);
+    return;
+  }
+
+  std::exception_ptr error;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    try
+    {
+      task(i);
+    }
+    catch (...)
+    {
+      if (!error)
+        error = std::current_exception();
+    }
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+} // namespace schedule
+} // namespace rmf_traffic
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_CONCURRENCY_HPP
+#define SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_CONCURRENCY_HPP
+
+#include <rmf_traffic/schedule/Concurrency.hpp>
+#include <rmf_traffic/schedule/Snapshot.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// Synchronizes the readers and writers of a Database or Mirror. When the
+/// concurrency mode is None, the locks do nothing and nothing gets published.
+class ConcurrencyControl
+{
+public:
+
+  using ReadLock = std::shared_lock<std::shared_mutex>;
+  using WriteLock = std::unique_lock<std::shared_mutex>;
+
+  ConcurrencyControl(const Concurrency mode = Concurrency::None)
+  : _locks(mode == Concurrency::SharedReads ?
+      std::make_unique<Locks>() : nullptr)
+  {
+    // Do nothing
+  }
+
+  bool shared_reads() const
+  {
+    return _locks != nullptr;
+  }
+
+  ReadLock read() const
+  {
+    if (!_locks)
+      return ReadLock();
+
+    // Readers pass through the turnstile so that they line up behind any
+    // writer that is waiting. Otherwise a steady stream of overlapping reads
+    // could keep the writers out forever.
+    const std::lock_guard<std::mutex> turnstile(_locks->turnstile);
+    return ReadLock(_locks->mutex);
+  }
+
+  WriteLock write() const
+  {
+    if (!_locks)
+      return WriteLock();
+
+    // Hold the turnstile until the current readers are done so that no new
+    // readers can get in ahead of this writer.
+    const std::lock_guard<std::mutex> turnstile(_locks->turnstile);
+    return WriteLock(_locks->mutex);
+  }
+
+  /// Get the snapshot that was published after the latest finished write. This
+  /// will be a nullptr if nothing has been published yet.
+  std::shared_ptr<const Snapshot> published() const
+  {
+    if (!_locks)
+      return nullptr;
+
+    return std::atomic_load(&_published);
+  }
+
+  void publish(std::shared_ptr<const Snapshot> snapshot) const
+  {
+    std::atomic_store(&_published, std::move(snapshot));
+  }
+
+  /// Check whether the calling thread is the one that holds the write lock
+  bool writing_on_this_thread() const
+  {
+    return _locks && _locks->writer.load() == std::this_thread::get_id();
+  }
+
+  void set_writer(const std::thread::id id) const
+  {
+    if (_locks)
+      _locks->writer.store(id);
+  }
+
+private:
+  struct Locks
+  {
+    std::shared_mutex mutex;
+    std::mutex turnstile;
+    std::atomic<std::thread::id> writer{std::thread::id()};
+  };
+
+  std::unique_ptr<Locks> _locks;
+  mutable std::shared_ptr<const Snapshot> _published;
+};
+
+//==============================================================================
+/// Holds the write lock of a schedule while it is being modified. When shared
+/// reads are allowed, a new snapshot is published before the lock is released.
+///
+/// Owner must have a concurrency field and a make_snapshot() function.
+template<typename Owner>
+class WriteScope
+{
+public:
+
+  WriteScope(const Owner& owner)
+  : _owner(owner),
+    _nested(owner.concurrency.writing_on_this_thread())
+  {
+    // A write that happens inside of another write on the same thread, e.g.
+    // the changes of a Database::Transaction, reuses the lock of the outer
+    // write, and only the outer write publishes a snapshot.
+    if (_nested)
+      return;
+
+    // The previous snapshot stays published while the write is in progress, so
+    // readers of snapshots never need to wait for writers.
+    _lock = owner.concurrency.write();
+    if (_owner.concurrency.shared_reads())
+      _owner.concurrency.set_writer(std::this_thread::get_id());
+  }
+
+  ~WriteScope()
+  {
+    if (_nested || !_owner.concurrency.shared_reads())
+      return;
+
+    _owner.concurrency.set_writer(std::thread::id());
+
+    try
+    {
+      _owner.concurrency.publish(_owner.make_snapshot());
+    }
+    catch (...)
+    {
+      // Readers will make their own snapshot if we fail to publish one
+      _owner.concurrency.publish(nullptr);
+    }
+  }
+
+  WriteScope(const WriteScope&) = delete;
+  WriteScope& operator=(const WriteScope&) = delete;
+
+private:
+  const Owner& _owner;
+  bool _nested;
+  ConcurrencyControl::WriteLock _lock;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_CONCURRENCY_HPP
@@ -20,6 +20,8 @@
 
 #include <rmf_traffic/schedule/Database.hpp>
 
+#include <functional>
+
 namespace rmf_traffic {
 namespace schedule {
 
@@ -54,6 +56,29 @@ void set_initial_fork_version(
   Database& database,
   Version version);
 
+//==============================================================================
+/// Only put the routes of the maps that pass this test into the timeline and
+/// change log of the database. The routes of other maps are still stored, so
+/// the route and storage IDs of the database stay the same as any other
+/// database that receives the same changes.
+void set_indexed_maps(
+  Database& database,
+  std::function<bool(const std::string& map)> indexed_maps);
+
+//==============================================================================
+/// Make the next change to the database take on the given version. This lets
+/// several databases share one sequence of versions.
+void set_next_version(Database& database, Version version);
+
+//==============================================================================
+/// Replace the itinerary, progress, and storage of a participant in the target
+/// database with the ones that it has in the source database.
+void copy_participant_state(
+  Database& source,
+  Database& target,
+  ParticipantId participant,
+  ItineraryVersion itinerary_version);
+
 } // namespace schedule
 } // namespace rmf_traffic
 
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_ITINERARY_HPP
+#define SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_ITINERARY_HPP
+
+#include <rmf_traffic/schedule/Itinerary.hpp>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// Compute the same hash as hash_itinerary() for a view of an itinerary
+std::size_t hash_itinerary(const ItineraryView& itinerary);
+
+//==============================================================================
+/// Check whether two itineraries have the same content. Use this to confirm
+/// that itineraries with matching hashes really are the same.
+bool same_itinerary(const Itinerary& a, const Itinerary& b);
+
+//==============================================================================
+/// Check whether an itinerary has the same content as a view of one
+bool same_itinerary(const Itinerary& a, const ItineraryView& b);
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_ITINERARY_HPP
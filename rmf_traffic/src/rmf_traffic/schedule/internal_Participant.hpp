@@ -55,6 +55,10 @@ public:
 
     void delay(Duration delay);
 
+    void delay_coalescing(std::optional<DelayCoalescing> policy);
+
+    void flush_delay();
+
     void reached(PlanId plan, RouteId route, CheckpointId checkpoint);
 
     void clear();
@@ -64,6 +68,8 @@ public:
       ItineraryVersion last_known_itinerary,
       ProgressVersion last_known_progress);
 
+    void retransmission(Retransmission mode);
+
     ItineraryVersion current_version() const;
 
     ParticipantId get_id() const;
@@ -81,22 +87,71 @@ public:
 
     ItineraryVersion get_next_version();
 
+    /// Apply a delay to every route of the current itinerary. Returns false if
+    /// there were no waypoints to delay.
+    bool apply_delay(Duration delay);
+
+    /// Send a delay to the schedule, or hold it back if the delay coalescing
+    /// policy says so.
+    void report_delay(Duration delay);
+
+    /// A change that was sent to the schedule, kept in case the schedule asks
+    /// for it again. Delays are stored inline, while the itinerary of a set is
+    /// shared with every retransmission of it.
+    struct StoredChange
+    {
+      enum class Type : uint8_t
+      {
+        Set,
+        Delay,
+        Clear
+      };
+
+      Type type;
+      Duration delay = Duration(0);
+      PlanId plan = 0;
+      Writer::StorageId storage_base = 0;
+      std::shared_ptr<const Itinerary> itinerary;
+    };
+
+    /// Get the hash of the current itinerary, calculating it if needed
+    std::size_t current_itinerary_hash() const;
+
+    /// Send a change to the schedule
+    void send(ItineraryVersion version, const StoredChange& change) const;
+
+    /// Record a change in the history and send it to the schedule
+    void record(ItineraryVersion version, StoredChange change);
+
+    /// Replace the history with a single set(~) of the current itinerary and
+    /// send it to the schedule, followed by the current progress.
+    void send_net_state();
+
     ParticipantId _id;
     ItineraryVersion _version;
     ParticipantDescription _description;
     std::shared_ptr<Writer> _writer;
     std::unique_ptr<RectificationRequester> _rectification;
 
-    using ChangeHistory =
-      std::map<RouteId, std::function<void()>, rmf_utils::ModularLess<RouteId>>;
+    using ChangeHistory = std::map<
+      ItineraryVersion, StoredChange, rmf_utils::ModularLess<ItineraryVersion>>;
 
     PlanId _current_plan_id;
     Writer::StorageId _next_storage_base;
     Itinerary _current_itinerary;
 
+    /// The hash_itinerary() of _current_itinerary, calculated when it is first
+    /// needed. Any change to _current_itinerary must reset it.
+    mutable std::optional<std::size_t> _current_itinerary_hash;
+
     ChangeHistory _change_history;
+    Retransmission _retransmission = Retransmission::Replay;
     Duration _cumulative_delay = std::chrono::seconds(0);
 
+    std::optional<DelayCoalescing> _delay_coalescing;
+    Duration _held_delay = std::chrono::seconds(0);
+    std::optional<std::chrono::steady_clock::time_point> _last_delay_sent;
+
     Progress _progress;
     ProgressBuffer _buffered_progress;
 
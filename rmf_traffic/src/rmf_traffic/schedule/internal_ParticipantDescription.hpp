@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_PARTICIPANTDESCRIPTION_HPP
+#define SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_PARTICIPANTDESCRIPTION_HPP
+
+#include <rmf_traffic/schedule/ParticipantDescription.hpp>
+
+#include <memory>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// Get a shared handle to a description that is equal to the one given. While
+/// any handle to an equal description is still alive, that same handle will be
+/// returned, so fleets that register many identical participants share one
+/// description and one set of profile shapes.
+std::shared_ptr<const ParticipantDescription> intern_description(
+  ParticipantDescription description);
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_PARTICIPANTDESCRIPTION_HPP
@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_PARTICIPANTTABLE_HPP
+#define SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_PARTICIPANTTABLE_HPP
+
+#include <rmf_traffic/Route.hpp>
+
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// A table of values for each participant, which the database and mirrors use
+/// in place of an std::unordered_map<ParticipantId, Value>. The database hands
+/// out participant IDs densely, so the table keeps a slot for every ID up to
+/// the highest one, and looking a participant up is an index into a vector
+/// instead of a hash lookup.
+///
+/// A slot is empty when its participant is not registered, so looking up an
+/// unregistered ID finds nothing, just like a map would. Each value lives in
+/// its own allocation, so references to values stay valid when other
+/// participants are inserted or erased, which the code that moved over from
+/// std::unordered_map relies on.
+///
+/// IDs can also arrive from patches and saved files, so they are not trusted
+/// to be dense. An ID that is far beyond the last slot is kept in an ordered
+/// map instead of growing the slots to reach it. The IDs in the map are always
+/// beyond the last slot, and they move into the slots once the slots grow to
+/// reach them.
+///
+/// Iteration visits participants in order of their IDs.
+template<typename Value>
+class ParticipantTable
+{
+public:
+
+  using key_type = ParticipantId;
+  using mapped_type = Value;
+  using value_type = std::pair<const ParticipantId, Value>;
+
+private:
+  using Slots = std::vector<std::unique_ptr<value_type>>;
+  using Sparse = std::map<ParticipantId, std::unique_ptr<value_type>>;
+
+  /// How far past the last slot an ID may be before it goes into the sparse
+  /// map instead of the slots
+  static constexpr std::size_t MaxDenseGap = 1024;
+
+public:
+
+  template<typename SlotIt, typename SparseIt, typename Element>
+  class basic_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Element;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Element*;
+    using reference = Element&;
+
+    basic_iterator() = default;
+
+    /// Allow an iterator to be converted into a const_iterator
+    template<
+      typename OtherIt,
+      typename OtherSparseIt,
+      typename OtherElement,
+      typename = std::enable_if_t<std::is_convertible_v<OtherIt, SlotIt>>>
+    basic_iterator(
+      const basic_iterator<OtherIt, OtherSparseIt, OtherElement>& other)
+    : _it(other._it),
+      _end(other._end),
+      _sparse(other._sparse)
+    {
+      // Do nothing
+    }
+
+    reference operator*() const
+    {
+      return *operator->();
+    }
+
+    pointer operator->() const
+    {
+      if (_it != _end)
+        return _it->get();
+
+      return _sparse->second.get();
+    }
+
+    basic_iterator& operator++()
+    {
+      if (_it != _end)
+      {
+        ++_it;
+        skip_empty();
+      }
+      else
+      {
+        ++_sparse;
+      }
+
+      return *this;
+    }
+
+    basic_iterator operator++(int)
+    {
+      basic_iterator copy = *this;
+      ++(*this);
+      return copy;
+    }
+
+    template<typename OtherIt, typename OtherSparseIt, typename OtherElement>
+    bool operator==(
+      const basic_iterator<OtherIt, OtherSparseIt, OtherElement>& other) const
+    {
+      return _it == other._it && _sparse == other._sparse;
+    }
+
+    template<typename OtherIt, typename OtherSparseIt, typename OtherElement>
+    bool operator!=(
+      const basic_iterator<OtherIt, OtherSparseIt, OtherElement>& other) const
+    {
+      return !(*this == other);
+    }
+
+  private:
+    template<typename, typename, typename> friend class basic_iterator;
+    friend class ParticipantTable;
+
+    basic_iterator(SlotIt it, SlotIt end, SparseIt sparse)
+    : _it(it),
+      _end(end),
+      _sparse(sparse)
+    {
+      skip_empty();
+    }
+
+    void skip_empty()
+    {
+      while (_it != _end && !*_it)
+        ++_it;
+    }
+
+    SlotIt _it;
+    SlotIt _end;
+
+    // Only used once _it has reached _end
+    SparseIt _sparse;
+  };
+
+  using iterator = basic_iterator<
+    typename Slots::iterator, typename Sparse::iterator, value_type>;
+  using const_iterator = basic_iterator<
+    typename Slots::const_iterator, typename Sparse::const_iterator,
+    const value_type>;
+
+  ParticipantTable() = default;
+  ParticipantTable(ParticipantTable&&) = default;
+  ParticipantTable& operator=(ParticipantTable&&) = default;
+
+  ParticipantTable(const ParticipantTable& other)
+  {
+    *this = other;
+  }
+
+  ParticipantTable& operator=(const ParticipantTable& other)
+  {
+    if (this == &other)
+      return *this;
+
+    Slots slots;
+    slots.reserve(other._slots.size());
+    for (const auto& slot : other._slots)
+    {
+      slots.push_back(
+        slot ? std::make_unique<value_type>(*slot) : nullptr);
+    }
+
+    Sparse sparse;
+    for (const auto& [id, value] : other._sparse)
+    {
+      sparse.emplace_hint(
+        sparse.end(), id, std::make_unique<value_type>(*value));
+    }
+
+    _slots = std::move(slots);
+    _sparse = std::move(sparse);
+    _size = other._size;
+    return *this;
+  }
+
+  iterator begin()
+  {
+    return iterator(_slots.begin(), _slots.end(), _sparse.begin());
+  }
+
+  const_iterator begin() const
+  {
+    return const_iterator(_slots.begin(), _slots.end(), _sparse.begin());
+  }
+
+  iterator end()
+  {
+    return iterator(_slots.end(), _slots.end(), _sparse.end());
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(_slots.end(), _slots.end(), _sparse.end());
+  }
+
+  iterator find(const ParticipantId id)
+  {
+    if (id < _slots.size())
+    {
+      if (!_slots[id])
+        return end();
+
+      return iterator(_slots.begin() + id, _slots.end(), _sparse.begin());
+    }
+
+    return iterator(_slots.end(), _slots.end(), _sparse.find(id));
+  }
+
+  const_iterator find(const ParticipantId id) const
+  {
+    if (id < _slots.size())
+    {
+      if (!_slots[id])
+        return end();
+
+      return const_iterator(
+        _slots.begin() + id, _slots.end(), _sparse.begin());
+    }
+
+    return const_iterator(_slots.end(), _slots.end(), _sparse.find(id));
+  }
+
+  std::size_t count(const ParticipantId id) const
+  {
+    return find(id) == end() ? 0 : 1;
+  }
+
+  Value& at(const ParticipantId id)
+  {
+    return const_cast<Value&>(std::as_const(*this).at(id));
+  }
+
+  const Value& at(const ParticipantId id) const
+  {
+    const auto it = find(id);
+    if (it == end())
+    {
+      // *INDENT-OFF*
+      throw std::out_of_range(
+        "[rmf_traffic::schedule::ParticipantTable::at] No participant with "
+        "ID [" + std::to_string(id) + "]");
+      // *INDENT-ON*
+    }
+
+    return it->second;
+  }
+
+  /// Get the value of a participant, inserting a default value if the
+  /// participant is not in the table yet
+  Value& operator[](const ParticipantId id)
+  {
+    return try_emplace(id).first->second;
+  }
+
+  /// Insert a value for a participant unless it already has one. This returns
+  /// an iterator to the value of the participant, and true if it was inserted.
+  template<typename... Args>
+  std::pair<iterator, bool> try_emplace(const ParticipantId id, Args&&... args)
+  {
+    const auto make = [&]()
+      {
+        ++_size;
+        return std::make_unique<value_type>(
+          std::piecewise_construct,
+          std::forward_as_tuple(id),
+          std::forward_as_tuple(std::forward<Args>(args)...));
+      };
+
+    if (id >= _slots.size() && id - _slots.size() >= MaxDenseGap)
+    {
+      auto s_it = _sparse.lower_bound(id);
+      const bool inserted = s_it == _sparse.end() || s_it->first != id;
+      if (inserted)
+        s_it = _sparse.emplace_hint(s_it, id, make());
+
+      return {iterator(_slots.end(), _slots.end(), s_it), inserted};
+    }
+
+    if (id >= _slots.size())
+      grow(id + 1);
+
+    auto& slot = _slots[id];
+    const bool inserted = !slot;
+    if (inserted)
+      slot = make();
+
+    return {
+      iterator(_slots.begin() + id, _slots.end(), _sparse.begin()),
+      inserted
+    };
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value)
+  {
+    return try_emplace(value.first, std::move(value.second));
+  }
+
+  iterator erase(const_iterator it)
+  {
+    --_size;
+    if (it._it == it._end)
+      return iterator(_slots.end(), _slots.end(), _sparse.erase(it._sparse));
+
+    const std::size_t index = it._it - _slots.cbegin();
+    _slots[index].reset();
+
+    const auto next = index + 1;
+    trim();
+    if (next >= _slots.size())
+      return iterator(_slots.end(), _slots.end(), _sparse.begin());
+
+    return iterator(_slots.begin() + next, _slots.end(), _sparse.begin());
+  }
+
+  std::size_t erase(const ParticipantId id)
+  {
+    const auto it = find(id);
+    if (it == end())
+      return 0;
+
+    erase(it);
+    return 1;
+  }
+
+  std::size_t size() const
+  {
+    return _size;
+  }
+
+  bool empty() const
+  {
+    return _size == 0;
+  }
+
+  void clear()
+  {
+    _slots.clear();
+    _sparse.clear();
+    _size = 0;
+  }
+
+private:
+
+  /// Grow the slots and move any participants of the sparse map that the
+  /// slots now reach into them
+  void grow(const std::size_t slot_count)
+  {
+    _slots.resize(slot_count);
+    while (!_sparse.empty() && _sparse.begin()->first < slot_count)
+    {
+      const auto s_it = _sparse.begin();
+      _slots[s_it->first] = std::move(s_it->second);
+      _sparse.erase(s_it);
+    }
+  }
+
+  /// Drop the empty slots at the back, so iterating and copying the table
+  /// does not get slower once the participants with the highest IDs are
+  /// gone.
+  void trim()
+  {
+    while (!_slots.empty() && !_slots.back())
+      _slots.pop_back();
+  }
+
+  Slots _slots;
+  Sparse _sparse;
+  std::size_t _size = 0;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_PARTICIPANTTABLE_HPP
@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_PATCHCODEC_HPP
+#define SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_PATCHCODEC_HPP
+
+#include <rmf_traffic/schedule/PatchCodec.hpp>
+#include <rmf_traffic/geometry/ConvexShape.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// The layout of the binary format, version 1. All integers are unsigned
+/// LEB128 varints unless noted otherwise, and signed integers are zigzag
+/// encoded first.
+///
+/// Header:
+///   "RMFP", format version (byte), flags (byte)
+///   [quantization: translation, rotation (little-endian doubles)]
+///   [base version], latest version, [cull time (signed nanoseconds)]
+///   map count, then each map name as a length followed by its bytes
+///   participant count
+///
+/// Each participant:
+///   id, itinerary version
+///   erasure count, then each storage ID
+///   delay count, then each delay (signed nanoseconds)
+///   plan ID, route count, then each route
+///   progress flag (byte), [progress version, checkpoint count, checkpoints]
+///
+/// Each route:
+///   route ID, storage ID, index of the map name
+///   checkpoint count, then each checkpoint as a delta from the previous one
+///   dependency count, then for each participant that is depended on:
+///     participant ID, plan flag (byte), [plan ID], route count, then for each
+///     route: route ID, count, then pairs of dependent and depended checkpoints
+///   waypoint count, then each waypoint:
+///     time (signed nanoseconds relative to the previous waypoint that was
+///     encoded, across the whole patch)
+///     position and velocity, either as little-endian doubles, or quantized
+///     signed integers where positions are deltas from the previous waypoint
+///     of the same route
+namespace codec {
+
+constexpr uint8_t Magic[4] = {'R', 'M', 'F', 'P'};
+
+constexpr uint8_t HasBaseVersion = 1 << 0;
+constexpr uint8_t HasCull = 1 << 1;
+constexpr uint8_t Quantized = 1 << 2;
+
+//==============================================================================
+inline int64_t to_nanoseconds(const Duration duration)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    duration).count();
+}
+
+//==============================================================================
+inline Duration from_nanoseconds(const int64_t ns)
+{
+  return std::chrono::duration_cast<Duration>(std::chrono::nanoseconds(ns));
+}
+
+//==============================================================================
+class Writer
+{
+public:
+
+  std::vector<uint8_t> data;
+
+  void byte(const uint8_t value)
+  {
+    data.push_back(value);
+  }
+
+  void varint(uint64_t value)
+  {
+    while (value >= 0x80)
+    {
+      data.push_back(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+  }
+
+  void zigzag(const int64_t value)
+  {
+    varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(
+        value >> 63));
+  }
+
+  void f64(const double value)
+  {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (std::size_t i = 0; i < 8; ++i)
+      data.push_back(static_cast<uint8_t>(bits >> (8*i)));
+  }
+
+  void string(const std::string& value)
+  {
+    varint(value.size());
+    data.insert(data.end(), value.begin(), value.end());
+  }
+};
+
+//==============================================================================
+/// Reads the binary format, throwing std::runtime_error if the data ends early
+class Reader
+{
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] begin
+  ///   The start of the data
+  ///
+  /// \param[in] end
+  ///   The end of the data
+  ///
+  /// \param[in] context
+  ///   The tag that error messages will start with
+  Reader(const uint8_t* begin, const uint8_t* end, std::string context)
+  : _it(begin),
+    _end(end),
+    _context(std::move(context))
+  {
+    // Do nothing
+  }
+
+  uint8_t byte()
+  {
+    require(1);
+    return *_it++;
+  }
+
+  uint64_t varint()
+  {
+    uint64_t value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+      const uint8_t b = byte();
+      value |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if ((b & 0x80) == 0)
+        return value;
+    }
+
+    fail("varint is too long");
+  }
+
+  int64_t zigzag()
+  {
+    const uint64_t value = varint();
+    return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+  }
+
+  double f64()
+  {
+    require(8);
+    uint64_t bits = 0;
+    for (std::size_t i = 0; i < 8; ++i)
+      bits |= static_cast<uint64_t>(*_it++) << (8*i);
+
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  std::string_view string()
+  {
+    const uint64_t size = varint();
+    require(size);
+    const std::string_view value(reinterpret_cast<const char*>(_it), size);
+    _it += size;
+    return value;
+  }
+
+  /// Read a count of elements that each take at least one byte
+  std::size_t count()
+  {
+    const uint64_t value = varint();
+    require(value);
+    return static_cast<std::size_t>(value);
+  }
+
+  const uint8_t* position() const
+  {
+    return _it;
+  }
+
+  bool done() const
+  {
+    return _it == _end;
+  }
+
+  [[noreturn]] void fail(const std::string& reason) const
+  {
+    throw std::runtime_error(_context + " Invalid data: " + reason);
+  }
+
+private:
+
+  void require(const uint64_t size) const
+  {
+    if (static_cast<uint64_t>(_end - _it) < size)
+      fail("the data ended early");
+  }
+
+  const uint8_t* _it;
+  const uint8_t* _end;
+  std::string _context;
+};
+
+//==============================================================================
+/// Write a route, except for its map, which the caller is responsible for.
+/// The time of the last waypoint written will be saved in last_time.
+void write_route(
+  Writer& writer,
+  const Route& route,
+  const std::optional<PatchEncoder::Quantization>& quantization,
+  Time& last_time);
+
+//==============================================================================
+/// Read a route that was written by write_route(). If build is false, the data
+/// will only be validated and skipped, and a nullptr will be returned.
+std::shared_ptr<Route> read_route(
+  Reader& reader,
+  std::string map,
+  const std::optional<PatchEncoder::Quantization>& quantization,
+  Time& last_time,
+  bool build);
+
+//==============================================================================
+/// Write a shape, which may be a nullptr. Only circles and boxes can be
+/// written, and std::runtime_error will be thrown for any other shape.
+void write_shape(Writer& writer, const geometry::FinalShape* shape);
+
+//==============================================================================
+/// Read a shape that was written by write_shape()
+geometry::ConstFinalConvexShapePtr read_shape(Reader& reader);
+
+//==============================================================================
+/// The changes to one participant, decoded from the binary format. One
+/// instance is reused for every participant of a patch so that its buffers
+/// only need to be allocated once.
+struct ParticipantChanges
+{
+  ParticipantId id;
+  ItineraryVersion itinerary_version;
+  std::vector<StorageId> erasures;
+  std::vector<Duration> delays;
+  PlanId plan_id;
+  std::vector<Change::Add::Item> additions;
+  std::optional<Change::Progress> progress;
+};
+
+} // namespace codec
+
+//==============================================================================
+class PatchView::Implementation
+{
+public:
+
+  const uint8_t* end;
+  std::optional<PatchEncoder::Quantization> quantization;
+  std::optional<Version> base_version;
+  Version latest_version;
+  std::optional<Time> cull;
+  std::vector<std::string_view> maps;
+  std::size_t participant_count;
+  const uint8_t* participants;
+
+  /// Parse the header and validate everything that follows it
+  Implementation(const uint8_t* data, std::size_t size);
+
+  /// Read the changes for the next participant. If output is a nullptr, the
+  /// changes will be validated and skipped.
+  void read_participant(
+    codec::Reader& reader,
+    Time& last_time,
+    codec::ParticipantChanges* output) const;
+
+  /// Decode each participant in order and pass its changes to the visitor.
+  /// The routes in the changes are newly created, so the visitor may take
+  /// ownership of them.
+  template<typename Visitor>
+  void for_each_participant(Visitor&& visitor) const
+  {
+    codec::Reader reader(
+      participants, end, "[rmf_traffic::schedule::PatchView]");
+    Time last_time = Time(Duration(0));
+    codec::ParticipantChanges changes;
+    for (std::size_t i = 0; i < participant_count; ++i)
+    {
+      read_participant(reader, last_time, &changes);
+      visitor(changes);
+    }
+  }
+
+  static const Implementation& get(const PatchView& view)
+  {
+    return *view._pimpl;
+  }
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_PATCHCODEC_HPP
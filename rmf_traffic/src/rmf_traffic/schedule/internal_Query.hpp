@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_QUERY_HPP
+#define SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_QUERY_HPP
+
+#include <rmf_traffic/schedule/Query.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+namespace rmf_traffic {
+
+namespace internal {
+struct SegmentCache;
+} // namespace internal
+
+namespace schedule {
+
+//==============================================================================
+/// A set of participant IDs that is compiled for fast lookups. Participant IDs
+/// are usually small and dense, so when the IDs fit, the set is stored as a
+/// bitmap. Otherwise it falls back to a hash set.
+class ParticipantIdSet
+{
+public:
+
+  /// The bitmap is used when the largest ID is below this number, or when it
+  /// is small enough compared to the number of IDs.
+  static constexpr ParticipantId DenseLimit = 4096;
+
+  ParticipantIdSet(const std::vector<ParticipantId>& ids)
+  {
+    ParticipantId max_id = 0;
+    for (const auto id : ids)
+      max_id = std::max(max_id, id);
+
+    if (ids.empty() || max_id < DenseLimit || max_id / 64 <= ids.size())
+    {
+      _bits.resize(ids.empty() ? 0 : max_id/64 + 1, 0);
+      for (const auto id : ids)
+        _bits[id/64] |= uint64_t(1) << (id%64);
+    }
+    else
+    {
+      _sparse = std::make_unique<std::unordered_set<ParticipantId>>(
+        ids.begin(), ids.end());
+    }
+  }
+
+  bool contains(const ParticipantId id) const
+  {
+    if (_sparse)
+      return _sparse->count(id) > 0;
+
+    const auto word = id/64;
+    return word < _bits.size() && (_bits[word] >> (id%64)) & 1;
+  }
+
+  /// True if the set is stored as a bitmap
+  bool dense() const
+  {
+    return _sparse == nullptr;
+  }
+
+private:
+  std::vector<uint64_t> _bits;
+  std::unique_ptr<std::unordered_set<ParticipantId>> _sparse;
+};
+
+using ConstParticipantIdSetPtr = std::shared_ptr<const ParticipantIdSet>;
+
+//==============================================================================
+/// Get the compiled set of IDs for an Include filter. The set is compiled the
+/// first time that it is needed and then cached in the filter until its IDs
+/// are changed, so repeated queries with the same Query object do not need to
+/// compile it again.
+ConstParticipantIdSetPtr get_id_set(
+  const Query::Participants::Include& include);
+
+//==============================================================================
+/// Get the compiled set of IDs for an Exclude filter. This is cached the same
+/// way as the Include set.
+ConstParticipantIdSetPtr get_id_set(
+  const Query::Participants::Exclude& exclude);
+
+//==============================================================================
+/// Mix the hash of one more value into a hash
+void hash_combine(std::size_t& seed, std::size_t value);
+
+//==============================================================================
+/// Hash the spacetime of a query. Spacetimes that compare equal have the same
+/// hash.
+std::size_t hash_spacetime(const Query::Spacetime& spacetime);
+
+//==============================================================================
+/// Hash the participants filter of a query. Filters that compare equal have
+/// the same hash.
+std::size_t hash_participants(const Query::Participants& participants);
+
+//==============================================================================
+/// True if both corridors have the same map, trajectory, and radius
+bool operator==(
+  const Query::Spacetime::Corridor& lhs,
+  const Query::Spacetime::Corridor& rhs);
+
+//==============================================================================
+/// Decides which routes are relevant to a Corridor query. The segments of the
+/// corridor are prepared once, so checking each route only needs a sweep over
+/// the bounding boxes of its segments and the segments of the corridor that
+/// overlap them in time.
+class CorridorFilter
+{
+public:
+
+  CorridorFilter(const Query::Spacetime::Corridor& corridor);
+
+  /// The map of the corridor
+  const std::string& map() const;
+
+  /// The earliest time that the corridor is active, or a nullptr if the
+  /// corridor is empty
+  const Time* lower_time_bound() const;
+
+  /// The latest time that the corridor is active, or a nullptr if the
+  /// corridor is empty
+  const Time* upper_time_bound() const;
+
+  /// True if a participant with this profile that follows this trajectory
+  /// might come within the corridor while the corridor is active
+  bool relevant(const Profile& profile, const Trajectory& trajectory) const;
+
+private:
+  const std::string* _map;
+  std::shared_ptr<const internal::SegmentCache> _segments;
+  double _radius;
+  std::optional<Time> _lower_time_bound;
+  std::optional<Time> _upper_time_bound;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_QUERY_HPP
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_QUERYCACHE_HPP
+#define SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_QUERYCACHE_HPP
+
+#include <rmf_traffic/schedule/Viewer.hpp>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <optional>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// Remembers the views that were produced by recent queries of a schedule so
+/// that repeated queries do not need to inspect the timeline again.
+///
+/// Every cached view belongs to the version of the schedule that it was made
+/// for, and the whole cache is dropped as soon as a query arrives for a
+/// different version. A query is answered from the cache if a cached query is
+/// identical to it, or if a cached query provably covers it: a timespan query
+/// can be answered by filtering the view of a query for all of spacetime, or
+/// of a timespan query whose maps and time range enclose it, as long as the
+/// cached query did not leave out any participants that this query needs.
+///
+/// The cache is safe to use from several threads that are reading the same
+/// schedule at once.
+class QueryCache
+{
+public:
+
+  QueryCache() = default;
+
+  /// Copies of a schedule begin with an empty cache of the same capacity
+  QueryCache(const QueryCache& other)
+  : _capacity(other.get_capacity())
+  {
+    // Do nothing
+  }
+
+  QueryCache& operator=(const QueryCache& other)
+  {
+    set_capacity(other.get_capacity());
+    clear();
+    return *this;
+  }
+
+  /// Set how many views are kept. The least recently used view is dropped
+  /// when a new view does not fit. A capacity of 0 turns the cache off.
+  void set_capacity(std::size_t capacity);
+
+  /// Get how many views are kept.
+  std::size_t get_capacity() const;
+
+  /// Drop every view in the cache. This must be called when a change to the
+  /// schedule could alter the results of queries without changing its version.
+  void clear();
+
+  /// Get the view for a query, either from the cache or by calling inspect,
+  /// which should return a Viewer::View for the query.
+  template<typename Inspect>
+  Viewer::View query(
+    const Query::Spacetime& spacetime,
+    const Query::Participants& participants,
+    const Version version,
+    const Inspect& inspect)
+  {
+    if (_capacity.load(std::memory_order_relaxed) == 0)
+      return inspect();
+
+    if (auto view = find(spacetime, participants, version))
+      return std::move(*view);
+
+    auto view = inspect();
+    insert(spacetime, participants, version, view);
+    return view;
+  }
+
+private:
+
+  std::optional<Viewer::View> find(
+    const Query::Spacetime& spacetime,
+    const Query::Participants& participants,
+    Version version);
+
+  void insert(
+    const Query::Spacetime& spacetime,
+    const Query::Participants& participants,
+    Version version,
+    const Viewer::View& view);
+
+  struct Entry
+  {
+    Query::Spacetime spacetime;
+    Query::Participants participants;
+    std::shared_ptr<const Viewer::View> view;
+  };
+
+  mutable std::mutex _mutex;
+  std::atomic_size_t _capacity = 0;
+  std::optional<Version> _version;
+
+  // The most recently used entry is at the front
+  std::list<Entry> _entries;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_QUERYCACHE_HPP
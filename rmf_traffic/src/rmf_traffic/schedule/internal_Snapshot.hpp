@@ -22,6 +22,7 @@
 
 #include "Timeline.hpp"
 #include "ViewerInternal.hpp"
+#include "internal_QueryCache.hpp"
 
 namespace rmf_traffic {
 namespace schedule {
@@ -47,9 +48,17 @@ public:
     const Query::Spacetime& spacetime,
     const Query::Participants& participants) const final
   {
-    QueryInspector inspector;
-    _timeline->inspect(spacetime, participants, inspector);
-    return Viewer::View::Implementation::make_view(std::move(inspector.routes));
+    // A snapshot never changes, so its cached results never need to be
+    // invalidated.
+    return _query_cache.query(
+      spacetime, participants, 0, [&]()
+      {
+        // The view pins the timeline of the snapshot, which keeps every
+        // description alive, so the inspector does not need to pin them.
+        QueryInspector inspector(false);
+        _timeline->inspect(spacetime, participants, inspector);
+        return std::move(inspector.routes).build(_timeline);
+      });
   }
 
   const std::unordered_set<ParticipantId>& participant_ids() const final
@@ -70,12 +79,13 @@ public:
   SnapshotImplementation(
     std::shared_ptr<const TimelineView<const BaseRouteEntry>> timeline,
     std::unordered_set<ParticipantId> ids,
-    ParticipantMap participants)
+    ParticipantMap participants,
+    std::size_t query_cache_capacity = 0)
   : _timeline(std::move(timeline)),
     _ids(std::move(ids)),
     _participants(std::move(participants))
   {
-    // Do nothing
+    _query_cache.set_capacity(query_cache_capacity);
   }
 
 private:
@@ -83,6 +93,7 @@ private:
   std::shared_ptr<const TimelineView<const RouteEntry>> _timeline;
   std::unordered_set<ParticipantId> _ids;
   ParticipantMap _participants;
+  mutable QueryCache _query_cache;
 
 };
 
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_WORKERPOOL_HPP
+#define SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_WORKERPOOL_HPP
+
+#include <rmf_traffic/Executor.hpp>
+
+#include <functional>
+#include <memory>
+
+namespace rmf_traffic {
+namespace schedule {
+
+//==============================================================================
+/// A fixed number of threads that split up the tasks of a job between them.
+/// The thread that runs a job works on its tasks too, so a pool of size N
+/// needs N-1 other threads. Several threads may run jobs at the same time.
+class WorkerPool
+{
+public:
+
+  /// Constructor for a pool with threads of its own
+  ///
+  /// \param[in] size
+  ///   The number of threads that will work on each job, including the thread
+  ///   that runs it.
+  WorkerPool(std::size_t size);
+
+  /// Constructor for a pool that borrows the threads of an executor
+  ///
+  /// \param[in] executor
+  ///   The executor whose threads will help with each job. If this is a
+  ///   nullptr, the pool will have threads of its own.
+  ///
+  /// \param[in] size
+  ///   The number of threads that will work on each job, including the thread
+  ///   that runs it.
+  WorkerPool(std::shared_ptr<Executor> executor, std::size_t size);
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /// The number of threads that will work on each job
+  std::size_t size() const;
+
+  /// The executor whose threads help with the jobs, or a nullptr if the jobs
+  /// only run on the calling thread
+  const std::shared_ptr<Executor>& executor() const;
+
+  /// Call task for each index in [0, count) and wait until every call has
+  /// finished. The calls may happen in any order and on any thread of the
+  /// pool. If any of the calls throws an exception, the first exception will
+  /// be rethrown here after the rest of the calls have finished.
+  void run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+private:
+  std::shared_ptr<Executor> _executor;
+  std::size_t _size;
+};
+
+} // namespace schedule
+} // namespace rmf_traffic
+
+#endif // SRC__RMF_TRAFFIC__SCHEDULE__INTERNAL_WORKERPOOL_HPP
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "utils_ConflictCorpus.hpp"
+
+#include <rmf_traffic/DetectConflict.hpp>
+#include <rmf_traffic/geometry/Box.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+// Every way of checking a pair of trajectories for conflicts must agree with
+// DetectConflict::between(). Optimizations to the narrowphase should keep this
+// test passing without any changes to it.
+
+//==============================================================================
+SCENARIO("Conflict detection paths agree on the regression corpus")
+{
+  using rmf_traffic::DetectConflict;
+  using rmf_traffic::geometry::make_final_convex;
+
+  const auto corpus = make_conflict_corpus(200);
+
+  const std::vector<std::pair<std::string, rmf_traffic::Profile>> profiles = {
+    {
+      "circle",
+      rmf_traffic::Profile{
+        make_final_convex<rmf_traffic::geometry::Circle>(0.5),
+        make_final_convex<rmf_traffic::geometry::Circle>(0.6)
+      }
+    },
+    {
+      "box",
+      rmf_traffic::Profile{
+        make_final_convex<rmf_traffic::geometry::Box>(1.0, 1.0),
+        make_final_convex<rmf_traffic::geometry::Box>(1.2, 1.2)
+      }
+    }
+  };
+
+  for (const auto& [shape, profile] : profiles)
+  {
+    std::vector<std::optional<DetectConflict::Conflict>> expected;
+    std::vector<DetectConflict::Pair> pairs;
+    std::size_t conflicts = 0;
+    for (std::size_t i = 0; i < corpus.size(); ++i)
+    {
+      const auto& entry = corpus[i];
+      CAPTURE(shape, i, entry.kind);
+
+      const auto conflict = DetectConflict::between(
+        profile, entry.a, nullptr, profile, entry.b, nullptr);
+      expected.push_back(conflict);
+      pairs.push_back({&profile, &entry.a, nullptr, &profile, &entry.b});
+      if (conflict)
+        ++conflicts;
+
+      // The same check must always give the same answer
+      const auto repeat = DetectConflict::between(
+        profile, entry.a, nullptr, profile, entry.b, nullptr);
+      REQUIRE(repeat.has_value() == conflict.has_value());
+      if (conflict)
+        CHECK(repeat->time == conflict->time);
+
+      // A copy that is built from scratch has none of the cached segments of
+      // the original, so this checks the caches against fresh computations.
+      rmf_traffic::Trajectory fresh_b;
+      for (const auto& wp : entry.b)
+        fresh_b.insert(wp.time(), wp.position(), wp.velocity());
+
+      const auto fresh = DetectConflict::between(
+        profile, entry.a, nullptr, profile, fresh_b, nullptr);
+      REQUIRE(fresh.has_value() == conflict.has_value());
+      if (conflict)
+        CHECK(fresh->time == conflict->time);
+
+      // Collecting every conflict finds one exactly when there is a first one
+      const auto all = DetectConflict::all_between(
+        profile, entry.a, nullptr, profile, entry.b, nullptr);
+      CHECK(all.empty() == !conflict.has_value());
+
+      // Stopping early may report an earlier time, but never a later one
+      DetectConflict::Options early;
+      early.exact_time = false;
+      const auto inexact = DetectConflict::between(
+        profile, entry.a, nullptr, profile, entry.b, nullptr, early);
+      REQUIRE(inexact.has_value() == conflict.has_value());
+      if (conflict)
+        CHECK(inexact->time <= conflict->time);
+    }
+
+    // The corpus should exercise both outcomes
+    CHECK(conflicts > corpus.size() / 10);
+    CHECK(conflicts < corpus.size() - corpus.size() / 10);
+
+    for (const std::size_t threads : {1, 4})
+    {
+      CAPTURE(shape, threads);
+      const DetectConflict::BatchOptions options(true, threads, 1);
+      const auto batch = DetectConflict::between_pairs(pairs, options);
+
+      std::size_t k = 0;
+      for (std::size_t i = 0; i < expected.size(); ++i)
+      {
+        if (!expected[i])
+          continue;
+
+        REQUIRE(k < batch.size());
+        CHECK(batch[k].index == i);
+        CHECK(batch[k].conflict.time == expected[i]->time);
+        CHECK(batch[k].conflict.a_it == expected[i]->a_it);
+        CHECK(batch[k].conflict.b_it == expected[i]->b_it);
+        ++k;
+      }
+      CHECK(k == batch.size());
+
+      // Checking each trajectory against its partner as a single candidate
+      // goes through the many-candidate path
+      for (std::size_t i = 0; i < corpus.size(); i += 7)
+      {
+        const auto many = DetectConflict::between_many(
+          profile, corpus[i].a, {{&profile, &corpus[i].b}}, options);
+        REQUIRE(many.empty() == !expected[i].has_value());
+        if (expected[i])
+          CHECK(many.front().conflict.time == expected[i]->time);
+      }
+    }
+  }
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef RMF_TRAFFIC__TEST__REGRESSION__UTILS_CONFLICTCORPUS_HPP
+#define RMF_TRAFFIC__TEST__REGRESSION__UTILS_CONFLICTCORPUS_HPP
+
+#include <rmf_traffic/Trajectory.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+//==============================================================================
+/// A pair of trajectories in the conflict regression corpus
+struct ConflictCorpusEntry
+{
+  /// The kind of traffic situation that the pair describes
+  std::string kind;
+
+  rmf_traffic::Trajectory a;
+  rmf_traffic::Trajectory b;
+};
+
+//==============================================================================
+/// Generates the same traffic situations on every platform. The standard
+/// random distributions are implementation-defined, so only the raw output of
+/// the engine, which the standard fully specifies, is used. Each value must be
+/// drawn in its own statement, because the order that function arguments are
+/// evaluated in is unspecified.
+class ConflictCorpusGenerator
+{
+public:
+
+  ConflictCorpusGenerator(std::uint32_t seed)
+  : _engine(seed)
+  {
+    // Do nothing
+  }
+
+  /// A value in the range [low, high)
+  double uniform(const double low, const double high)
+  {
+    const double unit = static_cast<double>(_engine()) / 4294967296.0;
+    return low + unit * (high - low);
+  }
+
+  /// A value in the range [0, n)
+  std::size_t index(const std::size_t n)
+  {
+    return static_cast<std::size_t>(_engine() % n);
+  }
+
+private:
+  std::mt19937 _engine;
+};
+
+//==============================================================================
+/// Append a straight drive to the trajectory. The agent starts and stops at
+/// rest, and drives at a constant velocity through the waypoints in between.
+inline void add_drive(
+  rmf_traffic::Trajectory& trajectory,
+  const Eigen::Vector2d& from,
+  const Eigen::Vector2d& to,
+  const rmf_traffic::Time start,
+  const double duration,
+  const std::size_t segments)
+{
+  const Eigen::Vector2d v = (to - from) / duration;
+  const double yaw = std::atan2(v.y(), v.x());
+  for (std::size_t i = 0; i <= segments; ++i)
+  {
+    const double s = static_cast<double>(i) / static_cast<double>(segments);
+    const auto t = start + rmf_traffic::time::from_seconds(s * duration);
+
+    // The drive may continue from where the trajectory already ends
+    if (i == 0 && trajectory.size() > 0 && trajectory.back().time() == t)
+      continue;
+
+    const Eigen::Vector2d p = from + s * (to - from);
+    const bool at_rest = i == 0 || i == segments;
+    trajectory.insert(
+      t, {p.x(), p.y(), yaw},
+      at_rest ? Eigen::Vector3d::Zero() : Eigen::Vector3d{v.x(), v.y(), 0.0});
+  }
+}
+
+//==============================================================================
+/// Append a hold at the last position of the trajectory
+inline void add_hold(
+  rmf_traffic::Trajectory& trajectory,
+  const double duration)
+{
+  const auto& last = trajectory.back();
+  trajectory.insert(
+    last.time() + rmf_traffic::time::from_seconds(duration),
+    last.position(), Eigen::Vector3d::Zero());
+}
+
+//==============================================================================
+/// Make a corpus of trajectory pairs that resemble the traffic of a schedule:
+/// crossings at intersections, head-on meetings in corridors, agents that
+/// follow each other, agents that pass by a parked agent, and long patrols.
+/// Roughly half of the pairs are in conflict. The corpus only depends on the
+/// count and the seed.
+inline std::vector<ConflictCorpusEntry> make_conflict_corpus(
+  const std::size_t count,
+  const std::uint32_t seed = 2022)
+{
+  ConflictCorpusGenerator gen(seed);
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+  const auto at = [&](const double seconds)
+    {
+      return t0 + rmf_traffic::time::from_seconds(seconds);
+    };
+
+  const auto direction = [&]()
+    {
+      const double theta = gen.uniform(-M_PI, M_PI);
+      return Eigen::Vector2d(std::cos(theta), std::sin(theta));
+    };
+
+  std::vector<ConflictCorpusEntry> corpus;
+  corpus.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    ConflictCorpusEntry entry;
+    const double center_x = gen.uniform(-50, 50);
+    const double center_y = gen.uniform(-50, 50);
+    const Eigen::Vector2d center(center_x, center_y);
+    const double length = gen.uniform(5.0, 20.0);
+    const double duration = gen.uniform(5.0, 20.0);
+    const std::size_t segments = 1 + gen.index(6);
+
+    // Parameters for the second agent
+    const double delay = gen.uniform(-3.0, 3.0);
+    const double offset_distance = gen.uniform(0.0, 2.0);
+    const double speed_factor = gen.uniform(0.5, 1.2);
+    const std::size_t other_segments = 1 + gen.index(6);
+
+    switch (gen.index(5))
+    {
+      case 0:
+      {
+        // Two agents pass through the same intersection
+        entry.kind = "crossing";
+        const Eigen::Vector2d u = direction();
+        const Eigen::Vector2d w = direction();
+        add_drive(
+          entry.a, center - length*u, center + length*u,
+          at(0.0), duration, segments);
+        add_drive(
+          entry.b, center - length*w, center + length*w,
+          at(delay), duration * speed_factor, other_segments);
+        break;
+      }
+      case 1:
+      {
+        // Two agents meet in a corridor, possibly in neighboring lanes
+        entry.kind = "head_on";
+        const Eigen::Vector2d u = direction();
+        const Eigen::Vector2d n(-u.y(), u.x());
+        const Eigen::Vector2d offset = offset_distance * n;
+        add_drive(
+          entry.a, center - length*u, center + length*u,
+          at(0.0), duration, segments);
+        add_drive(
+          entry.b, center + length*u + offset, center - length*u + offset,
+          at(delay), duration, other_segments);
+        break;
+      }
+      case 2:
+      {
+        // One agent follows another down the same lane, and may catch up
+        entry.kind = "following";
+        const Eigen::Vector2d u = direction();
+        add_drive(
+          entry.a, center, center + length*u, at(0.0), duration, segments);
+        add_drive(
+          entry.b, center, center + length*u,
+          at(std::abs(delay) + 0.5), duration * speed_factor, other_segments);
+        break;
+      }
+      case 3:
+      {
+        // One agent parks for a while, and the other drives past it
+        entry.kind = "parked";
+        const Eigen::Vector2d u = direction();
+        const Eigen::Vector2d n(-u.y(), u.x());
+        add_drive(
+          entry.a, center - length*u, center, at(0.0), duration/2, segments);
+        const double hold = gen.uniform(2.0, 10.0);
+        add_hold(entry.a, hold);
+        add_drive(
+          entry.a, center, center + length*u,
+          entry.a.back().time(), duration/2, segments);
+
+        const Eigen::Vector2d offset = offset_distance * n;
+        const double arrival = gen.uniform(0.0, duration);
+        add_drive(
+          entry.b, center + length*u + offset, center - length*u + offset,
+          at(arrival), duration, other_segments);
+        break;
+      }
+      default:
+      {
+        // A long patrol sweeps back and forth while another agent cuts across
+        // the area that it covers
+        entry.kind = "patrol";
+        const std::size_t waypoints = 70 + gen.index(60);
+        const double row = gen.uniform(1.0, 3.0);
+        for (std::size_t k = 0; k < waypoints; ++k)
+        {
+          const double x = (k % 2 == 0) ? 0.0 : length;
+          const double y = row * static_cast<double>(k / 2);
+          entry.a.insert(
+            at(static_cast<double>(k)),
+            {center.x() + x, center.y() + y, 0.0},
+            Eigen::Vector3d::Zero());
+        }
+
+        const double height = row * static_cast<double>(waypoints / 2);
+        const double x = center.x() + gen.uniform(-5.0, length + 5.0);
+        const double start = gen.uniform(0.0, 20.0);
+        const double crossing = gen.uniform(20.0, 100.0);
+        add_drive(
+          entry.b, {x, center.y() - 5.0}, {x, center.y() + height + 5.0},
+          at(start), crossing, other_segments);
+        break;
+      }
+    }
+
+    corpus.emplace_back(std::move(entry));
+  }
+
+  return corpus;
+}
+
+#endif // RMF_TRAFFIC__TEST__REGRESSION__UTILS_CONFLICTCORPUS_HPP
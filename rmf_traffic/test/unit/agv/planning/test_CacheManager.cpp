@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/CacheManager.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <thread>
+
+namespace {
+//==============================================================================
+using TestStorage = std::unordered_map<std::size_t, std::size_t>;
+
+//==============================================================================
+class TestGenerator
+  : public rmf_traffic::agv::planning::Generator<TestStorage>
+{
+public:
+
+  std::size_t generate(
+    const std::size_t& key,
+    const OldItems&,
+    Storage& new_items) const final
+  {
+    ++calls;
+    new_items[key] = 2*key;
+    return 2*key;
+  }
+
+  mutable std::atomic_size_t calls = 0;
+};
+
+//==============================================================================
+class TestFactory
+  : public rmf_traffic::agv::planning::Factory<TestGenerator>
+{
+public:
+
+  ConstGeneratorPtr make(const std::size_t) const final
+  {
+    return std::make_shared<TestGenerator>();
+  }
+};
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Cache manager budget")
+{
+  using namespace rmf_traffic::agv::planning;
+  using Manager = CacheManager<Cache<TestGenerator>>;
+
+  auto generator = std::make_shared<TestGenerator>();
+  const auto manager = Manager::make(generator);
+
+  // Put each key into the group of its tens digit, and count each entry as
+  // one byte to make the budget easy to reason about.
+  manager->set_grouping(
+    [](const std::size_t& key) { return key/10; },
+    [](const std::size_t&, const std::size_t&) -> std::size_t { return 1; });
+
+  const auto cache = manager->get();
+  for (std::size_t key : {0, 1, 2, 10, 11, 20})
+    CHECK(cache.get(key) == 2*key);
+
+  CHECK(cache.get(1) == 2);
+
+  auto stats = manager->statistics();
+  CHECK(stats.entries == 6);
+  CHECK(stats.bytes == 6);
+  CHECK(stats.hits == 1);
+  CHECK(stats.misses == 6);
+  CHECK(stats.evictions == 0);
+
+  WHEN("The least recently used group is evicted")
+  {
+    // Group 1 is used most recently, then group 0, then group 2
+    cache.get(20);
+    cache.get(0);
+    cache.get(10);
+
+    manager->set_budget(3);
+    stats = manager->statistics();
+    CHECK(stats.entries == 2);
+    CHECK(stats.evictions == 2);
+
+    const std::size_t calls = generator->calls;
+    CHECK(cache.get(11) == 22);
+    CHECK(generator->calls == calls);
+
+    CHECK(cache.get(0) == 0);
+    CHECK(generator->calls == calls + 1);
+  }
+
+  WHEN("A new entry pushes the cache over its budget")
+  {
+    manager->set_budget(6);
+    CHECK(manager->statistics().evictions == 0);
+
+    // The group of the new entry is kept even though it was not used before
+    cache.get(30);
+    stats = manager->statistics();
+    CHECK(stats.bytes <= 6);
+    CHECK(stats.evictions == 1);
+
+    const std::size_t calls = generator->calls;
+    cache.get(30);
+    CHECK(generator->calls == calls);
+  }
+
+  WHEN("Items are preloaded")
+  {
+    manager->preload({{1, 100}, {40, 80}});
+
+    // An existing item is kept
+    CHECK(cache.get(1) == 2);
+    CHECK(cache.get(40) == 80);
+    CHECK(manager->statistics().entries == 7);
+  }
+}
+
+//==============================================================================
+SCENARIO("Cache manager map budget")
+{
+  using namespace rmf_traffic::agv::planning;
+  using Map = CacheManagerMap<TestFactory>;
+
+  const Map map(std::make_shared<TestFactory>());
+  for (std::size_t goal = 0; goal < 3; ++goal)
+  {
+    const auto cache = map.get(goal)->get();
+    for (std::size_t key = 0; key < 4; ++key)
+      cache.get(key);
+  }
+
+  auto stats = map.statistics();
+  CHECK(stats.entries == 12);
+  CHECK(stats.misses == 12);
+  CHECK(map.managers().size() == 3);
+
+  const std::size_t goal_bytes = stats.bytes/3;
+  map.set_budget(2*goal_bytes);
+
+  // Requesting goal 0 makes goal 1 the least recently used
+  const auto manager = map.get(0);
+  stats = map.statistics();
+  CHECK(map.managers().size() == 2);
+  CHECK(stats.entries == 8);
+  CHECK(stats.misses == 12);
+  CHECK(stats.evictions == 1);
+
+  // The evicted goal can still be generated again
+  map.get(1)->get().get(0);
+  CHECK(map.statistics().misses == 13);
+
+  // The budget is checked whenever a goal is requested, so now goal 2 is
+  // discarded
+  map.get(1);
+  CHECK(map.managers().size() == 2);
+  CHECK(map.statistics().evictions == 2);
+}
+
+//==============================================================================
+SCENARIO("Concurrent cache access")
+{
+  using namespace rmf_traffic::agv::planning;
+  using Manager = CacheManager<Cache<TestGenerator>>;
+
+  const auto manager = Manager::make(std::make_shared<TestGenerator>());
+  manager->set_grouping([](const std::size_t& key) { return key % 7; });
+
+  const std::size_t N_threads = 8;
+  const std::size_t N_keys = 500;
+  std::vector<std::thread> threads;
+  std::atomic_size_t wrong_values = 0;
+  for (std::size_t t = 0; t < N_threads; ++t)
+  {
+    threads.emplace_back(
+      [&, t]()
+      {
+        const auto cache = manager->get();
+        for (std::size_t i = 0; i < N_keys; ++i)
+        {
+          // Each thread walks through the keys in a different order
+          const std::size_t key = (i*(2*t + 1)) % N_keys;
+          if (cache.get(key) != 2*key)
+            ++wrong_values;
+        }
+      });
+  }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  CHECK(wrong_values == 0);
+
+  const auto stats = manager->statistics();
+  CHECK(stats.entries == N_keys);
+  CHECK(stats.hits + stats.misses == N_threads*N_keys);
+  CHECK(manager->snapshot().size() == N_keys);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/CompressedAdjacency.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+//==============================================================================
+SCENARIO("Compressed adjacency")
+{
+  using Adjacency = rmf_traffic::agv::planning::CompressedAdjacency;
+  using Direction = Adjacency::Direction;
+
+  const std::string test_map = "test_map";
+  rmf_traffic::agv::Graph graph;
+  graph.add_waypoint(test_map, {0.0, 0.0}); // 0
+  graph.add_waypoint(test_map, {10.0, 0.0}); // 1
+  graph.add_waypoint(test_map, {10.0, 10.0}); // 2
+
+  graph.add_lane(0, 1); // 0
+  graph.add_lane(1, 0); // 1
+  graph.add_lane(1, 2); // 2
+  graph.add_lane(0, 2); // 3
+
+  // Lane 2 has a speed limit
+  graph.get_lane(2).properties().speed_limit(0.5);
+
+  const auto& g = rmf_traffic::agv::Graph::Implementation::get(graph);
+  rmf_traffic::agv::LaneClosure closures;
+  const double max_speed = 2.0;
+
+  const Adjacency forward(g, closures, max_speed, Direction::Forward);
+  CHECK(forward.num_waypoints() == 3);
+  CHECK(forward.num_edges() == 4);
+
+  const auto from_0 = forward.edges(0);
+  REQUIRE(from_0.size() == 2);
+  CHECK(from_0.begin()[0].lane == 0);
+  CHECK(from_0.begin()[0].target == 1);
+  CHECK(from_0.begin()[0].cost == Approx(5.0));
+  CHECK(from_0.begin()[1].lane == 3);
+  CHECK(from_0.begin()[1].target == 2);
+  CHECK(from_0.begin()[1].cost == Approx(std::sqrt(200.0)/max_speed));
+
+  const auto from_1 = forward.edges(1);
+  REQUIRE(from_1.size() == 2);
+  CHECK(from_1.begin()[1].target == 2);
+  CHECK(from_1.begin()[1].cost == Approx(20.0));
+
+  CHECK(forward.edges(2).empty());
+
+  const Adjacency reverse(g, closures, max_speed, Direction::Reverse);
+  const auto into_2 = reverse.edges(2);
+  REQUIRE(into_2.size() == 2);
+  CHECK(into_2.begin()[0].target == 1);
+  CHECK(into_2.begin()[0].cost == Approx(20.0));
+  CHECK(into_2.begin()[1].target == 0);
+
+  WHEN("A lane is closed")
+  {
+    closures.close(3);
+    const Adjacency closed(g, closures, max_speed, Direction::Forward);
+    CHECK(closed.num_edges() == 3);
+
+    const auto edges = closed.edges(0);
+    REQUIRE(edges.size() == 1);
+    CHECK(edges.begin()->lane == 0);
+  }
+}
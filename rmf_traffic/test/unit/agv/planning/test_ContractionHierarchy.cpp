@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/ShortestPathHeuristic.hpp>
+
+#include "../../utils_Trajectory.hpp"
+
+#include <rmf_utils/catch.hpp>
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+
+//==============================================================================
+SCENARIO("Contraction hierarchy")
+{
+  using rmf_traffic::agv::planning::ShortestPathHeuristic;
+  using rmf_traffic::agv::planning::Supergraph;
+
+  // A 5x5 grid where the rows are two way and the columns are one way,
+  // alternating between going up and going down, with one long diagonal
+  const std::string test_map = "test_map";
+  rmf_traffic::agv::Graph graph;
+  const std::size_t W = 5;
+  for (std::size_t i = 0; i < W; ++i)
+  {
+    for (std::size_t j = 0; j < W; ++j)
+      graph.add_waypoint(test_map, {10.0*i, 10.0*j});
+  }
+
+  for (std::size_t i = 0; i < W; ++i)
+  {
+    for (std::size_t j = 0; j+1 < W; ++j)
+    {
+      graph.add_lane(W*j + i, W*(j+1) + i);
+      graph.add_lane(W*(j+1) + i, W*j + i);
+
+      if (i % 2 == 0)
+        graph.add_lane(W*i + j, W*i + j + 1);
+      else
+        graph.add_lane(W*i + j + 1, W*i + j);
+    }
+  }
+
+  graph.add_lane(0, W*W - 1);
+
+  const rmf_traffic::agv::VehicleTraits traits(
+    {2.0, 0.3}, {1.0, 0.45}, create_test_profile(UnitCircle));
+
+  const auto make = [&](
+    bool contraction_hierarchy,
+    rmf_traffic::agv::LaneClosure closures)
+    {
+      return Supergraph::make(
+        rmf_traffic::agv::Graph::Implementation::get(graph),
+        traits, std::move(closures), rmf_traffic::agv::Interpolate::Options(),
+        0.1, std::nullopt, false, false, contraction_hierarchy);
+    };
+
+  // The forest of the flat heuristic does not always find the cheapest path,
+  // so the hierarchy is compared against a plain Dijkstra search over the
+  // open lanes instead.
+  const auto dijkstra = [](
+    const rmf_traffic::agv::planning::CompressedAdjacency& lanes_from,
+    const std::size_t N,
+    const std::size_t start)
+    {
+      std::vector<double> costs(N, std::numeric_limits<double>::infinity());
+      using Entry = std::pair<double, std::size_t>;
+      std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+      costs[start] = 0.0;
+      queue.push({0.0, start});
+      while (!queue.empty())
+      {
+        const auto [cost, waypoint] = queue.top();
+        queue.pop();
+        if (costs[waypoint] < cost)
+          continue;
+
+        for (const auto& edge : lanes_from.edges(waypoint))
+        {
+          const double next = cost + edge.cost;
+          if (next < costs[edge.target])
+          {
+            costs[edge.target] = next;
+            queue.push({next, edge.target});
+          }
+        }
+      }
+
+      return costs;
+    };
+
+  const auto compare = [&](const rmf_traffic::agv::LaneClosure& closures)
+    {
+      const auto supergraph = make(true, closures);
+      const ShortestPathHeuristic contracted(supergraph);
+      REQUIRE(contracted.contraction());
+      CHECK_FALSE(ShortestPathHeuristic(make(false, closures)).contraction());
+
+      const auto& lanes_from = supergraph->lanes_from();
+      const std::size_t N = graph.num_waypoints();
+      for (std::size_t start = 0; start < N; ++start)
+      {
+        const auto expected = dijkstra(lanes_from, N, start);
+        for (std::size_t finish = 0; finish < N; ++finish)
+        {
+          const auto solution = contracted.get(start, finish);
+          REQUIRE(std::isinf(expected[finish]) == (solution == nullptr));
+          if (!solution)
+            continue;
+
+          CHECK(solution->cost == Approx(expected[finish]));
+
+          // The shortcuts are unpacked into the open lanes of the graph
+          REQUIRE(!solution->path.empty());
+          CHECK(solution->path.front() == start);
+          CHECK(solution->path.back() == finish);
+          double path_cost = 0.0;
+          for (std::size_t i = 0; i+1 < solution->path.size(); ++i)
+          {
+            const auto* lane =
+              graph.lane_from(solution->path[i], solution->path[i+1]);
+            REQUIRE(lane);
+            CHECK_FALSE(closures.is_closed(lane->index()));
+
+            for (const auto& edge : lanes_from.edges(solution->path[i]))
+            {
+              if (edge.target == solution->path[i+1])
+              {
+                path_cost += edge.cost;
+                break;
+              }
+            }
+          }
+
+          CHECK(path_cost == Approx(solution->cost));
+        }
+      }
+    };
+
+  WHEN("Every lane is open")
+  {
+    compare(rmf_traffic::agv::LaneClosure());
+  }
+
+  WHEN("The diagonal and part of a column are closed")
+  {
+    rmf_traffic::agv::LaneClosure closures;
+    closures.close(graph.lane_from(0, W*W - 1)->index());
+    closures.close(graph.lane_from(W*2 + 1, W*2 + 2)->index());
+    closures.close(graph.lane_from(W*2 + 3, W*3 + 3)->index());
+    compare(closures);
+  }
+}
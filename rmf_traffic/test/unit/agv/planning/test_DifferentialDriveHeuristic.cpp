@@ -534,3 +534,92 @@ SCENARIO("Differential Drive Heuristic -- Indeterminate Yaw Edge Case")
     CHECK(solution->info.remaining_cost_estimate == Approx(5.65148));
   }
 }
+
+//==============================================================================
+SCENARIO("Differential drive cost table")
+{
+  using rmf_traffic::agv::planning::DifferentialDriveCostTable;
+  using rmf_traffic::agv::planning::DifferentialDriveMapTypes;
+  using rmf_traffic::agv::planning::Orientation;
+  using rmf_traffic::agv::planning::Side;
+  using Entry = DifferentialDriveMapTypes::Entry;
+  using Key = DifferentialDriveMapTypes::Key;
+  using SolutionNode = DifferentialDriveMapTypes::SolutionNode;
+
+  const auto make_node = [](
+    std::optional<Entry> entry,
+    const double remaining_cost,
+    SolutionNodePtr child) -> SolutionNodePtr
+    {
+      return std::make_shared<SolutionNode>(
+        SolutionNode{
+          DifferentialDriveMapTypes::NodeInfo{
+            entry, 0, {}, Eigen::Vector2d::Zero(), std::nullopt,
+            remaining_cost, 0.0, nullptr
+          },
+          nullptr,
+          std::move(child)
+        });
+    };
+
+  // A solution that goes from lane 0 to lane 2 through lane 1, with an
+  // intermediate node that has no entry
+  const Entry goal{2, Orientation::Forward, Side::Finish};
+  const Entry middle{1, Orientation::Backward, Side::Start};
+  const Entry start{0, Orientation::Any, Side::Finish};
+  const auto goal_node = make_node(goal, 0.0, nullptr);
+  const auto hold_node = make_node(std::nullopt, 3.0, goal_node);
+  const auto middle_node = make_node(middle, 5.0, hold_node);
+  const auto start_node = make_node(start, 10.1, middle_node);
+
+  const auto key_of = [&](const Entry& entry)
+    {
+      return Key{
+        entry.lane, entry.orientation, entry.side,
+        goal.lane, goal.orientation
+      };
+    };
+
+  DifferentialDriveCostTable table(4);
+  CHECK(table.rows() == 0);
+  CHECK_FALSE(table.cost(key_of(start)).has_value());
+  CHECK(table.path(key_of(start)).empty());
+
+  table.record(key_of(start), start_node);
+  CHECK(table.rows() == 1);
+  CHECK(table.bytes() > 0);
+
+  const auto cost = table.cost(key_of(start));
+  REQUIRE(cost.has_value());
+  CHECK(*cost <= 10.1);
+  CHECK(*cost == Approx(10.1));
+
+  // The path stops at the first entry whose key has not been recorded
+  CHECK(table.path(key_of(start)) == std::vector<Entry>{start});
+
+  table.record(key_of(middle), middle_node);
+  table.record(key_of(goal), goal_node);
+  CHECK(table.rows() == 1);
+  CHECK(table.cost(key_of(goal)) == 0.0);
+  CHECK(table.path(key_of(start)) == std::vector<Entry>{start, middle, goal});
+
+  WHEN("A key cannot reach its goal")
+  {
+    const Key stuck{3, Orientation::Forward, Side::Start, 0, Orientation::Any};
+    table.record(stuck, nullptr);
+    CHECK(table.rows() == 2);
+
+    const auto stuck_cost = table.cost(stuck);
+    REQUIRE(stuck_cost.has_value());
+    CHECK(std::isinf(*stuck_cost));
+    CHECK(table.path(stuck).empty());
+  }
+
+  WHEN("A key is outside of the graph")
+  {
+    const Key outside{
+      9, Orientation::Forward, Side::Start, goal.lane, goal.orientation};
+    table.record(outside, start_node);
+    CHECK_FALSE(table.cost(outside).has_value());
+  }
+}
@@ -162,6 +162,34 @@ SCENARIO("Euclidean Heuristic -- Easy Multifloor")
   value = cache->get(3);
   REQUIRE(value.has_value());
   CHECK(value.value() == Approx(expected_cost(p3)).margin(1e-8));
+
+  WHEN("The heuristic is used directly")
+  {
+    const rmf_traffic::agv::planning::EuclideanHeuristic heuristic(
+      goal, max_speed, supergraph);
+
+    // Waypoints on the map of the goal are known from the start
+    const auto p9 = graph.get_waypoint(9).get_location();
+    const auto known = heuristic.find(9);
+    REQUIRE(known.has_value());
+    REQUIRE(known->has_value());
+    CHECK(known->value() == Approx((p9 - p8).norm()/max_speed));
+
+    // Waypoints on other maps are only known after they are searched
+    CHECK_FALSE(heuristic.find(2).has_value());
+    value = heuristic.get(2);
+    REQUIRE(value.has_value());
+    CHECK(value.value() == Approx(expected_cost(p2)).margin(1e-8));
+    CHECK(heuristic.find(2).has_value());
+
+    // The search also fills in the waypoints along its solution
+    const auto lift = heuristic.find(7);
+    REQUIRE(lift.has_value());
+    REQUIRE(lift->has_value());
+    CHECK(lift->value() == Approx(
+        rmf_traffic::time::to_seconds(lift_move_duration)
+        + (p8 - p11).norm()/max_speed).margin(1e-8));
+  }
 }
 
 //==============================================================================
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/ShortestPathHeuristic.hpp>
+
+#include "../../utils_Trajectory.hpp"
+
+#include <rmf_utils/catch.hpp>
+
+//==============================================================================
+SCENARIO("Floor hierarchy")
+{
+  using rmf_traffic::agv::planning::ShortestPathHeuristic;
+  using rmf_traffic::agv::planning::Supergraph;
+
+  // Three floors with four waypoints each. The first and second floors are
+  // joined at both ends, and the third floor can only be reached from the
+  // far end of the second floor.
+  rmf_traffic::agv::Graph graph;
+  const std::vector<std::string> floors = {"L1", "L2", "L3"};
+  for (const auto& floor : floors)
+  {
+    for (std::size_t i = 0; i < 4; ++i)
+      graph.add_waypoint(floor, {10.0*i, 0.0});
+  }
+
+  const auto connect = [&graph](std::size_t a, std::size_t b)
+    {
+      graph.add_lane(a, b);
+      graph.add_lane(b, a);
+    };
+
+  for (std::size_t f = 0; f < floors.size(); ++f)
+  {
+    for (std::size_t i = 0; i+1 < 4; ++i)
+      connect(4*f + i, 4*f + i + 1);
+  }
+
+  connect(0, 4);
+  connect(3, 7);
+  connect(7, 11);
+
+  const double max_speed = 2.0;
+  const rmf_traffic::agv::VehicleTraits traits(
+    {max_speed, 0.3}, {1.0, 0.45}, create_test_profile(UnitCircle));
+
+  const auto make = [&](
+    bool floor_hierarchy,
+    rmf_traffic::agv::LaneClosure closures)
+    {
+      return Supergraph::make(
+        rmf_traffic::agv::Graph::Implementation::get(graph),
+        traits, std::move(closures), rmf_traffic::agv::Interpolate::Options(),
+        0.1, std::nullopt, floor_hierarchy);
+    };
+
+  const auto compare = [&](const rmf_traffic::agv::LaneClosure& closures)
+    {
+      const ShortestPathHeuristic flat(make(false, closures));
+      CHECK_FALSE(flat.floors());
+
+      const ShortestPathHeuristic tiered(make(true, closures));
+      REQUIRE(tiered.floors());
+
+      const std::size_t N = graph.num_waypoints();
+      for (std::size_t start = 0; start < N; ++start)
+      {
+        for (std::size_t finish = 0; finish < N; ++finish)
+        {
+          const auto expected = flat.get(start, finish);
+          const auto solution = tiered.get(start, finish);
+          REQUIRE((expected == nullptr) == (solution == nullptr));
+          if (!expected)
+            continue;
+
+          CHECK(solution->cost == Approx(expected->cost));
+          if (start == finish)
+            continue;
+
+          REQUIRE(solution->path.size() >= 2);
+          CHECK(solution->path.front() == start);
+          CHECK(solution->path.back() == finish);
+          for (std::size_t i = 0; i+1 < solution->path.size(); ++i)
+          {
+            const auto* lane =
+              graph.lane_from(solution->path[i], solution->path[i+1]);
+            REQUIRE(lane);
+            CHECK_FALSE(closures.is_closed(lane->index()));
+          }
+        }
+      }
+
+      // Only the start waypoints and the arrivals of the floor changes ever
+      // need a floor search
+      CHECK(tiered.floors()->cached_floor_searches() <= N);
+    };
+
+  WHEN("Every lane is open")
+  {
+    compare(rmf_traffic::agv::LaneClosure());
+  }
+
+  WHEN("The floor change at the near end is closed")
+  {
+    rmf_traffic::agv::LaneClosure closures;
+    closures.close(graph.lane_from(0, 4)->index());
+    closures.close(graph.lane_from(4, 0)->index());
+    compare(closures);
+  }
+
+  WHEN("The only way to the third floor is closed")
+  {
+    rmf_traffic::agv::LaneClosure closures;
+    closures.close(graph.lane_from(7, 11)->index());
+    compare(closures);
+
+    const ShortestPathHeuristic tiered(make(true, closures));
+    CHECK_FALSE(tiered.get(0, 8));
+    CHECK(tiered.get(8, 0));
+  }
+}
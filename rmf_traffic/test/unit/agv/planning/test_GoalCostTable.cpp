@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/GoalCostTable.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <cmath>
+
+//==============================================================================
+SCENARIO("Goal cost tables")
+{
+  using Adjacency = rmf_traffic::agv::planning::CompressedAdjacency;
+  using rmf_traffic::agv::planning::GoalCostTable;
+
+  const std::string test_map = "test_map";
+  rmf_traffic::agv::Graph graph;
+  graph.add_waypoint(test_map, {0.0, 0.0}); // 0
+  graph.add_waypoint(test_map, {10.0, 0.0}); // 1
+  graph.add_waypoint(test_map, {10.0, 10.0}); // 2
+  graph.add_waypoint(test_map, {0.0, 10.0}); // 3
+  graph.add_waypoint(test_map, {20.0, 20.0}); // 4
+
+  graph.add_lane(0, 1);
+  graph.add_lane(1, 0);
+  graph.add_lane(1, 2);
+  graph.add_lane(2, 3);
+  graph.add_lane(0, 3);
+  graph.add_lane(3, 0);
+
+  // Waypoint 4 can be reached, but it cannot reach anything
+  graph.add_lane(2, 4);
+
+  const auto& g = rmf_traffic::agv::Graph::Implementation::get(graph);
+  rmf_traffic::agv::LaneClosure closures;
+  const double max_speed = 1.0;
+  const Adjacency lanes_into(
+    g, closures, max_speed, Adjacency::Direction::Reverse);
+
+  GIVEN("The costs of a goal")
+  {
+    const auto costs = GoalCostTable::solve(lanes_into, 2);
+    REQUIRE(costs.size() == 5);
+    CHECK(costs[2] == Approx(0.0));
+    CHECK(costs[1] == Approx(10.0));
+    CHECK(costs[0] == Approx(20.0));
+    CHECK(costs[3] == Approx(30.0));
+    CHECK(std::isinf(costs[4]));
+  }
+
+  GIVEN("A table that promotes goals after three questions")
+  {
+    const GoalCostTable table(lanes_into, 2, 3);
+    CHECK(table.capacity() == 2);
+
+    CHECK_FALSE(table.find(3));
+    CHECK_FALSE(table.find(3));
+    const auto costs = table.find(3);
+    REQUIRE(costs);
+    CHECK(table.size() == 1);
+    CHECK((*costs)[0] == Approx(10.0));
+    CHECK((*costs)[2] == Approx(10.0));
+    CHECK(table.find(3) == costs);
+
+    WHEN("More goals are promoted than it has room for")
+    {
+      REQUIRE(table.get(0));
+      CHECK(table.size() == 2);
+
+      // Goal 0 has been asked about less than goal 3, so it gets dropped
+      const auto costs_1 = table.get(1);
+      REQUIRE(costs_1);
+      CHECK((*costs_1)[0] == Approx(10.0));
+      CHECK(table.size() == 2);
+      CHECK(table.find(3) == costs);
+    }
+
+    WHEN("A goal does not exist")
+    {
+      CHECK_FALSE(table.get(5));
+      CHECK(table.size() == 1);
+    }
+  }
+
+  GIVEN("A table with no capacity")
+  {
+    const GoalCostTable table(lanes_into, 0, 0);
+    CHECK_FALSE(table.find(2));
+    CHECK_FALSE(table.get(2));
+    CHECK(table.size() == 0);
+  }
+}
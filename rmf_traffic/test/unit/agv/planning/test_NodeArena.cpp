@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/NodeArena.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <memory_resource>
+
+namespace {
+//==============================================================================
+struct TestNode
+{
+  std::size_t value;
+  const TestNode* parent;
+  std::shared_ptr<std::size_t> destroyed;
+
+  ~TestNode()
+  {
+    ++(*destroyed);
+  }
+};
+
+//==============================================================================
+/// A memory resource that counts the bytes that are currently allocated from
+/// it
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+
+  std::size_t allocated = 0;
+
+private:
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) final
+  {
+    allocated += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) final
+  {
+    allocated -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+  noexcept final
+  {
+    return this == &other;
+  }
+};
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Node arena")
+{
+  using Arena = rmf_traffic::agv::planning::NodeArena<TestNode, 4>;
+  auto destroyed = std::make_shared<std::size_t>(0);
+
+  auto arena = std::make_shared<Arena>();
+  CHECK(arena->size() == 0);
+
+  const TestNode* parent = nullptr;
+  for (std::size_t i = 0; i < 10; ++i)
+    parent = arena->make(TestNode{i, parent, destroyed});
+
+  CHECK(arena->size() == 10);
+
+  // The temporaries that were moved into the arena have been destroyed
+  const std::size_t temporaries = *destroyed;
+
+  std::size_t expected = 9;
+  for (auto node = parent; node; node = node->parent)
+    CHECK(node->value == expected--);
+
+  WHEN("A second arena is chained to the first")
+  {
+    auto second = std::make_shared<Arena>(arena);
+    const TestNode* child = second->make(TestNode{10, parent, destroyed});
+    arena.reset();
+
+    // The first arena is still alive, so the chain is still intact
+    CHECK(*destroyed == temporaries + 1);
+    CHECK(child->parent->value == 9);
+
+    second.reset();
+    CHECK(*destroyed == temporaries + 1 + 11);
+  }
+
+  WHEN("The arena is destroyed")
+  {
+    arena.reset();
+    CHECK(*destroyed == temporaries + 10);
+  }
+}
+
+//==============================================================================
+SCENARIO("Node arena with a memory resource")
+{
+  using Arena = rmf_traffic::agv::planning::NodeArena<TestNode, 4>;
+  auto destroyed = std::make_shared<std::size_t>(0);
+  CountingResource resource;
+
+  auto arena = std::make_shared<Arena>(nullptr, &resource);
+  CHECK(arena->resource() == &resource);
+  CHECK(resource.allocated == 0);
+
+  const TestNode* parent = nullptr;
+  for (std::size_t i = 0; i < 10; ++i)
+    parent = arena->make(TestNode{i, parent, destroyed});
+
+  // Three blocks of four nodes each
+  CHECK(resource.allocated >= 3 * 4 * sizeof(TestNode));
+
+  auto second = std::make_shared<Arena>(arena);
+  CHECK(second->resource() == &resource);
+  second->make(TestNode{10, parent, destroyed});
+
+  arena.reset();
+  second.reset();
+  CHECK(resource.allocated == 0);
+
+  // Arenas without a resource use the default one
+  CHECK(Arena().resource() == std::pmr::get_default_resource());
+}
@@ -21,6 +21,8 @@
 
 #include <rmf_utils/catch.hpp>
 
+#include <unordered_map>
+
 // TODO(MXG): It would be good to add tests to see that the cache is behaving
 // as intended, caching and using the values in the way that it should. This
 // could be done by adding a proprocessor token into the cache manager header
@@ -268,3 +270,163 @@ SCENARIO("Supergraph -- Single Floor, Events, Irreversible")
   CHECK(count_alternatives(*traversals) == 6);
   CHECK(has_only_map(test_map, *traversals));
 }
+
+//==============================================================================
+SCENARIO("Eager supergraph")
+{
+  const std::string test_map = "test_map";
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    for (std::size_t j = 0; j < 4; ++j)
+      graph.add_waypoint(test_map, {10.0*i, 10.0*j});
+  }
+
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    for (std::size_t j = 0; j+1 < 4; ++j)
+    {
+      graph.add_lane(4*i + j, 4*i + j + 1);
+      graph.add_lane(4*i + j + 1, 4*i + j);
+      graph.add_lane(4*j + i, 4*(j+1) + i);
+      graph.add_lane(4*(j+1) + i, 4*j + i);
+    }
+  }
+
+  const rmf_traffic::agv::VehicleTraits traits(
+    {2.0, 0.3}, {1.0, 0.45}, create_test_profile(UnitCircle));
+
+  const auto make = [&](std::optional<std::size_t> eager_threads)
+    {
+      return rmf_traffic::agv::planning::Supergraph::make(
+        rmf_traffic::agv::Graph::Implementation::get(graph),
+        traits, {}, rmf_traffic::agv::Interpolate::Options(), 0.1,
+        eager_threads);
+    };
+
+  const auto lazy = make(std::nullopt);
+  const auto eager = make(4);
+
+  // The eager supergraph finds the same traversals as the lazy one
+  for (std::size_t wp = 0; wp < graph.num_waypoints(); ++wp)
+  {
+    const auto lazy_from = lazy->traversals_from(wp);
+    const auto eager_from = eager->traversals_from(wp);
+    REQUIRE(lazy_from);
+    REQUIRE(eager_from);
+    CHECK(eager_from->size() == lazy_from->size());
+    CHECK(count_alternatives(*eager_from) == count_alternatives(*lazy_from));
+
+    const auto lazy_into = lazy->traversals_into(wp);
+    const auto eager_into = eager->traversals_into(wp);
+    REQUIRE(lazy_into);
+    REQUIRE(eager_into);
+    CHECK(eager_into->size() == lazy_into->size());
+  }
+
+  // Precomputing again does not replace what was found before
+  const auto traversals = eager->traversals_from(0);
+  eager->precompute(2);
+  CHECK(eager->traversals_from(0) == traversals);
+}
+
+//==============================================================================
+SCENARIO("Corridor traversals")
+{
+  // A straight corridor 0 - 1 - 2 - 3 - 4 with a branch from 3 to 5 and a
+  // holding point at 2
+  const std::string test_map = "test_map";
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < 5; ++i)
+    graph.add_waypoint(test_map, {10.0*i, 0.0});
+
+  graph.add_waypoint(test_map, {30.0, 10.0});
+  graph.get_waypoint(2).set_holding_point(true);
+
+  for (std::size_t i = 0; i+1 < 5; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  graph.add_lane(3, 5);
+  graph.add_lane(5, 3);
+
+  const rmf_traffic::agv::VehicleTraits traits(
+    {2.0, 0.3}, {1.0, 0.45}, create_test_profile(UnitCircle));
+
+  const auto supergraph = rmf_traffic::agv::planning::Supergraph::make(
+    rmf_traffic::agv::Graph::Implementation::get(graph),
+    traits, {}, rmf_traffic::agv::Interpolate::Options(), 0.1,
+    std::nullopt, false, true);
+  CHECK(supergraph->contract_corridors());
+
+  std::unordered_map<std::size_t, bool> corridor;
+  for (const auto& traversal : *supergraph->traversals_from(0))
+    corridor[traversal.finish_waypoint_index] = traversal.corridor;
+
+  // Waypoint 1 is only passed through on the way along the corridor
+  REQUIRE(corridor.count(1));
+  CHECK(corridor.at(1));
+
+  // Holding points and junctions are never contracted
+  REQUIRE(corridor.count(2));
+  CHECK_FALSE(corridor.at(2));
+  REQUIRE(corridor.count(3));
+  CHECK_FALSE(corridor.at(3));
+
+  // The end of the corridor has nothing further along it
+  REQUIRE(corridor.count(4));
+  CHECK_FALSE(corridor.at(4));
+}
+
+//==============================================================================
+SCENARIO("Translation factories reuse their translation profile")
+{
+  using namespace rmf_traffic::agv;
+  const KinematicLimits limits{{0.7, 0.3}, {1.0, 0.45}};
+  const Eigen::Vector3d start{0.0, 0.0, 0.0};
+  const Eigen::Vector3d finish{10.0, 0.0, 0.0};
+  const double translation_thresh = 1e-3;
+  const double rotation_thresh = 1e-3;
+
+  const auto info = planning::make_differential_drive_translate_factory(
+    start, finish, limits, translation_thresh, rotation_thresh, 0.0,
+    {"test_map"});
+
+  const auto factory = info.factory(std::nullopt);
+  const auto check_route = [&](
+    const rmf_traffic::Time start_time,
+    const double initial_yaw)
+    {
+      rmf_traffic::Trajectory expected;
+      const Eigen::Vector3d pre_start{start.x(), start.y(), initial_yaw};
+      expected.insert(start_time, pre_start, Eigen::Vector3d::Zero());
+      internal::interpolate_rotation(
+        expected, limits.angular.velocity, limits.angular.acceleration,
+        start_time, pre_start, start, rotation_thresh);
+      internal::interpolate_translation(
+        expected, limits.linear.velocity, limits.linear.acceleration,
+        expected.back().time(), start, finish, translation_thresh);
+
+      const auto info = factory(start_time, initial_yaw);
+      REQUIRE(info.routes.size() == 1);
+      const auto& trajectory = info.routes.front().trajectory();
+      REQUIRE(trajectory.size() == expected.size());
+      CHECK(info.finish_time == *expected.finish_time());
+
+      auto it = trajectory.begin();
+      for (const auto& wp : expected)
+      {
+        CHECK(it->time() == wp.time());
+        CHECK((it->position() - wp.position()).norm() == Approx(0.0));
+        CHECK((it->velocity() - wp.velocity()).norm() == Approx(0.0));
+        ++it;
+      }
+    };
+
+  const auto now = std::chrono::steady_clock::now();
+  check_route(now, 0.0);
+  check_route(now + std::chrono::seconds(30), M_PI/2.0);
+  check_route(now - std::chrono::seconds(100), -M_PI/4.0);
+}
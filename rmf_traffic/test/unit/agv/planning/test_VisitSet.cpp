@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/agv/planning/VisitSet.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+//==============================================================================
+SCENARIO("Visit set")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::agv::planning::VisitSet;
+
+  const auto t0 = std::chrono::steady_clock::now();
+  const rmf_traffic::Duration tolerance = 500ms;
+
+  VisitSet visits;
+  CHECK_FALSE(visits.dominated(t0, 10.0, tolerance));
+  CHECK(visits.insert(t0, 10.0, tolerance));
+  CHECK(visits.size() == 1);
+
+  WHEN("A node is at about the same time")
+  {
+    THEN("It is dominated unless it costs less")
+    {
+      CHECK(visits.dominated(t0 + 200ms, 10.5, tolerance));
+      CHECK(visits.dominated(t0 - 200ms, 10.0, tolerance));
+      CHECK_FALSE(visits.dominated(t0 - 200ms, 9.0, tolerance));
+      CHECK(visits.insert(t0 - 200ms, 9.0, tolerance));
+      CHECK(visits.size() == 2);
+      CHECK(visits.visits().front().time == t0 - 200ms);
+    }
+
+    THEN("A later node is dominated only if waiting would not be cheaper")
+    {
+      // Waiting 0.4s after the visit would cost 10.4
+      CHECK(visits.dominated(t0 + 400ms, 10.4, tolerance));
+      CHECK_FALSE(visits.dominated(t0 + 400ms, 10.3, tolerance));
+    }
+  }
+
+  WHEN("A node is outside of the tolerance")
+  {
+    CHECK_FALSE(visits.dominated(t0 + 500ms, 100.0, tolerance));
+    CHECK_FALSE(visits.dominated(t0 - 600ms, 100.0, tolerance));
+    CHECK(visits.insert(t0 + 2s, 10.0, tolerance));
+    CHECK(visits.insert(t0 + 1s, 10.0, tolerance));
+    CHECK(visits.size() == 3);
+
+    THEN("The visits stay sorted by time")
+    {
+      const auto& v = visits.visits();
+      for (std::size_t i = 1; i < v.size(); ++i)
+        CHECK(v[i-1].time < v[i].time);
+    }
+  }
+}
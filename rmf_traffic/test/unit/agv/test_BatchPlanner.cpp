@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+
+#include <rmf_traffic/agv/BatchPlanner.hpp>
+#include <rmf_traffic/DetectConflict.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include "../utils_Trajectory.hpp"
+
+namespace {
+//==============================================================================
+void add_bidirectional_lane(
+  rmf_traffic::agv::Graph& graph,
+  const std::size_t a,
+  const std::size_t b)
+{
+  graph.add_lane(a, b);
+  graph.add_lane(b, a);
+}
+
+//==============================================================================
+rmf_traffic::Time finish_time(const rmf_traffic::agv::Plan& plan)
+{
+  rmf_traffic::Time finish = rmf_traffic::Time::min();
+  for (const auto& route : plan.get_itinerary())
+    finish = std::max(finish, *route.trajectory().finish_time());
+
+  return finish;
+}
+
+//==============================================================================
+bool have_conflict(
+  const rmf_traffic::Profile& profile,
+  const rmf_traffic::agv::Plan& a,
+  const rmf_traffic::agv::Plan& b)
+{
+  for (const auto& ra : a.get_itinerary())
+  {
+    for (const auto& rb : b.get_itinerary())
+    {
+      if (ra.map() != rb.map())
+        continue;
+
+      if (rmf_traffic::DetectConflict::between(
+          profile, ra.trajectory(), nullptr,
+          profile, rb.trajectory(), nullptr))
+        return true;
+    }
+  }
+
+  return false;
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Plan a batch of participants by priority")
+{
+  using BatchPlanner = rmf_traffic::agv::BatchPlanner;
+  using Planner = rmf_traffic::agv::Planner;
+
+  // A crossing on one map
+  rmf_traffic::agv::Graph crossing;
+  crossing.add_waypoint("map_a", {-10.0, 0.0}); // 0
+  crossing.add_waypoint("map_a", {0.0, 0.0}); // 1
+  crossing.add_waypoint("map_a", {10.0, 0.0}); // 2
+  crossing.add_waypoint("map_a", {0.0, -10.0}); // 3
+  crossing.add_waypoint("map_a", {0.0, 10.0}); // 4
+  add_bidirectional_lane(crossing, 0, 1);
+  add_bidirectional_lane(crossing, 1, 2);
+  add_bidirectional_lane(crossing, 3, 1);
+  add_bidirectional_lane(crossing, 1, 4);
+
+  // A corridor on another map
+  rmf_traffic::agv::Graph corridor;
+  for (std::size_t i = 0; i < 4; ++i)
+    corridor.add_waypoint("map_b", {10.0*i, 0.0});
+
+  for (std::size_t i = 0; i+1 < 4; ++i)
+    add_bidirectional_lane(corridor, i, i+1);
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options options{nullptr};
+  const auto crossing_planner = std::make_shared<Planner>(
+    Planner::Configuration{crossing, traits}, options);
+  const auto corridor_planner = std::make_shared<Planner>(
+    Planner::Configuration{corridor, traits}, options);
+
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<BatchPlanner::Request> requests;
+  requests.push_back({0, {now, 3, 0.0}, 4, crossing_planner, 0});
+  requests.push_back({1, {now, 0, 0.0}, 2, crossing_planner, 1});
+  requests.push_back({2, {now, 0, 0.0}, 3, corridor_planner, 0});
+
+  BatchPlanner batch;
+  CHECK(batch.threads() == 1);
+  CHECK(batch.exact());
+
+  const auto result = batch.plan(requests);
+  CHECK(result.groups() == 2);
+  CHECK(result.failures().empty());
+  REQUIRE(result.plans().size() == 3);
+
+  const auto& first = result.plans().at(1);
+  const auto& second = result.plans().at(0);
+
+  // The participant with the higher priority does not need to wait for anyone
+  const auto ideal = crossing_planner->plan({now, 0, 0.0}, 2);
+  REQUIRE(ideal);
+  CHECK(finish_time(first) == finish_time(*ideal));
+  CHECK(finish_time(first) < finish_time(second));
+  CHECK_FALSE(have_conflict(profile, first, second));
+
+  WHEN("The groups are planned in parallel")
+  {
+    const auto parallel = BatchPlanner().threads(4).plan(requests);
+    REQUIRE(parallel.plans().size() == 3);
+    for (const auto& [id, plan] : result.plans())
+      CHECK(finish_time(parallel.plans().at(id)) == finish_time(plan));
+  }
+
+  WHEN("Reservations are used without confirming them")
+  {
+    const auto cautious = BatchPlanner().exact(false).plan(requests);
+    REQUIRE(cautious.plans().size() == 3);
+    CHECK_FALSE(
+      have_conflict(profile, cautious.plans().at(1), cautious.plans().at(0)));
+  }
+
+  WHEN("Two requests share an ID")
+  {
+    requests.push_back({2, {now, 3, 0.0}, 0, corridor_planner, 0});
+    CHECK_THROWS_AS(batch.plan(requests), std::runtime_error);
+  }
+
+  WHEN("A request has no planner")
+  {
+    requests.push_back({3, {now, 3, 0.0}, 0, nullptr, 0});
+    CHECK_THROWS_AS(batch.plan(requests), std::runtime_error);
+  }
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/agv/CongestionField.hpp>
+#include <rmf_traffic/agv/Planner.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+using namespace std::chrono_literals;
+
+namespace {
+//==============================================================================
+rmf_traffic::schedule::Itinerary make_itinerary(
+  const rmf_traffic::Time start,
+  const std::vector<Eigen::Vector3d>& positions,
+  const rmf_traffic::Duration step)
+{
+  rmf_traffic::Trajectory t;
+  for (std::size_t i = 0; i < positions.size(); ++i)
+    t.insert(start + i*step, positions[i], Eigen::Vector3d::Zero());
+
+  return {rmf_traffic::Route("test_map", std::move(t))};
+}
+
+//==============================================================================
+double seconds(const rmf_traffic::Duration d)
+{
+  return rmf_traffic::time::to_seconds(d);
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Congestion field")
+{
+  using rmf_traffic::agv::CongestionField;
+  using rmf_traffic::schedule::ParticipantDescription;
+
+  // 0 --> 1 --> 2     3
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < 4; ++i)
+    graph.add_waypoint("test_map", {10.0 * static_cast<double>(i), 0.0});
+
+  graph.add_lane(0, 1);
+  graph.add_lane(1, 2);
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  rmf_traffic::schedule::Database db;
+  const auto make_description = [&](const std::string& name)
+    {
+      return ParticipantDescription{
+        name,
+        "test_CongestionField",
+        ParticipantDescription::Rx::Responsive,
+        profile
+      };
+    };
+
+  const auto blocker = db.register_participant(make_description("blocker"));
+  const auto passer = db.register_participant(make_description("passer"));
+
+  const auto now = std::chrono::steady_clock::now();
+
+  // The blocker stays at waypoint 2 for the first half of the horizon
+  db.set(
+    blocker.id(), 0,
+    make_itinerary(now, {{20, 0, 0}, {20, 0, 0}}, 60s), 0, 0);
+
+  // The passer drives past waypoint 3 twice, spending 2s near it each time
+  db.set(
+    passer.id(), 0,
+    make_itinerary(
+      now + 10s,
+      {{25, 0, 0}, {35, 0, 0}, {35, 5, 0}, {25, 5, 0}, {25, 0, 0},
+        {35, 0, 0}},
+      10s),
+    0, 0);
+
+  const auto field = CongestionField::make(graph, db, now, 120s, 1.0);
+  REQUIRE(field);
+  CHECK(field->num_waypoints() == 4);
+  CHECK(field->schedule_version() == db.schedule_version());
+
+  THEN("The delays follow the occupancy of each waypoint")
+  {
+    CHECK(seconds(field->waypoint_delay(0)) == Approx(0.0));
+    CHECK(seconds(field->waypoint_delay(1)) == Approx(0.0));
+
+    // 60s occupied in one pass: 60^2 / (2 * 120 * 1)
+    CHECK(seconds(field->waypoint_delay(2)) == Approx(15.0).margin(1e-3));
+
+    // 4s occupied in two passes: 4^2 / (2 * 120 * 2)
+    CHECK(seconds(field->waypoint_delay(3)) ==
+      Approx(16.0 / 480.0).margin(1e-3));
+
+    // Lanes take on the delay of the waypoint they exit into
+    CHECK(seconds(field->lane_delay(0)) == Approx(0.0));
+    CHECK(seconds(field->lane_delay(1)) == Approx(15.0).margin(1e-3));
+
+    // Indices outside of the graph have no delay
+    CHECK(seconds(field->waypoint_delay(10)) == Approx(0.0));
+    CHECK(seconds(field->lane_delay(10)) == Approx(0.0));
+  }
+
+  WHEN("Participants are ignored")
+  {
+    const auto ignoring = CongestionField::make(
+      graph, db, now, 120s, 1.0, {blocker.id()});
+
+    CHECK(seconds(ignoring->waypoint_delay(2)) == Approx(0.0));
+    CHECK(seconds(ignoring->waypoint_delay(3)) > 0.0);
+  }
+
+  WHEN("The schedule does not change")
+  {
+    CHECK_FALSE(field->stale(db, now + 10s));
+    CHECK(CongestionField::refresh(field, db, now + 10s) == field);
+
+    THEN("The field becomes stale once time moves on")
+    {
+      CHECK(field->stale(db, now + 31s));
+      const auto refreshed = CongestionField::refresh(field, db, now + 31s);
+      REQUIRE(refreshed != field);
+      CHECK(refreshed->start_time() == now + 31s);
+      CHECK(refreshed->horizon() == field->horizon());
+      CHECK(refreshed->radius() == Approx(field->radius()));
+    }
+  }
+
+  WHEN("The schedule changes")
+  {
+    db.set(
+      blocker.id(), 1,
+      make_itinerary(now, {{20, 0, 0}, {20, 0, 0}}, 120s), 1, 1);
+
+    CHECK(field->stale(db, now));
+    const auto refreshed = CongestionField::refresh(field, db, now);
+    REQUIRE(refreshed != field);
+    CHECK(refreshed->schedule_version() == db.schedule_version());
+
+    // 120s occupied in one pass: 120^2 / (2 * 120 * 1)
+    CHECK(seconds(refreshed->waypoint_delay(2)) ==
+      Approx(60.0).margin(1e-3));
+  }
+
+  GIVEN("Bad parameters")
+  {
+    CHECK_THROWS_AS(
+      CongestionField::make(graph, db, now, 0s),
+      std::invalid_argument);
+
+    CHECK_THROWS_AS(
+      CongestionField::make(graph, db, now, 60s, 0.0),
+      std::invalid_argument);
+  }
+}
+
+//==============================================================================
+SCENARIO("Planning with a congestion field")
+{
+  using rmf_traffic::agv::Planner;
+
+  // Two ways to get from 0 to 5 that cost the same: 0-1-2-5 and 0-3-4-5
+  rmf_traffic::agv::Graph graph;
+  const std::vector<Eigen::Vector2d> locations = {
+    {0, 0}, {5, 5}, {15, 5}, {5, -5}, {15, -5}, {20, 0}
+  };
+  for (const auto& location : locations)
+    graph.add_waypoint("test_map", location);
+
+  const auto add_bidir_lane = [&](std::size_t w0, std::size_t w1)
+    {
+      graph.add_lane(w0, w1);
+      graph.add_lane(w1, w0);
+    };
+
+  add_bidir_lane(0, 1);
+  add_bidir_lane(1, 2);
+  add_bidir_lane(2, 5);
+  add_bidir_lane(0, 3);
+  add_bidir_lane(3, 4);
+  add_bidir_lane(4, 5);
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {0.7, 0.3}, {1.0, 0.45}, profile
+  };
+
+  rmf_traffic::schedule::Database db;
+  const auto other = db.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "other",
+      "test_CongestionField",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+      profile
+    });
+
+  // The other participant waits near waypoint 2. The planner has no
+  // validator, so this only affects the plan through the congestion field.
+  const auto now = std::chrono::steady_clock::now();
+  db.set(
+    other.id(), 0,
+    make_itinerary(now, {{15, 7, 0}, {15, 7, 0}}, 120s), 0, 0);
+
+  const auto field =
+    rmf_traffic::agv::CongestionField::make(graph, db, now, 120s, 3.0);
+  REQUIRE(seconds(field->waypoint_delay(2)) > 0.0);
+
+  Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{nullptr}
+  };
+
+  const Planner::Start start{now, 0, 0.0};
+  const Planner::Goal goal{5};
+
+  const auto plain = planner.plan(start, goal);
+  REQUIRE(plain.success());
+
+  WHEN("The budget is zero")
+  {
+    auto options = planner.get_default_options();
+    options.congestion_field(field);
+    CHECK(options.congestion_field() == field);
+
+    const auto plan = planner.plan(start, goal, options);
+    REQUIRE(plan.success());
+
+    THEN("The best plan is still found")
+    {
+      CHECK(plan->get_cost() == Approx(plain->get_cost()).margin(1e-3));
+    }
+  }
+
+  WHEN("There is a budget")
+  {
+    auto options = planner.get_default_options();
+    options.suboptimality_budget(0.5);
+    options.congestion_field(field);
+
+    const auto plan = planner.plan(start, goal, options);
+    REQUIRE(plan.success());
+
+    THEN("The plan stays within the budget and avoids the congestion")
+    {
+      CHECK(plan->get_cost() <= 1.5 * plain->get_cost() + 1e-3);
+
+      bool passes_congestion = false;
+      for (const auto& wp : plan->get_waypoints())
+      {
+        if (wp.graph_index() && *wp.graph_index() == 2)
+          passes_congestion = true;
+      }
+
+      CHECK_FALSE(passes_congestion);
+    }
+  }
+}
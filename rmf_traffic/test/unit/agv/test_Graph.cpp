@@ -26,6 +26,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 
 void CHECK_WAYPOINT(rmf_traffic::agv::Graph::Waypoint wp,
   Eigen::Vector2d waypoint_location,
@@ -190,4 +191,130 @@ SCENARIO("Tests for Graph API")
       CHECK(moved.num_waypoints() == N);
     }
   }
+
+  WHEN("Lanes are added in bulk")
+  {
+    graph.reserve(3, 4);
+    for (std::size_t i = 0; i < 3; ++i)
+      graph.add_waypoint(test_map_name, Eigen::Vector2d{double(i), 0});
+
+    graph.add_lane(0, 1);
+
+    std::vector<rmf_traffic::agv::Graph::LaneInfo> lanes;
+    lanes.push_back({1, 0});
+    lanes.push_back({1, 2});
+    lanes.push_back({2, 1});
+    CHECK(graph.add_lanes(std::move(lanes)) == 1);
+
+    CHECK(graph.num_lanes() == 4);
+    CHECK(graph.lanes_from(1) == std::vector<std::size_t>({1, 2}));
+    CHECK(graph.lanes_into(1) == std::vector<std::size_t>({0, 3}));
+    REQUIRE(graph.lane_from(2, 1));
+    CHECK(graph.lane_from(2, 1)->index() == 3);
+    CHECK_LANE(graph.get_lane(2), 2, {1}, {2});
+
+    std::vector<rmf_traffic::agv::Graph::LaneInfo> bad_lanes;
+    bad_lanes.push_back({0, 2});
+    bad_lanes.push_back({2, 3});
+    CHECK_THROWS_AS(
+      graph.add_lanes(std::move(bad_lanes)), std::out_of_range);
+    CHECK(graph.num_lanes() == 4);
+    CHECK_FALSE(graph.lane_from(0, 2));
+  }
+}
+
+//==============================================================================
+SCENARIO("Graph snapshots")
+{
+  using namespace std::chrono_literals;
+  using Graph = rmf_traffic::agv::Graph;
+  using Lane = Graph::Lane;
+
+  Graph graph;
+  graph.add_waypoint("L1", {0, 0}).set_holding_point(true);
+  graph.add_waypoint("L1", {5, 0}).set_charger(true);
+  graph.add_waypoint("L2", {5, 0}).set_passthrough_point(true);
+  graph.add_key("dock", 1);
+
+  graph.add_lane(
+    {0, Lane::Event::make(Lane::DoorOpen("door", 2s))},
+    {1, Graph::OrientationConstraint::make({0.5})},
+    Lane::Properties().speed_limit(0.3));
+  graph.add_lane(
+    {1, Lane::Event::make(Lane::LiftSessionBegin("lift", "L1", 3s))},
+    {2, Lane::Event::make(Lane::Wait(1s))});
+  graph.add_lane(
+    {2, Graph::OrientationConstraint::make(
+        Graph::OrientationConstraint::Direction::Backward, {0, 1})},
+    {0, Lane::Event::make(Lane::Dock("dock", 4s))});
+
+  std::stringstream snapshot;
+  graph.save(snapshot);
+
+  WHEN("The snapshot is loaded")
+  {
+    const auto loaded = Graph::load(snapshot);
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded->num_waypoints() == 3);
+    REQUIRE(loaded->num_lanes() == 3);
+
+    CHECK_WAYPOINT(loaded->get_waypoint(0), {0, 0}, "L1", 0, true);
+    CHECK(loaded->get_waypoint(1).is_charger());
+    CHECK(loaded->get_waypoint(2).is_passthrough_point());
+    CHECK(loaded->get_waypoint(2).get_map_name() == "L2");
+    REQUIRE(loaded->find_waypoint("dock"));
+    CHECK(loaded->find_waypoint("dock")->index() == 1);
+    REQUIRE(loaded->get_waypoint(1).name());
+    CHECK(*loaded->get_waypoint(1).name() == "dock");
+
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      const auto& original = graph.get_lane(i);
+      const auto& lane = loaded->get_lane(i);
+      CHECK(lane.entry().waypoint_index() == original.entry().waypoint_index());
+      CHECK(lane.exit().waypoint_index() == original.exit().waypoint_index());
+      CHECK(lane.properties().speed_limit()
+        == original.properties().speed_limit());
+
+      for (const auto& [node, original_node] : {
+          std::make_pair(&lane.entry(), &original.entry()),
+          std::make_pair(&lane.exit(), &original.exit())})
+      {
+        CHECK((node->event() == nullptr)
+          == (original_node->event() == nullptr));
+        if (node->event())
+        {
+          CHECK(node->event()->duration()
+            == original_node->event()->duration());
+        }
+
+        CHECK((node->orientation_constraint() == nullptr)
+          == (original_node->orientation_constraint() == nullptr));
+        if (node->orientation_constraint())
+        {
+          Eigen::Vector3d p(0, 0, 0);
+          Eigen::Vector3d original_p(0, 0, 0);
+          const Eigen::Vector2d course(1, 1);
+          CHECK(node->orientation_constraint()->apply(p, course));
+          CHECK(original_node->orientation_constraint()->apply(
+              original_p, course));
+          CHECK(p[2] == Approx(original_p[2]));
+        }
+      }
+    }
+
+    CHECK(loaded->lanes_from(1) == graph.lanes_from(1));
+    CHECK(loaded->lanes_into(0) == graph.lanes_into(0));
+  }
+
+  WHEN("The snapshot is damaged")
+  {
+    std::string data = snapshot.str();
+    data[data.size() - 3] ^= 0x5a;
+    std::stringstream damaged(data);
+    CHECK_FALSE(Graph::load(damaged).has_value());
+
+    std::stringstream truncated(data.substr(0, data.size() / 2));
+    CHECK_FALSE(Graph::load(truncated).has_value());
+  }
 }
@@ -289,6 +289,81 @@ SCENARIO("Test Interpolations")
     // it. If anything, it should be expanded upon.
     CHECK(rmf_traffic::time::to_seconds(trajectory.duration()) > 0.0);
   }
+
+  GIVEN("Several sequences of waypoints")
+  {
+    const rmf_traffic::Time start_time = std::chrono::steady_clock::now();
+    using Interpolate = rmf_traffic::agv::Interpolate;
+
+    const std::vector<std::vector<Eigen::Vector3d>> sequences = {
+      {{0, 0, 0}, {10, 0, M_PI/2.0}, {10, -10, M_PI/4.0}},
+      {{10, 12, 0}, {5, 8, 0}, {0, 8, 0}, {0, 0, 0}},
+      {},
+      {{1, 1, 0}}
+    };
+
+    const auto check_equal = [](
+      const rmf_traffic::Trajectory& a,
+      const rmf_traffic::Trajectory& b)
+      {
+        REQUIRE(a.size() == b.size());
+        auto it_a = a.begin();
+        auto it_b = b.begin();
+        for (; it_a != a.end(); ++it_a, ++it_b)
+        {
+          CHECK(it_a->time() == it_b->time());
+          CHECK((it_a->position() - it_b->position()).norm() == Approx(0.0));
+          CHECK((it_a->velocity() - it_b->velocity()).norm() == Approx(0.0));
+        }
+      };
+
+    WHEN("The sequences are interpolated as a batch")
+    {
+      const auto batch =
+        Interpolate::batch_positions(traits, start_time, sequences);
+
+      THEN("Each trajectory matches its individual interpolation")
+      {
+        REQUIRE(batch.size() == sequences.size());
+        for (std::size_t i = 0; i < sequences.size(); ++i)
+        {
+          check_equal(
+            batch[i],
+            Interpolate::positions(traits, start_time, sequences[i]));
+        }
+      }
+    }
+
+    WHEN("A sequence is appended to an existing trajectory")
+    {
+      const auto& first = sequences[0];
+      const auto& second = sequences[1];
+
+      rmf_traffic::Trajectory output;
+      Interpolate::positions(traits, start_time, first, output);
+      check_equal(output, Interpolate::positions(traits, start_time, first));
+
+      const std::size_t first_size = output.size();
+      const auto second_start = *output.finish_time() + std::chrono::seconds(5);
+      Interpolate::positions(traits, second_start, second, output);
+
+      THEN("The new waypoints follow the old ones")
+      {
+        const auto expected =
+          Interpolate::positions(traits, second_start, second);
+        REQUIRE(output.size() == first_size + expected.size());
+
+        auto it = output.find(second_start);
+        REQUIRE(it != output.end());
+        for (const auto& wp : expected)
+        {
+          CHECK(it->time() == wp.time());
+          CHECK((it->position() - wp.position()).norm() == Approx(0.0));
+          ++it;
+        }
+      }
+    }
+  }
 }
 
 /// ================ TODO(MXG): Testing wishlist ================
@@ -80,26 +80,23 @@ SCENARIO("Test LaneClosure class functions")
   std::unordered_set<rmf_traffic::agv::LaneClosure> unique_closures;
 
   closure.close(0);
-  CHECK(closure.hash() == 1);
+  const std::size_t hash_0 = closure.hash();
+  CHECK(hash_0 != 0);
   CHECK_FALSE(closure.is_open(0));
   CHECK(closure.is_closed(0));
 
   unique_closures.insert(closure);
 
   closure.close(64);
-  {
-    // NOTE(MXG): This is an implementation-specific expectation which can be
-    // relaxed if the implementation of the hash function is ever changed in the
-    // future.
-    CHECK(closure.hash() == 1);
-  }
+  CHECK(closure.hash() != hash_0);
+  CHECK(closure.hash() != 0);
   CHECK_FALSE(closure.is_open(0));
   CHECK(closure.is_closed(0));
   CHECK_FALSE(closure.is_open(64));
   CHECK(closure.is_closed(64));
 
   // Since the value of the closure has changed, it should occupy a new spot in
-  // the set of unique closures, even though its hash has not changed.
+  // the set of unique closures.
   unique_closures.insert(closure);
   CHECK(unique_closures.size() == 2);
 
@@ -108,6 +105,33 @@ SCENARIO("Test LaneClosure class functions")
   // We should just be inserting the same closure value that we did originally,
   // so there should still only be 2 closures in the unique set.
   CHECK(unique_closures.size() == 2);
+  CHECK(closure.hash() == hash_0);
+}
+
+//==============================================================================
+SCENARIO("LaneClosure hash does not depend on the order of changes")
+{
+  rmf_traffic::agv::LaneClosure a;
+  a.close(3).close(70).close(200).close(5);
+
+  rmf_traffic::agv::LaneClosure b;
+  b.close(200).close(5).close(1).close(70).close(3).open(1);
+
+  CHECK(a == b);
+  CHECK(a.hash() == b.hash());
+  CHECK(a.closed_lanes() == std::vector<std::size_t>({3, 5, 70, 200}));
+
+  // Closing a lane that is already closed changes nothing
+  b.close(70);
+  CHECK(a.hash() == b.hash());
+
+  // Opening every lane gives back a closure that equals the default one
+  for (const std::size_t lane : a.closed_lanes())
+    a.open(lane);
+
+  CHECK(a == rmf_traffic::agv::LaneClosure());
+  CHECK(a.hash() == 0);
+  CHECK(a.closed_lanes().empty());
 }
 
 SCENARIO("Fuzz test of LaneClosure", "[debug]")
@@ -26,6 +26,7 @@
 #include <rmf_utils/catch.hpp>
 
 #include <iostream>
+#include <set>
 
 //==============================================================================
 Eigen::Vector3d get_location(
@@ -453,6 +454,22 @@ SCENARIO("Test cycling through all negotiation alternatives")
     rmf_traffic::agv::NegotiatingRouteValidator::Generator(
     table->viewer(), profile).all();
 
+  // Every combination of alternatives is enumerated exactly once
+  auto enumerator = rmf_traffic::agv::NegotiatingRouteValidator::Generator(
+    table->viewer(), profile).enumerate();
+  CHECK(enumerator.remaining() == validators.size());
+  std::set<std::vector<uint64_t>> combinations;
+  while (const auto v = enumerator.next())
+  {
+    std::vector<uint64_t> versions;
+    for (const auto& key : v->alternatives())
+      versions.push_back(key.version);
+
+    CHECK(combinations.insert(versions).second);
+  }
+  CHECK(combinations.size() == validators.size());
+  CHECK(enumerator.remaining() == 0);
+
   const auto start_0 = rmf_traffic::agv::Plan::Start(now, 0, 0.0);
   const auto goal_0 = rmf_traffic::agv::Plan::Goal(10);
   for (const auto& v : validators)
@@ -28,6 +28,7 @@
 
 #include <rmf_utils/catch.hpp>
 
+#include <future>
 #include <iostream>
 
 //==============================================================================
@@ -210,6 +211,99 @@ SCENARIO("Test Plan Negotiation Between Two Participants")
         nullptr, nullptr, rmf_utils::nullopt, rmf_utils::nullopt, wait_time)
     };
 
+    GIVEN("Negotiator #1 responds in the background")
+    {
+      const auto table = negotiation->table(p1.id(), {});
+      auto finished = std::make_shared<std::promise<std::size_t>>();
+      auto pending = negotiator_1.respond_async(
+        table->viewer(),
+        rmf_traffic::schedule::SimpleResponder::make(table),
+        [finished](
+          const rmf_traffic::agv::SimpleNegotiator::PendingResponse& response)
+        {
+          finished->set_value(response.get().responses);
+        });
+
+      auto future = finished->get_future();
+      REQUIRE(future.wait_for(10s) == std::future_status::ready);
+      CHECK(future.get() == 1);
+      REQUIRE(pending.ready());
+      CHECK(pending.get().cancelled_responses == 0);
+      CHECK_FALSE(pending.cancelled());
+      CHECK(table->submission());
+
+      // Nobody needs a response for a table that has become defunct
+      const auto child = negotiation->table(p2.id(), {p1.id()});
+      REQUIRE(child);
+      table->forfeit(table->version() + 1);
+      REQUIRE(child->defunct());
+
+      rmf_traffic::agv::SimpleNegotiator negotiator_2{
+        p2.plan_id_assigner(),
+        plan_2->get_start(),
+        plan_2.get_goal(),
+        configuration
+      };
+
+      pending = negotiator_2.respond_async(
+        child->viewer(),
+        rmf_traffic::schedule::SimpleResponder::make(child));
+      CHECK(pending.get().cancelled_responses == 1);
+      CHECK_FALSE(child->submission());
+      CHECK(negotiator_2.statistics().cancelled_responses == 1);
+    }
+
+    GIVEN("A background response whose responder throws")
+    {
+      class ThrowingResponder
+        : public rmf_traffic::schedule::Negotiator::Responder
+      {
+      public:
+        void submit(
+          rmf_traffic::PlanId,
+          std::vector<rmf_traffic::Route>,
+          ApprovalCallback) const final
+        {
+          throw std::runtime_error("submit");
+        }
+
+        void reject(const Alternatives&) const final
+        {
+          throw std::runtime_error("reject");
+        }
+
+        void forfeit(const std::vector<ParticipantId>&) const final
+        {
+          throw std::runtime_error("forfeit");
+        }
+      };
+
+      const auto table = negotiation->table(p1.id(), {});
+      auto finished = std::make_shared<std::promise<bool>>();
+      const auto pending = negotiator_1.respond_async(
+        table->viewer(),
+        std::make_shared<ThrowingResponder>(),
+        [finished](
+          const rmf_traffic::agv::SimpleNegotiator::PendingResponse& response)
+        {
+          try
+          {
+            response.get();
+            finished->set_value(false);
+          }
+          catch (const std::runtime_error&)
+          {
+            finished->set_value(true);
+          }
+        });
+
+      // The callback still hears about the job when it fails
+      auto future = finished->get_future();
+      REQUIRE(future.wait_for(10s) == std::future_status::ready);
+      CHECK(future.get());
+      CHECK_THROWS_AS(pending.get(), std::runtime_error);
+    }
+
     GIVEN("Negotiator #2 is a SimpleNegotiator")
     {
       rmf_traffic::agv::SimpleNegotiator negotiator_2{
@@ -268,6 +362,97 @@ SCENARIO("Test Plan Negotiation Between Two Participants")
       //print_proposal(*proposals);
     }
 
+    GIVEN("Negotiator #1 reuses its search results")
+    {
+      auto options = rmf_traffic::agv::SimpleNegotiator::Options(
+        nullptr, nullptr, rmf_utils::nullopt, rmf_utils::nullopt, wait_time);
+      CHECK_FALSE(options.reuse_search_results());
+      options.reuse_search_results(true);
+      CHECK(options.reuse_search_results());
+
+      rmf_traffic::agv::SimpleNegotiator reusing_negotiator{
+        p1.plan_id_assigner(),
+        plan_1->get_start(),
+        plan_1.get_goal(),
+        configuration,
+        options
+      };
+
+      auto first_table = negotiation->table(p1.id(), {});
+      reusing_negotiator.respond(
+        first_table->viewer(),
+        rmf_traffic::schedule::SimpleResponder::make(first_table));
+      REQUIRE(first_table->submission());
+
+      // The schedule has not changed, so a table with the same constraints in
+      // another negotiation gets the same response
+      auto other_negotiation = *rmf_traffic::schedule::Negotiation::make(
+        database, {p1.id(), p2.id()});
+      auto second_table = other_negotiation.table(p1.id(), {});
+      reusing_negotiator.respond(
+        second_table->viewer(),
+        rmf_traffic::schedule::SimpleResponder::make(second_table));
+      REQUIRE(second_table->submission());
+
+      const auto& first = *first_table->submission();
+      const auto& second = *second_table->submission();
+      REQUIRE(first.size() == second.size());
+      for (std::size_t i = 0; i < first.size(); ++i)
+      {
+        CHECK(first[i].trajectory().size() == second[i].trajectory().size());
+        CHECK(*first[i].trajectory().finish_time()
+          == *second[i].trajectory().finish_time());
+      }
+    }
+
+    GIVEN("Negotiator #1 responds to a batch of tables")
+    {
+      rmf_traffic::agv::SimpleNegotiator batch_negotiator{
+        p1.plan_id_assigner(),
+        plan_1->get_start(),
+        plan_1.get_goal(),
+        configuration,
+        rmf_traffic::agv::SimpleNegotiator::Options(
+          nullptr, nullptr, rmf_utils::nullopt, rmf_utils::nullopt, wait_time)
+      };
+
+      auto other_negotiation = *rmf_traffic::schedule::Negotiation::make(
+        database, {p1.id(), p2.id()});
+
+      const auto first_table = negotiation->table(p1.id(), {});
+      const auto second_table = other_negotiation.table(p1.id(), {});
+
+      const auto stats = batch_negotiator.respond_batch_with_statistics(
+        {
+          {
+            first_table->viewer(),
+            rmf_traffic::schedule::SimpleResponder::make(first_table)
+          },
+          {
+            second_table->viewer(),
+            rmf_traffic::schedule::SimpleResponder::make(second_table)
+          }
+        });
+
+      REQUIRE(first_table->submission());
+      REQUIRE(second_table->submission());
+
+      // Both tables have the same constraints, so one plan answers both
+      CHECK(stats.responses == 2);
+      CHECK(stats.batched_responses == 2);
+      CHECK(stats.planning_attempts == 1);
+      CHECK(batch_negotiator.statistics().batched_responses == 2);
+
+      const auto& first = *first_table->submission();
+      const auto& second = *second_table->submission();
+      REQUIRE(first.size() == second.size());
+      for (std::size_t i = 0; i < first.size(); ++i)
+      {
+        CHECK(*first[i].trajectory().finish_time()
+          == *second[i].trajectory().finish_time());
+      }
+    }
+
     GIVEN("Negotiator #2 is a StubbornNegotiator")
     {
       rmf_traffic::schedule::StubbornNegotiator negotiator_2{ p2 };
@@ -497,6 +682,103 @@ SCENARIO("Multi-participant negotiation")
 
   auto result = CentralizedNegotiation(database).solve(agents);
   REQUIRE(result.proposal().has_value());
+
+  const auto& stats = result.statistics();
+  CHECK(stats.negotiation.tables_created >= agents.size());
+  REQUIRE_FALSE(stats.responses.empty());
+  std::size_t expansions = 0;
+  for (const auto& response : stats.responses)
+  {
+    CHECK(response.work.responses == 1);
+    CHECK(response.work.time <= stats.time);
+    expansions += response.work.expansions;
+  }
+  CHECK(expansions > 0);
+
+  WHEN("The tables are responded to in parallel")
+  {
+    const auto parallel = CentralizedNegotiation(database).threads(4);
+    const auto first = parallel.solve(agents);
+    REQUIRE(first.proposal().has_value());
+    CHECK(first.proposal()->size() == agents.size());
+
+    // The responses are applied in a fixed order, so solving again must give
+    // the same proposal.
+    const auto second = parallel.solve(agents);
+    REQUIRE(second.proposal().has_value());
+    for (const auto& [id, plan] : *first.proposal())
+    {
+      const auto& other = second.proposal()->at(id);
+      REQUIRE(plan.get_waypoints().size() == other.get_waypoints().size());
+      CHECK(plan.get_waypoints().back().time()
+        == other.get_waypoints().back().time());
+    }
+  }
+
+  WHEN("The most promising tables are responded to first")
+  {
+    const auto best_first = CentralizedNegotiation(database)
+      .best_first().solve(agents);
+    REQUIRE(best_first.proposal().has_value());
+    CHECK(best_first.proposal()->size() == agents.size());
+
+    const auto optimal = CentralizedNegotiation(database)
+      .optimal().best_first().solve(agents);
+    REQUIRE(optimal.proposal().has_value());
+    CHECK(optimal.proposal()->size() == agents.size());
+  }
+
+  WHEN("The negotiation is solved incrementally")
+  {
+    auto incremental = CentralizedNegotiation(database).incremental();
+
+    const auto count_planning = [](const CentralizedNegotiation::Result& r)
+      {
+        std::size_t attempts = 0;
+        for (const auto& response : r.statistics().responses)
+          attempts += response.work.planning_attempts;
+
+        return attempts;
+      };
+
+    const auto first = incremental.solve(agents);
+    REQUIRE(first.proposal().has_value());
+    CHECK(count_planning(first) > 0);
+
+    // Nothing has changed, so every planning attempt can be reused
+    const auto second = incremental.solve(agents);
+    REQUIRE(second.proposal().has_value());
+    CHECK(count_planning(second) == 0);
+    for (const auto& [id, plan] : *first.proposal())
+    {
+      const auto& other = second.proposal()->at(id);
+      REQUIRE(plan.get_waypoints().size() == other.get_waypoints().size());
+      CHECK(plan.get_waypoints().back().time()
+        == other.get_waypoints().back().time());
+    }
+
+    // Only the agent whose goal changed needs to plan from scratch
+    auto changed = agents;
+    changed[2].goal(0);
+    const auto third = incremental.solve(changed);
+    REQUIRE(third.proposal().has_value());
+    CHECK(third.proposal()->at(2).get_waypoints().back().graph_index()
+      == std::optional<std::size_t>(0));
+
+    incremental.forget();
+    const auto fourth = incremental.solve(changed);
+    REQUIRE(fourth.proposal().has_value());
+    CHECK(count_planning(fourth) >= count_planning(third));
+  }
+
+  WHEN("There is no time to negotiate")
+  {
+    const auto rushed = CentralizedNegotiation(database)
+      .time_budget(rmf_traffic::Duration(0)).log().solve(agents);
+    CHECK_FALSE(rushed.proposal().has_value());
+    REQUIRE_FALSE(rushed.log().empty());
+    CHECK(rushed.log().back() == "Ran out of time");
+  }
 }
 
 // Helper Definitions
@@ -25,10 +25,14 @@
 
 #include "../utils_Trajectory.hpp"
 
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <iomanip>
 #include <thread>
 #include <iostream>
 #include <limits>
+#include <memory_resource>
 
 // TODO(MXG): Move performance testing content into a performance test folder
 const bool test_performance = false;
@@ -2398,6 +2402,60 @@ SCENARIO("Graph with door", "[door]")
   CHECK(has_event(ExpectEvent::DoorClose, *plan_with_door_open_close));
 }
 
+SCENARIO("Door events in the middle of a plan", "[door]")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::agv::Graph;
+  using Event = Graph::Lane::Event;
+  using DoorOpen = Graph::Lane::DoorOpen;
+  using DoorClose = Graph::Lane::DoorClose;
+
+  // The door lane sits between ordinary lanes, so the nodes before its exit
+  // event are followed by a node that keeps its own routes.
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  graph.add_waypoint(test_map_name, {  0, 0}); // 0
+  graph.add_waypoint(test_map_name, {  5, 0}); // 1
+  graph.add_waypoint(test_map_name, { 10, 0}); // 2
+  graph.add_waypoint(test_map_name, { 15, 0}); // 3
+  graph.add_waypoint(test_map_name, { 20, 0}); // 4
+
+  graph.add_lane(0, 1);
+  graph.add_lane(
+    {1, Event::make(DoorOpen("door", 4s))},
+    {2, Event::make(DoorClose("door", 4s))});
+  graph.add_lane(2, 3);
+  graph.add_lane(3, 4);
+
+  const rmf_traffic::agv::VehicleTraits traits(
+    {0.7, 0.3}, {1.0, 0.45}, create_test_profile(UnitCircle));
+
+  rmf_traffic::schedule::Database database;
+  rmf_traffic::agv::Planner::Options options{
+    make_test_schedule_validator(database, traits.profile())};
+
+  rmf_traffic::agv::Planner planner{
+    rmf_traffic::agv::Planner::Configuration{graph, traits},
+    options
+  };
+
+  const rmf_traffic::Time start_time = std::chrono::steady_clock::now();
+  const auto plan = planner.plan(
+    rmf_traffic::agv::Planner::Start(start_time, 0, 0.0),
+    rmf_traffic::agv::Planner::Goal(4));
+
+  REQUIRE(plan);
+  REQUIRE(plan->get_itinerary().size() == 1);
+  CHECK(count_events(*plan) == 2);
+  CHECK(has_event(ExpectEvent::DoorOpen, *plan));
+  CHECK(has_event(ExpectEvent::DoorClose, *plan));
+
+  const auto& trajectory = plan->get_itinerary().front().trajectory();
+  CHECK(*trajectory.start_time() == start_time);
+  CHECK((trajectory.back().position().block<2, 1>(0, 0)
+    - Eigen::Vector2d(20, 0)).norm() == Approx(0.0).margin(1e-6));
+}
+
 SCENARIO("Test planner with various start conditions")
 {
   using namespace std::chrono_literals;
@@ -3964,3 +4022,2128 @@ SCENARIO("Test dependencies", "[deps]")
   CHECK(found_waypoint_on_1);
   CHECK(found_waypoint_on_3);
 }
+
+//==============================================================================
+SCENARIO("Search several starts in parallel", "[search_threads]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  graph.add_waypoint(test_map_name, {0, -5}); // 0
+  graph.add_waypoint(test_map_name, {-5, 0}); // 1
+  graph.add_waypoint(test_map_name, {0, 0}); // 2
+  graph.add_waypoint(test_map_name, {5, 0}); // 3
+  graph.add_waypoint(test_map_name, {0, 5}); // 4
+  graph.add_waypoint(test_map_name, {10, 5}); // 5
+
+  graph.add_lane(0, 2);
+  graph.add_lane(2, 0);
+  graph.add_lane(1, 2);
+  graph.add_lane(2, 1);
+  graph.add_lane(3, 2);
+  graph.add_lane(2, 3);
+  graph.add_lane(4, 2);
+  graph.add_lane(2, 4);
+  graph.add_lane(3, 5);
+  graph.add_lane(5, 3);
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options serial_options{nullptr};
+  const Planner planner{Planner::Configuration{graph, traits}, serial_options};
+
+  auto parallel_options = serial_options;
+  parallel_options.search_threads(4);
+  CHECK(parallel_options.search_threads() == 4);
+  CHECK(serial_options.search_threads() == 1);
+
+  const auto initial_time = std::chrono::steady_clock::now();
+  const Planner::StartSet starts = {
+    Planner::Start{initial_time, 0, 0.0},
+    Planner::Start{initial_time, 1, M_PI/2.0},
+    Planner::Start{initial_time, 3, M_PI},
+    Planner::Start{initial_time, 5, -M_PI/2.0}
+  };
+
+  for (const std::size_t goal : {2u, 4u, 5u})
+  {
+    const auto serial = planner.plan(starts, goal, serial_options);
+    const auto parallel = planner.plan(starts, goal, parallel_options);
+    REQUIRE(serial.success());
+    REQUIRE(parallel.success());
+
+    CHECK(parallel->get_cost() == Approx(serial->get_cost()));
+    CHECK(parallel->get_start().waypoint() == serial->get_start().waypoint());
+  }
+}
+
+//==============================================================================
+SCENARIO("Validate expansions in parallel", "[expansion_threads]")
+{
+  using namespace std::chrono_literals;
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  // A 4x4 grid of two way lanes
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  const std::size_t W = 4;
+  for (std::size_t i = 0; i < W; ++i)
+  {
+    for (std::size_t j = 0; j < W; ++j)
+      graph.add_waypoint(test_map_name, {5.0*j, 5.0*i}).set_holding_point(true);
+  }
+
+  for (std::size_t i = 0; i < W; ++i)
+  {
+    for (std::size_t j = 0; j+1 < W; ++j)
+    {
+      graph.add_lane(W*i + j, W*i + j + 1);
+      graph.add_lane(W*i + j + 1, W*i + j);
+      graph.add_lane(W*j + i, W*(j+1) + i);
+      graph.add_lane(W*(j+1) + i, W*j + i);
+    }
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  rmf_traffic::schedule::Database database;
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_Planner",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  // The obstacle sits in the middle of the grid for half a minute
+  const auto now = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory t;
+  t.insert(now, {5.0, 5.0, 0.0}, {0.0, 0.0, 0.0});
+  t.insert(now + 30s, {5.0, 5.0, 0.0}, {0.0, 0.0, 0.0});
+  database.extend(obstacle.id(), {{test_map_name, t}}, 0);
+
+  const Planner::Options serial_options{
+    make_test_schedule_validator(database, profile)};
+  const Planner planner{Planner::Configuration{graph, traits}, serial_options};
+
+  auto parallel_options = serial_options;
+  parallel_options.expansion_threads(4);
+  CHECK(parallel_options.expansion_threads() == 4);
+  CHECK(serial_options.expansion_threads() == 1);
+
+  const Planner::Start start{now, 0, 0.0};
+  for (const std::size_t goal : {W*W - 1, W + 2, 2*W + 1})
+  {
+    const auto serial = planner.plan(start, goal, serial_options);
+    const auto parallel = planner.plan(start, goal, parallel_options);
+    REQUIRE(serial.success());
+    REQUIRE(parallel.success());
+
+    // The children are pushed in the same order as a serial search would push
+    // them, so the two searches are the same
+    CHECK(parallel->get_cost() == Approx(serial->get_cost()));
+    CHECK(parallel.statistics().nodes_expanded
+      == serial.statistics().nodes_expanded);
+    CHECK(parallel.statistics().validator_calls
+      == serial.statistics().validator_calls);
+  }
+}
+
+//==============================================================================
+SCENARIO("Hash distributed search", "[hash_distributed]")
+{
+  using namespace std::chrono_literals;
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  // A 5x5 grid of two way lanes
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  const std::size_t W = 5;
+  for (std::size_t i = 0; i < W; ++i)
+  {
+    for (std::size_t j = 0; j < W; ++j)
+      graph.add_waypoint(test_map_name, {5.0*j, 5.0*i}).set_holding_point(true);
+  }
+
+  for (std::size_t i = 0; i < W; ++i)
+  {
+    for (std::size_t j = 0; j+1 < W; ++j)
+    {
+      graph.add_lane(W*i + j, W*i + j + 1);
+      graph.add_lane(W*i + j + 1, W*i + j);
+      graph.add_lane(W*j + i, W*(j+1) + i);
+      graph.add_lane(W*(j+1) + i, W*j + i);
+    }
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  rmf_traffic::schedule::Database database;
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_Planner",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  const Planner::Options serial_options{
+    make_test_schedule_validator(database, profile)};
+  const Planner planner{Planner::Configuration{graph, traits}, serial_options};
+
+  auto distributed_options = serial_options;
+  distributed_options.search_threads(4).hash_distributed_search(true);
+  CHECK(distributed_options.hash_distributed_search());
+  CHECK_FALSE(serial_options.hash_distributed_search());
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+
+  const auto compare = [&]()
+    {
+      for (const std::size_t goal : {W*W - 1, 2*W + 2, W - 1})
+      {
+        const auto serial = planner.plan(start, goal, serial_options);
+        const auto distributed = planner.plan(start, goal, distributed_options);
+        REQUIRE(serial.success());
+        REQUIRE(distributed.success());
+        CHECK(distributed->get_cost() == Approx(serial->get_cost()));
+      }
+    };
+
+  WHEN("Nothing is in the way")
+  {
+    compare();
+  }
+
+  WHEN("The middle of the grid is blocked for a while")
+  {
+    // The obstacle stands on the goal in the middle of the grid for a minute
+    // and then leaves the graph
+    rmf_traffic::Trajectory t;
+    t.insert(now, {10.0, 10.0, 0.0}, {0.0, 0.0, 0.0});
+    t.insert(now + 60s, {10.0, 10.0, 0.0}, {0.0, 0.0, 0.0});
+    t.insert(now + 65s, {10.0, 30.0, 0.0}, {0.0, 0.0, 0.0});
+    database.extend(obstacle.id(), {{test_map_name, t}}, 0);
+
+    compare();
+
+    const auto distributed = planner.plan(start, 2*W + 2, distributed_options);
+    REQUIRE(distributed.success());
+    const auto& trajectory = distributed->get_itinerary().back().trajectory();
+    CHECK(*trajectory.finish_time() > now + 60s);
+  }
+}
+
+//==============================================================================
+SCENARIO("Plan asynchronously", "[async]")
+{
+  using namespace std::chrono_literals;
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  graph.add_waypoint(test_map_name, {0, 0}); // 0
+  graph.add_waypoint(test_map_name, {10, 0}); // 1
+  graph.add_waypoint(test_map_name, {10, 10}); // 2
+  graph.add_lane(0, 1);
+  graph.add_lane(1, 0);
+  graph.add_lane(1, 2);
+  graph.add_lane(2, 1);
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options options{nullptr};
+  const Planner planner{Planner::Configuration{graph, traits}, options};
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+
+  auto executor = rmf_traffic::agv::PlanExecutor::make(2);
+  CHECK(executor->threads() == 2);
+
+  WHEN("The plan is given time to finish")
+  {
+    const auto expected = planner.plan(start, 2, options);
+    REQUIRE(expected.success());
+
+    auto pending = planner.plan_async(start, 2, options, std::nullopt, executor);
+    CHECK(pending.wait_for(10s));
+    CHECK(pending.ready());
+
+    const auto& result = pending.get();
+    REQUIRE(result.success());
+    CHECK(result->get_cost() == Approx(expected->get_cost()));
+    CHECK(pending.expansions() > 0);
+    CHECK(pending.queue_delay().has_value());
+    CHECK(pending.compute_time().has_value());
+    CHECK_FALSE(pending.cancelled());
+  }
+
+  WHEN("The deadline has already passed")
+  {
+    auto pending = planner.plan_async(start, 2, options, now, executor);
+    const auto& result = pending.get();
+    CHECK_FALSE(result.success());
+    CHECK(result.interrupted());
+
+    // The result can still be finished later
+    auto resumed = result;
+    CHECK(resumed.resume());
+  }
+
+  WHEN("Several plans share the executor")
+  {
+    std::vector<Planner::PendingResult> pending;
+    for (std::size_t i = 0; i < 8; ++i)
+      pending.push_back(planner.plan_async(start, 2, options, std::nullopt,
+        executor));
+
+    for (const auto& p : pending)
+      CHECK(p.get().success());
+
+    const auto give_up = std::chrono::steady_clock::now() + 10s;
+    while (executor->statistics().jobs < pending.size()
+      && std::chrono::steady_clock::now() < give_up)
+    {
+      std::this_thread::sleep_for(1ms);
+    }
+
+    const auto stats = executor->statistics();
+    CHECK(stats.jobs == pending.size());
+    CHECK(stats.max_queue_delay <= stats.total_queue_delay);
+    CHECK(executor->queued() == 0);
+  }
+}
+
+//==============================================================================
+SCENARIO("Bounded suboptimal planning", "[suboptimality]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  // A grid gives the search many routes with nearly the same cost
+  const std::string test_map_name = "test_map";
+  const std::size_t N = 5;
+  Graph graph;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+      graph.add_waypoint(test_map_name, {5.0*i, 5.0*j});
+  }
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      const std::size_t k = i*N + j;
+      if (i+1 < N)
+      {
+        graph.add_lane(k, k+N);
+        graph.add_lane(k+N, k);
+      }
+
+      if (j+1 < N)
+      {
+        graph.add_lane(k, k+1);
+        graph.add_lane(k+1, k);
+      }
+    }
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  rmf_traffic::schedule::Database database;
+  const Planner::Options optimal_options{
+    make_test_schedule_validator(database, profile)};
+  const Planner planner{Planner::Configuration{graph, traits}, optimal_options};
+
+  auto bounded_options = optimal_options;
+  bounded_options.suboptimality_budget(0.5);
+  CHECK(bounded_options.suboptimality_budget() == Approx(0.5));
+  CHECK(optimal_options.suboptimality_budget() == Approx(0.0));
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+  const std::size_t goal = N*N - 1;
+
+  const auto optimal = planner.plan(start, goal, optimal_options);
+  REQUIRE(optimal.success());
+  REQUIRE(optimal.suboptimality_bound().has_value());
+  CHECK(*optimal.suboptimality_bound() == Approx(1.0).margin(1e-3));
+
+  const auto bounded = planner.plan(start, goal, bounded_options);
+  REQUIRE(bounded.success());
+  CHECK(bounded->get_cost() <= 1.5 * optimal->get_cost() + 1e-6);
+
+  REQUIRE(bounded.suboptimality_bound().has_value());
+  const double bound = *bounded.suboptimality_bound();
+  CHECK(1.0 <= bound);
+  CHECK(bound <= 1.5 + 1e-6);
+  CHECK(bounded->get_cost() <= bound * optimal->get_cost() + 1e-6);
+
+  const auto not_planned = planner.setup(start, goal, bounded_options);
+  CHECK_FALSE(not_planned.suboptimality_bound().has_value());
+}
+
+//==============================================================================
+SCENARIO("Anytime planning", "[anytime]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  const std::size_t N = 5;
+  Graph graph;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+      graph.add_waypoint(test_map_name, {5.0*i, 5.0*j});
+  }
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      const std::size_t k = i*N + j;
+      if (i+1 < N)
+      {
+        graph.add_lane(k, k+N);
+        graph.add_lane(k+N, k);
+      }
+
+      if (j+1 < N)
+      {
+        graph.add_lane(k, k+1);
+        graph.add_lane(k+1, k);
+      }
+    }
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  rmf_traffic::schedule::Database database;
+  const Planner::Options default_options{
+    make_test_schedule_validator(database, profile)};
+  const Planner planner{Planner::Configuration{graph, traits}, default_options};
+  CHECK_FALSE(default_options.deadline().has_value());
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+  const std::size_t goal = N*N - 1;
+
+  const auto optimal = planner.plan(start, goal, default_options);
+  REQUIRE(optimal.success());
+  CHECK_FALSE(optimal.incumbent());
+  REQUIRE(optimal.cost_gap().has_value());
+  CHECK(*optimal.cost_gap() == Approx(0.0).margin(1e-3));
+
+  WHEN("The deadline has already passed")
+  {
+    auto options = default_options;
+    options.deadline(std::chrono::steady_clock::now());
+
+    auto result = planner.plan(start, goal, options);
+    REQUIRE(result.success());
+    CHECK(result.incumbent());
+    CHECK(result.interrupted());
+    CHECK(optimal->get_cost() <= result->get_cost() + 1e-6);
+    REQUIRE(result.cost_gap().has_value());
+    CHECK(*result.cost_gap() >= 0.0);
+
+    THEN("Resuming without a deadline finds the best plan")
+    {
+      result.options().deadline(std::nullopt);
+      CHECK(result.resume());
+      CHECK_FALSE(result.incumbent());
+      CHECK(result->get_cost() == Approx(optimal->get_cost()).margin(1e-3));
+      REQUIRE(result.cost_gap().has_value());
+      CHECK(*result.cost_gap() == Approx(0.0).margin(1e-3));
+    }
+  }
+
+  WHEN("The deadline is generous")
+  {
+    auto options = default_options;
+    options.deadline(
+      std::chrono::steady_clock::now() + std::chrono::minutes(5));
+
+    const auto result = planner.plan(start, goal, options);
+    REQUIRE(result.success());
+    CHECK_FALSE(result.incumbent());
+    CHECK(result->get_cost() == Approx(optimal->get_cost()).margin(1e-3));
+  }
+
+  const auto not_planned = planner.setup(start, goal, default_options);
+  CHECK_FALSE(not_planned.incumbent());
+  CHECK_FALSE(not_planned.cost_gap().has_value());
+}
+
+//==============================================================================
+SCENARIO("Replan with the previous plan", "[replan]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  const std::size_t N = 5;
+  Graph graph;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+      graph.add_waypoint(test_map_name, {5.0*i, 5.0*j});
+  }
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    for (std::size_t j = 0; j < N; ++j)
+    {
+      const std::size_t k = i*N + j;
+      if (i+1 < N)
+      {
+        graph.add_lane(k, k+N);
+        graph.add_lane(k+N, k);
+      }
+
+      if (j+1 < N)
+      {
+        graph.add_lane(k, k+1);
+        graph.add_lane(k+1, k);
+      }
+    }
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  rmf_traffic::schedule::Database database;
+  const Planner::Options reuse_options{
+    make_test_schedule_validator(database, profile)};
+  CHECK(reuse_options.reuse_previous_plan());
+
+  auto fresh_options = reuse_options;
+  fresh_options.reuse_previous_plan(false);
+  CHECK_FALSE(fresh_options.reuse_previous_plan());
+
+  const Planner planner{Planner::Configuration{graph, traits}, reuse_options};
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+  const std::size_t goal = N*N - 1;
+
+  const auto result = planner.plan(start, goal);
+  REQUIRE(result.success());
+
+  // Pick up the plan from one of its waypoints
+  std::optional<Planner::Start> new_start;
+  const auto& waypoints = result->get_waypoints();
+  for (std::size_t i = waypoints.size()/2; i < waypoints.size(); ++i)
+  {
+    const auto& wp = waypoints[i];
+    if (wp.graph_index().has_value() && *wp.graph_index() != goal)
+    {
+      new_start =
+        Planner::Start{wp.time(), *wp.graph_index(), wp.position()[2]};
+      break;
+    }
+  }
+  REQUIRE(new_start.has_value());
+
+  const auto fresh = result.replan(*new_start, fresh_options);
+  REQUIRE(fresh.success());
+
+  const auto reused = result.replan(*new_start);
+  REQUIRE(reused.success());
+  CHECK(reused->get_cost() == Approx(fresh->get_cost()).margin(1e-3));
+  CHECK(reused->get_waypoints().back().graph_index() == goal);
+
+  WHEN("The new start is a little early")
+  {
+    auto early_start = *new_start;
+    early_start.time(early_start.time() - std::chrono::seconds(2));
+
+    const auto early_fresh = result.replan(early_start, fresh_options);
+    REQUIRE(early_fresh.success());
+
+    const auto early = result.replan(early_start);
+    REQUIRE(early.success());
+    CHECK(early->get_cost() <= early_fresh->get_cost() + 1e-3);
+  }
+}
+
+//==============================================================================
+SCENARIO("Planner result cache", "[result_cache]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 4; ++i)
+    graph.add_waypoint(test_map_name, {10.0*i, 0.0});
+
+  for (std::size_t i = 0; i+1 < 4; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  rmf_traffic::schedule::Database database;
+  const Planner::Options options{
+    make_test_schedule_validator(database, profile)};
+
+  // A search with these options stops before it can find anything, so a
+  // successful result must have come from the cache.
+  auto interrupted_options = options;
+  interrupted_options.interrupt_flag(std::make_shared<std::atomic_bool>(true));
+
+  Planner planner{Planner::Configuration{graph, traits}, options};
+  CHECK(planner.get_result_cache_capacity() == 0);
+  CHECK(planner.get_result_cache_eviction()
+    == Planner::CacheEviction::LeastRecentlyUsed);
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+
+  const auto first = planner.plan(start, 3);
+  REQUIRE(first.success());
+  CHECK_FALSE(planner.plan(start, 3, interrupted_options).success());
+
+  planner.set_result_cache_capacity(2);
+  CHECK(planner.get_result_cache_capacity() == 2);
+
+  const auto is_cached = [&](std::size_t goal)
+    {
+      return planner.plan(start, goal, interrupted_options).success();
+    };
+
+  REQUIRE(planner.plan(start, 3).success());
+  CHECK(is_cached(3));
+  CHECK(planner.setup(start, 3, interrupted_options).success());
+
+  const auto cached = planner.plan(start, 3, interrupted_options);
+  REQUIRE(cached.success());
+  CHECK(cached->get_cost() == Approx(first->get_cost()));
+
+  // A different start is not in the cache
+  CHECK_FALSE(
+    planner.plan(
+      Planner::Start{now + std::chrono::seconds(1), 0, 0.0},
+      3, interrupted_options).success());
+
+  WHEN("The schedule changes")
+  {
+    const auto version = database.latest_version();
+    database.register_participant(
+      rmf_traffic::schedule::ParticipantDescription{
+        "obstacle",
+        "test_Planner",
+        rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+        profile
+      });
+
+    REQUIRE(database.latest_version() != version);
+    CHECK_FALSE(is_cached(3));
+  }
+
+  WHEN("The least recently used result is evicted")
+  {
+    REQUIRE(planner.plan(start, 2).success());
+    CHECK(is_cached(3));
+    REQUIRE(planner.plan(start, 1).success());
+
+    CHECK(is_cached(3));
+    CHECK(is_cached(1));
+    CHECK_FALSE(is_cached(2));
+  }
+
+  WHEN("The first result in is evicted")
+  {
+    planner.set_result_cache_eviction(Planner::CacheEviction::FirstInFirstOut);
+    REQUIRE(planner.plan(start, 2).success());
+    CHECK(is_cached(3));
+    REQUIRE(planner.plan(start, 1).success());
+
+    CHECK_FALSE(is_cached(3));
+    CHECK(is_cached(2));
+    CHECK(is_cached(1));
+  }
+
+  WHEN("The cache is turned off")
+  {
+    planner.set_result_cache_capacity(0);
+    CHECK_FALSE(is_cached(3));
+  }
+}
+
+//==============================================================================
+SCENARIO("Persisted heuristic cache", "[heuristic_cache]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 5; ++i)
+    graph.add_waypoint(test_map_name, {10.0*i, 0.0});
+
+  for (std::size_t i = 0; i+1 < 5; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options options{nullptr};
+  const Planner::Configuration config{graph, traits};
+  CHECK_FALSE(config.heuristic_cache_file().has_value());
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+
+  Planner cold{config, options};
+  const auto cold_plan = cold.plan(start, 4);
+  REQUIRE(cold_plan.success());
+
+  const std::string file_path = "test_Planner_heuristic_cache.bin";
+  REQUIRE(cold.save_heuristic_cache(file_path));
+
+  WHEN("A planner preloads the file while it is constructed")
+  {
+    auto warm_config = config;
+    warm_config.heuristic_cache_file(file_path);
+    Planner warm{warm_config, options};
+
+    const auto warm_plan = warm.plan(start, 4);
+    REQUIRE(warm_plan.success());
+    CHECK(warm_plan->get_cost() == Approx(cold_plan->get_cost()));
+
+    // Preloading the same tables again is harmless
+    CHECK(warm.load_heuristic_cache(file_path));
+    CHECK(warm.plan(start, 4)->get_cost() == Approx(cold_plan->get_cost()));
+  }
+
+  WHEN("A planner has a different configuration")
+  {
+    auto lane_closures = config.lane_closures();
+    lane_closures.close(0);
+    auto other_config = config;
+    other_config.lane_closures(lane_closures);
+
+    Planner other{other_config, options};
+    CHECK_FALSE(other.load_heuristic_cache(file_path));
+
+    auto faster_config = config;
+    faster_config.vehicle_traits().linear().set_nominal_velocity(2.0);
+    Planner faster{faster_config, options};
+    CHECK_FALSE(faster.load_heuristic_cache(file_path));
+  }
+
+  WHEN("The file is missing or corrupted")
+  {
+    Planner planner{config, options};
+    CHECK_FALSE(planner.load_heuristic_cache(file_path + ".missing"));
+
+    {
+      std::ofstream output(file_path, std::ios::binary | std::ios::trunc);
+      output << "not a heuristic cache";
+    }
+
+    CHECK_FALSE(planner.load_heuristic_cache(file_path));
+
+    // A planner that ignores a bad file still works
+    auto bad_config = config;
+    bad_config.heuristic_cache_file(file_path);
+    Planner fallback{bad_config, options};
+    const auto fallback_plan = fallback.plan(start, 4);
+    REQUIRE(fallback_plan.success());
+    CHECK(fallback_plan->get_cost() == Approx(cold_plan->get_cost()));
+  }
+
+  std::remove(file_path.c_str());
+}
+
+//==============================================================================
+SCENARIO("Shared heuristic journal", "[heuristic_cache]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 5; ++i)
+    graph.add_waypoint(test_map_name, {10.0*i, 0.0});
+
+  for (std::size_t i = 0; i+1 < 5; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options options{nullptr};
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+
+  const std::string file_path = "test_Planner_heuristic_journal.bin";
+  const std::string archive_path = "test_Planner_heuristic_journal_copy.bin";
+  std::remove(file_path.c_str());
+
+  const auto file_size = [](const std::string& path)
+    {
+      std::ifstream input(path, std::ios::binary | std::ios::ate);
+      return static_cast<std::size_t>(input.tellg());
+    };
+
+  const auto journal_size = [&]() { return file_size(file_path); };
+
+  // The size of an archive tells us how many tables a planner has
+  const auto tables_size = [&](const Planner& planner)
+    {
+      REQUIRE(planner.save_heuristic_cache(archive_path));
+      return file_size(archive_path);
+    };
+
+  // Each planner gets its own copy of the graph, the same way that planners
+  // of different processes would, so they do not share a heuristic cache.
+  Planner first{Planner::Configuration{graph, traits}, options};
+  const auto first_plan = first.plan(start, 4);
+  REQUIRE(first_plan.success());
+  REQUIRE(first.sync_heuristic_cache(file_path));
+  const auto published = journal_size();
+  CHECK(published > 0);
+
+  // Syncing again has nothing new to publish
+  REQUIRE(first.sync_heuristic_cache(file_path));
+  CHECK(journal_size() == published);
+
+  Planner second{Planner::Configuration{graph, traits}, options};
+  const auto empty = tables_size(second);
+  CHECK(empty < tables_size(first));
+  REQUIRE(second.sync_heuristic_cache(file_path));
+  CHECK(tables_size(second) == tables_size(first));
+  CHECK(journal_size() == published);
+
+  const auto second_plan = second.plan(start, 4);
+  REQUIRE(second_plan.success());
+  CHECK(second_plan->get_cost() == Approx(first_plan->get_cost()));
+
+  WHEN("A planner publishes tables for a new goal")
+  {
+    const Planner::Start other_start{now, 4, 0.0};
+    REQUIRE(second.plan(other_start, 0).success());
+    REQUIRE(second.sync_heuristic_cache(file_path));
+    const auto grown = journal_size();
+    CHECK(published < grown);
+
+    const auto before = tables_size(first);
+    REQUIRE(first.sync_heuristic_cache(file_path));
+    CHECK(before < tables_size(first));
+    CHECK(tables_size(first) == tables_size(second));
+    CHECK(journal_size() == grown);
+  }
+
+  WHEN("A planner with a different configuration uses the same journal")
+  {
+    auto faster_config = Planner::Configuration{graph, traits};
+    faster_config.vehicle_traits().linear().set_nominal_velocity(2.0);
+    Planner faster{faster_config, options};
+    REQUIRE(faster.sync_heuristic_cache(file_path));
+    CHECK(tables_size(faster) == empty);
+
+    REQUIRE(faster.plan(start, 4).success());
+    REQUIRE(faster.sync_heuristic_cache(file_path));
+    CHECK(published < journal_size());
+
+    Planner third{Planner::Configuration{graph, traits}, options};
+    REQUIRE(third.sync_heuristic_cache(file_path));
+    CHECK(tables_size(third) == tables_size(second));
+  }
+
+  WHEN("The end of the journal is damaged")
+  {
+    {
+      std::ofstream output(file_path, std::ios::binary | std::ios::app);
+      output << "RMFJRNL";
+      output.put(0);
+      output << "cut short";
+    }
+
+    Planner third{Planner::Configuration{graph, traits}, options};
+    REQUIRE(third.sync_heuristic_cache(file_path));
+    CHECK(tables_size(third) == tables_size(second));
+    CHECK(third.plan(start, 4)->get_cost() == Approx(first_plan->get_cost()));
+  }
+
+  std::remove(file_path.c_str());
+  std::remove(archive_path.c_str());
+}
+
+//==============================================================================
+SCENARIO("Warm the heuristic cache", "[heuristic_cache]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j < 3; ++j)
+      graph.add_waypoint(test_map_name, {10.0*i, 10.0*j});
+  }
+
+  const auto connect = [&graph](std::size_t a, std::size_t b)
+    {
+      graph.add_lane(a, b);
+      graph.add_lane(b, a);
+    };
+
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j+1 < 3; ++j)
+    {
+      connect(3*i + j, 3*i + j + 1);
+      connect(3*j + i, 3*(j+1) + i);
+    }
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options options{nullptr};
+  const Planner::Configuration config{graph, traits};
+  const auto now = std::chrono::steady_clock::now();
+
+  Planner cold{config, options};
+  const auto expected = cold.plan(Planner::Start{now, 0, 0.0}, 8);
+  REQUIRE(expected.success());
+
+  WHEN("Some goals are warmed on several threads")
+  {
+    Planner planner{config, options};
+    planner.warm_cache({8, 4}, 3);
+
+    const auto result = planner.plan(Planner::Start{now, 0, 0.0}, 8);
+    REQUIRE(result.success());
+    CHECK(result->get_cost() == Approx(expected->get_cost()));
+
+    // The warmed tables can be saved for another planner
+    const std::string file_path = "test_Planner_warm_cache.bin";
+    REQUIRE(planner.save_heuristic_cache(file_path));
+    Planner other{config, options};
+    CHECK(other.load_heuristic_cache(file_path));
+    std::remove(file_path.c_str());
+  }
+
+  WHEN("Every goal is warmed")
+  {
+    Planner planner{config, options};
+    planner.warm_cache();
+
+    for (std::size_t goal = 0; goal < graph.num_waypoints(); ++goal)
+      CHECK(planner.plan(Planner::Start{now, 0, 0.0}, goal).success());
+  }
+
+  WHEN("A goal is not in the graph")
+  {
+    Planner planner{config, options};
+    CHECK_THROWS_AS(
+      planner.warm_cache({graph.num_waypoints()}), std::out_of_range);
+  }
+}
+
+//==============================================================================
+SCENARIO("Heuristic cache budget", "[heuristic_cache]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 6; ++i)
+    graph.add_waypoint(test_map_name, {10.0*i, 0.0});
+
+  for (std::size_t i = 0; i+1 < 6; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options options{nullptr};
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+
+  Planner::Configuration config{graph, traits};
+  CHECK_FALSE(config.heuristic_cache_budget().has_value());
+  CHECK(config.heuristic_cache_eviction()
+    == Planner::Configuration::HeuristicEviction::LeastRecentlyUsed);
+
+  Planner unbounded{config, options};
+  CHECK(unbounded.get_heuristic_cache_statistics().entries == 0);
+
+  std::vector<double> costs;
+  for (std::size_t goal = 1; goal < 6; ++goal)
+  {
+    const auto result = unbounded.plan(start, goal);
+    REQUIRE(result.success());
+    costs.push_back(result->get_cost());
+  }
+
+  const auto full = unbounded.get_heuristic_cache_statistics();
+  CHECK(full.entries > 0);
+  CHECK(full.bytes > 0);
+  CHECK(full.misses > 0);
+  CHECK(full.evictions == 0);
+
+  // The memory report covers the same heuristic entries, along with the other
+  // caches that planning filled in
+  const auto memory = unbounded.memory_usage();
+  CHECK(memory.heuristics.entries == full.entries);
+  CHECK(memory.heuristics.bytes >= full.bytes);
+  CHECK(memory.traversals.entries > 0);
+  CHECK(memory.traversals.bytes > 0);
+  CHECK(memory.total() > memory.heuristics.bytes);
+
+  // Planning to the same goal again reuses the cached heuristics
+  REQUIRE(unbounded.plan(start, 5).success());
+  CHECK(unbounded.get_heuristic_cache_statistics().hits > full.hits);
+
+  for (const auto policy : {
+      Planner::Configuration::HeuristicEviction::LeastRecentlyUsed,
+      Planner::Configuration::HeuristicEviction::CheapestToRecompute})
+  {
+    config.heuristic_cache_budget(full.bytes/4);
+    config.heuristic_cache_eviction(policy);
+    Planner bounded{config, options};
+
+    // Planning to the goals twice makes the bounded planner compute some of
+    // its discarded heuristics again, but its plans stay the same.
+    for (std::size_t round = 0; round < 2; ++round)
+    {
+      for (std::size_t goal = 1; goal < 6; ++goal)
+      {
+        const auto result = bounded.plan(start, goal);
+        REQUIRE(result.success());
+        CHECK(result->get_cost() == Approx(costs[goal-1]));
+      }
+    }
+
+    const auto stats = bounded.get_heuristic_cache_statistics();
+    CHECK(stats.evictions > 0);
+    CHECK(stats.bytes < full.bytes);
+  }
+}
+
+//==============================================================================
+SCENARIO("Planners with identical configurations", "[heuristic_cache]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 6; ++i)
+    graph.add_waypoint(test_map_name, {10.0*i, 0.0});
+
+  for (std::size_t i = 0; i+1 < 6; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options options{nullptr};
+  const Planner::Configuration config{graph, traits};
+
+  Planner first{config, options};
+  first.warm_cache();
+  const auto warmed = first.get_heuristic_cache_statistics();
+  REQUIRE(warmed.entries > 0);
+
+  WHEN("Another planner is made with a copy of the configuration")
+  {
+    auto copy = config;
+    const Planner second{copy, options};
+    CHECK(second.get_heuristic_cache_statistics().entries == warmed.entries);
+    CHECK(&second.get_configuration().graph() == &config.graph());
+  }
+
+  WHEN("Another planner is made for a different vehicle")
+  {
+    auto slower = config;
+    slower.vehicle_traits().linear().set_nominal_velocity(0.5);
+    const Planner second{slower, options};
+    CHECK(second.get_heuristic_cache_statistics().entries == 0);
+  }
+
+  WHEN("Another planner is made with an equal graph that is not shared")
+  {
+    const Planner second{Planner::Configuration{graph, traits}, options};
+    CHECK(second.get_heuristic_cache_statistics().entries == 0);
+  }
+
+  WHEN("The graph of a copy of the configuration is modified")
+  {
+    auto copy = config;
+    copy.graph().add_waypoint(test_map_name, {0.0, 10.0});
+    CHECK(copy.graph().num_waypoints() == 7);
+    CHECK(config.graph().num_waypoints() == 6);
+    CHECK(first.get_configuration().graph().num_waypoints() == 6);
+
+    const Planner second{copy, options};
+    CHECK(second.get_heuristic_cache_statistics().entries == 0);
+  }
+
+  WHEN("The graph is modified through a reference taken before a planner")
+  {
+    auto copy = config;
+    Graph& g = copy.graph();
+    const Planner second{copy, options};
+    const auto copy_of_copy = copy;
+
+    g.add_waypoint(test_map_name, {0.0, 10.0});
+    g.add_lane(0, 6);
+    CHECK(copy.graph().num_waypoints() == 7);
+    CHECK(second.get_configuration().graph().num_waypoints() == 6);
+    CHECK(copy_of_copy.graph().num_waypoints() == 6);
+    CHECK(config.graph().num_waypoints() == 6);
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto result = second.plan({now, 0, 0.0}, Planner::Goal{5});
+    REQUIRE(result);
+    CHECK(result->get_waypoints().back().graph_index() == 5);
+
+    const auto expected = first.plan({now, 0, 0.0}, Planner::Goal{5});
+    REQUIRE(expected);
+    CHECK(result->get_itinerary().back().trajectory().back().time()
+      == expected->get_itinerary().back().trajectory().back().time());
+  }
+}
+
+//==============================================================================
+SCENARIO("Lane closure overlay", "[heuristic_cache]")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+  using LaneClosure = rmf_traffic::agv::LaneClosure;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j < 3; ++j)
+      graph.add_waypoint(test_map_name, {10.0*i, 10.0*j});
+  }
+
+  const auto connect = [&graph](std::size_t a, std::size_t b)
+    {
+      graph.add_lane(a, b);
+      graph.add_lane(b, a);
+    };
+
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j+1 < 3; ++j)
+    {
+      connect(3*i + j, 3*i + j + 1);
+      connect(3*j + i, 3*(j+1) + i);
+    }
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options options{nullptr};
+  const Planner::Configuration config{graph, traits};
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+
+  Planner base{config, options};
+  base.warm_cache();
+  const auto warmed = base.get_heuristic_cache_statistics();
+  REQUIRE(warmed.entries > 0);
+
+  // Close the lanes that connect waypoints 4 and 5
+  LaneClosure closures;
+  closures.close(graph.lane_from(4, 5)->index());
+  closures.close(graph.lane_from(5, 4)->index());
+
+  WHEN("Lanes are closed")
+  {
+    const auto overlay = base.with_lane_closures(closures);
+    CHECK(overlay.get_configuration().lane_closures() == closures);
+    CHECK(base.get_configuration().lane_closures().is_open(
+        graph.lane_from(4, 5)->index()));
+
+    // The heuristics that do not cross the closed lanes are carried over
+    const auto carried = overlay.get_heuristic_cache_statistics();
+    CHECK(carried.entries > 0);
+    CHECK(carried.entries < warmed.entries);
+    CHECK(carried.hits == 0);
+
+    auto fresh_config = config;
+    fresh_config.lane_closures(closures);
+    const Planner fresh{fresh_config, options};
+
+    for (std::size_t goal = 1; goal < graph.num_waypoints(); ++goal)
+    {
+      const auto result = overlay.plan(start, goal);
+      const auto expected = fresh.plan(start, goal);
+      REQUIRE(result.success());
+      REQUIRE(expected.success());
+      CHECK(result->get_cost() == Approx(expected->get_cost()));
+
+      for (const auto& wp : result->get_waypoints())
+      {
+        for (const auto l : wp.approach_lanes())
+          CHECK(closures.is_open(l));
+      }
+    }
+
+    CHECK(overlay.get_heuristic_cache_statistics().hits > 0);
+
+    THEN("Opening the lanes again gives the plans of the base planner")
+    {
+      const auto reopened = overlay.with_lane_closures(LaneClosure());
+      for (std::size_t goal = 1; goal < graph.num_waypoints(); ++goal)
+      {
+        const auto result = reopened.plan(start, goal);
+        const auto expected = base.plan(start, goal);
+        REQUIRE(result.success());
+        REQUIRE(expected.success());
+        CHECK(result->get_cost() == Approx(expected->get_cost()));
+      }
+    }
+  }
+
+  WHEN("The closures do not change")
+  {
+    // The result shares the caches of the base planner
+    const auto same = base.with_lane_closures(LaneClosure());
+    CHECK(same.get_heuristic_cache_statistics().entries == warmed.entries);
+  }
+
+  WHEN("The lane closures of a planner are changed in place")
+  {
+    Planner planner = base;
+    planner.set_result_cache_capacity(8);
+    const auto before = planner.plan(start, 8);
+    REQUIRE(before.success());
+
+    planner.set_lane_closures(closures);
+    CHECK(planner.get_configuration().lane_closures() == closures);
+    CHECK(planner.get_result_cache_capacity() == 8);
+
+    const auto carried = planner.get_heuristic_cache_statistics();
+    CHECK(carried.entries > 0);
+    CHECK(carried.entries < warmed.entries);
+
+    for (std::size_t goal = 1; goal < graph.num_waypoints(); ++goal)
+    {
+      const auto result = planner.plan(start, goal);
+      REQUIRE(result.success());
+      for (const auto& wp : result->get_waypoints())
+      {
+        for (const auto l : wp.approach_lanes())
+          CHECK(closures.is_open(l));
+      }
+    }
+
+    // The result that was made before the change is not affected
+    CHECK(before->get_cost() == Approx(base.plan(start, 8)->get_cost()));
+  }
+}
+
+//==============================================================================
+SCENARIO("Quickest path matrix")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j < 3; ++j)
+      graph.add_waypoint(test_map_name, {10.0*i, 10.0*j});
+  }
+
+  // This waypoint is not connected to anything
+  graph.add_waypoint(test_map_name, {50.0, 50.0});
+
+  const auto connect = [&graph](std::size_t a, std::size_t b)
+    {
+      graph.add_lane(a, b);
+      graph.add_lane(b, a);
+    };
+
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (std::size_t j = 0; j+1 < 3; ++j)
+    {
+      connect(3*i + j, 3*i + j + 1);
+      connect(3*j + i, 3*(j+1) + i);
+    }
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner::Options options{nullptr};
+  const Planner::Configuration config{graph, traits};
+  const auto now = std::chrono::steady_clock::now();
+
+  const std::vector<Planner::StartSet> starts = {
+    {Planner::Start{now, 0, 0.0}},
+    {Planner::Start{now, 4, 0.0}, Planner::Start{now, 8, 0.0}},
+    {Planner::Start{now, 1, 0.0, Eigen::Vector2d(2.0, 0.0)}},
+    {}
+  };
+
+  const std::vector<std::size_t> goals = {8, 2, 0, 9, 4};
+
+  for (const std::size_t threads : {1, 3})
+  {
+    const Planner planner{config, options};
+    const auto matrix = planner.quickest_path_matrix(starts, goals, threads);
+    REQUIRE(matrix.size() == starts.size());
+
+    const Planner reference{config, options};
+    for (std::size_t i = 0; i < starts.size(); ++i)
+    {
+      REQUIRE(matrix[i].size() == goals.size());
+      for (std::size_t j = 0; j < goals.size(); ++j)
+      {
+        const auto expected = reference.quickest_path(starts[i], goals[j]);
+        REQUIRE(matrix[i][j].has_value() == expected.has_value());
+        if (!expected.has_value())
+          continue;
+
+        CHECK(matrix[i][j]->cost() == Approx(expected->cost()));
+        CHECK(matrix[i][j]->path() == expected->path());
+      }
+    }
+
+    // The unconnected waypoint cannot be reached, and the empty start set
+    // cannot reach anything
+    CHECK_FALSE(matrix[0][3].has_value());
+    for (const auto& path : matrix[3])
+      CHECK_FALSE(path.has_value());
+  }
+
+  const Planner planner{config, options};
+  CHECK_THROWS_AS(
+    planner.quickest_path_matrix(starts, {graph.num_waypoints()}),
+    std::out_of_range);
+}
+
+//==============================================================================
+SCENARIO("Plan to the nearest of several goals")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 5; ++i)
+    graph.add_waypoint(test_map_name, {10.0*i, 0.0});
+
+  // This waypoint is not connected to anything
+  graph.add_waypoint(test_map_name, {0.0, 50.0});
+
+  for (std::size_t i = 0; i+1 < 5; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{nullptr}};
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::StartSet starts = {Planner::Start{now, 1, 0.0}};
+
+  const auto cost_to = [&](std::size_t goal)
+    {
+      const auto result = planner.plan(starts, Planner::Goal{goal});
+      REQUIRE(result.success());
+      return result->get_cost();
+    };
+
+  WHEN("The goals have no cost offsets")
+  {
+    Planner::GoalSet goals;
+    goals.add(Planner::Goal{4}).add(Planner::Goal{5}).add(Planner::Goal{0});
+
+    const auto result = planner.plan(starts, goals);
+    REQUIRE(result.success());
+    CHECK(result.get_goal().waypoint() == 0);
+    CHECK(result->get_cost() == Approx(cost_to(0)));
+  }
+
+  WHEN("A cost offset makes a farther goal preferable")
+  {
+    Planner::GoalSet goals;
+    goals.add(Planner::Goal{0}, 1000.0).add(Planner::Goal{4});
+
+    const auto result = planner.plan(starts, goals);
+    REQUIRE(result.success());
+    CHECK(result.get_goal().waypoint() == 4);
+    CHECK(result->get_cost() == Approx(cost_to(4)));
+  }
+
+  WHEN("No goal can be reached")
+  {
+    Planner::GoalSet goals;
+    goals.add(Planner::Goal{5});
+    CHECK_FALSE(planner.plan(starts, goals).success());
+  }
+
+  WHEN("The set of goals is empty")
+  {
+    CHECK_THROWS_AS(
+      planner.plan(starts, Planner::GoalSet()), std::invalid_argument);
+  }
+}
+
+//==============================================================================
+SCENARIO("Planner search statistics")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::agv::Graph;
+  using rmf_traffic::agv::Planner;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 5; ++i)
+  {
+    graph.add_waypoint(test_map_name, {5.0 * static_cast<double>(i), 0.0})
+    .set_holding_point(true);
+  }
+
+  for (std::size_t i = 0; i+1 < 5; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{nullptr}};
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+
+  GIVEN("A plan without a validator")
+  {
+    const auto result = planner.plan(start, Planner::Goal{4});
+    REQUIRE(result.success());
+
+    const auto stats = result.statistics();
+    CHECK(stats.nodes_generated > 0);
+    CHECK(stats.validator_calls == 0);
+    CHECK(stats.validator_time == rmf_traffic::Duration(0));
+    CHECK(stats.hold_expansions == 0);
+    CHECK(stats.peak_memory > 0);
+    REQUIRE(stats.time_to_first_feasible.has_value());
+    CHECK(*stats.time_to_first_feasible <= stats.search_time);
+    REQUIRE(stats.heuristic_hit_rate().has_value());
+    CHECK(*stats.heuristic_hit_rate() >= 0.0);
+    CHECK(*stats.heuristic_hit_rate() <= 1.0);
+
+    WHEN("The same plan is requested again")
+    {
+      const auto again = planner.plan(start, Planner::Goal{4});
+      REQUIRE(again.success());
+
+      THEN("The heuristic is answered by the cache")
+      {
+        const auto again_stats = again.statistics();
+        CHECK(again_stats.heuristic_misses == 0);
+        CHECK(again_stats.heuristic_hits > 0);
+        CHECK(*again_stats.heuristic_hit_rate() == Approx(1.0));
+      }
+    }
+  }
+
+  GIVEN("An obstacle that the plan must wait for")
+  {
+    rmf_traffic::schedule::Database database;
+    const auto obstacle = database.register_participant(
+      rmf_traffic::schedule::ParticipantDescription{
+        "obstacle",
+        "test_Planner",
+        rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+        profile
+      });
+
+    // The obstacle sits on waypoint 2 for a while and then leaves the graph
+    rmf_traffic::Trajectory t;
+    t.insert(now, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+    t.insert(now + 20s, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+    t.insert(now + 25s, {10.0, 10.0, 0.0}, {0.0, 0.0, 0.0});
+    database.extend(obstacle.id(), {{test_map_name, t}}, 0);
+
+    Planner::Options options{
+      make_test_schedule_validator(database, profile)};
+
+    const auto result = planner.plan(start, Planner::Goal{4}, options);
+    REQUIRE(result.success());
+
+    const auto stats = result.statistics();
+    CHECK(stats.validator_calls > 0);
+    CHECK(stats.validator_time > rmf_traffic::Duration(0));
+    CHECK(stats.hold_expansions > 0);
+    CHECK(stats.nodes_expanded > 0);
+    CHECK(stats.peak_queue_size > 0);
+  }
+}
+
+//==============================================================================
+SCENARIO("Planner with a memory resource")
+{
+  using rmf_traffic::agv::Graph;
+  using rmf_traffic::agv::Planner;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    for (std::size_t j = 0; j < 4; ++j)
+    {
+      graph.add_waypoint(
+        test_map_name,
+        {5.0 * static_cast<double>(i), 5.0 * static_cast<double>(j)});
+    }
+  }
+
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    for (std::size_t j = 0; j+1 < 4; ++j)
+    {
+      graph.add_lane(4*i + j, 4*i + j+1);
+      graph.add_lane(4*i + j+1, 4*i + j);
+      graph.add_lane(4*j + i, 4*(j+1) + i);
+      graph.add_lane(4*(j+1) + i, 4*j + i);
+    }
+  }
+
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    create_test_profile(UnitCircle)};
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{nullptr}};
+
+  CHECK(planner.get_default_options().memory_resource() == nullptr);
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+  const auto expected = planner.plan(start, Planner::Goal{15});
+  REQUIRE(expected.success());
+
+  std::pmr::monotonic_buffer_resource arena;
+  auto options = planner.get_default_options();
+  options.memory_resource(&arena);
+  CHECK(options.memory_resource() == &arena);
+
+  const auto result = planner.plan(start, Planner::Goal{15}, options);
+  REQUIRE(result.success());
+  CHECK(result->get_cost() == Approx(expected->get_cost()));
+  CHECK(result->get_itinerary().size() == expected->get_itinerary().size());
+}
+
+//==============================================================================
+SCENARIO("Safe interval holding")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::agv::Graph;
+  using rmf_traffic::agv::Planner;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 5; ++i)
+  {
+    graph.add_waypoint(test_map_name, {5.0 * static_cast<double>(i), 0.0})
+    .set_holding_point(true);
+  }
+
+  for (std::size_t i = 0; i+1 < 5; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{nullptr}};
+
+  CHECK_FALSE(planner.get_default_options().safe_interval_holding());
+
+  rmf_traffic::schedule::Database database;
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_Planner",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  // The obstacle blocks the corridor at waypoint 2 for a minute and then
+  // leaves the graph
+  const auto now = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory t;
+  t.insert(now, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  t.insert(now + 60s, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  t.insert(now + 65s, {10.0, 10.0, 0.0}, {0.0, 0.0, 0.0});
+  database.extend(obstacle.id(), {{test_map_name, t}}, 0);
+
+  Planner::Options options{make_test_schedule_validator(database, profile)};
+  const Planner::Start start{now, 0, 0.0};
+  const auto stepped = planner.plan(start, Planner::Goal{4}, options);
+  REQUIRE(stepped.success());
+
+  options.safe_interval_holding(true);
+  CHECK(options.safe_interval_holding());
+  const auto interval = planner.plan(start, Planner::Goal{4}, options);
+  REQUIRE(interval.success());
+
+  // The plan may only be worse by one holding step
+  const double hold = rmf_traffic::time::to_seconds(
+    options.minimum_holding_time());
+  CHECK(interval->get_cost() <= stepped->get_cost() + hold + 1e-3);
+
+  // The plan still waits out the obstacle
+  const auto& trajectory = interval->get_itinerary().back().trajectory();
+  CHECK(*trajectory.finish_time() > now + 60s);
+
+  CHECK(interval.statistics().validator_calls
+    < stepped.statistics().validator_calls);
+}
+
+//==============================================================================
+SCENARIO("Squashing holds that were proven during the search", "[cruft]")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::agv::Graph;
+  using rmf_traffic::agv::Planner;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  graph.add_waypoint(test_map_name, {0.0, 0.0}); // 0
+  graph.add_waypoint(test_map_name, {5.0, 0.0}); // 1
+  graph.add_waypoint(test_map_name, {5.0, 5.0}); // 2
+
+  /*
+   *         2
+   *         |
+   *         |
+   *   0-----1
+   */
+
+  for (const std::size_t wp : {0, 2})
+  {
+    graph.add_lane(wp, 1);
+    graph.add_lane(1, wp);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  rmf_traffic::schedule::Database database;
+  const auto register_obstacle = [&](const std::string& name)
+    {
+      return database.register_participant(
+        rmf_traffic::schedule::ParticipantDescription{
+          name,
+          "test_Planner",
+          rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+          profile
+        }).id();
+    };
+
+  // The robot holds on waypoint 1, escapes to waypoint 2 while the chaser sits
+  // on waypoint 1, and then comes back through waypoint 1 to finish where it
+  // started. Squashing its visits to waypoint 1 would make a hold whose middle
+  // part was never proven during the search, which is when the chaser is there.
+  //
+  // The chaser first drives the robot off of waypoint 0, and then sits on
+  // waypoint 1 for a while before it leaves the graph.
+  const auto now = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory chaser;
+  chaser.insert(now + 1s, {-10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  chaser.insert(now + 4s, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  chaser.insert(now + 25s, {5.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  chaser.insert(now + 35s, {5.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  chaser.insert(now + 40s, {5.0, -10.0, 0.0}, {0.0, 0.0, 0.0});
+  database.extend(register_obstacle("chaser"), {{test_map_name, chaser}}, 0);
+
+  // The blocker keeps the robot off of waypoint 2 until the chaser is close,
+  // so the robot has to hold on waypoint 1 before it can escape.
+  rmf_traffic::Trajectory blocker;
+  blocker.insert(now, {5.0, 5.0, 0.0}, {0.0, 0.0, 0.0});
+  blocker.insert(now + 16s, {5.0, 5.0, 0.0}, {0.0, 0.0, 0.0});
+  blocker.insert(now + 21s, {5.0, 15.0, 0.0}, {0.0, 0.0, 0.0});
+  database.extend(register_obstacle("blocker"), {{test_map_name, blocker}}, 0);
+
+  Planner::Options options{make_test_schedule_validator(database, profile)};
+
+  WHEN("Holds are proven by validating them")
+  {
+    // Do nothing
+  }
+
+  WHEN("Holds are proven by safe intervals")
+  {
+    // The robot arrives at waypoint 1 through a lane, so its holds there are
+    // covered by a safe interval that ends when the chaser gets close.
+    options.safe_interval_holding(true);
+  }
+
+  const Planner planner{Planner::Configuration{graph, traits}, options};
+  const auto result = planner.plan(
+    Planner::Start{now, 0, 0.0}, Planner::Goal{0, now + 60s, 0.0});
+  REQUIRE(result.success());
+
+  bool before_obstacle = false;
+  bool after_obstacle = false;
+  for (const auto& wp : result->get_waypoints())
+  {
+    if (wp.graph_index() != 1)
+      continue;
+
+    before_obstacle |= wp.time() < now + 20s;
+    after_obstacle |= now + 40s < wp.time();
+  }
+
+  CHECK(before_obstacle);
+  CHECK(after_obstacle);
+
+  // The routes are checked directly against the obstacles, without any
+  // dependencies that the planner may have added to them.
+  for (const auto& route : result->get_itinerary())
+  {
+    for (const auto* obstacle : {&chaser, &blocker})
+    {
+      CHECK_FALSE(rmf_traffic::DetectConflict::between(
+          profile, route.trajectory(), nullptr, profile, *obstacle, nullptr));
+    }
+  }
+
+  CHECK(now + 60s <= result->get_waypoints().back().time());
+}
+
+//==============================================================================
+SCENARIO("Ideal plan first")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::agv::Graph;
+  using rmf_traffic::agv::Planner;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 5; ++i)
+  {
+    graph.add_waypoint(test_map_name, {5.0 * static_cast<double>(i), 0.0})
+    .set_holding_point(true);
+  }
+
+  for (std::size_t i = 0; i+1 < 5; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{nullptr}};
+
+  CHECK_FALSE(planner.get_default_options().ideal_plan_first());
+
+  rmf_traffic::schedule::Database database;
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_Planner",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+  Planner::Options options{make_test_schedule_validator(database, profile)};
+  Planner::Options ideal_options = options;
+  ideal_options.ideal_plan_first(true);
+  CHECK(ideal_options.ideal_plan_first());
+
+  GIVEN("Nothing in the way")
+  {
+    const auto searched = planner.plan(start, Planner::Goal{4}, options);
+    REQUIRE(searched.success());
+
+    const auto ideal = planner.plan(start, Planner::Goal{4}, ideal_options);
+    REQUIRE(ideal.success());
+
+    CHECK(ideal->get_cost() == Approx(searched->get_cost()));
+    CHECK(ideal.statistics().validator_calls
+      < searched.statistics().validator_calls);
+  }
+
+  GIVEN("An obstacle in the way")
+  {
+    // The obstacle blocks the corridor at waypoint 2 for a minute and then
+    // leaves the graph
+    rmf_traffic::Trajectory t;
+    t.insert(now, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+    t.insert(now + 60s, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+    t.insert(now + 65s, {10.0, 10.0, 0.0}, {0.0, 0.0, 0.0});
+    database.extend(obstacle.id(), {{test_map_name, t}}, 0);
+
+    const auto searched = planner.plan(start, Planner::Goal{4}, options);
+    REQUIRE(searched.success());
+
+    const auto ideal = planner.plan(start, Planner::Goal{4}, ideal_options);
+    REQUIRE(ideal.success());
+
+    // The plan is no worse for having tried the ideal plan first, and it
+    // still waits out the obstacle
+    CHECK(ideal->get_cost() == Approx(searched->get_cost()));
+    const auto& trajectory = ideal->get_itinerary().back().trajectory();
+    CHECK(*trajectory.finish_time() > now + 60s);
+  }
+}
+
+//==============================================================================
+/// A validator that approves everything while counting how often it gets used
+/// and copied
+class CountingValidator : public rmf_traffic::agv::RouteValidator
+{
+public:
+
+  struct Counts
+  {
+    std::atomic_size_t checks{0};
+    std::atomic_size_t clones{0};
+  };
+
+  CountingValidator(std::shared_ptr<Counts> counts)
+  : _counts(std::move(counts))
+  {
+    // Do nothing
+  }
+
+  std::optional<Conflict> find_conflict(const rmf_traffic::Route&) const final
+  {
+    ++_counts->checks;
+    return std::nullopt;
+  }
+
+  std::unique_ptr<RouteValidator> clone() const final
+  {
+    ++_counts->clones;
+    return std::make_unique<CountingValidator>(*this);
+  }
+
+private:
+  std::shared_ptr<Counts> _counts;
+};
+
+//==============================================================================
+SCENARIO("Share a validator between plans")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using Graph = rmf_traffic::agv::Graph;
+
+  const std::string test_map_name = "test_map";
+  Graph graph;
+  for (std::size_t i = 0; i < 4; ++i)
+    graph.add_waypoint(test_map_name, {10.0*i, 0.0});
+
+  for (std::size_t i = 0; i+1 < 4; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{nullptr}};
+
+  const auto counts = std::make_shared<CountingValidator::Counts>();
+  const auto now = std::chrono::steady_clock::now();
+  const Planner::Start start{now, 0, 0.0};
+
+  WHEN("The validator is shared")
+  {
+    const auto shared = std::make_shared<CountingValidator>(counts);
+    Planner::Options options{nullptr};
+    options.validator(shared);
+    CHECK_FALSE(options.validator());
+    CHECK(options.shared_validator() == shared);
+    CHECK(options.get_validator() == shared.get());
+
+    const auto copy = options;
+    CHECK(copy.get_validator() == shared.get());
+
+    const auto result = planner.plan(start, Planner::Goal{3}, options);
+    REQUIRE(result.success());
+    CHECK(result.options().get_validator() == shared.get());
+    CHECK(counts->checks > 0);
+    CHECK(counts->clones == 0);
+
+    options.validator(nullptr);
+    CHECK_FALSE(options.shared_validator());
+    CHECK(options.get_validator() == nullptr);
+  }
+
+  WHEN("The validator is cloned")
+  {
+    Planner::Options options{rmf_utils::make_clone<CountingValidator>(counts)};
+    CHECK(options.get_validator() == options.validator().get());
+
+    const auto copy = options;
+    CHECK(counts->clones > 0);
+    CHECK(copy.get_validator() != options.get_validator());
+
+    // Setting a shared validator replaces the cloned one
+    options.validator(std::make_shared<CountingValidator>(counts));
+    CHECK_FALSE(options.validator());
+    CHECK(options.get_validator() == options.shared_validator().get());
+  }
+}
+
+//==============================================================================
+/// Passes every check along to another validator, but raises an interrupt flag
+/// right before one of the interruptible checks
+class InterruptingValidator : public rmf_traffic::agv::RouteValidator
+{
+public:
+
+  InterruptingValidator(
+    std::shared_ptr<const RouteValidator> validator,
+    std::shared_ptr<std::atomic_bool> flag,
+    std::size_t interrupt_at)
+  : _validator(std::move(validator)),
+    _flag(std::move(flag)),
+    _interrupt_at(interrupt_at),
+    _checks(std::make_shared<std::atomic_size_t>(0))
+  {
+    // Do nothing
+  }
+
+  std::optional<Conflict> find_conflict(
+    const rmf_traffic::Route& route) const final
+  {
+    return _validator->find_conflict(route);
+  }
+
+  std::optional<Conflict> find_conflict(
+    const rmf_traffic::Route& route,
+    const rmf_traffic::DetectConflict::Options* options,
+    const Interrupter& interrupter) const final
+  {
+    if (++(*_checks) == _interrupt_at)
+      *_flag = true;
+
+    return _validator->find_conflict(route, options, interrupter);
+  }
+
+  std::unique_ptr<RouteValidator> clone() const final
+  {
+    return std::make_unique<InterruptingValidator>(*this);
+  }
+
+private:
+  std::shared_ptr<const RouteValidator> _validator;
+  std::shared_ptr<std::atomic_bool> _flag;
+  std::size_t _interrupt_at;
+  std::shared_ptr<std::atomic_size_t> _checks;
+};
+
+//==============================================================================
+SCENARIO("Interrupting the validator in the middle of a search")
+{
+  using Planner = rmf_traffic::agv::Planner;
+  using namespace std::chrono_literals;
+
+  const std::string test_map_name = "test_map";
+  rmf_traffic::agv::Graph graph;
+  for (std::size_t i = 0; i < 5; ++i)
+    graph.add_waypoint(test_map_name, {10.0*i, 0.0});
+
+  for (std::size_t i = 0; i+1 < 5; ++i)
+  {
+    graph.add_lane(i, i+1);
+    graph.add_lane(i+1, i);
+  }
+
+  const auto profile = create_test_profile(UnitCircle);
+  const rmf_traffic::agv::VehicleTraits traits{
+    {1.0, 0.4},
+    {1.0, 0.5},
+    profile};
+
+  auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  auto obstacle = rmf_traffic::schedule::make_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_Planner",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    },
+    database);
+
+  // The obstacle sits in the middle of the corridor for a while, so the robot
+  // has to wait for it to leave
+  const auto now = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory blocking;
+  blocking.insert(now, {20.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  blocking.insert(now + 30s, {20.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  obstacle.set(
+    obstacle.plan_id_assigner()->assign(), {{test_map_name, blocking}});
+
+  const auto schedule_validator =
+    std::make_shared<rmf_traffic::agv::ScheduleRouteValidator>(
+    *database,
+    std::numeric_limits<rmf_traffic::schedule::ParticipantId>::max(),
+    profile);
+
+  const Planner planner{
+    Planner::Configuration{graph, traits},
+    Planner::Options{nullptr}};
+
+  const Planner::Start start{now, 0, 0.0};
+  const Planner::Goal goal{4};
+
+  Planner::Options uninterrupted{nullptr};
+  uninterrupted.validator(schedule_validator);
+  const auto expected = planner.plan(start, goal, uninterrupted);
+  REQUIRE(expected.success());
+  CHECK(*expected->get_itinerary().back().trajectory().finish_time()
+    > now + 30s);
+
+  const auto flag = std::make_shared<std::atomic_bool>(false);
+  Planner::Options options{
+    nullptr, Planner::Options::DefaultMinHoldingTime, flag};
+  options.validator(
+    std::make_shared<InterruptingValidator>(schedule_validator, flag, 3));
+  options.validation_interrupts(true);
+  CHECK(options.validation_interrupts());
+
+  auto result = planner.plan(start, goal, options);
+  CHECK(*flag);
+  CHECK_FALSE(result.success());
+  CHECK(result.interrupted());
+
+  THEN("Resuming the search finds the same plan")
+  {
+    CHECK(result.resume(std::make_shared<std::atomic_bool>(false)));
+    REQUIRE(result.success());
+    CHECK(result->get_cost() == Approx(expected->get_cost()));
+  }
+}
@@ -252,6 +252,22 @@ SCENARIO("Test Rollout on graph with side routes")
   const auto alternatives = rollout_1.expand(
     p0.id(), 30s, rmf_traffic::agv::Planner::Options{nullptr, 10s});
 
+  // Rolling out on several threads finds alternatives whenever rolling out on
+  // one thread does, and it still respects the limit on rollouts
+  auto parallel_options = rmf_traffic::agv::Planner::Options{nullptr, 10s};
+  parallel_options.search_threads(4);
+  const auto parallel_alternatives =
+    rollout_1.expand(p0.id(), 30s, parallel_options);
+  CHECK(parallel_alternatives.empty() == alternatives.empty());
+  CHECK(rollout_1.expand(p0.id(), 30s, parallel_options, 1).size() <= 1);
+
+  // A rollout with no time to spend does not expand anything
+  auto budgeted_rollout = rollout_1;
+  budgeted_rollout.time_budget(rmf_traffic::Duration(0));
+  CHECK(budgeted_rollout.time_budget() == rmf_traffic::Duration(0));
+  CHECK(budgeted_rollout.expand(
+      p0.id(), 30s, rmf_traffic::agv::Planner::Options{nullptr, 10s}).empty());
+
   bool found_plan = false;
 //  std::size_t alterantive_count = 0;
 //  std::cout << "Found " << alternatives.size() << " alterantives" << std::endl;
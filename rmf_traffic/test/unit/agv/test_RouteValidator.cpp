@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/agv/RouteValidator.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include "../utils_Trajectory.hpp"
+
+namespace {
+//==============================================================================
+rmf_traffic::Route make_route(
+  const std::string& map,
+  const rmf_traffic::Time start,
+  const Eigen::Vector2d& from,
+  const Eigen::Vector2d& to)
+{
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(start, {from.x(), from.y(), 0.0}, Eigen::Vector3d::Zero());
+  trajectory.insert(
+    start + std::chrono::seconds(10),
+    {to.x(), to.y(), 0.0},
+    Eigen::Vector3d::Zero());
+
+  return rmf_traffic::Route{map, std::move(trajectory)};
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Validate several routes at once")
+{
+  using namespace std::chrono_literals;
+
+  const auto profile = create_test_profile(UnitCircle);
+  const auto now = std::chrono::steady_clock::now();
+
+  rmf_traffic::schedule::Database database;
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_RouteValidator",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  // The obstacle crosses the x axis during the first ten seconds
+  database.extend(
+    obstacle.id(),
+    {make_route("test_map", now, {5.0, -10.0}, {5.0, 10.0})},
+    0);
+
+  const rmf_traffic::agv::ScheduleRouteValidator validator(
+    database, obstacle.id() + 1, profile);
+
+  const auto conflicting = make_route("test_map", now, {0.0, 0.0}, {10.0, 0.0});
+  const auto later =
+    make_route("test_map", now + 1min, {0.0, 0.0}, {10.0, 0.0});
+  const auto elsewhere = make_route("other_map", now, {0.0, 0.0}, {10.0, 0.0});
+
+  REQUIRE(validator.find_conflict(conflicting).has_value());
+  CHECK_FALSE(validator.find_conflict(later).has_value());
+  CHECK_FALSE(validator.find_conflict(elsewhere).has_value());
+
+  CHECK_FALSE(validator.find_conflicts({}).has_value());
+  CHECK_FALSE(validator.find_conflicts({later, elsewhere}).has_value());
+
+  const auto conflict =
+    validator.find_conflicts({later, elsewhere, conflicting});
+  REQUIRE(conflict.has_value());
+  CHECK(conflict->dependency.on_participant == obstacle.id());
+
+  const auto single = validator.find_conflict(conflicting);
+  CHECK(conflict->time == single->time);
+
+  // The default implementation gives the same answers
+  const rmf_traffic::agv::RouteValidator& base = validator;
+  CHECK(base.RouteValidator::find_conflicts({later, conflicting}).has_value());
+  CHECK_FALSE(base.RouteValidator::find_conflicts({later}).has_value());
+}
+
+//==============================================================================
+SCENARIO("Reuse schedule queries inside a window")
+{
+  using namespace std::chrono_literals;
+
+  const auto profile = create_test_profile(UnitCircle);
+  const auto now = std::chrono::steady_clock::now();
+
+  rmf_traffic::schedule::Database database;
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_RouteValidator",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  rmf_traffic::schedule::ItineraryVersion iv = 0;
+  database.extend(
+    obstacle.id(),
+    {make_route("test_map", now, {5.0, -10.0}, {5.0, 10.0})},
+    iv++);
+
+  rmf_traffic::agv::ScheduleRouteValidator validator(
+    database, obstacle.id() + 1, profile);
+  CHECK_FALSE(validator.query_window().has_value());
+
+  validator.query_window(2min);
+  REQUIRE(validator.query_window().has_value());
+  CHECK(*validator.query_window() == 2min);
+
+  const auto conflicting = make_route("test_map", now, {0.0, 0.0}, {10.0, 0.0});
+  const auto later =
+    make_route("test_map", now + 1min, {0.0, 0.0}, {10.0, 0.0});
+  const auto elsewhere = make_route("other_map", now, {0.0, 0.0}, {10.0, 0.0});
+
+  // These checks fall inside the window of the first one
+  CHECK(validator.find_conflict(conflicting).has_value());
+  CHECK_FALSE(validator.find_conflict(later).has_value());
+  CHECK(validator.find_conflict(conflicting).has_value());
+
+  // This one needs a new map
+  CHECK_FALSE(validator.find_conflict(elsewhere).has_value());
+
+  WHEN("The schedule changes")
+  {
+    database.extend(
+      obstacle.id(),
+      {make_route("test_map", now + 1min, {5.0, -10.0}, {5.0, 10.0})},
+      iv++);
+
+    CHECK(validator.find_conflict(later).has_value());
+    CHECK(validator.clone()->find_conflict(later).has_value());
+  }
+
+  WHEN("The window is turned off")
+  {
+    validator.query_window(std::nullopt);
+    CHECK_FALSE(validator.query_window().has_value());
+    CHECK(validator.find_conflict(conflicting).has_value());
+    CHECK_FALSE(validator.find_conflict(later).has_value());
+  }
+}
+
+//==============================================================================
+SCENARIO("Remember the conflicts of unchanged routes")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::DetectConflict;
+
+  const auto profile = create_test_profile(UnitCircle);
+  const auto now = std::chrono::steady_clock::now();
+
+  rmf_traffic::schedule::Database database;
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_RouteValidator",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  rmf_traffic::schedule::ItineraryVersion iv = 0;
+  database.extend(
+    obstacle.id(),
+    {make_route("test_map", now, {5.0, -10.0}, {5.0, 10.0})},
+    iv++);
+
+  rmf_traffic::agv::ScheduleRouteValidator validator(
+    database, obstacle.id() + 1, profile);
+  CHECK(validator.conflict_memo() == 0);
+
+  validator.conflict_memo(16);
+  CHECK(validator.conflict_memo() == 16);
+
+  const auto conflicting = make_route("test_map", now, {0.0, 0.0}, {10.0, 0.0});
+  const auto clear = make_route("test_map", now, {20.0, 0.0}, {30.0, 0.0});
+
+  const bool collecting = DetectConflict::collecting_stats();
+  DetectConflict::collect_stats(true);
+  DetectConflict::reset_stats();
+
+  const auto first = validator.find_conflict(conflicting);
+  REQUIRE(first.has_value());
+  CHECK_FALSE(validator.find_conflict(clear).has_value());
+  CHECK(DetectConflict::get_stats().pair_checks == 2);
+
+  // Checking the same routes again, or copies of them, gives the same answers
+  // without detecting conflicts again
+  const auto copy = conflicting;
+  const auto again = validator.clone()->find_conflict(copy);
+  REQUIRE(again.has_value());
+  CHECK(again->time == first->time);
+  CHECK(again->dependency.on_participant == first->dependency.on_participant);
+  CHECK(again->dependency.on_route == first->dependency.on_route);
+  CHECK(again->dependency.on_checkpoint == first->dependency.on_checkpoint);
+  CHECK_FALSE(validator.find_conflict(clear).has_value());
+  CHECK(DetectConflict::get_stats().pair_checks == 2);
+
+  WHEN("The route in the schedule is delayed")
+  {
+    database.delay(obstacle.id(), 1s, iv++);
+    const auto delayed = validator.find_conflict(conflicting);
+    REQUIRE(delayed.has_value());
+    CHECK(DetectConflict::get_stats().pair_checks == 3);
+  }
+
+  WHEN("The memo is turned off")
+  {
+    validator.conflict_memo(0);
+    CHECK(validator.conflict_memo() == 0);
+    CHECK(validator.find_conflict(conflicting).has_value());
+    CHECK(DetectConflict::get_stats().pair_checks == 3);
+  }
+
+  DetectConflict::collect_stats(collecting);
+}
+
+//==============================================================================
+SCENARIO("Validate routes with graph reservations")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::DetectConflict;
+  using Validator = rmf_traffic::agv::ReservationRouteValidator;
+
+  const auto profile = create_test_profile(UnitCircle);
+  const auto now = std::chrono::steady_clock::now();
+
+  // Two corridors that cross at (5, 0), and a third one far away from them
+  rmf_traffic::agv::Graph graph;
+  graph.add_waypoint("test_map", {0.0, 0.0}); // 0
+  graph.add_waypoint("test_map", {10.0, 0.0}); // 1
+  graph.add_waypoint("test_map", {5.0, -10.0}); // 2
+  graph.add_waypoint("test_map", {5.0, 10.0}); // 3
+  graph.add_waypoint("test_map", {20.0, 0.0}); // 4
+  graph.add_waypoint("test_map", {30.0, 0.0}); // 5
+  graph.add_lane(0, 1); // 0
+  graph.add_lane(2, 3); // 1
+  graph.add_lane(4, 5); // 2
+
+  CHECK_THROWS_AS(Validator::Layout(graph, 0.0), std::invalid_argument);
+  CHECK_THROWS_AS(Validator::Layout(graph, 3.0, -1.0), std::invalid_argument);
+
+  const auto layout = std::make_shared<Validator::Layout>(graph, 3.0);
+  CHECK(layout->clearance() == Approx(3.0));
+  CHECK(layout->waypoints_near_waypoint(0) == std::vector<std::size_t>{0});
+  CHECK(layout->lanes_near_lane(0) == std::vector<std::size_t>{0, 1});
+  CHECK(layout->lanes_near_lane(2) == std::vector<std::size_t>{2});
+  CHECK_THROWS_AS(layout->lanes_near_lane(3), std::out_of_range);
+
+  // The clearance can be chosen from the profiles of the participants, and
+  // the layout is the same no matter how many threads make it
+  CHECK(Validator::Layout::clearance_for({profile}, 0.5) == Approx(2.5));
+  const auto small = create_test_profile(UnitBox);
+  CHECK(Validator::Layout::clearance_for({profile, profile, small}, 0.5)
+    == Approx(2.5));
+
+  const Validator::Layout threaded(graph, {profile, profile}, 1.0, 4);
+  CHECK(threaded.clearance() == Approx(3.0));
+  for (std::size_t i = 0; i < graph.num_waypoints(); ++i)
+  {
+    CHECK(threaded.waypoints_near_waypoint(i)
+      == layout->waypoints_near_waypoint(i));
+  }
+
+  for (std::size_t i = 0; i < graph.num_lanes(); ++i)
+    CHECK(threaded.lanes_near_lane(i) == layout->lanes_near_lane(i));
+
+  rmf_traffic::schedule::Database database;
+  const auto obstacle = database.register_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "obstacle",
+      "test_RouteValidator",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+      profile
+    });
+
+  rmf_traffic::schedule::ItineraryVersion iv = 0;
+  database.extend(
+    obstacle.id(),
+    {make_route("test_map", now, {5.0, -10.0}, {5.0, 10.0})},
+    iv++);
+
+  Validator validator(database, obstacle.id() + 1, profile, layout);
+  CHECK(validator.layout() == layout);
+  CHECK_FALSE(validator.geometric_confirmation());
+
+  const auto conflicting = make_route("test_map", now, {0.0, 0.0}, {10.0, 0.0});
+  const auto later =
+    make_route("test_map", now + 1min, {0.0, 0.0}, {10.0, 0.0});
+  const auto clear = make_route("test_map", now, {20.0, 0.0}, {30.0, 0.0});
+
+  const bool collecting = DetectConflict::collecting_stats();
+  DetectConflict::collect_stats(true);
+  DetectConflict::reset_stats();
+
+  // Routes on the graph are checked without detecting conflicts
+  const auto conflict = validator.find_conflict(conflicting);
+  REQUIRE(conflict.has_value());
+  CHECK(conflict->dependency.on_participant == obstacle.id());
+  CHECK_FALSE(validator.find_conflict(later).has_value());
+  CHECK_FALSE(validator.find_conflict(clear).has_value());
+  CHECK(DetectConflict::get_stats().pair_checks == 0);
+
+  WHEN("The schedule changes")
+  {
+    database.extend(
+      obstacle.id(),
+      {make_route("test_map", now + 1min, {5.0, -10.0}, {5.0, 10.0})},
+      iv++);
+
+    CHECK(validator.find_conflict(later).has_value());
+    CHECK(validator.clone()->find_conflict(later).has_value());
+    CHECK(DetectConflict::get_stats().pair_checks == 0);
+  }
+
+  WHEN("Conflicts are confirmed geometrically")
+  {
+    validator.geometric_confirmation(true);
+    CHECK(validator.geometric_confirmation());
+    CHECK(validator.find_conflict(conflicting).has_value());
+    CHECK_FALSE(validator.find_conflict(clear).has_value());
+    CHECK(DetectConflict::get_stats().pair_checks == 1);
+  }
+
+  WHEN("A route leaves the graph")
+  {
+    // This runs alongside the first corridor, so it cannot be matched to the
+    // graph, and it passes the obstacle where the corridors cross.
+    const auto off_graph =
+      make_route("test_map", now, {0.0, 1.0}, {10.0, 1.0});
+    CHECK(validator.find_conflict(off_graph).has_value());
+    CHECK(DetectConflict::get_stats().pair_checks == 1);
+  }
+
+  DetectConflict::collect_stats(collecting);
+}
@@ -1205,3 +1205,131 @@ SCENARIO("Test computing Starts from coordinates")
     CHECK(start_set.empty());
   }
 }
+
+//==============================================================================
+SCENARIO("Computing Starts with a spatial index")
+{
+  using rmf_traffic::agv::Graph;
+  using rmf_traffic::agv::GraphSpatialIndex;
+
+  const rmf_traffic::Time initial_time = std::chrono::steady_clock::now();
+
+  // A grid with long diagonal lanes across it, and a second map that overlaps
+  // the first one
+  Graph graph;
+  const std::size_t size = 10;
+  for (const std::string map : {"test_map", "other_map"})
+  {
+    const std::size_t offset = graph.num_waypoints();
+    for (std::size_t row = 0; row < size; ++row)
+    {
+      for (std::size_t col = 0; col < size; ++col)
+      {
+        graph.add_waypoint(map, {3.0 * col, 3.0 * row});
+        const std::size_t w = offset + row * size + col;
+        if (col > 0)
+        {
+          graph.add_lane(w - 1, w);
+          graph.add_lane(w, w - 1);
+        }
+
+        if (row > 0)
+          graph.add_lane(w - size, w);
+      }
+    }
+
+    graph.add_lane(offset, offset + size*size - 1);
+    graph.add_lane(offset + size - 1, offset + (size - 1)*size);
+  }
+
+  // A lane that connects the two maps, which should never be used as a start
+  graph.add_lane(0, size*size);
+
+  const GraphSpatialIndex index(graph, 2.0);
+  CHECK(index.num_waypoints() == graph.num_waypoints());
+  CHECK(index.num_lanes() == graph.num_lanes());
+  CHECK(index.cell_size() == Approx(2.0));
+
+  const auto same = [](
+    const std::vector<rmf_traffic::agv::Plan::Start>& a,
+    const std::vector<rmf_traffic::agv::Plan::Start>& b)
+    {
+      if (a.size() != b.size())
+        return false;
+
+      for (std::size_t i = 0; i < a.size(); ++i)
+      {
+        if (a[i].waypoint() != b[i].waypoint())
+          return false;
+
+        if (a[i].lane() != b[i].lane())
+          return false;
+
+        if (a[i].location().has_value() != b[i].location().has_value())
+          return false;
+      }
+
+      return true;
+    };
+
+  WHEN("Poses are spread over the map")
+  {
+    std::size_t nonempty = 0;
+    for (double x = -2.0; x < 30.0; x += 0.37)
+    {
+      for (double y = -2.0; y < 30.0; y += 0.41)
+      {
+        const Eigen::Vector3d pose = {x, y, 0.0};
+        const auto expected = rmf_traffic::agv::compute_plan_starts(
+          graph, "test_map", pose, initial_time, 0.2, 1.0);
+
+        const auto starts = rmf_traffic::agv::compute_plan_starts(
+          graph, index, "test_map", pose, initial_time, 0.2, 1.0);
+
+        CHECK(same(expected, starts));
+        if (!starts.empty())
+          ++nonempty;
+      }
+    }
+
+    CHECK(nonempty > 0);
+  }
+
+  WHEN("The index is queried directly")
+  {
+    const Eigen::Vector2d p = {4.0, 4.5};
+    CHECK(index.waypoints_near("test_map", p, 2.0)
+      == std::vector<std::size_t>({11, 21}));
+
+    CHECK(index.waypoints_near("missing_map", p, 10.0).empty());
+    CHECK(index.lanes_near("test_map", p, 0.0).empty());
+
+    // The diagonal lane from 0 to 99 passes through (4.5, 4.5)
+    const auto lanes = index.lanes_near("test_map", p, 0.75);
+    CHECK(std::is_sorted(lanes.begin(), lanes.end()));
+    bool found_diagonal = false;
+    for (const std::size_t lane : lanes)
+    {
+      const auto& l = graph.get_lane(lane);
+      if (l.entry().waypoint_index() == 0 && l.exit().waypoint_index() == 99)
+        found_diagonal = true;
+    }
+
+    CHECK(found_diagonal);
+  }
+
+  WHEN("The index was built from a different graph")
+  {
+    Graph other;
+    other.add_waypoint("test_map", {0.0, 0.0});
+    CHECK_THROWS_AS(
+      rmf_traffic::agv::compute_plan_starts(
+        other, index, "test_map", {0.0, 0.0, 0.0}, initial_time),
+      std::invalid_argument);
+  }
+
+  GIVEN("A bad cell size")
+  {
+    CHECK_THROWS_AS(GraphSpatialIndex(graph, 0.0), std::invalid_argument);
+  }
+}
@@ -18,6 +18,7 @@
 #include "utils_blockade_simulation.hpp"
 
 #include <algorithm>
+#include <random>
 
 //==============================================================================
 rmf_traffic::blockade::BlockageEndCondition reach(const std::size_t index)
@@ -55,6 +56,106 @@ std::optional<std::size_t> cannot_hold()
   return std::nullopt;
 }
 
+//==============================================================================
+SCENARIO("Track gridlock status incrementally")
+{
+  using namespace rmf_traffic::blockade;
+
+  const std::size_t A = 0;
+  const std::size_t B = 1;
+  const std::size_t C = 2;
+  const std::size_t D = 3;
+
+  Blockers g;
+  g[A][0] = blockage(D, hold_at(1), reach(2));
+  g[A][1] = blockage(B, hold_at(0), reach(2));
+  g[B][0] = blockage(A, hold_at(1), reach(2));
+  g[B][1] = blockage(C, hold_at(0), reach(2));
+  g[C][0] = blockage(B, hold_at(1), reach(2));
+  g[C][1] = blockage(D, hold_at(0), reach(2));
+  g[D][0] = blockage(C, hold_at(1), reach(2));
+  g[D][1] = blockage(A, hold_at(0), reach(2));
+
+  const auto cycles = compute_gridlock_cycles(g);
+  REQUIRE_FALSE(cycles.empty());
+  const auto no_gridlock = combine_gridlock_cycles(cycles);
+
+  State state;
+  for (std::size_t i = A; i <= D; ++i)
+    state[i] = range(0, 0);
+
+  GridlockStatus status;
+  CHECK_FALSE(status.has_gridlock());
+
+  status.reset(cycles, state);
+  CHECK_FALSE(status.has_gridlock());
+
+  const auto change = [&](const std::size_t p, const ReservedRange r)
+    {
+      state[p] = r;
+      status.update(p, state);
+      CHECK(status.has_gridlock() == !no_gridlock->evaluate(state));
+    };
+
+  change(A, range(0, 1));
+  change(B, range(0, 1));
+  change(C, range(0, 1));
+  change(D, range(0, 1));
+  CHECK(status.has_gridlock());
+
+  change(A, range(0, 0));
+  CHECK_FALSE(status.has_gridlock());
+
+  change(A, range(1, 1));
+  CHECK(status.has_gridlock());
+
+  change(D, range(2, 2));
+  CHECK_FALSE(status.has_gridlock());
+}
+
+//==============================================================================
+SCENARIO("Compiled constraints match the constraint tree")
+{
+  using namespace rmf_traffic::blockade;
+
+  const std::size_t A = 0;
+  const std::size_t B = 1;
+  const std::size_t C = 2;
+
+  Blockers g;
+  g[A][0] = blockage(C, hold_at(1), reach(2));
+  g[A][1] = blockage(B, hold_at(0), pass(2));
+  g[B][0] = blockage(A, hold_at(1), reach(2));
+  g[B][1] = blockage(C, cannot_hold(), reach(2));
+  g[C][0] = blockage(B, hold_at(1), reach(3));
+  g[C][1] = blockage(A, hold_at(0), std::nullopt);
+
+  const auto no_gridlock = compute_gridlock_constraint(g);
+  REQUIRE_FALSE(no_gridlock->dependencies().empty());
+
+  StateLayout layout;
+  const CompiledConstraint compiled(no_gridlock, layout);
+  CHECK(compiled.source() == no_gridlock);
+  CHECK(compiled.size() > 1);
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<std::size_t> index(0, 3);
+
+  PackedState packed;
+  for (std::size_t n = 0; n < 2000; ++n)
+  {
+    State state;
+    for (std::size_t p = A; p <= C; ++p)
+    {
+      const std::size_t begin = index(rng);
+      state[p] = range(begin, begin + index(rng));
+    }
+
+    packed.pack(layout, state);
+    CHECK(compiled.evaluate(packed, state) == no_gridlock->evaluate(state));
+  }
+}
+
 //==============================================================================
 SCENARIO("Test gridlock detection")
 {
@@ -303,6 +303,13 @@ SCENARIO("Test blockade moderator")
       context = make_reliable();
     }
 
+    WHEN("Multithreaded moderator")
+    {
+      context = make_reliable();
+      context.moderator->threads(4);
+      CHECK(context.moderator->threads() == 4);
+    }
+
     WHEN("Unreliable moderator")
     {
       context = make_unreliable();
@@ -363,6 +370,13 @@ SCENARIO("Test blockade moderator")
       context = make_reliable();
     }
 
+    WHEN("Multithreaded moderator")
+    {
+      context = make_reliable();
+      context.moderator->threads(4);
+      CHECK(context.moderator->threads() == 4);
+    }
+
     WHEN("Unreliable moderator")
     {
       context = make_unreliable();
@@ -526,3 +540,137 @@ SCENARIO("Test lane sharing")
     CHECK(range_B.end == 6);
   }
 }
+
+//==============================================================================
+SCENARIO("Batched moderator updates")
+{
+  using namespace rmf_traffic::blockade;
+
+  const auto scenario = fourway_standoff();
+
+  Moderator direct;
+  for (std::size_t i = 0; i < scenario.paths.size(); ++i)
+    direct.set(i, 0, Writer::Reservation{scenario.paths[i], 0.1});
+
+  for (std::size_t i = 0; i < scenario.paths.size(); ++i)
+    direct.ready(i, 0, 0);
+
+  Moderator batched;
+  const auto initial_version = batched.assignments().version();
+
+  {
+    Moderator::Batch batch(batched);
+    for (std::size_t i = 0; i < scenario.paths.size(); ++i)
+      batched.set(i, 0, Writer::Reservation{scenario.paths[i], 0.1});
+
+    for (std::size_t i = 0; i < scenario.paths.size(); ++i)
+      batched.ready(i, 0, 0);
+
+    WHEN("A nested batch finishes")
+    {
+      {
+        Moderator::Batch nested(batched);
+      }
+
+      // The outer batch is still open, so nothing has been assigned yet
+      for (const auto& r : batched.assignments().ranges())
+        CHECK(r.second.end == 0);
+    }
+
+    for (const auto& r : batched.assignments().ranges())
+      CHECK(r.second.end == 0);
+
+    // Only the insertions of the new participants have touched the
+    // assignments so far
+    CHECK(batched.assignments().version() - initial_version
+      == scenario.paths.size());
+  }
+
+  const auto& expected = direct.assignments().ranges();
+  const auto& actual = batched.assignments().ranges();
+  REQUIRE(actual.size() == expected.size());
+  for (const auto& r : expected)
+  {
+    const auto it = actual.find(r.first);
+    REQUIRE(it != actual.end());
+    CHECK(it->second.begin == r.second.begin);
+    CHECK(it->second.end == r.second.end);
+  }
+
+  CHECK(batched.has_gridlock() == direct.has_gridlock());
+}
+
+//==============================================================================
+SCENARIO("Setting the same path again")
+{
+  using namespace rmf_traffic::blockade;
+
+  const auto scenario = fourway_standoff();
+
+  Moderator moderator;
+  for (std::size_t i = 0; i < scenario.paths.size(); ++i)
+    moderator.set(i, 0, Writer::Reservation{scenario.paths[i], 0.1});
+
+  for (std::size_t i = 0; i < scenario.paths.size(); ++i)
+    moderator.ready(i, 0, 0);
+
+  const auto expected = moderator.assignments().ranges();
+
+  // Start every participant over with the same paths
+  for (std::size_t i = 0; i < scenario.paths.size(); ++i)
+  {
+    moderator.set(i, 1, Writer::Reservation{scenario.paths[i], 0.1});
+    CHECK(moderator.statuses().at(i).reservation == 1);
+    CHECK(moderator.assignments().ranges().at(i).end == 0);
+  }
+
+  for (std::size_t i = 0; i < scenario.paths.size(); ++i)
+    moderator.ready(i, 1, 0);
+
+  const auto& actual = moderator.assignments().ranges();
+  REQUIRE(actual.size() == expected.size());
+  for (const auto& r : expected)
+  {
+    CHECK(actual.at(r.first).begin == r.second.begin);
+    CHECK(actual.at(r.first).end == r.second.end);
+  }
+}
+
+//==============================================================================
+SCENARIO("Moderator change feed")
+{
+  using namespace rmf_traffic::blockade;
+
+  const auto scenario = fourway_standoff();
+
+  Moderator moderator;
+  CHECK(moderator.changes_version() == 0);
+  CHECK(moderator.changes_since(0).changed.empty());
+
+  for (std::size_t i = 0; i < scenario.paths.size(); ++i)
+    moderator.set(i, 0, Writer::Reservation{scenario.paths[i], 0.1});
+
+  auto changes = moderator.changes_since(0);
+  CHECK(changes.version == moderator.changes_version());
+  CHECK(changes.changed == std::vector<ParticipantId>{0, 1, 2, 3});
+  CHECK(changes.removed.empty());
+
+  // Nothing has changed since the last version
+  const auto version = changes.version;
+  CHECK(moderator.changes_since(version).changed.empty());
+
+  moderator.ready(2, 0, 0);
+  changes = moderator.changes_since(version);
+  CHECK(changes.changed == std::vector<ParticipantId>{2});
+  CHECK(changes.version > version);
+
+  moderator.cancel(1);
+  changes = moderator.changes_since(version);
+  CHECK(changes.changed == std::vector<ParticipantId>{2});
+  CHECK(changes.removed == std::vector<ParticipantId>{1});
+
+  // Canceling a participant that is already gone changes nothing
+  const auto cancel_version = moderator.changes_version();
+  moderator.cancel(1);
+  CHECK(moderator.changes_version() == cancel_version);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <src/rmf_traffic/blockade/ReservationIndex.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+//==============================================================================
+SCENARIO("Reservation index finds nearby paths")
+{
+  using namespace rmf_traffic::blockade;
+
+  const auto make_reservation = [](
+    const Eigen::Vector2d& start,
+    const Eigen::Vector2d& finish,
+    const std::string& map = "test_map")
+    {
+      return Writer::Reservation{
+        {
+          {start, map, true},
+          {finish, map, true}
+        },
+        0.5
+      };
+    };
+
+  ReservationIndex index(1.0);
+  index.insert(0, make_reservation({0.0, 0.0}, {10.0, 0.0}));
+  index.insert(1, make_reservation({5.0, -5.0}, {5.0, 5.0}));
+  index.insert(2, make_reservation({0.0, 20.0}, {10.0, 20.0}));
+  index.insert(3, make_reservation({0.0, 0.0}, {10.0, 0.0}, "other_map"));
+
+  CHECK(index.nearby(0) == std::unordered_set<ParticipantId>{1});
+  CHECK(index.nearby(1) == std::unordered_set<ParticipantId>{0});
+  CHECK(index.nearby(2).empty());
+  CHECK(index.nearby(3).empty());
+  CHECK(index.nearby(4).empty());
+
+  WHEN("A path is moved")
+  {
+    index.insert(2, make_reservation({0.0, 0.5}, {10.0, 0.5}));
+    CHECK(index.nearby(0) == std::unordered_set<ParticipantId>{1, 2});
+    CHECK(index.nearby(2) == std::unordered_set<ParticipantId>{0, 1});
+  }
+
+  WHEN("A path is erased")
+  {
+    index.erase(1);
+    CHECK(index.nearby(0).empty());
+    CHECK(index.nearby(1).empty());
+  }
+}
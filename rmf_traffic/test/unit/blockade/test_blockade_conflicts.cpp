@@ -16,12 +16,14 @@
 */
 
 #include <src/rmf_traffic/blockade/conflicts.hpp>
+#include <src/rmf_traffic/blockade/geometry.hpp>
 
 #include "utils_blockade_simulation.hpp"
 #include "utils_blockade_scenarios.hpp"
 
 #include <array>
 #include <iostream>
+#include <random>
 
 //==============================================================================
 using Checkpoint = rmf_traffic::blockade::Writer::Checkpoint;
@@ -721,3 +723,83 @@ SCENARIO("Simulate gridlocks")
     nullptr,
     scenario.goals);
 }
+
+//==============================================================================
+SCENARIO("Find nearby segment pairs")
+{
+  using namespace rmf_traffic::blockade;
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> position(-50.0, 50.0);
+  std::uniform_int_distribution<int> map(0, 3);
+
+  const auto make_path = [&](const std::size_t size)
+    {
+      std::vector<Writer::Checkpoint> path;
+      Eigen::Vector2d p{position(rng), position(rng)};
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        // Take short random steps so that the paths wander across the site
+        p += Eigen::Vector2d{position(rng), position(rng)}/10.0;
+        path.push_back({p, map(rng) == 0 ? "L2" : "L1", true});
+      }
+
+      return path;
+    };
+
+  for (std::size_t trial = 0; trial < 20; ++trial)
+  {
+    const auto path_a = make_path(120);
+    const auto path_b = make_path(80);
+    const double radius_a = 0.5;
+    const double radius_b = 1.0;
+
+    std::vector<std::pair<std::size_t, std::size_t>> expected;
+    for (std::size_t a = 0; a+1 < path_a.size(); ++a)
+    {
+      if (path_a[a].map_name != path_a[a+1].map_name)
+        continue;
+
+      const auto box_a = BoundingBox::make(
+        {path_a[a].position, path_a[a+1].position, radius_a});
+
+      for (std::size_t b = 0; b+1 < path_b.size(); ++b)
+      {
+        if (path_b[b].map_name != path_b[b+1].map_name)
+          continue;
+
+        if (path_a[a].map_name != path_b[b].map_name)
+          continue;
+
+        const auto box_b = BoundingBox::make(
+          {path_b[b].position, path_b[b+1].position, radius_b});
+
+        if (box_a.overlaps(box_b))
+          expected.emplace_back(a, b);
+      }
+    }
+
+    CHECK(find_segment_pairs(path_a, radius_a, path_b, radius_b) == expected);
+
+    const auto prepared_a = PreparedPath::make(path_a, radius_a);
+    const auto prepared_b = PreparedPath::make(path_b, radius_b);
+    REQUIRE(prepared_a.segments.size() == path_a.size() - 1);
+    for (std::size_t a = 0; a+1 < path_a.size(); ++a)
+    {
+      CHECK(prepared_a.segments[a].has_value()
+        == (path_a[a].map_name == path_a[a+1].map_name));
+    }
+
+    for (std::size_t i = 1; i < prepared_a.sweep_order.size(); ++i)
+    {
+      const auto& previous = prepared_a.segments[prepared_a.sweep_order[i-1]];
+      const auto& next = prepared_a.segments[prepared_a.sweep_order[i]];
+      CHECK(previous->box.min.x() <= next->box.min.x());
+    }
+
+    CHECK(find_segment_pairs(path_a, prepared_a, path_b, prepared_b)
+      == expected);
+  }
+
+  CHECK(find_segment_pairs({}, 1.0, make_path(5), 1.0).empty());
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/AsyncWriter.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+//==============================================================================
+/// A Writer that records the versions of the delays that it receives. It can
+/// be paused to simulate a slow connection.
+class RecordingWriter : public rmf_traffic::schedule::Writer
+{
+public:
+
+  void set(
+    ParticipantId,
+    PlanId,
+    const Itinerary&,
+    StorageId,
+    ItineraryVersion version) final
+  {
+    record(version);
+  }
+
+  void extend(
+    ParticipantId,
+    const Itinerary&,
+    ItineraryVersion version) final
+  {
+    record(version);
+  }
+
+  void delay(
+    ParticipantId,
+    Duration,
+    ItineraryVersion version) final
+  {
+    if (version == fail_on_version)
+      throw std::runtime_error("Failed to deliver");
+
+    record(version);
+  }
+
+  void reached(
+    ParticipantId,
+    PlanId,
+    const std::vector<CheckpointId>&,
+    ProgressVersion) final
+  {
+    // Do nothing
+  }
+
+  void clear(
+    ParticipantId,
+    ItineraryVersion version) final
+  {
+    record(version);
+  }
+
+  Registration register_participant(ParticipantDescription) final
+  {
+    record(0);
+    return Registration(7, 10, 20, 30);
+  }
+
+  void unregister_participant(ParticipantId) final
+  {
+    // Do nothing
+  }
+
+  void update_description(ParticipantId, ParticipantDescription) final
+  {
+    // Do nothing
+  }
+
+  void pause()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    paused = true;
+  }
+
+  void resume()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      paused = false;
+    }
+    cv.notify_all();
+  }
+
+  std::vector<ItineraryVersion> versions() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return received;
+  }
+
+  std::thread::id last_thread;
+  ItineraryVersion fail_on_version = 0;
+
+private:
+
+  void record(ItineraryVersion version)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return !paused; });
+    received.push_back(version);
+    last_thread = std::this_thread::get_id();
+  }
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  bool paused = false;
+  std::vector<ItineraryVersion> received;
+};
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Asynchronous schedule writer")
+{
+  using namespace std::chrono_literals;
+  const auto inner = std::make_shared<RecordingWriter>();
+
+  GIVEN("An AsyncWriter with a small queue")
+  {
+    const auto writer = rmf_traffic::schedule::AsyncWriter::make(inner, 4);
+    CHECK(writer->capacity() == 4);
+    CHECK(writer->inner() == inner);
+
+    WHEN("Changes are written")
+    {
+      for (uint64_t v = 1; v <= 20; ++v)
+        writer->delay(0, 1s, v);
+
+      writer->clear(0, 21);
+      writer->flush();
+
+      THEN("They are delivered in order on another thread")
+      {
+        const auto versions = inner->versions();
+        REQUIRE(versions.size() == 21);
+        for (std::size_t i = 0; i < versions.size(); ++i)
+          CHECK(versions[i] == i+1);
+
+        CHECK(inner->last_thread != std::this_thread::get_id());
+        CHECK(writer->queued() == 0);
+
+        const auto stats = writer->statistics();
+        CHECK(stats.delivered == 21);
+        CHECK(stats.failed == 0);
+        CHECK(stats.peak_queued <= 4);
+      }
+    }
+
+    WHEN("The inner writer is slower than the changes")
+    {
+      inner->pause();
+
+      // The first change is taken by the dispatch thread and the next four
+      // fill up the queue
+      for (uint64_t v = 1; v <= 5; ++v)
+        writer->delay(0, 1s, v);
+
+      std::thread resumer([&]()
+        {
+          std::this_thread::sleep_for(50ms);
+          inner->resume();
+        });
+
+      // These changes have to wait for room in the queue
+      for (uint64_t v = 6; v <= 10; ++v)
+        writer->delay(0, 1s, v);
+
+      writer->flush();
+      resumer.join();
+
+      const auto stats = writer->statistics();
+      CHECK(stats.blocked > 0);
+      CHECK(stats.total_blocked_time > rmf_traffic::Duration(0));
+      CHECK(stats.peak_queued == 4);
+      CHECK(inner->versions().size() == 10);
+    }
+
+    WHEN("The inner writer fails to deliver a change")
+    {
+      inner->fail_on_version = 2;
+      for (uint64_t v = 1; v <= 3; ++v)
+        writer->delay(0, 1s, v);
+
+      writer->flush();
+
+      THEN("Only that change is dropped")
+      {
+        CHECK(inner->versions() == std::vector<uint64_t>{1, 3});
+        CHECK(writer->statistics().failed == 1);
+        CHECK(writer->statistics().delivered == 2);
+      }
+    }
+
+    WHEN("A participant is registered")
+    {
+      writer->delay(0, 1s, 1);
+      const auto registration = writer->register_participant(
+        rmf_traffic::schedule::ParticipantDescription{
+          "participant",
+          "test_AsyncWriter",
+          rmf_traffic::schedule::ParticipantDescription::Rx::Unresponsive,
+          rmf_traffic::Profile{nullptr}
+        });
+
+      THEN("The registration comes back after the earlier changes")
+      {
+        CHECK(registration.id() == 7);
+        CHECK(registration.last_itinerary_version() == 10);
+        CHECK(registration.last_plan_id() == 20);
+        CHECK(registration.next_storage_base() == 30);
+        CHECK(inner->versions() == std::vector<uint64_t>{1, 0});
+      }
+    }
+  }
+
+  GIVEN("An AsyncWriter that is destroyed with changes in its queue")
+  {
+    inner->pause();
+    auto writer = rmf_traffic::schedule::AsyncWriter::make(inner, 16);
+    for (uint64_t v = 1; v <= 10; ++v)
+      writer->delay(0, 1s, v);
+
+    inner->resume();
+    writer.reset();
+
+    CHECK(inner->versions().size() == 10);
+  }
+
+  GIVEN("A nullptr inner writer")
+  {
+    CHECK_THROWS_AS(
+      rmf_traffic::schedule::AsyncWriter::make(nullptr),
+      std::runtime_error);
+  }
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "utils_Database.hpp"
+#include <rmf_traffic/schedule/ConflictScan.hpp>
+#include <rmf_traffic/schedule/Database.hpp>
+
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <set>
+
+using namespace std::chrono_literals;
+
+//==============================================================================
+SCENARIO("Scanning a whole schedule for conflicts")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+  const auto add = [&](
+    const Eigen::Vector3d& from,
+    const Eigen::Vector3d& to,
+    const rmf_traffic::Time start,
+    const std::string& map = "test_map")
+    {
+      const auto id = db.register_participant(
+        ParticipantDescription{
+          "participant_" + std::to_string(db.participant_ids().size()),
+          "test_ConflictScan",
+          ParticipantDescription::Rx::Responsive,
+          profile
+        }).id();
+
+      rmf_traffic::Trajectory t;
+      t.insert(start, from, zero);
+      t.insert(start + 10s, to, zero);
+      db.set(id, 0, {rmf_traffic::Route{map, std::move(t)}}, 0, 0);
+      return id;
+    };
+
+  // Two participants cross each other head-on in the first lane
+  const auto east = add({0, 0, 0}, {10, 0, 0}, time);
+  const auto west = add({10, 0, 0}, {0, 0, 0}, time + 1s);
+
+  // This participant stays far away from everyone
+  add({0, 20, 0}, {10, 20, 0}, time);
+
+  // This participant takes the first lane after everyone has left it
+  add({0, 0, 0}, {10, 0, 0}, time + 60s);
+
+  // This participant takes the first lane on a different map
+  add({10, 0, 0}, {0, 0, 0}, time, "other_map");
+
+  const auto view = db.query(query_all());
+
+  const auto collect = [](const std::vector<ConflictScan::Conflict>& conflicts)
+    {
+      std::set<std::pair<ParticipantId, ParticipantId>> found;
+      for (const auto& c : conflicts)
+        found.insert({c.a.participant, c.b.participant});
+
+      return found;
+    };
+
+  const auto conflicts = ConflictScan::between_all(view);
+  CHECK(collect(conflicts) ==
+    std::set<std::pair<ParticipantId, ParticipantId>>{{east, west}});
+
+  REQUIRE(conflicts.size() == 1);
+  CHECK(conflicts.front().a.route->map() == "test_map");
+  CHECK(conflicts.front().conflict.time > time + 1s);
+  CHECK(conflicts.front().conflict.time < time + 10s);
+
+  WHEN("The scan is spread across threads")
+  {
+    for (std::size_t i = 0; i < 40; ++i)
+    {
+      const double y = 100.0 + 10.0*i;
+      add({0, y, 0}, {10, y, 0}, time);
+      add({10, y, 0}, {0, y, 0}, time);
+    }
+
+    const auto full_view = db.query(query_all());
+    const auto serial = ConflictScan::between_all(full_view);
+    const auto parallel = ConflictScan::between_all(
+      full_view, ConflictScan::Options(4));
+
+    rmf_traffic::Executor::Config config;
+    config.threads = 2;
+    ConflictScan::Options options(4);
+    options.executor = rmf_traffic::Executor::make(config);
+    const auto on_executor = ConflictScan::between_all(full_view, options);
+
+    THEN("The same conflicts are found in the same order")
+    {
+      CHECK(serial.size() == 41);
+      REQUIRE(serial.size() == parallel.size());
+      REQUIRE(serial.size() == on_executor.size());
+      for (std::size_t i = 0; i < serial.size(); ++i)
+      {
+        CHECK(serial[i].a.participant == parallel[i].a.participant);
+        CHECK(serial[i].b.participant == parallel[i].b.participant);
+        CHECK(serial[i].conflict.time == parallel[i].conflict.time);
+        CHECK(serial[i].conflict.time == on_executor[i].conflict.time);
+      }
+    }
+  }
+}
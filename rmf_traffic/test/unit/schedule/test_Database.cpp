@@ -17,15 +17,24 @@
 
 #include "utils_Database.hpp"
 #include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Mirror.hpp>
 
 //#include <rmf_traffic/geometry/Box.hpp>
 #include <src/rmf_traffic/geometry/Box.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
 
 #include "src/rmf_traffic/schedule/debug_Viewer.hpp"
 #include "src/rmf_traffic/schedule/debug_Database.hpp"
 
 #include <rmf_utils/catch.hpp>
 
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory_resource>
+#include <set>
+#include <thread>
+
 using namespace std::chrono_literals;
 
 SCENARIO("Test Database Conflicts")
@@ -56,12 +65,7 @@ SCENARIO("Test Database Conflicts")
     const rmf_traffic::Profile profile{final_shape};
 
     const auto p1 = db.register_participant(
-      rmf_traffic::schedule::ParticipantDescription{
-        "test_participant",
-        "test_Database",
-        rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
-        profile
-      });
+      make_test_description("test_participant", profile));
     CHECK(db.latest_version() == ++dbv);
 
     db.update_description(
@@ -286,3 +290,2022 @@ SCENARIO("Test Database Conflicts")
     }
   }
 }
+
+//==============================================================================
+SCENARIO("Database timeline options")
+{
+  using namespace rmf_traffic::schedule;
+
+  CHECK_THROWS_AS(TimelineOptions(0s), std::invalid_argument);
+  CHECK_THROWS_AS(
+    TimelineOptions().minimum_bucket_duration(-1s), std::invalid_argument);
+
+  GIVEN("A Database with fixed buckets and a Database with adaptive buckets")
+  {
+    Database fixed_db(TimelineOptions(20s));
+    Database adaptive_db(
+      TimelineOptions::adaptive(20s, 4, 3).minimum_bucket_duration(1s));
+
+    const rmf_traffic::Profile profile{
+      rmf_traffic::geometry::make_final_convex<
+        rmf_traffic::geometry::Box>(1.0, 1.0)
+    };
+
+    const rmf_traffic::Time time = std::chrono::steady_clock::now();
+    const std::size_t N = 30;
+
+    std::vector<ParticipantId> participants;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      const ParticipantDescription desc{
+        "participant_" + std::to_string(i),
+        "test_Database",
+        ParticipantDescription::Rx::Responsive,
+        profile
+      };
+
+      const auto id = fixed_db.register_participant(desc).id();
+      CHECK(adaptive_db.register_participant(desc).id() == id);
+      participants.push_back(id);
+
+      const auto start = time + std::chrono::seconds(3*i);
+      rmf_traffic::Trajectory t;
+      t.insert(start, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(start + 20s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+
+      fixed_db.set(id, 0, create_test_input(t), 0, 0);
+      adaptive_db.set(id, 0, create_test_input(t), 0, 0);
+    }
+
+    const auto query_window = [](
+      const Database& db,
+      const rmf_traffic::Time lower,
+      const rmf_traffic::Time upper)
+      {
+        const auto query = make_query({"test_map"}, &lower, &upper);
+        std::set<ParticipantId> found;
+        for (const auto& element : db.query(query))
+          found.insert(element.participant);
+
+        return found;
+      };
+
+    const auto compare_windows = [&]()
+      {
+        for (std::size_t j = 0; j < 12; ++j)
+        {
+          const auto lower = time + std::chrono::seconds(10*j);
+          const auto upper = lower + 5s;
+          CHECK(query_window(fixed_db, lower, upper)
+            == query_window(adaptive_db, lower, upper));
+        }
+      };
+
+    THEN("Both databases find the same routes")
+    {
+      compare_windows();
+      CHECK(query_window(adaptive_db, time + 30s, time + 31s).size() == 7);
+    }
+
+    WHEN("Routes are cleared and the databases are culled")
+    {
+      for (std::size_t i = 0; i < N; i += 2)
+      {
+        fixed_db.clear(participants[i], 1);
+        adaptive_db.clear(participants[i], 1);
+      }
+
+      fixed_db.cull(time + 45s);
+      adaptive_db.cull(time + 45s);
+
+      THEN("Both databases still find the same routes")
+      {
+        compare_windows();
+      }
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Database corridor queries")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Box>(1.0, 1.0)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+  const auto add = [&](const double y, const rmf_traffic::Time start)
+    {
+      const auto id = register_test_participant(
+        db, "participant_" + std::to_string(db.participant_ids().size()),
+        profile);
+
+      rmf_traffic::Trajectory t;
+      t.insert(start, Eigen::Vector3d{0, y, 0}, zero);
+      t.insert(start + 10s, Eigen::Vector3d{10, y, 0}, zero);
+      db.set(id, 0, create_test_input(t), 0, 0);
+      return id;
+    };
+
+  const auto same_lane = add(0.0, time);
+  const auto next_lane = add(5.0, time);
+  add(20.0, time);
+  const auto later = add(0.0, time + 60s);
+
+  // The corridor runs down the first lane in the opposite direction
+  rmf_traffic::Trajectory corridor;
+  corridor.insert(time, Eigen::Vector3d{10, 0, 0}, zero);
+  corridor.insert(time + 10s, Eigen::Vector3d{0, 0, 0}, zero);
+
+  const auto query_corridor = [&](const double radius)
+    {
+      auto query = query_all();
+      query.spacetime().query_corridor("test_map", corridor, radius);
+      CHECK(query.spacetime().get_mode() == Query::Spacetime::Mode::Corridor);
+
+      std::set<ParticipantId> found;
+      for (const auto& element : db.query(query))
+        found.insert(element.participant);
+
+      return found;
+    };
+
+  CHECK(query_corridor(1.0) == std::set<ParticipantId>{same_lane});
+  CHECK(query_corridor(5.0) == std::set<ParticipantId>{same_lane, next_lane});
+
+  auto query = query_all();
+  auto& spec = query.spacetime().query_corridor("test_map", corridor, -1.0);
+  CHECK(spec.radius() == 0.0);
+  CHECK(query.spacetime().corridor()->map() == "test_map");
+  CHECK(query.spacetime().timespan() == nullptr);
+  CHECK(query == query);
+
+  auto other = query;
+  other.spacetime().corridor()->radius(2.0);
+  CHECK(query != other);
+
+  WHEN("The corridor is on another map")
+  {
+    spec.map("other_map");
+    CHECK(db.query(query).size() == 0);
+  }
+
+  WHEN("The corridor is moved to the time of the later route")
+  {
+    rmf_traffic::Trajectory late;
+    late.insert(time + 60s, Eigen::Vector3d{10, 0, 0}, zero);
+    late.insert(time + 70s, Eigen::Vector3d{0, 0, 0}, zero);
+    spec.trajectory(late);
+
+    std::set<ParticipantId> found;
+    for (const auto& element : db.query(query))
+      found.insert(element.participant);
+
+    CHECK(found == std::set<ParticipantId>{later});
+  }
+
+  WHEN("The corridor trajectory is empty")
+  {
+    spec.trajectory(rmf_traffic::Trajectory());
+    CHECK(db.query(query).size() == 0);
+  }
+}
+
+//==============================================================================
+SCENARIO("Database parallel inspection")
+{
+  using namespace rmf_traffic::schedule;
+
+  CHECK(TimelineOptions().inspection_threads() == 1);
+  CHECK(TimelineOptions().inspection_threads(0).inspection_threads() == 1);
+
+  Database serial_db;
+  Database parallel_db(TimelineOptions().inspection_threads(4));
+
+  const auto circle = [](const double radius)
+    {
+      return rmf_traffic::geometry::make_final_convex<
+        rmf_traffic::geometry::Circle>(radius);
+    };
+
+  const rmf_traffic::Profile profile{circle(0.5)};
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const std::size_t N = 200;
+
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    const ParticipantDescription desc{
+      "participant_" + std::to_string(i),
+      "test_Database",
+      ParticipantDescription::Rx::Responsive,
+      profile
+    };
+
+    const auto id = serial_db.register_participant(desc).id();
+    CHECK(parallel_db.register_participant(desc).id() == id);
+
+    // Each participant moves along its own row, so each space of the regions
+    // below only overlaps a few of them.
+    const double y = static_cast<double>(i%20);
+    const auto start = time + std::chrono::seconds(i/20);
+    rmf_traffic::Trajectory t;
+    t.insert(start, Eigen::Vector3d{0, y, 0}, Eigen::Vector3d{0, 0, 0});
+    t.insert(start + 20s, Eigen::Vector3d{10, y, 0}, Eigen::Vector3d{0, 0, 0});
+
+    serial_db.set(id, 0, create_test_input(t), 0, 0);
+    parallel_db.set(id, 0, create_test_input(t), 0, 0);
+  }
+
+  std::vector<rmf_traffic::Region> regions;
+  for (std::size_t i = 0; i < 8; ++i)
+  {
+    std::vector<rmf_traffic::geometry::Space> spaces;
+    for (std::size_t j = 0; j < 4; ++j)
+    {
+      Eigen::Isometry2d tf = Eigen::Isometry2d::Identity();
+      tf.translation() = Eigen::Vector2d(2.0*j, 2.5*i);
+      spaces.emplace_back(circle(0.75), tf);
+    }
+
+    regions.emplace_back(
+      "test_map", time + std::chrono::seconds(i), time + 40s, spaces);
+  }
+
+  const auto query = make_query(regions);
+  const auto found = [&](const Viewer& viewer)
+    {
+      std::vector<std::pair<ParticipantId, RouteId>> output;
+      for (const auto& element : viewer.query(query))
+        output.push_back({element.participant, element.route_id});
+
+      return output;
+    };
+
+  const auto expected = found(serial_db);
+  CHECK(expected.size() > 0);
+  CHECK(expected.size() < N);
+  CHECK(found(parallel_db) == expected);
+  CHECK(found(*parallel_db.snapshot()) == expected);
+
+  Mirror serial_mirror;
+  Mirror parallel_mirror(TimelineOptions().inspection_threads(3));
+  ParticipantDescriptionsMap descriptions;
+  for (const auto id : serial_db.participant_ids())
+    descriptions.insert({id, *serial_db.get_participant(id)});
+
+  for (auto* mirror : {&serial_mirror, &parallel_mirror})
+  {
+    mirror->update_participants_info(descriptions);
+    REQUIRE(mirror->update(serial_db.changes(query_all(), std::nullopt)));
+  }
+
+  const auto mirror_expected = found(serial_mirror);
+  CHECK(mirror_expected.size() == expected.size());
+  CHECK(found(parallel_mirror) == mirror_expected);
+  CHECK(found(*parallel_mirror.snapshot()) == mirror_expected);
+
+  // Several threads can run parallel queries at the same time
+  std::vector<std::thread> threads;
+  std::vector<int> matched(4, 0);
+  for (std::size_t i = 0; i < matched.size(); ++i)
+  {
+    threads.emplace_back(
+      [&, i]()
+      {
+        matched[i] = found(parallel_db) == expected;
+      });
+  }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  for (const int m : matched)
+    CHECK(m);
+}
+
+//==============================================================================
+SCENARIO("Database timeline memory resource")
+{
+  using namespace rmf_traffic::schedule;
+
+  // Counts how many allocations were made from it
+  class CountingResource : public std::pmr::memory_resource
+  {
+  public:
+    std::size_t allocations = 0;
+
+  private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) final
+    {
+      ++allocations;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) final
+    {
+      std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const
+    noexcept final
+    {
+      return this == &other;
+    }
+  };
+
+  CHECK(TimelineOptions().memory_resource() == nullptr);
+
+  CountingResource resource;
+  std::shared_ptr<const Snapshot> snapshot;
+  std::size_t expected = 0;
+  {
+    Database default_db;
+    Database db(TimelineOptions(10s).memory_resource(&resource));
+
+    const rmf_traffic::Profile profile{
+      rmf_traffic::geometry::make_final_convex<
+        rmf_traffic::geometry::Box>(1.0, 1.0)
+    };
+
+    const rmf_traffic::Time time = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < 10; ++i)
+    {
+      const ParticipantDescription desc{
+        "participant_" + std::to_string(i),
+        "test_Database",
+        ParticipantDescription::Rx::Responsive,
+        profile
+      };
+
+      const auto id = db.register_participant(desc).id();
+      CHECK(default_db.register_participant(desc).id() == id);
+
+      const auto start = time + std::chrono::seconds(5*i);
+      rmf_traffic::Trajectory t;
+      t.insert(start, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(start + 30s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+
+      db.set(id, 0, create_test_input(t), 0, 0);
+      default_db.set(id, 0, create_test_input(t), 0, 0);
+    }
+
+    // The buckets of the timeline came from the resource
+    CHECK(resource.allocations > 0);
+
+    const auto query = query_all();
+    expected = default_db.query(query).size();
+    CHECK(expected == 10);
+    CHECK(db.query(query).size() == expected);
+
+    snapshot = db.snapshot();
+  }
+
+  // The snapshot made its own copies of the buckets, so it still works after
+  // the database is gone
+  CHECK(snapshot->query(query_all()).size() == expected);
+}
+
+//==============================================================================
+SCENARIO("Database snapshots stay the same after the database changes")
+{
+  using namespace rmf_traffic::schedule;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Box>(1.0, 1.0)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+
+  const auto make_trajectory = [&](const rmf_traffic::Duration offset)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(
+        time + offset, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(
+        time + offset + 30s, Eigen::Vector3d{5, 0, 0},
+        Eigen::Vector3d{0, 0, 0});
+      return t;
+    };
+
+  const auto earliest = time - 1h;
+  const auto query_everything = make_query({"test_map"}, &earliest, nullptr);
+  const auto count = [&](const Viewer& viewer)
+    {
+      return viewer.query(query_everything).size();
+    };
+
+  for (const auto& options :
+    {TimelineOptions(), TimelineOptions::adaptive(20s, 2, 1)})
+  {
+    Database db(options);
+    std::vector<ParticipantId> participants;
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+      participants.push_back(
+        register_test_participant(
+          db, "participant_" + std::to_string(i), profile));
+
+      db.set(
+        participants.back(), 0,
+        create_test_input(make_trajectory(std::chrono::seconds(10*i))), 0, 0);
+    }
+
+    const auto first = db.snapshot();
+    CHECK(count(*first) == 6);
+
+    // Taking a snapshot without any changes in between should give the same
+    // results
+    const auto second = db.snapshot();
+    CHECK(count(*second) == 6);
+
+    db.clear(participants[0], 1);
+    db.set(
+      participants[1], 1, create_test_input(make_trajectory(100s)), 1, 1);
+    db.extend(
+      participants[2], create_test_input(make_trajectory(200s)), 1);
+
+    const auto third = db.snapshot();
+    CHECK(count(*first) == 6);
+    CHECK(count(*second) == 6);
+    CHECK(count(*third) == 6);
+    CHECK(count(*third) == count(db));
+
+    const auto lower = time + 150s;
+    const auto query_late = make_query({"test_map"}, &lower, nullptr);
+    CHECK(first->query(query_late).size() == 0);
+    CHECK(third->query(query_late).size() == 1);
+
+    db.cull(time + 45s);
+    const auto fourth = db.snapshot();
+    CHECK(count(*fourth) == count(db));
+    CHECK(count(*third) == 6);
+  }
+}
+
+//==============================================================================
+SCENARIO("Database pins")
+{
+  using namespace rmf_traffic::schedule;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Box>(1.0, 1.0)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto make_trajectory = [&](const rmf_traffic::Duration offset)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(
+        time + offset, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(
+        time + offset + 30s, Eigen::Vector3d{5, 0, 0},
+        Eigen::Vector3d{0, 0, 0});
+      return t;
+    };
+
+  const auto earliest = time - 1h;
+  const auto query_everything = make_query({"test_map"}, &earliest, nullptr);
+  const auto count = [&](const Viewer& viewer)
+    {
+      return viewer.query(query_everything).size();
+    };
+
+  auto db = std::make_unique<Database>();
+  std::vector<ParticipantId> participants;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    participants.push_back(
+      register_test_participant(
+        *db, "participant_" + std::to_string(i), profile));
+
+    db->set(
+      participants.back(), 0,
+      create_test_input(make_trajectory(std::chrono::seconds(10*i))), 0, 0);
+  }
+
+  const auto version = db->latest_version();
+  const auto first = db->pin();
+  CHECK(first->schedule_version() == version);
+  CHECK(count(*first) == 4);
+  CHECK(first->participant_ids().size() == 4);
+  CHECK(first->get_participant(participants[0]) != nullptr);
+
+  // Pins between writes are shared
+  CHECK(db->pin() == first);
+
+  db->clear(participants[0], 1);
+  db->set(
+    participants[1], 1, create_test_input(make_trajectory(100s)), 1, 1);
+
+  const auto second = db->pin();
+  CHECK(second != first);
+  CHECK(second->schedule_version() == db->latest_version());
+  CHECK(count(*second) == 3);
+  CHECK(count(*first) == 4);
+
+  const auto lower = time + 90s;
+  const auto query_late = make_query({"test_map"}, &lower, nullptr);
+  CHECK(first->query(query_late).size() == 0);
+  CHECK(second->query(query_late).size() == 1);
+
+  db->unregister_participant(participants[2]);
+  db->cull(time + 100s);
+  CHECK(count(*db) == 1);
+  CHECK(count(*first) == 4);
+  CHECK(count(*second) == 3);
+  CHECK(first->get_participant(participants[2]) != nullptr);
+
+  const auto third = db->pin();
+  CHECK(count(*third) == 1);
+
+  // Pins outlive the database
+  db.reset();
+  CHECK(count(*first) == 4);
+  CHECK(count(*third) == 1);
+  CHECK(third->participant_ids().size() == 3);
+}
+
+//==============================================================================
+SCENARIO("Database with shared reads")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database db(TimelineOptions(), Concurrency::SharedReads);
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Box>(1.0, 1.0)
+  };
+
+  const ParticipantId p = register_test_participant(db, "participant", profile);
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const std::size_t NumWrites = 200;
+
+  const auto earliest = time - 1h;
+  const auto query = make_query({"test_map"}, &earliest, nullptr);
+
+  std::atomic_bool done = false;
+  std::atomic_bool consistent = true;
+  std::vector<std::thread> readers;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    readers.emplace_back(
+      [&]()
+      {
+        while (!done)
+        {
+          // Each write replaces the whole itinerary with a single route, so
+          // every read should see at most one route.
+          if (db.query(query).size() > 1)
+            consistent = false;
+
+          if (db.snapshot()->query(query).size() > 1)
+            consistent = false;
+
+          db.get_itinerary(p);
+          db.changes(query_all(), std::nullopt);
+        }
+      });
+  }
+
+  for (std::size_t i = 0; i < NumWrites; ++i)
+  {
+    rmf_traffic::Trajectory t;
+    t.insert(
+      time + std::chrono::seconds(i),
+      Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+    t.insert(
+      time + std::chrono::seconds(i+10),
+      Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+
+    db.set(p, i, create_test_input(t), i, i);
+  }
+
+  done = true;
+  for (auto& reader : readers)
+    reader.join();
+
+  CHECK(consistent);
+  // The published snapshot should reflect the last write
+  const auto view = db.snapshot()->query(query);
+  REQUIRE(view.size() == 1);
+  CHECK(*view.begin()->route->trajectory().start_time()
+    == time + std::chrono::seconds(NumWrites-1));
+  CHECK(db.get_current_plan_id(p) == NumWrites-1);
+}
+
+//==============================================================================
+SCENARIO("Database transactions")
+{
+  using namespace rmf_traffic::schedule;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Box>(1.0, 1.0)
+  };
+
+  const auto description = [&](const std::string& name)
+    {
+      return make_test_description(name, profile);
+    };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto make_itinerary = [&](const double y)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(time, Eigen::Vector3d{0, y, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(time + 10s, Eigen::Vector3d{5, y, 0}, Eigen::Vector3d{0, 0, 0});
+      return create_test_input(t);
+    };
+
+  const auto earliest = time - 1h;
+  const auto query = make_query({"test_map"}, &earliest, nullptr);
+
+  Database batched;
+  Database individual;
+  std::vector<ParticipantId> participants;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    const auto name = "participant_" + std::to_string(i);
+    participants.push_back(
+      batched.register_participant(description(name)).id());
+    individual.register_participant(description(name));
+  }
+
+  const auto tear_down_version = batched.latest_version();
+  Mirror mirror;
+  ParticipantDescriptionsMap descriptions;
+  for (const auto id : batched.participant_ids())
+    descriptions.insert_or_assign(id, *batched.get_participant(id));
+  mirror.update_participants_info(descriptions);
+  mirror.update(batched.changes(query_all(), std::nullopt));
+
+  WHEN("A transaction sets, extends, and delays several itineraries")
+  {
+    Database::Transaction transaction;
+    for (std::size_t i = 0; i < participants.size(); ++i)
+    {
+      const auto p = participants[i];
+      transaction.set(p, 0, make_itinerary(2.0*i), 0, 0);
+      individual.set(p, 0, make_itinerary(2.0*i), 0, 0);
+    }
+
+    transaction
+    .extend(participants[0], make_itinerary(10.0), 1)
+    .delay(participants[1], 5s, 1)
+    .clear(participants[2], 1);
+    individual.extend(participants[0], make_itinerary(10.0), 1);
+    individual.delay(participants[1], 5s, 1);
+    individual.clear(participants[2], 1);
+
+    CHECK(transaction.size() == participants.size() + 3);
+    const auto version = batched.apply(transaction);
+
+    THEN("The whole transaction uses one schedule version")
+    {
+      CHECK(version == tear_down_version + 1);
+      CHECK(batched.latest_version() == version);
+      CHECK(individual.latest_version() > version);
+    }
+
+    THEN("The result is the same as applying each change individually")
+    {
+      CHECK(batched.query(query).size() == individual.query(query).size());
+      for (const auto p : participants)
+      {
+        CHECK(batched.itinerary_version(p) == individual.itinerary_version(p));
+        CHECK(batched.get_itinerary(p)->size()
+          == individual.get_itinerary(p)->size());
+      }
+
+      CHECK(*batched.get_itinerary(participants[1])->front()
+        ->trajectory().start_time() == time + 5s);
+    }
+
+    THEN("A mirror can catch up with one patch")
+    {
+      const auto patch = batched.changes(query_all(), tear_down_version);
+      CHECK(patch.latest_version() == version);
+      mirror.update(patch);
+      CHECK(mirror.latest_version() == std::optional<Version>(version));
+      CHECK(mirror.query(query).size() == batched.query(query).size());
+    }
+
+    THEN("A transaction of outdated changes does not bump the version")
+    {
+      Database::Transaction outdated;
+      outdated.set(participants[0], 1, make_itinerary(0.0), 10, 0);
+      CHECK(batched.apply(outdated) == version);
+      CHECK(batched.get_itinerary(participants[0])->size() == 2);
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Database change log")
+{
+  using namespace rmf_traffic::schedule;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto make_itinerary = [&](const double y, const std::string& map)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(time, Eigen::Vector3d{0, y, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(time + 10s, Eigen::Vector3d{5, y, 0}, Eigen::Vector3d{0, 0, 0});
+      return Itinerary{rmf_traffic::Route(map, t)};
+    };
+
+  // The same changes get applied to a database that uses its change log and to
+  // a database that has its change log turned off.
+  Database logged;
+  Database unlogged;
+  unlogged.set_change_log_retention(0);
+  CHECK(logged.get_change_log_retention() == 1024);
+  CHECK(unlogged.get_change_log_retention() == 0);
+
+  std::vector<ParticipantId> participants;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    const ParticipantDescription description{
+      "participant_" + std::to_string(i),
+      "test_Database",
+      ParticipantDescription::Rx::Responsive,
+      profile
+    };
+
+    participants.push_back(logged.register_participant(description).id());
+    unlogged.register_participant(description);
+  }
+
+  std::vector<std::function<void(Database&)>> changes;
+  for (std::size_t i = 0; i < participants.size(); ++i)
+  {
+    const auto p = participants[i];
+    const std::string map = i%2 == 0 ? "test_map" : "other_map";
+    changes.push_back(
+      [=](Database& db) { db.set(p, 0, make_itinerary(2.0*i, map), 0, 0); });
+  }
+
+  changes.push_back(
+    [&](Database& db) { db.delay(participants[0], 5s, 1); });
+  changes.push_back(
+    [&](Database& db)
+    {
+      db.extend(participants[1], make_itinerary(10.0, "test_map"), 1);
+    });
+  changes.push_back(
+    [&](Database& db) { db.clear(participants[2], 1); });
+  changes.push_back(
+    [&](Database& db)
+    {
+      db.set(participants[3], 1, make_itinerary(0.0, "test_map"), 1, 1);
+    });
+  changes.push_back(
+    [&](Database& db) { db.delay(participants[0], 2s, 2); });
+
+  for (const auto& change : changes)
+  {
+    change(logged);
+    change(unlogged);
+  }
+
+  REQUIRE(logged.latest_version() == unlogged.latest_version());
+
+  const auto earliest = time - 1h;
+  const rmf_traffic::Region region(
+    "test_map", time + 3s, time + 1h, {
+      rmf_traffic::geometry::Space{
+        rmf_traffic::geometry::make_final_convex<
+          rmf_traffic::geometry::Circle>(1.0),
+        Eigen::Isometry2d(Eigen::Translation2d(2.0, 0.0))
+      }
+    });
+
+  auto some_participants = make_query({"test_map"}, &earliest, nullptr);
+  some_participants.participants() =
+    Query::Participants::make_only({participants[0], participants[3]});
+
+  const std::vector<Query> queries = {
+    query_all(),
+    make_query({"test_map"}, &earliest, nullptr),
+    make_query({"other_map", "test_map"}, nullptr, nullptr),
+    make_query({region}),
+    some_participants
+  };
+
+  const auto describe = [](const Patch& patch)
+    {
+      std::map<ParticipantId, std::array<std::size_t, 3>> summary;
+      for (const auto& p : patch)
+      {
+        summary[p.participant_id()] = {
+          p.erasures().ids().size(),
+          p.delays().size(),
+          p.additions().items().size()
+        };
+      }
+      return summary;
+    };
+
+  const auto initial_version = logged.latest_version() - changes.size();
+  for (const auto& query : queries)
+  {
+    for (Version after = initial_version - 1;
+      after <= logged.latest_version(); ++after)
+    {
+      CAPTURE(after);
+      CHECK(describe(logged.changes(query, after))
+        == describe(unlogged.changes(query, after)));
+
+      CHECK(logged.query(query, after).size()
+        == unlogged.query(query, after).size());
+    }
+  }
+
+  // Participants 0 and 3 end up passing through the region
+  CHECK(logged.changes(make_query({region}), initial_version).size() == 2);
+
+  WHEN("The retention window is shorter than the requested versions")
+  {
+    logged.set_change_log_retention(2);
+    for (const auto& query : queries)
+    {
+      const auto after = initial_version;
+      CHECK(describe(logged.changes(query, after))
+        == describe(unlogged.changes(query, after)));
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Database subscriptions")
+{
+  using namespace rmf_traffic::schedule;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto make_itinerary = [&](const double y, const std::string& map)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(time, Eigen::Vector3d{0, y, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(time + 10s, Eigen::Vector3d{5, y, 0}, Eigen::Vector3d{0, 0, 0});
+      return Itinerary{rmf_traffic::Route(map, t)};
+    };
+
+  Database db;
+  std::vector<ParticipantId> participants;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    participants.push_back(
+      register_test_participant(
+        db, "participant_" + std::to_string(i), profile));
+  }
+
+  std::vector<std::function<void()>> changes;
+  for (std::size_t i = 0; i < participants.size(); ++i)
+  {
+    const auto p = participants[i];
+    const std::string map = i%2 == 0 ? "test_map" : "other_map";
+    changes.push_back(
+      [=, &db]() { db.set(p, 0, make_itinerary(2.0*i, map), 0, 0); });
+  }
+
+  changes.push_back([&]() { db.delay(participants[0], 5s, 1); });
+  changes.push_back(
+    [&]() { db.extend(participants[1], make_itinerary(10.0, "test_map"), 1); });
+  changes.push_back([&]() { db.clear(participants[2], 1); });
+  changes.push_back(
+    [&]()
+    {
+      db.set(participants[3], 1, make_itinerary(0.0, "other_map"), 1, 1);
+    });
+  changes.push_back([&]() { db.delay(participants[0], 2s, 2); });
+
+  const auto earliest = time - 1h;
+  auto some_participants = make_query({"test_map"}, &earliest, nullptr);
+  some_participants.participants() =
+    Query::Participants::make_only({participants[3], participants[0]});
+
+  const std::vector<Query> queries = {
+    query_all(),
+    make_query({"test_map"}, &earliest, nullptr),
+    make_query({"test_map", "other_map"}, nullptr, nullptr),
+    make_query({"other_map", "test_map"}, nullptr, nullptr),
+    some_participants
+  };
+
+  const auto describe = [](const Patch& patch)
+    {
+      std::map<ParticipantId, std::array<std::size_t, 3>> summary;
+      for (const auto& p : patch)
+      {
+        summary[p.participant_id()] = {
+          p.erasures().ids().size(),
+          p.delays().size(),
+          p.additions().items().size()
+        };
+      }
+      return summary;
+    };
+
+  // Apply the first change before anything subscribes
+  changes.front()();
+
+  std::vector<Database::SubscriptionId> subscriptions;
+  for (const auto& query : queries)
+    subscriptions.push_back(db.subscribe(query));
+
+  for (std::size_t i = 0; i < queries.size(); ++i)
+  {
+    const auto patch = db.take_patch(subscriptions[i]);
+    CHECK_FALSE(patch.base_version().has_value());
+    CHECK(describe(patch) == describe(db.changes(queries[i], std::nullopt)));
+  }
+
+  WHEN("Patches are taken after each change")
+  {
+    for (std::size_t c = 1; c < changes.size(); ++c)
+    {
+      CAPTURE(c);
+      const auto after = db.latest_version();
+      changes[c]();
+      for (std::size_t i = 0; i < queries.size(); ++i)
+      {
+        CAPTURE(i);
+        const auto patch = db.take_patch(subscriptions[i]);
+        CHECK(patch.base_version() == after);
+        CHECK(patch.latest_version() == db.latest_version());
+        CHECK(describe(patch) == describe(db.changes(queries[i], after)));
+      }
+    }
+  }
+
+  WHEN("Patches are taken after all of the changes")
+  {
+    const auto after = db.latest_version();
+    for (std::size_t c = 1; c < changes.size(); ++c)
+      changes[c]();
+
+    for (std::size_t i = 0; i < queries.size(); ++i)
+    {
+      CAPTURE(i);
+      CHECK(describe(db.take_patch(subscriptions[i]))
+        == describe(db.changes(queries[i], after)));
+
+      // Nothing has changed since the last patch
+      CHECK(db.take_patch(subscriptions[i]).size() == 0);
+    }
+  }
+
+  WHEN("More changes pile up than the change log retention")
+  {
+    db.set_change_log_retention(2);
+    const auto after = db.latest_version();
+    for (std::size_t c = 1; c < changes.size(); ++c)
+      changes[c]();
+
+    for (std::size_t i = 0; i < queries.size(); ++i)
+    {
+      CAPTURE(i);
+      CHECK(describe(db.take_patch(subscriptions[i]))
+        == describe(db.changes(queries[i], after)));
+    }
+  }
+
+  WHEN("A subscription is removed")
+  {
+    db.unsubscribe(subscriptions.front());
+    CHECK_THROWS_AS(
+      db.take_patch(subscriptions.front()), std::runtime_error);
+    CHECK_THROWS_AS(
+      db.unsubscribe(subscriptions.front()), std::runtime_error);
+
+    const auto after = db.latest_version();
+    changes[1]();
+    CHECK(describe(db.take_patch(subscriptions[1]))
+      == describe(db.changes(queries[1], after)));
+  }
+}
+
+//==============================================================================
+SCENARIO("Database culling")
+{
+  using namespace rmf_traffic::schedule;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto make_itinerary = [&](const rmf_traffic::Time start)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(start, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(start + 10s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      return create_test_input(t);
+    };
+
+  const bool background = GENERATE(false, true);
+  const bool adaptive = GENERATE(false, true);
+  CAPTURE(background);
+  CAPTURE(adaptive);
+
+  Database db(
+    adaptive ? TimelineOptions::adaptive(1min, 4, 2) : TimelineOptions());
+  db.set_background_cull_reclamation(background);
+  CHECK(db.get_background_cull_reclamation() == background);
+
+  const std::size_t N = 20;
+  std::vector<ParticipantId> participants;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    const auto p = register_test_participant(
+      db, "participant_" + std::to_string(i), profile);
+
+    // Half of the participants finish well before the cull time, and the rest
+    // finish well after it. Each one gets a long history of delays.
+    const auto start = i < N/2 ? time : time + 1h;
+    db.set(p, 0, make_itinerary(start), 0, 0);
+    for (std::size_t d = 1; d <= 50; ++d)
+      db.delay(p, 1s, d);
+
+    participants.push_back(p);
+  }
+
+  const auto earliest = time - 1h;
+  const auto query = make_query({"test_map"}, &earliest, nullptr);
+  REQUIRE(db.query(query).size() == N);
+
+  const auto cull_time = time + 30min;
+  db.cull(cull_time);
+
+  CHECK(db.query(query).size() == N/2);
+  CHECK(db.query(query_all()).size() == N/2);
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    const auto itinerary = db.get_itinerary(participants[i]);
+    REQUIRE(itinerary.has_value());
+    CHECK(itinerary->size() == (i < N/2 ? 0 : 1));
+  }
+
+  // The remaining routes can still be changed after the cull
+  db.delay(participants.back(), 1s, 51);
+  CHECK(db.query(query).size() == N/2);
+
+  // Turning off background reclamation waits for everything to be released
+  db.set_background_cull_reclamation(false);
+  CHECK_FALSE(db.get_background_cull_reclamation());
+}
+
+//==============================================================================
+SCENARIO("Database retention window")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database db(TimelineOptions(1min));
+  CHECK_FALSE(db.get_retention().has_value());
+
+  const auto p = register_test_participant(db);
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto make_route = [&](const rmf_traffic::Time start)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(start, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(start + 10s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      return create_test_input(t).front();
+    };
+
+  db.set(p, 0, {make_route(time), make_route(time + 10min)}, 0, 0);
+
+  ParticipantDescriptionsMap descriptions;
+  descriptions.insert_or_assign(p, *db.get_participant(p));
+  Mirror mirror;
+  mirror.update_participants_info(descriptions);
+  mirror.update(db.changes(query_all(), std::nullopt));
+  REQUIRE(mirror.get_itinerary(p)->size() == 2);
+
+  // Without a retention window, setting the time never culls anything
+  const auto initial_version = db.latest_version();
+  db.set_current_time(time + 1h);
+  CHECK(db.latest_version() == initial_version);
+  CHECK(db.get_itinerary(p)->size() == 2);
+
+  db.set_retention(5min);
+  REQUIRE(db.get_retention().has_value());
+  CHECK(*db.get_retention() == 5min);
+
+  db.set_current_time(time + 6min);
+  CHECK(db.latest_version() == initial_version + 1);
+  CHECK(db.get_itinerary(p)->size() == 1);
+
+  // Moving by less than a bucket does not roll the schedule again
+  db.set_current_time(time + 6min + 30s);
+  CHECK(db.latest_version() == initial_version + 1);
+
+  db.set_current_time(time + 16min);
+  CHECK(db.latest_version() == initial_version + 2);
+  CHECK(db.get_itinerary(p)->empty());
+
+  // Mirrors follow the rolling culls through their patches
+  CHECK(mirror.update(db.changes(query_all(), mirror.latest_version())));
+  CHECK(mirror.get_itinerary(p)->empty());
+
+  db.set_retention(std::nullopt);
+  db.set_current_time(time + 2h);
+  CHECK(db.latest_version() == initial_version + 2);
+}
+
+//==============================================================================
+SCENARIO("Database checkpoints")
+{
+  using namespace rmf_traffic::schedule;
+
+  const auto circle = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(1.0);
+  const auto box = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Box>(1.0, 2.0);
+
+  Database db;
+  const auto p0 = register_test_participant(
+    db, "participant_0", rmf_traffic::Profile{circle});
+
+  const auto p1 = register_test_participant(
+    db, "participant_1", rmf_traffic::Profile{circle, box},
+    ParticipantDescription::Rx::Unresponsive);
+
+  // This participant never sends any changes
+  const auto p2 = register_test_participant(
+    db, "participant_2", rmf_traffic::Profile{box});
+
+  const auto time = std::chrono::steady_clock::now();
+  const auto make_route = [&](const rmf_traffic::Duration start)
+    {
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(time + start, {0, 0, 0}, {0, 0, 0});
+      trajectory.insert(time + start + 10s, {10, 0.5, 1.0}, {0, 0, 0});
+      return rmf_traffic::Route("test_map", std::move(trajectory));
+    };
+
+  auto dependent = make_route(20s);
+  dependent.checkpoints({0, 1});
+  dependent.dependencies(
+    {{p0, rmf_traffic::DependsOnPlan(3, {{0, {{1, 0}}}})}});
+
+  db.set(p0, 3, {make_route(0s), make_route(30s)}, 10, 0);
+  db.delay(p0, 5s, 1);
+  db.reached(p0, 3, {1, 0}, 1);
+  db.set(p1, 0, {make_route(-60s), dependent}, 0, 0);
+  db.cull(time - 30s);
+
+  ParticipantDescriptionsMap descriptions;
+  for (const auto p : db.participant_ids())
+    descriptions.insert({p, *db.get_participant(p)});
+
+  Mirror mirror;
+  mirror.update_participants_info(descriptions);
+  REQUIRE(mirror.update(db.changes(query_all(), std::nullopt)));
+  CHECK(mirror.query(query_all()).size() == 3);
+
+  const auto path = "test_Database_checkpoint.rmfd";
+  db.save(path);
+  const auto loaded = Database::load(path);
+
+  CHECK(loaded.latest_version() == db.latest_version());
+  CHECK(loaded.participant_ids() == db.participant_ids());
+  for (const auto p : {p0, p1, p2})
+  {
+    CHECK(*loaded.get_participant(p) == *db.get_participant(p));
+    CHECK(loaded.itinerary_version(p) == db.itinerary_version(p));
+    CHECK(loaded.latest_plan_id(p) == db.latest_plan_id(p));
+    CHECK(loaded.next_storage_base(p) == db.next_storage_base(p));
+    CHECK(loaded.get_cumulative_delay(p) == db.get_cumulative_delay(p));
+    CHECK(*loaded.get_current_progress(p) == *db.get_current_progress(p));
+
+    const auto original = db.get_itinerary(p);
+    const auto restored = loaded.get_itinerary(p);
+    REQUIRE(original.has_value());
+    REQUIRE(restored.has_value());
+    REQUIRE(original->size() == restored->size());
+
+    std::map<rmf_traffic::Time, rmf_traffic::ConstRoutePtr> routes;
+    for (const auto& r : *original)
+      routes[*r->trajectory().start_time()] = r;
+
+    for (const auto& r : *restored)
+    {
+      const auto it = routes.find(*r->trajectory().start_time());
+      REQUIRE(it != routes.end());
+      const auto& o = *it->second;
+      CHECK(r->map() == o.map());
+      CHECK(r->checkpoints() == o.checkpoints());
+      CHECK(r->dependencies().size() == o.dependencies().size());
+      REQUIRE(r->trajectory().size() == o.trajectory().size());
+      for (std::size_t i = 0; i < o.trajectory().size(); ++i)
+      {
+        CHECK(r->trajectory()[i].time() == o.trajectory()[i].time());
+        CHECK(r->trajectory()[i].position() == o.trajectory()[i].position());
+      }
+    }
+  }
+
+  WHEN("The restored database keeps going")
+  {
+    Database restored = Database::load(path);
+    restored.extend(p1, {make_route(100s)}, 1);
+    restored.delay(p0, 1s, 2);
+
+    // A mirror that was in sync before the restart can keep up incrementally
+    REQUIRE(mirror.update(
+        restored.changes(query_all(), mirror.latest_version())));
+    CHECK(mirror.latest_version() == restored.latest_version());
+    CHECK(mirror.get_itinerary(p1)->size() == 2);
+    CHECK(mirror.get_itinerary(p0)->size() == 2);
+    CHECK(mirror.query(query_all()).size() == 4);
+
+    // A mirror that is older than the checkpoint gets a full update
+    Mirror fresh;
+    fresh.update_participants_info(descriptions);
+    REQUIRE(fresh.update(restored.changes(query_all(), 1)));
+    CHECK(fresh.query(query_all()).size() == 4);
+
+    // New participants do not reuse the IDs of the old ones
+    const auto p3 = register_test_participant(
+      restored, "participant_3", rmf_traffic::Profile{circle});
+    CHECK(p3 != p0);
+    CHECK(p3 != p1);
+    CHECK(p3 != p2);
+
+    // Out-of-order changes are still recognized as inconsistencies
+    restored.delay(p0, 1s, 5);
+    bool inconsistent = false;
+    for (const auto& i : restored.inconsistencies())
+    {
+      if (i.participant == p0 && i.ranges.size() > 0)
+        inconsistent = true;
+    }
+    CHECK(inconsistent);
+  }
+
+  WHEN("The checkpoint is not valid")
+  {
+    CHECK_THROWS_AS(
+      Database::load("test_Database_missing.rmfd"), std::runtime_error);
+
+    {
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      file << "RMFD";
+    }
+    CHECK_THROWS_AS(Database::load(path), std::runtime_error);
+  }
+
+  WHEN("The checkpoint cannot be written")
+  {
+    CHECK_THROWS_AS(
+      db.save("test_Database_missing_directory/checkpoint.rmfd"),
+      std::runtime_error);
+  }
+
+  std::remove(path);
+}
+
+//==============================================================================
+SCENARIO("Database query cache")
+{
+  using namespace rmf_traffic::schedule;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto make_route = [&](
+    const double y, const std::string& map, const rmf_traffic::Duration start)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(time + start, {0, y, 0}, {0, 0, 0});
+      t.insert(time + start + 10s, {5, y, 0}, {0, 0, 0});
+      return rmf_traffic::Route(map, t);
+    };
+
+  // The same changes get applied to a database that caches its queries and to
+  // a database that does not.
+  Database cached;
+  Database uncached;
+  cached.set_query_cache_capacity(8);
+  CHECK(cached.get_query_cache_capacity() == 8);
+  CHECK(uncached.get_query_cache_capacity() == 0);
+
+  std::vector<ParticipantId> participants;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    const ParticipantDescription description{
+      "participant_" + std::to_string(i),
+      "test_Database",
+      ParticipantDescription::Rx::Responsive,
+      profile
+    };
+
+    participants.push_back(cached.register_participant(description).id());
+    uncached.register_participant(description);
+  }
+
+  const auto apply = [&](const auto& change)
+    {
+      change(cached);
+      change(uncached);
+    };
+
+  apply([&](Database& db)
+    {
+      db.set(participants[0], 0,
+        {make_route(0, "A", 0s), make_route(0, "B", 30s)}, 0, 0);
+      db.set(participants[1], 0, {make_route(3, "A", 20s)}, 0, 0);
+      db.set(participants[2], 0, {make_route(6, "B", 5s)}, 0, 0);
+    });
+
+  using Entries = std::set<std::pair<ParticipantId, RouteId>>;
+  const auto entries = [](const Viewer::View& view)
+    {
+      Entries output;
+      for (const auto& v : view)
+        output.insert({v.participant, v.route_id});
+
+      CHECK(output.size() == view.size());
+      return output;
+    };
+
+  const auto timespan = [&](
+    std::vector<std::string> maps,
+    const rmf_traffic::Duration lower,
+    const rmf_traffic::Duration upper,
+    const Query::Participants& participants)
+    {
+      Query::Spacetime spacetime;
+      auto& span = spacetime.query_timespan();
+      span.all_maps(maps.empty());
+      for (auto& map : maps)
+        span.add_map(std::move(map));
+
+      span.set_lower_time_bound(time + lower);
+      span.set_upper_time_bound(time + upper);
+      return std::make_pair(spacetime, participants);
+    };
+
+  const auto all = Query::Participants::make_all();
+  const auto only_0 = Query::Participants::make_only({participants[0]});
+  std::vector<std::pair<Query::Spacetime, Query::Participants>> queries = {
+    {query_all().spacetime(), all},
+    timespan({}, 0s, 60s, all),
+    timespan({"A"}, 0s, 60s, all),
+    timespan({"A", "B"}, 15s, 25s, all),
+    timespan({"B"}, 12s, 14s, all),
+    timespan({"A"}, 0s, 5s, only_0),
+    {query_all().spacetime(), only_0},
+    timespan({}, 25s, 60s, Query::Participants::make_all_except(
+        {participants[1]})),
+    {rmf_traffic::schedule::make_query(
+        {
+          rmf_traffic::Region{"A", time, time + 60s,
+            {
+              rmf_traffic::geometry::Space{
+                rmf_traffic::geometry::make_final_convex<
+                  rmf_traffic::geometry::Circle>(1.0),
+                Eigen::Isometry2d::Identity()
+              }
+            }}
+        }).spacetime(), all}
+  };
+
+  const auto check_queries = [&]()
+    {
+      // Each query is asked twice so that the second one is answered by the
+      // cache.
+      for (std::size_t repeat = 0; repeat < 2; ++repeat)
+      {
+        for (const auto& [spacetime, participants] : queries)
+        {
+          CHECK(entries(cached.query(spacetime, participants))
+            == entries(uncached.query(spacetime, participants)));
+        }
+      }
+    };
+
+  check_queries();
+  CHECK(entries(cached.query(queries[3].first, queries[3].second)).size() == 2);
+  CHECK(entries(cached.query(queries[5].first, queries[5].second)).size() == 1);
+
+  WHEN("The database changes")
+  {
+    apply([&](Database& db)
+      {
+        db.delay(participants[1], 10s, 1);
+        db.extend(participants[2], {make_route(9, "A", 0s)}, 1);
+      });
+
+    check_queries();
+    CHECK(entries(cached.query(queries[2].first, queries[2].second)).size()
+      == 3);
+
+    apply([&](Database& db) { db.clear(participants[0], 2); });
+    check_queries();
+
+    apply([&](Database& db) { db.cull(time + 32s); });
+    check_queries();
+  }
+
+  WHEN("A snapshot is taken")
+  {
+    const auto snapshot = cached.snapshot();
+    apply([&](Database& db) { db.clear(participants[0], 1); });
+
+    for (std::size_t repeat = 0; repeat < 2; ++repeat)
+    {
+      const auto view = snapshot->query(queries[2].first, queries[2].second);
+      CHECK(entries(view).size() == 2);
+    }
+
+    check_queries();
+  }
+
+  WHEN("A mirror caches its queries")
+  {
+    Mirror mirror;
+    mirror.set_query_cache_capacity(4);
+    CHECK(mirror.get_query_cache_capacity() == 4);
+
+    ParticipantDescriptionsMap descriptions;
+    for (const auto p : participants)
+      descriptions.insert({p, *cached.get_participant(p)});
+
+    mirror.update_participants_info(descriptions);
+    REQUIRE(mirror.update(cached.changes(query_all(), std::nullopt)));
+    CHECK(entries(mirror.query(query_all())).size() == 4);
+    CHECK(entries(mirror.query(query_all())).size() == 4);
+
+    descriptions.erase(participants[0]);
+    mirror.update_participants_info(descriptions);
+    CHECK(entries(mirror.query(query_all())).size() == 2);
+
+    const auto version = cached.latest_version();
+    cached.delay(participants[1], 5s, 1);
+    REQUIRE(mirror.update(cached.changes(query_all(), version)));
+    const auto view = mirror.query(queries[3].first, queries[3].second);
+    for (const auto& v : view)
+    {
+      if (v.participant != participants[1])
+        continue;
+
+      CHECK(*v.route->trajectory().start_time() == time + 25s);
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Views outlive the schedule that made them")
+{
+  using namespace rmf_traffic::schedule;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory t;
+  t.insert(time, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  t.insert(time + 10s, Eigen::Vector3d{10, 0, 0}, Eigen::Vector3d{0, 0, 0});
+
+  auto db = std::make_unique<Database>();
+  std::vector<ParticipantId> participants;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    const auto id = register_test_participant(
+      *db, "participant_" + std::to_string(i), profile);
+
+    db->set(id, 0, {create_test_input(t).front(), create_test_input(t).front()},
+      0, 0);
+    participants.push_back(id);
+  }
+
+  const auto check_view = [&](const Viewer::View& view)
+    {
+      CHECK(view.size() == 6);
+      std::set<std::string> names;
+      for (const auto& element : view)
+      {
+        names.insert(element.description.name());
+        CHECK(element.route->map() == "test_map");
+      }
+
+      CHECK(names.size() == 3);
+      CHECK(names.count("participant_0") == 1);
+    };
+
+  auto snapshot = db->snapshot();
+  const auto snapshot_view = snapshot->query(query_all());
+  const auto database_view = db->query(query_all());
+
+  // Replace the descriptions and routes that the views refer to, and then
+  // get rid of the snapshot and the database.
+  for (const auto p : participants)
+  {
+    db->update_description(
+      p, make_test_description("renamed", profile));
+
+    db->clear(p, 1);
+  }
+
+  snapshot.reset();
+  db.reset();
+
+  check_view(snapshot_view);
+  check_view(database_view);
+}
+
+//==============================================================================
+SCENARIO("Database participant descriptions are shared")
+{
+  using namespace rmf_traffic::schedule;
+
+  const auto make_description = [](const std::string& owner)
+    {
+      // Each description gets its own copy of the shape
+      return ParticipantDescription{
+        "robot", owner, ParticipantDescription::Rx::Responsive,
+        rmf_traffic::Profile{
+          rmf_traffic::geometry::make_final_convex<
+            rmf_traffic::geometry::Circle>(0.5)
+        }
+      };
+    };
+
+  CHECK(make_description("fleet").hash() == make_description("fleet").hash());
+  CHECK(make_description("fleet").hash() != make_description("other").hash());
+
+  Database db;
+  const auto p0 = db.register_participant(make_description("fleet")).id();
+  const auto p1 = db.register_participant(make_description("fleet")).id();
+  const auto p2 = db.register_participant(make_description("other")).id();
+
+  CHECK(db.get_participant(p0) == db.get_participant(p1));
+  CHECK(db.get_participant(p0) != db.get_participant(p2));
+  CHECK(db.get_participant(p0)->profile().footprint()
+    == db.get_participant(p2)->profile().footprint());
+
+  WHEN("A participant is given the description it already has")
+  {
+    const auto version = db.latest_version();
+    db.update_description(p0, make_description("fleet"));
+    CHECK(db.latest_version() == version);
+    CHECK(db.get_participant(p0) == db.get_participant(p1));
+  }
+
+  WHEN("A participant is given a new description")
+  {
+    const auto version = db.latest_version();
+    db.update_description(p0, make_description("other"));
+    CHECK(db.latest_version() == version + 1);
+    CHECK(db.get_participant(p0) == db.get_participant(p2));
+    CHECK(db.get_participant(p1)->owner() == "fleet");
+  }
+}
+
+//==============================================================================
+SCENARIO("Database itinerary views")
+{
+  using namespace rmf_traffic::schedule;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory t;
+  t.insert(time, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  t.insert(time + 10s, Eigen::Vector3d{10, 0, 0}, Eigen::Vector3d{0, 0, 0});
+
+  Database db;
+  const auto make_participant = [&](const std::string& name)
+    {
+      return register_test_participant(db, name, profile);
+    };
+
+  const auto p0 = make_participant("p0");
+  const auto p1 = make_participant("p1");
+  CHECK_FALSE(db.get_itinerary_view(p1 + 10));
+
+  db.set(p0, 0, create_test_input(t), 0, 0);
+  db.set(p1, 0, create_test_input(t), 0, 0);
+
+  const auto view = db.get_itinerary_view(p0);
+  REQUIRE(view);
+  CHECK(view->size() == 1);
+  CHECK(db.get_itinerary_view(p0) == view);
+  CHECK(*db.get_itinerary(p0) == *view);
+
+  // Changing another participant leaves this view alone
+  db.delay(p1, 5s, 1);
+  CHECK(db.get_itinerary_view(p0) == view);
+
+  const auto check_changed = [&]()
+    {
+      const auto changed = db.get_itinerary_view(p0);
+      REQUIRE(changed);
+      CHECK(changed != view);
+      CHECK(*db.get_itinerary(p0) == *changed);
+      CHECK(view->size() == 1);
+      return changed;
+    };
+
+  WHEN("The itinerary is extended")
+  {
+    db.extend(p0, create_test_input(t), 1);
+    CHECK(check_changed()->size() == 2);
+  }
+
+  WHEN("The itinerary is delayed")
+  {
+    db.delay(p0, 5s, 1);
+    const auto changed = check_changed();
+    CHECK(changed->front()->trajectory().back().time() == time + 15s);
+  }
+
+  WHEN("The itinerary is cleared")
+  {
+    db.clear(p0, 1);
+    CHECK(check_changed()->empty());
+  }
+
+  WHEN("The itinerary is replaced")
+  {
+    db.set(p0, 1, create_test_input(t), 1, 1);
+    CHECK(check_changed()->size() == 1);
+  }
+}
+
+//==============================================================================
+SCENARIO("Database out of order limit")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  CHECK(db.get_out_of_order_limit() == 256);
+  db.set_out_of_order_limit(3);
+  CHECK(db.get_out_of_order_limit() == 3);
+
+  const auto p = register_test_participant(db);
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory t;
+  t.insert(time, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  t.insert(time + 10s, Eigen::Vector3d{10, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  const auto route = create_test_input(t).front();
+
+  db.set(p, 0, {route}, 0, 0);
+
+  const auto missing = [&]()
+    {
+      std::vector<std::pair<ItineraryVersion, ItineraryVersion>> output;
+      for (const auto& range : db.inconsistencies().find(p)->ranges)
+        output.push_back({range.lower, range.upper});
+
+      return output;
+    };
+
+  using Missing = std::vector<std::pair<ItineraryVersion, ItineraryVersion>>;
+
+  WHEN("Changes arrive out of order within the limit")
+  {
+    db.clear(p, 2);
+    db.extend(p, {route}, 3);
+    CHECK(missing() == Missing{{1, 1}});
+    CHECK(db.get_itinerary(p)->size() == 1);
+
+    db.extend(p, {route, route}, 1);
+    CHECK(missing().empty());
+
+    // The held changes are applied in order, so the clear removes the routes
+    // of the first extension before the second extension is applied.
+    CHECK(db.get_itinerary(p)->size() == 1);
+    CHECK(db.itinerary_version(p) == 3);
+  }
+
+  WHEN("A change arrives too far ahead of a missing change")
+  {
+    db.extend(p, {route}, 2);
+    db.extend(p, {route}, 4);
+
+    // The change with version 4 could not be held, so it is reported as
+    // missing along with version 3.
+    CHECK(missing() == Missing{{1, 1}, {3, 4}});
+    CHECK(db.inconsistencies().find(p)->ranges.last_known_version() == 4);
+
+    db.extend(p, {route}, 1);
+    CHECK(missing() == Missing{{3, 4}});
+    CHECK(db.get_itinerary(p)->size() == 3);
+
+    THEN("Resending the discarded change resolves the inconsistency")
+    {
+      db.extend(p, {route}, 4);
+      CHECK(missing() == Missing{{3, 3}});
+
+      db.extend(p, {route}, 3);
+      CHECK(missing().empty());
+      CHECK(db.get_itinerary(p)->size() == 5);
+      CHECK(db.itinerary_version(p) == 4);
+    }
+
+    THEN("A nullifying change is accepted right away")
+    {
+      db.set(p, 1, {route}, 10, 5);
+      CHECK(missing().empty());
+      CHECK(db.get_itinerary(p)->size() == 1);
+      CHECK(db.itinerary_version(p) == 5);
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Database dependencies on many checkpoints")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  const auto p = register_test_participant(db);
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory t;
+  t.insert(time, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  t.insert(time + 10s, Eigen::Vector3d{10, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  const auto route = create_test_input(t).front();
+
+  db.set(p, 0, {route, route}, 0, 0);
+
+  // Watch every checkpoint of both routes, in a shuffled order
+  const std::size_t N = 20;
+  std::vector<std::vector<int>> reached(2, std::vector<int>(N, 0));
+  std::vector<std::vector<int>> deprecated(2, std::vector<int>(N, 0));
+  std::vector<ItineraryViewer::DependencySubscription> subscriptions;
+  for (std::size_t i = 0; i < N; ++i)
+  {
+    const std::size_t c = (i * 7) % N;
+    for (std::size_t r = 0; r < 2; ++r)
+    {
+      subscriptions.push_back(
+        db.watch_dependency(
+          rmf_traffic::Dependency{p, 0, r, c},
+          [&reached, r, c]() { ++reached[r][c]; },
+          [&deprecated, r, c]() { ++deprecated[r][c]; }));
+    }
+  }
+
+  // A dependency can be watched from inside of a notification
+  std::optional<ItineraryViewer::DependencySubscription> nested;
+  bool nested_reached = false;
+  subscriptions.push_back(
+    db.watch_dependency(
+      rmf_traffic::Dependency{p, 0, 0, 5},
+      [&]()
+      {
+        nested = db.watch_dependency(
+          rmf_traffic::Dependency{p, 0, 1, 3},
+          [&]() { nested_reached = true; }, []() {});
+      },
+      []() {}));
+
+  db.reached(p, 0, {9, 3}, 0);
+  for (std::size_t c = 0; c < N; ++c)
+  {
+    CHECK(reached[0][c] == (c <= 9 ? 1 : 0));
+    CHECK(reached[1][c] == (c <= 3 ? 1 : 0));
+  }
+
+  REQUIRE(nested.has_value());
+  CHECK(nested_reached);
+
+  db.reached(p, 0, {12, 3}, 1);
+  for (std::size_t c = 0; c < N; ++c)
+    CHECK(reached[0][c] == (c <= 12 ? 1 : 0));
+
+  // Setting a new plan deprecates everything that has not been reached
+  db.set(p, 1, {route}, 2, 1);
+  for (std::size_t c = 0; c < N; ++c)
+  {
+    CHECK(deprecated[0][c] == (c <= 12 ? 0 : 1));
+    CHECK(deprecated[1][c] == (c <= 3 ? 0 : 1));
+  }
+}
+
+//==============================================================================
+SCENARIO("Database progress along one route")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  const auto p = register_test_participant(db);
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory t;
+  t.insert(time, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  t.insert(time + 10s, Eigen::Vector3d{10, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  const auto route = create_test_input(t).front();
+
+  db.set(p, 0, {route, route}, 0, 0);
+
+  std::vector<std::string> events;
+  std::vector<ItineraryViewer::DependencySubscription> subscriptions;
+  const auto watch = [&](
+    const rmf_traffic::PlanId plan,
+    const rmf_traffic::RouteId r,
+    const rmf_traffic::CheckpointId c)
+    {
+      const std::string name = std::to_string(plan) + ":"
+        + std::to_string(r) + ":" + std::to_string(c);
+      subscriptions.push_back(
+        db.watch_dependency(
+          rmf_traffic::Dependency{p, plan, r, c},
+          [&events, name]() { events.push_back("reached " + name); },
+          [&events, name]() { events.push_back("deprecated " + name); }));
+    };
+
+  watch(0, 0, 2);
+  watch(0, 1, 1);
+  watch(0, 1, 4);
+
+  auto version = db.latest_version();
+  db.reached(p, 0, 1, 1, 0);
+  CHECK(db.latest_version() == ++version);
+  REQUIRE(events.size() == 1);
+  CHECK(events.back() == "reached 0:1:1");
+
+  const auto* progress = db.get_current_progress(p);
+  REQUIRE(progress);
+  REQUIRE(progress->size() == 2);
+  CHECK((*progress)[0] == 0);
+  CHECK((*progress)[1] == 1);
+
+  // Progress that is not beyond what is known changes nothing
+  db.reached(p, 0, 1, 1, 1);
+  db.reached(p, 0, 1, 0, 1);
+  CHECK(db.latest_version() == version);
+  CHECK(events.size() == 1);
+
+  WHEN("Progress arrives for a plan that has not been set yet")
+  {
+    db.reached(p, 1, 0, 3, 1);
+    CHECK(db.latest_version() == version);
+
+    db.set(p, 1, {route}, 2, 1);
+    progress = db.get_current_progress(p);
+    REQUIRE(progress);
+    CHECK((*progress)[0] == 3);
+  }
+
+  WHEN("Progress is reported in a transaction")
+  {
+    Database::Transaction transaction;
+    transaction
+    .reached(p, 0, 0, 2, 1)
+    .reached(p, 0, 1, 4, 2)
+    .set(p, 1, {route}, 2, 1);
+
+    // The watchers are not notified while the transaction is being applied,
+    // so each notification is made once it has all been applied.
+    db.apply(transaction);
+    REQUIRE(events.size() == 3);
+    CHECK(events[1] == "reached 0:0:2");
+    CHECK(events[2] == "reached 0:1:4");
+    CHECK(db.latest_version() == version + 1);
+  }
+}
+
+//==============================================================================
+SCENARIO("Database extensions append to the itinerary")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  const auto p = register_test_participant(db);
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  const auto make_route = [&](const rmf_traffic::Time start)
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(start, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      t.insert(start + 10s, Eigen::Vector3d{5, 0, 0}, Eigen::Vector3d{0, 0, 0});
+      return create_test_input(t).front();
+    };
+
+  const auto r0 = make_route(time);
+  const auto r1 = make_route(time + 1min);
+  const auto r2 = make_route(time + 2min);
+
+  db.set(p, 0, {r0}, 0, 0);
+
+  // Sending the same itinerary again does not change the schedule, and it
+  // leaves the database with a hash of the active routes.
+  const auto v0 = db.latest_version();
+  db.set(p, 0, {r0}, 0, 1);
+  CHECK(db.latest_version() == v0);
+
+  db.extend(p, {r1, r2}, 2);
+  const auto v1 = db.latest_version();
+  CHECK(v1 == v0 + 1);
+  REQUIRE(db.get_itinerary(p)->size() == 3);
+
+  // Only the new routes are reported as changes
+  const auto patch = db.changes(query_all(), v0);
+  std::size_t additions = 0;
+  for (const auto& change : patch)
+    additions += change.additions().items().size();
+  CHECK(additions == 2);
+
+  // The hash that was carried through the extension still matches
+  db.set(p, 0, {r0, r1, r2}, 0, 3);
+  CHECK(db.latest_version() == v1);
+
+  // A different itinerary is still noticed
+  db.set(p, 0, {r0, r2, r1}, 0, 4);
+  CHECK(db.latest_version() == v1 + 1);
+}
+
+//==============================================================================
+SCENARIO("Database memory usage")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  const auto p = register_test_participant(db);
+
+  const auto empty = db.memory_usage();
+  REQUIRE(empty.participants.count(p) == 1);
+  CHECK(empty.participants.at(p).routes > 0);
+  CHECK(empty.participants.at(p).change_history == 0);
+  CHECK(empty.maps.empty());
+
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory t;
+  t.insert(time, Eigen::Vector3d{0, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  t.insert(time + 10s, Eigen::Vector3d{10, 0, 0}, Eigen::Vector3d{0, 0, 0});
+  const auto route = create_test_input(t).front();
+
+  db.set(p, 0, {route}, 0, 0);
+  const auto one = db.memory_usage();
+  CHECK(one.participants.at(p).routes > empty.participants.at(p).routes);
+  REQUIRE(one.maps.count("test_map") == 1);
+  CHECK(one.maps.at("test_map").buckets > 0);
+  CHECK(one.maps.at("test_map").bytes > 0);
+  CHECK(one.total() > empty.total());
+
+  WHEN("Routes are delayed")
+  {
+    db.delay(p, 5s, 1);
+
+    // The route from before the delay is kept to make patches
+    CHECK(db.memory_usage().participants.at(p).change_history > 0);
+  }
+
+  WHEN("Changes are held back by an inconsistency")
+  {
+    db.extend(p, {route, route}, 2);
+    CHECK(db.memory_usage().participants.at(p).inconsistencies
+      > one.participants.at(p).inconsistencies);
+  }
+
+  WHEN("A mirror is updated")
+  {
+    ParticipantDescriptionsMap descriptions;
+    descriptions.insert_or_assign(p, *db.get_participant(p));
+    Mirror mirror;
+    mirror.update_participants_info(descriptions);
+    mirror.update(db.changes(query_all(), std::nullopt));
+    REQUIRE(mirror.get_itinerary(p)->size() == 1);
+
+    const auto mirrored = mirror.memory_usage();
+    REQUIRE(mirrored.participants.count(p) == 1);
+    CHECK(mirrored.participants.at(p).routes > 0);
+    CHECK(mirrored.participants.at(p).change_history == 0);
+    CHECK(mirrored.maps.count("test_map") == 1);
+  }
+}
@@ -28,6 +28,7 @@
 #include <rmf_traffic/schedule/Mirror.hpp>
 #include <rmf_traffic/DetectConflict.hpp>
 
+#include <set>
 #include <unordered_map>
 
 using namespace std::chrono_literals;
@@ -766,3 +767,301 @@ SCENARIO("Test forking off of mirrors")
   // the mirror is out of sync? How would their changesets be impacted?
 }
 
+
+//==============================================================================
+SCENARIO("Mirror subscribed to some maps")
+{
+  using namespace std::chrono_literals;
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  const auto profile = rmf_traffic::Profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  const auto p0 = db.register_participant(
+    ParticipantDescription{
+      "participant_0",
+      "test_Mirror",
+      ParticipantDescription::Rx::Responsive,
+      profile
+    }).id();
+
+  const auto time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(time, {0, 0, 0}, {0, 0, 0});
+  trajectory.insert(time + 10s, {10, 0, 0}, {0, 0, 0});
+
+  db.set(
+    p0, 0,
+    {
+      rmf_traffic::Route("test_map", trajectory),
+      rmf_traffic::Route("other_map", trajectory)
+    }, 0, 0);
+
+  const auto query_all = rmf_traffic::schedule::query_all();
+
+  Mirror mirror;
+  CHECK_FALSE(mirror.subscribed_maps().has_value());
+  mirror.subscribe_to_maps({"test_map"});
+  REQUIRE(mirror.subscribed_maps().has_value());
+  CHECK(mirror.subscribed_maps()->count("test_map") == 1);
+
+  mirror.update_participants_info(
+    {{p0, *db.get_participant(p0)}});
+  REQUIRE(mirror.update(db.changes(query_all, std::nullopt)));
+  CHECK(mirror.latest_version() == db.latest_version());
+
+  const auto check_only_test_map = [&]()
+    {
+      const auto view = mirror.query(query_all);
+      for (const auto& v : view)
+        CHECK(v.route->map() == "test_map");
+
+      return view.size();
+    };
+
+  CHECK(check_only_test_map() == 1);
+  CHECK(mirror.get_itinerary(p0)->size() == 1);
+  REQUIRE(mirror.get_current_progress(p0));
+  CHECK(mirror.get_current_progress(p0)->size() == 2);
+
+  WHEN("Incremental changes arrive")
+  {
+    auto version = db.latest_version();
+    db.delay(p0, 5s, 1);
+    db.extend(
+      p0,
+      {
+        rmf_traffic::Route("other_map", trajectory),
+        rmf_traffic::Route("test_map", trajectory)
+      }, 2);
+
+    REQUIRE(mirror.update(db.changes(query_all, version)));
+    CHECK(mirror.latest_version() == db.latest_version());
+    CHECK(check_only_test_map() == 2);
+    CHECK(mirror.get_current_progress(p0)->size() == 4);
+
+    const auto itinerary = mirror.get_itinerary(p0);
+    REQUIRE(itinerary.has_value());
+    std::size_t delayed = 0;
+    for (const auto& route : *itinerary)
+    {
+      if (*route->trajectory().start_time() == time + 5s)
+        ++delayed;
+    }
+    CHECK(delayed == 1);
+
+    version = db.latest_version();
+    db.set(p0, 1, {rmf_traffic::Route("other_map", trajectory)}, 4, 3);
+    REQUIRE(mirror.update(db.changes(query_all, version)));
+    CHECK(check_only_test_map() == 0);
+    CHECK(mirror.get_itinerary(p0)->empty());
+    CHECK(mirror.get_current_plan_id(p0) == 1);
+    CHECK(mirror.get_current_progress(p0)->size() == 1);
+
+    // The fork of a partial mirror only contains the subscribed maps, but it
+    // should not reuse the storage IDs of the skipped routes.
+    const auto fork = mirror.fork();
+    CHECK(fork.query(query_all).size() == 0);
+  }
+
+  WHEN("The subscription is narrowed")
+  {
+    mirror.subscribe_to_maps({});
+    CHECK(check_only_test_map() == 0);
+    CHECK(mirror.latest_version() == db.latest_version());
+
+    const auto version = db.latest_version();
+    db.extend(p0, {rmf_traffic::Route("test_map", trajectory)}, 1);
+    REQUIRE(mirror.update(db.changes(query_all, version)));
+    CHECK(check_only_test_map() == 0);
+  }
+
+  WHEN("The subscription is widened")
+  {
+    const auto version = db.latest_version();
+    db.extend(p0, {rmf_traffic::Route("other_map", trajectory)}, 1);
+
+    mirror.subscribe_to_all_maps();
+    CHECK_FALSE(mirror.subscribed_maps().has_value());
+    CHECK_FALSE(mirror.latest_version().has_value());
+    CHECK(check_only_test_map() == 0);
+
+    // An incremental patch cannot be applied anymore
+    CHECK_FALSE(mirror.update(db.changes(query_all, version)));
+
+    REQUIRE(mirror.update(db.changes(query_all, std::nullopt)));
+    CHECK(mirror.query(query_all).size() == 3);
+    CHECK(mirror.latest_version() == db.latest_version());
+  }
+}
+
+//==============================================================================
+SCENARIO("Mirror batch updates")
+{
+  using namespace std::chrono_literals;
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  const auto profile = rmf_traffic::Profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  std::vector<ParticipantId> participants;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    participants.push_back(
+      db.register_participant(
+        ParticipantDescription{
+          "participant_" + std::to_string(i),
+          "test_Mirror",
+          ParticipantDescription::Rx::Responsive,
+          profile
+        }).id());
+  }
+
+  const auto time = std::chrono::steady_clock::now();
+  const auto make_route = [&](const rmf_traffic::Duration start)
+    {
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(time + start, {0, 0, 0}, {0, 0, 0});
+      trajectory.insert(time + start + 10s, {10, 0, 0}, {0, 0, 0});
+      return rmf_traffic::Route("test_map", std::move(trajectory));
+    };
+
+  const auto query_all = rmf_traffic::schedule::query_all();
+  std::vector<Patch> patches;
+  auto record = [&]()
+    {
+      const std::optional<Version> base = patches.empty() ?
+        std::nullopt : std::optional<Version>(patches.back().latest_version());
+      patches.push_back(db.changes(query_all, base));
+    };
+
+  record();
+  db.set(participants[0], 0, {make_route(0s), make_route(20s)}, 0, 0);
+  record();
+  db.delay(participants[0], 5s, 1);
+  record();
+  db.set(participants[0], 1, {make_route(30s)}, 2, 2);
+  record();
+  db.set(participants[1], 0, {make_route(0s)}, 0, 0);
+  record();
+  db.extend(participants[1], {make_route(40s)}, 1);
+  record();
+  db.delay(participants[1], 2s, 2);
+  record();
+  db.reached(participants[1], 0, {1, 0}, 1);
+  record();
+  db.set(participants[2], 0, {make_route(10s)}, 0, 0);
+  record();
+  db.clear(participants[2], 1);
+  record();
+
+  const auto compare = [&](const Mirror& a, const Mirror& b)
+    {
+      CHECK(a.latest_version() == b.latest_version());
+      CHECK(a.query(query_all).size() == b.query(query_all).size());
+      for (const auto p : participants)
+      {
+        CHECK(a.get_current_plan_id(p) == b.get_current_plan_id(p));
+
+        const auto itinerary_a = a.get_itinerary(p);
+        const auto itinerary_b = b.get_itinerary(p);
+        REQUIRE(itinerary_a.has_value() == itinerary_b.has_value());
+        if (!itinerary_a.has_value())
+          continue;
+
+        REQUIRE(itinerary_a->size() == itinerary_b->size());
+        std::multiset<rmf_traffic::Time> starts_a;
+        std::multiset<rmf_traffic::Time> starts_b;
+        for (const auto& r : *itinerary_a)
+          starts_a.insert(*r->trajectory().start_time());
+        for (const auto& r : *itinerary_b)
+          starts_b.insert(*r->trajectory().start_time());
+        CHECK(starts_a == starts_b);
+
+        const auto* progress_a = a.get_current_progress(p);
+        const auto* progress_b = b.get_current_progress(p);
+        REQUIRE((progress_a == nullptr) == (progress_b == nullptr));
+        if (progress_a)
+          CHECK(*progress_a == *progress_b);
+      }
+    };
+
+  Mirror one_by_one;
+  for (const auto& patch : patches)
+    REQUIRE(one_by_one.update(patch));
+  CHECK(one_by_one.latest_version() == db.latest_version());
+
+  WHEN("All the patches are applied at once")
+  {
+    Mirror batch;
+    REQUIRE(batch.update(patches));
+    compare(one_by_one, batch);
+  }
+
+  WHEN("The batch is split up")
+  {
+    Mirror batch;
+    const auto middle = patches.begin() + patches.size()/2;
+    REQUIRE(batch.update(std::vector<Patch>(patches.begin(), middle)));
+    REQUIRE(batch.update(std::vector<Patch>(middle, patches.end())));
+    compare(one_by_one, batch);
+
+    // Patches that the mirror already has are ignored
+    CHECK(batch.update(patches));
+    compare(one_by_one, batch);
+  }
+
+  WHEN("A cull happens within the batch")
+  {
+    const auto version = db.latest_version();
+    db.set(participants[2], 1, {make_route(100s)}, 1, 2);
+    const auto before_cull = db.changes(query_all, version);
+    db.cull(time + 39s);
+    const auto cull = db.changes(query_all, before_cull.latest_version());
+    REQUIRE(cull.cull());
+
+    REQUIRE(one_by_one.update(before_cull));
+    REQUIRE(one_by_one.update(cull));
+
+    auto all = patches;
+    all.push_back(before_cull);
+    all.push_back(cull);
+
+    Mirror batch;
+    REQUIRE(batch.update(all));
+    compare(one_by_one, batch);
+  }
+
+  WHEN("A patch is missing from the batch")
+  {
+    auto missing = patches;
+    missing.erase(missing.begin() + 4);
+
+    Mirror batch;
+    CHECK_FALSE(batch.update(missing));
+    CHECK(batch.latest_version() == patches[3].latest_version());
+
+    REQUIRE(batch.update(std::vector<Patch>(patches.begin() + 4, patches.end())));
+    compare(one_by_one, batch);
+  }
+
+  WHEN("The batch contains a full update")
+  {
+    auto with_full = patches;
+    with_full.push_back(db.changes(query_all, std::nullopt));
+
+    // Everything before the full update gets replaced by it
+    Mirror full;
+    REQUIRE(full.update(with_full.back()));
+
+    Mirror batch;
+    REQUIRE(batch.update(with_full));
+    compare(full, batch);
+  }
+}
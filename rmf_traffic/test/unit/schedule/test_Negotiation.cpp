@@ -17,10 +17,41 @@
 
 #include <rmf_traffic/schedule/Negotiation.hpp>
 #include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Participant.hpp>
 #include <rmf_traffic/geometry/Circle.hpp>
 
 #include <rmf_utils/catch.hpp>
 
+//==============================================================================
+/// Register participants with IDs from 0 to count-1, so that negotiations
+/// between them can be made. The participants need to be kept alive for as
+/// long as they are being negotiated for.
+std::vector<rmf_traffic::schedule::Participant> make_participants(
+  const std::shared_ptr<rmf_traffic::schedule::Database>& database,
+  const std::size_t count)
+{
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  std::vector<rmf_traffic::schedule::Participant> participants;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    participants.push_back(
+      rmf_traffic::schedule::make_participant(
+        rmf_traffic::schedule::ParticipantDescription{
+          "participant " + std::to_string(i),
+          "test_Negotiation",
+          rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+          profile
+        },
+        database));
+  }
+
+  return participants;
+}
+
 SCENARIO("Negotiation Unit Tests")
 {
   const auto database = std::make_shared<rmf_traffic::schedule::Database>();
@@ -89,3 +120,547 @@ SCENARIO("Negotiation Unit Tests")
   CHECK(table->defunct());
   CHECK(viewer->defunct());
 }
+
+//==============================================================================
+SCENARIO("Negotiation tables share base schedule queries")
+{
+  using namespace std::chrono_literals;
+
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+
+  rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  const auto make_participant = [&](const std::string& name)
+    {
+      return rmf_traffic::schedule::make_participant(
+        rmf_traffic::schedule::ParticipantDescription{
+          name,
+          "test_Negotiation",
+          rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+          profile
+        },
+        database);
+    };
+
+  auto p1 = make_participant("participant 1");
+  auto p2 = make_participant("participant 2");
+  auto outsider = make_participant("outsider");
+
+  const auto now = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(now, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  trajectory.insert(now + 10s, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  outsider.set(outsider.assign_plan_id(), {{"test_map", trajectory}});
+
+  const rmf_traffic::schedule::Query::Spacetime spacetime;
+
+  for (const std::size_t capacity : {0, 10})
+  {
+    auto negotiation = *rmf_traffic::schedule::Negotiation::make(
+      database, {p1.id(), p2.id()});
+    negotiation.set_base_query_cache_capacity(capacity);
+    CHECK(negotiation.get_base_query_cache_capacity() == capacity);
+
+    const auto first = negotiation.table(p1.id(), {})->viewer();
+    const auto view = first->query(spacetime, {});
+    REQUIRE(view.size() == 1);
+    CHECK(view.begin()->participant == outsider.id());
+
+    // The cache assumes that the schedule does not change during the
+    // negotiation, so a second table will still see the outsider's route when
+    // the cache is on.
+    outsider.clear();
+    const auto second = negotiation.table(p2.id(), {})->viewer();
+    CHECK(second->query(spacetime, {}).size() == (capacity > 0 ? 1 : 0));
+
+    outsider.set(outsider.assign_plan_id(), {{"test_map", trajectory}});
+  }
+}
+
+//==============================================================================
+SCENARIO("Negotiation tables build on the proposals of their parents")
+{
+  using namespace std::chrono_literals;
+
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  const auto participants = make_participants(database, 3);
+  auto maybe_negotiation = rmf_traffic::schedule::Negotiation::make(
+    database, {0, 1, 2});
+  REQUIRE(maybe_negotiation);
+  auto& negotiation = *maybe_negotiation;
+
+  const auto now = std::chrono::steady_clock::now();
+  const auto make_itinerary = [&](const rmf_traffic::Time start)
+    {
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(start, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      trajectory.insert(start + 10s, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      return std::vector<rmf_traffic::Route>{{"test_map", trajectory}};
+    };
+
+  const auto root = negotiation.table(0, {});
+  REQUIRE(root->submit(0, make_itinerary(now), 1));
+
+  const auto middle = negotiation.table(1, {0});
+  REQUIRE(middle);
+  REQUIRE(middle->submit(0, make_itinerary(now + 20s), 1));
+
+  const auto leaf = negotiation.table(2, {0, 1});
+  REQUIRE(leaf);
+  const auto leaf_viewer = leaf->viewer();
+
+  REQUIRE(leaf_viewer->base_proposals().size() == 2);
+  CHECK(leaf_viewer->base_proposals()[0].participant == 0);
+  CHECK(leaf_viewer->base_proposals()[1].participant == 1);
+  CHECK(*leaf_viewer->earliest_base_proposal_time() == now);
+  CHECK(*leaf_viewer->latest_base_proposal_time() == now + 30s);
+  CHECK(leaf->proposal().size() == 2);
+
+  REQUIRE(middle->proposal().size() == 2);
+  CHECK(middle->proposal().back().participant == 1);
+  REQUIRE(middle->submission());
+  CHECK(*middle->submission()->front().trajectory().start_time() == now + 20s);
+
+  WHEN("The root table submits a new itinerary")
+  {
+    REQUIRE(root->submit(1, make_itinerary(now + 5s), 2));
+
+    const auto new_middle = negotiation.table(1, {0});
+    REQUIRE(new_middle);
+    CHECK_FALSE(new_middle->submission());
+    REQUIRE(new_middle->proposal().size() == 1);
+    CHECK(new_middle->proposal().front().plan == 1);
+    CHECK(*new_middle->viewer()->earliest_base_proposal_time() == now + 5s);
+
+    // Viewers of the old tables still see the proposals they were made with
+    CHECK(leaf_viewer->defunct());
+    CHECK(leaf_viewer->base_proposals().size() == 2);
+    CHECK(*leaf_viewer->earliest_base_proposal_time() == now);
+  }
+
+  WHEN("The middle table is rejected")
+  {
+    REQUIRE(middle->reject(2, 2, {}));
+    CHECK_FALSE(middle->submission());
+    REQUIRE(middle->proposal().size() == 1);
+    CHECK(middle->proposal().front().participant == 0);
+  }
+}
+
+//==============================================================================
+SCENARIO("Defunct negotiation branches are released")
+{
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  const auto participants = make_participants(database, 3);
+  auto maybe_negotiation = rmf_traffic::schedule::Negotiation::make(
+    database, {0, 1, 2});
+  REQUIRE(maybe_negotiation);
+  auto& negotiation = *maybe_negotiation;
+
+  const auto root = negotiation.table(0, {});
+  REQUIRE(root->submit(0, {}, 1));
+
+  const auto middle = negotiation.table(1, {0});
+  REQUIRE(middle);
+  REQUIRE(middle->submit(0, {}, 1));
+
+  std::weak_ptr<rmf_traffic::schedule::Negotiation::Table> leaf =
+    negotiation.table(2, {0, 1});
+  REQUIRE_FALSE(leaf.expired());
+
+  const auto old_viewer = middle->viewer();
+  CHECK(middle->viewer() == old_viewer);
+
+  WHEN("The root submits again")
+  {
+    REQUIRE(root->submit(1, {}, 2));
+
+    // We are still holding onto the middle table, but the branch beneath it
+    // has been released because it can no longer be chosen.
+    CHECK(middle->defunct());
+    CHECK(leaf.expired());
+
+    const auto new_middle = negotiation.table(1, {0});
+    REQUIRE(new_middle);
+    CHECK(new_middle != middle);
+    CHECK_FALSE(new_middle->defunct());
+  }
+
+  WHEN("The middle table is forfeited")
+  {
+    middle->forfeit(2);
+    CHECK(leaf.expired());
+
+    // The viewer that was cached before the forfeit is out of date
+    const auto new_viewer = middle->viewer();
+    CHECK(new_viewer != old_viewer);
+    CHECK(new_viewer->forfeited());
+    CHECK_FALSE(old_viewer->forfeited());
+  }
+}
+
+//==============================================================================
+SCENARIO("Negotiation statistics")
+{
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  const auto participants = make_participants(database, 3);
+  auto maybe_negotiation = rmf_traffic::schedule::Negotiation::make(
+    database, {0, 1, 2});
+  REQUIRE(maybe_negotiation);
+  auto& negotiation = *maybe_negotiation;
+
+  // The three root tables are created right away
+  CHECK(negotiation.statistics().tables_created == 3);
+  REQUIRE(negotiation.statistics().tables_per_depth.size() == 1);
+  CHECK(negotiation.statistics().tables_per_depth[0] == 3);
+
+  const auto root = negotiation.table(0, {});
+  REQUIRE(root->submit(0, {}, 1));
+  CHECK(negotiation.statistics().tables_created == 5);
+
+  const auto middle = negotiation.table(1, {0});
+  REQUIRE(middle->submit(0, {}, 1));
+
+  const auto& stats = negotiation.statistics();
+  CHECK(stats.tables_created == 6);
+  REQUIRE(stats.tables_per_depth.size() == 3);
+  CHECK(stats.tables_per_depth[1] == 2);
+  CHECK(stats.tables_per_depth[2] == 1);
+
+  middle->reject(2, 2, {});
+  CHECK(stats.rejections == 1);
+  CHECK(stats.defunct_tables == 1);
+
+  negotiation.table(2, {0})->forfeit(1);
+  CHECK(stats.forfeits == 1);
+}
+
+//==============================================================================
+SCENARIO("Rebasing a negotiation onto a changed schedule")
+{
+  using namespace std::chrono_literals;
+
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+
+  rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  const auto make_participant = [&](const std::string& name)
+    {
+      return rmf_traffic::schedule::make_participant(
+        rmf_traffic::schedule::ParticipantDescription{
+          name,
+          "test_Negotiation",
+          rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+          profile
+        },
+        database);
+    };
+
+  auto p1 = make_participant("participant 1");
+  auto p2 = make_participant("participant 2");
+  auto outsider = make_participant("outsider");
+
+  const auto now = std::chrono::steady_clock::now();
+  const auto stay_at = [&](const double x)
+    {
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(now, {x, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      trajectory.insert(now + 10s, {x, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      return std::vector<rmf_traffic::Route>{{"test_map", trajectory}};
+    };
+
+  // Conflicts are only found between itineraries that come closer together,
+  // so this drives into the spot at x instead of starting there.
+  const auto drive_to = [&](const double x)
+    {
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(now, {x, 10.0, 0.0}, {0.0, 0.0, 0.0});
+      trajectory.insert(now + 10s, {x, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      return std::vector<rmf_traffic::Route>{{"test_map", trajectory}};
+    };
+
+  auto negotiation = *rmf_traffic::schedule::Negotiation::make(
+    database, {p1.id(), p2.id()});
+  negotiation.set_base_query_cache_capacity(10);
+
+  REQUIRE(negotiation.table(p1.id(), {})->submit(0, stay_at(0.0), 1));
+  const auto changed_table = negotiation.table(p2.id(), {p1.id()});
+  REQUIRE(changed_table->submit(0, stay_at(10.0), 1));
+
+  REQUIRE(negotiation.table(p2.id(), {})->submit(0, stay_at(20.0), 1));
+  const auto kept_table = negotiation.table(p1.id(), {p2.id()});
+  REQUIRE(kept_table->submit(0, stay_at(30.0), 1));
+
+  CHECK(negotiation.ready());
+  CHECK(negotiation.complete());
+
+  // Fill the base query cache while the outsider has no itinerary. The viewer
+  // of the kept table only sees the proposal of its parent.
+  const rmf_traffic::schedule::Query::Spacetime spacetime;
+  CHECK(kept_table->viewer()->query(spacetime, {}).size() == 1);
+
+  WHEN("An outsider moves into the way of one submission")
+  {
+    outsider.set(outsider.assign_plan_id(), drive_to(10.0));
+
+    const auto invalidated = negotiation.rebase(nullptr, {outsider.id()});
+    REQUIRE(invalidated.size() == 1);
+    CHECK(invalidated.front() == changed_table);
+    CHECK(changed_table->submission() == nullptr);
+    CHECK(changed_table->version() == 2);
+    CHECK_FALSE(changed_table->defunct());
+
+    // The other branch of the negotiation was kept
+    CHECK(kept_table->submission() != nullptr);
+    CHECK(negotiation.ready());
+    CHECK_FALSE(negotiation.complete());
+    CHECK(negotiation.statistics().invalidated_tables == 1);
+
+    // The base query cache no longer hides the change
+    CHECK(kept_table->viewer()->query(spacetime, {}).size() == 2);
+
+    // A response that was made before the rebase is turned away
+    CHECK_FALSE(changed_table->submit(0, stay_at(40.0), 2));
+    CHECK(changed_table->submit(0, stay_at(40.0), 3));
+    CHECK(negotiation.complete());
+  }
+
+  WHEN("An outsider changes without getting in the way")
+  {
+    outsider.set(outsider.assign_plan_id(), stay_at(50.0));
+
+    CHECK(negotiation.rebase(database, {outsider.id()}).empty());
+    CHECK(changed_table->submission() != nullptr);
+    CHECK(negotiation.complete());
+  }
+
+  WHEN("Only negotiation participants are said to have changed")
+  {
+    CHECK(negotiation.rebase(nullptr, {p1.id(), p2.id()}).empty());
+    CHECK(negotiation.statistics().invalidated_tables == 0);
+  }
+}
+
+//==============================================================================
+SCENARIO("Stubborn negotiation participants")
+{
+  using namespace std::chrono_literals;
+
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+
+  rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  const auto make_participant = [&](const std::string& name)
+    {
+      return rmf_traffic::schedule::make_participant(
+        rmf_traffic::schedule::ParticipantDescription{
+          name,
+          "test_Negotiation",
+          rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+          profile
+        },
+        database);
+    };
+
+  auto p1 = make_participant("participant 1");
+  auto p2 = make_participant("participant 2");
+
+  const auto now = std::chrono::steady_clock::now();
+  const auto stay_at = [&](const double x)
+    {
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(now, {x, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      trajectory.insert(now + 10s, {x, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      return std::vector<rmf_traffic::Route>{{"test_map", trajectory}};
+    };
+
+  // Conflicts are only found between itineraries that come closer together,
+  // so this drives into the spot at x instead of starting there.
+  const auto drive_to = [&](const double x)
+    {
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(now, {x, 10.0, 0.0}, {0.0, 0.0, 0.0});
+      trajectory.insert(now + 10s, {x, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      return std::vector<rmf_traffic::Route>{{"test_map", trajectory}};
+    };
+
+  auto negotiation = *rmf_traffic::schedule::Negotiation::make(
+    database, {p1.id(), p2.id()});
+
+  CHECK_THROWS(negotiation.set_stubborn(p2.id() + 10, 0, stay_at(0.0)));
+
+  negotiation.set_stubborn(p1.id(), 5, stay_at(0.0));
+  CHECK(negotiation.is_stubborn(p1.id()));
+  CHECK_FALSE(negotiation.is_stubborn(p2.id()));
+
+  // The root table of the stubborn participant was resolved right away
+  const auto stubborn_root = negotiation.table(p1.id(), {});
+  REQUIRE(stubborn_root->submission());
+  CHECK(stubborn_root->proposal().front().plan == 5);
+  CHECK(negotiation.statistics().stubborn_submissions == 1);
+
+  const auto p2_root = negotiation.table(p2.id(), {});
+
+  WHEN("The other participant proposes something that fits")
+  {
+    REQUIRE(p2_root->submit(0, stay_at(10.0), 1));
+    const auto accommodating = negotiation.table(p1.id(), {p2.id()});
+    REQUIRE(accommodating);
+    CHECK(accommodating->submission());
+    CHECK(negotiation.statistics().stubborn_submissions == 2);
+    CHECK(negotiation.ready());
+
+    REQUIRE(negotiation.table(p2.id(), {p1.id()})->submit(
+        0, stay_at(20.0), 1));
+    CHECK(negotiation.complete());
+  }
+
+  WHEN("The other participant proposes something that is in the way")
+  {
+    REQUIRE(p2_root->submit(0, drive_to(0.0), 1));
+    CHECK(p2_root->rejected());
+    CHECK_FALSE(negotiation.ready());
+
+    // The stubborn participant offers its itinerary as the only rollout
+    const auto& alternatives = p2_root->viewer()->alternatives();
+    REQUIRE(alternatives.count(p1.id()) == 1);
+    REQUIRE(alternatives.at(p1.id())->size() == 1);
+    const auto view = p2_root->viewer()->query(
+      rmf_traffic::schedule::Query::Spacetime(), {{p1.id(), 0}});
+    CHECK(view.size() == 1);
+
+    REQUIRE(p2_root->submit(0, stay_at(10.0), 2));
+    CHECK_FALSE(p2_root->rejected());
+    CHECK(negotiation.ready());
+  }
+
+  WHEN("Both participants are stubborn and in each other's way")
+  {
+    negotiation.set_stubborn(p2.id(), 0, drive_to(0.0));
+    CHECK(stubborn_root->forfeited());
+    CHECK(p2_root->forfeited());
+    CHECK_FALSE(negotiation.ready());
+    CHECK(negotiation.complete());
+  }
+}
+
+//==============================================================================
+SCENARIO("Finding negotiation tables by sequence")
+{
+  using SearchStatus = rmf_traffic::schedule::Negotiation::SearchStatus;
+
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  const auto participants = make_participants(database, 3);
+  auto maybe_negotiation = rmf_traffic::schedule::Negotiation::make(
+    database, {0, 1, 2});
+  REQUIRE(maybe_negotiation);
+  auto& negotiation = *maybe_negotiation;
+
+  const auto root = negotiation.table(0, {});
+  REQUIRE(root->submit(0, {}, 1));
+
+  const auto middle = negotiation.table(1, {0});
+  REQUIRE(middle);
+  REQUIRE(middle->submit(0, {}, 1));
+
+  const auto leaf = negotiation.table(2, {0, 1});
+  REQUIRE(leaf);
+  CHECK(negotiation.table({0, 1, 2}) == leaf);
+  CHECK_FALSE(negotiation.table({0, 2, 1}));
+
+  auto sequence = leaf->sequence();
+  auto result = negotiation.find(sequence);
+  CHECK(result.status == SearchStatus::Found);
+  CHECK(result.table == leaf);
+
+  // A version that has not been submitted yet cannot be found
+  sequence[1].version = 2;
+  CHECK(negotiation.find(sequence).status == SearchStatus::Absent);
+
+  WHEN("The middle table submits again")
+  {
+    REQUIRE(middle->submit(1, {}, 2));
+
+    const auto new_leaf = negotiation.table({0, 1, 2});
+    REQUIRE(new_leaf);
+    CHECK(new_leaf != leaf);
+
+    result = negotiation.find(sequence);
+    CHECK(result.status == SearchStatus::Found);
+    CHECK(result.table == new_leaf);
+
+    // The old version of the branch is out of date
+    CHECK(negotiation.find(leaf->sequence()).status
+      == SearchStatus::Deprecated);
+  }
+
+  WHEN("The middle table is rejected")
+  {
+    middle->reject(2, 2, {});
+    CHECK_FALSE(negotiation.table({0, 1, 2}));
+    CHECK(negotiation.find(leaf->sequence()).status
+      == SearchStatus::Deprecated);
+  }
+}
+
+//==============================================================================
+SCENARIO("Evaluating a negotiation")
+{
+  using namespace std::chrono_literals;
+
+  const auto database = std::make_shared<rmf_traffic::schedule::Database>();
+  const auto participants = make_participants(database, 2);
+  auto maybe_negotiation = rmf_traffic::schedule::Negotiation::make(
+    database, {0, 1});
+  REQUIRE(maybe_negotiation);
+  auto& negotiation = *maybe_negotiation;
+
+  const auto now = std::chrono::steady_clock::now();
+  const auto make_itinerary = [&](const rmf_traffic::Duration duration)
+    {
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(now, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      trajectory.insert(now + duration, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+      return std::vector<rmf_traffic::Route>{{"test_map", trajectory}};
+    };
+
+  const rmf_traffic::schedule::QuickestFinishEvaluator evaluator;
+  CHECK_FALSE(negotiation.evaluate(evaluator));
+
+  REQUIRE(negotiation.table(0, {})->submit(0, make_itinerary(10s), 1));
+  REQUIRE(negotiation.table(1, {0})->submit(0, make_itinerary(20s), 1));
+  REQUIRE(negotiation.table(1, {})->submit(0, make_itinerary(10s), 1));
+  REQUIRE(negotiation.table(0, {1})->submit(0, make_itinerary(30s), 1));
+  REQUIRE(negotiation.ready());
+
+  const auto expected = negotiation.table({0, 1});
+  REQUIRE(expected);
+
+  // The summarized and unsummarized paths of the evaluator agree
+  const auto unsummarized = evaluator.choose(
+    {&negotiation.table({0, 1})->proposal(),
+      &negotiation.table({1, 0})->proposal()});
+  CHECK(unsummarized == 0);
+
+  CHECK(negotiation.evaluation_threads() == 1);
+  CHECK(negotiation.evaluate(evaluator) == expected);
+
+  // Evaluating again gives the same answer from the cached summaries
+  CHECK(negotiation.evaluate(evaluator) == expected);
+
+  negotiation.evaluation_threads(2);
+  CHECK(negotiation.evaluation_threads() == 2);
+  CHECK(negotiation.evaluate(evaluator) == expected);
+
+  negotiation.evaluation_threads(0);
+  CHECK(negotiation.evaluation_threads() == 1);
+}
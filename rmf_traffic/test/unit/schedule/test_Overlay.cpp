@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Overlay.hpp>
+
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <set>
+#include <tuple>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+//==============================================================================
+using RouteKey = std::tuple<
+  rmf_traffic::schedule::ParticipantId,
+  rmf_traffic::PlanId,
+  double>;
+
+//==============================================================================
+std::set<RouteKey> routes_of(
+  const rmf_traffic::schedule::Viewer& viewer,
+  const rmf_traffic::schedule::Query& query =
+  rmf_traffic::schedule::query_all())
+{
+  std::set<RouteKey> output;
+  for (const auto& element : viewer.query(query))
+  {
+    output.insert(
+      {
+        element.participant,
+        element.plan_id,
+        element.route->trajectory().front().position().y()
+      });
+  }
+
+  return output;
+}
+
+//==============================================================================
+rmf_traffic::Route make_route(
+  const std::string& map,
+  const rmf_traffic::Time start,
+  const double y)
+{
+  rmf_traffic::Trajectory t;
+  t.insert(start, Eigen::Vector3d{0, y, 0}, Eigen::Vector3d::Zero());
+  t.insert(start + 10s, Eigen::Vector3d{10, y, 0}, Eigen::Vector3d::Zero());
+  return rmf_traffic::Route(map, std::move(t));
+}
+
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Overlay hypothetical changes on a schedule")
+{
+  using namespace rmf_traffic::schedule;
+
+  Database database;
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  std::vector<ParticipantId> ids;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    ids.push_back(
+      database.register_participant(
+        ParticipantDescription{
+          "participant_" + std::to_string(i),
+          "test_Overlay",
+          ParticipantDescription::Rx::Responsive,
+          profile
+        }).id());
+  }
+
+  const auto p0 = ids[0];
+  const auto p1 = ids[1];
+  const auto p2 = ids[2];
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  database.set(p0, 1, {make_route("A", time, 0.0)}, 0, 0);
+  database.set(p1, 1, {make_route("A", time, 1.0)}, 0, 0);
+  database.set(p2, 1, {make_route("B", time, 2.0)}, 0, 0);
+
+  Overlay overlay(database.snapshot());
+  CHECK(routes_of(overlay) == routes_of(database));
+  CHECK(overlay.participant_ids() == database.participant_ids());
+
+  overlay.set(
+    p0, 5, {make_route("A", time, 10.0), make_route("B", time, 11.0)});
+  overlay.erase(p1);
+
+  const std::set<RouteKey> expected = {
+    {p0, 5, 10.0},
+    {p0, 5, 11.0},
+    {p2, 1, 2.0}
+  };
+  CHECK(routes_of(overlay) == expected);
+
+  // The base schedule is not changed by the overlay
+  CHECK(routes_of(*overlay.base()).size() == 3);
+
+  // Queries of the overlay apply to its changes the same way as to the base
+  const auto on_b = make_query({"B"}, nullptr, nullptr);
+  CHECK(routes_of(overlay, on_b) == std::set<RouteKey>({
+      {p0, 5, 11.0},
+      {p2, 1, 2.0}
+    }));
+
+  const auto late = time + 20s;
+  CHECK(routes_of(overlay, make_query({"A", "B"}, &late, nullptr)).empty());
+
+  auto include_p0 = query_all();
+  include_p0.participants() = Query::Participants::make_only({p0});
+  CHECK(routes_of(overlay, include_p0) == std::set<RouteKey>({
+      {p0, 5, 10.0},
+      {p0, 5, 11.0}
+    }));
+
+  WHEN("An overlay is copied and then modified")
+  {
+    const auto view = overlay.query(query_all());
+
+    Overlay alternative = overlay;
+    alternative.reset(p1);
+    alternative.set(p2, 7, {make_route("B", time, 20.0)});
+
+    CHECK(routes_of(overlay) == expected);
+    CHECK(routes_of(alternative) == std::set<RouteKey>({
+        {p0, 5, 10.0},
+        {p0, 5, 11.0},
+        {p1, 1, 1.0},
+        {p2, 7, 20.0}
+      }));
+
+    // Views that were made before the change are not affected
+    CHECK(view.size() == 3);
+
+    alternative.reset();
+    CHECK(alternative.changed_participants().empty());
+    CHECK(routes_of(alternative) == routes_of(database));
+    CHECK(overlay.changed_participants()
+      == std::vector<ParticipantId>({p0, p1}));
+  }
+
+  WHEN("An overlay is used as the base of another overlay")
+  {
+    Overlay nested(std::make_shared<Overlay>(overlay));
+    nested.set(p1, 9, {make_route("A", time, 30.0)});
+    CHECK(routes_of(nested) == std::set<RouteKey>({
+        {p0, 5, 10.0},
+        {p0, 5, 11.0},
+        {p1, 9, 30.0},
+        {p2, 1, 2.0}
+      }));
+  }
+
+  WHEN("An unknown participant is changed")
+  {
+    CHECK_THROWS_AS(
+      overlay.set(p2 + 100, 1, {make_route("A", time, 0.0)}),
+      std::runtime_error);
+  }
+}
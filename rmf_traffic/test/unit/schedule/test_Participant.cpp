@@ -876,3 +876,335 @@ SCENARIO("Test Participant")
     CHECK(db->inconsistencies().size() == 1);
   }
 }
+
+//==============================================================================
+SCENARIO("Setting an itinerary shares its trajectories with the schedule")
+{
+  using namespace std::chrono_literals;
+  using Route = rmf_traffic::Route;
+
+  const auto db = std::make_shared<rmf_traffic::schedule::Database>();
+  auto participant = rmf_traffic::schedule::make_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "participant",
+      "test_Participant",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+      rmf_traffic::Profile{
+        rmf_traffic::geometry::make_final_convex<
+          rmf_traffic::geometry::Circle>(1.0)
+      }
+    },
+    db);
+
+  const auto time = std::chrono::steady_clock::now();
+  std::vector<Route> itinerary;
+  itinerary.emplace_back("test_map", rmf_traffic::Trajectory());
+
+  // Building the trajectory through the route hands out a mutable reference
+  // to it
+  auto& trajectory = itinerary.front().trajectory();
+  trajectory.insert(time, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  trajectory.insert(time + 10s, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  const rmf_traffic::Trajectory* const original = &trajectory;
+
+  const auto plan = participant.plan_id_assigner()->assign();
+  REQUIRE(participant.set(plan, std::move(itinerary)));
+
+  const auto& stored = participant.itinerary();
+  REQUIRE(stored.size() == 1);
+  CHECK(&stored.front().trajectory() == original);
+
+  const auto scheduled = db->get_itinerary(participant.id());
+  REQUIRE(scheduled.has_value());
+  REQUIRE(scheduled->size() == 1);
+  CHECK(&scheduled->front()->trajectory() == original);
+
+  WHEN("The participant is delayed")
+  {
+    REQUIRE(participant.cumulative_delay(plan, 5s));
+
+    // Neither copy of the route needs to rewrite the shared trajectory
+    CHECK(*original->start_time() == time);
+    CHECK(*stored.front().trajectory().start_time() == time + 5s);
+
+    const auto delayed = db->get_itinerary(participant.id());
+    REQUIRE(delayed.has_value());
+    CHECK(*delayed->front()->trajectory().start_time() == time + 5s);
+  }
+}
+
+//==============================================================================
+SCENARIO("Coalescing the delays of a participant")
+{
+  using namespace std::chrono_literals;
+  using Route = rmf_traffic::Route;
+
+  const auto db = std::make_shared<rmf_traffic::schedule::Database>();
+  auto participant = rmf_traffic::schedule::make_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "participant",
+      "test_Participant",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+      rmf_traffic::Profile{
+        rmf_traffic::geometry::make_final_convex<
+          rmf_traffic::geometry::Circle>(1.0)
+      }
+    },
+    db);
+
+  const auto time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(time, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  trajectory.insert(time + 10s, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  trajectory.insert(time + 20s, {20.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+
+  const auto plan = participant.assign_plan_id();
+  REQUIRE(participant.set(plan, {Route{"test_map", trajectory}}));
+  CHECK_FALSE(participant.delay_coalescing().has_value());
+
+  const auto scheduled_start = [&]()
+    {
+      const auto itinerary = db->get_itinerary(participant.id());
+      REQUIRE(itinerary.has_value());
+      REQUIRE(itinerary->size() == 1);
+      return *itinerary->front()->trajectory().start_time();
+    };
+
+  const auto local_start = [&]()
+    {
+      return *participant.itinerary().front().trajectory().start_time();
+    };
+
+  WHEN("Delays are held back by their magnitude")
+  {
+    participant.delay_coalescing(
+      rmf_traffic::schedule::Participant::DelayCoalescing{0s, 2s});
+
+    const auto version = participant.version();
+    REQUIRE(participant.cumulative_delay(plan, 500ms));
+    REQUIRE(participant.cumulative_delay(plan, 1s));
+
+    // The participant knows about the delay, but the schedule does not
+    CHECK(local_start() == time + 1s);
+    CHECK(scheduled_start() == time);
+    CHECK(participant.version() == version);
+
+    REQUIRE(participant.cumulative_delay(plan, 2500ms));
+
+    // The delays were sent together as one change
+    CHECK(local_start() == time + 2500ms);
+    CHECK(scheduled_start() == time + 2500ms);
+    CHECK(participant.version() == version + 1);
+  }
+
+  WHEN("Delays are held back by their interval")
+  {
+    participant.delay_coalescing(
+      rmf_traffic::schedule::Participant::DelayCoalescing{1h, 0s});
+
+    const auto version = participant.version();
+    REQUIRE(participant.cumulative_delay(plan, 1s));
+
+    // The first delay is sent right away
+    CHECK(scheduled_start() == time + 1s);
+    CHECK(participant.version() == version + 1);
+
+    REQUIRE(participant.cumulative_delay(plan, 2s));
+    REQUIRE(participant.cumulative_delay(plan, 3s));
+    CHECK(local_start() == time + 3s);
+    CHECK(scheduled_start() == time + 1s);
+    CHECK(participant.version() == version + 1);
+
+    THEN("Reaching a checkpoint sends the held delays")
+    {
+      participant.reached(plan, 0, 1);
+      CHECK(scheduled_start() == time + 3s);
+      CHECK(participant.version() == version + 2);
+    }
+
+    THEN("Flushing sends the held delays")
+    {
+      participant.flush_delay();
+      CHECK(scheduled_start() == time + 3s);
+      CHECK(participant.version() == version + 2);
+
+      // Flushing again has no effect
+      participant.flush_delay();
+      CHECK(participant.version() == version + 2);
+    }
+
+    THEN("Removing the policy sends the held delays")
+    {
+      participant.delay_coalescing(std::nullopt);
+      CHECK(scheduled_start() == time + 3s);
+      CHECK(participant.version() == version + 2);
+    }
+
+    THEN("Setting a new itinerary drops the held delays")
+    {
+      const auto new_plan = participant.assign_plan_id();
+      REQUIRE(participant.set(new_plan, {Route{"test_map", trajectory}}));
+      CHECK(scheduled_start() == time);
+      CHECK(participant.version() == version + 2);
+
+      participant.flush_delay();
+      CHECK(participant.version() == version + 2);
+    }
+
+    THEN("Delays that cancel out are never sent")
+    {
+      REQUIRE(participant.cumulative_delay(plan, 1s));
+      CHECK(local_start() == time + 1s);
+      participant.flush_delay();
+      CHECK(participant.version() == version + 1);
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Retransmitting the net state of a participant")
+{
+  using namespace std::chrono_literals;
+  using Route = rmf_traffic::Route;
+  using Retransmission = rmf_traffic::schedule::Participant::Retransmission;
+
+  const auto db = std::make_shared<rmf_traffic::schedule::Database>();
+  const auto writer = std::make_shared<FaultyWriter>(db);
+  const auto rectifier = std::make_shared<
+    rmf_traffic::schedule::DatabaseRectificationRequesterFactory>(db);
+
+  auto participant = rmf_traffic::schedule::make_participant(
+    rmf_traffic::schedule::ParticipantDescription{
+      "participant",
+      "test_Participant",
+      rmf_traffic::schedule::ParticipantDescription::Rx::Responsive,
+      rmf_traffic::Profile{
+        rmf_traffic::geometry::make_final_convex<
+          rmf_traffic::geometry::Circle>(1.0)
+      }
+    },
+    writer,
+    rectifier);
+
+  CHECK(participant.retransmission() == Retransmission::Replay);
+
+  const auto time = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(time, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+  trajectory.insert(time + 10s, {10.0, 0.0, 0.0}, {0.0, 0.0, 0.0});
+
+  const auto plan = participant.assign_plan_id();
+  REQUIRE(participant.set(plan, {Route{"test_map", trajectory}}));
+  participant.reached(plan, 0, 1);
+
+  // Drop several delays, then let one through so the database notices
+  writer->drop_packets = true;
+  for (int i = 1; i <= 4; ++i)
+    participant.cumulative_delay(plan, i*1s);
+
+  writer->drop_packets = false;
+  participant.cumulative_delay(plan, 5s);
+  REQUIRE(db->inconsistencies().size() == 1);
+  CHECK(db->inconsistencies().begin()->ranges.size() == 1);
+
+  const auto version = participant.version();
+
+  WHEN("The missing changes are replayed")
+  {
+    rectifier->rectify();
+    CHECK(participant.version() == version);
+    CHECK(db->inconsistencies().begin()->ranges.size() == 0);
+    CHECK_ITINERARY(participant, *db);
+  }
+
+  WHEN("The net state is sent instead")
+  {
+    participant.retransmission(Retransmission::NetState);
+    CHECK(participant.retransmission() == Retransmission::NetState);
+
+    rectifier->rectify();
+    CHECK(participant.version() == version + 1);
+    CHECK(db->inconsistencies().begin()->ranges.size() == 0);
+    CHECK_ITINERARY(participant, *db);
+
+    const auto* progress = db->get_current_progress(participant.id());
+    REQUIRE(progress);
+    REQUIRE(progress->size() == 1);
+    CHECK(progress->front() == 1);
+
+    const auto itinerary = db->get_itinerary(participant.id());
+    REQUIRE(itinerary.has_value());
+    REQUIRE(itinerary->size() == 1);
+    CHECK(*itinerary->front()->trajectory().start_time() == time + 5s);
+
+    // Nothing is missing anymore, so rectifying again sends nothing
+    rectifier->rectify();
+    CHECK(participant.version() == version + 1);
+  }
+}
+
+//==============================================================================
+SCENARIO("Resubmitting an identical itinerary is a no-op")
+{
+  using namespace std::chrono_literals;
+  using namespace rmf_traffic::schedule;
+
+  const auto db = std::make_shared<Database>();
+  auto participant = make_participant(
+    ParticipantDescription{
+      "participant",
+      "test_Participant",
+      ParticipantDescription::Rx::Responsive,
+      rmf_traffic::Profile{
+        rmf_traffic::geometry::make_final_convex<
+          rmf_traffic::geometry::Circle>(1.0)
+      }
+    },
+    db);
+
+  const auto time = std::chrono::steady_clock::now();
+  const auto make_itinerary = [&](const double y) -> Itinerary
+    {
+      rmf_traffic::Trajectory t;
+      t.insert(time, {0.0, y, 0.0}, {0.0, 0.0, 0.0});
+      t.insert(time + 10s, {10.0, y, 0.0}, {0.0, 0.0, 0.0});
+      return {rmf_traffic::Route("test_map", std::move(t))};
+    };
+
+  CHECK(hash_itinerary(make_itinerary(0.0)) ==
+    hash_itinerary(make_itinerary(0.0)));
+  CHECK(hash_itinerary(make_itinerary(0.0)) !=
+    hash_itinerary(make_itinerary(1.0)));
+
+  const auto plan = participant.plan_id_assigner()->assign();
+  REQUIRE(participant.set(plan, make_itinerary(0.0)));
+  CHECK(participant.itinerary_hash() == hash_itinerary(make_itinerary(0.0)));
+
+  const auto db_version = db->latest_version();
+  const auto itinerary_version = participant.version();
+
+  // The participant does not send the same plan again
+  CHECK(participant.set(plan, make_itinerary(0.0)));
+  CHECK(participant.version() == itinerary_version);
+  CHECK(db->latest_version() == db_version);
+
+  // A change to the same plan is still refused
+  CHECK_FALSE(participant.set(plan, make_itinerary(1.0)));
+
+  // The database does not change when it hears the same plan again, for
+  // example from a retransmission
+  db->set(
+    participant.id(), plan, make_itinerary(0.0), 100, itinerary_version + 1);
+  CHECK(db->latest_version() == db_version);
+  CHECK(db->changes(query_all(), db_version).size() == 0);
+
+  // An itinerary that is really different still changes the schedule
+  db->set(
+    participant.id(), plan, make_itinerary(1.0), 101, itinerary_version + 2);
+  CHECK(db->latest_version() > db_version);
+
+  // Delays change the cached hash
+  const auto original_hash = participant.itinerary_hash();
+  REQUIRE(participant.cumulative_delay(plan, 5s));
+  CHECK(participant.itinerary_hash() != original_hash);
+}
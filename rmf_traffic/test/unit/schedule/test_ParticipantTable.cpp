@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "src/rmf_traffic/schedule/internal_ParticipantTable.hpp"
+
+#include <rmf_utils/catch.hpp>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+//==============================================================================
+SCENARIO("Participant table")
+{
+  using rmf_traffic::schedule::ParticipantTable;
+
+  ParticipantTable<std::string> table;
+  CHECK(table.empty());
+  CHECK(table.find(0) == table.end());
+
+  CHECK(table.insert({3, "three"}).second);
+  CHECK_FALSE(table.insert({3, "other"}).second);
+  table[1] = "one";
+  CHECK(table.try_emplace(5, "five").second);
+  CHECK(table.size() == 3);
+
+  // References stay valid while other participants come and go
+  const std::string& three = table.at(3);
+  table[100] = "hundred";
+  table.erase(100);
+  CHECK(&three == &table.at(3));
+
+  CHECK(table.count(0) == 0);
+  CHECK(table.count(1) == 1);
+  CHECK(table.find(2) == table.end());
+  CHECK(table.find(1000) == table.end());
+  CHECK_THROWS_AS(table.at(2), std::out_of_range);
+
+  std::vector<uint64_t> ids;
+  for (const auto& [id, value] : table)
+  {
+    ids.push_back(id);
+    CHECK(!value.empty());
+  }
+  CHECK(ids == std::vector<uint64_t>{1, 3, 5});
+
+  WHEN("A participant is erased")
+  {
+    const auto next = table.erase(table.find(3));
+    REQUIRE(next != table.end());
+    CHECK(next->first == 5);
+    CHECK(table.find(3) == table.end());
+    CHECK(table.erase(3) == 0);
+    CHECK(table.size() == 2);
+  }
+
+  WHEN("The table is copied")
+  {
+    const ParticipantTable<std::string> copy = table;
+    table.at(1) = "changed";
+    CHECK(copy.at(1) == "one");
+    CHECK(copy.size() == 3);
+  }
+
+  WHEN("Participants have IDs far beyond the others")
+  {
+    const auto max = std::numeric_limits<uint64_t>::max();
+    table[max] = "max";
+    table[1000000] = "million";
+    table[1000000000000] = "trillion";
+    const std::string& million = table.at(1000000);
+    CHECK(table.size() == 6);
+    CHECK(table.at(max) == "max");
+    CHECK(table.count(999999) == 0);
+
+    ids.clear();
+    for (const auto& [id, value] : table)
+      ids.push_back(id);
+    CHECK(ids == std::vector<uint64_t>{1, 3, 5, 1000000, 1000000000000, max});
+
+    const ParticipantTable<std::string> copy = table;
+    CHECK(copy.at(1000000000000) == "trillion");
+
+    THEN("Denser IDs can still reach them")
+    {
+      // Each new ID stays close enough to the last one to be kept densely,
+      // until the dense IDs have caught up with the first far ID
+      for (uint64_t id = 1000; id < 1000000; id += 1000)
+        table[id] = "filler";
+      table[1000500] = "filler";
+
+      CHECK(&million == &table.at(1000000));
+      CHECK(table.erase(1000000) == 1);
+      CHECK(table.find(1000000) == table.end());
+
+      const auto next = table.erase(table.find(1000000000000));
+      REQUIRE(next != table.end());
+      CHECK(next->first == max);
+      CHECK(table.size() == 1004);
+    }
+  }
+}
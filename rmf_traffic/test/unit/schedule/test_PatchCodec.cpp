@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Mirror.hpp>
+#include <rmf_traffic/schedule/PatchCodec.hpp>
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+namespace {
+//==============================================================================
+void CHECK_SAME_ROUTES(
+  const rmf_traffic::schedule::ItineraryView& a,
+  const rmf_traffic::schedule::ItineraryView& b,
+  const double tolerance)
+{
+  REQUIRE(a.size() == b.size());
+  for (const auto& route_a : a)
+  {
+    bool found = false;
+    for (const auto& route_b : b)
+    {
+      if (route_a->map() != route_b->map())
+        continue;
+
+      const auto& t_a = route_a->trajectory();
+      const auto& t_b = route_b->trajectory();
+      if (t_a.size() != t_b.size())
+        continue;
+
+      if (t_a.size() > 0 && *t_a.start_time() != *t_b.start_time())
+        continue;
+
+      found = true;
+      for (std::size_t i = 0; i < t_a.size(); ++i)
+      {
+        CHECK(t_a[i].time() == t_b[i].time());
+        CHECK((t_a[i].position() - t_b[i].position()).norm() <= tolerance);
+        CHECK((t_a[i].velocity() - t_b[i].velocity()).norm() <= tolerance);
+      }
+
+      CHECK(route_a->checkpoints() == route_b->checkpoints());
+      CHECK(route_a->dependencies().size() == route_b->dependencies().size());
+      for (const auto& [participant, plan] : route_a->dependencies())
+      {
+        const auto it = route_b->dependencies().find(participant);
+        REQUIRE(it != route_b->dependencies().end());
+        CHECK(it->second.plan() == plan.plan());
+        CHECK(it->second.routes() == plan.routes());
+      }
+      break;
+    }
+
+    CHECK(found);
+  }
+}
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Encoding patches")
+{
+  using namespace std::chrono_literals;
+  using namespace rmf_traffic::schedule;
+
+  Database db;
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(1.0)
+  };
+
+  std::vector<ParticipantId> participants;
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    participants.push_back(
+      db.register_participant(
+        ParticipantDescription{
+          "participant_" + std::to_string(i),
+          "test_PatchCodec",
+          ParticipantDescription::Rx::Responsive,
+          profile
+        }).id());
+  }
+
+  const auto time = std::chrono::steady_clock::now();
+  const auto make_route = [&](const std::string& map, const double offset)
+    {
+      rmf_traffic::Trajectory trajectory;
+      trajectory.insert(time, {offset, 0.123456, 0.5}, {0.25, 0, 0});
+      trajectory.insert(time + 10s, {offset + 10, 5.5, -1.0}, {0, 0.1, 0});
+      trajectory.insert(time + 15s, {offset + 12, 6.0, 3.0}, {0, 0, 0.2});
+      return rmf_traffic::Route(map, std::move(trajectory));
+    };
+
+  auto dependent = make_route("map_B", 3.0);
+  dependent.checkpoints({0, 2});
+  dependent.dependencies(
+    {
+      {participants[0], rmf_traffic::DependsOnPlan(0, {{0, {{2, 1}}}})}
+    });
+
+  db.set(participants[0], 0, {make_route("map_A", 0.0)}, 0, 0);
+  db.set(
+    participants[1], 0, {dependent, make_route("map_A", 7.0)}, 0, 0);
+
+  const auto query_all = rmf_traffic::schedule::query_all();
+  const auto full = db.changes(query_all, std::nullopt);
+
+  const auto compare_mirrors = [&](
+    const Mirror& a, const Mirror& b, const double tolerance)
+    {
+      CHECK(a.latest_version() == b.latest_version());
+      for (const auto p : participants)
+      {
+        const auto itinerary_a = a.get_itinerary(p);
+        const auto itinerary_b = b.get_itinerary(p);
+        REQUIRE(itinerary_a.has_value());
+        REQUIRE(itinerary_b.has_value());
+        CHECK_SAME_ROUTES(*itinerary_a, *itinerary_b, tolerance);
+        CHECK(a.get_current_plan_id(p) == b.get_current_plan_id(p));
+      }
+    };
+
+  WHEN("Encoding with full precision")
+  {
+    const PatchEncoder encoder;
+    const auto data = encoder.encode(full);
+    const PatchView view(data);
+    CHECK(view.size() == full.size());
+    CHECK(view.base_version() == full.base_version());
+    CHECK(view.latest_version() == full.latest_version());
+
+    Mirror from_patch;
+    Mirror from_view;
+    Mirror from_decoded;
+    REQUIRE(from_patch.update(full));
+    REQUIRE(from_view.update(view));
+    REQUIRE(from_decoded.update(view.decode()));
+    compare_mirrors(from_patch, from_view, 0.0);
+    compare_mirrors(from_patch, from_decoded, 0.0);
+
+    THEN("Incremental patches can be applied from views")
+    {
+      auto version = db.latest_version();
+      db.delay(participants[0], 5s, 1);
+      db.set(participants[1], 1, {make_route("map_C", 20.0)}, 2, 1);
+      db.extend(participants[1], {dependent}, 2);
+      db.cull(time + 12s);
+
+      const auto patch = db.changes(query_all, version);
+      const auto patch_data = encoder.encode(patch);
+      REQUIRE(from_patch.update(patch));
+      REQUIRE(from_view.update(PatchView(patch_data)));
+      compare_mirrors(from_patch, from_view, 0.0);
+      CHECK(from_view.latest_version() == db.latest_version());
+
+      // A patch that does not match the mirror's version is refused
+      version = db.latest_version();
+      db.set(participants[0], 1, {make_route("map_A", 1.0)}, 4, 2);
+      const auto first = encoder.encode(db.changes(query_all, version));
+      version = db.latest_version();
+      db.delay(participants[0], 1s, 3);
+      const auto second = encoder.encode(db.changes(query_all, version));
+      CHECK_FALSE(from_view.update(PatchView(second)));
+      CHECK(from_view.update(PatchView(first)));
+      CHECK(from_view.update(PatchView(second)));
+      CHECK(from_view.latest_version() == db.latest_version());
+    }
+  }
+
+  WHEN("Encoding with quantization")
+  {
+    PatchEncoder encoder;
+    encoder.quantization(PatchEncoder::Quantization{1e-2, 1e-3});
+    const auto quantized = encoder.encode(full);
+    const auto precise = PatchEncoder().encode(full);
+    CHECK(quantized.size() < precise.size());
+
+    Mirror from_patch;
+    Mirror from_view;
+    REQUIRE(from_patch.update(full));
+    REQUIRE(from_view.update(PatchView(quantized)));
+    compare_mirrors(from_patch, from_view, 1e-2);
+
+    CHECK_THROWS_AS(
+      encoder.quantization(PatchEncoder::Quantization{0.0, 1e-3}),
+      std::invalid_argument);
+  }
+
+  WHEN("The data is invalid")
+  {
+    auto data = PatchEncoder().encode(full);
+
+    auto truncated = data;
+    truncated.pop_back();
+    CHECK_THROWS_AS(PatchView(truncated), std::runtime_error);
+
+    auto extended = data;
+    extended.push_back(0);
+    CHECK_THROWS_AS(PatchView(extended), std::runtime_error);
+
+    auto wrong_version = data;
+    wrong_version[4] = PatchView::FormatVersion + 1;
+    CHECK_THROWS_AS(PatchView(wrong_version), std::runtime_error);
+
+    auto wrong_marker = data;
+    wrong_marker[0] = 'X';
+    CHECK_THROWS_AS(PatchView(wrong_marker), std::runtime_error);
+  }
+}
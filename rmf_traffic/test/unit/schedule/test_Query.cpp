@@ -19,6 +19,7 @@
 #include <src/rmf_traffic/geometry/Box.hpp>
 
 #include <rmf_traffic/schedule/Query.hpp>
+#include <src/rmf_traffic/schedule/internal_Query.hpp>
 
 #include <rmf_utils/catch.hpp>
 
@@ -239,3 +240,181 @@ SCENARIO("Test Query API", "[query]")
   // TODO(MXG): Write tests for every function to confirm that the
   // Query API works as intended
 }
+
+SCENARIO("Compiled participant filters", "[query]")
+{
+  using rmf_traffic::schedule::ParticipantIdSet;
+  using rmf_traffic::schedule::Query;
+
+  GIVEN("Small participant IDs")
+  {
+    const ParticipantIdSet ids({0, 5, 63, 64, 4000});
+    CHECK(ids.dense());
+    CHECK(ids.contains(0));
+    CHECK(ids.contains(5));
+    CHECK(ids.contains(63));
+    CHECK(ids.contains(64));
+    CHECK(ids.contains(4000));
+    CHECK_FALSE(ids.contains(1));
+    CHECK_FALSE(ids.contains(65));
+    CHECK_FALSE(ids.contains(4001));
+    CHECK_FALSE(ids.contains(1000000));
+  }
+
+  GIVEN("A participant ID that is too large for a bitmap")
+  {
+    const ParticipantIdSet ids({3, 1000000000});
+    CHECK_FALSE(ids.dense());
+    CHECK(ids.contains(3));
+    CHECK(ids.contains(1000000000));
+    CHECK_FALSE(ids.contains(4));
+  }
+
+  GIVEN("No participant IDs")
+  {
+    const ParticipantIdSet ids({});
+    CHECK_FALSE(ids.contains(0));
+  }
+
+  GIVEN("A query that excludes one participant")
+  {
+    auto query = rmf_traffic::schedule::query_all();
+    query.participants() = Query::Participants::make_all_except({7});
+
+    const auto& exclude = *query.participants().exclude();
+    const auto compiled = rmf_traffic::schedule::get_id_set(exclude);
+    CHECK(compiled->contains(7));
+
+    THEN("The compiled set is reused by later queries")
+    {
+      CHECK(rmf_traffic::schedule::get_id_set(exclude) == compiled);
+      const Query copy = query;
+      CHECK(rmf_traffic::schedule::get_id_set(
+          *copy.participants().exclude()) == compiled);
+    }
+
+    THEN("Changing the IDs recompiles the set")
+    {
+      query.participants().exclude()->set_ids({8});
+      const auto recompiled = rmf_traffic::schedule::get_id_set(
+        *query.participants().exclude());
+      CHECK(recompiled != compiled);
+      CHECK(recompiled->contains(8));
+      CHECK_FALSE(recompiled->contains(7));
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Canonical and shared queries", "[query]")
+{
+  using namespace std::chrono_literals;
+  using Query = rmf_traffic::schedule::Query;
+  using SharedQuery = rmf_traffic::schedule::SharedQuery;
+
+  const auto now = std::chrono::steady_clock::now();
+  const auto box = rmf_traffic::geometry::make_final_convex(
+    rmf_traffic::geometry::Box(1.0, 1.0));
+  Eigen::Isometry2d tf_a = Eigen::Isometry2d::Identity();
+  Eigen::Isometry2d tf_b = Eigen::Isometry2d::Identity();
+  tf_b.translate(Eigen::Vector2d(5.0, 0.0));
+  const rmf_traffic::geometry::Space space_a{box, tf_a};
+  const rmf_traffic::geometry::Space space_b{box, tf_b};
+
+  const auto make_query = [](std::vector<rmf_traffic::ParticipantId> ids)
+    {
+      auto query = rmf_traffic::schedule::query_all();
+      query.participants() = Query::Participants::make_only(std::move(ids));
+      return query;
+    };
+
+  GIVEN("Participant IDs given in different orders")
+  {
+    const auto a = make_query({3, 1, 2, 1});
+    const auto b = make_query({2, 3, 1});
+
+    THEN("The IDs are sorted and unique")
+    {
+      const auto& ids = a.participants().include()->get_ids();
+      CHECK(ids == std::vector<rmf_traffic::ParticipantId>({1, 2, 3}));
+      CHECK(a == b);
+      CHECK(a.hash() == b.hash());
+    }
+  }
+
+  GIVEN("Regions written in two different ways")
+  {
+    auto a = rmf_traffic::schedule::query_all();
+    a.spacetime().query_regions(
+      {
+        rmf_traffic::Region{"B", now, now + 10s, {space_b}},
+        rmf_traffic::Region{"A", now, now + 10s, {space_a}},
+        rmf_traffic::Region{"A", now, now + 10s, {space_b, space_a}}
+      });
+
+    auto b = rmf_traffic::schedule::query_all();
+    b.spacetime().query_regions(
+      {
+        rmf_traffic::Region{"A", now, now + 10s, {space_a, space_b}},
+        rmf_traffic::Region{"B", now, now + 10s, {space_b}}
+      });
+
+    CHECK(a != b);
+
+    WHEN("They are canonicalized")
+    {
+      a.canonicalize();
+      b.canonicalize();
+
+      THEN("They are equal and have the same hash")
+      {
+        CHECK(a.spacetime().regions()->size() == 2);
+        CHECK(a.spacetime().regions()->begin()->num_spaces() == 2);
+        CHECK(a == b);
+        CHECK(a.hash() == b.hash());
+      }
+    }
+  }
+
+  GIVEN("Timespans with different time bounds")
+  {
+    auto a = rmf_traffic::schedule::query_all();
+    a.spacetime().query_timespan();
+    auto b = rmf_traffic::schedule::query_all();
+    b.spacetime().query_timespan().set_lower_time_bound(now);
+
+    THEN("Missing bounds are compared safely")
+    {
+      CHECK(a != b);
+      CHECK(b != a);
+      b.spacetime().timespan()->remove_lower_time_bound();
+      CHECK(a == b);
+      CHECK(a.hash() == b.hash());
+    }
+  }
+
+  GIVEN("Shared queries")
+  {
+    auto query = make_query({1, 2});
+    const SharedQuery shared(query);
+    const SharedQuery copy = shared;
+    const SharedQuery other(make_query({2, 1}));
+    const SharedQuery different(make_query({3}));
+
+    THEN("Equivalent queries collapse to one key")
+    {
+      CHECK(&copy.get() == &shared.get());
+      CHECK(copy == shared);
+      CHECK(other == shared);
+      CHECK(different != shared);
+      CHECK(shared.hash() == query.hash());
+
+      std::unordered_set<SharedQuery> keys;
+      keys.insert(shared);
+      keys.insert(copy);
+      keys.insert(other);
+      keys.insert(different);
+      CHECK(keys.size() == 2);
+    }
+  }
+}
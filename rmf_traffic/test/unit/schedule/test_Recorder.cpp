@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/Recorder.hpp>
+
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <set>
+#include <tuple>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+//==============================================================================
+using RouteKey = std::tuple<
+  rmf_traffic::schedule::ParticipantId,
+  rmf_traffic::PlanId,
+  double,
+  rmf_traffic::Time>;
+
+//==============================================================================
+std::set<RouteKey> routes_of(const rmf_traffic::schedule::Viewer& viewer)
+{
+  std::set<RouteKey> output;
+  for (const auto& element : viewer.query(rmf_traffic::schedule::query_all()))
+  {
+    const auto& start = element.route->trajectory().front();
+    output.insert(
+      {element.participant, element.plan_id, start.position().y(),
+        start.time()});
+  }
+
+  return output;
+}
+
+//==============================================================================
+rmf_traffic::Route make_route(
+  const std::string& map,
+  const rmf_traffic::Time start,
+  const double y)
+{
+  rmf_traffic::Trajectory t;
+  t.insert(start, Eigen::Vector3d{0, y, 0}, Eigen::Vector3d::Zero());
+  t.insert(start + 10s, Eigen::Vector3d{10, y, 0}, Eigen::Vector3d::Zero());
+  return rmf_traffic::Route(map, std::move(t));
+}
+
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Record and replay the calls to a schedule")
+{
+  using namespace rmf_traffic::schedule;
+
+  CHECK_THROWS_AS(Recorder(nullptr), std::runtime_error);
+
+  const auto database = std::make_shared<Database>();
+  Recorder recorder(database);
+  CHECK(recorder.database() == database);
+
+  const auto circle =
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Circle>(
+    0.5);
+
+  std::vector<ParticipantId> ids;
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    ids.push_back(
+      recorder.register_participant(
+        ParticipantDescription{
+          "participant_" + std::to_string(i),
+          "test_Recorder",
+          ParticipantDescription::Rx::Responsive,
+          rmf_traffic::Profile{circle, circle}
+        }).id());
+  }
+
+  const auto p0 = ids[0];
+  const auto p1 = ids[1];
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+  recorder.set(p0, 1, {make_route("A", time, 0.0)}, 0, 0);
+  recorder.set(p1, 1, {make_route("A", time, 1.0)}, 0, 0);
+  recorder.delay(p0, 5s, 1);
+  recorder.extend(p1, {make_route("B", time + 20s, 2.0)}, 1);
+  recorder.reached(p1, 1, {1}, 0);
+
+  // A call that the database rejects is still recorded
+  CHECK_THROWS(recorder.clear(p1 + 100, 0));
+
+  const auto patch = recorder.changes(query_all(), std::nullopt);
+  CHECK(patch.size() == 2);
+
+  const auto view = recorder.query(
+    make_query({"A"}, &time, nullptr));
+  CHECK(view.size() == 2);
+
+  recorder.set_current_time(time);
+  recorder.cull(time - 1min);
+  CHECK(recorder.size() == 12);
+  CHECK(recorder.skipped() == 0);
+
+  // The log can be taken in parts that are joined back together
+  auto log = recorder.take_log();
+  recorder.clear(p0, 2);
+  const auto rest = recorder.take_log();
+  CHECK(recorder.take_log().empty());
+  log.insert(log.end(), rest.begin(), rest.end());
+
+  const Replay replay(log);
+  CHECK(replay.size() == 13);
+  CHECK(replay.duration() >= rmf_traffic::Duration(0));
+
+  Database replayed;
+  Mirror mirror;
+  const auto stats = replay.run(replayed, &mirror);
+  CHECK(routes_of(replayed) == routes_of(*database));
+  CHECK(replayed.latest_version() == database->latest_version());
+  CHECK(replayed.participant_ids() == database->participant_ids());
+
+  using Op = Recorder::Operation;
+  CHECK(stats[Op::RegisterParticipant].count == 2);
+  CHECK(stats[Op::Set].count == 2);
+  CHECK(stats[Op::Clear].count == 2);
+  CHECK(stats[Op::Clear].failed == 1);
+  CHECK(stats[Op::Changes].count == 1);
+  CHECK(stats[Op::Set].max <= stats.total);
+
+  // The mirror received the patch from the Changes call
+  CHECK(stats.mirror_update.count == 1);
+  CHECK(stats.mirror_update.failed == 0);
+  CHECK(mirror.get_itinerary(p0).has_value());
+  CHECK(mirror.get_itinerary(p1).has_value());
+
+  // Invalid logs are refused
+  CHECK_THROWS_AS(Replay(std::vector<uint8_t>{}), std::runtime_error);
+  auto truncated = log;
+  truncated.pop_back();
+  CHECK_THROWS_AS(Replay(truncated), std::runtime_error);
+}
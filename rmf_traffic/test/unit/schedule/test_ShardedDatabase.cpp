@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/schedule/Database.hpp>
+#include <rmf_traffic/schedule/Mirror.hpp>
+#include <rmf_traffic/schedule/ShardedDatabase.hpp>
+
+#include <rmf_traffic/geometry/Circle.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <set>
+#include <thread>
+#include <tuple>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+//==============================================================================
+using RouteKey = std::tuple<
+  rmf_traffic::schedule::ParticipantId,
+  rmf_traffic::RouteId,
+  std::string,
+  rmf_traffic::Time,
+  rmf_traffic::Time>;
+
+//==============================================================================
+std::set<RouteKey> routes_of(const rmf_traffic::schedule::Viewer& viewer)
+{
+  std::set<RouteKey> output;
+  for (const auto& element
+    : viewer.query(rmf_traffic::schedule::query_all()))
+  {
+    const auto& trajectory = element.route->trajectory();
+    output.insert(
+      {
+        element.participant,
+        element.route_id,
+        element.route->map(),
+        *trajectory.start_time(),
+        *trajectory.finish_time()
+      });
+  }
+
+  return output;
+}
+
+//==============================================================================
+rmf_traffic::Route make_route(
+  const std::string& map,
+  const rmf_traffic::Time start,
+  const double y)
+{
+  rmf_traffic::Trajectory t;
+  t.insert(start, Eigen::Vector3d{0, y, 0}, Eigen::Vector3d::Zero());
+  t.insert(start + 10s, Eigen::Vector3d{10, y, 0}, Eigen::Vector3d::Zero());
+  return rmf_traffic::Route(map, std::move(t));
+}
+
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Sharded database")
+{
+  using namespace rmf_traffic::schedule;
+
+  ShardedDatabase sharded({{"A"}, {"B"}});
+  CHECK(sharded.shard_count() == 3);
+  CHECK(sharded.shard_of("A") == 0);
+  CHECK(sharded.shard_of("B") == 1);
+  CHECK(sharded.shard_of("C") == 2);
+
+  // The same changes are given to a plain Database to compare against
+  Database reference;
+  Mirror mirror;
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  ParticipantDescriptionsMap descriptions;
+  std::vector<ParticipantId> ids;
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    const ParticipantDescription desc{
+      "participant_" + std::to_string(i),
+      "test_ShardedDatabase",
+      ParticipantDescription::Rx::Responsive,
+      profile
+    };
+
+    const auto id = sharded.register_participant(desc).id();
+    CHECK(reference.register_participant(desc).id() == id);
+    descriptions.insert({id, desc});
+    ids.push_back(id);
+  }
+
+  mirror.update_participants_info(descriptions);
+
+  const auto check_same = [&]()
+    {
+      const auto expected = routes_of(reference);
+      CHECK(routes_of(sharded) == expected);
+
+      REQUIRE(mirror.update(
+          sharded.changes(query_all(), mirror.latest_version())));
+      CHECK(mirror.latest_version() == sharded.latest_version());
+      CHECK(routes_of(mirror) == expected);
+
+      for (const auto id : ids)
+      {
+        CHECK(sharded.get_itinerary(id)->size()
+          == reference.get_itinerary(id)->size());
+        CHECK(sharded.get_current_plan_id(id)
+          == reference.get_current_plan_id(id));
+      }
+    };
+
+  const auto p0 = ids[0];
+  const auto p1 = ids[1];
+  const rmf_traffic::Time time = std::chrono::steady_clock::now();
+
+  const auto apply = [&](const auto& change)
+    {
+      change(sharded);
+      change(reference);
+      check_same();
+    };
+
+  apply([&](Writer& w)
+    {
+      w.set(p0, 0, {make_route("A", time, 0), make_route("A", time+20s, 0)},
+      0, 0);
+    });
+
+  apply([&](Writer& w)
+    {
+      w.set(p1, 0, {make_route("B", time, 1)}, 0, 0);
+    });
+
+  WHEN("A participant extends its itinerary onto another map")
+  {
+    apply([&](Writer& w)
+      {
+        w.extend(p0, {make_route("B", time+40s, 2)}, 1);
+      });
+
+    apply([&](Writer& w) { w.delay(p0, 5s, 2); });
+
+    THEN("Later changes reach every shard that it is in")
+    {
+      apply([&](Writer& w)
+        {
+          w.extend(p0, {make_route("C", time+60s, 3)}, 3);
+        });
+
+      apply([&](Writer& w) { w.delay(p0, 2s, 4); });
+      apply([&](Writer& w) { w.clear(p0, 5); });
+      apply([&](Writer& w)
+        {
+          w.extend(p0, {make_route("A", time+80s, 4)}, 6);
+        });
+    }
+
+    THEN("Setting a new plan moves it off of the old maps")
+    {
+      apply([&](Writer& w)
+        {
+          w.set(p0, 1, {make_route("C", time, 3)}, 10, 3);
+        });
+
+      apply([&](Writer& w)
+        {
+          w.extend(p0, {make_route("A", time+20s, 4)}, 4);
+        });
+
+      CHECK(sharded.get_itinerary(p0)->size() == 2);
+    }
+  }
+
+  WHEN("Changes arrive out of order")
+  {
+    sharded.extend(p1, {make_route("C", time+40s, 5)}, 2);
+    CHECK(sharded.inconsistencies().find(p1)->ranges.size() == 1);
+
+    apply([&](Writer& w)
+      {
+        w.extend(p1, {make_route("A", time+20s, 5)}, 1);
+        if (&w == &reference)
+          w.extend(p1, {make_route("C", time+40s, 5)}, 2);
+      });
+
+    CHECK(sharded.inconsistencies().find(p1)->ranges.size() == 0);
+    CHECK(sharded.get_itinerary(p1)->size() == 3);
+  }
+
+  WHEN("Progress arrives before its plan")
+  {
+    sharded.reached(p1, 1, {1}, 1);
+    reference.reached(p1, 1, {1}, 1);
+    apply([&](Writer& w)
+      {
+        w.set(p1, 1, {make_route("A", time, 1)}, 1, 1);
+      });
+
+    REQUIRE(mirror.get_current_progress(p1));
+    CHECK(
+      *mirror.get_current_progress(p1)
+      == std::vector<rmf_traffic::CheckpointId>{1});
+  }
+
+  WHEN("The database is culled")
+  {
+    apply([&](Writer& w)
+      {
+        w.extend(p0, {make_route("B", time+40s, 2)}, 1);
+      });
+
+    sharded.cull(time + 15s);
+    reference.cull(time + 15s);
+    check_same();
+
+    CHECK(sharded.get_itinerary(p0)->size() == 2);
+
+    apply([&](Writer& w)
+      {
+        w.extend(p0, {make_route("C", time+60s, 3)}, 2);
+      });
+  }
+
+  WHEN("Participants on different maps write at the same time")
+  {
+    const std::size_t N = 100;
+    const auto write = [&](const ParticipantId p, const std::string& map)
+      {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+          sharded.set(
+            p, i+1, {make_route(map, time + std::chrono::seconds(i), 0)},
+            i+10, i+1);
+        }
+      };
+
+    std::thread t0(write, p0, "A");
+    std::thread t1(write, p1, "B");
+    std::thread reader(
+      [&]()
+      {
+        for (std::size_t i = 0; i < N; ++i)
+          CHECK(routes_of(sharded).size() <= 3);
+      });
+
+    t0.join();
+    t1.join();
+    reader.join();
+
+    CHECK(sharded.get_current_plan_id(p0) == N);
+    CHECK(sharded.get_current_plan_id(p1) == N);
+
+    REQUIRE(mirror.update(
+        sharded.changes(query_all(), mirror.latest_version())));
+    CHECK(routes_of(mirror) == routes_of(sharded));
+    CHECK(routes_of(mirror).size() == 2);
+  }
+}
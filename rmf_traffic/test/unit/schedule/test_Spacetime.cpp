@@ -109,6 +109,23 @@ SCENARIO("Testing intersection of spacetime with trajectories")
 
     CHECK_FALSE(rmf_traffic::internal::detect_conflicts(circle, t1, region));
   }
+
+  GIVEN("A trajectory whose path never comes close to the spacetime region")
+  {
+    rmf_traffic::Trajectory t1;
+    t1.insert(time, {-50, 50, 0}, {5, 0, 0});
+    t1.insert(time+5s, {0, 50, 0}, {5, 0, 0});
+    t1.insert(time+10s, {50, 50, 0}, {5, 0, 0});
+    REQUIRE(t1.size() == 3);
+
+    rmf_traffic::DetectConflict::reset_stats();
+    rmf_traffic::DetectConflict::collect_stats(true);
+    CHECK_FALSE(rmf_traffic::internal::detect_conflicts(box, t1, region));
+    rmf_traffic::DetectConflict::collect_stats(false);
+
+    // The bounding boxes should rule it out without any narrowphase checks
+    CHECK(rmf_traffic::DetectConflict::get_stats().fcl_ccd_calls == 0);
+  }
 }
 
 
@@ -1517,3 +1534,51 @@ SCENARIO("Testing multi-waypoint trajectories with various spacetimes")
     // Eigen::Isometry2d tf= Eigen::Isometry2d::Identity();
   }
 }
+
+SCENARIO("Spacetime bounds are computed in the world frame")
+{
+  using namespace std::chrono_literals;
+  const auto time = std::chrono::steady_clock::now();
+
+  Eigen::Isometry2d tf = Eigen::Isometry2d::Identity();
+  tf.translate(Eigen::Vector2d(3.0, 4.0));
+  tf.rotate(Eigen::Rotation2Dd(M_PI/2.0));
+
+  const auto circle = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(1.0);
+
+  rmf_traffic::internal::Spacetime region{nullptr, nullptr, tf, circle};
+  CHECK(region.piece_bounds.empty());
+  CHECK((region.bounds.min - Eigen::Vector2d(2.0, 3.0)).norm()
+    == Approx(0.0).margin(1e-12));
+  CHECK((region.bounds.max - Eigen::Vector2d(4.0, 5.0)).norm()
+    == Approx(0.0).margin(1e-12));
+
+  const auto circle_profile = rmf_traffic::Profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  // This trajectory stays far away from the region, so it can be ruled out
+  // without any narrowphase checks
+  rmf_traffic::Trajectory far_away;
+  far_away.insert(time, {-10.0, -10.0, 0.0}, {0.0, 0.0, 0.0});
+  far_away.insert(time + 10s, {-10.0, 10.0, 0.0}, {0.0, 0.0, 0.0});
+  CHECK_FALSE(rmf_traffic::internal::detect_conflicts(
+      circle_profile, far_away, region));
+
+  rmf_traffic::Trajectory passing;
+  passing.insert(time, {-10.0, 4.0, 0.0}, {0.0, 0.0, 0.0});
+  passing.insert(time + 10s, {10.0, 4.0, 0.0}, {0.0, 0.0, 0.0});
+  CHECK(rmf_traffic::internal::detect_conflicts(
+      circle_profile, passing, region));
+
+  WHEN("The space is moved")
+  {
+    region.set_space(Eigen::Isometry2d::Identity(), circle);
+    CHECK((region.bounds.min - Eigen::Vector2d(-1.0, -1.0)).norm()
+      == Approx(0.0).margin(1e-12));
+    CHECK_FALSE(rmf_traffic::internal::detect_conflicts(
+        circle_profile, passing, region));
+  }
+}
@@ -169,4 +169,40 @@ inline rmf_traffic::schedule::Itinerary create_test_input(
   return {rmf_traffic::Route("test_map", t)};
 }
 
+//==============================================================================
+inline rmf_traffic::Profile make_test_profile()
+{
+  return rmf_traffic::Profile{
+    rmf_traffic::geometry::make_final_convex<
+      rmf_traffic::geometry::Circle>(0.5)
+  };
+}
+
+//==============================================================================
+inline rmf_traffic::schedule::ParticipantDescription make_test_description(
+  const std::string& name,
+  const rmf_traffic::Profile& profile = make_test_profile(),
+  const rmf_traffic::schedule::ParticipantDescription::Rx responsiveness =
+    rmf_traffic::schedule::ParticipantDescription::Rx::Responsive)
+{
+  return rmf_traffic::schedule::ParticipantDescription{
+    name,
+    "test_Database",
+    responsiveness,
+    profile
+  };
+}
+
+//==============================================================================
+inline rmf_traffic::schedule::ParticipantId register_test_participant(
+  rmf_traffic::schedule::Database& db,
+  const std::string& name = "participant",
+  const rmf_traffic::Profile& profile = make_test_profile(),
+  const rmf_traffic::schedule::ParticipantDescription::Rx responsiveness =
+    rmf_traffic::schedule::ParticipantDescription::Rx::Responsive)
+{
+  return db.register_participant(
+    make_test_description(name, profile, responsiveness)).id();
+}
+
 #endif //RMF_TRAFFIC__TEST__UNIT__SCHEDULE__UTILS_TRAJECTORY_HPP
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/CompactTrajectory.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <cmath>
+
+using namespace std::chrono_literals;
+
+//==============================================================================
+SCENARIO("Compact trajectory encoding")
+{
+  const auto start = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory trajectory;
+  for (std::size_t i = 0; i < 100; ++i)
+  {
+    const double s = static_cast<double>(i);
+    trajectory.insert(
+      start + std::chrono::milliseconds(1500*i + 7),
+      Eigen::Vector3d(0.3*s + 1e-4, -0.7*s, std::fmod(0.1*s, M_PI)),
+      Eigen::Vector3d(0.3, -0.7, 0.1));
+  }
+
+  GIVEN("The default quantization")
+  {
+    const rmf_traffic::CompactTrajectory compact(trajectory);
+    const auto& q = compact.quantization();
+    CHECK(compact.size() == trajectory.size());
+    CHECK(*compact.start_time() == *trajectory.start_time());
+
+    // Each waypoint of a Trajectory holds seven 8-byte values
+    CHECK(compact.data().size() < 7*8*trajectory.size()/4);
+
+    const rmf_traffic::Trajectory decoded = compact.decode();
+    REQUIRE(decoded.size() == trajectory.size());
+    CHECK(*decoded.finish_time() == *compact.finish_time());
+
+    const double t_tol = 0.5*std::chrono::duration<double>(q.time).count();
+    for (std::size_t i = 0; i < trajectory.size(); ++i)
+    {
+      const auto& original = trajectory[i];
+      const auto& result = decoded[i];
+      const double dt =
+        std::chrono::duration<double>(result.time() - original.time()).count();
+      CHECK(std::abs(dt) <= t_tol + 1e-9);
+
+      const Eigen::Vector3d dp = result.position() - original.position();
+      CHECK(std::abs(dp[0]) <= 0.5*q.translation + 1e-9);
+      CHECK(std::abs(dp[1]) <= 0.5*q.translation + 1e-9);
+      CHECK(std::abs(dp[2]) <= 0.5*q.rotation + 1e-9);
+
+      const Eigen::Vector3d dv = result.velocity() - original.velocity();
+      CHECK(std::abs(dv[0]) <= 0.5*q.translation + 1e-9);
+      CHECK(std::abs(dv[2]) <= 0.5*q.rotation + 1e-9);
+    }
+  }
+
+  GIVEN("Waypoints that are closer together than the time resolution")
+  {
+    rmf_traffic::Trajectory close;
+    close.insert(start, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+    close.insert(
+      start + 10ns, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+    close.insert(
+      start + 20ns, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+
+    const auto decoded = rmf_traffic::CompactTrajectory(close).decode();
+    CHECK(decoded.size() == 3);
+  }
+
+  GIVEN("An empty trajectory")
+  {
+    const rmf_traffic::CompactTrajectory compact{rmf_traffic::Trajectory()};
+    CHECK(compact.empty());
+    CHECK_FALSE(compact.start_time().has_value());
+    CHECK(compact.decode().empty());
+  }
+
+  GIVEN("An invalid quantization")
+  {
+    rmf_traffic::CompactTrajectory::Quantization q;
+    q.translation = 0.0;
+    CHECK_THROWS_AS(
+      rmf_traffic::CompactTrajectory(trajectory, q), std::invalid_argument);
+  }
+}
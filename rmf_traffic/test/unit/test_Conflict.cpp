@@ -21,6 +21,8 @@
 
 #include <rmf_utils/catch.hpp>
 
+#include <thread>
+
 using namespace std::chrono_literals;
 
 SCENARIO("DetectConflict unit tests")
@@ -734,4 +736,630 @@ SCENARIO("Route dependency conflict tests")
   }
 }
 
+//==============================================================================
+SCENARIO("Skipping spans of ignored segments")
+{
+  using rmf_traffic::DetectConflict;
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Circle>(0.2)
+  };
+
+  // A and B drive head-on through the same lane and pass each other halfway
+  rmf_traffic::Trajectory A;
+  rmf_traffic::Trajectory B;
+  for (std::size_t i = 0; i < 20; ++i)
+  {
+    const auto t = t0 + std::chrono::seconds(i);
+    const double x = static_cast<double>(i);
+    A.insert(t, {x, 0, 0}, {0, 0, 0});
+    B.insert(t, {19.0 - x, 0, 0}, {0, 0, 0});
+  }
+
+  rmf_traffic::Route rA("test_map", A);
+  rmf_traffic::Route rB("test_map", B);
+
+  const bool collecting = DetectConflict::collecting_stats();
+  DetectConflict::collect_stats(true);
+  DetectConflict::reset_stats();
+
+  WHEN("There are no dependencies")
+  {
+    CHECK(DetectConflict::between(
+        profile, A, rA.check_dependencies(1, 0, 0),
+        profile, B, rB.check_dependencies(0, 0, 0)));
+    CHECK(DetectConflict::get_stats().ignored_span_skips == 0);
+  }
+
+  WHEN("A0 depends on B15")
+  {
+    // Every pair is ignored until B has passed its 15th checkpoint, which is
+    // long after the agents have passed each other.
+    rA.add_dependency(0, {1, 0, 0, 15});
+    CHECK_FALSE(DetectConflict::between(
+        profile, A, rA.check_dependencies(1, 0, 0),
+        profile, B, rB.check_dependencies(0, 0, 0)));
+
+    const auto stats = DetectConflict::get_stats();
+    CHECK(stats.ignored_span_skips == 1);
+    CHECK(stats.invasion_segment_pairs < 10);
+  }
+
+  DetectConflict::collect_stats(collecting);
+}
+
+SCENARIO("Cached segment bounds follow trajectory changes")
+{
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  rmf_traffic::Trajectory A;
+  A.insert(t0, {-10, 0, 0}, {1, 0, 0});
+  A.insert(t0+20s, {10, 0, 0}, {1, 0, 0});
+
+  rmf_traffic::Trajectory B;
+  B.insert(t0, {0, 20, 0}, {0, 0, 0});
+  B.insert(t0+5s, {0, 20, 0}, {0, 0, 0});
+  B.insert(t0+20s, {0, 20, 0}, {0, 0, 0});
+
+  // Populate the cache of both trajectories
+  CHECK_FALSE(rmf_traffic::DetectConflict::between(
+      profile, A, nullptr, profile, B, nullptr));
+
+  WHEN("A waypoint position is moved into the path of the other trajectory")
+  {
+    B.back().position({10, 0, 0});
+    THEN("The conflict is detected")
+    {
+      CHECK(rmf_traffic::DetectConflict::between(
+          profile, A, nullptr, profile, B, nullptr));
+    }
+  }
+
+  WHEN("A waypoint is inserted in the path of the other trajectory")
+  {
+    B.insert(t0+10s, {0, 0, 0}, {0, 0, 0});
+    THEN("The conflict is detected")
+    {
+      CHECK(rmf_traffic::DetectConflict::between(
+          profile, A, nullptr, profile, B, nullptr));
+    }
+  }
+
+  WHEN("A copy of the trajectory is modified")
+  {
+    rmf_traffic::Trajectory C = B;
+    C.back().position({10, 0, 0});
+    THEN("Only the modified copy is in conflict")
+    {
+      CHECK(rmf_traffic::DetectConflict::between(
+          profile, A, nullptr, profile, C, nullptr));
+      CHECK_FALSE(rmf_traffic::DetectConflict::between(
+          profile, A, nullptr, profile, B, nullptr));
+    }
+  }
+}
+
+SCENARIO("Analytic circle collision times")
+{
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  rmf_traffic::Trajectory A;
+  A.insert(t0, {-10, 0, 0}, {1, 0, 0});
+  A.insert(t0+20s, {10, 0, 0}, {1, 0, 0});
+
+  GIVEN("A head-on approach")
+  {
+    rmf_traffic::Trajectory B;
+    B.insert(t0, {10, 0, 0}, {-1, 0, 0});
+    B.insert(t0+20s, {-10, 0, 0}, {-1, 0, 0});
+
+    THEN("The conflict is found at the moment the circles touch")
+    {
+      const auto conflict = rmf_traffic::DetectConflict::between(
+        profile, A, nullptr, profile, B, nullptr);
+      REQUIRE(conflict);
+      CHECK(rmf_traffic::time::to_seconds(conflict->time - t0)
+        == Approx(9.5).margin(1e-3));
+
+      CHECK_between_is_commutative(profile, A, profile, B);
+    }
+  }
+
+  GIVEN("Parallel lanes that are barely far enough apart")
+  {
+    rmf_traffic::Trajectory B;
+    B.insert(t0, {10, 1.01, 0}, {-1, 0, 0});
+    B.insert(t0+20s, {-10, 1.01, 0}, {-1, 0, 0});
+
+    THEN("There is no conflict")
+    {
+      CHECK_FALSE(rmf_traffic::DetectConflict::between(
+          profile, A, nullptr, profile, B, nullptr));
+    }
+  }
+
+  GIVEN("Parallel lanes that are barely too close together")
+  {
+    rmf_traffic::Trajectory B;
+    B.insert(t0, {10, 0.99, 0}, {-1, 0, 0});
+    B.insert(t0+20s, {-10, 0.99, 0}, {-1, 0, 0});
+
+    THEN("The conflict is found when the robots pass each other")
+    {
+      const auto conflict = rmf_traffic::DetectConflict::between(
+        profile, A, nullptr, profile, B, nullptr);
+      REQUIRE(conflict);
+
+      // The circles first touch when the longitudinal gap is sqrt(1 - 0.99^2)
+      const double expected = 10.0 - std::sqrt(1.0 - 0.99*0.99)/2.0;
+      CHECK(rmf_traffic::time::to_seconds(conflict->time - t0)
+        == Approx(expected).margin(1e-3));
+    }
+  }
+}
+
+SCENARIO("Batch conflict detection")
+{
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  rmf_traffic::Trajectory A;
+  A.insert(t0, {-10, 0, 0}, {1, 0, 0});
+  A.insert(t0+20s, {10, 0, 0}, {1, 0, 0});
+
+  // Every third trajectory cuts across the path of A
+  std::vector<rmf_traffic::Trajectory> others;
+  for (std::size_t i = 0; i < 30; ++i)
+  {
+    const double x = -9.0 + 0.6*static_cast<double>(i);
+    const double y = (i % 3 == 2) ? 0.0 : 5.0;
+
+    rmf_traffic::Trajectory B;
+    B.insert(t0, {x, 10, 0}, {0, 0, 0});
+    B.insert(t0 + 2s, {x, 10, 0}, {0, 0, 0});
+    B.insert(t0 + 20s, {x, y, 0}, {0, 0, 0});
+    others.emplace_back(std::move(B));
+  }
+
+  std::vector<rmf_traffic::DetectConflict::Candidate> candidates;
+  for (const auto& B : others)
+    candidates.push_back({&profile, &B});
+
+  std::vector<std::size_t> expected;
+  for (std::size_t i = 0; i < others.size(); ++i)
+  {
+    if (rmf_traffic::DetectConflict::between(
+        profile, A, nullptr, profile, others[i], nullptr))
+      expected.push_back(i);
+  }
+  REQUIRE_FALSE(expected.empty());
+
+  for (const std::size_t threads : {1, 4})
+  {
+    rmf_traffic::DetectConflict::BatchOptions options;
+    options.max_threads = threads;
+    options.min_candidates_per_thread = 1;
+
+    WHEN("Looking for the first conflict with " + std::to_string(threads)
+      + " threads")
+    {
+      options.find_all = false;
+      const auto conflicts = rmf_traffic::DetectConflict::between_many(
+        profile, A, candidates, options);
+
+      REQUIRE(conflicts.size() == 1);
+      CHECK(conflicts.front().index == expected.front());
+    }
+
+    WHEN("Looking for all conflicts with " + std::to_string(threads)
+      + " threads")
+    {
+      options.find_all = true;
+      const auto conflicts = rmf_traffic::DetectConflict::between_many(
+        profile, A, candidates, options);
+
+      REQUIRE(conflicts.size() == expected.size());
+      for (std::size_t i = 0; i < conflicts.size(); ++i)
+      {
+        CHECK(conflicts[i].index == expected[i]);
+
+        const auto single = rmf_traffic::DetectConflict::between(
+          profile, A, nullptr, profile, others[expected[i]], nullptr);
+        REQUIRE(single);
+        CHECK(conflicts[i].conflict.time == single->time);
+      }
+    }
+  }
+
+  WHEN("The checks are given as independent pairs")
+  {
+    // Every other pair swaps which side A is on
+    std::vector<rmf_traffic::DetectConflict::Pair> pairs;
+    for (std::size_t i = 0; i < others.size(); ++i)
+    {
+      if (i % 2 == 0)
+        pairs.push_back({&profile, &A, nullptr, &profile, &others[i], nullptr});
+      else
+        pairs.push_back({&profile, &others[i], nullptr, &profile, &A, nullptr});
+    }
+
+    rmf_traffic::DetectConflict::BatchOptions options(true, 4, 1);
+    const auto conflicts =
+      rmf_traffic::DetectConflict::between_pairs(pairs, options);
+
+    REQUIRE(conflicts.size() == expected.size());
+    for (std::size_t i = 0; i < conflicts.size(); ++i)
+    {
+      const std::size_t index = conflicts[i].index;
+      CHECK(index == expected[i]);
+
+      const auto& pair = pairs[index];
+      const auto single = rmf_traffic::DetectConflict::between(
+        profile, *pair.trajectory_a, nullptr,
+        profile, *pair.trajectory_b, nullptr);
+      REQUIRE(single);
+      CHECK(conflicts[i].conflict.time == single->time);
+      CHECK(conflicts[i].conflict.a_it == single->a_it);
+    }
+  }
+
+  WHEN("The batch is interrupted partway through")
+  {
+    // Let the first few candidates be checked before interrupting
+    const std::size_t allowed = expected.front() + 1;
+    std::size_t calls = 0;
+
+    rmf_traffic::DetectConflict::BatchOptions options(true);
+    options.interrupter = [&]() { return ++calls > allowed; };
+
+    const auto conflicts = rmf_traffic::DetectConflict::between_many(
+      profile, A, candidates, options);
+
+    CHECK(calls == allowed + 1);
+    REQUIRE(conflicts.size() == 1);
+    CHECK(conflicts.front().index == expected.front());
+  }
+
+  WHEN("The batch is interrupted before it starts")
+  {
+    for (const std::size_t threads : {1, 4})
+    {
+      rmf_traffic::DetectConflict::BatchOptions options(true, threads, 1);
+      options.interrupter = []() { return true; };
+
+      CHECK(rmf_traffic::DetectConflict::between_many(
+          profile, A, candidates, options).empty());
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Conflict detection stats")
+{
+  using rmf_traffic::DetectConflict;
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  rmf_traffic::Trajectory A;
+  A.insert(t0, {-10, 0, 0}, {0, 0, 0});
+  A.insert(t0+10s, {10, 0, 0}, {0, 0, 0});
+
+  // B crosses the path of A
+  rmf_traffic::Trajectory B;
+  B.insert(t0, {0, -10, 0}, {0, 0, 0});
+  B.insert(t0+10s, {0, 10, 0}, {0, 0, 0});
+
+  // C is never close to A
+  rmf_traffic::Trajectory C;
+  C.insert(t0, {-10, 50, 0}, {0, 0, 0});
+  C.insert(t0+10s, {10, 50, 0}, {0, 0, 0});
+
+  // D happens after A is finished
+  rmf_traffic::Trajectory D;
+  D.insert(t0+20s, {0, -10, 0}, {0, 0, 0});
+  D.insert(t0+30s, {0, 10, 0}, {0, 0, 0});
+
+  const bool collecting = DetectConflict::collecting_stats();
+  DetectConflict::reset_stats();
+
+  WHEN("Stats are turned off")
+  {
+    DetectConflict::collect_stats(false);
+    CHECK(DetectConflict::between(profile, A, nullptr, profile, B, nullptr));
+
+    const auto stats = DetectConflict::get_stats();
+    CHECK(stats.pair_checks == 0);
+    CHECK(stats.conflicts == 0);
+    CHECK(stats.time_spent == rmf_traffic::Duration(0));
+  }
+
+  WHEN("Stats are turned on")
+  {
+    DetectConflict::collect_stats(true);
+    CHECK(DetectConflict::between(profile, A, nullptr, profile, B, nullptr));
+    CHECK_FALSE(
+      DetectConflict::between(profile, A, nullptr, profile, C, nullptr));
+    CHECK_FALSE(
+      DetectConflict::between(profile, A, nullptr, profile, D, nullptr));
+
+    const auto stats = DetectConflict::get_stats();
+    CHECK(stats.pair_checks == 3);
+    CHECK(stats.time_overlap_rejects == 1);
+    CHECK(stats.bounding_box_rejects == 1);
+    CHECK(stats.close_start_hits == 0);
+    CHECK(stats.invasion_segment_pairs == 1);
+    CHECK(stats.analytic_circle_checks == 1);
+    CHECK(stats.fcl_ccd_calls == 0);
+    CHECK(stats.conflicts == 1);
+
+    THEN("Stats from other threads are included")
+    {
+      std::thread worker([&]()
+        {
+          CHECK(DetectConflict::between(
+            profile, A, nullptr, profile, B, nullptr));
+        });
+      worker.join();
+
+      CHECK(DetectConflict::get_stats().pair_checks == 4);
+      CHECK(DetectConflict::get_stats().conflicts == 2);
+    }
+
+    THEN("Stats can be reset")
+    {
+      DetectConflict::reset_stats();
+      const auto reset = DetectConflict::get_stats();
+      CHECK(reset.pair_checks == 0);
+      CHECK(reset.conflicts == 0);
+      CHECK(reset.time_spent == rmf_traffic::Duration(0));
+    }
+  }
+
+  DetectConflict::collect_stats(collecting);
+}
+
+//==============================================================================
+SCENARIO("Finding every conflict between two trajectories")
+{
+  using rmf_traffic::DetectConflict;
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  // A passes through B on its way out and again on its way back
+  rmf_traffic::Trajectory A;
+  A.insert(t0, {-10, 0, 0}, {0, 0, 0});
+  A.insert(t0+10s, {10, 0, 0}, {0, 0, 0});
+  A.insert(t0+20s, {-10, 0, 0}, {0, 0, 0});
+
+  rmf_traffic::Trajectory B;
+  B.insert(t0, {0, 0, 0}, {0, 0, 0});
+  B.insert(t0+10s, {0, 0, 0}, {0, 0, 0});
+  B.insert(t0+20s, {0, 0, 0}, {0, 0, 0});
+
+  const auto first = DetectConflict::between(
+    profile, A, nullptr, profile, B, nullptr);
+  REQUIRE(first);
+
+  const auto intervals = DetectConflict::all_between(
+    profile, A, nullptr, profile, B, nullptr);
+  REQUIRE(intervals.size() == 2);
+
+  // The first interval matches the conflict that between() finds
+  CHECK(intervals[0].a_it == first->a_it);
+  CHECK(intervals[0].b_it == first->b_it);
+  CHECK(intervals[0].begin == first->time);
+  CHECK(intervals[0].end == t0+10s);
+
+  CHECK(intervals[1].a_it->index() == 2);
+  CHECK(intervals[1].b_it->index() == 2);
+  CHECK(t0+10s < intervals[1].begin);
+  CHECK(intervals[1].begin < t0+15s);
+  CHECK(intervals[1].end == t0+20s);
+
+  WHEN("The trajectories never meet")
+  {
+    rmf_traffic::Trajectory C;
+    C.insert(t0, {0, 50, 0}, {0, 0, 0});
+    C.insert(t0+20s, {0, 50, 0}, {0, 0, 0});
+    CHECK(DetectConflict::all_between(
+        profile, A, nullptr, profile, C, nullptr).empty());
+  }
+}
+
+//==============================================================================
+SCENARIO("Conflicts between stationary segments")
+{
+  using rmf_traffic::DetectConflict;
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+
+  // The boxes can reach farther than they actually extend along each axis, so
+  // parked boxes that are side by side will get past the broadphase.
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Box>(
+      1.0, 1.0)
+  };
+
+  rmf_traffic::Trajectory A;
+  A.insert(t0, {0, 0, 0}, {0, 0, 0});
+  A.insert(t0+10s, {0, 0, 0}, {0, 0, 0});
+
+  rmf_traffic::Trajectory B;
+  B.insert(t0, {1.2, 0, 0}, {0, 0, 0});
+  B.insert(t0+10s, {1.2, 0, 0}, {0, 0, 0});
+
+  const bool collecting = DetectConflict::collecting_stats();
+  DetectConflict::collect_stats(true);
+  DetectConflict::reset_stats();
+
+  WHEN("Both agents are holding next to each other")
+  {
+    CHECK_FALSE(
+      DetectConflict::between(profile, A, nullptr, profile, B, nullptr));
+
+    const auto stats = DetectConflict::get_stats();
+    CHECK(stats.stationary_checks == 1);
+    CHECK(stats.fcl_ccd_calls == 0);
+  }
+
+  WHEN("One of the agents moves into the other")
+  {
+    B.back().position({0.5, 0, 0});
+    CHECK(DetectConflict::between(profile, A, nullptr, profile, B, nullptr));
+
+    const auto stats = DetectConflict::get_stats();
+    CHECK(stats.stationary_checks == 0);
+    CHECK(stats.fcl_ccd_calls == 1);
+  }
+
+  DetectConflict::collect_stats(collecting);
+}
+
+//==============================================================================
+SCENARIO("Conflicts with long trajectories")
+{
+  using rmf_traffic::DetectConflict;
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Circle>(
+      0.5)
+  };
+
+  // A patrol that sweeps back and forth while moving north
+  rmf_traffic::Trajectory patrol;
+  for (std::size_t i = 0; i < 200; ++i)
+  {
+    const double x = (i % 2 == 0) ? 0.0 : 10.0;
+    const double y = 2.0 * static_cast<double>(i / 2);
+    patrol.insert(t0 + std::chrono::seconds(i), {x, y, 0}, {0, 0, 0});
+  }
+
+  const bool collecting = DetectConflict::collecting_stats();
+  DetectConflict::collect_stats(true);
+  DetectConflict::reset_stats();
+
+  WHEN("Another agent waits in one of the lanes of the patrol")
+  {
+    rmf_traffic::Trajectory parked;
+    parked.insert(t0, {5, 150.5, 0}, {0, 0, 0});
+    parked.insert(t0 + 200s, {5, 150.5, 0}, {0, 0, 0});
+
+    const auto conflict = DetectConflict::between(
+      profile, patrol, nullptr, profile, parked, nullptr);
+    REQUIRE(conflict);
+    CHECK(t0 + 150s <= conflict->time);
+    CHECK(conflict->time <= t0 + 151s);
+
+    // Most of the patrol is far away from the parked agent, so the hierarchy
+    // lets the search pass over it without visiting each segment.
+    const auto stats = DetectConflict::get_stats();
+    CHECK(stats.hierarchy_skipped_segments > 100);
+    CHECK(stats.invasion_segment_pairs < 50);
+  }
+
+  WHEN("Another agent waits outside of the patrol")
+  {
+    rmf_traffic::Trajectory parked;
+    parked.insert(t0, {20, 150, 0}, {0, 0, 0});
+    parked.insert(t0 + 200s, {20, 150, 0}, {0, 0, 0});
+
+    CHECK_FALSE(DetectConflict::between(
+        profile, patrol, nullptr, profile, parked, nullptr));
+  }
+
+  DetectConflict::collect_stats(collecting);
+}
+
+//==============================================================================
+SCENARIO("Conflict detection options")
+{
+  using rmf_traffic::DetectConflict;
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+
+  const rmf_traffic::Profile profile{
+    rmf_traffic::geometry::make_final_convex<rmf_traffic::geometry::Circle>(0.5)
+  };
+
+  rmf_traffic::Trajectory A;
+  A.insert(t0, {-10, 0, 0}, {0, 0, 0});
+  A.insert(t0+10s, {10, 0, 0}, {0, 0, 0});
+
+  rmf_traffic::Trajectory B;
+  B.insert(t0, {0, -10, 0}, {0, 0, 0});
+  B.insert(t0+10s, {0, 10, 0}, {0, 0, 0});
+
+  rmf_traffic::Trajectory C;
+  C.insert(t0, {-10, 5, 0}, {0, 0, 0});
+  C.insert(t0+10s, {10, 5, 0}, {0, 0, 0});
+
+  const auto exact = DetectConflict::between(
+    profile, A, nullptr, profile, B, nullptr);
+  REQUIRE(exact);
+
+  WHEN("Using the default options")
+  {
+    const auto conflict = DetectConflict::between(
+      profile, A, nullptr, profile, B, nullptr, DetectConflict::Options());
+    REQUIRE(conflict);
+    CHECK(conflict->time == exact->time);
+  }
+
+  WHEN("Using precise options")
+  {
+    const auto conflict = DetectConflict::between(
+      profile, A, nullptr, profile, B, nullptr,
+      DetectConflict::Options::precise());
+    REQUIRE(conflict);
+    CHECK(rmf_traffic::time::to_seconds(conflict->time - exact->time)
+      == Approx(0.0).margin(1e-5));
+  }
+
+  WHEN("Using fast options")
+  {
+    const auto options = DetectConflict::Options::fast();
+    CHECK_FALSE(options.exact_time);
+
+    const auto conflict = DetectConflict::between(
+      profile, A, nullptr, profile, B, nullptr, options);
+    REQUIRE(conflict);
+    CHECK(conflict->time <= exact->time);
+    CHECK(t0 <= conflict->time);
+
+    CHECK_FALSE(DetectConflict::between(
+      profile, A, nullptr, profile, C, nullptr, options));
+  }
+
+  WHEN("Using options in a batch")
+  {
+    std::vector<DetectConflict::Candidate> candidates;
+    candidates.push_back({&profile, &C});
+    candidates.push_back({&profile, &B});
+
+    DetectConflict::BatchOptions batch;
+    batch.detection = DetectConflict::Options::fast();
+
+    const auto conflicts = DetectConflict::between_many(
+      profile, A, candidates, batch);
+    REQUIRE(conflicts.size() == 1);
+    CHECK(conflicts.front().index == 1);
+    CHECK(conflicts.front().conflict.time <= exact->time);
+  }
+}
+
 // A useful website for playing with 2D cubic splines: https://www.desmos.com/calculator/
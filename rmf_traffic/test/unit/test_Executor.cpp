@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/Executor.hpp>
+#include <rmf_traffic/agv/PlanExecutor.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+
+SCENARIO("Executor")
+{
+  rmf_traffic::Executor::Config config;
+  config.threads = 2;
+  const auto executor = rmf_traffic::Executor::make(config);
+  CHECK(executor->concurrency() == 2);
+
+  WHEN("Tasks are posted")
+  {
+    const std::size_t N = 100;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t finished = 0;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      executor->post(
+        [&]()
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          ++finished;
+          cv.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return finished == N; });
+    CHECK(finished == N);
+  }
+
+  WHEN("Higher priority tasks are waiting with lower priority tasks")
+  {
+    // Keep both threads busy until every task has been posted
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    std::size_t blocked = 0;
+    for (std::size_t i = 0; i < 2; ++i)
+    {
+      executor->post(
+        [&]()
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          ++blocked;
+          cv.notify_all();
+          cv.wait(lock, [&]() { return release; });
+        });
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() { return blocked == 2; });
+    }
+
+    std::vector<rmf_traffic::Executor::Priority> order;
+    std::size_t finished = 0;
+    const auto record = [&](rmf_traffic::Executor::Priority p)
+      {
+        return [&, p]()
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(p);
+            ++finished;
+            cv.notify_all();
+          };
+      };
+
+    using Priority = rmf_traffic::Executor::Priority;
+    executor->post(record(Priority::Low), Priority::Low);
+    executor->post(record(Priority::Normal), Priority::Normal);
+    executor->post(record(Priority::High), Priority::High);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      release = true;
+    }
+    cv.notify_all();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return finished == 3; });
+
+    // Two threads may pick up tasks at the same time, so only the first task
+    // is certain.
+    REQUIRE(order.size() == 3);
+    CHECK(order.front() != Priority::Low);
+  }
+
+  WHEN("Work is run")
+  {
+    const std::size_t N = 1000;
+    std::vector<std::size_t> values(N, 0);
+    executor->run(N, [&](std::size_t i) { values[i] = i; });
+    for (std::size_t i = 0; i < N; ++i)
+      CHECK(values[i] == i);
+  }
+
+  WHEN("Work is run from inside of tasks that occupy every thread")
+  {
+    std::atomic_size_t total = 0;
+    executor->run(
+      4,
+      [&](std::size_t)
+      {
+        executor->run(10, [&](std::size_t) { ++total; });
+      });
+
+    CHECK(total.load() == 40);
+  }
+
+  WHEN("Some of the work throws an exception")
+  {
+    std::atomic_size_t calls = 0;
+    CHECK_THROWS_AS(
+      executor->run(
+        20,
+        [&](std::size_t i)
+        {
+          ++calls;
+          if (i == 5)
+            throw std::runtime_error("failure");
+        }),
+      std::runtime_error);
+
+    // Every call is still made
+    CHECK(calls.load() == 20);
+  }
+
+  WHEN("A plan executor is made from the executor")
+  {
+    const auto plan_executor = rmf_traffic::agv::PlanExecutor::make(executor);
+    CHECK(plan_executor->executor() == executor);
+    CHECK(plan_executor->threads() == 2);
+  }
+}
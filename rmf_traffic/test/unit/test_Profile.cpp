@@ -21,6 +21,7 @@
 
 //#include <rmf_traffic/geometry/Box.hpp>
 #include <src/rmf_traffic/geometry/Box.hpp>
+#include <src/rmf_traffic/ProfileInternal.hpp>
 
 #include <rmf_utils/catch.hpp>
 
@@ -385,3 +386,61 @@ SCENARIO("Testing conflicts", "[close_start]")
         t2, nullptr));
   }
 }
+
+SCENARIO("Testing collision plan")
+{
+  using Profile = rmf_traffic::Profile;
+  using Plan = Profile::Implementation::CollisionPlan;
+
+  const auto circle_1 = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(1.0);
+  const auto other_circle_1 = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Circle>(1.0);
+  const auto box = rmf_traffic::geometry::make_final_convex<
+    rmf_traffic::geometry::Box>(2.0, 2.0);
+
+  const auto get_plan = [](const Profile& profile) -> const Plan&
+    {
+      return Profile::Implementation::get(profile).plan;
+    };
+
+  WHEN("Only a footprint is given")
+  {
+    const Profile profile{circle_1};
+    const auto& plan = get_plan(profile);
+    CHECK(plan.symmetric);
+    CHECK(plan.vicinity == circle_1);
+    CHECK(plan.footprint_radius == Approx(1.0));
+    REQUIRE(plan.footprint_circle);
+    CHECK(*plan.footprint_circle == Approx(1.0));
+  }
+
+  WHEN("The vicinity is an equal but separate shape")
+  {
+    const Profile profile{circle_1, other_circle_1};
+    CHECK(get_plan(profile).symmetric);
+  }
+
+  WHEN("The vicinity is a different shape")
+  {
+    Profile profile{circle_1, box};
+    const auto& plan = get_plan(profile);
+    CHECK_FALSE(plan.symmetric);
+    CHECK_FALSE(plan.vicinity_circle);
+    CHECK(plan.vicinity_radius == Approx(std::sqrt(2.0)));
+
+    THEN("The plan is updated when the vicinity is changed")
+    {
+      profile.vicinity(circle_1);
+      CHECK(get_plan(profile).symmetric);
+      CHECK(get_plan(profile).vicinity_circle);
+    }
+
+    THEN("The plan is updated when the footprint is changed")
+    {
+      profile.footprint(box);
+      CHECK(get_plan(profile).symmetric);
+      CHECK_FALSE(get_plan(profile).footprint_circle);
+    }
+  }
+}
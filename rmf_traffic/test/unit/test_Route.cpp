@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/Route.hpp>
+
+#include <src/rmf_traffic/internal_Route.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <utility>
+
+using namespace std::chrono_literals;
+
+//==============================================================================
+SCENARIO("Routes share their trajectories")
+{
+  const auto now = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(now, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+  trajectory.insert(
+    now + 10s, Eigen::Vector3d(1, 0, 0), Eigen::Vector3d::Zero());
+
+  const rmf_traffic::Route original("test_map", trajectory);
+  rmf_traffic::Route copy = original;
+
+  CHECK(&original.trajectory() == &std::as_const(copy).trajectory());
+
+  WHEN("A copy is modified")
+  {
+    copy.trajectory().front().adjust_times(5s);
+
+    THEN("The original route is not affected")
+    {
+      CHECK(&original.trajectory() != &std::as_const(copy).trajectory());
+      CHECK(*original.trajectory().start_time() == now);
+      CHECK(*std::as_const(copy).trajectory().start_time() == now + 5s);
+    }
+  }
+
+  WHEN("A route is copied after handing out a mutable reference")
+  {
+    rmf_traffic::Trajectory& ref = copy.trajectory();
+    const rmf_traffic::Route second = copy;
+    ref.front().adjust_times(5s);
+
+    THEN("The new copy is not affected by the reference")
+    {
+      CHECK(&second.trajectory() != &ref);
+      CHECK(*second.trajectory().start_time() == now);
+      CHECK(*original.trajectory().start_time() == now);
+      CHECK(*ref.start_time() == now + 5s);
+    }
+  }
+
+  WHEN("A route is assigned a new trajectory")
+  {
+    copy.trajectory(rmf_traffic::Trajectory());
+
+    THEN("The original route is not affected")
+    {
+      CHECK(std::as_const(copy).trajectory().empty());
+      CHECK(original.trajectory().size() == 2);
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Routes apply delays lazily")
+{
+  using rmf_traffic::RouteData;
+
+  const auto now = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(now, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+  trajectory.insert(
+    now + 10s, Eigen::Vector3d(1, 0, 0), Eigen::Vector3d::Zero());
+
+  const rmf_traffic::Route original("test_map", trajectory);
+  rmf_traffic::Route delayed = original;
+  RouteData::delay_route(delayed, 5s);
+  RouteData::delay_route(delayed, 2s);
+
+  const RouteData& data = RouteData::get(delayed);
+  CHECK(data.size() == 2);
+  CHECK(*data.start_time() == now + 7s);
+  CHECK(*data.finish_time() == now + 17s);
+
+  // The waypoints have not been touched yet
+  CHECK(&original.trajectory() == data.trajectory.get());
+
+  WHEN("The delayed trajectory is read")
+  {
+    const rmf_traffic::Trajectory& view = std::as_const(delayed).trajectory();
+
+    THEN("The delay has been applied to it")
+    {
+      CHECK(*view.start_time() == now + 7s);
+      CHECK(*view.finish_time() == now + 17s);
+      CHECK(&view == &std::as_const(delayed).trajectory());
+      CHECK(*original.trajectory().start_time() == now);
+    }
+  }
+
+  WHEN("The delayed route is copied and modified")
+  {
+    rmf_traffic::Route copy = delayed;
+    copy.trajectory().back().position(Eigen::Vector3d(2, 0, 0));
+
+    THEN("The modified copy keeps the delay")
+    {
+      CHECK(*std::as_const(copy).trajectory().start_time() == now + 7s);
+      CHECK(*std::as_const(delayed).trajectory().start_time() == now + 7s);
+      CHECK(std::as_const(delayed).trajectory().back().position().x() == 1.0);
+    }
+  }
+
+  WHEN("A route is delayed after handing out a mutable reference")
+  {
+    rmf_traffic::Route route("test_map", trajectory);
+    rmf_traffic::Trajectory& ref = route.trajectory();
+    RouteData::delay_route(route, 5s);
+
+    THEN("The reference sees the delay")
+    {
+      CHECK(*ref.start_time() == now + 5s);
+      CHECK(&std::as_const(route).trajectory() == &ref);
+    }
+  }
+}
+
+//==============================================================================
+SCENARIO("Route map names are interned")
+{
+  using rmf_traffic::MapName;
+  using rmf_traffic::RouteData;
+
+  const auto now = std::chrono::steady_clock::now();
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(now, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+  trajectory.insert(
+    now + 10s, Eigen::Vector3d(1, 0, 0), Eigen::Vector3d::Zero());
+
+  rmf_traffic::Route a("test_map_interned", trajectory);
+  rmf_traffic::Route b(std::string("test_map_") + "interned", trajectory);
+  CHECK(RouteData::same_map(a, b));
+  CHECK(&a.map() == &b.map());
+  CHECK(MapName::find("test_map_interned") == RouteData::get(a).map.id());
+
+  b.map("test_map_other");
+  CHECK_FALSE(RouteData::same_map(a, b));
+  CHECK(b.map() == "test_map_other");
+  CHECK(a.map() == "test_map_interned");
+
+  CHECK_FALSE(MapName::find("test_map_never_used").has_value());
+  CHECK(MapName().str().empty());
+  CHECK(MapName() == MapName(""));
+}
@@ -19,6 +19,7 @@
 #include <rmf_traffic/geometry/Shape.hpp>
 #include <src/rmf_traffic/geometry/Box.hpp>
 #include <src/rmf_traffic/geometry/SimplePolygon.hpp>
+#include <src/rmf_traffic/geometry/ShapeInternal.hpp>
 
 #include <rmf_utils/catch.hpp>
 
@@ -72,3 +73,95 @@ SCENARIO("Test shapes", "[shape]")
   CHECK(*final_simple_polygon1 != *final_simple_polygon3);
   CHECK(*final_simple_polygon1 != *final_simple_polygon4);
 }
+
+SCENARIO("Interning shapes", "[shape]")
+{
+  using rmf_traffic::geometry::Circle;
+  using FinalShapeImpl = rmf_traffic::geometry::FinalShape::Implementation;
+
+  const auto final_circle1 = rmf_traffic::geometry::make_final_convex<Circle>(
+    1.0);
+  const auto final_circle2 = rmf_traffic::geometry::make_final_convex<Circle>(
+    1.0);
+  const auto final_circle3 = rmf_traffic::geometry::make_final_convex<Circle>(
+    2.0);
+
+  // Equal shapes share their collision geometry even when they are not
+  // interned
+  CHECK(FinalShapeImpl::get_collisions(*final_circle1)
+    == FinalShapeImpl::get_collisions(*final_circle2));
+  CHECK(FinalShapeImpl::get_collisions(*final_circle1)
+    != FinalShapeImpl::get_collisions(*final_circle3));
+
+  const auto final_box1 = rmf_traffic::geometry::make_final_convex(
+    rmf_traffic::geometry::Box(1.0, 1.0));
+  CHECK(FinalShapeImpl::get_collisions(*final_box1)
+    != FinalShapeImpl::get_collisions(*final_circle1));
+
+  const auto interned1 =
+    rmf_traffic::geometry::make_interned_final_convex<Circle>(1.0);
+  const auto interned2 =
+    rmf_traffic::geometry::intern_final_convex(*final_circle2);
+  const auto interned3 =
+    rmf_traffic::geometry::make_interned_final_convex<Circle>(2.0);
+
+  CHECK(interned1 == interned2);
+  CHECK(interned1 != interned3);
+  CHECK(*interned1 == *final_circle1);
+  CHECK(*interned1 != *interned3);
+}
+
+SCENARIO("Decomposing simple polygons", "[shape]")
+{
+  using FinalShapeImpl = rmf_traffic::geometry::FinalShape::Implementation;
+
+  GIVEN("A convex polygon")
+  {
+    const auto final_polygon = rmf_traffic::geometry::make_final(
+      rmf_traffic::geometry::SimplePolygon(
+        {{0.0, 0.0}, {2.0, 0.0}, {2.0, 1.0}, {0.0, 1.0}}));
+
+    CHECK(FinalShapeImpl::get_collisions(*final_polygon).size() == 1);
+    const auto& bounds = FinalShapeImpl::get_bounds(*final_polygon);
+    REQUIRE(bounds.size() == 1);
+    CHECK((bounds.front().center - Eigen::Vector2d(1.0, 0.5)).norm()
+      == Approx(0.0).margin(1e-12));
+    CHECK(bounds.front().radius == Approx(std::sqrt(1.25)));
+  }
+
+  GIVEN("A concave polygon")
+  {
+    // An L shape which needs at least two convex pieces
+    const std::vector<Eigen::Vector2d> points = {
+      {0.0, 0.0}, {2.0, 0.0}, {2.0, 1.0}, {1.0, 1.0}, {1.0, 2.0}, {0.0, 2.0}
+    };
+
+    const auto final_polygon = rmf_traffic::geometry::make_final(
+      rmf_traffic::geometry::SimplePolygon(points));
+
+    // The triangulation has four triangles, and some of them are joined into
+    // larger convex pieces.
+    const auto& collisions = FinalShapeImpl::get_collisions(*final_polygon);
+    CHECK(collisions.size() >= 2);
+    CHECK(collisions.size() <= 3);
+
+    const auto& bounds = FinalShapeImpl::get_bounds(*final_polygon);
+    REQUIRE(bounds.size() == collisions.size());
+    for (const auto& p : points)
+    {
+      const bool bounded = std::any_of(bounds.begin(), bounds.end(),
+          [&p](const auto& b) { return (p - b.center).norm() <= b.radius; });
+      CHECK(bounded);
+    }
+
+    for (const auto& b : bounds)
+      CHECK(b.radius <= std::sqrt(2.0) + 1e-12);
+
+    // The same L shape with its reflex vertex listed first
+    const auto rotated_polygon = rmf_traffic::geometry::make_final(
+      rmf_traffic::geometry::SimplePolygon(
+        {{1.0, 1.0}, {1.0, 2.0}, {0.0, 2.0}, {0.0, 0.0}, {2.0, 0.0},
+          {2.0, 1.0}}));
+    CHECK(FinalShapeImpl::get_collisions(*rotated_polygon).size() >= 2);
+  }
+}
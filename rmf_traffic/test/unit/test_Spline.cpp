@@ -15,6 +15,7 @@
  *
 */
 
+#include <src/rmf_traffic/MotionInternal.hpp>
 #include <src/rmf_traffic/Spline.hpp>
 #include "utils_Trajectory.hpp"
 
@@ -66,3 +67,305 @@ SCENARIO("Test spline")
     CHECK(p[1] == Approx(delta_t.count() - 5.0));
   }
 }
+
+SCENARIO("Batch spline evaluation")
+{
+  using namespace std::chrono_literals;
+
+  const rmf_traffic::Time begin_time = std::chrono::steady_clock::now();
+
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(
+    begin_time,
+    Eigen::Vector3d{-5.0, 0.0, 0.0},
+    Eigen::Vector3d{ 1.0, 0.0, 0.5});
+
+  trajectory.insert(
+    begin_time + 10s,
+    Eigen::Vector3d{ 5.0, 3.0, 1.0},
+    Eigen::Vector3d{ 0.0, 1.0, 0.0});
+
+  trajectory.insert(
+    begin_time + 15s,
+    Eigen::Vector3d{ 5.0, 8.0, -1.0},
+    Eigen::Vector3d{ 0.0, 0.0, 0.0});
+  REQUIRE(trajectory.size() == 3);
+
+  WHEN("Evaluating one spline at many times")
+  {
+    const rmf_traffic::Spline spline(++trajectory.begin());
+
+    std::vector<rmf_traffic::Time> times;
+    for (const auto delta_t : {0ms, 100ms, 1250ms, 5000ms, 7777ms, 10000ms})
+      times.push_back(begin_time + delta_t);
+
+    const Eigen::Matrix3Xd p = spline.compute_positions(times);
+    REQUIRE(p.cols() == static_cast<Eigen::Index>(times.size()));
+
+    for (std::size_t k = 0; k < times.size(); ++k)
+    {
+      const auto i = static_cast<Eigen::Index>(k);
+      CHECK((p.col(i) - spline.compute_position(times[k])).norm()
+        == Approx(0.0).margin(1e-12));
+    }
+  }
+}
+
+SCENARIO("Cached spline parameters")
+{
+  using namespace std::chrono_literals;
+
+  const rmf_traffic::Time begin_time = std::chrono::steady_clock::now();
+
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(
+    begin_time,
+    Eigen::Vector3d{-5.0, 0.0, 0.0},
+    Eigen::Vector3d{ 1.0, 0.0, 0.0});
+
+  trajectory.insert(
+    begin_time + 10s,
+    Eigen::Vector3d{ 5.0, 0.0, 0.0},
+    Eigen::Vector3d{ 1.0, 0.0, 0.0});
+
+  trajectory.insert(
+    begin_time + 20s,
+    Eigen::Vector3d{ 5.0, 10.0, 0.0},
+    Eigen::Vector3d{ 0.0, 0.0, 0.0});
+
+  const auto check_cache = [&]()
+    {
+      const auto cache = rmf_traffic::internal::get_segment_cache(trajectory);
+      REQUIRE(cache->splines.size() == trajectory.size());
+      REQUIRE(cache->times.size() == trajectory.size());
+      for (auto it = trajectory.begin(); it != trajectory.end(); ++it)
+      {
+        const auto i = it->index();
+        CHECK(cache->times[i] == it->time());
+        CHECK(cache->positions[i] == it->position());
+        CHECK(cache->velocities[i] == it->velocity());
+        CHECK(rmf_traffic::internal::get_iterator(trajectory, i) == it);
+      }
+
+      CHECK(rmf_traffic::internal::get_iterator(trajectory, trajectory.size())
+        == trajectory.end());
+
+      for (auto it = ++trajectory.begin(); it != trajectory.end(); ++it)
+      {
+        const rmf_traffic::Spline fresh(it);
+        const rmf_traffic::Spline cached(cache->splines[it->index()]);
+        CHECK(fresh.start_time() == cached.start_time());
+        CHECK(fresh.finish_time() == cached.finish_time());
+        for (const auto t :
+          {fresh.start_time(), fresh.finish_time() - 3s, fresh.finish_time()})
+        {
+          CHECK((fresh.compute_position(t) - cached.compute_position(t)).norm()
+            == Approx(0.0).margin(1e-12));
+        }
+      }
+    };
+
+  check_cache();
+
+  WHEN("A waypoint velocity changes")
+  {
+    trajectory.front().velocity(Eigen::Vector3d{0.0, 2.0, 0.0});
+    check_cache();
+  }
+
+  WHEN("A waypoint time changes")
+  {
+    trajectory.back().adjust_times(5s);
+    check_cache();
+  }
+
+  WHEN("A waypoint is erased")
+  {
+    trajectory.erase(++trajectory.begin());
+    check_cache();
+  }
+}
+
+SCENARIO("Approach times of two splines")
+{
+  using namespace std::chrono_literals;
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+  const Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+
+  // A swings out and back while B passes by, so the distance between them
+  // shrinks, grows, and shrinks again.
+  rmf_traffic::Trajectory a;
+  a.insert(t0, {0.0, 0.0, 0.0}, {0.0, 4.0, 0.0});
+  a.insert(t0 + 10s, {0.0, 0.0, 0.0}, {0.0, -4.0, 0.0});
+
+  rmf_traffic::Trajectory b;
+  b.insert(t0, {-5.0, 2.0, 0.0}, zero);
+  b.insert(t0 + 10s, {5.0, 2.0, 0.0}, zero);
+
+  const rmf_traffic::Spline spline_a(++a.begin());
+  const rmf_traffic::Spline spline_b(++b.begin());
+  const rmf_traffic::DistanceDifferential D(spline_a, spline_b);
+
+  const auto times = D.approach_times();
+  REQUIRE_FALSE(times.empty());
+  CHECK(times.size() <= rmf_traffic::DistanceDifferential::MaxApproachTimes);
+  CHECK(std::is_sorted(times.begin(), times.end()));
+  for (const auto t : times)
+  {
+    CHECK(D.start_time() <= t);
+    CHECK(t <= D.finish_time());
+  }
+}
+
+SCENARIO("Piecewise spline motion")
+{
+  using namespace std::chrono_literals;
+  const auto t0 = rmf_traffic::Time(rmf_traffic::Duration(0));
+
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(t0, {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0});
+  trajectory.insert(t0 + 2s, {2.0, 1.0, 0.5}, {0.0, 1.0, 0.0});
+  trajectory.insert(t0 + 5s, {2.0, 4.0, 1.0}, {-1.0, 0.0, 0.0});
+  trajectory.insert(t0 + 6s, {1.0, 4.0, 1.0}, {0.0, 0.0, 0.0});
+
+  const auto expected_position = [&](const rmf_traffic::Time t)
+    {
+      auto it = ++trajectory.begin();
+      while (it->time() < t && it != --trajectory.end())
+        ++it;
+
+      return rmf_traffic::Spline(it).compute_position(t);
+    };
+
+  const auto motion = rmf_traffic::Motion::compute_cubic_splines(trajectory);
+  CHECK(motion->start_time() == t0);
+  CHECK(motion->finish_time() == t0 + 6s);
+
+  // Sample forwards and then backwards so that the hint has to move both ways
+  std::vector<rmf_traffic::Time> times;
+  for (int ms = 0; ms <= 6000; ms += 250)
+    times.push_back(t0 + std::chrono::milliseconds(ms));
+
+  for (const auto t : times)
+    CHECK((motion->compute_position(t) - expected_position(t)).norm() < 1e-12);
+
+  for (auto it = times.rbegin(); it != times.rend(); ++it)
+  {
+    CHECK(
+      (motion->compute_position(*it) - expected_position(*it)).norm() < 1e-12);
+  }
+
+  WHEN("Only part of the trajectory is used")
+  {
+    const auto partial = rmf_traffic::Motion::compute_cubic_splines(
+      ++trajectory.begin(), --trajectory.end());
+    CHECK(partial->start_time() == t0 + 2s);
+    CHECK(partial->finish_time() == t0 + 5s);
+    CHECK((partial->compute_position(t0 + 3s)
+      - expected_position(t0 + 3s)).norm() < 1e-12);
+
+    const auto single = rmf_traffic::Motion::compute_cubic_splines(
+      ++trajectory.begin(), ++(++trajectory.begin()));
+    CHECK(single->start_time() == t0 + 2s);
+    CHECK(single->finish_time() == t0 + 2s);
+    CHECK((single->compute_position(t0 + 2s)
+      - Eigen::Vector3d(2.0, 1.0, 0.5)).norm() < 1e-12);
+  }
+
+  WHEN("The motion is sampled in batches")
+  {
+    // A visualizer samples every trajectory at 10 Hz
+    std::vector<rmf_traffic::Time> samples;
+    for (int ms = 0; ms <= 6000; ms += 100)
+      samples.push_back(t0 + std::chrono::milliseconds(ms));
+
+    const Eigen::Matrix3Xd p = motion->compute_positions(samples);
+    REQUIRE(p.cols() == static_cast<Eigen::Index>(samples.size()));
+    for (std::size_t k = 0; k < samples.size(); ++k)
+    {
+      CHECK((p.col(static_cast<Eigen::Index>(k))
+        - expected_position(samples[k])).norm() < 1e-12);
+    }
+
+    // Times that are out of order are still sampled correctly
+    const std::vector<rmf_traffic::Time> shuffled = {
+      t0 + 5500ms, t0 + 1s, t0 + 4s, t0 + 2s, t0 + 2100ms, t0 + 6s, t0};
+    const Eigen::Matrix3Xd q = motion->compute_positions(shuffled);
+    for (std::size_t k = 0; k < shuffled.size(); ++k)
+    {
+      CHECK((q.col(static_cast<Eigen::Index>(k))
+        - expected_position(shuffled[k])).norm() < 1e-12);
+    }
+
+    const auto single = rmf_traffic::Motion::compute_cubic_splines(
+      trajectory.begin(), ++trajectory.begin());
+    const Eigen::Matrix3Xd r = single->compute_positions({t0, t0});
+    REQUIRE(r.cols() == 2);
+    CHECK(r.col(0).norm() < 1e-12);
+    CHECK(r.col(1).norm() < 1e-12);
+  }
+
+  WHEN("The trajectory changes after the motion was made")
+  {
+    const rmf_traffic::PiecewiseSplineMotion before(trajectory);
+    const Eigen::Vector3d p = before.compute_position(t0 + 3s);
+
+    trajectory.begin()->position({-5.0, -5.0, 0.0});
+    (++trajectory.begin())->position({10.0, 10.0, 0.0});
+
+    CHECK((before.compute_position(t0 + 3s) - p).norm() < 1e-12);
+
+    const rmf_traffic::PiecewiseSplineMotion after(trajectory);
+    CHECK((after.compute_position(t0 + 3s) - p).norm() > 1.0);
+  }
+}
+
+#ifdef RMF_TRAFFIC__USING_FCL_0_6
+SCENARIO("Reusable FCL spline motion")
+{
+  using namespace std::chrono_literals;
+
+  const rmf_traffic::Time begin_time = std::chrono::steady_clock::now();
+
+  rmf_traffic::Trajectory trajectory;
+  trajectory.insert(
+    begin_time,
+    Eigen::Vector3d{-5.0, 0.0, 0.0},
+    Eigen::Vector3d{ 1.0, 0.0, 0.5});
+
+  trajectory.insert(
+    begin_time + 10s,
+    Eigen::Vector3d{ 5.0, 3.0, 1.0},
+    Eigen::Vector3d{ 0.0, 1.0, 0.0});
+
+  trajectory.insert(
+    begin_time + 15s,
+    Eigen::Vector3d{ 5.0, 8.0, 1.0},
+    Eigen::Vector3d{ 0.0, 0.0, 0.0});
+  REQUIRE(trajectory.size() == 3);
+
+  rmf_traffic::ReusableFclSplineMotion reusable;
+  for (auto it = ++trajectory.begin(); it != trajectory.end(); ++it)
+  {
+    const rmf_traffic::Spline spline(it);
+    const auto start = spline.start_time() + 1s;
+    const auto finish = spline.finish_time();
+
+    const auto expected = spline.to_fcl(start, finish);
+    reusable.reset(spline, start, finish);
+
+    for (const double t : {0.0, 0.25, 0.5, 0.75, 1.0})
+    {
+      expected.integrate(t);
+      reusable.integrate(t);
+
+      fcl::Transform3d tf_expected;
+      fcl::Transform3d tf_reusable;
+      expected.getCurrentTransform(tf_expected);
+      reusable.getCurrentTransform(tf_reusable);
+
+      CHECK(tf_expected.isApprox(tf_reusable));
+    }
+  }
+}
+#endif
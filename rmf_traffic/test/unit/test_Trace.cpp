@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2021 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <rmf_traffic/debug/Trace.hpp>
+
+#include <rmf_utils/catch.hpp>
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+//==============================================================================
+/// Installs a sink for the lifetime of a test, and removes it afterwards
+class InstallSink
+{
+public:
+
+  InstallSink(std::shared_ptr<rmf_traffic::debug::TraceSink> sink)
+  {
+    rmf_traffic::debug::Trace::set_sink(std::move(sink));
+  }
+
+  ~InstallSink()
+  {
+    rmf_traffic::debug::Trace::set_sink(nullptr);
+  }
+};
+} // anonymous namespace
+
+//==============================================================================
+SCENARIO("Tracing spans")
+{
+  using namespace std::chrono_literals;
+  using rmf_traffic::debug::ScopedTrace;
+  using rmf_traffic::debug::Trace;
+  using rmf_traffic::debug::TraceSpan;
+
+  GIVEN("No sink")
+  {
+    CHECK_FALSE(Trace::active());
+    CHECK_FALSE(Trace::get_sink());
+
+    // Nothing should happen
+    ScopedTrace trace("test.idle");
+  }
+
+  GIVEN("A callback sink")
+  {
+    std::vector<TraceSpan> spans;
+    const InstallSink install(
+      std::make_shared<rmf_traffic::debug::CallbackTraceSink>(
+        [&](const TraceSpan& span) { spans.push_back(span); }));
+
+    CHECK(Trace::active());
+
+    {
+      ScopedTrace outer("test.outer");
+      {
+        ScopedTrace inner("test.inner");
+        std::this_thread::sleep_for(1ms);
+      }
+    }
+
+    REQUIRE(spans.size() == 2);
+    CHECK(std::string(spans[0].category) == "test.inner");
+    CHECK(std::string(spans[1].category) == "test.outer");
+    CHECK(spans[0].finish - spans[0].start >= 1ms);
+    CHECK(spans[1].start <= spans[0].start);
+    CHECK(spans[0].finish <= spans[1].finish);
+    CHECK(spans[0].thread == spans[1].thread);
+  }
+
+  GIVEN("A sink that is removed while a span is in progress")
+  {
+    std::size_t count = 0;
+    Trace::set_sink(
+      std::make_shared<rmf_traffic::debug::CallbackTraceSink>(
+        [&](const TraceSpan&) { ++count; }));
+
+    {
+      ScopedTrace trace("test.removed");
+      Trace::set_sink(nullptr);
+    }
+
+    CHECK(count == 0);
+    CHECK_FALSE(Trace::active());
+  }
+
+  GIVEN("A Chrome trace sink")
+  {
+    const auto sink = std::make_shared<rmf_traffic::debug::ChromeTraceSink>();
+    const InstallSink install(sink);
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      threads.emplace_back([]()
+        {
+          for (std::size_t j = 0; j < 10; ++j)
+            ScopedTrace trace("test.\"quoted\"");
+        });
+    }
+
+    for (auto& t : threads)
+      t.join();
+
+    CHECK(sink->size() == 40);
+
+    std::stringstream ss;
+    sink->write(ss);
+    const std::string json = ss.str();
+    CHECK(json.find("{\"traceEvents\":[") == 0);
+    CHECK(json.find("\"name\":\"test.\\\"quoted\\\"\"") != json.npos);
+    CHECK(json.find("\"ph\":\"X\"") != json.npos);
+
+    sink->clear();
+    CHECK(sink->size() == 0);
+  }
+
+  GIVEN("A counter sink")
+  {
+    const auto sink = std::make_shared<rmf_traffic::debug::CounterTraceSink>();
+    const InstallSink install(sink);
+
+    for (std::size_t i = 0; i < 3; ++i)
+      ScopedTrace trace("test.counted");
+
+    {
+      ScopedTrace trace("test.slow");
+      std::this_thread::sleep_for(2ms);
+    }
+
+    const auto counters = sink->counters();
+    REQUIRE(counters.size() == 2);
+    CHECK(counters.at("test.counted").count == 3);
+    CHECK(counters.at("test.counted").max <= counters.at("test.counted").total);
+    CHECK(counters.at("test.slow").count == 1);
+    CHECK(counters.at("test.slow").max >= 2ms);
+
+    sink->reset();
+    CHECK(sink->counters().empty());
+  }
+
+  GIVEN("A sample interval")
+  {
+    const auto sink = std::make_shared<rmf_traffic::debug::CounterTraceSink>();
+    const InstallSink install(sink);
+
+    Trace::set_sample_interval(5);
+    CHECK(Trace::sample_interval() == 5);
+
+    for (std::size_t i = 0; i < 100; ++i)
+      ScopedTrace trace("test.sampled");
+
+    Trace::set_sample_interval(0);
+    CHECK(Trace::sample_interval() == 1);
+
+    CHECK(sink->counters().at("test.sampled").count == 20);
+  }
+}
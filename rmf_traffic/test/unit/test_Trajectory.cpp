@@ -17,6 +17,7 @@
 
 #include "utils_Trajectory.hpp"
 #include <src/rmf_traffic/debug_Trajectory.hpp>
+#include <src/rmf_traffic/TrajectoryInternal.hpp>
 #include <rmf_utils/catch.hpp>
 #include <iostream>
 
@@ -779,12 +780,13 @@ SCENARIO("Trajectory and base_iterator unit tests")
         CHECK(trajectory_copy.size() == 3);
         CHECK(trajectory.size() == 3);
         const rmf_traffic::Trajectory::iterator erase_first =
-          trajectory.begin();
-        const rmf_traffic::Trajectory::iterator erase_last = trajectory.find(
-          time + 10s);
+          trajectory_copy.begin();
+        const rmf_traffic::Trajectory::iterator erase_last =
+          trajectory_copy.find(time + 10s);
         const rmf_traffic::Trajectory::iterator next_it = trajectory_copy.erase(
           erase_first, erase_last);
         CHECK(trajectory_copy.size() == 2);
+        CHECK(trajectory.size() == 3);
         CHECK(next_it->time() == time + 10s);
       }
     }
@@ -813,12 +815,13 @@ SCENARIO("Trajectory and base_iterator unit tests")
         CHECK(trajectory_copy.size() == 3);
         CHECK(trajectory.size() == 3);
         const rmf_traffic::Trajectory::iterator erase_first =
-          trajectory.begin();
-        const rmf_traffic::Trajectory::iterator erase_last = trajectory.find(
-          time + 20s);
+          trajectory_copy.begin();
+        const rmf_traffic::Trajectory::iterator erase_last =
+          trajectory_copy.find(time + 20s);
         const rmf_traffic::Trajectory::iterator next_it = trajectory_copy.erase(
           erase_first, erase_last);
         CHECK(trajectory_copy.size() == 1);
+        CHECK(trajectory.size() == 3);
         CHECK(next_it->time() == time + 20s);
       }
     }
@@ -951,3 +954,350 @@ SCENARIO("Trajectory and base_iterator unit tests")
     }
   }
 }
+
+SCENARIO("Inline trajectory storage")
+{
+  GIVEN("An inline memory resource")
+  {
+    using Resource = rmf_traffic::internal::InlineResource<64>;
+    Resource resource;
+
+    void* const a = resource.allocate(20);
+    void* const b = resource.allocate(32);
+    CHECK(resource.owns(a));
+    CHECK(resource.owns(b));
+
+    // The buffer is used up, so this request goes to the heap
+    void* const c = resource.allocate(32);
+    CHECK_FALSE(resource.owns(c));
+
+    WHEN("A block is returned to the buffer")
+    {
+      resource.deallocate(b, 32);
+
+      THEN("It is reused for a request with the same size")
+      {
+        void* const d = resource.allocate(32);
+        CHECK(d == b);
+        resource.deallocate(d, 32);
+      }
+    }
+
+    WHEN("A block is returned and a different size is requested")
+    {
+      resource.deallocate(a, 20);
+
+      THEN("The block is not reused")
+      {
+        void* const d = resource.allocate(48);
+        CHECK(d != a);
+        CHECK_FALSE(resource.owns(d));
+        resource.deallocate(d, 48);
+      }
+
+      resource.deallocate(b, 32);
+    }
+
+    resource.deallocate(c, 32);
+  }
+
+  GIVEN("An inline memory resource with reserved room")
+  {
+    using Resource = rmf_traffic::internal::InlineResource<64>;
+    Resource resource;
+
+    void* const a = resource.allocate(64);
+    resource.reserve(4*32);
+    const std::size_t reserved = resource.heap_bytes();
+    CHECK(reserved > 0);
+
+    // The requests are handed out of the reserved room without going back to
+    // the heap
+    std::vector<void*> blocks;
+    for (std::size_t i = 0; i < 4; ++i)
+      blocks.push_back(resource.allocate(32));
+
+    CHECK(resource.heap_bytes() == reserved);
+
+    // A block from the reserved room is reused like a block of the buffer
+    resource.deallocate(blocks.back(), 32);
+    CHECK(resource.allocate(32) == blocks.back());
+    CHECK(resource.heap_bytes() == reserved);
+
+    for (void* const block : blocks)
+      resource.deallocate(block, 32);
+
+    resource.deallocate(a, 64);
+  }
+
+  GIVEN("A trajectory that outgrows its inline storage")
+  {
+    const auto time = std::chrono::steady_clock::now();
+    const std::size_t N = 3*rmf_traffic::internal::TrajectoryInlineWaypoints;
+
+    rmf_traffic::Trajectory trajectory;
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      const double x = static_cast<double>(i);
+      trajectory.insert(
+        time + std::chrono::seconds(N - i),
+        Eigen::Vector3d(x, 0, 0),
+        Eigen::Vector3d::Zero());
+    }
+
+    REQUIRE(trajectory.size() == N);
+    CHECK(consistent_trajectory_indices(trajectory));
+
+    WHEN("It is copied")
+    {
+      const rmf_traffic::Trajectory copy = trajectory;
+
+      THEN("The copy has the same waypoints")
+      {
+        REQUIRE(copy.size() == N);
+        CHECK(consistent_trajectory_indices(copy));
+        for (std::size_t i = 0; i < N; ++i)
+        {
+          CHECK(copy[i].time() == trajectory[i].time());
+          CHECK(copy[i].position() == trajectory[i].position());
+        }
+      }
+    }
+
+    WHEN("It shrinks and grows again")
+    {
+      trajectory.erase(trajectory.begin(), trajectory.find(time + 10s));
+      const std::size_t remaining = trajectory.size();
+      CHECK(consistent_trajectory_indices(trajectory));
+
+      for (std::size_t i = 0; i < N; ++i)
+      {
+        trajectory.insert(
+          time + std::chrono::seconds(N + 1 + i),
+          Eigen::Vector3d::Zero(),
+          Eigen::Vector3d::Zero());
+      }
+
+      THEN("Its waypoints are consistent")
+      {
+        CHECK(trajectory.size() == remaining + N);
+        CHECK(consistent_trajectory_indices(trajectory));
+        CHECK(trajectory.front().position().x() == static_cast<double>(N - 10));
+      }
+    }
+  }
+}
+
+SCENARIO("Appending presorted waypoints")
+{
+  using Point = rmf_traffic::Trajectory::Point;
+  const auto time = std::chrono::steady_clock::now();
+
+  const auto make_points = [&](const std::size_t begin, const std::size_t end)
+    {
+      std::vector<Point> points;
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        const double x = static_cast<double>(i);
+        points.push_back(
+          {time + std::chrono::seconds(i),
+            Eigen::Vector3d(x, 0, 0),
+            Eigen::Vector3d(1, 0, 0)});
+      }
+
+      return points;
+    };
+
+  for (const std::size_t N : {std::size_t(3), std::size_t(100)})
+  {
+    const auto points = make_points(0, N);
+    const rmf_traffic::Trajectory sorted(points);
+
+    rmf_traffic::Trajectory inserted;
+    for (const auto& point : points)
+      inserted.insert(point.time, point.position, point.velocity);
+
+    REQUIRE(sorted.size() == N);
+    CHECK(consistent_trajectory_indices(sorted));
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      CHECK(sorted[i].time() == inserted[i].time());
+      CHECK(sorted[i].position() == inserted[i].position());
+      CHECK(sorted[i].velocity() == inserted[i].velocity());
+    }
+
+    CHECK(sorted.find(time + std::chrono::seconds(N/2))->index() == N/2);
+  }
+
+  GIVEN("A trajectory that already has waypoints")
+  {
+    rmf_traffic::Trajectory trajectory(make_points(0, 10));
+
+    WHEN("Later waypoints are appended")
+    {
+      trajectory.append_sorted(make_points(10, 50));
+
+      THEN("They come after the original waypoints")
+      {
+        REQUIRE(trajectory.size() == 50);
+        CHECK(consistent_trajectory_indices(trajectory));
+        CHECK(trajectory.back().position().x() == 49.0);
+      }
+
+      THEN("The trajectory can still be modified one waypoint at a time")
+      {
+        trajectory.insert(time - 1s, Eigen::Vector3d::Zero(),
+          Eigen::Vector3d::Zero());
+        trajectory.erase(trajectory.find(time + 20s));
+        CHECK(trajectory.size() == 50);
+        CHECK(consistent_trajectory_indices(trajectory));
+      }
+    }
+
+    WHEN("The waypoints overlap with the trajectory")
+    {
+      CHECK_THROWS_AS(
+        trajectory.append_sorted(make_points(9, 20)), std::invalid_argument);
+      CHECK(trajectory.size() == 10);
+    }
+
+    WHEN("The waypoints are not sorted")
+    {
+      auto points = make_points(10, 20);
+      std::swap(points[3], points[4]);
+      CHECK_THROWS_AS(trajectory.append_sorted(points), std::invalid_argument);
+      CHECK(trajectory.size() == 10);
+      CHECK(consistent_trajectory_indices(trajectory));
+    }
+  }
+}
+
+SCENARIO("Seeking times with a hint")
+{
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<rmf_traffic::Time> times;
+  for (std::size_t i = 0; i < 50; ++i)
+    times.push_back(start + std::chrono::seconds(2*i));
+
+  const auto expected = [&](const rmf_traffic::Time t) -> std::size_t
+    {
+      return std::lower_bound(times.begin(), times.end(), t) - times.begin();
+    };
+
+  WHEN("Any hint is used")
+  {
+    for (std::size_t hint = 0; hint <= times.size() + 1; hint += 7)
+    {
+      for (int s = -1; s <= 100; ++s)
+      {
+        const auto t = start + std::chrono::seconds(s);
+        CHECK(rmf_traffic::internal::seek_time(times, hint, t) == expected(t));
+      }
+    }
+  }
+
+  WHEN("A cursor samples forwards and backwards")
+  {
+    rmf_traffic::internal::TimeCursor cursor(times);
+    for (int s = -1; s <= 100; ++s)
+    {
+      const auto t = start + std::chrono::seconds(s);
+      CHECK(cursor.lower_bound(t) == expected(t));
+    }
+
+    for (int s = 100; s >= -1; s -= 3)
+    {
+      const auto t = start + std::chrono::seconds(s);
+      CHECK(cursor.lower_bound(t) == expected(t));
+    }
+  }
+}
+
+SCENARIO("Segment hierarchy of long trajectories")
+{
+  using rmf_traffic::internal::find_overlapping_segment;
+  using rmf_traffic::internal::get_segment_cache;
+  using rmf_traffic::internal::BoundingBox;
+
+  const auto start = std::chrono::steady_clock::now();
+  const Eigen::Vector3d zero = Eigen::Vector3d::Zero();
+
+  // A patrol that sweeps back and forth along a row of lanes
+  const auto make_patrol = [&](const std::size_t waypoints)
+    {
+      rmf_traffic::Trajectory patrol;
+      for (std::size_t i = 0; i < waypoints; ++i)
+      {
+        const double x = (i % 2 == 0) ? 0.0 : 10.0;
+        const double y = 2.0 * static_cast<double>(i / 2);
+        patrol.insert(start + std::chrono::seconds(i), {x, y, 0.0}, zero);
+      }
+
+      return patrol;
+    };
+
+  const auto scan = [](
+    const rmf_traffic::internal::SegmentCache& cache,
+    const std::size_t first,
+    const std::size_t last,
+    const BoundingBox& box) -> std::size_t
+    {
+      for (std::size_t i = first; i < last; ++i)
+      {
+        const auto& b = cache.bounds[i];
+        if ((b.min.array() <= box.max.array()).all()
+          && (box.min.array() <= b.max.array()).all())
+          return i;
+      }
+
+      return last;
+    };
+
+  const std::vector<BoundingBox> boxes = {
+    {{-1.0, -1.0}, {1.0, 1.0}},
+    {{4.0, 50.0}, {6.0, 51.0}},
+    {{9.5, 150.0}, {20.0, 300.0}},
+    {{-5.0, 500.0}, {5.0, 600.0}},
+    {{20.0, 0.0}, {30.0, 100.0}}
+  };
+
+  WHEN("The trajectory is short")
+  {
+    const auto cache = get_segment_cache(make_patrol(20));
+    CHECK(cache->hierarchy.empty());
+
+    for (const auto& box : boxes)
+    {
+      CHECK(find_overlapping_segment(*cache, 1, 20, box)
+        == scan(*cache, 1, 20, box));
+    }
+  }
+
+  WHEN("The trajectory is long")
+  {
+    const std::size_t N = 301;
+    const auto cache = get_segment_cache(make_patrol(N));
+    REQUIRE_FALSE(cache->hierarchy.empty());
+
+    const auto& root = cache->hierarchy.front();
+    CHECK(root.begin == 1);
+    CHECK(root.end == N);
+    CHECK(root.bounds.min == cache->total_bounds.min);
+    CHECK(root.bounds.max == cache->total_bounds.max);
+
+    THEN("Every search matches a scan through the segments")
+    {
+      for (const auto& box : boxes)
+      {
+        for (std::size_t first = 1; first < N; first += 37)
+        {
+          for (std::size_t last = first; last <= N; last += 53)
+          {
+            CHECK(find_overlapping_segment(*cache, first, last, box)
+              == scan(*cache, first, last, box));
+          }
+        }
+      }
+    }
+  }
+}